@@ -739,6 +739,85 @@ namespace bliss
       constexpr std::array<uint8_t, DNA16_T<DUMMY>::SIZE> DNA16_T<DUMMY>::TO_COMPLEMENT;
 
 
+      /**
+       * @brief amino acid alphabet:  the 20 standard amino acids, the stop codon '*', and X for any other character.
+       * @details  22 symbols, packed in 5 bits.  the order is alphabetical by 1 letter code, so kmers compare
+       *        lexicographically.  B, Z, J, U, and O map to X.  there is no complement, so to_complement is the identity
+       *        and reverse_complement of a peptide kmer only reverses it.  see common/translation.hpp for generating
+       *        peptide kmers from DNA.
+       */
+      template <typename DUMMY = void>
+      struct AA_T : BaseAlphabetChar
+      {
+        AA_T& operator=(const CharType& c){ BaseAlphabetChar::operator=(c); return *this;}
+        AA_T(const CharType& c) : BaseAlphabetChar(c) {}
+        AA_T() : BaseAlphabetChar() {}
+
+        /// alphabet size
+        static constexpr AlphabetSizeType SIZE = 22;
+
+        /// code of the stop codon, and of unknown amino acids.
+        static constexpr uint8_t STOP = 20;
+        static constexpr uint8_t UNKNOWN = 21;
+
+        /// ascii to alphabet lookup table
+        static constexpr std::array<uint8_t, 256> FROM_ASCII =
+        {{
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+       //                                         '*'
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 20, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+       //     'A'     'C' 'D' 'E' 'F' 'G' 'H' 'I'     'K' 'L' 'M' 'N'
+          21,  0, 21,  1,  2,  3,  4,  5,  6,  7, 21,  8,  9, 10, 11, 21,
+       // 'P' 'Q' 'R' 'S' 'T'     'V' 'W'     'Y'
+          12, 13, 14, 15, 16, 21, 17, 18, 21, 19, 21, 21, 21, 21, 21, 21,
+       //     'a'     'c' 'd' 'e' 'f' 'g' 'h' 'i'     'k' 'l' 'm' 'n'
+          21,  0, 21,  1,  2,  3,  4,  5,  6,  7, 21,  8,  9, 10, 11, 21,
+       // 'p' 'q' 'r' 's' 't'     'v' 'w'     'y'
+          12, 13, 14, 15, 16, 21, 17, 18, 21, 19, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+          21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21
+        }};
+
+        /// alphabet to ascii lookup table
+        static constexpr std::array<char, SIZE> TO_ASCII =
+        {{
+          'A', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'K', 'L', 'M',   // = 0 - 10
+          'N', 'P', 'Q', 'R', 'S', 'T', 'V', 'W', 'Y',             // = 11 - 19
+          '*',  // = 20  stop
+          'X'   // = 21  unknown
+        }};
+
+        /// complement lookup table.  identity.
+        static constexpr std::array<uint8_t, SIZE> TO_COMPLEMENT =
+        {{
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21
+        }};
+
+        static inline uint8_t to_complement(uint8_t const & x) {
+        	return x;
+        }
+      };
+
+      template <typename DUMMY>
+      constexpr uint8_t AA_T<DUMMY>::STOP;
+      template <typename DUMMY>
+      constexpr uint8_t AA_T<DUMMY>::UNKNOWN;
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, 256> AA_T<DUMMY>::FROM_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<char, AA_T<DUMMY>::SIZE> AA_T<DUMMY>::TO_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, AA_T<DUMMY>::SIZE> AA_T<DUMMY>::TO_COMPLEMENT;
+
+
     } // namespace alphabet
 
       using ASCII = ::bliss::common::alphabet::ASCII_T<>;
@@ -750,6 +829,7 @@ namespace bliss
       using RNA6 = ::bliss::common::alphabet::RNA6_T<>;
       using DNA16 = ::bliss::common::alphabet::DNA16_T<>;
       using DNA_IUPAC = ::bliss::common::alphabet::DNA_IUPAC_T<>;
+      using AA = ::bliss::common::alphabet::AA_T<>;
 
 
   } // namespace common
@@ -50,6 +50,9 @@
 #include "common/padding.hpp"
 #include "utils/kmer_utils.hpp"
 #include "utils/bitgroup_ops.hpp"
+#if defined(USE_RUNTIME_SIMD_DISPATCH)
+#include "utils/bitgroup_dispatch.hpp"
+#endif
 
 #define KMER_INLINE inline
 
@@ -64,6 +67,48 @@ namespace bliss
 
 
 
+  namespace detail {
+
+    /**
+     * @brief  fast paths for k-mers stored in 1 word, or in 2 64 bit words where 128 bit integers are available (K 33..64 for DNA).
+     * @details  the words are loaded into 1 scalar, so that comparison and shifts are single integer operations
+     *           instead of loops over the words.  other word counts use the bit_ops implementations (fast = false).
+     */
+    template <typename WORD_TYPE, unsigned int N>
+    struct kmer_words {
+        static constexpr bool fast = false;
+    };
+
+    template <typename WORD_TYPE>
+    struct kmer_words<WORD_TYPE, 1> {
+        static constexpr bool fast = true;
+        typedef WORD_TYPE scalar_type;
+        static constexpr unsigned int bits = sizeof(scalar_type) * 8;
+
+        static inline scalar_type load(WORD_TYPE const (&d)[1]) { return d[0]; }
+        static inline void store(WORD_TYPE (&d)[1], scalar_type const & x) { d[0] = x; }
+    };
+
+#if defined(__SIZEOF_INT128__)
+    template <>
+    struct kmer_words<uint64_t, 2> {
+        static constexpr bool fast = true;
+        typedef unsigned __int128 scalar_type;
+        static constexpr unsigned int bits = sizeof(scalar_type) * 8;
+
+        static inline scalar_type load(uint64_t const (&d)[2]) {
+          return (static_cast<scalar_type>(d[1]) << 64) | static_cast<scalar_type>(d[0]);
+        }
+        static inline void store(uint64_t (&d)[2], scalar_type const & x) {
+          d[0] = static_cast<uint64_t>(x);
+          d[1] = static_cast<uint64_t>(x >> 64);
+        }
+    };
+#endif
+
+  } // namespace detail
+
+
   /**
    * @brief   Implements a general templated k-mer class.
    *
@@ -147,6 +192,13 @@ namespace bliss
     /// The number of stored words inside the Kmer
     static constexpr unsigned int nWords = bitstream::nWords;
     static constexpr unsigned int nBytes = bitstream::nBytes;
+
+  protected:
+    /// single scalar operations for 1 and 2 word k-mers, see detail::kmer_words
+    typedef ::bliss::common::detail::kmer_words<WORD_TYPE, nWords> word_ops;
+    typedef ::std::integral_constant<bool, word_ops::fast> fast_words;
+
+  public:
   
    private:
   
@@ -775,7 +827,7 @@ namespace bliss
     KMER_INLINE bool operator==(const Kmer& rhs) const
     {
       // MUST COMPARE ALL BITS, INCLUDING UNUSED
-    	return ::bliss::utils::bit_ops::equal<WORD_TYPE, nWords>(data, rhs.data);
+    	return do_equal(rhs, fast_words());
     }
 
     /**
@@ -804,7 +856,7 @@ namespace bliss
      */
     KMER_INLINE bool operator<(const Kmer& rhs) const
     {
-    	return ::bliss::utils::bit_ops::less<WORD_TYPE, nWords>(data, rhs.data);
+    	return do_less(rhs, fast_words());
     }
   
     /**
@@ -846,7 +898,7 @@ namespace bliss
   
 
     KMER_INLINE int8_t compare(const Kmer& rhs) const {
-      return ::bliss::utils::bit_ops::compare<WORD_TYPE, nWords>(data, rhs.data);
+      return do_compare(rhs, fast_words());
     }
 
     /* bit operators */
@@ -980,15 +1032,13 @@ namespace bliss
     template <uint16_t shift = bitsPerChar>
     KMER_INLINE void left_shift_bits()
     {
-    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
-    	::bliss::utils::bit_ops::left_shift<SIMD, shift, WORD_TYPE, nWords>(data, data);
+    	do_left_shift_bits<shift>(data, fast_words());
     	do_sanitize();
     }
     template <uint16_t shift = bitsPerChar>
     KMER_INLINE void left_shift_bits(Kmer const & src)
     {
-    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
-    	::bliss::utils::bit_ops::left_shift<SIMD, shift, WORD_TYPE, nWords>(data, src.data);
+    	do_left_shift_bits<shift>(src.data, fast_words());
     	do_sanitize();
     }
 
@@ -1034,14 +1084,12 @@ namespace bliss
     template <uint16_t shift = bitsPerChar>
     KMER_INLINE void right_shift_bits()
     {
-    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
-    	::bliss::utils::bit_ops::right_shift<SIMD, shift, WORD_TYPE, nWords>(data, data);
+    	do_right_shift_bits<shift>(data, fast_words());
     }
     template <uint16_t shift = bitsPerChar>
     KMER_INLINE void right_shift_bits(Kmer const & src)
     {
-    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
-    	::bliss::utils::bit_ops::right_shift<SIMD, shift, WORD_TYPE, nWords>(data, src.data);
+    	do_right_shift_bits<shift>(src.data, fast_words());
     }
   
     /**
@@ -1273,12 +1321,68 @@ namespace bliss
       // left shift k-mer
       // TODO: replace by single shift operation
       this->template right_shift_bits<shift>();
-  
-      // add character to least significant end (requires least shifting)
-      data[nWords - 1] |= (static_cast<WORD_TYPE>(w) &
-          getLeastSignificantBitsMask<WORD_TYPE>(shift)) << (bitstream::invPadBits - shift);
+
+      // add character to the most significant end.
+      constexpr unsigned int inLast = (bitstream::invPadBits < shift) ? bitstream::invPadBits : shift;
+      constexpr unsigned int inPrev = shift - inLast;
+      WORD_TYPE v = static_cast<WORD_TYPE>(w) & getLeastSignificantBitsMask<WORD_TYPE>(shift);
+      data[nWords - 1] |= static_cast<WORD_TYPE>(v >> inPrev) << (bitstream::invPadBits - inLast);
+      // the character is split across the last 2 words:  its low bits are the high bits of the previous word.
+      if ((inPrev > 0) && (nWords > 1))
+        data[(nWords > 1) ? (nWords - 2) : 0] |= static_cast<WORD_TYPE>(v << ((sizeof(WORD_TYPE) * 8 - inPrev) % (sizeof(WORD_TYPE) * 8)));
     }
   
+    /// comparisons of 1 or 2 word k-mers as 1 scalar.
+    KMER_INLINE bool do_equal(Kmer const & rhs, ::std::true_type const &) const
+    {
+      return word_ops::load(data) == word_ops::load(rhs.data);
+    }
+    KMER_INLINE bool do_equal(Kmer const & rhs, ::std::false_type const &) const
+    {
+      return ::bliss::utils::bit_ops::equal<WORD_TYPE, nWords>(data, rhs.data);
+    }
+    KMER_INLINE bool do_less(Kmer const & rhs, ::std::true_type const &) const
+    {
+      return word_ops::load(data) < word_ops::load(rhs.data);
+    }
+    KMER_INLINE bool do_less(Kmer const & rhs, ::std::false_type const &) const
+    {
+      return ::bliss::utils::bit_ops::less<WORD_TYPE, nWords>(data, rhs.data);
+    }
+    KMER_INLINE int8_t do_compare(Kmer const & rhs, ::std::true_type const &) const
+    {
+      typename word_ops::scalar_type x = word_ops::load(data), y = word_ops::load(rhs.data);
+      return (x == y) ? 0 : ((x < y) ? -1 : 1);
+    }
+    KMER_INLINE int8_t do_compare(Kmer const & rhs, ::std::false_type const &) const
+    {
+      return ::bliss::utils::bit_ops::compare<WORD_TYPE, nWords>(data, rhs.data);
+    }
+
+    /// compile time shifts of 1 or 2 word k-mers as 1 scalar.  shifts of the full width or more give 0.
+    template <uint16_t shift>
+    KMER_INLINE void do_left_shift_bits(WORD_TYPE const (&src)[nWords], ::std::true_type const &)
+    {
+      word_ops::store(data, (shift >= word_ops::bits) ? 0 : (word_ops::load(src) << (shift % word_ops::bits)));
+    }
+    template <uint16_t shift>
+    KMER_INLINE void do_left_shift_bits(WORD_TYPE const (&src)[nWords], ::std::false_type const &)
+    {
+    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
+    	::bliss::utils::bit_ops::left_shift<SIMD, shift, WORD_TYPE, nWords>(data, const_cast<WORD_TYPE (&)[nWords]>(src));
+    }
+    template <uint16_t shift>
+    KMER_INLINE void do_right_shift_bits(WORD_TYPE const (&src)[nWords], ::std::true_type const &)
+    {
+      word_ops::store(data, (shift >= word_ops::bits) ? 0 : (word_ops::load(src) >> (shift % word_ops::bits)));
+    }
+    template <uint16_t shift>
+    KMER_INLINE void do_right_shift_bits(WORD_TYPE const (&src)[nWords], ::std::false_type const &)
+    {
+    	using SIMD = ::bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<(nWords * sizeof(WORD_TYPE))>;
+    	::bliss::utils::bit_ops::right_shift<SIMD, shift, WORD_TYPE, nWords>(data, const_cast<WORD_TYPE (&)[nWords]>(src));
+    }
+
     /**
      * @brief Sets all unused bits of the underlying k-mer data to 0.
      * @details  highest order bits in highest number element are 0.
@@ -1304,9 +1408,18 @@ namespace bliss
      *
      * @param shift   The number of bits to shift by.
      */
-    // TODO template specialization for nWords = 1 (just use base type shift)
-    // TODO implement more efficient version doing fixed left shift by BITS_PER_CHAR
     KMER_INLINE void do_left_shift(size_t const & shift)
+    {
+      do_left_shift(shift, fast_words());
+    }
+
+    /// left shift of 1 or 2 word k-mers as 1 scalar.
+    KMER_INLINE void do_left_shift(size_t const & shift, ::std::true_type const &)
+    {
+      word_ops::store(data, (shift >= word_ops::bits) ? 0 : (word_ops::load(data) << shift));
+    }
+
+    KMER_INLINE void do_left_shift(size_t const & shift, ::std::false_type const &)
     {
       // inspired by STL bitset implementation
       const int64_t word_shift = shift / (sizeof(WORD_TYPE) << 3);
@@ -1351,9 +1464,18 @@ namespace bliss
      *
      * @param shift   The number of bits to shift by.
      */
-    // TODO template specialization for nWords = 1 (just use base type shift)
-    // TODO implement more efficient version doing fixed right shift by BITS_PER_CHAR
     KMER_INLINE void do_right_shift(size_t const & shift)
+    {
+      do_right_shift(shift, fast_words());
+    }
+
+    /// right shift of 1 or 2 word k-mers as 1 scalar.
+    KMER_INLINE void do_right_shift(size_t const & shift, ::std::true_type const &)
+    {
+      word_ops::store(data, (shift >= word_ops::bits) ? 0 : (word_ops::load(data) >> shift));
+    }
+
+    KMER_INLINE void do_right_shift(size_t const & shift, ::std::false_type const &)
     {
       // inspired by STL bitset implementation
       const size_t word_shift = shift / (sizeof(WORD_TYPE) << 3);
@@ -1439,6 +1561,11 @@ namespace bliss
 
       constexpr size_t bytes = nWords * sizeof(WORD_TYPE);
 
+#if defined(USE_RUNTIME_SIMD_DISPATCH)
+      if (bliss::utils::bit_ops::dispatch::reverse<bitsPerChar, ((bytes << 3) - nBits), false,
+          WORD_TYPE, nWords>(result.data, src.data)) return;
+#endif
+
       using SIMDType = bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<bytes>;
 
       bliss::utils::bit_ops::reverse<bitsPerChar,
@@ -1460,6 +1587,11 @@ namespace bliss
       // DNA and RNA complement is via negation.
       constexpr size_t bytes = nWords * sizeof(WORD_TYPE);
 
+#if defined(USE_RUNTIME_SIMD_DISPATCH)
+      if (bliss::utils::bit_ops::dispatch::reverse<bitsPerChar, ((bytes << 3) - nBits), true,
+          WORD_TYPE, nWords>(result.data, src.data)) return;
+#endif
+
       using SIMDType = bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<bytes>;
   	  ::bliss::utils::bit_ops::bitgroup_ops<bitsPerChar, SIMDType::SIMDVal> op;
 
@@ -1484,6 +1616,11 @@ namespace bliss
 
       constexpr size_t bytes = nWords * sizeof(WORD_TYPE);
 
+#if defined(USE_RUNTIME_SIMD_DISPATCH)
+      if (bliss::utils::bit_ops::dispatch::reverse<1, ((bytes << 3) - nBits), false,
+          WORD_TYPE, nWords>(result.data, src.data)) return;
+#endif
+
       using SIMDType = bliss::utils::bit_ops::BITREV_AUTO_AGGRESSIVE<bytes>;
 
       // reverse 1 bit groups
@@ -1598,6 +1735,56 @@ namespace bliss
   template<unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
   constexpr unsigned int Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>::nWords;
 
+  namespace detail {
+
+    /// batch reverse complement via per-kmer call.  used for multiword kmers and alphabets without a bitwise complement.
+    template <typename KMER>
+    inline void batch_reverse_complement(KMER const * in, KMER * out, size_t const & count, ::std::false_type) {
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = in[i].reverse_complement();   // via temporary, since in and out may alias.
+      }
+    }
+
+    /// batch reverse complement for single word kmers:  multiple kmers per SIMD register.
+    template <typename KMER>
+    inline void batch_reverse_complement(KMER const * in, KMER * out, size_t const & count, ::std::true_type) {
+      using KmerWordType = typename KMER::KmerWordType;
+      using A = typename KMER::KmerAlphabet;
+
+      constexpr uint16_t pad = (sizeof(KmerWordType) << 3) - KMER::nBits;
+
+      // DNA/RNA complement is negation, DNA6/RNA6/DNA16 complement is 1 bit reverse.
+      constexpr bool negate = ::std::is_same<A, DNA>::value || ::std::is_same<A, RNA>::value;
+      constexpr unsigned int bits = negate ? KMER::bitsPerChar : 1;
+
+      ::bliss::utils::bit_ops::reverse_words<bits, pad, negate, KmerWordType>(
+          reinterpret_cast<KmerWordType *>(out), reinterpret_cast<KmerWordType const *>(in), count);
+    }
+
+  } // namespace detail
+
+  /**
+   * @brief reverse complement an array of kmers.
+   * @details  for single word kmers of DNA, RNA, DNA5/6, RNA5/6, and DNA16, multiple kmers are processed per SIMD register
+   *           (e.g. 4 64-bit kmers per AVX2 register) via bitgroup_ops.  Other kmers are reverse complemented one at a time.
+   * @param in      input kmers
+   * @param out     output kmers.  may be the same as in.
+   * @param count   number of kmers.
+   */
+  template<unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
+  inline void reverse_complement(Kmer<KMER_SIZE, ALPHABET, WORD_TYPE> const * in,
+                                 Kmer<KMER_SIZE, ALPHABET, WORD_TYPE> * out, size_t const & count) {
+    using KMER = Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>;
+
+    ::bliss::common::detail::batch_reverse_complement(in, out, count,
+        ::std::integral_constant<bool, (KMER::nWords == 1) && (sizeof(KMER) == sizeof(WORD_TYPE)) &&
+                                       (::std::is_same<ALPHABET, DNA>::value ||
+                                        ::std::is_same<ALPHABET, RNA>::value ||
+                                        ::std::is_same<ALPHABET, DNA6>::value ||
+                                        ::std::is_same<ALPHABET, RNA6>::value ||
+                                        ::std::is_same<ALPHABET, DNA16>::value)>());
+  }
+
   /**
    * @brief print kmer to output stream
    *
@@ -1618,6 +1805,54 @@ namespace bliss
   }
   
 
+  namespace detail {
+    /// number of bytes needed to store BITS bits in whole words of WORD_BYTES bytes.
+    constexpr size_t kmer_storage_bytes(size_t bits, size_t word_bytes) {
+      return ((bits + (word_bytes << 3) - 1) / (word_bytes << 3)) * word_bytes;
+    }
+  } // namespace detail
+
+  /**
+   * @brief  packed key storage policy:  selects the largest word type for a kmer such that the storage is not padded
+   *         beyond multiples of MIN_WORD_BYTES.
+   * @details  Kmer rounds storage up to whole WORD_TYPE words.  With uint64_t words a DNA 41-mer occupies 16 bytes and a
+   *           std::pair<Kmer, uint32_t> 24 bytes.  With MIN_WORD_BYTES = 4, K in 33..48 uses 3 uint32_t words instead,
+   *           i.e. 12 bytes for the kmer and 16 for the pair.  K <= 32 and K in 49..64 still use uint64_t words.
+   *
+   *           All Kmer operations, the kmer hash functions, the containers, and the mxx datatype are generic in WORD_TYPE, so
+   *           the compact kmers are stored and communicated without padding.  Note that the pair is padded to the
+   *           alignment of its value type, so the savings apply when the value is no larger than the selected word.
+   * @tparam MIN_WORD_BYTES  smallest word type to consider, 1, 2, 4 or 8.
+   */
+  template <unsigned int KMER_SIZE, typename ALPHABET, size_t MIN_WORD_BYTES = 4>
+  struct compact_kmer_word {
+      static_assert((MIN_WORD_BYTES == 1) || (MIN_WORD_BYTES == 2) || (MIN_WORD_BYTES == 4) || (MIN_WORD_BYTES == 8),
+                    "MIN_WORD_BYTES should be 1, 2, 4, or 8");
+
+      static constexpr size_t nBits = KMER_SIZE * bliss::common::AlphabetTraits<ALPHABET>::getBitsPerChar();
+      /// the smallest storage possible at MIN_WORD_BYTES granularity.
+      static constexpr size_t nBytes = ::bliss::common::detail::kmer_storage_bytes(nBits, MIN_WORD_BYTES);
+
+      using type =
+          typename ::std::conditional<(::bliss::common::detail::kmer_storage_bytes(nBits, 8) == nBytes), uint64_t,
+            typename ::std::conditional<(::bliss::common::detail::kmer_storage_bytes(nBits, 4) == nBytes), uint32_t,
+              typename ::std::conditional<(::bliss::common::detail::kmer_storage_bytes(nBits, 2) == nBytes), uint16_t,
+                uint8_t
+              >::type
+            >::type
+          >::type;
+  };
+
+  template <unsigned int KMER_SIZE, typename ALPHABET, size_t MIN_WORD_BYTES>
+  constexpr size_t compact_kmer_word<KMER_SIZE, ALPHABET, MIN_WORD_BYTES>::nBits;
+  template <unsigned int KMER_SIZE, typename ALPHABET, size_t MIN_WORD_BYTES>
+  constexpr size_t compact_kmer_word<KMER_SIZE, ALPHABET, MIN_WORD_BYTES>::nBytes;
+
+  /// kmer type using the packed key storage policy.  e.g. CompactKmer<41, DNA> is 12 bytes instead of 16.
+  template <unsigned int KMER_SIZE, typename ALPHABET, size_t MIN_WORD_BYTES = 4>
+  using CompactKmer = Kmer<KMER_SIZE, ALPHABET, typename compact_kmer_word<KMER_SIZE, ALPHABET, MIN_WORD_BYTES>::type>;
+
+
   template <typename T>
   struct is_kmer : public std::false_type {};
 
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_dispatch.hpp
+ * @ingroup common
+ * @brief   selects a compiled Kmer type from a k given at runtime.
+ * @details  one binary is built for a list of k values, and the k of a run is chosen by parameter.  the work, e.g.
+ *          parse, build the index, and query, is written once as a functor templated on the kmer type, and
+ *          dispatch_kmer_size calls it with the Kmer<K, ...> for the runtime k.  everything inside the functor
+ *          is compiled for a fixed K, so it runs at template speed; the only runtime cost is 1 comparison per
+ *          listed k at the dispatch.
+ *
+ *          the default list covers the common sizes with 1 to 4 64 bit words for DNA.  each listed k instantiates
+ *          the functor's whole code path, so binaries should list only the sizes they serve.
+ */
+#ifndef BLISS_COMMON_KMER_DISPATCH_HPP
+#define BLISS_COMMON_KMER_DISPATCH_HPP
+
+#include <vector>
+#include <utility>    // forward
+
+#include "common/base_types.hpp"
+#include "common/kmer.hpp"
+
+namespace bliss
+{
+  namespace common
+  {
+
+    /// compile time list of k-mer sizes for dispatch_kmer_size
+    template <unsigned int... Ks>
+    struct kmer_sizes {
+        /// the sizes, in order.
+        static ::std::vector<unsigned int> values() {
+          return ::std::vector<unsigned int>({Ks...});
+        }
+    };
+
+    /// default k-mer sizes:  1 (up to 31), 2 (up to 63), 3, and 4 words of 64 bits for DNA.
+    using default_kmer_sizes = kmer_sizes<15, 21, 25, 27, 31, 41, 51, 55, 63, 95, 127>;
+
+    namespace detail {
+
+      template <typename Alphabet, typename WORD_TYPE, typename Sizes>
+      struct kmer_size_dispatcher;
+
+      template <typename Alphabet, typename WORD_TYPE>
+      struct kmer_size_dispatcher<Alphabet, WORD_TYPE, kmer_sizes<> > {
+          template <typename Func, typename... Args>
+          static bool call(unsigned int const &, Func &, Args&&...) {
+            return false;
+          }
+          static bool contains(unsigned int const &) { return false; }
+      };
+
+      template <typename Alphabet, typename WORD_TYPE, unsigned int K, unsigned int... Ks>
+      struct kmer_size_dispatcher<Alphabet, WORD_TYPE, kmer_sizes<K, Ks...> > {
+          template <typename Func, typename... Args>
+          static bool call(unsigned int const & k, Func & f, Args&&... args) {
+            if (k == K) {
+              f.template operator()<::bliss::common::Kmer<K, Alphabet, WORD_TYPE> >(::std::forward<Args>(args)...);
+              return true;
+            }
+            return kmer_size_dispatcher<Alphabet, WORD_TYPE, kmer_sizes<Ks...> >::call(k, f, ::std::forward<Args>(args)...);
+          }
+          static bool contains(unsigned int const & k) {
+            return (k == K) || kmer_size_dispatcher<Alphabet, WORD_TYPE, kmer_sizes<Ks...> >::contains(k);
+          }
+      };
+
+    } // namespace detail
+
+
+    /**
+     * @brief  call f.operator()<Kmer<k, Alphabet, WORD_TYPE> >(args...) for the runtime k.
+     * @details  results should be returned through the functor's members or the arguments.
+     * @tparam Alphabet   alphabet of the kmers
+     * @tparam Sizes      kmer_sizes list of the compiled k values
+     * @tparam WORD_TYPE  storage word type of the kmers
+     * @param k     the k-mer size
+     * @param f     functor with a member template `template <typename KmerType> void operator()(Args...)`
+     * @return      false if k is not in Sizes, in which case f is not called.
+     */
+    template <typename Alphabet, typename Sizes = default_kmer_sizes, typename WORD_TYPE = WordType,
+        typename Func, typename... Args>
+    bool dispatch_kmer_size(unsigned int const & k, Func & f, Args&&... args) {
+      return ::bliss::common::detail::kmer_size_dispatcher<Alphabet, WORD_TYPE, Sizes>::call(k, f, ::std::forward<Args>(args)...);
+    }
+
+    /// check if k is in the compiled sizes.
+    template <typename Sizes = default_kmer_sizes>
+    bool is_dispatched_kmer_size(unsigned int const & k) {
+      // the alphabet and word type do not matter for the check.
+      return ::bliss::common::detail::kmer_size_dispatcher<::bliss::common::DNA, WordType, Sizes>::contains(k);
+    }
+
+  } // namespace common
+} // namespace bliss
+
+#endif // BLISS_COMMON_KMER_DISPATCH_HPP
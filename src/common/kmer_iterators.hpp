@@ -36,11 +36,19 @@
 // C++ STL includes:
 #include <iterator>
 #include <type_traits>
+#include <utility>      // pair
+#include <cstdint>
+#include <deque>
+
+#if defined(__BMI2__)
+#include <immintrin.h>  // pext
+#endif
 
 // own includes
 #include "common/base_types.hpp"
 #include "common/padding.hpp"
 #include "common/kmer.hpp"
+#include "common/kmer_rolling_hash.hpp"
 
 #include "iterators/sliding_window_iterator.hpp"
 
@@ -178,8 +186,342 @@ namespace bliss
     /// The kmer buffer (i.e. the window of the sliding window)
     kmer_type kmer;
   };
-  
-  
+
+  /**
+   * @brief The sliding window operator for canonical k-mer generation from character data.
+   * @details  maintains the forward k-mer and its reverse complement together, shifting each new character into
+   *           the forward window and its complement into the reverse window.  The canonical (lexicographically
+   *           smaller) k-mer is then chosen without calling reverse_complement() on each k-mer.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   */
+  template <class BaseIterator, class Kmer>
+  class CanonicalKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type>
+  class CanonicalKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> >
+  {
+  public:
+    /// The Kmer type (same as the `value_type` of this iterator)
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    /**
+     * @brief Initializes the sliding window.
+     *
+     * @param it[in|out]  The current base iterator position. This will be set to
+     *                    the last read position.
+     */
+    inline void init(BaseIterator& it)
+    {
+      kmer = kmer_type();
+      rc = kmer_type();
+      for (unsigned int i = 0; i < KMER_SIZE; ++i) {
+        unsigned char c = *it;
+        kmer.nextFromChar(c);
+        rc.nextReverseFromChar(ALPHABET::to_complement(c));
+
+        // leave the iterator at the last read position.
+        if (i < (KMER_SIZE - 1)) ++it;
+      }
+    }
+
+    /**
+     * @brief Slides the window by one character taken from the given iterator.
+     *
+     * This will read the current character of the iterator and then advance the
+     * iterator by one.
+     *
+     * @param it[in|out]  The underlying iterator position, this will be read
+     *                    and then advanced.
+     */
+    inline void next(BaseIterator& it)
+    {
+      unsigned char c = *it;
+      kmer.nextFromChar(c);
+      rc.nextReverseFromChar(ALPHABET::to_complement(c));
+      ++it;
+    }
+
+    /**
+     * @brief Returns the value of the current sliding window, i.e., the smaller
+     *        of the current k-mer and its reverse complement.
+     *
+     * @return The current canonical k-mer value.
+     */
+    inline kmer_type getValue()
+    {
+      return (this->kmer < this->rc) ? this->kmer : this->rc;
+    }
+  private:
+    /// The kmer buffer (i.e. the window of the sliding window)
+    kmer_type kmer;
+    /// The reverse complement of the kmer buffer
+    kmer_type rc;
+  };
+
+  /**
+   * @brief The sliding window operator for k-mer generation with an ntHash style rolling hash.
+   * @details  the forward k-mer and the forward and reverse complement hashes are updated as each character enters
+   *           and the first character leaves, in O(1) regardless of k (see rolling_hash).  the value is the k-mer and
+   *           its raw hash, for bliss::kmer::hash::ntHash, which then only finalizes the carried value.
+   *           with canonical, the value is the smaller of the k-mer and its reverse complement, as in
+   *           CanonicalKmerSlidingWindow, and the hash is the canonical one, the same for both strands.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   * @tparam canonical    produce canonical k-mers and hashes.
+   */
+  template <class BaseIterator, class Kmer, bool canonical = false>
+  class RollingHashKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type, bool canonical>
+  class RollingHashKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type>, canonical>
+  {
+  public:
+    /// The Kmer type
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    /// the value type:  the k-mer and its raw rolling hash
+    typedef std::pair<kmer_type, uint64_t> value_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    typedef bliss::common::rolling_hash<kmer_type> hash_type;
+
+    /**
+     * @brief Initializes the sliding window.
+     *
+     * @param it[in|out]  The current base iterator position. This will be set to
+     *                    the last read position.
+     */
+    inline void init(BaseIterator& it)
+    {
+      kmer = kmer_type();
+      rc = kmer_type();
+      for (unsigned int i = 0; i < KMER_SIZE; ++i) {
+        unsigned char c = *it;
+        kmer.nextFromChar(c);
+        if (canonical) rc.nextReverseFromChar(ALPHABET::to_complement(c));
+
+        // leave the iterator at the last read position.
+        if (i < (KMER_SIZE - 1)) ++it;
+      }
+      fhash = hash_type::forward(kmer);
+      rhash = canonical ? hash_type::reverse(kmer) : 0;
+    }
+
+    /**
+     * @brief Slides the window by one character taken from the given iterator.
+     *
+     * This will read the current character of the iterator and then advance the
+     * iterator by one.
+     *
+     * @param it[in|out]  The underlying iterator position, this will be read
+     *                    and then advanced.
+     */
+    inline void next(BaseIterator& it)
+    {
+      unsigned char c = *it;
+      uint8_t out = hash_type::get_char(kmer, KMER_SIZE - 1);
+      fhash = hash_type::roll_forward(fhash, out, c);
+      kmer.nextFromChar(c);
+      if (canonical) {
+        rhash = hash_type::roll_reverse(rhash, out, c);
+        rc.nextReverseFromChar(ALPHABET::to_complement(c));
+      }
+      ++it;
+    }
+
+    /**
+     * @brief Returns the value of the current sliding window, i.e., the current
+     *        k-mer (or canonical k-mer) and its hash.
+     *
+     * @return The current k-mer and hash.
+     */
+    inline value_type getValue()
+    {
+      if (canonical)
+        return value_type((this->kmer < this->rc) ? this->kmer : this->rc, hash_type::canonical(fhash, rhash));
+      else
+        return value_type(this->kmer, fhash);
+    }
+  private:
+    /// The kmer buffer (i.e. the window of the sliding window)
+    kmer_type kmer;
+    /// The reverse complement of the kmer buffer, if canonical
+    kmer_type rc;
+    /// forward and reverse complement hashes of the window
+    uint64_t fhash;
+    uint64_t rhash;
+  };
+
+  /**
+   * @brief  compile time spaced seed pattern.  bit j of PATTERN is position j of the window counted from its last
+   *         character, so the pattern reads in sequence order from its highest set bit, e.g. 0b1101101 is "11_11_1".
+   * @details  span is the window length, weight the number of care positions, i.e. the k of the seeds.
+   */
+  template <uint64_t PATTERN>
+  struct spaced_seed {
+      static_assert(PATTERN != 0, "spaced seed pattern needs at least 1 care position.");
+      static_assert((PATTERN & 0x1) != 0, "spaced seed pattern should end with a care position.");
+
+      static constexpr uint64_t pattern = PATTERN;
+      static constexpr unsigned int span = 64 - __builtin_clzll(PATTERN);
+      static constexpr unsigned int weight = __builtin_popcountll(PATTERN);
+
+      /// pattern with each care position expanded to bits_per_char bits, for windows of at most 64 bits.
+      static constexpr uint64_t bit_mask(unsigned int bits_per_char, unsigned int j = 0) {
+        return ((j >= span) || ((j + 1) * bits_per_char > 64)) ? 0 :
+            ((((PATTERN >> j) & 0x1) ? (((bits_per_char >= 64) ? ~0ULL : ((1ULL << bits_per_char) - 1)) << (j * bits_per_char)) : 0) |
+                bit_mask(bits_per_char, j + 1));
+      }
+  };
+
+  template <uint64_t PATTERN>
+  constexpr uint64_t spaced_seed<PATTERN>::pattern;
+  template <uint64_t PATTERN>
+  constexpr unsigned int spaced_seed<PATTERN>::span;
+  template <uint64_t PATTERN>
+  constexpr unsigned int spaced_seed<PATTERN>::weight;
+
+
+  /**
+   * @brief The sliding window operator for spaced seed (gapped k-mer) generation from character data.
+   * @details  the window is a contiguous span-mer, and the care characters are gathered from its packed bits into
+   *           the seed k-mer.  when the window fits in 64 bits, the gather is 1 pext with BMI2 (__BMI2__), or else
+   *           a shift and mask per run of care positions.  wider windows gather 1 character at a time.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The seed k-mer type, must be of type bliss::Kmer, with size Seed::weight.
+   * @tparam Seed         a spaced_seed.
+   */
+  template <class BaseIterator, class Kmer, class Seed>
+  class SpacedKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type, class Seed>
+  class SpacedKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type>, Seed >
+  {
+  public:
+    /// The Kmer type (same as the `value_type` of this iterator)
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    /// the contiguous window.
+    typedef bliss::common::Kmer<Seed::span, ALPHABET, uint64_t> window_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    static_assert(KMER_SIZE == Seed::weight, "the seed k-mer size should be the weight of the spaced seed.");
+
+  protected:
+    static constexpr unsigned int bitsPerChar = window_type::bitsPerChar;
+    /// whether the window is 1 64 bit word.
+    static constexpr bool single_word = (Seed::span * bitsPerChar <= 64);
+    static constexpr uint64_t mask = Seed::bit_mask(bitsPerChar);
+
+    /// (first bit, bit mask) of each run of care positions, from the last character.
+    struct runs_type {
+        unsigned int count;
+        unsigned int lo[32];
+        uint64_t bits[32];
+
+        runs_type() : count(0) {
+          for (unsigned int j = 0; j < Seed::span && j < 64; ) {
+            if (((Seed::pattern >> j) & 0x1) == 0) { ++j; continue; }
+            unsigned int e = j;
+            while ((e < Seed::span) && ((Seed::pattern >> e) & 0x1)) ++e;
+            lo[count] = j * bitsPerChar;
+            bits[count] = ((e - j) * bitsPerChar >= 64) ? ~0ULL : ((1ULL << ((e - j) * bitsPerChar)) - 1);
+            ++count;
+            j = e;
+          }
+        }
+    };
+    static runs_type const & runs() {
+      static const runs_type r;
+      return r;
+    }
+
+    /// gather the care bits of the low 64 bits w.
+    static inline uint64_t gather(uint64_t const & w) {
+#if defined(__BMI2__)
+      return _pext_u64(w, mask);
+#else
+      runs_type const & r = runs();
+      uint64_t result = 0;
+      unsigned int out = 0;
+      for (unsigned int i = 0; i < r.count; ++i) {
+        result |= ((w >> r.lo[i]) & r.bits[i]) << out;
+        out += __builtin_popcountll(r.bits[i]);
+      }
+      return result;
+#endif
+    }
+
+    inline kmer_type extract(::std::true_type) const {
+      uint64_t seed[1] = { gather(window.getData()[0]) };
+      return kmer_type(seed);
+    }
+    inline kmer_type extract(::std::false_type) const {
+      kmer_type seed;
+      for (unsigned int j = Seed::span; j > 0; --j) {
+        if ((Seed::pattern >> (j - 1)) & 0x1)
+          seed.nextFromChar(window.getInfix(bitsPerChar, (Seed::span - j) * bitsPerChar));
+      }
+      return seed;
+    }
+
+  public:
+    /**
+     * @brief Initializes the sliding window.
+     *
+     * @param it[in|out]  The current base iterator position. This will be set to
+     *                    the last read position.
+     */
+    inline void init(BaseIterator& it)
+    {
+      window.fillFromChars(it, true);
+    }
+
+    /**
+     * @brief Slides the window by one character taken from the given iterator.
+     *
+     * This will read the current character of the iterator and then advance the
+     * iterator by one.
+     *
+     * @param it[in|out]  The underlying iterator position, this will be read
+     *                    and then advanced.
+     */
+    inline void next(BaseIterator& it)
+    {
+      window.nextFromChar(*it);
+      ++it;
+    }
+
+    /**
+     * @brief Returns the seed of the current window.
+     *
+     * @return The care characters of the current window, as a k-mer.
+     */
+    inline kmer_type getValue()
+    {
+      return extract(::std::integral_constant<bool, single_word>());
+    }
+  private:
+    /// the contiguous span-mer.
+    window_type window;
+  };
+
+
   /**
    * @brief Iterator that generates k-mers from character data.
    *
@@ -276,6 +618,113 @@ namespace bliss
   /// reverse KmerGenerationIterator for generating kmers from a sequence of alphabet characters.  can be used for reverse complements.
   template <class BaseIterator, class Kmer>
   using ReverseKmerGenerationIterator = KmerGenerationIteratorBase<ReverseKmerSlidingWindow<BaseIterator, Kmer > >;
+
+  /// canonical KmerGenerationIterator for generating the smaller of each kmer and its reverse complement from a sequence of alphabet characters.
+  template <class BaseIterator, class Kmer>
+  using CanonicalKmerGenerationIterator = KmerGenerationIteratorBase<CanonicalKmerSlidingWindow<BaseIterator, Kmer > >;
+
+  /// KmerGenerationIterator for generating (kmer, rolling hash) pairs, or (canonical kmer, canonical rolling hash) pairs, from a sequence of alphabet characters.
+  template <class BaseIterator, class Kmer, bool canonical = false>
+  using RollingHashKmerGenerationIterator = KmerGenerationIteratorBase<RollingHashKmerSlidingWindow<BaseIterator, Kmer, canonical > >;
+
+  /// spaced seed KmerGenerationIterator for generating gapped kmers, Seed::weight characters of each Seed::span window, from a sequence of alphabet characters.
+  template <class BaseIterator, class Kmer, class Seed>
+  using SpacedKmerGenerationIterator = KmerGenerationIteratorBase<SpacedKmerSlidingWindow<BaseIterator, Kmer, Seed > >;
+
+
+  /**
+   * @brief (w,k) minimizer sampling of the consecutive k-mers of 1 sequence, e.g. from a KmerGenerationIterator.
+   * @details  of each window of W consecutive k-mers, the k-mer with the smallest order is selected, the rightmost one
+   *           if equal k-mers tie.  consecutive windows mostly share their minimizer, so about 2/(W+1) of the k-mers
+   *           are selected.  the selection depends only on the characters of a window, so a substring shared by a
+   *           reference and a query selects the same k-mers in both.  the order mixes the smaller of the k-mer and its
+   *           reverse complement, so the 2 strands of a substring also select the same k-mers, for single strand and
+   *           canonical maps alike.  a sequence with fewer than W k-mers selects its smallest k-mer.
+   *
+   * @tparam Kmer     The k-mer type, must be of type bliss::Kmer
+   * @tparam W        number of consecutive k-mers per window.
+   */
+  template <class Kmer, unsigned int W>
+  class minimizer_sampler {
+      static_assert(W > 0, "minimizer window should have at least 1 k-mer.");
+
+    public:
+      typedef Kmer kmer_type;
+      static constexpr unsigned int window = W;
+
+    protected:
+      /// a k-mer that can still be the minimizer of the current or a later window.
+      struct candidate {
+          uint64_t order;
+          kmer_type canonical;
+          size_t offset;
+
+          bool operator<(candidate const & other) const {
+            return (order < other.order) || ((order == other.order) && (canonical < other.canonical));
+          }
+      };
+
+      /// candidates in increasing offset and strictly increasing order.  the front is the current minimizer.
+      ::std::deque<candidate> candidates;
+
+      /// splitmix64 finalizer.
+      static inline uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+      }
+
+    public:
+      /// strand symmetric order of a k-mer, given its canonical k-mer.
+      static inline uint64_t order(kmer_type const & canonical) {
+        uint64_t h = 0;
+        for (unsigned int i = 0; i < kmer_type::nWords; ++i)
+          h = mix(h ^ static_cast<uint64_t>(canonical.getData()[i]));
+        return h;
+      }
+
+      /**
+       * @brief select the minimizers of the k-mers in [first, last), which are the consecutive k-mers of 1 sequence.
+       * @param output   receives the offsets of the selected k-mers from first, in increasing order.
+       * @return new position of output.
+       */
+      template <typename KmerIter, typename OutputIt>
+      OutputIt select(KmerIter first, KmerIter last, OutputIt output) {
+        candidates.clear();
+
+        size_t i = 0;
+        size_t last_selected = 0;
+        bool selected = false;
+        for (; first != last; ++first, ++i) {
+          kmer_type km = *first;
+          kmer_type rc = km.reverse_complement();
+          candidate c{0, (rc < km) ? rc : km, i};
+          c.order = order(c.canonical);
+
+          // candidates that are not smaller than the new k-mer are never the minimizer again.
+          while (!candidates.empty() && !(candidates.back() < c)) candidates.pop_back();
+          candidates.push_back(c);
+          // candidates that have left the window.
+          if (candidates.front().offset + W <= i) candidates.pop_front();
+
+          if ((i + 1 >= W) && (!selected || (candidates.front().offset != last_selected))) {
+            last_selected = candidates.front().offset;
+            selected = true;
+            *output = last_selected;
+            ++output;
+          }
+        }
+        // shorter than 1 window.
+        if (!selected && !candidates.empty()) {
+          *output = candidates.front().offset;
+          ++output;
+        }
+        return output;
+      }
+  };
+
+  template <class Kmer, unsigned int W>
+  constexpr unsigned int minimizer_sampler<Kmer, W>::window;
   
   
   
@@ -493,6 +942,185 @@ namespace bliss
       : base_class_t(baseBegin, window, offset)  {}
   };
   
+
+
+  /**
+   * @brief Generates k-mers and their reverse complements from packed words, by shifting the k-mer words directly.
+   *
+   * @details  The input is in the PackedStringImpl layout, e.g. from PackedEncoder:  characters start at the least
+   *           significant bits of each word and do not span words.  Each character is taken from the current input
+   *           word by shift and mask, shifted into the forward k-mer at the least significant end, and its complement
+   *           into the reverse complement k-mer at the most significant end.  The shifts are by a compile time
+   *           constant over the k-mer's words, so there is no per character iterator chain and no separate
+   *           reverse_complement() per k-mer.
+   *
+   *           This requires that the characters do not span the k-mer's storage words, i.e. bits per char divides
+   *           the word size (e.g. DNA, RNA, DNA16), as indicated by `supported`.  Other alphabets should use
+   *           PackedKmerGenerationIterator.
+   *
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   */
+  template <class Kmer>
+  class PackedWordKmerGenerator {};
+
+  template <unsigned int KMER_SIZE, typename ALPHABET, typename word_type>
+  class PackedWordKmerGenerator<bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> >
+  {
+  public:
+    /// The Kmer type
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    /// type of the packed input words
+    typedef ::WordType input_word_type;
+
+    /// number of bits per character
+    static constexpr unsigned int bits_per_char = kmer_type::bitsPerChar;
+    /// number of characters in each input word
+    static constexpr unsigned int chars_per_input_word = (sizeof(input_word_type) * 8) / bits_per_char;
+    /// number of bits in each k-mer storage word
+    static constexpr unsigned int kmer_word_bits = sizeof(word_type) * 8;
+    /// whether the k-mer type can be generated by word shifts.
+    static constexpr bool supported = (kmer_word_bits % bits_per_char) == 0;
+
+  protected:
+    static constexpr unsigned int nWords = kmer_type::nWords;
+    /// mask for 1 character
+    static constexpr input_word_type char_mask = (static_cast<input_word_type>(1) << bits_per_char) - 1;
+    /// number of used bits in the most significant k-mer word, in (0, kmer_word_bits]
+    static constexpr unsigned int top_bits = kmer_type::nBits - (nWords - 1) * kmer_word_bits;
+    /// word and bit offset of the most significant character, where the reverse complement takes new characters
+    static constexpr unsigned int top_char_word = (kmer_type::nBits - bits_per_char) / kmer_word_bits;
+    static constexpr unsigned int top_char_offset = (kmer_type::nBits - bits_per_char) % kmer_word_bits;
+
+    /// shift the k-mer left by 1 char, and add c at the least significant end.
+    static inline void shift_in_forward(word_type (&d)[nWords], word_type const & c) {
+      for (unsigned int j = nWords - 1; j > 0; --j) {
+        d[j] = static_cast<word_type>((d[j] << bits_per_char) | (d[j - 1] >> (kmer_word_bits - bits_per_char)));
+      }
+      d[0] = static_cast<word_type>((d[0] << bits_per_char) | c);
+      d[nWords - 1] &= static_cast<word_type>(static_cast<word_type>(~static_cast<word_type>(0)) >> (kmer_word_bits - top_bits));
+    }
+
+    /// shift the k-mer right by 1 char, and add c at the most significant end.
+    static inline void shift_in_reverse(word_type (&d)[nWords], word_type const & c) {
+      for (unsigned int j = 0; (j + 1) < nWords; ++j) {
+        d[j] = static_cast<word_type>((d[j] >> bits_per_char) | (d[j + 1] << (kmer_word_bits - bits_per_char)));
+      }
+      d[nWords - 1] = static_cast<word_type>(d[nWords - 1] >> bits_per_char);
+      d[top_char_word] |= static_cast<word_type>(c << top_char_offset);
+    }
+
+  public:
+    /**
+     * @brief  generate all k-mers in a packed sequence.
+     * @param words   packed words of the sequence, get_word_count(len) of them.
+     * @param len     number of characters in the sequence.
+     * @param f       called as f(position, kmer, reverse_complement) for each k-mer, in order.
+     */
+    template <typename Func>
+    static void generate(input_word_type const * words, size_t const & len, Func f) {
+      static_assert(supported, "PackedWordKmerGenerator requires bits per char to divide the k-mer word size.");
+
+      if (len < KMER_SIZE) return;
+
+      kmer_type fwd;
+      kmer_type rev;
+      word_type (&fd)[nWords] = fwd.getDataRef();
+      word_type (&rd)[nWords] = rev.getDataRef();
+
+      input_word_type w = 0;
+      word_type c;
+      for (size_t i = 0; i < len; ++i) {
+        if ((i % chars_per_input_word) == 0) w = words[i / chars_per_input_word];
+        c = static_cast<word_type>(w & char_mask);
+        w >>= bits_per_char;
+
+        shift_in_forward(fd, c);
+        shift_in_reverse(rd, static_cast<word_type>(ALPHABET::to_complement(c)));
+
+        if ((i + 1) >= KMER_SIZE) f(i + 1 - KMER_SIZE, fwd, rev);
+      }
+    }
+
+    /**
+     * @brief  generate the k-mers in a packed sequence that contain no non-ACGT character, e.g. N.
+     * @details  a run counter of the characters since the last masked one is kept, and a window is emitted only if
+     *           the run covers it.  the window still shifts through masked characters, so the k-mer words stay correct.
+     * @param words   packed words of the sequence, get_word_count(len) of them.
+     * @param ambig   non-ACGT mask of the sequence from PackedEncoder::encode, 1 bit per char.
+     * @param len     number of characters in the sequence.
+     * @param f       called as f(position, kmer, reverse_complement) for each valid k-mer, in order.
+     */
+    template <typename Func>
+    static void generate_valid(input_word_type const * words, input_word_type const * ambig, size_t const & len, Func f) {
+      static_assert(supported, "PackedWordKmerGenerator requires bits per char to divide the k-mer word size.");
+
+      if (len < KMER_SIZE) return;
+
+      constexpr unsigned int mask_bits = sizeof(input_word_type) * 8;
+
+      kmer_type fwd;
+      kmer_type rev;
+      word_type (&fd)[nWords] = fwd.getDataRef();
+      word_type (&rd)[nWords] = rev.getDataRef();
+
+      input_word_type w = 0;
+      input_word_type m = 0;
+      word_type c;
+      size_t run = 0;
+      for (size_t i = 0; i < len; ++i) {
+        if ((i % chars_per_input_word) == 0) w = words[i / chars_per_input_word];
+        if ((i % mask_bits) == 0) m = ambig[i / mask_bits];
+        c = static_cast<word_type>(w & char_mask);
+        w >>= bits_per_char;
+
+        shift_in_forward(fd, c);
+        shift_in_reverse(rd, static_cast<word_type>(ALPHABET::to_complement(c)));
+
+        if ((m != 0) && ((m & 1) != 0)) run = 0;
+        else ++run;
+        m >>= 1;
+
+        if (run >= KMER_SIZE) f(i + 1 - KMER_SIZE, fwd, rev);
+      }
+    }
+
+    /// generate all k-mers in a packed sequence into output.
+    template <typename OutputIt>
+    OutputIt operator()(input_word_type const * words, size_t const & len, OutputIt output) const {
+      generate(words, len, [&output](size_t const &, kmer_type const & km, kmer_type const &) {
+        *output = km;
+        ++output;
+      });
+      return output;
+    }
+
+    /// generate all k-mers and their reverse complements in a packed sequence into output and rc_output.
+    template <typename OutputIt, typename RCOutputIt>
+    std::pair<OutputIt, RCOutputIt> operator()(input_word_type const * words, size_t const & len,
+                                                OutputIt output, RCOutputIt rc_output) const {
+      generate(words, len, [&output, &rc_output](size_t const &, kmer_type const & km, kmer_type const & rc) {
+        *output = km;
+        ++output;
+        *rc_output = rc;
+        ++rc_output;
+      });
+      return std::make_pair(output, rc_output);
+    }
+
+    /// generate the canonical (lexicographically smaller of k-mer and reverse complement) k-mers in a packed sequence into output.
+    template <typename OutputIt>
+    OutputIt canonical(input_word_type const * words, size_t const & len, OutputIt output) const {
+      generate(words, len, [&output](size_t const &, kmer_type const & km, kmer_type const & rc) {
+        *output = (km < rc) ? km : rc;
+        ++output;
+      });
+      return output;
+    }
+  };
+
+  template <unsigned int KMER_SIZE, typename ALPHABET, typename word_type>
+  constexpr bool PackedWordKmerGenerator<bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> >::supported;
+
   } //namespace common
 } // namespace bliss
 
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_neighbors.hpp
+ * @ingroup common
+ * @brief   hamming distance, and enumeration of the k-mers within hamming distance d (substitutions only) of a k-mer.
+ * @details  a substitution at character position i is an xor with (old ^ new) shifted to i, so the neighbors are
+ *          generated from a table of the single character masks, 1 per position and xor value, built once per Kmer type.
+ *          substitute values are the alphabet values [0, SIZE) that fit in bitsPerChar, e.g. the other 3 bases for DNA.
+ *          for k = 31 and DNA, there are 93 neighbors within d = 1, and 4278 within d = 2.
+ */
+#ifndef SRC_COMMON_KMER_NEIGHBORS_HPP_
+#define SRC_COMMON_KMER_NEIGHBORS_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>  // invalid_argument
+
+#include "common/alphabet_traits.hpp"
+#include "common/kmer.hpp"
+
+namespace bliss {
+
+  namespace common {
+
+    namespace kmer {
+
+      /// number of values a character can be substituted with.
+      template <typename KMER>
+      constexpr unsigned int substitute_count() {
+        return ((::bliss::common::AlphabetTraits<typename KMER::KmerAlphabet>::getSize() < (1U << KMER::bitsPerChar)) ?
+                ::bliss::common::AlphabetTraits<typename KMER::KmerAlphabet>::getSize() : (1U << KMER::bitsPerChar)) - 1;
+      }
+
+      /// number of k-mers at hamming distance 1 to d of a k-mer, i.e. excluding the k-mer itself.  d <= 2.
+      template <typename KMER>
+      size_t hamming_neighborhood_size(unsigned int const & d) {
+        size_t s = substitute_count<KMER>();
+        size_t k = KMER::size;
+        return (d == 0) ? 0 : ((d == 1) ? k * s : k * s + (k * (k - 1) / 2) * s * s);
+      }
+
+      /// number of character positions at which x and y differ.
+      template <typename KMER>
+      unsigned int hamming_distance(KMER const & x, KMER const & y) {
+        KMER diff = x ^ y;
+        unsigned int dist = 0;
+        for (unsigned int i = 0; i < KMER::size; ++i, diff = diff >> 1)
+          dist += (diff.getSuffix(KMER::bitsPerChar) != 0) ? 1 : 0;
+        return dist;
+      }
+
+      namespace detail {
+        /// the single character masks:  entry i * 2^bitsPerChar + v is v at position i.
+        template <typename KMER>
+        ::std::vector<KMER> const & substitution_masks() {
+          static const ::std::vector<KMER> masks = []() {
+            constexpr unsigned int vals = (1U << KMER::bitsPerChar);
+            ::std::vector<KMER> m;
+            m.reserve(KMER::size * vals);
+            for (unsigned int i = 0; i < KMER::size; ++i) {
+              for (unsigned int v = 0; v < vals; ++v) {
+                KMER x;
+                x.nextFromChar(v);
+                m.emplace_back(x << i);
+              }
+            }
+            return m;
+          }();
+          return masks;
+        }
+      } // namespace detail
+
+      /**
+       * @brief call f on each k-mer at hamming distance 1 to d of q, with substitutions only.  d <= 2.
+       * @details  each neighbor is passed once.  q itself is not passed.
+       * @throw std::invalid_argument  if d > 2.
+       */
+      template <typename KMER, typename F>
+      void for_each_hamming_neighbor(KMER const & q, unsigned int const & d, F && f) {
+        if (d > 2) throw ::std::invalid_argument("for_each_hamming_neighbor: hamming distance d > 2 is not supported.");
+        if (d == 0) return;
+
+        constexpr unsigned int vals = (1U << KMER::bitsPerChar);
+        constexpr unsigned int subs = substitute_count<KMER>() + 1;
+        ::std::vector<KMER> const & masks = detail::substitution_masks<KMER>();
+
+        uint64_t chars[KMER::size];
+        KMER x = q;
+        for (unsigned int i = 0; i < KMER::size; ++i, x = x >> 1) chars[i] = x.getSuffix(KMER::bitsPerChar);
+
+        uint64_t ci, cj;
+        for (unsigned int i = 0; i < KMER::size; ++i) {
+          ci = chars[i];
+          for (unsigned int v = 0; v < subs; ++v) {
+            if (v == ci) continue;
+            KMER n1 = q ^ masks[i * vals + (v ^ ci)];
+            f(n1);
+
+            if (d < 2) continue;
+            for (unsigned int j = i + 1; j < KMER::size; ++j) {
+              cj = chars[j];
+              for (unsigned int w = 0; w < subs; ++w) {
+                if (w == cj) continue;
+                f(n1 ^ masks[j * vals + (w ^ cj)]);
+              }
+            }
+          }
+        }
+      }
+
+    } // namespace kmer
+
+  } // namespace common
+
+} // namespace bliss
+
+#endif /* SRC_COMMON_KMER_NEIGHBORS_HPP_ */
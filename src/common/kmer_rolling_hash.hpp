@@ -0,0 +1,173 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_rolling_hash.hpp
+ * @ingroup common
+ * @brief   ntHash style rolling hash of kmers:  updated in O(1) per character as a window slides, for any k.
+ * @details  each character value c has a random 64 bit seed s[c].  the forward hash of c_0 .. c_{k-1} is
+ *            XOR_i srol(s[c_i], k-1-i),
+ *          and the reverse complement hash is the forward hash of the reverse complement,
+ *            XOR_i srol(s[comp(c_i)], i).
+ *          sliding by 1 character, c_0 out and c_k in, is then
+ *            f' = srol(f, 1) ^ srol(s[c_0], k) ^ s[c_k]
+ *            r' = sror(r, 1) ^ sror(s[comp(c_0)], 1) ^ srol(s[comp(c_k)], k-1),
+ *          with the rotated seeds of the outgoing and incoming characters in tables.  the canonical hash is f + r,
+ *          which is the same for a kmer and its reverse complement.
+ *
+ *          srol rotates the high 31 and the low 33 bits separately (as in ntHash 2), so the rotations repeat every
+ *          31 * 33 = 1023 positions instead of 64, and characters 64 positions apart do not cancel for large k.
+ *
+ *          the values are not finalized:  bliss::kmer::hash::ntHash mixes them in O(1) for the maps, and
+ *          RollingHashKmerSlidingWindow (kmer_iterators.hpp) carries them with each kmer.
+ */
+#ifndef BLISS_COMMON_KMER_ROLLING_HASH_HPP
+#define BLISS_COMMON_KMER_ROLLING_HASH_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+#include "common/kmer.hpp"
+
+namespace bliss
+{
+  namespace common
+  {
+
+    /// ntHash style rolling hash of the kmers of type KMER.
+    template <typename KMER>
+    class rolling_hash {};
+
+    template <unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
+    class rolling_hash<Kmer<KMER_SIZE, ALPHABET, WORD_TYPE> > {
+      public:
+        using kmer_type = Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>;
+
+      protected:
+        static constexpr unsigned int bitsPerChar = kmer_type::bitsPerChar;
+        static constexpr unsigned int nChars = 1U << bitsPerChar;
+        static constexpr unsigned int wordBits = 8 * sizeof(WORD_TYPE);
+
+        static constexpr uint64_t lo_mask = 0x1FFFFFFFFULL;   // low 33 bits
+
+        /// seeds, and the rotated seeds of the characters leaving and entering the window.
+        struct tables {
+            uint64_t seed[nChars];
+            uint64_t f_out[nChars];    // srol(s[c], k)
+            uint64_t r_out[nChars];    // sror(s[comp(c)], 1)
+            uint64_t r_in[nChars];     // srol(s[comp(c)], k-1)
+
+            tables() {
+              // the ntHash seeds of A, C, G, T, in the order of the DNA encoding.  splitmix64 for the other values.
+              static const uint64_t dna[4] = { 0x3c8bfbb395c60474ULL, 0x3193c18562a02b4cULL,
+                                               0x20323ed082572324ULL, 0x295549f54be24456ULL };
+              uint64_t x = 0x9E3779B97F4A7C15ULL * nChars;
+              for (unsigned int c = 0; c < nChars; ++c) {
+                if ((bitsPerChar == 2) && (c < 4)) {
+                  seed[c] = dna[c];
+                } else {
+                  x += 0x9E3779B97F4A7C15ULL;
+                  uint64_t z = x;
+                  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                  seed[c] = z ^ (z >> 31);
+                }
+              }
+              for (unsigned int c = 0; c < nChars; ++c) {
+                uint64_t s = seed[c];
+                uint64_t sc = seed[ALPHABET::to_complement(c) & (nChars - 1)];
+                f_out[c] = srol(s, KMER_SIZE);
+                r_out[c] = sror(sc, 1);
+                r_in[c] = srol(sc, KMER_SIZE - 1);
+              }
+            }
+        };
+
+        static tables const & get_tables() {
+          static const tables t;
+          return t;
+        }
+
+      public:
+        /// character j of the kmer, counting from the last (least significant) one.  O(1)
+        static inline uint8_t get_char(kmer_type const & km, unsigned int const & j) {
+          unsigned int bit = j * bitsPerChar;
+          unsigned int w = bit / wordBits;
+          unsigned int off = bit % wordBits;
+          uint64_t v = static_cast<uint64_t>(km.getData()[w]) >> off;
+          if ((off + bitsPerChar > wordBits) && (w + 1 < kmer_type::nWords))
+            v |= static_cast<uint64_t>(km.getData()[w + 1]) << (wordBits - off);
+          return static_cast<uint8_t>(v & (nChars - 1));
+        }
+
+        /// rotate the high 31 and the low 33 bits left by d, separately.
+        static inline uint64_t srol(uint64_t const & x, unsigned int d) {
+          unsigned int dh = d % 31;
+          unsigned int dl = d % 33;
+          uint64_t h = x >> 33;
+          uint64_t l = x & lo_mask;
+          if (dh > 0) h = ((h << dh) | (h >> (31 - dh))) & 0x7FFFFFFFULL;
+          if (dl > 0) l = ((l << dl) | (l >> (33 - dl))) & lo_mask;
+          return (h << 33) | l;
+        }
+
+        /// rotate the high 31 and the low 33 bits right by d, separately.
+        static inline uint64_t sror(uint64_t const & x, unsigned int d) {
+          return srol(x, (31 * 33) - (d % (31 * 33)));
+        }
+
+        /// forward hash of a kmer, in O(k).
+        static inline uint64_t forward(kmer_type const & km) {
+          tables const & t = get_tables();
+          uint64_t h = 0;
+          for (unsigned int j = 0; j < KMER_SIZE; ++j) h ^= srol(t.seed[get_char(km, j)], j);
+          return h;
+        }
+
+        /// reverse complement hash of a kmer, i.e. forward(km.reverse_complement()), in O(k).
+        static inline uint64_t reverse(kmer_type const & km) {
+          tables const & t = get_tables();
+          uint64_t h = 0;
+          for (unsigned int j = 0; j < KMER_SIZE; ++j)
+            h ^= srol(t.seed[ALPHABET::to_complement(get_char(km, j)) & (nChars - 1)], KMER_SIZE - 1 - j);
+          return h;
+        }
+
+        /// the same for a kmer and its reverse complement.
+        static inline uint64_t canonical(uint64_t const & f, uint64_t const & r) {
+          return f + r;
+        }
+        static inline uint64_t canonical(kmer_type const & km) {
+          return canonical(forward(km), reverse(km));
+        }
+
+        /// forward hash after out leaves and in enters the window.  O(1)
+        static inline uint64_t roll_forward(uint64_t const & f, uint8_t const & out, uint8_t const & in) {
+          tables const & t = get_tables();
+          return srol(f, 1) ^ t.f_out[out & (nChars - 1)] ^ t.seed[in & (nChars - 1)];
+        }
+
+        /// reverse complement hash after out leaves and in enters the window.  O(1)
+        static inline uint64_t roll_reverse(uint64_t const & r, uint8_t const & out, uint8_t const & in) {
+          tables const & t = get_tables();
+          return sror(r, 1) ^ t.r_out[out & (nChars - 1)] ^ t.r_in[in & (nChars - 1)];
+        }
+    };
+
+  } // namespace common
+} // namespace bliss
+
+#endif // BLISS_COMMON_KMER_ROLLING_HASH_HPP
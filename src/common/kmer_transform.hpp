@@ -60,6 +60,8 @@
 #include <exception>  // for hash - std::system_error
 #include <algorithm>
 #include <type_traits>  // enable_if
+#include <cstring>  // memcpy
+#include <cstdint>
 
 #include "common/kmer.hpp"
 
@@ -144,6 +146,96 @@ namespace bliss {
 
       };
 
+      /**
+       * @brief canonical minimizer of a kmer, for use as distribution transform.
+       * @details  the minimizer is the M-mer of the kmer or of its reverse complement with the smallest mixed value.
+       *        mixing avoids the lexicographic order, which would select poly-A M-mers disproportionately often.
+       *        since both strands are considered, a kmer and its reverse complement have the same minimizer, so
+       *        the transform can be applied before or after canonicalization.  consecutive kmers of a sequence share
+       *        the minimizer for several positions, which allows them to be sent together as a super-kmer.
+       *        the minimizer is returned as a KMER with the M-mer in its least significant bits.
+       */
+      template <typename KMER, unsigned int M>
+      struct minimizer {
+          static_assert(M > 0 && M <= KMER::size, "minimizer length has to be between 1 and k");
+          static_assert(M * KMER::bitsPerChar <= 64, "minimizer has to fit in 64 bits");
+
+          static constexpr unsigned int m_bits = M * KMER::bitsPerChar;
+          static constexpr uint64_t m_mask = (m_bits >= 64) ? ~(0ULL) : ((1ULL << (m_bits % 64)) - 1ULL);
+
+          /// order of M-mers:  splitmix64 finalizer.
+          static inline uint64_t order(uint64_t x) {
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return x ^ (x >> 31);
+          }
+
+          inline KMER operator()(KMER const & x) const {
+            uint64_t best = 0, best_order = ~(0ULL), v, o;
+
+            KMER strands[2] = {x, x.reverse_complement()};
+            for (int s = 0; s < 2; ++s) {
+              if (KMER::nBits <= 64) {
+                // single 64 bit value.  shift the value directly.
+                uint64_t w = strands[s].getSuffix(KMER::nBits);
+                for (unsigned int i = 0; i <= KMER::size - M; ++i, w >>= KMER::bitsPerChar) {
+                  v = w & m_mask;
+                  o = order(v);
+                  if ((o < best_order) || ((o == best_order) && (v < best))) {
+                    best_order = o;
+                    best = v;
+                  }
+                }
+              } else {
+                KMER t = strands[s];
+                for (unsigned int i = 0; i <= KMER::size - M; ++i, t >>= 1) {
+                  v = t.getSuffix(m_bits) & m_mask;  // getSuffix does not mask for multiple small words.
+                  o = order(v);
+                  if ((o < best_order) || ((o == best_order) && (v < best))) {
+                    best_order = o;
+                    best = v;
+                  }
+                }
+              }
+            }
+
+            KMER result;
+            memcpy(result.getDataRef(), &best,
+                   ::std::min(sizeof(uint64_t), KMER::nWords * sizeof(typename KMER::KmerWordType)));
+            return result;
+          }
+          template <typename VAL>
+          inline ::std::pair<KMER, VAL> operator()(std::pair<KMER, VAL> const & x) const {
+              return std::pair<KMER, VAL>(operator()(x.first), x.second);
+          }
+          template <typename VAL>
+          inline ::std::pair<const KMER, VAL> operator()(std::pair<const KMER, VAL> const & x) const {
+              return std::pair<const KMER, VAL>(operator()(x.first), x.second);
+          }
+      };
+
+      template <typename KMER, unsigned int M>
+      constexpr unsigned int minimizer<KMER, M>::m_bits;
+      template <typename KMER, unsigned int M>
+      constexpr uint64_t minimizer<KMER, M>::m_mask;
+
+      /// minimizer with M = min(k, 15), a compromise between super-kmer length and load balance.
+      template <typename KMER>
+      using default_minimizer = minimizer<KMER, (KMER::size < 15U ? KMER::size : 15U)>;
+
+
+      /// true if the transform maps a kmer and its reverse complement to the same value.
+      template <typename TRANS>
+      struct is_strand_symmetric : public ::std::false_type {};
+      template <typename KMER>
+      struct is_strand_symmetric<xor_rev_comp<KMER> > : public ::std::true_type {};
+      template <typename KMER>
+      struct is_strand_symmetric<lex_less<KMER> > : public ::std::true_type {};
+      template <typename KMER>
+      struct is_strand_symmetric<lex_greater<KMER> > : public ::std::true_type {};
+      template <typename KMER, unsigned int M>
+      struct is_strand_symmetric<minimizer<KMER, M> > : public ::std::true_type {};
+
 
 //      template <typename KMER, template <typename> class TRANS>
 //      struct tuple_transform {
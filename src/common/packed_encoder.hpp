@@ -0,0 +1,299 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_encoder.hpp
+ * @ingroup common
+ * @brief   block encoder from ASCII characters to packed alphabet words.
+ * @details translates and packs 32 (AVX2) or 16 (SSSE3) characters at a time, and marks the positions of
+ *          non-ACGT characters (e.g. N) in a separate bit mask in the same pass.
+ *
+ *          The output has the same layout as PackedStringImpl and the UnpackingIterator:  characters are packed
+ *          starting at the least significant bits of each word and do not span words.  The words can therefore
+ *          be used directly with PackedKmerGenerationIterator.
+ */
+#ifndef BLISS_COMMON_PACKED_ENCODER_HPP
+#define BLISS_COMMON_PACKED_ENCODER_HPP
+
+#include <cstring>    // memset
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <x86intrin.h>   // all intrinsics.  will be enabled based on compiler flag such as __SSSE3__ internally.
+#endif
+
+#include "common/base_types.hpp"
+#include "common/alphabet_traits.hpp"
+
+namespace bliss
+{
+  namespace common
+  {
+
+    /**
+     * @brief  translates ASCII characters into the alphabet and packs them into words.
+     * @details  The vectorized path looks up the alphabet's FROM_ASCII table with pshufb, 16 entries at a time,
+     *           for characters between 0x40 and 0x7F, after folding lower case to upper case.  This requires the
+     *           FROM_ASCII table to be case insensitive, which is true for DNA, DNA5 and DNA16 (checked at runtime,
+     *           otherwise the scalar lookup is used).  Blocks with any other character, e.g. '.' or '-', are encoded
+     *           with the scalar lookup, so the output is always the same as translating with ASCII2 and packing
+     *           with PackedStringImpl.
+     *
+     *           2 bit and 4 bit alphabets are packed in vector registers.  Others, e.g. DNA5 at 3 bits, are
+     *           translated in vector registers and packed 1 char at a time.
+     *
+     * @tparam Alphabet  alphabet to encode into.
+     */
+    template <typename Alphabet>
+    class PackedEncoder
+    {
+      public:
+        /// storage word type
+        typedef ::WordType word_type;
+
+        /// number of bits per packed character
+        static constexpr unsigned int bits_per_char = AlphabetTraits<Alphabet>::getBitsPerChar();
+
+        /// number of characters per word.  characters do not span words.
+        static constexpr unsigned int chars_per_word = (sizeof(word_type) * 8) / bits_per_char;
+
+        /// number of characters per word of the non-ACGT bit mask
+        static constexpr unsigned int chars_per_mask_word = sizeof(word_type) * 8;
+
+        /// number of packed words for a sequence.
+        static size_t get_word_count(size_t const & length) {
+          return (length + chars_per_word - 1) / chars_per_word;
+        }
+
+        /// number of non-ACGT mask words for a sequence.
+        static size_t get_mask_word_count(size_t const & length) {
+          return (length + chars_per_mask_word - 1) / chars_per_mask_word;
+        }
+
+        /// check if an ASCII character is A, C, G, or T, case insensitive.
+        static inline bool is_acgt(unsigned char c) {
+          c &= 0xDF;
+          return (c == 'A') || (c == 'C') || (c == 'G') || (c == 'T');
+        }
+
+        /**
+         * @brief  translate and pack a sequence of ASCII chars.
+         * @param in      input characters.  should not contain EOL characters.
+         * @param len     number of input characters
+         * @param out     output words, get_word_count(len) of them.  overwritten.
+         * @param ambig   optional output mask, 1 bit per char for non-ACGT chars (e.g. N), get_mask_word_count(len) words.
+         *                overwritten.  bit (i % 64) of word (i / 64) corresponds to char i.
+         */
+        static void encode(unsigned char const * in, size_t const & len, word_type * out, word_type * ambig = nullptr) {
+          if (len == 0) return;
+
+          ::memset(out, 0, get_word_count(len) * sizeof(word_type));
+          if (ambig != nullptr) ::memset(ambig, 0, get_mask_word_count(len) * sizeof(word_type));
+
+          size_t i = 0;
+#if defined(__AVX2__)
+          if (simd_compatible()) i = encode_avx2(in, i, len, out, ambig);
+#endif
+#if defined(__SSSE3__)
+          if (simd_compatible()) i = encode_ssse3(in, i, len, out, ambig);
+#endif
+          encode_scalar(in, i, len, out, ambig);
+        }
+
+        /// check that the FROM_ASCII table is case insensitive in 0x40-0x7F, as required by the vectorized lookup.
+        static bool simd_compatible() {
+          static const bool compatible = check_case_insensitive();
+          return compatible;
+        }
+
+      protected:
+
+        /// see simd_compatible
+        static bool check_case_insensitive() {
+          for (unsigned int c = 0x60; c < 0x80; ++c) {
+            if (Alphabet::FROM_ASCII[c] != Alphabet::FROM_ASCII[c & 0xDF]) return false;
+          }
+          return true;
+        }
+
+        /// pack n translated chars starting at position i, 1 char at a time.
+        static inline void pack_codes(uint8_t const * codes, size_t const & i, size_t const & n, word_type * out) {
+          for (size_t j = 0; j < n; ++j) {
+            out[(i + j) / chars_per_word] |= static_cast<word_type>(codes[j]) << (((i + j) % chars_per_word) * bits_per_char);
+          }
+        }
+
+        /// translate and pack chars [i, end) with the lookup table, 1 char at a time.
+        static inline void encode_scalar(unsigned char const * in, size_t i, size_t const & end, word_type * out, word_type * ambig) {
+          for (; i < end; ++i) {
+            out[i / chars_per_word] |= static_cast<word_type>(Alphabet::FROM_ASCII[in[i]]) << ((i % chars_per_word) * bits_per_char);
+            if ((ambig != nullptr) && !is_acgt(in[i])) ambig[i / chars_per_mask_word] |= static_cast<word_type>(1) << (i % chars_per_mask_word);
+          }
+        }
+
+#if defined(__SSSE3__)
+        /// pack 16 2-bit chars into half a word.
+        static inline void pack16(__m128i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, 2> const &) {
+          __m128i x = _mm_maddubs_epi16(codes, _mm_set1_epi16(0x0401));    // 2 chars per 16 bit
+          x = _mm_madd_epi16(x, _mm_set1_epi32(0x00100001));               // 4 chars per 32 bit
+          x = _mm_shuffle_epi8(x, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+          out[i / chars_per_word] |= static_cast<word_type>(static_cast<uint32_t>(_mm_cvtsi128_si32(x))) << ((i % chars_per_word) * bits_per_char);
+        }
+
+        /// pack 16 4-bit chars into a word.
+        static inline void pack16(__m128i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, 4> const &) {
+          __m128i x = _mm_maddubs_epi16(codes, _mm_set1_epi16(0x1001));    // 2 chars per 16 bit
+          x = _mm_packus_epi16(x, x);
+          out[i / chars_per_word] = static_cast<word_type>(_mm_cvtsi128_si64(x));
+        }
+
+        /// pack 16 chars of other sizes, 1 char at a time.
+        template <unsigned int BITS>
+        static inline void pack16(__m128i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, BITS> const &) {
+          uint8_t buf[16];
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(buf), codes);
+          pack_codes(buf, i, 16, out);
+        }
+
+        /// encode 16 chars at a time, starting from i (multiple of 16).  returns the position of the first unencoded char.
+        static size_t encode_ssse3(unsigned char const * in, size_t i, size_t const & len, word_type * out, word_type * ambig) {
+          // tables for 0x40-0x4F and 0x50-0x5F are loaded directly from FROM_ASCII.
+          const __m128i tbl4 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x40));
+          const __m128i tbl5 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x50));
+          const __m128i hi2 = _mm_set1_epi8(static_cast<char>(0xC0));
+          const __m128i range = _mm_set1_epi8(0x40);
+          const __m128i fold = _mm_set1_epi8(static_cast<char>(0xDF));
+          const __m128i lo4 = _mm_set1_epi8(0x0F);
+          const __m128i bit4 = _mm_set1_epi8(0x10);
+          const __m128i a = _mm_set1_epi8('A');
+          const __m128i c = _mm_set1_epi8('C');
+          const __m128i g = _mm_set1_epi8('G');
+          const __m128i t = _mm_set1_epi8('T');
+
+          __m128i v, idx, sel, codes, acgt;
+          for (; (i + 16) <= len; i += 16) {
+            v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+
+            // any char outside of 0x40-0x7F:  use lookup table.
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, hi2), range)) != 0xFFFF) {
+              encode_scalar(in, i, i + 16, out, ambig);
+              continue;
+            }
+
+            // fold to upper case, then look up by low nibble in the 0x4X or 0x5X table
+            v = _mm_and_si128(v, fold);
+            idx = _mm_and_si128(v, lo4);
+            sel = _mm_cmpeq_epi8(_mm_and_si128(v, bit4), bit4);
+            codes = _mm_or_si128(_mm_and_si128(sel, _mm_shuffle_epi8(tbl5, idx)),
+                                 _mm_andnot_si128(sel, _mm_shuffle_epi8(tbl4, idx)));
+
+            if (ambig != nullptr) {
+              acgt = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, c)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, g), _mm_cmpeq_epi8(v, t)));
+              ambig[i / chars_per_mask_word] |=
+                  static_cast<word_type>(~_mm_movemask_epi8(acgt) & 0xFFFF) << (i % chars_per_mask_word);
+            }
+
+            pack16(codes, i, out, ::std::integral_constant<unsigned int, bits_per_char>());
+          }
+          return i;
+        }
+#endif
+
+#if defined(__AVX2__)
+        /// pack 32 2-bit chars into a word.
+        static inline void pack32(__m256i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, 2> const &) {
+          __m256i x = _mm256_maddubs_epi16(codes, _mm256_set1_epi16(0x0401));    // 2 chars per 16 bit
+          x = _mm256_madd_epi16(x, _mm256_set1_epi32(0x00100001));               // 4 chars per 32 bit
+          x = _mm256_shuffle_epi8(x, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+          out[i / chars_per_word] = static_cast<word_type>(static_cast<uint32_t>(_mm256_extract_epi32(x, 0))) |
+              (static_cast<word_type>(static_cast<uint32_t>(_mm256_extract_epi32(x, 4))) << 32);
+        }
+
+        /// pack 32 4-bit chars into 2 words.
+        static inline void pack32(__m256i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, 4> const &) {
+          __m256i x = _mm256_maddubs_epi16(codes, _mm256_set1_epi16(0x1001));    // 2 chars per 16 bit
+          x = _mm256_packus_epi16(x, x);                                         // per 128 bit lane
+          out[i / chars_per_word] = static_cast<word_type>(_mm256_extract_epi64(x, 0));
+          out[i / chars_per_word + 1] = static_cast<word_type>(_mm256_extract_epi64(x, 2));
+        }
+
+        /// pack 32 chars of other sizes, 1 char at a time.
+        template <unsigned int BITS>
+        static inline void pack32(__m256i codes, size_t const & i, word_type * out, ::std::integral_constant<unsigned int, BITS> const &) {
+          uint8_t buf[32];
+          _mm256_storeu_si256(reinterpret_cast<__m256i *>(buf), codes);
+          pack_codes(buf, i, 32, out);
+        }
+
+        /// encode 32 chars at a time, starting from i (multiple of 32).  returns the position of the first unencoded char.
+        static size_t encode_avx2(unsigned char const * in, size_t i, size_t const & len, word_type * out, word_type * ambig) {
+          const __m256i tbl4 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x40)));
+          const __m256i tbl5 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x50)));
+          const __m256i hi2 = _mm256_set1_epi8(static_cast<char>(0xC0));
+          const __m256i range = _mm256_set1_epi8(0x40);
+          const __m256i fold = _mm256_set1_epi8(static_cast<char>(0xDF));
+          const __m256i lo4 = _mm256_set1_epi8(0x0F);
+          const __m256i bit4 = _mm256_set1_epi8(0x10);
+          const __m256i a = _mm256_set1_epi8('A');
+          const __m256i c = _mm256_set1_epi8('C');
+          const __m256i g = _mm256_set1_epi8('G');
+          const __m256i t = _mm256_set1_epi8('T');
+
+          __m256i v, idx, sel, codes, acgt;
+          for (; (i + 32) <= len; i += 32) {
+            v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+
+            // any char outside of 0x40-0x7F:  use lookup table.
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(v, hi2), range)) != -1) {
+              encode_scalar(in, i, i + 32, out, ambig);
+              continue;
+            }
+
+            // fold to upper case, then look up by low nibble in the 0x4X or 0x5X table
+            v = _mm256_and_si256(v, fold);
+            idx = _mm256_and_si256(v, lo4);
+            sel = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit4), bit4);
+            codes = _mm256_blendv_epi8(_mm256_shuffle_epi8(tbl4, idx), _mm256_shuffle_epi8(tbl5, idx), sel);
+
+            if (ambig != nullptr) {
+              acgt = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, c)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, g), _mm256_cmpeq_epi8(v, t)));
+              ambig[i / chars_per_mask_word] |=
+                  static_cast<word_type>(static_cast<uint32_t>(~_mm256_movemask_epi8(acgt))) << (i % chars_per_mask_word);
+            }
+
+            pack32(codes, i, out, ::std::integral_constant<unsigned int, bits_per_char>());
+          }
+          return i;
+        }
+#endif
+
+    };
+
+    template <typename Alphabet>
+    constexpr unsigned int PackedEncoder<Alphabet>::bits_per_char;
+    template <typename Alphabet>
+    constexpr unsigned int PackedEncoder<Alphabet>::chars_per_word;
+    template <typename Alphabet>
+    constexpr unsigned int PackedEncoder<Alphabet>::chars_per_mask_word;
+
+  } // namespace common
+} // namespace bliss
+
+#endif // BLISS_COMMON_PACKED_ENCODER_HPP
@@ -165,7 +165,21 @@ namespace bliss
     {
       return this->nChars;
     }
-  
+
+    /**
+     * @brief   Returns the storage words of the PackedString.
+     *
+     * Characters are packed starting at the least significant bits of each
+     * word, and do not span words.  This is the same layout as read by the
+     * UnpackingIterator.
+     *
+     * @return  The packed storage words.
+     */
+    const std::vector<WordType>& getPackedWords() const
+    {
+      return this->packedString;
+    }
+
   private:
     /// The base container for the packed sequence.
     std::vector<WordType> packedString;
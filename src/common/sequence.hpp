@@ -25,6 +25,9 @@
 #ifndef SEQUENCE_HPP_
 #define SEQUENCE_HPP_
 
+#include <type_traits>  // decay
+#include <utility>      // declval
+
 namespace bliss
 {
   namespace common
@@ -303,6 +306,119 @@ namespace bliss
     };
 
 
+    /**
+     * @class     bliss::common::DenseSequenceKmerId
+     * @brief     kmer position as a dense global read number and a 16 bit offset in the record.
+     * @details   the read number comes from SequenceId::seq_id, which has to be set by a numbering pass first, e.g.
+     *            KmerFileHelper::number_reads.  read numbers are 0 to (number of reads - 1) over all files and ranks,
+     *            so they can index arrays directly.  with uint32_t read numbers the id is 6 bytes instead of 8,
+     *            and with uint64_t 10 bytes.  the file id is not stored.
+     *
+     *      read_id |===[=====][========*======]====================|
+     *                  |<--pos->|
+     *
+     * @note      for short reads only, as the offset is 16 bits.  packed, so it is sent via MPI as bytes.
+     * @tparam ReadIdType   unsigned integer type for the read number.  uint32_t if the number of reads fits.
+     */
+    template <typename ReadIdType = uint32_t>
+    class DenseSequenceKmerId
+    {
+      public:
+        /// dense global read number.
+        ReadIdType id;
+        /// offset of the kmer from the start of the record.
+        uint16_t pos;
+
+        friend std::ostream& operator<<(std::ostream& ost, const DenseSequenceKmerId & seq_id)
+        {
+          ost << " DenseSeqId: id=" << static_cast<size_t>(seq_id.id) << " pos=" << seq_id.pos;
+          return ost;
+        }
+
+        DenseSequenceKmerId() : id(0), pos(0) {};
+
+        DenseSequenceKmerId(size_t const & read_id, uint16_t const & pos_in_seq = 0) :
+          id(static_cast<ReadIdType>(read_id)), pos(pos_in_seq) {}
+        DenseSequenceKmerId(SequenceId const & other) : DenseSequenceKmerId(other.seq_id) {}
+        DenseSequenceKmerId(DenseSequenceKmerId const & other) : id(other.id), pos(other.pos) {}
+
+        DenseSequenceKmerId& operator=(SequenceId const & other) {
+          this->id = static_cast<ReadIdType>(other.seq_id);
+          this->pos = 0;
+          return *this;
+        }
+        DenseSequenceKmerId& operator=(DenseSequenceKmerId const & other) {
+          this->id = other.id;
+          this->pos = other.pos;
+          return *this;
+        }
+
+        bool operator==(DenseSequenceKmerId const & other) const {
+          return (id == other.id) && (pos == other.pos);
+        }
+
+        bool operator>(DenseSequenceKmerId const & other) const {
+          return (id > other.id) || ((id == other.id) && (pos > other.pos));
+        }
+
+        bool operator<(DenseSequenceKmerId const & other) const {
+          return (id < other.id) || ((id == other.id) && (pos < other.pos));
+        }
+
+        void operator+=(size_t dist) {
+          if ((pos + dist) > 0xFFFF) throw std::invalid_argument("DenseSequenceKmerId increment overflow.");
+          pos += dist;
+        }
+
+        void operator-=(size_t dist) {
+          if (pos < dist) throw std::invalid_argument("DenseSequenceKmerId decrement underflow.");
+          pos -= dist;
+        }
+
+        /// distance in positions.  ids of different reads are compared as (id << 16 | pos).
+        std::ptrdiff_t operator-(DenseSequenceKmerId const & other) {
+          return static_cast<std::ptrdiff_t>(get_key()) - static_cast<std::ptrdiff_t>(other.get_key());
+        }
+
+        /// getter for the read number
+        size_t get_id() const { return id; }
+
+        /// get position within the record
+        size_t get_pos() const { return pos; }
+
+        /// file id is not stored.  read numbers are global over all files.
+        uint8_t get_file_id() const { return 0; }
+
+        /// (id << 16 | pos), in the same order as operator<.  for id types up to 48 bits.
+        uint64_t get_key() const { return (static_cast<uint64_t>(id) << 16) | pos; }
+        static DenseSequenceKmerId from_key(uint64_t const & key) {
+          return DenseSequenceKmerId(key >> 16, static_cast<uint16_t>(key & 0xFFFF));
+        }
+
+    } __attribute__((packed));
+
+
+    /**
+     * @brief   strand of a kmer position, as the highest bit of the id's id member.
+     * @details  canonical position indices store the canonical kmer once, and set the bit for positions where the read
+     *          has the reverse complement.  the bit is the top bit of the file id for ShortSequenceKmerId and
+     *          LongSequenceKmerId, so file ids have to be less than 128, and of the read number for DenseSequenceKmerId.
+     *          use forward() before get_file_id() or get_id().
+     */
+    template <typename IdType>
+    struct kmer_strand {
+        using word_type = typename ::std::decay<decltype(::std::declval<IdType>().id)>::type;
+        static constexpr word_type mask = static_cast<word_type>(static_cast<word_type>(1) << (sizeof(word_type) * 8 - 1));
+
+        static inline bool is_reverse(IdType const & x) { return (x.id & mask) != 0; }
+        static inline void set_reverse(IdType & x) { x.id |= mask; }
+        /// the id without the strand bit.
+        static inline IdType forward(IdType x) { x.id &= ~mask; return x; }
+    };
+    template <typename IdType>
+    constexpr typename kmer_strand<IdType>::word_type kmer_strand<IdType>::mask;
+
+
     /**
      * @class     bliss::io::Sequence
      * @brief     represents a biological sequence, and provides iterators for traversing the sequence.
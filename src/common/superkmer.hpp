@@ -0,0 +1,166 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    superkmer.hpp
+ * @ingroup bliss::common
+ * @brief   packing of consecutive kmers into super-kmers for communication.
+ * @details a super-kmer is a run of consecutive kmers of a sequence (each one is the previous one shifted by 1 character)
+ *          that are assigned to the same rank.  with a minimizer distribution transform, runs are long, e.g. about
+ *          9 kmers for 31-mers with 15-mer minimizers, so sending the run as a packed sequence is several times smaller
+ *          than sending each kmer.
+ *
+ *          packed format of 1 super-kmer, byte aligned, no padding between super-kmers:
+ *            uint16_t n                              number of kmers
+ *            KMER::nWords words                      the first kmer, as stored.
+ *            ceil((n-1) * bitsPerChar / 8) bytes     the last character of each subsequent kmer, LSB first.
+ */
+#ifndef SUPERKMER_HPP_
+#define SUPERKMER_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>    // memcpy
+#include <cassert>
+#include <limits>
+
+#include "common/kmer.hpp"
+
+namespace bliss {
+
+  namespace kmer
+  {
+
+    namespace superkmer {
+
+      /// bytes used for the k-mer in a packed super-kmer.
+      template <typename KMER>
+      constexpr size_t kmer_bytes() {
+        return KMER::nWords * sizeof(typename KMER::KmerWordType);
+      }
+
+      /// bytes used by a packed super-kmer with n kmers.
+      template <typename KMER>
+      constexpr size_t packed_bytes(size_t n) {
+        return sizeof(uint16_t) + kmer_bytes<KMER>() + ((n - 1) * KMER::bitsPerChar + 7) / 8;
+      }
+
+      /// true if next is prev shifted by 1 character, i.e. they are consecutive kmers of a sequence.
+      template <typename KMER>
+      inline bool is_adjacent(KMER const & prev, KMER const & next) {
+        KMER t = prev;
+        t.nextFromChar(static_cast<unsigned char>(next.getSuffix(KMER::bitsPerChar)));
+        return t == next;
+      }
+
+      /**
+       * @brief pack kmers into super-kmers, grouped by destination rank.
+       * @details  runs of consecutive kmers with the same rank are packed together.  the input does not need to
+       *        be consecutive, but should be in sequence order for the packing to be effective.
+       * @param input        kmers, in sequence order and not transformed.
+       * @param ranks        destination rank of each kmer, in [0, p).
+       * @param p            number of ranks
+       * @param send_counts  output, number of bytes for each rank.
+       * @param buffer       output, packed super-kmers, grouped by rank.
+       */
+      template <typename KMER, typename RANK>
+      void pack(std::vector<KMER> const & input, std::vector<RANK> const & ranks, int const p,
+                std::vector<size_t> & send_counts, std::vector<uint8_t> & buffer) {
+        assert(input.size() == ranks.size());
+
+        constexpr size_t max_run = ::std::numeric_limits<uint16_t>::max();
+
+        // first pass:  find the runs and their sizes.
+        std::vector<size_t> run_ends;
+        send_counts.assign(p, 0);
+        size_t j;
+        for (size_t i = 0; i < input.size(); i = j) {
+          for (j = i + 1; (j < input.size()) && (ranks[j] == ranks[i]) && ((j - i) < max_run) &&
+                          is_adjacent(input[j - 1], input[j]); ++j);
+          run_ends.emplace_back(j);
+          send_counts[ranks[i]] += packed_bytes<KMER>(j - i);
+        }
+
+        std::vector<size_t> offsets(p, 0);
+        for (int r = 1; r < p; ++r) {
+          offsets[r] = offsets[r - 1] + send_counts[r - 1];
+        }
+        buffer.resize(offsets[p - 1] + send_counts[p - 1]);
+
+        // second pass:  write the runs.
+        uint16_t n;
+        uint8_t * out;
+        size_t bit;
+        size_t i = 0;
+        for (size_t e : run_ends) {
+          n = static_cast<uint16_t>(e - i);
+          out = buffer.data() + offsets[ranks[i]];
+          offsets[ranks[i]] += packed_bytes<KMER>(n);
+
+          memcpy(out, &n, sizeof(uint16_t));
+          out += sizeof(uint16_t);
+          memcpy(out, input[i].getData(), kmer_bytes<KMER>());
+          out += kmer_bytes<KMER>();
+
+          memset(out, 0, packed_bytes<KMER>(n) - sizeof(uint16_t) - kmer_bytes<KMER>());
+          bit = 0;
+          for (++i; i < e; ++i, bit += KMER::bitsPerChar) {
+            uint16_t c = static_cast<uint16_t>(input[i].getSuffix(KMER::bitsPerChar)) << (bit & 0x7);
+            out[bit >> 3] |= static_cast<uint8_t>(c);
+            if (((bit & 0x7) + KMER::bitsPerChar) > 8) out[(bit >> 3) + 1] |= static_cast<uint8_t>(c >> 8);
+          }
+        }
+      }
+
+      /**
+       * @brief unpack super-kmers, appending the kmers to output.
+       * @return number of kmers unpacked.
+       */
+      template <typename KMER>
+      size_t unpack(uint8_t const * begin, uint8_t const * end, std::vector<KMER> & output) {
+        constexpr uint16_t char_mask = static_cast<uint16_t>((1U << KMER::bitsPerChar) - 1U);
+
+        size_t before = output.size();
+        uint16_t n;
+        size_t bit;
+        uint16_t c;
+        KMER kmer;
+        while (begin < end) {
+          memcpy(&n, begin, sizeof(uint16_t));
+          begin += sizeof(uint16_t);
+          memcpy(kmer.getDataRef(), begin, kmer_bytes<KMER>());
+          begin += kmer_bytes<KMER>();
+          output.emplace_back(kmer);
+
+          bit = 0;
+          for (uint16_t i = 1; i < n; ++i, bit += KMER::bitsPerChar) {
+            c = begin[bit >> 3] >> (bit & 0x7);
+            if (((bit & 0x7) + KMER::bitsPerChar) > 8) c |= static_cast<uint16_t>(begin[(bit >> 3) + 1]) << (8 - (bit & 0x7));
+            kmer.nextFromChar(static_cast<unsigned char>(c & char_mask));
+            output.emplace_back(kmer);
+          }
+          begin += packed_bytes<KMER>(n) - sizeof(uint16_t) - kmer_bytes<KMER>();
+        }
+        assert(begin == end);
+        return output.size() - before;
+      }
+
+    } // namespace superkmer
+
+  } // namespace kmer
+} // namespace bliss
+
+#endif /* SUPERKMER_HPP_ */
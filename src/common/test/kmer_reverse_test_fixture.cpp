@@ -33,6 +33,7 @@
 
 #include <random>
 #include <cstdint>
+#include <vector>
 
 #include <atomic>
 
@@ -371,6 +372,40 @@ TYPED_TEST_P(KmerReverseTest, reverse)
 
 }
 
-REGISTER_TYPED_TEST_CASE_P(KmerReverseTest, reverse_seq_self, reverse_seq, reverse_bswap, reverse_swar, reverse_ssse3, reverse);
+TYPED_TEST_P(KmerReverseTest, reverse_batch)
+{
+  // not a multiple of any SIMD register width, so the remainder path is exercised too.
+  constexpr size_t count = 77;
+  TypeParam km = this->kmer;
+
+  std::vector<TypeParam> input, revcomp(count), revcomp_inplace;
+  for (size_t i = 0; i < count; ++i) {
+    input.push_back(km);
+    km.nextFromChar(rand() % TypeParam::KmerAlphabet::SIZE);
+  }
+  revcomp_inplace = input;
+
+  for (size_t iter = 0; iter < (this->iterations / count); ++iter) {
+    bliss::common::reverse_complement(input.data(), revcomp.data(), count);
+    bliss::common::reverse_complement(revcomp_inplace.data(), revcomp_inplace.data(), count);
+
+    for (size_t i = 0; i < count; ++i) {
+      TypeParam revcomp_seq = input[i].reverse_complement();
+
+      if (!(revcomp[i] == revcomp_seq)) {
+        BL_ERRORF("ERROR: batch revcomp diff at iter %lu, kmer %lu:\n\tinput %s\n\toutput %s\n\tgold %s", iter, i, input[i].toAlphabetString().c_str(), revcomp[i].toAlphabetString().c_str(), revcomp_seq.toAlphabetString().c_str());
+        std::cout << "output: ";  this->print(revcomp[i].getDataRef());
+        std::cout << "gold: ";  this->print(revcomp_seq.getDataRef());
+      }
+      ASSERT_TRUE(revcomp[i] == revcomp_seq);
+      ASSERT_TRUE(revcomp_inplace[i] == revcomp_seq);
+
+      input[i].nextFromChar(rand() % TypeParam::KmerAlphabet::SIZE);
+    }
+    revcomp_inplace = input;
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(KmerReverseTest, reverse_seq_self, reverse_seq, reverse_bswap, reverse_swar, reverse_ssse3, reverse, reverse_batch);
 
 
@@ -214,9 +214,55 @@ TYPED_TEST_P(KmerTransformTest, lex_greater)
 }
 
 
+TYPED_TEST_P(KmerTransformTest, minimizer)
+{
+  using MinOp = bliss::kmer::transform::default_minimizer<TypeParam>;
+  constexpr unsigned int M = (TypeParam::size < 15U ? TypeParam::size : 15U);
+
+  auto km = this->kmer;
+  auto prev = MinOp()(km);
+  auto tmp = km;
+
+  MinOp op;
+
+  static_assert(bliss::kmer::transform::is_strand_symmetric<MinOp>::value, "minimizer should be strand symmetric");
+
+  size_t changes = 0;
+  bool local_same;
+  for (size_t i = 0; i < this->iterations; ++i) {
+    tmp = op(km);
+
+    // same for both strands
+    local_same = (tmp == op(km.reverse_complement()));
+    if (!local_same) {
+      BL_ERRORF("ERROR: minimizer not strand symmetric at iter %lu:\n\tinput %s\n\tresult %s", i, km.toAlphabetString().c_str(), tmp.toAlphabetString().c_str());
+    }
+    ASSERT_TRUE(local_same);
+
+    // is one of the M-mers of either strand.
+    local_same = false;
+    TypeParam strands[2] = {km, km.reverse_complement()};
+    for (int s = 0; s < 2; ++s) {
+      for (unsigned int j = 0; j <= TypeParam::size - M; ++j) {
+        local_same |= (((strands[s] >> j).getSuffix(64) & MinOp::m_mask) == tmp.getSuffix(64));
+      }
+    }
+    ASSERT_TRUE(local_same);
+
+    if (tmp != prev) ++changes;
+    prev = tmp;
+
+    km.nextFromChar(rand() % TypeParam::KmerAlphabet::SIZE);
+  }
+
+  // the minimizer stays the same over several consecutive kmers, when it is shorter than the kmer.
+  if (M + 4 < TypeParam::size) {
+    EXPECT_LT(changes, this->iterations / 2);
+  }
+}
 
 
-REGISTER_TYPED_TEST_CASE_P(KmerTransformTest, identity, trans_xor, lex_less, lex_greater);
+REGISTER_TYPED_TEST_CASE_P(KmerTransformTest, identity, trans_xor, lex_less, lex_greater, minimizer);
 
 //////////////////// RUN the tests with different types.
 
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    microbench_kmer_kernels.cpp
+ * @ingroup
+ * @brief   micro-benchmarks of the kmer kernels, in ns/op and GB/s, with plog::MicroBench.
+ * @details covers Kmer::nextFromChar, reverse complement, the kmer hash functions, lex_less, the bitgroup_ops
+ *          array reverse for each SIMD type, and the ASCII encoders (FROM_ASCII lookup and PackedEncoder).
+ *          usage:  microbench-bliss-common [repetitions [sample_ms]]
+ */
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <cstdlib>   // atoi, atof
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "common/packed_encoder.hpp"
+#include "index/kmer_hash.hpp"
+#include "utils/bitgroup_ops.hpp"
+#include "utils/micro_benchmark.hpp"
+
+// number of kmers or characters processed per kernel call.  fits in L1/L2, so this measures compute, not memory.
+static constexpr size_t N = 4096;
+
+static std::vector<unsigned char> random_ascii(size_t const & n, unsigned int seed) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<int> d(0, 3);
+  std::vector<unsigned char> out(n);
+  for (size_t i = 0; i < n; ++i) out[i] = "ACGT"[d(gen)];
+  return out;
+}
+
+template <typename KMER>
+static std::vector<KMER> random_kmers(size_t const & n, unsigned int seed) {
+  std::vector<unsigned char> ascii = random_ascii(n + KMER::size, seed);
+  std::vector<KMER> out;
+  out.reserve(n);
+  KMER km;
+  for (size_t i = 0; i < KMER::size - 1; ++i) km.nextFromChar(KMER::KmerAlphabet::FROM_ASCII[ascii[i]]);
+  for (size_t i = KMER::size - 1; i < n + KMER::size - 1; ++i) {
+    km.nextFromChar(KMER::KmerAlphabet::FROM_ASCII[ascii[i]]);
+    out.push_back(km);
+  }
+  return out;
+}
+
+
+template <typename KMER>
+void bench_next_from_char(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<unsigned char> ascii = random_ascii(N, 1);
+  std::vector<unsigned char> enc(N);
+  for (size_t i = 0; i < N; ++i) enc[i] = KMER::KmerAlphabet::FROM_ASCII[ascii[i]];
+  KMER km;
+  mb.run("nextFromChar " + name, N, 1.0, [&]() {
+    for (size_t i = 0; i < N; ++i) {
+      km.nextFromChar(enc[i]);
+      ::plog::do_not_optimize(km);
+    }
+  });
+}
+
+template <typename KMER>
+void bench_revcomp(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<KMER> kmers = random_kmers<KMER>(N, 2);
+  std::vector<KMER> out(N);
+  mb.run("reverse_complement " + name, N, 2.0 * sizeof(KMER), [&]() {
+    for (size_t i = 0; i < N; ++i) out[i] = kmers[i].reverse_complement();
+    ::plog::do_not_optimize(out[N - 1]);
+  });
+}
+
+template <typename KMER>
+void bench_lex_less(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<KMER> kmers = random_kmers<KMER>(N, 3);
+  std::vector<KMER> out(N);
+  ::bliss::kmer::transform::lex_less<KMER> op;
+  mb.run("lex_less " + name, N, 2.0 * sizeof(KMER), [&]() {
+    for (size_t i = 0; i < N; ++i) out[i] = op(kmers[i]);
+    ::plog::do_not_optimize(out[N - 1]);
+  });
+}
+
+template <typename HASH, typename KMER>
+void bench_hash(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<KMER> kmers = random_kmers<KMER>(N, 4);
+  std::vector<uint64_t> out(N);
+  HASH h;
+  mb.run("hash " + name, N, sizeof(KMER), [&]() {
+    for (size_t i = 0; i < N; ++i) out[i] = h(kmers[i]);
+    ::plog::do_not_optimize(out[N - 1]);
+  });
+}
+
+template <unsigned int BITS, unsigned char SIMD>
+void bench_bit_reverse(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<unsigned char> in = random_ascii(N, 5);
+  std::vector<unsigned char> out(N);
+  // per byte.  the array version picks the widest SIMD up to SIMD, and the narrower ones for the remainder.
+  mb.run("bitgroup_ops reverse " + name, N, 2.0, [&]() {
+    ::bliss::utils::bit_ops::reverse<BITS, SIMD>(out.data(), in.data(), N);
+    ::plog::do_not_optimize(out[0]);
+  });
+}
+
+template <typename ALPHA>
+void bench_ascii(::plog::MicroBench & mb, std::string const & name) {
+  std::vector<unsigned char> in = random_ascii(N, 6);
+  std::vector<unsigned char> out(N);
+  mb.run("FROM_ASCII " + name, N, 2.0, [&]() {
+    for (size_t i = 0; i < N; ++i) out[i] = ALPHA::FROM_ASCII[in[i]];
+    ::plog::do_not_optimize(out[N - 1]);
+  });
+
+  using encoder = ::bliss::common::PackedEncoder<ALPHA>;
+  std::vector<typename encoder::word_type> words(encoder::get_word_count(N));
+  std::vector<typename encoder::word_type> mask(encoder::get_mask_word_count(N));
+  mb.run("PackedEncoder " + name, N, 1.0, [&]() {
+    encoder::encode(in.data(), N, words.data(), mask.data());
+    ::plog::do_not_optimize(words[0]);
+  });
+}
+
+
+int main(int argc, char** argv) {
+  size_t reps = (argc > 1) ? atoi(argv[1]) : 15;
+  double sample_ms = (argc > 2) ? atof(argv[2]) : 20.0;
+
+  using K21 = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+  using K31 = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+  using K63 = ::bliss::common::Kmer<63, ::bliss::common::DNA, uint64_t>;
+  using K31_16 = ::bliss::common::Kmer<31, ::bliss::common::DNA16, uint64_t>;
+  using K31_5 = ::bliss::common::Kmer<31, ::bliss::common::DNA5, uint64_t>;
+
+  {
+    ::plog::MicroBench mb(reps, sample_ms);
+    bench_next_from_char<K21>(mb, "DNA k21");
+    bench_next_from_char<K31>(mb, "DNA k31");
+    bench_next_from_char<K63>(mb, "DNA k63");
+    bench_next_from_char<K31_16>(mb, "DNA16 k31");
+    mb.report("kmer");
+  }
+  {
+    ::plog::MicroBench mb(reps, sample_ms);
+    bench_revcomp<K21>(mb, "DNA k21");
+    bench_revcomp<K31>(mb, "DNA k31");
+    bench_revcomp<K63>(mb, "DNA k63");
+    bench_revcomp<K31_5>(mb, "DNA5 k31");
+    bench_revcomp<K31_16>(mb, "DNA16 k31");
+    bench_lex_less<K31>(mb, "DNA k31");
+    bench_lex_less<K63>(mb, "DNA k63");
+    mb.report("revcomp");
+  }
+  {
+    ::plog::MicroBench mb(reps, sample_ms);
+    bench_hash<::bliss::kmer::hash::cpp_std<K31, false>, K31>(mb, "std k31");
+    bench_hash<::bliss::kmer::hash::identity<K31, false>, K31>(mb, "identity k31");
+    bench_hash<::bliss::kmer::hash::murmur<K31, false>, K31>(mb, "murmur k31");
+    bench_hash<::bliss::kmer::hash::farm<K31, false>, K31>(mb, "farm k31");
+    bench_hash<::bliss::kmer::hash::crc32c<K31, false>, K31>(mb, "crc32c k31");
+    bench_hash<::bliss::kmer::hash::murmur<K63, false>, K63>(mb, "murmur k63");
+    bench_hash<::bliss::kmer::hash::farm<K63, false>, K63>(mb, "farm k63");
+    bench_hash<::bliss::kmer::hash::crc32c<K63, false>, K63>(mb, "crc32c k63");
+    mb.report("hash");
+  }
+  {
+    ::plog::MicroBench mb(reps, sample_ms);
+    bench_bit_reverse<2, ::bliss::utils::bit_ops::BIT_REV_SEQ>(mb, "2 SEQ");
+    bench_bit_reverse<2, ::bliss::utils::bit_ops::BIT_REV_SWAR>(mb, "2 SWAR");
+    bench_bit_reverse<4, ::bliss::utils::bit_ops::BIT_REV_SWAR>(mb, "4 SWAR");
+#if defined(__SSSE3__)
+    bench_bit_reverse<2, ::bliss::utils::bit_ops::BIT_REV_SSSE3>(mb, "2 SSSE3");
+    bench_bit_reverse<4, ::bliss::utils::bit_ops::BIT_REV_SSSE3>(mb, "4 SSSE3");
+#endif
+#if defined(__AVX2__)
+    bench_bit_reverse<2, ::bliss::utils::bit_ops::BIT_REV_AVX2>(mb, "2 AVX2");
+    bench_bit_reverse<4, ::bliss::utils::bit_ops::BIT_REV_AVX2>(mb, "4 AVX2");
+#endif
+    mb.report("bitgroup_ops");
+  }
+  {
+    ::plog::MicroBench mb(reps, sample_ms);
+    bench_ascii<::bliss::common::DNA>(mb, "DNA");
+    bench_ascii<::bliss::common::DNA5>(mb, "DNA5");
+    bench_ascii<::bliss::common::DNA16>(mb, "DNA16");
+    mb.report("ascii");
+  }
+
+  return 0;
+}
@@ -207,3 +207,43 @@ TEST_F(PackingTest, TestKmerGeneration1) {
 
   }
 }
+
+// bulk fill gives the same values as operator* and operator++, also when mixed with them.
+TEST_F(PackingTest, TestIteratorFill) {
+  for (std::string dna : dna_seqs)
+  {
+    bliss::common::AlphabetTraits<bliss::common::DNA>::translateFromAscii(dna.begin(), dna.end(), dna.begin());
+
+    typedef bliss::common::PackingIterator<std::string::iterator, bliss::common::AlphabetTraits<bliss::common::DNA>::getBitsPerChar()> packit_t;
+    packit_t packIt(dna.begin(), dna.end());
+
+    // unpacking iterator (one2many)
+    typedef bliss::common::UnpackingIterator<packit_t, bliss::common::AlphabetTraits<bliss::common::DNA>::getBitsPerChar()> unpackit_t;
+    std::vector<char> gold(dna.size());
+    std::copy(unpackit_t(packIt), unpackit_t(packIt, dna.size()), gold.begin());
+
+    std::vector<char> unpacked(dna.size());
+    unpackit_t unpackIt(packIt);
+    size_t half = dna.size() / 2;
+    auto out = unpackIt.fill(unpacked.begin(), half);
+    out = unpackIt.fill(out, dna.size() - half);
+    EXPECT_TRUE(out == unpacked.end());
+    EXPECT_TRUE(unpackIt == unpackit_t(packIt, dna.size()));
+    EXPECT_EQ(gold, unpacked);
+
+    // packed kmer generation iterator (one2many sliding window)
+    typedef bliss::common::Kmer<21, bliss::common::DNA, uint8_t> Kmer;
+    typedef bliss::common::PackedKmerGenerationIterator< packit_t, Kmer > kmer_gen_it_t;
+    if (dna.size() >= 21)
+    {
+      size_t nkmers = dna.size() - 21 + 1;
+      std::vector<Kmer> kgold(kmer_gen_it_t(packIt), kmer_gen_it_t(packIt, dna.length()));
+
+      std::vector<Kmer> kmers(nkmers);
+      kmer_gen_it_t kmerGenIt(packIt);
+      kmers[0] = *kmerGenIt;   // read the first kmer before the fill.
+      kmerGenIt.fill(kmers.begin(), nkmers);
+      EXPECT_EQ(kgold, kmers);
+    }
+  }
+}
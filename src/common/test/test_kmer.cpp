@@ -754,3 +754,157 @@ TEST(KmerReverse, TestKmerReverse112)
   EXPECT_EQ(kmer4_ex_rev, kmer4_rev);
 
 }
+
+
+/**
+ * Test the packed key storage policy:  compact kmers are not padded beyond 4 byte granularity and behave as the uint64_t kmers.
+ */
+template <typename Alphabet, unsigned int K>
+void compute_compact_kmer(std::string const & input) {
+  using Kmer = bliss::common::Kmer<K, Alphabet, uint64_t>;
+  using CompactKmer = bliss::common::CompactKmer<K, Alphabet>;
+
+  EXPECT_EQ(((CompactKmer::nBits + 31) / 32) * 4, sizeof(CompactKmer));
+  EXPECT_EQ(CompactKmer::nWords * sizeof(typename CompactKmer::KmerWordType), sizeof(CompactKmer));
+
+  Kmer km(input.substr(0, K));
+  CompactKmer ckm(input.substr(0, K));
+
+  for (size_t i = K; i < input.length(); ++i) {
+    EXPECT_EQ(km.toAlphabetString(), ckm.toAlphabetString());
+    EXPECT_EQ(km.reverse_complement().toAlphabetString(), ckm.reverse_complement().toAlphabetString());
+    // the words are stored least significant first, so the bytes are the same on little endian machines.
+    EXPECT_EQ(0, memcmp(km.getData(), ckm.getData(), (CompactKmer::nBits + 7) / 8));
+
+    km.nextFromChar(Alphabet::FROM_ASCII[static_cast<size_t>(input[i])]);
+    ckm.nextFromChar(Alphabet::FROM_ASCII[static_cast<size_t>(input[i])]);
+  }
+}
+
+TEST(KmerStorage, TestCompactKmer)
+{
+  static_assert(std::is_same<uint64_t, typename bliss::common::compact_kmer_word<31, bliss::common::DNA>::type>::value, "31-mer should use uint64_t");
+  static_assert(std::is_same<uint32_t, typename bliss::common::compact_kmer_word<33, bliss::common::DNA>::type>::value, "33-mer should use uint32_t");
+  static_assert(std::is_same<uint32_t, typename bliss::common::compact_kmer_word<48, bliss::common::DNA>::type>::value, "48-mer should use uint32_t");
+  static_assert(std::is_same<uint64_t, typename bliss::common::compact_kmer_word<49, bliss::common::DNA>::type>::value, "49-mer should use uint64_t");
+  static_assert(std::is_same<uint16_t, typename bliss::common::compact_kmer_word<40, bliss::common::DNA, 2>::type>::value, "40-mer should use uint16_t with 2 byte granularity");
+  static_assert(std::is_same<uint8_t, typename bliss::common::compact_kmer_word<41, bliss::common::DNA, 1>::type>::value, "41-mer should use uint8_t with 1 byte granularity");
+
+  EXPECT_EQ(12UL, sizeof(bliss::common::CompactKmer<41, bliss::common::DNA>));
+  EXPECT_EQ(16UL, sizeof(std::pair<bliss::common::CompactKmer<41, bliss::common::DNA>, uint32_t>));
+  EXPECT_EQ(24UL, sizeof(std::pair<bliss::common::Kmer<41, bliss::common::DNA, uint64_t>, uint32_t>));
+
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT";
+
+  compute_compact_kmer<bliss::common::DNA, 21>(input);
+  compute_compact_kmer<bliss::common::DNA, 33>(input);
+  compute_compact_kmer<bliss::common::DNA, 41>(input);
+  compute_compact_kmer<bliss::common::DNA, 48>(input);
+  compute_compact_kmer<bliss::common::DNA5, 21>(input);
+  compute_compact_kmer<bliss::common::DNA5, 31>(input);
+  compute_compact_kmer<bliss::common::DNA16, 17>(input);
+}
+
+
+/**
+ * Test the 1 and 2 word scalar paths against the same kmers in more words of a smaller word type.
+ */
+template <typename Alphabet, unsigned int K, typename WT, typename SmallWT>
+void compute_fast_word_kmer(std::string const & input) {
+  using Kmer = bliss::common::Kmer<K, Alphabet, WT>;
+  using SmallKmer = bliss::common::Kmer<K, Alphabet, SmallWT>;
+  static_assert(bliss::common::detail::kmer_words<WT, Kmer::nWords>::fast, "expected a scalar path");
+  static_assert(!bliss::common::detail::kmer_words<SmallWT, SmallKmer::nWords>::fast, "expected the generic path");
+
+  Kmer km(input.substr(0, K)), prev(km);
+  SmallKmer skm(input.substr(0, K)), sprev(skm);
+
+  for (size_t i = K; i < input.length(); ++i) {
+    km.nextFromChar(Alphabet::FROM_ASCII[static_cast<size_t>(input[i])]);
+    skm.nextFromChar(Alphabet::FROM_ASCII[static_cast<size_t>(input[i])]);
+    ASSERT_EQ(skm.toAlphabetString(), km.toAlphabetString());
+    EXPECT_EQ(skm.reverse_complement().toAlphabetString(), km.reverse_complement().toAlphabetString());
+
+    // comparisons
+    EXPECT_EQ(sprev < skm, prev < km);
+    EXPECT_EQ(sprev == skm, prev == km);
+    EXPECT_EQ(sprev.compare(skm), prev.compare(km));
+    EXPECT_EQ(0, km.compare(km));
+
+    // shifts by characters, up to and past the kmer size.
+    for (size_t s : {1UL, 3UL, 16UL, static_cast<size_t>(K - 1), static_cast<size_t>(K), static_cast<size_t>(K + 40)}) {
+      EXPECT_EQ((skm << s).toAlphabetString(), (km << s).toAlphabetString());
+      EXPECT_EQ((skm >> s).toAlphabetString(), (km >> s).toAlphabetString());
+    }
+    prev = km;
+    sprev = skm;
+  }
+}
+
+TEST(KmerStorage, TestFastWordKmer)
+{
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT"
+                         "GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT";
+
+  compute_fast_word_kmer<bliss::common::DNA, 21, uint64_t, uint16_t>(input);
+  compute_fast_word_kmer<bliss::common::DNA, 32, uint64_t, uint32_t>(input);
+  compute_fast_word_kmer<bliss::common::DNA16, 15, uint64_t, uint8_t>(input);
+#if defined(__SIZEOF_INT128__)
+  compute_fast_word_kmer<bliss::common::DNA, 33, uint64_t, uint32_t>(input);
+  compute_fast_word_kmer<bliss::common::DNA, 48, uint64_t, uint32_t>(input);
+  compute_fast_word_kmer<bliss::common::DNA5, 32, uint64_t, uint32_t>(input);
+  compute_fast_word_kmer<bliss::common::DNA16, 24, uint64_t, uint32_t>(input);
+#endif
+}
+
+
+/**
+ * Test the comparison of multi-word kmers (SIMD for 16 bytes or more) against a word loop from the most significant word.
+ * the pairs differ in 1 random character, so each chunk of the comparison decides some of them.
+ */
+template <typename Alphabet, unsigned int K, typename WT>
+void compute_multi_word_comparison() {
+  using Kmer = bliss::common::Kmer<K, Alphabet, WT>;
+
+  srand(K);
+  Kmer km, other;
+  for (size_t i = 0; i < 2000; ++i) {
+    for (unsigned int j = 0; j < K; ++j) km.nextFromChar(rand() % 4);
+    other = km;
+    if (i % 8 != 0) {
+      // change 1 character, via the string form.
+      std::string s = km.toAlphabetString();
+      size_t pos = rand() % K;
+      s[pos] = (s[pos] == 'A') ? 'C' : 'A';
+      other = Kmer(s);
+    }
+
+    int expected = 0;
+    for (int w = Kmer::nWords - 1; w >= 0; --w) {
+      if (km.getData()[w] != other.getData()[w]) {
+        expected = (km.getData()[w] < other.getData()[w]) ? -1 : 1;
+        break;
+      }
+    }
+    ASSERT_EQ(expected == 0, km == other) << "K=" << K << " i=" << i;
+    ASSERT_EQ(expected < 0, km < other) << "K=" << K << " i=" << i;
+    ASSERT_EQ(expected > 0, other < km) << "K=" << K << " i=" << i;
+    ASSERT_EQ(expected, static_cast<int>(km.compare(other))) << "K=" << K << " i=" << i;
+    ASSERT_EQ(-expected, static_cast<int>(other.compare(km))) << "K=" << K << " i=" << i;
+  }
+}
+
+TEST(KmerComparison, TestMultiWordComparison)
+{
+  compute_multi_word_comparison<bliss::common::DNA, 51, uint32_t>();
+  compute_multi_word_comparison<bliss::common::DNA, 63, uint16_t>();
+  compute_multi_word_comparison<bliss::common::DNA, 95, uint64_t>();
+  compute_multi_word_comparison<bliss::common::DNA, 127, uint64_t>();
+  compute_multi_word_comparison<bliss::common::DNA, 127, uint8_t>();
+  compute_multi_word_comparison<bliss::common::DNA, 160, uint64_t>();
+  compute_multi_word_comparison<bliss::common::DNA5, 85, uint64_t>();
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+
+#include "common/kmer_dispatch.hpp"
+#include "common/alphabets.hpp"
+
+#include <string>
+#include <vector>
+
+
+/// records the kmer type it was called with, and reverse complements the input prefix.
+struct KmerSizeRecorder {
+    unsigned int k = 0;
+    unsigned int words = 0;
+    std::string rc;
+
+    template <typename KmerType>
+    void operator()(std::string const & input) {
+      k = KmerType::size;
+      words = KmerType::nWords;
+      KmerType km(input.substr(0, KmerType::size));
+      rc = km.reverse_complement().toAlphabetString();
+    }
+};
+
+TEST(KmerDispatch, dispatch)
+{
+  std::string input;
+  for (int i = 0; i < 10; ++i) input.append("GATTTGGGGTTCAAAGCAGT");
+
+  for (unsigned int k : bliss::common::default_kmer_sizes::values()) {
+    KmerSizeRecorder rec;
+    ASSERT_TRUE(bliss::common::dispatch_kmer_size<bliss::common::DNA>(k, rec, input));
+    EXPECT_EQ(k, rec.k);
+    EXPECT_EQ((2 * k + 63) / 64, rec.words);
+    EXPECT_FALSE(rec.rc.empty());
+    EXPECT_TRUE(bliss::common::is_dispatched_kmer_size(k));
+  }
+
+  // same result as the compile time type.
+  KmerSizeRecorder rec;
+  bliss::common::dispatch_kmer_size<bliss::common::DNA>(31, rec, input);
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA>;
+  EXPECT_EQ(KmerType(input.substr(0, 31)).reverse_complement().toAlphabetString(), rec.rc);
+
+  // custom list, and sizes not in the list.
+  using Sizes = bliss::common::kmer_sizes<5, 17>;
+  KmerSizeRecorder rec2;
+  EXPECT_TRUE((bliss::common::dispatch_kmer_size<bliss::common::DNA5, Sizes>(17, rec2, input)));
+  EXPECT_EQ(17U, rec2.k);
+  KmerSizeRecorder rec3;
+  EXPECT_FALSE((bliss::common::dispatch_kmer_size<bliss::common::DNA, Sizes>(31, rec3, input)));
+  EXPECT_EQ(0U, rec3.k);
+  EXPECT_FALSE(bliss::common::is_dispatched_kmer_size<Sizes>(31));
+  EXPECT_FALSE(bliss::common::is_dispatched_kmer_size(32));
+}
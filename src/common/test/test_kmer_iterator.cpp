@@ -23,9 +23,16 @@
 #include "common/alphabets.hpp"
 #include "iterators/transform_iterator.hpp"
 #include "common/kmer_iterators.hpp"
+#include "common/packed_encoder.hpp"
+#include "common/kmer_transform.hpp"
 #include "utils/kmer_utils.hpp"
 #include "utils/logging.h"
 
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+
 template<typename Alphabet, int K>
 void compute_kmer_iter(std::string input) {
 
@@ -120,3 +127,355 @@ TEST(KmerIterator, TestKmerIteratorDNA5MultiWord)
 }
 
 
+template<typename Alphabet, int K, typename WordT = WordType>
+void compute_packed_word_kmers(std::string input) {
+
+  using KmerType = bliss::common::Kmer<K, Alphabet, WordT>;
+  using Encoder = bliss::common::PackedEncoder<Alphabet>;
+  using Generator = bliss::common::PackedWordKmerGenerator<KmerType>;
+
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  // the character iterator needs at least K chars.
+  std::vector<KmerType> gold;
+  if (input.size() >= K)
+    gold.assign(KmerIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                KmerIterator(BaseCharIterator(input.cend(), Decoder()), false));
+
+  std::vector<WordType> words(Encoder::get_word_count(input.size()));
+  Encoder::encode(reinterpret_cast<unsigned char const *>(input.data()), input.size(), words.data());
+
+  std::vector<KmerType> kmers, rcs;
+  Generator()(words.data(), input.size(), std::back_inserter(kmers), std::back_inserter(rcs));
+
+  ASSERT_EQ(gold.size(), kmers.size());
+  ASSERT_EQ(gold.size(), rcs.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(gold[i], kmers[i]) << "position " << i;
+    EXPECT_EQ(gold[i].reverse_complement(), rcs[i]) << "position " << i;
+  }
+
+  // forward only
+  std::vector<KmerType> kmers2;
+  Generator()(words.data(), input.size(), std::back_inserter(kmers2));
+  EXPECT_EQ(kmers, kmers2);
+
+  // canonical
+  ::bliss::kmer::transform::lex_less<KmerType> lexless;
+  std::vector<KmerType> canonicals;
+  Generator().canonical(words.data(), input.size(), std::back_inserter(canonicals));
+  ASSERT_EQ(gold.size(), canonicals.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(lexless(gold[i]), canonicals[i]) << "position " << i;
+  }
+}
+
+/**
+ * Test word based k-mer generation from packed words, against the character based iterator
+ */
+TEST(KmerIterator, TestPackedWordKmerGenerator)
+{
+  // test sequence: GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT"
+                         "GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTTacgtaatgc";
+
+  compute_packed_word_kmers<bliss::common::DNA, 21>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 31>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 32>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 33>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 64>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 65>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 31, uint16_t>(input);
+  compute_packed_word_kmers<bliss::common::DNA, 21, uint8_t>(input);
+  compute_packed_word_kmers<bliss::common::DNA16, 15>(input);
+  compute_packed_word_kmers<bliss::common::DNA16, 16>(input);
+  compute_packed_word_kmers<bliss::common::DNA16, 31>(input);
+  compute_packed_word_kmers<bliss::common::DNA16, 31, uint32_t>(input);
+
+  // shorter than k
+  compute_packed_word_kmers<bliss::common::DNA, 31>(input.substr(0, 20));
+
+  static_assert(!bliss::common::PackedWordKmerGenerator<bliss::common::Kmer<21, bliss::common::DNA5> >::supported,
+                "DNA5 chars span words");
+}
+
+
+template<typename Alphabet, int K>
+void compute_valid_packed_word_kmers(std::string input) {
+
+  using KmerType = bliss::common::Kmer<K, Alphabet>;
+  using Encoder = bliss::common::PackedEncoder<Alphabet>;
+  using Generator = bliss::common::PackedWordKmerGenerator<KmerType>;
+
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  // gold:  all kmers, then drop the windows with a non-ACGT char.
+  std::vector<KmerType> all(KmerIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                            KmerIterator(BaseCharIterator(input.cend(), Decoder()), false));
+  std::vector<size_t> gold_pos;
+  for (size_t i = 0; i < all.size(); ++i) {
+    bool valid = true;
+    for (size_t j = i; j < i + K; ++j) valid &= Encoder::is_acgt(input[j]);
+    if (valid) gold_pos.emplace_back(i);
+  }
+
+  std::vector<WordType> words(Encoder::get_word_count(input.size()));
+  std::vector<WordType> ambig(Encoder::get_mask_word_count(input.size()));
+  Encoder::encode(reinterpret_cast<unsigned char const *>(input.data()), input.size(), words.data(), ambig.data());
+
+  std::vector<size_t> pos;
+  std::vector<KmerType> kmers, rcs;
+  Generator::generate_valid(words.data(), ambig.data(), input.size(),
+      [&pos, &kmers, &rcs](size_t const & p, KmerType const & km, KmerType const & rc) {
+    pos.emplace_back(p);
+    kmers.emplace_back(km);
+    rcs.emplace_back(rc);
+  });
+
+  ASSERT_EQ(gold_pos, pos);
+  for (size_t i = 0; i < pos.size(); ++i) {
+    EXPECT_EQ(all[pos[i]], kmers[i]) << "position " << pos[i];
+    EXPECT_EQ(all[pos[i]].reverse_complement(), rcs[i]) << "position " << pos[i];
+  }
+}
+
+/**
+ * Test generating only the k-mers without N from packed words and the non-ACGT mask
+ */
+TEST(KmerIterator, TestPackedWordValidKmerGenerator)
+{
+  // Ns at the start, scattered, in a run, across the 64 char mask word boundary, and at the end.
+  std::string input = "NGATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCNAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT"
+                         "GATTNNNNGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTTacgtaatgN";
+
+  compute_valid_packed_word_kmers<bliss::common::DNA, 5>(input);
+  compute_valid_packed_word_kmers<bliss::common::DNA, 21>(input);
+  compute_valid_packed_word_kmers<bliss::common::DNA, 33>(input);
+  compute_valid_packed_word_kmers<bliss::common::DNA16, 15>(input);
+  compute_valid_packed_word_kmers<bliss::common::DNA16, 31>(input);
+
+  // no N:  same as all kmers.
+  compute_valid_packed_word_kmers<bliss::common::DNA, 31>(input.substr(21, 60));
+}
+
+
+template<typename Alphabet, int K>
+void compute_canonical_kmer_iter(std::string input) {
+
+  using KmerType = bliss::common::Kmer<K, Alphabet>;
+
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+  using CanonicalIterator = bliss::common::CanonicalKmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  std::vector<KmerType> gold(KmerIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                             KmerIterator(BaseCharIterator(input.cend(), Decoder()), false));
+  std::vector<KmerType> canonicals(CanonicalIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                                   CanonicalIterator(BaseCharIterator(input.cend(), Decoder()), false));
+
+  ::bliss::kmer::transform::lex_less<KmerType> lexless;
+  ASSERT_EQ(gold.size(), canonicals.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(lexless(gold[i]), canonicals[i]) << "position " << i;
+  }
+}
+
+/**
+ * Test canonical k-mer generation, against lex_less of the forward k-mers
+ */
+TEST(KmerIterator, TestCanonicalKmerIterator)
+{
+  // test sequence: GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT"
+                         "AAAAACCCCCGGGGGTTTTTACGTACGTNNACGT";
+
+  compute_canonical_kmer_iter<bliss::common::DNA, 21>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA, 32>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA, 33>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA5, 21>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA5, 31>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA16, 17>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA16, 31>(input);
+}
+
+/**
+ * Test bulk fill against the iterator loop, mixed with operator* and operator++.
+ */
+TEST(KmerIterator, TestKmerIteratorFill)
+{
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT";
+
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA>;
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<bliss::common::DNA, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  KmerIterator end(BaseCharIterator(input.cend(), Decoder()), false);
+  std::vector<KmerType> gold(KmerIterator(BaseCharIterator(input.cbegin(), Decoder()), true), end);
+  ASSERT_EQ(input.size() - 21 + 1, gold.size());
+
+  std::vector<KmerType> kmers(gold.size());
+  KmerIterator it(BaseCharIterator(input.cbegin(), Decoder()), true);
+  kmers[0] = *it;
+  ++it;
+  auto out = it.fill(kmers.begin() + 1, 10);
+  kmers[11] = *it;
+  out = it.fill(out, gold.size() - 11);
+
+  EXPECT_TRUE(out == kmers.end());
+  EXPECT_TRUE(it == end);
+  EXPECT_EQ(gold, kmers);
+}
+
+
+template<typename Alphabet, uint64_t PATTERN>
+void compute_spaced_kmer_iter(std::string input) {
+
+  using Seed = bliss::common::spaced_seed<PATTERN>;
+  using KmerType = bliss::common::Kmer<Seed::weight, Alphabet>;
+
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using SpacedIterator = bliss::common::SpacedKmerGenerationIterator<BaseCharIterator, KmerType, Seed>;
+
+  std::vector<KmerType> seeds(SpacedIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                              SpacedIterator(BaseCharIterator(input.cend(), Decoder()), false));
+  ASSERT_EQ(input.size() - Seed::span + 1, seeds.size());
+
+  // gold:  the care characters of each window, the highest pattern bit first.
+  for (size_t i = 0; i < seeds.size(); ++i) {
+    std::string gold;
+    for (unsigned int j = 0; j < Seed::span; ++j)
+      if ((PATTERN >> (Seed::span - 1 - j)) & 0x1) gold.push_back(input[i + j]);
+    std::string seed(bliss::utils::KmerUtils::toASCIIString(seeds[i]));
+    // compare via the alphabet, since the input has lower case and N.
+    KmerType gold_kmer(gold);
+    EXPECT_EQ(gold_kmer, seeds[i]) << "position " << i << " gold " << gold << " seed " << seed;
+  }
+}
+
+/**
+ * Test spaced seed generation, against the care characters of each window.
+ */
+TEST(KmerIterator, TestSpacedKmerIterator)
+{
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT"
+                         "AAAAACCCCCGGGGGTTTTTACGTACGTNNACGT";
+
+  EXPECT_EQ(10U, bliss::common::spaced_seed<0x36DULL>::span);   // 1101101101
+  EXPECT_EQ(7U, bliss::common::spaced_seed<0x36DULL>::weight);
+
+  compute_spaced_kmer_iter<bliss::common::DNA, 0x36DULL>(input);    // 1101101101
+  compute_spaced_kmer_iter<bliss::common::DNA, 0x1ULL>(input);      // span 1
+  compute_spaced_kmer_iter<bliss::common::DNA, 0xFFFFFFFFULL>(input);   // contiguous 32, a full word
+  compute_spaced_kmer_iter<bliss::common::DNA, 0xEFB7DD3F1ULL>(input);   // span 36, 2 words
+  compute_spaced_kmer_iter<bliss::common::DNA5, 0x1B5B5ULL>(input);   // 3 bits per char
+  compute_spaced_kmer_iter<bliss::common::DNA16, 0xB5B5ULL>(input);   // 4 bits per char, full word
+}
+
+
+template<typename Alphabet, int K, unsigned int W>
+void compute_minimizer_sample(std::string input) {
+
+  using KmerType = bliss::common::Kmer<K, Alphabet>;
+  using Sampler = bliss::common::minimizer_sampler<KmerType, W>;
+
+  using BaseIterator = std::string::const_iterator;
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  std::vector<KmerType> kmers(KmerIterator(BaseCharIterator(input.cbegin(), Decoder()), true),
+                              KmerIterator(BaseCharIterator(input.cend(), Decoder()), false));
+  std::vector<KmerType> canonical(kmers.size());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    KmerType rc = kmers[i].reverse_complement();
+    canonical[i] = (rc < kmers[i]) ? rc : kmers[i];
+  }
+
+  Sampler sampler;
+  std::vector<size_t> selected;
+  sampler.select(kmers.begin(), kmers.end(), std::back_inserter(selected));
+  ASSERT_FALSE(selected.empty());
+  EXPECT_TRUE(std::is_sorted(selected.begin(), selected.end()));
+  EXPECT_TRUE(std::adjacent_find(selected.begin(), selected.end()) == selected.end());
+
+  // gold:  the smallest kmer of each window, the rightmost of equal ones.
+  size_t windows = (kmers.size() < W) ? 1 : (kmers.size() - W + 1);
+  for (size_t w = 0; w < windows; ++w) {
+    size_t best = w;
+    for (size_t i = w + 1; i < std::min(kmers.size(), w + W); ++i) {
+      uint64_t o = Sampler::order(canonical[i]), bo = Sampler::order(canonical[best]);
+      if ((o < bo) || ((o == bo) && !(canonical[best] < canonical[i]))) best = i;
+    }
+    EXPECT_TRUE(std::binary_search(selected.begin(), selected.end(), best)) << "window " << w << " minimizer " << best;
+  }
+
+  // about 2/(W+1) of the kmers.
+  if (kmers.size() > 10 * W) {
+    EXPECT_LT(selected.size() * (W + 1), kmers.size() * 3);
+    EXPECT_GE(selected.size() * W, kmers.size() - W + 1);
+  }
+
+  // the reverse complement of the sequence selects the same canonical kmers.
+  std::string rc_input(input.rbegin(), input.rend());
+  for (auto & c : rc_input) c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+  std::vector<KmerType> rc_kmers(KmerIterator(BaseCharIterator(rc_input.cbegin(), Decoder()), true),
+                                 KmerIterator(BaseCharIterator(rc_input.cend(), Decoder()), false));
+  std::vector<size_t> rc_selected;
+  sampler.select(rc_kmers.begin(), rc_kmers.end(), std::back_inserter(rc_selected));
+
+  std::vector<KmerType> fwd_set, rc_set;
+  for (auto const & i : selected) fwd_set.push_back(canonical[i]);
+  for (auto const & i : rc_selected) {
+    KmerType rc = rc_kmers[i].reverse_complement();
+    rc_set.push_back((rc < rc_kmers[i]) ? rc : rc_kmers[i]);
+  }
+  std::sort(fwd_set.begin(), fwd_set.end());
+  fwd_set.erase(std::unique(fwd_set.begin(), fwd_set.end()), fwd_set.end());
+  std::sort(rc_set.begin(), rc_set.end());
+  rc_set.erase(std::unique(rc_set.begin(), rc_set.end()), rc_set.end());
+  EXPECT_EQ(fwd_set, rc_set);
+}
+
+/**
+ * Test minimizer sampling against the smallest kmer of each window.
+ */
+TEST(KmerIterator, TestMinimizerSampler)
+{
+  // pseudo random ACGT, with a low complexity run.
+  std::string input;
+  uint64_t x = 12345;
+  for (size_t i = 0; i < 2000; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    input.push_back("ACGT"[(x >> 33) & 0x3]);
+  }
+  input.append(100, 'A');
+  input.append("GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCC");
+
+  compute_minimizer_sample<bliss::common::DNA, 21, 10>(input);
+  compute_minimizer_sample<bliss::common::DNA, 31, 5>(input);
+  compute_minimizer_sample<bliss::common::DNA, 15, 1>(input);       // every kmer
+  compute_minimizer_sample<bliss::common::DNA, 41, 10>(input);      // 2 words
+  compute_minimizer_sample<bliss::common::DNA, 21, 10>(input.substr(0, 25));   // shorter than 1 window
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_kmer_neighbors.cpp
+ * @ingroup
+ * @brief   test hamming distance and the enumeration of hamming neighbors of kmers.
+ * @details
+ *
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_neighbors.hpp"
+
+
+template <typename T>
+class KmerNeighborsTest : public ::testing::Test {
+  protected:
+
+    std::vector<T> kmers;
+
+    virtual void SetUp()
+    {
+      srand(0);
+      T kmer;
+      for (size_t i = 0; i < 20 + T::size; ++i) {
+        kmer.nextFromChar(rand() % bliss::common::kmer::substitute_count<T>());
+        if (i + 1 >= T::size) kmers.emplace_back(kmer);
+      }
+    }
+
+    /// enumerate, and check that the neighbors are distinct and at distance 1 to d.
+    void check(T const & q, unsigned int const d) {
+      std::vector<T> neighbors;
+      bliss::common::kmer::for_each_hamming_neighbor(q, d, [&neighbors](T const & n) { neighbors.emplace_back(n); });
+      EXPECT_EQ(bliss::common::kmer::hamming_neighborhood_size<T>(d), neighbors.size());
+
+      std::vector<size_t> dist(d + 1, 0);
+      for (auto const & n : neighbors) {
+        unsigned int h = bliss::common::kmer::hamming_distance(q, n);
+        ASSERT_GE(h, 1U);
+        ASSERT_LE(h, d);
+        ++dist[h];
+        // substitutes are valid characters.
+        T x = n;
+        for (unsigned int i = 0; i < T::size; ++i, x = x >> 1)
+          ASSERT_LE(x.getSuffix(T::bitsPerChar), bliss::common::kmer::substitute_count<T>());
+      }
+      EXPECT_EQ(bliss::common::kmer::hamming_neighborhood_size<T>(1), dist.size() > 1 ? dist[1] : 0UL);
+
+      std::sort(neighbors.begin(), neighbors.end());
+      EXPECT_TRUE(std::adjacent_find(neighbors.begin(), neighbors.end()) == neighbors.end());
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(KmerNeighborsTest);
+
+
+TYPED_TEST_P(KmerNeighborsTest, distance)
+{
+  for (size_t i = 1; i < this->kmers.size(); ++i) {
+    TypeParam const & x = this->kmers[i - 1];
+    TypeParam const & y = this->kmers[i];
+    EXPECT_EQ(0U, bliss::common::kmer::hamming_distance(x, x));
+
+    // compare character by character.
+    unsigned int gold = 0;
+    TypeParam a = x, b = y;
+    for (unsigned int j = 0; j < TypeParam::size; ++j, a = a >> 1, b = b >> 1)
+      gold += (a.getSuffix(TypeParam::bitsPerChar) != b.getSuffix(TypeParam::bitsPerChar)) ? 1 : 0;
+    EXPECT_EQ(gold, bliss::common::kmer::hamming_distance(x, y));
+    EXPECT_EQ(gold, bliss::common::kmer::hamming_distance(y, x));
+  }
+}
+
+TYPED_TEST_P(KmerNeighborsTest, enumerate)
+{
+  size_t count = 0;
+  bliss::common::kmer::for_each_hamming_neighbor(this->kmers[0], 0, [&count](TypeParam const &) { ++count; });
+  EXPECT_EQ(0UL, count);
+
+  for (size_t i = 0; i < 4; ++i) {
+    this->check(this->kmers[i], 1);
+    this->check(this->kmers[i], 2);
+  }
+}
+
+TYPED_TEST_P(KmerNeighborsTest, too_far)
+{
+  size_t count = 0;
+  EXPECT_THROW(bliss::common::kmer::for_each_hamming_neighbor(this->kmers[0], 3, [&count](TypeParam const &) { ++count; }),
+               std::invalid_argument);
+  EXPECT_EQ(0UL, count);
+}
+
+
+REGISTER_TYPED_TEST_CASE_P(KmerNeighborsTest, distance, enumerate, too_far);
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer< 31, bliss::common::DNA,   uint64_t>,  // 1 word, not full
+    ::bliss::common::Kmer< 32, bliss::common::DNA,   uint64_t>,  // 1 word, full
+    ::bliss::common::Kmer< 63, bliss::common::DNA,   uint64_t>,  // 2 words, not full
+    ::bliss::common::Kmer< 31, bliss::common::DNA,   uint16_t>,  // 4 words, not full
+    ::bliss::common::Kmer< 21, bliss::common::DNA5,  uint64_t>,  // 3 bits per char
+    ::bliss::common::Kmer< 15, bliss::common::DNA16, uint64_t>   // 4 bits per char
+> KmerNeighborsTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, KmerNeighborsTest, KmerNeighborsTestTypes);
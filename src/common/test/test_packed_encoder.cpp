@@ -0,0 +1,148 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <random>
+
+// include files to test
+#include "common/packed_encoder.hpp"
+#include "common/packed_string.hpp"
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_iterators.hpp"
+
+
+template <typename Alphabet>
+class PackedEncoderTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::string> seqs;
+
+    virtual void SetUp()
+    {
+      seqs = { "", "A", "acgt", "ACGTN", "ACTGGGCCATAATCTCTCATGGATGCTACGAGCTGATCGTAGCTGACTAGTCGA",
+               "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAACTCTGCTCNNNNNNNNATCGATCGATCGATCGATCGACTAGCTAGCTACGTACGTACGTACGATCGATCG",
+               "acgtRYKMSWBDHVNacgt-actg.ACGTacgtACGTacgtACGTacgtACGTacgtxXnNuU" };
+
+      // random reads with some lower case, ambiguous, gap, and out of range chars.
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> base(0, 3);
+      std::uniform_int_distribution<int> other(0, 255);
+      std::uniform_int_distribution<int> choice(0, 99);
+      const char acgt[] = "ACGT";
+      for (size_t len = 1; len < 300; len += 7) {
+        std::string s;
+        for (size_t i = 0; i < len; ++i) {
+          int ch = choice(generator);
+          if (ch < 85) s.push_back(acgt[base(generator)]);
+          else if (ch < 92) s.push_back(acgt[base(generator)] | 0x20);
+          else if (ch < 97) s.push_back('N');
+          else s.push_back(static_cast<char>(other(generator)));
+        }
+        seqs.push_back(s);
+      }
+    }
+};
+
+TYPED_TEST_CASE_P(PackedEncoderTest);
+
+/// encoded words and non-ACGT mask are the same as translating with ASCII2 and packing with PackedStringImpl
+TYPED_TEST_P(PackedEncoderTest, same_as_packed_string)
+{
+  using Encoder = ::bliss::common::PackedEncoder<TypeParam>;
+  using PackedStringType = typename ::bliss::common::AlphabetTraits<TypeParam>::PackedStringType;
+
+  ::bliss::common::ASCII2<TypeParam> ascii2;
+
+  for (auto const & s : this->seqs) {
+    std::vector<uint8_t> chars;
+    for (auto c : s) chars.push_back(ascii2(c));
+    PackedStringType gold(chars);
+
+    std::vector<WordType> words(Encoder::get_word_count(s.size()), 0xFFFFFFFFFFFFFFFFUL);
+    std::vector<WordType> mask(Encoder::get_mask_word_count(s.size()), 0xFFFFFFFFFFFFFFFFUL);
+    Encoder::encode(reinterpret_cast<unsigned char const *>(s.data()), s.size(), words.data(), mask.data());
+
+    ASSERT_EQ(gold.getPackedWords(), words) << "sequence: " << s;
+
+    for (size_t i = 0; i < s.size(); ++i) {
+      bool ambig = (mask[i / 64] >> (i % 64)) & 0x1;
+      ASSERT_EQ(!Encoder::is_acgt(s[i]), ambig) << "position " << i << " sequence: " << s;
+    }
+  }
+}
+
+/// all 256 characters, and unaligned starting positions.
+TYPED_TEST_P(PackedEncoderTest, all_chars)
+{
+  using Encoder = ::bliss::common::PackedEncoder<TypeParam>;
+
+  std::vector<unsigned char> s;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 256; ++c) s.push_back(c);
+    for (int c = 0x40; c < 0x80; ++c) s.push_back(c);
+  }
+
+  for (size_t offset = 0; offset < 33; ++offset) {
+    size_t len = s.size() - offset;
+    std::vector<WordType> words(Encoder::get_word_count(len));
+    Encoder::encode(s.data() + offset, len, words.data());
+
+    for (size_t i = 0; i < len; ++i) {
+      WordType v = (words[i / Encoder::chars_per_word] >> ((i % Encoder::chars_per_word) * Encoder::bits_per_char)) &
+          getCharBitMask(Encoder::bits_per_char);
+      ASSERT_EQ(TypeParam::FROM_ASCII[s[i + offset]], v) << "offset " << offset << " position " << i;
+    }
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(PackedEncoderTest, same_as_packed_string, all_chars);
+
+typedef ::testing::Types<::bliss::common::DNA, ::bliss::common::DNA5, ::bliss::common::DNA16> PackedEncoderTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PackedEncoderTest, PackedEncoderTestTypes);
+
+
+/// the encoded words can be used directly for k-mer generation.
+TEST(PackedEncoderKmerTest, kmers)
+{
+  using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+  using Encoder = ::bliss::common::PackedEncoder<::bliss::common::DNA>;
+
+  std::string s = "ACTGGGCCATAATCTCTCATGGATGCTACGAGCTGATCGTAGCTGACTAGTCGAACGATCGATCGTACGTACGTACGTACGTAGCTAGCTAGCTAGCATCGA";
+
+  std::vector<WordType> words(Encoder::get_word_count(s.size()));
+  Encoder::encode(reinterpret_cast<unsigned char const *>(s.data()), s.size(), words.data());
+
+  ::bliss::common::PackedKmerGenerationIterator<WordType const *, KmerType> it(words.data());
+  ::bliss::common::PackedKmerGenerationIterator<WordType const *, KmerType> end(words.data(), s.size());
+
+  std::vector<uint8_t> chars;
+  for (auto c : s) chars.push_back(::bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(c)]);
+
+  size_t i = 0;
+  for (; it != end; ++it, ++i) {
+    KmerType gold;
+    auto cit = chars.begin() + i;
+    gold.fillFromChars(cit);
+    ASSERT_EQ(gold, *it) << "position " << i;
+  }
+  ASSERT_EQ(s.size() - KmerType::size + 1, i);
+}
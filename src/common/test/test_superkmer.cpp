@@ -0,0 +1,138 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_superkmer.cpp
+ * @ingroup
+ * @brief   test packing and unpacking of super-kmers.
+ * @details
+ *
+ */
+
+#include "utils/logging.h"
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <random>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "common/superkmer.hpp"
+
+
+template <typename T>
+class SuperKmerTest : public ::testing::Test {
+  protected:
+
+    std::vector<T> kmers;
+
+    static const size_t read_len = 150;
+    static const size_t reads = 200;
+
+    virtual void SetUp()
+    {
+      srand(0);
+      T kmer;
+
+      // kmers of reads, in sequence order.
+      for (size_t r = 0; r < reads; ++r) {
+        for (size_t i = 0; i < read_len; ++i) {
+          kmer.nextFromChar(rand() % T::KmerAlphabet::SIZE);
+          if (i + 1 >= T::size) kmers.emplace_back(kmer);
+        }
+      }
+    }
+
+    /// pack with the given rank assignment, then unpack per rank and compare to the kmers with that rank.
+    template <typename ToRank>
+    size_t pack_unpack(ToRank const & to_rank, int const p) {
+      std::vector<int> ranks(kmers.size());
+      std::transform(kmers.begin(), kmers.end(), ranks.begin(), to_rank);
+
+      std::vector<size_t> send_counts;
+      std::vector<uint8_t> buffer;
+      bliss::kmer::superkmer::pack(kmers, ranks, p, send_counts, buffer);
+
+      EXPECT_EQ(static_cast<size_t>(p), send_counts.size());
+
+      size_t offset = 0;
+      size_t total = 0;
+      for (int r = 0; r < p; ++r) {
+        std::vector<T> gold;
+        for (size_t i = 0; i < kmers.size(); ++i) {
+          if (ranks[i] == r) gold.emplace_back(kmers[i]);
+        }
+
+        std::vector<T> result;
+        size_t n = bliss::kmer::superkmer::unpack(buffer.data() + offset, buffer.data() + offset + send_counts[r], result);
+        offset += send_counts[r];
+        total += n;
+
+        EXPECT_EQ(gold.size(), n);
+        EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+      }
+      EXPECT_EQ(buffer.size(), offset);
+      EXPECT_EQ(kmers.size(), total);
+
+      return buffer.size();
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(SuperKmerTest);
+
+
+TYPED_TEST_P(SuperKmerTest, roundtrip)
+{
+  // all to 1 rank:  1 super-kmer per read.
+  size_t bytes = this->pack_unpack([](TypeParam const &) { return 0; }, 1);
+  EXPECT_EQ(this->reads * bliss::kmer::superkmer::packed_bytes<TypeParam>(this->read_len - TypeParam::size + 1), bytes);
+
+  // each kmer to a different rank than its predecessor: no runs.
+  bytes = this->pack_unpack([](TypeParam const & x) { return static_cast<int>(x.getSuffix(TypeParam::bitsPerChar) % 3); }, 3);
+
+  // minimizer based rank assignment.
+  bliss::kmer::transform::default_minimizer<TypeParam> minimizer;
+  bytes = this->pack_unpack([&minimizer](TypeParam const & x) {
+    return static_cast<int>(bliss::kmer::transform::default_minimizer<TypeParam>::order(minimizer(x).getSuffix(64)) % 16);
+  }, 16);
+
+  // several times fewer bytes than sending each kmer, when minimizers are shorter than kmers.
+  if (TypeParam::size > 20) {
+    EXPECT_LT(bytes * 2, this->kmers.size() * sizeof(TypeParam));
+  }
+}
+
+
+REGISTER_TYPED_TEST_CASE_P(SuperKmerTest, roundtrip);
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer< 31, bliss::common::DNA,   uint64_t>,  // 1 word, not full
+    ::bliss::common::Kmer< 32, bliss::common::DNA,   uint64_t>,  // 1 word, full
+    ::bliss::common::Kmer< 63, bliss::common::DNA,   uint64_t>,  // 2 words, not full
+    ::bliss::common::Kmer< 31, bliss::common::DNA,   uint16_t>,  // 4 words, not full
+    ::bliss::common::Kmer< 21, bliss::common::DNA5,  uint64_t>,  // 3 bits per char
+    ::bliss::common::Kmer< 31, bliss::common::DNA16, uint64_t>,  // 4 bits per char
+    ::bliss::common::Kmer<  9, bliss::common::DNA,    uint8_t>   // minimizer is the whole kmer
+> SuperKmerTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, SuperKmerTest, SuperKmerTestTypes);
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_translation.cpp
+ * @ingroup
+ * @brief   tests the codon table and the six frame peptide kmers against translating each window as a string.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "common/translation.hpp"
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer.hpp"
+#include "utils/kmer_utils.hpp"
+
+
+/// reference translation of a codon string, by the codon's ascii letters.
+static char translate_codon(std::string const & codon) {
+  const std::string bases("TCAG");
+  const std::string aas("FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG");
+  size_t i = bases.find(codon[0]) * 16 + bases.find(codon[1]) * 4 + bases.find(codon[2]);
+  return aas[i];
+}
+
+static std::string reverse_complement(std::string const & s) {
+  std::string out(s.rbegin(), s.rend());
+  for (auto & c : out) {
+    c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+  }
+  return out;
+}
+
+static std::string translate(std::string const & s) {
+  std::string out;
+  for (size_t i = 0; i + 3 <= s.size(); i += 3) out.push_back(translate_codon(s.substr(i, 3)));
+  return out;
+}
+
+/// six frame peptides of all windows, forward before reverse.
+static std::vector<std::string> reference(std::string const & seq, size_t const & k) {
+  std::vector<std::string> out;
+  if (seq.size() < 3 * k) return out;
+  for (size_t p = 0; p + 3 * k <= seq.size(); ++p) {
+    std::string w = seq.substr(p, 3 * k);
+    if (w.find_first_not_of("ACGT") != std::string::npos) continue;
+    std::string f = translate(w);
+    if (f.find('*') == std::string::npos) out.push_back(f);
+    std::string r = translate(reverse_complement(w));
+    if (r.find('*') == std::string::npos) out.push_back(r);
+  }
+  return out;
+}
+
+
+TEST(TranslationTest, alphabet)
+{
+  using AA = bliss::common::AA;
+  EXPECT_EQ(5U, bliss::common::AlphabetTraits<AA>::getBitsPerChar());
+  const std::string letters("ACDEFGHIKLMNPQRSTVWY*X");
+  for (size_t i = 0; i < letters.size(); ++i) {
+    EXPECT_EQ(i, AA::FROM_ASCII[static_cast<unsigned char>(letters[i])]);
+    EXPECT_EQ(letters[i], AA::TO_ASCII[i]);
+  }
+  EXPECT_EQ(AA::FROM_ASCII['m'], AA::FROM_ASCII['M']);
+  EXPECT_EQ(AA::UNKNOWN, AA::FROM_ASCII['B']);
+}
+
+TEST(TranslationTest, codon_table)
+{
+  using AA = bliss::common::AA;
+  const std::string bases("ACGT");
+  for (uint8_t c = 0; c < 64; ++c) {
+    std::string codon;
+    codon.push_back(bases[c >> 4]);
+    codon.push_back(bases[(c >> 2) & 0x3]);
+    codon.push_back(bases[c & 0x3]);
+    EXPECT_EQ(translate_codon(codon), AA::TO_ASCII[bliss::common::CodonTable::translate(c)]) << codon;
+    EXPECT_EQ(translate_codon(reverse_complement(codon)),
+              AA::TO_ASCII[bliss::common::CodonTable::translate(bliss::common::CodonTable::reverse_complement(c))]) << codon;
+  }
+}
+
+template <typename KmerType>
+void check_six_frames(std::vector<std::string> const & seqs) {
+  bliss::common::SixFrameKmerGenerator<KmerType> gen;
+  for (auto const & s : seqs) {
+    std::vector<KmerType> kmers;
+    gen(reinterpret_cast<unsigned char const *>(s.data()), s.size(), std::back_inserter(kmers));
+
+    std::vector<std::string> gold = reference(s, KmerType::size);
+    ASSERT_EQ(gold.size(), kmers.size()) << s;
+    for (size_t i = 0; i < gold.size(); ++i) {
+      EXPECT_EQ(gold[i], bliss::utils::KmerUtils::toASCIIString(kmers[i])) << s << " " << i;
+      EXPECT_TRUE(kmers[i] == KmerType(gold[i]));
+    }
+  }
+}
+
+TEST(TranslationTest, six_frames)
+{
+  std::vector<std::string> seqs = { "", "ACG", "ATGGCC", "ATGGCCATTGTAATGGGCCGCTGAAAGGGTGCCCGATAG",
+                                    "ATGAAACCCNGGGTTTAAAGGGCCCTTTAAACCCGGGATGCATGCATGCATGC" };
+  std::default_random_engine generator(7);
+  std::uniform_int_distribution<int> base(0, 99);
+  const char acgt[] = "ACGT";
+  for (size_t len = 1; len < 400; len += 13) {
+    std::string s;
+    for (size_t i = 0; i < len; ++i) {
+      int b = base(generator);
+      s.push_back((b < 98) ? acgt[b % 4] : 'N');
+    }
+    seqs.push_back(s);
+  }
+
+  check_six_frames<bliss::common::Kmer<5, bliss::common::AA, uint64_t> >(seqs);
+  check_six_frames<bliss::common::Kmer<12, bliss::common::AA, uint64_t> >(seqs);
+  // multiple words.
+  check_six_frames<bliss::common::Kmer<15, bliss::common::AA, uint16_t> >(seqs);
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    translation.hpp
+ * @ingroup common
+ * @brief   six frame translation of DNA into amino acid (AA) kmers, without an intermediate protein sequence.
+ * @details  the read is packed into 2 bit DNA words with PackedEncoder, which also marks the non-ACGT characters.  the
+ *          6 bit codon ending at each position is kept in a rolling register, and translated by a 64 entry table.  the
+ *          reverse strand amino acid is the table entry of the codon's reverse complement.
+ *
+ *          each of the 3 codon phases has a forward and a reverse peptide kmer.  a new codon is appended to the forward
+ *          kmer and prepended to the reverse kmer, so both slide with 1 shift.  a window of 3k bases gives 1 forward and
+ *          1 reverse kmer, and all window starts together cover the 6 frames.  windows with a non-ACGT base, and peptides
+ *          with a stop codon, are skipped.
+ */
+#ifndef SRC_COMMON_TRANSLATION_HPP_
+#define SRC_COMMON_TRANSLATION_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/packed_encoder.hpp"
+
+namespace bliss {
+
+  namespace common {
+
+    /**
+     * @brief standard genetic code (NCBI table 1), from a 6 bit codon of DNA values (A=0, C=1, G=2, T=3, first base in
+     *        the high bits) to AA values.
+     */
+    template <typename DUMMY = void>
+    struct CodonTable_T {
+        static constexpr std::array<uint8_t, 64> STANDARD =
+        {{
+           8, 11,  8, 11,   // AAA=K AAC=N AAG=K AAT=N
+          16, 16, 16, 16,   // ACA=T ACC=T ACG=T ACT=T
+          14, 15, 14, 15,   // AGA=R AGC=S AGG=R AGT=S
+           7,  7, 10,  7,   // ATA=I ATC=I ATG=M ATT=I
+          13,  6, 13,  6,   // CAA=Q CAC=H CAG=Q CAT=H
+          12, 12, 12, 12,   // CCA=P CCC=P CCG=P CCT=P
+          14, 14, 14, 14,   // CGA=R CGC=R CGG=R CGT=R
+           9,  9,  9,  9,   // CTA=L CTC=L CTG=L CTT=L
+           3,  2,  3,  2,   // GAA=E GAC=D GAG=E GAT=D
+           0,  0,  0,  0,   // GCA=A GCC=A GCG=A GCT=A
+           5,  5,  5,  5,   // GGA=G GGC=G GGG=G GGT=G
+          17, 17, 17, 17,   // GTA=V GTC=V GTG=V GTT=V
+          20, 19, 20, 19,   // TAA=* TAC=Y TAG=* TAT=Y
+          15, 15, 15, 15,   // TCA=S TCC=S TCG=S TCT=S
+          20,  1, 18,  1,   // TGA=* TGC=C TGG=W TGT=C
+           9,  4,  9,  4    // TTA=L TTC=F TTG=L TTT=F
+        }};
+
+        /// amino acid of a codon.
+        static inline uint8_t translate(uint8_t const & codon) {
+          return STANDARD[codon];
+        }
+
+        /// reverse complement of a codon:  complement the bases, and swap the first and last.
+        static inline uint8_t reverse_complement(uint8_t const & codon) {
+          uint8_t c = (~codon) & 0x3F;
+          return ((c & 0x3) << 4) | (c & 0xC) | (c >> 4);
+        }
+    };
+    template <typename DUMMY>
+    constexpr std::array<uint8_t, 64> CodonTable_T<DUMMY>::STANDARD;
+
+    using CodonTable = CodonTable_T<>;
+
+
+    /**
+     * @brief generates the six frame peptide kmers of a DNA sequence.
+     * @details  for window start p, the forward kmer translates bases [p, p + 3k), and the reverse kmer translates their
+     *        reverse complement.  output is in the order of p, forward before reverse.
+     * @tparam KmerType  kmer of the AA alphabet.
+     */
+    template <typename KmerType>
+    class SixFrameKmerGenerator {
+        static_assert(::std::is_same<typename KmerType::KmerAlphabet, ::bliss::common::AA>::value,
+                      "six frame translation generates kmers of the AA alphabet.");
+
+      public:
+        /// bases per peptide kmer.
+        static constexpr size_t window_size = 3 * KmerType::size;
+
+      protected:
+        using encoder_type = ::bliss::common::PackedEncoder<::bliss::common::DNA>;
+
+        /// packed bases and non-ACGT mask of the current sequence.  reused between sequences.
+        ::std::vector<WordType> words;
+        ::std::vector<WordType> ambig;
+
+      public:
+        /**
+         * @brief call f(p, kmer, reverse) for each peptide kmer of the ASCII sequence, in the order of window start p.
+         * @param ptr  characters, without EOL.
+         */
+        template <typename Func>
+        void generate(unsigned char const * ptr, size_t const & len, Func const & f) {
+          if (len < window_size) return;
+
+          words.resize(encoder_type::get_word_count(len));
+          ambig.resize(encoder_type::get_mask_word_count(len));
+          encoder_type::encode(ptr, len, words.data(), ambig.data());
+
+          KmerType fwd[3], rev[3];
+          size_t frun[3] = {0, 0, 0};
+          size_t rrun[3] = {0, 0, 0};
+
+          uint8_t codon = 0;
+          size_t valid = 0;   // consecutive ACGT bases ending at i.
+          uint8_t aa;
+          for (size_t i = 0; i < len; ++i) {
+            codon = ((codon << 2) | ((words[i / encoder_type::chars_per_word] >>
+                ((i % encoder_type::chars_per_word) * encoder_type::bits_per_char)) & 0x3)) & 0x3F;
+            if ((ambig[i / encoder_type::chars_per_mask_word] >> (i % encoder_type::chars_per_mask_word)) & 0x1) valid = 0;
+            else ++valid;
+
+            if (i < 2) continue;
+            size_t ph = (i - 2) % 3;
+
+            if (valid < 3) {
+              frun[ph] = 0;
+              rrun[ph] = 0;
+              continue;
+            }
+
+            aa = CodonTable::translate(codon);
+            fwd[ph].nextFromChar(aa);
+            frun[ph] = (aa == ::bliss::common::AA::STOP) ? 0 : frun[ph] + 1;
+
+            aa = CodonTable::translate(CodonTable::reverse_complement(codon));
+            rev[ph].nextReverseFromChar(aa);
+            rrun[ph] = (aa == ::bliss::common::AA::STOP) ? 0 : rrun[ph] + 1;
+
+            if (frun[ph] >= KmerType::size) f(i + 1 - window_size, fwd[ph], false);
+            if (rrun[ph] >= KmerType::size) f(i + 1 - window_size, rev[ph], true);
+          }
+        }
+
+        /// peptide kmers of the ASCII sequence, forward and reverse, in the order of window start.
+        template <typename OutputIt>
+        OutputIt operator()(unsigned char const * ptr, size_t const & len, OutputIt output_iter) {
+          generate(ptr, len, [&output_iter](size_t const &, KmerType const & km, bool const &) {
+            *output_iter = km;
+            ++output_iter;
+          });
+          return output_iter;
+        }
+    };
+
+    template <typename KmerType>
+    constexpr size_t SixFrameKmerGenerator<KmerType>::window_size;
+
+  } // namespace common
+} // namespace bliss
+
+#endif // SRC_COMMON_TRANSLATION_HPP_
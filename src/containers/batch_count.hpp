@@ -0,0 +1,78 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    batch_count.hpp
+ * @ingroup fsc::containers
+ * @brief   batch counting of received keys:  sort, then collapse equal keys into (key, count) runs.
+ * @details  the local phase of a counting insert is either hash, probe and increment per key, or count the whole received
+ *          batch first and merge the runs into the table, so that each distinct key is probed once.  the second form is a
+ *          self contained kernel on 1 buffer (radix sort plus run length encoding), which is the unit that an accelerator
+ *          backend would replace:  copy the batch in, sort and reduce there, copy the runs back.
+ *
+ *          batch_count_backend selects the form.  only HASH and SORT (host radix sort, with OpenMP threads) are provided.
+ */
+#ifndef BATCH_COUNT_HPP_
+#define BATCH_COUNT_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <type_traits>
+
+#include "common/kmer.hpp"
+#include "containers/radix_sort.hpp"
+
+namespace fsc {  // fast standard container
+
+  /// local counting backend of the counting maps' insert.
+  enum class batch_count_backend : int {
+    HASH = 0,   ///< probe the local table once per received key.
+    SORT = 1    ///< radix sort the batch, then probe once per distinct key.  Kmer keys only.
+  };
+
+  /**
+   * @brief count a batch of Kmer keys.  keys are sorted in place, and the runs of equal keys appended to counts.
+   * @details  keys are ordered and compared after trans, e.g. the storage transform of a map, so k-mers that the map
+   *        considers equal, such as a k-mer and its reverse complement with lex_less, are counted together.  each run
+   *        keeps its first key.  counts are in the order of the transformed keys.
+   * @param equal  equality of keys, consistent with trans, e.g. the map's transformed equal.
+   */
+  template <typename Key, typename T, typename Transform, typename Equal>
+  void sort_count(::std::vector<Key> & keys, ::std::vector<::std::pair<Key, T> > & counts,
+                  Transform const & trans, Equal const & equal, int nthreads = 0) {
+    static_assert(::bliss::common::is_kmer<Key>::value, "sort_count requires Kmer keys");
+
+    if (keys.empty()) return;
+    ::fsc::radix_sort(keys, trans, nthreads);
+
+    counts.reserve(counts.size() + keys.size() / 2);
+    auto run = keys.begin();
+    T count = 1;
+    for (auto it = run + 1; it != keys.end(); ++it) {
+      if (equal(*it, *run)) {
+        ++count;
+      } else {
+        counts.emplace_back(*run, count);
+        run = it;
+        count = 1;
+      }
+    }
+    counts.emplace_back(*run, count);
+  }
+
+} // namespace fsc
+
+#endif /* BATCH_COUNT_HPP_ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bloom_filter.hpp
+ * @ingroup fsc::containers
+ * @brief   cache blocked bloom filter.
+ * @details all k bits of a key are in one 512 bit block (1 cache line), so a test or set touches 1 cache line.  the block is
+ *          chosen by the hash value, and the bits within the block by double hashing on a second mix of the hash value.
+ *          blocking raises the false positive rate slightly over a standard bloom filter of the same size.
+ *
+ *          used by the counting maps to keep singleton k-mers out of the hash table:  keys are distributed by rank, so each
+ *          rank's local filter covers only the keys it owns, and the filters together form a distributed filter.
+ */
+#ifndef BLOOM_FILTER_HPP_
+#define BLOOM_FILTER_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief blocked bloom filter over keys.
+   * @tparam Hash   hash functor on Key, returning a 64 bit value.  weak hashes are mixed before use.
+   */
+  template <typename Key, typename Hash>
+  class bloom_filter {
+
+    protected:
+      static constexpr size_t block_bits = 512;
+      static constexpr size_t block_words = block_bits / 64;
+
+      Hash hash;
+      ::std::vector<uint64_t> bits;
+      size_t n_blocks;
+      uint8_t k;
+
+      /// murmur3 64 bit finalizer.
+      static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+      }
+
+    public:
+      /// create a filter for expected number of keys and target false positive rate.  expected = 0 does not allocate.
+      bloom_filter(size_t const & expected = 0, double const & fp_rate = 0.01) : n_blocks(0), k(1) {
+        resize(expected, fp_rate);
+      }
+
+      /// reallocate for expected number of keys and target false positive rate.  clears the filter.
+      void resize(size_t const & expected, double const & fp_rate = 0.01) {
+        if (expected == 0) {
+          reset();
+          return;
+        }
+        double m = -static_cast<double>(expected) * ::std::log(fp_rate) / (::std::log(2.0) * ::std::log(2.0));
+        n_blocks = ::std::max(static_cast<size_t>(1), static_cast<size_t>(::std::ceil(m / static_cast<double>(block_bits))));
+        k = static_cast<uint8_t>(::std::min(16.0, ::std::max(1.0, ::std::round(::std::log(2.0) * m / static_cast<double>(expected)))));
+        bits.assign(n_blocks * block_words, 0);
+      }
+
+      /// true if the filter has not been allocated.
+      bool empty() const {
+        return n_blocks == 0;
+      }
+
+      /// unset all bits.
+      void clear() {
+        ::std::fill(bits.begin(), bits.end(), 0);
+      }
+
+      /// release the memory
+      void reset() {
+        ::std::vector<uint64_t>().swap(bits);
+        n_blocks = 0;
+        k = 1;
+      }
+
+      /// size in bits
+      size_t size() const {
+        return n_blocks * block_bits;
+      }
+
+      uint8_t get_hash_count() const {
+        return k;
+      }
+
+      /// set the bits for key.  returns true if all were already set, i.e. the key was (probably) seen before.
+      bool test_and_set(Key const & key) {
+        uint64_t h = mix(hash(key));
+        uint64_t * block = bits.data() + (h % n_blocks) * block_words;
+        h = mix(h);
+        uint64_t a = h & (block_bits - 1);
+        uint64_t b = (h >> 9) | 1;
+
+        bool seen = true;
+        uint64_t pos, bit;
+        for (uint8_t i = 0; i < k; ++i) {
+          pos = (a + i * b) & (block_bits - 1);
+          bit = 1ULL << (pos & 63);
+          seen &= ((block[pos >> 6] & bit) != 0);
+          block[pos >> 6] |= bit;
+        }
+        return seen;
+      }
+
+      /// true if the key is (probably) in the filter.
+      bool contains(Key const & key) const {
+        uint64_t h = mix(hash(key));
+        uint64_t const * block = bits.data() + (h % n_blocks) * block_words;
+        h = mix(h);
+        uint64_t a = h & (block_bits - 1);
+        uint64_t b = (h >> 9) | 1;
+
+        uint64_t pos;
+        for (uint8_t i = 0; i < k; ++i) {
+          pos = (a + i * b) & (block_bits - 1);
+          if ((block[pos >> 6] & (1ULL << (pos & 63))) == 0) return false;
+        }
+        return true;
+      }
+  };
+
+  template <typename Key, typename Hash>
+  constexpr size_t bloom_filter<Key, Hash>::block_bits;
+  template <typename Key, typename Hash>
+  constexpr size_t bloom_filter<Key, Hash>::block_words;
+
+} // namespace fsc
+
+#endif /* BLOOM_FILTER_HPP_ */
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bucket_table.hpp
+ * @ingroup dsc::containers
+ * @brief   assignment of a fixed number of virtual buckets to ranks, for the hash distributed maps.
+ * @details  a key hashes to 1 of 2^16 buckets, independent of the number of processes, and the table gives the rank of
+ *          each bucket.  the default table gives each rank a contiguous range of buckets.  remap() assigns the buckets to a
+ *          different number of ranks, and keeps each bucket on its rank up to the rank's new share, so only the buckets of
+ *          removed ranks, or of ranks over their share, move.
+ *
+ *          a rank's share is within 1 bucket of 2^16 / p, so the imbalance from the table is at most p / 2^16.
+ *
+ *          for ranks of different speed or memory, weighted() and remap(weights) give each rank a share proportional to
+ *          its weight instead, e.g. from bliss::partition::rank_weights.
+ *
+ *          when the keys are not spread evenly over the buckets, balanced() gives each rank a share of the bucket loads
+ *          instead of the bucket count.  see dsc::balance_buckets.
+ */
+#ifndef BUCKET_TABLE_HPP_
+#define BUCKET_TABLE_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>  // min
+#include <cmath>    // floor
+
+namespace dsc  // distributed std container
+{
+
+  class bucket_table {
+    public:
+      /// number of bits of the bucket index.
+      static constexpr unsigned int bits = 16;
+      static constexpr size_t nbuckets = 1UL << bits;
+
+    protected:
+      /// rank of each bucket.
+      ::std::vector<uint32_t> ranks;
+      int p;
+
+    public:
+      /// contiguous ranges of buckets for comm_size ranks.
+      explicit bucket_table(int const & comm_size = 1) : ranks(nbuckets), p(comm_size) {
+        if (comm_size < 1) throw ::std::invalid_argument("bucket_table: comm_size has to be positive.");
+        for (size_t b = 0; b < nbuckets; ++b)
+          ranks[b] = static_cast<uint32_t>((b * static_cast<size_t>(p)) >> bits);
+      }
+
+      /// table from the rank of each bucket.  all ranks have to be in [0, comm_size).
+      bucket_table(::std::vector<uint32_t> const & _ranks, int const & comm_size) : ranks(_ranks), p(comm_size) {
+        if (ranks.size() != nbuckets) throw ::std::invalid_argument("bucket_table: need 1 rank per bucket.");
+        for (auto r : ranks)
+          if (static_cast<int>(r) >= p) throw ::std::invalid_argument("bucket_table: rank out of range.");
+      }
+
+      inline int operator[](size_t const & bucket) const { return ranks[bucket]; }
+
+      int comm_size() const { return p; }
+      ::std::vector<uint32_t> const & get_ranks() const { return ranks; }
+
+      /// number of buckets of each rank.
+      ::std::vector<size_t> shares() const {
+        ::std::vector<size_t> result(p, 0);
+        for (auto r : ranks) ++result[r];
+        return result;
+      }
+
+      /// share of each rank, proportional to the weights.  the shares are the differences of the floored prefix sums.
+      static ::std::vector<size_t> weighted_shares(::std::vector<double> const & weights) {
+        if (weights.empty()) throw ::std::invalid_argument("bucket_table: need 1 weight per rank.");
+        double total = 0;
+        for (auto w : weights) {
+          if (!(w > 0)) throw ::std::invalid_argument("bucket_table: weights have to be positive.");
+          total += w;
+        }
+        size_t const n = nbuckets;
+        ::std::vector<size_t> result(weights.size());
+        double prefix = 0;
+        size_t last = 0;
+        for (size_t r = 0; r < weights.size(); ++r) {
+          prefix += weights[r];
+          size_t next = (r + 1 == weights.size()) ? n :
+              ::std::min(n, static_cast<size_t>(::std::floor(static_cast<double>(n) * (prefix / total))));
+          result[r] = next - last;
+          last = next;
+        }
+        return result;
+      }
+
+      /// contiguous ranges of buckets, with a share proportional to each rank's weight.
+      static bucket_table weighted(::std::vector<double> const & weights) {
+        ::std::vector<size_t> quota = weighted_shares(weights);
+        ::std::vector<uint32_t> result(nbuckets);
+        size_t b = 0;
+        for (size_t r = 0; r < quota.size(); ++r)
+          for (size_t i = 0; i < quota[r]; ++i, ++b) result[b] = static_cast<uint32_t>(r);
+        return bucket_table(result, static_cast<int>(weights.size()));
+      }
+
+      /**
+       * @brief contiguous ranges of buckets with about equal load, or a load proportional to each rank's weight.
+       * @details  a bucket goes to the first rank whose share of the total load ends after the middle of the bucket's load,
+       *        in bucket order.  buckets are not split, so a bucket with more than a share stays on 1 rank.
+       * @param loads      load of each bucket, e.g. sampled entry counts.  nbuckets entries.
+       * @param comm_size  number of ranks.
+       * @param weights    1 positive weight per rank, or empty for equal shares.
+       */
+      static bucket_table balanced(::std::vector<size_t> const & loads, int const & comm_size,
+                                   ::std::vector<double> const & weights = ::std::vector<double>()) {
+        if (loads.size() != nbuckets) throw ::std::invalid_argument("bucket_table: need 1 load per bucket.");
+        if (!weights.empty() && (weights.size() != static_cast<size_t>(comm_size)))
+          throw ::std::invalid_argument("bucket_table: need 1 weight per rank.");
+
+        double total = 0;
+        for (auto l : loads) total += static_cast<double>(l);
+        if (total == 0) return weights.empty() ? bucket_table(comm_size) : weighted(weights);
+
+        // end of each rank's share of the load.
+        ::std::vector<double> ends(comm_size);
+        double wsum = 0;
+        for (int r = 0; r < comm_size; ++r) wsum += weights.empty() ? 1.0 : weights[r];
+        double prefix = 0;
+        for (int r = 0; r < comm_size; ++r) {
+          prefix += weights.empty() ? 1.0 : weights[r];
+          ends[r] = total * (prefix / wsum);
+        }
+
+        ::std::vector<uint32_t> result(nbuckets);
+        double before = 0;
+        int r = 0;
+        for (size_t b = 0; b < nbuckets; ++b) {
+          while ((r + 1 < comm_size) && ((before + 0.5 * static_cast<double>(loads[b])) >= ends[r])) ++r;
+          result[b] = static_cast<uint32_t>(r);
+          before += static_cast<double>(loads[b]);
+        }
+        return bucket_table(result, comm_size);
+      }
+
+      /**
+       * @brief ratio of the largest load of a rank to the mean, for the load of each bucket.  per weight, if weights are given.
+       */
+      double imbalance(::std::vector<size_t> const & loads, ::std::vector<double> const & weights = ::std::vector<double>()) const {
+        ::std::vector<double> per_rank(p, 0);
+        double total = 0;
+        for (size_t b = 0; b < nbuckets; ++b) {
+          per_rank[ranks[b]] += static_cast<double>(loads[b]);
+          total += static_cast<double>(loads[b]);
+        }
+        if (total == 0) return 1.0;
+
+        double wsum = 0, largest = 0;
+        for (int r = 0; r < p; ++r) {
+          double w = weights.empty() ? 1.0 : weights[r];
+          wsum += w;
+          largest = ::std::max(largest, per_rank[r] / w);
+        }
+        return largest / (total / wsum);
+      }
+
+      /**
+       * @brief the table for new_p ranks that moves the fewest buckets.
+       * @details  each rank gets nbuckets / new_p buckets, and nbuckets % new_p ranks get 1 more, preferring the ranks that
+       *        have more already.  a rank keeps its buckets in index order up to its share.  the rest go to the ranks under
+       *        their share, in rank order.
+       */
+      bucket_table remap(int const & new_p) const {
+        if (new_p < 1) throw ::std::invalid_argument("bucket_table: comm_size has to be positive.");
+
+        // the extra buckets go to the ranks that have more than the base share already, so they do not move.
+        size_t const base = nbuckets / new_p;
+        size_t extra = nbuckets % new_p;
+        ::std::vector<size_t> old = shares();
+        ::std::vector<size_t> quota(new_p, base);
+        for (int r = 0; (r < new_p) && (extra > 0); ++r)
+          if ((r < p) && (old[r] > base)) { ++quota[r]; --extra; }
+        for (int r = 0; (r < new_p) && (extra > 0); ++r)
+          if (!((r < p) && (old[r] > base))) { ++quota[r]; --extra; }
+
+        return remap_to(quota);
+      }
+
+      /// the table for weights.size() ranks with weighted shares (see weighted()) that moves the fewest buckets.
+      bucket_table remap(::std::vector<double> const & weights) const {
+        return remap_to(weighted_shares(weights));
+      }
+
+    protected:
+      /// keep each bucket on its rank up to the rank's quota, and give the rest to the ranks under their quota.
+      bucket_table remap_to(::std::vector<size_t> const & quota) const {
+        int const new_p = quota.size();
+        ::std::vector<uint32_t> result(nbuckets);
+        ::std::vector<size_t> kept(new_p, 0);
+        ::std::vector<size_t> moved;
+        for (size_t b = 0; b < nbuckets; ++b) {
+          if ((static_cast<int>(ranks[b]) < new_p) && (kept[ranks[b]] < quota[ranks[b]])) {
+            result[b] = ranks[b];
+            ++kept[ranks[b]];
+          } else {
+            moved.emplace_back(b);
+          }
+        }
+
+        int r = 0;
+        for (auto b : moved) {
+          while (kept[r] == quota[r]) ++r;
+          result[b] = r;
+          ++kept[r];
+        }
+        return bucket_table(result, new_p);
+      }
+
+    public:
+      /// number of buckets with a different rank in other.
+      size_t difference(bucket_table const & other) const {
+        size_t n = 0;
+        for (size_t b = 0; b < nbuckets; ++b) n += (ranks[b] != other.ranks[b]) ? 1 : 0;
+        return n;
+      }
+
+      /// FNV-1a hash of the table, to check that 2 tables are the same, e.g. a saved map's and the loading map's.
+      uint64_t id() const {
+        uint64_t h = 0xcbf29ce484222325UL;
+        h = (h ^ static_cast<uint64_t>(p)) * 0x100000001b3UL;
+        for (auto r : ranks) h = (h ^ r) * 0x100000001b3UL;
+        return h;
+      }
+
+      bool operator==(bucket_table const & other) const {
+        return (p == other.p) && (ranks == other.ranks);
+      }
+      bool operator!=(bucket_table const & other) const {
+        return !(*this == other);
+      }
+  };
+
+} // namespace dsc
+
+#endif /* BUCKET_TABLE_HPP_ */
@@ -0,0 +1,810 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    compact_counting_map.hpp
+ * @ingroup fsc::containers
+ * @brief   open addressing counting map with keys and small counters in separate arrays.
+ * @details most k-mers in a read set occur only a few times, so a full width count per entry wastes memory and cache.
+ *          this map stores the keys, the control bytes, and 1 or 2 byte counters in 3 parallel arrays.  a counter at its max
+ *          value marks an overflowed count, which is kept at full width in a side table indexed by slot.  counts are exact.
+ *
+ *          for 31-mers in uint64_t with uint32_t counts, an entry is 8 + 1 + 1 = 10 bytes instead of the 16 bytes of std::pair<Kmer, uint32_t>.
+ *
+ *          probing uses the control bytes and SSE2 group matching of ::fsc::swiss_map, and the interface is the same as
+ *          ::fsc::densehash_map so that it can be used as the local container of the distributed counting maps, via the
+ *          compact_counting_map8 and compact_counting_map16 aliases.  since the entries are not stored as pairs, iterators return the
+ *          (key, count) pair by value, and iterator->second is a proxy that reads and writes the count.
+ */
+#ifndef COMPACT_COUNTING_MAP_HPP_
+#define COMPACT_COUNTING_MAP_HPP_
+
+#include <vector>
+#include <unordered_map>
+#include <functional>  // hash, equal_to, etc
+#include <utility>   // pair
+#include <memory>  // allocator
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstdint>
+#include <cstring>   // memset
+#include <type_traits>
+
+#include "containers/swiss_map.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "utils/transform_utils.hpp"
+
+namespace fsc {  // fast standard container
+
+/**
+ * @brief open addressing counting map with Counter sized counts and a side table for the overflowed counts.
+ * @details  see file description.  T is the full width count type.  max load factor is 7/8, counting deleted slots.
+ *          iterators are invalidated by insertion (which may rehash), but not by erase.
+ * @tparam Counter   unsigned integer type for the in-table counts, e.g. uint8_t or uint16_t.
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = void,   // not used.  for compatibility with densehash_map
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = false,    // not used.  for compatibility with densehash_map
+typename Counter = uint8_t >
+class compact_counting_map {
+    static_assert(::std::is_integral<T>::value && !::std::is_signed<T>::value, "count type should be an unsigned integer");
+    static_assert(::std::is_integral<Counter>::value && !::std::is_signed<Counter>::value, "counter type should be an unsigned integer");
+    static_assert(sizeof(Counter) <= sizeof(T), "counter type should not be larger than the count type");
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = typename ::fsc::swiss::key_equal<Equal>::type;
+    using allocator_type        = typename ::std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using reference             = value_type;    // entries are materialized.
+    using const_reference       = value_type;
+    using pointer               = typename std::allocator_traits<allocator_type>::pointer;
+    using const_pointer         = typename std::allocator_traits<allocator_type>::const_pointer;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+    /// number of keys hashed and prefetched at a time by the batch operations.
+    static constexpr size_t batch_size = 32;
+
+    /// counter value marking an overflowed count.
+    static constexpr Counter saturated = ::std::numeric_limits<Counter>::max();
+
+  protected:
+    using ctrl_t = ::fsc::swiss::ctrl_t;
+    using key_allocator_type = typename ::std::allocator_traits<Allocator>::template rebind_alloc<Key>;
+    using key_alloc_traits = ::std::allocator_traits<key_allocator_type>;
+
+    static constexpr size_t group_size = ::fsc::swiss::group_size;
+    static constexpr size_t npos = ::std::numeric_limits<size_t>::max();
+
+    hasher hash;
+    key_equal eq;
+    key_allocator_type alloc;
+
+    ctrl_t * ctrl;
+    Key * keys_;
+    Counter * counts;
+    ::std::unordered_map<size_t, T> overflow;   // full count for slots whose counter is saturated.
+    size_t group_mask;    // number of groups - 1.  number of groups is a power of 2.
+    size_t n_slots;
+    size_t n_elements;
+    size_t n_deleted;
+    size_t growth_left;   // number of EMPTY slots that can be filled before rehashing.
+
+    inline T get_count(size_t const idx) const {
+      return (counts[idx] == saturated) ? overflow.at(idx) : static_cast<T>(counts[idx]);
+    }
+    inline void set_count(size_t const idx, T const & v) {
+      if (v < static_cast<T>(saturated)) {
+        if (counts[idx] == saturated) overflow.erase(idx);
+        counts[idx] = static_cast<Counter>(v);
+      } else {
+        counts[idx] = saturated;
+        overflow[idx] = v;
+      }
+    }
+
+    /// reference to the count of an entry, returned as iterator->second.
+    template <bool is_const>
+    class count_reference {
+        using map_ptr = typename ::std::conditional<is_const, compact_counting_map const *, compact_counting_map *>::type;
+        map_ptr m;
+        size_t idx;
+
+      public:
+        count_reference(map_ptr _m, size_t const & _idx) : m(_m), idx(_idx) {};
+
+        inline operator T() const { return m->get_count(idx); }
+
+        template <bool c = is_const, typename = typename ::std::enable_if<!c>::type>
+        inline count_reference & operator=(T const & v) {
+          m->set_count(idx, v);
+          return *this;
+        }
+        template <bool c = is_const, typename = typename ::std::enable_if<!c>::type>
+        inline count_reference & operator=(count_reference const & other) {
+          m->set_count(idx, static_cast<T>(other));
+          return *this;
+        }
+        template <bool c = is_const, typename = typename ::std::enable_if<!c>::type>
+        inline count_reference & operator+=(T const & v) {
+          m->set_count(idx, m->get_count(idx) + v);
+          return *this;
+        }
+    };
+
+    /// (key, count reference) pair, returned by iterator::operator->.
+    template <bool is_const>
+    struct entry_reference {
+        Key const & first;
+        count_reference<is_const> second;
+
+        inline entry_reference * operator->() { return this; }
+    };
+
+    /// iterator over the full slots.
+    template <bool is_const>
+    class slot_iterator : public ::std::iterator<::std::forward_iterator_tag, value_type, ptrdiff_t,
+                                                 entry_reference<is_const>, value_type> {
+        friend class compact_counting_map;
+        using map_ptr = typename ::std::conditional<is_const, compact_counting_map const *, compact_counting_map *>::type;
+
+        map_ptr m;
+        size_t idx;
+
+        inline void skip() {
+          while ((idx < m->n_slots) && (m->ctrl[idx] < 0)) ++idx;
+        }
+
+      public:
+        slot_iterator() : m(nullptr), idx(0) {};
+        slot_iterator(map_ptr _m, size_t const & _idx) : m(_m), idx(_idx) {
+          skip();
+        };
+
+        /// conversion to const iterator
+        template <bool c = is_const, typename = typename ::std::enable_if<!c>::type>
+        operator slot_iterator<true>() const {
+          return slot_iterator<true>(m, idx);
+        }
+
+        inline value_type operator*() const { return value_type(m->keys_[idx], m->get_count(idx)); }
+        inline entry_reference<is_const> operator->() const {
+          return entry_reference<is_const>{m->keys_[idx], count_reference<is_const>(m, idx)};
+        }
+
+        inline slot_iterator & operator++() {
+          ++idx;
+          skip();
+          return *this;
+        }
+        inline slot_iterator operator++(int) {
+          slot_iterator out(*this);
+          ++(*this);
+          return out;
+        }
+
+        template <bool c>
+        inline bool operator==(slot_iterator<c> const & other) const {
+          return (idx == other.get_index()) && (m == other.get_map());
+        }
+        template <bool c>
+        inline bool operator!=(slot_iterator<c> const & other) const {
+          return !(*this == other);
+        }
+
+        inline size_t get_index() const { return idx; }
+        inline compact_counting_map const * get_map() const { return m; }
+    };
+
+  public:
+    using iterator              = slot_iterator<false>;
+    using const_iterator        = slot_iterator<true>;
+
+  protected:
+
+    static inline uint64_t mix(uint64_t const h) { return ::fsc::swiss::mix(h); }
+    static inline size_t get_group(uint64_t const m) { return ::fsc::swiss::get_group(m); }
+    static inline ctrl_t get_tag(uint64_t const m) { return ::fsc::swiss::get_tag(m); }
+
+    template <typename V>
+    static inline Key const & get_key(V const & x) { return x.first; }
+    static inline Key const & get_key(Key const & x) { return x; }
+
+    inline void prefetch_hash(uint64_t const h) const {
+      size_t g = (get_group(h) & group_mask) * group_size;
+      __builtin_prefetch(ctrl + g);
+      __builtin_prefetch(keys_ + g);
+    }
+
+    void allocate(size_t const groups) {
+      group_mask = groups - 1;
+      n_slots = groups * group_size;
+      ctrl = new ctrl_t[n_slots];
+      memset(ctrl, ::fsc::swiss::EMPTY, n_slots);
+      keys_ = key_alloc_traits::allocate(alloc, n_slots);
+      counts = new Counter[n_slots];
+      n_elements = 0;
+      n_deleted = 0;
+      growth_left = n_slots - n_slots / 8;
+    }
+
+    void destroy_elements() {
+      overflow.clear();
+      if (n_elements == 0) return;
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) key_alloc_traits::destroy(alloc, keys_ + i);
+      }
+    }
+
+    void deallocate() {
+      if (ctrl == nullptr) return;
+      destroy_elements();
+      key_alloc_traits::deallocate(alloc, keys_, n_slots);
+      delete [] counts;
+      delete [] ctrl;
+      ctrl = nullptr;
+      keys_ = nullptr;
+      counts = nullptr;
+    }
+
+    /// index of the slot with key, or npos.
+    size_t find_index(Key const & key, uint64_t const h) const {
+      ctrl_t tag = get_tag(h);
+      size_t g = get_group(h) & group_mask;
+      ctrl_t const * gc;
+      uint32_t m;
+      size_t idx;
+      for (size_t i = 1; ; ++i) {
+        gc = ctrl + g * group_size;
+        for (m = ::fsc::swiss::match(gc, tag); m != 0; m &= m - 1) {
+          idx = g * group_size + ::fsc::swiss::first_bit(m);
+          if (eq(keys_[idx], key)) return idx;
+        }
+        if (::fsc::swiss::match(gc, ::fsc::swiss::EMPTY) != 0) return npos;
+        g = (g + i) & group_mask;   // triangular probing visits all groups.
+      }
+    }
+
+    /// first EMPTY or DELETED slot in the probe sequence of h.  there is always one since load is at most 7/8.
+    size_t find_free(uint64_t const h) const {
+      size_t g = get_group(h) & group_mask;
+      uint32_t m;
+      for (size_t i = 1; ; ++i) {
+        m = ::fsc::swiss::match_empty_or_deleted(ctrl + g * group_size);
+        if (m != 0) return g * group_size + ::fsc::swiss::first_bit(m);
+        g = (g + i) & group_mask;
+      }
+    }
+
+    /// claim a free slot for a new element with hash h.  the caller constructs the key and sets the count.
+    size_t prepare_insert(uint64_t const h) {
+      size_t idx = find_free(h);
+      if ((growth_left == 0) && (ctrl[idx] == ::fsc::swiss::EMPTY)) {
+        // full.  grow, or just drop the DELETED markers if they are taking up much of the space.
+        rehash_groups((n_elements * 2 > growth_left + n_elements + n_deleted) ? (group_mask + 1) * 2 : (group_mask + 1));
+        idx = find_free(h);
+      }
+      if (ctrl[idx] == ::fsc::swiss::DELETED) --n_deleted;
+      else --growth_left;
+      ctrl[idx] = get_tag(h);
+      counts[idx] = 0;
+      ++n_elements;
+      return idx;
+    }
+
+    void erase_index(size_t const idx) {
+      key_alloc_traits::destroy(alloc, keys_ + idx);
+      if (counts[idx] == saturated) overflow.erase(idx);
+      --n_elements;
+      // a lookup passing through this group stops here if the group has an EMPTY slot, so the slot can be EMPTY too.
+      if (::fsc::swiss::match(ctrl + (idx & ~(group_size - 1)), ::fsc::swiss::EMPTY) != 0) {
+        ctrl[idx] = ::fsc::swiss::EMPTY;
+        ++growth_left;
+      } else {
+        ctrl[idx] = ::fsc::swiss::DELETED;
+        ++n_deleted;
+      }
+    }
+
+    /// move all elements into a new table with the specified number of groups.  overflowed counts are re-indexed.
+    void rehash_groups(size_t const groups) {
+      ctrl_t * old_ctrl = ctrl;
+      Key * old_keys = keys_;
+      Counter * old_counts = counts;
+      size_t old_n = n_slots;
+      size_t count = n_elements;
+      ::std::unordered_map<size_t, T> old_overflow;
+      old_overflow.swap(overflow);
+
+      allocate(groups);
+
+      uint64_t h;
+      size_t idx;
+      for (size_t i = 0; i < old_n; ++i) {
+        if (old_ctrl[i] < 0) continue;
+
+        h = mix(hash(old_keys[i]));
+        idx = find_free(h);   // no duplicates, and no DELETED entries.
+        ctrl[idx] = get_tag(h);
+        key_alloc_traits::construct(alloc, keys_ + idx, ::std::move(old_keys[i]));
+        key_alloc_traits::destroy(alloc, old_keys + i);
+        counts[idx] = old_counts[i];
+        if (counts[idx] == saturated) overflow.emplace(idx, old_overflow.at(i));
+      }
+      n_elements = count;
+      growth_left -= count;
+
+      key_alloc_traits::deallocate(alloc, old_keys, old_n);
+      delete [] old_counts;
+      delete [] old_ctrl;
+    }
+
+    /// insert with precomputed hash value.
+    template <typename V>
+    std::pair<iterator, bool> insert_hashed(V const & x, uint64_t const h) {
+      size_t idx = find_index(x.first, h);
+      if (idx != npos) return std::make_pair(iterator(this, idx), false);
+
+      idx = prepare_insert(h);
+      key_alloc_traits::construct(alloc, keys_ + idx, x.first);
+      set_count(idx, x.second);
+      return std::make_pair(iterator(this, idx), true);
+    }
+
+    /// insert a contiguous array of elements.  hashes are computed for a block via the batch hash interface, then the groups are prefetched.
+    template <typename V>
+    void insert_batch(V const * input, size_t const count) {
+      uint64_t hashes[batch_size];
+      size_t n;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, input + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+        for (size_t j = 0; j < n; ++j) insert_hashed(input[i + j], hashes[j]);
+      }
+    }
+
+  public:
+
+    compact_counting_map(size_type bucket_count = 128) :
+      hash(), eq(), alloc(), ctrl(nullptr), keys_(nullptr), counts(nullptr) {
+      allocate(::fsc::swiss::groups_for(bucket_count));
+    };
+
+    template<class InputIt>
+    compact_counting_map(InputIt first, InputIt last) :
+      compact_counting_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    compact_counting_map(compact_counting_map const & other) :
+      hash(other.hash), eq(other.eq),
+      alloc(key_alloc_traits::select_on_container_copy_construction(other.alloc)),
+      ctrl(nullptr), keys_(nullptr), counts(nullptr), overflow(other.overflow) {
+      allocate(other.group_mask + 1);
+      memcpy(ctrl, other.ctrl, n_slots);
+      memcpy(counts, other.counts, n_slots * sizeof(Counter));
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) key_alloc_traits::construct(alloc, keys_ + i, other.keys_[i]);
+      }
+      n_elements = other.n_elements;
+      n_deleted = other.n_deleted;
+      growth_left = other.growth_left;
+    }
+
+    compact_counting_map(compact_counting_map && other) :
+      hash(::std::move(other.hash)), eq(::std::move(other.eq)), alloc(::std::move(other.alloc)),
+      ctrl(other.ctrl), keys_(other.keys_), counts(other.counts), overflow(::std::move(other.overflow)),
+      group_mask(other.group_mask), n_slots(other.n_slots),
+      n_elements(other.n_elements), n_deleted(other.n_deleted), growth_left(other.growth_left) {
+      other.ctrl = nullptr;
+      other.keys_ = nullptr;
+      other.counts = nullptr;
+      other.overflow.clear();
+      other.allocate(1);
+    }
+
+    compact_counting_map & operator=(compact_counting_map other) {
+      this->swap(other);
+      return *this;
+    }
+
+    void swap(compact_counting_map & other) {
+      ::std::swap(hash, other.hash);
+      ::std::swap(eq, other.eq);
+      ::std::swap(alloc, other.alloc);
+      ::std::swap(ctrl, other.ctrl);
+      ::std::swap(keys_, other.keys_);
+      ::std::swap(counts, other.counts);
+      overflow.swap(other.overflow);
+      ::std::swap(group_mask, other.group_mask);
+      ::std::swap(n_slots, other.n_slots);
+      ::std::swap(n_elements, other.n_elements);
+      ::std::swap(n_deleted, other.n_deleted);
+      ::std::swap(growth_left, other.growth_left);
+    }
+
+    virtual ~compact_counting_map() {
+      deallocate();
+    };
+
+    float get_max_load_factor() const {
+      return 0.875f;
+    }
+
+    iterator begin() {
+      return iterator(this, 0);
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      return const_iterator(this, 0);
+    }
+
+    iterator end() {
+      return iterator(this, n_slots);
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return const_iterator(this, n_slots);
+    }
+
+
+    std::vector<Key> keys() const {
+      std::vector<Key> ks;
+
+      keys(ks);
+
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const {
+      ks.clear();
+      ks.reserve(size());
+
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) ks.emplace_back(keys_[i]);
+      }
+    }
+
+    std::vector<std::pair<Key, T> > to_vector() const {
+      std::vector<std::pair<Key, T>> vs;
+
+      to_vector(vs);
+
+      return vs;
+    }
+    void to_vector(  std::vector<std::pair<Key, T> > & vs) const {
+      vs.clear();
+      vs.reserve(size());
+
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) vs.emplace_back(keys_[i], get_count(i));
+      }
+    }
+
+
+    bool empty() const {
+      return n_elements == 0;
+    }
+
+    size_type size() const {
+      return n_elements;
+    }
+    size_type unique_size() const {
+      return n_elements;
+    }
+
+    /// number of counts that did not fit in the counter type.
+    size_type overflow_size() const {
+      return overflow.size();
+    }
+
+    /// clear and release memory.
+    void reset() {
+      deallocate();
+      allocate(1);
+    }
+
+    /// clear without releasing memory.
+    void clear() {
+      destroy_elements();
+      memset(ctrl, ::fsc::swiss::EMPTY, n_slots);
+      n_elements = 0;
+      n_deleted = 0;
+      growth_left = n_slots - n_slots / 8;
+    }
+
+    /// resize to hold at least n elements, and at least the current elements.  may shrink.  iterators are invalidated.
+    void resize(size_t const n) {
+      size_t groups = ::fsc::swiss::groups_for(::std::max(n, n_elements));
+      if ((groups != group_mask + 1) || (n_deleted > 0)) rehash_groups(groups);
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type count) {
+      this->resize(count);
+    }
+
+    /// bucket count, i.e. number of slots.
+    size_type bucket_count() const {
+      return n_slots;
+    }
+
+    float load_factor() const {
+      return static_cast<float>(n_elements) / static_cast<float>(n_slots);
+    }
+
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      // hash and prefetch a block, then insert it.
+      uint64_t hashes[batch_size];
+      size_t n;
+      InputIt it;
+      while (first != last) {
+        for (it = first, n = 0; (n < batch_size) && (it != last); ++it, ++n) {
+          hashes[n] = mix(hash(get_key(*it)));
+          prefetch_hash(hashes[n]);
+        }
+        for (n = 0; first != it; ++first, ++n) {
+          insert_hashed(*first, hashes[n]);
+        }
+      }
+    }
+
+    void insert(::std::vector<::std::pair<Key, T> > & input) {
+      insert_batch(input.data(), input.size());
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    std::pair<iterator, bool> insert(::std::pair<Key, T> const & x) {
+      return insert_hashed(x, mix(hash(x.first)));
+    }
+
+    std::pair<iterator, bool> insert(::std::pair<const Key, T> const & x) {
+      return insert_hashed(x, mix(hash(x.first)));
+    }
+
+    /// add 1 to the count of each key, inserting the keys that are not present.  hashes are computed and groups prefetched a block at a time.
+    void increment(Key const * input, size_t const count) {
+      uint64_t hashes[batch_size];
+      size_t n, idx;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, input + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+        for (size_t j = 0; j < n; ++j) {
+          idx = find_index(input[i + j], hashes[j]);
+          if (idx == npos) {
+            idx = prepare_insert(hashes[j]);
+            key_alloc_traits::construct(alloc, keys_ + idx, input[i + j]);
+          }
+          if (counts[idx] < saturated - 1) ++counts[idx];    // common case.
+          else set_count(idx, get_count(idx) + 1);
+        }
+      }
+    }
+
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+
+      if (input.size() == 0) return 0;
+
+      size_t count = 0;
+      size_t idx;
+      uint64_t hashes[batch_size];
+      size_t n;
+      T v;
+      for (size_t i = 0; i < input.size(); i += batch_size) {
+        n = ::std::min(batch_size, input.size() - i);
+        ::fsc::batch_hash(hash, input.data() + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          idx = find_index(input[i + j].first, hashes[j]);
+          if (idx == npos) continue;
+
+          // update the entry
+          v = get_count(idx);
+          count += op(v, input[i + j].second);
+          set_count(idx, v);
+        }
+      }
+      return count;
+    }
+
+    // non distributed version
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t count = 0;
+      T v;
+
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] < 0) continue;
+        v = get_count(i);
+        if (fop(value_type(keys_[i], v))) {
+          count += op(v);
+          set_count(i, v);
+        }
+      }
+
+      return count;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      if (first == last) return 0;
+
+      size_t count = 0;
+      size_t idx;
+
+      for (; first != last; ++first) {
+        idx = find_index(*first, mix(hash(*first)));
+        if (idx == npos) continue;
+
+        if (pred(value_type(keys_[idx], get_count(idx)))) {
+          erase_index(idx);
+          ++count;
+        }
+      }
+      return count;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+        static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                      "InputIt value type for erase cannot be converted to key type");
+
+        if (first == last) return 0;
+
+        size_t count = 0;
+        size_t idx;
+
+        for (; first != last; ++first) {
+          idx = find_index(*first, mix(hash(*first)));
+          if (idx == npos) continue;
+
+          erase_index(idx);
+          ++count;
+        }
+        return count;
+    }
+
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      size_t before = n_elements;
+
+      for (size_t i = 0; i < n_slots; ++i) {
+        if ((ctrl[i] >= 0) && pred(value_type(keys_[i], get_count(i))))
+          erase_index(i);
+      }
+
+      return before - n_elements;
+    }
+
+    size_type count(Key const & key) const {
+      return (find_index(key, mix(hash(key))) == npos) ? 0 : 1;
+    }
+
+
+    ::std::pair<iterator, iterator> equal_range(Key const & key) {
+      iterator it = find(key);
+      if (it == end()) return ::std::make_pair(it, it);
+      return ::std::make_pair(it, iterator(this, it.get_index() + 1));
+    }
+    ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+      const_iterator it = find(key);
+      if (it == cend()) return ::std::make_pair(it, it);
+      return ::std::make_pair(it, const_iterator(this, it.get_index() + 1));
+    }
+    // NO bucket interfaces
+
+
+    iterator find(Key const &key) {
+      size_t idx = find_index(key, mix(hash(key)));
+      return iterator(this, (idx == npos) ? n_slots : idx);
+    }
+
+    const_iterator find(Key const &key) const {
+      size_t idx = find_index(key, mix(hash(key)));
+      return const_iterator(this, (idx == npos) ? n_slots : idx);
+    }
+
+    /// prefetch the group that key probes first, ahead of a lookup.
+    inline void prefetch(Key const & key) const {
+      prefetch_hash(mix(hash(key)));
+    }
+
+    /// batch count.  results[i] is the count for queries[i].  hashes are computed and groups prefetched a block at a time.
+    void count(Key const * queries, size_t const count, size_type * results) const {
+      uint64_t hashes[batch_size];
+      size_t n;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, queries + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          results[i + j] = (find_index(queries[i + j], hashes[j]) == npos) ? 0 : 1;
+        }
+      }
+    }
+
+    inline bool exists(Key const & key) const {
+      return find_index(key, mix(hash(key))) != npos;
+    }
+
+};
+
+template <typename Key, typename T, typename SpecialKeys, template<typename> class Transform,
+  typename Hash, typename Equal, typename Allocator, bool split, typename Counter>
+constexpr size_t compact_counting_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split, Counter>::batch_size;
+template <typename Key, typename T, typename SpecialKeys, template<typename> class Transform,
+  typename Hash, typename Equal, typename Allocator, bool split, typename Counter>
+constexpr Counter compact_counting_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split, Counter>::saturated;
+
+
+/// compact counting map with 1 byte counters, with the template parameters of densehash_map for use as a local container.
+template <typename Key, typename T, typename SpecialKeys = void,
+    template<typename> class Transform = ::bliss::transform::identity,
+    typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+    typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+    typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+    bool split = false>
+using compact_counting_map8 = compact_counting_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split, uint8_t>;
+
+/// compact counting map with 2 byte counters, with the template parameters of densehash_map for use as a local container.
+template <typename Key, typename T, typename SpecialKeys = void,
+    template<typename> class Transform = ::bliss::transform::identity,
+    typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+    typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+    typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+    bool split = false>
+using compact_counting_map16 = compact_counting_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split, uint16_t>;
+
+
+} // namespace fsc
+
+
+#endif /* COMPACT_COUNTING_MAP_HPP_ */
@@ -349,6 +349,189 @@ namespace sparsehash {
 	static constexpr bool need_to_split = false;
   };
 
+
+  /// number of queries hashed and prefetched at a time by the batch lookups.
+  static constexpr size_t batch_size = 32;
+
+  /**
+   * @brief prefetch the first probe bucket for hash value h in a google dense_hash_map.
+   * @details the bucket array is not exposed, but the end iterator points to the end of it.
+   *          the hash is not munged for non-pointer keys, and the first probe is at h & (buckets - 1).
+   */
+  template <typename Map>
+  inline void prefetch_bucket(Map const & map, uint64_t const h) {
+    __builtin_prefetch(map.end().pos - map.bucket_count() + (h & (map.bucket_count() - 1)));
+  }
+
+  template <typename Key>
+  inline Key const & get_key(Key const & x) { return x; }
+  template <typename Key, typename V>
+  inline Key const & get_key(::std::pair<Key, V> const & x) { return x.first; }
+
+  /**
+   * @brief call op(i) for each query in [0, n), a block at a time.
+   * @details each block is hashed with the batch hash interface where available, and the first probe bucket
+   *          in map_of(key) is prefetched for every query of the block before op is called, so that the
+   *          cache misses of the lookups in a block are in flight together.
+   */
+  template <typename Query, typename Hash, typename MapOf, typename Op>
+  inline void prefetched_apply(Query const * queries, size_t const n, Hash const & h,
+                               MapOf const & map_of, Op const & op) {
+    uint64_t hashes[batch_size];
+    size_t m;
+    for (size_t i = 0; i < n; i += batch_size) {
+      m = ::std::min(batch_size, n - i);
+      ::fsc::batch_hash(h, queries + i, m, hashes);
+      for (size_t j = 0; j < m; ++j) {
+        prefetch_bucket(map_of(get_key(queries[i + j])), hashes[j]);
+      }
+      for (size_t j = 0; j < m; ++j) {
+        op(i + j);
+      }
+    }
+  }
+
+  /**
+   * @brief health statistics of 1 or more open addressing tables.
+   * @details probe_hist[i] is the number of entries found at the i-th probe from their home bucket (the last bin
+   *          also counts longer probes).  tombstones are buckets holding the deleted key.  bytes is the table
+   *          memory, including out of table storage such as the multimap value vectors.
+   *          imbalance is max / mean of the entries per rank, set by the collective stats of the distributed maps.
+   */
+  struct table_stats {
+      static constexpr size_t max_probe_bins = 32;
+
+      size_t size;
+      size_t buckets;
+      size_t tombstones;
+      size_t bytes;
+      size_t max_probe;
+      ::std::vector<size_t> probe_hist;
+      double imbalance;
+
+      table_stats() : size(0), buckets(0), tombstones(0), bytes(0), max_probe(0), probe_hist(max_probe_bins, 0), imbalance(1.0) {}
+
+      double load_factor() const { return (buckets == 0) ? 0.0 : static_cast<double>(size) / static_cast<double>(buckets); }
+      double tombstone_ratio() const { return (buckets == 0) ? 0.0 : static_cast<double>(tombstones) / static_cast<double>(buckets); }
+      double bytes_per_entry() const { return (size == 0) ? 0.0 : static_cast<double>(bytes) / static_cast<double>(size); }
+      /// mean number of probes of a successful lookup.
+      double mean_probe() const {
+        size_t total = 0, n = 0;
+        for (size_t i = 0; i < probe_hist.size(); ++i) {
+          total += (i + 1) * probe_hist[i];
+          n += probe_hist[i];
+        }
+        return (n == 0) ? 0.0 : static_cast<double>(total) / static_cast<double>(n);
+      }
+
+      /// add another table (e.g. the other half of a split map).
+      void merge(table_stats const & other) {
+        size += other.size;
+        buckets += other.buckets;
+        tombstones += other.tombstones;
+        bytes += other.bytes;
+        max_probe = ::std::max(max_probe, other.max_probe);
+        for (size_t i = 0; i < probe_hist.size(); ++i) probe_hist[i] += other.probe_hist[i];
+      }
+
+      void print(::std::ostream & os) const {
+        os << "entries=" << size << " buckets=" << buckets << " load=" << load_factor()
+           << " tombstones=" << tombstones << " bytes/entry=" << bytes_per_entry()
+           << " mean_probe=" << mean_probe() << " max_probe=" << max_probe << " imbalance=" << imbalance
+           << " probe_hist=[";
+        size_t last = probe_hist.size();
+        while ((last > 1) && (probe_hist[last - 1] == 0)) --last;
+        for (size_t i = 0; i < last; ++i) os << (i == 0 ? "" : ",") << probe_hist[i];
+        os << "]";
+      }
+  };
+
+  /**
+   * @brief compute the table statistics of a google dense_hash_map by scanning its bucket array.
+   * @details the bucket array is found as in prefetch_bucket.  the probe sequence is quadratic (triangular), i.e.
+   *          home + 0, 1, 3, 6, ... so the probe count of an entry is found by replaying the sequence from its home bucket.
+   */
+  template <typename Map>
+  table_stats get_table_stats(Map const & map, size_t const & extra_bytes = 0) {
+    table_stats st;
+    st.size = map.size();
+    st.buckets = map.bucket_count();
+    st.bytes = sizeof(Map) + st.buckets * sizeof(typename Map::value_type) + extra_bytes;
+    if (st.buckets == 0) return st;
+
+    auto const * table = map.end().pos - map.bucket_count();
+    size_t const mask = st.buckets - 1;
+    auto const & eq = map.key_eq();
+    auto const & h = map.hash_funct();
+    auto del = map.deleted_key();
+    auto empty = map.empty_key();
+
+    size_t pos, bucket, probes;
+    for (size_t i = 0; i < st.buckets; ++i) {
+      if (eq(table[i].first, empty)) continue;
+      if (eq(table[i].first, del)) {
+        ++st.tombstones;
+        continue;
+      }
+      // replay the probe sequence.
+      pos = i;
+      bucket = h(table[i].first) & mask;
+      probes = 0;
+      while ((bucket != pos) && (probes < st.buckets)) {
+        ++probes;
+        bucket = (bucket + probes) & mask;
+      }
+      st.max_probe = ::std::max(st.max_probe, probes + 1);
+      ++st.probe_hist[::std::min(probes, table_stats::max_probe_bins - 1)];
+    }
+    return st;
+  }
+
+  /// partitions of the table for bulk_insert.  with 16 byte entries, a table of 2^26 buckets has 256KB partitions, i.e. in L2 cache.
+  static constexpr size_t bulk_partitions = 4096;
+  /// smallest batch, and table in bytes, for which the vector inserts reorder the batch first.
+  static constexpr size_t bulk_min_input = 1UL << 16;
+  static constexpr size_t bulk_min_table_bytes = 1UL << 22;
+
+  /// partition of the table that the home bucket of hash value h is in, for a dense_hash_map with buckets buckets.
+  struct bucket_partition {
+      size_t mask;
+      int shift;
+
+      bucket_partition(size_t const & buckets) : mask(buckets - 1), shift(0) {
+        while ((buckets >> shift) > bulk_partitions) ++shift;
+      }
+      inline size_t parts(size_t const & buckets) const {
+        return (buckets + (1UL << shift) - 1) >> shift;
+      }
+      inline size_t operator()(uint64_t const & h) const {
+        return (h & mask) >> shift;
+      }
+  };
+
+  /**
+   * @brief reorder input in place by part(x), a stable counting sort.  returns the start of each part, and the end.
+   * @details  ids are computed once.  used by bulk_insert to order a batch by home bucket.
+   */
+  template <typename V, typename Part>
+  ::std::vector<size_t> counting_sort(::std::vector<V> & input, size_t const & nparts, Part const & part) {
+    ::std::vector<size_t> offsets(nparts + 1, 0);
+    ::std::vector<uint32_t> ids(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+      ids[i] = static_cast<uint32_t>(part(input[i]));
+      ++offsets[ids[i] + 1];
+    }
+    for (size_t p = 0; p < nparts; ++p) offsets[p + 1] += offsets[p];
+
+    ::std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    ::std::vector<V> buffer(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+      buffer[pos[ids[i]]++] = input[i];
+    }
+    input.swap(buffer);
+    return offsets;
+  }
+
 }  // namespace sparsehash
 
 
@@ -603,6 +786,13 @@ protected:
       return  static_cast<float>(size()) / static_cast<float>(bucket_count());
     }
 
+    /// table health statistics of the 2 halves.  O(buckets).
+    ::fsc::sparsehash::table_stats stats() const {
+      ::fsc::sparsehash::table_stats st = ::fsc::sparsehash::get_table_stats(lower_map);
+      st.merge(::fsc::sparsehash::get_table_stats(upper_map));
+      return st;
+    }
+
 
 
     // choices:  sort first, then insert in ranges, or no sort, insert one by one.  second is O(n) but pays the random access and mem realloc cost
@@ -629,8 +819,12 @@ protected:
 
     }
 
-    /// inserting a vector
+    /// inserting a vector.  a large batch into a large table is inserted in bucket order, see bulk_insert.  input may be reordered.
     void insert(::std::vector<::std::pair<Key, T> > & input) {
+      if ((input.size() >= ::fsc::sparsehash::bulk_min_input) &&
+          (bucket_count() * sizeof(value_type) >= ::fsc::sparsehash::bulk_min_table_bytes))
+        bulk_insert(input);
+      else
     	insert(input.begin(), input.end());
     }
 
@@ -639,6 +833,32 @@ protected:
     	insert(input.begin(), input.end());
     }
 
+    /**
+     * @brief insert a batch in the order of the home buckets, so the table is written 1 partition at a time.
+     * @details  the batch is counting sorted by half, then by the partition of its home bucket (see bucket_partition),
+     *        at the current bucket counts.  the order is stable, so the first of duplicate keys is kept, as in insert.
+     *        resize first if the table would grow during the insert, e.g. as the distributed maps do from the key
+     *        estimate, otherwise the order only helps until the first rehash.  input is reordered.
+     */
+    void bulk_insert(::std::vector<::std::pair<Key, T> > & input) {
+      if (input.empty()) return;
+      Hash h = lower_map.hash_funct();
+      ::fsc::sparsehash::bucket_partition lower_part(lower_map.bucket_count());
+      ::fsc::sparsehash::bucket_partition upper_part(upper_map.bucket_count());
+      size_t nlower = lower_part.parts(lower_map.bucket_count());
+      size_t nupper = upper_part.parts(upper_map.bucket_count());
+
+      auto offsets = ::fsc::sparsehash::counting_sort(input, nlower + nupper,
+          [this, &h, &lower_part, &upper_part, &nlower](::std::pair<Key, T> const & x) {
+        uint64_t hv = h(x.first);
+        return this->splitter(x.first) ? lower_part(hv) : nlower + upper_part(hv);
+      });
+
+      auto middle = input.begin() + offsets[nlower];
+      for (auto it = input.begin(); it != middle; ++it) lower_map.insert(*it);
+      for (auto it = middle; it != input.end(); ++it) upper_map.insert(*it);
+    }
+
     template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
     std::pair<typename container_type::iterator, bool> insert(::std::pair<Key, T> const & x) {
       if (splitter(x.first)) {
@@ -696,22 +916,25 @@ protected:
 //        count += op((*iter).second, iit->second );
 //      }
 
-      for (auto iit = input.begin(); iit != input.end(); ++iit) {
-    	  auto k = iit->first;
+      // buckets are prefetched a block at a time.
+      ::fsc::sparsehash::prefetched_apply(input.data(), input.size(), lower_map.hash_funct(),
+          [this](Key const & k) -> container_type const & { return splitter(k) ? lower_map : upper_map; },
+          [this, &input, &op, &count](size_t const i) {
+    	  auto k = input[i].first;
     	  if (splitter(k)) {
 			  auto iter = lower_map.find(k);
-			  if (iter == lower_map.end()) continue;
+			  if (iter == lower_map.end()) return;
 
 			  // update the entry
-			  count += op((*iter).second, iit->second );
+			  count += op((*iter).second, input[i].second );
     	  } else {
 			  auto iter = upper_map.find(k);
-			  if (iter == upper_map.end()) continue;
+			  if (iter == upper_map.end()) return;
 
 			  // update the entry
-			  count += op((*iter).second, iit->second );
+			  count += op((*iter).second, input[i].second );
     	  }
-      }
+      });
 
       return count;
     }
@@ -909,11 +1132,40 @@ protected:
 
     inline bool exists(Key const & key) const {
       if (splitter(key)) {
-        return upper_map.find(key) != upper_map.end();
+        return lower_map.find(key) != lower_map.end();
       } else {
         return upper_map.find(key) != upper_map.end();
       }
     }
+
+    /// prefetch the bucket for a key, e.g. a few queries ahead of its lookup.
+    inline void prefetch(Key const & key) const {
+      if (splitter(key)) {
+        ::fsc::sparsehash::prefetch_bucket(lower_map, lower_map.hash_funct()(key));
+      } else {
+        ::fsc::sparsehash::prefetch_bucket(upper_map, upper_map.hash_funct()(key));
+      }
+    }
+
+    /// batch count.  buckets are prefetched a block of queries at a time.
+    void count(Key const * queries, size_t const n, size_type * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, lower_map.hash_funct(),
+          [this](Key const & k) -> container_type const & { return splitter(k) ? lower_map : upper_map; },
+          [this, queries, results](size_t const i) {
+        results[i] = this->count(queries[i]);
+      });
+    }
+
+    /// batch find.  results[i] points to the entry for queries[i], or is nullptr if not found.
+    void find(Key const * queries, size_t const n, value_type const ** results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, lower_map.hash_funct(),
+          [this](Key const & k) -> container_type const & { return splitter(k) ? lower_map : upper_map; },
+          [this, queries, results](size_t const i) {
+        container_type const & m = splitter(queries[i]) ? lower_map : upper_map;
+        auto iter = m.find(queries[i]);
+        results[i] = (iter == m.end()) ? nullptr : &(*iter);
+      });
+    }
 };
 
 
@@ -1080,6 +1332,11 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
       return  static_cast<float>(map.size()) / static_cast<float>(map.bucket_count());
     }
 
+    /// table health statistics.  O(buckets).
+    ::fsc::sparsehash::table_stats stats() const {
+      return ::fsc::sparsehash::get_table_stats(map);
+    }
+
 
     // choices:  sort first, then insert in ranges, or no sort, insert one by one.  second is O(n) but pays the random access and mem realloc cost
     template <class InputIt>
@@ -1090,15 +1347,39 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
       map.insert(first, last);
     }
 
-    /// inserting sorted range
+    /// inserting a vector.  a large batch into a large table is inserted in bucket order, see bulk_insert.  input may be reordered.
     void insert(::std::vector<::std::pair<Key, T> > & input) {
-      insert(input.begin(), input.end());
+      if ((input.size() >= ::fsc::sparsehash::bulk_min_input) &&
+          (map.bucket_count() * sizeof(value_type) >= ::fsc::sparsehash::bulk_min_table_bytes))
+        bulk_insert(input);
+      else
+        insert(input.begin(), input.end());
     }
 
     void insert(::std::vector<value_type > & input) {
       insert(input.begin(), input.end());
     }
 
+    /**
+     * @brief insert a batch in the order of the home buckets, so the table is written 1 partition at a time.
+     * @details  the batch is counting sorted by the partition of its home bucket (see bucket_partition) at the current
+     *        bucket count.  the order is stable, so the first of duplicate keys is kept, as in insert.  resize first if
+     *        the table would grow during the insert, otherwise the order only helps until the first rehash.
+     *        input is reordered.
+     */
+    void bulk_insert(::std::vector<::std::pair<Key, T> > & input) {
+      if (input.empty()) return;
+      Hash h = map.hash_funct();
+      ::fsc::sparsehash::bucket_partition part(map.bucket_count());
+
+      ::fsc::sparsehash::counting_sort(input, part.parts(map.bucket_count()),
+          [&h, &part](::std::pair<Key, T> const & x) {
+        return part(h(x.first));
+      });
+
+      for (auto it = input.begin(); it != input.end(); ++it) map.insert(*it);
+    }
+
     template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
     std::pair<iterator, bool> insert(::std::pair<Key, T> const & x) {
       return map.insert(x);
@@ -1115,18 +1396,16 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
 
       size_t count = 0;
 
-      // do update
-      for (auto vv : input) {
-        auto iter = map.find(vv.first);
-        if (iter == map.end()) {
-//          // TONY: temporary.  for testing only
-//          assert(map.find(vv.first.reverse_complement()) == map.end());
-          continue;
-        }
+      // do update.  buckets are prefetched a block at a time.
+      ::fsc::sparsehash::prefetched_apply(input.data(), input.size(), map.hash_funct(),
+          [this](Key const &) -> container_type const & { return map; },
+          [this, &input, &op, &count](size_t const i) {
+        auto iter = map.find(input[i].first);
+        if (iter == map.end()) return;
 
         // update the entry
-        count += op((*iter).second, vv.second );
-      }
+        count += op((*iter).second, input[i].second );
+      });
 
       return count;
     }
@@ -1226,6 +1505,30 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
       return map.find(key) != map.end();
     }
 
+    /// prefetch the bucket for a key, e.g. a few queries ahead of its lookup.
+    inline void prefetch(Key const & key) const {
+      ::fsc::sparsehash::prefetch_bucket(map, map.hash_funct()(key));
+    }
+
+    /// batch count.  buckets are prefetched a block of queries at a time.
+    void count(Key const * queries, size_t const n, size_type * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, map.hash_funct(),
+          [this](Key const &) -> container_type const & { return map; },
+          [this, queries, results](size_t const i) {
+        results[i] = map.count(queries[i]);
+      });
+    }
+
+    /// batch find.  results[i] points to the entry for queries[i], or is nullptr if not found.
+    void find(Key const * queries, size_t const n, value_type const ** results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, map.hash_funct(),
+          [this](Key const &) -> container_type const & { return map; },
+          [this, queries, results](size_t const i) {
+        auto iter = map.find(queries[i]);
+        results[i] = (iter == map.end()) ? nullptr : &(*iter);
+      });
+    }
+
 };
 
 
@@ -1247,6 +1550,8 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
  *
  *            this trades off sorting with more vector allocations and copying, but appears to be faster at least for the case when there are large number of singleton entries.
  *
+ *            after the last insert, finalize() regroups the entries by key into vec1 (CSR), and frees the per key vectors.
+ *
  */
 template <typename Key,
 typename T,
@@ -1291,8 +1596,50 @@ class densehash_multimap {
     std::vector<subcontainer_type, vector_allocator_type> vecX;
     size_t s;
 
+    /// after finalize():  the entries of multiple entry key j are vec1[offsets[j], offsets[j+1]), and vecX is empty.
+    ::std::vector<int64_t> offsets;
+    bool grouped;
+
     // TODO: provide iterator implementation for  begin/end.
 
+    /// back to separate vectors for multiple entries, before an update.  the runs stay in vec1 unused until the next finalize.
+    void ungroup() {
+      if (!grouped) return;
+
+      vecX.clear();
+      vecX.resize(offsets.size() - 1);
+      for (size_t j = 0; j + 1 < offsets.size(); ++j) {
+        vecX[j].assign(::std::make_move_iterator(vec1.begin() + offsets[j]),
+                       ::std::make_move_iterator(vec1.begin() + offsets[j + 1]));
+      }
+      ::std::vector<int64_t>().swap(offsets);
+      grouped = false;
+    }
+
+    /// finalize:  append the entries of the multiple entry keys of map to grouped_vec, and record their ranges.
+    void group_multiples(supercontainer_type & map, subcontainer_type & grouped_vec, ::std::vector<int64_t> & offs) {
+      int64_t idx;
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->second >= 0) continue;
+        idx = it->second & ::std::numeric_limits<int64_t>::max();
+        grouped_vec.insert(grouped_vec.end(), ::std::make_move_iterator(vecX[idx].begin()),
+                           ::std::make_move_iterator(vecX[idx].end()));
+        it->second = static_cast<int64_t>(offs.size() - 1) | ~(::std::numeric_limits<int64_t>::max());
+        offs.emplace_back(grouped_vec.size());
+      }
+    }
+
+    /// finalize:  append the singletons of map to grouped_vec.
+    void group_singles(supercontainer_type & map, subcontainer_type & grouped_vec) {
+      int64_t idx;
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->second < 0) continue;
+        idx = it->second;
+        it->second = grouped_vec.size();
+        grouped_vec.emplace_back(::std::move(vec1[idx]));
+      }
+    }
+
     template <typename InputIt>
     InputIt partition_input(InputIt first, InputIt last) {
       return ::std::stable_partition(first, last, splitter);
@@ -1668,7 +2015,9 @@ class densehash_multimap {
 
       if (iter->second < 0) {
         // multiple entries
-        return vecX[iter->second &  ::std::numeric_limits<int64_t>::max()].size();
+        int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+        if (grouped) return offsets[idx + 1] - offsets[idx];
+        return vecX[idx].size();
       } else {
         return 1;
       }
@@ -1687,7 +2036,10 @@ class densehash_multimap {
       if (iter->second >= 0)  return ::std::make_pair(vec1.begin() + iter->second, vec1.begin() + iter->second + 1);
 
       // found, has multiple values
-      subcontainer_type & vec = vecX[iter->second & ::std::numeric_limits<int64_t>::max()];
+      int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+      if (grouped) return ::std::make_pair(vec1.begin() + offsets[idx], vec1.begin() + offsets[idx + 1]);
+
+      subcontainer_type & vec = vecX[idx];
 
       return std::make_pair(vec.begin(), vec.end());
 
@@ -1702,7 +2054,10 @@ class densehash_multimap {
       if (iter->second >= 0)  return ::std::make_pair(vec1.cbegin() + iter->second, vec1.cbegin() + iter->second + 1);
 
       // found, has multiple values
-      subcontainer_type & vec = vecX[iter->second & ::std::numeric_limits<int64_t>::max()];
+      int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+      if (grouped) return ::std::make_pair(vec1.cbegin() + offsets[idx], vec1.cbegin() + offsets[idx + 1]);
+
+      subcontainer_type const & vec = vecX[idx];
 
       return std::make_pair(vec.cbegin(), vec.cend());
 
@@ -1719,7 +2074,7 @@ class densehash_multimap {
 			   Equal(specials.generate(0), specials.generate(1))),
 	   upper_map(bucket_count / 2, Hash(),
 			   Equal(specials.invert(specials.generate(0)), specials.invert(specials.generate(1)))),
-			   s(0UL)
+			   s(0UL), grouped(false)
     {
     	lower_map.set_empty_key(specials.generate(0));
     	lower_map.set_deleted_key(specials.generate(1));
@@ -1781,7 +2136,10 @@ class densehash_multimap {
       vs.reserve(size());
 
       for (auto it = lower_map.begin(); it != lower_map.end(); ++it) {
-        if (it->second < 0) {
+        if ((it->second < 0) && grouped) {
+          int64_t idx = it->second & ::std::numeric_limits<int64_t>::max();
+          vs.insert(vs.end(), vec1.begin() + offsets[idx], vec1.begin() + offsets[idx + 1]);
+        } else if (it->second < 0) {
           auto it2 = vecX[it->second & ::std::numeric_limits<int64_t>::max()].begin();
           auto max2 = vecX[it->second & ::std::numeric_limits<int64_t>::max()].end();
           for (; it2 != max2; ++it2) {
@@ -1792,7 +2150,10 @@ class densehash_multimap {
         }
       }
       for (auto it = upper_map.begin(); it != upper_map.end(); ++it) {
-        if (it->second < 0) {
+        if ((it->second < 0) && grouped) {
+          int64_t idx = it->second & ::std::numeric_limits<int64_t>::max();
+          vs.insert(vs.end(), vec1.begin() + offsets[idx], vec1.begin() + offsets[idx + 1]);
+        } else if (it->second < 0) {
           auto it2 = vecX[it->second & ::std::numeric_limits<int64_t>::max()].begin();
           auto max2 = vecX[it->second & ::std::numeric_limits<int64_t>::max()].end();
           for (; it2 != max2; ++it2) {
@@ -1825,6 +2186,8 @@ class densehash_multimap {
     void reset() {
     	decltype(vec1) tmp1;  vec1.swap(tmp1);
     	decltype(vecX) tmpX;  vecX.swap(tmpX);
+    	::std::vector<int64_t>().swap(offsets);
+    	grouped = false;
     	lower_map.clear();
     	upper_map.clear();
     	s = 0UL;
@@ -1833,6 +2196,8 @@ class densehash_multimap {
     void clear() {
       vec1.clear();
       vecX.clear();
+      offsets.clear();
+      grouped = false;
       lower_map.clear_no_resize();
       upper_map.clear_no_resize();
       s = 0UL;
@@ -1859,6 +2224,51 @@ class densehash_multimap {
       return static_cast<float>(size()) / static_cast<float>(bucket_count());
     }
 
+    /// table health statistics of the key tables.  entries are unique keys; bytes include the value vectors.  O(buckets).
+    ::fsc::sparsehash::table_stats stats() const {
+      size_t vec_bytes = vec1.capacity() * sizeof(typename subcontainer_type::value_type) +
+          vecX.capacity() * sizeof(subcontainer_type);
+      for (auto const & v : vecX) vec_bytes += v.capacity() * sizeof(typename subcontainer_type::value_type);
+      vec_bytes += offsets.capacity() * sizeof(int64_t);
+      ::fsc::sparsehash::table_stats st = ::fsc::sparsehash::get_table_stats(lower_map, vec_bytes);
+      st.merge(::fsc::sparsehash::get_table_stats(upper_map));
+      return st;
+    }
+
+    /**
+     * @brief regroup the entries by key into 1 contiguous array, indexed by the key tables (CSR).
+     * @details  the entries of keys with multiple entries are copied out of their separate vectors, key by key, into vec1,
+     *          followed by the singletons.  key j with multiple entries then has the range [offsets[j], offsets[j+1]) of vec1,
+     *          so equal_range and count are 1 probe and the entries are read sequentially.  the per key vectors and
+     *          the unused entries left in vec1 by erase are freed.
+     *          insert and erase go back to separate vectors first, so call finalize again after the last update.  O(n)
+     */
+    void finalize() {
+      if (grouped) return;
+
+      subcontainer_type grouped_vec;
+      grouped_vec.reserve(s);
+      ::std::vector<int64_t> offs;
+      offs.reserve(vecX.size() + 1);
+      offs.emplace_back(0);
+
+      // multiple entries first, so that the ranges are back to back.
+      group_multiples(lower_map, grouped_vec, offs);
+      group_multiples(upper_map, grouped_vec, offs);
+      group_singles(lower_map, grouped_vec);
+      group_singles(upper_map, grouped_vec);
+
+      vec1.swap(grouped_vec);
+      decltype(vecX) tmpX;  vecX.swap(tmpX);
+      offsets.swap(offs);
+      grouped = true;
+    }
+
+    /// whether the entries are grouped by key, i.e. finalize() was called with no update since.
+    bool is_finalized() const {
+      return grouped;
+    }
+
 
 
 
@@ -1872,6 +2282,8 @@ class densehash_multimap {
 
         if (first == last) return;
 
+        this->ungroup();
+
 //        auto middle = partition_input(first, last);
 //
 //        lower_map.resize(static_cast<float>(lower_map.size() + std::distance(first, middle)) );
@@ -1914,6 +2326,7 @@ class densehash_multimap {
 
       if (first == last) return 0;
 
+      this->ungroup();
 
       size_t before = s;
 
@@ -1936,6 +2349,8 @@ class densehash_multimap {
 
       if (first == last) return 0;
 
+      this->ungroup();
+
       size_t before = s;
 
 //      auto middle = partition_input(first, last);
@@ -1955,6 +2370,8 @@ class densehash_multimap {
 
       if (this->size() == 0) return 0;
 
+      this->ungroup();
+
       size_t before = s;
 
       erase_impl(pred, lower_map);
@@ -1975,7 +2392,7 @@ class densehash_multimap {
 
     inline bool exists(Key const & key) const {
       if (splitter(key)) {
-        return upper_map.find(key) != upper_map.end();
+        return lower_map.find(key) != lower_map.end();
       } else {
         return upper_map.find(key) != upper_map.end();
       }
@@ -1997,6 +2414,33 @@ class densehash_multimap {
     }
     // NO bucket interfaces
 
+    /// prefetch the bucket for a key, e.g. a few queries ahead of its lookup.
+    inline void prefetch(Key const & key) const {
+      if (splitter(key)) {
+        ::fsc::sparsehash::prefetch_bucket(lower_map, lower_map.hash_funct()(key));
+      } else {
+        ::fsc::sparsehash::prefetch_bucket(upper_map, upper_map.hash_funct()(key));
+      }
+    }
+
+    /// batch count.  buckets are prefetched a block of queries at a time.
+    void count(Key const * queries, size_t const n, size_type * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, lower_map.hash_funct(),
+          [this](Key const & k) -> supercontainer_type const & { return splitter(k) ? lower_map : upper_map; },
+          [this, queries, results](size_t const i) {
+        results[i] = this->count(queries[i]);
+      });
+    }
+
+    /// batch find.  results[i] is the range of entries for queries[i].
+    void equal_range(Key const * queries, size_t const n, ::std::pair<const_iterator, const_iterator> * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, lower_map.hash_funct(),
+          [this](Key const & k) -> supercontainer_type const & { return splitter(k) ? lower_map : upper_map; },
+          [this, queries, results](size_t const i) {
+        results[i] = this->equal_range(queries[i]);
+      });
+    }
+
 };
 
 
@@ -2043,8 +2487,26 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
     supercontainer_type map;
     size_t s;
 
+    /// after finalize():  the entries of multiple entry key j are vec1[offsets[j], offsets[j+1]), and vecX is empty.
+    ::std::vector<int64_t> offsets;
+    bool grouped;
+
     // TODO: provide iterator implementation for  begin/end.
 
+    /// back to separate vectors for multiple entries, before an update.  the runs stay in vec1 unused until the next finalize.
+    void ungroup() {
+      if (!grouped) return;
+
+      vecX.clear();
+      vecX.resize(offsets.size() - 1);
+      for (size_t j = 0; j + 1 < offsets.size(); ++j) {
+        vecX[j].assign(::std::make_move_iterator(vec1.begin() + offsets[j]),
+                       ::std::make_move_iterator(vec1.begin() + offsets[j + 1]));
+      }
+      ::std::vector<int64_t>().swap(offsets);
+      grouped = false;
+    }
+
 
   public:
     using key_type              = Key;
@@ -2067,7 +2529,7 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
     densehash_multimap(size_type bucket_count = 128) :
 		   specials(),
 		   map(bucket_count, Hash(),
-				   Equal(specials.generate(0), specials.generate(1))), s(0UL)
+				   Equal(specials.generate(0), specials.generate(1))), s(0UL), grouped(false)
 		{
 		map.set_empty_key(specials.generate(0));
 		map.set_deleted_key(specials.generate(1));
@@ -2120,7 +2582,10 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       int64_t idx;
       for (auto it = map.begin(); it != map.end(); ++it) {
-        if (it->second < 0) {
+        if ((it->second < 0) && grouped) {
+          idx = it->second & ::std::numeric_limits<int64_t>::max();
+          vs.insert(vs.end(), vec1.begin() + offsets[idx], vec1.begin() + offsets[idx + 1]);
+        } else if (it->second < 0) {
           idx = it->second & ::std::numeric_limits<int64_t>::max();
           auto max2 = vecX[idx].end();
           for (auto it2 = vecX[idx].begin(); it2 != max2; ++it2) {
@@ -2153,6 +2618,8 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
     void reset() {
     	decltype(vec1) tmp1;  vec1.swap(tmp1);
     	decltype(vecX) tmpX;  vecX.swap(tmpX);
+    	::std::vector<int64_t>().swap(offsets);
+    	grouped = false;
     	map.clear();
     	s = 0UL;
     }
@@ -2160,6 +2627,8 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
     void clear() {
       vec1.clear();
       vecX.clear();
+      offsets.clear();
+      grouped = false;
       map.clear_no_resize();
       s = 0UL;
     }
@@ -2184,6 +2653,61 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
       return static_cast<float>(map.size()) / static_cast<float>(map.bucket_count());
     }
 
+    /// table health statistics of the key table.  entries are unique keys; bytes include the value vectors.  O(buckets).
+    ::fsc::sparsehash::table_stats stats() const {
+      size_t vec_bytes = vec1.capacity() * sizeof(typename subcontainer_type::value_type) +
+          vecX.capacity() * sizeof(subcontainer_type);
+      for (auto const & v : vecX) vec_bytes += v.capacity() * sizeof(typename subcontainer_type::value_type);
+      vec_bytes += offsets.capacity() * sizeof(int64_t);
+      return ::fsc::sparsehash::get_table_stats(map, vec_bytes);
+    }
+
+    /**
+     * @brief regroup the entries by key into 1 contiguous array, indexed by the key table (CSR).
+     * @details  the entries of keys with multiple entries are copied out of their separate vectors, key by key, into vec1,
+     *          followed by the singletons.  key j with multiple entries then has the range [offsets[j], offsets[j+1]) of vec1,
+     *          so equal_range and count are 1 probe and the entries are read sequentially.  the per key vectors and
+     *          the unused entries left in vec1 by erase are freed.
+     *          insert and erase go back to separate vectors first, so call finalize again after the last update.  O(n)
+     */
+    void finalize() {
+      if (grouped) return;
+
+      subcontainer_type grouped_vec;
+      grouped_vec.reserve(s);
+      ::std::vector<int64_t> offs;
+      offs.reserve(vecX.size() + 1);
+      offs.emplace_back(0);
+
+      // multiple entries first, so that the ranges are back to back.
+      int64_t idx;
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->second >= 0) continue;
+        idx = it->second & ::std::numeric_limits<int64_t>::max();
+        grouped_vec.insert(grouped_vec.end(), ::std::make_move_iterator(vecX[idx].begin()),
+                           ::std::make_move_iterator(vecX[idx].end()));
+        it->second = static_cast<int64_t>(offs.size() - 1) | ~(::std::numeric_limits<int64_t>::max());
+        offs.emplace_back(grouped_vec.size());
+      }
+      // then singletons.
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->second < 0) continue;
+        idx = it->second;
+        it->second = grouped_vec.size();
+        grouped_vec.emplace_back(::std::move(vec1[idx]));
+      }
+
+      vec1.swap(grouped_vec);
+      decltype(vecX) tmpX;  vecX.swap(tmpX);
+      offsets.swap(offs);
+      grouped = true;
+    }
+
+    /// whether the entries are grouped by key, i.e. finalize() was called with no update since.
+    bool is_finalized() const {
+      return grouped;
+    }
+
 
 
     // choices:  sort first, then insert in ranges, or no sort, insert one by one.  second is O(n) but pays the random access and mem realloc cost
@@ -2195,6 +2719,7 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
         if (first == last) return;
 
+        this->ungroup();
 
         // get previous sizes so we know where to start from
         int64_t idx1 = vec1.size();
@@ -2270,6 +2795,8 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       if (first == last) return 0;
 
+      this->ungroup();
+
       size_t before = s;
       size_t dist = 0;
       int64_t idx;
@@ -2333,6 +2860,8 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       if (first == last) return 0;
 
+      this->ungroup();
+
       size_t before = s;
 
       int64_t idx;
@@ -2366,6 +2895,8 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       if (this->size() == 0) return 0;
 
+      this->ungroup();
+
       size_t before = s;
       size_t dist = 0;
       int64_t idx;
@@ -2427,7 +2958,9 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       if (iter->second < 0) {
         // multiple entries
-        return vecX[iter->second &  ::std::numeric_limits<int64_t>::max()].size();
+        int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+        if (grouped) return offsets[idx + 1] - offsets[idx];
+        return vecX[idx].size();
       } else {
         return 1;
       }
@@ -2448,7 +2981,10 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
       if (iter->second >= 0)  return ::std::make_pair(vec1.begin() + iter->second, vec1.begin() + iter->second + 1);
 
       // found, has multiple values
-      subcontainer_type & vec = vecX[iter->second & ::std::numeric_limits<int64_t>::max()];
+      int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+      if (grouped) return ::std::make_pair(vec1.begin() + offsets[idx], vec1.begin() + offsets[idx + 1]);
+
+      subcontainer_type & vec = vecX[idx];
 
       return std::make_pair(vec.begin(), vec.end());
 
@@ -2464,6 +3000,7 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
       // found, has multiple values
       int64_t idx = iter->second & ::std::numeric_limits<int64_t>::max();
+      if (grouped) return ::std::make_pair(vec1.cbegin() + offsets[idx], vec1.cbegin() + offsets[idx + 1]);
 
       return std::make_pair(vecX[idx].cbegin(), vecX[idx].cend());
 
@@ -2471,6 +3008,29 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
     }
     // NO bucket interfaces
 
+    /// prefetch the bucket for a key, e.g. a few queries ahead of its lookup.
+    inline void prefetch(Key const & key) const {
+      ::fsc::sparsehash::prefetch_bucket(map, map.hash_funct()(key));
+    }
+
+    /// batch count.  buckets are prefetched a block of queries at a time.
+    void count(Key const * queries, size_t const n, size_type * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, map.hash_funct(),
+          [this](Key const &) -> supercontainer_type const & { return map; },
+          [this, queries, results](size_t const i) {
+        results[i] = this->count(queries[i]);
+      });
+    }
+
+    /// batch find.  results[i] is the range of entries for queries[i].
+    void equal_range(Key const * queries, size_t const n, ::std::pair<const_iterator, const_iterator> * results) const {
+      ::fsc::sparsehash::prefetched_apply(queries, n, map.hash_funct(),
+          [this](Key const &) -> supercontainer_type const & { return map; },
+          [this, queries, results](size_t const i) {
+        results[i] = this->equal_range(queries[i]);
+      });
+    }
+
 };
 
 
@@ -0,0 +1,433 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_adaptive_map.hpp
+ * @ingroup dsc::containers
+ * @brief   distributed map that picks hashed or sorted storage from the workload, with the same interface either way.
+ * @details  hash_vs_sort and the notes in unordered_vecmap show that sorted vectors win for small per process tables and
+ *          repeat heavy input, and hash tables win for large tables and query heavy use.  adaptive_map holds a hashed
+ *          and a sorted distributed map of the same key and value types, e.g. counting_unordered_map and
+ *          counting_sorted_map, and inserts into the hashed one until policy.min_sample entries were inserted over all
+ *          processes.  it then estimates the distinct keys per process from a hyperloglog sketch of the sampled input,
+ *          the multiplicity, and the keys queried per entry inserted so far, and picks the engine with choose().  if it
+ *          picks sorted storage, the sampled entries are moved over.
+ *
+ *          the 2 engines distribute keys differently, by hash vs by splitters, so the choice is collective, from the statistics
+ *          reduced over all processes, and the same on all processes.  adapt() reevaluates later, e.g. after the build,
+ *          with the query counts of the actual use, and moves the entries if the choice changed.
+ *
+ *          it is a MapType for the kmer indices, e.g.
+ *          CountIndex<adaptive_map<counting_unordered_map<K, uint32_t, HashParams>, counting_sorted_map<K, uint32_t, SortParams> > >.
+ */
+#ifndef DISTRIBUTED_ADAPTIVE_MAP_HPP_
+#define DISTRIBUTED_ADAPTIVE_MAP_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <cmath>
+
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "containers/distributed_aggregation.hpp"
+#include "utils/filter_utils.hpp"
+#include "utils/hyperloglog.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /// local storage engine of an adaptive_map.
+  enum class adaptive_engine : int {
+    UNDECIDED = 0,  ///< still sampling.  entries are in the hashed map.
+    HASHED = 1,
+    SORTED = 2
+  };
+
+  /// thresholds for adaptive_map::choose.  same on all processes.
+  struct adaptive_policy {
+      /// entries inserted over all processes before the engine is picked.
+      size_t min_sample = 1UL << 20;
+      /// largest distinct keys per process for sorted storage.  hash_vs_sort breaks even just under 8M entries.
+      size_t sorted_max_distinct = 1UL << 23;
+      /// smallest entries per distinct key for sorted storage.  the repeats collapse in the sort, but each probes the hash table.
+      double sorted_min_multiplicity = 2.0;
+      /// largest keys queried per entry inserted for sorted storage, since each query costs a binary search.
+      double sorted_max_query_ratio = 1.0;
+  };
+
+  /**
+   * @brief distributed map with hashed or sorted storage, picked from the first inserts.  see file description.
+   * @tparam HashedMap   e.g. unordered_map, counting_unordered_map.  the default engine while sampling.
+   * @tparam SortedMap   e.g. sorted_map, counting_sorted_map, with the same key, mapped type and insert semantics.
+   */
+  template <typename HashedMap, typename SortedMap>
+  class adaptive_map {
+      static_assert(::std::is_same<typename HashedMap::key_type, typename SortedMap::key_type>::value,
+                    "adaptive map requires the same key type for both engines");
+      static_assert(::std::is_same<typename HashedMap::mapped_type, typename SortedMap::mapped_type>::value,
+                    "adaptive map requires the same mapped type for both engines");
+
+    public:
+      using hashed_map_type = HashedMap;
+      using sorted_map_type = SortedMap;
+
+      using key_type              = typename HashedMap::key_type;
+      using mapped_type           = typename HashedMap::mapped_type;
+      using value_type            = ::std::pair<key_type, mapped_type>;
+      using size_type             = size_t;
+
+      /// forward iterator over the entries of the current engine.  entries are returned by value.
+      class const_iterator : public ::std::iterator<::std::forward_iterator_tag, value_type, ptrdiff_t, value_type const *, value_type> {
+          typename HashedMap::const_iterator hit;
+          typename SortedMap::const_iterator sit;
+          bool sorted;
+          mutable value_type v;
+
+        public:
+          const_iterator() : sorted(false) {}
+          explicit const_iterator(typename HashedMap::const_iterator const & it) : hit(it), sorted(false) {}
+          explicit const_iterator(typename SortedMap::const_iterator const & it) : sit(it), sorted(true) {}
+
+          value_type operator*() const {
+            return sorted ? value_type(*sit) : value_type(*hit);
+          }
+          value_type const * operator->() const {
+            v = **this;
+            return &v;
+          }
+          const_iterator & operator++() {
+            if (sorted) ++sit; else ++hit;
+            return *this;
+          }
+          const_iterator operator++(int) {
+            const_iterator out(*this);
+            ++(*this);
+            return out;
+          }
+          bool operator==(const_iterator const & other) const {
+            return (sorted == other.sorted) && (sorted ? (sit == other.sit) : (hit == other.hit));
+          }
+          bool operator!=(const_iterator const & other) const {
+            return !(*this == other);
+          }
+      };
+
+    protected:
+      using Key = key_type;
+      using T = mapped_type;
+
+      template <typename K>
+      using SketchHash = typename ::std::conditional<::bliss::common::is_kmer<K>::value,
+          ::bliss::kmer::hash::farm<K, false>, ::std::hash<K> >::type;
+
+      HashedMap hashed;
+      SortedMap sorted;
+
+      const mxx::comm& comm;
+
+      adaptive_engine engine;
+      adaptive_policy policy;
+
+      /// sketch of the sampled input keys, merged over all processes.
+      ::bliss::utils::hyperloglog64<12> sketch;
+      /// entries inserted over all processes while sampling.
+      size_t sampled;
+
+      /// entries inserted and keys queried on this process.
+      size_t inserted;
+      mutable size_t queried;
+
+      static inline Key const & get_key(Key const & x) { return x; }
+      template <typename V>
+      static inline Key const & get_key(::std::pair<Key, V> const & x) { return x.first; }
+
+      /// add the input keys to the sketch.  collective.
+      template <typename V>
+      void sample(::std::vector<V> const & input) {
+        ::bliss::utils::hyperloglog64<12> local;
+        SketchHash<Key> hash;
+        for (auto const & x : input) local.update(hash(get_key(x)));
+        if (comm.size() > 1)
+          local.get_registers() = ::mxx::allreduce(local.get_registers(), ::mxx::max<uint8_t>(), comm);
+        sketch.merge(local);
+        sampled += (comm.size() > 1) ? ::mxx::allreduce(input.size(), comm) : input.size();
+      }
+
+      /// keys queried per entry inserted, over all processes.  collective.
+      double query_ratio() const {
+        size_t q = queried, n = inserted;
+        if (comm.size() > 1) {
+          q = ::mxx::allreduce(q, comm);
+          n = ::mxx::allreduce(n, comm);
+        }
+        return static_cast<double>(q) / static_cast<double>(::std::max(n, static_cast<size_t>(1)));
+      }
+
+      /**
+       * @brief redistribute the sorted engine, so each key is in 1 entry on 1 process.  collective.
+       * @details  the sorted maps reduce the inserted runs lazily, and on 1 process only sort them before a query.  done
+       *        before the queries, size and aggregations, so both engines answer the same.  get_multiplicity redistributes.
+       */
+      void settle() const {
+        sorted.get_multiplicity();
+      }
+
+      /// make e the engine, moving the entries over.  collective.
+      void switch_to(adaptive_engine const & e) {
+        bool to_sorted = (e == adaptive_engine::SORTED);
+        bool from_sorted = (engine == adaptive_engine::SORTED);
+        engine = e;
+        if (to_sorted == from_sorted) return;
+
+        BL_BENCH_INIT(adapt);
+
+        BL_BENCH_START(adapt);
+        ::std::vector<value_type> entries;
+        if (from_sorted) {
+          settle();
+          sorted.to_vector(entries);
+          sorted.reset();
+        } else {
+          hashed.to_vector(entries);
+          hashed.reset();
+        }
+        BL_BENCH_END(adapt, "extract", entries.size());
+
+        BL_BENCH_START(adapt);
+        if (to_sorted) sorted.insert(entries);
+        else hashed.insert(entries);
+        BL_BENCH_END(adapt, "insert", local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(adapt, "adaptive_map:switch", comm);
+      }
+
+    public:
+
+      adaptive_map(const mxx::comm& _comm) : hashed(_comm), sorted(_comm), comm(_comm),
+          engine(adaptive_engine::UNDECIDED), sampled(0), inserted(0), queried(0) {}
+
+      virtual ~adaptive_map() {};
+
+      /**
+       * @brief the engine for the workload statistics, reduced over all processes.
+       * @param distinct       distinct keys per process.
+       * @param multiplicity   entries inserted per distinct key.
+       * @param query_ratio    keys queried per entry inserted.
+       */
+      static adaptive_engine choose(adaptive_policy const & policy, double const & distinct,
+                                    double const & multiplicity, double const & query_ratio) {
+        return ((distinct <= static_cast<double>(policy.sorted_max_distinct)) &&
+                (multiplicity >= policy.sorted_min_multiplicity) &&
+                (query_ratio <= policy.sorted_max_query_ratio)) ?
+            adaptive_engine::SORTED : adaptive_engine::HASHED;
+      }
+
+      adaptive_engine get_engine() const {
+        return engine;
+      }
+      /// set the thresholds.  before the first insert, and the same on all processes.
+      void set_policy(adaptive_policy const & p) {
+        policy = p;
+      }
+      adaptive_policy const & get_policy() const {
+        return policy;
+      }
+
+      /// pick the engine now, instead of from the sample, e.g. from a previous run.  collective.
+      void set_engine(adaptive_engine const & e) {
+        switch_to(e == adaptive_engine::UNDECIDED ? adaptive_engine::HASHED : e);
+      }
+
+      /**
+       * @brief reevaluate the engine with the current size and the entries inserted and keys queried so far.  collective.
+       * @details  e.g. after the build, once the query load is known.  moves the entries if the choice changed.
+       * @return  the engine.
+       */
+      adaptive_engine adapt() {
+        size_t n = (comm.size() > 1) ? ::mxx::allreduce(inserted, comm) : inserted;
+        double distinct = static_cast<double>(::std::max(size(), static_cast<size_t>(1)));
+        double ratio = query_ratio();
+        switch_to(choose(policy, distinct / static_cast<double>(comm.size()),
+                         static_cast<double>(n) / distinct, ratio));
+        return engine;
+      }
+
+      /// the hashed engine.  holds the entries unless the engine is SORTED.
+      HashedMap & get_hashed_map() { return hashed; }
+      HashedMap const & get_hashed_map() const { return hashed; }
+      /// the sorted engine.  holds the entries if the engine is SORTED.
+      SortedMap & get_sorted_map() { return sorted; }
+      SortedMap const & get_sorted_map() const { return sorted; }
+
+      /**
+       * @brief insert into the current engine.  while sampling, the input is sketched first, and the engine picked once
+       *        policy.min_sample entries were inserted over all processes.  collective.
+       * @param input  entries, or keys for the counting maps.  may be changed.
+       */
+      template <typename V, class Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<V> & input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        inserted += input.size();
+        if (engine == adaptive_engine::SORTED) return sorted.insert(input, sorted_input, pred);
+        if (engine == adaptive_engine::HASHED) return hashed.insert(input, sorted_input, pred);
+
+        sample(input);
+        size_t count = hashed.insert(input, sorted_input, pred);
+
+        if (sampled >= policy.min_sample) {
+          double distinct = ::std::max(sketch.estimate(), 1.0);
+          switch_to(choose(policy, distinct / static_cast<double>(comm.size()),
+                           static_cast<double>(sampled) / distinct, query_ratio()));
+        }
+        return count;
+      }
+
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
+                                               Predicate const& pred = Predicate()) const {
+        queried += keys.size();
+        if (engine != adaptive_engine::SORTED) return hashed.find(keys, sorted_input, pred);
+        settle();
+        return sorted.find(keys, sorted_input, pred);
+      }
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(Predicate const& pred = Predicate()) const {
+        return (engine == adaptive_engine::SORTED) ? sorted.find(pred) : hashed.find(pred);
+      }
+
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate()) const {
+        queried += keys.size();
+        if (engine != adaptive_engine::SORTED) return hashed.count(keys, sorted_input, pred);
+        settle();
+        return sorted.count(keys, sorted_input, pred);
+      }
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(Predicate const& pred = Predicate()) const {
+        return (engine == adaptive_engine::SORTED) ? sorted.count(pred) : hashed.count(pred);
+      }
+
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate()) {
+        return (engine == adaptive_engine::SORTED) ? sorted.erase(keys, sorted_input, pred) : hashed.erase(keys, sorted_input, pred);
+      }
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(Predicate const& pred = Predicate()) {
+        return (engine == adaptive_engine::SORTED) ? sorted.erase(pred) : hashed.erase(pred);
+      }
+
+      /// number of entries with each value in [0, max_value].  collective.
+      ::std::vector<size_t> histogram(size_t const & max_value) const {
+        if (engine != adaptive_engine::SORTED) return hashed.histogram(max_value);
+        settle();
+        return ::dsc::aggregate::histogram(sorted.cbegin(), sorted.cend(), max_value, comm);
+      }
+
+      /// the n entries with the largest values, in decreasing order.  collective.
+      template <typename Less = ::dsc::aggregate::value_less>
+      ::std::vector<::std::pair<Key, T> > top_n(size_t const & n, Less const & less = Less()) const {
+        if (engine != adaptive_engine::SORTED) return hashed.top_n(n, less);
+        settle();
+        return ::dsc::aggregate::top_n(sorted.cbegin(), sorted.cend(), n, less, comm);
+      }
+
+      /// reduce f(entry) over all entries, with init the identity of reduce.  collective.
+      template <typename V, typename MapOp, typename ReduceOp>
+      V map_reduce(MapOp const & f, ReduceOp const & reduce, V const & init) const {
+        if (engine != adaptive_engine::SORTED) return hashed.map_reduce(f, reduce, init);
+        settle();
+        return ::dsc::aggregate::map_reduce(sorted.cbegin(), sorted.cend(), f, reduce, init, comm);
+      }
+
+      void set_distribution_policy(::imxx::distribution_policy const & p) {
+        hashed.set_distribution_policy(p);
+        sorted.set_distribution_policy(p);
+      }
+      ::imxx::distribution_policy const & get_distribution_policy() const {
+        return hashed.get_distribution_policy();
+      }
+
+      /// local entries of the current engine.  for the sorted engine, valid after a collective call that redistributes, e.g. size().
+      const_iterator cbegin() const {
+        return (engine == adaptive_engine::SORTED) ? const_iterator(sorted.cbegin()) : const_iterator(hashed.cbegin());
+      }
+      const_iterator cend() const {
+        return (engine == adaptive_engine::SORTED) ? const_iterator(sorted.cend()) : const_iterator(hashed.cend());
+      }
+
+      void to_vector(::std::vector<::std::pair<Key, T> > & result) const {
+        if (engine == adaptive_engine::SORTED) sorted.to_vector(result);
+        else hashed.to_vector(result);
+      }
+      ::std::vector<::std::pair<Key, T> > to_vector() const {
+        ::std::vector<::std::pair<Key, T> > result;
+        to_vector(result);
+        return result;
+      }
+      void keys(::std::vector<Key> & result) const {
+        if (engine == adaptive_engine::SORTED) sorted.keys(result);
+        else hashed.keys(result);
+      }
+      /// chunked scan of the local entries of the current engine.  see map_base::scan.
+      ::dsc::scan_cursor<Key, T> scan(size_t const & chunk_size) const {
+        return (engine == adaptive_engine::SORTED) ? sorted.scan(chunk_size) : hashed.scan(chunk_size);
+      }
+
+      float get_multiplicity() const {
+        return (engine == adaptive_engine::SORTED) ? sorted.get_multiplicity() : hashed.get_multiplicity();
+      }
+      void compact(bool rebalance = false) {
+        if (engine == adaptive_engine::SORTED) sorted.compact(rebalance);
+        else hashed.compact(rebalance);
+      }
+
+      /// collective.
+      size_t size() const {
+        if (engine != adaptive_engine::SORTED) return hashed.size();
+        settle();
+        return sorted.size();
+      }
+      size_t local_size() const {
+        return (engine == adaptive_engine::SORTED) ? sorted.local_size() : hashed.local_size();
+      }
+      /// collective.
+      bool empty() const {
+        return (engine == adaptive_engine::SORTED) ? sorted.empty() : hashed.empty();
+      }
+
+      /// remove all entries.  the engine stays.  collective.
+      void clear() {
+        hashed.clear();
+        sorted.clear();
+      }
+      /// remove all entries and release the memory.  the engine stays.  collective.
+      void reset() {
+        hashed.reset();
+        sorted.reset();
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_ADAPTIVE_MAP_HPP_ */
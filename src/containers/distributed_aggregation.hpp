@@ -0,0 +1,144 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_aggregation.hpp
+ * @ingroup
+ * @brief   collective aggregation over the local entries of a distributed map:  value histogram, top n by value, and map/reduce.
+ * @details  each process aggregates its local range, and only the aggregates are communicated, so the map entries are not
+ *          copied or gathered.  these are used by the distributed maps' histogram, top_n and map_reduce methods.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_AGGREGATION_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_AGGREGATION_HPP_
+
+#include <vector>
+#include <iterator>   // iterator_traits
+#include <algorithm>  // push_heap, sort_heap, merge, min
+#include <functional> // less, plus
+#include <type_traits>
+#include <cstdint>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace dsc {
+
+  namespace aggregate {
+
+    /// compares (key, value) entries by value.
+    struct value_less {
+        template <typename E1, typename E2>
+        inline bool operator()(E1 const & x, E2 const & y) const { return x.second < y.second; }
+    };
+
+    /**
+     * @brief number of entries with each value in [0, max_value], e.g. the kmer spectrum of a counting map.  collective.
+     * @details  values larger than max_value are counted in the last bin.  same result on all processes.
+     */
+    template <typename Iter>
+    ::std::vector<size_t> histogram(Iter first, Iter last, size_t const & max_value, ::mxx::comm const & comm) {
+      ::std::vector<size_t> hist(max_value + 1, 0);
+      for (; first != last; ++first) {
+        ++hist[::std::min(static_cast<size_t>((*first).second), max_value)];
+      }
+      if (comm.size() > 1) hist = ::mxx::allreduce(hist, ::std::plus<size_t>(), comm);
+      return hist;
+    }
+
+    /**
+     * @brief reduce f(entry) over all entries.  collective.
+     * @details  each process folds its entries starting from init, then the partial results are reduced across processes.
+     *          reduce has to be associative and commutative, and init its identity.  V has to be trivially copyable.
+     */
+    template <typename Iter, typename V, typename MapOp, typename ReduceOp>
+    V map_reduce(Iter first, Iter last, MapOp const & f, ReduceOp const & reduce, V const & init, ::mxx::comm const & comm) {
+      V result = init;
+      for (; first != last; ++first) result = reduce(result, f(*first));
+      if (comm.size() > 1) result = ::mxx::allreduce(result, reduce, comm);
+      return result;
+    }
+
+    /**
+     * @brief the n entries with the largest values, in decreasing order.  collective.
+     * @details  each process selects its local top n, then the lists are merged pairwise up a binomial tree to rank 0, keeping
+     *          the top n at each step, and broadcast.  each process sends at most n entries once, instead of all entries.
+     *          ties are broken arbitrarily.  entries are sent as bytes, as in map_base::save.
+     * @param less  compares 2 entries, possibly 1 with const key, e.g. value_less.
+     */
+    template <typename Iter, typename Less>
+    ::std::vector<::std::pair<typename ::std::remove_const<typename ::std::iterator_traits<Iter>::value_type::first_type>::type,
+                              typename ::std::iterator_traits<Iter>::value_type::second_type> >
+    top_n(Iter first, Iter last, size_t const & n, Less const & less, ::mxx::comm const & comm) {
+      using E = typename ::std::iterator_traits<Iter>::value_type;
+      using Pair = ::std::pair<typename ::std::remove_const<typename E::first_type>::type, typename E::second_type>;
+
+      auto greater = [&less](Pair const & x, Pair const & y) { return less(y, x); };
+
+      // local top n, via a min heap.  Pair since map entries have const keys.
+      ::std::vector<Pair> top;
+      top.reserve(n);
+      for (; first != last; ++first) {
+        if (top.size() < n) {
+          top.emplace_back(*first);
+          ::std::push_heap(top.begin(), top.end(), greater);
+        } else if ((n > 0) && less(top.front(), *first)) {
+          ::std::pop_heap(top.begin(), top.end(), greater);
+          top.back() = *first;
+          ::std::push_heap(top.begin(), top.end(), greater);
+        }
+      }
+      ::std::sort_heap(top.begin(), top.end(), greater);
+
+      if (comm.size() == 1) return top;
+
+      // binomial tree merge to rank 0.
+      int rank = comm.rank();
+      int p = comm.size();
+      ::std::vector<Pair> other;
+      ::std::vector<Pair> merged;
+      for (int s = 1; s < p; s <<= 1) {
+        if (rank & s) {
+          uint64_t count = top.size();
+          MPI_Send(&count, 1, MPI_UINT64_T, rank - s, 0, comm);
+          MPI_Send(top.data(), count * sizeof(Pair), MPI_BYTE, rank - s, 1, comm);
+          break;
+        } else if (rank + s < p) {
+          uint64_t count = 0;
+          MPI_Recv(&count, 1, MPI_UINT64_T, rank + s, 0, comm, MPI_STATUS_IGNORE);
+          other.resize(count);
+          MPI_Recv(other.data(), count * sizeof(Pair), MPI_BYTE, rank + s, 1, comm, MPI_STATUS_IGNORE);
+
+          merged.resize(top.size() + other.size());
+          ::std::merge(top.begin(), top.end(), other.begin(), other.end(), merged.begin(), greater);
+          merged.resize(::std::min(n, merged.size()));
+          top.swap(merged);
+        }
+      }
+
+      uint64_t count = top.size();
+      MPI_Bcast(&count, 1, MPI_UINT64_T, 0, comm);
+      top.resize(count);
+      MPI_Bcast(top.data(), count * sizeof(Pair), MPI_BYTE, 0, comm);
+
+      return top;
+    }
+
+  } // namespace aggregate
+
+} // namespace dsc
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_AGGREGATION_HPP_ */
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_count_min_sketch.hpp
+ * @ingroup dsc::containers
+ * @brief   distributed Count-Min sketch, for approximate counting of keys in fixed memory.
+ * @details  each key is reduced to its 64 bit storage hash, the fingerprint, before any communication.  the high 16 bits of
+ *          the fingerprint select the virtual bucket, hence the owner rank (as for SingleHashMapParams maps), so only
+ *          the 8 byte fingerprints are distributed, and each process holds a depth x width sketch of the fingerprints it owns.
+ *
+ *          an estimate is never below the true count, and exceeds it by at most epsilon * N with probability 1 - delta,
+ *          where N is the number of insertions into the owner's sketch.  width = ceil(e / epsilon), depth = ceil(ln(1 / delta)),
+ *          so memory per process depends only on the error rate, not on the number of distinct keys.  with conservative
+ *          update, an insertion only raises the counters that are at the current minimum, which gives the same bound and
+ *          usually much smaller overestimates, but does not support decrement or merging of sketches.
+ *
+ *          counters saturate at the maximum of Counter instead of wrapping around.
+ */
+#ifndef DISTRIBUTED_COUNT_MIN_SKETCH_HPP_
+#define DISTRIBUTED_COUNT_MIN_SKETCH_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+
+#include <mxx/collective.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/bucket_table.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /// estimated count of a key, and the maximum overestimate with probability 1 - delta.
+  template <typename Counter>
+  struct approximate_count {
+      Counter count;
+      size_t error;
+
+      /// lower and upper bound of the true count.
+      size_t lower() const { return (count > error) ? count - error : 0; }
+      size_t upper() const { return count; }
+  };
+
+  /**
+   * @brief Count-Min sketch partitioned by the key hash.  all operations are collective, except the accessors.
+   * @tparam MapParams     parameters of the hashed map type, for the input transform and the storage hash.  the storage
+   *                       hash has to mix all 64 bits, e.g. murmur or farm, since the fingerprint selects the owner too.
+   * @tparam Counter       counter type.  smaller counters saturate sooner, and take less memory.
+   * @tparam Conservative  conservative update.
+   */
+  template<typename Key,
+    template <typename> class MapParams,
+    typename Counter = uint32_t,
+    bool Conservative = true
+  >
+  class count_min_sketch {
+      static_assert(::std::is_integral<Counter>::value && ::std::is_unsigned<Counter>::value,
+                    "count_min_sketch counter has to be an unsigned integer.");
+
+    protected:
+      using InputTransform = typename MapParams<Key>::InputTransform;
+      using StoreTransformedFunc = typename MapParams<Key>::StorageTransformedFunction;
+
+      /// owner of a fingerprint, from its high bits, as map_base::hash_to_bucket with single_hash.
+      struct FingerprintToRank {
+          ::dsc::bucket_table buckets;
+
+          FingerprintToRank(::dsc::bucket_table const & table) : buckets(table) {};
+
+          inline int operator()(uint64_t const & fp) const {
+            return buckets[fp >> (64 - ::dsc::bucket_table::bits)];
+          }
+      } fp_to_rank;
+
+    public:
+      using key_type = Key;
+      using count_type = Counter;
+      using size_type = size_t;
+      using estimate_type = approximate_count<Counter>;
+
+    protected:
+      const mxx::comm& comm;
+
+      InputTransform trans;
+      StoreTransformedFunc hash;
+
+      double epsilon;
+      double delta;
+      size_t width;
+      size_t depth;
+
+      /// depth rows of width counters, row major.
+      ::std::vector<Counter> counters;
+
+      /// insertions into the sketch of each process.  the same on all processes.
+      ::std::vector<size_t> totals;
+
+      /// column of the fingerprint in row i.  rows use independent remixes of the low bits, since the high bits select the owner.
+      inline size_t column(uint64_t const & fp, size_t const & i) const {
+        uint64_t x = fp + (i + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= (x >> 31);
+        return static_cast<size_t>(x % width);
+      }
+
+      inline Counter local_estimate(uint64_t const & fp) const {
+        Counter c = ::std::numeric_limits<Counter>::max();
+        for (size_t i = 0; i < depth; ++i) {
+          c = ::std::min(c, counters[i * width + column(fp, i)]);
+        }
+        return c;
+      }
+
+      inline void local_insert(uint64_t const & fp) {
+        const Counter cmax = ::std::numeric_limits<Counter>::max();
+        if (Conservative) {
+          Counter m = local_estimate(fp);
+          if (m == cmax) return;
+          ++m;
+          for (size_t i = 0; i < depth; ++i) {
+            Counter & c = counters[i * width + column(fp, i)];
+            if (c < m) c = m;
+          }
+        } else {
+          for (size_t i = 0; i < depth; ++i) {
+            Counter & c = counters[i * width + column(fp, i)];
+            if (c < cmax) ++c;
+          }
+        }
+      }
+
+      /// fingerprints of the keys, input transformed first.  keys are transformed in place.
+      ::std::vector<uint64_t> fingerprints(::std::vector<Key> & keys) const {
+        ::std::transform(keys.begin(), keys.end(), keys.begin(), trans);
+        ::std::vector<uint64_t> fps;
+        fps.reserve(keys.size());
+        for (auto const & k : keys) fps.emplace_back(hash(k));
+        return fps;
+      }
+
+      size_t error_of(int const & rank) const {
+        return static_cast<size_t>(::std::ceil(epsilon * static_cast<double>(totals[rank])));
+      }
+
+    public:
+      /**
+       * @brief sketch with the given error rate.  local.
+       * @param _epsilon  relative error:  estimates exceed the true count by at most _epsilon times the owner's insertions...
+       * @param _delta    ...with probability 1 - _delta.
+       */
+      count_min_sketch(const mxx::comm& _comm, double const & _epsilon = 1.0e-5, double const & _delta = 0.01) :
+        fp_to_rank(::dsc::bucket_table(_comm.size())), comm(_comm),
+        epsilon(_epsilon), delta(_delta),
+        width(width_for(_epsilon)), depth(depth_for(_delta)),
+        counters(width * depth, 0), totals(_comm.size(), 0) {}
+
+      virtual ~count_min_sketch() {};
+
+      /// number of counters per row for the relative error epsilon.
+      static size_t width_for(double const & epsilon) {
+        if (!(epsilon > 0.0) || !(epsilon < 1.0))
+          throw ::std::invalid_argument("count_min_sketch: epsilon has to be in (0, 1).");
+        return static_cast<size_t>(::std::ceil(::std::exp(1.0) / epsilon));
+      }
+      /// number of rows for the failure probability delta.
+      static size_t depth_for(double const & delta) {
+        if (!(delta > 0.0) || !(delta < 1.0))
+          throw ::std::invalid_argument("count_min_sketch: delta has to be in (0, 1).");
+        return ::std::max(static_cast<size_t>(1), static_cast<size_t>(::std::ceil(::std::log(1.0 / delta))));
+      }
+      /// bytes of the sketch per process, for the error rate.
+      static size_t bytes_for(double const & epsilon, double const & delta) {
+        return width_for(epsilon) * depth_for(delta) * sizeof(Counter);
+      }
+
+      size_t get_width() const { return width; }
+      size_t get_depth() const { return depth; }
+      double get_epsilon() const { return epsilon; }
+      double get_delta() const { return delta; }
+      size_t local_bytes() const { return counters.size() * sizeof(Counter); }
+
+      /// insertions into this process's sketch.
+      size_t local_size() const { return totals[comm.rank()]; }
+      /// insertions into all sketches.
+      size_t size() const {
+        size_t s = 0;
+        for (auto t : totals) s += t;
+        return s;
+      }
+
+      /// maximum overestimate of any key, with probability 1 - delta.
+      size_t error_bound() const {
+        size_t e = 0;
+        for (int r = 0; r < comm.size(); ++r) e = ::std::max(e, error_of(r));
+        return e;
+      }
+
+      ::dsc::bucket_table const & get_bucket_table() const {
+        return fp_to_rank.buckets;
+      }
+
+      /// zero all counters.  local, but should be called on all processes to keep the totals consistent.
+      void clear() {
+        ::std::fill(counters.begin(), counters.end(), 0);
+        ::std::fill(totals.begin(), totals.end(), 0);
+      }
+
+      /**
+       * @brief count 1 occurrence of each key.  collective.
+       * @details  only the fingerprints are sent to their owners.
+       * @param keys  content will be transformed, but not reordered.
+       */
+      void insert(::std::vector<Key>& keys) {
+        BL_BENCH_INIT(insert);
+
+        BL_BENCH_START(insert);
+        ::std::vector<uint64_t> fps = fingerprints(keys);
+        BL_BENCH_END(insert, "fingerprint", fps.size());
+
+        if (comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(insert, "dist_data", comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<uint64_t> buffer;
+          ::imxx::distribute(fps, this->fp_to_rank, recv_counts, i2o, buffer, comm);
+          fps.swap(buffer);
+          BL_BENCH_END(insert, "dist_data", fps.size());
+        }
+
+        BL_BENCH_START(insert);
+        for (auto const & fp : fps) local_insert(fp);
+        BL_BENCH_END(insert, "local_insert", fps.size());
+
+        BL_BENCH_COLLECTIVE_START(insert, "totals", comm);
+        totals[comm.rank()] += fps.size();
+        ::mxx::allgather(totals[comm.rank()], comm).swap(totals);
+        BL_BENCH_END(insert, "totals", size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "count_min_sketch:insert", comm);
+      }
+
+      /**
+       * @brief estimated count and error bound of each key, in the order of the keys.  collective.
+       * @param keys  content will be transformed, but not reordered.
+       */
+      ::std::vector<estimate_type> query(::std::vector<Key>& keys) const {
+        BL_BENCH_INIT(query);
+
+        BL_BENCH_START(query);
+        ::std::vector<uint64_t> fps = fingerprints(keys);
+        ::std::vector<Counter> counts;
+        BL_BENCH_END(query, "fingerprint", fps.size());
+
+        if (comm.size() == 1) {
+          BL_BENCH_START(query);
+          counts.reserve(fps.size());
+          for (auto const & fp : fps) counts.emplace_back(local_estimate(fp));
+          BL_BENCH_END(query, "local_query", counts.size());
+        } else {
+          BL_BENCH_COLLECTIVE_START(query, "dist_query", comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<uint64_t> buffer;
+          ::imxx::distribute(fps, this->fp_to_rank, recv_counts, i2o, buffer, comm, true);
+          BL_BENCH_END(query, "dist_query", buffer.size());
+
+          BL_BENCH_START(query);
+          ::std::vector<Counter> local;
+          local.reserve(buffer.size());
+          for (auto const & fp : buffer) local.emplace_back(local_estimate(fp));
+          BL_BENCH_END(query, "local_query", local.size());
+
+          // 1 result per query, back in query order.
+          BL_BENCH_COLLECTIVE_START(query, "a2a2", comm);
+          ::imxx::undistribute(local, recv_counts, i2o, counts, comm, true);
+          BL_BENCH_END(query, "a2a2", counts.size());
+        }
+
+        BL_BENCH_START(query);
+        ::std::vector<estimate_type> results;
+        results.reserve(fps.size());
+        for (size_t i = 0; i < fps.size(); ++i) {
+          results.emplace_back(estimate_type{counts[i], error_of(fp_to_rank(fps[i]))});
+        }
+        BL_BENCH_END(query, "bounds", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(query, "count_min_sketch:query", comm);
+        return results;
+      }
+
+      /**
+       * @brief estimated count of each key, in the order of the keys, as the count of the maps.  collective.
+       * @param keys  content will be transformed, but not reordered.
+       */
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys) const {
+        ::std::vector<estimate_type> est = this->query(keys);
+        ::std::vector<::std::pair<Key, size_type> > results;
+        results.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) results.emplace_back(keys[i], est[i].count);
+        return results;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_COUNT_MIN_SKETCH_HPP_ */
@@ -49,6 +49,7 @@
 #include <functional> 		// for std::function and std::hash
 #include <algorithm> 		// for sort, stable_sort, unique, is_sorted
 #include <iterator>  // advance, distance
+#include <numeric>   // accumulate, partial_sum
 
 #include <cstdint>  // for uint8, etc.
 
@@ -59,15 +60,26 @@
 #include <mxx/algos.hpp> // for bucketing
 
 #include "containers/distributed_map_base.hpp"
+#include "containers/distributed_aggregation.hpp"
+#include "containers/mapped_map.hpp"
 #include "containers/densehash_map.hpp"
+#include "containers/swiss_map.hpp"
+#include "containers/sharded_map.hpp"
+#include "containers/compact_counting_map.hpp"
+#include "containers/bloom_filter.hpp"
+#include "containers/batch_count.hpp"
+#include "containers/heavy_hitters.hpp"
+#include "containers/distributed_frozen_map.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
 #include "utils/logging.h"
 #include "utils/transform_utils.hpp"
 #include "utils/filter_utils.hpp"
+#include "utils/hyperloglog.hpp"
 
 
 #include "common/kmer_transform.hpp"
+#include "common/superkmer.hpp"
 
 #include "containers/dsc_container_utils.hpp"
 
@@ -145,19 +157,26 @@ namespace dsc  // distributed std container
     protected:
       using Base = ::dsc::map_base<Key, T, MapParams, Alloc>;
 
+      /// key to virtual bucket by hash, then bucket to rank by table.  see bucket_table.
       struct KeyToRank {
           typename Base::DistTransformedFunc proc_trans_hash;
-          const int p;
+          ::dsc::bucket_table buckets;
 
-          // 2x comm size to allow more even distribution?
           KeyToRank(int comm_size) :
-        	  proc_trans_hash(typename Base::DistFunc(ceilLog2(comm_size)),
+        	  proc_trans_hash(typename Base::DistFunc(::dsc::bucket_table::bits),
         			  	  	  typename Base::DistTrans()),
-        			  p(comm_size) {};
+        			  buckets(comm_size) {};
+          KeyToRank(::dsc::bucket_table const & table) :
+        	  proc_trans_hash(typename Base::DistFunc(::dsc::bucket_table::bits),
+        			  	  	  typename Base::DistTrans()),
+        			  buckets(table) {};
+
+          inline size_t bucket(Key const & x) const {
+            return Base::hash_to_bucket(proc_trans_hash(x));
+          }
 
           inline int operator()(Key const & x) const {
-            //            printf("KeyToRank operator. commsize %d  key.  hashed to %d, mapped to proc %d \n", p, proc_hash(Base::trans(x)), proc_hash(Base::trans(x)) % p);
-            return proc_trans_hash(x) % p;
+            return buckets[this->bucket(x)];
           }
           template<typename V>
           inline int operator()(::std::pair<Key, V> const & x) const {
@@ -167,8 +186,38 @@ namespace dsc  // distributed std container
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+          /// batch version, used by imxx::local::assign_to_buckets.  hashes are computed in blocks via the batch hash interface.
+          template<typename KT, typename SIZE>
+          inline void operator()(KT const * x, size_t const & count, SIZE * ranks) const {
+            constexpr size_t block = 256;
+            uint64_t hashes[block];
+            size_t n;
+            for (size_t i = 0; i < count; i += block) {
+              n = ::std::min(block, count - i);
+              ::fsc::batch_hash(proc_trans_hash, x + i, n, hashes);
+              for (size_t j = 0; j < n; ++j) {
+                ranks[i + j] = buckets[Base::hash_to_bucket(hashes[j])];
+              }
+            }
+          }
       } key_to_rank;
 
+      /// true for the entries whose bucket has a different rank in table than in the current one.
+      struct BucketMoved {
+          KeyToRank const & key_to_rank;
+          ::dsc::bucket_table const & table;
+
+          BucketMoved(KeyToRank const & _key_to_rank, ::dsc::bucket_table const & _table) :
+            key_to_rank(_key_to_rank), table(_table) {}
+
+          template <typename V>
+          inline bool operator()(V const & x) const {
+            size_t b = key_to_rank.bucket(x.first);
+            return table[b] != key_to_rank.buckets[b];
+          }
+      };
+
       /**
        * @brief count elements with the specified keys in the distributed sorted_multimap.
        * @note  input cannot have duplicate elements.
@@ -191,11 +240,8 @@ namespace dsc  // distributed std container
 
               if (query_begin == query_end) return 0;
 
-              size_t count = 0;  // before size.
-				for (auto it = query_begin; it != query_end; ++it) {
-				  count += op(db, *it, output, pred, trans);
-				}
-              return count;
+              // blocks of queries in parallel for a sharded local container, else a serial loop.
+              return ::fsc::process_queries(db, query_begin, query_end, output, op, pred, trans);
           }
 
       };
@@ -231,6 +277,54 @@ namespace dsc  // distributed std container
 
       mutable bool local_changed;
 
+      /// imbalance check before insert.  see set_balance_policy.
+      ::dsc::balance_policy balance;
+
+      /// rebucket before input is distributed, if the policy's check projects a partition too large.  collective.
+      template <typename V>
+      void balance_input(::std::vector<V> const & input) {
+        ::dsc::bucket_table table;
+        if (::dsc::balance_buckets(input, this->c.begin(), this->c.size(), key_to_rank, balance, this->comm, table))
+          this->set_bucket_table(table);
+      }
+
+      /// sketch of the distinct keys inserted so far, same on all processes.  used to size the local container before insert.
+      ::bliss::utils::hyperloglog64<12> key_sketch;
+
+      /**
+       * @brief estimate this process's share of the distinct keys after inserting input.  collective.
+       * @details  the input keys are sketched, then the sketch is merged across processes with 1 allreduce (4KB), and with the
+       *        sketch of the previous inserts so keys already in the map are not counted again.  the share includes
+       *        slack for skew and estimation error.  input may be before or after distribution.
+       */
+      template <typename V>
+      size_t sketch_for_insert(::std::vector<V> const & input) {
+        ::bliss::utils::hyperloglog64<12> sketch;
+        typename Base::StoreTransformedFarmHash hash;
+
+        constexpr size_t block = 256;
+        uint64_t hashes[block];
+        size_t n;
+        for (size_t i = 0; i < input.size(); i += block) {
+          n = ::std::min(block, input.size() - i);
+          ::fsc::batch_hash(hash, input.data() + i, n, hashes);
+          sketch.update(hashes, n);
+        }
+        if (this->comm.size() > 1)
+          sketch.get_registers() = ::mxx::allreduce(sketch.get_registers(), ::mxx::max<uint8_t>(), this->comm);
+        key_sketch.merge(sketch);
+
+        size_t est = static_cast<size_t>(key_sketch.estimate()) / this->comm.size();
+        return est + est / 8;
+      }
+
+      /// resize the local container once for the distinct keys after inserting input, so it does not rehash repeatedly during insert.  collective.
+      template <typename V>
+      void reserve_for_insert(::std::vector<V> const & input) {
+        size_t est = sketch_for_insert(input);
+        if (static_cast<double>(est) > static_cast<double>(c.bucket_count()) * c.get_max_load_factor()) c.resize(est);
+      }
+
       struct LocalCount {
           // filtered element-wise.
           template<class DB, typename Query, class OutputIter,
@@ -268,6 +362,22 @@ namespace dsc  // distributed std container
           // no filter by range AND elemenet for now.
       } count_element;
 
+      /// exact number of entries find_element outputs for the queries in [first, last), i.e. the sum of the LocalCount results.
+      template <class QueryIter, class Predicate>
+      size_t local_find_size(QueryIter first, QueryIter last, Predicate const & pred) const {
+        size_t count = 0;
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          for (; first != last; ++first) count += c.count(*first);
+        } else {
+          for (; first != last; ++first) {
+            auto range = c.equal_range(*first);
+            if (pred(range.first, range.second))
+              count += ::std::count_if(range.first, range.second, pred);
+          }
+        }
+        return count;
+      }
+
 
       /**
        * @brief insert new elements in the distributed densehash_multimap.
@@ -287,6 +397,8 @@ namespace dsc  // distributed std container
           BL_BENCH_START(local_insert);
           this->c.insert(input);
           BL_BENCH_END(local_insert, "insert", this->c.size());
+          // read the input, read and write 1 table entry per element.
+          BL_BENCH_BYTES(local_insert, input.size() * (sizeof(KT) + 2 * sizeof(typename local_container_type::value_type)));
 
           if (c.size() != before) local_changed = true;
 
@@ -358,10 +470,10 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+				  auto i2o = this->buffers.template acquire<size_t>(keys.size());
+				  auto buffer = this->buffers.template acquire<Key>(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -372,14 +484,39 @@ namespace dsc  // distributed std container
             // local find. memory utilization a potential problem.
             // do for each src proc one at a time.
 
+            std::vector<size_t> send_counts(this->comm.size(), 0);
+            auto start = keys.begin();
+            auto end = start;
+
+            if (this->exact_find_size) {
+              // count pass, so the results are allocated once at the exact size.
+              BL_BENCH_START(find);
+              for (int i = 0; i < this->comm.size(); ++i) {
+                ::std::advance(end, recv_counts[i]);
+                send_counts[i] = this->local_find_size(start, end, pred);
+                start = end;
+              }
+              results.reserve(::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0)));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              start = keys.begin();
+              for (int i = 0; i < this->comm.size(); ++i) {
+                end = start + recv_counts[i];
+                send_counts[i] = QueryProcessor::process(c, start, end, emplace_iter, find_element, sorted_input, pred);
+                start = end;
+              }
+              BL_BENCH_END(find, "local_find", results.size());
+              BL_BENCH_BYTES(find, keys.size() * (sizeof(Key) + sizeof(typename local_container_type::value_type)) +
+                  results.size() * sizeof(::std::pair<Key, T>));
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size());                   // TODO:  should estimate coverage.
             BL_BENCH_END(find, "reserve", results.capacity());
 
             BL_BENCH_START(find);
-            std::vector<size_t> send_counts(this->comm.size(), 0);
-            auto start = keys.begin();
-            auto end = start;
             size_t new_est = 0;
             size_t req_sofar = 0;
             size_t req_total = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
@@ -407,16 +544,32 @@ namespace dsc  // distributed std container
               start = end;
             }
             BL_BENCH_END(find, "local_find", results.size());
+            BL_BENCH_BYTES(find, keys.size() * (sizeof(Key) + sizeof(typename local_container_type::value_type)) +
+                results.size() * sizeof(::std::pair<Key, T>));
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
-            mxx::all2allv(results, send_counts, this->comm).swap(results);
+            this->return_find_results(results, send_counts);
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
 
+            if (this->exact_find_size) {
+              BL_BENCH_START(find);
+              results.reserve(this->local_find_size(keys.begin(), keys.end(), pred));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, find_element, sorted_input, pred);
+              BL_BENCH_END(find, "local_find", results.size());
+              BL_BENCH_BYTES(find, keys.size() * (sizeof(Key) + sizeof(typename local_container_type::value_type)) +
+                  results.size() * sizeof(::std::pair<Key, T>));
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size());                   // TODO:  should estimate coverage.
             //printf("reserving %lu\n", keys.size() * this->key_multiplicity);
@@ -436,8 +589,11 @@ namespace dsc  // distributed std container
             BL_BENCH_START(find);
             QueryProcessor::process(c, keys.begin() + estimating, keys.end(), emplace_iter, find_element, sorted_input, pred);
             BL_BENCH_END(find, "local_find", results.size());
+            BL_BENCH_BYTES(find, keys.size() * (sizeof(Key) + sizeof(typename local_container_type::value_type)) +
+                results.size() * sizeof(::std::pair<Key, T>));
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
           }
 
@@ -449,6 +605,96 @@ namespace dsc  // distributed std container
 
 
 
+      /**
+       * @brief find elements with the specified keys, and pass the results to sink in chunks instead of returning them.  collective.
+       * @details  the received queries are answered in rounds.  in each round a process answers its next received queries,
+       *        up to chunk results (at least 1 query), and sends the results back.  sink gets the results that arrived in
+       *        the round, so at most p x chunk results are held at a time instead of all of them, and the caller can
+       *        consume a chunk while the next one is computed by the other processes.
+       *        rounds continue until all processes are done, so sink is called a different number of times on each process.
+       * @param keys   content will be changed and reordered
+       * @param sink   called as sink(std::vector<std::pair<Key, T> > &) with each nonempty chunk.  may modify the vector.
+       * @param chunk  maximum number of results a process computes per round.
+       */
+      template <bool remove_duplicate = false, class LocalFind, class Sink, typename Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(LocalFind & find_element, ::std::vector<Key>& keys, Sink && sink, size_t const & chunk,
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          BL_BENCH_INIT(find);
+
+          if (this->empty() || ::dsc::empty(keys, this->comm)) {
+            BL_BENCH_REPORT_MPI_NAMED(find, "base_densehash:find_stream", this->comm);
+            return;
+          }
+
+          BL_BENCH_START(find);
+          this->transform_input(keys);
+          BL_BENCH_END(find, "input_transform", keys.size());
+
+          BL_BENCH_START(find);
+          if (remove_duplicate)
+          ::fsc::unique(keys, sorted_input,
+                        typename Base::StoreTransformedFunc(),
+                        typename Base::StoreTransformedEqual());
+          BL_BENCH_END(find, "unique", keys.size());
+
+          std::vector<size_t> recv_counts(1, keys.size());
+          if (this->comm.size() > 1) {
+            BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
+            auto i2o = this->buffers.template acquire<size_t>(keys.size());
+            auto buffer = this->buffers.template acquire<Key>(keys.size());
+            ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+            keys.swap(*buffer);
+            BL_BENCH_END(find, "dist_query", keys.size());
+          }
+
+          // start of each source's queries in keys.
+          std::vector<size_t> offsets(recv_counts.size() + 1, 0);
+          ::std::partial_sum(recv_counts.begin(), recv_counts.end(), offsets.begin() + 1);
+
+          BL_BENCH_START(find);
+          ::std::vector<::std::pair<Key, T> > results;
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(results);
+          std::vector<size_t> send_counts(recv_counts.size(), 0);
+          size_t pos = 0, end, total, n, first, last;
+          int src = 0;
+          bool more = true;
+          size_t rounds = 0;
+
+          while (more) {
+            // the next queries, up to chunk results.
+            total = 0;
+            for (end = pos; end < keys.size(); ++end) {
+              n = this->local_find_size(keys.begin() + end, keys.begin() + end + 1, pred);
+              if ((end > pos) && ((total + n) > chunk)) break;
+              total += n;
+            }
+
+            // answer them, grouped by source.
+            results.clear();
+            results.reserve(total);
+            ::std::fill(send_counts.begin(), send_counts.end(), 0);
+            for (first = pos; first < end; first = last) {
+              while (offsets[src + 1] <= first) ++src;
+              last = ::std::min(end, offsets[src + 1]);
+              send_counts[src] = QueryProcessor::process(c, keys.begin() + first, keys.begin() + last, emplace_iter, find_element, sorted_input, pred);
+            }
+            pos = end;
+
+            if (this->comm.size() > 1) {
+              this->return_find_results(results, send_counts);
+              more = ::mxx::any_of(pos < keys.size(), this->comm);
+            } else {
+              more = pos < keys.size();
+            }
+
+            if (results.size() > 0) sink(results);
+            ++rounds;
+          }
+          BL_BENCH_END(find, "rounds", rounds);
+
+          BL_BENCH_REPORT_MPI_NAMED(find, "base_densehash:find_stream", this->comm);
+      }
+
       /**
        * @brief find elements with the specified keys in the distributed densehash_multimap.
        *
@@ -488,10 +734,10 @@ namespace dsc  // distributed std container
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				auto i2o = this->buffers.template acquire<size_t>(keys.size());
+				auto buffer = this->buffers.template acquire<Key>(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				keys.swap(*buffer);
 	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	//            				typename Base::StoreTransformedFunc(),
 	//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -698,10 +944,10 @@ namespace dsc  // distributed std container
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-					std::vector<size_t> i2o;
-					std::vector<Key > buffer;
-					::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-					keys.swap(buffer);
+					auto i2o = this->buffers.template acquire<size_t>(keys.size());
+					auto buffer = this->buffers.template acquire<Key>(keys.size());
+					::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+					keys.swap(*buffer);
 		//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 		//            				typename Base::StoreTransformedFunc(),
 		//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -712,14 +958,37 @@ namespace dsc  // distributed std container
             // local find. memory utilization a potential problem.
             // do for each src proc one at a time.
 
+            std::vector<size_t> send_counts(this->comm.size(), 0);
+            auto start = keys.begin();
+            auto end = start;
+
+            if (this->exact_find_size) {
+              // count pass, so the results are allocated once at the exact size.
+              BL_BENCH_START(find);
+              for (int i = 0; i < this->comm.size(); ++i) {
+                ::std::advance(end, recv_counts[i]);
+                send_counts[i] = this->local_find_size(start, end, pred);
+                start = end;
+              }
+              results.reserve(::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0)));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              start = keys.begin();
+              for (int i = 0; i < this->comm.size(); ++i) {
+                end = start + recv_counts[i];
+                send_counts[i] = QueryProcessor::process(c, start, end, emplace_iter, find_element, sorted_input, pred, trans);
+                start = end;
+              }
+              BL_BENCH_END(find, "local_find", results.size());
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size());                   // TODO:  should estimate coverage.
             BL_BENCH_END(find, "reserve", results.capacity());
 
             BL_BENCH_START(find);
-            std::vector<size_t> send_counts(this->comm.size(), 0);
-            auto start = keys.begin();
-            auto end = start;
 
             size_t new_est = 0;
             size_t req_sofar = 0;
@@ -750,6 +1019,7 @@ namespace dsc  // distributed std container
             }
             BL_BENCH_END(find, "local_find", results.size());
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
@@ -760,6 +1030,17 @@ namespace dsc  // distributed std container
           } else {
 
 
+            if (this->exact_find_size) {
+              BL_BENCH_START(find);
+              results.reserve(this->local_find_size(keys.begin(), keys.end(), pred));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, find_element, sorted_input, pred, trans);
+              BL_BENCH_END(find, "local_find", results.size());
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size());                   // TODO:  should estimate coverage.
             //printf("reserving %lu\n", keys.size() * this->key_multiplicity);
@@ -781,6 +1062,7 @@ namespace dsc  // distributed std container
             BL_BENCH_END(find, "local_find", results.size());
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
           }
 
@@ -1045,7 +1327,7 @@ namespace dsc  // distributed std container
 
 
       densehash_map_base(const mxx::comm& _comm) :
-		    Base(_comm), key_to_rank(_comm.size()),
+		    Base(_comm), key_to_rank(::dsc::default_bucket_table(_comm)),
 		    local_changed(false) {}
 
 
@@ -1054,12 +1336,26 @@ namespace dsc  // distributed std container
       /// clears the densehash_map and release memory
       virtual void local_reset() noexcept {
         c.reset();
+        key_sketch.clear();
       }
 
 
       /// clears the densehash_map
       virtual void local_clear() noexcept {
         c.clear();
+        key_sketch.clear();
+      }
+
+      /// insert elements from a saved map.  already transformed and reduced, so distribute only if the partitioning changed.
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool same_partition) {
+        if (!same_partition && (this->comm.size() > 1)) {
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, T> > buffer;
+          ::imxx::distribute(entries, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          entries.swap(buffer);
+        }
+        this->local_insert(entries);
       }
 
 
@@ -1070,6 +1366,106 @@ namespace dsc  // distributed std container
         c.resize(n); 
       }
 
+      /// rebuild the table at the capacity for its current size.  erased entries do not shrink the table, and in the multimaps
+      /// their values stay in the value vectors.  the entries are copied out and the old table released before the rebuild.
+      virtual void local_compact() {
+        if (c.empty()) {
+          c.reset();
+          return;
+        }
+        ::std::vector<::std::pair<Key, T> > entries;
+        c.to_vector(entries);
+        c.reset();
+        c.resize(entries.size());
+        c.insert(entries);
+      }
+
+      /// identifies the bucket table, so a saved map is loaded without redistribution only with the same table.
+      virtual uint64_t get_partition_id() const {
+        return key_to_rank.buckets.id();
+      }
+
+      /// the assignment of the virtual buckets to the processes.
+      ::dsc::bucket_table const & get_bucket_table() const {
+        return key_to_rank.buckets;
+      }
+
+      /**
+       * @brief check the projected balance before each insert, and rebucket if a partition would be more than
+       *        policy.threshold times the mean.  off by default.  should be the same on all processes.
+       * @details  the check samples the input, and costs 1 allreduce of the bucket counts per insert.  the local entries
+       *        are scanned, with a second allreduce, only when the projection exceeds the threshold.  see dsc::balance_buckets.
+       */
+      void set_balance_policy(::dsc::balance_policy const & policy) {
+        balance = policy;
+      }
+
+      ::dsc::balance_policy const & get_balance_policy() const {
+        return balance;
+      }
+
+      /// identifies the key to process assignment function.  same as unordered_map_base::partition_type.
+      using partition_type = ::std::pair<typename Base::DistTransformedFunc, ::std::integral_constant<bool, Base::single_hash> >;
+
+      /// true if each key is on the same process in this map as in other.  local.
+      template <typename OtherMap>
+      bool is_co_partitioned(OtherMap const & other) const {
+        return ::std::is_same<partition_type, typename OtherMap::partition_type>::value &&
+            (other.get_bucket_table() == key_to_rank.buckets);
+      }
+
+      /**
+       * @brief owner process of each element of input, e.g. to send the inputs of several maps in 1 exchange before insert.
+       * @details  input should be input transformed (see transform_input), as insert does before distributing.  not collective.
+       */
+      template <typename V>
+      void owners(::std::vector<V> const & input, ::std::vector<int> & ranks) const {
+        ranks.resize(input.size());
+        for (size_t i = 0; i < input.size(); ++i) ranks[i] = key_to_rank(input[i]);
+      }
+
+      /// owner process of 1 input transformed key.  not collective.
+      inline int owner(Key const & key) const {
+        return key_to_rank(key);
+      }
+
+      /**
+       * @brief assign the virtual buckets to the processes by table, and move only the entries of the reassigned buckets.  collective.
+       * @details  e.g. table = get_bucket_table().remap(p) on a map with p processes, to keep the layout of a map that was
+       *        saved with a different number of processes.  table has to be the same on all processes.
+       */
+      void set_bucket_table(::dsc::bucket_table const & table) {
+        if (table.comm_size() != this->comm.size())
+          throw ::std::invalid_argument("set_bucket_table: table is for a different number of processes.");
+        if (table == key_to_rank.buckets) return;
+
+        BL_BENCH_INIT(rebucket);
+
+        BL_BENCH_START(rebucket);
+        ::std::vector<::std::pair<Key, T> > moving;
+        BucketMoved moved(key_to_rank, table);
+        for (auto it = this->c.begin(); it != this->c.end(); ++it) {
+          if (moved(*it)) moving.emplace_back(*it);
+        }
+        this->c.erase(moved);
+        key_to_rank.buckets = table;
+        BL_BENCH_END(rebucket, "extract", moving.size());
+
+        BL_BENCH_COLLECTIVE_START(rebucket, "dist_data", this->comm);
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<::std::pair<Key, T> > buffer;
+        ::imxx::distribute(moving, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        ::std::vector<::std::pair<Key, T> >().swap(moving);
+        BL_BENCH_END(rebucket, "dist_data", buffer.size());
+
+        BL_BENCH_START(rebucket);
+        this->local_insert(buffer);
+        BL_BENCH_END(rebucket, "insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(rebucket, "hashmap:set_bucket_table", this->comm);
+      }
+
       virtual size_t local_capacity() noexcept {
     	  return c.bucket_count();
       }
@@ -1077,6 +1473,39 @@ namespace dsc  // distributed std container
     	  return c.get_max_load_factor();
       }
 
+      /// health statistics of the local table.
+      ::fsc::sparsehash::table_stats local_stats() const {
+        return c.stats();
+      }
+
+      /// health statistics summed over all ranks, with the imbalance of entries per rank.  collective.
+      ::fsc::sparsehash::table_stats stats() const {
+        ::fsc::sparsehash::table_stats st = c.stats();
+
+        size_t max_size = ::mxx::allreduce(st.size, ::mxx::max<size_t>(), this->comm);
+        st.max_probe = ::mxx::allreduce(st.max_probe, ::mxx::max<size_t>(), this->comm);
+        st.size = ::mxx::allreduce(st.size, this->comm);
+        st.buckets = ::mxx::allreduce(st.buckets, this->comm);
+        st.tombstones = ::mxx::allreduce(st.tombstones, this->comm);
+        st.bytes = ::mxx::allreduce(st.bytes, this->comm);
+        st.probe_hist = ::mxx::allreduce(st.probe_hist, ::std::plus<size_t>(), this->comm);
+        st.imbalance = (st.size == 0) ? 1.0 :
+            static_cast<double>(max_size) * static_cast<double>(this->comm.size()) / static_cast<double>(st.size);
+        return st;
+      }
+
+      /// print the collective statistics from rank 0.  collective.
+      void print_stats(::std::string const & title) const {
+        ::fsc::sparsehash::table_stats st = stats();
+        if (this->comm.rank() == 0) {
+          ::std::stringstream ss;
+          ss << "[TABLE] " << title << "\t";
+          st.print(ss);
+          printf("%s\n", ss.str().c_str());
+          fflush(stdout);
+        }
+      }
+
 
       virtual ~densehash_map_base() {};
 
@@ -1112,6 +1541,111 @@ namespace dsc  // distributed std container
         c.keys(result);
       }
 
+      /// chunks of the hash table entries, copied.  see map_base::scan.
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const {
+        return this->make_local_scanner_impl(c, 0);
+      }
+      template <typename C>
+      auto make_local_scanner_impl(C const & cont, int) const
+        -> decltype(cont.cbegin(), ::std::unique_ptr<::dsc::local_scanner<Key, T> >()) {
+        return ::std::unique_ptr<::dsc::local_scanner<Key, T> >(
+            new ::dsc::iterator_scanner<Key, T, typename C::const_iterator>(cont.cbegin(), cont.cend()));
+      }
+      /// the multimap containers have no iterators, so the scan is over a copy.
+      template <typename C>
+      ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner_impl(C const & cont, long) const {
+        ::std::vector<::std::pair<Key, T> > entries;
+        this->to_vector(entries);
+        return ::std::unique_ptr<::dsc::local_scanner<Key, T> >(new ::dsc::copy_scanner<Key, T>(::std::move(entries)));
+      }
+
+      /// the local entries in table order, without copying.  only for containers with iterators, not the multimaps.
+      template <typename C = local_container_type>
+      auto local_entries() const -> decltype(::dsc::make_local_view(::std::declval<C const &>().cbegin(), ::std::declval<C const &>().cend())) {
+        return ::dsc::make_local_view(c.cbegin(), c.cend());
+      }
+      /// keys of the local entries, read from the table.
+      template <typename C = local_container_type>
+      auto local_keys() const -> decltype(::dsc::make_key_view(::std::declval<C const &>().cbegin(), ::std::declval<C const &>().cend())) {
+        return ::dsc::make_key_view(c.cbegin(), c.cend());
+      }
+      /// values of the local entries, read from the table.
+      template <typename C = local_container_type>
+      auto local_values() const -> decltype(::dsc::make_value_view(::std::declval<C const &>().cbegin(), ::std::declval<C const &>().cend())) {
+        return ::dsc::make_value_view(c.cbegin(), c.cend());
+      }
+
+      /// number of entries with each value in [0, max_value], e.g. the kmer spectrum.  larger values are in the last bin.  collective.
+      ::std::vector<size_t> histogram(size_t const & max_value) const {
+        return ::dsc::aggregate::histogram(c.cbegin(), c.cend(), max_value, this->comm);
+      }
+
+      /// the n entries with the largest values, in decreasing order.  same on all processes.  collective.
+      template <typename Less = ::dsc::aggregate::value_less>
+      ::std::vector<::std::pair<Key, T> > top_n(size_t const & n, Less const & less = Less()) const {
+        return ::dsc::aggregate::top_n(c.cbegin(), c.cend(), n, less, this->comm);
+      }
+
+      /// reduce f(entry) over all entries, with init the identity of reduce.  same on all processes.  collective.
+      template <typename V, typename MapOp, typename ReduceOp>
+      V map_reduce(MapOp const & f, ReduceOp const & reduce, V const & init) const {
+        return ::dsc::aggregate::map_reduce(c.cbegin(), c.cend(), f, reduce, init, this->comm);
+      }
+
+      /// read-only map type for the files written by save_mapped.
+      using mapped_map_type = ::fsc::mapped_hash_map<Key, T, typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual>;
+
+      /**
+       * @brief write each process's partition as a mapped_map_type file, <filename>.<rank>, for query-only serving.  collective.
+       * @details  a query service with the same number of processes maps its own partition, and routes the queries with the same
+       *           distribution hash.
+       */
+      void save_mapped(::std::string const & filename) const {
+        ::std::vector<::std::pair<Key, T> > local;
+        this->to_vector(local);
+
+        bool ok = true;
+        ::std::string message;
+        try {
+          mapped_map_type::write(filename + "." + ::std::to_string(this->comm.rank()), local);
+        } catch (::bliss::io::IOException & e) {
+          ok = false;
+          message = e.what();
+        }
+
+        if (!::mxx::all_of(ok, this->comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+              ok ? ::std::string("ERROR : dsc::densehash_map save_mapped failed on another process") : message);
+        }
+      }
+
+      /**
+       * @brief replace the content of the map with the files written by save_mapped.  collective.
+       * @details  each process reads <filename>.<rank>, so the number of processes has to be the same as for save_mapped.
+       *           the files do not record the bucket table, so the elements are redistributed.
+       */
+      void load_mapped(::std::string const & filename) {
+        ::std::vector<::std::pair<Key, T> > local;
+
+        bool ok = true;
+        ::std::string message;
+        try {
+          mapped_map_type mapped(filename + "." + ::std::to_string(this->comm.rank()));
+          mapped.to_vector(local);
+        } catch (::bliss::io::IOException & e) {
+          ok = false;
+          message = e.what();
+        }
+
+        if (!::mxx::all_of(ok, this->comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+              ok ? ::std::string("ERROR : dsc::densehash_map load_mapped failed on another process") : message);
+        }
+
+        this->local_clear();
+        this->local_load(local, false);
+      }
+
 
 
       /**
@@ -1145,7 +1679,29 @@ namespace dsc  // distributed std container
       		BL_BENCH_END(count, "unique", keys.size());
 
 
-          if (this->comm.size() > 1) {
+          BL_BENCH_START(count);
+          ::imxx::scatter_algo algo = (this->comm.size() > 1) ?
+              this->dist_policy.template choose<Key, ::std::pair<Key, size_type> >(keys.size(), this->comm) :
+              ::imxx::scatter_algo::FULL;
+          BL_BENCH_END(count, "choose_algo", static_cast<int>(algo));
+
+          if (algo != ::imxx::scatter_algo::FULL) {
+            // large batch.  one result per key, so use the memory bounded one to one versions.
+            BL_BENCH_COLLECTIVE_START(count, "scat_comp_gath", this->comm);
+            auto i2o = this->buffers.template acquire<size_t>(keys.size());
+            auto in_buffer = this->buffers.template acquire<Key>(keys.size());
+            auto out_buffer = this->buffers.template acquire<::std::pair<Key, size_type> >(keys.size());
+            auto counter = [this, &sorted_input, &pred](typename ::std::vector<Key>::iterator first,
+                                                        typename ::std::vector<Key>::iterator last,
+                                                        typename ::std::vector<::std::pair<Key, size_type> >::iterator out) {
+              QueryProcessor::process(c, first, last, out, count_element, sorted_input, pred);
+            };
+            ::imxx::scatter_compute_gather_adaptive(keys, this->key_to_rank, counter, *i2o, results,
+                                                    *in_buffer, *out_buffer, this->comm,
+                                                    ::imxx::distribution_policy(algo));
+            BL_BENCH_END(count, "scat_comp_gath", results.size());
+
+          } else if (this->comm.size() > 1) {
 
             // distribute (communication part)
 
@@ -1155,10 +1711,10 @@ namespace dsc  // distributed std container
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-            	std::vector<size_t> i2o;
-                std::vector<Key > buffer;
-                ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-                keys.swap(buffer);
+            	auto i2o = this->buffers.template acquire<size_t>(keys.size());
+                auto buffer = this->buffers.template acquire<Key>(keys.size());
+                ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+                keys.swap(*buffer);
             }
 //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //            				typename Base::StoreTransformedFunc(),
@@ -1261,10 +1817,10 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+				  auto i2o = this->buffers.template acquire<size_t>(keys.size());
+				  auto buffer = this->buffers.template acquire<Key>(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -1622,11 +2178,11 @@ namespace dsc  // distributed std container
 //            BLISS_UNUSED(recv_counts);
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				auto i2o = this->buffers.template acquire<size_t>(keys.size());
+				auto buffer = this->buffers.template acquire<Key>(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
 				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-				keys.swap(buffer);
+				keys.swap(*buffer);
             }
             BL_BENCH_END(erase, "dist_query", keys.size());
 
@@ -1733,16 +2289,20 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam LocalContainer  default to ::fsc::densehash_map.  ::fsc::swiss_map does not reserve key values, so it never needs the split map.
+   *                        ::fsc::sharded_swiss_map inserts and looks up with several threads, see containers/sharded_map.hpp.
    */
   template<typename Key, typename T,
   	  template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class densehash_map : 
-    public densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc> {
+    public densehash_map_base<Key, T, LocalContainer, MapParams, SpecialKeys, Alloc> {
     protected:
-      using Base = densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map_base<Key, T, LocalContainer, MapParams, SpecialKeys, Alloc>;
 
 
     public:
@@ -1798,6 +2358,15 @@ namespace dsc  // distributed std container
       } find_element;
 
 
+      /// reserve for the entries of insert_count_find.  collective.
+      virtual void prepare_batch_insert(::std::vector<::std::pair<Key, T> > const & input) {
+        this->reserve_for_insert(input);
+      }
+      /// apply the entries of insert_count_find received from all processes.  the reduction maps override this to reduce.
+      virtual size_t local_batch_insert(::std::vector<::std::pair<Key, T> > & input) {
+        return this->Base::local_insert(input);
+      }
+
       virtual void local_reduction(::std::vector<::std::pair<Key, T> > &input, bool & sorted_input) {
         ::fsc::unique(input, sorted_input,
         		typename Base::Base::StoreTransformedFarmHash(),
@@ -1815,6 +2384,20 @@ namespace dsc  // distributed std container
 
       virtual ~densehash_map() {};
 
+      /// read only distributed map type, see freeze.  same distribution as unordered_map, so the same frozen map type.
+      template <typename Fingerprint = uint16_t>
+      using frozen_type = ::dsc::frozen_unordered_map<Key, T, MapParams, Fingerprint>;
+
+      /**
+       * @brief build a read only copy with a minimal perfect hash layout per process, for a reference set that is only queried.  collective.
+       * @details  uses the same processes for each key, i.e. the same bucket table.  see frozen_unordered_map.
+       *        this map is not modified, and can be cleared afterwards.
+       */
+      template <typename Fingerprint = uint16_t>
+      frozen_type<Fingerprint> freeze() const {
+        return frozen_type<Fingerprint>(*this, this->comm);
+      }
+
       using Base::count;
       using Base::erase;
       using Base::unique_size;
@@ -1825,6 +2408,12 @@ namespace dsc  // distributed std container
                                                           Predicate const& pred = Predicate()) const {
           return Base::template find<remove_duplicate>(find_element, keys, sorted_input, pred);
       }
+      /// find, with the results passed to sink in chunks of at most chunk results per process.  see Base::find_stream
+      template <bool remove_duplicate = false, class Sink, class Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(::std::vector<Key>& keys, Sink && sink, size_t const & chunk = (1UL << 20),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          Base::template find_stream<remove_duplicate>(find_element, keys, sink, chunk, sorted_input, pred);
+      }
       template <bool remove_duplicate = false, class Transform = ::bliss::transform::identity<Key>, class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, T> >::return_type>
       find_transform(::std::vector<Key>& keys, bool sorted_input = false,
@@ -1902,6 +2491,14 @@ namespace dsc  // distributed std container
           return results;
       }
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -1909,6 +2506,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -1919,8 +2519,13 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_intput", input.size());
 
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->reserve_for_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
@@ -1929,10 +2534,10 @@ namespace dsc  // distributed std container
 //          auto recv_counts(::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm));
 //          BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
-			  std::vector<::std::pair<Key, T> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-			  input.swap(buffer);
+			  auto i2o = this->buffers.template acquire<size_t>(input.size());
+			  auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+			  input.swap(*buffer);
           BL_BENCH_END(insert, "dist_data", input.size());
         }
 
@@ -1966,6 +2571,217 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief insert new elements, consuming the input.  the input is bucketed in place and each received chunk is
+       *        inserted as it arrives, so there is no receive buffer the size of the input.  input is empty afterwards.
+       * @details  the local containers insert from a vector, so each chunk is copied to 1 chunk sized buffer first.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, T> >&& input, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_intput", input.size());
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->reserve_for_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
+        BL_BENCH_START(insert);
+        size_t before = this->c.size();
+        ::std::vector<::std::pair<Key, T> > chunk;
+        auto consume = [this, &pred, &chunk](::std::pair<Key, T> * first, ::std::pair<Key, T> * last) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            chunk.assign(first, ::std::partition(first, last, pred));
+          else
+            chunk.assign(first, last);
+          this->c.insert(chunk);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        if (this->c.size() != before) this->local_changed = true;
+        BL_BENCH_END(insert, "dist_insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
+
+        return this->c.size() - before;
+      }
+
+      /**
+       * @brief insert entries, then count and find keys, with 1 request exchange and 1 response exchange.  collective.
+       * @details  insert followed by count or find costs a distribute and an undistribute per operation.  here the entries
+       *        and the query keys for each owner go in 1 message of 3 segments (insert, count, find), whose sizes are
+       *        exchanged in place of the message sizes.  the owner applies the inserts from all processes first, so the
+       *        queries see this call's inserts, then answers each source's queries in order.  a key has at most 1 entry
+       *        in this map, so a count query is answered with the entry if there is one, and the querying process fills in
+       *        the counts, including the 0s.
+       * @param input       entries to insert.  transformed and consumed, as in insert.
+       * @param count_keys  keys to count.  transformed and deduplicated.
+       * @param find_keys   keys to find.  transformed and deduplicated.
+       * @param counts      output:  (key, count) for each key in count_keys.
+       * @return  entries found for find_keys.
+       */
+      ::std::vector<::std::pair<Key, T> > insert_count_find(std::vector<::std::pair<Key, T> >& input,
+          ::std::vector<Key>& count_keys, ::std::vector<Key>& find_keys,
+          ::std::vector<::std::pair<Key, size_type> > & counts) {
+        BL_BENCH_INIT(multi);
+
+        ::std::vector<::std::pair<Key, T> > results;
+        counts.clear();
+        int const p = this->comm.size();
+
+        BL_BENCH_START(multi);
+        this->transform_input(input);
+        this->transform_input(count_keys);
+        this->transform_input(find_keys);
+        bool sorted_count = false, sorted_find = false;
+        ::fsc::unique(count_keys, sorted_count, typename Base::Base::StoreTransformedFunc(), typename Base::Base::StoreTransformedEqual());
+        ::fsc::unique(find_keys, sorted_find, typename Base::Base::StoreTransformedFunc(), typename Base::Base::StoreTransformedEqual());
+        BL_BENCH_END(multi, "transform_input", input.size() + count_keys.size() + find_keys.size());
+
+        BL_BENCH_COLLECTIVE_START(multi, "reserve", this->comm);
+        this->prepare_batch_insert(input);
+        BL_BENCH_END(multi, "reserve", this->c.bucket_count());
+
+        // owner of each element, and the segment sizes for each owner:  inserts, counts, finds.
+        BL_BENCH_START(multi);
+        ::std::vector<int> input_rank(input.size()), count_rank(count_keys.size()), find_rank(find_keys.size());
+        ::std::vector<size_t> segments(3 * p, 0);
+        for (size_t i = 0; i < input.size(); ++i) ++segments[3 * (input_rank[i] = this->key_to_rank(input[i].first))];
+        for (size_t i = 0; i < count_keys.size(); ++i) ++segments[3 * (count_rank[i] = this->key_to_rank(count_keys[i])) + 1];
+        for (size_t i = 0; i < find_keys.size(); ++i) ++segments[3 * (find_rank[i] = this->key_to_rank(find_keys[i])) + 2];
+
+        // pack.  queries carry a default value.
+        ::std::vector<size_t> offsets(3 * p, 0);
+        ::std::partial_sum(segments.begin(), segments.end() - 1, offsets.begin() + 1);
+        ::std::vector<::std::pair<Key, T> > requests(input.size() + count_keys.size() + find_keys.size());
+        for (size_t i = 0; i < input.size(); ++i) requests[offsets[3 * input_rank[i]]++] = input[i];
+        for (size_t i = 0; i < count_keys.size(); ++i) requests[offsets[3 * count_rank[i] + 1]++] = ::std::make_pair(count_keys[i], T());
+        for (size_t i = 0; i < find_keys.size(); ++i) requests[offsets[3 * find_rank[i] + 2]++] = ::std::make_pair(find_keys[i], T());
+        ::std::vector<::std::pair<Key, T> >().swap(input);
+        ::std::vector<int>().swap(input_rank);
+        ::std::vector<int>().swap(find_rank);
+        BL_BENCH_END(multi, "pack", requests.size());
+
+        // exchange the segment sizes, then the requests.
+        BL_BENCH_COLLECTIVE_START(multi, "a2a_request", this->comm);
+        ::std::vector<size_t> recv_segments(3 * p);
+        ::std::vector<::std::pair<Key, T> > received;
+        if (p > 1) {
+          ::mxx::all2all(segments.data(), 3, recv_segments.data(), this->comm);
+          ::std::vector<size_t> send_counts(p), recv_counts(p);
+          for (int r = 0; r < p; ++r) {
+            send_counts[r] = segments[3 * r] + segments[3 * r + 1] + segments[3 * r + 2];
+            recv_counts[r] = recv_segments[3 * r] + recv_segments[3 * r + 1] + recv_segments[3 * r + 2];
+          }
+          received.resize(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+          ::mxx::all2allv(requests.data(), send_counts, received.data(), recv_counts, this->comm);
+          ::std::vector<::std::pair<Key, T> >().swap(requests);
+        } else {
+          recv_segments = segments;
+          received.swap(requests);
+        }
+        BL_BENCH_END(multi, "a2a_request", received.size());
+
+        // apply the inserts of all sources.
+        BL_BENCH_START(multi);
+        ::std::vector<::std::pair<Key, T> > entries;
+        entries.reserve(::std::accumulate(recv_segments.begin(), recv_segments.end(), static_cast<size_t>(0)));
+        size_t start = 0;
+        for (int r = 0; r < p; ++r) {
+          entries.insert(entries.end(), received.begin() + start, received.begin() + start + recv_segments[3 * r]);
+          start += recv_segments[3 * r] + recv_segments[3 * r + 1] + recv_segments[3 * r + 2];
+        }
+        this->local_batch_insert(entries);
+        ::std::vector<::std::pair<Key, T> >().swap(entries);
+        BL_BENCH_END(multi, "insert", this->c.size());
+
+        // answer the queries of each source:  the entries of the counted keys that are present, then the found entries.
+        BL_BENCH_START(multi);
+        ::std::vector<size_t> resp_segments(2 * p, 0);
+        ::std::vector<::std::pair<Key, T> > responses;
+        start = 0;
+        size_t before;
+        for (int r = 0; r < p; ++r) {
+          start += recv_segments[3 * r];
+          for (size_t s = 0; s < 2; ++s) {
+            before = responses.size();
+            for (size_t i = start, end = start + recv_segments[3 * r + 1 + s]; i < end; ++i) {
+              auto it = this->c.find(received[i].first);
+              if (it != this->c.end()) responses.emplace_back(*it);
+            }
+            resp_segments[2 * r + s] = responses.size() - before;
+            start += recv_segments[3 * r + 1 + s];
+          }
+        }
+        ::std::vector<::std::pair<Key, T> >().swap(received);
+        BL_BENCH_END(multi, "local_query", responses.size());
+
+        // return the responses, with their segment sizes.
+        BL_BENCH_COLLECTIVE_START(multi, "a2a_response", this->comm);
+        ::std::vector<size_t> back_segments(2 * p);
+        ::std::vector<::std::pair<Key, T> > answers;
+        if (p > 1) {
+          ::mxx::all2all(resp_segments.data(), 2, back_segments.data(), this->comm);
+          ::std::vector<size_t> send_counts(p), recv_counts(p);
+          for (int r = 0; r < p; ++r) {
+            send_counts[r] = resp_segments[2 * r] + resp_segments[2 * r + 1];
+            recv_counts[r] = back_segments[2 * r] + back_segments[2 * r + 1];
+          }
+          answers.resize(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+          ::mxx::all2allv(responses.data(), send_counts, answers.data(), recv_counts, this->comm);
+          ::std::vector<::std::pair<Key, T> >().swap(responses);
+        } else {
+          back_segments = resp_segments;
+          answers.swap(responses);
+        }
+        BL_BENCH_END(multi, "a2a_response", answers.size());
+
+        // split into counts and found entries.  the count answers from an owner are in the order of the keys sent to it,
+        // so each count key is matched against the next answer from its owner.
+        BL_BENCH_START(multi);
+        ::std::vector<size_t> count_pos(p), find_pos(p), find_end(p);
+        start = 0;
+        size_t found = 0;
+        for (int r = 0; r < p; ++r) {
+          count_pos[r] = start;
+          find_pos[r] = start + back_segments[2 * r];
+          find_end[r] = find_pos[r] + back_segments[2 * r + 1];
+          found += back_segments[2 * r + 1];
+          start = find_end[r];
+        }
+        typename Base::Base::StoreTransformedEqual eq;
+        counts.reserve(count_keys.size());
+        int r;
+        for (size_t i = 0; i < count_keys.size(); ++i) {
+          r = count_rank[i];
+          if ((count_pos[r] < find_pos[r]) && eq(answers[count_pos[r]].first, count_keys[i])) {
+            counts.emplace_back(count_keys[i], 1);
+            ++count_pos[r];
+          } else {
+            counts.emplace_back(count_keys[i], 0);
+          }
+        }
+        results.reserve(found);
+        for (r = 0; r < p; ++r) {
+          results.insert(results.end(), answers.begin() + find_pos[r], answers.begin() + find_end[r]);
+        }
+        BL_BENCH_END(multi, "unpack", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(multi, "hashmap:insert_count_find", this->comm);
+
+        return results;
+      }
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -1994,10 +2810,10 @@ namespace dsc  // distributed std container
 			BL_BENCH_START(update);
 //			::dsc::distribute_bucketed(input, recv_counts, this->comm).swap(input);
 			std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
-			  std::vector<::std::pair<Key, V> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-			  input.swap(buffer);
+			  auto i2o = this->buffers.template acquire<size_t>(input.size());
+			  auto buffer = this->buffers.template acquire<::std::pair<Key, V> >(input.size());
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+			  input.swap(*buffer);
 
 			BL_BENCH_END(update, "distribute", input.size());
 
@@ -2137,7 +2953,25 @@ namespace dsc  // distributed std container
 
       mutable size_t local_unique_count;
 
+      /// keys with entries spread over all ranks, and their global counts.  the same on all ranks.
+      ::dsc::heavy_key_directory<Key, typename Base::StoreTransformedFarmHash, typename Base::StoreTransformedEqual> heavy;
+
+      /// this rank's number of entries for each heavy key.
+      ::std::vector<size_t> local_heavy_counts() const {
+        ::std::vector<size_t> result(heavy.size());
+        for (size_t i = 0; i < heavy.size(); ++i) result[i] = this->c.count(heavy.key(i));
+        return result;
+      }
 
+      /// entries of heavy keys, from all ranks' shares.  collective.
+      template <class Predicate>
+      ::std::vector<::std::pair<Key, T> > find_heavy(::std::vector<Key> const & heavy_keys, Predicate const & pred) const {
+        return ::dsc::query_all<Key, ::std::pair<Key, T> >(heavy_keys,
+          [this, &pred](Key const & k, ::std::vector<::std::pair<Key, T> > & out) {
+            ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(out);
+            this->find_element(this->c, k, emplace_iter, pred);
+          }, this->comm);
+      }
 
 
     public:
@@ -2154,12 +2988,176 @@ namespace dsc  // distributed std container
       using Base::unique_size;
 
 
+      /**
+       * @brief spread the entries of keys with more than threshold entries over all ranks.  collective.
+       * @details  the entries of a key that is not heavy are all on its owner, so the local counts are exact and no sketch is needed.
+       *          keys stay heavy until all their entries are erased.  later inserts of heavy keys are spread as well.
+       *          count and find of heavy keys are answered by all ranks, so repeats do not pile onto their owners.
+       * @return number of new heavy keys.
+       */
+      size_t find_heavy_hitters(size_t const & threshold) {
+        BL_BENCH_INIT(heavy);
+
+        BL_BENCH_START(heavy);
+        ::std::vector<Key> ks;
+        this->keys(ks);
+        ::std::vector<::std::pair<Key, size_t> > found;
+        ::std::vector<Key> found_keys;
+        ::std::vector<::std::pair<Key, T> > entries;
+        size_t n;
+        for (auto const & k : ks) {
+          if (heavy.find(k) < heavy.size()) continue;  // already spread.
+          n = this->c.count(k);
+          if (n <= threshold) continue;
+
+          found.emplace_back(k, n);
+          found_keys.emplace_back(k);
+          auto range = this->c.equal_range(k);
+          for (auto it = range.first; it != range.second; ++it) entries.emplace_back(*it);
+        }
+        if (found_keys.size() > 0) {
+          this->c.erase(found_keys.begin(), found_keys.end());
+          this->local_changed = true;
+        }
+        BL_BENCH_END(heavy, "detect", found.size());
+
+        BL_BENCH_START(heavy);
+        size_t before = heavy.size();
+        heavy.add(found, this->comm);
+        entries = ::dsc::spread_evenly(entries, this->comm);
+        BL_BENCH_END(heavy, "spread", entries.size());
+
+        BL_BENCH_START(heavy);
+        this->local_reserve(this->c.size() + entries.size());
+        this->Base::local_insert(entries);
+        BL_BENCH_END(heavy, "insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(heavy, "hash_multimap:find_heavy_hitters", this->comm);
+        return heavy.size() - before;
+      }
+
+      /// number of heavy keys.  not collective.
+      size_t heavy_size() const {
+        return heavy.size();
+      }
+
+
       template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
                                                Predicate const& pred = Predicate()) const {
-          return Base::template find_overlap<remove_duplicate>(find_element, keys, sorted_input, pred);
-      }
-      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate, class Transform = ::bliss::transform::identity<Key>>
+          if (heavy.empty())
+            return Base::template find_overlap<remove_duplicate>(find_element, keys, sorted_input, pred);
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+          if (remove_duplicate) {
+            bool heavy_sorted = false;
+            ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+          }
+
+          ::std::vector<::std::pair<Key, T> > results =
+              Base::template find_overlap<remove_duplicate>(find_element, keys, sorted_input, pred);
+
+          ::std::vector<::std::pair<Key, T> > heavy_results = this->find_heavy(heavy_keys, pred);
+          results.insert(results.end(), heavy_results.begin(), heavy_results.end());
+          return results;
+      }
+
+      /**
+       * @brief find, with the results passed to sink in chunks of at most chunk results per process.  see Base::find_stream
+       * @details  the results for heavy keys, spread over all processes, are passed in 1 more chunk.
+       */
+      template <bool remove_duplicate = false, class Sink, class Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(::std::vector<Key>& keys, Sink && sink, size_t const & chunk = (1UL << 20),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+
+          Base::template find_stream<remove_duplicate>(find_element, keys, sink, chunk, sorted_input, pred);
+
+          if (heavy.empty()) return;
+          if (remove_duplicate) {
+            bool heavy_sorted = false;
+            ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+          }
+          ::std::vector<::std::pair<Key, T> > heavy_results = this->find_heavy(heavy_keys, pred);
+          if (heavy_results.size() > 0) sink(heavy_results);
+      }
+
+      /**
+       * @brief count elements with the specified keys.  heavy keys are counted from the directory, or by all ranks if filtered.
+       */
+      template <bool remove_duplicate = true, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate() ) const {
+          if (heavy.empty())
+            return Base::template count<remove_duplicate>(keys, sorted_input, pred);
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+          if (remove_duplicate) {
+            bool heavy_sorted = false;
+            ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+          }
+
+          ::std::vector<::std::pair<Key, size_type> > results =
+              Base::template count<remove_duplicate>(keys, sorted_input, pred);
+          results.reserve(results.size() + heavy_keys.size());
+
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+            for (auto const & k : heavy_keys) results.emplace_back(k, heavy.count(heavy.find(k)));
+            return results;
+          }
+
+          // every rank counts its share.  each rank answers all of heavy_keys in order.
+          ::std::vector<::std::pair<Key, size_type> > partial =
+              ::dsc::query_all<Key, ::std::pair<Key, size_type> >(heavy_keys,
+                [this, &pred](Key const & k, ::std::vector<::std::pair<Key, size_type> > & out) {
+                  ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > emplace_iter(out);
+                  this->count_element(this->c, k, emplace_iter, pred);
+                }, this->comm);
+          size_t first = results.size();
+          for (auto const & k : heavy_keys) results.emplace_back(k, 0);
+          for (size_t i = 0; i < partial.size(); ++i) results[first + (i % heavy_keys.size())].second += partial[i].second;
+          return results;
+      }
+
+      /**
+       * @brief erase elements with the specified keys.  heavy keys are erased on all ranks.
+       */
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate() ) {
+          if (heavy.empty())
+            return Base::template erase<remove_duplicate>(keys, sorted_input, pred);
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+
+          size_t count = Base::template erase<remove_duplicate>(keys, sorted_input, pred);
+
+          if (this->comm.size() > 1) heavy_keys = ::mxx::allgatherv(heavy_keys, this->comm);
+          size_t before = this->c.size();
+          if (heavy_keys.size() > 0) {
+            if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+              this->c.erase(heavy_keys.begin(), heavy_keys.end(), pred);
+            } else {
+              this->c.erase(heavy_keys.begin(), heavy_keys.end());
+            }
+          }
+          if (before != this->c.size()) this->local_changed = true;
+
+          heavy.recount(this->local_heavy_counts(), this->comm);
+
+          return count + before - this->c.size();
+      }
+
+      template <typename Predicate>
+      size_t erase(Predicate const & pred = Predicate()) {
+          size_t count = Base::erase(pred);
+          heavy.recount(this->local_heavy_counts(), this->comm);
+          return count;
+      }
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate, class Transform = ::bliss::transform::identity<Key>>
       ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, T> >::return_type>
       find_transform(::std::vector<Key>& keys, bool sorted_input = false,
     		  Predicate const& pred = Predicate(),
@@ -2321,6 +3319,16 @@ namespace dsc  // distributed std container
       }
 
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+        // group the local entries by key, see ::fsc::densehash_multimap::finalize.
+        this->c.finalize();
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2328,6 +3336,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -2339,8 +3350,19 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_intput", input.size());
 
+        // entries of heavy keys go to all ranks evenly instead of to the owner.
+        ::std::vector<::std::pair<Key, T> > heavy_input;
+        if (!heavy.empty()) {
+          BL_BENCH_START(insert);
+          heavy.extract(input, heavy_input);
+          heavy_input = ::dsc::spread_evenly(heavy_input, this->comm);
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            heavy_input.erase(::std::partition(heavy_input.begin(), heavy_input.end(), pred), heavy_input.end());
+          BL_BENCH_END(insert, "spread_heavy", heavy_input.size());
+        }
 
         //        printf("r %d key size %lu, val size %lu, pair size %lu, tuple size %lu\n", this->comm.rank(), sizeof(Key), sizeof(T), sizeof(::std::pair<Key, T>), sizeof(::std::tuple<Key, T>));
         //        count_unique(input);
@@ -2352,10 +3374,10 @@ namespace dsc  // distributed std container
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
 
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          auto i2o = this->buffers.template acquire<size_t>(input.size());
+          auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          input.swap(*buffer);
 
           //auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
           //BLISS_UNUSED(recv_counts);
@@ -2364,8 +3386,8 @@ namespace dsc  // distributed std container
 
         //        count_unique(input);
 		  BL_BENCH_START(insert);
-		  this->local_reserve(this->c.size() + input.size());  // before branching, because reserve calls collective "empty()"
-		  BL_BENCH_END(insert, "reserve", this->c.size() + input.size());
+		  this->local_reserve(this->c.size() + input.size() + heavy_input.size());  // before branching, because reserve calls collective "empty()"
+		  BL_BENCH_END(insert, "reserve", this->c.size() + input.size() + heavy_input.size());
 
 
         BL_BENCH_START(insert);
@@ -2379,14 +3401,36 @@ namespace dsc  // distributed std container
 
         BL_BENCH_END(insert, "insert", this->c.size());
 
+        if (!heavy.empty()) {
+          BL_BENCH_START(insert);
+          ::std::vector<size_t> delta = heavy.tally(heavy_input);
+          count += this->Base::local_insert(heavy_input);
+          heavy.add_counts(delta, this->comm);
+          BL_BENCH_END(insert, "insert_heavy", this->c.size());
+        }
+
         BL_BENCH_REPORT_MPI_NAMED(insert, "hash_multimap:insert", this->comm);
         return count;
       }
 
 
-      /// get the size of unique keys in the current local container.
+      /// get the size of unique keys in the current local container.  heavy keys are attributed to rank 0, so the sum over ranks is exact.
       virtual size_t local_unique_size() const {
-        return this->c.unique_size();
+        size_t n = this->c.unique_size();
+        for (size_t i = 0; i < heavy.size(); ++i)
+          if (this->c.count(heavy.key(i)) > 0) --n;
+        if (this->comm.rank() == 0) n += heavy.size();
+        return n;
+      }
+
+      virtual void local_reset() noexcept {
+        Base::local_reset();
+        heavy.clear();
+      }
+
+      virtual void local_clear() noexcept {
+        Base::local_clear();
+        heavy.clear();
       }
   };
 
@@ -2419,19 +3463,23 @@ namespace dsc  // distributed std container
    * @tparam Reduc  default to ::std::plus<key>    reduction operator
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam LocalContainer  default to ::fsc::densehash_map.  ::fsc::swiss_map does not reserve key values, so it never needs the split map.
+   *                        ::fsc::sharded_swiss_map inserts and looks up with several threads, see containers/sharded_map.hpp.
    */
   template<typename Key, typename T,
   template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
   typename Reduc = ::std::plus<T>,
-  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class reduction_densehash_map : 
-    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc> {
+    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer> {
       //static_assert(::std::is_arithmetic<T>::value, "mapped type has to be arithmetic");
 
     protected:
-      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2455,30 +3503,66 @@ namespace dsc  // distributed std container
     protected:
       Reduc r;
 
-      /**
-       * @brief insert new elements in the distributed densehash_multimap.
-       * @param first
-       * @param last
-       */
-      template <class InputIterator>
-      size_t local_insert(InputIterator first, InputIterator last) {
-          size_t before = this->c.size();
+      /// entries in the sender side combiner table.  0 disables the combiner.
+      size_t combiner_slots;
 
-          //this->local_reserve(before + ::std::distance(first, last));
+      static inline Key const & get_key(Key const & x) { return x; }
+      static inline Key const & get_key(::std::pair<Key, T> const & x) { return x.first; }
+      static inline T get_value(Key const &) { return T(1); }
+      static inline T const & get_value(::std::pair<Key, T> const & x) { return x.second; }
 
-          for (auto it = first; it != last; ++it) {
-            auto v = *it;
+      /**
+       * @brief sender side combiner.  merges repeated keys in input with the reduction operator, before distribution.
+       * @details  the table is direct mapped, and small enough to stay in cache.  a key whose slot holds a different key
+       *        evicts that entry to output, and the remaining entries are flushed at the end, so output may still have
+       *        repeated keys.  input is Key (value 1) or (Key, T).  the order of the entries is not preserved.
+       */
+      template <typename V>
+      void local_combine(::std::vector<V> const & input, ::std::vector<::std::pair<Key, T> > & output) {
+        output.clear();
+        if (input.size() == 0) return;
 
-            auto result = this->c.insert(v);
-            if (!(result.second)) {
-              // failed insertion - means an entry is already there, so reduce
-              result.first->second = r(result.first->second, v.second);
+        typename Base::StoreTransformedFarmHash hash;
+        typename Base::StoreTransformedEqual eq;
+        size_t const mask = combiner_slots - 1;
+        ::std::vector<::std::pair<Key, T> > slots(combiner_slots);
+        ::std::vector<uint8_t> used(combiner_slots, 0);
+
+        constexpr size_t block = 256;
+        uint64_t hashes[block];
+        size_t n, s;
+        for (size_t i = 0; i < input.size(); i += block) {
+          n = ::std::min(block, input.size() - i);
+          ::fsc::batch_hash(hash, input.data() + i, n, hashes);
+
+          for (size_t j = 0; j < n; ++j) {
+            Key const & k = get_key(input[i + j]);
+            s = hashes[j] & mask;
+            if (used[s]) {
+              if (eq(slots[s].first, k)) {
+                slots[s].second = r(slots[s].second, get_value(input[i + j]));
+                continue;
+              }
+              output.emplace_back(slots[s]);
             }
+            slots[s] = ::std::make_pair(k, get_value(input[i + j]));
+            used[s] = 1;
           }
+        }
 
-          if (this->c.size() != before) this->local_changed = true;
+        for (s = 0; s < combiner_slots; ++s) {
+          if (used[s]) output.emplace_back(slots[s]);
+        }
+      }
 
-          return this->c.size() - before;
+      /**
+       * @brief insert new elements in the distributed densehash_multimap.
+       * @param first
+       * @param last
+       */
+      template <class InputIterator>
+      size_t local_insert(InputIterator first, InputIterator last) {
+          return local_insert(first, last, ::bliss::filter::TruePredicate());
       }
 
       /**
@@ -2492,6 +3576,17 @@ namespace dsc  // distributed std container
 
           //this->local_reserve(before + ::std::distance(first, last));
 
+          insert_reduce(first, last, pred, ::fsc::is_sharded_map<local_container_type>());
+
+          if (this->c.size() != before) this->local_changed = true;
+
+          return this->c.size() - before;
+
+      }
+
+      /// reduce into the local container, 1 element at a time.
+      template <class InputIterator, class Predicate>
+      void insert_reduce(InputIterator first, InputIterator last, Predicate const & pred, ::std::false_type) {
           for (auto it = first; it != last; ++it) {
             auto v = *it;
             if (pred(v)) {
@@ -2502,11 +3597,17 @@ namespace dsc  // distributed std container
               }
             }
           }
+      }
 
-          if (this->c.size() != before) this->local_changed = true;
-
-          return this->c.size() - before;
+      /// reduce into the shards of a sharded local container, with its threads.
+      template <class InputIterator, class Predicate>
+      void insert_reduce(InputIterator first, InputIterator last, Predicate const & pred, ::std::true_type) {
+          this->c.insert_reduce(first, last, r, pred);
+      }
 
+      /// reduce the entries of insert_count_find with the existing ones.
+      virtual size_t local_batch_insert(::std::vector<::std::pair<Key, T> > & input) {
+        return this->local_insert(input.begin(), input.end());
       }
 
       /// local reduction via a copy of local container type (i.e. densehash_map).
@@ -2546,17 +3647,39 @@ namespace dsc  // distributed std container
 
     public:
       reduction_densehash_map(const mxx::comm& _comm) :
-	  	  Base(_comm) {}
+	  	  Base(_comm), combiner_slots(0) {}
 
 
       virtual ~reduction_densehash_map() {};
 
+      /**
+       * @brief merge repeated keys on the sending process before insert distributes them.
+       * @details  with high coverage, a key occurs many times in a process's input.  combining first cuts the data sent
+       *        roughly by the local multiplicity.  the reduction operator has to be associative.  used only with more than 1 process.
+       * @param slots  entries in the combiner table, rounded up to a power of 2.  0 disables it.
+       *        the default (32K) fits in L2 cache for 64 bit keys.
+       */
+      void set_combiner(size_t const & slots = (1UL << 15)) {
+        combiner_slots = (slots == 0) ? 0 : (1UL << ceilLog2(static_cast<unsigned>(slots)));
+      }
+      size_t get_combiner() const {
+        return combiner_slots;
+      }
+
       using Base::count;
       using Base::find;
       using Base::erase;
       using Base::unique_size;
       using Base::update;
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2564,6 +3687,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -2575,18 +3701,31 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        if ((combiner_slots > 0) && (this->comm.size() > 1)) {
+          BL_BENCH_START(insert);
+          std::vector<::std::pair<Key, T> > combined;
+          this->local_combine(input, combined);
+          input.swap(combined);
+          BL_BENCH_END(insert, "combine", input.size());
+        }
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->reserve_for_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
 
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          auto i2o = this->buffers.template acquire<size_t>(input.size());
+          auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          input.swap(*buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
 //          BLISS_UNUSED(recv_counts);
@@ -2627,6 +3766,97 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief insert new elements, consuming the input.  received chunks are reduced into the map as they arrive.
+       *        input is empty afterwards.  with the combiner, the input is combined first and inserted by the copying insert.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, T> >&& input, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
+
+        if ((combiner_slots > 0) && (this->comm.size() > 1)) {
+          size_t count = this->insert(input, false, pred);
+          ::std::vector<::std::pair<Key, T> >().swap(input);
+          return count;
+        }
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_densehash:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->reserve_for_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
+        BL_BENCH_START(insert);
+        size_t count = 0;
+        auto consume = [this, &count, &pred](::std::pair<Key, T> * first, ::std::pair<Key, T> * last) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            count += this->local_insert(first, last, pred);
+          else
+            count += this->local_insert(first, last);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        BL_BENCH_END(insert, "dist_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_densehash:insert", this->comm);
+
+        return count;
+      }
+
+
+      /**
+       * @brief reduce the entries of other into this map, e.g. to add the counts of another batch.  collective.
+       * @details  if the maps are co-partitioned and transform the input the same way, other's entries are already on
+       *        their owner processes and transformed, so they are reduced into the local container without communication.
+       *        otherwise other's entries are streamed through insert, which transforms and distributes them, with the combiner if set (see set_combiner).
+       *        either way other is read in chunks via its scan cursor, so the extra memory is bounded by the chunk.
+       * @param chunk_size  entries of other per process per round.
+       * @return  number of new local entries.
+       */
+      template <typename OtherMap>
+      size_t merge(OtherMap const & other, size_t const & chunk_size = (1UL << 20)) {
+        static_assert(::std::is_same<Key, typename OtherMap::key_type>::value, "merge needs maps with the same key type.");
+
+        BL_BENCH_INIT(merge);
+
+        // same decision on all processes, since the bucket tables are the same.
+        bool const local = ::std::is_same<typename Base::input_transform_type, typename OtherMap::input_transform_type>::value &&
+            ((this->comm.size() == 1) || this->is_co_partitioned(other));
+
+        BL_BENCH_COLLECTIVE_START(merge, "merge", this->comm);
+        size_t before = this->c.size();
+        ::std::vector<::std::pair<Key, T> > buffer;
+        if (static_cast<void const *>(&other) == static_cast<void const *>(this)) {
+          // the scan would read the table while it is updated.
+          this->to_vector(buffer);
+          if (local) this->local_insert(buffer.begin(), buffer.end());
+          else this->insert(buffer);
+        } else {
+          auto cursor = other.scan(chunk_size);
+          while (cursor.next()) {
+            auto const & chunk = cursor.chunk();
+            buffer.clear();
+            buffer.reserve(chunk.size());
+            for (size_t i = 0; i < chunk.size(); ++i) buffer.emplace_back(chunk.key(i), static_cast<T>(chunk.value(i)));
+            if (local) this->local_insert(buffer.begin(), buffer.end());
+            else this->insert(buffer);  // collective
+          }
+        }
+        BL_BENCH_END(merge, local ? "local_merge" : "insert_merge", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(merge, "reduction_densehash:merge", this->comm);
+        return this->c.size() - before;
+      }
 
   };
 
@@ -2659,19 +3889,24 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam LocalContainer  default to ::fsc::densehash_map.  ::fsc::swiss_map does not reserve key values, so it never needs the split map.
+   *                        ::fsc::sharded_swiss_map inserts and looks up with several threads, see containers/sharded_map.hpp.
+   *                        ::fsc::compact_counting_map8 and 16 store 1 or 2 byte counts apart from the keys, for less memory per entry.
    */
   template<
     typename Key, typename T,
     template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class counting_densehash_map : 
-    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc> {
+    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, LocalContainer> {
       static_assert(::std::is_integral<T>::value, "count type has to be integral");
 
     protected:
-      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc>;
+      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, LocalContainer>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2693,8 +3928,221 @@ namespace dsc  // distributed std container
       using difference_type       = typename local_container_type::difference_type;
 
 
+    protected:
+      /// filter of the keys seen once, so singletons are not inserted into the local container.
+      ::fsc::bloom_filter<Key, typename Base::StoreTransformedFarmHash> solid_filter;
+      /// target false positive rate for the solid filter.  0 if the filter is not in use.
+      double solid_fp_rate;
+      /// expected number of distinct keys for the solid filter, over all processes.  0 to estimate from the first insert.
+      size_t solid_expected;
+      /// send inserted keys sorted and delta encoded.  see imxx::distribute_compressed.
+      bool compress_distribute;
+      /// local counting of the received keys.  see fsc::batch_count_backend.
+      ::fsc::batch_count_backend count_backend;
+
+      /// clear the filter too.  the solid filter stays in use, and is resized at the next insert.
+      virtual void local_reset() noexcept {
+        Base::local_reset();
+        solid_filter.reset();
+      }
+      virtual void local_clear() noexcept {
+        Base::local_clear();
+        solid_filter.clear();
+      }
+
+      /// reserve the local container, or with the solid filter, size the filter instead.  collective.
+      template <typename V>
+      void prepare_local_insert(std::vector< V > const & input) {
+        if (solid_fp_rate == 0.0) {
+          this->reserve_for_insert(input);
+          return;
+        }
+        // the local container holds only the solid keys, whose number is not known, so it is not reserved.
+        size_t est = this->sketch_for_insert(input);
+        if (solid_filter.empty())
+          solid_filter.resize(solid_expected > 0 ? (solid_expected + this->comm.size() - 1) / this->comm.size() : est, solid_fp_rate);
+      }
+
+      /**
+       * @brief count the local keys.  with the solid filter, a key is inserted only at its second occurrence.
+       * @details  the first occurrence of a key only sets the filter.  at the next occurrence the key is inserted with count 2,
+       *        which includes the first.  a false positive in the filter inserts a key at its first occurrence, also with count 2,
+       *        so the counts of a fraction fp_rate of the keys are 1 too high.
+       */
+      template <typename Predicate>
+      size_t local_count_insert(std::vector< Key > & input, Predicate const & pred) {
+        if ((count_backend == ::fsc::batch_count_backend::SORT) &&
+            ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          std::vector< ::std::pair<Key, T> > runs;
+          if (this->sort_count(input, runs, ::std::integral_constant<bool, ::bliss::common::is_kmer<Key>::value>()))
+            return this->local_count_insert(runs, pred);
+        }
+
+        if (solid_fp_rate == 0.0) {
+          auto trans = [](Key const & x) {
+            return ::std::make_pair(x, T(1));
+          };
+          auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
+          auto local_end = ::bliss::iterator::make_transform_iterator(input.end(), trans);
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            return this->Base::local_insert(local_start, local_end, pred);
+          else
+            return this->Base::local_insert(local_start, local_end);
+        }
+
+        size_t before = this->c.size();
+        for (auto it = input.begin(); it != input.end(); ++it) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            if (!pred(::std::make_pair(*it, T(1)))) continue;
+
+          auto found = this->c.find(*it);
+          if (found != this->c.end()) {
+            found->second = this->r(found->second, T(1));
+          } else if (solid_filter.test_and_set(*it)) {
+            this->c.insert(::std::make_pair(*it, T(2)));
+          }
+        }
+
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
+
+      /// count the received keys as (key, count) runs, in the storage transform's order.  false if the keys are not Kmers.
+      bool sort_count(std::vector< Key > & input, std::vector< ::std::pair<Key, T> > & runs, ::std::true_type) const {
+        ::fsc::sort_count(input, runs, typename Base::template StoreTransform<Key>(), typename Base::StoreTransformedEqual());
+        return true;
+      }
+      bool sort_count(std::vector< Key > & input, std::vector< ::std::pair<Key, T> > & runs, ::std::false_type) const {
+        return false;
+      }
+
+      /// count the local (key, count) pairs from the combiner.  with the solid filter, a key seen before is inserted with 1 added to its count.
+      template <typename Predicate>
+      size_t local_count_insert(std::vector< ::std::pair<Key, T> > & input, Predicate const & pred) {
+        if (solid_fp_rate == 0.0) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            return this->Base::local_insert(input.begin(), input.end(), pred);
+          else
+            return this->Base::local_insert(input.begin(), input.end());
+        }
+
+        size_t before = this->c.size();
+        for (auto it = input.begin(); it != input.end(); ++it) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            if (!pred(*it)) continue;
+
+          auto found = this->c.find(it->first);
+          if (found != this->c.end()) {
+            found->second = this->r(found->second, it->second);
+          } else if (solid_filter.test_and_set(it->first)) {
+            this->c.insert(::std::make_pair(it->first, this->r(it->second, T(1))));
+          } else if (it->second > T(1)) {
+            this->c.insert(*it);
+          }
+        }
+
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
+
+      /// true for the keys counted once, for end_solid_recount.
+      struct singleton {
+        template <typename V>
+        inline bool operator()(V const & x) const { return x.second < T(2); }
+      };
+
+      /// with the solid filter, insert_count_find sizes the filter instead of the local container.
+      virtual void prepare_batch_insert(::std::vector<::std::pair<Key, T> > const & input) {
+        this->prepare_local_insert(input);
+      }
+      /// count the entries of insert_count_find, through the solid filter if it is in use.
+      virtual size_t local_batch_insert(::std::vector<::std::pair<Key, T> > & input) {
+        return this->local_count_insert(input, ::bliss::filter::TruePredicate());
+      }
+
+      /// send input to the owner ranks.  output is in input.
+      template <typename V>
+      void distribute_input(std::vector< V > & input) {
+        std::vector<size_t> recv_counts;
+        std::vector< V > buffer;
+        if (compress_distribute) {
+          ::imxx::distribute_compressed(input, this->key_to_rank, recv_counts, buffer, this->comm);
+        } else {
+          std::vector<size_t> i2o;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        }
+        input.swap(buffer);
+      }
+
+    public:
+
       counting_densehash_map(const mxx::comm& _comm) :
-	  	  Base(_comm) {}
+	  	  Base(_comm), solid_fp_rate(0.0), solid_expected(0), compress_distribute(false),
+	  	  count_backend(::fsc::batch_count_backend::HASH) {}
+
+      /**
+       * @brief count each received batch before merging it into the local table, e.g. SORT for input with many repeated k-mers.
+       * @details  with SORT, each distinct key of a batch is probed once, after a radix sort.  applies to insert without a
+       *        predicate, and falls back to HASH for non Kmer keys.  may differ between processes.
+       */
+      void set_batch_count_backend(::fsc::batch_count_backend const & backend) {
+        count_backend = backend;
+      }
+      ::fsc::batch_count_backend get_batch_count_backend() const {
+        return count_backend;
+      }
+
+      /// compress the keys sent during insert.  trades local sorting for less traffic.  should be the same on all processes.
+      void set_compressed_distribute(bool const & compress) {
+        compress_distribute = compress;
+      }
+      bool get_compressed_distribute() const {
+        return compress_distribute;
+      }
+
+      /**
+       * @brief keep singleton keys out of the map with a bloom filter.  call before insert.  collective.
+       * @details  keys that occur once, e.g. most of the k-mers with sequencing errors, are then not in the map, and the
+       *        counts of a fraction fp_rate of the other keys may be 1 too high.  the filter state is kept across inserts.
+       *        for exact counts, pass the same input again through the second pass, see begin_solid_recount.
+       * @param fp_rate    target false positive rate of the filter.  0 disables the filter.
+       * @param expected   expected number of distinct keys including singletons, over all processes.  0 to estimate it from the first insert.
+       */
+      void set_solid_filter(double const & fp_rate, size_t const & expected = 0) {
+        solid_fp_rate = fp_rate;
+        solid_expected = expected;
+        solid_filter.reset();
+      }
+
+      /**
+       * @brief start the exact second pass after the inserts with the solid filter.  collective.
+       * @details  a key that the filter admitted by a false positive has a count 1 too high, and a singleton admitted this
+       *        way is in the map with count 2.  the second pass sets all counts to 0, solid_recount adds the exact counts
+       *        of the keys already in the map, and end_solid_recount erases the keys that occur once.  the input of the
+       *        second pass has to be the same as that of the inserts.
+       */
+      void begin_solid_recount() {
+        for (auto it = this->c.begin(); it != this->c.end(); ++it) it->second = T(0);
+        if (this->comm.size() > 1) this->comm.barrier();
+      }
+
+      /// count the input keys that are in the map, for the second pass.  no key is added.  collective.  see begin_solid_recount
+      void solid_recount(std::vector< Key >& input) {
+        if (::dsc::empty(input, this->comm)) return;
+
+        this->transform_input(input);
+        if (this->comm.size() > 1) this->distribute_input(input);
+
+        for (auto it = input.begin(); it != input.end(); ++it) {
+          auto found = this->c.find(*it);
+          if (found != this->c.end()) found->second = this->r(found->second, T(1));
+        }
+      }
+
+      /// end the second pass:  erase the singletons admitted by false positives.  returns the number erased locally.  collective.
+      size_t end_solid_recount() {
+        return this->erase(singleton());
+      }
 
 
       virtual ~counting_densehash_map() {};
@@ -2706,6 +4154,15 @@ namespace dsc  // distributed std container
       using Base::unique_size;
       using Base::update;
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        Base::finalize_build();
+        this->insert_staged(this->staged_keys, [this](::std::vector<Key> & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2713,6 +4170,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged_keys);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -2766,22 +4226,34 @@ namespace dsc  // distributed std container
         // transform input first.
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        // with the combiner, send (key, count) pairs instead of the raw k-mers.
+        bool const combine = (this->combiner_slots > 0) && (this->comm.size() > 1);
+        std::vector< ::std::pair<Key, T> > combined;
+        if (combine) {
+          BL_BENCH_START(insert);
+          this->local_combine(input, combined);
+          std::vector< Key >().swap(input);
+          BL_BENCH_END(insert, "combine", combined.size());
+        }
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        if (combine) this->prepare_local_insert(combined);
+        else this->prepare_local_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
         // then send the raw k-mers.
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
-          // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
-          std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector< Key > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          if (combine) this->distribute_input(combined);
+          else this->distribute_input(input);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
 //          BLISS_UNUSED(recv_counts);
-          BL_BENCH_END(insert, "dist_data", input.size());
+          BL_BENCH_END(insert, "dist_data", combine ? combined.size() : input.size());
         }
 
 //        // once received, then transform and locally insert.
@@ -2818,9 +4290,6 @@ namespace dsc  // distributed std container
 
 
           size_t count = 0;
-          auto trans = [](Key const & x) {
-            return ::std::make_pair(x, T(1));
-          };
         // ====== estimate is not great.
 //        // once received, transform and locally insert, in 2 parts.  first part takes 1M entry and insert to estimate
 //        // total size.
@@ -2870,13 +4339,8 @@ namespace dsc  // distributed std container
             " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
 
           // then insert all the rest,
-          auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
-          auto local_end = ::bliss::iterator::make_transform_iterator(input.end(), trans);
-          // insert
-          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
-            count += this->Base::local_insert(local_start, local_end, pred);
-          else
-            count += this->Base::local_insert(local_start, local_end);
+          if (combine) count += this->local_count_insert(combined, pred);
+          else count += this->local_count_insert(input, pred);
 
           if (this->comm.rank() == 0)
           std::cout << "rank " << this->comm.rank() <<
@@ -2889,6 +4353,9 @@ namespace dsc  // distributed std container
 //            " input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
 
           BL_BENCH_END(insert, "local_insert", this->local_size());
+          BL_BENCH_BYTES(insert, combine ?
+              combined.size() * (sizeof(::std::pair<Key, T>) + 2 * sizeof(typename local_container_type::value_type)) :
+              input.size() * (sizeof(Key) + 2 * sizeof(typename local_container_type::value_type)));
 
 
 
@@ -2897,6 +4364,121 @@ namespace dsc  // distributed std container
         return count;
 
       }
+
+      /**
+       * @brief insert keys, consuming the input.  received chunks are counted into the map as they arrive, through the
+       *        solid filter and the batch count backend.  input is empty afterwards.
+       * @details  with the combiner or compress_distribute, the input is inserted by the copying insert instead.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector< Key >&& input, Predicate const &pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged_keys);
+
+        if (((this->combiner_slots > 0) && (this->comm.size() > 1)) || compress_distribute) {
+          size_t count = this->insert(input, false, pred);
+          ::std::vector< Key >().swap(input);
+          return count;
+        }
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->prepare_local_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
+        BL_BENCH_START(insert);
+        // local_count_insert takes a vector, so each chunk is copied to 1 chunk sized buffer first.
+        size_t count = 0;
+        ::std::vector< Key > chunk;
+        auto consume = [this, &count, &pred, &chunk](Key * first, Key * last) {
+          chunk.assign(first, last);
+          count += this->local_count_insert(chunk, pred);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        BL_BENCH_END(insert, "dist_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_key", this->comm);
+
+        return count;
+      }
+
+      /**
+       * @brief insert kmers given in sequence order.  runs of consecutive kmers with the same rank are sent as packed super-kmers.
+       * @details  use with a minimizer distribution transform (e.g. ::bliss::kmer::transform::default_minimizer), so that
+       *        consecutive kmers usually go to the same rank.  ranks are computed before the input transform is applied,
+       *        so the input transform has to be identity, or the distribution transform has to be strand symmetric.
+       * @param input   kmers in sequence order, e.g. from KmerParser.  on return, contains the kmers received by this rank.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert_superkmers(std::vector< Key >& input, Predicate const &pred = Predicate()) {
+        static_assert(::std::is_same<typename Base::InputTransform, ::bliss::transform::identity<Key> >::value ||
+                      ::bliss::kmer::transform::is_strand_symmetric<typename Base::DistTrans>::value,
+                      "super-kmer insert computes ranks before the input transform.  requires identity input transform or strand symmetric distribution transform");
+
+        // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_superkmers", this->comm);
+          return 0;
+        }
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_START(insert);
+          std::vector<int> ranks(input.size());
+          this->key_to_rank(input.data(), input.size(), ranks.data());
+          BL_BENCH_END(insert, "rank", input.size());
+
+          BL_BENCH_START(insert);
+          std::vector<size_t> send_counts;
+          std::vector<uint8_t> send_buffer;
+          ::bliss::kmer::superkmer::pack(input, ranks, this->comm.size(), send_counts, send_buffer);
+          size_t input_size = input.size();
+          std::vector<int>().swap(ranks);
+          std::vector<Key>().swap(input);
+          BL_BENCH_END(insert, "pack", send_buffer.size());
+
+          BL_BENCH_COLLECTIVE_START(insert, "dist_data", this->comm);
+          std::vector<size_t> recv_counts(this->comm.size());
+          mxx::all2all(send_counts.data(), 1, recv_counts.data(), this->comm);
+          std::vector<uint8_t> recv_buffer(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+          mxx::all2allv(send_buffer.data(), send_counts, recv_buffer.data(), recv_counts, this->comm);
+          std::vector<uint8_t>().swap(send_buffer);
+          BL_BENCH_END(insert, "dist_data", recv_buffer.size());
+
+          BL_BENCH_START(insert);
+          input.reserve(input_size);
+          ::bliss::kmer::superkmer::unpack(recv_buffer.data(), recv_buffer.data() + recv_buffer.size(), input);
+          BL_BENCH_END(insert, "unpack", input.size());
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->prepare_local_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
+        BL_BENCH_START(insert);
+        size_t count = this->local_count_insert(input, pred);
+        BL_BENCH_END(insert, "local_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_superkmers", this->comm);
+
+        return count;
+      }
   };
 
 
@@ -2985,6 +4567,15 @@ namespace dsc  // distributed std container
       using Base::unique_size;
       using Base::update;
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        Base::finalize_build();
+        this->insert_staged(this->staged_keys, [this](::std::vector<Key> & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2992,6 +4583,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged_keys);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -3008,20 +4602,25 @@ namespace dsc  // distributed std container
         // transform input first.
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        BL_BENCH_COLLECTIVE_START(insert, "reserve", this->comm);
+        this->reserve_for_insert(input);
+        BL_BENCH_END(insert, "reserve", this->c.bucket_count());
+
         // then send the raw k-mers.
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
+          auto i2o = this->buffers.template acquire<size_t>(input.size());
 
-          std::vector<Key > buffer;
+          auto buffer = this->buffers.template acquire<Key>(input.size());
           //::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          input.swap(*buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
 //          BLISS_UNUSED(recv_counts);
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_direct_count_map.hpp
+ * @ingroup dsc::containers
+ * @brief   distributed exact kmer counts for small k, in an array indexed by the packed kmer.
+ * @details  for k * bitsPerChar bits up to ~28 (DNA k <= 14), all 2^nBits kmers fit in an array of counters, so the packed
+ *          kmer value is the index:  no hashing, probing, or stored keys.  each process counts its input into a local array of
+ *          all 2^nBits counters, without communication.  the local arrays are combined with 1 MPI_Reduce_scatter, which leaves
+ *          each process with the sums of its contiguous index range, [rank * block, (rank + 1) * block).  the combine happens
+ *          at the first collective query after an insert, or at finalize.
+ *
+ *          memory per process is 2^nBits pending counters, plus the owned block.  counting is a sequential pass over the
+ *          input and random increments into the array, i.e. bound by memory bandwidth.  counts are summed without
+ *          saturation, so Counter has to hold the total count of a kmer.
+ */
+#ifndef DISTRIBUTED_DIRECT_COUNT_MAP_HPP_
+#define DISTRIBUTED_DIRECT_COUNT_MAP_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstring>   // memcpy
+
+#include <mxx/comm.hpp>
+#include <mxx/datatypes.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /// kmers with at most MaxBits packed bits are counted with direct_count_map.  2^28 counters is 1 GB of uint32_t.
+  template <typename Kmer, unsigned int MaxBits = 28>
+  struct direct_count_fits {
+      static constexpr bool value = (Kmer::nBits <= MaxBits);
+  };
+
+  /**
+   * @brief exact counts of kmers in a 2^nBits array, partitioned by contiguous index ranges.
+   * @details  insert is local.  count, to_vector, unique_size, and finalize are collective.
+   * @tparam MapParams  parameters of the hashed map type, for the input transform only, e.g. CanonicalHashMapParams.
+   * @tparam Counter    counter type.
+   */
+  template<typename Kmer,
+    template <typename> class MapParams,
+    typename Counter = uint32_t
+  >
+  class direct_count_map {
+      static_assert(::std::is_integral<Counter>::value && ::std::is_unsigned<Counter>::value,
+                    "direct_count_map counter has to be an unsigned integer.");
+      // counts of MPI_Reduce_scatter are int.
+      static_assert(Kmer::nBits <= 30, "direct_count_map supports kmers of at most 30 bits.");
+
+    protected:
+      using InputTransform = typename MapParams<Kmer>::InputTransform;
+
+      /// owner of an index, by contiguous ranges of block indices.
+      struct IndexToRank {
+          size_t block;
+
+          IndexToRank(size_t const & _block) : block(_block) {};
+
+          inline int operator()(uint64_t const & idx) const {
+            return static_cast<int>(idx / block);
+          }
+      } idx_to_rank;
+
+    public:
+      using key_type = Kmer;
+      using mapped_type = Counter;
+      using value_type = ::std::pair<Kmer, Counter>;
+      using size_type = size_t;
+
+      /// number of counters, 1 per kmer.
+      static constexpr size_t range = (1ULL << Kmer::nBits);
+
+    protected:
+      const mxx::comm& comm;
+
+      InputTransform trans;
+
+      /// local counts since the last combine, for all kmers.  allocated on first insert.
+      ::std::vector<Counter> pending;
+      bool dirty;
+
+      /// combined counts of [offset, offset + counts.size()).
+      ::std::vector<Counter> counts;
+      size_t offset;
+
+      /// kmers inserted on this process.
+      size_t inserted;
+
+      /// packed kmer value.  the kmer bits are the low nBytes bytes, as in the Kmer(T const (&)[len]) constructor.
+      static inline uint64_t to_index(Kmer const & k) {
+        uint64_t x = 0;
+        memcpy(&x, k.getData(), Kmer::nBytes);
+        return x;
+      }
+
+      static inline Kmer to_kmer(uint64_t const & idx) {
+        uint64_t w[1] = {idx};
+        return Kmer(w);
+      }
+
+      /// block of rank r:  [r * block, min((r + 1) * block, range)).
+      size_t block_size(int const & r) const {
+        size_t s = ::std::min(static_cast<size_t>(r) * idx_to_rank.block, range);
+        size_t e = ::std::min(static_cast<size_t>(r + 1) * idx_to_rank.block, range);
+        return e - s;
+      }
+
+      /// packed values of the keys, input transformed first.  keys are transformed in place.
+      ::std::vector<uint64_t> indices(::std::vector<Kmer> & keys) const {
+        ::std::transform(keys.begin(), keys.end(), keys.begin(), trans);
+        ::std::vector<uint64_t> idx;
+        idx.reserve(keys.size());
+        for (auto const & k : keys) idx.emplace_back(to_index(k));
+        return idx;
+      }
+
+      /// combine the pending counts of all processes into the owned blocks, if any process inserted.  collective.
+      void combine() {
+        if (!::mxx::any_of(dirty, comm)) return;
+
+        BL_BENCH_INIT(combine);
+
+        BL_BENCH_START(combine);
+        if (pending.size() == 0) pending.resize(range, 0);
+        ::std::vector<int> recv_counts(comm.size());
+        for (int r = 0; r < comm.size(); ++r) recv_counts[r] = static_cast<int>(block_size(r));
+        ::std::vector<Counter> sums(counts.size());
+        BL_BENCH_END(combine, "alloc", pending.size());
+
+        BL_BENCH_COLLECTIVE_START(combine, "reduce_scatter", comm);
+        ::mxx::datatype dt = ::mxx::get_datatype<Counter>();
+        MPI_Reduce_scatter(pending.data(), sums.data(), recv_counts.data(), dt.type(), MPI_SUM, comm);
+        BL_BENCH_END(combine, "reduce_scatter", sums.size());
+
+        BL_BENCH_START(combine);
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += sums[i];
+        ::std::fill(pending.begin(), pending.end(), 0);
+        dirty = false;
+        BL_BENCH_END(combine, "accumulate", counts.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(combine, "direct_count_map:combine", comm);
+      }
+
+    public:
+      direct_count_map(const mxx::comm& _comm) :
+        idx_to_rank((range + _comm.size() - 1) / _comm.size()), comm(_comm),
+        dirty(false), offset(::std::min(static_cast<size_t>(_comm.rank()) * idx_to_rank.block, range)),
+        inserted(0) {
+        counts.resize(block_size(comm.rank()), 0);
+      }
+
+      virtual ~direct_count_map() {};
+
+      /// first index owned by this process.
+      size_t get_offset() const { return offset; }
+      size_t local_bytes() const { return (pending.size() + counts.size()) * sizeof(Counter); }
+
+      /// kmers inserted on this process.
+      size_t local_size() const { return inserted; }
+      /// kmers inserted on all processes.  collective.
+      size_t size() const { return ::mxx::allreduce(inserted, comm); }
+
+      /// distinct kmers.  collective.
+      size_t unique_size() {
+        combine();
+        size_t n = 0;
+        for (auto const & c : counts) n += (c > 0) ? 1 : 0;
+        return ::mxx::allreduce(n, comm);
+      }
+
+      /// zero all counters.  local, but should be called on all processes.
+      void clear() {
+        ::std::vector<Counter>().swap(pending);
+        ::std::fill(counts.begin(), counts.end(), 0);
+        dirty = false;
+        inserted = 0;
+      }
+
+      /// combine the pending counts now, e.g. after the last insert of a build.  collective.
+      void finalize() {
+        combine();
+      }
+
+      /**
+       * @brief count 1 occurrence of each key.  local.
+       * @param keys  content will be transformed, but not reordered.
+       */
+      void insert(::std::vector<Kmer>& keys) {
+        BL_BENCH_INIT(insert);
+
+        BL_BENCH_START(insert);
+        if (pending.size() == 0) pending.resize(range, 0);
+        ::std::transform(keys.begin(), keys.end(), keys.begin(), trans);
+        BL_BENCH_END(insert, "transform", keys.size());
+
+        BL_BENCH_START(insert);
+        for (auto const & k : keys) ++pending[to_index(k)];
+        inserted += keys.size();
+        dirty |= (keys.size() > 0);
+        BL_BENCH_END(insert, "local_insert", keys.size());
+
+        BL_BENCH_REPORT_NAMED(insert, "direct_count_map:insert");
+      }
+
+      /**
+       * @brief count of each key, in the order of the keys, as the count of the maps.  collective.
+       * @param keys  content will be transformed, but not reordered.
+       */
+      ::std::vector<::std::pair<Kmer, size_type> > count(::std::vector<Kmer>& keys) {
+        BL_BENCH_INIT(count);
+
+        BL_BENCH_COLLECTIVE_START(count, "combine", comm);
+        combine();
+        BL_BENCH_END(count, "combine", counts.size());
+
+        BL_BENCH_START(count);
+        ::std::vector<uint64_t> idx = indices(keys);
+        ::std::vector<Counter> found;
+        BL_BENCH_END(count, "index", idx.size());
+
+        if (comm.size() == 1) {
+          BL_BENCH_START(count);
+          found.reserve(idx.size());
+          for (auto const & i : idx) found.emplace_back(counts[i]);
+          BL_BENCH_END(count, "local_count", found.size());
+        } else {
+          BL_BENCH_COLLECTIVE_START(count, "dist_query", comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<uint64_t> buffer;
+          ::imxx::distribute(idx, this->idx_to_rank, recv_counts, i2o, buffer, comm, true);
+          BL_BENCH_END(count, "dist_query", buffer.size());
+
+          BL_BENCH_START(count);
+          ::std::vector<Counter> local;
+          local.reserve(buffer.size());
+          for (auto const & i : buffer) local.emplace_back(counts[i - offset]);
+          BL_BENCH_END(count, "local_count", local.size());
+
+          // 1 result per query, back in query order.
+          BL_BENCH_COLLECTIVE_START(count, "a2a2", comm);
+          ::imxx::undistribute(local, recv_counts, i2o, found, comm, true);
+          BL_BENCH_END(count, "a2a2", found.size());
+        }
+
+        BL_BENCH_START(count);
+        ::std::vector<::std::pair<Kmer, size_type> > results;
+        results.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) results.emplace_back(keys[i], found[i]);
+        BL_BENCH_END(count, "results", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "direct_count_map:count", comm);
+        return results;
+      }
+
+      /// the kmers with nonzero counts owned by this process, in kmer order.  collective.
+      void to_vector(::std::vector<value_type> & result) {
+        combine();
+        result.clear();
+        for (size_t i = 0; i < counts.size(); ++i) {
+          if (counts[i] > 0) result.emplace_back(to_kmer(offset + i), counts[i]);
+        }
+      }
+  };
+
+  template<typename Kmer, template <typename> class MapParams, typename Counter>
+  constexpr size_t direct_count_map<Kmer, MapParams, Counter>::range;
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_DIRECT_COUNT_MAP_HPP_ */
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_frozen_map.hpp
+ * @ingroup dsc::containers
+ * @brief   read only distributed map, frozen from a hashed distributed map into a minimal perfect hash layout per process.
+ * @details  for reference kmer sets that are built once and queried many times.  each process replaces its hash table with
+ *          a fsc::mphf_map, so about 4 bits per key plus the values and fingerprints, and 1 to 2 cache misses per query.
+ *          the bucket table of the source map is kept, so queries go to the same processes as before.
+ *
+ *          keys are not stored.  find and count are exact for keys in the map, and report an absent key as present with
+ *          probability 2^-(bits of Fingerprint).  to_vector, keys and save are not available.
+ */
+#ifndef DISTRIBUTED_FROZEN_MAP_HPP_
+#define DISTRIBUTED_FROZEN_MAP_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+
+#include <mxx/collective.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/bucket_table.hpp"
+#include "containers/mphf_map.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /**
+   * @brief distributed static map with unique keys.  constructed from a hashed map, e.g. via unordered_map::freeze.
+   * @tparam Fingerprint  fingerprint type of the local mphf_map.  larger type means fewer false positives for absent keys.
+   */
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename Fingerprint = uint16_t
+  >
+  class frozen_unordered_map : public ::dsc::map_base<Key, T, MapParams> {
+
+    protected:
+      using Base = ::dsc::map_base<Key, T, MapParams>;
+
+      /// same key to rank function as unordered_map_base.
+      struct KeyToRank {
+          typename Base::DistTransformedFunc proc_trans_hash;
+          ::dsc::bucket_table buckets;
+
+          KeyToRank(::dsc::bucket_table const & table) :
+            proc_trans_hash(typename Base::DistFunc(::dsc::bucket_table::bits),
+                            typename Base::DistTrans()),
+            buckets(table) {};
+
+          inline int operator()(Key const & x) const {
+            return buckets[Base::hash_to_bucket(proc_trans_hash(x))];
+          }
+      } key_to_rank;
+
+    public:
+      using local_container_type = ::fsc::mphf_map<Key, T, typename Base::StoreTransformedFunc, Fingerprint>;
+      using key_type = Key;
+      using mapped_type = T;
+      using size_type = size_t;
+
+      /// same as unordered_map_base::partition_type, so a frozen map and its source are co-partitioned.
+      using partition_type = ::std::pair<typename Base::DistTransformedFunc, ::std::integral_constant<bool, Base::single_hash> >;
+
+    protected:
+      local_container_type c;
+
+      // ================ local overrides.  the layout is built once, so only clearing is supported.
+      virtual void local_reset() { local_container_type().swap(c); }
+      virtual void local_clear() { local_container_type().swap(c); }
+      virtual void local_reserve(size_t n) {}
+      virtual void local_compact() {}
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool same_partition) {
+        throw ::std::logic_error("frozen_unordered_map: load is not supported.  load the source map and freeze it.");
+      }
+      virtual uint64_t get_partition_id() const {
+        return key_to_rank.buckets.id();
+      }
+
+      /// local lookup of the received queries.  unique keys, so at most 1 result per query.
+      template <typename Iter>
+      size_t local_find(Iter first, Iter last, ::std::vector<::std::pair<Key, T> > & results) const {
+        size_t found = 0;
+        for (; first != last; ++first) {
+          T const * v = c.find(*first);
+          if (v != nullptr) {
+            results.emplace_back(*first, *v);
+            ++found;
+          }
+        }
+        return found;
+      }
+
+    public:
+      /**
+       * @brief build the frozen layout from the entries of a hashed map.  collective.
+       * @details  each process builds from its own entries, so there is no communication.  the source map is not modified.
+       */
+      template <typename SourceMap>
+      frozen_unordered_map(SourceMap const & source, const mxx::comm& _comm) : Base(_comm),
+        key_to_rank(source.get_bucket_table()) {
+        static_assert(::std::is_same<partition_type, typename SourceMap::partition_type>::value,
+                      "frozen map has to use the same distribution as the source map.");
+        static_assert(::std::is_same<Key, typename SourceMap::key_type>::value &&
+                      ::std::is_same<T, typename SourceMap::mapped_type>::value,
+                      "frozen map has to have the same key and value types as the source map.");
+
+        BL_BENCH_INIT(freeze);
+
+        BL_BENCH_START(freeze);
+        ::std::vector<::std::pair<Key, T> > entries;
+        source.to_vector(entries);
+        BL_BENCH_END(freeze, "to_vector", entries.size());
+
+        BL_BENCH_START(freeze);
+        local_container_type(entries.begin(), entries.end()).swap(c);
+        BL_BENCH_END(freeze, "build", c.bytes());
+
+        BL_BENCH_REPORT_MPI_NAMED(freeze, "frozen_map:freeze", this->comm);
+      }
+
+      virtual ~frozen_unordered_map() {};
+
+      ::dsc::bucket_table const & get_bucket_table() const {
+        return key_to_rank.buckets;
+      }
+
+      /// the local layout.
+      local_container_type const & get_local_container() const { return c; }
+
+      // ================ accessors.  keys are not stored.
+      virtual void to_vector(std::vector<std::pair<Key, T> > & result) const {
+        throw ::std::logic_error("frozen_unordered_map: keys are not stored.  use the source map.");
+      }
+      virtual void keys(std::vector<Key> & result) const {
+        throw ::std::logic_error("frozen_unordered_map: keys are not stored.  use the source map.");
+      }
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const {
+        throw ::std::logic_error("frozen_unordered_map: keys are not stored.  use the source map.");
+      }
+      using Base::to_vector;
+      using Base::keys;
+
+      virtual bool local_empty() const { return c.empty(); }
+      virtual size_t local_size() const { return c.size(); }
+      virtual size_t local_unique_size() const { return c.size(); }
+
+      /// bytes used by the local layout.
+      size_t local_bytes() const { return c.bytes(); }
+
+      /**
+       * @brief find entries with the specified keys.  collective.
+       * @param keys  content will be changed and reordered.
+       */
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false) const {
+        BL_BENCH_INIT(find);
+
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (this->empty() || ::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(find, "frozen_map:find", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(find);
+        this->transform_input(keys);
+        ::fsc::unique(keys, sorted_input,
+                      typename Base::StoreTransformedFunc(),
+                      typename Base::StoreTransformedEqual());
+        BL_BENCH_END(find, "unique", keys.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
+          std::vector<size_t> recv_counts;
+          {
+            std::vector<size_t> i2o;
+            std::vector<Key > buffer;
+            ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+            keys.swap(buffer);
+          }
+          BL_BENCH_END(find, "dist_query", keys.size());
+
+          BL_BENCH_START(find);
+          results.reserve(keys.size());
+          std::vector<size_t> send_counts(this->comm.size(), 0);
+          auto start = keys.begin();
+          for (int i = 0; i < this->comm.size(); ++i) {
+            send_counts[i] = this->local_find(start, start + recv_counts[i], results);
+            start += recv_counts[i];
+          }
+          BL_BENCH_END(find, "local_find", results.size());
+
+          BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
+          mxx::all2allv(results, send_counts, this->comm).swap(results);
+          BL_BENCH_END(find, "a2a2", results.size());
+
+        } else {
+          BL_BENCH_START(find);
+          results.reserve(keys.size());
+          this->local_find(keys.begin(), keys.end(), results);
+          BL_BENCH_END(find, "local_find", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "frozen_map:find", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief count the entries with the specified keys, i.e. 0 or 1 for each unique key.  collective.
+       * @param keys  content will be changed and reordered.
+       */
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false) const {
+        BL_BENCH_INIT(count);
+
+        ::std::vector<::std::pair<Key, size_type> > results;
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(count, "frozen_map:count", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(count);
+        this->transform_input(keys);
+        ::fsc::unique(keys, sorted_input,
+                      typename Base::StoreTransformedFunc(),
+                      typename Base::StoreTransformedEqual());
+        BL_BENCH_END(count, "unique", keys.size());
+
+        std::vector<size_t> recv_counts;
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
+          std::vector<size_t> i2o;
+          std::vector<Key > buffer;
+          ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          keys.swap(buffer);
+          BL_BENCH_END(count, "dist_query", keys.size());
+        }
+
+        BL_BENCH_START(count);
+        results.reserve(keys.size());
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+          results.emplace_back(*it, c.count(*it));
+        }
+        BL_BENCH_END(count, "local_count", results.size());
+
+        if (this->comm.size() > 1) {
+          // 1 result per query, so send back using the recv counts.
+          BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
+          mxx::all2allv(results, recv_counts, this->comm).swap(results);
+          BL_BENCH_END(count, "a2a2", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "frozen_map:count", this->comm);
+        return results;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_FROZEN_MAP_HPP_ */
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_frozen_sorted_map.hpp
+ * @ingroup dsc::containers
+ * @brief   read only distributed sorted multimap, frozen from a sorted map or multimap into a structure of arrays per process.
+ * @details  for reference sets that are built once and queried many times.  each process keeps its entries as a
+ *          fsc::soa_sorted_vector, a sorted keys array and a parallel values array, so the searches of find and count
+ *          touch only the keys.  the splitters and spans of the source map are kept, so queries go to the same
+ *          processes as before, and keys whose entries cross process boundaries are answered by all their holders.
+ *
+ *          the mutable sorted maps keep the array of pairs, as their merges, reductions, erase and save move whole entries.
+ */
+#ifndef DISTRIBUTED_FROZEN_SORTED_MAP_HPP_
+#define DISTRIBUTED_FROZEN_SORTED_MAP_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <algorithm>
+#include <stdexcept>
+
+#include <mxx/collective.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/soa_sorted_vector.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /**
+   * @brief distributed static sorted multimap.  constructed from a sorted map or multimap, e.g. via sorted_map::freeze.
+   */
+  template<typename Key, typename T,
+    template <typename> class MapParams
+  >
+  class frozen_sorted_multimap : public ::dsc::map_base<Key, T, MapParams> {
+
+    protected:
+      using Base = ::dsc::map_base<Key, T, MapParams>;
+
+      /// same key to rank function as sorted_map_base:  splitters, and the keys that span processes.
+      struct KeyToRank {
+          ::std::vector<::std::pair<Key, int> > map;
+          ::std::vector<::std::pair<Key, ::std::pair<int, int> > > spans;
+          int p;
+          typename Base::DistTransformedFunc comp;
+
+          KeyToRank(::std::vector<::std::pair<Key, int> > const & _map,
+                    ::std::vector<::std::pair<Key, ::std::pair<int, int> > > const & _spans, int _comm_size) :
+            map(_map), spans(_spans), p(_comm_size) {};
+
+          inline int operator()(Key const & x) const {
+            auto pos = ::std::upper_bound(map.begin(), map.end(), x, comp);
+            return (pos == map.end()) ? (p-1) : pos->second;
+          }
+
+          inline ::std::pair<int, int> owners(Key const & x) const {
+            if (spans.size() > 0) {
+              auto pos = ::std::lower_bound(spans.begin(), spans.end(), x, comp);
+              if ((pos != spans.end()) && !comp(x, pos->first)) return pos->second;
+            }
+            int r = this->operator()(x);
+            return ::std::make_pair(r, r);
+          }
+      } key_to_rank;
+
+    public:
+      using local_container_type = ::fsc::soa_sorted_vector<Key, T, typename Base::StoreTransformedFunc>;
+      using key_type = Key;
+      using mapped_type = T;
+      using size_type = size_t;
+
+    protected:
+      local_container_type c;
+
+      // ================ local overrides.  the layout is built once, so only clearing is supported.
+      virtual void local_reset() { local_container_type().swap(c); }
+      virtual void local_clear() { local_container_type().swap(c); }
+      virtual void local_reserve(size_t n) {}
+      virtual void local_compact() {}
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool same_partition) {
+        throw ::std::logic_error("frozen_sorted_multimap: load is not supported.  load the source map and freeze it.");
+      }
+
+      /**
+       * @brief distribute query keys to the processes that hold them, as sorted_map_base::distribute_keys.  collective.
+       * @return  the keys this process sent to more than 1 process.
+       */
+      ::std::vector<Key> distribute_keys(::std::vector<Key> & keys, ::std::vector<size_t> & recv_counts) const {
+        ::std::vector<Key> split_keys;
+        std::vector<size_t> i2o;
+        std::vector<Key > buffer;
+
+        if (this->key_to_rank.spans.size() == 0) {  // same on all processes.
+          ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        } else {
+          ::std::vector<::std::pair<Key, int> > targets;
+          targets.reserve(keys.size());
+          ::std::pair<int, int> o;
+          for (auto const & k : keys) {
+            o = this->key_to_rank.owners(k);
+            if (o.first < o.second) split_keys.emplace_back(k);
+            for (int r = o.first; r <= o.second; ++r) targets.emplace_back(k, r);
+          }
+
+          ::std::vector<::std::pair<Key, int> > received;
+          ::imxx::distribute(targets, [](::std::pair<Key, int> const & x) { return x.second; },
+                             recv_counts, i2o, received, this->comm);
+          buffer.reserve(received.size());
+          for (auto const & x : received) buffer.emplace_back(x.first);
+        }
+        keys.swap(buffer);
+        return split_keys;
+      }
+
+      /// sort 1 process' queries if needed.  then each search starts at the previous match.
+      template <typename Iter>
+      static void sort_queries(Iter first, Iter last) {
+        typename Base::StoreTransformedFunc comp;
+        if (!::std::is_sorted(first, last, comp)) ::std::sort(first, last, comp);
+      }
+
+      /// local lookup of the received queries of 1 process.
+      template <typename Iter>
+      size_t local_find(Iter first, Iter last, ::std::vector<::std::pair<Key, T> > & results) const {
+        sort_queries(first, last);
+        size_t found = 0;
+        size_t from = 0;
+        ::std::pair<size_t, size_t> r;
+        for (; first != last; ++first) {
+          r = c.equal_range(*first, from);
+          for (size_t i = r.first; i < r.second; ++i) results.emplace_back(c.key(i), c.value(i));
+          found += r.second - r.first;
+          from = r.first;
+        }
+        return found;
+      }
+
+      /// counts of the received queries of 1 process.  1 result per query.
+      template <typename Iter>
+      void local_count(Iter first, Iter last, ::std::vector<::std::pair<Key, size_type> > & results) const {
+        sort_queries(first, last);
+        size_t from = 0;
+        ::std::pair<size_t, size_t> r;
+        for (; first != last; ++first) {
+          r = c.equal_range(*first, from);
+          results.emplace_back(*first, r.second - r.first);
+          from = r.first;
+        }
+      }
+
+      /// add up the partial counts of keys that were sent to several processes.  the query keys are unique.
+      static void merge_split_counts(::std::vector<::std::pair<Key, size_type> > & results, ::std::vector<Key> & split_keys) {
+        typename Base::StoreTransformedFunc comp;
+        ::std::sort(split_keys.begin(), split_keys.end(), comp);
+
+        auto split_begin = ::std::stable_partition(results.begin(), results.end(),
+            [&split_keys, &comp](::std::pair<Key, size_type> const & x) {
+          return !::std::binary_search(split_keys.begin(), split_keys.end(), x.first, comp);
+        });
+        ::std::vector<::std::pair<Key, size_type> > partials(split_begin, results.end());
+        results.erase(split_begin, results.end());
+        ::std::sort(partials.begin(), partials.end(), comp);
+
+        for (auto it = partials.begin(); it != partials.end(); ) {
+          auto group_end = ::fsc::upper_bound<true>(it, partials.end(), it->first, comp);
+          size_type total = 0;
+          for (auto g = it; g != group_end; ++g) total += g->second;
+          results.emplace_back(it->first, total);
+          it = group_end;
+        }
+      }
+
+    public:
+      /**
+       * @brief build the frozen layout from the entries of a redistributed sorted map.  collective.
+       * @details  each process builds from its own entries, so there is no communication.  see sorted_map_base::freeze.
+       * @param entries   the local entries of the source map, sorted.
+       * @param splitters the splitters of the source map.
+       * @param spans     the keys of the source map that span processes.
+       */
+      frozen_sorted_multimap(::std::vector<::std::pair<Key, T> > const & entries,
+                             ::std::vector<::std::pair<Key, int> > const & splitters,
+                             ::std::vector<::std::pair<Key, ::std::pair<int, int> > > const & spans,
+                             const mxx::comm& _comm) : Base(_comm),
+        key_to_rank(splitters, spans, _comm.size()) {
+
+        BL_BENCH_INIT(freeze);
+
+        BL_BENCH_START(freeze);
+        c.assign(entries.begin(), entries.end());
+        BL_BENCH_END(freeze, "build", c.bytes());
+
+        BL_BENCH_REPORT_MPI_NAMED(freeze, "frozen_sorted_map:freeze", this->comm);
+      }
+
+      virtual ~frozen_sorted_multimap() {};
+
+      /// the local layout.
+      local_container_type const & get_local_container() const { return c; }
+
+      // ================ accessors
+      virtual void to_vector(std::vector<std::pair<Key, T> > & result) const {
+        result.clear();
+        result.reserve(c.size());
+        for (size_t i = 0; i < c.size(); ++i) result.emplace_back(c.key(i), c.value(i));
+      }
+      virtual void keys(std::vector<Key> & result) const {
+        result.assign(c.keys().begin(), c.keys().end());
+        bool sorted = true;
+        ::fsc::sorted_unique(result, sorted,
+                             typename Base::StoreTransformedFunc(),
+                             typename Base::StoreTransformedEqual());
+      }
+      /// zero copy chunks of the key and value arrays, in key order.  see map_base::scan.
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const {
+        return ::std::unique_ptr<::dsc::local_scanner<Key, T> >(
+            new ::dsc::soa_scanner<Key, T>(c.keys().data(), c.values().data(), c.size()));
+      }
+      /// the local key array, in key order, without copying.  repeated keys are not removed.
+      ::dsc::local_view<Key const *> local_keys() const {
+        return ::dsc::make_local_view(c.keys().data(), c.keys().data() + c.size());
+      }
+      /// the local value array, in the order of local_keys, without copying.
+      ::dsc::local_view<T const *> local_values() const {
+        return ::dsc::make_local_view(c.values().data(), c.values().data() + c.size());
+      }
+      using Base::to_vector;
+      using Base::keys;
+
+      virtual bool local_empty() const { return c.empty(); }
+      virtual size_t local_size() const { return c.size(); }
+      virtual size_t local_unique_size() const {
+        size_t n = 0;
+        for (size_t i = 0; i < c.size(); i = c.upper_bound(c.key(i), i)) ++n;
+        return n;
+      }
+
+      /// bytes used by the local layout.
+      size_t local_bytes() const { return c.bytes(); }
+
+      /**
+       * @brief find entries with the specified keys.  collective.
+       * @param keys  content will be changed and reordered.
+       */
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false) const {
+        BL_BENCH_INIT(find);
+
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (this->empty() || ::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(find, "frozen_sorted_map:find", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(find);
+        this->transform_input(keys);
+        ::fsc::sorted_unique(keys, sorted_input,
+                             typename Base::StoreTransformedFunc(),
+                             typename Base::StoreTransformedEqual());
+        BL_BENCH_END(find, "unique", keys.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
+          std::vector<size_t> recv_counts;
+          this->distribute_keys(keys, recv_counts);
+          BL_BENCH_END(find, "dist_query", keys.size());
+
+          // each holder of a split key returns its share of the entries, so the results need no merging.
+          BL_BENCH_START(find);
+          results.reserve(keys.size());
+          std::vector<size_t> send_counts(this->comm.size(), 0);
+          auto start = keys.begin();
+          for (int i = 0; i < this->comm.size(); ++i) {
+            send_counts[i] = this->local_find(start, start + recv_counts[i], results);
+            start += recv_counts[i];
+          }
+          BL_BENCH_END(find, "local_find", results.size());
+
+          BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
+          mxx::all2allv(results, send_counts, this->comm).swap(results);
+          BL_BENCH_END(find, "a2a2", results.size());
+
+        } else {
+          BL_BENCH_START(find);
+          results.reserve(keys.size());
+          this->local_find(keys.begin(), keys.end(), results);
+          BL_BENCH_END(find, "local_find", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "frozen_sorted_map:find", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief count the entries with the specified keys, 1 result for each unique key.  collective.
+       * @param keys  content will be changed and reordered.
+       */
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false) const {
+        BL_BENCH_INIT(count);
+
+        ::std::vector<::std::pair<Key, size_type> > results;
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(count, "frozen_sorted_map:count", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(count);
+        this->transform_input(keys);
+        ::fsc::sorted_unique(keys, sorted_input,
+                             typename Base::StoreTransformedFunc(),
+                             typename Base::StoreTransformedEqual());
+        BL_BENCH_END(count, "unique", keys.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
+          std::vector<size_t> recv_counts;
+          ::std::vector<Key> split_keys = this->distribute_keys(keys, recv_counts);
+          BL_BENCH_END(count, "dist_query", keys.size());
+
+          BL_BENCH_START(count);
+          results.reserve(keys.size());
+          auto start = keys.begin();
+          for (int i = 0; i < this->comm.size(); ++i) {
+            this->local_count(start, start + recv_counts[i], results);
+            start += recv_counts[i];
+          }
+          BL_BENCH_END(count, "local_count", results.size());
+
+          // 1 result per query, so send back using the recv counts.
+          BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
+          mxx::all2allv(results, recv_counts, this->comm).swap(results);
+          BL_BENCH_END(count, "a2a2", results.size());
+
+          if (split_keys.size() > 0) {
+            BL_BENCH_START(count);
+            merge_split_counts(results, split_keys);
+            BL_BENCH_END(count, "merge_split", results.size());
+          }
+        } else {
+          BL_BENCH_START(count);
+          results.reserve(keys.size());
+          this->local_count(keys.begin(), keys.end(), results);
+          BL_BENCH_END(count, "local_count", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "frozen_sorted_map:count", this->comm);
+        return results;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_FROZEN_SORTED_MAP_HPP_ */
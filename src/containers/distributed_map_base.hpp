@@ -27,13 +27,31 @@
 
 #include <functional>
 #include <algorithm>
+#include <type_traits>
 #include <iterator>
 #include <vector>
+#include <memory>     // unique_ptr
 #include <unordered_set>
+#include <string>
+#include <sstream>    // stringstream
+#include <typeinfo>   // typeid
+#include <cstdint>    // uint64_t
+#include <cstring>    // memcpy
+#include <cstdio>     // FILE, rename
+#include <cerrno>
+#include <mpi.h>
 #include "containers/dsc_container_utils.hpp"
+#include "containers/bucket_table.hpp"
+#include "partition/rank_weights.hpp"
 #include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+#include "io/io_exception.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/buffer_pool.hpp"
+#include "containers/response_codec.hpp"
 
 
 
@@ -142,6 +160,345 @@ namespace dsc
       Key, InputTrans, DistTrans, DistHash, DistEqual, StoreTrans, StoreHash, StoreEqual,
       ::fsc::TransformedHash, ::fsc::TransformedHash>;
 
+  /**
+   * @brief parameters for a hashed map that computes one 64 bit hash per key, used for both distribution and storage.
+   * @details  distribution and storage share the transform and the hash function.  the hash is then split by bits:
+   *        the high 16 bits select the virtual bucket, hence the rank (see map_base::hash_to_bucket), while the local hash table probes with the low bits,
+   *        so the two uses stay independent.  requires a hash that mixes all 64 bits, e.g. murmur, farm, or crc32c,
+   *        and not identity or std::hash.
+   */
+  template <typename Key,
+        template <typename> class InputTrans,
+        template <typename> class Trans,
+        template <typename> class Hash,
+        template <typename> class Equal
+        >
+  using SingleHashMapParams = ::dsc::DistributedMapParams<
+      Key, InputTrans, Trans, Hash, Equal, Trans, Hash, Equal,
+      ::fsc::TransformedHash, ::fsc::TransformedHash>;
+
+
+  /// bucket table of a new hashed map on comm:  weighted if rank weights are installed for comm, else balanced.
+  inline bucket_table default_bucket_table(::mxx::comm const & comm) {
+    ::std::vector<double> weights = ::bliss::partition::rank_weights::instance().get(comm);
+    return weights.empty() ? bucket_table(comm.size()) : bucket_table::weighted(weights);
+  }
+
+
+  /// imbalance check of the hashed maps before insert.  see balance_buckets.
+  struct balance_policy {
+      /// largest allowed ratio of a projected partition size to the mean (per weight, see rank_weights).  0 disables the check.
+      double threshold;
+      /// evenly spaced entries sampled per process, of the input and of the local entries each.
+      size_t samples;
+
+      balance_policy(double const & _threshold = 0.0, size_t const & _samples = 4096) :
+        threshold(_threshold), samples(_samples) {};
+  };
+
+  namespace detail {
+    template <typename Key>
+    inline Key const & balance_key(Key const & x) { return x; }
+    template <typename Key, typename V>
+    inline Key const & balance_key(::std::pair<Key, V> const & x) { return x.first; }
+    template <typename Key, typename V>
+    inline Key const & balance_key(::std::pair<const Key, V> const & x) { return x.first; }
+
+    /// add the virtual buckets of s evenly spaced elements of [first, first + n) to loads, each counted for its share of n.
+    template <typename Iter, typename KeyToRank>
+    void sample_bucket_loads(Iter first, size_t const & n, size_t const & samples, KeyToRank const & key_to_rank,
+                             ::std::vector<size_t> & loads) {
+      size_t s = ::std::min(n, samples);
+      if (s == 0) return;
+      size_t pos = 0;
+      for (size_t i = 0; i < s; ++i) {
+        size_t next = (i * n) / s;
+        for (; pos < next; ++pos) ++first;   // forward iterators of the local containers.
+        loads[key_to_rank.bucket(balance_key(*first))] += ((i + 1) * n) / s - next;
+      }
+    }
+  }
+
+  /**
+   * @brief  projected balance of a hashed map after inserting input, from a sample, and a bucket table that improves it.  collective.
+   * @details  each process samples up to policy.samples evenly spaced elements of input and counts them by virtual bucket,
+   *        scaled to the input size.  the counts and the local map sizes are summed with 1 allreduce of
+   *        bucket_table::nbuckets + p integers, so all processes see the same loads.  a partition's projected size is its
+   *        local entries plus the input in its buckets.  only if the largest is more than policy.threshold times the mean
+   *        are the local entries sampled by bucket too, with a second allreduce, since that walks the local container.
+   *        table is then the bucket_table::balanced table of the loads, with a small part spread over all buckets for
+   *        later keys in unsampled buckets.
+   *
+   *        buckets are not split, so a distribution hash that maps many keys to a few buckets, e.g. identity on low
+   *        complexity k-mers, stays imbalanced.  a mixing distribution hash such as murmur or farm is needed then.
+   * @param first, local_size    local entries of the map.
+   * @return  true if table is balanced better than the current table, key_to_rank.buckets.
+   */
+  template <typename V, typename Iter, typename KeyToRank>
+  bool balance_buckets(::std::vector<V> const & input, Iter first, size_t const & local_size, KeyToRank const & key_to_rank,
+                       balance_policy const & policy, ::mxx::comm const & comm, bucket_table & table) {
+    if (!(policy.threshold > 0) || (comm.size() == 1)) return false;
+
+    // input loads by bucket, then the local sizes by rank.
+    ::std::vector<size_t> counts(bucket_table::nbuckets + comm.size(), 0);
+    detail::sample_bucket_loads(input.begin(), input.size(), policy.samples, key_to_rank, counts);
+    counts[bucket_table::nbuckets + comm.rank()] = local_size;
+    counts = ::mxx::allreduce(counts, ::std::plus<size_t>(), comm);
+
+    ::std::vector<double> weights = ::bliss::partition::rank_weights::instance().get(comm);
+
+    // the local entries are in their rank's buckets already, so the projection does not need their buckets.
+    ::std::vector<double> projected(comm.size(), 0);
+    double total = 0;
+    for (size_t b = 0; b < bucket_table::nbuckets; ++b) projected[key_to_rank.buckets[b]] += static_cast<double>(counts[b]);
+    for (int r = 0; r < comm.size(); ++r) projected[r] += static_cast<double>(counts[bucket_table::nbuckets + r]);
+    for (auto x : projected) total += x;
+    if (total == 0) return false;
+    double wsum = 0, largest = 0;
+    for (int r = 0; r < comm.size(); ++r) {
+      double w = weights.empty() ? 1.0 : weights[r];
+      wsum += w;
+      largest = ::std::max(largest, projected[r] / w);
+    }
+    if (largest / (total / wsum) <= policy.threshold) return false;
+
+    // imbalanced:  the buckets of the local entries are needed for a new table.
+    ::std::vector<size_t> loads(bucket_table::nbuckets, 0);
+    detail::sample_bucket_loads(first, local_size, policy.samples, key_to_rank, loads);
+    loads = ::mxx::allreduce(loads, ::std::plus<size_t>(), comm);
+    for (size_t b = 0; b < bucket_table::nbuckets; ++b) loads[b] += counts[b];
+
+    double current = key_to_rank.buckets.imbalance(loads, weights);
+    if (current <= policy.threshold) return false;
+
+    // 1/16 of the load spread over all buckets, for the keys of later inserts in the buckets that were not sampled.
+    size_t sum = 0;
+    for (auto l : loads) sum += l;
+    ::std::vector<size_t> smoothed(loads.size());
+    for (size_t b = 0; b < loads.size(); ++b) smoothed[b] = 16 * loads[b] + (sum + bucket_table::nbuckets - 1) / bucket_table::nbuckets;
+
+    bucket_table balanced = bucket_table::balanced(smoothed, comm.size(), weights);
+    if (balanced.imbalance(loads, weights) >= current) return false;
+
+    table = balanced;
+    return true;
+  }
+
+
+  /**
+   * @brief  a bounded span of local map entries, from a scan_cursor.  valid until the next call to the cursor.
+   * @details  either contiguous pairs (entries), or separate key and value arrays (keys and values, the SoA layout).
+   *        zero copy if the local container stores the entries that way, else entries points to a buffer of the scanner.
+   */
+  template <typename Key, typename T>
+  struct scan_chunk {
+      ::std::pair<Key, T> const * entries;
+      Key const * keys;
+      T const * values;
+      size_t count;
+
+      scan_chunk() : entries(nullptr), keys(nullptr), values(nullptr), count(0) {}
+      scan_chunk(::std::pair<Key, T> const * _entries, size_t const & _count) :
+        entries(_entries), keys(nullptr), values(nullptr), count(_count) {}
+      scan_chunk(Key const * _keys, T const * _values, size_t const & _count) :
+        entries(nullptr), keys(_keys), values(_values), count(_count) {}
+
+      size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+      Key const & key(size_t const & i) const { return (entries == nullptr) ? keys[i] : entries[i].first; }
+      T const & value(size_t const & i) const { return (entries == nullptr) ? values[i] : entries[i].second; }
+  };
+
+  /// source of the chunks of a scan_cursor, over the local container of a map.  local.
+  template <typename Key, typename T>
+  class local_scanner {
+    public:
+      virtual ~local_scanner() {}
+      /// the next at most max local entries.  empty at the end.
+      virtual scan_chunk<Key, T> next(size_t const & max) = 0;
+  };
+
+  /// scan of an iterator range, e.g. of a hash table.  each chunk is copied into a buffer of at most max entries.
+  template <typename Key, typename T, typename Iter>
+  class iterator_scanner : public local_scanner<Key, T> {
+      Iter it;
+      Iter end;
+      ::std::vector<::std::pair<Key, T> > buffer;
+
+    public:
+      iterator_scanner(Iter const & _begin, Iter const & _end) : it(_begin), end(_end) {}
+
+      virtual scan_chunk<Key, T> next(size_t const & max) {
+        buffer.clear();
+        for (; (it != end) && (buffer.size() < max); ++it) buffer.emplace_back(it->first, it->second);
+        return scan_chunk<Key, T>(buffer.data(), buffer.size());
+      }
+  };
+
+  /// zero copy scan of contiguous pairs, e.g. the vector of the sorted maps.
+  template <typename Key, typename T>
+  class contiguous_scanner : public local_scanner<Key, T> {
+      ::std::pair<Key, T> const * it;
+      ::std::pair<Key, T> const * end;
+
+    public:
+      contiguous_scanner(::std::pair<Key, T> const * _begin, size_t const & count) : it(_begin), end(_begin + count) {}
+
+      virtual scan_chunk<Key, T> next(size_t const & max) {
+        size_t n = ::std::min(max, static_cast<size_t>(end - it));
+        scan_chunk<Key, T> out(it, n);
+        it += n;
+        return out;
+      }
+  };
+
+  /// zero copy scan of separate key and value arrays, e.g. soa_sorted_vector.
+  template <typename Key, typename T>
+  class soa_scanner : public local_scanner<Key, T> {
+      Key const * keys;
+      T const * values;
+      size_t pos;
+      size_t count;
+
+    public:
+      soa_scanner(Key const * _keys, T const * _values, size_t const & _count) :
+        keys(_keys), values(_values), pos(0), count(_count) {}
+
+      virtual scan_chunk<Key, T> next(size_t const & max) {
+        size_t n = ::std::min(max, count - pos);
+        scan_chunk<Key, T> out(keys + pos, values + pos, n);
+        pos += n;
+        return out;
+      }
+  };
+
+  /// scan of a copy of the local entries, for local containers without iterators, e.g. fsc::densehash_multimap.
+  template <typename Key, typename T>
+  class copy_scanner : public local_scanner<Key, T> {
+      ::std::vector<::std::pair<Key, T> > entries;
+      size_t pos;
+
+    public:
+      copy_scanner(::std::vector<::std::pair<Key, T> > && _entries) : entries(::std::move(_entries)), pos(0) {}
+
+      virtual scan_chunk<Key, T> next(size_t const & max) {
+        size_t n = ::std::min(max, entries.size() - pos);
+        scan_chunk<Key, T> out(entries.data() + pos, n);
+        pos += n;
+        return out;
+      }
+  };
+
+  /**
+   * @brief  chunked scan over the local entries of a distributed map, instead of copying them all with to_vector.
+   * @details  each call to next gives the next at most chunk_size local entries of each process, so the extra memory is
+   *        bounded by chunk_size entries.  next is collective, and returns false on all processes once all processes are done.
+   *        until then, a process that is done gets empty chunks, so it can take part in collective calls on each chunk,
+   *        e.g. a collective write.  the map must not be modified during the scan.
+   *
+   *        while (cursor.next()) { auto const & chunk = cursor.chunk(); for (size_t i = 0; i < chunk.size(); ++i) ... }
+   */
+  template <typename Key, typename T>
+  class scan_cursor {
+      ::std::unique_ptr<local_scanner<Key, T> > scanner;
+      size_t chunk_size;
+      mxx::comm const * comm;
+      scan_chunk<Key, T> current;
+      size_t scanned;
+      bool local_done;
+
+    public:
+      scan_cursor(::std::unique_ptr<local_scanner<Key, T> > && _scanner, size_t const & _chunk_size, mxx::comm const & _comm) :
+        scanner(::std::move(_scanner)), chunk_size(::std::max(_chunk_size, static_cast<size_t>(1))), comm(&_comm),
+        scanned(0), local_done(false) {}
+
+      /// advance all processes to their next chunk.  collective.  false if no process has entries left.
+      bool next() {
+        current = local_done ? scan_chunk<Key, T>() : scanner->next(chunk_size);
+        local_done = current.empty();
+        scanned += current.size();
+        if (comm->size() == 1) return !local_done;
+        return ::mxx::any_of(!local_done, *comm);
+      }
+
+      /// the current chunk of the local entries.  empty if this process is done.
+      scan_chunk<Key, T> const & chunk() const { return current; }
+
+      /// number of local entries in the chunks so far.
+      size_t local_scanned() const { return scanned; }
+
+      /// true if the local entries are done, while other processes may still have entries.
+      bool local_end() const { return local_done; }
+  };
+
+
+  /**
+   * @brief  non-owning range over local storage of a map, e.g. from local_entries, local_keys, local_values.
+   * @details  no allocation or copy, unlike to_vector and keys.  valid until the map is next modified.  for contiguous
+   *        layouts Iter is a pointer, so begin()/size() can be passed on as a span.  size() is linear otherwise.
+   */
+  template <typename Iter>
+  class local_view {
+      Iter first;
+      Iter last;
+
+    public:
+      using iterator = Iter;
+      using value_type = typename ::std::iterator_traits<Iter>::value_type;
+
+      local_view(Iter const & _first, Iter const & _last) : first(_first), last(_last) {}
+
+      Iter begin() const { return first; }
+      Iter end() const { return last; }
+      bool empty() const { return first == last; }
+      size_t size() const { return ::std::distance(first, last); }
+  };
+
+  template <typename Iter>
+  local_view<Iter> make_local_view(Iter const & first, Iter const & last) {
+    return local_view<Iter>(first, last);
+  }
+
+  /**
+   * @brief  forward iterator over element I (0 = key, 1 = value) of the pairs of Iter.  projection on read, for hash tables.
+   * @details  gives a reference into the table if Iter does, else the element by value (e.g. compact_counting_map).
+   */
+  template <typename Iter, size_t I>
+  class entry_field_iterator {
+      using base_reference = typename ::std::iterator_traits<Iter>::reference;
+      Iter it;
+
+    public:
+      using iterator_category = ::std::forward_iterator_tag;
+      using value_type = typename ::std::remove_const<typename ::std::remove_reference<
+          decltype(::std::get<I>(::std::declval<base_reference>()))>::type>::type;
+      using difference_type = typename ::std::iterator_traits<Iter>::difference_type;
+      using pointer = value_type const *;
+      using reference = typename ::std::conditional<::std::is_reference<base_reference>::value,
+          value_type const &, value_type>::type;
+
+      entry_field_iterator() : it() {}
+      explicit entry_field_iterator(Iter const & _it) : it(_it) {}
+
+      reference operator*() const { return ::std::get<I>(*it); }
+      entry_field_iterator & operator++() { ++it; return *this; }
+      entry_field_iterator operator++(int) { entry_field_iterator out(*this); ++it; return out; }
+      bool operator==(entry_field_iterator const & other) const { return it == other.it; }
+      bool operator!=(entry_field_iterator const & other) const { return it != other.it; }
+  };
+
+  /// view of the keys of a range of local pairs.
+  template <typename Iter>
+  local_view<entry_field_iterator<Iter, 0> > make_key_view(Iter const & first, Iter const & last) {
+    return local_view<entry_field_iterator<Iter, 0> >(entry_field_iterator<Iter, 0>(first), entry_field_iterator<Iter, 0>(last));
+  }
+
+  /// view of the values of a range of local pairs.
+  template <typename Iter>
+  local_view<entry_field_iterator<Iter, 1> > make_value_view(Iter const & first, Iter const & last) {
+    return local_view<entry_field_iterator<Iter, 1> >(entry_field_iterator<Iter, 1>(first), entry_field_iterator<Iter, 1>(last));
+  }
+
 
   /**
    * KeyTransformParams should be an alias of a specialization of DistributedMapParams.  see subclass for example.
@@ -164,6 +521,28 @@ namespace dsc
 	  using StoreTransformedFunc = typename MapParams<Key>::StorageTransformedFunction;
 	  using StoreTransformedEqual = typename MapParams<Key>::StorageTransformedEqual;
 
+	public:
+	  /// input transform and transformed distribution function.  maps that have the same ones, and the same bucket table
+	  /// or splitters, assign each key to the same process, i.e. they are co-partitioned.
+	  using input_transform_type = InputTransform;
+	  using distribution_function_type = DistTransformedFunc;
+
+	  /// true if distribution and storage use the same transformed hash, e.g. via SingleHashMapParams.
+	  static constexpr bool single_hash = ::std::is_same<DistTransformedFunc, StoreTransformedFunc>::value;
+
+	  /**
+	   * @brief map a distribution hash value to a virtual bucket in [0, bucket_table::nbuckets).  see bucket_table for the rank.
+	   * @details  with a single hash, the local hash table uses the low bits, so the bucket is the high bits.  otherwise the
+	   *        distribution hash is independent of the storage hash, and computed with bucket_table::bits prefix bits.
+	   */
+	  static inline size_t hash_to_bucket(uint64_t const & h) {
+	    return single_hash ?
+	        static_cast<size_t>(h >> (64 - ::dsc::bucket_table::bits)) :
+	        static_cast<size_t>(h & (::dsc::bucket_table::nbuckets - 1));
+	  }
+
+	protected:
+
 	  // primarily for use with distributed_map and sorted_map, where the TransformedFunction is
 	  // a comparator, but we need a hash function.
 	  template <typename K>
@@ -185,18 +564,339 @@ namespace dsc
       // communication stuff...
       const mxx::comm& comm;
 
+      /// choice of distribute-compute-gather algorithm for the one to one queries (count).
+      ::imxx::distribution_policy dist_policy;
+
+      /// find counts the matches of the received queries first, so the results are allocated once at the exact size.
+      /// otherwise the size is extrapolated from the first queries, and may be far off for multimaps with skewed multiplicity.
+      bool exact_find_size;
+
+      /// find sends the results back grouped by key and delta encoded.  see response_codec.hpp
+      bool compress_find;
+
+      /// distribute buffers and mappings of the queries, kept between calls.  mutable since the queries are const.
+      mutable ::imxx::buffer_pool buffers;
+
+      /// build phase, between begin_build and finalize:  insert appends to the staged input instead of inserting.
+      bool building;
+      /// input staged during a build, as entries, or as keys for the counting maps.  not yet transformed or distributed.
+      ::std::vector<::std::pair<Key, T> > staged;
+      ::std::vector<Key> staged_keys;
+
       // ============= local modifiers.  not directly accessible publically.  meant to be called via collective calls.
 
       // abstract declarations - need to access the local containers, therefore override in subclases.
       virtual void local_reset() = 0;
       virtual void local_clear() = 0;
       virtual void local_reserve(size_t n) = 0;
+      /// rebuild the local container at the capacity for its current size.
+      virtual void local_compact() = 0;
+
+      map_base(const mxx::comm& _comm) : comm(_comm), exact_find_size(true), compress_find(false), building(false) {}
+
+      /// during a build, move input to the end of stage.  input is empty afterwards.  not collective.  returns the number staged.
+      template <typename V>
+      size_t stage_input(::std::vector<V> & input, ::std::vector<V> & stage) {
+        size_t n = input.size();
+        if (stage.empty()) {
+          stage.swap(input);
+        } else {
+          stage.insert(stage.end(), ::std::make_move_iterator(input.begin()), ::std::make_move_iterator(input.end()));
+        }
+        ::std::vector<V>().swap(input);
+        return n;
+      }
+
+      /// insert_op(input) for all input staged in stage, as 1 batch.  collective.
+      template <typename V, typename InsertOp>
+      void insert_staged(::std::vector<V> & stage, InsertOp const & insert_op) {
+        ::std::vector<V> input;
+        input.swap(stage);
+        insert_op(input);
+      }
+
+      /// insert the staged input with insert_staged, and do any one time work after a build.  collective.  see finalize
+      virtual void finalize_build() {}
+
+      /// send send_counts[i] find results back to process i, compressed if compress_find is set, and replace results with the received ones.  collective.
+      void return_find_results(::std::vector<::std::pair<Key, T> > & results, ::std::vector<size_t> const & send_counts) const {
+        if (compress_find) {
+          ::dsc::compressed_all2allv(results, send_counts, comm);
+        } else {
+          mxx::all2allv(results, send_counts, comm).swap(results);
+        }
+      }
+
+
+      // ============= save and load.  1 file for the distributed container, written and read with MPI-IO.
+
+      /**
+       * @brief header of a saved map.  followed by the element count of each saving process (comm_size uint64_t),
+       *        then the elements of all processes, in rank order.
+       * @details  the distribution function of the hashed maps depends only on the map type and the bucket table, so a file
+       *        saved and loaded with the same number of processes and bucket table does not need to be redistributed.
+       */
+      struct file_header {
+          uint64_t magic;
+          uint64_t version;
+          uint64_t type_id;     // hash of the map's type name, so a file is only loaded into the same type of map.
+          uint64_t value_size;  // sizeof(std::pair<Key, T>)
+          uint64_t comm_size;   // number of processes that saved the map.
+          uint64_t partition_id;  // see get_partition_id.
+          uint64_t count;       // total number of elements.
+      };
+
+      /// "BLISSMAP" as a little endian uint64_t, and the format version.
+      static constexpr uint64_t file_magic = 0x50414D5353494C42UL;
+      static constexpr uint64_t file_version = 2UL;
+
+      /// size of each MPI-IO read or write call.  bounds the memory used during load, and keeps byte counts in int range.
+      static constexpr size_t io_chunk_bytes = 64UL * 1024UL * 1024UL;
+
+      /// FNV-1a hash of the dynamic type name.
+      uint64_t get_type_id() const {
+        uint64_t h = 0xcbf29ce484222325UL;
+        for (const char * c = typeid(*this).name(); *c != 0; ++c) {
+          h ^= static_cast<unsigned char>(*c);
+          h *= 0x100000001b3UL;
+        }
+        return h;
+      }
+
+      /// format an MPI-IO error and throw on all processes.
+      void throw_io_error(::std::string const & filename, ::std::string const & op, int res) const {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(res, msg, &len);
+
+        ::std::stringstream ss;
+        ss << "ERROR : dsc::map_base " << op << ": rank " << comm.rank() << " [" << filename << "] " << ::std::string(msg, len);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      /**
+       * @brief  write a header, then the local elements of all processes in rank order, to a file.  collective.
+       * @param head   bytes at the start of the file.  written by rank 0, but all processes need the same size.
+       * @param local  elements on the current process.
+       */
+      template <typename A>
+      void write_entries(::std::string const & filename, ::std::vector<unsigned char> const & head,
+                         ::std::vector<::std::pair<Key, T>, A> const & local) const {
+        using V = ::std::pair<Key, T>;
+
+        MPI_File fh;
+        int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+        if (res != MPI_SUCCESS) throw_io_error(filename, "open", res);
+
+        // truncate any existing file.
+        res = MPI_File_set_size(fh, 0);
+
+        MPI_Status stat;
+        if ((res == MPI_SUCCESS) && (comm.rank() == 0) && (head.size() > 0)) {
+          res = MPI_File_write_at(fh, 0, const_cast<unsigned char *>(head.data()), head.size(), MPI_BYTE, &stat);
+        }
+
+        // then all processes write their elements, in chunks.  all participate in every round.
+        size_t chunk = ::std::max(static_cast<size_t>(1), io_chunk_bytes / sizeof(V));
+        size_t rounds = ::mxx::allreduce((local.size() + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+
+        size_t prefix = ::mxx::exscan(local.size(), comm);
+        if (comm.rank() == 0) prefix = 0;
+        MPI_Offset offset = head.size() + prefix * sizeof(V);
+
+        size_t pos = 0, n;
+        for (size_t r = 0; r < rounds; ++r) {
+          n = ::std::min(chunk, local.size() - pos);
+          int r_res = MPI_File_write_at_all(fh, offset, const_cast<V*>(local.data() + pos), n * sizeof(V), MPI_BYTE, &stat);
+          if (res == MPI_SUCCESS) res = r_res;
+          offset += n * sizeof(V);
+          pos += n;
+        }
+
+        int c_res = MPI_File_close(&fh);
+        if (res == MPI_SUCCESS) res = c_res;
+
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+          throw_io_error(filename, "save", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+        }
+      }
+
+      /**
+       * @brief  write the local elements of all processes to a file, with the file_header and counts.  collective.
+       * @param local  elements on the current process.
+       */
+      void save_entries(::std::string const & filename, ::std::vector<::std::pair<Key, T> > const & local) const {
+        uint64_t local_count = local.size();
+        ::std::vector<uint64_t> counts = ::mxx::allgather(local_count, comm);
+
+        file_header header;
+        header.magic = file_magic;
+        header.version = file_version;
+        header.type_id = get_type_id();
+        header.value_size = sizeof(::std::pair<Key, T>);
+        header.comm_size = comm.size();
+        header.partition_id = this->get_partition_id();
+        header.count = 0;
+        for (size_t i = 0; i < counts.size(); ++i) header.count += counts[i];
+
+        ::std::vector<unsigned char> head(sizeof(file_header) + counts.size() * sizeof(uint64_t));
+        memcpy(head.data(), &header, sizeof(file_header));
+        memcpy(head.data() + sizeof(file_header), counts.data(), counts.size() * sizeof(uint64_t));
+
+        write_entries(filename, head, local);
+      }
+
+      /**
+       * @brief  read the elements from a file and pass each chunk to local_load.  collective.
+       * @details  if the file was saved by a map of the same type with the same number of processes, each process reads back
+       *           its own elements and local_load is told that no redistribution is needed.  otherwise the elements are
+       *           block partitioned, and local_load redistributes each chunk as it is read, so the file is read in 1 pass.
+       *           all processes call local_load the same number of times, so local_load can be collective.
+       */
+      void load_entries(::std::string const & filename) {
+        using V = ::std::pair<Key, T>;
+
+        MPI_File fh;
+        int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+        if (res != MPI_SUCCESS) throw_io_error(filename, "open", res);
+        MPI_File_set_atomicity(fh, 0);
+
+        // all processes read the header.
+        MPI_Status stat;
+        file_header header = file_header();
+        res = MPI_File_read_at_all(fh, 0, &header, sizeof(file_header), MPI_BYTE, &stat);
+        if ((res != MPI_SUCCESS) ||
+            (header.magic != file_magic) || (header.version != file_version) ||
+            (header.value_size != sizeof(V)) || (header.type_id != get_type_id())) {
+          MPI_File_close(&fh);
+          ::std::stringstream ss;
+          ss << "ERROR : dsc::map_base load: [" << filename << "] is not a saved map of this type.";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        ::std::vector<uint64_t> counts(header.comm_size, 0);
+        res = MPI_File_read_at_all(fh, sizeof(file_header), counts.data(), counts.size() * sizeof(uint64_t), MPI_BYTE, &stat);
+
+        // get the range of elements to read.
+        bool same_partition = (header.comm_size == static_cast<uint64_t>(comm.size())) &&
+            (header.partition_id == this->get_partition_id());
+        size_t start = 0, local_count = 0;
+        if (same_partition) {
+          for (int i = 0; i < comm.rank(); ++i) start += counts[i];
+          local_count = counts[comm.rank()];
+        } else {
+          size_t step = header.count / comm.size();
+          size_t rem = header.count % comm.size();
+          size_t rank = comm.rank();
+          start = rank * step + ::std::min(rank, rem);
+          local_count = step + ((rank < rem) ? 1 : 0);
+        }
+
+        size_t chunk = ::std::max(static_cast<size_t>(1), io_chunk_bytes / sizeof(V));
+        size_t rounds = ::mxx::allreduce((local_count + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+
+        MPI_Offset offset = sizeof(file_header) + counts.size() * sizeof(uint64_t) + start * sizeof(V);
+
+        ::std::vector<V> buffer;
+        buffer.reserve(::std::min(chunk, local_count));
+        size_t pos = 0, n;
+        for (size_t r = 0; r < rounds; ++r) {
+          n = ::std::min(chunk, local_count - pos);
+          buffer.resize(n);
+          int r_res = MPI_File_read_at_all(fh, offset, buffer.data(), n * sizeof(V), MPI_BYTE, &stat);
+          if (res == MPI_SUCCESS) res = r_res;
+          offset += n * sizeof(V);
+          pos += n;
+
+          this->local_load(buffer, same_partition);
+        }
+
+        int c_res = MPI_File_close(&fh);
+        if (res == MPI_SUCCESS) res = c_res;
+
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+          throw_io_error(filename, "load", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+        }
+      }
 
-      map_base(const mxx::comm& _comm) : comm(_comm) {}
+      /**
+       * @brief  insert elements read from a saved map into the local container, without reduction.  may be collective.
+       * @param entries          elements read by the current process.  may be modified.
+       * @param same_partition   true if the entries are already on the correct process.
+       */
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool same_partition) = 0;
+
+      /// identifies the assignment of keys to processes, e.g. the hashed maps' bucket table.  0 if it depends on the content only.
+      virtual uint64_t get_partition_id() const { return 0; }
+
+      /// source of the local chunks for scan.  see scan_cursor.
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const = 0;
 
     public:
       virtual ~map_base() {};
 
+      /// set the algorithm choice for the one to one queries.  should be the same on all processes.
+      void set_distribution_policy(::imxx::distribution_policy const & policy) {
+        dist_policy = policy;
+      }
+
+      ::imxx::distribution_policy const & get_distribution_policy() const {
+        return dist_policy;
+      }
+
+      /// the pool of query and insert buffers, capped at 64 MB by default, e.g. to change the cap, or to clear it after a query phase.  local.
+      ::imxx::buffer_pool & get_buffer_pool() const {
+        return buffers;
+      }
+
+      /// choose between exact (2 pass) and estimated result allocation in find.  default is exact.
+      void set_exact_find_size(bool exact) {
+        exact_find_size = exact;
+      }
+
+      bool get_exact_find_size() const {
+        return exact_find_size;
+      }
+
+      /// compress the find results sent back:  the key once per key, and positions delta encoded.  default is uncompressed.
+      /// worth it for multimaps with repetitive keys, e.g. position and position-quality indices.
+      void set_compress_find(bool compress) {
+        compress_find = compress;
+      }
+
+      bool get_compress_find() const {
+        return compress_find;
+      }
+
+      /**
+       * @brief start a build made of many insert batches, e.g. a streaming build.  call on all processes.
+       * @details  until finalize, insert only appends its input to a local staging vector:  no transform, communication,
+       *          rehash, or sort per batch.  finalize then inserts all of it as 1 batch, so the hashed maps reserve once and
+       *          recount their unique keys once, and the sorted maps sort and rebalance once.  inserts with a predicate
+       *          are not staged.  queries and erase see only the finalized entries.  the staged input takes about the
+       *          memory of the input, so a build bounded by memory should not stage.
+       */
+      void begin_build() {
+        building = true;
+      }
+
+      bool is_building() const {
+        return building;
+      }
+
+      /**
+       * @brief end the build started by begin_build:  insert the staged input, then the map is queried as usual.  collective.
+       * @details  also does the one time work of the map type, e.g. the sort of the sorted maps, and counts the unique keys,
+       *          which the multimaps otherwise do in the first query.  the maps with a read only layout can be frozen
+       *          after, see freeze.  may be called without a build.
+       */
+      void finalize() {
+        building = false;
+        this->finalize_build();
+        this->local_unique_size();
+        if (comm.size() > 1) comm.barrier();
+      }
+
 
       // ================ data access functions
       virtual void to_vector(std::vector<std::pair<Key, T> > & result) const  = 0;
@@ -216,6 +916,14 @@ namespace dsc
         return result;
       }
 
+      /**
+       * @brief  scan the local entries in chunks of at most chunk_size, e.g. to export or sample the map at constant extra memory.
+       * @details  the calls to next of the cursor are collective.  see scan_cursor.
+       */
+      ::dsc::scan_cursor<Key, T> scan(size_t const & chunk_size) const {
+        return ::dsc::scan_cursor<Key, T>(this->make_local_scanner(), chunk_size, comm);
+      }
+
       // =========== local accessors.  abstract methods since they need access to local containers.
       virtual bool local_empty() const = 0;
       virtual size_t local_size() const = 0;
@@ -270,19 +978,150 @@ namespace dsc
 
       virtual void reset() {
     	  this->local_reset();
+    	  buffers.clear();
+    	  building = false;
+    	  ::std::vector<::std::pair<Key, T> >().swap(staged);
+    	  ::std::vector<Key>().swap(staged_keys);
           if (comm.size() > 1)
             comm.barrier();
 
       }
 
+      /**
+       * @brief release the memory left over from erase, e.g. after filtering out the erroneous k-mers.  collective.
+       * @details  each process rebuilds its local container at the capacity for its current size.
+       * @param rebalance  also even out the element counts across processes, if the partitioning allows it.
+       *        the hashed maps assign a key to a fixed process, so they ignore it.
+       */
+      virtual void compact(bool rebalance = false) {
+        this->local_compact();
+        if (comm.size() > 1)
+          comm.barrier();
+      }
+
       /// clears the distributed container.
       virtual void clear() {
         // clear + barrier.
         this->local_clear();
+        building = false;
+        staged.clear();
+        staged_keys.clear();
+        if (comm.size() > 1)
+          comm.barrier();
+      }
+
+      /**
+       * @brief save the distributed container to a single file, for checkpoint/restart.  collective.
+       * @note  copies the local container into a vector first.
+       */
+      virtual void save(::std::string const & filename) const {
+        ::std::vector<::std::pair<Key, T> > local;
+        this->to_vector(local);
+        this->save_entries(filename, local);
+      }
+
+      /**
+       * @brief replace the content of the distributed container with that of a saved file.  collective.
+       * @details  no redistribution if the file was saved with the same number of processes.
+       *           otherwise the elements are redistributed as they are read.
+       */
+      virtual void load(::std::string const & filename) {
+        this->local_clear();
+        this->load_entries(filename);
         if (comm.size() > 1)
           comm.barrier();
       }
 
+      // ============= per process save and load, e.g. for build checkpoints.  POSIX I/O, no communication.
+
+      /// header of a per process file with count elements:  comm_size and partition_id as for save.  the rank follows the header.
+      file_header local_file_header(size_t const & count) const {
+        file_header header;
+        header.magic = file_magic;
+        header.version = file_version;
+        header.type_id = get_type_id();
+        header.value_size = sizeof(::std::pair<Key, T>);
+        header.comm_size = comm.size();
+        header.partition_id = this->get_partition_id();
+        header.count = count;
+        return header;
+      }
+
+      /**
+       * @brief copy of the local elements for a per process file.  write does not access the map, so it can run in a
+       *        background thread while the map is modified, e.g. for the checkpoints of a build.
+       */
+      struct local_snapshot {
+          ::std::string filename;
+          file_header header;
+          uint64_t rank;
+          ::std::vector<::std::pair<Key, T> > entries;
+
+          /// write to filename.tmp, then rename, so an existing file is replaced whole.  throws IOException on error.
+          void write() const {
+            ::std::string tmp = filename + ".tmp";
+            FILE * f = fopen(tmp.c_str(), "wb");
+            bool ok = (f != NULL);
+            if (ok) ok = (fwrite(&header, sizeof(file_header), 1, f) == 1) && (fwrite(&rank, sizeof(uint64_t), 1, f) == 1);
+            if (ok && (entries.size() > 0))
+              ok = (fwrite(entries.data(), sizeof(::std::pair<Key, T>), entries.size(), f) == entries.size());
+            if (f != NULL) ok = (fclose(f) == 0) && ok;
+            if (ok) ok = (rename(tmp.c_str(), filename.c_str()) == 0);
+            if (!ok) {
+              int myerr = errno;
+              ::std::stringstream ss;
+              ss << "ERROR : dsc::map_base save_local: [" << filename << "] " << strerror(myerr);
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+          }
+      };
+
+      /// copy the local elements for save_local.  local.
+      local_snapshot snapshot_local(::std::string const & filename) const {
+        local_snapshot snap;
+        snap.filename = filename;
+        snap.rank = comm.rank();
+        this->to_vector(snap.entries);
+        snap.header = local_file_header(snap.entries.size());
+        return snap;
+      }
+
+      /// save the local elements to a per process file.  local.
+      void save_local(::std::string const & filename) const {
+        snapshot_local(filename).write();
+      }
+
+      /**
+       * @brief replace the local elements with those of a save_local file.  local.
+       * @details  the file has to be saved by the same rank of a map of the same type, number of processes, and bucket table,
+       *        so that no redistribution is needed.  throws IOException otherwise.
+       */
+      void load_local(::std::string const & filename) {
+        using V = ::std::pair<Key, T>;
+        FILE * f = fopen(filename.c_str(), "rb");
+        file_header header = file_header();
+        uint64_t rank = 0;
+        bool ok = (f != NULL);
+        if (ok) ok = (fread(&header, sizeof(file_header), 1, f) == 1) && (fread(&rank, sizeof(uint64_t), 1, f) == 1);
+        file_header expected = local_file_header(header.count);
+        ok = ok && (memcmp(&header, &expected, sizeof(file_header)) == 0) && (rank == static_cast<uint64_t>(comm.rank()));
+
+        ::std::vector<V> buffer;
+        if (ok) {
+          buffer.resize(header.count);
+          if (header.count > 0) ok = (fread(buffer.data(), sizeof(V), buffer.size(), f) == buffer.size());
+        }
+        if (f != NULL) fclose(f);
+        if (!ok) {
+          ::std::stringstream ss;
+          ss << "ERROR : dsc::map_base load_local: [" << filename << "] is not a save_local file of this map on rank " << comm.rank() << ".";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        this->local_clear();
+        this->local_load(buffer, true);
+      }
+
       template <typename V>
       void transform_input(std::vector<V> & input) const {
     	  std::transform(input.begin(), input.end(), input.begin(), InputTransform());
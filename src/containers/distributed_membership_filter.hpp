@@ -0,0 +1,268 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_membership_filter.hpp
+ * @ingroup dsc::containers
+ * @brief   distributed membership filter over the keys of a hashed distributed map, for screening out absent keys.
+ * @details  each process builds a fsc::xor_filter from the keys it owns, so the filters together cover the map, and a key
+ *          is tested on the process that owns it.  optionally the filters are replicated on all processes, so a key is
+ *          tested locally, and keys that are absent, e.g. most reads against a contaminant set, are removed before
+ *          any communication or hash table lookup.  the replicated copy takes about 1.23 bytes per key of the whole map
+ *          per process with 8 bit fingerprints.
+ *
+ *          the filter has no false negatives, and false positives at a rate of 2^-(bits of Fingerprint).  it is a
+ *          snapshot:  later changes to the map are not reflected.
+ */
+#ifndef DISTRIBUTED_MEMBERSHIP_FILTER_HPP_
+#define DISTRIBUTED_MEMBERSHIP_FILTER_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+
+#include <mxx/collective.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/bucket_table.hpp"
+#include "containers/xor_filter.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+
+namespace dsc {
+
+  /**
+   * @brief membership filter with the distribution of a hashed map.  constructed from the map, e.g. via its membership_filter method.
+   */
+  template<typename Key,
+    template <typename> class MapParams,
+    typename Fingerprint = uint8_t
+  >
+  class membership_filter {
+
+    protected:
+      using MapBase = ::dsc::map_base<Key, bool, MapParams>;
+      using InputTransform = typename MapParams<Key>::InputTransform;
+      using StoreTransformedFunc = typename MapParams<Key>::StorageTransformedFunction;
+
+      /// same key to rank function as unordered_map_base.
+      struct KeyToRank {
+          typename MapParams<Key>::DistributionTransformedFunction proc_trans_hash;
+          ::dsc::bucket_table buckets;
+
+          KeyToRank(::dsc::bucket_table const & table) :
+            proc_trans_hash(typename MapParams<Key>::template DistFunction<Key>(::dsc::bucket_table::bits),
+                            typename MapParams<Key>::template DistTransform<Key>()),
+            buckets(table) {};
+
+          inline int operator()(Key const & x) const {
+            return buckets[MapBase::hash_to_bucket(proc_trans_hash(x))];
+          }
+      } key_to_rank;
+
+    public:
+      using key_type = Key;
+      using size_type = size_t;
+      using filter_type = ::fsc::xor_filter<Key, StoreTransformedFunc, Fingerprint>;
+
+      /// same as unordered_map_base::partition_type.
+      using partition_type = ::std::pair<typename MapParams<Key>::DistributionTransformedFunction,
+          ::std::integral_constant<bool, MapBase::single_hash> >;
+
+    protected:
+      const mxx::comm& comm;
+
+      InputTransform trans;
+
+      /// filter of the keys owned by this process.
+      filter_type local;
+
+      /// filters of all processes, by rank, if replicated.
+      ::std::vector<filter_type> replicas;
+
+      /// contains, for a transformed key.
+      bool contains_transformed(Key const & k) const {
+        int r = (comm.size() == 1) ? 0 : key_to_rank(k);
+        if (r == comm.rank()) return local.contains(k);
+        if (!is_replicated())
+          throw ::std::logic_error("membership_filter: contains for a remote key needs the replicated filters.");
+        return replicas[r].contains(k);
+      }
+
+    public:
+      /**
+       * @brief build from the local keys of a hashed map.  collective if replicate.
+       * @param replicate  also copy every process's filter to all processes.  see replicate().
+       */
+      template <typename SourceMap>
+      membership_filter(SourceMap const & source, const mxx::comm& _comm, bool replicate = false) :
+        key_to_rank(source.get_bucket_table()), comm(_comm) {
+        static_assert(::std::is_same<partition_type, typename SourceMap::partition_type>::value,
+                      "membership filter has to use the same distribution as the source map.");
+        static_assert(::std::is_same<Key, typename SourceMap::key_type>::value,
+                      "membership filter has to have the same key type as the source map.");
+
+        BL_BENCH_INIT(filter);
+
+        BL_BENCH_START(filter);
+        ::std::vector<Key> keys;
+        source.keys(keys);
+        BL_BENCH_END(filter, "keys", keys.size());
+
+        BL_BENCH_START(filter);
+        filter_type(keys.begin(), keys.end()).swap(local);
+        BL_BENCH_END(filter, "build", local.bytes());
+
+        BL_BENCH_REPORT_MPI_NAMED(filter, "membership_filter:build", this->comm);
+
+        if (replicate) this->replicate();
+      }
+
+      virtual ~membership_filter() {};
+
+      /// copy every process's filter to all processes, so contains and screen need no communication.  collective.
+      void replicate() {
+        if (is_replicated()) return;
+
+        BL_BENCH_INIT(replicate);
+
+        BL_BENCH_COLLECTIVE_START(replicate, "allgather", comm);
+        ::std::vector<uint64_t> seeds = ::mxx::allgather(local.get_seed(), comm);
+        ::std::vector<size_t> sizes = ::mxx::allgather(local.get_fingerprints().size(), comm);
+        ::std::vector<Fingerprint> all = ::mxx::allgatherv(local.get_fingerprints(), comm);
+        BL_BENCH_END(replicate, "allgather", all.size());
+
+        BL_BENCH_START(replicate);
+        replicas.clear();
+        replicas.reserve(comm.size());
+        auto start = all.begin();
+        for (int i = 0; i < comm.size(); ++i) {
+          replicas.emplace_back(seeds[i], ::std::vector<Fingerprint>(start, start + sizes[i]));
+          start += sizes[i];
+        }
+        BL_BENCH_END(replicate, "split", replicas.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(replicate, "membership_filter:replicate", comm);
+      }
+
+      bool is_replicated() const {
+        return replicas.size() == static_cast<size_t>(comm.size());
+      }
+
+      /// release the replicated filters.  local.
+      void release_replicas() {
+        ::std::vector<filter_type>().swap(replicas);
+      }
+
+      ::dsc::bucket_table const & get_bucket_table() const {
+        return key_to_rank.buckets;
+      }
+
+      /// bytes of the filters held by this process.
+      size_t local_bytes() const {
+        if (!is_replicated()) return local.bytes();
+        size_t bytes = 0;
+        for (auto const & f : replicas) bytes += f.bytes();
+        return bytes;
+      }
+
+      /**
+       * @brief true if the key is (probably) in the map.  local, no communication.
+       * @details  needs the replicated filters, except on a single process or for keys owned by this process.
+       */
+      bool contains(Key const & key) const {
+        return contains_transformed(trans(key));
+      }
+
+      /**
+       * @brief remove the keys that are not in the map.  the remaining keys are in the map up to the false positive rate.
+       * @details  local if replicated or on a single process, otherwise collective via count.  keys are not transformed,
+       *        so they can be passed to the map's queries as they are.
+       * @return  the number of keys removed.
+       */
+      size_t screen(::std::vector<Key> & keys) const {
+        size_t before = keys.size();
+        if (is_replicated() || (comm.size() == 1)) {
+          keys.erase(::std::remove_if(keys.begin(), keys.end(), [this](Key const & k) {
+            return !this->contains(k);
+          }), keys.end());
+          return before - keys.size();
+        }
+
+        ::std::vector<Key> query;
+        query.reserve(keys.size());
+        for (auto const & k : keys) query.emplace_back(trans(k));
+        auto counts = this->count(query);
+        ::std::vector<Key> present;
+        for (auto const & x : counts) {
+          if (x.second > 0) present.emplace_back(x.first);
+        }
+        // keep the original keys whose transformed key is present.
+        ::std::sort(present.begin(), present.end());
+        keys.erase(::std::remove_if(keys.begin(), keys.end(), [this, &present](Key const & k) {
+          return !::std::binary_search(present.begin(), present.end(), trans(k));
+        }), keys.end());
+        return before - keys.size();
+      }
+
+      /**
+       * @brief 1 if the key is (probably) in the map, else 0, for each key.  collective.
+       * @details  each key is tested by the process that owns it, or locally if replicated.  results are in the
+       *        order of the transformed keys.
+       * @param keys  content will be changed and reordered.
+       */
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys) const {
+        ::std::vector<::std::pair<Key, size_type> > results;
+        results.reserve(keys.size());
+
+        ::std::transform(keys.begin(), keys.end(), keys.begin(), trans);
+
+        if (is_replicated() || (comm.size() == 1)) {
+          for (auto const & k : keys) results.emplace_back(k, this->contains_transformed(k) ? 1 : 0);
+          return results;
+        }
+
+        BL_BENCH_INIT(count);
+
+        BL_BENCH_COLLECTIVE_START(count, "dist_query", comm);
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<Key > buffer;
+        ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, comm);
+        keys.swap(buffer);
+        BL_BENCH_END(count, "dist_query", keys.size());
+
+        BL_BENCH_START(count);
+        for (auto const & k : keys) results.emplace_back(k, local.contains(k) ? 1 : 0);
+        BL_BENCH_END(count, "local_count", results.size());
+
+        // 1 result per query, so send back using the recv counts.
+        BL_BENCH_COLLECTIVE_START(count, "a2a2", comm);
+        mxx::all2allv(results, recv_counts, comm).swap(results);
+        BL_BENCH_END(count, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "membership_filter:count", comm);
+        return results;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* DISTRIBUTED_MEMBERSHIP_FILTER_HPP_ */
@@ -63,6 +63,11 @@
 #include "utils/filter_utils.hpp"
 
 #include "containers/distributed_map_base.hpp"
+#include "containers/distributed_frozen_sorted_map.hpp"
+#include "containers/mapped_map.hpp"
+#include "containers/radix_sort.hpp"
+#include "containers/parallel_merge.hpp"
+#include "containers/interpolation_search.hpp"
 #include "common/kmer_transform.hpp"
 #include "containers/dsc_container_utils.hpp"
 #include "io/incremental_mxx.hpp"
@@ -138,7 +143,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
    * 				find/cnt   : unique input, distribute, search, return results.
    * 				erase  : unique input, distribute, delete.  user can then call rehash with sorted set to true: (multimap: balance, sample and redistribute, keep pivots) (map: balance, get pivots)
    *       2. rehash - redistribute carefully.  map: should balance, sort(unique first, sample and redistribute, k-way merge, unique, balance (entries are unique so don't span multiple procs)), get pivots).
-   *       										multimap:  balance, mxx::sort(sort, sample and redistribute, k-way merge), sample and redistribute (due to nonunique entries), get pivots.
+   *       										multimap:  balance, imxx::samplesort(sort, sample and redistribute, loser tree merge), balance, sample and redistribute (due to nonunique entries), get pivots.
    *       3. sampling:  should it be based on nyquist, i.e. 2p-1?
    *
    * predicate : operates on container content.  query can be filtered before hand, and results can be filtered after (on source proc, or on dest proc).  container content should be filtered during.
@@ -186,8 +191,24 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+          /// keys whose entries cross process boundaries, with the first and last process holding them.  sorted.  only multimaps have these.
+          ::std::vector<::std::pair<Key, ::std::pair<int, int> > > spans;
+
+          /// first and last process holding entries of x.  operator() gives the last.
+          inline ::std::pair<int, int> owners(Key const & x) const {
+            if (spans.size() > 0) {
+              auto pos = ::std::lower_bound(spans.begin(), spans.end(), x, comp);
+              if ((pos != spans.end()) && !comp(x, pos->first)) return pos->second;
+            }
+            int r = this->operator()(x);
+            return ::std::make_pair(r, r);
+          }
       } key_to_rank;
 
+      /// optional offsets of the key prefixes in c, for Kmer keys.  see set_prefix_directory_bits.
+      using directory_type = ::fsc::prefix_directory<typename Base::StoreTransformedFunc>;
+
       /**
        * @brief count elements with the specified keys in the distributed sorted_multimap.
        * @note  input cannot have duplicate elements.
@@ -224,12 +245,34 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             return ::std::make_pair(range_begin, range_end);
           }
 
+          /**
+           * @brief  with a directory, narrow the search for v to its bucket.  the bucket start, if after el_end, is the
+           *        search hint in range_begin (see search_start), and the bucket end is returned.  entries before the
+           *        hint are not skipped by the operator, so erase still keeps them.
+           */
+          template <class DBIter, typename Query>
+          static inline DBIter narrow(directory_type const * dir, DBIter const & base,
+                                      DBIter & range_begin, DBIter const & el_end, DBIter const & range_end, Query const & v) {
+            if (dir == nullptr) return range_end;
+            auto r = dir->range(v);
+            DBIter hi = base + r.second;
+            if (hi < el_end) hi = el_end;
+            if (range_end < hi) hi = range_end;
+            DBIter lo = base + r.first;
+            if (lo < el_end) lo = el_end;
+            if (hi < lo) lo = hi;
+            range_begin = lo;
+            return hi;
+          }
+
           // assumes that container is sorted. and exact overlap region is provided.  do not filter output here since it's an output iterator.
+          // dir, if not null, is the directory of the container starting at base.
           template <class DBIter, class QueryIter, class OutputIter, class Operator, class Predicate = ::bliss::filter::TruePredicate>
           static size_t process(DBIter range_begin, DBIter range_end,
                                 QueryIter query_begin, QueryIter query_end,
                                 OutputIter &output, Operator & op,
-                                bool sorted_query = false, Predicate const &pred = Predicate()) {
+                                bool sorted_query = false, Predicate const &pred = Predicate(),
+                                directory_type const * dir = nullptr, DBIter base = DBIter()) {
 
               // no matches in container.
               if (range_begin == range_end) return 0;
@@ -245,6 +288,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             	  ::std::sort(query_begin, query_end, typename Base::StoreTransformedFunc());
 
               auto el_end = range_begin;
+              auto bucket_end = range_end;
               size_t count = 0;
               // CHECK DISABLED FOR NOW - dist_range for count index may not be big enough, causing linear to be used?
               bool linear = false; // (static_cast<double>(dist_query) * ::std::log2(dist_range)) > dist_range;
@@ -256,7 +300,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
                 if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
                   for (auto it = query_begin; it != query_end;) {
                     v = *it;
-                    count += op.template operator()<true>(range_begin, el_end, range_end, v, output, pred);
+                    bucket_end = narrow(dir, base, range_begin, el_end, range_end, v);
+                    count += op.template operator()<true>(range_begin, el_end, bucket_end, v, output, pred);
 
                     // compiler optimize out the conditional.
                     if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
@@ -266,7 +311,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
                   for (auto it = query_begin; it != query_end;) {
                     v = *it;
-                      count += op.template operator()<true>(range_begin, el_end, range_end, v, output);
+                    bucket_end = narrow(dir, base, range_begin, el_end, range_end, v);
+                    count += op.template operator()<true>(range_begin, el_end, bucket_end, v, output);
 
                     // compiler optimize out the conditional.
                     if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
@@ -281,7 +327,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
                 if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
                   for (auto it = query_begin; it != query_end;) {
                     v = *it;
-                      count += op.template operator()<false>(range_begin, el_end, range_end, v, output, pred);
+                    bucket_end = narrow(dir, base, range_begin, el_end, range_end, v);
+                    count += op.template operator()<false>(range_begin, el_end, bucket_end, v, output, pred);
 
                     // compiler optmizes out the conditional
                     if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
@@ -290,7 +337,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
                 else
                   for (auto it = query_begin; it != query_end;) {
                     v = *it;
-                      count += op.template operator()<false>(range_begin, el_end, range_end, v, output);
+                    bucket_end = narrow(dir, base, range_begin, el_end, range_end, v);
+                    count += op.template operator()<false>(range_begin, el_end, bucket_end, v, output);
 
                     // compiler optmizes out the conditional
                     if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
@@ -343,10 +391,31 @@ using SortedMapParams = ::dsc::DistributedMapParams<
        */
       bool sorted;   // this is a local variable.
 
+      /**
+       * @brief  start of each sorted run in c after the first.  only meaningful while !sorted.
+       * @details  insert() sorts each batch and appends it as a run, so a later local_sort() is a few linear merges
+       *          instead of a full sort.  !sorted with no runs means c is not ordered at all.
+       */
+      ::std::vector<size_t> runs;
+
+      /// the last run is merged with the one before it while that one is less than run_ratio times as large.
+      size_t run_ratio;
+
+      /**
+       * @brief  prefix directory of c, built by local_sort or the next query after c changes.  only for Kmer keys.
+       * @details  valid while c is unchanged.  the changes of c go through set_balanced, append_run, merge_runs,
+       *          or the local overrides, which invalidate it.
+       */
+      mutable directory_type directory;
+      mutable bool directory_valid;
+      /// bits of the directory prefix.  0 for no directory.
+      unsigned int directory_bits;
+
 
       // =========== accessors to change the local state of the container
       void set_balanced(bool v) const {
         balanced = v;
+        directory_valid = false;
       }
       // =========== accessors to change the local state of the container
       void set_globally_sorted(bool v) const {
@@ -374,6 +443,133 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       }
 
 
+      /// directory for the queries on c, or nullptr if there is none.  builds it if c changed.  c must be sorted.
+      directory_type const * query_directory() const {
+        if ((directory_bits == 0) || !this->sorted) return nullptr;
+        if (!directory_valid) {
+          directory.build(c.begin(), c.end(), directory_bits);
+          directory_valid = true;
+        }
+        return directory.empty() ? nullptr : &directory;
+      }
+
+      /// lower bound in the sorted container.  Kmer keys use interpolation search on the top bits, otherwise binary search.
+      template <bool linear, class DBIter, typename Query>
+      static inline DBIter key_lower_bound(DBIter b, DBIter e, Query const & v, typename Base::StoreTransformedFunc const & comp) {
+        return key_lower_bound<linear>(b, e, v, comp,
+            ::std::integral_constant<bool, !linear && ::fsc::is_radix_sortable<typename Base::StoreTransformedFunc>::value>());
+      }
+      template <bool linear, class DBIter, typename Query>
+      static inline DBIter key_lower_bound(DBIter b, DBIter e, Query const & v, typename Base::StoreTransformedFunc const & comp, ::std::true_type) {
+        return ::fsc::interpolation_lower_bound(b, e, v, comp);
+      }
+      template <bool linear, class DBIter, typename Query>
+      static inline DBIter key_lower_bound(DBIter b, DBIter e, Query const & v, typename Base::StoreTransformedFunc const & comp, ::std::false_type) {
+        return ::fsc::lower_bound<linear>(b, e, v, comp);
+      }
+
+      /// start of the search for the next query:  the end of the previous match, or the hint from QueryProcessor::narrow if later.
+      template <class DBIter>
+      static inline DBIter search_start(DBIter const & hint, DBIter const & el_end) {
+        return (el_end < hint) ? hint : el_end;
+      }
+
+      /**
+       * @brief distribute query keys to the processes that own them.  a key in key_to_rank.spans goes to every process in its span.  collective.
+       * @param[out] recv_counts  number of keys received from each process.
+       * @return  the keys this process sent to more than 1 process, with repeats.
+       */
+      ::std::vector<Key> distribute_keys(::std::vector<Key> & keys, ::std::vector<size_t> & recv_counts) const {
+        ::std::vector<Key> split_keys;
+        std::vector<size_t> i2o;
+        std::vector<Key > buffer;
+
+        if (this->key_to_rank.spans.size() == 0) {  // same on all processes.
+          ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        } else {
+          ::std::vector<::std::pair<Key, int> > targets;
+          targets.reserve(keys.size());
+          ::std::pair<int, int> o;
+          for (auto const & k : keys) {
+            o = this->key_to_rank.owners(k);
+            if (o.first < o.second) split_keys.emplace_back(k);
+            for (int r = o.first; r <= o.second; ++r) targets.emplace_back(k, r);
+          }
+
+          ::std::vector<::std::pair<Key, int> > received;
+          ::imxx::distribute(targets, [](::std::pair<Key, int> const & x) { return x.second; },
+                             recv_counts, i2o, received, this->comm);
+          buffer.reserve(received.size());
+          for (auto const & x : received) buffer.emplace_back(x.first);
+        }
+        keys.swap(buffer);
+        return split_keys;
+      }
+
+      /// add up the partial counts of keys that were sent to several processes.  each query for such a key gets 1 entry with the total.
+      static void merge_split_counts(::std::vector<::std::pair<Key, size_type> > & results, ::std::vector<Key> & split_keys) {
+        typename Base::StoreTransformedFunc comp;
+        ::std::sort(split_keys.begin(), split_keys.end(), comp);
+
+        // partial counts to the end, grouped by key.
+        auto split_begin = ::std::stable_partition(results.begin(), results.end(),
+            [&split_keys, &comp](::std::pair<Key, size_type> const & x) {
+          return !::std::binary_search(split_keys.begin(), split_keys.end(), x.first, comp);
+        });
+        ::std::vector<::std::pair<Key, size_type> > partials(split_begin, results.end());
+        results.erase(split_begin, results.end());
+        ::std::sort(partials.begin(), partials.end(), comp);
+
+        // every holder answered each of the m queries for a key, so the total is m times the count.
+        auto it = partials.begin();
+        auto q = split_keys.begin();
+        while (it != partials.end()) {
+          auto group_end = ::fsc::upper_bound<true>(it, partials.end(), it->first, comp);
+          auto qr = ::std::equal_range(q, split_keys.end(), it->first, comp);
+          size_t m = ::std::max(static_cast<size_t>(1), static_cast<size_t>(::std::distance(qr.first, qr.second)));
+          size_type total = 0;
+          for (auto g = it; g != group_end; ++g) total += g->second;
+          for (size_t i = 0; i < m; ++i) results.emplace_back(it->first, total / m);
+          q = qr.second;
+          it = group_end;
+        }
+      }
+
+      /// find the keys whose entries cross process boundaries, and the processes that hold them.  c must be globally sorted.  collective.
+      void find_spans() {
+        this->key_to_rank.spans.clear();
+
+        // first and last key of each process with entries, in rank order.
+        ::std::vector<::std::pair<Key, int> > ends;
+        if (c.size() > 0) {
+          ends.emplace_back(c.front().first, this->comm.rank());
+          ends.emplace_back(c.back().first, this->comm.rank());
+        }
+        ::mxx::allgatherv(ends, this->comm).swap(ends);
+
+        // a key crosses a boundary when the last key of a process is the first key of the next process with entries.
+        typename Base::StoreTransformedEqual equal;
+        auto & spans = this->key_to_rank.spans;
+        for (size_t i = 1; (i + 1) < ends.size(); i += 2) {
+          if (!equal(ends[i].first, ends[i + 1].first)) continue;
+
+          if ((spans.size() > 0) && (spans.back().second.second == ends[i].second) && equal(spans.back().first, ends[i].first))
+            spans.back().second.second = ends[i + 1].second;  // covers more than 2 processes.
+          else
+            spans.emplace_back(ends[i].first, ::std::make_pair(ends[i].second, ends[i + 1].second));
+        }
+      }
+
+      /// before moving blocks of c between processes.  c stays locally sorted only if the map is globally sorted.
+      void prepare_block_move(bool gsorted) {
+        if (gsorted) {
+          merge_runs();
+        } else {
+          runs.clear();
+          this->sorted = false;
+        }
+      }
+
       // ============ shared functors.
 
       struct LocalCount {
@@ -383,7 +579,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           template<bool linear, class DBIter, typename Query, class OutputIter>
           size_t operator()(DBIter &range_begin, DBIter &el_end, DBIter const &range_end, Query const &v, OutputIter &output) const {
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);  // range_begin at equal or greater than v.
+              range_begin = key_lower_bound<linear>(search_start(range_begin, el_end), range_end, v, store_comp);  // range_begin at equal or greater than v.
               el_end = ::fsc::upper_bound<true>(range_begin, range_end, v, store_comp);  // el_end at greater than v.
               // difference between the 2 iterators is the part that's equal.
 
@@ -399,7 +595,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           size_t operator()(DBIter &range_begin, DBIter &el_end, DBIter const &range_end, Query const &v, OutputIter &output,
                             Predicate const& pred) const {
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);  // range_begin at equal or greater than v.
+              range_begin = key_lower_bound<linear>(search_start(range_begin, el_end), range_end, v, store_comp);  // range_begin at equal or greater than v.
               el_end = ::fsc::upper_bound<true>(range_begin, range_end, v, store_comp);  // el_end at greater than v.
               // difference between the 2 iterators is the part that's equal.
 
@@ -423,7 +619,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           template<bool linear, class DBIter, typename Query>
           size_t operator()(DBIter &curr_start, DBIter &last_end, DBIter const &range_end, Query const &v, DBIter &output) {
               // find start of segment to delete == end of prev segment to keep
-              curr_start = ::fsc::lower_bound<linear>(last_end, range_end, v, store_comp);
+              curr_start = key_lower_bound<linear>(search_start(curr_start, last_end), range_end, v, store_comp);
 
               // if the keep range is larger than 0, then move data and update insert pos.
               if (output == last_end) {  // if they point to same place, no copy is needed.  just advance
@@ -443,7 +639,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           size_t operator()(DBIter &curr_start, DBIter &last_end, DBIter const &range_end, Query const &v, DBIter &output,
                             Predicate const & pred) {
               // find start of segment to delete == end of prev segment to keep
-              curr_start = ::fsc::lower_bound<linear>(last_end, range_end, v, store_comp);
+              curr_start = key_lower_bound<linear>(search_start(curr_start, last_end), range_end, v, store_comp);
 
               // if the keep range is larger than 0, then move data and update insert pos.
               if (output == last_end) {  // if they point to same place, no copy is needed.  just advance
@@ -526,10 +722,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				this->distribute_keys(keys, recv_counts);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
 //      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -557,7 +750,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(), start, end,
             		  sorted_input);
               QueryProcessor<false>::process(overlap.first, overlap.second, start, end,
-            		  count_emplace_iter, count_element, sorted_input, pred);
+            		  count_emplace_iter, count_element, sorted_input, pred, this->query_directory(), this->c.begin());
               send_counts[i] = ::std::accumulate(count_results.begin(), count_results.end(), static_cast<size_t>(0),
                                                  [](size_t v, ::std::pair<Key, size_t> const & x) {
                              return v + x.second;
@@ -625,7 +818,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(),
             		  start, end, sorted_input);
               found = QueryProcessor<false>::process(overlap.first, overlap.second,
-            		  start, end, local_results_iter, lf, sorted_input, pred);
+            		  start, end, local_results_iter, lf, sorted_input, pred, this->query_directory(), this->c.begin());
               total += found;
               //== now send the results immediately - minimizing data usage so we need to wait for both send and recv to complete right now.
 
@@ -672,7 +865,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(),
             		keys.begin(), keys.end(), sorted_input);
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		keys.begin(), keys.end(), count_emplace_iter, count_element, sorted_input, pred);
+            		keys.begin(), keys.end(), count_emplace_iter, count_element, sorted_input, pred, this->query_directory(), this->c.begin());
             size_t count = ::std::accumulate(count_results.begin(), count_results.end(), static_cast<size_t>(0),
                                           [](size_t v, ::std::pair<Key, size_t> const & x) {
                       return v + x.second;
@@ -687,7 +880,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             BL_BENCH_START(find);
             // within start-end, values are unique, so don't need to set unique to true.
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		keys.begin(), keys.end(), emplace_iter, lf, sorted_input, pred);
+            		keys.begin(), keys.end(), emplace_iter, lf, sorted_input, pred, this->query_directory(), this->c.begin());
             BL_BENCH_END(find, "local_find", results.size());
 
           }
@@ -740,10 +933,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				this->distribute_keys(keys, recv_counts);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
 //      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -787,7 +977,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
               // within start-end, values are unique, so don't need to set unique to true.
               send_counts[i] = QueryProcessor<false>::process(overlap.first, overlap.second,
-            		  start, end, emplace_iter, lf, sorted_input, pred);
+            		  start, end, emplace_iter, lf, sorted_input, pred, this->query_directory(), this->c.begin());
 
               start = end;
             }
@@ -829,7 +1019,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             		keys.begin(), keys.begin() + estimating, sorted_input);
 
             QueryProcessor<false>::process(overlap.first, overlap.second, keys.begin(), keys.begin() + estimating,
-            		emplace_iter, lf, sorted_input, pred);
+            		emplace_iter, lf, sorted_input, pred, this->query_directory(), this->c.begin());
             BL_BENCH_END(find, "local_find_0.1", estimating);
 
             BL_BENCH_START(find);
@@ -842,7 +1032,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             		keys.begin() + estimating, keys.end(), sorted_input);
 
             QueryProcessor<false>::process(overlap.first, overlap.second, keys.begin() + estimating, keys.end(),
-            		emplace_iter, lf, sorted_input, pred);
+            		emplace_iter, lf, sorted_input, pred, this->query_directory(), this->c.begin());
             BL_BENCH_END(find, "local_find", results.size());
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
@@ -879,7 +1069,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
             // count now.
             QueryProcessor<false>::process(this->c.begin(), this->c.end(),
-                keys.begin(), keys.end(), count_emplace_iter, count_element, true, pred);
+                keys.begin(), keys.end(), count_emplace_iter, count_element, true, pred, this->query_directory(), this->c.begin());
             size_t count = ::std::accumulate(count_results.begin(), count_results.end(), static_cast<size_t>(0),
                                              [](size_t v, ::std::pair<Key, size_t> const & x) {
                          return v + x.second;
@@ -888,7 +1078,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
             // within start-end, values are unique, so don't need to set unique to true.
             QueryProcessor<false>::process(this->c.begin(), this->c.end(),
-                keys.begin(), keys.end(), emplace_iter, lf, true, pred);
+                keys.begin(), keys.end(), emplace_iter, lf, true, pred, this->query_directory(), this->c.begin());
           }
           if (this->comm.size() > 1) this->comm.barrier();
           return results;
@@ -901,7 +1091,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       /// constructor
       sorted_map_base(const mxx::comm& _comm) : Base(_comm),
-          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false) {}
+          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false), run_ratio(2),
+          directory_valid(false), directory_bits(0) {}
 
       // ===================  sorted map specific virtual functions
       /// ensures container is globally sorted/organized and balanced, and splitters are capatured.  also ensures local sortedness.
@@ -914,6 +1105,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       // clears the sorted map and release memory.
       virtual void local_reset() {
         local_container_type tmp; tmp.swap(c);
+        runs.clear();
+        directory.clear();
 
         this->sorted = true;
         this->set_balanced(false);
@@ -922,6 +1115,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       /// clears the sorted_map
       virtual void local_clear() {
         c.clear();
+        runs.clear();
+        directory_valid = false;
 
         this->sorted = true;
         this->set_balanced(false);
@@ -933,12 +1128,131 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         c.reserve(n);
       }
 
+      /// release the vector capacity beyond its size.
+      virtual void local_compact() {
+        c.shrink_to_fit();
+      }
+
+      /// append elements from a saved map.  saved globally sorted, so any block partition of the file is still globally sorted.
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool /* same_partition */) {
+        if (c.size() == 0) c.swap(entries);
+        else ::std::move(entries.begin(), entries.end(), ::std::back_inserter(c));
+        runs.clear();
+        directory_valid = false;
+      }
+
 
       // ==================== sorted vector specific functions.
 
+      /// Kmer keys compared by Kmer::operator< after the storage transform:  radix sort on the packed words.
+      template <typename V>
+      static void sort_entries(::std::vector<V> & input, bool & sorted_input, ::std::true_type) {
+        if (!sorted_input)
+          ::fsc::radix_sort(input, typename ::fsc::is_radix_sortable<typename Base::StoreTransformedFunc>::transform_type());
+        sorted_input = true;
+      }
+      template <typename V>
+      static void sort_entries(::std::vector<V> & input, bool & sorted_input, ::std::false_type) {
+        ::fsc::sort(input, sorted_input, typename Base::StoreTransformedFunc());
+      }
+      /// sort by the storage comparator.
+      template <typename V>
+      static void sort_entries(::std::vector<V> & input, bool & sorted_input) {
+        sort_entries(input, sorted_input,
+                     ::std::integral_constant<bool, ::fsc::is_radix_sortable<typename Base::StoreTransformedFunc>::value>());
+      }
+
+      /// merge the sorted runs from insert(), from the back.  c is sorted after, if it had runs.
+      void merge_runs() {
+        if (this->sorted || runs.empty()) return;
+        directory_valid = false;
+
+        typename Base::StoreTransformedFunc comp;
+        while (!runs.empty()) {
+          size_t prev = (runs.size() > 1) ? runs[runs.size() - 2] : 0;
+          ::fsc::inplace_merge(c, prev, runs.back(), comp);
+          runs.pop_back();
+        }
+        this->sorted = true;
+      }
+
+      /// reserve for appending n entries, growing geometrically so that repeated batch inserts copy c O(1) times amortized.
+      void reserve_append(size_t n) {
+        if (n > c.capacity()) this->local_reserve(::std::max(n, 2 * c.capacity()));
+      }
+
+      /**
+       * @brief called when append_run merged c into 1 sorted run.  c is sorted, so subclasses can reduce it in linear time,
+       *        e.g. remove duplicates or combine the counts, which keeps the runs from growing with the duplicates.
+       *        multimaps keep all entries.
+       */
+      virtual void reduce_merged() {}
+
+      /**
+       * @brief append entries to c.  if c is sorted or in runs, input is sorted and becomes a new run, and the smaller
+       *        runs at the end are merged, so run sizes shrink geometrically and there are O(log n) runs.
+       * @details  with sorted_input, input is not sorted again, so a sorted batch costs a linear merge.  when the merges
+       *        leave c in 1 run, it is reduced via reduce_merged().
+       * @return number of entries appended.
+       */
+      template <class Predicate>
+      size_t append_run(::std::vector<::std::pair<Key, T> > & input, bool sorted_input, Predicate const & pred) {
+        directory_valid = false;
+        size_t before = c.size();
+        bool ordered = (before == 0) || this->sorted || !runs.empty();
+        if (ordered) sort_entries(input, sorted_input);
+
+        ::fsc::back_emplace_iterator<local_container_type> emplace_iter(c);
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          if (before == 0)   // container is empty, so swap it in.
+            c.swap(input);
+          else {
+            reserve_append(before + input.size());
+            ::std::move(input.begin(), input.end(), emplace_iter);    // else move it in.
+          }
+        }
+        else {
+          reserve_append(before + input.size());
+          ::std::copy_if(::std::make_move_iterator(input.begin()),
+                    ::std::make_move_iterator(input.end()), emplace_iter, pred);  // predicate needed.  move it though.
+        }
+
+        size_t count = c.size() - before;
+        if (count == 0) return 0;
+        if (before == 0) {
+          this->sorted = sorted_input;
+          runs.clear();
+          return count;
+        }
+        if (!ordered) return count;  // unordered stays unordered until the next local_sort.
+
+        if (this->sorted) runs.clear();
+        this->sorted = false;
+        runs.emplace_back(before);
+
+        typename Base::StoreTransformedFunc comp;
+        size_t last, prev;
+        while (!runs.empty()) {
+          last = runs.back();
+          prev = (runs.size() > 1) ? runs[runs.size() - 2] : 0;
+          if ((last - prev) >= run_ratio * (c.size() - last)) break;
+          ::fsc::inplace_merge(c, prev, last, comp);
+          runs.pop_back();
+        }
+        if (runs.empty()) {
+          this->sorted = true;
+          this->reduce_merged();
+        }
+
+        return count;
+      }
+
       /// rehash the local container.  n is the local container size.  this allows different processes to individually adjust its own size.
       void local_sort() {
-        ::fsc::sort(c, sorted, typename Base::StoreTransformedFunc());
+        if (!sorted) directory_valid = false;
+        merge_runs();
+        sort_entries(c, sorted);
+        query_directory();
       }
 
       /// const version that sorts the local container.
@@ -952,8 +1266,40 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       virtual ~sorted_map_base() {};
 
-      /// returns the local storage.  please use sparingly.
-      local_container_type& get_local_container() { return c; }
+      /// returns the local storage.  please use sparingly.  the prefix directory is rebuilt after.
+      local_container_type& get_local_container() {
+        directory_valid = false;
+        return c;
+      }
+
+      /// size ratio at which insert() merges adjacent sorted runs.  larger means fewer merges on insert and more runs to merge on query.
+      void set_run_ratio(size_t const & ratio) {
+        run_ratio = ::std::max(static_cast<size_t>(1), ratio);
+      }
+      size_t get_run_ratio() const {
+        return run_ratio;
+      }
+
+      /**
+       * @brief use a prefix directory of 2^bits buckets on the local container, for Kmer keys.  0 (the default) for none.
+       * @details  each query is narrowed to the entries with its top bits before the search, in find, count and erase.
+       *        about log2(local size) - 3 bits gives buckets of 8 entries for uniform keys, e.g. lex_less transformed
+       *        k-mers.  the directory takes 8 * 2^bits bytes, and is rebuilt in O(local size) by the first query after
+       *        an insert or erase.  has no effect for other keys.
+       */
+      void set_prefix_directory_bits(unsigned int const & bits) {
+        directory_bits = ::std::min(bits, directory_type::max_bits);
+        directory_valid = false;
+        if (directory_bits == 0) directory.clear();
+      }
+      unsigned int get_prefix_directory_bits() const {
+        return directory_bits;
+      }
+
+      /// number of sorted runs in the local container, 0 if not sorted at all.
+      size_t local_run_count() const {
+        return this->sorted ? 1 : (runs.empty() ? 0 : runs.size() + 1);
+      }
 
       const_iterator cbegin() const
       {
@@ -978,6 +1324,129 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         result.assign(c.begin(), c.end());
       }
 
+      /// zero copy chunks of the local vector, in storage order.  see map_base::scan.
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const {
+        return ::std::unique_ptr<::dsc::local_scanner<Key, T> >(
+            new ::dsc::contiguous_scanner<Key, T>(c.data(), c.size()));
+      }
+
+      /// the local entries in storage order, without copying.  a span of the local vector.  see dsc::local_view.
+      ::dsc::local_view<::std::pair<Key, T> const *> local_entries() const {
+        return ::dsc::make_local_view(c.data(), c.data() + c.size());
+      }
+      /// keys of the local entries, read in place.  unlike keys(), repeated keys of a multimap are not removed.
+      ::dsc::local_view<::dsc::entry_field_iterator<::std::pair<Key, T> const *, 0> > local_keys() const {
+        return ::dsc::make_key_view(c.data(), c.data() + c.size());
+      }
+      /// values of the local entries, read in place.
+      ::dsc::local_view<::dsc::entry_field_iterator<::std::pair<Key, T> const *, 1> > local_values() const {
+        return ::dsc::make_value_view(c.data(), c.data() + c.size());
+      }
+
+      /// save the map to a single file.  collective.  redistributes first, so the file is globally sorted.
+      virtual void save(::std::string const & filename) const {
+        this->redistribute();
+        this->Base::save(filename);
+      }
+
+      /// release the capacity left over from erase.  collective.  with rebalance, redistribute first, so the processes have even shares.
+      virtual void compact(bool rebalance = false) {
+        if (rebalance) this->redistribute();
+        this->Base::compact(rebalance);
+      }
+
+      /// load the map from a saved file.  collective.  the splitters are recomputed by the next redistribute, without sorting.
+      virtual void load(::std::string const & filename) {
+        this->Base::load(filename);
+
+        this->sorted = true;
+        this->set_globally_sorted(true);
+        this->set_balanced(false);
+      }
+
+      /// read-only map type for the files written by save_mapped.
+      using mapped_map_type = ::fsc::mapped_sorted_map<Key, T, typename Base::StoreTransformedFunc>;
+
+      /**
+       * @brief write the map as a single mapped_map_type file, for query-only serving without reload.  collective.
+       * @details  redistributes first, so the local containers in rank order are the sorted array of the file.
+       *        written to a temporary file then renamed, so processes that have the old file mapped are not affected.
+       */
+      void save_mapped(::std::string const & filename) const {
+        this->redistribute();
+
+        ::fsc::mapped_map_file::header_type header;
+        header.magic = ::fsc::mapped_map_file::magic;
+        header.version = ::fsc::mapped_map_file::version;
+        header.layout = ::fsc::mapped_map_file::SORTED;
+        header.type_id = ::fsc::mapped_map_file::get_type_id<mapped_map_type>();
+        header.value_size = sizeof(::std::pair<Key, T>);
+        header.count = this->size();
+        header.capacity = header.count;
+        header.data_offset = sizeof(::fsc::mapped_map_file::header_type);
+
+        ::std::vector<unsigned char> head(sizeof(header));
+        memcpy(head.data(), &header, sizeof(header));
+
+        ::std::string tmp_filename = filename + ".tmp";
+        this->write_entries(tmp_filename, head, c);
+
+        int res = 0;
+        if (this->comm.rank() == 0) res = rename(tmp_filename.c_str(), filename.c_str());
+        if (this->comm.size() > 1) MPI_Bcast(&res, 1, MPI_INT, 0, this->comm);
+        if (res != 0) {
+          ::std::stringstream ss;
+          ss << "ERROR : dsc::sorted_map save_mapped: failed to rename [" << tmp_filename << "] to [" << filename << "]";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+      }
+
+      /**
+       * @brief replace the content of the map with a file written by save_mapped.  collective.
+       * @details  each process maps the file and copies its block of the sorted array, so any number of processes can load it.
+       */
+      void load_mapped(::std::string const & filename) {
+        ::std::vector<::std::pair<Key, T> > local;
+
+        bool ok = true;
+        ::std::string message;
+        try {
+          mapped_map_type mapped(filename);
+          size_t p = this->comm.size();
+          size_t r = this->comm.rank();
+          local.assign(mapped.begin() + (mapped.size() * r) / p, mapped.begin() + (mapped.size() * (r + 1)) / p);
+        } catch (::bliss::io::IOException & e) {
+          ok = false;
+          message = e.what();
+        }
+
+        if (!::mxx::all_of(ok, this->comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+              ok ? ::std::string("ERROR : dsc::sorted_map load_mapped failed on another process") : message);
+        }
+
+        this->local_clear();
+        this->local_load(local, true);
+
+        this->sorted = true;
+        this->set_globally_sorted(true);
+        this->set_balanced(false);
+      }
+
+      /// read only distributed multimap type, see freeze.
+      using frozen_type = ::dsc::frozen_sorted_multimap<Key, T, MapParams>;
+
+      /**
+       * @brief build a read only copy with separate key and value arrays per process, for a reference set that is only queried.  collective.
+       * @details  redistributes first, then uses the same processes for each key.  searches touch only the keys, see
+       *        frozen_sorted_multimap.  this map is not modified, and can be cleared afterwards.
+       */
+      frozen_type freeze() const {
+        this->redistribute();
+        this->local_sort();
+        return frozen_type(c, key_to_rank.map, key_to_rank.spans, this->comm);
+      }
+
       /// extract the unique keys of a map.
       virtual void keys(std::vector<Key> & result) const {
         result.clear();
@@ -1048,15 +1517,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
           // distribute (communication part)
           std::vector<size_t> recv_counts;
-          {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
-//      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
-//      				  typename Base::StoreTransformedFunc(),
-//      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
-          }
+          ::std::vector<Key> split_keys = this->distribute_keys(keys, recv_counts);
           BL_BENCH_END(count, "dist_query", keys.size());
 
 
@@ -1077,7 +1538,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
             // within start-end, values are unique, so don't need to set unique to true.
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		start, end, emplace_iter, count_element, sorted_input, pred);
+            		start, end, emplace_iter, count_element, sorted_input, pred, this->query_directory(), this->c.begin());
 
             start = end;
           }
@@ -1088,6 +1549,12 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           mxx::all2allv(results, recv_counts, this->comm).swap(results);
           BL_BENCH_END(count, "a2a2", results.size());
 
+          if (split_keys.size() > 0) {
+            BL_BENCH_START(count);
+            this->merge_split_counts(results, split_keys);
+            BL_BENCH_END(count, "merge_split", results.size());
+          }
+
 
         } else {
             // ensure that the container splitters are setup properly, and load balanced.
@@ -1114,7 +1581,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // within key, values may not be unique,
           QueryProcessor<true>::process(overlap.first, overlap.second,
-        		  keys.begin(), keys.end(), emplace_iter, count_element, sorted_input, pred);
+        		  keys.begin(), keys.end(), emplace_iter, count_element, sorted_input, pred, this->query_directory(), this->c.begin());
           BL_BENCH_END(count, "local_count", results.size());
 
         }
@@ -1142,12 +1609,182 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // keys already unique
           QueryProcessor<false>::process(c.begin(), c.end(), keys.begin(), keys.end(),
-              emplace_iter, count_element, true, pred);
+              emplace_iter, count_element, true, pred, this->query_directory(), this->c.begin());
         }
         if (this->comm.size() > 1) this->comm.barrier();
         return results;
       }
 
+    protected:
+      /**
+       * @brief send each range, with its index, to the processes whose entries may be in it.  collective.
+       * @details  a range goes to the processes from the first holder of its lower bound to the last holder of its upper
+       *        bound, so only the splitter intervals that overlap it.  empty ranges are not sent.
+       * @param[out] recv_counts  number of ranges received from each process.
+       */
+      ::std::vector<::std::pair<::std::pair<Key, Key>, size_t> >
+      distribute_ranges(::std::vector<::std::pair<Key, Key> > const & ranges, ::std::vector<size_t> & recv_counts) const {
+        typename Base::StoreTransformedFunc comp;
+        ::std::vector<::std::pair<::std::pair<Key, Key>, size_t> > received;
+
+        if (this->comm.size() == 1) {
+          for (size_t i = 0; i < ranges.size(); ++i)
+            if (!comp(ranges[i].second, ranges[i].first)) received.emplace_back(ranges[i], i);
+          recv_counts.assign(1, received.size());
+          return received;
+        }
+
+        ::std::vector<::std::pair<::std::pair<::std::pair<Key, Key>, size_t>, int> > targets;
+        targets.reserve(ranges.size());
+        int first, last;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+          if (comp(ranges[i].second, ranges[i].first)) continue;
+          first = this->key_to_rank.owners(ranges[i].first).first;
+          last = this->key_to_rank.owners(ranges[i].second).second;
+          for (int r = first; r <= last; ++r) targets.emplace_back(::std::make_pair(ranges[i], i), r);
+        }
+
+        std::vector<size_t> i2o;
+        ::std::vector<::std::pair<::std::pair<::std::pair<Key, Key>, size_t>, int> > buffer;
+        ::imxx::distribute(targets, [](::std::pair<::std::pair<::std::pair<Key, Key>, size_t>, int> const & x) { return x.second; },
+                           recv_counts, i2o, buffer, this->comm);
+        received.reserve(buffer.size());
+        for (auto const & x : buffer) received.emplace_back(x.first);
+        return received;
+      }
+
+      /// [first, last) entries of c in the closed range.  c must be sorted.
+      ::std::pair<const_iterator, const_iterator> local_range(::std::pair<Key, Key> const & range) const {
+        typename Base::StoreTransformedFunc comp;
+        auto b = key_lower_bound<false>(c.cbegin(), c.cend(), range.first, comp);
+        auto e = ::std::upper_bound(b, c.cend(), range.second, comp);
+        return ::std::make_pair(b, e);
+      }
+
+    public:
+      /**
+       * @brief  the lower and upper bound of the keys that start with the first prefix_chars characters of x.  for Kmer keys.
+       * @details  characters are stored from the most significant bits, so these keys are contiguous in Kmer::operator< order.
+       */
+      template <typename K = Key>
+      static ::std::pair<K, K> prefix_bounds(K const & x, size_t const & prefix_chars) {
+        if (prefix_chars >= K::size) return ::std::make_pair(x, x);
+        size_t suffix_chars = K::size - prefix_chars;
+        K lo = (prefix_chars == 0) ? K() : ((x >> suffix_chars) << suffix_chars);
+
+        K suffix_mask;
+        for (size_t i = 0; i < suffix_chars; ++i)
+          suffix_mask.nextFromChar(static_cast<unsigned char>((1U << K::bitsPerChar) - 1));
+        return ::std::make_pair(lo, lo | suffix_mask);
+      }
+
+      /**
+       * @brief find the entries with keys in the closed ranges [first, second].  collective.
+       * @details  the bounds are stored keys, compared with the storage comparator, and are not input transformed.
+       *        each range is sent only to the processes whose splitter intervals overlap it, and each holder returns its
+       *        entries in the range.  an entry in several ranges of the same process is returned once for each.
+       * @param pred   applied to each entry in a range.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_range(::std::vector<::std::pair<Key, Key> > const & ranges,
+                                                      Predicate const & pred = Predicate()) const {
+        BL_BENCH_INIT(find_range);
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (this->empty() || ::dsc::empty(ranges, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(find_range, "base_sorted_map:find_range", this->comm);
+          return results;
+        }
+
+        BL_BENCH_COLLECTIVE_START(find_range, "global_sort", this->comm);
+        if (this->comm.size() > 1) this->redistribute();
+        else this->local_sort();
+        BL_BENCH_END(find_range, "global_sort", this->local_size());
+
+        BL_BENCH_COLLECTIVE_START(find_range, "dist_query", this->comm);
+        std::vector<size_t> recv_counts;
+        auto received = this->distribute_ranges(ranges, recv_counts);
+        BL_BENCH_END(find_range, "dist_query", received.size());
+
+        BL_BENCH_START(find_range);
+        std::vector<size_t> send_counts(this->comm.size(), 0);
+        auto q = received.begin();
+        size_t before;
+        for (int i = 0; i < this->comm.size(); ++i) {
+          before = results.size();
+          for (size_t j = 0; j < recv_counts[i]; ++j, ++q) {
+            auto r = local_range(q->first);
+            if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+              results.insert(results.end(), r.first, r.second);
+            else
+              for (auto it = r.first; it != r.second; ++it)
+                if (pred(*it)) results.emplace_back(*it);
+          }
+          send_counts[i] = results.size() - before;
+        }
+        BL_BENCH_END(find_range, "local_find", results.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(find_range, "a2a2", this->comm);
+          mxx::all2allv(results, send_counts, this->comm).swap(results);
+          BL_BENCH_END(find_range, "a2a2", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(find_range, "base_sorted_map:find_range", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief count the entries with keys in each closed range [first, second].  collective.
+       * @return  1 count per range, in the order of ranges.  the counts of all holders are added up.
+       */
+      ::std::vector<size_type> count_range(::std::vector<::std::pair<Key, Key> > const & ranges) const {
+        ::std::vector<size_type> results(ranges.size(), 0);
+
+        if (::dsc::empty(ranges, this->comm)) return results;
+
+        if (this->comm.size() > 1) this->redistribute();
+        else this->local_sort();
+
+        std::vector<size_t> recv_counts;
+        auto received = this->distribute_ranges(ranges, recv_counts);
+
+        // (range index, partial count), back to the requesting process.
+        ::std::vector<::std::pair<size_t, size_type> > partials;
+        partials.reserve(received.size());
+        for (auto const & q : received) {
+          auto r = local_range(q.first);
+          partials.emplace_back(q.second, ::std::distance(r.first, r.second));
+        }
+        if (this->comm.size() > 1)
+          mxx::all2allv(partials, recv_counts, this->comm).swap(partials);
+
+        for (auto const & x : partials) results[x.first] += x.second;
+        return results;
+      }
+
+      /**
+       * @brief find the entries whose keys start with the first prefix_chars characters of each query.  for Kmer keys.  collective.
+       * @details  e.g. all k-mers that extend a (k - j)-mer seed, without enumerating the 4^j suffixes.  the prefix is
+       *        of the stored key, so with a storage transform other than the identity, see find_range.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_prefix(::std::vector<Key> const & keys, size_t const & prefix_chars,
+                                                       Predicate const & pred = Predicate()) const {
+        ::std::vector<::std::pair<Key, Key> > ranges;
+        ranges.reserve(keys.size());
+        for (auto const & k : keys) ranges.emplace_back(prefix_bounds(k, prefix_chars));
+        return find_range(ranges, pred);
+      }
+
+      /// count the entries whose keys start with the first prefix_chars characters of each query.  1 count per query.  collective.
+      ::std::vector<size_type> count_prefix(::std::vector<Key> const & keys, size_t const & prefix_chars) const {
+        ::std::vector<::std::pair<Key, Key> > ranges;
+        ranges.reserve(keys.size());
+        for (auto const & k : keys) ranges.emplace_back(prefix_bounds(k, prefix_chars));
+        return count_range(ranges);
+      }
+
 
 //      /**
 //       * @brief insert new elements in the distributed sorted_multimap.  example use: stop inserting if more than x entries.
@@ -1176,6 +1813,15 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 //          return count;
 //      }
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch, then sort and rebalance once.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+        this->redistribute();
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed sorted_multimap.  example use: stop inserting if more than x entries.  LOCAL INSERT
        * TODO: split this into insert (into empty), and an append (into existing)
@@ -1184,6 +1830,10 @@ using SortedMapParams = ::dsc::DistributedMapParams<
        */
       template <class Predicate = ::bliss::filter::TruePredicate>
       size_t insert(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+          // build phase:  stage only.  see begin_build
+          if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            return this->stage_input(input, this->staged);
+
           BL_BENCH_INIT(insert);
 
           if (::dsc::empty(input, this->comm)) {
@@ -1191,41 +1841,46 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             return 0;
           }
 
-          this->set_balanced(false);
-          this->set_globally_sorted(false);
-
+          // already partitioned:  send the new entries to their owners by the current splitters, so the map stays
+          // globally sorted and the next query only merges the local runs.
+          bool route = (this->comm.size() > 1) && this->is_globally_sorted() && this->is_balanced();
+          if (!route) {
+            this->set_balanced(false);
+            this->set_globally_sorted(false);
+          }
 
           BL_BENCH_START(insert);
           this->transform_input(input);
           BL_BENCH_END(insert, "transform_input", input.size());
 
-
-          size_t before = c.size();
-          BL_BENCH_START(insert);
-
-          ::fsc::back_emplace_iterator<local_container_type> emplace_iter(c);
-          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
-            if (c.size() == 0)   // container is empty, so swap it in.
-              c.swap(input);
-            else {
-              this->local_reserve(before + input.size());
-                ::std::move(input.begin(), input.end(), emplace_iter);    // else move it in.
-            }
-          }
-          else {
-            this->local_reserve(before + input.size());
-            ::std::copy_if(::std::make_move_iterator(input.begin()),
-                      ::std::make_move_iterator(input.end()), emplace_iter, pred);  // predicate needed.  move it though.
+          if (route) {
+            BL_BENCH_START(insert);
+            std::vector<size_t> recv_counts;
+            std::vector<size_t> i2o;
+            std::vector<::std::pair<Key, T> > buffer;
+            ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+            input.swap(buffer);
+            BL_BENCH_END(insert, "distribute", input.size());
           }
 
-          size_t count = c.size() - before;
+          // input order is not kept by the distribute, or by a transform other than identity.
+          BL_BENCH_START(insert);
+          size_t count = this->append_run(input, sorted_input && !route &&
+              ::std::is_same<typename Base::InputTransform, ::bliss::transform::identity<Key> >::value, pred);
           BL_BENCH_END(insert, "insert", count);
 
+          if (route) {
+            // stays balanced until a process has more than twice the average.
+            BL_BENCH_START(insert);
+            size_t s = c.size();
+            size_t max_size = ::mxx::allreduce(s, ::mxx::max<size_t>(), this->comm);
+            size_t total = ::mxx::allreduce(s, this->comm);
+            this->set_balanced(max_size * this->comm.size() <= 2 * total);
+            BL_BENCH_END(insert, "balance", max_size);
+          }
 
           BL_BENCH_REPORT_MPI_NAMED(insert, "base_sorted_map:insert", this->comm);
 
-          this->sorted = false;
-
           return count;
       }
 
@@ -1265,11 +1920,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 //            BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
           {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-				keys.swap(buffer);
+				this->distribute_keys(keys, recv_counts);
           }
           BL_BENCH_END(erase, "dist_query", keys.size());
 
@@ -1304,7 +1955,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         auto new_end = overlap.first;
         // do the work.  skip duplicates = true
         size_t kept = QueryProcessor<false>::process(overlap.first, overlap.second,
-            keys.begin(), keys.end(), new_end, erase_element, sorted_input, pred);
+            keys.begin(), keys.end(), new_end, erase_element, sorted_input, pred, this->query_directory(), this->c.begin());
         BLISS_UNUSED(kept);
 
         // move the last part.
@@ -1434,7 +2085,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
 
               // map, so only 1 entry.
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);
+              range_begin = Base::template key_lower_bound<linear>(Base::search_start(range_begin, el_end), range_end, v, store_comp);
               el_end = range_begin;
 
               // add the output entry, if found.
@@ -1454,7 +2105,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
 
               // map, so only 1 entry.
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);
+              range_begin = Base::template key_lower_bound<linear>(Base::search_start(range_begin, el_end), range_end, v, store_comp);
               el_end = range_begin;
 
               // add the output entry, if found.
@@ -1517,9 +2168,15 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 //          }
 //      }
 
+      /// c is sorted after a merge in insert:  reduce it, linear.  reduction_sorted_map combines the values.
+      virtual void reduce_merged() {
+        this->local_reduction(this->c, true);
+      }
+
       // ============= local reduction override.
       virtual void local_reduction(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false) {
 
+        this->sort_entries(input, sorted_input);
         ::fsc::sorted_unique(input, sorted_input,
 				  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
@@ -1616,6 +2273,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // ensure locally sorted.
           BL_BENCH_START(rehash);
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "local_sort", this->c.size());
 
@@ -1790,6 +2448,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         	// 9. bucket - sort and unique, and 10. distribute
         	BL_BENCH_START(rehash);
         	this->sorted = false;
+        	this->runs.clear();
             std::vector<size_t> recv_counts(
             		::dsc::distribute_reduce(this->c, this->key_to_rank, this->sorted, this->comm,
           				  [this](iterator & first, iterator & last, iterator & output, bool & input_sorted){
@@ -1805,6 +2464,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         	// 11. local sort and reduce
         	BL_BENCH_START(rehash);
         	this->sorted = false;
+        	this->runs.clear();
         	this->local_reduction(this->c, this->sorted);
         	BL_BENCH_END(rehash, "reduce", this->c.size());
 
@@ -1835,6 +2495,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         } else {
           BL_BENCH_START(rehash);
           // local reduction
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "reduc", this->c.size());
         }
@@ -1865,6 +2526,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // ensure locally sorted.
           BL_BENCH_START(rehash);
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "local_sort", this->c.size());
 
@@ -1895,6 +2557,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           if (!balanced) {
             BL_BENCH_START(rehash);
+            this->prepare_block_move(gsorted);
             ::mxx::stable_distribute(this->c, this->comm).swap(this->c);
             BL_BENCH_END(rehash, "block1", this->c.size());
           }
@@ -1902,6 +2565,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // global sort if needed
           if (!gsorted) {
         	  BL_BENCH_START(rehash);
+              this->merge_runs();
               this->local_reduction(this->c, this->sorted);
               BL_BENCH_END(rehash, "reduc1", this->c.size());
 
@@ -1991,6 +2655,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         } else {
           BL_BENCH_START(rehash);
           // local reduction
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "reduc", this->c.size());
         }
@@ -2021,6 +2686,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // ensure locally sorted.
           BL_BENCH_START(rehash);
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "local_sort", this->c.size());
 
@@ -2051,15 +2717,21 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           if (!balanced) {
             BL_BENCH_START(rehash);
+            this->prepare_block_move(gsorted);
             ::mxx::stable_distribute(this->c, this->comm).swap(this->c);
             BL_BENCH_END(rehash, "block1", this->c.size());
           }
 
           // global sort if needed
+          // samplesort merges the received runs with a loser tree, within samplesort_settings' budget.
+          // it does not rebalance, so block distribute again as mxx::sort did.
           BL_BENCH_START(rehash);
-          if (!gsorted)
-            ::mxx::sort(this->c.begin(), this->c.end(), typename Base::Base::StoreTransformedFunc(), this->comm);
-          BL_BENCH_END(rehash, "mxxsort", this->c.size());
+          if (!gsorted) {
+            ::std::vector<value_type> sorted_c;
+            ::imxx::samplesort(this->c, sorted_c, typename Base::Base::StoreTransformedFunc(), this->comm);
+            ::mxx::stable_distribute(sorted_c, this->comm).swap(this->c);
+          }
+          BL_BENCH_END(rehash, "samplesort", this->c.size());
 
 
             BL_BENCH_START(rehash);
@@ -2112,7 +2784,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               if (dist > 1) {  // if > 1, the value crossed boundary and we have extra entries to remove.
 
                 size_t offset = ::std::distance(boundary_values.begin(), range.second);
-                if (boundary_ids[offset - 1] < this->comm.rank()) {  // not an owner, so need to remove this element
+                if (boundary_ids[offset - 1] > this->comm.rank()) {  // a later process owns it, so remove this element
                   // now remove this element.  there is only 1, since it's unique.  also c is at least 1 in size before.
                   this->c.pop_back();
 
@@ -2149,6 +2821,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         } else {
           BL_BENCH_START(rehash);
           // local reduction
+          this->merge_runs();
           this->local_reduction(this->c, this->sorted);
           BL_BENCH_END(rehash, "reduc", this->c.size());
         }
@@ -2359,7 +3032,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
 
 
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);
+              range_begin = Base::template key_lower_bound<linear>(Base::search_start(range_begin, el_end), range_end, v, store_comp);
 
               el_end = ::fsc::upper_bound<true>(range_begin, range_end, v, store_comp);
 
@@ -2377,7 +3050,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // TODO: LINEAR SEARCH, O(n).  vs BINARY SEARCH, O(mlogn)
         	  //OutputIter output_orig = output;
 
-              range_begin = ::fsc::lower_bound<linear>(el_end, range_end, v, store_comp);
+              range_begin = Base::template key_lower_bound<linear>(Base::search_start(range_begin, el_end), range_end, v, store_comp);
 
               el_end = ::fsc::upper_bound<true>(range_begin, range_end, v, store_comp);
 
@@ -2434,6 +3107,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.spans.clear();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_multimap:rehash", this->comm);
 
           this->sorted = true;
@@ -2447,6 +3121,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.spans.clear();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_multimap:rehash", this->comm);
           return;
         }
@@ -2457,6 +3132,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // TODO: stable_block_decompose uses all2all internally.  is it better to move the deltas ourselves?
           if (!balanced) {
             BL_BENCH_START(rehash);
+            this->prepare_block_move(gsorted);
             ::mxx::stable_distribute(this->c, this->comm).swap(this->c);
             BL_BENCH_END(rehash, "block1", this->c.size());
           }
@@ -2464,8 +3140,10 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // sort if needed
           if (!gsorted) {
             BL_BENCH_START(rehash);
-            ::mxx::sort(this->c.begin(), this->c.end(), store_comp, this->comm);
-            BL_BENCH_END(rehash, "mxxsort", this->c.size());
+            ::std::vector<value_type> sorted_c;
+            ::imxx::samplesort(this->c, sorted_c, store_comp, this->comm);
+            ::mxx::stable_distribute(sorted_c, this->comm).swap(this->c);
+            BL_BENCH_END(rehash, "samplesort", this->c.size());
           }
 
           // get new pivots
@@ -2486,30 +3164,17 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           BL_BENCH_END(rehash, "splitter1", this->key_to_rank.map.size());
 
-
-          //        mxx::datatype<::std::pair<Key, T> > dt;
-          //        MPI_Datatype mpi_dt = dt.type();
-          //        this->key_to_rank.map = ::mxx::sample_block_decomp(d.begin(), d.end(), Base::store_comp, this->comm.size() - 1, this->comm, mpi_dt);
-
-          // redistribute using new pivots.  in trouble if we have a value that takes up a large part of the partition.
+          // the sort left the entries balanced by count.  keep them there:  a key whose entries cross a process
+          // boundary is owned by every process holding it, so a heavy key does not all land on 1 process.
           BL_BENCH_START(rehash);
-          ::std::vector<size_t> send_counts =
-              ::fsc::sorted_bucketing(this->c, this->key_to_rank.map, store_comp, this->comm.size());
-          BL_BENCH_END(rehash, "bucket", this->c.size());
-
-//          size_t tt = std::accumulate(send_counts.begin(), send_counts.end(), 0UL);
-//          if (tt == 0) printf("rank %d has nothing.\n", this->comm.rank());
-//          if (tt == send_counts[this->comm.rank()]) printf("rank %d nothing to send to others\n", this->comm.rank());
-
-          BL_BENCH_COLLECTIVE_START(rehash, "a2a", this->comm);
-          // TODO: readjust boundaries using all2all.  is it better to move the deltas ourselves?
-          mxx::all2allv(this->c, send_counts, this->comm).swap(this->c);
-          BL_BENCH_END(rehash, "a2a", this->c.size());
+          this->find_spans();
+          BL_BENCH_END(rehash, "spans", this->key_to_rank.spans.size());
 
         } else {
 
           BL_BENCH_START(rehash);
           this->local_sort();
+          this->key_to_rank.spans.clear();
           BL_BENCH_END(rehash, "local_sort", this->c.size());
 
         }
@@ -2532,6 +3197,9 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         } else {
           local_unique_count = this->c.size();
         }
+        // a key crossing into this process from the one before is counted there.
+        if ((this->c.size() > 0) && (this->key_to_rank.owners(this->c.front().first).first < this->comm.rank()))
+          --local_unique_count;
 
 
         BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_multimap:rehash", this->comm);
@@ -2850,6 +3518,15 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       using Base::count;
       using Base::find;
 
+    protected:
+      /// insert the keys staged since begin_build, then the staged entries, and sort once.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged_keys, [this](::std::vector<Key> & input) { this->insert(input); });
+        Base::finalize_build();
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed sorted_multimap.  convert from Key to Key-count pair.  LOCAL INSERT
        * @param first
@@ -2857,6 +3534,10 @@ using SortedMapParams = ::dsc::DistributedMapParams<
        */
       template <class Predicate = ::bliss::filter::TruePredicate>
       size_t insert(::std::vector<Key> &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+          // build phase:  stage only.  see begin_build
+          if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            return this->stage_input(input, this->staged_keys);
+
 
           if (input.size() == 0) return 0;  // OKAY HERE ONLY BECAUSE NO COMMUNICATION IS HERE.
 
@@ -2877,29 +3558,12 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         });
         BL_BENCH_END(insert, "convert", input.size());
 
-        size_t before = this->c.size();
         BL_BENCH_START(insert);
-
-        ::fsc::back_emplace_iterator<local_container_type> emplace_iter(this->c);
-        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
-          if (this->c.size() == 0)   // container is empty, so swap it in.
-            this->c.swap(temp);
-          else {
-            this->local_reserve(before + temp.size());
-              ::std::move(temp.begin(), temp.end(), emplace_iter);    // else move it in.
-          }
-        }
-        else {
-          this->local_reserve(before + temp.size());
-          ::std::copy_if(::std::make_move_iterator(temp.begin()),
-                    ::std::make_move_iterator(temp.end()), emplace_iter, pred);  // predicate needed.  move it though.
-        }
-
-        size_t count = this->c.size() - before;
+        size_t count = this->append_run(temp, sorted_input &&
+            ::std::is_same<decltype(trans), ::bliss::transform::identity<Key> >::value, pred);
         BL_BENCH_END(insert, "insert", count);
 
         ::std::vector<::std::pair<Key, T> >().swap(temp);  // clear the temp.
-        this->sorted = false;
 
         // distribute
         BL_BENCH_REPORT_MPI_NAMED(insert, "count_sorted_map:insert", this->comm);
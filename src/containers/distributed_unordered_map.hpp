@@ -44,12 +44,17 @@
 
 
 #include <unordered_map>  // local storage hash table  // for multimap
+#include <unordered_set>
 #include <utility> 			  // for std::pair
+#include <tuple>          // join results
 
 //#include <sparsehash/dense_hash_map>  // not a multimap, where we need it most.
 #include <functional> 		// for std::function and std::hash
 #include <algorithm> 		// for sort, stable_sort, unique, is_sorted
 #include <iterator>  // advance, distance
+#include <numeric>   // accumulate, partial_sum
+#include <limits>
+#include <stdexcept>  // invalid_argument
 
 #include <cstdint>  // for uint8, etc.
 
@@ -60,12 +65,17 @@
 #include <mxx/algos.hpp> // for bucketing
 
 #include "containers/distributed_map_base.hpp"
+#include "containers/distributed_aggregation.hpp"
+#include "containers/distributed_frozen_map.hpp"
+#include "containers/distributed_membership_filter.hpp"
+#include "containers/heavy_hitters.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
 #include "utils/logging.h"
 #include "utils/filter_utils.hpp"
 
 #include "common/kmer_transform.hpp"
+#include "common/kmer_neighbors.hpp"
 
 #include "containers/dsc_container_utils.hpp"
 
@@ -145,19 +155,26 @@ namespace dsc  // distributed std container
 //      using TransformedHash = ::fsc::TransformedHash<Key, Hash<Key, false>, KeyTransform>;
 //      TransformedHash hash;
 
+      /// key to virtual bucket by hash, then bucket to rank by table.  see bucket_table.
       struct KeyToRank {
           typename Base::DistTransformedFunc proc_trans_hash;
-          const int p;
+          ::dsc::bucket_table buckets;
 
-          // 2x comm size to allow more even distribution?
           KeyToRank(int comm_size) :
-        	  proc_trans_hash(typename Base::DistFunc(ceilLog2(comm_size)),
+        	  proc_trans_hash(typename Base::DistFunc(::dsc::bucket_table::bits),
         			  	  	  typename Base::DistTrans()),
-        			  p(comm_size) {};
+        			  buckets(comm_size) {};
+          KeyToRank(::dsc::bucket_table const & table) :
+        	  proc_trans_hash(typename Base::DistFunc(::dsc::bucket_table::bits),
+        			  	  	  typename Base::DistTrans()),
+        			  buckets(table) {};
+
+          inline size_t bucket(Key const & x) const {
+            return Base::hash_to_bucket(proc_trans_hash(x));
+          }
 
           inline int operator()(Key const & x) const {
-            //            printf("KeyToRank operator. commsize %d  key.  hashed to %d, mapped to proc %d \n", p, proc_hash(Base::trans(x)), proc_hash(Base::trans(x)) % p);
-            return proc_trans_hash(x) % p;
+            return buckets[this->bucket(x)];
           }
           template<typename V>
           inline int operator()(::std::pair<Key, V> const & x) const {
@@ -167,8 +184,38 @@ namespace dsc  // distributed std container
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+          /// batch version, used by imxx::local::assign_to_buckets.  hashes are computed in blocks via the batch hash interface.
+          template<typename KT, typename SIZE>
+          inline void operator()(KT const * x, size_t const & count, SIZE * ranks) const {
+            constexpr size_t block = 256;
+            uint64_t hashes[block];
+            size_t n;
+            for (size_t i = 0; i < count; i += block) {
+              n = ::std::min(block, count - i);
+              ::fsc::batch_hash(proc_trans_hash, x + i, n, hashes);
+              for (size_t j = 0; j < n; ++j) {
+                ranks[i + j] = buckets[Base::hash_to_bucket(hashes[j])];
+              }
+            }
+          }
       } key_to_rank;
 
+      /// true for the entries whose bucket has a different rank in table than in the current one.
+      struct BucketMoved {
+          KeyToRank const & key_to_rank;
+          ::dsc::bucket_table const & table;
+
+          BucketMoved(KeyToRank const & _key_to_rank, ::dsc::bucket_table const & _table) :
+            key_to_rank(_key_to_rank), table(_table) {}
+
+          template <typename V>
+          inline bool operator()(V const & x) const {
+            size_t b = key_to_rank.bucket(x.first);
+            return table[b] != key_to_rank.buckets[b];
+          }
+      };
+
 
       /**
        * @brief count elements with the specified keys in the distributed sorted_multimap.
@@ -228,6 +275,17 @@ namespace dsc  // distributed std container
 
       mutable bool local_changed;
 
+      /// imbalance check before insert.  see set_balance_policy.
+      ::dsc::balance_policy balance;
+
+      /// rebucket before input is distributed, if the policy's check projects a partition too large.  collective.
+      template <typename V>
+      void balance_input(::std::vector<V> const & input) {
+        ::dsc::bucket_table table;
+        if (::dsc::balance_buckets(input, this->c.begin(), this->c.size(), key_to_rank, balance, this->comm, table))
+          this->set_bucket_table(table);
+      }
+
       struct LocalCount {
           // unfiltered.
           template<class DB, typename Query, class OutputIter>
@@ -254,12 +312,32 @@ namespace dsc  // distributed std container
           // no filter by range AND elemenet for now.
       } count_element;
 
+      /// exact number of entries find_element outputs for the queries in [first, last), i.e. the sum of the LocalCount results.
+      template <class QueryIter, class Predicate>
+      size_t local_find_size(QueryIter first, QueryIter last, Predicate const & pred) const {
+        size_t count = 0;
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          for (; first != last; ++first) count += c.count(*first);
+        } else {
+          for (; first != last; ++first) {
+            auto range = c.equal_range(*first);
+            if (pred(range.first, range.second))
+              count += ::std::count_if(range.first, range.second, pred);
+          }
+        }
+        return count;
+      }
+
       struct LocalErase {
+          /// number of keys whose last entry was erased, for the incremental unique count of the multimap.
+          size_t keys_removed = 0;
+
           /// Return how much was KEPT.
           template<class DB, typename Query, class OutputIter>
           size_t operator()(DB &db, Query const &v, OutputIter &) {
               size_t before = db.size();
               db.erase(v);
+              if (before != db.size()) ++keys_removed;
               return before - db.size();
           }
           /// Return how much was KEPT.
@@ -285,6 +363,7 @@ namespace dsc  // distributed std container
                     ++it;
                   }
                 }
+                if ((count > 0) && (db.find(v) == db.end())) ++keys_removed;
               }
 
               return count;
@@ -392,10 +471,10 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-  				std::vector<size_t> i2o;
-  				std::vector<Key > buffer;
-  				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-  				keys.swap(buffer);
+  				auto i2o = this->buffers.template acquire<size_t>(keys.size());
+  				auto buffer = this->buffers.template acquire<Key>(keys.size());
+  				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+  				keys.swap(*buffer);
   	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	//            				typename Base::StoreTransformedFunc(),
   	//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -590,10 +669,10 @@ namespace dsc  // distributed std container
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-  				  std::vector<size_t> i2o;
-  				  std::vector<Key > buffer;
-  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-  				  keys.swap(buffer);
+  				  auto i2o = this->buffers.template acquire<size_t>(keys.size());
+  				  auto buffer = this->buffers.template acquire<Key>(keys.size());
+  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+  				  keys.swap(*buffer);
   	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	  //            				typename Base::StoreTransformedFunc(),
   	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -604,14 +683,37 @@ namespace dsc  // distributed std container
             // local find. memory utilization a potential problem.
             // do for each src proc one at a time.
 
+            std::vector<size_t> send_counts(this->comm.size(), 0);
+            auto start = keys.begin();
+            auto end = start;
+
+            if (this->exact_find_size) {
+              // count pass, so the results are allocated once at the exact size.
+              BL_BENCH_START(find);
+              for (int i = 0; i < this->comm.size(); ++i) {
+                ::std::advance(end, recv_counts[i]);
+                send_counts[i] = this->local_find_size(start, end, pred);
+                start = end;
+              }
+              results.reserve(::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0)));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              start = keys.begin();
+              for (int i = 0; i < this->comm.size(); ++i) {
+                end = start + recv_counts[i];
+                send_counts[i] = QueryProcessor::process(c, start, end, emplace_iter, find_element, sorted_input, pred);
+                start = end;
+              }
+              BL_BENCH_END(find, "local_find", results.size());
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size() * 10);                   // TODO:  should estimate coverage.
             BL_BENCH_END(find, "reserve", results.capacity());
 
             BL_BENCH_START(find);
-            std::vector<size_t> send_counts(this->comm.size(), 0);
-            auto start = keys.begin();
-            auto end = start;
             size_t new_est = 0;
             size_t req_sofar = 0;
             size_t req_total = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
@@ -640,11 +742,12 @@ namespace dsc  // distributed std container
             }
             BL_BENCH_END(find, "local_find", results.size());
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
-            mxx::all2allv(results, send_counts, this->comm).swap(results);
+            this->return_find_results(results, send_counts);
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -656,6 +759,17 @@ namespace dsc  // distributed std container
 //            		typename Base::StoreTransformedEqual());
 //            BL_BENCH_END(find, "uniq1", keys.size());
 
+            if (this->exact_find_size) {
+              BL_BENCH_START(find);
+              results.reserve(this->local_find_size(keys.begin(), keys.end(), pred));
+              BL_BENCH_END(find, "local_size", results.capacity());
+
+              BL_BENCH_START(find);
+              QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, find_element, sorted_input, pred);
+              BL_BENCH_END(find, "local_find", results.size());
+
+            } else {
+
             BL_BENCH_START(find);
             results.reserve(keys.size());                   // TODO:  should estimate coverage.
             //printf("reserving %lu\n", keys.size() * this->key_multiplicity);
@@ -677,6 +791,7 @@ namespace dsc  // distributed std container
             BL_BENCH_END(find, "local_find", results.size());
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            }
 
           }
 
@@ -686,6 +801,215 @@ namespace dsc  // distributed std container
 
       }
 
+      /// skips no keys.  see find_neighbors.
+      struct NoSkip {
+          inline bool operator()(Key const &) const { return false; }
+      };
+
+      /**
+       * @brief find the entries within hamming distance d of each query k-mer, as (query, entry) pairs.  collective.
+       * @details  instead of enumerating the neighbors of a query and sending each to its owner, a query is sent once to
+       *        each distinct process that owns its transformed neighbors (or itself), at most min(p, neighborhood size + 1)
+       *        copies.  the owner enumerates the neighbors again, keeps those it owns, and looks them up.  the owners of the
+       *        neighbors are computed on both sides, so hashing is done twice, and the queries that go out are 1 k-mer each.
+       *        the input transform (e.g. canonical) is applied to each neighbor, not to the query.  only substitutions;
+       *        d <= 2, see bliss::common::kmer::for_each_hamming_neighbor.  throws std::invalid_argument for d > 2, on all processes.
+       * @param keys   queries.  not modified.  each query appears once in the results per matching entry, in the original orientation.
+       * @param skip   transformed keys that the owners do not look up, e.g. the heavy keys of a multimap.
+       */
+      template <class LocalFind, typename Predicate = ::bliss::filter::TruePredicate, typename Skip = NoSkip>
+      ::std::vector<::std::pair<Key, ::std::pair<Key, T> > >
+      find_neighbors(LocalFind & find_element, ::std::vector<Key> const & keys, unsigned int const & d,
+                     Predicate const& pred = Predicate(), Skip const & skip = Skip()) const {
+          if (d > 2) throw ::std::invalid_argument("find_neighbors: hamming distance d > 2 is not supported.");
+          BL_BENCH_INIT(find_neighbors);
+
+          ::std::vector<::std::pair<Key, ::std::pair<Key, T> > > results;
+
+          if (this->empty() || ::dsc::empty(keys, this->comm)) {
+            BL_BENCH_REPORT_MPI_NAMED(find_neighbors, "base_hashmap:find_neighbors", this->comm);
+            return results;
+          }
+
+          typename Base::InputTransform trans;
+          int p = this->comm.size();
+
+          BL_BENCH_START(find_neighbors);
+          ::std::vector<Key> queries(keys);
+          ::std::sort(queries.begin(), queries.end());
+          queries.erase(::std::unique(queries.begin(), queries.end()), queries.end());
+          BL_BENCH_END(find_neighbors, "unique", queries.size());
+
+          std::vector<size_t> recv_counts(1, queries.size());
+          if (p > 1) {
+            BL_BENCH_START(find_neighbors);
+            // distinct owners of each query's neighborhood.  last[r] is the last query sent to r.
+            ::std::vector<::std::pair<int, size_t> > targets;
+            ::std::vector<size_t> send_counts(p, 0);
+            ::std::vector<size_t> last(p, ::std::numeric_limits<size_t>::max());
+            auto add_owner = [this, &trans, &targets, &send_counts, &last](size_t const & i, Key const & n) {
+              int r = this->key_to_rank(trans(n));
+              if (last[r] == i) return;
+              last[r] = i;
+              targets.emplace_back(r, i);
+              ++send_counts[r];
+            };
+            for (size_t i = 0; i < queries.size(); ++i) {
+              add_owner(i, queries[i]);
+              ::bliss::common::kmer::for_each_hamming_neighbor(queries[i], d, [&add_owner, &i](Key const & n) {
+                add_owner(i, n);
+              });
+            }
+            BL_BENCH_END(find_neighbors, "owners", targets.size());
+
+            BL_BENCH_COLLECTIVE_START(find_neighbors, "dist_query", this->comm);
+            ::std::vector<size_t> offsets(p, 0);
+            for (int r = 1; r < p; ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+            ::std::vector<Key> buffer(targets.size());
+            for (auto const & t : targets) buffer[offsets[t.first]++] = queries[t.second];
+            ::std::vector<size_t>().swap(offsets);
+            ::std::vector<::std::pair<int, size_t> >().swap(targets);
+
+            recv_counts = mxx::all2all(send_counts, this->comm);
+            mxx::all2allv(buffer, send_counts, recv_counts, this->comm).swap(queries);
+            BL_BENCH_END(find_neighbors, "dist_query", queries.size());
+          }
+
+          BL_BENCH_START(find_neighbors);
+          // each received query:  its neighborhood's keys owned here, then the local find of each.
+          int rank = this->comm.rank();
+          std::vector<size_t> send_counts(recv_counts.size(), 0);
+          ::std::vector<Key> owned;
+          ::std::vector<::std::pair<Key, T> > found;
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > found_iter(found);
+          auto add_owned = [this, &trans, &owned, &rank, &p, &skip](Key const & n) {
+            Key t = trans(n);
+            if (((p == 1) || (this->key_to_rank(t) == rank)) && !skip(t)) owned.emplace_back(t);
+          };
+          auto q = queries.begin();
+          size_t before;
+          for (size_t i = 0; i < recv_counts.size(); ++i) {
+            before = results.size();
+            for (size_t j = 0; j < recv_counts[i]; ++j, ++q) {
+              owned.clear();
+              add_owned(*q);
+              ::bliss::common::kmer::for_each_hamming_neighbor(*q, d, add_owned);
+              // a transform may map 2 neighbors to the same key, e.g. a k-mer and its reverse complement.
+              ::std::sort(owned.begin(), owned.end());
+              owned.erase(::std::unique(owned.begin(), owned.end()), owned.end());
+
+              found.clear();
+              if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+                for (auto const & t : owned) find_element(c, t, found_iter);
+              else
+                for (auto const & t : owned) find_element(c, t, found_iter, pred);
+              for (auto const & e : found) results.emplace_back(*q, e);
+            }
+            send_counts[i] = results.size() - before;
+          }
+          BL_BENCH_END(find_neighbors, "local_find", results.size());
+
+          if (p > 1) {
+            BL_BENCH_COLLECTIVE_START(find_neighbors, "a2a2", this->comm);
+            mxx::all2allv(results, send_counts, this->comm).swap(results);
+            BL_BENCH_END(find_neighbors, "a2a2", results.size());
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(find_neighbors, "base_hashmap:find_neighbors", this->comm);
+
+          return results;
+      }
+
+      /**
+       * @brief find elements with the specified keys, and pass the results to sink in chunks instead of returning them.  collective.
+       * @details  the received queries are answered in rounds.  in each round a process answers its next received queries,
+       *        up to chunk results (at least 1 query), and sends the results back.  sink gets the results that arrived in
+       *        the round, so at most p x chunk results are held at a time instead of all of them, and the caller can
+       *        consume a chunk while the next one is computed by the other processes.
+       *        rounds continue until all processes are done, so sink is called a different number of times on each process.
+       * @param keys   content will be changed and reordered
+       * @param sink   called as sink(std::vector<std::pair<Key, T> > &) with each nonempty chunk.  may modify the vector.
+       * @param chunk  maximum number of results a process computes per round.
+       */
+      template <class LocalFind, class Sink, typename Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(LocalFind & find_element, ::std::vector<Key>& keys, Sink && sink, size_t const & chunk,
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          BL_BENCH_INIT(find);
+
+          if (this->empty() || ::dsc::empty(keys, this->comm)) {
+            BL_BENCH_REPORT_MPI_NAMED(find, "base_hashmap:find_stream", this->comm);
+            return;
+          }
+
+          BL_BENCH_START(find);
+          this->transform_input(keys);
+          BL_BENCH_END(find, "input_transform", keys.size());
+
+          BL_BENCH_START(find);
+          ::fsc::unique(keys, sorted_input,
+                        typename Base::StoreTransformedFunc(),
+                        typename Base::StoreTransformedEqual());
+          BL_BENCH_END(find, "unique", keys.size());
+
+          std::vector<size_t> recv_counts(1, keys.size());
+          if (this->comm.size() > 1) {
+            BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
+            auto i2o = this->buffers.template acquire<size_t>(keys.size());
+            auto buffer = this->buffers.template acquire<Key>(keys.size());
+            ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+            keys.swap(*buffer);
+            BL_BENCH_END(find, "dist_query", keys.size());
+          }
+
+          // start of each source's queries in keys.
+          std::vector<size_t> offsets(recv_counts.size() + 1, 0);
+          ::std::partial_sum(recv_counts.begin(), recv_counts.end(), offsets.begin() + 1);
+
+          BL_BENCH_START(find);
+          ::std::vector<::std::pair<Key, T> > results;
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(results);
+          std::vector<size_t> send_counts(recv_counts.size(), 0);
+          size_t pos = 0, end, total, n, first, last;
+          int src = 0;
+          bool more = true;
+          size_t rounds = 0;
+
+          while (more) {
+            // the next queries, up to chunk results.
+            total = 0;
+            for (end = pos; end < keys.size(); ++end) {
+              n = this->local_find_size(keys.begin() + end, keys.begin() + end + 1, pred);
+              if ((end > pos) && ((total + n) > chunk)) break;
+              total += n;
+            }
+
+            // answer them, grouped by source.
+            results.clear();
+            results.reserve(total);
+            ::std::fill(send_counts.begin(), send_counts.end(), 0);
+            for (first = pos; first < end; first = last) {
+              while (offsets[src + 1] <= first) ++src;
+              last = ::std::min(end, offsets[src + 1]);
+              send_counts[src] = QueryProcessor::process(c, keys.begin() + first, keys.begin() + last, emplace_iter, find_element, sorted_input, pred);
+            }
+            pos = end;
+
+            if (this->comm.size() > 1) {
+              this->return_find_results(results, send_counts);
+              more = ::mxx::any_of(pos < keys.size(), this->comm);
+            } else {
+              more = pos < keys.size();
+            }
+
+            if (results.size() > 0) sink(results);
+            ++rounds;
+          }
+          BL_BENCH_END(find, "rounds", rounds);
+
+          BL_BENCH_REPORT_MPI_NAMED(find, "base_hashmap:find_stream", this->comm);
+      }
+
+
 
       template <class LocalFind, typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(LocalFind & find_element, Predicate const& pred = Predicate()) const {
@@ -738,11 +1062,11 @@ namespace dsc  // distributed std container
   //            BLISS_UNUSED(recv_counts);
               std::vector<size_t> recv_counts;
               {
-  				std::vector<size_t> i2o;
-  				std::vector<Key > buffer;
-  				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+  				auto i2o = this->buffers.template acquire<size_t>(keys.size());
+  				auto buffer = this->buffers.template acquire<Key>(keys.size());
+  				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
   				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-  				keys.swap(buffer);
+  				keys.swap(*buffer);
               }
               BL_BENCH_END(erase, "dist_query", keys.size());
 
@@ -805,7 +1129,7 @@ namespace dsc  // distributed std container
       }
 
       unordered_map_base(const mxx::comm& _comm) : Base(_comm),
-          key_to_rank(_comm.size()), local_changed(false) {}
+          key_to_rank(::dsc::default_bucket_table(_comm)), local_changed(false) {}
 
 
       // ================ local overrides
@@ -826,14 +1150,265 @@ namespace dsc  // distributed std container
         if (this->c.bucket_count() < buckets) this->c.rehash(buckets);
       }
 
+      /// shrink the bucket array to the size needed for the current elements at max_load_factor.
+      virtual void local_compact() {
+        this->c.rehash(0);
+      }
+
+      /// identifies the bucket table, so a saved map is loaded without redistribution only with the same table.
+      virtual uint64_t get_partition_id() const {
+        return key_to_rank.buckets.id();
+      }
+
+      /// insert elements from a saved map.  already transformed and reduced, so distribute only if the partitioning changed.
+      virtual void local_load(::std::vector<::std::pair<Key, T> > & entries, bool same_partition) {
+        if (!same_partition && (this->comm.size() > 1)) {
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, T> > buffer;
+          ::imxx::distribute(entries, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          entries.swap(buffer);
+        }
+        this->local_insert(entries.begin(), entries.end());
+      }
 
 
     public:
 
       virtual ~unordered_map_base() {};
 
+      /// the assignment of the virtual buckets to the processes.
+      ::dsc::bucket_table const & get_bucket_table() const {
+        return key_to_rank.buckets;
+      }
+
+      /**
+       * @brief check the projected balance before each insert, and rebucket if a partition would be more than
+       *        policy.threshold times the mean.  off by default.  should be the same on all processes.
+       * @details  the check samples the input, and costs 1 allreduce of the bucket counts per insert.  the local entries
+       *        are scanned, with a second allreduce, only when the projection exceeds the threshold.  see dsc::balance_buckets.
+       */
+      void set_balance_policy(::dsc::balance_policy const & policy) {
+        balance = policy;
+      }
+
+      ::dsc::balance_policy const & get_balance_policy() const {
+        return balance;
+      }
+
+      /**
+       * @brief owner process of each element of input, e.g. to send the inputs of several maps in 1 exchange before insert.
+       * @details  input should be input transformed (see transform_input), as insert does before distributing.  not collective.
+       */
+      template <typename V>
+      void owners(::std::vector<V> const & input, ::std::vector<int> & ranks) const {
+        ranks.resize(input.size());
+        for (size_t i = 0; i < input.size(); ++i) ranks[i] = key_to_rank(input[i]);
+      }
+
+      /// owner process of 1 input transformed key.  not collective.
+      inline int owner(Key const & key) const {
+        return key_to_rank(key);
+      }
+
+      /**
+       * @brief assign the virtual buckets to the processes by table, and move only the entries of the reassigned buckets.  collective.
+       * @details  e.g. table = get_bucket_table().remap(p) on a map with p processes, to keep the layout of a map that was
+       *        saved with a different number of processes.  table has to be the same on all processes.
+       */
+      void set_bucket_table(::dsc::bucket_table const & table) {
+        if (table.comm_size() != this->comm.size())
+          throw ::std::invalid_argument("set_bucket_table: table is for a different number of processes.");
+        if (table == key_to_rank.buckets) return;
+
+        BL_BENCH_INIT(rebucket);
+
+        BL_BENCH_START(rebucket);
+        ::std::vector<::std::pair<Key, T> > moving;
+        BucketMoved moved(key_to_rank, table);
+        for (auto it = this->c.begin(); it != this->c.end(); ) {
+          if (moved(*it)) {
+            moving.emplace_back(*it);
+            it = this->c.erase(it);
+          } else ++it;
+        }
+        key_to_rank.buckets = table;
+        BL_BENCH_END(rebucket, "extract", moving.size());
+
+        BL_BENCH_COLLECTIVE_START(rebucket, "dist_data", this->comm);
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<::std::pair<Key, T> > buffer;
+        ::imxx::distribute(moving, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        ::std::vector<::std::pair<Key, T> >().swap(moving);
+        BL_BENCH_END(rebucket, "dist_data", buffer.size());
+
+        BL_BENCH_START(rebucket);
+        this->local_insert(buffer.begin(), buffer.end());
+        BL_BENCH_END(rebucket, "insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(rebucket, "hashmap:set_bucket_table", this->comm);
+      }
+
       /// returns the local storage.  please use sparingly.
       local_container_type& get_local_container() { return c; }
+      local_container_type const & get_local_container() const { return c; }
+
+      /// identifies the key to process assignment function.  maps with the same type and bucket table place each key on the same process.
+      using partition_type = ::std::pair<typename Base::DistTransformedFunc, ::std::integral_constant<bool, Base::single_hash> >;
+
+      /// true if each key is on the same process in this map as in other, so set operations need no communication.  local.
+      template <typename OtherMap>
+      bool is_co_partitioned(OtherMap const & other) const {
+        return ::std::is_same<partition_type, typename OtherMap::partition_type>::value &&
+            (other.get_bucket_table() == key_to_rank.buckets);
+      }
+
+      /// membership filter type, see membership_filter.
+      template <typename Fingerprint = uint8_t>
+      using membership_filter_type = ::dsc::membership_filter<Key, MapParams, Fingerprint>;
+
+      /**
+       * @brief build a membership filter of the current keys, to remove absent query keys before find or count.  collective.
+       * @param replicate  copy the filter to all processes, so screening needs no communication.  see dsc::membership_filter.
+       */
+      template <typename Fingerprint = uint8_t>
+      membership_filter_type<Fingerprint> membership_filter(bool replicate = false) const {
+        return membership_filter_type<Fingerprint>(*this, this->comm, replicate);
+      }
+
+    protected:
+      /**
+       * @brief call op(entry, first, last) for each local entry, with the range of entries of other with the same key.  collective.
+       * @details  if the maps are co-partitioned, other's local container is probed directly.  otherwise other's entries are
+       *        redistributed once with this map's partitioning, and probed via a temporary hash table.
+       *        the decision is the same on all processes since the bucket tables are.
+       */
+      template <typename OtherMap, typename Op>
+      void probe_other(OtherMap const & other, Op & op) const {
+        static_assert(::std::is_same<Key, typename OtherMap::key_type>::value, "set operations need maps with the same key type.");
+
+        if (this->is_co_partitioned(other) || (this->comm.size() == 1)) {
+          auto const & probe = other.get_local_container();
+          for (auto it = c.begin(); it != c.end(); ++it) {
+            auto range = probe.equal_range((*it).first);
+            op(*it, range.first, range.second);
+          }
+          return;
+        }
+
+        using OtherT = typename OtherMap::mapped_type;
+        ::std::vector<::std::pair<Key, OtherT> > entries;
+        other.to_vector(entries);
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<::std::pair<Key, OtherT> > buffer;
+        ::imxx::distribute(entries, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+        ::std::vector<::std::pair<Key, OtherT> >().swap(entries);
+
+        ::std::unordered_multimap<Key, OtherT, typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual> probe(buffer.begin(), buffer.end(), buffer.size());
+        ::std::vector<::std::pair<Key, OtherT> >().swap(buffer);
+        for (auto it = c.begin(); it != c.end(); ++it) {
+          auto range = probe.equal_range((*it).first);
+          op(*it, range.first, range.second);
+        }
+      }
+
+      /// keep the entries with matches in other.
+      struct IntersectOp {
+          ::std::vector<::std::pair<Key, T> > & results;
+          template <typename Iter>
+          inline void operator()(value_type const & x, Iter first, Iter last) {
+            if (first != last) results.emplace_back(x);
+          }
+      };
+      /// keep the entries without matches in other.
+      struct DifferenceOp {
+          ::std::vector<::std::pair<Key, T> > & results;
+          template <typename Iter>
+          inline void operator()(value_type const & x, Iter first, Iter last) {
+            if (first == last) results.emplace_back(x);
+          }
+      };
+      /// pair each entry with each match in other.
+      template <typename OtherT>
+      struct JoinOp {
+          ::std::vector<::std::tuple<Key, T, OtherT> > & results;
+          template <typename Iter>
+          inline void operator()(value_type const & x, Iter first, Iter last) {
+            for (; first != last; ++first) results.emplace_back(x.first, x.second, (*first).second);
+          }
+      };
+
+    public:
+
+      /**
+       * @brief local entries whose key is also in other.  collective.
+       * @details  the result is partitioned as this map.  no communication if the maps are co-partitioned, otherwise 1
+       *        redistribution of other's entries.
+       */
+      template <typename OtherMap>
+      ::std::vector<::std::pair<Key, T> > set_intersection(OtherMap const & other) const {
+        BL_BENCH_INIT(set_op);
+
+        BL_BENCH_COLLECTIVE_START(set_op, "intersect", this->comm);
+        ::std::vector<::std::pair<Key, T> > results;
+        IntersectOp op{results};
+        this->probe_other(other, op);
+        BL_BENCH_END(set_op, "intersect", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(set_op, "hashmap:set_intersection", this->comm);
+        return results;
+      }
+
+      /// local entries whose key is not in other.  collective.  see set_intersection.
+      template <typename OtherMap>
+      ::std::vector<::std::pair<Key, T> > set_difference(OtherMap const & other) const {
+        BL_BENCH_INIT(set_op);
+
+        BL_BENCH_COLLECTIVE_START(set_op, "difference", this->comm);
+        ::std::vector<::std::pair<Key, T> > results;
+        DifferenceOp op{results};
+        this->probe_other(other, op);
+        BL_BENCH_END(set_op, "difference", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(set_op, "hashmap:set_difference", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief  unique keys in this map or in other.  collective.
+       * @details  the local keys, and other's local keys that are not in this map, i.e. each key is on 1 process.
+       */
+      template <typename OtherMap>
+      ::std::vector<Key> set_union(OtherMap const & other) const {
+        ::std::vector<Key> results;
+        this->keys(results);
+
+        auto others = other.set_difference(*this);
+        typename Base::template UniqueKeySetUtilityType<Key> temp(others.size());
+        for (auto const & x : others) temp.emplace(x.first);
+        results.insert(results.end(), temp.begin(), temp.end());
+        return results;
+      }
+
+      /**
+       * @brief  inner join on the key:  (key, value, other's value) for each pair of entries with the same key.  collective.
+       * @details  partitioned as this map.  see set_intersection.
+       */
+      template <typename OtherMap>
+      ::std::vector<::std::tuple<Key, T, typename OtherMap::mapped_type> > join(OtherMap const & other) const {
+        BL_BENCH_INIT(set_op);
+
+        BL_BENCH_COLLECTIVE_START(set_op, "join", this->comm);
+        ::std::vector<::std::tuple<Key, T, typename OtherMap::mapped_type> > results;
+        JoinOp<typename OtherMap::mapped_type> op{results};
+        this->probe_other(other, op);
+        BL_BENCH_END(set_op, "join", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(set_op, "hashmap:join", this->comm);
+        return results;
+      }
 
       const_iterator cbegin() const
       {
@@ -857,6 +1432,25 @@ namespace dsc  // distributed std container
         ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(result);
         ::std::copy(c.begin(), c.end(), emplace_iter);
       }
+
+      /// chunks of the hash table entries, copied.  see map_base::scan.
+      virtual ::std::unique_ptr<::dsc::local_scanner<Key, T> > make_local_scanner() const {
+        return ::std::unique_ptr<::dsc::local_scanner<Key, T> >(
+            new ::dsc::iterator_scanner<Key, T, const_iterator>(c.cbegin(), c.cend()));
+      }
+
+      /// the local entries in table order, without copying.  see dsc::local_view.
+      ::dsc::local_view<const_iterator> local_entries() const {
+        return ::dsc::make_local_view(c.cbegin(), c.cend());
+      }
+      /// keys of the local entries, read from the table.  unlike keys(), repeated keys of a multimap are not removed.
+      ::dsc::local_view<::dsc::entry_field_iterator<const_iterator, 0> > local_keys() const {
+        return ::dsc::make_key_view(c.cbegin(), c.cend());
+      }
+      /// values of the local entries, read from the table.
+      ::dsc::local_view<::dsc::entry_field_iterator<const_iterator, 1> > local_values() const {
+        return ::dsc::make_value_view(c.cbegin(), c.cend());
+      }
       /// extract the unique keys of a map.
       virtual void keys(std::vector<Key> & result) const {
         result.clear();
@@ -870,6 +1464,23 @@ namespace dsc  // distributed std container
         result.assign(temp.begin(), temp.end());
       }
 
+      /// number of entries with each value in [0, max_value], e.g. the kmer spectrum.  larger values are in the last bin.  collective.
+      ::std::vector<size_t> histogram(size_t const & max_value) const {
+        return ::dsc::aggregate::histogram(c.cbegin(), c.cend(), max_value, this->comm);
+      }
+
+      /// the n entries with the largest values, in decreasing order.  same on all processes.  collective.
+      template <typename Less = ::dsc::aggregate::value_less>
+      ::std::vector<::std::pair<Key, T> > top_n(size_t const & n, Less const & less = Less()) const {
+        return ::dsc::aggregate::top_n(c.cbegin(), c.cend(), n, less, this->comm);
+      }
+
+      /// reduce f(entry) over all entries, with init the identity of reduce.  same on all processes.  collective.
+      template <typename V, typename MapOp, typename ReduceOp>
+      V map_reduce(MapOp const & f, ReduceOp const & reduce, V const & init) const {
+        return ::dsc::aggregate::map_reduce(c.cbegin(), c.cend(), f, reduce, init, this->comm);
+      }
+
 
 
       /**
@@ -910,17 +1521,39 @@ namespace dsc  // distributed std container
       		BL_BENCH_END(count, "unique", keys.size());
           }
 
-          if (this->comm.size() > 1) {
+          BL_BENCH_START(count);
+          ::imxx::scatter_algo algo = (this->comm.size() > 1) ?
+              this->dist_policy.template choose<Key, ::std::pair<Key, size_type> >(keys.size(), this->comm) :
+              ::imxx::scatter_algo::FULL;
+          BL_BENCH_END(count, "choose_algo", static_cast<int>(algo));
+
+          if (algo != ::imxx::scatter_algo::FULL) {
+            // large batch.  one result per key, so use the memory bounded one to one versions.
+            BL_BENCH_COLLECTIVE_START(count, "scat_comp_gath", this->comm);
+            auto i2o = this->buffers.template acquire<size_t>(keys.size());
+            auto in_buffer = this->buffers.template acquire<Key>(keys.size());
+            auto out_buffer = this->buffers.template acquire<::std::pair<Key, size_type> >(keys.size());
+            auto counter = [this, &sorted_input, &pred](typename ::std::vector<Key>::iterator first,
+                                                        typename ::std::vector<Key>::iterator last,
+                                                        typename ::std::vector<::std::pair<Key, size_type> >::iterator out) {
+              QueryProcessor::process(c, first, last, out, count_element, sorted_input, pred);
+            };
+            ::imxx::scatter_compute_gather_adaptive(keys, this->key_to_rank, counter, *i2o, results,
+                                                    *in_buffer, *out_buffer, this->comm,
+                                                    ::imxx::distribution_policy(algo));
+            BL_BENCH_END(count, "scat_comp_gath", results.size());
+
+          } else if (this->comm.size() > 1) {
 
 
               BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+				  auto i2o = this->buffers.template acquire<size_t>(keys.size());
+				  auto buffer = this->buffers.template acquire<Key>(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -982,6 +1615,130 @@ namespace dsc  // distributed std container
 
       }
 
+    protected:
+      /**
+       * @brief count for each query, in the order of the queries, with the duplicates counted once.
+       * @details  the queries are deduplicated with a hash table that maps each distinct key to its representative,
+       *        so only the distinct keys are distributed and counted, by count_unique(unique_keys), without sorting.  the
+       *        counts come back keyed by the transformed key, and are expanded to all query slots through the
+       *        representatives.  costs O(n) hash lookups locally, and communication proportional to the distinct keys.
+       */
+      template <class CountUnique>
+      ::std::vector<size_type> count_each_by(::std::vector<Key> const & keys, CountUnique && count_unique) const {
+          BL_BENCH_INIT(count_each);
+
+          BL_BENCH_START(count_each);
+          ::std::vector<Key> reps;
+          ::std::vector<size_t> rep_of(keys.size());
+          {
+            ::std::unordered_map<Key, size_t, typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual> dedup(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) {
+              auto it = dedup.emplace(keys[i], reps.size());
+              if (it.second) reps.emplace_back(keys[i]);
+              rep_of[i] = it.first->second;
+            }
+          }
+          ::std::vector<Key> queries(reps);
+          BL_BENCH_END(count_each, "dedup", reps.size());
+
+          BL_BENCH_COLLECTIVE_START(count_each, "count", this->comm);
+          ::std::vector<::std::pair<Key, size_type> > counts = count_unique(queries);
+          BL_BENCH_END(count_each, "count", counts.size());
+
+          // results are keyed by the transformed keys, in any order.
+          BL_BENCH_START(count_each);
+          ::std::vector<size_type> rep_counts(reps.size(), 0);
+          {
+            ::std::unordered_map<Key, size_type, typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual>
+              lookup(counts.begin(), counts.end(), counts.size());
+            typename Base::InputTransform trans;
+            for (size_t j = 0; j < reps.size(); ++j) {
+              auto it = lookup.find(trans(reps[j]));
+              if (it != lookup.end()) rep_counts[j] = it->second;
+            }
+          }
+
+          ::std::vector<size_type> results(keys.size());
+          for (size_t i = 0; i < keys.size(); ++i) results[i] = rep_counts[rep_of[i]];
+          BL_BENCH_END(count_each, "fan_out", results.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(count_each, "base_hashmap:count_each", this->comm);
+          return results;
+      }
+
+    public:
+      /**
+       * @brief count for each query key, in the order of keys.  duplicate keys are queried once.  collective.
+       * @details  for read derived queries with many repeats, e.g. the kmers of overlapping reads.  keys are not modified.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_each(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+          return count_each_by(keys, [this, &pred](::std::vector<Key> & unique_keys) {
+            return this->template count<false>(unique_keys, false, pred);
+          });
+      }
+
+    protected:
+      /**
+       * @brief 1 value per query, computed by op(local container, transformed key) at the owner, in the order of the queries.
+       * @details  the responses carry only the values, and are put back in query order by the undistribute of
+       *        scatter_compute_gather, so the requester does not match keys to queries, and the response is smaller by
+       *        sizeof(Key) per query.  the version is chosen by the distribution policy.  keys are not modified.  collective.
+       */
+      template <typename V, class LocalOp>
+      ::std::vector<V> query_values(::std::vector<Key> const & keys, LocalOp const & op, char const * name) const {
+          BL_BENCH_INIT(query_values);
+          ::std::vector<V> results;
+
+          if (::dsc::empty(keys, this->comm)) {
+            BL_BENCH_REPORT_MPI_NAMED(query_values, name, this->comm);
+            return results;
+          }
+
+          BL_BENCH_START(query_values);
+          ::std::vector<Key> queries;
+          this->transform_input(keys, queries);
+          BL_BENCH_END(query_values, "transform_input", queries.size());
+
+          auto compute = [this, &op](typename ::std::vector<Key>::iterator first, typename ::std::vector<Key>::iterator last,
+                                     typename ::std::vector<V>::iterator out) {
+            for (; first != last; ++first, ++out) *out = op(this->c, *first);
+          };
+
+          if (this->comm.size() == 1) {
+            BL_BENCH_START(query_values);
+            results.resize(queries.size());
+            compute(queries.begin(), queries.end(), results.begin());
+            BL_BENCH_END(query_values, "local", results.size());
+          } else {
+            BL_BENCH_COLLECTIVE_START(query_values, "scat_comp_gath", this->comm);
+            auto i2o = this->buffers.template acquire<size_t>(queries.size());
+            auto in_buffer = this->buffers.template acquire<Key>(queries.size());
+            auto out_buffer = this->buffers.template acquire<V>(queries.size());
+            ::imxx::scatter_compute_gather_adaptive(queries, this->key_to_rank, compute, *i2o, results,
+                                                    *in_buffer, *out_buffer, this->comm, this->dist_policy, true);
+            BL_BENCH_END(query_values, "scat_comp_gath", results.size());
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(query_values, name, this->comm);
+          return results;
+      }
+
+    public:
+      /**
+       * @brief count for each query key, in the order of keys.  only the counts are sent back.  collective.
+       * @details  duplicate keys are counted once per occurrence.  see count_each for duplicate heavy queries.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_values(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+          return query_values<size_type>(keys, [this, &pred](local_container_type const & db, Key const & k) {
+            ::std::pair<Key, size_type> r;
+            ::std::pair<Key, size_type> * out = &r;
+            this->count_element(db, k, out, pred);
+            return r.second;
+          }, "base_hashmap:count_values");
+      }
+
 
       template <typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, size_type> > count(Predicate const & pred = Predicate()) const {
@@ -1130,6 +1887,25 @@ namespace dsc  // distributed std container
         // no filter by range AND elemenet for now.
       } find_element;
 
+    public:
+      /**
+       * @brief the value of each query key, in the order of keys, or not_found.  only the values are sent back.  collective.
+       * @details  for queries whose results are used by position, e.g. per read kmer lookups.  find returns (key, value)
+       *        pairs of the found keys in an unspecified order;  here the response is sizeof(T) per query instead of
+       *        sizeof(Key) + sizeof(T) per found key.  keys are not modified.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_values(::std::vector<Key> const & keys, T const & not_found = T(),
+                                   Predicate const& pred = Predicate()) const {
+          return this->template query_values<T>(keys, [&not_found, &pred](local_container_type const & db, Key const & k) {
+            auto iter = db.find(k);
+            if (iter == db.end()) return not_found;
+            auto next = iter;  ++next;
+            return (pred(iter, next) && pred(*iter)) ? iter->second : not_found;
+          }, "base_hashmap:find_values");
+      }
+
+    protected:
 
       virtual void local_reduction(::std::vector<::std::pair<Key, T> > &input, bool & sorted_input) {
         ::fsc::unique(input, sorted_input,
@@ -1144,6 +1920,20 @@ namespace dsc  // distributed std container
 
       virtual ~unordered_map() {};
 
+      /// read only distributed map type, see freeze.
+      template <typename Fingerprint = uint16_t>
+      using frozen_type = ::dsc::frozen_unordered_map<Key, T, MapParams, Fingerprint>;
+
+      /**
+       * @brief build a read only copy with a minimal perfect hash layout per process, for a reference set that is only queried.  collective.
+       * @details  uses the same processes for each key, and about 4 bits per key plus the values.  see frozen_unordered_map.
+       *        this map is not modified, and can be cleared afterwards.
+       */
+      template <typename Fingerprint = uint16_t>
+      frozen_type<Fingerprint> freeze() const {
+        return frozen_type<Fingerprint>(*this, this->comm);
+      }
+
       using Base::count;
       using Base::erase;
       using Base::unique_size;
@@ -1165,6 +1955,19 @@ namespace dsc  // distributed std container
                                                           Predicate const& pred = Predicate()) const {
           return Base::find(find_element, keys, sorted_input, pred);
       }
+      /// find, with the results passed to sink in chunks of at most chunk results per process.  see Base::find_stream
+      template <class Sink, class Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(::std::vector<Key>& keys, Sink && sink, size_t const & chunk = (1UL << 20),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          Base::find_stream(find_element, keys, sink, chunk, sorted_input, pred);
+      }
+
+      /// (query, entry) for each entry within hamming distance d of a query.  for Kmer keys.  see Base::find_neighbors
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, ::std::pair<Key, T> > >
+      find_neighbors(::std::vector<Key> const & keys, unsigned int const & d, Predicate const& pred = Predicate()) const {
+          return Base::find_neighbors(find_element, keys, d, pred);
+      }
 //      template <class Predicate = ::bliss::filter::TruePredicate>
 //      ::std::vector<::std::pair<Key, T> > find_sendrecv(::std::vector<Key>& keys, bool sorted_input = false,
 //                                                          Predicate const& pred = Predicate()) const {
@@ -1177,6 +1980,14 @@ namespace dsc  // distributed std container
       }
 
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed unordered_multimap.
        * @param first
@@ -1184,6 +1995,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -1194,6 +2008,7 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_intput", input.size());
 
         // communication part
@@ -1204,10 +2019,10 @@ namespace dsc  // distributed std container
 //          auto recv_counts(::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm));
 //          BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
-			  std::vector<::std::pair<Key, T> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-			  input.swap(buffer);
+			  auto i2o = this->buffers.template acquire<size_t>(input.size());
+			  auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+			  input.swap(*buffer);
           BL_BENCH_END(insert, "dist_data", input.size());
         }
 
@@ -1226,6 +2041,43 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief insert new elements, consuming the input.  the input is bucketed in place and each received chunk is
+       *        inserted as it arrives, so there is no separate receive buffer.  input is empty afterwards.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, T> >&& input, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_intput", input.size());
+
+        BL_BENCH_START(insert);
+        size_t count = 0;
+        auto consume = [this, &count, &pred](::std::pair<Key, T> * first, ::std::pair<Key, T> * last) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            count += this->Base::local_insert(first, last, pred);
+          else
+            count += this->Base::local_insert(first, last);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        BL_BENCH_END(insert, "dist_insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
+
+        return count;
+      }
+
 
   };
 
@@ -1327,8 +2179,66 @@ namespace dsc  // distributed std container
         // no filter by range AND elemenet for now.
       } find_element;
 
+      /// number of unique local keys.  kept up to date by local_insert, erase and find_heavy_hitters, so that
+      /// local_unique_size and get_multiplicity do not scan the table.  recounted only after the base class modifies
+      /// the table directly, e.g. load or set_bucket_table, which set local_changed.
       mutable size_t local_unique_count;
 
+      /**
+       * @brief insert, counting the new keys.  an entry with a key already present is placed next to it via the hint.
+       */
+      template <class InputIterator>
+      size_t local_insert(InputIterator first, InputIterator last) {
+        this->local_reserve(this->c.size() + ::std::distance(first, last));
+        if (first == last) return 0;
+
+        size_t before = this->c.size();
+        for (auto it = first; it != last; ++it) {
+          auto pos = this->c.find((*it).first);
+          if (pos == this->c.end()) {
+            this->c.emplace(*it);
+            ++local_unique_count;
+          } else this->c.emplace_hint(pos, *it);
+        }
+        return this->c.size() - before;
+      }
+
+      template <class InputIterator, class Predicate>
+      size_t local_insert(InputIterator first, InputIterator last, Predicate const &pred) {
+        return this->local_insert(first, ::std::partition(first, last, pred));
+      }
+
+      /// run a base class erase, and subtract the keys it removed completely from the unique count.
+      template <typename F>
+      size_t tracked_erase(F const & f) {
+        bool stale = this->local_changed;
+        this->erase_element.keys_removed = 0;
+        size_t count = f();
+        local_unique_count -= ::std::min(local_unique_count, this->erase_element.keys_removed);
+        this->local_changed = stale;
+        return count;
+      }
+
+      /// keys with entries spread over all ranks, and their global counts.  the same on all ranks.
+      ::dsc::heavy_key_directory<Key, typename Base::StoreTransformedFarmHash, typename Base::StoreTransformedEqual> heavy;
+
+      /// this rank's number of entries for each heavy key.
+      ::std::vector<size_t> local_heavy_counts() const {
+        ::std::vector<size_t> result(heavy.size());
+        for (size_t i = 0; i < heavy.size(); ++i) result[i] = this->c.count(heavy.key(i));
+        return result;
+      }
+
+      /// entries of heavy keys, from all ranks' shares.  collective.
+      template <class Predicate>
+      ::std::vector<::std::pair<Key, T> > find_heavy(::std::vector<Key> const & heavy_keys, Predicate const & pred) const {
+        return ::dsc::query_all<Key, ::std::pair<Key, T> >(heavy_keys,
+          [this, &pred](Key const & k, ::std::vector<::std::pair<Key, T> > & out) {
+            ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(out);
+            this->find_element(this->c, k, emplace_iter, pred);
+          }, this->comm);
+      }
+
     public:
 
 
@@ -1341,10 +2251,221 @@ namespace dsc  // distributed std container
       using Base::unique_size;
 
 
+      /**
+       * @brief spread the entries of keys with more than threshold entries over all ranks.  collective.
+       * @details  the entries of a key that is not heavy are all on its owner, so the local counts are exact and no sketch is needed.
+       *          keys stay heavy until all their entries are erased.  later inserts of heavy keys are spread as well.
+       *          count and find of heavy keys are answered by all ranks, so repeats do not pile onto their owners.
+       * @return number of new heavy keys.
+       */
+      size_t find_heavy_hitters(size_t const & threshold) {
+        BL_BENCH_INIT(heavy);
+
+        BL_BENCH_START(heavy);
+        ::std::vector<Key> ks;
+        this->keys(ks);
+        ::std::vector<::std::pair<Key, size_t> > found;
+        ::std::vector<::std::pair<Key, T> > entries;
+        size_t n;
+        for (auto const & k : ks) {
+          if (heavy.find(k) < heavy.size()) continue;  // already spread.
+          n = this->c.count(k);
+          if (n <= threshold) continue;
+
+          found.emplace_back(k, n);
+          auto range = this->c.equal_range(k);
+          for (auto it = range.first; it != range.second; ++it) entries.emplace_back(*it);
+          this->c.erase(k);
+          --local_unique_count;
+        }
+        BL_BENCH_END(heavy, "detect", found.size());
+
+        BL_BENCH_START(heavy);
+        size_t before = heavy.size();
+        heavy.add(found, this->comm);
+        entries = ::dsc::spread_evenly(entries, this->comm);
+        BL_BENCH_END(heavy, "spread", entries.size());
+
+        BL_BENCH_START(heavy);
+        this->local_insert(entries.begin(), entries.end());
+        BL_BENCH_END(heavy, "insert", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(heavy, "hash_multimap:find_heavy_hitters", this->comm);
+        return heavy.size() - before;
+      }
+
+      /// number of heavy keys.  not collective.
+      size_t heavy_size() const {
+        return heavy.size();
+      }
+
+
       template <class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
                                                Predicate const& pred = Predicate()) const {
-          return Base::find_overlap(find_element, keys, sorted_input, pred);
+          if (heavy.empty())
+            return Base::find_overlap(find_element, keys, sorted_input, pred);
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+          bool heavy_sorted = false;
+          ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+
+          ::std::vector<::std::pair<Key, T> > results = Base::find_overlap(find_element, keys, sorted_input, pred);
+
+          ::std::vector<::std::pair<Key, T> > heavy_results = this->find_heavy(heavy_keys, pred);
+          results.insert(results.end(), heavy_results.begin(), heavy_results.end());
+          return results;
+      }
+
+      /**
+       * @brief find, with the results passed to sink in chunks of at most chunk results per process.  see Base::find_stream
+       * @details  the results for heavy keys, spread over all processes, are passed in 1 more chunk.
+       */
+      template <class Sink, class Predicate = ::bliss::filter::TruePredicate>
+      void find_stream(::std::vector<Key>& keys, Sink && sink, size_t const & chunk = (1UL << 20),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+
+          Base::find_stream(find_element, keys, sink, chunk, sorted_input, pred);
+
+          if (heavy.empty()) return;
+          bool heavy_sorted = false;
+          ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+          ::std::vector<::std::pair<Key, T> > heavy_results = this->find_heavy(heavy_keys, pred);
+          if (heavy_results.size() > 0) sink(heavy_results);
+      }
+
+      /**
+       * @brief (query, entry) for each entry within hamming distance d of a query.  for Kmer keys.  see Base::find_neighbors
+       * @details  heavy keys in the neighborhoods are looked up on all ranks, with the find of the heavy keys.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, ::std::pair<Key, T> > >
+      find_neighbors(::std::vector<Key> const & keys, unsigned int const & d, Predicate const& pred = Predicate()) const {
+          if (heavy.empty())
+            return Base::find_neighbors(find_element, keys, d, pred);
+
+          auto is_heavy = [this](Key const & t) { return heavy.find(t) < heavy.size(); };
+          ::std::vector<::std::pair<Key, ::std::pair<Key, T> > > results =
+              Base::find_neighbors(find_element, keys, d, pred, is_heavy);
+
+          // (heavy key, query) for the heavy keys in the neighborhood of each query.
+          typename Base::InputTransform trans;
+          ::std::vector<::std::pair<Key, Key> > heavy_queries;
+          for (auto const & q : keys) {
+            Key t = trans(q);
+            if (is_heavy(t)) heavy_queries.emplace_back(t, q);
+            ::bliss::common::kmer::for_each_hamming_neighbor(q, d, [&trans, &is_heavy, &heavy_queries, &q](Key const & n) {
+              Key t = trans(n);
+              if (is_heavy(t)) heavy_queries.emplace_back(t, q);
+            });
+          }
+          ::std::sort(heavy_queries.begin(), heavy_queries.end());
+          heavy_queries.erase(::std::unique(heavy_queries.begin(), heavy_queries.end()), heavy_queries.end());
+
+          ::std::vector<Key> heavy_keys;
+          for (auto const & x : heavy_queries)
+            if (heavy_keys.empty() || !(heavy_keys.back() == x.first)) heavy_keys.emplace_back(x.first);
+
+          ::std::vector<::std::pair<Key, T> > heavy_results = this->find_heavy(heavy_keys, pred);
+          ::std::sort(heavy_results.begin(), heavy_results.end(),
+                      [](::std::pair<Key, T> const & x, ::std::pair<Key, T> const & y) { return x.first < y.first; });
+
+          // join on the heavy key.
+          auto e = heavy_results.begin();
+          for (auto const & x : heavy_queries) {
+            while ((e != heavy_results.end()) && (e->first < x.first)) ++e;
+            for (auto f = e; (f != heavy_results.end()) && (f->first == x.first); ++f) results.emplace_back(x.second, *f);
+          }
+          return results;
+      }
+
+      /// count for each query key, in the order of keys, with heavy keys.  see Base::count_each
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_each(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+          return this->count_each_by(keys, [this, &pred](::std::vector<Key> & unique_keys) {
+            return this->template count<false>(unique_keys, false, pred);
+          });
+      }
+
+      /// count for each query key, in the order of keys.  see Base::count_values.  heavy keys are answered by count_each.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_values(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+          if (heavy.empty()) return Base::count_values(keys, pred);
+          return this->count_each(keys, pred);
+      }
+
+      /**
+       * @brief count elements with the specified keys.  heavy keys are counted from the directory, or by all ranks if filtered.
+       */
+      template <bool remove_duplicate = true, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate() ) const {
+          if (heavy.empty())
+            return Base::template count<remove_duplicate>(keys, sorted_input, pred);
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+          if (remove_duplicate) {
+            bool heavy_sorted = false;
+            ::fsc::unique(heavy_keys, heavy_sorted, typename Base::StoreTransformedFunc(), typename Base::StoreTransformedEqual());
+          }
+
+          ::std::vector<::std::pair<Key, size_type> > results =
+              Base::template count<remove_duplicate>(keys, sorted_input, pred);
+          results.reserve(results.size() + heavy_keys.size());
+
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+            for (auto const & k : heavy_keys) results.emplace_back(k, heavy.count(heavy.find(k)));
+            return results;
+          }
+
+          // every rank counts its share.  each rank answers all of heavy_keys in order.
+          ::std::vector<::std::pair<Key, size_type> > partial =
+              ::dsc::query_all<Key, ::std::pair<Key, size_type> >(heavy_keys,
+                [this, &pred](Key const & k, ::std::vector<::std::pair<Key, size_type> > & out) {
+                  ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > emplace_iter(out);
+                  this->count_element(this->c, k, emplace_iter, pred);
+                }, this->comm);
+          size_t first = results.size();
+          for (auto const & k : heavy_keys) results.emplace_back(k, 0);
+          for (size_t i = 0; i < partial.size(); ++i) results[first + (i % heavy_keys.size())].second += partial[i].second;
+          return results;
+      }
+
+      /**
+       * @brief erase elements with the specified keys.  heavy keys are erased on all ranks.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate() ) {
+          if (heavy.empty())
+            return this->tracked_erase([&]() { return Base::erase(keys, sorted_input, pred); });
+
+          ::std::vector<Key> heavy_keys;
+          heavy.extract_keys(keys, heavy_keys, typename Base::InputTransform());
+
+          size_t count = this->tracked_erase([&]() { return Base::erase(keys, sorted_input, pred); });
+
+          if (this->comm.size() > 1) heavy_keys = ::mxx::allgatherv(heavy_keys, this->comm);
+          size_t before = this->c.size();
+          count += this->tracked_erase([&]() {
+            auto dummy = heavy_keys.begin();
+            for (auto const & k : heavy_keys) this->erase_element(this->c, k, dummy, pred);
+            return before - this->c.size();
+          });
+
+          heavy.recount(this->local_heavy_counts(), this->comm);
+
+          return count;
+      }
+
+      template <typename Predicate>
+      size_t erase(Predicate const & pred = Predicate()) {
+          size_t count = this->tracked_erase([&]() { return Base::erase(pred); });
+          heavy.recount(this->local_heavy_counts(), this->comm);
+          return count;
       }
 //      template <class Predicate = ::bliss::filter::TruePredicate>
 //      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
@@ -1458,6 +2579,14 @@ namespace dsc  // distributed std container
       }
 
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed unordered_multimap.
        * @param first
@@ -1465,6 +2594,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -1476,8 +2608,19 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_intput", input.size());
 
+        // entries of heavy keys go to all ranks evenly instead of to the owner.
+        ::std::vector<::std::pair<Key, T> > heavy_input;
+        if (!heavy.empty()) {
+          BL_BENCH_START(insert);
+          heavy.extract(input, heavy_input);
+          heavy_input = ::dsc::spread_evenly(heavy_input, this->comm);
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            heavy_input.erase(::std::partition(heavy_input.begin(), heavy_input.end(), pred), heavy_input.end());
+          BL_BENCH_END(insert, "spread_heavy", heavy_input.size());
+        }
 
         //        printf("r %d key size %lu, val size %lu, pair size %lu, tuple size %lu\n", this->comm.rank(), sizeof(Key), sizeof(T), sizeof(::std::pair<Key, T>), sizeof(::std::tuple<Key, T>));
         //        count_unique(input);
@@ -1489,10 +2632,10 @@ namespace dsc  // distributed std container
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
 
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          auto i2o = this->buffers.template acquire<size_t>(input.size());
+          auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          input.swap(*buffer);
 
           //auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
           //BLISS_UNUSED(recv_counts);
@@ -1505,11 +2648,18 @@ namespace dsc  // distributed std container
         // local compute part.  called by the communicator.
         size_t count = 0;
         if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
-          count = this->Base::local_insert(input.begin(), input.end(), pred);
+          count = this->local_insert(input.begin(), input.end(), pred);
         else
-          count = this->Base::local_insert(input.begin(), input.end());
+          count = this->local_insert(input.begin(), input.end());
         BL_BENCH_END(insert, "insert", this->c.size());
 
+        if (!heavy.empty()) {
+          BL_BENCH_START(insert);
+          heavy.add_counts(heavy.tally(heavy_input), this->comm);
+          count += this->local_insert(heavy_input.begin(), heavy_input.end());
+          BL_BENCH_END(insert, "insert_heavy", this->c.size());
+        }
+
         BL_BENCH_REPORT_MPI_NAMED(insert, "hash_multimap:insert", this->comm);
         return count;
       }
@@ -1528,7 +2678,26 @@ namespace dsc  // distributed std container
 
           this->local_changed = false;
         }
-        return local_unique_count;
+        // heavy keys are attributed to rank 0, so the sum over ranks is exact.
+        size_t n = local_unique_count;
+        for (size_t i = 0; i < heavy.size(); ++i)
+          if (this->c.find(heavy.key(i)) != this->c.end()) --n;
+        if (this->comm.rank() == 0) n += heavy.size();
+        return n;
+      }
+
+      virtual void local_reset() noexcept {
+        Base::local_reset();
+        heavy.clear();
+        local_unique_count = 0;
+        this->local_changed = false;
+      }
+
+      virtual void local_clear() noexcept {
+        Base::local_clear();
+        heavy.clear();
+        local_unique_count = 0;
+        this->local_changed = false;
       }
   };
 
@@ -1568,7 +2737,7 @@ namespace dsc  // distributed std container
   class Alloc = ::std::allocator< ::std::pair<const Key, T> >
   >
   class reduction_unordered_map : public unordered_map<Key, T, MapParams, Alloc> {
-      static_assert(::std::is_arithmetic<T>::value, "mapped type has to be arithmetic");
+      static_assert(::std::is_trivially_copyable<T>::value, "mapped type has to be trivially copyable, e.g. arithmetic or a fixed size struct, with Reduc defined");
 
     protected:
       using Base = unordered_map<Key, T, MapParams, Alloc>;
@@ -1689,6 +2858,14 @@ namespace dsc  // distributed std container
       using Base::erase;
       using Base::unique_size;
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        this->insert_staged(this->staged, [this](::std::vector<::std::pair<Key, T> > & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed unordered_multimap.
        * @param first
@@ -1696,6 +2873,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -1707,6 +2887,7 @@ namespace dsc  // distributed std container
 
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_intput", input.size());
 
 
@@ -1715,10 +2896,10 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          auto i2o = this->buffers.template acquire<size_t>(input.size());
+          auto buffer = this->buffers.template acquire<::std::pair<Key, T> >(input.size());
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          input.swap(*buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
 //          BLISS_UNUSED(recv_counts);
@@ -1744,6 +2925,87 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief insert new elements, consuming the input.  received chunks are reduced into the map as they arrive.
+       *        input is empty afterwards.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, T> >&& input, Predicate const & pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged);
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_hashmap:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_intput", input.size());
+
+        BL_BENCH_START(insert);
+        size_t count = 0;
+        auto consume = [this, &count, &pred](::std::pair<Key, T> * first, ::std::pair<Key, T> * last) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            count += this->local_insert(first, last, pred);
+          else
+            count += this->local_insert(first, last);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        BL_BENCH_END(insert, "dist_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_hashmap:insert", this->comm);
+
+        return count;
+      }
+
+
+      /**
+       * @brief reduce the entries of other into this map, e.g. to add the counts of another batch.  collective.
+       * @details  if the maps are co-partitioned and transform the input the same way, other's entries are already on
+       *        their owner processes and transformed, so they are reduced into the local container without communication.
+       *        otherwise other's entries are streamed through insert, which transforms and distributes them.
+       *        either way other is read in chunks via its scan cursor, so the extra memory is bounded by the chunk.
+       * @param chunk_size  entries of other per process per round.
+       * @return  number of new local entries.
+       */
+      template <typename OtherMap>
+      size_t merge(OtherMap const & other, size_t const & chunk_size = (1UL << 20)) {
+        static_assert(::std::is_same<Key, typename OtherMap::key_type>::value, "merge needs maps with the same key type.");
+
+        BL_BENCH_INIT(merge);
+
+        // same decision on all processes, since the bucket tables are the same.
+        bool const local = ::std::is_same<typename Base::input_transform_type, typename OtherMap::input_transform_type>::value &&
+            ((this->comm.size() == 1) || this->is_co_partitioned(other));
+
+        BL_BENCH_COLLECTIVE_START(merge, "merge", this->comm);
+        size_t before = this->c.size();
+        ::std::vector<::std::pair<Key, T> > buffer;
+        if (static_cast<void const *>(&other) == static_cast<void const *>(this)) {
+          // the scan would read the table while it is updated.
+          this->to_vector(buffer);
+          if (local) this->local_insert(buffer.begin(), buffer.end());
+          else this->insert(buffer);
+        } else {
+          auto cursor = other.scan(chunk_size);
+          while (cursor.next()) {
+            auto const & chunk = cursor.chunk();
+            buffer.clear();
+            buffer.reserve(chunk.size());
+            for (size_t i = 0; i < chunk.size(); ++i) buffer.emplace_back(chunk.key(i), static_cast<T>(chunk.value(i)));
+            if (local) this->local_insert(buffer.begin(), buffer.end());
+            else this->insert(buffer);  // collective
+          }
+        }
+        BL_BENCH_END(merge, local ? "local_merge" : "insert_merge", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(merge, "reduction_hashmap:merge", this->comm);
+        return this->c.size() - before;
+      }
 
   };
 
@@ -1806,9 +3068,21 @@ namespace dsc  // distributed std container
       using size_type             = typename local_container_type::size_type;
       using difference_type       = typename local_container_type::difference_type;
 
+    protected:
+      /// send inserted keys sorted and delta encoded.  see imxx::distribute_compressed.
+      bool compress_distribute;
 
+    public:
 
-      counting_unordered_map(const mxx::comm& _comm) : Base(_comm) {}
+      counting_unordered_map(const mxx::comm& _comm) : Base(_comm), compress_distribute(false) {}
+
+      /// compress the keys sent during insert.  trades local sorting for less traffic.  should be the same on all processes.
+      void set_compressed_distribute(bool const & compress) {
+        compress_distribute = compress;
+      }
+      bool get_compressed_distribute() const {
+        return compress_distribute;
+      }
 
       virtual ~counting_unordered_map() {};
 
@@ -1818,6 +3092,15 @@ namespace dsc  // distributed std container
       using Base::erase;
       using Base::unique_size;
 
+    protected:
+      /// insert the input staged since begin_build as 1 batch.  collective.  see map_base::finalize
+      virtual void finalize_build() {
+        Base::finalize_build();
+        this->insert_staged(this->staged_keys, [this](::std::vector<Key> & input) { this->insert(input); });
+      }
+
+    public:
+
       /**
        * @brief insert new elements in the distributed unordered_multimap.
        * @param first
@@ -1825,6 +3108,9 @@ namespace dsc  // distributed std container
        */
       template <typename Predicate = ::bliss::filter::TruePredicate>
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged_keys);
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
 
@@ -1837,6 +3123,7 @@ namespace dsc  // distributed std container
         // transform input first.
         BL_BENCH_START(insert);
         this->transform_input(input);
+        this->balance_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
         // then send the raw k-mers.
@@ -1845,9 +3132,13 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector< Key > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          if (compress_distribute) {
+            ::imxx::distribute_compressed(input, this->key_to_rank, recv_counts, buffer, this->comm);
+          } else {
+            std::vector<size_t> i2o;
+            ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          }
           input.swap(buffer);
 
           BL_BENCH_END(insert, "dist_data", input.size());
@@ -1883,6 +3174,48 @@ namespace dsc  // distributed std container
 
       }
 
+      /**
+       * @brief insert keys, consuming the input.  received chunks are counted into the map as they arrive.
+       *        input is empty afterwards.  does not use compress_distribute.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector< Key >&& input, Predicate const &pred = Predicate()) {
+        // build phase:  stage only.  see begin_build
+        if (this->building && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return this->stage_input(input, this->staged_keys);
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "count_hashmap:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        this->balance_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_START(insert);
+        size_t count = 0;
+        auto trans = [](Key const & x) {
+          return ::std::make_pair(x, T(1));
+        };
+        auto consume = [this, &count, &pred, &trans](Key * first, Key * last) {
+          auto local_start = ::bliss::iterator::make_transform_iterator(first, trans);
+          auto local_end = ::bliss::iterator::make_transform_iterator(last, trans);
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            count += this->Base::local_insert(local_start, local_end, pred);
+          else
+            count += this->Base::local_insert(local_start, local_end);
+        };
+        ::imxx::distribute_consume(input, this->key_to_rank, consume, this->comm);
+        BL_BENCH_END(insert, "dist_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "count_hashmap:insert_key", this->comm);
+
+        return count;
+      }
+
 
   };
 
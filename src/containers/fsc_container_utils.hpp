@@ -27,7 +27,10 @@
 
 #include <iterator>  // iterator_traits
 #include <unordered_set>
+#include <type_traits>  // enable_if
+#include <utility>  // declval
 #include <algorithm>  // upper bound, unique, sort, etc.
+#include <cassert>
 
 #include "utils/benchmark_utils.hpp"
 #include "utils/filter_utils.hpp"
@@ -63,11 +66,42 @@ namespace fsc {
 
 
 
+  /// detect hash functors with a batch interface, i.e. h(T const * input, size_t count, uint64_t * results)
+  template <typename Hash, typename T>
+  struct has_batch_hash {
+    protected:
+      template <typename H>
+      static constexpr auto check(H const * h) ->
+          decltype((*h)(::std::declval<T const *>(), ::std::declval<size_t const &>(), ::std::declval<uint64_t *>()), bool()) { return true; }
+      template <typename H>
+      static constexpr bool check(...) { return false; }
+    public:
+      static constexpr bool value = check<Hash>(nullptr);
+  };
+
+  /// batch hash:  results[i] = h(input[i]).  uses the batch interface of the hash functor if available.
+  template <typename Hash, typename T,
+      typename ::std::enable_if<has_batch_hash<Hash, T>::value, int>::type = 0>
+  inline void batch_hash(Hash const & h, T const * input, size_t const & count, uint64_t * results) {
+	  h(input, count, results);
+  }
+  template <typename Hash, typename T,
+      typename ::std::enable_if<!has_batch_hash<Hash, T>::value, int>::type = 0>
+  inline void batch_hash(Hash const & h, T const * input, size_t const & count, uint64_t * results) {
+	  for (size_t i = 0; i < count; ++i) {
+		  results[i] = h(input[i]);
+	  }
+  }
+
+
   template <typename Key, template <typename> class Hash, template <typename> class Transform>
   struct TransformedHash {
       Hash<Key> h;
       Transform<Key> trans;
 
+      /// number of keys transformed at a time by the batch operator.
+      static constexpr size_t batch_block = 64;
+
       TransformedHash(Hash<Key> const & _hash = Hash<Key>(),
     		  Transform<Key> const &_trans = Transform<Key>()) : h(_hash), trans(_trans) {};
 
@@ -82,7 +116,30 @@ namespace fsc {
       inline uint64_t operator()(::std::pair<const Key, V> const& x) const {
         return this->operator()(x.first);
       }
+
+      /// batch hash.  keys are transformed in blocks, then hashed via the batch interface of Hash, if available.
+      template <typename T>
+      inline void operator()(T const * x, size_t const & count, uint64_t * results) const {
+        Key keys[batch_block];
+        size_t n;
+        for (size_t i = 0; i < count; i += batch_block) {
+          n = ::std::min(batch_block, count - i);
+          for (size_t j = 0; j < n; ++j) {
+            keys[j] = trans(get_key(x[i + j]));
+          }
+          ::fsc::batch_hash(h, keys, n, results + i);
+        }
+      }
+
+    protected:
+      static inline Key const & get_key(Key const & x) { return x; }
+      template<typename V>
+      static inline Key const & get_key(::std::pair<Key, V> const & x) { return x.first; }
+      template<typename V>
+      static inline Key const & get_key(::std::pair<const Key, V> const & x) { return x.first; }
   };
+  template <typename Key, template <typename> class Hash, template <typename> class Transform>
+  constexpr size_t TransformedHash<Key, Hash, Transform>::batch_block;
 
 
   template <typename Key, template <typename> class Predicate, template <typename> class Transform>
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    heavy_hitters.hpp
+ * @ingroup dsc::containers
+ * @brief   replicated directory of heavy keys, and the collectives to spread and query their entries, for the hash distributed multimaps.
+ * @details  in a hash distributed multimap all entries of a key are on 1 rank, so queries for highly repetitive k-mers
+ *          (ALU, centromeric repeats) send most of the requests and results to a few ranks.  a key is heavy when it has
+ *          more than a threshold of entries.  the entries of a heavy key are spread round robin over all ranks, and every
+ *          rank keeps the list of heavy keys with their global counts.
+ *
+ *          count of a heavy key is then answered from the directory without communication.  find of heavy keys gathers
+ *          the (few, deduplicated) heavy query keys on all ranks, and each rank returns its share of the entries, so the
+ *          result volume is balanced.
+ *
+ *          the directory is identical on all ranks.  add, add_counts, recount and the free functions here are collective.
+ */
+#ifndef HEAVY_HITTERS_HPP_
+#define HEAVY_HITTERS_HPP_
+
+#include <vector>
+#include <utility>        // pair
+#include <unordered_map>
+#include <functional>     // plus
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+namespace dsc  // distributed std container
+{
+
+  /**
+   * @brief list of heavy keys and their global entry counts.  the same on all ranks.
+   * @tparam Hash   hash on Key, e.g. the map's StoreTransformedFarmHash.
+   * @tparam Equal  equality on Key, e.g. the map's StoreTransformedEqual.
+   */
+  template <typename Key, typename Hash, typename Equal>
+  class heavy_key_directory {
+    protected:
+      /// heavy keys, in the same order on all ranks.
+      ::std::vector<Key> keys;
+      /// global number of entries for each key.
+      ::std::vector<size_t> counts;
+      /// position of each key in keys.
+      ::std::unordered_map<Key, size_t, Hash, Equal> index;
+
+    public:
+      size_t size() const { return keys.size(); }
+      bool empty() const { return keys.empty(); }
+
+      /// position of k, or size() if k is not heavy.
+      size_t find(Key const & k) const {
+        auto it = index.find(k);
+        return (it == index.end()) ? keys.size() : it->second;
+      }
+      Key const & key(size_t const & i) const { return keys[i]; }
+      size_t count(size_t const & i) const { return counts[i]; }
+
+      /// add heavy keys found on this rank, with their global counts.  keys must not be in the directory already.  collective.
+      void add(::std::vector<::std::pair<Key, size_t> > const & local, ::mxx::comm const & comm) {
+        ::std::vector<::std::pair<Key, size_t> > all =
+            (comm.size() > 1) ? ::mxx::allgatherv(local, comm) : local;
+        keys.reserve(keys.size() + all.size());
+        counts.reserve(counts.size() + all.size());
+        for (auto const & x : all) {
+          index.emplace(x.first, keys.size());
+          keys.emplace_back(x.first);
+          counts.emplace_back(x.second);
+        }
+      }
+
+      /// add the delta[i] of all ranks to counts[i].  delta has size().  collective.
+      void add_counts(::std::vector<size_t> const & delta, ::mxx::comm const & comm) {
+        if (keys.empty()) return;
+        ::std::vector<size_t> total =
+            (comm.size() > 1) ? ::mxx::allreduce(delta, ::std::plus<size_t>(), comm) : delta;
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += total[i];
+      }
+
+      /**
+       * @brief set the counts to the sum of each rank's local counts, and drop keys that have no entries left.  collective.
+       * @param local   this rank's number of entries for each key.  has size().
+       */
+      void recount(::std::vector<size_t> const & local, ::mxx::comm const & comm) {
+        if (keys.empty()) return;
+        ::std::vector<size_t> total =
+            (comm.size() > 1) ? ::mxx::allreduce(local, ::std::plus<size_t>(), comm) : local;
+        index.clear();
+        size_t j = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          if (total[i] == 0) continue;
+          keys[j] = keys[i];
+          counts[j] = total[i];
+          index.emplace(keys[j], j);
+          ++j;
+        }
+        keys.erase(keys.begin() + j, keys.end());
+        counts.resize(j);
+      }
+
+      /// number of entries of each heavy key in input.
+      template <typename V>
+      ::std::vector<size_t> tally(::std::vector<::std::pair<Key, V> > const & input) const {
+        ::std::vector<size_t> result(keys.size(), 0);
+        size_t h;
+        for (auto const & x : input) {
+          h = find(x.first);
+          if (h < keys.size()) ++result[h];
+        }
+        return result;
+      }
+
+      /// move the entries of heavy keys from input to the end of output.  order of the rest is preserved.
+      template <typename V>
+      void extract(::std::vector<::std::pair<Key, V> > & input, ::std::vector<::std::pair<Key, V> > & output) const {
+        if (keys.empty()) return;
+        size_t j = 0;
+        for (size_t i = 0; i < input.size(); ++i) {
+          if (find(input[i].first) < keys.size()) output.emplace_back(input[i]);
+          else input[j++] = input[i];
+        }
+        input.erase(input.begin() + j, input.end());
+      }
+
+      /**
+       * @brief move the query keys that are heavy after trans from qs to the end of output, as transformed keys.
+       * @details  the other keys are left untransformed, for the map's own query path to transform.
+       */
+      template <typename Trans>
+      void extract_keys(::std::vector<Key> & qs, ::std::vector<Key> & output, Trans const & trans) const {
+        if (keys.empty()) return;
+        size_t j = 0;
+        Key k;
+        for (size_t i = 0; i < qs.size(); ++i) {
+          k = trans(qs[i]);
+          if (find(k) < keys.size()) output.emplace_back(k);
+          else qs[j++] = qs[i];
+        }
+        qs.erase(qs.begin() + j, qs.end());
+      }
+
+      void clear() {
+        keys.clear();
+        counts.clear();
+        index.clear();
+      }
+  };
+
+  /**
+   * @brief send the i-th entry of this rank to rank (rank + i) % p, so that each rank gets an even share.  collective.
+   * @return the entries received.
+   */
+  template <typename V>
+  ::std::vector<V> spread_evenly(::std::vector<V> const & entries, ::mxx::comm const & comm) {
+    int const p = comm.size();
+    if (p == 1) return entries;
+
+    // group by destination
+    size_t const n = entries.size();
+    ::std::vector<size_t> send_counts(p, 0);
+    for (int r = 0; r < p; ++r) {
+      size_t first = (r - comm.rank() + p) % p;
+      send_counts[r] = (n > first) ? (n - first + p - 1) / p : 0;
+    }
+    ::std::vector<V> buffer;
+    buffer.reserve(n);
+    for (int r = 0; r < p; ++r) {
+      for (size_t i = (r - comm.rank() + p) % p; i < n; i += p) buffer.emplace_back(entries[i]);
+    }
+
+    return ::mxx::all2allv(buffer, send_counts, comm);
+  }
+
+  /**
+   * @brief answer each rank's queries on every rank, and return the results to the querying rank.  collective.
+   * @details  for queries (e.g. heavy keys) whose answers are spread over all ranks.  op(query, output) appends this rank's
+   *          results for query to output.  the query lists of all ranks are gathered, so they should be short.
+   * @return results for this rank's queries from all ranks, grouped by the answering rank.
+   */
+  template <typename Q, typename R, typename Op>
+  ::std::vector<R> query_all(::std::vector<Q> const & queries, Op const & op, ::mxx::comm const & comm) {
+    ::std::vector<R> results;
+    if (comm.size() == 1) {
+      for (auto const & q : queries) op(q, results);
+      return results;
+    }
+
+    ::std::vector<size_t> query_counts = ::mxx::allgather(queries.size(), comm);
+    ::std::vector<Q> all = ::mxx::allgatherv(queries, query_counts, comm);
+
+    // answer the queries of each source rank in turn, so the results are grouped by destination.
+    ::std::vector<size_t> send_counts(comm.size(), 0);
+    size_t q = 0, before;
+    for (int r = 0; r < comm.size(); ++r) {
+      before = results.size();
+      for (size_t i = 0; i < query_counts[r]; ++i, ++q) op(all[q], results);
+      send_counts[r] = results.size() - before;
+    }
+
+    return ::mxx::all2allv(results, send_counts, comm);
+  }
+
+} // namespace dsc
+
+#endif /* HEAVY_HITTERS_HPP_ */
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    hugepage_allocator.hpp
+ * @ingroup fsc::containers
+ * @brief   allocator that backs large arrays with 2 MB or 1 GB pages, for the local tables of the distributed maps.
+ * @details probes of a multi-GB hash table miss the TLB on almost every access with 4 KB pages.  allocations of at
+ *          least Policy::min_bytes (hash table bucket arrays, sorted vectors, densehash tables) are mmapped:
+ *            transparent   anonymous mapping with madvise(MADV_HUGEPAGE), aligned to 2 MB.  needs THP "madvise" or "always".
+ *            hugetlb_2m/1g MAP_HUGETLB from the reserved pool (vm.nr_hugepages, or hugepages-1048576kB).  if the pool
+ *                          is empty, falls back to transparent.
+ *          smaller allocations, e.g. the nodes of std::unordered_map, go to std::allocator.
+ *
+ *          NUMA placement:  by default the pages are touched by the allocating thread (Policy::prefault), so they land
+ *          on its node by first touch.  if the process was pinned to 1 node by bliss::utils::affinity_manager, that
+ *          node is preferred (mbind MPOL_PREFERRED) even for pages first touched elsewhere.  with Policy::interleave,
+ *          the pages are interleaved over the allowed nodes (mbind MPOL_INTERLEAVE), for tables shared by the
+ *          processes of a node.
+ *
+ *          stateless:  all instances with the same Policy compare equal.  derives from std::allocator so the pre-C++11
+ *          interface needed by google dense_hash_map is present.  on platforms other than Linux it is std::allocator.
+ *
+ *          selected through the Alloc parameter of the maps, e.g. bliss::index::kmer::HugePageAlloc.
+ */
+#ifndef SRC_CONTAINERS_HUGEPAGE_ALLOCATOR_HPP_
+#define SRC_CONTAINERS_HUGEPAGE_ALLOCATOR_HPP_
+
+#include <memory>   // allocator
+#include <new>      // bad_alloc
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sys/mman.h>      // mmap, madvise
+#include <sys/syscall.h>   // SYS_mbind
+#include <unistd.h>        // syscall
+#endif
+
+#include "utils/numa_node.hpp"
+
+namespace fsc {  // fast standard container
+
+  enum class hugepage_kind { transparent, hugetlb_2m, hugetlb_1g };
+
+  /**
+   * @tparam Kind       page source.
+   * @tparam Interleave interleave the pages over the NUMA nodes, else first touch.
+   * @tparam Prefault   touch the pages at allocation, by the allocating thread.  ignored with Interleave.
+   * @tparam MinBytes   smallest allocation that gets huge pages.
+   */
+  template <hugepage_kind Kind = hugepage_kind::transparent, bool Interleave = false, bool Prefault = true,
+            size_t MinBytes = (1UL << 21)>
+  struct hugepage_policy {
+      static constexpr hugepage_kind kind = Kind;
+      static constexpr bool interleave = Interleave;
+      static constexpr bool prefault = Prefault && !Interleave;
+      static constexpr size_t min_bytes = MinBytes;
+      /// size and alignment of the mappings.
+      static constexpr size_t page_bytes = (Kind == hugepage_kind::hugetlb_1g) ? (1UL << 30) : (1UL << 21);
+  };
+
+  template <hugepage_kind Kind, bool Interleave, bool Prefault, size_t MinBytes>
+  constexpr hugepage_kind hugepage_policy<Kind, Interleave, Prefault, MinBytes>::kind;
+  template <hugepage_kind Kind, bool Interleave, bool Prefault, size_t MinBytes>
+  constexpr bool hugepage_policy<Kind, Interleave, Prefault, MinBytes>::interleave;
+  template <hugepage_kind Kind, bool Interleave, bool Prefault, size_t MinBytes>
+  constexpr bool hugepage_policy<Kind, Interleave, Prefault, MinBytes>::prefault;
+  template <hugepage_kind Kind, bool Interleave, bool Prefault, size_t MinBytes>
+  constexpr size_t hugepage_policy<Kind, Interleave, Prefault, MinBytes>::min_bytes;
+  template <hugepage_kind Kind, bool Interleave, bool Prefault, size_t MinBytes>
+  constexpr size_t hugepage_policy<Kind, Interleave, Prefault, MinBytes>::page_bytes;
+
+  /// for tables shared by the processes of a node.
+  using interleaved_hugepage_policy = hugepage_policy<hugepage_kind::transparent, true>;
+
+
+  /// bytes currently mapped by the huge page allocators, and the hugetlb requests that fell back to transparent pages.
+  struct hugepage_stats {
+      std::atomic<int64_t> mapped;
+      std::atomic<int64_t> fallbacks;
+
+      hugepage_stats() : mapped(0), fallbacks(0) {}
+
+      static hugepage_stats & instance() {
+        static hugepage_stats stats;
+        return stats;
+      }
+  };
+
+
+  namespace local {
+
+#if defined(__linux__)
+    /// MAP_HUGETLB flags for the page size, from linux/mman.h.
+    inline int hugetlb_flags(size_t const & page_bytes) {
+      int shift = (page_bytes == (1UL << 30)) ? 30 : 21;
+      return MAP_HUGETLB | (shift << 26);   // MAP_HUGE_SHIFT
+    }
+
+    /// interleave [p, p + bytes) over the nodes this process may use.  best effort:  errors leave the default policy.
+    inline void interleave_pages(void * p, size_t const & bytes) {
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+      unsigned long nodes[16] = {0};
+      int mode = 0;
+      // MPOL_F_MEMS_ALLOWED = 4, MPOL_INTERLEAVE = 3
+      if (syscall(SYS_get_mempolicy, &mode, nodes, 16 * 8 * sizeof(unsigned long), nullptr, 4UL) != 0) return;
+      syscall(SYS_mbind, p, bytes, 3, nodes, 16 * 8 * sizeof(unsigned long), 0U);
+#else
+      (void)p; (void)bytes;
+#endif
+    }
+
+    /// anonymous mapping of bytes (a multiple of align), aligned to align.
+    inline void * map_aligned(size_t const & bytes, size_t const & align) {
+      void * raw = mmap(nullptr, bytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (raw == MAP_FAILED) return nullptr;
+
+      // trim to the aligned part.
+      uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+      uintptr_t aligned = (start + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+      if (aligned > start) munmap(raw, aligned - start);
+      munmap(reinterpret_cast<void *>(aligned + bytes), start + align - aligned);
+      return reinterpret_cast<void *>(aligned);
+    }
+#endif
+
+    template <typename Policy>
+    inline size_t hugepage_round(size_t const & bytes) {
+      return (bytes + Policy::page_bytes - 1) & ~(Policy::page_bytes - 1);
+    }
+
+    template <typename Policy>
+    void * hugepage_map(size_t const & bytes) {
+#if defined(__linux__)
+      size_t len = hugepage_round<Policy>(bytes);
+      void * p = MAP_FAILED;
+
+      if (Policy::kind != hugepage_kind::transparent) {
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | hugetlb_flags(Policy::page_bytes), -1, 0);
+        if (p == MAP_FAILED) hugepage_stats::instance().fallbacks.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (p == MAP_FAILED) {
+        p = map_aligned(len, (1UL << 21));
+        if (p == nullptr) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+        madvise(p, len, MADV_HUGEPAGE);
+#endif
+      }
+
+      if (Policy::interleave) interleave_pages(p, len);
+      else {
+        int node = ::bliss::utils::pinned_numa_node().load(std::memory_order_relaxed);
+        if (node >= 0) ::bliss::utils::prefer_numa_node(p, len, node);
+      }
+      if (Policy::prefault) {
+        // first touch, 1 write per 4 KB page.
+        char * c = reinterpret_cast<char *>(p);
+        for (size_t i = 0; i < len; i += 4096) c[i] = 0;
+      }
+
+      hugepage_stats::instance().mapped.fetch_add(static_cast<int64_t>(len), std::memory_order_relaxed);
+      return p;
+#else
+      (void)bytes;
+      return nullptr;
+#endif
+    }
+
+    template <typename Policy>
+    void hugepage_unmap(void * p, size_t const & bytes) {
+#if defined(__linux__)
+      size_t len = hugepage_round<Policy>(bytes);
+      munmap(p, len);
+      hugepage_stats::instance().mapped.fetch_sub(static_cast<int64_t>(len), std::memory_order_relaxed);
+#else
+      (void)p; (void)bytes;
+#endif
+    }
+
+  } // namespace local
+
+
+  /**
+   * @brief std::allocator that maps allocations of at least Policy::min_bytes with huge pages.
+   */
+  template <typename T, typename Policy = hugepage_policy<> >
+  class hugepage_allocator : public std::allocator<T> {
+    public:
+      using base_type = std::allocator<T>;
+      using value_type = T;
+      using pointer = T*;
+      using size_type = size_t;
+
+      template <typename U>
+      struct rebind {
+          using other = hugepage_allocator<U, Policy>;
+      };
+
+      hugepage_allocator() noexcept : base_type() {}
+      hugepage_allocator(hugepage_allocator const & other) noexcept : base_type(other) {}
+      template <typename U>
+      hugepage_allocator(hugepage_allocator<U, Policy> const &) noexcept : base_type() {}
+
+      /// whether an allocation of n elements is mapped.  the same for allocate and deallocate.
+      static inline bool is_huge(size_type const & n) {
+#if defined(__linux__)
+        return n * sizeof(T) >= Policy::min_bytes;
+#else
+        (void)n;
+        return false;
+#endif
+      }
+
+      pointer allocate(size_type n, void const * = 0) {
+        if (!is_huge(n)) return base_type::allocate(n);
+        return reinterpret_cast<pointer>(local::hugepage_map<Policy>(n * sizeof(T)));
+      }
+
+      void deallocate(pointer p, size_type n) {
+        if (!is_huge(n)) base_type::deallocate(p, n);
+        else local::hugepage_unmap<Policy>(p, n * sizeof(T));
+      }
+  };
+
+  template <typename T, typename U, typename Policy>
+  inline bool operator==(hugepage_allocator<T, Policy> const &, hugepage_allocator<U, Policy> const &) { return true; }
+  template <typename T, typename U, typename Policy>
+  inline bool operator!=(hugepage_allocator<T, Policy> const &, hugepage_allocator<U, Policy> const &) { return false; }
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_HUGEPAGE_ALLOCATOR_HPP_ */
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    interpolation_search.hpp
+ * @ingroup fsc::containers
+ * @brief   interpolation search for lower bound in sorted arrays of Kmer keys.
+ * @details  the top 64 bits of a k-mer are used as its numeric value.  k-mers, particularly canonical ones (lex_less), are
+ *          close to uniformly distributed, so the position of a key can be interpolated between the keys at the ends of
+ *          the range.  each step probes 1 element and updates 1 bracket, and about log log n steps are needed for uniform keys,
+ *          i.e. a few cache misses instead of log n dependent ones.  the steps are capped, then binary search finishes,
+ *          so skewed data costs at most a few extra probes.
+ *
+ *          the comparator has to satisfy is_radix_sortable, i.e. order the keys by Kmer::operator< after a transform.
+ *          no auxiliary structure is kept, so the sorted array can change freely between searches.
+ *
+ *          prefix_directory is the optional auxiliary structure:  a table of 2^b + 1 offsets into the sorted array, by
+ *          the top b bits of the transformed key, as the bucket table of a suffix array.  a query is narrowed to its
+ *          bucket in O(1), about n / 2^b entries for uniform keys, before the final search.  it has to be rebuilt
+ *          when the array changes.
+ */
+#ifndef INTERPOLATION_SEARCH_HPP_
+#define INTERPOLATION_SEARCH_HPP_
+
+#include <algorithm>  // lower_bound
+#include <iterator>
+#include <vector>
+#include <utility>    // pair
+#include <cstring>    // memcpy
+#include <cstdint>
+
+#include "containers/radix_sort.hpp"
+
+namespace fsc {  // fast standard container
+
+  /// top 64 bits in use of a Kmer, as an integer.  monotonic in Kmer::operator<.
+  template <typename Kmer>
+  inline uint64_t radix_prefix(Kmer const & k) {
+    constexpr size_t bytes = (Kmer::nBytes < 8) ? Kmer::nBytes : 8;
+    uint64_t x = 0;
+    memcpy(&x, reinterpret_cast<uint8_t const *>(k.getData()) + (Kmer::nBytes - bytes), bytes);
+    return x;
+  }
+
+  /**
+   * @brief lower bound of v in sorted [b, e), by interpolation.  same result as std::lower_bound(b, e, v, comp).
+   * @tparam Comparator   a comparator with is_radix_sortable<Comparator>::value, e.g. TransformedComparator<Kmer, std::less, lex_less>.
+   */
+  template <class Iterator, class V, class Comparator>
+  Iterator interpolation_lower_bound(Iterator b, Iterator e, V const & v, Comparator const & comp) {
+    using Trans = typename is_radix_sortable<Comparator>::transform_type;
+    constexpr ptrdiff_t small = 16;
+    constexpr int max_steps = 8;
+
+    if ((e - b) <= small) return ::std::lower_bound(b, e, v, comp);
+    if (!comp(*b, v)) return b;
+    Iterator R = e - 1;
+    if (comp(*R, v)) return e;
+
+    // *L < v <= *R, so the lower bound is in (L, R].
+    Trans trans;
+    Iterator L = b;
+    Iterator M;
+    uint64_t kv = radix_prefix(trans(local::radix_key(v)));
+    uint64_t kl = radix_prefix(trans(local::radix_key(*L)));
+    uint64_t kr = radix_prefix(trans(local::radix_key(*R)));
+    ptrdiff_t d, off;
+    for (int i = 0; (i < max_steps) && ((R - L) > small); ++i) {
+      if ((kv <= kl) || (kr <= kv)) break;  // same top bits.  can't interpolate further.
+
+      d = R - L;
+      off = 1 + static_cast<ptrdiff_t>(static_cast<double>(kv - kl) / static_cast<double>(kr - kl) * static_cast<double>(d - 1));
+      if (off >= d) off = d - 1;
+      M = L + off;
+
+      if (comp(*M, v)) {
+        L = M;
+        kl = radix_prefix(trans(local::radix_key(*L)));
+      } else {
+        R = M;
+        kr = radix_prefix(trans(local::radix_key(*R)));
+      }
+    }
+    return ::std::lower_bound(L + 1, R + 1, v, comp);
+  }
+
+  /**
+   * @brief offsets of the buckets of the top bits of the keys, in a sorted array.
+   * @tparam Comparator   the comparator the array is sorted by.  without is_radix_sortable<Comparator>::value, the
+   *                      directory is never built, and empty.
+   */
+  template <class Comparator, bool radix_sortable = is_radix_sortable<Comparator>::value>
+  class prefix_directory {
+    public:
+      static constexpr unsigned int max_bits = 24;
+
+      prefix_directory() {}
+
+      bool empty() const { return true; }
+      unsigned int get_bits() const { return 0; }
+      size_t bytes() const { return 0; }
+      void clear() {}
+
+      template <class Iterator>
+      void build(Iterator b, Iterator e, unsigned int const & _bits) {}
+
+      template <typename V>
+      inline ::std::pair<size_t, size_t> range(V const & v) const {
+        return ::std::make_pair(static_cast<size_t>(0), static_cast<size_t>(0));
+      }
+  };
+
+  template <class Comparator>
+  class prefix_directory<Comparator, true> {
+    protected:
+      using Trans = typename is_radix_sortable<Comparator>::transform_type;
+      using Kmer = typename is_radix_sortable<Comparator>::key_type;
+
+      /// bits of radix_prefix in use, i.e. the top bits of the k-mer.
+      static constexpr unsigned int prefix_bytes = (Kmer::nBytes < 8) ? Kmer::nBytes : 8;
+      static constexpr unsigned int prefix_bits = prefix_bytes * 8 - (Kmer::nBytes * 8 - Kmer::nBits);
+
+      unsigned int bits;
+      /// entry i is the first position with a bucket >= i.  2^bits + 1 entries, or empty if not built.
+      ::std::vector<size_t> offsets;
+
+      template <typename V>
+      inline size_t bucket(V const & v) const {
+        return radix_prefix(Trans()(local::radix_key(v))) >> (prefix_bits - bits);
+      }
+
+    public:
+      /// largest table, 2^24 + 1 offsets.
+      static constexpr unsigned int max_bits = 24;
+
+      prefix_directory() : bits(0) {}
+
+      bool empty() const { return offsets.empty(); }
+      unsigned int get_bits() const { return bits; }
+      size_t bytes() const { return offsets.capacity() * sizeof(size_t); }
+
+      void clear() {
+        ::std::vector<size_t>().swap(offsets);
+        bits = 0;
+      }
+
+      /**
+       * @brief build for sorted [b, e), in 1 pass.
+       * @param _bits   bits of the key prefix, capped by max_bits and by the bits of the key.  0 clears the directory.
+       */
+      template <class Iterator>
+      void build(Iterator b, Iterator e, unsigned int const & _bits) {
+        bits = (_bits < max_bits) ? _bits : max_bits;
+        if (bits > prefix_bits) bits = prefix_bits;
+        if (bits == 0) {
+          clear();
+          return;
+        }
+        size_t buckets = static_cast<size_t>(1) << bits;
+        offsets.assign(buckets + 1, 0);
+
+        // keys are sorted, so the buckets are filled in order.
+        size_t pos = 0, next = 0, k;
+        for (Iterator it = b; it != e; ++it, ++pos) {
+          k = bucket(*it);
+          for (; next <= k; ++next) offsets[next] = pos;
+        }
+        for (; next <= buckets; ++next) offsets[next] = pos;
+      }
+
+      /// [first, second) positions that may hold v.  all entries equal to v are in the range.  the directory must not be empty.
+      template <typename V>
+      inline ::std::pair<size_t, size_t> range(V const & v) const {
+        size_t k = bucket(v);
+        return ::std::make_pair(offsets[k], offsets[k + 1]);
+      }
+  };
+
+  template <class Comparator, bool radix_sortable>
+  constexpr unsigned int prefix_directory<Comparator, radix_sortable>::max_bits;
+  template <class Comparator>
+  constexpr unsigned int prefix_directory<Comparator, true>::max_bits;
+  template <class Comparator>
+  constexpr unsigned int prefix_directory<Comparator, true>::prefix_bytes;
+  template <class Comparator>
+  constexpr unsigned int prefix_directory<Comparator, true>::prefix_bits;
+
+} // namespace fsc
+
+#endif /* INTERPOLATION_SEARCH_HPP_ */
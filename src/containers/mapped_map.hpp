@@ -0,0 +1,461 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mapped_map.hpp
+ * @ingroup
+ * @brief   read-only maps that are queried in place from a memory mapped file.
+ * @details  for query-only serving of a fixed index.  opening the map is a single mmap, there is no
+ *          rebuild or reload into heap containers, and processes on the same node share the page cache pages.
+ *
+ *          2 layouts are supported:
+ *            mapped_sorted_map:  array of std::pair<Key, T> sorted by key.  binary search.  duplicate keys allowed.
+ *            mapped_hash_map:    open addressing with linear probing, like densehash, with power of 2 capacity.
+ *                                occupancy is a bit vector after the slots, so no empty key is needed.
+ *
+ *          file format:  header of 8 uint64_t (magic, version, layout, type id, value size, count, capacity, data offset),
+ *          then the slots at data offset, then (hash layout only) the occupancy bits.  native byte order.
+ *          the type id is a hash of the map type name, so a file written for one key/value/hash type is not
+ *          opened as another.
+ *
+ *          Key and T are stored as raw bytes, so they need to be bitwise copyable and contain no pointers,
+ *          e.g. Kmer and integral types.
+ *
+ */
+#ifndef SRC_CONTAINERS_MAPPED_MAP_HPP_
+#define SRC_CONTAINERS_MAPPED_MAP_HPP_
+
+#include <vector>
+#include <string>
+#include <functional>   // hash, equal_to, less
+#include <algorithm>    // sort, lower_bound, equal_range
+#include <utility>      // pair
+#include <typeinfo>     // typeid
+#include <cstdint>      // uint64_t
+#include <cstdio>       // fopen, fwrite, rename
+#include <cstring>      // strerror
+#include <cerrno>
+#include <sstream>      // stringstream
+
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+
+#include "utils/exception_handling.hpp"
+#include "io/io_exception.hpp"
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief  read-only memory mapping of a map file, and the file header.  move only.
+   * @details  MAP_SHARED and PROT_READ, so the pages are shared via the page cache.  MADV_RANDOM since queries probe.
+   */
+  class mapped_map_file {
+    public:
+      /// layouts
+      static constexpr uint64_t SORTED = 0;
+      static constexpr uint64_t HASHED = 1;
+
+      /// file header
+      struct header_type {
+          uint64_t magic;
+          uint64_t version;
+          uint64_t layout;
+          uint64_t type_id;
+          uint64_t value_size;
+          uint64_t count;       // number of elements
+          uint64_t capacity;    // number of slots.  same as count for the sorted layout.
+          uint64_t data_offset; // start of the slots in the file.
+      };
+
+      /// "BLISSMRO" (mapped read only) as a little endian uint64_t, and the format version.
+      static constexpr uint64_t magic = 0x4F524D5353494C42UL;
+      static constexpr uint64_t version = 1UL;
+
+    protected:
+      unsigned char * data;
+      size_t bytes;
+
+    public:
+
+      /// FNV-1a hash of a type name
+      template <typename M>
+      static uint64_t get_type_id() {
+        uint64_t h = 0xcbf29ce484222325UL;
+        for (const char * c = typeid(M).name(); *c != 0; ++c) {
+          h ^= static_cast<unsigned char>(*c);
+          h *= 0x100000001b3UL;
+        }
+        return h;
+      }
+
+      /**
+       * @brief write a map file.  written to a temporary file then renamed, so processes that have the old file mapped are not affected.
+       * @param blocks   pointer and size in bytes of each block to write after the header, in order.
+       */
+      static void write(::std::string const & filename, header_type const & header,
+                        ::std::vector<::std::pair<const void *, size_t> > const & blocks) {
+        ::std::string tmp_filename = filename + ".tmp";
+
+        FILE * fp = fopen(tmp_filename.c_str(), "wb");
+        bool ok = (fp != nullptr);
+        if (ok) {
+          ok = (fwrite(&header, sizeof(header_type), 1, fp) == 1);
+
+          // pad to the data offset.
+          ::std::vector<unsigned char> pad(header.data_offset - sizeof(header_type), 0);
+          if (ok && (pad.size() > 0)) ok = (fwrite(pad.data(), 1, pad.size(), fp) == pad.size());
+
+          for (size_t i = 0; ok && (i < blocks.size()); ++i) {
+            if (blocks[i].second > 0) ok = (fwrite(blocks[i].first, 1, blocks[i].second, fp) == blocks[i].second);
+          }
+          ok &= (fclose(fp) == 0);
+        }
+        if (ok) ok = (rename(tmp_filename.c_str(), filename.c_str()) == 0);
+
+        if (!ok) {
+          int myerr = errno;
+          remove(tmp_filename.c_str());
+
+          ::std::stringstream ss;
+          ss << "ERROR : fsc::mapped_map_file::write: ["  << filename << "] " << myerr << ": " << strerror(myerr);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+      }
+
+      /// default constructor.  empty.
+      mapped_map_file() : data(nullptr), bytes(0) {}
+
+      /**
+       * @brief map a file and check its header.
+       * @param layout    expected layout
+       * @param type_id   expected type id
+       * @param value_size  expected element size
+       */
+      mapped_map_file(::std::string const & filename, uint64_t const layout, uint64_t const type_id, uint64_t const value_size) :
+        data(nullptr), bytes(0) {
+
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat filestat;
+        if ((fd == -1) || (fstat(fd, &filestat) == -1)) {
+          int myerr = errno;
+          if (fd != -1) close(fd);
+          ::std::stringstream ss;
+          ss << "ERROR : fsc::mapped_map_file: ["  << filename << "] " << myerr << ": " << strerror(myerr);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+        bytes = filestat.st_size;
+
+        if (bytes >= sizeof(header_type)) {
+          void * result = mmap(nullptr, bytes, PROT_READ, MAP_SHARED | MAP_NORESERVE, fd, 0);
+          data = (result == MAP_FAILED) ? nullptr : reinterpret_cast<unsigned char *>(result);
+        }
+        int myerr = errno;
+        close(fd);   // mapping persists after close.
+
+        if (data == nullptr) {
+          bytes = 0;
+          ::std::stringstream ss;
+          ss << "ERROR : fsc::mapped_map_file: mmap ["  << filename << "] " << myerr << ": " << strerror(myerr);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        // queries probe randomly.  no read ahead.
+        madvise(data, bytes, MADV_RANDOM);
+
+        header_type const & h = header();
+        if ((h.magic != magic) || (h.version != version) || (h.layout != layout) ||
+            (h.type_id != type_id) || (h.value_size != value_size) ||
+            (h.data_offset + h.capacity * h.value_size > bytes)) {
+          munmap(data, bytes);
+          data = nullptr;
+          bytes = 0;
+
+          ::std::stringstream ss;
+          ss << "ERROR : fsc::mapped_map_file: ["  << filename << "] is not a map file of the expected layout and type.";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+      }
+
+      ~mapped_map_file() {
+        if (data != nullptr) munmap(data, bytes);
+      }
+
+      mapped_map_file(mapped_map_file const & other) = delete;
+      mapped_map_file& operator=(mapped_map_file const & other) = delete;
+
+      mapped_map_file(mapped_map_file && other) : data(other.data), bytes(other.bytes) {
+        other.data = nullptr;
+        other.bytes = 0;
+      }
+      mapped_map_file& operator=(mapped_map_file && other) {
+        if (data != nullptr) munmap(data, bytes);
+        data = other.data;    other.data = nullptr;
+        bytes = other.bytes;  other.bytes = 0;
+        return *this;
+      }
+
+      header_type const & header() const {
+        return *(reinterpret_cast<header_type const *>(data));
+      }
+
+      /// pointer into the mapping at a file offset.
+      unsigned char const * at(size_t const & offset) const {
+        return data + offset;
+      }
+
+      bool is_mapped() const {
+        return data != nullptr;
+      }
+  };
+
+
+  /**
+   * @brief  read-only sorted map, queried in place from a memory mapped file.  supports duplicate keys.
+   * @tparam Less   comparator for the keys.  must be the same as when the file was written.
+   */
+  template <typename Key, typename T, typename Less = ::std::less<Key> >
+  class mapped_sorted_map {
+
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using value_type = ::std::pair<Key, T>;
+      using const_iterator = value_type const *;
+
+    protected:
+      struct value_less {
+          Less l;
+          inline bool operator()(value_type const & x, Key const & y) const { return l(x.first, y); }
+          inline bool operator()(Key const & x, value_type const & y) const { return l(x, y.first); }
+          inline bool operator()(value_type const & x, value_type const & y) const { return l(x.first, y.first); }
+      } comp;
+
+      mapped_map_file file;
+      const_iterator first;
+      const_iterator last;
+
+    public:
+
+      /**
+       * @brief write a sorted map file.
+       * @param input   elements to write.  sorted in place by key.
+       */
+      static void write(::std::string const & filename, ::std::vector<value_type> & input) {
+        ::std::stable_sort(input.begin(), input.end(), value_less());
+
+        mapped_map_file::header_type header;
+        header.magic = mapped_map_file::magic;
+        header.version = mapped_map_file::version;
+        header.layout = mapped_map_file::SORTED;
+        header.type_id = mapped_map_file::get_type_id<mapped_sorted_map>();
+        header.value_size = sizeof(value_type);
+        header.count = input.size();
+        header.capacity = input.size();
+        header.data_offset = sizeof(mapped_map_file::header_type);
+
+        mapped_map_file::write(filename, header,
+            { ::std::make_pair(static_cast<const void*>(input.data()), input.size() * sizeof(value_type)) });
+      }
+
+      /// map a sorted map file.
+      explicit mapped_sorted_map(::std::string const & filename) :
+        file(filename, mapped_map_file::SORTED, mapped_map_file::get_type_id<mapped_sorted_map>(), sizeof(value_type)) {
+        first = reinterpret_cast<const_iterator>(file.at(file.header().data_offset));
+        last = first + file.header().count;
+      }
+
+      size_t size() const { return last - first; }
+      bool empty() const { return first == last; }
+
+      const_iterator begin() const { return first; }
+      const_iterator end() const { return last; }
+      const_iterator cbegin() const { return first; }
+      const_iterator cend() const { return last; }
+
+      const_iterator lower_bound(Key const & k) const {
+        return ::std::lower_bound(first, last, k, comp);
+      }
+      const_iterator upper_bound(Key const & k) const {
+        return ::std::upper_bound(first, last, k, comp);
+      }
+      ::std::pair<const_iterator, const_iterator> equal_range(Key const & k) const {
+        return ::std::equal_range(first, last, k, comp);
+      }
+
+      /// find the first element with key k.  end() if not found.
+      const_iterator find(Key const & k) const {
+        const_iterator it = lower_bound(k);
+        return ((it != last) && !comp.l(k, it->first)) ? it : last;
+      }
+
+      size_t count(Key const & k) const {
+        auto range = equal_range(k);
+        return range.second - range.first;
+      }
+  };
+
+
+  /**
+   * @brief  read-only open addressing hash map, queried in place from a memory mapped file.  linear probing.  supports duplicate keys.
+   * @tparam Hash   hash function for the keys.  must be the same (and default constructed the same way) as when the file was written.
+   * @tparam Equal  equal function for the keys.
+   */
+  template <typename Key, typename T, typename Hash = ::std::hash<Key>, typename Equal = ::std::equal_to<Key> >
+  class mapped_hash_map {
+
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using value_type = ::std::pair<Key, T>;
+      using const_iterator = value_type const *;
+
+    protected:
+      Hash hash;
+      Equal eq;
+
+      mapped_map_file file;
+      const_iterator slots;
+      uint64_t const * occupied;
+      size_t mask;
+      size_t count_;
+
+      /// murmur3 finalizer.  std::hash is the identity for integers, which clusters badly with linear probing.
+      static inline size_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdUL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53UL;
+        h ^= h >> 33;
+        return h;
+      }
+
+      inline bool is_occupied(size_t const & i) const {
+        return (occupied[i >> 6] >> (i & 63)) & 1;
+      }
+
+    public:
+
+      /**
+       * @brief write a hash map file.
+       * @param input         elements to write.
+       * @param load_factor   maximum fraction of slots used.  capacity is the next power of 2 that ensures this.
+       */
+      static void write(::std::string const & filename, ::std::vector<value_type> const & input, float const & load_factor = 0.5f) {
+        size_t capacity = 64;
+        while (static_cast<float>(capacity) * load_factor < static_cast<float>(input.size())) capacity <<= 1;
+        size_t mask = capacity - 1;
+
+        ::std::vector<value_type> slots(capacity);
+        ::std::vector<uint64_t> bits(capacity >> 6, 0);
+
+        Hash h;
+        size_t i;
+        for (auto const & x : input) {
+          i = mix(h(x.first)) & mask;
+          while ((bits[i >> 6] >> (i & 63)) & 1) i = (i + 1) & mask;
+          slots[i] = x;
+          bits[i >> 6] |= (1UL << (i & 63));
+        }
+
+        mapped_map_file::header_type header;
+        header.magic = mapped_map_file::magic;
+        header.version = mapped_map_file::version;
+        header.layout = mapped_map_file::HASHED;
+        header.type_id = mapped_map_file::get_type_id<mapped_hash_map>();
+        header.value_size = sizeof(value_type);
+        header.count = input.size();
+        header.capacity = capacity;
+        header.data_offset = sizeof(mapped_map_file::header_type);
+
+        // slot size is a multiple of 8 in practice, but pad so the bits are aligned regardless.
+        size_t slot_bytes = capacity * sizeof(value_type);
+        ::std::vector<unsigned char> pad((8 - (slot_bytes & 7)) & 7, 0);
+
+        mapped_map_file::write(filename, header,
+            { ::std::make_pair(static_cast<const void*>(slots.data()), slot_bytes),
+              ::std::make_pair(static_cast<const void*>(pad.data()), pad.size()),
+              ::std::make_pair(static_cast<const void*>(bits.data()), bits.size() * sizeof(uint64_t)) });
+      }
+
+      /// map a hash map file.
+      explicit mapped_hash_map(::std::string const & filename) :
+        file(filename, mapped_map_file::HASHED, mapped_map_file::get_type_id<mapped_hash_map>(), sizeof(value_type)) {
+        auto const & header = file.header();
+
+        size_t slot_bytes = header.capacity * sizeof(value_type);
+        size_t bits_offset = header.data_offset + ((slot_bytes + 7) & ~(static_cast<size_t>(7)));
+
+        slots = reinterpret_cast<const_iterator>(file.at(header.data_offset));
+        occupied = reinterpret_cast<uint64_t const *>(file.at(bits_offset));
+        mask = header.capacity - 1;
+        count_ = header.count;
+      }
+
+      size_t size() const { return count_; }
+      bool empty() const { return count_ == 0; }
+      size_t capacity() const { return mask + 1; }
+
+      /// find the first element with key k.  nullptr if not found.
+      const_iterator find(Key const & k) const {
+        size_t i = mix(hash(k)) & mask;
+        while (is_occupied(i)) {
+          if (eq(slots[i].first, k)) return slots + i;
+          i = (i + 1) & mask;
+        }
+        return nullptr;
+      }
+
+      size_t count(Key const & k) const {
+        size_t c = 0;
+        size_t i = mix(hash(k)) & mask;
+        while (is_occupied(i)) {
+          if (eq(slots[i].first, k)) ++c;
+          i = (i + 1) & mask;
+        }
+        return c;
+      }
+
+      /// copy all elements with key k to output.  returns number of elements found.
+      template <typename OutputIter>
+      size_t find(Key const & k, OutputIter output) const {
+        size_t c = 0;
+        size_t i = mix(hash(k)) & mask;
+        while (is_occupied(i)) {
+          if (eq(slots[i].first, k)) {
+            *output = slots[i];
+            ++output;
+            ++c;
+          }
+          i = (i + 1) & mask;
+        }
+        return c;
+      }
+
+      /// copy all elements to a vector.
+      void to_vector(::std::vector<value_type> & result) const {
+        result.clear();
+        result.reserve(count_);
+        for (size_t i = 0; i <= mask; ++i) {
+          if (is_occupied(i)) result.emplace_back(slots[i]);
+        }
+      }
+  };
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_MAPPED_MAP_HPP_ */
@@ -0,0 +1,272 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mphf_map.hpp
+ * @ingroup fsc::containers
+ * @brief   static map over a fixed key set, via a minimal perfect hash function (BBHash style), a dense value array and key fingerprints.
+ * @details the minimal perfect hash is a cascade of bit arrays.  at level l, each remaining key is hashed to a position in a
+ *          bit array of gamma * (number of remaining keys) bits.  positions hit by exactly 1 key are set, and the colliding
+ *          keys go to the next level.  the index of a key is the rank of its set bit over the concatenated levels, so the
+ *          n keys map to [0, n).  keys left after the last level are kept in a small fallback table, with the keys
+ *          themselves, so that keys with the same 64 bit hash, which collide at every level, are told apart.
+ *
+ *          the bit arrays are stored in 64 byte blocks of 1 rank word and 7 bit words, so that the bit test and the rank are
+ *          in 1 cache line.  most keys are placed at level 0, i.e. a query touches 1 line of the hash, then 1 slot of the
+ *          (fingerprint, value) array.  with gamma = 2, the hash uses about 3.7 bits per key including the rank words.
+ *
+ *          keys are not stored.  a fingerprint of the key's hash rejects most keys not in the set, but absent keys are
+ *          reported as present with probability 2^-(bits of Fingerprint).  queries for keys in the set are always exact.
+ *          the map cannot be modified after construction.
+ */
+#ifndef MPHF_MAP_HPP_
+#define MPHF_MAP_HPP_
+
+#include <vector>
+#include <utility>   // pair
+#include <functional>  // equal_to
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>     // ceil
+#include <type_traits>
+
+namespace fsc {  // fast standard container
+
+  namespace mphf {
+
+    /// 64 bit finalizer (murmur3), to derive level and fingerprint hashes from the key's hash.
+    inline uint64_t mix(uint64_t h) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+    /// bits per block, after the rank word.
+    static constexpr size_t block_bits = 7 * 64;
+
+  }
+
+  /**
+   * @brief static key to value map over a fixed set of unique keys.
+   * @tparam Hash         full 64 bit hash of the key, e.g. the transformed storage hash of a distributed map.
+   * @tparam Fingerprint  unsigned integer type of the key fingerprints.  uint8_t or uint16_t.
+   */
+  template <typename Key, typename T, typename Hash, typename Fingerprint = uint16_t>
+  class mphf_map {
+      static_assert(::std::is_unsigned<Fingerprint>::value, "fingerprint type has to be unsigned");
+
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using size_type = size_t;
+
+      /// gamma, i.e. bits per remaining key at each level.
+      static constexpr double gamma = 2.0;
+      /// levels before falling back to the table.
+      static constexpr size_t max_levels = 32;
+
+    protected:
+      struct slot {
+          Fingerprint fp;
+          T value;
+      };
+
+      /// an input entry, with its hash.  the key is kept for the fallback table.
+      struct entry {
+          uint64_t h;
+          Key key;
+          T value;
+      };
+
+      Hash hasher;
+
+      /// blocks of 1 rank word and 7 bit words.
+      ::std::vector<uint64_t> blocks;
+      /// start of each level in the concatenated bit array, and its size.
+      ::std::vector<size_t> level_offsets;
+      ::std::vector<size_t> level_sizes;
+      ::std::vector<slot> slots;
+      /// (hash, key) of the keys left after the last level, sorted by hash.  their slots follow those of the placed keys.
+      ::std::vector<::std::pair<uint64_t, Key> > fallback;
+
+      static inline Fingerprint fingerprint(uint64_t const & h) {
+        return static_cast<Fingerprint>(mphf::mix(h ^ 0x9e3779b97f4a7c15ULL));
+      }
+      static inline uint64_t level_hash(uint64_t const & h, size_t const & level) {
+        return mphf::mix(h + (level + 1) * 0xbf58476d1ce4e5b9ULL);
+      }
+
+      inline bool test(size_t const & pos) const {
+        return (blocks[(pos / mphf::block_bits) * 8 + 1 + (pos % mphf::block_bits) / 64] >> (pos & 63)) & 1ULL;
+      }
+      /// number of set bits before pos.
+      inline size_t rank(size_t const & pos) const {
+        uint64_t const * b = blocks.data() + (pos / mphf::block_bits) * 8;
+        size_t off = pos % mphf::block_bits;
+        size_t r = b[0];
+        size_t w = off / 64;
+        for (size_t i = 0; i < w; ++i) r += __builtin_popcountll(b[1 + i]);
+        return r + __builtin_popcountll(b[1 + w] & ((1ULL << (off & 63)) - 1));
+      }
+
+      /// index of the key with hash h, or size() if not placed.  the key is compared only in the fallback table.
+      inline size_t index(Key const & key, uint64_t const & h) const {
+        for (size_t l = 0; l < level_sizes.size(); ++l) {
+          size_t pos = level_offsets[l] + level_hash(h, l) % level_sizes[l];
+          if (test(pos)) return rank(pos);
+        }
+        if (fallback.empty()) return slots.size();
+        auto it = ::std::lower_bound(fallback.begin(), fallback.end(), h,
+                                     [](::std::pair<uint64_t, Key> const & x, uint64_t const & y) { return x.first < y; });
+        ::std::equal_to<Key> eq;
+        for (; (it != fallback.end()) && (it->first == h); ++it) {
+          if (eq(it->second, key)) return slots.size() - fallback.size() + (it - fallback.begin());
+        }
+        return slots.size();
+      }
+
+    public:
+      mphf_map() {}
+
+      /// build from (key, value) entries with unique keys.
+      template <typename Iter>
+      mphf_map(Iter first, Iter last) {
+        size_t n = ::std::distance(first, last);
+
+        // the remaining keys.
+        ::std::vector<entry> remaining;
+        remaining.reserve(n);
+        for (; first != last; ++first) remaining.emplace_back(entry{hasher((*first).first), (*first).first, (*first).second});
+
+        // placed entries:  (global bit position, hash, value).  indices are assigned after the ranks are known.
+        ::std::vector<::std::pair<size_t, ::std::pair<uint64_t, T> > > placed;
+        placed.reserve(n);
+
+        ::std::vector<uint64_t> bits;
+        ::std::vector<uint64_t> collide;
+        ::std::vector<entry> next;
+        size_t offset = 0;
+        for (size_t l = 0; (l < max_levels) && !remaining.empty(); ++l) {
+          size_t m = ::std::max(static_cast<size_t>(64), static_cast<size_t>(::std::ceil(gamma * static_cast<double>(remaining.size()))));
+          m = (m + 63) & ~static_cast<size_t>(63);
+          bits.assign(m / 64, 0);
+          collide.assign(m / 64, 0);
+
+          for (auto const & x : remaining) {
+            size_t p = level_hash(x.h, l) % m;
+            uint64_t bit = 1ULL << (p & 63);
+            if (bits[p / 64] & bit) collide[p / 64] |= bit;
+            else bits[p / 64] |= bit;
+          }
+
+          next.clear();
+          for (auto const & x : remaining) {
+            size_t p = level_hash(x.h, l) % m;
+            if (collide[p / 64] & (1ULL << (p & 63))) next.emplace_back(x);
+            else placed.emplace_back(offset + p, ::std::make_pair(x.h, x.value));
+          }
+          for (size_t i = 0; i < bits.size(); ++i) bits[i] &= ~collide[i];
+
+          // append the level's bits to the blocked array.
+          size_t total = offset + m;
+          blocks.resize(((total + mphf::block_bits - 1) / mphf::block_bits) * 8, 0);
+          for (size_t i = 0; i < m; ++i) {
+            if ((bits[i / 64] >> (i & 63)) & 1ULL) {
+              size_t pos = offset + i;
+              blocks[(pos / mphf::block_bits) * 8 + 1 + (pos % mphf::block_bits) / 64] |= 1ULL << (pos & 63);
+            }
+          }
+          level_offsets.emplace_back(offset);
+          level_sizes.emplace_back(m);
+          offset = total;
+          remaining.swap(next);
+        }
+
+        // rank words.
+        size_t r = 0;
+        for (size_t b = 0; b < blocks.size(); b += 8) {
+          blocks[b] = r;
+          for (size_t i = 1; i < 8; ++i) r += __builtin_popcountll(blocks[b + i]);
+        }
+
+        slots.resize(n);
+        for (auto const & x : placed) {
+          slots[rank(x.first)] = slot{fingerprint(x.second.first), x.second.second};
+        }
+        // keys with the same hash are all kept, and found by comparing the keys.
+        ::std::sort(remaining.begin(), remaining.end(), [](entry const & x, entry const & y) { return x.h < y.h; });
+        size_t idx = placed.size();
+        fallback.reserve(remaining.size());
+        for (auto const & x : remaining) {
+          fallback.emplace_back(x.h, x.key);
+          slots[idx++] = slot{fingerprint(x.h), x.value};
+        }
+      }
+
+      void swap(mphf_map & other) {
+        ::std::swap(hasher, other.hasher);
+        blocks.swap(other.blocks);
+        level_offsets.swap(other.level_offsets);
+        level_sizes.swap(other.level_sizes);
+        slots.swap(other.slots);
+        fallback.swap(other.fallback);
+      }
+
+      size_t size() const {
+        return slots.size();
+      }
+      bool empty() const {
+        return slots.empty();
+      }
+
+      /// pointer to the value of key, or nullptr if the key is not in the set.  may return a value for an absent key, see fingerprint.
+      T const * find(Key const & key) const {
+        uint64_t h = hasher(key);
+        size_t i = index(key, h);
+        if ((i >= slots.size()) || (slots[i].fp != fingerprint(h))) return nullptr;
+        return &(slots[i].value);
+      }
+
+      size_t count(Key const & key) const {
+        return (find(key) == nullptr) ? 0 : 1;
+      }
+
+      /// bytes used by the hash function, excluding the values and fingerprints.
+      size_t hash_bytes() const {
+        return blocks.size() * sizeof(uint64_t) + fallback.size() * sizeof(::std::pair<uint64_t, Key>);
+      }
+      /// total bytes.
+      size_t bytes() const {
+        return hash_bytes() + slots.size() * sizeof(slot);
+      }
+      size_t levels() const {
+        return level_sizes.size();
+      }
+  };
+
+  template <typename Key, typename T, typename Hash, typename Fingerprint>
+  constexpr double mphf_map<Key, T, Hash, Fingerprint>::gamma;
+  template <typename Key, typename T, typename Hash, typename Fingerprint>
+  constexpr size_t mphf_map<Key, T, Hash, Fingerprint>::max_levels;
+
+} // namespace fsc
+
+#endif /* MPHF_MAP_HPP_ */
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    multiway_merge.hpp
+ * @ingroup fsc::containers
+ * @brief   stable merge of k sorted runs with a loser tree, out of place with OpenMP threads, or in place in blocks.
+ * @details  the loser tree takes log k comparisons per element.  ties take the element of the run with the lower
+ *          index, so the merge is stable when the runs are in input order, e.g. by source rank after an all2allv.
+ *
+ *          multiway_merge moves the runs into an output range.  with threads, the output is cut at T-1 pivots taken
+ *          from the longest run, and each thread merges its part of every run independently.
+ *
+ *          block_multiway_merge merges runs that start at multiples of a block size B within 1 vector, using k
+ *          extra blocks instead of a buffer the size of the data:  merged elements go to blocks whose elements have
+ *          all been consumed, and the blocks are put in order at the end.
+ */
+#ifndef MULTIWAY_MERGE_HPP_
+#define MULTIWAY_MERGE_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <iterator>   // distance, make_move_iterator
+#include <utility>    // pair, move
+
+#include "containers/radix_sort.hpp"   // radix_sort_threads
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief tournament tree over k sorted runs [first, last), which stores the loser at each internal node.
+   * @details  pop moves the front of the winning run forward and replays its path to the root, so each element
+   *          costs log k comparisons against the stored losers.
+   */
+  template <typename Iter, typename Comparator>
+  class loser_tree {
+    protected:
+      ::std::vector<::std::pair<Iter, Iter> > runs;
+      /// [0] is the winner, [1, K) the losers of the internal nodes.  leaves are runs, padded with empty ones to K.
+      ::std::vector<size_t> tree;
+      size_t K;
+      Comparator comp;
+
+      /// run a's front precedes run b's.  empty runs lose, ties go to the lower run.
+      inline bool before(size_t const & a, size_t const & b) const {
+        if ((a >= runs.size()) || (runs[a].first == runs[a].second)) return false;
+        if ((b >= runs.size()) || (runs[b].first == runs[b].second)) return true;
+        if (comp(*(runs[a].first), *(runs[b].first))) return true;
+        if (comp(*(runs[b].first), *(runs[a].first))) return false;
+        return a < b;
+      }
+
+    public:
+      loser_tree(::std::vector<::std::pair<Iter, Iter> > const & _runs, Comparator const & _comp = Comparator()) :
+        runs(_runs), K(1), comp(_comp) {
+        while (K < runs.size()) K <<= 1;
+        tree.resize(K);
+
+        // winners of the subtrees, bottom up.  the losers stay in the nodes.
+        ::std::vector<size_t> win(2 * K);
+        for (size_t i = 0; i < K; ++i) win[K + i] = i;
+        for (size_t n = K - 1; n > 0; --n) {
+          size_t l = win[2 * n], r = win[2 * n + 1];
+          if (before(r, l)) { win[n] = r; tree[n] = l; }
+          else { win[n] = l; tree[n] = r; }
+        }
+        tree[0] = (K == 1) ? 0 : win[1];
+      }
+
+      bool empty() const {
+        return (tree[0] >= runs.size()) || (runs[tree[0]].first == runs[tree[0]].second);
+      }
+
+      /// run of the next element.
+      size_t top() const { return tree[0]; }
+
+      /// iterator to the next element, which is then consumed.
+      Iter pop() {
+        size_t w = tree[0];
+        Iter it = runs[w].first;
+        ++(runs[w].first);
+        for (size_t n = (w + K) >> 1; n > 0; n >>= 1) {
+          if (before(tree[n], w)) ::std::swap(tree[n], w);
+        }
+        tree[0] = w;
+        return it;
+      }
+
+      /// remaining elements of each run.
+      ::std::vector<::std::pair<Iter, Iter> > const & get_runs() const { return runs; }
+  };
+
+
+  namespace local {
+
+    /// move the runs into out, sequentially.
+    template <typename Iter, typename OutIter, typename Comparator>
+    OutIter multiway_merge(::std::vector<::std::pair<Iter, Iter> > const & runs, OutIter out, Comparator const & comp) {
+      loser_tree<Iter, Comparator> tree(runs, comp);
+      while (!tree.empty()) {
+        *out = ::std::move(*(tree.pop()));
+        ++out;
+      }
+      return out;
+    }
+
+  }
+
+  /**
+   * @brief merge the sorted runs into out, by moving.  stable, with ties in run order.
+   * @param out       random access, with room for all elements of the runs.
+   * @param nthreads  number of threads.  0 means omp_get_max_threads().  a thread gets at least 64K elements.
+   * @return end of the output.
+   */
+  template <typename Iter, typename OutIter, typename Comparator>
+  OutIter multiway_merge(::std::vector<::std::pair<Iter, Iter> > const & runs, OutIter out, Comparator const & comp,
+                         int nthreads = 0) {
+    size_t n = 0;
+    size_t longest = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      size_t len = ::std::distance(runs[i].first, runs[i].second);
+      n += len;
+      if (len > static_cast<size_t>(::std::distance(runs[longest].first, runs[longest].second))) longest = i;
+    }
+    if (n == 0) return out;
+
+    int const T = ::std::max(1, ::std::min(local::radix_sort_threads(nthreads), static_cast<int>(n >> 16)));
+    if (T == 1) return local::multiway_merge(runs, out, comp);
+
+    // T-1 pivots from the longest run.  every run is cut before its first element not less than the pivot, so
+    // equal elements stay in 1 part and the merge stays stable.
+    size_t len = ::std::distance(runs[longest].first, runs[longest].second);
+    ::std::vector<::std::vector<Iter> > cuts(T + 1, ::std::vector<Iter>(runs.size()));
+    ::std::vector<size_t> offsets(T + 1, 0);
+    for (size_t i = 0; i < runs.size(); ++i) {
+      cuts[0][i] = runs[i].first;
+      cuts[T][i] = runs[i].second;
+    }
+    for (int t = 1; t < T; ++t) {
+      auto const & pivot = *(runs[longest].first + (len * t) / T);
+      for (size_t i = 0; i < runs.size(); ++i) {
+        // pivots do not decrease, so the cuts do not either.
+        cuts[t][i] = ::std::lower_bound(cuts[t - 1][i], runs[i].second, pivot, comp);
+        offsets[t] += ::std::distance(runs[i].first, cuts[t][i]);
+      }
+    }
+    offsets[T] = n;
+
+#pragma omp parallel for num_threads(T) schedule(dynamic, 1)
+    for (int t = 0; t < T; ++t) {
+      ::std::vector<::std::pair<Iter, Iter> > part(runs.size());
+      for (size_t i = 0; i < runs.size(); ++i) part[i] = ::std::make_pair(cuts[t][i], cuts[t + 1][i]);
+      local::multiway_merge(part, out + offsets[t], comp);
+    }
+
+    return out + n;
+  }
+
+
+  /// size of the storage for block_multiway_merge of runs of the given sizes, runs starting at multiples of block.
+  inline size_t block_merge_storage(::std::vector<size_t> const & counts, size_t const & block,
+                                    ::std::vector<size_t> & displs) {
+    displs.resize(counts.size());
+    size_t pos = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+      displs[i] = pos;
+      pos += ((counts[i] + block - 1) / block) * block;
+    }
+    // k free blocks, so that a block is always free for the output.
+    return pos + counts.size() * block;
+  }
+
+  /**
+   * @brief merge the sorted runs of data in place, with a memory overhead of about 2 k blocks.  stable.
+   * @details  run i is data[displs[i], displs[i] + counts[i]), with displs from block_merge_storage and data sized to
+   *          its return value.  data is resized to the total element count.
+   *          elements are only moved, so an element of a run that is merged is never overwritten before it is read.
+   */
+  template <typename V, typename A, typename Comparator>
+  void block_multiway_merge(::std::vector<V, A> & data, ::std::vector<size_t> const & counts,
+                            ::std::vector<size_t> const & displs, size_t const & block, Comparator const & comp) {
+    typedef typename ::std::vector<V, A>::iterator Iter;
+    size_t const k = counts.size();
+    size_t n = 0;
+    for (size_t i = 0; i < k; ++i) n += counts[i];
+
+    // the free blocks:  the k extra blocks at the end, then each block whose elements are all consumed.
+    ::std::vector<size_t> free_blocks;
+    for (size_t b = data.size() / block; b > data.size() / block - k; --b) free_blocks.push_back(b - 1);
+
+    ::std::vector<::std::pair<Iter, Iter> > runs(k);
+    for (size_t i = 0; i < k; ++i) runs[i] = ::std::make_pair(data.begin() + displs[i], data.begin() + displs[i] + counts[i]);
+    ::std::vector<size_t> consumed(k, 0);
+
+    // output block of logical block j.
+    ::std::vector<size_t> phys;
+    phys.reserve((n + block - 1) / block);
+    size_t fill = block;
+
+    loser_tree<Iter, Comparator> tree(runs, comp);
+    while (!tree.empty()) {
+      if (fill == block) {
+        phys.push_back(free_blocks.back());
+        free_blocks.pop_back();
+        fill = 0;
+      }
+      size_t r = tree.top();
+      data[phys.back() * block + fill] = ::std::move(*(tree.pop()));
+      ++fill;
+
+      size_t c = ++(consumed[r]);
+      if (((c % block) == 0) || (c == counts[r])) free_blocks.push_back((displs[r] + c - 1) / block);
+    }
+
+    // put the logical blocks in place.  first the chains that start at a block holding no output, which end outside
+    // the output, then the cycles, through 1 block of temporary storage.
+    size_t const L = phys.size();
+    ::std::vector<size_t> owner(data.size() / block, L);  // logical block held by each block, L if none.
+    for (size_t j = 0; j < L; ++j) owner[phys[j]] = j;
+
+    auto move_block = [&data, &block](size_t const & from, size_t const & to) {
+      ::std::move(data.begin() + from * block, data.begin() + (from + 1) * block, data.begin() + to * block);
+    };
+
+    for (size_t j = 0; j < L; ++j) {
+      if ((owner[j] != L) || (phys[j] == j)) continue;
+      size_t hole = j;
+      while (hole < L) {
+        size_t from = phys[hole];
+        move_block(from, hole);
+        phys[hole] = hole;
+        owner[hole] = hole;
+        hole = from;
+      }
+    }
+
+    ::std::vector<V, A> tmp;
+    for (size_t j = 0; j < L; ++j) {
+      if (phys[j] == j) continue;
+      if (tmp.empty()) tmp.resize(block);
+      ::std::move(data.begin() + j * block, data.begin() + (j + 1) * block, tmp.begin());
+      size_t hole = j;
+      while (phys[hole] != j) {
+        size_t from = phys[hole];
+        move_block(from, hole);
+        phys[hole] = hole;
+        hole = from;
+      }
+      ::std::move(tmp.begin(), tmp.end(), data.begin() + hole * block);
+      phys[hole] = hole;
+    }
+
+    data.resize(n);
+  }
+
+} // namespace fsc
+
+#endif /* MULTIWAY_MERGE_HPP_ */
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    node_shared_map.hpp
+ * @ingroup index
+ * @brief   read-only distributed multimap with one copy of the index per node, in MPI-3 shared memory.
+ * @details  the distributed maps keep a private partition on each rank.  for a read-mostly reference index, a node with many
+ *          ranks then holds as many tables and communication buffers, and queries are shuffled between ranks on the same node.
+ *
+ *          here the entries are partitioned by node.  each node's entries are stored once, sorted, in a window from
+ *          MPI_Win_allocate_shared, and every rank on the node can search all of them.  queries are routed to a node, to the
+ *          rank with the same local rank as the sender, so the ranks of a node share the query load and there is no intra-node shuffle.
+ *          with a uniform number of ranks per node, routing uses the cross node communicator of node_aware_comm.
+ *
+ *          build: entries are sent to their node, each rank copies and sorts its part of the window, then the sorted parts are
+ *          merged pairwise in log(local ranks) rounds.
+ *
+ *          Key and T need to be bitwise copyable, as the entries are placed in the window with memcpy semantics.
+ *          the map is static after build().  build() and the destructor are collective on the communicator.
+ */
+#ifndef BLISS_NODE_SHARED_MAP_HPP
+#define BLISS_NODE_SHARED_MAP_HPP
+
+#include <vector>
+#include <utility>     // pair
+#include <functional>  // hash, less
+#include <algorithm>   // sort, inplace_merge, equal_range
+#include <numeric>     // partial_sum
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "utils/benchmark_utils.hpp"
+#include "io/incremental_mxx.hpp"
+
+namespace dsc  // distributed std container
+{
+
+  /**
+   * @brief node shared, sorted, read-only multimap.
+   * @tparam Hash   hash functor on Key, used to assign keys to nodes.
+   * @tparam Less   comparator on Key, for the sorted storage.
+   */
+  template <typename Key, typename T, typename Hash = ::std::hash<Key>, typename Less = ::std::less<Key> >
+  class node_shared_map {
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<Key, T>;
+
+    protected:
+      /// compare entries by key only, so equal_range works on keys.
+      struct KeyLess {
+          Less l;
+          inline bool operator()(value_type const & x, value_type const & y) const { return l(x.first, y.first); }
+          inline bool operator()(value_type const & x, Key const & y) const { return l(x.first, y); }
+          inline bool operator()(Key const & x, value_type const & y) const { return l(x, y.first); }
+      };
+
+      ::imxx::node_aware_comm hc;
+      Hash hash;
+      KeyLess less;
+
+      /// global ranks on each node, ordered by local rank.  used for routing when ranks per node differ.
+      ::std::vector<::std::vector<int> > node_ranks;
+      int local_rank;
+
+      MPI_Win win;
+      bool allocated;
+      /// start of the node's sorted entries, in the shared window.
+      value_type const * data;
+      /// entries on this node.
+      size_t n;
+
+      /// communicator used for routing: one rank per node.
+      ::mxx::comm const & routing_comm() const {
+        return hc.uniform() ? hc.cross : hc.global;
+      }
+
+      /// destination of a key, as a rank in routing_comm().
+      inline int route(Key const & k) const {
+        int node = hash(k) % hc.num_nodes();
+        if (hc.uniform()) return node;
+        auto const & ranks = node_ranks[node];
+        return ranks[local_rank % ranks.size()];
+      }
+
+      /// make the window contents written by the local ranks visible to each other.
+      void sync() const {
+        MPI_Win_sync(win);
+        MPI_Barrier(hc.local);
+        MPI_Win_sync(win);
+      }
+
+      void release() {
+        if (allocated) {
+          MPI_Win_unlock_all(win);
+          MPI_Win_free(&win);
+        }
+        allocated = false;
+        data = nullptr;
+        n = 0;
+      }
+
+    public:
+      node_shared_map(::mxx::comm const & _comm) : hc(_comm), allocated(false), data(nullptr), n(0) {
+        local_rank = hc.local.rank();
+        node_ranks.resize(hc.num_nodes());
+        for (int i = 0; i < hc.global.size(); ++i) {
+          node_ranks[hc.node_of[i]].emplace_back(i);   // global ranks are in increasing order, and so are the local ranks.
+        }
+      }
+
+      // the window cannot be copied.
+      node_shared_map(node_shared_map const & other) = delete;
+      node_shared_map & operator=(node_shared_map const & other) = delete;
+
+      /// collective.  frees the shared window.
+      virtual ~node_shared_map() {
+        release();
+      }
+
+      /// number of entries stored on this node.
+      size_t local_size() const {
+        return n;
+      }
+
+      /// number of entries across all nodes.  collective.
+      size_t size() const {
+        size_t s = (hc.local.rank() == 0) ? n : 0;
+        return ::mxx::allreduce(s, hc.global);
+      }
+
+      /// entries stored on this node, sorted by key.
+      ::std::pair<value_type const *, value_type const *> local_range() const {
+        return ::std::make_pair(data, data + n);
+      }
+
+      /**
+       * @brief build the index from entries on every rank, e.g. the to_vector() of a distributed map.  replaces current content.  collective.
+       */
+      void build(::std::vector<value_type> const & entries) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        release();
+
+        // send entries to their nodes.
+        ::std::vector<value_type> input(entries);
+        ::std::vector<value_type> mine;
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::imxx::distribute(input, [this](value_type const & x) { return this->route(x.first); },
+                           recv_counts, i2o, mine, routing_comm(), false);
+        ::std::vector<value_type>().swap(input);
+        BL_BENCH_END(build, "distribute", mine.size());
+
+        // allocate the window.  the local ranks' segments are contiguous.
+        BL_BENCH_START(build);
+        int L = hc.local.size();
+        int lr = hc.local.rank();
+        value_type * mine_base = nullptr;
+        MPI_Win_allocate_shared(static_cast<MPI_Aint>(mine.size() * sizeof(value_type)), sizeof(value_type),
+                                MPI_INFO_NULL, hc.local, &mine_base, &win);
+        allocated = true;
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+        ::std::vector<size_t> offsets = ::mxx::allgather(mine.size(), hc.local);
+        offsets.insert(offsets.begin(), 0);
+        ::std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        n = offsets[L];
+
+        // locate the start of the window, the segment of the first rank with entries.
+        if (n > 0) {
+          int first = 0;
+          while (offsets[first + 1] == 0) ++first;
+          MPI_Aint seg_size;
+          int disp_unit;
+          value_type * base = nullptr;
+          MPI_Win_shared_query(win, first, &seg_size, &disp_unit, &base);
+          data = base;
+        }
+        BL_BENCH_END(build, "alloc_shared", n);
+
+        // copy and sort own part
+        BL_BENCH_START(build);
+        ::std::copy(mine.begin(), mine.end(), mine_base);
+        ::std::sort(mine_base, mine_base + mine.size(), less);
+        ::std::vector<value_type>().swap(mine);
+        BL_BENCH_END(build, "local_sort", offsets[lr + 1] - offsets[lr]);
+
+        // merge the sorted parts, pairwise.
+        BL_BENCH_START(build);
+        sync();
+        value_type * all = const_cast<value_type *>(data);
+        for (int step = 1; step < L; step <<= 1) {
+          if (((lr % (2 * step)) == 0) && ((lr + step) < L)) {
+            ::std::inplace_merge(all + offsets[lr], all + offsets[lr + step],
+                                 all + offsets[::std::min(L, lr + 2 * step)], less);
+          }
+          sync();
+        }
+        BL_BENCH_END(build, "merge", n);
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "node_shared_map:build", hc.global);
+      }
+
+      /// count for each query key, in the order of keys.  collective.
+      ::std::vector<size_t> count(::std::vector<Key> & keys) const {
+        BL_BENCH_INIT(count);
+
+        BL_BENCH_START(count);
+        ::std::vector<Key> queries;
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::imxx::distribute(keys, [this](Key const & x) { return this->route(x); },
+                           recv_counts, i2o, queries, routing_comm(), true);
+        BL_BENCH_END(count, "distribute", queries.size());
+
+        BL_BENCH_START(count);
+        ::std::vector<size_t> counts(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+          auto r = ::std::equal_range(data, data + n, queries[i], less);
+          counts[i] = ::std::distance(r.first, r.second);
+        }
+        BL_BENCH_END(count, "local_count", counts.size());
+
+        BL_BENCH_START(count);
+        ::std::vector<size_t> results(keys.size(), 0);
+        ::imxx::undistribute(counts, recv_counts, i2o, results, routing_comm(), true);
+        BL_BENCH_END(count, "undistribute", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "node_shared_map:count", hc.global);
+        return results;
+      }
+
+      /// all entries matching the query keys.  duplicate keys are queried once.  collective.
+      ::std::vector<value_type> find(::std::vector<Key> & keys) const {
+        BL_BENCH_INIT(find);
+
+        BL_BENCH_START(find);
+        ::std::sort(keys.begin(), keys.end(), Less());
+        keys.erase(::std::unique(keys.begin(), keys.end(),
+                                 [](Key const & x, Key const & y) { return !Less()(x, y) && !Less()(y, x); }), keys.end());
+        BL_BENCH_END(find, "unique", keys.size());
+
+        BL_BENCH_START(find);
+        ::std::vector<Key> queries;
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::imxx::distribute(keys, [this](Key const & x) { return this->route(x); },
+                           recv_counts, i2o, queries, routing_comm(), false);
+        BL_BENCH_END(find, "distribute", queries.size());
+
+        // answer the queries of each source rank.
+        BL_BENCH_START(find);
+        ::mxx::comm const & rc = routing_comm();
+        ::std::vector<size_t> resp_counts(rc.size(), 0);
+        ::std::vector<value_type> local_results;
+        size_t q = 0;
+        for (int s = 0; s < rc.size() && q < queries.size(); ++s) {
+          for (size_t i = 0; i < recv_counts[s]; ++i, ++q) {
+            auto r = ::std::equal_range(data, data + n, queries[q], less);
+            local_results.insert(local_results.end(), r.first, r.second);
+            resp_counts[s] += ::std::distance(r.first, r.second);
+          }
+        }
+        BL_BENCH_END(find, "local_find", local_results.size());
+
+        BL_BENCH_START(find);
+        ::std::vector<size_t> back_counts(rc.size(), 0);
+        ::mxx::all2all(resp_counts.data(), 1, back_counts.data(), rc);
+        ::std::vector<value_type> results(::std::accumulate(back_counts.begin(), back_counts.end(), static_cast<size_t>(0)));
+        ::mxx::all2allv(local_results.data(), resp_counts, results.data(), back_counts, rc);
+        BL_BENCH_END(find, "a2av", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "node_shared_map:find", hc.global);
+        return results;
+      }
+  };
+
+} // namespace dsc
+
+#endif // BLISS_NODE_SHARED_MAP_HPP
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    parallel_merge.hpp
+ * @ingroup fsc::containers
+ * @brief   stable merge of 2 adjacent sorted ranges of a vector, with OpenMP threads.
+ * @details  the output is cut into equal blocks, 1 per thread.  the start of each block in the 2 inputs is found by a
+ *          binary search along the block's diagonal of the merge matrix (merge path), so the threads merge independently
+ *          into 1 buffer the size of the merged range, which is then moved back.  ties take the element of the first
+ *          range first, as std::inplace_merge does.
+ *          without OpenMP (USE_OPENMP), or for small ranges, this is std::inplace_merge.
+ */
+#ifndef PARALLEL_MERGE_HPP_
+#define PARALLEL_MERGE_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <iterator>   // make_move_iterator
+
+#include "containers/radix_sort.hpp"   // radix_sort_threads
+
+namespace fsc {  // fast standard container
+
+  namespace local {
+
+    /// number of elements from a (sorted, size na) in the first d elements of the stable merge of a and b (size nb).
+    template <typename Iter, typename Comparator>
+    size_t merge_path(Iter a, size_t na, Iter b, size_t nb, size_t d, Comparator const & comp) {
+      size_t lo = (d > nb) ? d - nb : 0;
+      size_t hi = ::std::min(d, na);
+      while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        // a[mid] precedes b[d - mid - 1] unless b is strictly less, then more of a is in the first d.
+        if (comp(*(b + (d - mid - 1)), *(a + mid))) hi = mid;
+        else lo = mid + 1;
+      }
+      return lo;
+    }
+
+  }
+
+  /**
+   * @brief merge the sorted ranges [first, middle) and [middle, end) of data, stably.
+   * @param nthreads  number of threads.  0 means omp_get_max_threads().  a thread gets at least 64K elements.
+   */
+  template <typename V, typename A, typename Comparator>
+  void inplace_merge(::std::vector<V, A> & data, size_t first, size_t middle, Comparator const & comp, int nthreads = 0) {
+    size_t n = data.size() - first;
+    size_t na = middle - first;
+    size_t nb = data.size() - middle;
+    if ((na == 0) || (nb == 0)) return;
+
+    int const T = ::std::max(1, ::std::min(local::radix_sort_threads(nthreads), static_cast<int>(n >> 16)));
+    if (T == 1) {
+      ::std::inplace_merge(data.begin() + first, data.begin() + middle, data.end(), comp);
+      return;
+    }
+
+    auto a = data.begin() + first;
+    auto b = data.begin() + middle;
+    ::std::vector<V, A> buffer(n);
+
+#pragma omp parallel for num_threads(T) schedule(static, 1)
+    for (int t = 0; t < T; ++t) {
+      size_t d0 = (n * t) / T;
+      size_t d1 = (n * (t + 1)) / T;
+      size_t i0 = local::merge_path(a, na, b, nb, d0, comp);
+      size_t i1 = local::merge_path(a, na, b, nb, d1, comp);
+      ::std::merge(::std::make_move_iterator(a + i0), ::std::make_move_iterator(a + i1),
+                   ::std::make_move_iterator(b + (d0 - i0)), ::std::make_move_iterator(b + (d1 - i1)),
+                   buffer.begin() + d0, comp);
+    }
+
+#pragma omp parallel for num_threads(T) schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+      *(a + i) = ::std::move(buffer[i]);
+    }
+  }
+
+} // namespace fsc
+
+#endif /* PARALLEL_MERGE_HPP_ */
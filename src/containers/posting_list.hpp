@@ -0,0 +1,276 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    posting_list.hpp
+ * @ingroup fsc::containers
+ * @brief   delta and byte length coded lists of sorted 64 bit ids, and a read-mostly multimap of them, for position indices.
+ * @details  the positions of a k-mer, as ShortSequenceKmerId or LongSequenceKmerId, are 64 bit ids that are close together
+ *          when sorted, so the deltas mostly fit in 1 or 2 bytes.  each delta is stored in 1, 2, 4, or 8 bytes, given by a
+ *          2 bit code.  the codes of 4 deltas share a control byte, and the control bytes precede the data bytes
+ *          (as in stream vbyte, with 64 bit values).
+ *
+ *          with SSSE3 (__SSSE3__), 2 deltas are decoded per step:  1 unaligned load, 1 pshufb with a mask chosen by the
+ *          2 codes, and a 2 lane prefix sum.  otherwise, or for the last odd delta, bytes are assembled with shifts.
+ *          the data is padded with 16 bytes so the loads do not read past the end.
+ */
+#ifndef POSTING_LIST_HPP_
+#define POSTING_LIST_HPP_
+
+#include <vector>
+#include <utility>        // pair
+#include <unordered_map>
+#include <algorithm>      // sort
+#include <functional>     // hash, equal_to
+#include <type_traits>
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#if defined(__SSSE3__)
+#include <x86intrin.h>
+#endif
+
+#include "common/sequence.hpp"
+
+namespace fsc {  // fast standard container
+
+  /// conversion of a posting value to and from its 64 bit id.  for integral types and the k-mer position ids.
+  template <typename T, typename Enable = void>
+  struct posting_id {
+      static inline uint64_t get(T const & x) { return x.id; }
+      static inline T make(uint64_t const & id) { T x; x.id = id; return x; }
+  };
+  template <typename T>
+  struct posting_id<T, typename ::std::enable_if<::std::is_integral<T>::value>::type> {
+      static inline uint64_t get(T const & x) { return static_cast<uint64_t>(x); }
+      static inline T make(uint64_t const & id) { return static_cast<T>(id); }
+  };
+  template <typename ReadIdType>
+  struct posting_id<::bliss::common::DenseSequenceKmerId<ReadIdType> > {
+      using T = ::bliss::common::DenseSequenceKmerId<ReadIdType>;
+      static inline uint64_t get(T const & x) { return x.get_key(); }
+      static inline T make(uint64_t const & id) { return T::from_key(id); }
+  };
+
+  /**
+   * @brief sorted list of 64 bit ids, delta and byte length coded.
+   */
+  class posting_list {
+    protected:
+      /// control bytes, then data bytes, then padding.
+      ::std::vector<uint8_t> buffer;
+      size_t n;
+
+      static constexpr size_t padding = 16;
+
+      static inline uint8_t code_bytes(uint8_t const & code) {
+        return static_cast<uint8_t>(1) << code;
+      }
+      static inline uint8_t code_of(uint64_t const & x) {
+        return (x < (1UL << 8)) ? 0 : ((x < (1UL << 16)) ? 1 : ((x < (1UL << 32)) ? 2 : 3));
+      }
+      static inline uint64_t read_bytes(uint8_t const * p, uint8_t const & bytes) {
+        uint64_t x = 0;
+        for (uint8_t i = 0; i < bytes; ++i) x |= static_cast<uint64_t>(p[i]) << (8 * i);
+        return x;
+      }
+
+#if defined(__SSSE3__)
+      /// pshufb masks and byte counts for the 16 combinations of 2 codes.
+      struct shuffle_table {
+          uint8_t masks[16][16];
+          uint8_t bytes[16];
+
+          shuffle_table() {
+            for (uint8_t c = 0; c < 16; ++c) {
+              uint8_t b0 = code_bytes(c & 3), b1 = code_bytes(c >> 2);
+              for (uint8_t i = 0; i < 8; ++i) {
+                masks[c][i] = (i < b0) ? i : 0x80;
+                masks[c][8 + i] = (i < b1) ? (b0 + i) : 0x80;
+              }
+              bytes[c] = b0 + b1;
+            }
+          }
+      };
+      static shuffle_table const & get_shuffle_table() {
+        static const shuffle_table table;
+        return table;
+      }
+#endif
+
+    public:
+      posting_list() : n(0) {}
+
+      /// encode sorted ids.
+      void assign(uint64_t const * sorted, size_t const & count) {
+        n = count;
+        size_t ctrl_bytes = (n + 3) / 4;
+        buffer.assign(ctrl_bytes, 0);
+        buffer.reserve(ctrl_bytes + n * 2 + padding);
+
+        uint64_t prev = 0, d;
+        uint8_t code;
+        for (size_t i = 0; i < n; ++i) {
+          d = sorted[i] - prev;
+          prev = sorted[i];
+          code = code_of(d);
+          buffer[i >> 2] |= code << (2 * (i & 3));
+          for (uint8_t b = 0; b < code_bytes(code); ++b) buffer.emplace_back(static_cast<uint8_t>(d >> (8 * b)));
+        }
+        buffer.insert(buffer.end(), padding, 0);
+        buffer.shrink_to_fit();
+      }
+
+      size_t size() const { return n; }
+      bool empty() const { return n == 0; }
+      /// memory used by the coded list.
+      size_t bytes() const { return buffer.size(); }
+
+      /// decode all ids into out, which has room for size() ids.
+      void decode(uint64_t * out) const {
+        if (n == 0) return;
+        uint8_t const * ctrl = buffer.data();
+        uint8_t const * data = ctrl + (n + 3) / 4;
+        uint64_t prev = 0;
+        size_t i = 0;
+
+#if defined(__SSSE3__)
+        shuffle_table const & table = get_shuffle_table();
+        __m128i running = _mm_setzero_si128();
+        __m128i d;
+        uint8_t c;
+        for (; i + 2 <= n; i += 2) {
+          c = (ctrl[i >> 2] >> (2 * (i & 3))) & 0xF;
+          d = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(data)),
+                               _mm_loadu_si128(reinterpret_cast<__m128i const *>(table.masks[c])));
+          data += table.bytes[c];
+          // [d0, d0 + d1] + [prev, prev]
+          d = _mm_add_epi64(d, _mm_slli_si128(d, 8));
+          d = _mm_add_epi64(d, running);
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), d);
+          running = _mm_shuffle_epi32(d, 0xEE);
+        }
+        if (i > 0) prev = out[i - 1];
+#endif
+
+        uint8_t bytes;
+        for (; i < n; ++i) {
+          bytes = code_bytes((ctrl[i >> 2] >> (2 * (i & 3))) & 3);
+          prev += read_bytes(data, bytes);
+          data += bytes;
+          out[i] = prev;
+        }
+      }
+
+      ::std::vector<uint64_t> decode() const {
+        ::std::vector<uint64_t> result(n);
+        decode(result.data());
+        return result;
+      }
+  };
+
+
+  /**
+   * @brief multimap from keys to sorted lists of values, each list coded as a posting_list.
+   * @details  for the query phase of a position index:  the values of a key are inserted in batches and coded once per
+   *        batch, and find decodes a key's whole list.  values are returned in id order, and ids that are the same
+   *        are kept.
+   * @tparam T  a value with a 64 bit id, see posting_id.
+   */
+  template <typename Key, typename T, typename Hash = ::std::hash<Key>, typename Equal = ::std::equal_to<Key> >
+  class posting_map {
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using value_type = ::std::pair<Key, T>;
+
+    protected:
+      ::std::unordered_map<Key, posting_list, Hash, Equal> lists;
+      size_t s;
+
+    public:
+      posting_map() : s(0) {}
+
+      /// add entries.  the lists of the keys in input are decoded, merged with the new values, and coded again.
+      void insert(::std::vector<value_type> const & input) {
+        ::std::unordered_map<Key, ::std::vector<uint64_t>, Hash, Equal> grouped;
+        for (auto const & x : input) grouped[x.first].emplace_back(posting_id<T>::get(x.second));
+
+        for (auto & g : grouped) {
+          posting_list & pl = lists[g.first];
+          if (!pl.empty()) {
+            size_t before = g.second.size();
+            g.second.resize(before + pl.size());
+            pl.decode(g.second.data() + before);
+            s -= pl.size();
+          }
+          ::std::sort(g.second.begin(), g.second.end());
+          pl.assign(g.second.data(), g.second.size());
+          s += pl.size();
+          ::std::vector<uint64_t>().swap(g.second);
+        }
+      }
+
+      size_t size() const { return s; }
+      size_t unique_size() const { return lists.size(); }
+      bool empty() const { return s == 0; }
+
+      /// memory used by the coded lists.
+      size_t bytes() const {
+        size_t b = 0;
+        for (auto const & l : lists) b += sizeof(Key) + sizeof(posting_list) + l.second.bytes();
+        return b;
+      }
+
+      size_t count(Key const & k) const {
+        auto it = lists.find(k);
+        return (it == lists.end()) ? 0 : it->second.size();
+      }
+
+      /// append the entries of k to output, in id order.  returns the number appended.
+      size_t find(Key const & k, ::std::vector<value_type> & output) const {
+        auto it = lists.find(k);
+        if (it == lists.end()) return 0;
+
+        ::std::vector<uint64_t> ids = it->second.decode();
+        output.reserve(output.size() + ids.size());
+        for (auto id : ids) output.emplace_back(k, posting_id<T>::make(id));
+        return ids.size();
+      }
+
+      /// the entries of all keys, grouped by key.
+      ::std::vector<value_type> find(::std::vector<Key> const & keys) const {
+        ::std::vector<value_type> results;
+        for (auto const & k : keys) find(k, results);
+        return results;
+      }
+
+      void erase(Key const & k) {
+        auto it = lists.find(k);
+        if (it == lists.end()) return;
+        s -= it->second.size();
+        lists.erase(it);
+      }
+
+      void clear() {
+        lists.clear();
+        s = 0;
+      }
+  };
+
+} // namespace fsc
+
+#endif /* POSTING_LIST_HPP_ */
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    radix_sort.hpp
+ * @ingroup fsc::containers
+ * @brief   LSD radix sort on the packed words of Kmer keys, for Kmer and std::pair<Kmer, T> vectors.
+ * @details  Kmer::operator< compares the words as 1 little endian integer, so sorting by the bytes of the packed words,
+ *          least significant first, gives the same order.  each pass sorts on 1 byte (256 buckets, so the histograms and the
+ *          write positions stay in L1 cache), and is stable.  passes on a byte that is the same for all elements are
+ *          skipped, e.g. the high bytes when all keys share a prefix, as they often do within a partition.
+ *
+ *          with threads, each thread has a contiguous block of the input, and its own histogram for each pass.  the
+ *          prefix sum is digit major, thread minor, so the scatter keeps the sort stable.
+ *          uses 1 buffer the size of the input.  without OpenMP (USE_OPENMP), runs in the calling thread.
+ */
+#ifndef RADIX_SORT_HPP_
+#define RADIX_SORT_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <type_traits>
+#include <functional>   // less
+#include <algorithm>
+#include <cstdint>
+
+#if defined(USE_OPENMP)
+#include "omp.h"
+#endif
+
+#include "common/kmer.hpp"
+#include "utils/transform_utils.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+namespace fsc {  // fast standard container
+
+  /// true if the comparator orders keys by Kmer::operator< after a transform, i.e. the order radix_sort produces.  transform_type is the transform.
+  template <typename Comparator>
+  struct is_radix_sortable : public ::std::false_type {};
+  template <typename Key, template <typename> class Transform>
+  struct is_radix_sortable<::fsc::TransformedComparator<Key, ::std::less, Transform> > :
+    public ::std::integral_constant<bool, ::bliss::common::is_kmer<Key>::value> {
+      using transform_type = Transform<Key>;
+      using key_type = Key;
+  };
+
+  namespace local {
+
+    /// 0 means omp_get_max_threads().  1 without OpenMP.
+    inline int radix_sort_threads(int nthreads) {
+#if defined(USE_OPENMP)
+      return (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    template <typename Kmer>
+    inline Kmer const & radix_key(Kmer const & x) { return x; }
+    template <typename Kmer, typename T>
+    inline Kmer const & radix_key(::std::pair<Kmer, T> const & x) { return x.first; }
+
+  }
+
+  /**
+   * @brief sort vector of Kmer or std::pair<Kmer, T> by Kmer::operator< on the key.  stable.
+   * @param nthreads  number of threads.  0 means omp_get_max_threads().  a thread gets at least 64K elements.
+   */
+  template <typename V, typename A>
+  void radix_sort(::std::vector<V, A> & data, int nthreads = 0) {
+    using Kmer = typename ::std::decay<decltype(local::radix_key(::std::declval<V const &>()))>::type;
+    static_assert(::bliss::common::is_kmer<Kmer>::value, "radix_sort requires Kmer keys");
+
+    // bytes in use in the packed words.  the rest is 0.
+    constexpr size_t key_bytes = Kmer::nBytes;
+    constexpr size_t radix = 256;
+
+    size_t const n = data.size();
+    if (n < 2) return;
+
+    int const T = ::std::max(1, ::std::min(local::radix_sort_threads(nthreads), static_cast<int>(n >> 16)));
+    size_t const block = (n + T - 1) / T;
+
+    ::std::vector<V, A> buffer(n);
+    V * src = data.data();
+    V * dst = buffer.data();
+    ::std::vector<size_t> counts(T * radix);  // thread major
+
+    for (size_t b = 0; b < key_bytes; ++b) {
+      ::std::fill(counts.begin(), counts.end(), 0);
+
+      // per thread histograms
+#pragma omp parallel for num_threads(T) schedule(static, 1)
+      for (int t = 0; t < T; ++t) {
+        size_t * cnt = counts.data() + t * radix;
+        for (size_t i = t * block, max = ::std::min(n, (t + 1) * block); i < max; ++i) {
+          ++cnt[reinterpret_cast<uint8_t const *>(local::radix_key(src[i]).getData())[b]];
+        }
+      }
+
+      // exclusive prefix, digit major.  skip the pass if all elements have the same digit.
+      size_t total = 0, c;
+      bool constant = false;
+      for (size_t d = 0; d < radix; ++d) {
+        size_t digit_total = 0;
+        for (int t = 0; t < T; ++t) {
+          c = counts[t * radix + d];
+          counts[t * radix + d] = total;
+          total += c;
+          digit_total += c;
+        }
+        if (digit_total == n) constant = true;
+      }
+      if (constant) continue;
+
+      // scatter
+#pragma omp parallel for num_threads(T) schedule(static, 1)
+      for (int t = 0; t < T; ++t) {
+        size_t * off = counts.data() + t * radix;
+        for (size_t i = t * block, max = ::std::min(n, (t + 1) * block); i < max; ++i) {
+          dst[off[reinterpret_cast<uint8_t const *>(local::radix_key(src[i]).getData())[b]]++] = src[i];
+        }
+      }
+      ::std::swap(src, dst);
+    }
+
+    if (src != data.data()) data.swap(buffer);
+  }
+
+  /**
+   * @brief sort vector of Kmer or std::pair<Kmer, T> by the transformed key, i.e. in the order of TransformedComparator<Kmer, std::less, Transform>.
+   * @details  the transformed keys are sorted with their positions, then the elements are gathered.
+   *        with the identity transform, sorts the elements directly.
+   */
+  template <typename V, typename A, typename Transform>
+  void radix_sort(::std::vector<V, A> & data, Transform const & trans, int nthreads = 0) {
+    using Kmer = typename ::std::decay<decltype(local::radix_key(::std::declval<V const &>()))>::type;
+    if (::std::is_same<Transform, ::bliss::transform::identity<Kmer> >::value) {
+      radix_sort(data, nthreads);
+      return;
+    }
+
+    nthreads = local::radix_sort_threads(nthreads);
+    ::std::vector<::std::pair<Kmer, size_t> > keys(data.size());
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+    for (size_t i = 0; i < data.size(); ++i) {
+      keys[i] = ::std::make_pair(trans(local::radix_key(data[i])), i);
+    }
+    radix_sort(keys, nthreads);
+
+    ::std::vector<V, A> sorted(data.size());
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+    for (size_t i = 0; i < data.size(); ++i) {
+      sorted[i] = data[keys[i].second];
+    }
+    data.swap(sorted);
+  }
+
+} // namespace fsc
+
+#endif /* RADIX_SORT_HPP_ */
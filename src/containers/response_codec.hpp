@@ -0,0 +1,254 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    response_codec.hpp
+ * @ingroup dsc::containers
+ * @brief   compressed find responses of the multimaps:  the key once per group of results, and the values delta encoded.
+ * @details  a multimap find answers a query with all (key, value) pairs of the key, so a repetitive kmer sends its key
+ *          once per occurrence.  encode_responses writes each run of results with equal keys as
+ *            key bytes, varint(count), values
+ *          and, for values with a 64 bit id that orders them (kmer positions, see response_delta), sorts the run's
+ *          values by id and writes the first id and the differences as varints (LEB128), followed by any other bytes
+ *          of the value (e.g. the quality score of a position-quality pair).  nearby positions then take 1-2 bytes
+ *          instead of 8.  other values are copied as is.  the order of the values of a key is not kept.
+ *
+ *          compressed_all2allv encodes the results for each destination, exchanges the bytes, and decodes them.
+ *          the maps use it in find and find_stream when set_compress_find(true) is set.
+ */
+#ifndef DSC_RESPONSE_CODEC_HPP_
+#define DSC_RESPONSE_CODEC_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>
+#include <functional>   // equal_to
+#include <type_traits>
+#include <cstdint>
+#include <cstring>      // memcpy
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "common/sequence.hpp"
+
+namespace dsc  // distributed std container
+{
+
+  /**
+   * @brief  values that find responses delta encode:  id() gives a 64 bit id whose order groups nearby values, and
+   *        extra bytes of the value that are not in the id are copied.  value is false for other types.
+   */
+  template <typename T, typename = void>
+  struct response_delta {
+      static constexpr bool value = false;
+  };
+
+  /// integers.
+  template <typename T>
+  struct response_delta<T, typename ::std::enable_if<::std::is_integral<T>::value>::type> {
+      static constexpr bool value = true;
+      static constexpr size_t extra = 0;
+      static inline uint64_t id(T const & v) { return static_cast<uint64_t>(v); }
+      static inline void put_extra(T const &, uint8_t *) {}
+      static inline T get(uint64_t const & id, uint8_t const *) { return static_cast<T>(id); }
+  };
+
+  /// kmer positions.  the id is the whole position, file, sequence and offset.
+  template <typename T>
+  struct response_delta<T, typename ::std::enable_if<
+    ::std::is_same<T, ::bliss::common::ShortSequenceKmerId>::value ||
+    ::std::is_same<T, ::bliss::common::LongSequenceKmerId>::value>::type> {
+      static constexpr bool value = true;
+      static constexpr size_t extra = 0;
+      static inline uint64_t id(T const & v) { return v.id; }
+      static inline void put_extra(T const &, uint8_t *) {}
+      static inline T get(uint64_t const & id, uint8_t const *) {
+        T v;
+        v.id = id;
+        return v;
+      }
+  };
+
+  /// (position, payload) pairs, e.g. position and quality.  the payload is copied.
+  template <typename P, typename Q>
+  struct response_delta<::std::pair<P, Q>, typename ::std::enable_if<response_delta<P>::value>::type> {
+      static constexpr bool value = true;
+      static constexpr size_t extra = response_delta<P>::extra + sizeof(Q);
+      static inline uint64_t id(::std::pair<P, Q> const & v) { return response_delta<P>::id(v.first); }
+      static inline void put_extra(::std::pair<P, Q> const & v, uint8_t * out) {
+        response_delta<P>::put_extra(v.first, out);
+        memcpy(out + response_delta<P>::extra, &(v.second), sizeof(Q));
+      }
+      static inline ::std::pair<P, Q> get(uint64_t const & id, uint8_t const * in) {
+        ::std::pair<P, Q> v;
+        v.first = response_delta<P>::get(id, in);
+        memcpy(static_cast<void *>(&(v.second)), in + response_delta<P>::extra, sizeof(Q));
+        return v;
+      }
+  };
+
+  namespace detail {
+
+    inline void put_varint(::std::vector<uint8_t> & out, uint64_t x) {
+      while (x >= 0x80) {
+        out.push_back(static_cast<uint8_t>(x | 0x80));
+        x >>= 7;
+      }
+      out.push_back(static_cast<uint8_t>(x));
+    }
+
+    inline uint64_t get_varint(uint8_t const * & in) {
+      uint64_t x = 0;
+      unsigned int shift = 0;
+      while (*in & 0x80) {
+        x |= static_cast<uint64_t>(*in & 0x7F) << shift;
+        shift += 7;
+        ++in;
+      }
+      x |= static_cast<uint64_t>(*in) << shift;
+      ++in;
+      return x;
+    }
+
+    template <typename T>
+    inline void put_raw(::std::vector<uint8_t> & out, T const & v) {
+      size_t s = out.size();
+      out.resize(s + sizeof(T));
+      memcpy(out.data() + s, &v, sizeof(T));
+    }
+
+    template <typename T>
+    inline T get_raw(uint8_t const * & in) {
+      T v;
+      memcpy(static_cast<void *>(&v), in, sizeof(T));
+      in += sizeof(T);
+      return v;
+    }
+
+    /// write the values of 1 group, sorted by id and delta encoded.  the values are reordered in place.
+    template <typename Key, typename T>
+    inline void put_values(::std::vector<uint8_t> & out, ::std::pair<Key, T> * first, ::std::pair<Key, T> * last,
+                           ::std::true_type const &) {
+      using D = response_delta<T>;
+      ::std::sort(first, last, [](::std::pair<Key, T> const & x, ::std::pair<Key, T> const & y) {
+        return D::id(x.second) < D::id(y.second);
+      });
+      uint64_t prev = 0;
+      for (; first != last; ++first) {
+        uint64_t id = D::id(first->second);
+        put_varint(out, id - prev);
+        prev = id;
+        if (D::extra > 0) {
+          size_t s = out.size();
+          out.resize(s + D::extra);
+          D::put_extra(first->second, out.data() + s);
+        }
+      }
+    }
+    template <typename Key, typename T>
+    inline void put_values(::std::vector<uint8_t> & out, ::std::pair<Key, T> * first, ::std::pair<Key, T> * last,
+                           ::std::false_type const &) {
+      for (; first != last; ++first) put_raw(out, first->second);
+    }
+
+    template <typename T>
+    inline T get_value(uint8_t const * & in, uint64_t & prev, ::std::true_type const &) {
+      using D = response_delta<T>;
+      prev += get_varint(in);
+      T v = D::get(prev, in);
+      in += D::extra;
+      return v;
+    }
+    template <typename T>
+    inline T get_value(uint8_t const * & in, uint64_t &, ::std::false_type const &) {
+      return get_raw<T>(in);
+    }
+
+  } // namespace detail
+
+
+  /**
+   * @brief  encode results for each destination.  counts[i] consecutive results go to process i.
+   * @details  runs of equal keys become 1 group.  the values within a run are reordered.
+   * @param bytes        encoded results, by destination.
+   * @param byte_counts  bytes per destination.
+   */
+  template <typename Key, typename T, typename Equal = ::std::equal_to<Key> >
+  void encode_responses(::std::vector<::std::pair<Key, T> > & results, ::std::vector<size_t> const & counts,
+                        ::std::vector<uint8_t> & bytes, ::std::vector<size_t> & byte_counts, Equal const & eq = Equal()) {
+    using delta = ::std::integral_constant<bool, response_delta<T>::value>;
+
+    bytes.clear();
+    bytes.reserve(results.size() * (sizeof(T) + 2));
+    byte_counts.assign(counts.size(), 0);
+
+    ::std::pair<Key, T> * it = results.data();
+    for (size_t i = 0; i < counts.size(); ++i) {
+      size_t start = bytes.size();
+      ::std::pair<Key, T> * end = it + counts[i];
+      while (it != end) {
+        ::std::pair<Key, T> * last = it + 1;
+        while ((last != end) && eq(last->first, it->first)) ++last;
+
+        detail::put_raw(bytes, it->first);
+        detail::put_varint(bytes, last - it);
+        detail::put_values(bytes, it, last, delta());
+        it = last;
+      }
+      byte_counts[i] = bytes.size() - start;
+    }
+  }
+
+  /// decode results written by encode_responses, appending them to results.
+  template <typename Key, typename T>
+  void decode_responses(uint8_t const * first, uint8_t const * last, ::std::vector<::std::pair<Key, T> > & results) {
+    using delta = ::std::integral_constant<bool, response_delta<T>::value>;
+
+    while (first < last) {
+      Key k = detail::get_raw<Key>(first);
+      size_t n = detail::get_varint(first);
+      uint64_t prev = 0;
+      for (size_t j = 0; j < n; ++j) {
+        results.emplace_back(k, detail::get_value<T>(first, prev, delta()));
+      }
+    }
+  }
+
+  /**
+   * @brief  send counts[i] results to process i, compressed, and replace results with the received ones.  collective.
+   * @details  the received results are in source rank order, as with mxx::all2allv.
+   * @return  number of bytes sent by this process.
+   */
+  template <typename Key, typename T>
+  size_t compressed_all2allv(::std::vector<::std::pair<Key, T> > & results, ::std::vector<size_t> const & counts,
+                             ::mxx::comm const & comm) {
+    ::std::vector<uint8_t> bytes;
+    ::std::vector<size_t> byte_counts;
+    encode_responses(results, counts, bytes, byte_counts);
+    size_t sent = bytes.size();
+
+    ::std::vector<uint8_t> received = ::mxx::all2allv(bytes, byte_counts, comm);
+    ::std::vector<uint8_t>().swap(bytes);
+
+    results.clear();
+    decode_responses(received.data(), received.data() + received.size(), results);
+    return sent;
+  }
+
+} // namespace dsc
+
+#endif /* DSC_RESPONSE_CODEC_HPP_ */
@@ -0,0 +1,272 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    rma_sorted_map.hpp
+ * @ingroup index
+ * @brief   read-only distributed multimap with non-collective queries, via MPI one-sided communication.
+ * @details  the find and count of the distributed maps are collective, so all ranks have to take part in every query.
+ *          for a query service where one rank gets a few keys at a time, that costs a full all-to-all per request.
+ *
+ *          here each rank keeps its partition as a sorted array, exposed in a window from MPI_Win_create and locked
+ *          with MPI_Win_lock_all for the lifetime of the index.  every rank also holds a replicated splitter table:  the key
+ *          at the start of each block of entries, for every rank.  a query hashes the key to its owner, finds the blocks
+ *          that can hold the key in the owner's splitters, and reads them with 1 MPI_Get, usually 1 or 2 blocks.
+ *          the target rank does not take part, and queries need no matching calls on the other ranks.
+ *
+ *          the splitter table takes (total entries / block) keys on every rank.  larger blocks use less memory and read more per query.
+ *
+ *          Key and T need to be bitwise copyable, as entries are read with MPI_BYTE.
+ *          the map is static after build().  build() and the destructor are collective on the communicator.
+ *          with MPI implementations that need the target to progress one-sided operations, queries complete when the target
+ *          is in an MPI call.
+ */
+#ifndef BLISS_RMA_SORTED_MAP_HPP
+#define BLISS_RMA_SORTED_MAP_HPP
+
+#include <vector>
+#include <utility>     // pair
+#include <functional>  // hash, less
+#include <algorithm>   // sort, lower_bound, upper_bound, equal_range
+#include <numeric>     // partial_sum
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "utils/benchmark_utils.hpp"
+#include "io/incremental_mxx.hpp"
+
+namespace dsc  // distributed std container
+{
+
+  /**
+   * @brief sorted, read-only multimap with one-sided queries.
+   * @tparam Hash   hash functor on Key, used to assign keys to ranks.
+   * @tparam Less   comparator on Key, for the sorted storage.
+   */
+  template <typename Key, typename T, typename Hash = ::std::hash<Key>, typename Less = ::std::less<Key> >
+  class rma_sorted_map {
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<Key, T>;
+
+    protected:
+      /// compare entries by key only, so equal_range works on keys.
+      struct KeyLess {
+          Less l;
+          inline bool operator()(value_type const & x, value_type const & y) const { return l(x.first, y.first); }
+          inline bool operator()(value_type const & x, Key const & y) const { return l(x.first, y); }
+          inline bool operator()(Key const & x, value_type const & y) const { return l(x, y.first); }
+      };
+
+      ::mxx::comm comm;
+      Hash hash;
+      KeyLess less;
+
+      /// entries per splitter block.
+      size_t block;
+
+      /// this rank's entries, sorted by key.  exposed in the window.
+      ::std::vector<value_type> entries;
+
+      /// first key of each block, for all ranks.  rank r's splitters are [splitter_offsets[r], splitter_offsets[r+1]).
+      ::std::vector<Key> splitters;
+      ::std::vector<size_t> splitter_offsets;
+      /// number of entries on each rank.
+      ::std::vector<size_t> sizes;
+
+      MPI_Win win;
+      bool exposed;
+
+      inline int route(Key const & k) const {
+        return hash(k) % comm.size();
+      }
+
+      /// range of entries on the owner of k that contains all entries with key k.
+      ::std::pair<size_t, size_t> block_range(int const & r, Key const & k) const {
+        Key const * s_begin = splitters.data() + splitter_offsets[r];
+        Key const * s_end = splitters.data() + splitter_offsets[r + 1];
+        if (s_begin == s_end) return ::std::pair<size_t, size_t>(0, 0);
+
+        // the block before the first splitter >= k may end with k.  the first splitter > k starts after the last k.
+        size_t lb = ::std::lower_bound(s_begin, s_end, k, less.l) - s_begin;
+        size_t ub = ::std::upper_bound(s_begin, s_end, k, less.l) - s_begin;
+        if (lb > 0) --lb;
+        return ::std::make_pair(lb * block, ::std::min(ub * block, sizes[r]));
+      }
+
+      /**
+       * @brief read the blocks that can hold each key.  not collective.
+       * @param[out] buffer   the blocks, concatenated.
+       * @param[out] offsets  keys[i]'s blocks are [offsets[i], offsets[i+1]) in buffer.
+       */
+      void fetch(::std::vector<Key> const & keys, ::std::vector<value_type> & buffer, ::std::vector<size_t> & offsets) const {
+        ::std::vector<int> owners(keys.size());
+        ::std::vector<::std::pair<size_t, size_t> > ranges(keys.size());
+        offsets.resize(keys.size() + 1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          owners[i] = route(keys[i]);
+          ranges[i] = block_range(owners[i], keys[i]);
+          offsets[i + 1] = offsets[i] + (ranges[i].second - ranges[i].first);
+        }
+
+        // issue all the reads, then wait for them together.
+        buffer.resize(offsets.back());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          size_t n = ranges[i].second - ranges[i].first;
+          if (n == 0) continue;
+          if (owners[i] == comm.rank()) {
+            ::std::copy(entries.begin() + ranges[i].first, entries.begin() + ranges[i].second, buffer.begin() + offsets[i]);
+          } else {
+            MPI_Get(buffer.data() + offsets[i], static_cast<int>(n * sizeof(value_type)), MPI_BYTE, owners[i],
+                    static_cast<MPI_Aint>(ranges[i].first), static_cast<int>(n * sizeof(value_type)), MPI_BYTE, win);
+          }
+        }
+        if (keys.size() > 0) MPI_Win_flush_all(win);
+      }
+
+      void release() {
+        if (exposed) {
+          MPI_Win_unlock_all(win);
+          MPI_Win_free(&win);
+        }
+        exposed = false;
+        ::std::vector<value_type>().swap(entries);
+        splitters.clear();
+        splitter_offsets.assign(comm.size() + 1, 0);
+        sizes.assign(comm.size(), 0);
+      }
+
+    public:
+      /**
+       * @param _block   entries per splitter block.
+       */
+      rma_sorted_map(::mxx::comm const & _comm, size_t const & _block = 64) :
+        comm(_comm.copy()), block(::std::max(static_cast<size_t>(1), _block)), exposed(false) {
+        splitter_offsets.assign(comm.size() + 1, 0);
+        sizes.assign(comm.size(), 0);
+      }
+
+      // the window cannot be copied.
+      rma_sorted_map(rma_sorted_map const & other) = delete;
+      rma_sorted_map & operator=(rma_sorted_map const & other) = delete;
+
+      /// collective.  frees the window.
+      virtual ~rma_sorted_map() {
+        release();
+      }
+
+      /// number of entries on this rank.
+      size_t local_size() const {
+        return entries.size();
+      }
+
+      /// number of entries across all ranks.  not collective.
+      size_t size() const {
+        return ::std::accumulate(sizes.begin(), sizes.end(), static_cast<size_t>(0));
+      }
+
+      /// entries stored on this rank, sorted by key.
+      ::std::pair<value_type const *, value_type const *> local_range() const {
+        return ::std::make_pair(entries.data(), entries.data() + entries.size());
+      }
+
+      /**
+       * @brief build the index from entries on every rank, e.g. the to_vector() of a distributed map.  replaces current content.  collective.
+       */
+      void build(::std::vector<value_type> const & input) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        release();
+
+        ::std::vector<value_type> temp(input);
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::imxx::distribute(temp, [this](value_type const & x) { return this->route(x.first); },
+                           recv_counts, i2o, entries, comm, false);
+        ::std::vector<value_type>().swap(temp);
+        BL_BENCH_END(build, "distribute", entries.size());
+
+        BL_BENCH_START(build);
+        ::std::sort(entries.begin(), entries.end(), less);
+        BL_BENCH_END(build, "local_sort", entries.size());
+
+        // replicate the splitters.
+        BL_BENCH_START(build);
+        ::std::vector<Key> samples;
+        samples.reserve((entries.size() + block - 1) / block);
+        for (size_t i = 0; i < entries.size(); i += block) {
+          samples.emplace_back(entries[i].first);
+        }
+        sizes = ::mxx::allgather(entries.size(), comm);
+        ::std::vector<size_t> counts = ::mxx::allgather(samples.size(), comm);
+        splitters = ::mxx::allgatherv(samples, counts, comm);
+        splitter_offsets.assign(comm.size() + 1, 0);
+        ::std::partial_sum(counts.begin(), counts.end(), splitter_offsets.begin() + 1);
+        BL_BENCH_END(build, "splitters", splitters.size());
+
+        // expose the entries.
+        BL_BENCH_START(build);
+        MPI_Win_create(entries.data(), static_cast<MPI_Aint>(entries.size() * sizeof(value_type)), sizeof(value_type),
+                       MPI_INFO_NULL, comm, &win);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+        exposed = true;
+        BL_BENCH_END(build, "expose", entries.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "rma_sorted_map:build", comm);
+      }
+
+      /// count for each query key, in the order of keys.  not collective.
+      ::std::vector<size_t> count(::std::vector<Key> const & keys) const {
+        ::std::vector<value_type> buffer;
+        ::std::vector<size_t> offsets;
+        fetch(keys, buffer, offsets);
+
+        ::std::vector<size_t> results(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          auto r = ::std::equal_range(buffer.begin() + offsets[i], buffer.begin() + offsets[i + 1], keys[i], less);
+          results[i] = ::std::distance(r.first, r.second);
+        }
+        return results;
+      }
+
+      /// count for 1 key.  not collective.
+      size_t count(Key const & key) const {
+        return count(::std::vector<Key>(1, key))[0];
+      }
+
+      /// all entries matching the query keys, in the order of keys.  repeated keys are reported repeatedly.  not collective.
+      ::std::vector<value_type> find(::std::vector<Key> const & keys) const {
+        ::std::vector<value_type> buffer;
+        ::std::vector<size_t> offsets;
+        fetch(keys, buffer, offsets);
+
+        ::std::vector<value_type> results;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          auto r = ::std::equal_range(buffer.begin() + offsets[i], buffer.begin() + offsets[i + 1], keys[i], less);
+          results.insert(results.end(), r.first, r.second);
+        }
+        return results;
+      }
+  };
+
+} // namespace dsc
+
+#endif // BLISS_RMA_SORTED_MAP_HPP
@@ -0,0 +1,769 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    sharded_map.hpp
+ * @ingroup fsc::containers
+ * @brief   local hash map split into shards, whose batch operations use several threads.
+ * @details  lets a rank use several threads for its local table operations, so that fewer ranks per node are needed,
+ *          and the all-to-all and its buffers shrink accordingly.
+ *
+ *          keys are assigned to shards by the high bits of a re-mixed hash, so the shards still see well distributed low bits.
+ *          a batch operation first groups its input by shard with a threaded counting sort (per thread histograms, then
+ *          a scatter of the positions), then each shard is processed by 1 thread at a time.  shards are independent, so
+ *          there is no locking.  there are 4x as many shards as threads, so dynamic scheduling can balance skewed shards.
+ *          the elements of a shard keep their input order, so repeated keys are reduced in the same order as by 1 thread.
+ *
+ *          the interface and the template parameters are those of ::fsc::swiss_map, so sharded_swiss_map can be the
+ *          LocalContainer of the distributed densehash maps.  their local insert and reduction use the threaded batch
+ *          insert, and their QueryProcessor looks up the queries in parallel blocks, see process_queries.
+ *          single key operations go to 1 shard in the calling thread.  iterators visit the shards in order.
+ *
+ *          without OpenMP (USE_OPENMP), or for fewer than min_per_thread elements per thread, everything runs in the
+ *          calling thread.
+ */
+#ifndef SHARDED_MAP_HPP_
+#define SHARDED_MAP_HPP_
+
+#include <vector>
+#include <utility>    // pair
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(USE_OPENMP)
+#include "omp.h"
+#endif
+
+#include "containers/fsc_container_utils.hpp"
+#include "containers/swiss_map.hpp"
+
+namespace fsc {  // fast standard container
+
+  /// 0 means omp_get_max_threads().  1 without OpenMP.
+  inline int sharded_map_threads(int nthreads) {
+#if defined(USE_OPENMP)
+    return (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  /**
+   * @brief  local map of Shard maps, with threaded batch operations.  see file description.
+   * @tparam Shard  local map template with the template parameters of ::fsc::swiss_map, e.g. ::fsc::swiss_map.
+   */
+  template <template <typename, typename, typename, template <typename> class, typename, typename, typename, bool> class Shard,
+    typename Key, typename T, typename SpecialKeys, template <typename> class Transform,
+    typename Hash, typename Equal, typename Allocator, bool split>
+  class sharded_map {
+
+    public:
+      using local_map_type        = Shard<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>;
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = typename local_map_type::value_type;
+      using hasher                = typename local_map_type::hasher;
+      using key_equal             = typename local_map_type::key_equal;
+      using allocator_type        = typename local_map_type::allocator_type;
+      using reference             = value_type&;
+      using const_reference       = const value_type&;
+      using pointer               = typename local_map_type::pointer;
+      using const_pointer         = typename local_map_type::const_pointer;
+      using size_type             = size_t;
+      using difference_type       = ptrdiff_t;
+
+      /// batch operations with fewer elements per thread than this use fewer threads.
+      static constexpr size_t min_per_thread = 4096;
+
+    protected:
+
+      /// iterator over the entries of all shards, shard by shard.
+      template <bool is_const>
+      class shard_iterator : public ::std::iterator<::std::forward_iterator_tag,
+        typename ::std::conditional<is_const, const value_type, value_type>::type> {
+          friend class sharded_map;
+          template <bool> friend class shard_iterator;
+
+          using V = typename ::std::conditional<is_const, const value_type, value_type>::type;
+          using map_ptr = typename ::std::conditional<is_const, local_map_type const *, local_map_type *>::type;
+          using inner_iterator = typename ::std::conditional<is_const,
+              typename local_map_type::const_iterator, typename local_map_type::iterator>::type;
+
+          map_ptr maps;
+          size_t s;
+          size_t n;
+          inner_iterator it;
+
+          inline void skip() {
+            while ((s < n) && (it == maps[s].end())) {
+              ++s;
+              if (s < n) it = maps[s].begin();
+            }
+          }
+
+        public:
+          shard_iterator() : maps(nullptr), s(0), n(0), it() {};
+          shard_iterator(map_ptr _maps, size_t const & _s, size_t const & _n, inner_iterator const & _it) :
+            maps(_maps), s(_s), n(_n), it(_it) {
+            skip();
+          };
+
+          /// conversion to const iterator
+          template <bool c = is_const, typename = typename ::std::enable_if<!c>::type>
+          operator shard_iterator<true>() const {
+            return shard_iterator<true>(maps, s, n, it);
+          }
+
+          inline V & operator*() const { return *it; }
+          inline V * operator->() const { return &(*it); }
+
+          inline shard_iterator & operator++() {
+            ++it;
+            skip();
+            return *this;
+          }
+          inline shard_iterator operator++(int) {
+            shard_iterator out(*this);
+            ++(*this);
+            return out;
+          }
+
+          template <bool c>
+          inline bool operator==(shard_iterator<c> const & other) const {
+            return (s == other.s) && ((s == n) || (it == other.it));
+          }
+          template <bool c>
+          inline bool operator!=(shard_iterator<c> const & other) const {
+            return !(*this == other);
+          }
+      };
+
+    public:
+      using iterator              = shard_iterator<false>;
+      using const_iterator        = shard_iterator<true>;
+
+    protected:
+      ::std::vector<local_map_type> shards;
+      hasher hash;
+      int n_threads;
+
+      /// murmur3 64 bit finalizer, so that the shard does not depend on the bits the shards use.
+      static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+      }
+
+      template <typename V>
+      static inline Key const & get_key(V const & x) { return x.first; }
+      static inline Key const & get_key(Key const & x) { return x; }
+
+      /// accepts all elements, for insert_reduce without a predicate.
+      struct accept_all {
+          template <typename V>
+          inline bool operator()(V const &) const { return true; }
+      };
+
+      /**
+       * @brief threaded counting sort of the positions [0, n) by the shard of key_at(i).
+       * @param[out] offsets   start of each shard in order, plus the end.  size is shards + 1.
+       * @param[out] order     input positions, grouped by shard, in input order within a shard.
+       */
+      template <typename KeyAt>
+      void group_by_shard(size_t const & n, KeyAt const & key_at,
+                          ::std::vector<size_t> & offsets, ::std::vector<size_t> & order) const {
+        size_t const S = shards.size();
+        int const nt = threads_for(n);
+        size_t const block = (n + nt - 1) / nt;
+
+        ::std::vector<uint32_t> ids(n);
+        ::std::vector<size_t> counts(nt * S, 0);   // thread major
+
+        // shard ids and per thread histograms.
+#pragma omp parallel for num_threads(nt) schedule(static, 1)
+        for (int t = 0; t < nt; ++t) {
+          size_t * cnt = counts.data() + t * S;
+          for (size_t i = t * block, max = ::std::min(n, (t + 1) * block); i < max; ++i) {
+            ids[i] = shard_of(key_at(i));
+            ++cnt[ids[i]];
+          }
+        }
+
+        // exclusive prefix, shard major, so each thread's part of a shard is contiguous.
+        offsets.assign(S + 1, 0);
+        size_t total = 0, c;
+        for (size_t s = 0; s < S; ++s) {
+          offsets[s] = total;
+          for (int t = 0; t < nt; ++t) {
+            c = counts[t * S + s];
+            counts[t * S + s] = total;
+            total += c;
+          }
+        }
+        offsets[S] = total;
+
+        // scatter the positions.
+        order.resize(n);
+#pragma omp parallel for num_threads(nt) schedule(static, 1)
+        for (int t = 0; t < nt; ++t) {
+          size_t * off = counts.data() + t * S;
+          for (size_t i = t * block, max = ::std::min(n, (t + 1) * block); i < max; ++i) {
+            order[off[ids[i]]++] = i;
+          }
+        }
+      }
+
+      /// insert a contiguous array, grouped by shard, then each shard's part in 1 batch.
+      template <typename V>
+      void insert_batch(V const * input, size_t const & n) {
+        if (n == 0) return;
+        if (threads_for(n) == 1) {
+          for (size_t i = 0; i < n; ++i) shards[shard_of(get_key(input[i]))].insert(input[i]);
+          return;
+        }
+
+        ::std::vector<size_t> offsets;
+        ::std::vector<size_t> order;
+        group_by_shard(n, [input](size_t const & i) -> Key const & { return get_key(input[i]); }, offsets, order);
+
+        ::std::vector<::std::pair<Key, T> > grouped(n);
+#pragma omp parallel for num_threads(threads_for(n)) schedule(static)
+        for (size_t j = 0; j < n; ++j) {
+          grouped[j] = input[order[j]];
+        }
+
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          shards[s].insert(grouped.begin() + offsets[s], grouped.begin() + offsets[s + 1]);
+        }
+      }
+
+      /// insert or reduce 1 element into shard s.  returns false if pred rejects it.
+      template <typename V, typename Reducer, typename Predicate>
+      inline void insert_reduce_one(size_t const & s, V const & v, Reducer const & r, Predicate const & pred) {
+        if (!pred(v)) return;
+        auto result = shards[s].insert(v);
+        if (!(result.second)) {
+          // an entry is already there, so reduce
+          result.first->second = r(result.first->second, v.second);
+        }
+      }
+
+      template <typename InputIt, typename Reducer, typename Predicate>
+      void insert_reduce_impl(InputIt first, InputIt last, Reducer const & r, Predicate const & pred,
+                              ::std::random_access_iterator_tag) {
+        size_t const n = ::std::distance(first, last);
+        if (threads_for(n) == 1) {
+          for (; first != last; ++first) {
+            auto v = *first;
+            insert_reduce_one(shard_of(v.first), v, r, pred);
+          }
+          return;
+        }
+
+        ::std::vector<size_t> offsets;
+        ::std::vector<size_t> order;
+        group_by_shard(n, [&first](size_t const & i) -> Key { return (*(first + i)).first; }, offsets, order);
+
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          for (size_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+            insert_reduce_one(s, *(first + order[j]), r, pred);
+          }
+        }
+      }
+      template <typename InputIt, typename Reducer, typename Predicate>
+      void insert_reduce_impl(InputIt first, InputIt last, Reducer const & r, Predicate const & pred,
+                              ::std::input_iterator_tag) {
+        for (; first != last; ++first) {
+          auto v = *first;
+          insert_reduce_one(shard_of(v.first), v, r, pred);
+        }
+      }
+
+      /// group keys by shard, then call op(shard, grouped keys, count, offset in the grouped keys) for each shard, with the threads.
+      template <typename Op>
+      void for_each_shard(Key const * keys, size_t const & n, ::std::vector<size_t> & order, Op const & op) const {
+        ::std::vector<size_t> offsets;
+        group_by_shard(n, [keys](size_t const & i) -> Key const & { return keys[i]; }, offsets, order);
+
+        ::std::vector<Key> grouped(n);
+#pragma omp parallel for num_threads(threads_for(n)) schedule(static)
+        for (size_t j = 0; j < n; ++j) {
+          grouped[j] = keys[order[j]];
+        }
+
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          op(s, grouped.data() + offsets[s], offsets[s + 1] - offsets[s], offsets[s]);
+        }
+      }
+
+    public:
+
+      /**
+       * @param bucket_count  total initial capacity, spread over the shards.
+       * @param threads       number of threads for the batch operations.  0 means omp_get_max_threads().
+       * @param shard_count   number of shards.  0 means 4 x threads.
+       */
+      sharded_map(size_type bucket_count = 128, int threads = 0, size_t shard_count = 0) :
+        hash(), n_threads(sharded_map_threads(threads)) {
+        if (shard_count == 0) shard_count = 4 * n_threads;
+        shards.reserve(shard_count);
+        for (size_t s = 0; s < shard_count; ++s) shards.emplace_back((bucket_count + shard_count - 1) / shard_count);
+      };
+
+      template<class InputIt>
+      sharded_map(InputIt first, InputIt last) :
+        sharded_map(std::distance(first, last)) {
+        this->insert(first, last);
+      };
+
+      sharded_map(sharded_map const & other) = default;
+      sharded_map(sharded_map && other) = default;
+
+      sharded_map & operator=(sharded_map other) {
+        this->swap(other);
+        return *this;
+      }
+
+      void swap(sharded_map & other) {
+        ::std::swap(shards, other.shards);
+        ::std::swap(hash, other.hash);
+        ::std::swap(n_threads, other.n_threads);
+      }
+
+      virtual ~sharded_map() {};
+
+      /// threads of the batch operations.  the number of shards stays.
+      void set_thread_count(int threads) {
+        n_threads = sharded_map_threads(threads);
+      }
+      int get_thread_count() const {
+        return n_threads;
+      }
+      /// threads for a batch of n elements, so each thread has at least min_per_thread elements.
+      int threads_for(size_t const & n) const {
+        return static_cast<int>(::std::max(static_cast<size_t>(1),
+                                           ::std::min(static_cast<size_t>(n_threads), n / min_per_thread)));
+      }
+
+      size_t shard_count() const {
+        return shards.size();
+      }
+      inline size_t shard_of(Key const & k) const {
+        return (mix(hash(k)) >> 32) % shards.size();
+      }
+      local_map_type & shard(size_t const & s) { return shards[s]; }
+      local_map_type const & shard(size_t const & s) const { return shards[s]; }
+
+      float get_max_load_factor() const {
+        return shards[0].get_max_load_factor();
+      }
+
+      iterator begin() {
+        return iterator(shards.data(), 0, shards.size(), shards[0].begin());
+      }
+      const_iterator begin() const {
+        return cbegin();
+      }
+      const_iterator cbegin() const {
+        return const_iterator(shards.data(), 0, shards.size(), shards[0].cbegin());
+      }
+
+      iterator end() {
+        return iterator(shards.data(), shards.size(), shards.size(), typename local_map_type::iterator());
+      }
+      const_iterator end() const {
+        return cend();
+      }
+      const_iterator cend() const {
+        return const_iterator(shards.data(), shards.size(), shards.size(), typename local_map_type::const_iterator());
+      }
+
+
+      std::vector<Key> keys() const {
+        std::vector<Key> ks;
+
+        keys(ks);
+
+        return ks;
+      }
+      void keys(std::vector<Key> & ks) const {
+        ::std::vector<size_t> offsets(shards.size() + 1, 0);
+        for (size_t s = 0; s < shards.size(); ++s) offsets[s + 1] = offsets[s] + shards[s].size();
+
+        ks.resize(offsets.back());
+#pragma omp parallel for num_threads(threads_for(offsets.back())) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          size_t i = offsets[s];
+          for (auto it = shards[s].cbegin(); it != shards[s].cend(); ++it, ++i) ks[i] = it->first;
+        }
+      }
+
+      std::vector<std::pair<Key, T> > to_vector() const {
+        std::vector<std::pair<Key, T>> vs;
+
+        to_vector(vs);
+
+        return vs;
+      }
+      void to_vector(  std::vector<std::pair<Key, T> > & vs) const {
+        ::std::vector<size_t> offsets(shards.size() + 1, 0);
+        for (size_t s = 0; s < shards.size(); ++s) offsets[s + 1] = offsets[s] + shards[s].size();
+
+        vs.resize(offsets.back());
+#pragma omp parallel for num_threads(threads_for(offsets.back())) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          ::std::copy(shards[s].cbegin(), shards[s].cend(), vs.begin() + offsets[s]);
+        }
+      }
+
+
+      bool empty() const {
+        return size() == 0;
+      }
+
+      size_type size() const {
+        size_type n = 0;
+        for (auto const & m : shards) n += m.size();
+        return n;
+      }
+      size_type unique_size() const {
+        return size();
+      }
+
+      /// clear and release memory.
+      void reset() {
+        for (auto & m : shards) m.reset();
+      }
+
+      /// clear without releasing memory.
+      void clear() {
+        for (auto & m : shards) m.clear();
+      }
+
+      /// resize to hold at least n elements, spread evenly over the shards.  iterators are invalidated.
+      void resize(size_t const n) {
+        size_t per_shard = (n + shards.size() - 1) / shards.size();
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          shards[s].resize(per_shard);
+        }
+      }
+
+      /// rehash for new count number of BUCKETS.  iterators are invalidated.
+      void rehash(size_type count) {
+        this->resize(count);
+      }
+
+      size_type bucket_count() const {
+        size_type n = 0;
+        for (auto const & m : shards) n += m.bucket_count();
+        return n;
+      }
+
+      float load_factor() const {
+        return static_cast<float>(size()) / static_cast<float>(bucket_count());
+      }
+
+
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        ::std::vector<::std::pair<Key, T> > input(first, last);
+        insert_batch(input.data(), input.size());
+      }
+
+      /// threaded insert.  input is not modified.
+      void insert(::std::vector<::std::pair<Key, T> > & input) {
+        insert_batch(input.data(), input.size());
+      }
+
+      void insert(::std::vector<value_type > & input) {
+        insert_batch(input.data(), input.size());
+      }
+
+      template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+      std::pair<iterator, bool> insert(::std::pair<Key, T> const & x) {
+        size_t s = shard_of(x.first);
+        auto result = shards[s].insert(x);
+        return std::make_pair(iterator(shards.data(), s, shards.size(), result.first), result.second);
+      }
+
+      std::pair<iterator, bool> insert(::std::pair<const Key, T> const & x) {
+        size_t s = shard_of(x.first);
+        auto result = shards[s].insert(x);
+        return std::make_pair(iterator(shards.data(), s, shards.size(), result.first), result.second);
+      }
+
+      /**
+       * @brief threaded insert of [first, last) that reduces the value of a key already present with r(existing, new).
+       * @details  the elements of a key are reduced in input order.  random access iterators are grouped by shard, others
+       *        are inserted in the calling thread.
+       * @return  number of new entries.
+       */
+      template <typename InputIt, typename Reducer, typename Predicate>
+      size_t insert_reduce(InputIt first, InputIt last, Reducer const & r, Predicate const & pred) {
+        size_t before = size();
+        insert_reduce_impl(first, last, r, pred, typename ::std::iterator_traits<InputIt>::iterator_category());
+        return size() - before;
+      }
+      template <typename InputIt, typename Reducer>
+      size_t insert_reduce(InputIt first, InputIt last, Reducer const & r) {
+        return insert_reduce(first, last, r, accept_all());
+      }
+
+      template <typename V, typename Updater>
+      size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+        size_t count = 0;
+        for (auto const & x : input) {
+          local_map_type & m = shards[shard_of(x.first)];
+          auto it = m.find(x.first);
+          if (it != m.end()) count += op(it->second, x.second);
+        }
+        return count;
+      }
+
+      // non distributed version
+      template <typename Filter, typename Updater>
+      size_t update(Filter const & fop, Updater const & op) {
+        size_t count = 0;
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1) reduction(+:count)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          count += shards[s].update(fop, op);
+        }
+        return count;
+      }
+
+
+      template <typename InputIt, typename Pred>
+      size_t erase(InputIt first, InputIt last, Pred const & pred) {
+        static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                      "InputIt value type for erase cannot be converted to key type");
+
+        ::std::vector<Key> keys(first, last);
+        if (keys.size() == 0) return 0;
+
+        ::std::vector<size_t> order;
+        ::std::vector<size_t> counts(shards.size(), 0);
+        for_each_shard(keys.data(), keys.size(), order, [this, &pred, &counts](size_t const & s, Key const * k, size_t const & n, size_t const &) {
+          counts[s] = shards[s].erase(k, k + n, pred);
+        });
+        size_t count = 0;
+        for (auto c : counts) count += c;
+        return count;
+      }
+
+      template <typename InputIt>
+      size_t erase(InputIt first, InputIt last) {
+        return erase(first, last, accept_all());
+      }
+
+      /// erase the elements that satisfy pred.  each shard in 1 thread.
+      template <typename Pred>
+      size_t erase(Pred const & pred) {
+        size_t count = 0;
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1) reduction(+:count)
+        for (size_t s = 0; s < shards.size(); ++s) {
+          count += shards[s].erase(pred);
+        }
+        return count;
+      }
+
+      size_type count(Key const & key) const {
+        return shards[shard_of(key)].count(key);
+      }
+
+      ::std::pair<iterator, iterator> equal_range(Key const & key) {
+        iterator it = find(key);
+        if (it == end()) return ::std::make_pair(it, it);
+        iterator next = it;
+        return ::std::make_pair(it, ++next);
+      }
+      ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+        const_iterator it = find(key);
+        if (it == cend()) return ::std::make_pair(it, it);
+        const_iterator next = it;
+        return ::std::make_pair(it, ++next);
+      }
+
+      iterator find(Key const &key) {
+        size_t s = shard_of(key);
+        auto it = shards[s].find(key);
+        return (it == shards[s].end()) ? end() : iterator(shards.data(), s, shards.size(), it);
+      }
+
+      const_iterator find(Key const &key) const {
+        size_t s = shard_of(key);
+        auto it = shards[s].find(key);
+        return (it == shards[s].cend()) ? cend() : const_iterator(shards.data(), s, shards.size(), it);
+      }
+
+      inline void prefetch(Key const & key) const {
+        shards[shard_of(key)].prefetch(key);
+      }
+
+      /// threaded batch count.  results[i] is the count for queries[i].
+      void count(Key const * queries, size_t const count, size_type * results) const {
+        if (threads_for(count) == 1) {
+          for (size_t i = 0; i < count; ++i) results[i] = shards[shard_of(queries[i])].count(queries[i]);
+          return;
+        }
+
+        ::std::vector<size_t> order;
+        ::std::vector<size_type> grouped(count);
+        for_each_shard(queries, count, order, [this, &grouped](size_t const & s, Key const * k, size_t const & n, size_t const & offset) {
+          shards[s].count(k, n, grouped.data() + offset);
+        });
+#pragma omp parallel for num_threads(threads_for(count)) schedule(static)
+        for (size_t j = 0; j < count; ++j) {
+          results[order[j]] = grouped[j];
+        }
+      }
+
+      /// threaded batch find.  results[i] points to the entry for queries[i], or is nullptr.  valid until the next insert.
+      void find(Key const * queries, size_t const count, value_type const ** results) const {
+        if (threads_for(count) == 1) {
+          for (size_t i = 0; i < count; ++i) {
+            auto it = find(queries[i]);
+            results[i] = (it == cend()) ? nullptr : &(*it);
+          }
+          return;
+        }
+
+        ::std::vector<size_t> order;
+        ::std::vector<value_type const *> grouped(count);
+        for_each_shard(queries, count, order, [this, &grouped](size_t const & s, Key const * k, size_t const & n, size_t const & offset) {
+          shards[s].find(k, n, grouped.data() + offset);
+        });
+#pragma omp parallel for num_threads(threads_for(count)) schedule(static)
+        for (size_t j = 0; j < count; ++j) {
+          results[order[j]] = grouped[j];
+        }
+      }
+
+      inline bool exists(Key const & key) const {
+        return shards[shard_of(key)].exists(key);
+      }
+
+  };
+
+  template <template <typename, typename, typename, template <typename> class, typename, typename, typename, bool> class Shard,
+    typename Key, typename T, typename SpecialKeys, template <typename> class Transform,
+    typename Hash, typename Equal, typename Allocator, bool split>
+  constexpr size_t sharded_map<Shard, Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>::min_per_thread;
+
+
+  /**
+   * @brief  ::fsc::swiss_map shards.  same template parameters as ::fsc::swiss_map, so it can be the LocalContainer of
+   *        the distributed densehash maps.
+   */
+  template <typename Key,
+    typename T,
+    typename SpecialKeys = void,   // not used.  for compatibility with densehash_map
+    template<typename> class Transform = ::bliss::transform::identity,
+    typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+    typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+    typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+    bool split = false >   // not used.  for compatibility with densehash_map
+  using sharded_swiss_map = sharded_map<::fsc::swiss_map, Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>;
+
+
+  /// true for the sharded maps, whose queries the distributed maps look up with process_queries.
+  template <typename Map>
+  struct is_sharded_map : public ::std::false_type {};
+  template <template <typename, typename, typename, template <typename> class, typename, typename, typename, bool> class Shard,
+    typename Key, typename T, typename SpecialKeys, template <typename> class Transform,
+    typename Hash, typename Equal, typename Allocator, bool split>
+  struct is_sharded_map<sharded_map<Shard, Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split> > :
+    public ::std::true_type {};
+  template <typename Map>
+  struct is_sharded_map<Map const> : public is_sharded_map<Map> {};
+
+
+  namespace sharded {
+
+    template <typename Map, typename QueryIter, typename OutputIter, typename Operator, typename Predicate, typename Transform>
+    size_t process_queries(Map & map, QueryIter first, QueryIter last, OutputIter & output, Operator & op,
+                           Predicate const & pred, Transform const & trans, ::std::false_type) {
+      size_t count = 0;
+      for (; first != last; ++first) count += op(map, *first, output, pred, trans);
+      return count;
+    }
+
+    template <typename Map, typename QueryIter, typename OutputIter, typename Operator, typename Predicate, typename Transform>
+    size_t process_queries(Map & map, QueryIter first, QueryIter last, OutputIter & output, Operator & op,
+                           Predicate const & pred, Transform const & trans, ::std::true_type) {
+      size_t const n = ::std::distance(first, last);
+      int const T = map.threads_for(n);
+      if (T == 1) return process_queries(map, first, last, output, op, pred, trans, ::std::false_type());
+
+      using V = typename ::std::remove_const<typename ::std::iterator_traits<OutputIter>::value_type>::type;
+
+      // 4 blocks per thread, for dynamic scheduling.
+      size_t const block = (n + 4 * T - 1) / (4 * T);
+      size_t const blocks = (n + block - 1) / block;
+      ::std::vector<::std::vector<V> > outputs(blocks);
+      ::std::vector<size_t> counts(blocks, 0);
+
+#pragma omp parallel for num_threads(T) schedule(dynamic, 1)
+      for (size_t b = 0; b < blocks; ++b) {
+        ::fsc::back_emplace_iterator<::std::vector<V> > out(outputs[b]);
+        size_t c = 0;
+        for (QueryIter it = first + b * block, max = first + ::std::min(n, (b + 1) * block); it != max; ++it) {
+          c += op(map, *it, out, pred, trans);
+        }
+        counts[b] = c;
+      }
+
+      // in query order.
+      size_t count = 0;
+      for (size_t b = 0; b < blocks; ++b) {
+        count += counts[b];
+        for (auto & x : outputs[b]) {
+          *output = ::std::move(x);
+          ++output;
+        }
+      }
+      return count;
+    }
+
+  } // namespace sharded
+
+  /**
+   * @brief  op(map, query, output, pred, trans) for each query, as QueryProcessor does.  with a sharded map, blocks of queries
+   *        are looked up in parallel into per block buffers, then written to output in query order, so the output is the
+   *        same as that of the serial loop.  op has to be safe for concurrent lookups, as the const lookups of the maps are.
+   * @details  serial for other maps, for input iterators, and for output iterators without a value type.
+   * @return  sum of the op results.
+   */
+  template <typename Map, typename QueryIter, typename OutputIter, typename Operator, typename Predicate, typename Transform>
+  size_t process_queries(Map & map, QueryIter first, QueryIter last, OutputIter & output, Operator & op,
+                         Predicate const & pred, Transform const & trans) {
+    return ::fsc::sharded::process_queries(map, first, last, output, op, pred, trans,
+        ::std::integral_constant<bool, ::fsc::is_sharded_map<Map>::value &&
+          ::std::is_same<typename ::std::iterator_traits<QueryIter>::iterator_category, ::std::random_access_iterator_tag>::value &&
+          !::std::is_void<typename ::std::iterator_traits<OutputIter>::value_type>::value>());
+  }
+
+} // namespace fsc
+
+#endif /* SHARDED_MAP_HPP_ */
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    soa_sorted_vector.hpp
+ * @ingroup fsc::containers
+ * @brief   sorted multimap as a structure of arrays:  a sorted keys array, and a parallel values array.
+ * @details  a sorted std::vector<std::pair<Key, T> > is searched by comparing keys, but every probe loads the whole
+ *          entry, so with 8 byte k-mers and 16 to 24 byte position or quality values, 2 to 4 times the lines are cached.
+ *          here the searches touch only the keys array, and a value is read once, for each match.
+ *
+ *          sort() sorts (key, index) pairs, stable, and then permutes the values by the indices, so each value is moved
+ *          once.  keys are searched by interpolation when Less is radix sortable (Kmer keys), otherwise by binary search.
+ *          positions, not iterators, are returned by the searches, for use with key(i) and value(i).
+ */
+#ifndef SOA_SORTED_VECTOR_HPP_
+#define SOA_SORTED_VECTOR_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // stable_sort, is_sorted, lower_bound, upper_bound
+#include <functional>   // less
+#include <type_traits>
+#include <iterator>
+
+#include "containers/interpolation_search.hpp"
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief sorted keys and values in separate arrays.  duplicate keys are allowed, and keep their insertion order.
+   * @tparam Less   comparator on Key.
+   */
+  template <typename Key, typename T, typename Less = ::std::less<Key> >
+  class soa_sorted_vector {
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using value_type = ::std::pair<Key, T>;
+      using size_type = size_t;
+      using key_const_iterator = typename ::std::vector<Key>::const_iterator;
+
+    protected:
+      ::std::vector<Key> key_array;
+      ::std::vector<T> value_array;
+      Less comp;
+
+      /// lower bound in [b, e) of the keys array
+      template <typename Query>
+      inline key_const_iterator lower_bound(key_const_iterator b, key_const_iterator e, Query const & k, ::std::true_type) const {
+        return ::fsc::interpolation_lower_bound(b, e, k, comp);
+      }
+      template <typename Query>
+      inline key_const_iterator lower_bound(key_const_iterator b, key_const_iterator e, Query const & k, ::std::false_type) const {
+        return ::std::lower_bound(b, e, k, comp);
+      }
+
+    public:
+      soa_sorted_vector(Less const & _comp = Less()) : comp(_comp) {}
+
+      /**
+       * @brief build from a range of (key, value) pairs.
+       * @param sorted  the range is already ordered by key.
+       */
+      template <typename Iter>
+      soa_sorted_vector(Iter first, Iter last, bool sorted = false, Less const & _comp = Less()) : comp(_comp) {
+        assign(first, last, sorted);
+      }
+
+      template <typename Iter>
+      void assign(Iter first, Iter last, bool sorted = false) {
+        size_t n = ::std::distance(first, last);
+        key_array.clear();
+        value_array.clear();
+        key_array.reserve(n);
+        value_array.reserve(n);
+        for (; first != last; ++first) {
+          key_array.emplace_back(first->first);
+          value_array.emplace_back(first->second);
+        }
+        if (!sorted) sort();
+      }
+
+      /// sort by key, stable.  both arrays are permuted.
+      void sort() {
+        if (::std::is_sorted(key_array.begin(), key_array.end(), comp)) return;
+
+        ::std::vector<::std::pair<Key, size_t> > order;
+        order.reserve(key_array.size());
+        for (size_t i = 0; i < key_array.size(); ++i) order.emplace_back(key_array[i], i);
+        Less const & lt = comp;
+        ::std::stable_sort(order.begin(), order.end(),
+                           [&lt](::std::pair<Key, size_t> const & x, ::std::pair<Key, size_t> const & y) {
+          return lt(x.first, y.first);
+        });
+
+        ::std::vector<T> permuted;
+        permuted.reserve(value_array.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+          key_array[i] = order[i].first;
+          permuted.emplace_back(::std::move(value_array[order[i].second]));
+        }
+        value_array.swap(permuted);
+      }
+
+      size_t size() const { return key_array.size(); }
+      bool empty() const { return key_array.empty(); }
+      /// memory used by the 2 arrays.
+      size_t bytes() const { return key_array.capacity() * sizeof(Key) + value_array.capacity() * sizeof(T); }
+
+      void clear() {
+        ::std::vector<Key>().swap(key_array);
+        ::std::vector<T>().swap(value_array);
+      }
+      void swap(soa_sorted_vector & other) {
+        key_array.swap(other.key_array);
+        value_array.swap(other.value_array);
+        ::std::swap(comp, other.comp);
+      }
+
+      Key const & key(size_t const & i) const { return key_array[i]; }
+      T const & value(size_t const & i) const { return value_array[i]; }
+      value_type entry(size_t const & i) const { return value_type(key_array[i], value_array[i]); }
+
+      ::std::vector<Key> const & keys() const { return key_array; }
+      ::std::vector<T> const & values() const { return value_array; }
+
+      // ============ searches.  touch only the keys array.
+      /// position of the first entry not less than k, in [from, size()).
+      template <typename Query>
+      size_t lower_bound(Query const & k, size_t const & from = 0) const {
+        return lower_bound(key_array.begin() + from, key_array.end(), k,
+                           ::std::integral_constant<bool, ::fsc::is_radix_sortable<Less>::value>()) - key_array.begin();
+      }
+      /// position of the first entry greater than k, in [from, size()).
+      template <typename Query>
+      size_t upper_bound(Query const & k, size_t const & from = 0) const {
+        return ::std::upper_bound(key_array.begin() + from, key_array.end(), k, comp) - key_array.begin();
+      }
+      /// [first, second) positions of the entries with key k.
+      template <typename Query>
+      ::std::pair<size_t, size_t> equal_range(Query const & k, size_t const & from = 0) const {
+        size_t lb = lower_bound(k, from);
+        // matches are usually few, so scan before falling back to binary search.
+        size_t ub = lb;
+        for (size_t i = 0; (i < 8) && (ub < key_array.size()) && !comp(k, key_array[ub]); ++i) ++ub;
+        if ((ub < key_array.size()) && !comp(k, key_array[ub])) ub = upper_bound(k, ub);
+        return ::std::make_pair(lb, ub);
+      }
+      template <typename Query>
+      size_t count(Query const & k) const {
+        auto r = equal_range(k);
+        return r.second - r.first;
+      }
+  };
+
+} // namespace fsc
+
+#endif /* SOA_SORTED_VECTOR_HPP_ */
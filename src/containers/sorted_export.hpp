@@ -0,0 +1,319 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    sorted_export.hpp
+ * @ingroup dsc::containers
+ * @brief   export of the entries of a hashed distributed map (or index) in globally sorted key order, in windows.
+ * @details  the hashed maps have no key order, so a sorted output used to be to_vector then mxx::sort, which copies all
+ *          local entries and then needs the sort's buffers on top.  sorted_export instead:
+ *
+ *          1. counts the local entries per 16 bit key prefix (the radix buckets of dsc::bucket_table) during 1 scan, and
+ *             sums the counts over all processes.
+ *          2. cuts the prefix range into consecutive windows of about chunk_size entries per process.
+ *          3. for each window, scans the local entries again and keeps those in the window, sends them so that each
+ *             process gets a contiguous sub-range of the window's prefixes with about equal load
+ *             (bucket_table::balanced), sorts what it received, and passes it to the sink.
+ *
+ *          the sink is called collectively once per window, on all processes, with the sorted local piece.  the pieces of
+ *          a window in rank order, and the windows in call order, are the entries in key order.  so a sink that writes each
+ *          call's pieces at consecutive file offsets in rank order (exscan) writes a sorted file.  the extra memory is about
+ *          2 windows of chunk_size entries, plus a prefix with more entries than a window, instead of 2-3 copies of the map.
+ *          the cost is 1 scan of the local entries per window.
+ *
+ *          the prefix of a key has to be consistent with the order:  dsc::sorted_prefix gives the first 16 bits for
+ *          kmers and integers.
+ *
+ *          sinks here:  sorted_file_sink writes the fsc::mapped_sorted_map file format (save_sorted), and
+ *          bliss::index::kmer::export_text uses sorted_export for its sorted text output.
+ */
+#ifndef DSC_SORTED_EXPORT_HPP_
+#define DSC_SORTED_EXPORT_HPP_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <functional>   // less
+#include <type_traits>
+#include <cstdint>
+#include <cstring>      // memcpy
+#include <cstdio>       // rename
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/kmer.hpp"
+#include "containers/bucket_table.hpp"
+#include "containers/distributed_map_base.hpp"
+#include "containers/mapped_map.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/io_exception.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace dsc  // distributed std container
+{
+
+  /// first bucket_table::bits bits of a key, in key order.  unsigned integers.
+  template <typename Key, typename = void>
+  struct sorted_prefix {
+      static_assert(::std::is_integral<Key>::value, "sorted_prefix: give a prefix functor for this key type.");
+
+      inline size_t operator()(Key const & k) const {
+        constexpr unsigned int nbits = 8 * sizeof(Key);
+        using U = typename ::std::make_unsigned<Key>::type;
+        // signed keys:  flip the sign bit, so negative keys come first.
+        uint64_t x = static_cast<uint64_t>(static_cast<U>(k)) ^
+            (::std::is_signed<Key>::value ? (static_cast<uint64_t>(1) << (nbits - 1)) : 0);
+        return (nbits >= bucket_table::bits) ? static_cast<size_t>(x >> (nbits - bucket_table::bits)) :
+            static_cast<size_t>(x << (bucket_table::bits - nbits));
+      }
+  };
+
+  /// first bucket_table::bits bits of a kmer, which are its first characters.  the same order as Kmer::operator<.
+  template <typename Key>
+  struct sorted_prefix<Key, typename ::std::enable_if<::bliss::common::is_kmer<Key>::value>::type> {
+      inline size_t operator()(Key const & k) const {
+        constexpr unsigned int b = (Key::nBits < bucket_table::bits) ? Key::nBits : bucket_table::bits;
+        return static_cast<size_t>(k.getPrefix(b) << (bucket_table::bits - b));
+      }
+  };
+
+  namespace detail {
+    template <typename Cursor>
+    struct cursor_types;
+
+    template <typename Key, typename T>
+    struct cursor_types<scan_cursor<Key, T> > {
+        using key_type = Key;
+        using mapped_type = T;
+    };
+
+    template <typename Map>
+    using scan_types = cursor_types<decltype(::std::declval<Map const &>().scan(1))>;
+  }
+
+  /**
+   * @brief  pass the entries of map to sink in globally sorted key order, 1 window at a time.  collective.
+   * @param map         a map or index with scan(chunk_size), e.g. densehash_map, unordered_map, or a kmer index.
+   * @param sink        called as sink(::std::vector<::std::pair<Key, T> > const &) once per window on all processes.
+   * @param chunk_size  target entries per process per window.
+   * @return  number of entries passed to the local sink.
+   */
+  template <typename Map, typename Sink,
+            typename Key = typename detail::scan_types<Map>::key_type,
+            typename T = typename detail::scan_types<Map>::mapped_type,
+            typename Less = ::std::less<Key>, typename Prefix = sorted_prefix<Key> >
+  size_t sorted_export(Map const & map, Sink & sink, ::mxx::comm const & comm, size_t const & chunk_size = (1UL << 20),
+                       Less const & less = Less(), Prefix const & prefix = Prefix()) {
+    using V = ::std::pair<Key, T>;
+    size_t const chunk = ::std::max(chunk_size, static_cast<size_t>(1));
+    size_t const nbuckets = bucket_table::nbuckets;
+
+    BL_BENCH_INIT(sorted_export);
+
+    // entries per prefix, over all processes.
+    BL_BENCH_START(sorted_export);
+    ::std::vector<size_t> counts(nbuckets, 0);
+    {
+      auto cursor = map.scan(chunk);
+      while (cursor.next()) {
+        auto const & c = cursor.chunk();
+        for (size_t i = 0; i < c.size(); ++i) ++counts[prefix(c.key(i))];
+      }
+    }
+    if (comm.size() > 1)
+      MPI_Allreduce(MPI_IN_PLACE, counts.data(), counts.size(), MPI_UNSIGNED_LONG, MPI_SUM, comm);
+    BL_BENCH_COLLECTIVE_END(sorted_export, "histogram", nbuckets, comm);
+
+    // windows of consecutive prefixes, about chunk entries per process each.
+    size_t const target = chunk * comm.size();
+    ::std::vector<size_t> window_ends;
+    {
+      size_t load = 0;
+      for (size_t b = 0; b < nbuckets; ++b) {
+        if ((load > 0) && (load + counts[b] > target)) {
+          window_ends.emplace_back(b);
+          load = 0;
+        }
+        load += counts[b];
+      }
+      if (load > 0) window_ends.emplace_back(nbuckets);
+    }
+
+    BL_BENCH_START(sorted_export);
+    size_t exported = 0;
+    ::std::vector<V> piece, received;
+    ::std::vector<size_t> recv_counts, i2o;
+    size_t lo = 0;
+    for (size_t w = 0; w < window_ends.size(); ++w) {
+      size_t const hi = window_ends[w];
+
+      // the local entries in the window.
+      piece.clear();
+      {
+        auto cursor = map.scan(chunk);
+        while (cursor.next()) {
+          auto const & c = cursor.chunk();
+          for (size_t i = 0; i < c.size(); ++i) {
+            size_t b = prefix(c.key(i));
+            if ((b >= lo) && (b < hi)) piece.emplace_back(c.key(i), c.value(i));
+          }
+        }
+      }
+
+      // contiguous prefix ranges of the window per process, by load.
+      if (comm.size() > 1) {
+        ::std::vector<size_t> loads(nbuckets, 0);
+        ::std::copy(counts.begin() + lo, counts.begin() + hi, loads.begin() + lo);
+        bucket_table table = bucket_table::balanced(loads, comm.size());
+        ::imxx::distribute(piece, [&table, &prefix](V const & x) { return table[prefix(x.first)]; },
+                           recv_counts, i2o, received, comm);
+      } else {
+        received.swap(piece);
+      }
+
+      ::std::sort(received.begin(), received.end(), [&less](V const & x, V const & y) { return less(x.first, y.first); });
+      sink(static_cast<::std::vector<V> const &>(received));
+      exported += received.size();
+      lo = hi;
+    }
+    BL_BENCH_COLLECTIVE_END(sorted_export, "windows", exported, comm);
+
+    BL_BENCH_REPORT_MPI_NAMED(sorted_export, "dsc:sorted_export", comm);
+    return exported;
+  }
+
+
+  /**
+   * @brief  sink for sorted_export that writes 1 fsc::mapped_sorted_map file with MPI-IO.
+   * @details  each call writes the pieces of all processes after the previous ones, in rank order.  the file is written
+   *        to <filename>.tmp and renamed by close(), so processes that have the old file mapped are not affected.
+   */
+  template <typename Key, typename T, typename Less = ::std::less<Key> >
+  class sorted_file_sink {
+      using V = ::std::pair<Key, T>;
+
+      ::mxx::comm const & comm;
+      ::std::string filename;
+      ::std::string tmp_filename;
+      MPI_File fh;
+      MPI_Offset offset;
+      size_t count;
+      int res;
+
+      void throw_io_error(::std::string const & op, int const & code) const {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(code, msg, &len);
+
+        ::std::stringstream ss;
+        ss << "ERROR : dsc::sorted_file_sink " << op << ": rank " << comm.rank() << " [" << filename << "] " << ::std::string(msg, len);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+    public:
+      /// the file type, for reading it back.
+      using mapped_map_type = ::fsc::mapped_sorted_map<Key, T, Less>;
+
+      /// open the file.  the header is written by close().  collective.
+      sorted_file_sink(::std::string const & _filename, ::mxx::comm const & _comm) :
+        comm(_comm), filename(_filename), tmp_filename(_filename + ".tmp"),
+        offset(sizeof(::fsc::mapped_map_file::header_type)), count(0) {
+        res = MPI_File_open(comm, const_cast<char *>(tmp_filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) throw_io_error("open", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+        // truncate any existing file.
+        res = MPI_File_set_size(fh, 0);
+      }
+
+      /// number of entries written so far, over all processes.
+      size_t size() const { return count; }
+
+      /// write the sorted pieces of all processes after the previous ones.  collective.
+      void operator()(::std::vector<V> const & sorted) {
+        size_t prefix = ::mxx::exscan(sorted.size(), comm);
+        if (comm.rank() == 0) prefix = 0;
+        size_t total = ::mxx::allreduce(sorted.size(), comm);
+
+        // writes of at most 1 GB, within the int count.
+        size_t chunk = ::std::max(static_cast<size_t>(1), (1UL << 30) / sizeof(V));
+        size_t rounds = ::mxx::allreduce((sorted.size() + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+        MPI_Offset pos = offset + static_cast<MPI_Offset>(prefix * sizeof(V));
+        size_t i = 0;
+        MPI_Status stat;
+        for (size_t r = 0; r < rounds; ++r) {
+          size_t n = ::std::min(chunk, sorted.size() - i);
+          int w_res = MPI_File_write_at_all(fh, pos, const_cast<V *>(sorted.data() + i), static_cast<int>(n * sizeof(V)), MPI_BYTE, &stat);
+          if (res == MPI_SUCCESS) res = w_res;
+          pos += static_cast<MPI_Offset>(n * sizeof(V));
+          i += n;
+        }
+        offset += static_cast<MPI_Offset>(total * sizeof(V));
+        count += total;
+      }
+
+      /// write the header, close and rename, and throw on all processes if any write failed.  collective.
+      void close() {
+        if ((res == MPI_SUCCESS) && (comm.rank() == 0)) {
+          ::fsc::mapped_map_file::header_type header;
+          header.magic = ::fsc::mapped_map_file::magic;
+          header.version = ::fsc::mapped_map_file::version;
+          header.layout = ::fsc::mapped_map_file::SORTED;
+          header.type_id = ::fsc::mapped_map_file::get_type_id<mapped_map_type>();
+          header.value_size = sizeof(V);
+          header.count = count;
+          header.capacity = count;
+          header.data_offset = sizeof(::fsc::mapped_map_file::header_type);
+
+          MPI_Status stat;
+          res = MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, &stat);
+        }
+        int c_res = MPI_File_close(&fh);
+        if (res == MPI_SUCCESS) res = c_res;
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) throw_io_error("save", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+
+        int r = 0;
+        if (comm.rank() == 0) r = rename(tmp_filename.c_str(), filename.c_str());
+        if (comm.size() > 1) MPI_Bcast(&r, 1, MPI_INT, 0, comm);
+        if (r != 0) {
+          ::std::stringstream ss;
+          ss << "ERROR : dsc::sorted_file_sink: failed to rename [" << tmp_filename << "] to [" << filename << "]";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+      }
+  };
+
+  /**
+   * @brief  write the entries of a hashed map (or index) as 1 fsc::mapped_sorted_map file, in key order.  collective.
+   * @details  via sorted_export, so without a full local copy.  read back with sorted_file_sink<Key, T>::mapped_map_type.
+   * @return  number of entries in the file.
+   */
+  template <typename Map,
+            typename Key = typename detail::scan_types<Map>::key_type,
+            typename T = typename detail::scan_types<Map>::mapped_type>
+  size_t save_sorted(Map const & map, ::std::string const & filename, ::mxx::comm const & comm,
+                     size_t const & chunk_size = (1UL << 20)) {
+    sorted_file_sink<Key, T> sink(filename, comm);
+    sorted_export(map, sink, comm, chunk_size);
+    sink.close();
+    return sink.size();
+  }
+
+} // namespace dsc
+
+#endif /* DSC_SORTED_EXPORT_HPP_ */
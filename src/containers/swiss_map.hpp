@@ -0,0 +1,845 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    swiss_map.hpp
+ * @ingroup fsc::containers
+ * @brief   open addressing hash map with group probing via per-slot control bytes.
+ * @details slots are organized in groups of 16.  each slot has 1 control byte:  EMPTY or a 7 bit tag from the hash value.
+ *          (DELETED marks slots vacated during an erase only.)
+ *          a lookup compares the tag against all 16 control bytes of a group at once (SSE2), and only compares the keys whose tags match.
+ *          groups are probed linearly, and a lookup terminates at the first group with an EMPTY slot.
+ *
+ *          erase leaves no DELETED markers (tombstones):  if the slot's group was full, an element from a later group whose probe
+ *          sequence passed through it is shifted back into the slot, and so on until a group with an EMPTY slot (backward shift).
+ *          probe sequences after erasing are as short as in a freshly built table.  erase by predicate that removes more than
+ *          get_rebuild_fraction() of the elements moves the survivors into a new table in 1 pass instead.
+ *
+ *          unlike google dense_hash_map, no key values are reserved for empty and deleted entries, so the map does not need to be split
+ *          into lower and upper maps for k-mers whose values span the entire key space.
+ *
+ *          the interface is the same as ::fsc::densehash_map, and the template parameters are the same so that it can be used as a
+ *          drop-in local container for the distributed densehash maps.  SpecialKeys and split are accepted but ignored.
+ *
+ *          batch insert and batch find compute hashes in blocks (batch hash interface where available) and prefetch the probed groups
+ *          before touching them, so that the cache misses of a block overlap.
+ */
+#ifndef SWISS_MAP_HPP_
+#define SWISS_MAP_HPP_
+
+#include <vector>
+#include <functional>  // hash, equal_to, etc
+#include <utility>   // pair
+#include <memory>  // allocator
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstring>   // memset
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "containers/fsc_container_utils.hpp"
+#include "utils/transform_utils.hpp"
+
+namespace fsc {  // fast standard container
+
+  namespace sparsehash {
+    // forward declaration.  defined in densehash_map.hpp
+    template <typename Key, template <typename> class Comparator, template <typename> class Transform>
+    struct compare;
+  }
+
+  namespace swiss {
+
+    /// control byte.  full slots have the 7 bit tag (non-negative), EMPTY and DELETED have the sign bit set.
+    using ctrl_t = int8_t;
+    static constexpr ctrl_t EMPTY = static_cast<ctrl_t>(-128);
+    static constexpr ctrl_t DELETED = static_cast<ctrl_t>(-2);
+
+    /// slots per group
+    static constexpr size_t group_size = 16;
+
+    /// bit mask of the slots in group g with control byte equal to tag.
+    inline uint32_t match(ctrl_t const * g, ctrl_t const tag) {
+#if defined(__SSE2__)
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag),
+                                                     _mm_loadu_si128(reinterpret_cast<__m128i const *>(g)))));
+#else
+      uint32_t m = 0;
+      for (size_t i = 0; i < group_size; ++i) {
+        m |= static_cast<uint32_t>(g[i] == tag) << i;
+      }
+      return m;
+#endif
+    }
+
+    /// bit mask of the EMPTY or DELETED slots in group g
+    inline uint32_t match_empty_or_deleted(ctrl_t const * g) {
+#if defined(__SSE2__)
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(g))));
+#else
+      uint32_t m = 0;
+      for (size_t i = 0; i < group_size; ++i) {
+        m |= static_cast<uint32_t>(g[i] < 0) << i;
+      }
+      return m;
+#endif
+    }
+
+    /// bit mask of the full slots in group g
+    inline uint32_t match_full(ctrl_t const * g) {
+      return ~match_empty_or_deleted(g) & 0xFFFFU;
+    }
+
+    inline unsigned int first_bit(uint32_t const m) {
+      return __builtin_ctz(m);
+    }
+
+    /// number of groups for n elements at the max load factor of 7/8.  power of 2.
+    inline size_t groups_for(size_t const n) {
+      size_t needed = (n * 8 + 6) / 7;
+      size_t groups = 1;
+      while (groups * group_size < needed) groups <<= 1;
+      return groups;
+    }
+
+    /// spread the hash bits.  the group comes from the low bits, so weak hashes such as std::hash on integers or the identity hash on kmers would cluster.
+    inline uint64_t mix(uint64_t h) {
+      h *= 0x9E3779B97F4A7C15ULL;
+      return h ^ (h >> 32);
+    }
+    /// group index from the mixed hash. not yet masked by the number of groups.
+    inline size_t get_group(uint64_t const m) {
+      return static_cast<size_t>(m >> 7);
+    }
+    /// 7 bit tag from the mixed hash.
+    inline ctrl_t get_tag(uint64_t const m) {
+      return static_cast<ctrl_t>(m & 0x7F);
+    }
+
+    /// key equality for the table.  the sparsehash compare functor treats its empty and deleted keys specially,
+    /// which does not apply here, so it is replaced by the plain transformed comparator.
+    template <typename Equal>
+    struct key_equal {
+        using type = Equal;
+    };
+    template <typename Key, template <typename> class Comparator, template <typename> class Transform>
+    struct key_equal<::fsc::sparsehash::compare<Key, Comparator, Transform> > {
+        using type = ::fsc::TransformedComparator<Key, Comparator, Transform>;
+    };
+
+  } // namespace swiss
+
+
+/**
+ * @brief open addressing hash map with SSE2 group probing, that does not reserve any key values.
+ * @details  see file description.  max load factor is 7/8.  erase shifts elements back instead of leaving DELETED markers.
+ *          iterators are invalidated by insertion (which may rehash) and by erase (which may move elements).
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = void,   // not used.  for compatibility with densehash_map
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = false >   // not used.  for compatibility with densehash_map
+class swiss_map {
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = typename ::fsc::swiss::key_equal<Equal>::type;
+    using allocator_type        = typename ::std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using reference             = value_type&;
+    using const_reference       = const value_type&;
+    using pointer               = typename std::allocator_traits<allocator_type>::pointer;
+    using const_pointer         = typename std::allocator_traits<allocator_type>::const_pointer;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+    /// number of keys hashed and prefetched at a time by the batch operations.
+    static constexpr size_t batch_size = 32;
+
+  protected:
+    using ctrl_t = ::fsc::swiss::ctrl_t;
+    using alloc_traits = ::std::allocator_traits<allocator_type>;
+
+    static constexpr size_t group_size = ::fsc::swiss::group_size;
+    static constexpr size_t npos = ::std::numeric_limits<size_t>::max();
+
+    hasher hash;
+    key_equal eq;
+    allocator_type alloc;
+
+    ctrl_t * ctrl;
+    value_type * slots;
+    size_t group_mask;    // number of groups - 1.  number of groups is a power of 2.
+    size_t n_slots;
+    size_t n_elements;
+    size_t growth_left;   // number of EMPTY slots that can be filled before rehashing.
+    float rebuild_fraction;   // erase by predicate rebuilds the table if it removes more than this fraction of the elements.
+
+    /// iterator over the full slots.
+    template <typename V>
+    class slot_iterator : public ::std::iterator<::std::forward_iterator_tag, V> {
+        friend class swiss_map;
+
+        ctrl_t const * ctrl;
+        V * slots;
+        size_t idx;
+        size_t n;
+
+        inline void skip() {
+          while ((idx < n) && (ctrl[idx] < 0)) ++idx;
+        }
+
+      public:
+        slot_iterator() : ctrl(nullptr), slots(nullptr), idx(0), n(0) {};
+        slot_iterator(ctrl_t const * _ctrl, V * _slots, size_t const & _idx, size_t const & _n) :
+          ctrl(_ctrl), slots(_slots), idx(_idx), n(_n) {
+          skip();
+        };
+
+        /// conversion to const iterator
+        template <typename U = V, typename = typename ::std::enable_if<!::std::is_const<U>::value>::type>
+        operator slot_iterator<const U>() const {
+          return slot_iterator<const U>(ctrl, slots, idx, n);
+        }
+
+        inline V & operator*() const { return slots[idx]; }
+        inline V * operator->() const { return slots + idx; }
+
+        inline slot_iterator & operator++() {
+          ++idx;
+          skip();
+          return *this;
+        }
+        inline slot_iterator operator++(int) {
+          slot_iterator out(*this);
+          ++(*this);
+          return out;
+        }
+
+        template <typename U>
+        inline bool operator==(slot_iterator<U> const & other) const {
+          return (idx == other.get_index()) && (ctrl == other.get_ctrl());
+        }
+        template <typename U>
+        inline bool operator!=(slot_iterator<U> const & other) const {
+          return !(*this == other);
+        }
+
+        inline size_t get_index() const { return idx; }
+        inline ctrl_t const * get_ctrl() const { return ctrl; }
+    };
+
+  public:
+    using iterator              = slot_iterator<value_type>;
+    using const_iterator        = slot_iterator<const value_type>;
+
+  protected:
+
+    static inline size_t groups_for(size_t const n) { return ::fsc::swiss::groups_for(n); }
+    static inline uint64_t mix(uint64_t const h) { return ::fsc::swiss::mix(h); }
+    static inline size_t get_group(uint64_t const m) { return ::fsc::swiss::get_group(m); }
+    static inline ctrl_t get_tag(uint64_t const m) { return ::fsc::swiss::get_tag(m); }
+
+    template <typename V>
+    static inline Key const & get_key(V const & x) { return x.first; }
+    static inline Key const & get_key(Key const & x) { return x; }
+
+    inline void prefetch_hash(uint64_t const h) const {
+      size_t g = (get_group(h) & group_mask) * group_size;
+      __builtin_prefetch(ctrl + g);
+      __builtin_prefetch(slots + g);
+    }
+
+    void allocate(size_t const groups) {
+      group_mask = groups - 1;
+      n_slots = groups * group_size;
+      ctrl = new ctrl_t[n_slots];
+      memset(ctrl, ::fsc::swiss::EMPTY, n_slots);
+      slots = alloc_traits::allocate(alloc, n_slots);
+      n_elements = 0;
+      growth_left = n_slots - n_slots / 8;
+    }
+
+    void destroy_elements() {
+      if (n_elements == 0) return;
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) alloc_traits::destroy(alloc, slots + i);
+      }
+    }
+
+    void deallocate() {
+      if (ctrl == nullptr) return;
+      destroy_elements();
+      alloc_traits::deallocate(alloc, slots, n_slots);
+      delete [] ctrl;
+      ctrl = nullptr;
+      slots = nullptr;
+    }
+
+    /// index of the slot with key, or npos.
+    size_t find_index(Key const & key, uint64_t const h) const {
+      ctrl_t tag = get_tag(h);
+      size_t g = get_group(h) & group_mask;
+      ctrl_t const * gc;
+      uint32_t m;
+      size_t idx;
+      for (;;) {
+        gc = ctrl + g * group_size;
+        for (m = ::fsc::swiss::match(gc, tag); m != 0; m &= m - 1) {
+          idx = g * group_size + ::fsc::swiss::first_bit(m);
+          if (eq(slots[idx].first, key)) return idx;
+        }
+        if (::fsc::swiss::match(gc, ::fsc::swiss::EMPTY) != 0) return npos;
+        g = (g + 1) & group_mask;
+      }
+    }
+
+    /// first EMPTY slot in the probe sequence of h.  there is always one since load is at most 7/8.
+    size_t find_free(uint64_t const h) const {
+      size_t g = get_group(h) & group_mask;
+      uint32_t m;
+      for (;;) {
+        m = ::fsc::swiss::match_empty_or_deleted(ctrl + g * group_size);
+        if (m != 0) return g * group_size + ::fsc::swiss::first_bit(m);
+        g = (g + 1) & group_mask;
+      }
+    }
+
+    /// claim a free slot for a new element with hash h.  the caller constructs the element.
+    size_t prepare_insert(uint64_t const h) {
+      if (growth_left == 0) rehash_groups((group_mask + 1) * 2);
+      size_t idx = find_free(h);
+      --growth_left;
+      ctrl[idx] = get_tag(h);
+      ++n_elements;
+      return idx;
+    }
+
+    /// home group of the element in slot idx.
+    inline size_t home_group(size_t const idx) const {
+      return get_group(mix(hash(slots[idx].first))) & group_mask;
+    }
+
+    /// an element in a group after group hg whose probe sequence passed through hg, or npos.
+    /// the search ends at a group with an EMPTY slot:  no element beyond it probed through hg.
+    size_t find_shift_source(size_t const hg) const {
+      size_t g, idx;
+      ctrl_t const * gc;
+      uint32_t m;
+      for (size_t d = 1; d <= group_mask; ++d) {
+        g = (hg + d) & group_mask;
+        gc = ctrl + g * group_size;
+        for (m = ::fsc::swiss::match_full(gc); m != 0; m &= m - 1) {
+          idx = g * group_size + ::fsc::swiss::first_bit(m);
+          if (((g - home_group(idx)) & group_mask) >= d) return idx;
+        }
+        if (::fsc::swiss::match(gc, ::fsc::swiss::EMPTY) != 0) return npos;
+      }
+      return npos;
+    }
+
+    /// make the vacated slot idx EMPTY, shifting elements back so that every element stays reachable from its home group.
+    void fill_hole(size_t idx) {
+      size_t src;
+      for (;;) {
+        // a lookup passing through this group stops here if the group has an EMPTY slot, so the slot can be EMPTY too.
+        src = (::fsc::swiss::match(ctrl + (idx & ~(group_size - 1)), ::fsc::swiss::EMPTY) != 0) ?
+            npos : find_shift_source(idx / group_size);
+        if (src == npos) break;
+
+        alloc_traits::construct(alloc, slots + idx, ::std::move(slots[src]));
+        alloc_traits::destroy(alloc, slots + src);
+        ctrl[idx] = ctrl[src];
+        ctrl[src] = ::fsc::swiss::DELETED;
+        idx = src;
+      }
+      ctrl[idx] = ::fsc::swiss::EMPTY;
+      ++growth_left;
+    }
+
+    void erase_index(size_t const idx) {
+      alloc_traits::destroy(alloc, slots + idx);
+      --n_elements;
+      ctrl[idx] = ::fsc::swiss::DELETED;
+      fill_hole(idx);
+    }
+
+    /// move all elements into a new table with the specified number of groups.
+    void rehash_groups(size_t const groups) {
+      ctrl_t * old_ctrl = ctrl;
+      value_type * old_slots = slots;
+      size_t old_n = n_slots;
+      size_t count = n_elements;
+
+      allocate(groups);
+
+      uint64_t h;
+      size_t idx;
+      for (size_t i = 0; i < old_n; ++i) {
+        if (old_ctrl[i] < 0) continue;
+
+        h = mix(hash(old_slots[i].first));
+        idx = find_free(h);   // no duplicates.
+        ctrl[idx] = get_tag(h);
+        alloc_traits::construct(alloc, slots + idx, ::std::move(old_slots[i]));
+        alloc_traits::destroy(alloc, old_slots + i);
+      }
+      n_elements = count;
+      growth_left -= count;
+
+      alloc_traits::deallocate(alloc, old_slots, old_n);
+      delete [] old_ctrl;
+    }
+
+    /// insert with precomputed hash value.
+    template <typename V>
+    std::pair<iterator, bool> insert_hashed(V const & x, uint64_t const h) {
+      size_t idx = find_index(x.first, h);
+      if (idx != npos) return std::make_pair(iterator(ctrl, slots, idx, n_slots), false);
+
+      idx = prepare_insert(h);
+      alloc_traits::construct(alloc, slots + idx, x);
+      return std::make_pair(iterator(ctrl, slots, idx, n_slots), true);
+    }
+
+    /// insert a contiguous array of elements.  hashes are computed for a block via the batch hash interface, then the groups are prefetched.
+    template <typename V>
+    void insert_batch(V const * input, size_t const count) {
+      uint64_t hashes[batch_size];
+      size_t n;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, input + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+        for (size_t j = 0; j < n; ++j) insert_hashed(input[i + j], hashes[j]);
+      }
+    }
+
+  public:
+
+    swiss_map(size_type bucket_count = 128) :
+      hash(), eq(), alloc(), ctrl(nullptr), slots(nullptr), rebuild_fraction(0.25f) {
+      allocate(groups_for(bucket_count));
+    };
+
+    template<class InputIt>
+    swiss_map(InputIt first, InputIt last) :
+      swiss_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    swiss_map(swiss_map const & other) :
+      hash(other.hash), eq(other.eq),
+      alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+      ctrl(nullptr), slots(nullptr), rebuild_fraction(other.rebuild_fraction) {
+      allocate(other.group_mask + 1);
+      memcpy(ctrl, other.ctrl, n_slots);
+      for (size_t i = 0; i < n_slots; ++i) {
+        if (ctrl[i] >= 0) alloc_traits::construct(alloc, slots + i, other.slots[i]);
+      }
+      n_elements = other.n_elements;
+      growth_left = other.growth_left;
+    }
+
+    swiss_map(swiss_map && other) :
+      hash(::std::move(other.hash)), eq(::std::move(other.eq)), alloc(::std::move(other.alloc)),
+      ctrl(other.ctrl), slots(other.slots), group_mask(other.group_mask), n_slots(other.n_slots),
+      n_elements(other.n_elements), growth_left(other.growth_left), rebuild_fraction(other.rebuild_fraction) {
+      other.ctrl = nullptr;
+      other.slots = nullptr;
+      other.allocate(1);
+    }
+
+    swiss_map & operator=(swiss_map other) {
+      this->swap(other);
+      return *this;
+    }
+
+    void swap(swiss_map & other) {
+      ::std::swap(hash, other.hash);
+      ::std::swap(eq, other.eq);
+      ::std::swap(alloc, other.alloc);
+      ::std::swap(ctrl, other.ctrl);
+      ::std::swap(slots, other.slots);
+      ::std::swap(group_mask, other.group_mask);
+      ::std::swap(n_slots, other.n_slots);
+      ::std::swap(n_elements, other.n_elements);
+      ::std::swap(growth_left, other.growth_left);
+      ::std::swap(rebuild_fraction, other.rebuild_fraction);
+    }
+
+    virtual ~swiss_map() {
+      deallocate();
+    };
+
+    float get_max_load_factor() const {
+      return 0.875f;
+    }
+
+    /// fraction of the elements above which erase by predicate rebuilds the table instead of shifting elements back.
+    float get_rebuild_fraction() const {
+      return rebuild_fraction;
+    }
+    void set_rebuild_fraction(float const f) {
+      rebuild_fraction = f;
+    }
+
+    iterator begin() {
+      return iterator(ctrl, slots, 0, n_slots);
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      return const_iterator(ctrl, slots, 0, n_slots);
+    }
+
+    iterator end() {
+      return iterator(ctrl, slots, n_slots, n_slots);
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return const_iterator(ctrl, slots, n_slots, n_slots);
+    }
+
+
+    std::vector<Key> keys() const {
+      std::vector<Key> ks;
+
+      keys(ks);
+
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const {
+      ks.clear();
+      ks.reserve(size());
+
+      for (auto it = cbegin(); it != cend(); ++it) {
+        ks.emplace_back(it->first);
+      }
+    }
+
+    std::vector<std::pair<Key, T> > to_vector() const {
+      std::vector<std::pair<Key, T>> vs;
+
+      to_vector(vs);
+
+      return vs;
+    }
+    void to_vector(  std::vector<std::pair<Key, T> > & vs) const {
+      vs.clear();
+      vs.reserve(size());
+
+      for (auto it = cbegin(); it != cend(); ++it) {
+        vs.emplace_back(*it);
+      }
+    }
+
+
+    bool empty() const {
+      return n_elements == 0;
+    }
+
+    size_type size() const {
+      return n_elements;
+    }
+    size_type unique_size() const {
+      return n_elements;
+    }
+
+    /// clear and release memory.
+    void reset() {
+      deallocate();
+      allocate(1);
+    }
+
+    /// clear without releasing memory.
+    void clear() {
+      destroy_elements();
+      memset(ctrl, ::fsc::swiss::EMPTY, n_slots);
+      n_elements = 0;
+      growth_left = n_slots - n_slots / 8;
+    }
+
+    /// resize to hold at least n elements, and at least the current elements.  may shrink.  iterators are invalidated.
+    void resize(size_t const n) {
+      size_t groups = groups_for(::std::max(n, n_elements));
+      if (groups != group_mask + 1) rehash_groups(groups);
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type count) {
+      this->resize(count);
+    }
+
+    /// bucket count, i.e. number of slots.
+    size_type bucket_count() const {
+      return n_slots;
+    }
+
+    float load_factor() const {
+      return static_cast<float>(n_elements) / static_cast<float>(n_slots);
+    }
+
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      // hash and prefetch a block, then insert it.
+      uint64_t hashes[batch_size];
+      size_t n;
+      InputIt it;
+      while (first != last) {
+        for (it = first, n = 0; (n < batch_size) && (it != last); ++it, ++n) {
+          hashes[n] = mix(hash(get_key(*it)));
+          prefetch_hash(hashes[n]);
+        }
+        for (n = 0; first != it; ++first, ++n) {
+          insert_hashed(*first, hashes[n]);
+        }
+      }
+    }
+
+    void insert(::std::vector<::std::pair<Key, T> > & input) {
+      insert_batch(input.data(), input.size());
+    }
+
+    void insert(::std::vector<value_type > & input) {
+      insert_batch(input.data(), input.size());
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    std::pair<iterator, bool> insert(::std::pair<Key, T> const & x) {
+      return insert_hashed(x, mix(hash(x.first)));
+    }
+
+    std::pair<iterator, bool> insert(::std::pair<const Key, T> const & x) {
+      return insert_hashed(x, mix(hash(x.first)));
+    }
+
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+
+      if (input.size() == 0) return 0;
+
+      size_t count = 0;
+      size_t idx;
+      uint64_t hashes[batch_size];
+      size_t n;
+      for (size_t i = 0; i < input.size(); i += batch_size) {
+        n = ::std::min(batch_size, input.size() - i);
+        ::fsc::batch_hash(hash, input.data() + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          idx = find_index(input[i + j].first, hashes[j]);
+          if (idx == npos) continue;
+
+          // update the entry
+          count += op(slots[idx].second, input[i + j].second);
+        }
+      }
+      return count;
+    }
+
+    // non distributed version
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t count = 0;
+
+      for (auto iter = begin(); iter != end(); ++iter) {
+        if (fop(*iter)) {
+          count += op((*iter).second);
+        }
+      }
+
+      return count;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      if (first == last) return 0;
+
+      size_t count = 0;
+      size_t idx;
+
+      for (; first != last; ++first) {
+        idx = find_index(*first, mix(hash(*first)));
+        if (idx == npos) continue;
+
+        if (pred(slots[idx])) {
+          erase_index(idx);
+          ++count;
+        }
+      }
+      return count;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+        static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                      "InputIt value type for erase cannot be converted to key type");
+
+        if (first == last) return 0;
+
+        size_t count = 0;
+        size_t idx;
+
+        for (; first != last; ++first) {
+          idx = find_index(*first, mix(hash(*first)));
+          if (idx == npos) continue;
+
+          erase_index(idx);
+          ++count;
+        }
+        return count;
+    }
+
+    /// erase the elements that satisfy pred.  pred is evaluated once per element, then the vacated slots are filled by
+    /// shifting back, or if more than get_rebuild_fraction() of the elements were removed, the survivors are moved
+    /// into a new table of the same size.
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      size_t before = n_elements;
+
+      // mark first, since shifting would move unvisited elements to visited slots.
+      for (size_t i = 0; i < n_slots; ++i) {
+        if ((ctrl[i] >= 0) && pred(slots[i])) {
+          alloc_traits::destroy(alloc, slots + i);
+          ctrl[i] = ::fsc::swiss::DELETED;
+          --n_elements;
+        }
+      }
+      size_t count = before - n_elements;
+      if (count == 0) return 0;
+
+      if (static_cast<float>(count) > rebuild_fraction * static_cast<float>(before)) {
+        rehash_groups(group_mask + 1);   // skips the marked slots.
+      } else {
+        for (size_t i = 0; i < n_slots; ++i) {
+          if (ctrl[i] == ::fsc::swiss::DELETED) fill_hole(i);
+        }
+      }
+
+      return count;
+    }
+
+    size_type count(Key const & key) const {
+      return (find_index(key, mix(hash(key))) == npos) ? 0 : 1;
+    }
+
+
+    ::std::pair<iterator, iterator> equal_range(Key const & key) {
+      iterator it = find(key);
+      if (it == end()) return ::std::make_pair(it, it);
+      return ::std::make_pair(it, iterator(ctrl, slots, it.get_index() + 1, n_slots));
+    }
+    ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+      const_iterator it = find(key);
+      if (it == cend()) return ::std::make_pair(it, it);
+      return ::std::make_pair(it, const_iterator(ctrl, slots, it.get_index() + 1, n_slots));
+    }
+    // NO bucket interfaces
+
+
+    iterator find(Key const &key) {
+      size_t idx = find_index(key, mix(hash(key)));
+      return iterator(ctrl, slots, (idx == npos) ? n_slots : idx, n_slots);
+    }
+
+    const_iterator find(Key const &key) const {
+      size_t idx = find_index(key, mix(hash(key)));
+      return const_iterator(ctrl, slots, (idx == npos) ? n_slots : idx, n_slots);
+    }
+
+    /// prefetch the group that key probes first, ahead of a lookup.
+    inline void prefetch(Key const & key) const {
+      prefetch_hash(mix(hash(key)));
+    }
+
+    /// batch count.  results[i] is the count for queries[i].  hashes are computed and groups prefetched a block at a time.
+    void count(Key const * queries, size_t const count, size_type * results) const {
+      uint64_t hashes[batch_size];
+      size_t n;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, queries + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          results[i + j] = (find_index(queries[i + j], hashes[j]) == npos) ? 0 : 1;
+        }
+      }
+    }
+
+    /// batch find.  results[i] points to the entry for queries[i], or is nullptr.  hashes are computed and groups prefetched a block at a time.
+    void find(Key const * queries, size_t const count, value_type const ** results) const {
+      uint64_t hashes[batch_size];
+      size_t n, idx;
+      for (size_t i = 0; i < count; i += batch_size) {
+        n = ::std::min(batch_size, count - i);
+        ::fsc::batch_hash(hash, queries + i, n, hashes);
+        for (size_t j = 0; j < n; ++j) {
+          hashes[j] = mix(hashes[j]);
+          prefetch_hash(hashes[j]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          idx = find_index(queries[i + j], hashes[j]);
+          results[i + j] = (idx == npos) ? nullptr : &(slots[idx]);
+        }
+      }
+    }
+
+    inline bool exists(Key const & key) const {
+      return find_index(key, mix(hash(key))) != npos;
+    }
+
+};
+
+template <typename Key, typename T, typename SpecialKeys, template<typename> class Transform,
+  typename Hash, typename Equal, typename Allocator, bool split>
+constexpr size_t swiss_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>::batch_size;
+
+
+} // namespace fsc
+
+
+#endif /* SWISS_MAP_HPP_ */
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_adaptive_map.cpp
+ * @ingroup
+ * @brief   tests that the adaptive map picks the engine from the workload, and counts the same with either engine.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_sorted_map.hpp"
+#include "containers/distributed_adaptive_map.hpp"
+
+#include <map>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using HashParams = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+using MapType = ::dsc::adaptive_map<::dsc::counting_unordered_map<KmerType, uint32_t, HashParams>,
+                                    ::dsc::counting_sorted_map<KmerType, uint32_t, SortParams> >;
+
+/// distinct random kmers, from the same seed on all processes.
+std::vector<KmerType> make_kmers(size_t n) {
+  std::default_random_engine generator(31);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  return kmers;
+}
+
+/// insert each kmer repeat times, in batches, then compare the counts to the gold.
+void insert_and_check(MapType & m, std::vector<KmerType> const & kmers, size_t repeat, ::mxx::comm const & comm) {
+  std::map<KmerType, uint32_t> gold;
+  for (auto const & k : kmers) gold[k] += repeat;
+
+  for (size_t r = 0; r < repeat; ++r) {
+    std::vector<KmerType> batch;
+    for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) batch.emplace_back(kmers[i]);
+    m.insert(batch);
+  }
+  EXPECT_EQ(gold.size(), m.size());
+
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+  std::vector<KmerType> q(query);
+  auto counts = m.count(q);
+  EXPECT_EQ(query.size(), counts.size());
+  for (auto const & x : counts) EXPECT_EQ(1UL, x.second);
+
+  q = query;
+  auto found = m.find(q);
+  EXPECT_EQ(query.size(), found.size());
+  for (auto const & x : found) {
+    EXPECT_EQ(gold.at(x.first), x.second);
+  }
+
+  auto hist = m.histogram(repeat + 1);
+  EXPECT_EQ(gold.size(), hist[repeat]);
+}
+
+
+TEST(AdaptiveMapTest, choose)
+{
+  ::dsc::adaptive_policy p;
+  EXPECT_EQ(::dsc::adaptive_engine::SORTED, MapType::choose(p, 1000.0, 8.0, 0.1));
+  EXPECT_EQ(::dsc::adaptive_engine::HASHED, MapType::choose(p, 1.0e8, 8.0, 0.1));
+  EXPECT_EQ(::dsc::adaptive_engine::HASHED, MapType::choose(p, 1000.0, 1.0, 0.1));
+  EXPECT_EQ(::dsc::adaptive_engine::HASHED, MapType::choose(p, 1000.0, 8.0, 10.0));
+}
+
+
+TEST(AdaptiveMapTest, repeats_pick_sorted)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(2000);
+
+  MapType m(comm);
+  ::dsc::adaptive_policy p;
+  p.min_sample = 4 * kmers.size();
+  m.set_policy(p);
+
+  // 8 copies of each kmer.  picked after the 4th batch.
+  insert_and_check(m, kmers, 8, comm);
+  EXPECT_EQ(::dsc::adaptive_engine::SORTED, m.get_engine());
+
+  // query heavy use afterwards switches to hashed, with the same counts.  each process queries part of the kmers.
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+  for (int i = 0; i < 2; ++i) {
+    std::vector<KmerType> q(query);
+    m.find(q);
+  }
+  EXPECT_EQ(::dsc::adaptive_engine::SORTED, m.adapt());
+  for (int i = 0; i < 8; ++i) {
+    std::vector<KmerType> q(query);
+    m.find(q);
+  }
+  EXPECT_EQ(::dsc::adaptive_engine::HASHED, m.adapt());
+
+  std::vector<KmerType> q(query);
+  auto found = m.find(q);
+  EXPECT_EQ(query.size(), found.size());
+  for (auto const & x : found) EXPECT_EQ(8U, x.second);
+}
+
+
+TEST(AdaptiveMapTest, distinct_pick_hashed)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(20000);
+
+  MapType m(comm);
+  ::dsc::adaptive_policy p;
+  p.min_sample = kmers.size();
+  m.set_policy(p);
+
+  insert_and_check(m, kmers, 1, comm);
+  EXPECT_EQ(::dsc::adaptive_engine::HASHED, m.get_engine());
+
+  size_t local = 0;
+  for (auto it = m.cbegin(); it != m.cend(); ++it) local += it->second;
+  EXPECT_EQ(kmers.size(), ::mxx::allreduce(local, comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
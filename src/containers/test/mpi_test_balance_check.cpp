@@ -0,0 +1,146 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_balance_check.cpp
+ * @ingroup
+ * @brief   tests that the imbalance check before insert rebuckets a hashed map whose input falls on 1 process.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+/// distinct kmers that the default table assigns to rank 0, a part from each process.
+template <typename Map>
+std::vector<KmerType> make_skewed(Map const & map, size_t n, ::mxx::comm const & comm) {
+  std::default_random_engine generator(31 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  while (kmers.size() < n) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+    if (map.owner(k) == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+template <typename Map>
+void check_balance(Map & map, ::mxx::comm const & comm) {
+  size_t const n = 5000;
+  std::vector<KmerType> kmers = make_skewed(map, n, comm);
+  std::vector<KmerType> queries(kmers);
+
+  map.set_balance_policy(::dsc::balance_policy(1.5));
+  map.insert(kmers);
+
+  // the partitions are within the threshold, apart from sampling error.
+  size_t total = ::mxx::allreduce(map.local_size(), comm);
+  size_t largest = ::mxx::allreduce(map.local_size(), ::mxx::max<size_t>(), comm);
+  EXPECT_LE(static_cast<double>(largest), 1.6 * static_cast<double>(total) / comm.size());
+  if (comm.size() > 1) {
+    EXPECT_TRUE(map.get_bucket_table() != ::dsc::default_bucket_table(comm));
+  }
+
+  // all kmers are found under the new table.
+  auto counts = map.count(queries);
+  for (auto const & c : counts) EXPECT_EQ(1UL, c.second);
+
+  // more input of the same distribution is balanced already, so the table stays.
+  ::dsc::bucket_table table = map.get_bucket_table();
+  Map fresh(comm);
+  std::vector<KmerType> more = make_skewed(fresh, n, comm);
+  map.insert(more);
+  EXPECT_TRUE(table == map.get_bucket_table());
+}
+
+TEST(BalanceCheckTest, counting_unordered_map)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, Params> map(comm);
+  check_balance(map, comm);
+}
+
+TEST(BalanceCheckTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> > map(comm);
+  check_balance(map, comm);
+}
+
+TEST(BalanceCheckTest, disabled)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, Params> map(comm);
+  std::vector<KmerType> kmers = make_skewed(map, 1000, comm);
+
+  // without the check, all go to rank 0.
+  map.insert(kmers);
+  EXPECT_EQ(comm.rank() == 0 ? 1000UL * comm.size() : 0UL, map.local_size());
+  EXPECT_TRUE(map.get_bucket_table() == ::dsc::default_bucket_table(comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_build_phase.cpp
+ * @ingroup
+ * @brief   tests that a staged build (begin_build, insert batches, finalize) gives the same maps as inserting each batch.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using SortedParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+/// batches of kmers, with repeats.
+std::vector<std::vector<KmerType> > make_batches(size_t nbatches, size_t n, ::mxx::comm const & comm) {
+  std::default_random_engine generator(23 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<std::vector<KmerType> > batches(nbatches);
+  KmerType k;
+  for (size_t b = 0; b < nbatches; ++b) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+      batches[b].emplace_back(k);
+      if (i % 5 == 0) batches[b].emplace_back(k);
+    }
+    // repeats across batches.
+    if (b > 0) batches[b].insert(batches[b].end(), batches[0].begin(), batches[0].begin() + n / 10);
+  }
+  return batches;
+}
+
+template <typename T>
+std::vector<std::vector<std::pair<KmerType, T> > > make_entry_batches(std::vector<std::vector<KmerType> > const & batches) {
+  std::vector<std::vector<std::pair<KmerType, T> > > result(batches.size());
+  for (size_t b = 0; b < batches.size(); ++b)
+    for (size_t i = 0; i < batches[b].size(); ++i) result[b].emplace_back(batches[b][i], static_cast<T>(b * 100000 + i));
+  return result;
+}
+
+/// all entries, sorted.
+template <typename Map>
+std::vector<std::pair<KmerType, typename Map::mapped_type> > all_entries(Map const & map, ::mxx::comm const & comm) {
+  using V = std::pair<KmerType, typename Map::mapped_type>;
+  std::vector<V> local;
+  map.to_vector(local);
+  std::vector<V> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](V const & x, V const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return all;
+}
+
+/// insert each batch into gold, and stage all batches into test.  the maps agree after finalize.
+template <typename Map, typename V>
+void check_build_phase(Map & gold, Map & test, std::vector<std::vector<V> > const & batches, ::mxx::comm const & comm) {
+  for (auto b : batches) gold.insert(b);
+
+  test.begin_build();
+  EXPECT_TRUE(test.is_building());
+  for (auto b : batches) {
+    test.insert(b);
+    EXPECT_EQ(0UL, b.size());   // moved to staging.
+  }
+  // nothing is inserted until finalize.
+  EXPECT_EQ(0UL, test.size());
+
+  test.finalize();
+  EXPECT_FALSE(test.is_building());
+
+  auto gold_entries = all_entries(gold, comm);
+  auto test_entries = all_entries(test, comm);
+  EXPECT_EQ(gold.size(), test.size());
+  EXPECT_EQ(gold.unique_size(), test.unique_size());
+  ASSERT_EQ(gold_entries.size(), test_entries.size());
+  for (size_t i = 0; i < gold_entries.size(); ++i) {
+    EXPECT_EQ(gold_entries[i].first, test_entries[i].first);
+    EXPECT_EQ(gold_entries[i].second, test_entries[i].second);
+  }
+
+  // inserts after finalize are not staged.
+  std::vector<V> more(batches[0]);
+  test.insert(more);
+  gold.insert(more = batches[0]);
+  EXPECT_EQ(gold.size(), test.size());
+}
+
+TEST(BuildPhaseTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  auto batches = make_batches(4, 2000, comm);
+  ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys> gold(comm), test(comm);
+  check_build_phase(gold, test, batches, comm);
+}
+
+TEST(BuildPhaseTest, counting_unordered_map)
+{
+  ::mxx::comm comm;
+  auto batches = make_batches(4, 2000, comm);
+  ::dsc::counting_unordered_map<KmerType, uint32_t, Params> gold(comm), test(comm);
+  check_build_phase(gold, test, batches, comm);
+}
+
+TEST(BuildPhaseTest, densehash_multimap)
+{
+  ::mxx::comm comm;
+  auto batches = make_entry_batches<uint32_t>(make_batches(4, 2000, comm));
+  ::dsc::densehash_multimap<KmerType, uint32_t, Params, DenseKeys> gold(comm), test(comm);
+  check_build_phase(gold, test, batches, comm);
+
+  // find answers from the key grouped local layout.
+  std::vector<KmerType> query;
+  for (size_t i = 0; i < 100; ++i) query.emplace_back(batches[1][i].first);
+  std::vector<KmerType> query2(query);
+  auto gold_found = gold.find(query);
+  auto test_found = test.find(query2);
+  EXPECT_EQ(::mxx::allreduce(gold_found.size(), comm), ::mxx::allreduce(test_found.size(), comm));
+}
+
+TEST(BuildPhaseTest, unordered_multimap)
+{
+  ::mxx::comm comm;
+  auto batches = make_entry_batches<uint32_t>(make_batches(4, 2000, comm));
+  ::dsc::unordered_multimap<KmerType, uint32_t, Params> gold(comm), test(comm);
+  check_build_phase(gold, test, batches, comm);
+}
+
+TEST(BuildPhaseTest, counting_sorted_map)
+{
+  ::mxx::comm comm;
+  auto batches = make_batches(4, 2000, comm);
+  ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams> gold(comm), test(comm);
+  check_build_phase(gold, test, batches, comm);
+}
+
+TEST(BuildPhaseTest, finalize_without_build)
+{
+  ::mxx::comm comm;
+  auto batches = make_batches(1, 2000, comm);
+  ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys> map(comm);
+  map.insert(batches[0]);
+  size_t n = map.size();
+  map.finalize();
+  EXPECT_EQ(n, map.size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_consume_insert.cpp
+ * @ingroup
+ * @brief   tests distribute_consume, and the consuming inserts against the copying ones.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "io/incremental_mxx.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+
+/// local entries of a map, sorted.
+template <typename Map>
+static std::vector<std::pair<KmerType, typename Map::mapped_type> > local_entries(Map const & map) {
+  std::vector<std::pair<KmerType, typename Map::mapped_type> > local;
+  map.to_vector(local);
+  std::sort(local.begin(), local.end());
+  return local;
+}
+
+/// kmers with repeats, a different part on each rank.
+static std::vector<KmerType> make_kmers(::mxx::comm const & comm) {
+  std::vector<KmerType> input;
+  KmerType km;
+  for (size_t i = 0; i < 3000; ++i) {
+    size_t v = (i * 7 + comm.rank() * 13) % 700;
+    for (size_t j = 0; j < 10; ++j) km.nextFromChar((v >> (2 * j)) & 3);
+    input.emplace_back(km);
+  }
+  return input;
+}
+
+TEST(ConsumeInsertTest, distribute_consume)
+{
+  ::mxx::comm comm;
+  int p = comm.size();
+  auto to_rank = [&p](uint64_t const & x) { return static_cast<int>(((x * 2654435761UL) >> 16) % p); };
+
+  std::vector<uint64_t> data;
+  for (uint64_t i = 0; i < 5000; ++i) data.emplace_back(i * p + comm.rank());
+
+  std::vector<uint64_t> gold_in = data, gold;
+  std::vector<size_t> recv_counts, i2o;
+  ::imxx::distribute(gold_in, to_rank, recv_counts, i2o, gold, comm, false);
+  std::sort(gold.begin(), gold.end());
+
+  // small chunks, so each pair of ranks exchanges several messages.
+  std::vector<uint64_t> input = data, received;
+  size_t calls = 0;
+  auto consume = [&received, &calls](uint64_t * first, uint64_t * last) {
+    received.insert(received.end(), first, last);
+    ++calls;
+  };
+  ::imxx::distribute_consume(input, to_rank, consume, comm, 64 * sizeof(uint64_t));
+  EXPECT_TRUE(input.empty());
+  if (p > 1) EXPECT_GT(calls, static_cast<size_t>(p));
+
+  std::sort(received.begin(), received.end());
+  EXPECT_EQ(gold, received);
+}
+
+TEST(ConsumeInsertTest, counting_map)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> input = make_kmers(comm);
+  std::vector<KmerType> input2 = input;
+
+  ::dsc::counting_unordered_map<KmerType, size_t, Params> gold(comm);
+  gold.insert(input);
+
+  ::dsc::counting_unordered_map<KmerType, size_t, Params> map(comm);
+  map.insert(std::move(input2));
+  EXPECT_TRUE(input2.empty());
+
+  ASSERT_EQ(gold.size(), map.size());
+  std::vector<std::pair<KmerType, size_t> > g(gold.get_local_container().begin(), gold.get_local_container().end());
+  std::vector<std::pair<KmerType, size_t> > m(map.get_local_container().begin(), map.get_local_container().end());
+  std::sort(g.begin(), g.end());
+  std::sort(m.begin(), m.end());
+  EXPECT_EQ(g, m);
+}
+
+TEST(ConsumeInsertTest, unordered_map)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> kmers = make_kmers(comm);
+  std::vector<std::pair<KmerType, int> > input;
+  for (size_t i = 0; i < kmers.size(); ++i) input.emplace_back(kmers[i], 1);
+  std::vector<std::pair<KmerType, int> > input2 = input;
+
+  ::dsc::unordered_map<KmerType, int, Params> gold(comm);
+  gold.insert(input);
+
+  ::dsc::unordered_map<KmerType, int, Params> map(comm);
+  map.insert(std::move(input2));
+  EXPECT_TRUE(input2.empty());
+
+  EXPECT_EQ(gold.size(), map.size());
+}
+
+TEST(ConsumeInsertTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> input = make_kmers(comm);
+  std::vector<KmerType> input2 = input;
+
+  ::dsc::counting_densehash_map<KmerType, size_t, Params, DenseKeys> gold(comm);
+  gold.insert(input);
+
+  ::dsc::counting_densehash_map<KmerType, size_t, Params, DenseKeys> map(comm);
+  map.insert(std::move(input2));
+  EXPECT_TRUE(input2.empty());
+
+  ASSERT_EQ(gold.size(), map.size());
+  EXPECT_EQ(local_entries(gold), local_entries(map));
+
+  // a second batch adds to the counts.
+  input = make_kmers(comm);
+  input2 = input;
+  gold.insert(input);
+  map.insert(std::move(input2));
+  EXPECT_EQ(local_entries(gold), local_entries(map));
+}
+
+TEST(ConsumeInsertTest, densehash_maps)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> kmers = make_kmers(comm);
+  std::vector<std::pair<KmerType, int> > input;
+  for (size_t i = 0; i < kmers.size(); ++i) input.emplace_back(kmers[i], 1);
+
+  std::vector<std::pair<KmerType, int> > in = input, in2 = input;
+  ::dsc::densehash_map<KmerType, int, Params, DenseKeys> gold(comm);
+  gold.insert(in);
+  ::dsc::densehash_map<KmerType, int, Params, DenseKeys> map(comm);
+  map.insert(std::move(in2));
+  EXPECT_TRUE(in2.empty());
+  EXPECT_EQ(gold.size(), map.size());
+
+  in = input;
+  in2 = input;
+  ::dsc::reduction_densehash_map<KmerType, int, Params, DenseKeys, ::std::plus<int> > rgold(comm);
+  rgold.insert(in);
+  ::dsc::reduction_densehash_map<KmerType, int, Params, DenseKeys, ::std::plus<int> > rmap(comm);
+  rmap.insert(std::move(in2));
+  EXPECT_TRUE(in2.empty());
+  ASSERT_EQ(rgold.size(), rmap.size());
+  EXPECT_EQ(local_entries(rgold), local_entries(rmap));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_count_each.cpp
+ * @ingroup
+ * @brief   tests the per query counts and values of the hashed maps, in query order, against the allgathered entries.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using CanonicalParams = ::dsc::HashMapParams<Key, ::bliss::kmer::transform::lex_less, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+
+/// random kmers from a small pool, so there are repeats on each rank and across ranks.
+static std::vector<KmerType> make_kmers(::mxx::comm const & comm, size_t const & n, unsigned int const & pool_seed,
+                                        unsigned int const & seed) {
+  srand(pool_seed);
+  std::vector<KmerType> pool;
+  KmerType km;
+  for (size_t i = 0; i < 200; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    pool.emplace_back(km);
+  }
+  srand(seed + 1 + comm.rank());
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < n; ++i) kmers.emplace_back(pool[rand() % pool.size()]);
+  return kmers;
+}
+
+template <typename Map, typename Trans>
+static void check_count_each(Map & map, ::mxx::comm const & comm) {
+  std::vector<KmerType> input = make_kmers(comm, 1000, 13, 1);
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  for (size_t i = 0; i < input.size(); ++i) entries.emplace_back(input[i], i);
+  map.insert(entries);
+
+  // all entries, and the queries:  many repeats, some not in the map.
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  map.to_vector(local);
+  auto all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end());
+
+  std::vector<KmerType> queries = make_kmers(comm, 3000, 13, 7);
+  std::vector<KmerType> extra = make_kmers(comm, 100, 31, 1);
+  queries.insert(queries.end(), extra.begin(), extra.end());
+  std::vector<KmerType> original(queries);
+
+  auto results = map.count_each(queries);
+  EXPECT_TRUE(original == queries);
+  ASSERT_EQ(queries.size(), results.size());
+
+  Trans trans;
+  size_t found = 0;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    KmerType t = trans(queries[i]);
+    auto r = std::equal_range(all.begin(), all.end(), std::make_pair(t, static_cast<uint32_t>(0)),
+                              [](std::pair<KmerType, uint32_t> const & x, std::pair<KmerType, uint32_t> const & y) {
+      return x.first < y.first;
+    });
+    EXPECT_EQ(static_cast<size_t>(std::distance(r.first, r.second)), results[i]) << "query " << i;
+    found += (results[i] > 0) ? 1 : 0;
+  }
+  EXPECT_GT(::mxx::allreduce(found, comm), 0UL);
+
+  // same counts without deduplication, with only the counts sent back.
+  auto values = map.count_values(queries);
+  EXPECT_TRUE(original == queries);
+  EXPECT_TRUE(results == values);
+
+  // empty queries on some ranks
+  std::vector<KmerType> none;
+  if (comm.rank() % 2 == 1) queries.swap(none);
+  results = map.count_each(queries);
+  EXPECT_EQ(queries.size(), results.size());
+  values = map.count_values(queries);
+  EXPECT_EQ(queries.size(), values.size());
+}
+
+/// element predicate, values above 500.
+struct Big {
+  bool operator()(std::pair<KmerType, uint32_t> const & x) const { return x.second > 500; }
+  template <typename Iter>
+  bool operator()(Iter, Iter) const { return true; }
+};
+
+/// values by position for unique key maps:  the value of each query, or the sentinel.
+template <typename Map, typename Trans>
+static void check_find_values(Map & map, ::mxx::comm const & comm) {
+  std::vector<KmerType> input = make_kmers(comm, 1000, 13, 1);
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  for (size_t i = 0; i < input.size(); ++i) entries.emplace_back(input[i], i + 1);
+  map.insert(entries);
+
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  map.to_vector(local);
+  auto all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end());
+
+  std::vector<KmerType> queries = make_kmers(comm, 2000, 13, 5);
+  std::vector<KmerType> extra = make_kmers(comm, 100, 31, 1);
+  queries.insert(queries.end(), extra.begin(), extra.end());
+
+  uint32_t const none = ::std::numeric_limits<uint32_t>::max();
+  auto values = map.find_values(queries, none);
+  ASSERT_EQ(queries.size(), values.size());
+
+  Trans trans;
+  size_t found = 0;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    auto it = std::lower_bound(all.begin(), all.end(), std::make_pair(trans(queries[i]), static_cast<uint32_t>(0)));
+    uint32_t gold = ((it != all.end()) && (it->first == trans(queries[i]))) ? it->second : none;
+    EXPECT_EQ(gold, values[i]) << "query " << i;
+    found += (values[i] != none) ? 1 : 0;
+  }
+  EXPECT_GT(::mxx::allreduce(found, comm), 0UL);
+  EXPECT_LT(::mxx::allreduce(found, comm), ::mxx::allreduce(queries.size(), comm));
+
+  // filtered:  values above a threshold only.
+  auto filtered = map.find_values(queries, none, Big());
+  ASSERT_EQ(queries.size(), filtered.size());
+  for (size_t i = 0; i < queries.size(); ++i)
+    EXPECT_EQ(((values[i] != none) && (values[i] > 500)) ? values[i] : none, filtered[i]);
+}
+
+
+TEST(CountEachTest, map)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_map<KmerType, uint32_t, Params> map(comm);
+  check_count_each<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(CountEachTest, multimap)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, Params> map(comm);
+  check_count_each<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(CountEachTest, multimap_heavy)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, Params> map(comm);
+
+  // a heavy key, and so spread over all ranks.
+  KmerType heavy;
+  for (size_t j = 0; j < KmerType::size; ++j) heavy.nextFromChar(j % 4);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 500; ++i) input.emplace_back(heavy, i + 1000 * comm.rank());
+  map.insert(input);
+  map.find_heavy_hitters(100);
+  EXPECT_EQ(1UL, map.heavy_size());
+
+  std::vector<KmerType> queries(3, heavy);
+  auto results = map.count_each(queries);
+  ASSERT_EQ(3UL, results.size());
+  for (auto const & x : results) EXPECT_EQ(500UL * comm.size(), x);
+  results = map.count_values(queries);
+  ASSERT_EQ(3UL, results.size());
+  for (auto const & x : results) EXPECT_EQ(500UL * comm.size(), x);
+
+  check_count_each<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(CountEachTest, find_values)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_map<KmerType, uint32_t, Params> map(comm);
+  check_find_values<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(CountEachTest, find_values_canonical)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_map<KmerType, uint32_t, CanonicalParams> map(comm);
+  check_find_values<decltype(map), ::bliss::kmer::transform::lex_less<KmerType> >(map, comm);
+}
+
+TEST(CountEachTest, counting_canonical)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> map(comm);
+  check_count_each<decltype(map), ::bliss::kmer::transform::lex_less<KmerType> >(map, comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
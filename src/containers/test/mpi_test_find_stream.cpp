@@ -0,0 +1,205 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_find_stream.cpp
+ * @ingroup
+ * @brief   tests that the chunks of find_stream of the hashed maps together are the results of find, and that each
+ *          chunk is bounded.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using DenseMultiMap = ::dsc::densehash_multimap<KmerType, uint32_t, Params, DenseKeys>;
+using CountMap = ::dsc::counting_unordered_map<KmerType, uint32_t, Params>;
+using MultiMap = ::dsc::unordered_multimap<KmerType, uint32_t, Params>;
+
+using V = std::pair<KmerType, uint32_t>;
+
+/// kmers with repeats, a different part on each rank.
+std::vector<KmerType> make_kmers(size_t n, unsigned int seed, ::mxx::comm const & comm) {
+  std::default_random_engine generator(seed + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    if (i % 3 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+template <typename Map>
+void fill(Map & map, std::vector<KmerType> & kmers, ::mxx::comm const &) {
+  map.insert(kmers);
+}
+
+template <typename Map>
+void fill_pairs(Map & map, std::vector<KmerType> & kmers, ::mxx::comm const & comm) {
+  std::vector<V> entries;
+  for (size_t i = 0; i < kmers.size(); ++i) entries.emplace_back(kmers[i], static_cast<uint32_t>(comm.rank() * kmers.size() + i));
+  map.insert(entries);
+}
+void fill(DenseMultiMap & map, std::vector<KmerType> & kmers, ::mxx::comm const & comm) { fill_pairs(map, kmers, comm); }
+void fill(MultiMap & map, std::vector<KmerType> & kmers, ::mxx::comm const & comm) { fill_pairs(map, kmers, comm); }
+
+void sort_entries(std::vector<V> & x) {
+  std::sort(x.begin(), x.end(), [](V const & a, V const & b) {
+    return (a.first < b.first) || ((a.first == b.first) && (a.second < b.second));
+  });
+}
+
+/**
+ * the union of the chunks of find_stream is the result of find on each process.
+ * each chunk has at most p x chunk results for maps with at most 1 result per key.
+ */
+template <typename Map>
+void check_find_stream(bool compress, bool unique_keys, ::mxx::comm const & comm) {
+  Map map(comm);
+  map.set_compress_find(compress);
+  std::vector<KmerType> kmers = make_kmers(3000, 13, comm);
+  fill(map, kmers, comm);
+
+  // half present, half absent, with repeats.
+  std::vector<KmerType> query = make_kmers(1000, 13, comm);
+  std::vector<KmerType> absent = make_kmers(1000, 71, comm);
+  query.insert(query.end(), absent.begin(), absent.end());
+
+  std::vector<KmerType> q = query;
+  std::vector<V> gold = map.find(q);
+  sort_entries(gold);
+
+  for (size_t chunk : {1UL, 37UL, 1UL << 20}) {
+    q = query;
+    std::vector<V> test;
+    size_t calls = 0;
+    size_t max_chunk = 0;
+    map.find_stream(q, [&test, &calls, &max_chunk](std::vector<V> & results) {
+      EXPECT_FALSE(results.empty());
+      test.insert(test.end(), results.begin(), results.end());
+      max_chunk = std::max(max_chunk, results.size());
+      ++calls;
+    }, chunk);
+    sort_entries(test);
+
+    EXPECT_EQ(gold, test);
+    if (unique_keys) {
+      EXPECT_GE(static_cast<size_t>(comm.size()) * chunk, max_chunk);
+    }
+    // small chunks take several rounds.
+    if ((chunk == 1UL) && (gold.size() > static_cast<size_t>(comm.size()))) {
+      EXPECT_LT(1UL, calls);
+    }
+  }
+}
+
+TEST(FindStreamTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  check_find_stream<CountDenseMap>(false, true, comm);
+  check_find_stream<CountDenseMap>(true, true, comm);
+}
+
+TEST(FindStreamTest, densehash_multimap)
+{
+  ::mxx::comm comm;
+  check_find_stream<DenseMultiMap>(false, false, comm);
+  check_find_stream<DenseMultiMap>(true, false, comm);
+}
+
+TEST(FindStreamTest, counting_unordered_map)
+{
+  ::mxx::comm comm;
+  check_find_stream<CountMap>(false, true, comm);
+  check_find_stream<CountMap>(true, true, comm);
+}
+
+TEST(FindStreamTest, unordered_multimap)
+{
+  ::mxx::comm comm;
+  check_find_stream<MultiMap>(false, false, comm);
+  check_find_stream<MultiMap>(true, false, comm);
+}
+
+TEST(FindStreamTest, empty_query)
+{
+  ::mxx::comm comm;
+  CountDenseMap map(comm);
+  std::vector<KmerType> kmers = make_kmers(100, 13, comm);
+  map.insert(kmers);
+
+  std::vector<KmerType> q;
+  size_t calls = 0;
+  map.find_stream(q, [&calls](std::vector<V> &) { ++calls; }, 8);
+  EXPECT_EQ(0UL, calls);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_frozen_map.cpp
+ * @ingroup
+ * @brief   tests that a frozen distributed map answers find and count as its source map.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+/// kmers 0..n-1, from the same seed on all processes.
+std::vector<KmerType> make_kmers(size_t n) {
+  std::default_random_engine generator(23);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  return kmers;
+}
+
+
+TEST(FrozenMapTest, find_count)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(20000);
+
+  // first half in the map, value i.  each process inserts a part.
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (size_t i = comm.rank(); i < 10000; i += comm.size()) input.emplace_back(kmers[i], i);
+  std::map<KmerType, uint32_t> gold;
+  for (size_t i = 0; i < 10000; ++i) gold[kmers[i]] = i;
+
+  ::dsc::unordered_map<KmerType, uint32_t, Params> m(comm);
+  m.insert(input);
+
+  // 32 bit fingerprints, so the absent kmers are not expected to be reported.
+  auto frozen = m.freeze<uint32_t>();
+  EXPECT_EQ(gold.size(), frozen.size());
+  EXPECT_EQ(m.local_size(), frozen.local_size());
+  EXPECT_TRUE(frozen.get_bucket_table() == m.get_bucket_table());
+  EXPECT_THROW(frozen.to_vector(), std::logic_error);
+
+  // each process queries part of all the kmers.
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+
+  std::vector<KmerType> q(query);
+  auto found = frozen.find(q);
+  q = query;
+  auto gold_found = m.find(q);
+  EXPECT_EQ(gold_found.size(), found.size());
+  for (auto const & x : found) {
+    EXPECT_EQ(gold.at(x.first), x.second);
+  }
+
+  q = query;
+  auto counted = frozen.count(q);
+  EXPECT_EQ(query.size(), counted.size());
+  size_t present = 0;
+  for (auto const & x : counted) {
+    EXPECT_EQ(gold.count(x.first), x.second);
+    present += x.second;
+  }
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(present, comm));
+
+  // still valid after the source map is cleared.
+  m.clear();
+  q = query;
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(frozen.find(q).size(), comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_frozen_sorted_map.cpp
+ * @ingroup
+ * @brief   tests that a frozen sorted multimap answers find and count as its source map.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <map>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+/// kmers from the same seed on all processes.
+std::vector<KmerType> make_kmers(size_t n) {
+  std::default_random_engine generator(29);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  return kmers;
+}
+
+
+TEST(FrozenSortedMapTest, multimap_find_count)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(4000);
+
+  // the first 2000 kmers, kmer i with (i % 7) + 1 entries.  kmer 0 has many, so it spans processes.
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  std::multimap<KmerType, uint32_t> gold;
+  size_t j = 0;
+  for (size_t i = 0; i < 2000; ++i) {
+    size_t reps = (i == 0) ? 3000 : (i % 7) + 1;
+    for (size_t r = 0; r < reps; ++r, ++j) {
+      gold.emplace(kmers[i], j);
+      if (j % comm.size() == static_cast<size_t>(comm.rank())) input.emplace_back(kmers[i], j);
+    }
+  }
+
+  ::dsc::sorted_multimap<KmerType, uint32_t, SortParams> m(comm);
+  m.insert(input);
+
+  auto frozen = m.freeze();
+  EXPECT_EQ(gold.size(), frozen.size());
+  EXPECT_EQ(m.local_size(), frozen.local_size());
+  EXPECT_EQ(m.get_local_container().size(), frozen.get_local_container().size());
+
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+
+  std::vector<KmerType> q(query);
+  auto found = frozen.find(q);
+  size_t expected = 0;
+  for (auto const & k : query) expected += gold.count(k);
+  EXPECT_EQ(expected, found.size());
+  for (auto const & x : found) {
+    auto r = gold.equal_range(x.first);
+    bool present = false;
+    for (auto it = r.first; it != r.second; ++it) present |= (it->second == x.second);
+    EXPECT_TRUE(present);
+  }
+
+  q = query;
+  auto counted = frozen.count(q);
+  EXPECT_EQ(query.size(), counted.size());
+  for (auto const & x : counted) {
+    EXPECT_EQ(gold.count(x.first), x.second);
+  }
+
+  // same entries as the source, in the same order.
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  frozen.to_vector(entries);
+  ASSERT_EQ(m.get_local_container().size(), entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(m.get_local_container()[i].first, entries[i].first);
+  }
+
+  // still valid after the source map is cleared.
+  m.clear();
+  q = query;
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(frozen.find(q).size(), comm));
+}
+
+TEST(FrozenSortedMapTest, map_count)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(4000);
+
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (size_t i = comm.rank(); i < 2000; i += comm.size()) input.emplace_back(kmers[i], i);
+  std::map<KmerType, uint32_t> gold;
+  for (size_t i = 0; i < 2000; ++i) gold.emplace(kmers[i], i);
+
+  ::dsc::sorted_map<KmerType, uint32_t, SortParams> m(comm);
+  m.insert(input);
+  auto frozen = m.freeze();
+
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+
+  std::vector<KmerType> q(query);
+  auto found = frozen.find(q);
+  for (auto const & x : found) EXPECT_EQ(gold.at(x.first), x.second);
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(found.size(), comm));
+
+  q = query;
+  auto counted = frozen.count(q);
+  EXPECT_EQ(query.size(), counted.size());
+  for (auto const & x : counted) EXPECT_EQ(gold.count(x.first), x.second);
+  EXPECT_EQ(gold.size(), frozen.unique_size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_heavy_hitters.cpp
+ * @ingroup
+ * @brief   tests the heavy key directory, and spreading and querying entries over all ranks.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "containers/heavy_hitters.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+TEST(HeavyHittersTest, directory)
+{
+  ::mxx::comm comm;
+  ::dsc::heavy_key_directory<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t> > dir;
+
+  // each rank contributes 1 heavy key.
+  std::vector<std::pair<uint64_t, size_t> > local(1, std::make_pair(static_cast<uint64_t>(100 + comm.rank()), static_cast<size_t>(10)));
+  dir.add(local, comm);
+  ASSERT_EQ(static_cast<size_t>(comm.size()), dir.size());
+  for (int r = 0; r < comm.size(); ++r) {
+    EXPECT_EQ(static_cast<uint64_t>(100 + r), dir.key(r));
+    EXPECT_EQ(static_cast<size_t>(r), dir.find(100 + r));
+  }
+  EXPECT_EQ(dir.size(), dir.find(1));
+
+  // split an insert batch, and count the heavy part.
+  std::vector<std::pair<uint64_t, int> > input;
+  for (int i = 0; i < 20; ++i) input.emplace_back((i % 2 == 0) ? 100 : i, i);
+  std::vector<std::pair<uint64_t, int> > heavy_input;
+  dir.extract(input, heavy_input);
+  EXPECT_EQ(10UL, input.size());
+  EXPECT_EQ(10UL, heavy_input.size());
+  for (auto const & x : input) EXPECT_NE(100UL, x.first);
+
+  dir.add_counts(dir.tally(heavy_input), comm);
+  EXPECT_EQ(10UL + 10UL * comm.size(), dir.count(0));
+
+  // heavy queries are moved out, transformed.
+  std::vector<uint64_t> queries = {1, 2, 50, 3};
+  std::vector<uint64_t> heavy_queries;
+  dir.extract_keys(queries, heavy_queries, [](uint64_t const & x) { return x * 2; });
+  EXPECT_EQ(std::vector<uint64_t>({1, 2, 3}), queries);
+  EXPECT_EQ(std::vector<uint64_t>({100}), heavy_queries);
+
+  // keys with no entries left are dropped.
+  std::vector<size_t> counts(dir.size(), 1);
+  counts[0] = 0;
+  dir.recount(counts, comm);
+  ASSERT_EQ(static_cast<size_t>(comm.size() - 1), dir.size());
+  EXPECT_EQ(dir.size(), dir.find(100));
+  for (size_t i = 0; i < dir.size(); ++i) {
+    EXPECT_EQ(101 + i, dir.key(i));
+    EXPECT_EQ(i, dir.find(101 + i));
+    EXPECT_EQ(static_cast<size_t>(comm.size()), dir.count(i));
+  }
+}
+
+TEST(HeavyHittersTest, spread_query)
+{
+  ::mxx::comm comm;
+  int p = comm.size();
+
+  // all entries of key 7 start on rank 0.
+  std::vector<std::pair<uint64_t, uint32_t> > entries;
+  size_t n = 1000 + 7;
+  if (comm.rank() == 0)
+    for (uint32_t i = 0; i < n; ++i) entries.emplace_back(7, i);
+
+  std::vector<std::pair<uint64_t, uint32_t> > spread = ::dsc::spread_evenly(entries, comm);
+  EXPECT_LE(spread.size(), (n + p - 1) / p);
+  EXPECT_GE(spread.size(), n / p);
+  EXPECT_EQ(n, ::mxx::allreduce(spread.size(), comm));
+
+  // each rank's queries are answered by all ranks from their shares.
+  std::unordered_multimap<uint64_t, uint32_t> local(spread.begin(), spread.end());
+  std::vector<uint64_t> queries = {7, 8};
+  auto results = ::dsc::query_all<uint64_t, std::pair<uint64_t, uint32_t> >(queries,
+      [&local](uint64_t const & k, std::vector<std::pair<uint64_t, uint32_t> > & out) {
+        auto range = local.equal_range(k);
+        out.insert(out.end(), range.first, range.second);
+      }, comm);
+  ASSERT_EQ(n, results.size());
+  std::sort(results.begin(), results.end());
+  for (uint32_t i = 0; i < n; ++i) {
+    EXPECT_EQ(7UL, results[i].first);
+    EXPECT_EQ(i, results[i].second);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
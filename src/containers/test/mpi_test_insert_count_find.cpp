@@ -0,0 +1,186 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_insert_count_find.cpp
+ * @ingroup
+ * @brief   tests that insert_count_find of the densehash maps gives the same map, counts and results as a separate
+ *          insert, count and find.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+using DenseMap = ::dsc::densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+
+using V = std::pair<KmerType, uint32_t>;
+
+/// kmers with repeats, a different part on each rank.
+std::vector<KmerType> make_kmers(size_t n, unsigned int seed, ::mxx::comm const & comm) {
+  std::default_random_engine generator(seed + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    if (i % 3 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+/// entries to insert.  the value depends only on the key, so it is the same whichever repeat the map keeps.
+std::vector<V> make_entries(DenseMap const &, std::vector<KmerType> const & kmers) {
+  std::vector<V> entries;
+  for (auto const & k : kmers) entries.emplace_back(k, static_cast<uint32_t>(k.getData()[0]));
+  return entries;
+}
+/// a count of 1 per occurrence.
+std::vector<V> make_entries(CountDenseMap const &, std::vector<KmerType> const & kmers) {
+  std::vector<V> entries;
+  for (auto const & k : kmers) entries.emplace_back(k, 1);
+  return entries;
+}
+
+/// all elements, on all processes, sorted.
+template <typename T>
+std::vector<T> all_sorted(std::vector<T> const & local, ::mxx::comm const & comm) {
+  std::vector<T> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](T const & x, T const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return all;
+}
+
+template <typename Map>
+std::vector<V> all_entries(Map const & map, ::mxx::comm const & comm) {
+  std::vector<V> local;
+  map.to_vector(local);
+  return all_sorted(local, comm);
+}
+
+/// 2 rounds, the second on a non empty map.  the queries overlap the inserts of the same round.
+template <typename Map>
+void check_insert_count_find(::mxx::comm const & comm) {
+  Map gold(comm);
+  Map test(comm);
+
+  for (unsigned int round = 0; round < 2; ++round) {
+    std::vector<V> input = make_entries(gold, make_kmers(2000, 5 + round, comm));
+    std::vector<KmerType> count_keys = make_kmers(300, 5 + round, comm);
+    std::vector<KmerType> absent = make_kmers(300, 61 + round, comm);
+    count_keys.insert(count_keys.end(), absent.begin(), absent.end());
+    std::vector<KmerType> find_keys = make_kmers(300, 5, comm);
+    absent = make_kmers(300, 83 + round, comm);
+    find_keys.insert(find_keys.end(), absent.begin(), absent.end());
+
+    // separate operations, deduplicated queries as in insert_count_find.
+    std::vector<V> input2 = input;
+    std::vector<KmerType> count_keys2 = count_keys, find_keys2 = find_keys;
+    gold.insert(input2);
+    auto gold_counts = gold.template count<true>(count_keys2);
+    auto gold_found = gold.template find<true>(find_keys2);
+
+    std::vector<std::pair<KmerType, typename Map::size_type> > test_counts;
+    auto test_found = test.insert_count_find(input, count_keys, find_keys, test_counts);
+
+    EXPECT_EQ(gold.size(), test.size());
+    EXPECT_EQ(all_entries(gold, comm), all_entries(test, comm));
+    EXPECT_EQ(all_sorted(gold_counts, comm), all_sorted(test_counts, comm));
+    EXPECT_EQ(all_sorted(gold_found, comm), all_sorted(test_found, comm));
+  }
+}
+
+TEST(InsertCountFindTest, densehash_map)
+{
+  ::mxx::comm comm;
+  check_insert_count_find<DenseMap>(comm);
+}
+
+TEST(InsertCountFindTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  check_insert_count_find<CountDenseMap>(comm);
+}
+
+TEST(InsertCountFindTest, empty)
+{
+  ::mxx::comm comm;
+  CountDenseMap map(comm);
+
+  std::vector<V> input;
+  std::vector<KmerType> count_keys = make_kmers(10, 5, comm), find_keys;
+  std::vector<std::pair<KmerType, CountDenseMap::size_type> > counts;
+  auto found = map.insert_count_find(input, count_keys, find_keys, counts);
+
+  EXPECT_TRUE(found.empty());
+  EXPECT_EQ(0UL, map.size());
+  for (auto const & c : counts) EXPECT_EQ(0UL, c.second);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
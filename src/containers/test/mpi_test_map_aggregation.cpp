@@ -0,0 +1,126 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_map_aggregation.cpp
+ * @ingroup
+ * @brief   tests the value histogram, top n and map/reduce queries of the distributed counting maps.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+
+TEST(MapAggregationTest, histogram_top_n_map_reduce)
+{
+  ::mxx::comm comm;
+
+  // kmer i occurs (i % 10) + 1 times, except kmer 0 which occurs 100 times.  each process inserts a part.
+  std::vector<KmerType> kmers(500);
+  KmerType km;
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    for (size_t j = 0; j < 10; ++j) km.nextFromChar((i >> (2 * j)) & 3);
+    kmers[i] = km;
+  }
+  std::vector<KmerType> input;
+  size_t total = 0;
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    size_t c = (i == 0) ? 100 : ((i % 10) + 1);
+    for (size_t j = 0; j < c; ++j, ++total) {
+      if (static_cast<int>(total % comm.size()) == comm.rank()) input.emplace_back(kmers[i]);
+    }
+  }
+
+  ::dsc::counting_unordered_map<KmerType, size_t, Params> map(comm);
+  map.insert(input);
+  ASSERT_EQ(kmers.size(), map.size());
+
+  // spectrum:  50 kmers of each count 1..10, 1 less for count 1 since kmer 0 is at 100.
+  std::vector<size_t> hist = map.histogram(20);
+  ASSERT_EQ(21UL, hist.size());
+  EXPECT_EQ(0UL, hist[0]);
+  EXPECT_EQ(49UL, hist[1]);
+  for (size_t i = 2; i <= 10; ++i) EXPECT_EQ(50UL, hist[i]);
+  EXPECT_EQ(1UL, hist[20]);
+
+  // top 6:  kmer 0, then 5 kmers with count 10.  same on all processes.
+  auto top = map.top_n(6);
+  ASSERT_EQ(6UL, top.size());
+  EXPECT_EQ(kmers[0], top[0].first);
+  EXPECT_EQ(100UL, top[0].second);
+  for (size_t i = 1; i < top.size(); ++i) EXPECT_EQ(10UL, top[i].second);
+  EXPECT_TRUE(::mxx::all_of(top[5].first == ::mxx::bcast(top[5].first, 0, comm), comm));
+  EXPECT_EQ(kmers.size(), map.top_n(1000).size());
+  EXPECT_EQ(0UL, map.top_n(0).size());
+
+  // total count, and number of kmers with count above 5.
+  size_t sum = map.map_reduce([](std::pair<const KmerType, size_t> const & x) { return x.second; }, std::plus<size_t>(), 0UL);
+  EXPECT_EQ(total, sum);
+  size_t above = map.map_reduce([](std::pair<const KmerType, size_t> const & x) { return (x.second > 5) ? 1UL : 0UL; }, std::plus<size_t>(), 0UL);
+  EXPECT_EQ(251UL, above);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_map_save_load.cpp
+ * @ingroup
+ * @brief   tests the MPI-IO save and load of the distributed maps, with the same and with a different number of
+ *          processes, and the partition id check of the per process files.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <unistd.h>  // getpid
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "io/io_exception.hpp"
+#include "containers/bucket_table.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using SortedParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using CountMap = ::dsc::counting_unordered_map<KmerType, uint32_t, Params>;
+using MultiMap = ::dsc::unordered_multimap<KmerType, uint32_t, Params>;
+using CountSortedMap = ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams>;
+
+
+/// kmers with repeats, a different part on each rank.
+std::vector<KmerType> make_kmers(size_t n, ::mxx::comm const & comm) {
+  std::default_random_engine generator(31 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    if (i % 3 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+std::vector<std::pair<KmerType, uint32_t> > make_entries(size_t n, ::mxx::comm const & comm) {
+  std::vector<KmerType> kmers = make_kmers(n, comm);
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  for (size_t i = 0; i < kmers.size(); ++i) entries.emplace_back(kmers[i], static_cast<uint32_t>(comm.rank() * n + i));
+  return entries;
+}
+
+template <typename Map>
+void fill(Map & map, size_t n, ::mxx::comm const & comm) {
+  std::vector<KmerType> kmers = make_kmers(n, comm);
+  map.insert(kmers);
+}
+
+void fill(MultiMap & map, size_t n, ::mxx::comm const & comm) {
+  std::vector<std::pair<KmerType, uint32_t> > entries = make_entries(n, comm);
+  map.insert(entries);
+}
+
+/// all entries, sorted.
+template <typename Map>
+std::vector<std::pair<KmerType, uint32_t> > all_entries(Map const & map, ::mxx::comm const & comm) {
+  using V = std::pair<KmerType, uint32_t>;
+  std::vector<V> local;
+  map.to_vector(local);
+  std::vector<V> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](V const & x, V const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return all;
+}
+
+/// sorted local entries.
+template <typename Map>
+std::vector<std::pair<KmerType, uint32_t> > local_entries(Map const & map) {
+  using V = std::pair<KmerType, uint32_t>;
+  std::vector<V> local;
+  map.to_vector(local);
+  std::sort(local.begin(), local.end(), [](V const & x, V const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return local;
+}
+
+/// a file name that is the same on all processes of comm.
+std::string temp_name(std::string const & tag, ::mxx::comm const & comm) {
+  std::stringstream ss;
+  ss << "./bliss_map_save_load." << tag << "." << ::mxx::bcast(static_cast<int>(getpid()), 0, comm) << ".bin";
+  return ss.str();
+}
+
+/**
+ * save with all processes, then load with the same processes, with the first p - 1, and with the last 1.
+ * then save with the first p - 1 and load with all.
+ */
+template <typename Map>
+void check_save_load(::mxx::comm const & comm) {
+  std::string filename = temp_name("all", comm);
+
+  Map map(comm);
+  fill(map, 3000, comm);
+  auto gold = all_entries(map, comm);
+  map.save(filename);
+
+  // same number of processes:  every process gets back its own entries.
+  {
+    Map loaded(comm);
+    fill(loaded, 10, comm);   // replaced by load.
+    loaded.load(filename);
+    EXPECT_EQ(map.size(), loaded.size());
+    EXPECT_EQ(local_entries(map), local_entries(loaded));
+  }
+
+  if (comm.size() > 1) {
+    std::string subname = temp_name("sub", comm);
+
+    // fewer processes:  redistributed as read.
+    ::mxx::comm sub = comm.split((comm.rank() < comm.size() - 1) ? 0 : 1);
+    {
+      Map loaded(sub);
+      loaded.load(filename);
+      EXPECT_EQ(gold, all_entries(loaded, sub));
+
+      // and saved with p - 1, loaded with p.
+      if (comm.rank() < comm.size() - 1) loaded.save(subname);
+    }
+    comm.barrier();
+    {
+      Map loaded(comm);
+      loaded.load(subname);
+      EXPECT_EQ(gold, all_entries(loaded, comm));
+    }
+    comm.barrier();
+    if (comm.rank() == 0) remove(subname.c_str());
+  }
+
+  comm.barrier();
+  if (comm.rank() == 0) remove(filename.c_str());
+}
+
+TEST(MapSaveLoadTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  check_save_load<CountDenseMap>(comm);
+}
+
+TEST(MapSaveLoadTest, counting_unordered_map)
+{
+  ::mxx::comm comm;
+  check_save_load<CountMap>(comm);
+}
+
+TEST(MapSaveLoadTest, unordered_multimap)
+{
+  ::mxx::comm comm;
+  check_save_load<MultiMap>(comm);
+}
+
+TEST(MapSaveLoadTest, counting_sorted_map)
+{
+  ::mxx::comm comm;
+  check_save_load<CountSortedMap>(comm);
+}
+
+TEST(MapSaveLoadTest, not_a_map)
+{
+  ::mxx::comm comm;
+  std::string filename = temp_name("bad", comm);
+  if (comm.rank() == 0) {
+    FILE * f = fopen(filename.c_str(), "wb");
+    fputs("not a saved map", f);
+    fclose(f);
+  }
+  comm.barrier();
+
+  CountDenseMap map(comm);
+  EXPECT_THROW(map.load(filename), ::bliss::io::IOException);
+
+  comm.barrier();
+  if (comm.rank() == 0) remove(filename.c_str());
+}
+
+/// a map with a different bucket table has a different partition id.
+template <typename Map>
+void check_partition_id(::mxx::comm const & comm) {
+  std::vector<double> weights;
+  for (int i = 0; i < comm.size(); ++i) weights.emplace_back(static_cast<double>(i + 1));
+  ::dsc::bucket_table skewed = ::dsc::bucket_table::weighted(weights);
+
+  Map map(comm);
+  fill(map, 3000, comm);
+  auto gold = all_entries(map, comm);
+
+  Map other(comm);
+  other.set_bucket_table(skewed);
+  ASSERT_NE(map.get_bucket_table().id(), other.get_bucket_table().id());
+
+  // the collective load redistributes when the partition ids differ.
+  std::string filename = temp_name("pid", comm);
+  map.save(filename);
+  other.load(filename);
+  EXPECT_EQ(gold, all_entries(other, comm));
+  comm.barrier();
+  if (comm.rank() == 0) remove(filename.c_str());
+
+  // a per process file is only loaded with the same partition id.
+  std::stringstream ss;
+  ss << temp_name("local", comm) << "." << comm.rank();
+  map.save_local(ss.str());
+
+  Map same(comm);
+  same.load_local(ss.str());
+  EXPECT_EQ(local_entries(map), local_entries(same));
+
+  EXPECT_THROW(other.load_local(ss.str()), ::bliss::io::IOException);
+  remove(ss.str().c_str());
+}
+
+TEST(MapSaveLoadTest, partition_id_densehash)
+{
+  ::mxx::comm comm;
+  if (comm.size() == 1) return;   // 1 table only.
+  check_partition_id<CountDenseMap>(comm);
+}
+
+TEST(MapSaveLoadTest, partition_id_unordered)
+{
+  ::mxx::comm comm;
+  if (comm.size() == 1) return;
+  check_partition_id<CountMap>(comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_map_set_ops.cpp
+ * @ingroup
+ * @brief   tests set intersection, difference, union and join of distributed hash maps, co-partitioned or not.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+template <typename Key>
+using DistFarm = ::bliss::kmer::hash::farm<Key, true>;
+template <typename Key>
+using StoreFarm = ::bliss::kmer::hash::farm<Key, false>;
+
+template <typename Key>
+using ParamsA = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+template <typename Key>
+using ParamsB = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistFarm, ::std::equal_to, ::bliss::transform::identity, StoreFarm, ::std::equal_to>;
+
+/// kmers 0..n-1, from the same seed on all processes.
+std::vector<KmerType> make_kmers(size_t n) {
+  std::default_random_engine generator(17);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  return kmers;
+}
+
+
+TEST(MapSetOpsTest, intersect_difference_join)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(1000);
+
+  // a:  kmers [0, 600), value i.  b:  kmers [400, 1000), value i + 1, and twice in the multimap.
+  // each process inserts a part.
+  std::vector<std::pair<KmerType, uint32_t> > a_in, b_in;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) {
+    if (i < 600) a_in.emplace_back(kmers[i], i);
+    if (i >= 400) b_in.emplace_back(kmers[i], i + 1);
+  }
+  std::map<KmerType, uint32_t> gold_a, gold_b;
+  for (size_t i = 0; i < 600; ++i) gold_a[kmers[i]] = i;
+  for (size_t i = 400; i < 1000; ++i) gold_b[kmers[i]] = i + 1;
+
+  ::dsc::unordered_map<KmerType, uint32_t, ParamsA> a(comm);
+  ::dsc::unordered_map<KmerType, uint32_t, ParamsA> b(comm);
+  ::dsc::unordered_map<KmerType, uint32_t, ParamsB> b_farm(comm);
+  ::dsc::unordered_multimap<KmerType, uint32_t, ParamsB> b_multi(comm);
+  { auto x = a_in; a.insert(x); }
+  { auto x = b_in; b.insert(x); }
+  { auto x = b_in; b_farm.insert(x); }
+  { auto x = b_in; b_multi.insert(x); }
+  { auto x = b_in; b_multi.insert(x); }
+
+  EXPECT_TRUE(a.is_co_partitioned(b));
+  EXPECT_FALSE(a.is_co_partitioned(b_farm));
+
+  // co-partitioned and not:  same global results.
+  for (int j = 0; j < 2; ++j) {
+    auto inter = (j == 0) ? a.set_intersection(b) : a.set_intersection(b_farm);
+    auto diff = (j == 0) ? a.set_difference(b) : a.set_difference(b_farm);
+    auto joined = (j == 0) ? a.join(b) : a.join(b_farm);
+    auto uni = (j == 0) ? a.set_union(b) : a.set_union(b_farm);
+
+    auto all_inter = ::mxx::allgatherv(inter, comm);
+    auto all_diff = ::mxx::allgatherv(diff, comm);
+    auto all_join = ::mxx::allgatherv(joined, comm);
+    auto all_uni = ::mxx::allgatherv(uni, comm);
+
+    EXPECT_EQ(200UL, all_inter.size());
+    for (auto const & x : all_inter) {
+      EXPECT_EQ(gold_a.at(x.first), x.second);
+      EXPECT_EQ(1UL, gold_b.count(x.first));
+    }
+    EXPECT_EQ(400UL, all_diff.size());
+    for (auto const & x : all_diff) {
+      EXPECT_EQ(gold_a.at(x.first), x.second);
+      EXPECT_EQ(0UL, gold_b.count(x.first));
+    }
+    EXPECT_EQ(200UL, all_join.size());
+    for (auto const & x : all_join) {
+      EXPECT_EQ(gold_a.at(std::get<0>(x)), std::get<1>(x));
+      EXPECT_EQ(gold_b.at(std::get<0>(x)), std::get<2>(x));
+    }
+    std::set<KmerType> uni_set(all_uni.begin(), all_uni.end());
+    EXPECT_EQ(1000UL, all_uni.size());
+    EXPECT_EQ(1000UL, uni_set.size());
+
+    // results are local to a's partition.
+    std::vector<KmerType> local;
+    a.keys(local);
+    std::set<KmerType> local_set(local.begin(), local.end());
+    for (auto const & x : inter) EXPECT_EQ(1UL, local_set.count(x.first));
+  }
+
+  // join with a multimap:  1 tuple per match.
+  auto joined = a.join(b_multi);
+  EXPECT_EQ(400UL, ::mxx::allreduce(joined.size(), comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
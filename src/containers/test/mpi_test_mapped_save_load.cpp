@@ -0,0 +1,235 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_mapped_save_load.cpp
+ * @ingroup
+ * @brief   tests the round trip of save_mapped and load_mapped of the densehash and sorted maps, and that the files
+ *          are readable by the serial mapped maps.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <unistd.h>  // getpid
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "io/io_exception.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using SortedParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using CountSortedMap = ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams>;
+
+using V = std::pair<KmerType, uint32_t>;
+
+/// kmers with repeats, a different part on each rank.
+std::vector<KmerType> make_kmers(size_t n, ::mxx::comm const & comm) {
+  std::default_random_engine generator(17 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    if (i % 3 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+bool value_less(V const & x, V const & y) {
+  return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+}
+
+/// all entries, sorted.
+template <typename Map>
+std::vector<V> all_entries(Map const & map, ::mxx::comm const & comm) {
+  std::vector<V> local;
+  map.to_vector(local);
+  std::vector<V> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), value_less);
+  return all;
+}
+
+/// the found entries of the queries, on all processes, sorted.
+template <typename Map>
+std::vector<V> all_found(Map & map, std::vector<KmerType> & query, ::mxx::comm const & comm) {
+  std::vector<V> found = map.find(query);
+  std::vector<V> all = ::mxx::allgatherv(found, comm);
+  std::sort(all.begin(), all.end(), value_less);
+  return all;
+}
+
+/// a file name that is the same on all processes of comm.
+std::string temp_name(std::string const & tag, ::mxx::comm const & comm) {
+  std::stringstream ss;
+  ss << "./bliss_mapped_save_load." << tag << "." << ::mxx::bcast(static_cast<int>(getpid()), 0, comm) << ".bin";
+  return ss.str();
+}
+
+
+TEST(MappedSaveLoadTest, densehash_map)
+{
+  ::mxx::comm comm;
+  std::string filename = temp_name("hash", comm);
+  std::string local_name = filename + "." + std::to_string(comm.rank());
+
+  CountDenseMap map(comm);
+  std::vector<KmerType> kmers = make_kmers(3000, comm);
+  map.insert(kmers);
+  auto gold = all_entries(map, comm);
+
+  map.save_mapped(filename);
+
+  // each process's file is its partition, readable by the serial mapped map.
+  {
+    CountDenseMap::mapped_map_type mapped(local_name);
+    EXPECT_EQ(map.local_size(), mapped.size());
+
+    std::vector<V> local;
+    map.to_vector(local);
+    for (auto const & x : local) {
+      auto it = mapped.find(x.first);
+      ASSERT_TRUE(it != nullptr);
+      EXPECT_EQ(x.second, it->second);
+    }
+  }
+
+  // round trip.
+  CountDenseMap loaded(comm);
+  std::vector<KmerType> other = make_kmers(10, comm);
+  loaded.insert(other);   // replaced by load_mapped.
+  loaded.load_mapped(filename);
+
+  EXPECT_EQ(map.size(), loaded.size());
+  EXPECT_EQ(gold, all_entries(loaded, comm));
+
+  std::vector<KmerType> query = make_kmers(500, comm);
+  query.insert(query.end(), other.begin(), other.end());
+  std::vector<KmerType> query2 = query;
+  EXPECT_EQ(all_found(map, query, comm), all_found(loaded, query2, comm));
+
+  remove(local_name.c_str());
+  comm.barrier();
+
+  // a missing file is an error on all processes.
+  EXPECT_THROW(loaded.load_mapped(filename), ::bliss::io::IOException);
+}
+
+TEST(MappedSaveLoadTest, sorted_map)
+{
+  ::mxx::comm comm;
+  std::string filename = temp_name("sorted", comm);
+
+  CountSortedMap map(comm);
+  std::vector<KmerType> kmers = make_kmers(3000, comm);
+  map.insert(kmers);
+  auto gold = all_entries(map, comm);
+
+  map.save_mapped(filename);
+
+  // the file is the sorted array, readable by the serial mapped map.
+  {
+    CountSortedMap::mapped_map_type mapped(filename);
+    EXPECT_EQ(gold.size(), mapped.size());
+    EXPECT_TRUE(std::is_sorted(mapped.begin(), mapped.end(), value_less));
+    EXPECT_EQ(gold, std::vector<V>(mapped.begin(), mapped.end()));
+  }
+
+  // round trip.
+  {
+    CountSortedMap loaded(comm);
+    loaded.load_mapped(filename);
+
+    EXPECT_EQ(map.size(), loaded.size());
+    EXPECT_EQ(gold, all_entries(loaded, comm));
+
+    std::vector<KmerType> query = make_kmers(500, comm);
+    std::vector<KmerType> query2 = query;
+    EXPECT_EQ(all_found(map, query, comm), all_found(loaded, query2, comm));
+  }
+
+  // fewer processes.
+  if (comm.size() > 1) {
+    ::mxx::comm sub = comm.split((comm.rank() < comm.size() - 1) ? 0 : 1);
+    CountSortedMap loaded(sub);
+    loaded.load_mapped(filename);
+    EXPECT_EQ(gold, all_entries(loaded, sub));
+  }
+
+  comm.barrier();
+  if (comm.rank() == 0) remove(filename.c_str());
+  comm.barrier();
+
+  CountSortedMap missing(comm);
+  EXPECT_THROW(missing.load_mapped(filename), ::bliss::io::IOException);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_membership_filter.cpp
+ * @ingroup
+ * @brief   tests screening query keys with the distributed membership filter of a map, with and without replication.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <set>
+#include <random>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+/// kmers 0..n-1, from the same seed on all processes.
+std::vector<KmerType> make_kmers(size_t n) {
+  std::default_random_engine generator(23);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  return kmers;
+}
+
+
+TEST(MembershipFilterTest, screen_count)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(20000);
+
+  // first half in the map.  each process inserts a part.
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (size_t i = comm.rank(); i < 10000; i += comm.size()) input.emplace_back(kmers[i], i);
+  std::set<KmerType> gold;
+  for (size_t i = 0; i < 10000; ++i) gold.insert(kmers[i]);
+
+  ::dsc::unordered_map<KmerType, uint32_t, Params> m(comm);
+  m.insert(input);
+
+  // each process queries part of all the kmers.
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < kmers.size(); i += comm.size()) query.emplace_back(kmers[i]);
+
+  // 16 bit fingerprints, so the absent kmers are not expected to pass.
+  auto filter = m.membership_filter<uint16_t>();
+  EXPECT_FALSE(filter.is_replicated() && (comm.size() > 1));
+
+  std::vector<KmerType> q(query);
+  auto counted = filter.count(q);
+  EXPECT_EQ(query.size(), counted.size());
+  size_t present = 0;
+  for (auto const & x : counted) {
+    EXPECT_EQ(gold.count(x.first), x.second);
+    present += x.second;
+  }
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(present, comm));
+
+  // collective screen.
+  q = query;
+  size_t removed = filter.screen(q);
+  EXPECT_EQ(query.size(), q.size() + removed);
+  for (auto const & k : q) EXPECT_EQ(1UL, gold.count(k));
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(q.size(), comm));
+
+  // replicated:  local screen, same result, then the map query sees only present kmers.
+  filter.replicate();
+  EXPECT_TRUE(filter.is_replicated());
+  std::vector<KmerType> r(query);
+  EXPECT_EQ(removed, filter.screen(r));
+  EXPECT_EQ(q, r);
+  for (auto const & k : query) EXPECT_EQ(gold.count(k) > 0, filter.contains(k));
+
+  auto found = m.find(r);
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(found.size(), comm));
+
+  filter.release_replicas();
+  if (comm.size() > 1) {
+    bool thrown = false;
+    for (auto const & k : query) {
+      try { filter.contains(k); } catch (std::logic_error const & e) { thrown = true; break; }
+    }
+    EXPECT_TRUE(thrown);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
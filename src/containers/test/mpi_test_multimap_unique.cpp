@@ -0,0 +1,157 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_multimap_unique.cpp
+ * @ingroup
+ * @brief   tests that the incrementally maintained unique key count of the hash multimap matches a recount
+ *          after inserts, erases, and heavy hitter spreading.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+using ValueType = std::pair<KmerType, uint32_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using HashParams = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+/// key i repeated (i % 4 + 1) times, on every process.
+KmerType make_key(size_t const & i) {
+  KmerType km;
+  size_t x = i * 2654435761UL;
+  for (size_t j = 0; j < KmerType::size; ++j, x >>= 2) km.nextFromChar(x & 0x3);
+  return km;
+}
+
+std::vector<ValueType> make_input(size_t const & n, ::mxx::comm const & comm) {
+  std::vector<ValueType> input;
+  for (size_t i = 0; i < n; ++i)
+    for (size_t r = 0; r <= i % 4; ++r) input.emplace_back(make_key(i), static_cast<uint32_t>(comm.rank()));
+  return input;
+}
+
+/// entries inserted by rank 0.
+struct FromRank0 {
+  bool operator()(ValueType const & x) const { return x.second == 0; }
+  template <typename Iter>
+  bool operator()(Iter, Iter) const { return true; }
+};
+
+/// unique keys, by collecting the keys of all processes.
+template <typename Map>
+size_t recount(Map const & map, ::mxx::comm const & comm) {
+  std::vector<ValueType> entries = map.to_vector();
+  std::vector<KmerType> keys;
+  for (auto const & e : entries) keys.emplace_back(e.first);
+  keys = ::mxx::allgatherv(keys, comm);
+  std::sort(keys.begin(), keys.end());
+  return std::distance(keys.begin(), std::unique(keys.begin(), keys.end()));
+}
+
+TEST(MultimapUniqueTest, insert_erase)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> map(comm);
+
+  std::vector<ValueType> input = make_input(1000, comm);
+  map.insert(input);
+  EXPECT_EQ(1000UL, map.unique_size());
+  EXPECT_EQ(recount(map, comm), map.unique_size());
+
+  // inserting existing keys adds entries but no keys.
+  input = make_input(500, comm);
+  map.insert(input);
+  EXPECT_EQ(1000UL, map.unique_size());
+
+  // erase every 3rd key.
+  std::vector<KmerType> keys;
+  for (size_t i = 0; i < 1000; i += 3) keys.emplace_back(make_key(i));
+  map.erase(keys);
+  EXPECT_EQ(1000UL - 334UL, map.unique_size());
+  EXPECT_EQ(recount(map, comm), map.unique_size());
+
+  // erase the entries of rank 0.  keys keep their entries from the other ranks.
+  map.erase(FromRank0());
+  EXPECT_EQ(recount(map, comm), map.unique_size());
+
+  map.clear();
+  EXPECT_EQ(0UL, map.unique_size());
+}
+
+TEST(MultimapUniqueTest, heavy_hitters)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> map(comm);
+
+  std::vector<ValueType> input = make_input(200, comm);
+  for (size_t i = 0; i < 100; ++i) input.emplace_back(make_key(7), 0);
+  map.insert(input);
+  map.find_heavy_hitters(50);
+  EXPECT_EQ(200UL, map.unique_size());
+  EXPECT_EQ(recount(map, comm), map.unique_size());
+
+  std::vector<KmerType> keys(1, make_key(7));
+  map.erase(keys);
+  EXPECT_EQ(199UL, map.unique_size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_neighbor_query.cpp
+ * @ingroup
+ * @brief   tests the hamming neighborhood queries of the hashed maps against finding all neighbors.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_neighbors.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using CanonicalParams = ::dsc::HashMapParams<Key, ::bliss::kmer::transform::lex_less, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using Result = std::pair<KmerType, std::pair<KmerType, uint32_t> >;
+
+
+/// random kmers, and 1 and 2 substitution variants of some of them, a different part on each rank.
+static std::vector<std::pair<KmerType, uint32_t> > make_entries(::mxx::comm const & comm, std::vector<KmerType> & bases) {
+  srand(23 + comm.rank());
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  KmerType km;
+  for (size_t i = 0; i < 300; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    bases.emplace_back(km);
+    entries.emplace_back(km, i);
+    if (i % 2 == 0) {
+      std::vector<KmerType> n;
+      bliss::common::kmer::for_each_hamming_neighbor(km, 2, [&n](KmerType const & x) { n.emplace_back(x); });
+      entries.emplace_back(n[i % n.size()], i + 2);
+      entries.emplace_back(n[(i * 7) % n.size()], i + 3);
+    }
+  }
+  return entries;
+}
+
+/// (query, entry) by joining all transformed neighbors of each query with all entries.
+template <typename Map, typename Trans>
+static std::vector<Result> gold_neighbors(Map const & map, std::vector<KmerType> const & queries, unsigned int d,
+                                          ::mxx::comm const & comm) {
+  Trans trans;
+  std::vector<std::pair<KmerType, KmerType> > nq;    // (transformed neighbor, query)
+  for (auto const & q : queries) {
+    nq.emplace_back(trans(q), q);
+    bliss::common::kmer::for_each_hamming_neighbor(q, d, [&nq, &q, &trans](KmerType const & n) { nq.emplace_back(trans(n), q); });
+  }
+  std::sort(nq.begin(), nq.end());
+  nq.erase(std::unique(nq.begin(), nq.end()), nq.end());
+
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  map.to_vector(local);
+  auto all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end());
+
+  std::vector<Result> gold;
+  for (auto const & x : nq) {
+    for (auto it = std::lower_bound(all.begin(), all.end(), std::make_pair(x.first, static_cast<uint32_t>(0)));
+         (it != all.end()) && (it->first == x.first); ++it)
+      gold.emplace_back(x.second, *it);
+  }
+  std::sort(gold.begin(), gold.end());
+  return gold;
+}
+
+template <typename Map, typename Trans>
+static void check_neighbors(Map & map, ::mxx::comm const & comm) {
+  std::vector<KmerType> bases;
+  auto entries = make_entries(comm, bases);
+  map.insert(entries);
+
+  // queries:  inserted kmers, and their neighbors, with repeats.
+  std::vector<KmerType> queries;
+  for (size_t i = 0; i < bases.size(); i += 3) queries.emplace_back(bases[(i * 5) % bases.size()]);
+  for (size_t i = 0; i < 20; ++i) queries.emplace_back(bases[i] ^ (KmerType(bases[i + 1]) >> (KmerType::size - 1)));
+  queries.emplace_back(queries[0]);
+  std::vector<KmerType> unique_queries(queries);
+  std::sort(unique_queries.begin(), unique_queries.end());
+  unique_queries.erase(std::unique(unique_queries.begin(), unique_queries.end()), unique_queries.end());
+
+  for (unsigned int d = 0; d < 3; ++d) {
+    auto gold = gold_neighbors<Map, Trans>(map, unique_queries, d, comm);
+    auto results = map.find_neighbors(queries, d);
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(gold.size(), results.size()) << "d = " << d;
+    EXPECT_TRUE(gold == results) << "d = " << d;
+    if (d > 0) EXPECT_GT(::mxx::allreduce(results.size(), comm), 0UL);
+  }
+}
+
+
+TEST(NeighborQueryTest, map)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_map<KmerType, uint32_t, Params> map(comm);
+  check_neighbors<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(NeighborQueryTest, multimap)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, Params> map(comm);
+  check_neighbors<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(NeighborQueryTest, multimap_heavy)
+{
+  ::mxx::comm comm;
+  ::dsc::unordered_multimap<KmerType, uint32_t, Params> map(comm);
+
+  // a heavy key, and so spread over all ranks.
+  KmerType heavy;
+  for (size_t j = 0; j < KmerType::size; ++j) heavy.nextFromChar(j % 4);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 500; ++i) input.emplace_back(heavy, i + 1000 * comm.rank());
+  map.insert(input);
+  map.find_heavy_hitters(100);
+  EXPECT_EQ(1UL, map.heavy_size());
+
+  // each rank queries a neighbor of the heavy key.
+  std::vector<KmerType> queries;
+  bliss::common::kmer::for_each_hamming_neighbor(heavy, 1, [&queries](KmerType const & x) { queries.emplace_back(x); });
+  queries.resize(comm.rank() % 3 + 1);
+
+  auto results = map.find_neighbors(queries, 1);
+  ASSERT_EQ(queries.size() * 500 * comm.size(), results.size());
+  for (auto const & x : results) EXPECT_TRUE(x.second.first == heavy);
+
+  check_neighbors<decltype(map), ::bliss::transform::identity<KmerType> >(map, comm);
+}
+
+TEST(NeighborQueryTest, counting_canonical)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> map(comm);
+  check_neighbors<decltype(map), ::bliss::kmer::transform::lex_less<KmerType> >(map, comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_node_shared_map.cpp
+ * @ingroup
+ * @brief   tests the node shared, read-only index against gathered gold.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "containers/node_shared_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+TEST(NodeSharedMapTest, build_count_find)
+{
+  ::mxx::comm comm;
+
+  // each rank contributes entries with keys in [0, 2000), some repeated.
+  std::default_random_engine generator(comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution(0, 1999);
+  std::vector<std::pair<uint64_t, uint32_t> > entries;
+  for (uint32_t i = 0; i < 3000; ++i) {
+    entries.emplace_back(distribution(generator), comm.rank() * 3000 + i);
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t> > all = ::mxx::allgatherv(entries, comm);
+  std::unordered_multimap<uint64_t, uint32_t> gold(all.begin(), all.end());
+
+  ::dsc::node_shared_map<uint64_t, uint32_t> index(comm);
+  index.build(entries);
+  EXPECT_EQ(all.size(), index.size());
+
+  // local entries are sorted.
+  auto range = index.local_range();
+  EXPECT_TRUE(std::is_sorted(range.first, range.second,
+                             [](std::pair<uint64_t, uint32_t> const & x, std::pair<uint64_t, uint32_t> const & y) { return x.first < y.first; }));
+
+  // queries include absent keys.
+  std::vector<uint64_t> keys;
+  for (uint64_t i = comm.rank(); i < 2500; i += comm.size()) keys.emplace_back(i);
+
+  std::vector<size_t> counts = index.count(keys);
+  ASSERT_EQ(keys.size(), counts.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(gold.count(keys[i]), counts[i]);
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t> > found = index.find(keys);
+  std::vector<std::pair<uint64_t, uint32_t> > found_gold;
+  for (auto k : keys) {
+    auto r = gold.equal_range(k);
+    found_gold.insert(found_gold.end(), r.first, r.second);
+  }
+  std::sort(found.begin(), found.end());
+  std::sort(found_gold.begin(), found_gold.end());
+  EXPECT_EQ(found_gold, found);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
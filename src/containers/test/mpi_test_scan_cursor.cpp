@@ -0,0 +1,240 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_scan_cursor.cpp
+ * @ingroup
+ * @brief   tests that the chunked scan of the distributed maps visits the same entries as to_vector.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+using ValueType = std::pair<KmerType, uint32_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using HashParams = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+/// entries of the current process.  the counts differ between processes, so they finish at different rounds.
+std::vector<ValueType> make_input(::mxx::comm const & comm) {
+  std::default_random_engine generator(17 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<ValueType> input((comm.rank() * 300 + 700) % 1000);
+  for (size_t i = 0; i < input.size(); ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) input[i].first.nextFromChar(distribution(generator) % 4);
+    input[i].second = static_cast<uint32_t>(i);
+  }
+  return input;
+}
+
+/// scan the map in chunks, check the chunk sizes and the collective termination, and return the entries.
+template <typename Cursor>
+std::vector<ValueType> scan_all(Cursor && cursor, size_t const & chunk_size, size_t const & local_size, ::mxx::comm const & comm) {
+  std::vector<ValueType> scanned;
+  size_t rounds = 0;
+  while (cursor.next()) {
+    auto const & chunk = cursor.chunk();
+    EXPECT_LE(chunk.size(), chunk_size);
+    if (!cursor.local_end()) {
+      EXPECT_EQ(std::min(chunk_size, local_size - scanned.size()), chunk.size());
+    }
+    for (size_t i = 0; i < chunk.size(); ++i) scanned.emplace_back(chunk.key(i), chunk.value(i));
+    ++rounds;
+  }
+  EXPECT_TRUE(cursor.local_end());
+  EXPECT_EQ(local_size, cursor.local_scanned());
+
+  // all processes took the same number of rounds, that of the largest partition.
+  size_t max_size = ::mxx::allreduce(local_size, ::mxx::max<size_t>(), comm);
+  EXPECT_EQ((max_size + chunk_size - 1) / chunk_size, rounds);
+  return scanned;
+}
+
+template <typename Map>
+void check_scan(Map const & map, size_t const & chunk_size, ::mxx::comm const & comm) {
+  std::vector<ValueType> gold;
+  map.to_vector(gold);
+
+  std::vector<ValueType> scanned = scan_all(map.scan(chunk_size), chunk_size, map.local_size(), comm);
+
+  std::sort(gold.begin(), gold.end());
+  std::sort(scanned.begin(), scanned.end());
+  EXPECT_TRUE(gold == scanned);
+}
+
+
+TEST(ScanCursorTest, unordered_multimap)
+{
+  ::mxx::comm comm;
+  std::vector<ValueType> input = make_input(comm);
+
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> map(comm);
+  map.insert(input);
+
+  check_scan(map, 1, comm);
+  check_scan(map, 64, comm);
+  check_scan(map, 100000, comm);
+}
+
+TEST(ScanCursorTest, sorted_multimap_zero_copy)
+{
+  ::mxx::comm comm;
+  std::vector<ValueType> input = make_input(comm);
+
+  ::dsc::sorted_multimap<KmerType, uint32_t, SortParams> map(comm);
+  map.insert(input);
+
+  check_scan(map, 64, comm);
+
+  // the chunks point into the local vector.
+  auto cursor = map.scan(64);
+  size_t pos = 0;
+  while (cursor.next()) {
+    if (cursor.chunk().empty()) continue;
+    EXPECT_EQ(map.get_local_container().data() + pos, cursor.chunk().entries);
+    pos += cursor.chunk().size();
+  }
+  EXPECT_EQ(map.get_local_container().size(), pos);
+
+  // the frozen layout gives chunks of its key and value arrays.
+  auto frozen = map.freeze();
+  check_scan(frozen, 64, comm);
+
+  auto fcursor = frozen.scan(64);
+  pos = 0;
+  while (fcursor.next()) {
+    if (fcursor.chunk().empty()) continue;
+    EXPECT_EQ(nullptr, fcursor.chunk().entries);
+    EXPECT_EQ(frozen.get_local_container().keys().data() + pos, fcursor.chunk().keys);
+    EXPECT_EQ(frozen.get_local_container().values().data() + pos, fcursor.chunk().values);
+    pos += fcursor.chunk().size();
+  }
+  EXPECT_EQ(frozen.local_size(), pos);
+}
+
+/// the local views hold the same entries as to_vector, in storage order.
+template <typename Map>
+void check_views(Map const & map) {
+  std::vector<ValueType> gold;
+  map.to_vector(gold);
+
+  auto entries = map.local_entries();
+  auto keys = map.local_keys();
+  auto values = map.local_values();
+  EXPECT_EQ(gold.size(), entries.size());
+  EXPECT_EQ(gold.size(), keys.size());
+  EXPECT_EQ(gold.size(), values.size());
+
+  std::vector<ValueType> viewed(entries.begin(), entries.end());
+  EXPECT_TRUE(gold == viewed);
+
+  auto k = keys.begin();
+  auto v = values.begin();
+  for (size_t i = 0; i < gold.size(); ++i, ++k, ++v) {
+    EXPECT_EQ(gold[i].first, *k);
+    EXPECT_EQ(gold[i].second, *v);
+  }
+  EXPECT_TRUE(k == keys.end());
+}
+
+TEST(ScanCursorTest, local_views)
+{
+  ::mxx::comm comm;
+  std::vector<ValueType> input = make_input(comm);
+
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> umap(comm);
+  umap.insert(input);
+  check_views(umap);
+
+  ::dsc::sorted_multimap<KmerType, uint32_t, SortParams> map(comm);
+  map.insert(input);
+  check_views(map);
+
+  // spans of the local vector, and of the frozen key and value arrays.
+  EXPECT_EQ(map.get_local_container().data(), map.local_entries().begin());
+  if (!map.local_entries().empty()) {
+    EXPECT_EQ(&(map.get_local_container().data()->second), &(*(map.local_values().begin())));
+  }
+
+  auto frozen = map.freeze();
+  EXPECT_EQ(frozen.get_local_container().keys().data(), frozen.local_keys().begin());
+  EXPECT_EQ(frozen.get_local_container().values().data(), frozen.local_values().begin());
+  EXPECT_EQ(frozen.local_size(), frozen.local_keys().size());
+}
+
+TEST(ScanCursorTest, empty)
+{
+  ::mxx::comm comm;
+
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> map(comm);
+  auto cursor = map.scan(64);
+  EXPECT_FALSE(cursor.next());
+  EXPECT_TRUE(cursor.chunk().empty());
+  EXPECT_EQ(0UL, cursor.local_scanned());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
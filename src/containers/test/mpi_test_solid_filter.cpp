@@ -0,0 +1,154 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_solid_filter.cpp
+ * @ingroup
+ * @brief   tests the bloom filter front-end of counting_densehash_map:  no singletons, and exact counts after the second pass.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+
+using V = std::pair<KmerType, uint32_t>;
+
+/// mostly singletons, with some keys repeated 2 to 4 times, in 2 batches.
+void make_kmers(std::vector<KmerType> & batch1, std::vector<KmerType> & batch2, ::mxx::comm const & comm) {
+  std::default_random_engine generator(43 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  KmerType k;
+  for (size_t i = 0; i < 20000; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    batch1.emplace_back(k);
+    if (i % 5 == 0) batch1.emplace_back(k);
+    if (i % 7 == 0) batch2.emplace_back(k);
+    if (i % 11 == 0) batch2.emplace_back(k);
+  }
+}
+
+/// all entries, sorted.
+std::vector<V> all_entries(CountDenseMap const & map, ::mxx::comm const & comm) {
+  std::vector<V> local;
+  map.to_vector(local);
+  std::vector<V> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](V const & x, V const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return all;
+}
+
+
+TEST(SolidFilterTest, recount)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> batch1, batch2;
+  make_kmers(batch1, batch2, comm);
+
+  // exact counts, without singletons.
+  CountDenseMap gold(comm);
+  {
+    std::vector<KmerType> in1 = batch1, in2 = batch2;
+    gold.insert(in1);
+    gold.insert(in2);
+    gold.erase([](V const & x) { return x.second < 2; });
+  }
+  auto gold_all = all_entries(gold, comm);
+
+  // a high false positive rate, so some singletons are admitted.
+  CountDenseMap test(comm);
+  test.set_solid_filter(0.2);
+  {
+    std::vector<KmerType> in1 = batch1, in2 = batch2;
+    test.insert(in1);
+    test.insert(in2);
+  }
+  auto test_all = all_entries(test, comm);
+
+  // every solid key is in, and no count is too low.
+  ASSERT_LE(gold_all.size(), test_all.size());
+  for (auto const & x : gold_all) {
+    auto it = std::lower_bound(test_all.begin(), test_all.end(), x, [](V const & a, V const & b) { return a.first < b.first; });
+    ASSERT_TRUE(it != test_all.end());
+    EXPECT_EQ(x.first, it->first);
+    EXPECT_LE(x.second, it->second);
+    EXPECT_GE(x.second + 1, it->second);
+  }
+
+  // the second pass makes the counts exact.
+  test.begin_solid_recount();
+  {
+    std::vector<KmerType> in1 = batch1, in2 = batch2;
+    test.solid_recount(in1);
+    test.solid_recount(in2);
+  }
+  test.end_solid_recount();
+  EXPECT_EQ(gold_all, all_entries(test, comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
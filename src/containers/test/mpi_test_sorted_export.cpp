@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sorted_export.cpp
+ * @ingroup
+ * @brief   tests that the windowed sorted export of the hashed maps gives all entries in global key order.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "containers/sorted_export.hpp"
+
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+using ValueType = std::pair<KmerType, uint32_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+std::vector<KmerType> make_kmers(size_t n, ::mxx::comm const & comm) {
+  std::default_random_engine generator(17 + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    // some repeats, for counts above 1.
+    if (i % 7 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+/// all entries in key order, from to_vector.
+template <typename Map>
+std::vector<ValueType> gold_entries(Map const & map, ::mxx::comm const & comm) {
+  std::vector<ValueType> local;
+  map.to_vector(local);
+  std::vector<ValueType> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](ValueType const & x, ValueType const & y) { return x.first < y.first; });
+  return all;
+}
+
+template <typename Map>
+void check_sorted_export(Map & map, ::mxx::comm const & comm) {
+  std::vector<KmerType> kmers = make_kmers(3000, comm);
+  map.insert(kmers);
+  std::vector<ValueType> gold = gold_entries(map, comm);
+
+  // small windows, so there are several.
+  size_t windows = 0;
+  std::vector<ValueType> exported;
+  auto sink = [&windows, &exported, &comm](std::vector<ValueType> const & sorted) {
+    ++windows;
+    EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end(),
+                               [](ValueType const & x, ValueType const & y) { return x.first < y.first; }));
+    // gathered in rank order, the window is sorted too.
+    std::vector<ValueType> window = ::mxx::allgatherv(sorted, comm);
+    EXPECT_TRUE(std::is_sorted(window.begin(), window.end(),
+                               [](ValueType const & x, ValueType const & y) { return x.first < y.first; }));
+    exported.insert(exported.end(), window.begin(), window.end());
+  };
+  size_t local = ::dsc::sorted_export(map, sink, comm, 500);
+
+  EXPECT_LT(1UL, windows);
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(local, comm));
+  ASSERT_EQ(gold.size(), exported.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(gold[i].first, exported[i].first);
+    EXPECT_EQ(gold[i].second, exported[i].second);
+  }
+
+  // the same entries as 1 sorted map file.
+  std::string filename = "sorted_export_test.bin";
+  EXPECT_EQ(gold.size(), ::dsc::save_sorted(map, filename, comm, 500));
+  {
+    ::fsc::mapped_sorted_map<KmerType, uint32_t> file(filename);
+    ASSERT_EQ(gold.size(), file.size());
+    size_t i = 0;
+    for (auto it = file.begin(); it != file.end(); ++it, ++i) {
+      EXPECT_EQ(gold[i].first, it->first);
+      EXPECT_EQ(gold[i].second, it->second);
+    }
+  }
+  comm.barrier();
+  if (comm.rank() == 0) remove(filename.c_str());
+}
+
+TEST(SortedExportTest, counting_unordered_map)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, Params> map(comm);
+  check_sorted_export(map, comm);
+}
+
+TEST(SortedExportTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> > map(comm);
+  check_sorted_export(map, comm);
+}
+
+TEST(SortedExportTest, empty)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_unordered_map<KmerType, uint32_t, Params> map(comm);
+
+  size_t windows = 0;
+  auto sink = [&windows](std::vector<ValueType> const &) { ++windows; };
+  EXPECT_EQ(0UL, ::dsc::sorted_export(map, sink, comm, 500));
+  EXPECT_EQ(0UL, windows);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
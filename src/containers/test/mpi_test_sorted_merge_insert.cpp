@@ -0,0 +1,144 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sorted_merge_insert.cpp
+ * @ingroup
+ * @brief   tests inserting sorted batches into the sorted maps by merging, against gold counts.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+/// random kmers from a small pool, so batches repeat keys.  different on each process.
+std::vector<KmerType> make_batch(size_t n, size_t seed) {
+  std::default_random_engine generator(seed);
+  std::uniform_int_distribution<uint64_t> distribution(0, 2999);
+  std::vector<KmerType> kmers(n);
+  for (auto & k : kmers) {
+    uint64_t x = distribution(generator);
+    for (size_t i = 0; i < KmerType::size; ++i, x >>= 2) k.nextFromChar(x & 3);
+  }
+  std::sort(kmers.begin(), kmers.end());
+  return kmers;
+}
+
+
+TEST(SortedMergeInsertTest, counting)
+{
+  ::mxx::comm comm;
+  ::dsc::counting_sorted_map<KmerType, uint32_t, SortParams> m(comm);
+
+  std::map<KmerType, uint32_t> gold;
+  size_t max_runs = 0;
+  for (size_t b = 0; b < 16; ++b) {
+    std::vector<KmerType> batch = make_batch(2000, b * comm.size() + comm.rank());
+    std::vector<KmerType> all = ::mxx::allgatherv(batch, comm);
+    for (auto const & k : all) ++gold[k];
+
+    m.insert(batch, true);
+    max_runs = std::max(max_runs, m.local_run_count());
+    // runs are merged and reduced, so the local container stays within the number of distinct keys per run.
+    EXPECT_GE(3000UL * m.local_run_count(), m.get_local_container().size());
+  }
+  EXPECT_GE(6UL, max_runs);
+
+  EXPECT_EQ(gold.size(), m.unique_size());
+
+  std::vector<KmerType> query;
+  for (auto const & x : gold) query.emplace_back(x.first);
+  std::vector<::std::pair<KmerType, uint32_t> > found = m.find(query);
+  size_t total = 0;
+  for (auto const & x : found) {
+    EXPECT_EQ(gold.at(x.first), x.second);
+    total += x.second;
+  }
+  EXPECT_EQ(16UL * 2000UL * comm.size(), total);
+}
+
+
+TEST(SortedMergeInsertTest, multimap)
+{
+  ::mxx::comm comm;
+  ::dsc::sorted_multimap<KmerType, uint32_t, SortParams> m(comm);
+
+  std::map<KmerType, size_t> gold;
+  for (size_t b = 0; b < 8; ++b) {
+    std::vector<KmerType> keys = make_batch(2000, b * comm.size() + comm.rank());
+    std::vector<::std::pair<KmerType, uint32_t> > batch;
+    for (auto const & k : keys) batch.emplace_back(k, b);
+    std::vector<KmerType> all = ::mxx::allgatherv(keys, comm);
+    for (auto const & k : all) ++gold[k];
+
+    m.insert(batch, true);
+  }
+
+  // duplicates are all kept.
+  EXPECT_EQ(8UL * 2000UL * comm.size(), m.size());
+
+  std::vector<KmerType> query;
+  for (auto const & x : gold) query.emplace_back(x.first);
+  auto counts = m.count(query);
+  EXPECT_EQ(gold.size(), counts.size());
+  for (auto const & x : counts) EXPECT_EQ(gold.at(x.first), x.second);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
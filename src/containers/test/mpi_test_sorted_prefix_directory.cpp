@@ -0,0 +1,163 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sorted_prefix_directory.cpp
+ * @ingroup
+ * @brief   tests that the sorted maps answer find, count and erase the same with and without a prefix directory.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::kmer::transform::lex_less,
+    ::std::less, ::std::equal_to>;
+
+/// random kmers, with repeats.  different on each process.
+std::vector<std::pair<KmerType, uint32_t> > make_entries(size_t n, size_t seed) {
+  std::default_random_engine generator(seed);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    if ((i % 5) != 0) for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    entries.emplace_back(k, i);
+  }
+  return entries;
+}
+
+template <typename Map>
+void check_same(Map & m, Map & gold, std::vector<KmerType> const & query) {
+  std::vector<KmerType> q(query);
+  auto found = m.find(q);
+  q = query;
+  auto gold_found = gold.find(q);
+  std::sort(found.begin(), found.end());
+  std::sort(gold_found.begin(), gold_found.end());
+  EXPECT_TRUE(found == gold_found);
+
+  q = query;
+  auto counted = m.count(q);
+  q = query;
+  auto gold_counted = gold.count(q);
+  std::sort(counted.begin(), counted.end());
+  std::sort(gold_counted.begin(), gold_counted.end());
+  EXPECT_TRUE(counted == gold_counted);
+}
+
+template <typename Map>
+void check_map(::mxx::comm const & comm) {
+  auto entries = make_entries(20000, comm.rank());
+  std::vector<KmerType> query;
+  for (size_t i = 0; i < entries.size(); i += 3) query.emplace_back(entries[i].first);
+  auto absent = make_entries(2000, comm.size() + comm.rank());
+  for (auto const & x : absent) query.emplace_back(x.first);
+
+  Map m(comm), gold(comm);
+  m.set_prefix_directory_bits(10);
+  EXPECT_EQ(10U, m.get_prefix_directory_bits());
+  auto input = entries;
+  m.insert(input);
+  input = entries;
+  gold.insert(input);
+  check_same(m, gold, query);
+
+  // erase a part, then insert more.  the directory is rebuilt after each change.
+  std::vector<KmerType> erasing;
+  for (size_t i = 0; i < entries.size(); i += 7) erasing.emplace_back(entries[i].first);
+  std::vector<KmerType> e(erasing);
+  size_t erased = m.erase(e);
+  e = erasing;
+  EXPECT_EQ(gold.erase(e), erased);
+  EXPECT_EQ(gold.size(), m.size());
+  check_same(m, gold, query);
+
+  auto more = make_entries(5000, 3 * comm.size() + comm.rank());
+  input = more;
+  m.insert(input);
+  input = more;
+  gold.insert(input);
+  for (auto const & x : more) query.emplace_back(x.first);
+  check_same(m, gold, query);
+
+  // bits larger than the key prefix, and back to none.
+  m.set_prefix_directory_bits(100);
+  check_same(m, gold, query);
+  m.set_prefix_directory_bits(0);
+  check_same(m, gold, query);
+}
+
+
+TEST(SortedPrefixDirectoryTest, map)
+{
+  ::mxx::comm comm;
+  check_map<::dsc::sorted_map<KmerType, uint32_t, SortParams> >(comm);
+}
+
+TEST(SortedPrefixDirectoryTest, multimap)
+{
+  ::mxx::comm comm;
+  check_map<::dsc::sorted_multimap<KmerType, uint32_t, SortParams> >(comm);
+}
+
+TEST(SortedPrefixDirectoryTest, counting)
+{
+  ::mxx::comm comm;
+  check_map<::dsc::counting_sorted_map<KmerType, uint32_t, SortParams> >(comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
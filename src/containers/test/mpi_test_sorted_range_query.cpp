@@ -0,0 +1,174 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sorted_range_query.cpp
+ * @ingroup
+ * @brief   tests the range and prefix queries of the sorted maps against a brute force scan.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using SortParams = ::dsc::SortedMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    ::std::less, ::std::equal_to>;
+
+using MultimapType = ::dsc::sorted_multimap<KmerType, uint32_t, SortParams>;
+
+/// random kmers.  a few share long prefixes, so prefix ranges span processes.
+std::vector<KmerType> make_kmers(size_t n, size_t seed) {
+  std::default_random_engine generator(seed);
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers(n);
+  for (size_t i = 0; i < n; ++i) {
+    if ((i % 4) == 0) for (size_t j = 0; j < KmerType::size; ++j) kmers[i].nextFromChar(distribution(generator) % 4);
+    else {
+      kmers[i] = kmers[i - 1];
+      kmers[i].nextFromChar(distribution(generator) % 4);  // shares k - 1 characters with the previous one.
+    }
+  }
+  return kmers;
+}
+
+/// entries of all processes whose keys start with the prefix of q.
+size_t count_gold(std::vector<std::pair<KmerType, uint32_t> > const & all, KmerType const & q, size_t prefix_chars) {
+  size_t s = KmerType::size - prefix_chars;
+  size_t n = 0;
+  for (auto const & x : all)
+    if ((prefix_chars == 0) || ((x.first >> s) == (q >> s))) ++n;
+  return n;
+}
+
+
+TEST(SortedRangeQueryTest, prefix)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(4000, comm.rank());
+
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (size_t i = 0; i < kmers.size(); ++i) input.emplace_back(kmers[i], i * comm.size() + comm.rank());
+  std::vector<std::pair<KmerType, uint32_t> > all = ::mxx::allgatherv(input, comm);
+
+  MultimapType m(comm);
+  m.insert(input);
+
+  std::vector<KmerType> query;
+  for (size_t i = 0; i < kmers.size(); i += 97) query.emplace_back(kmers[i]);
+
+  for (size_t prefix_chars : {21UL, 18UL, 10UL, 4UL, 0UL}) {
+    auto counts = m.count_prefix(query, prefix_chars);
+    ASSERT_EQ(query.size(), counts.size());
+
+    auto found = m.find_prefix(query, prefix_chars);
+    size_t total = 0;
+    for (size_t i = 0; i < query.size(); ++i) {
+      size_t gold = count_gold(all, query[i], prefix_chars);
+      EXPECT_EQ(gold, counts[i]);
+      total += gold;
+    }
+    EXPECT_EQ(total, found.size());
+
+    size_t s = KmerType::size - prefix_chars;
+    for (auto const & x : found) {
+      bool matches = (prefix_chars == 0);
+      for (size_t i = 0; !matches && (i < query.size()); ++i) matches = ((x.first >> s) == (query[i] >> s));
+      EXPECT_TRUE(matches);
+    }
+  }
+}
+
+TEST(SortedRangeQueryTest, ranges)
+{
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_kmers(3000, comm.size() + comm.rank());
+
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (size_t i = 0; i < kmers.size(); ++i) input.emplace_back(kmers[i], i);
+  std::vector<std::pair<KmerType, uint32_t> > all = ::mxx::allgatherv(input, comm);
+
+  ::dsc::sorted_map<KmerType, uint32_t, SortParams> m(comm);
+  m.insert(input);
+  std::vector<KmerType> keys;
+  for (auto const & x : all) keys.emplace_back(x.first);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // ranges between random kmers, a reversed (empty) range, and only rank 0 queries.
+  std::vector<std::pair<KmerType, KmerType> > ranges;
+  if (comm.rank() == 0) {
+    std::vector<KmerType> bounds = make_kmers(40, 77);
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) ranges.emplace_back(std::min(bounds[i], bounds[i + 1]), std::max(bounds[i], bounds[i + 1]));
+    ranges.emplace_back(keys.back(), keys.front());
+    ranges.emplace_back(keys.front(), keys.back());
+  }
+
+  auto counts = m.count_range(ranges);
+  auto found = m.find_range(ranges);
+  ASSERT_EQ(ranges.size(), counts.size());
+  size_t total = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    size_t gold = std::upper_bound(keys.begin(), keys.end(), ranges[i].second) - std::lower_bound(keys.begin(), keys.end(), ranges[i].first);
+    if (ranges[i].second < ranges[i].first) gold = 0;
+    EXPECT_EQ(gold, counts[i]);
+    total += gold;
+  }
+  EXPECT_EQ(total, found.size());
+  if (comm.rank() == 0) EXPECT_EQ(keys.size(), counts.back());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_swiss_local_container.cpp
+ * @ingroup
+ * @brief   tests the distributed densehash maps with ::fsc::swiss_map as the local container, against the default
+ *          ::fsc::densehash_map local container.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "common/kmer_transform.hpp"
+#include "io/mxx_support.hpp"
+#include "containers/swiss_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using DistMurmur = ::bliss::kmer::hash::murmur<Key, true>;
+template <typename Key>
+using StoreMurmur = ::bliss::kmer::hash::murmur<Key, false>;
+
+template <typename Key>
+using Params = ::dsc::HashMapParams<Key, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistMurmur, ::std::equal_to, ::bliss::transform::identity, StoreMurmur, ::std::equal_to>;
+
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+using Alloc = ::std::allocator< ::std::pair<const KmerType, uint32_t> >;
+
+using CountDenseMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using CountSwissMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params, DenseKeys, Alloc, ::fsc::swiss_map>;
+using DenseMap = ::dsc::densehash_map<KmerType, uint32_t, Params, DenseKeys>;
+using SwissMap = ::dsc::densehash_map<KmerType, uint32_t, Params, DenseKeys, Alloc, ::fsc::swiss_map>;
+
+using V = std::pair<KmerType, uint32_t>;
+
+/// kmers with repeats, a different part on each rank.
+std::vector<KmerType> make_kmers(size_t n, unsigned int seed, ::mxx::comm const & comm) {
+  std::default_random_engine generator(seed + comm.rank());
+  std::uniform_int_distribution<uint64_t> distribution;
+  std::vector<KmerType> kmers;
+  KmerType k;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(distribution(generator) % 4);
+    kmers.emplace_back(k);
+    if (i % 3 == 0) kmers.emplace_back(k);
+  }
+  return kmers;
+}
+
+/// all elements, on all processes, sorted.
+template <typename T>
+std::vector<T> all_sorted(std::vector<T> const & local, ::mxx::comm const & comm) {
+  std::vector<T> all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), [](T const & x, T const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+  });
+  return all;
+}
+
+template <typename Map>
+std::vector<V> all_entries(Map const & map, ::mxx::comm const & comm) {
+  std::vector<V> local;
+  map.to_vector(local);
+  return all_sorted(local, comm);
+}
+
+
+TEST(SwissLocalContainerTest, counting_densehash_map)
+{
+  ::mxx::comm comm;
+
+  CountDenseMap gold(comm);
+  CountSwissMap test(comm);
+
+  std::vector<KmerType> kmers = make_kmers(5000, 11, comm);
+  std::vector<KmerType> kmers2 = kmers;
+  gold.insert(kmers);
+  test.insert(kmers2);
+
+  EXPECT_EQ(gold.size(), test.size());
+  EXPECT_EQ(all_entries(gold, comm), all_entries(test, comm));
+
+  // a second insert adds to the counts.
+  kmers = make_kmers(2000, 11, comm);
+  kmers2 = kmers;
+  gold.insert(kmers);
+  test.insert(kmers2);
+  EXPECT_EQ(all_entries(gold, comm), all_entries(test, comm));
+
+  // queries, half of them absent.
+  std::vector<KmerType> query = make_kmers(500, 11, comm);
+  std::vector<KmerType> absent = make_kmers(500, 97, comm);
+  query.insert(query.end(), absent.begin(), absent.end());
+  std::vector<KmerType> query2 = query;
+
+  EXPECT_EQ(all_sorted(gold.find(query), comm), all_sorted(test.find(query2), comm));
+  query2 = query;
+  std::vector<KmerType> query3 = query;
+  EXPECT_EQ(all_sorted(gold.count(query2), comm), all_sorted(test.count(query3), comm));
+
+  // erase.
+  query2 = query;
+  query3 = query;
+  EXPECT_EQ(gold.erase(query2), test.erase(query3));
+  EXPECT_EQ(gold.size(), test.size());
+  EXPECT_EQ(all_entries(gold, comm), all_entries(test, comm));
+}
+
+TEST(SwissLocalContainerTest, densehash_map)
+{
+  ::mxx::comm comm;
+
+  DenseMap gold(comm);
+  SwissMap test(comm);
+
+  std::vector<KmerType> kmers = make_kmers(5000, 23, comm);
+  std::vector<V> entries;
+  for (size_t i = 0; i < kmers.size(); ++i) entries.emplace_back(kmers[i], static_cast<uint32_t>(comm.rank() * kmers.size() + i));
+  std::vector<V> entries2 = entries;
+  gold.insert(entries);
+  test.insert(entries2);
+
+  // the value kept for a repeated key may differ, so compare the keys and the number of elements.
+  auto gold_all = all_entries(gold, comm);
+  auto test_all = all_entries(test, comm);
+  ASSERT_EQ(gold_all.size(), test_all.size());
+  for (size_t i = 0; i < gold_all.size(); ++i) EXPECT_EQ(gold_all[i].first, test_all[i].first);
+
+  std::vector<KmerType> query = make_kmers(500, 23, comm);
+  std::vector<KmerType> absent = make_kmers(500, 97, comm);
+  query.insert(query.end(), absent.begin(), absent.end());
+  std::vector<KmerType> query2 = query;
+  std::vector<KmerType> query3 = query;
+  EXPECT_EQ(all_sorted(gold.count(query2), comm), all_sorted(test.count(query3), comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/batch_count.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "utils/transform_utils.hpp"
+
+#include <map>
+#include <random>
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+TEST(BatchCountTest, sort_count)
+{
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  std::default_random_engine generator(7);
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  // 1000 distinct kmers, each repeated, some as reverse complement.
+  std::vector<KmerType> distinct(1000);
+  for (auto & k : distinct) {
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+  }
+  std::vector<KmerType> keys;
+  for (size_t i = 0; i < 20000; ++i) {
+    KmerType k = distinct[distribution(generator) % distinct.size()];
+    keys.emplace_back((i % 3 == 0) ? k.reverse_complement() : k);
+  }
+
+  ::bliss::kmer::transform::lex_less<KmerType> trans;
+  std::map<KmerType, uint32_t> gold;
+  std::map<KmerType, uint32_t> gold_plain;
+  for (auto const & k : keys) {
+    ++gold[trans(k)];
+    ++gold_plain[k];
+  }
+
+  // canonical:  a kmer and its reverse complement are counted together.
+  {
+    std::vector<KmerType> input(keys);
+    std::vector<std::pair<KmerType, uint32_t> > counts;
+    ::fsc::sort_count(input, counts, trans, ::fsc::TransformedComparator<KmerType, ::std::equal_to, ::bliss::kmer::transform::lex_less>());
+    EXPECT_EQ(gold.size(), counts.size());
+    for (size_t i = 0; i < counts.size(); ++i) {
+      EXPECT_EQ(gold.at(trans(counts[i].first)), counts[i].second);
+      if (i > 0) EXPECT_TRUE(trans(counts[i - 1].first) < trans(counts[i].first));
+    }
+  }
+
+  // identity.
+  {
+    std::vector<KmerType> input(keys);
+    std::vector<std::pair<KmerType, uint32_t> > counts;
+    ::fsc::sort_count(input, counts, ::bliss::transform::identity<KmerType>(), ::std::equal_to<KmerType>());
+    EXPECT_EQ(gold_plain.size(), counts.size());
+    for (auto const & x : counts) EXPECT_EQ(gold_plain.at(x.first), x.second);
+  }
+}
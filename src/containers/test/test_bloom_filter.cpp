@@ -0,0 +1,65 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/bloom_filter.hpp"
+
+#include <functional>
+#include <cstdint>
+
+
+TEST(BloomFilterTest, test_and_set)
+{
+  ::fsc::bloom_filter<uint64_t, ::std::hash<uint64_t> > filter(100000, 0.01);
+  EXPECT_FALSE(filter.empty());
+
+  size_t fp = 0;
+  for (uint64_t i = 0; i < 100000; ++i) {
+    fp += filter.test_and_set(i) ? 1 : 0;
+  }
+  // no false negatives.
+  for (uint64_t i = 0; i < 100000; ++i) {
+    EXPECT_TRUE(filter.contains(i));
+    EXPECT_TRUE(filter.test_and_set(i));
+  }
+  // as the filter fills, the false positive rate goes from 0 to the target, so the average is lower.
+  EXPECT_GT(1000UL, fp);
+}
+
+TEST(BloomFilterTest, false_positive_rate)
+{
+  ::fsc::bloom_filter<uint64_t, ::std::hash<uint64_t> > filter(100000, 0.01);
+  for (uint64_t i = 0; i < 100000; ++i) {
+    filter.test_and_set(i);
+  }
+
+  size_t fp = 0;
+  for (uint64_t i = 100000; i < 200000; ++i) {
+    fp += filter.contains(i) ? 1 : 0;
+  }
+  // blocking raises the rate somewhat above the target.
+  EXPECT_GT(2000UL, fp);
+
+  filter.clear();
+  for (uint64_t i = 0; i < 100000; ++i) {
+    EXPECT_FALSE(filter.contains(i));
+  }
+
+  filter.reset();
+  EXPECT_TRUE(filter.empty());
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/bucket_table.hpp"
+
+#include <algorithm>  // min, max_element
+#include <cmath>    // abs
+#include <cstdint>
+#include <vector>
+
+
+TEST(BucketTableTest, balanced)
+{
+  for (int p : {1, 3, 16, 1000}) {
+    ::dsc::bucket_table t(p);
+    ASSERT_EQ(p, t.comm_size());
+
+    std::vector<size_t> shares = t.shares();
+    for (auto s : shares) {
+      EXPECT_GE(s, ::dsc::bucket_table::nbuckets / p);
+      EXPECT_LE(s, ::dsc::bucket_table::nbuckets / p + 1);
+    }
+
+    // contiguous ranges
+    for (size_t b = 1; b < ::dsc::bucket_table::nbuckets; ++b) {
+      EXPECT_LE(t[b - 1], t[b]);
+    }
+  }
+}
+
+TEST(BucketTableTest, remap)
+{
+  for (int p : {4, 7, 64}) {
+    for (int q : {1, 3, 5, 8, 65, 100}) {
+      ::dsc::bucket_table t(p);
+      ::dsc::bucket_table u = t.remap(q);
+      ASSERT_EQ(q, u.comm_size());
+
+      std::vector<size_t> shares = u.shares();
+      for (auto s : shares) {
+        EXPECT_GE(s, ::dsc::bucket_table::nbuckets / q);
+        EXPECT_LE(s, ::dsc::bucket_table::nbuckets / q + 1);
+      }
+
+      // a bucket moves only if its rank is gone or over its new share.
+      std::vector<size_t> old_shares = t.shares();
+      size_t must_move = 0;
+      for (int r = 0; r < p; ++r) {
+        if (r >= q) must_move += old_shares[r];
+        else if (old_shares[r] > shares[r]) must_move += old_shares[r] - shares[r];
+      }
+      EXPECT_EQ(must_move, t.difference(u));
+    }
+  }
+
+  // remap to the same size moves nothing.
+  ::dsc::bucket_table t(6);
+  EXPECT_EQ(0UL, t.difference(t.remap(6)));
+  EXPECT_TRUE(t == t.remap(6));
+  EXPECT_EQ(t.id(), t.remap(6).id());
+  EXPECT_NE(t.id(), t.remap(5).id());
+}
+
+TEST(BucketTableTest, weighted)
+{
+  // 2 fast ranks and 2 slow ones.
+  std::vector<double> w = {2.0, 1.0, 2.0, 1.0};
+  ::dsc::bucket_table t = ::dsc::bucket_table::weighted(w);
+  ASSERT_EQ(4, t.comm_size());
+  std::vector<size_t> shares = t.shares();
+  EXPECT_EQ(static_cast<size_t>(::dsc::bucket_table::nbuckets), shares[0] + shares[1] + shares[2] + shares[3]);
+  for (int r = 0; r < 4; ++r) {
+    double expected = ::dsc::bucket_table::nbuckets * w[r] / 6.0;
+    EXPECT_LE(std::abs(expected - static_cast<double>(shares[r])), 1.0);
+  }
+  for (size_t b = 1; b < ::dsc::bucket_table::nbuckets; ++b) {
+    EXPECT_LE(t[b - 1], t[b]);
+  }
+
+  // equal weights give the balanced shares.
+  for (auto s : ::dsc::bucket_table::weighted(std::vector<double>(5, 3.0)).shares()) {
+    EXPECT_GE(s, ::dsc::bucket_table::nbuckets / 5);
+    EXPECT_LE(s, ::dsc::bucket_table::nbuckets / 5 + 1);
+  }
+
+  // reweighting moves only the buckets over the new shares.
+  ::dsc::bucket_table u(4);
+  ::dsc::bucket_table v = u.remap(w);
+  EXPECT_TRUE(v.shares() == shares);
+  std::vector<size_t> old_shares = u.shares();
+  size_t must_move = 0;
+  for (int r = 0; r < 4; ++r)
+    if (old_shares[r] > shares[r]) must_move += old_shares[r] - shares[r];
+  EXPECT_EQ(must_move, u.difference(v));
+
+  EXPECT_THROW(::dsc::bucket_table::weighted(std::vector<double>()), std::invalid_argument);
+  EXPECT_THROW(::dsc::bucket_table::weighted(std::vector<double>({1.0, 0.0})), std::invalid_argument);
+}
+
+TEST(BucketTableTest, load_balanced)
+{
+  // all the load in the first 1/8 of the buckets, as for keys that hash to few buckets.
+  std::vector<size_t> loads(::dsc::bucket_table::nbuckets, 0);
+  for (size_t b = 0; b < ::dsc::bucket_table::nbuckets / 8; ++b) loads[b] = 10;
+
+  ::dsc::bucket_table t(4);
+  EXPECT_DOUBLE_EQ(4.0, t.imbalance(loads));
+
+  ::dsc::bucket_table u = ::dsc::bucket_table::balanced(loads, 4);
+  ASSERT_EQ(4, u.comm_size());
+  EXPECT_LE(u.imbalance(loads), 1.001);
+  for (size_t b = 1; b < ::dsc::bucket_table::nbuckets; ++b) {
+    EXPECT_LE(u[b - 1], u[b]);
+  }
+
+  // load proportional to the weights.
+  std::vector<double> w = {3.0, 1.0};
+  ::dsc::bucket_table v = ::dsc::bucket_table::balanced(loads, 2, w);
+  EXPECT_LE(v.imbalance(loads, w), 1.001);
+  EXPECT_GT(v.imbalance(loads), 1.4);
+
+  // a bucket is not split.
+  std::vector<size_t> heavy(::dsc::bucket_table::nbuckets, 1);
+  heavy[100] = ::dsc::bucket_table::nbuckets;
+  ::dsc::bucket_table h = ::dsc::bucket_table::balanced(heavy, 4);
+  EXPECT_LE(h.imbalance(heavy), 2.001);
+  EXPECT_GE(h.imbalance(heavy), 1.99);
+
+  // no load:  the default table.
+  EXPECT_TRUE(::dsc::bucket_table(3) == ::dsc::bucket_table::balanced(std::vector<size_t>(::dsc::bucket_table::nbuckets, 0), 3));
+  EXPECT_THROW(::dsc::bucket_table::balanced(std::vector<size_t>(10, 1), 3), std::invalid_argument);
+}
+
+TEST(BucketTableTest, invalid)
+{
+  EXPECT_THROW(::dsc::bucket_table(0), std::invalid_argument);
+  EXPECT_THROW(::dsc::bucket_table(std::vector<uint32_t>(10, 0), 2), std::invalid_argument);
+  EXPECT_THROW(::dsc::bucket_table(std::vector<uint32_t>(::dsc::bucket_table::nbuckets, 2), 2), std::invalid_argument);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/compact_counting_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename COUNTER>
+class CompactCountingMapTest : public ::testing::Test
+{
+  protected:
+
+    using MAP = ::fsc::compact_counting_map<uint64_t, uint32_t, void, ::bliss::transform::identity,
+        ::fsc::TransformedHash<uint64_t, ::std::hash, ::bliss::transform::identity>,
+        ::fsc::TransformedComparator<uint64_t, ::std::equal_to, ::bliss::transform::identity>,
+        ::std::allocator<::std::pair<const uint64_t, uint32_t> >, false, COUNTER>;
+
+    ::std::unordered_map<uint64_t, uint32_t> gold;
+    ::std::vector<uint64_t> keys;
+
+    virtual void SetUp()
+    {
+      // mostly small counts, with a few keys occurring more than the 1 and 2 byte counters can hold.
+      std::default_random_engine generator;
+      std::uniform_int_distribution<uint64_t> distribution(0, 20000);
+
+      for (size_t i = 0; i < 100000; ++i) {
+        keys.emplace_back(distribution(generator));
+      }
+      for (size_t i = 0; i < 70000; ++i) {
+        keys.emplace_back(8);
+      }
+      for (size_t i = 0; i < 300; ++i) {
+        keys.emplace_back(123456788);
+      }
+      ::std::shuffle(keys.begin(), keys.end(), generator);
+
+      for (auto k : keys) ++gold[k];
+    }
+
+    static bool less(::std::pair<uint64_t, uint32_t> const & x, ::std::pair<uint64_t, uint32_t> const &y) {
+      return (x.first == y.first) ? (x.second < y.second) : (x.first < y.first);
+    }
+
+    void check_counts(MAP const & test) {
+      EXPECT_EQ(gold.size(), test.size());
+
+      ::std::vector<::std::pair<uint64_t, uint32_t> > test_vals = test.to_vector();
+      ::std::vector<::std::pair<uint64_t, uint32_t> > gold_vals(gold.begin(), gold.end());
+      ::std::sort(test_vals.begin(), test_vals.end(), &CompactCountingMapTest<COUNTER>::less);
+      ::std::sort(gold_vals.begin(), gold_vals.end(), &CompactCountingMapTest<COUNTER>::less);
+      ASSERT_EQ(gold_vals.size(), test_vals.size());
+      EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(CompactCountingMapTest);
+
+TYPED_TEST_P(CompactCountingMapTest, increment)
+{
+  typename TestFixture::MAP test(16);
+  test.increment(this->keys.data(), this->keys.size());
+
+  this->check_counts(test);
+  EXPECT_LT(0UL, test.overflow_size());
+
+  // a rehash keeps the overflowed counts.
+  test.resize(test.bucket_count() * 4);
+  this->check_counts(test);
+}
+
+TYPED_TEST_P(CompactCountingMapTest, reduce)
+{
+  // insert and reduce through the iterator, as in the reduction maps.
+  typename TestFixture::MAP test;
+  for (auto k : this->keys) {
+    auto result = test.insert(::std::make_pair(k, 1U));
+    if (!result.second) result.first->second = result.first->second + 1U;
+  }
+  this->check_counts(test);
+
+  for (auto i : this->gold) {
+    auto it = test.find(i.first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(i.second, static_cast<uint32_t>(it->second));
+    EXPECT_EQ(i.second, (*it).second);
+  }
+
+  // counts can go down as well, out of the side table.
+  ::std::vector<::std::pair<uint64_t, uint32_t> > decr;
+  for (auto i : this->gold) decr.emplace_back(i.first, i.second - 1);
+  EXPECT_EQ(decr.size(), test.update(decr, [](uint32_t & x, uint32_t const & y){ x -= y; return 1; }));
+  for (auto it = test.cbegin(); it != test.cend(); ++it) {
+    EXPECT_EQ(1U, (*it).second);
+  }
+  EXPECT_EQ(0UL, test.overflow_size());
+}
+
+TYPED_TEST_P(CompactCountingMapTest, erase)
+{
+  typename TestFixture::MAP test;
+  test.increment(this->keys.data(), this->keys.size());
+
+  // erase the even keys, which include the overflowed ones.
+  ::std::vector<uint64_t> evens;
+  for (auto i : this->gold) {
+    if ((i.first & 0x1) == 0) evens.emplace_back(i.first);
+  }
+  for (auto k : evens) this->gold.erase(k);
+  EXPECT_EQ(evens.size(), test.erase(evens.begin(), evens.end()));
+  this->check_counts(test);
+  EXPECT_EQ(0UL, test.overflow_size());
+
+  // copy, then clear
+  typename TestFixture::MAP copied(test);
+  this->check_counts(copied);
+  test.clear();
+  EXPECT_TRUE(test.empty());
+  EXPECT_TRUE(test.begin() == test.end());
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(CompactCountingMapTest, increment, reduce, erase);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint8_t, uint16_t> CompactCountingMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, CompactCountingMapTest, CompactCountingMapTestTypes);
@@ -61,6 +61,117 @@
 	static constexpr bool need_to_split = true;
   };
 
+/// queries for the batch lookups:  the input keys, plus neighboring values that may not be present.
+template <typename T>
+::std::vector<T> make_batch_queries(::std::vector<::std::pair<T, T> > const & input) {
+  ::std::vector<T> queries;
+  for (size_t i = 0; i < input.size(); i += 3) {
+    queries.emplace_back(input[i].first);
+    queries.emplace_back(input[i].first + 1);
+  }
+  return queries;
+}
+
+/// compare batch count and find to the gold map.
+template <typename MAP, typename GOLD, typename T>
+void check_batch_map(MAP const & test, GOLD const & gold, ::std::vector<T> const & queries) {
+  ::std::vector<size_t> counts(queries.size());
+  test.count(queries.data(), queries.size(), counts.data());
+
+  ::std::vector<typename MAP::value_type const *> found(queries.size());
+  test.find(queries.data(), queries.size(), found.data());
+
+  for (size_t i = 0; i < queries.size(); ++i) {
+    auto it = gold.find(queries[i]);
+    EXPECT_EQ(gold.count(queries[i]), counts[i]);
+    if (it == gold.end()) {
+      EXPECT_TRUE(found[i] == nullptr);
+    } else {
+      ASSERT_TRUE(found[i] != nullptr);
+      EXPECT_EQ(it->first, found[i]->first);
+      EXPECT_EQ(it->second, found[i]->second);
+    }
+  }
+}
+
+/// compare batch count and equal_range to the gold multimap.
+template <typename MAP, typename GOLD, typename T>
+void check_batch_multimap(MAP const & test, GOLD const & gold, ::std::vector<T> const & queries) {
+  ::std::vector<size_t> counts(queries.size());
+  test.count(queries.data(), queries.size(), counts.data());
+
+  ::std::vector<::std::pair<typename MAP::const_iterator, typename MAP::const_iterator> > ranges(queries.size());
+  test.equal_range(queries.data(), queries.size(), ranges.data());
+
+  for (size_t i = 0; i < queries.size(); ++i) {
+    EXPECT_EQ(gold.count(queries[i]), counts[i]);
+    EXPECT_EQ(gold.count(queries[i]), static_cast<size_t>(::std::distance(ranges[i].first, ranges[i].second)));
+    for (auto it = ranges[i].first; it != ranges[i].second; ++it) {
+      EXPECT_EQ(queries[i], it->first);
+    }
+  }
+}
+
+/// entries of the multimap and the gold multimap, sorted.
+template <typename MAP, typename GOLD>
+void check_multimap_entries(MAP const & test, GOLD const & gold) {
+  using V = typename GOLD::value_type;
+  ::std::vector<::std::pair<typename GOLD::key_type, typename GOLD::mapped_type> > test_vals = test.to_vector();
+  ::std::vector<::std::pair<typename GOLD::key_type, typename GOLD::mapped_type> > gold_vals;
+  for (V const & v : gold) gold_vals.emplace_back(v.first, v.second);
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+  EXPECT_EQ(gold.size(), test.size());
+  ASSERT_EQ(gold_vals.size(), test_vals.size());
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+}
+
+/// finalize the multimap, compare to the gold multimap, then update and finalize again.
+template <typename MAP, typename T>
+void check_finalize_multimap(::std::vector<::std::pair<T, T> > const & input) {
+  ::std::unordered_multimap<T, T> gold(input.begin(), input.end());
+  MAP test(input.begin(), input.end());
+  ::std::vector<T> queries = make_batch_queries(input);
+
+  test.finalize();
+  EXPECT_TRUE(test.is_finalized());
+  check_multimap_entries(test, gold);
+  check_batch_multimap(test, gold, queries);
+
+  // updates go back to the per key vectors.
+  ::std::vector<T> erased;
+  for (size_t i = 0; i < queries.size(); i += 10) erased.emplace_back(queries[i]);
+  test.erase(erased.begin(), erased.end());
+  EXPECT_FALSE(test.is_finalized());
+  for (auto k : erased) gold.erase(k);
+  ::std::vector<::std::pair<T, T> > more(input.begin(), input.begin() + input.size() / 2);
+  test.insert(more);
+  gold.insert(more.begin(), more.end());
+  check_multimap_entries(test, gold);
+  check_batch_multimap(test, gold, queries);
+
+  test.finalize();
+  check_multimap_entries(test, gold);
+  check_batch_multimap(test, gold, queries);
+}
+
+/// bulk insert into a presized map, compared to the gold map.  the first of duplicate keys is kept, as with emplace.
+template <typename MAP, typename GOLD, typename T>
+void check_bulk_map(GOLD const & gold, ::std::vector<::std::pair<T, T> > const & input) {
+  MAP test;
+  test.resize(input.size());
+  ::std::vector<::std::pair<T, T> > batch(input);
+  test.bulk_insert(batch);
+  EXPECT_EQ(input.size(), batch.size());
+  EXPECT_EQ(gold.size(), test.size());
+
+  ::std::vector<::std::pair<T, T> > test_vals = test.to_vector();
+  ::std::vector<::std::pair<T, T> > gold_vals(gold.begin(), gold.end());
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+}
+
 /*
  * test class holding some information.  Also, needed for the typed tests
  */
@@ -212,8 +323,52 @@ TYPED_TEST_P(DenseHashMapPartialTest, count_partial)
     }
 }
 
+TYPED_TEST_P(DenseHashMapPartialTest, batch_partial)
+{
+  using MAP = ::fsc::densehash_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  check_batch_map(test, this->gold, make_batch_queries(this->temp));
+
+  // batch update:  increment the values of the present keys.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > updates;
+  for (auto q : make_batch_queries(this->temp)) updates.emplace_back(q, 1);
+  size_t expected = 0;
+  for (auto u : updates) expected += this->gold.count(u.first);
+  EXPECT_EQ(expected, test.update(updates, [](TypeParam & x, TypeParam const & y) { x += y; return 1; }));
+}
+
+TYPED_TEST_P(DenseHashMapPartialTest, bulk_partial)
+{
+  check_bulk_map<::fsc::densehash_map<TypeParam, TypeParam> >(this->gold, this->temp);
+}
+
+TYPED_TEST_P(DenseHashMapPartialTest, stats_partial)
+{
+  using MAP = ::fsc::densehash_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  ::fsc::sparsehash::table_stats st = test.stats();
+  EXPECT_EQ(test.size(), st.size);
+  EXPECT_EQ(test.bucket_count(), st.buckets);
+  EXPECT_EQ(0UL, st.tombstones);
+  EXPECT_LE(st.load_factor(), 0.75);
+  EXPECT_GT(st.bytes_per_entry(), static_cast<double>(sizeof(::std::pair<TypeParam, TypeParam>)));
+
+  // every entry is found at some probe.
+  size_t found = 0;
+  for (auto x : st.probe_hist) found += x;
+  EXPECT_EQ(test.size(), found);
+  if (test.size() > 0) {
+    EXPECT_GE(st.mean_probe(), 1.0);
+    EXPECT_GE(st.max_probe, 1UL);
+  }
+}
+
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMapPartialTest, insert_partial, equal_range_partial, count_partial);
+REGISTER_TYPED_TEST_CASE_P(DenseHashMapPartialTest, insert_partial, equal_range_partial, count_partial, batch_partial, bulk_partial, stats_partial);
 
 
 //////////////////// RUN the tests with different types.
@@ -391,8 +546,29 @@ TYPED_TEST_P(DenseHashMapFullTest, count_full)
 
 
 
+TYPED_TEST_P(DenseHashMapFullTest, batch_full)
+{
+  using MAP = ::fsc::densehash_map<TypeParam, TypeParam, full_special_keys<TypeParam> >;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  check_batch_map(test, this->gold, make_batch_queries(this->temp));
+
+  // batch update:  increment the values of the present keys.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > updates;
+  for (auto q : make_batch_queries(this->temp)) updates.emplace_back(q, 1);
+  size_t expected = 0;
+  for (auto u : updates) expected += this->gold.count(u.first);
+  EXPECT_EQ(expected, test.update(updates, [](TypeParam & x, TypeParam const & y) { x += y; return 1; }));
+}
+
+TYPED_TEST_P(DenseHashMapFullTest, bulk_full)
+{
+  check_bulk_map<::fsc::densehash_map<TypeParam, TypeParam, full_special_keys<TypeParam> > >(this->gold, this->temp);
+}
+
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMapFullTest, insert_full, equal_range_full, count_full);
+REGISTER_TYPED_TEST_CASE_P(DenseHashMapFullTest, insert_full, equal_range_full, count_full, batch_full, bulk_full);
 
 
 //////////////////// RUN the tests with different types.
@@ -571,8 +747,24 @@ TYPED_TEST_P(DenseHashMultimapPartialTest, count_partial)
 
 
 
+TYPED_TEST_P(DenseHashMultimapPartialTest, batch_partial)
+{
+  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  check_batch_multimap(test, this->gold, make_batch_queries(this->temp));
+}
+
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapPartialTest, insert_partial, equal_range_partial, count_partial);
+TYPED_TEST_P(DenseHashMultimapPartialTest, finalize_partial)
+{
+  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam>;
+
+  check_finalize_multimap<MAP>(this->temp);
+}
+
+REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapPartialTest, insert_partial, equal_range_partial, count_partial, batch_partial, finalize_partial);
 
 
 //////////////////// RUN the tests with different types.
@@ -751,8 +943,24 @@ TYPED_TEST_P(DenseHashMultimapFullTest, count_full)
 
 
 
+TYPED_TEST_P(DenseHashMultimapFullTest, batch_full)
+{
+  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam, full_special_keys<TypeParam> >;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  check_batch_multimap(test, this->gold, make_batch_queries(this->temp));
+}
+
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapFullTest, insert_full, equal_range_full, count_full);
+TYPED_TEST_P(DenseHashMultimapFullTest, finalize_full)
+{
+  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam, full_special_keys<TypeParam> >;
+
+  check_finalize_multimap<MAP>(this->temp);
+}
+
+REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapFullTest, insert_full, equal_range_full, count_full, batch_full, finalize_full);
 
 
 //////////////////// RUN the tests with different types.
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/hugepage_allocator.hpp"
+
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+template <typename Policy>
+void check_vector() {
+  int64_t before = ::fsc::hugepage_stats::instance().mapped.load();
+  {
+    std::vector<uint64_t, ::fsc::hugepage_allocator<uint64_t, Policy> > v(1UL << 20);  // 8 MB
+    for (size_t i = 0; i < v.size(); ++i) v[i] = i;
+    for (size_t i = 0; i < v.size(); i += 4099) EXPECT_EQ(i, v[i]);
+
+#if defined(__linux__)
+    EXPECT_EQ(0UL, reinterpret_cast<uintptr_t>(v.data()) % (1UL << 21));
+    EXPECT_LE(static_cast<int64_t>(v.size() * sizeof(uint64_t)), ::fsc::hugepage_stats::instance().mapped.load() - before);
+#endif
+
+    // small allocations are not mapped.
+    int64_t mapped = ::fsc::hugepage_stats::instance().mapped.load();
+    std::vector<uint64_t, ::fsc::hugepage_allocator<uint64_t, Policy> > w(100, 1);
+    EXPECT_EQ(mapped, ::fsc::hugepage_stats::instance().mapped.load());
+  }
+  EXPECT_EQ(before, ::fsc::hugepage_stats::instance().mapped.load());
+}
+
+TEST(HugePageAllocatorTest, transparent)
+{
+  check_vector<::fsc::hugepage_policy<> >();
+}
+
+TEST(HugePageAllocatorTest, interleaved)
+{
+  check_vector<::fsc::interleaved_hugepage_policy>();
+}
+
+TEST(HugePageAllocatorTest, hugetlb)
+{
+  // falls back to transparent pages if no huge pages are reserved.
+  check_vector<::fsc::hugepage_policy<::fsc::hugepage_kind::hugetlb_2m> >();
+}
+
+TEST(HugePageAllocatorTest, unordered_map)
+{
+  using Alloc = ::fsc::hugepage_allocator<std::pair<const uint64_t, uint32_t> >;
+  std::unordered_map<uint64_t, uint32_t, std::hash<uint64_t>, std::equal_to<uint64_t>, Alloc> m;
+  m.reserve(1UL << 20);   // bucket array of 8 MB, mapped.  the nodes are not.
+  for (uint64_t i = 0; i < 100000; ++i) m[i * 7] = static_cast<uint32_t>(i);
+  for (uint64_t i = 0; i < 100000; i += 1000) EXPECT_EQ(i, m.at(i * 7));
+  EXPECT_TRUE(m.find(3) == m.end());
+}
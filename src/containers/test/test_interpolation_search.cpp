@@ -0,0 +1,176 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/interpolation_search.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "utils/transform_utils.hpp"
+
+#include <algorithm>  // for sort, lower_bound
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename KMER>
+class InterpolationSearchTest : public ::testing::Test
+{
+  protected:
+
+    std::vector<KMER> random;
+    std::vector<KMER> skewed;
+    std::vector<KMER> queries;
+
+    static KMER random_kmer() {
+      KMER kmer;
+      for (unsigned int i = 0; i < KMER::size; ++i) {
+        kmer.nextFromChar(rand() % KMER::KmerAlphabet::SIZE);
+      }
+      return kmer;
+    }
+
+    virtual void SetUp()
+    {
+      srand(0);
+      for (uint32_t i = 0; i < 20000; ++i) {
+        random.emplace_back(random_kmer());
+      }
+      for (uint32_t i = 0; i < 5000; ++i) {
+        queries.emplace_back(random_kmer());
+      }
+
+      // skewed:  mostly 1 character, with long runs of repeats.
+      KMER kmer;
+      for (uint32_t i = 0; i < 20000; ++i) {
+        kmer.nextFromChar(((rand() % 10) == 0) ? (rand() % KMER::KmerAlphabet::SIZE) : 0);
+        skewed.emplace_back(kmer);
+        if ((i % 100) == 0) for (int j = 0; j < 50; ++j) skewed.emplace_back(kmer);
+      }
+    }
+
+    template <template <typename> class Transform>
+    void check(std::vector<KMER> data) {
+      using Less = ::fsc::TransformedComparator<KMER, ::std::less, Transform>;
+      static_assert(::fsc::is_radix_sortable<Less>::value, "comparator should allow interpolation search");
+      Less comp;
+      std::sort(data.begin(), data.end(), comp);
+
+      // present keys, absent keys, and the ends.
+      std::vector<KMER> q(queries);
+      q.insert(q.end(), data.begin(), data.begin() + 5000);
+      q.emplace_back(data.front());
+      q.emplace_back(data.back());
+      q.emplace_back(KMER());
+
+      for (auto const & k : q) {
+        EXPECT_EQ(std::lower_bound(data.begin(), data.end(), k, comp),
+                  ::fsc::interpolation_lower_bound(data.begin(), data.end(), k, comp));
+      }
+
+      // sub ranges, including small ones.
+      for (size_t s = 1; s < 40; s += 3) {
+        auto b = data.begin() + 100;
+        auto e = b + s * s;
+        for (size_t i = 0; i < 100; ++i) {
+          EXPECT_EQ(std::lower_bound(b, e, q[i], comp),
+                    ::fsc::interpolation_lower_bound(b, e, q[i], comp));
+        }
+      }
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(InterpolationSearchTest);
+
+TYPED_TEST_P(InterpolationSearchTest, uniform)
+{
+  this->template check<::bliss::transform::identity>(this->random);
+  this->template check<::bliss::kmer::transform::lex_less>(this->random);
+}
+
+TYPED_TEST_P(InterpolationSearchTest, repeats)
+{
+  this->template check<::bliss::transform::identity>(this->skewed);
+  this->template check<::bliss::kmer::transform::lex_less>(this->skewed);
+}
+
+TYPED_TEST_P(InterpolationSearchTest, pairs)
+{
+  using Less = ::fsc::TransformedComparator<TypeParam, ::std::less, ::bliss::kmer::transform::lex_less>;
+  Less comp;
+
+  std::vector<std::pair<TypeParam, uint32_t> > data;
+  for (uint32_t i = 0; i < this->random.size(); ++i) {
+    data.emplace_back(this->random[i], i);
+  }
+  std::sort(data.begin(), data.end(), comp);
+
+  for (auto const & k : this->queries) {
+    EXPECT_EQ(std::lower_bound(data.begin(), data.end(), k, comp),
+              ::fsc::interpolation_lower_bound(data.begin(), data.end(), k, comp));
+  }
+}
+
+TYPED_TEST_P(InterpolationSearchTest, prefix_directory)
+{
+  using Less = ::fsc::TransformedComparator<TypeParam, ::std::less, ::bliss::kmer::transform::lex_less>;
+  Less comp;
+
+  for (auto data : {this->random, this->skewed}) {
+    std::sort(data.begin(), data.end(), comp);
+    std::vector<TypeParam> q(this->queries);
+    q.insert(q.end(), data.begin(), data.begin() + 5000);
+    q.emplace_back(data.front());
+    q.emplace_back(data.back());
+
+    for (unsigned int bits : {1U, 6U, 12U, 30U}) {
+      ::fsc::prefix_directory<Less> dir;
+      dir.build(data.begin(), data.end(), bits);
+      EXPECT_FALSE(dir.empty());
+      EXPECT_GE(::fsc::prefix_directory<Less>::max_bits, dir.get_bits());
+
+      // the lower bound, and every equal entry, is in the range.
+      for (auto const & k : q) {
+        auto r = dir.range(k);
+        auto lb = std::lower_bound(data.begin(), data.end(), k, comp);
+        auto ub = std::upper_bound(data.begin(), data.end(), k, comp);
+        EXPECT_LE(r.first, static_cast<size_t>(lb - data.begin()));
+        EXPECT_GE(r.second, static_cast<size_t>(ub - data.begin()));
+        EXPECT_EQ(lb, std::lower_bound(data.begin() + r.first, data.begin() + r.second, k, comp));
+      }
+    }
+  }
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(InterpolationSearchTest, uniform, repeats, pairs, prefix_directory);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<::bliss::common::Kmer<21, ::bliss::common::DNA, uint16_t>,
+                         ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>,
+                         ::bliss::common::Kmer<45, ::bliss::common::DNA, uint64_t>,
+                         ::bliss::common::Kmer<17, ::bliss::common::DNA5, uint32_t> > InterpolationSearchTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, InterpolationSearchTest, InterpolationSearchTestTypes);
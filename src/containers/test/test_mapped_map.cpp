@@ -0,0 +1,201 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/mapped_map.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <random>
+#include <vector>
+#include <cstdio>     // remove
+#include <unistd.h>   // getpid
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class MappedMapTest : public ::testing::Test
+{
+  protected:
+    ::std::unordered_multimap<T, T> gold;
+    ::std::vector<::std::pair<T, T> > input;
+    ::std::string filename;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs.  keys repeat.
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(0,9999);
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        input.emplace_back(key, val);
+        gold.emplace(key, val);
+      }
+
+      filename = ::std::string("/tmp/test_mapped_map.") + ::std::to_string(getpid()) + ".bin";
+    }
+
+    virtual void TearDown() {
+      remove(filename.c_str());
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(MappedMapTest);
+
+TYPED_TEST_P(MappedMapTest, sorted)
+{
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam>::write(this->filename, this->input);
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam> test(this->filename);
+
+  ASSERT_EQ(this->gold.size(), test.size());
+  ASSERT_TRUE(::std::is_sorted(test.begin(), test.end(),
+                               [](::std::pair<TypeParam, TypeParam> const & x, ::std::pair<TypeParam, TypeParam> const & y){
+    return x.first < y.first;
+  }));
+
+  for (TypeParam k = 0; k < 11000; ++k) {
+    ASSERT_EQ(this->gold.count(k), test.count(k));
+
+    auto it = test.find(k);
+    if (this->gold.count(k) == 0) {
+      ASSERT_TRUE(it == test.end());
+    } else {
+      ASSERT_EQ(k, it->first);
+    }
+  }
+}
+
+TYPED_TEST_P(MappedMapTest, hashed)
+{
+  ::fsc::mapped_hash_map<TypeParam, TypeParam>::write(this->filename, this->input);
+  ::fsc::mapped_hash_map<TypeParam, TypeParam> test(this->filename);
+
+  ASSERT_EQ(this->gold.size(), test.size());
+  ASSERT_GE(test.capacity() / 2, test.size());
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > results;
+  for (TypeParam k = 0; k < 11000; ++k) {
+    ASSERT_EQ(this->gold.count(k), test.count(k));
+
+    auto it = test.find(k);
+    if (this->gold.count(k) == 0) {
+      ASSERT_TRUE(it == nullptr);
+    } else {
+      ASSERT_EQ(k, it->first);
+    }
+
+    // values match too.
+    results.clear();
+    test.find(k, ::std::back_inserter(results));
+    ::std::vector<TypeParam> vals, gold_vals;
+    for (auto x : results) vals.emplace_back(x.second);
+    auto range = this->gold.equal_range(k);
+    for (auto g = range.first; g != range.second; ++g) gold_vals.emplace_back(g->second);
+    ::std::sort(vals.begin(), vals.end());
+    ::std::sort(gold_vals.begin(), gold_vals.end());
+    ASSERT_EQ(gold_vals, vals);
+  }
+
+  test.to_vector(results);
+  ASSERT_EQ(this->gold.size(), results.size());
+}
+
+TYPED_TEST_P(MappedMapTest, wrong_layout)
+{
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam>::write(this->filename, this->input);
+
+  bool thrown = false;
+  try {
+    ::fsc::mapped_hash_map<TypeParam, TypeParam> test(this->filename);
+  } catch (::bliss::io::IOException & e) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+TYPED_TEST_P(MappedMapTest, rewrite_while_mapped)
+{
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam>::write(this->filename, this->input);
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam> test(this->filename);
+
+  // replacing the file does not change an existing mapping.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > other(this->input.begin(), this->input.begin() + 10);
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam>::write(this->filename, other);
+  ::fsc::mapped_sorted_map<TypeParam, TypeParam> test2(this->filename);
+
+  ASSERT_EQ(this->gold.size(), test.size());
+  ASSERT_EQ(10UL, test2.size());
+  for (TypeParam k = 0; k < 11000; ++k) {
+    ASSERT_EQ(this->gold.count(k), test.count(k));
+  }
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(MappedMapTest, sorted, hashed, wrong_layout, rewrite_while_mapped);
+
+typedef ::testing::Types<uint32_t, uint64_t> MappedMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, MappedMapTest, MappedMapTestTypes);
+
+
+/// kmer keys, with the kmer hash functions used by the index.
+TEST(MappedKmerMapTest, hashed)
+{
+  using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+  using HashType = ::bliss::kmer::hash::farm<KmerType, false>;
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  ::std::vector<::std::pair<KmerType, uint32_t> > input;
+  KmerType km;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    km.getDataRef()[0] = distribution(generator) & 0x3FFFFFFFFFFFFFFFUL;
+    input.emplace_back(km, i);
+  }
+
+  ::std::string filename = ::std::string("/tmp/test_mapped_kmer_map.") + ::std::to_string(getpid()) + ".bin";
+  ::fsc::mapped_hash_map<KmerType, uint32_t, HashType>::write(filename, input);
+  ::fsc::mapped_sorted_map<KmerType, uint32_t>::write(filename + ".sorted", input);
+  {
+    ::fsc::mapped_hash_map<KmerType, uint32_t, HashType> test(filename);
+    ::fsc::mapped_sorted_map<KmerType, uint32_t> test2(filename + ".sorted");
+
+    for (auto const & x : input) {
+      auto it = test.find(x.first);
+      ASSERT_TRUE(it != nullptr);
+      ASSERT_EQ(x.second, it->second);
+
+      auto it2 = test2.find(x.first);
+      ASSERT_TRUE(it2 != test2.end());
+      ASSERT_EQ(x.second, it2->second);
+    }
+  }
+  remove(filename.c_str());
+  remove((filename + ".sorted").c_str());
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/mphf_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+
+
+template <typename T>
+struct hash64 {
+    inline uint64_t operator()(T const & x) const { return ::fsc::mphf::mix(static_cast<uint64_t>(x) * 0x9e3779b97f4a7c15ULL + 1); }
+};
+
+
+TEST(MphfMapTest, find_all_inserted)
+{
+  for (size_t n : {0UL, 1UL, 63UL, 1000UL, 100000UL}) {
+    std::default_random_engine generator(n);
+    std::uniform_int_distribution<uint64_t> distribution;
+
+    std::unordered_map<uint64_t, uint32_t> gold;
+    while (gold.size() < n) gold.emplace(distribution(generator), gold.size());
+    std::vector<std::pair<uint64_t, uint32_t> > entries(gold.begin(), gold.end());
+
+    ::fsc::mphf_map<uint64_t, uint32_t, hash64<uint64_t> > m(entries.begin(), entries.end());
+    EXPECT_EQ(n, m.size());
+
+    for (auto const & x : gold) {
+      uint32_t const * v = m.find(x.first);
+      ASSERT_TRUE(v != nullptr);
+      EXPECT_EQ(x.second, *v);
+      EXPECT_EQ(1UL, m.count(x.first));
+    }
+
+    if (n >= 1000) {
+      // about 2 bits per key at level 0, as a geometric series with gamma = 2, plus the rank words.
+      EXPECT_LT(static_cast<double>(m.hash_bytes() * 8) / static_cast<double>(n), 5.0);
+    }
+  }
+}
+
+
+TEST(MphfMapTest, absent_keys)
+{
+  size_t n = 100000;
+  std::default_random_engine generator(11);
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  std::unordered_map<uint64_t, uint32_t> gold;
+  while (gold.size() < n) gold.emplace(distribution(generator), 1);
+  std::vector<std::pair<uint64_t, uint32_t> > entries(gold.begin(), gold.end());
+
+  ::fsc::mphf_map<uint64_t, uint32_t, hash64<uint64_t>, uint16_t> m16(entries.begin(), entries.end());
+  ::fsc::mphf_map<uint64_t, uint32_t, hash64<uint64_t>, uint8_t> m8(entries.begin(), entries.end());
+
+  // false positive rate about 2^-16 and 2^-8.
+  size_t fp16 = 0, fp8 = 0, queries = 0;
+  while (queries < n) {
+    uint64_t k = distribution(generator);
+    if (gold.count(k) > 0) continue;
+    ++queries;
+    fp16 += m16.count(k);
+    fp8 += m8.count(k);
+  }
+  EXPECT_LT(fp16, 20UL);
+  EXPECT_LT(fp8, 2 * n / 256);
+}
+
+
+TEST(MphfMapTest, kmer_keys)
+{
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  std::default_random_engine generator(3);
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  std::unordered_map<KmerType, size_t, ::bliss::kmer::hash::farm<KmerType, false> > gold;
+  while (gold.size() < 10000) {
+    KmerType k;
+    for (size_t i = 0; i < KmerType::size; ++i) k.nextFromChar(distribution(generator) % 4);
+    gold.emplace(k, gold.size());
+  }
+  std::vector<std::pair<KmerType, size_t> > entries(gold.begin(), gold.end());
+
+  ::fsc::mphf_map<KmerType, size_t, ::bliss::kmer::hash::farm<KmerType, false> > m(entries.begin(), entries.end());
+  EXPECT_EQ(gold.size(), m.size());
+  for (auto const & x : gold) {
+    size_t const * v = m.find(x.first);
+    ASSERT_TRUE(v != nullptr);
+    EXPECT_EQ(x.second, *v);
+  }
+}
+
+
+/// maps pairs of keys to the same 64 bit hash.
+template <typename T>
+struct colliding_hash64 {
+    inline uint64_t operator()(T const & x) const { return ::fsc::mphf::mix(static_cast<uint64_t>(x) / 2 + 1); }
+};
+
+TEST(MphfMapTest, hash_collisions)
+{
+  // keys 2i and 2i + 1 have the same hash, so they collide at every level and are told apart in the fallback table.
+  std::vector<std::pair<uint64_t, uint32_t> > entries;
+  for (uint64_t k = 0; k < 200; ++k) entries.emplace_back(k, static_cast<uint32_t>(k * 3));
+
+  ::fsc::mphf_map<uint64_t, uint32_t, colliding_hash64<uint64_t> > m(entries.begin(), entries.end());
+  EXPECT_EQ(entries.size(), m.size());
+  for (auto const & x : entries) {
+    uint32_t const * v = m.find(x.first);
+    ASSERT_TRUE(v != nullptr);
+    EXPECT_EQ(x.second, *v);
+  }
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/multiway_merge.hpp"
+
+#include <random>
+#include <algorithm>  // for stable_sort
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+typedef std::pair<uint32_t, uint32_t> Entry;
+
+/// compare keys only, so ties show whether the merge is stable.
+struct FirstLess {
+    bool operator()(Entry const & x, Entry const & y) const {
+      return x.first < y.first;
+    }
+};
+
+/// sorted runs of the given sizes, with many equal keys across them.  values are the positions in the concatenation.
+std::vector<Entry> make_runs(std::vector<size_t> const & counts, std::vector<Entry> & gold) {
+  std::default_random_engine generator(counts.size());
+  std::uniform_int_distribution<uint32_t> distribution(0, 1000);
+  std::vector<Entry> data;
+  size_t start = 0;
+  for (size_t c : counts) {
+    for (size_t i = 0; i < c; ++i) data.emplace_back(distribution(generator), 0);
+    std::sort(data.begin() + start, data.end(), FirstLess());
+    start += c;
+  }
+  for (uint32_t i = 0; i < data.size(); ++i) data[i].second = i;
+
+  // stable sort of the concatenation is the stable merge.
+  gold = data;
+  std::stable_sort(gold.begin(), gold.end(), FirstLess());
+  return data;
+}
+
+void check_merge(std::vector<size_t> const & counts, int nthreads) {
+  std::vector<Entry> gold;
+  std::vector<Entry> data = make_runs(counts, gold);
+
+  typedef std::vector<Entry>::iterator Iter;
+  std::vector<std::pair<Iter, Iter> > runs;
+  size_t start = 0;
+  for (size_t c : counts) {
+    runs.emplace_back(data.begin() + start, data.begin() + start + c);
+    start += c;
+  }
+
+  std::vector<Entry> merged(data.size());
+  auto end = ::fsc::multiway_merge(runs, merged.begin(), FirstLess(), nthreads);
+  EXPECT_TRUE(end == merged.end());
+  EXPECT_EQ(gold, merged);
+}
+
+void check_block_merge(std::vector<size_t> const & counts, size_t block) {
+  std::vector<Entry> gold;
+  std::vector<Entry> data = make_runs(counts, gold);
+
+  // copy the runs to their block aligned places.
+  std::vector<size_t> displs;
+  std::vector<Entry> blocks(::fsc::block_merge_storage(counts, block, displs));
+  size_t start = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    std::copy(data.begin() + start, data.begin() + start + counts[i], blocks.begin() + displs[i]);
+    start += counts[i];
+  }
+
+  ::fsc::block_multiway_merge(blocks, counts, displs, block, FirstLess());
+  EXPECT_EQ(gold, blocks);
+}
+
+TEST(MultiwayMergeTest, loser_tree)
+{
+  check_merge({1000, 2000, 3000}, 1);
+  check_merge({5000}, 1);
+  check_merge({0, 100, 0, 7, 300}, 1);
+  check_merge({1, 1, 1, 1, 1, 1, 1, 1, 1}, 1);
+  check_merge({}, 1);
+}
+
+TEST(MultiwayMergeTest, threads)
+{
+  check_merge({300000, 200000, 100000}, 4);
+  check_merge({100000, 0, 100000, 1, 100000, 50000, 70000}, 3);
+  check_merge({400000}, 4);
+}
+
+TEST(MultiwayMergeTest, blocks)
+{
+  check_block_merge({1000, 2000, 3000}, 64);
+  check_block_merge({1000, 2000, 3000}, 1);
+  check_block_merge({0, 17, 1000, 0, 5}, 16);
+  check_block_merge({4096, 4096}, 1024);
+  check_block_merge({10000}, 7);
+  check_block_merge({3, 5, 2}, 100);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/parallel_merge.hpp"
+
+#include <random>
+#include <algorithm>  // for stable_sort, merge
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/// compare keys only, so ties show whether the merge is stable.
+struct FirstLess {
+    bool operator()(std::pair<uint32_t, uint32_t> const & x, std::pair<uint32_t, uint32_t> const & y) const {
+      return x.first < y.first;
+    }
+};
+
+/// 2 sorted runs of sizes na and nb, with many equal keys across them.  values are the positions before the merge.
+void check_merge(size_t na, size_t nb, int nthreads) {
+  std::default_random_engine generator(na + nb);
+  std::uniform_int_distribution<uint32_t> distribution(0, 1000);
+  std::vector<std::pair<uint32_t, uint32_t> > data;
+  for (uint32_t i = 0; i < na + nb; ++i) data.emplace_back(distribution(generator), 0);
+  std::sort(data.begin(), data.begin() + na, FirstLess());
+  std::sort(data.begin() + na, data.end(), FirstLess());
+  for (uint32_t i = 0; i < data.size(); ++i) data[i].second = i;
+
+  std::vector<std::pair<uint32_t, uint32_t> > gold(data);
+  std::inplace_merge(gold.begin(), gold.begin() + na, gold.end(), FirstLess());
+
+  ::fsc::inplace_merge(data, 0, na, FirstLess(), nthreads);
+  EXPECT_EQ(gold, data);
+}
+
+TEST(ParallelMergeTest, merge)
+{
+  check_merge(300000, 200000, 4);
+  check_merge(1, 400000, 4);
+  check_merge(400000, 1, 3);
+  check_merge(1000, 1000, 4);   // too small to split.
+  check_merge(0, 1000, 4);
+}
+
+TEST(ParallelMergeTest, offset)
+{
+  // merge only the tail runs.
+  std::vector<std::pair<uint32_t, uint32_t> > data;
+  for (uint32_t i = 0; i < 100; ++i) data.emplace_back(1000 - i, i);
+  for (uint32_t i = 0; i < 200000; ++i) data.emplace_back(i / 3, i);
+  for (uint32_t i = 0; i < 100000; ++i) data.emplace_back(i / 2, i);
+  std::vector<std::pair<uint32_t, uint32_t> > gold(data);
+  std::inplace_merge(gold.begin() + 100, gold.begin() + 200100, gold.end(), FirstLess());
+
+  ::fsc::inplace_merge(data, 100, 200100, FirstLess(), 4);
+  EXPECT_EQ(gold, data);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/posting_list.hpp"
+#include "common/sequence.hpp"
+
+#include <algorithm>  // sort
+#include <random>
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+
+TEST(PostingListTest, roundtrip)
+{
+  std::mt19937_64 gen(7);
+
+  // sizes around the 2 and 4 value groups, and deltas of all byte lengths.
+  for (size_t n : {0, 1, 2, 3, 4, 5, 8, 9, 1000}) {
+    for (uint64_t range : {1UL << 6, 1UL << 14, 1UL << 30, 1UL << 62}) {
+      std::vector<uint64_t> ids(n);
+      for (auto & x : ids) x = gen() % range;
+      std::sort(ids.begin(), ids.end());
+
+      ::fsc::posting_list pl;
+      pl.assign(ids.data(), ids.size());
+      ASSERT_EQ(n, pl.size());
+      EXPECT_EQ(ids, pl.decode());
+    }
+  }
+
+  // max values and repeats.
+  std::vector<uint64_t> ids = {0, 0, 255, 256, 65535, 65536, 0xFFFFFFFFUL, 0x100000000UL, 0xFFFFFFFFFFFFFFFFUL, 0xFFFFFFFFFFFFFFFFUL};
+  ::fsc::posting_list pl;
+  pl.assign(ids.data(), ids.size());
+  EXPECT_EQ(ids, pl.decode());
+}
+
+TEST(PostingListTest, compression)
+{
+  // close positions take about 1 byte each.
+  std::vector<uint64_t> ids(10000);
+  for (size_t i = 0; i < ids.size(); ++i) ids[i] = (1UL << 40) + i * 100;
+
+  ::fsc::posting_list pl;
+  pl.assign(ids.data(), ids.size());
+  EXPECT_LT(pl.bytes(), ids.size() * 2);
+  EXPECT_EQ(ids, pl.decode());
+}
+
+TEST(PostingListTest, map)
+{
+  using Id = ::bliss::common::ShortSequenceKmerId;
+  ::fsc::posting_map<uint64_t, Id> pm;
+
+  std::vector<std::pair<uint64_t, Id> > input;
+  for (size_t i = 0; i < 100; ++i) input.emplace_back(i % 7, Id(1000 + i, 0, i % 50));
+  pm.insert(input);
+
+  // second batch is merged into the existing lists.
+  std::vector<std::pair<uint64_t, Id> > more;
+  for (size_t i = 100; i < 150; ++i) more.emplace_back(i % 7, Id(1000 + i, 1, 0));
+  pm.insert(more);
+  input.insert(input.end(), more.begin(), more.end());
+
+  EXPECT_EQ(150UL, pm.size());
+  EXPECT_EQ(7UL, pm.unique_size());
+
+  for (uint64_t k = 0; k < 7; ++k) {
+    std::vector<uint64_t> expected;
+    for (auto const & x : input)
+      if (x.first == k) expected.emplace_back(x.second.id);
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<std::pair<uint64_t, Id> > found;
+    EXPECT_EQ(expected.size(), pm.find(k, found));
+    EXPECT_EQ(expected.size(), pm.count(k));
+    ASSERT_EQ(expected.size(), found.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+      EXPECT_EQ(k, found[i].first);
+      EXPECT_EQ(expected[i], found[i].second.id);
+    }
+  }
+  EXPECT_EQ(0UL, pm.count(7));
+
+  pm.erase(3);
+  EXPECT_EQ(0UL, pm.count(3));
+  EXPECT_EQ(6UL, pm.unique_size());
+}
+
+TEST(PostingListTest, dense_id)
+{
+  using Id = ::bliss::common::DenseSequenceKmerId<uint32_t>;
+  EXPECT_EQ(6UL, sizeof(Id));
+  EXPECT_EQ(10UL, sizeof(::bliss::common::DenseSequenceKmerId<uint64_t>));
+
+  // id from a numbered SequenceId, then positions as the kmer parsers increment them.
+  Id a(::bliss::common::SequenceId(1000, 5));
+  a += 40;
+  EXPECT_EQ(5UL, a.get_id());
+  EXPECT_EQ(40UL, a.get_pos());
+  EXPECT_TRUE(Id(4, 200) < a);
+  EXPECT_TRUE(Id(5, 41) > a);
+  EXPECT_EQ(1, Id(5, 41) - a);
+
+  // dense read numbers give 1 byte deltas.
+  ::fsc::posting_map<uint64_t, Id> pm;
+  std::vector<std::pair<uint64_t, Id> > input;
+  for (size_t i = 0; i < 1000; ++i) input.emplace_back(0, Id(i / 3, (i % 3) * 20));
+  pm.insert(input);
+
+  std::vector<std::pair<uint64_t, Id> > found;
+  ASSERT_EQ(input.size(), pm.find(0, found));
+  for (size_t i = 0; i < found.size(); ++i) EXPECT_EQ(input[i].second, found[i].second);
+  EXPECT_LT(pm.bytes(), input.size() * 2 + 128);
+}
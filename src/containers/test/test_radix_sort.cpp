@@ -0,0 +1,121 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/radix_sort.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+
+#include <random>
+#include <algorithm>  // for stable_sort
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename KMER>
+class RadixSortTest : public ::testing::Test
+{
+  protected:
+
+    std::vector<std::pair<KMER, uint32_t> > entries;
+
+    virtual void SetUp()
+    {
+      // a random sequence, then repeats of a few kmers so there are equal keys to check stability.
+      srand(0);
+      KMER kmer;
+      for (unsigned int i = 0; i < KMER::size; ++i) {
+        kmer.nextFromChar(rand() % KMER::KmerAlphabet::SIZE);
+      }
+      for (uint32_t i = 0; i < 150000; ++i) {
+        entries.emplace_back(kmer, i);
+        kmer.nextFromChar(rand() % KMER::KmerAlphabet::SIZE);
+      }
+      for (uint32_t i = 0; i < 20000; ++i) {
+        entries.emplace_back(entries[i % 7].first, 150000 + i);
+      }
+      std::shuffle(entries.begin(), entries.end(), std::default_random_engine(1));
+    }
+
+    static bool key_less(std::pair<KMER, uint32_t> const & x, std::pair<KMER, uint32_t> const & y) {
+      return x.first < y.first;
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(RadixSortTest);
+
+TYPED_TEST_P(RadixSortTest, kmers)
+{
+  std::vector<TypeParam> keys;
+  for (auto const & e : this->entries) keys.emplace_back(e.first);
+
+  std::vector<TypeParam> gold(keys);
+  std::sort(gold.begin(), gold.end());
+
+  for (int t = 1; t <= 4; t += 3) {
+    std::vector<TypeParam> test(keys);
+    ::fsc::radix_sort(test, t);
+    EXPECT_TRUE(test == gold);
+  }
+}
+
+TYPED_TEST_P(RadixSortTest, pairs_stable)
+{
+  std::vector<std::pair<TypeParam, uint32_t> > gold(this->entries);
+  std::stable_sort(gold.begin(), gold.end(), &RadixSortTest<TypeParam>::key_less);
+
+  for (int t = 1; t <= 4; t += 3) {
+    std::vector<std::pair<TypeParam, uint32_t> > test(this->entries);
+    ::fsc::radix_sort(test, t);
+    EXPECT_TRUE(test == gold);
+  }
+}
+
+TYPED_TEST_P(RadixSortTest, transformed)
+{
+  using Less = ::fsc::TransformedComparator<TypeParam, ::std::less, ::bliss::kmer::transform::lex_less>;
+  static_assert(::fsc::is_radix_sortable<Less>::value, "lex_less comparator should use radix sort");
+
+  std::vector<std::pair<TypeParam, uint32_t> > gold(this->entries);
+  std::stable_sort(gold.begin(), gold.end(), [](std::pair<TypeParam, uint32_t> const & x, std::pair<TypeParam, uint32_t> const & y) {
+    return Less()(x.first, y.first);
+  });
+
+  std::vector<std::pair<TypeParam, uint32_t> > test(this->entries);
+  ::fsc::radix_sort(test, typename ::fsc::is_radix_sortable<Less>::transform_type(), 4);
+  EXPECT_TRUE(test == gold);
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(RadixSortTest, kmers, pairs_stable, transformed);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<::bliss::common::Kmer<21, ::bliss::common::DNA, uint16_t>,
+                         ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>,
+                         ::bliss::common::Kmer<45, ::bliss::common::DNA, uint64_t>,
+                         ::bliss::common::Kmer<17, ::bliss::common::DNA5, uint32_t> > RadixSortTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, RadixSortTest, RadixSortTestTypes);
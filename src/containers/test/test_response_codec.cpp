@@ -0,0 +1,142 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_response_codec.cpp
+ * @ingroup
+ * @brief   tests that the compressed find responses decode to the same results, grouped per destination.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include "containers/response_codec.hpp"
+#include "common/sequence.hpp"
+
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+/// results for 3 destinations:  keys with 1 to 200 values each, values of nearby ids.
+template <typename T, typename Make>
+std::vector<std::pair<uint64_t, T> > make_results(std::vector<size_t> & counts, Make const & make) {
+  std::default_random_engine generator(11);
+  std::uniform_int_distribution<uint64_t> mult(1, 200);
+  std::uniform_int_distribution<uint64_t> step(0, 300);
+
+  std::vector<std::pair<uint64_t, T> > results;
+  counts.assign(3, 0);
+  for (size_t d = 0; d < counts.size(); ++d) {
+    for (uint64_t k = 0; k < 50; ++k) {
+      size_t n = mult(generator);
+      uint64_t id = k << 24;
+      for (size_t j = 0; j < n; ++j) {
+        id += step(generator);
+        results.emplace_back(k * 7 + d, make(id, j));
+      }
+      counts[d] += n;
+    }
+  }
+  // values of a key out of order.
+  std::reverse(results.begin(), results.begin() + counts[0]);
+  return results;
+}
+
+template <typename T, typename Less>
+void check_round_trip(std::vector<std::pair<uint64_t, T> > results, std::vector<size_t> const & counts, Less const & less) {
+  std::vector<std::pair<uint64_t, T> > gold(results);
+
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> byte_counts;
+  ::dsc::encode_responses(results, counts, bytes, byte_counts);
+  EXPECT_EQ(bytes.size(), std::accumulate(byte_counts.begin(), byte_counts.end(), static_cast<size_t>(0)));
+
+  // each destination decodes to its results, up to the order of the values of a key.
+  size_t offset = 0, first = 0;
+  for (size_t d = 0; d < counts.size(); ++d) {
+    std::vector<std::pair<uint64_t, T> > decoded;
+    ::dsc::decode_responses(bytes.data() + offset, bytes.data() + offset + byte_counts[d], decoded);
+    ASSERT_EQ(counts[d], decoded.size());
+
+    std::vector<std::pair<uint64_t, T> > expected(gold.begin() + first, gold.begin() + first + counts[d]);
+    std::sort(expected.begin(), expected.end(), less);
+    std::sort(decoded.begin(), decoded.end(), less);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].first, decoded[i].first);
+      EXPECT_TRUE(!less(expected[i], decoded[i]) && !less(decoded[i], expected[i]));
+    }
+    offset += byte_counts[d];
+    first += counts[d];
+  }
+}
+
+TEST(ResponseCodecTest, positions)
+{
+  using T = bliss::common::ShortSequenceKmerId;
+  std::vector<size_t> counts;
+  auto results = make_results<T>(counts, [](uint64_t id, size_t) { T v; v.id = id; return v; });
+  auto less = [](std::pair<uint64_t, T> const & x, std::pair<uint64_t, T> const & y) {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second.id < y.second.id));
+  };
+  check_round_trip(results, counts, less);
+
+  // nearby positions take 1-2 bytes instead of 8, and the key is sent once per key.
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> byte_counts;
+  ::dsc::encode_responses(results, counts, bytes, byte_counts);
+  EXPECT_LT(bytes.size() * 4, results.size() * sizeof(std::pair<uint64_t, T>));
+}
+
+TEST(ResponseCodecTest, position_quality)
+{
+  using T = std::pair<bliss::common::LongSequenceKmerId, float>;
+  std::vector<size_t> counts;
+  auto results = make_results<T>(counts, [](uint64_t id, size_t j) {
+    T v;
+    v.first.id = id;
+    v.second = 0.5f * j;
+    return v;
+  });
+  auto less = [](std::pair<uint64_t, T> const & x, std::pair<uint64_t, T> const & y) {
+    return (x.first < y.first) || ((x.first == y.first) &&
+        ((x.second.first.id < y.second.first.id) ||
+         ((x.second.first.id == y.second.first.id) && (x.second.second < y.second.second))));
+  };
+  check_round_trip(results, counts, less);
+}
+
+TEST(ResponseCodecTest, raw_values)
+{
+  using T = std::pair<double, double>;
+  std::vector<size_t> counts;
+  auto results = make_results<T>(counts, [](uint64_t id, size_t j) { return T(0.25 * id, 1.0 * j); });
+  auto less = [](std::pair<uint64_t, T> const & x, std::pair<uint64_t, T> const & y) { return x < y; };
+  check_round_trip(results, counts, less);
+}
+
+TEST(ResponseCodecTest, empty)
+{
+  std::vector<std::pair<uint64_t, uint32_t> > results;
+  std::vector<size_t> counts(4, 0);
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> byte_counts;
+  ::dsc::encode_responses(results, counts, bytes, byte_counts);
+  EXPECT_EQ(0UL, bytes.size());
+  EXPECT_EQ(4UL, byte_counts.size());
+}
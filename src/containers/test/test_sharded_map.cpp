@@ -0,0 +1,277 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/sharded_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+#include <functional>  // plus
+
+#include "utils/filter_utils.hpp"
+#include "utils/transform_utils.hpp"
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class ShardedMapTest : public ::testing::Test
+{
+    static_assert(std::is_integral<T>::value, "only supporting integral types in tests right now.");
+  protected:
+
+    // repeated keys, so insert keeps the first and insert_reduce adds.
+    ::std::unordered_map<T, T> gold;
+    ::std::unordered_map<T, T> gold_sum;
+    ::std::vector<std::pair<T, T>> temp;
+
+    size_t iters = 100000;
+
+    /// (threads, shards).  0 shards means 4 x threads.  enough elements for 4 threads to be used.
+    ::std::vector<::std::pair<int, size_t> > configs = { {1, 1}, {1, 3}, {4, 0}, {4, 7} };
+
+    virtual void SetUp()
+    { // generate some inputs
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(0, static_cast<T>(iters / 2));
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        gold.emplace(key, val);
+        gold_sum[key] += val;
+        temp.emplace_back(::std::move(key), ::std::move(val));
+      }
+    }
+
+    static bool less(::std::pair<T, T> const & x, ::std::pair<T, T> const &y) {
+      return (x.first == y.first) ? (x.second < y.second) : (x.first < y.first);
+    }
+
+    template <typename MAP>
+    void check(MAP const & test, ::std::unordered_map<T, T> const & g) {
+      EXPECT_EQ(g.size(), test.size());
+
+      ::std::vector<::std::pair<T, T> > test_vals = test.to_vector();
+      ::std::vector<::std::pair<T, T> > iter_vals(test.begin(), test.end());
+      ::std::vector<::std::pair<T, T> > gold_vals(g.begin(), g.end());
+
+      ::std::sort(test_vals.begin(), test_vals.end(), &ShardedMapTest<T>::less);
+      ::std::sort(iter_vals.begin(), iter_vals.end(), &ShardedMapTest<T>::less);
+      ::std::sort(gold_vals.begin(), gold_vals.end(), &ShardedMapTest<T>::less);
+
+      ASSERT_EQ(gold_vals.size(), test_vals.size());
+      ASSERT_EQ(gold_vals.size(), iter_vals.size());
+      EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+      EXPECT_TRUE(::std::equal(iter_vals.begin(), iter_vals.end(), gold_vals.begin()));
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(ShardedMapTest);
+
+TYPED_TEST_P(ShardedMapTest, insert)
+{
+  using MAP = ::fsc::sharded_swiss_map<TypeParam, TypeParam>;
+
+  for (auto conf : this->configs) {
+    MAP test(128, conf.first, conf.second);
+    test.insert(this->temp);
+    this->check(test, this->gold);
+
+    // 1 at a time keeps the first value too.
+    MAP single(128, conf.first, conf.second);
+    for (auto x : this->temp) single.insert(x);
+    this->check(single, this->gold);
+
+    EXPECT_EQ(test.size(), ::std::distance(test.begin(), test.end()));
+    EXPECT_EQ((conf.second == 0) ? static_cast<size_t>(4 * test.get_thread_count()) : conf.second, test.shard_count());
+  }
+}
+
+TYPED_TEST_P(ShardedMapTest, insert_reduce)
+{
+  using MAP = ::fsc::sharded_swiss_map<TypeParam, TypeParam>;
+
+  for (auto conf : this->configs) {
+    MAP test(128, conf.first, conf.second);
+    EXPECT_EQ(this->gold_sum.size(), test.insert_reduce(this->temp.begin(), this->temp.end(), ::std::plus<TypeParam>()));
+    this->check(test, this->gold_sum);
+
+    // again, with only the odd values.  no new keys.
+    auto odd = [](::std::pair<TypeParam, TypeParam> const & x) { return (x.second & 0x1) == 1; };
+    ::std::unordered_map<TypeParam, TypeParam> g = this->gold_sum;
+    for (auto x : this->temp) {
+      if (odd(x)) g[x.first] += x.second;
+    }
+    EXPECT_EQ(0UL, test.insert_reduce(this->temp.begin(), this->temp.end(), ::std::plus<TypeParam>(), odd));
+    this->check(test, g);
+  }
+}
+
+TYPED_TEST_P(ShardedMapTest, find_count)
+{
+  using MAP = ::fsc::sharded_swiss_map<TypeParam, TypeParam>;
+
+  // present and absent keys.
+  ::std::vector<TypeParam> queries;
+  for (size_t i = 0; i < this->iters; ++i) queries.emplace_back(static_cast<TypeParam>(i));
+
+  for (auto conf : this->configs) {
+    MAP test(128, conf.first, conf.second);
+    test.insert(this->temp);
+
+    for (auto i : this->gold) {
+      EXPECT_EQ(1UL, test.count(i.first));
+      EXPECT_TRUE(test.exists(i.first));
+      auto it = test.find(i.first);
+      ASSERT_TRUE(it != test.end());
+      EXPECT_EQ(i.second, it->second);
+
+      auto range = test.equal_range(i.first);
+      EXPECT_EQ(1, ::std::distance(range.first, range.second));
+    }
+
+    ::std::vector<typename MAP::value_type const *> results(queries.size());
+    ::std::vector<typename MAP::size_type> counts(queries.size());
+    test.find(queries.data(), queries.size(), results.data());
+    test.count(queries.data(), queries.size(), counts.data());
+    for (size_t i = 0; i < queries.size(); ++i) {
+      auto g = this->gold.find(queries[i]);
+      EXPECT_EQ(this->gold.count(queries[i]), counts[i]);
+      if (g == this->gold.end()) {
+        EXPECT_TRUE(results[i] == nullptr);
+        EXPECT_TRUE(test.find(queries[i]) == test.end());
+      } else {
+        ASSERT_TRUE(results[i] != nullptr);
+        EXPECT_EQ(g->first, results[i]->first);
+        EXPECT_EQ(g->second, results[i]->second);
+      }
+    }
+  }
+}
+
+TYPED_TEST_P(ShardedMapTest, erase_update)
+{
+  using MAP = ::fsc::sharded_swiss_map<TypeParam, TypeParam>;
+
+  for (auto conf : this->configs) {
+    MAP test(128, conf.first, conf.second);
+    test.insert(this->temp);
+
+    // erase the even keys
+    ::std::vector<TypeParam> evens;
+    ::std::unordered_map<TypeParam, TypeParam> g;
+    for (auto i : this->gold) {
+      if ((i.first & 0x1) == 0) evens.emplace_back(i.first);
+      else g.emplace(i);
+    }
+    EXPECT_EQ(evens.size(), test.erase(evens.begin(), evens.end()));
+    this->check(test, g);
+    EXPECT_EQ(0UL, test.erase(evens.begin(), evens.end()));
+
+    // add 1 to the keys divisible by 3, then erase them by predicate.
+    auto div3 = [](::std::pair<const TypeParam, TypeParam> const & x) { return (x.first % 3) == 0; };
+    size_t expected = 0;
+    for (auto & i : g) {
+      if ((i.first % 3) == 0) {
+        ++expected;
+        ++(i.second);
+      }
+    }
+    EXPECT_EQ(expected, test.update(div3, [](TypeParam & x) { ++x; return 1; }));
+    this->check(test, g);
+
+    EXPECT_EQ(expected, test.erase(div3));
+    for (auto it = g.begin(); it != g.end(); ) {
+      if ((it->first % 3) == 0) it = g.erase(it);
+      else ++it;
+    }
+    this->check(test, g);
+
+    // resize keeps the entries.
+    test.resize(4 * this->iters);
+    EXPECT_LE(4 * this->iters, test.bucket_count());
+    this->check(test, g);
+
+    test.clear();
+    EXPECT_TRUE(test.empty());
+    EXPECT_TRUE(test.begin() == test.end());
+  }
+}
+
+/// same signature as the distributed maps' find_element.
+struct ShardedFind {
+    template <typename DB, typename Q, typename OutputIter, typename Predicate, typename Transform>
+    size_t operator()(DB & db, Q const & q, OutputIter & output, Predicate const &, Transform const &) const {
+      auto it = db.find(q);
+      if (it == db.end()) return 0;
+      *output = *it;
+      ++output;
+      return 1;
+    }
+};
+
+TYPED_TEST_P(ShardedMapTest, process_queries)
+{
+  using MAP = ::fsc::sharded_swiss_map<TypeParam, TypeParam>;
+
+  ::std::vector<TypeParam> queries;
+  for (size_t i = 0; i < this->iters; ++i) queries.emplace_back(static_cast<TypeParam>(i));
+
+  ShardedFind find_element;
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > gold_vals;
+  for (auto q : queries) {
+    auto g = this->gold.find(q);
+    if (g != this->gold.end()) gold_vals.emplace_back(*g);
+  }
+
+  for (auto conf : this->configs) {
+    MAP test(128, conf.first, conf.second);
+    test.insert(this->temp);
+
+    // results in query order, through an emplace iterator and a vector iterator.
+    ::std::vector<::std::pair<TypeParam, TypeParam> > results;
+    ::fsc::back_emplace_iterator<::std::vector<::std::pair<TypeParam, TypeParam> > > emplace_iter(results);
+    EXPECT_EQ(gold_vals.size(), ::fsc::process_queries(test, queries.begin(), queries.end(), emplace_iter, find_element,
+                                                        ::bliss::filter::TruePredicate(), ::bliss::transform::identity<TypeParam>()));
+    EXPECT_TRUE(results == gold_vals);
+
+    ::std::vector<::std::pair<TypeParam, TypeParam> > direct(queries.size());
+    auto direct_iter = direct.begin();
+    EXPECT_EQ(gold_vals.size(), ::fsc::process_queries(test, queries.begin(), queries.end(), direct_iter, find_element,
+                                                        ::bliss::filter::TruePredicate(), ::bliss::transform::identity<TypeParam>()));
+    EXPECT_EQ(gold_vals.size(), ::std::distance(direct.begin(), direct_iter));
+    EXPECT_TRUE(::std::equal(gold_vals.begin(), gold_vals.end(), direct.begin()));
+  }
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(ShardedMapTest, insert, insert_reduce, find_count, erase_update, process_queries);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint32_t, uint64_t> ShardedMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, ShardedMapTest, ShardedMapTestTypes);
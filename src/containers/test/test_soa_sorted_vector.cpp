@@ -0,0 +1,107 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/soa_sorted_vector.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+
+#include <algorithm>  // for stable_sort, lower_bound
+#include <cstdint>  // uint32_t
+#include <cstdlib>  // rand
+#include <utility>  // pair
+#include <vector>
+
+
+TEST(SoaSortedVectorTest, sort_is_stable)
+{
+  std::vector<std::pair<uint32_t, uint32_t> > input;
+  srand(1);
+  for (uint32_t i = 0; i < 10000; ++i) input.emplace_back(rand() % 500, i);
+
+  ::fsc::soa_sorted_vector<uint32_t, uint32_t> v(input.begin(), input.end());
+  ASSERT_EQ(input.size(), v.size());
+
+  std::stable_sort(input.begin(), input.end(),
+                   [](std::pair<uint32_t, uint32_t> const & x, std::pair<uint32_t, uint32_t> const & y) {
+    return x.first < y.first;
+  });
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_EQ(input[i].first, v.key(i));
+    EXPECT_EQ(input[i].second, v.value(i));
+  }
+  EXPECT_TRUE(std::is_sorted(v.keys().begin(), v.keys().end()));
+}
+
+TEST(SoaSortedVectorTest, searches)
+{
+  std::vector<std::pair<uint32_t, uint64_t> > input;
+  srand(2);
+  for (uint32_t i = 0; i < 5000; ++i) input.emplace_back(2 * (rand() % 1000), i);
+  ::fsc::soa_sorted_vector<uint32_t, uint64_t> v(input.begin(), input.end());
+  std::vector<uint32_t> keys(v.keys());
+
+  size_t total = 0;
+  for (uint32_t k = 0; k <= 2001; ++k) {
+    auto gold = std::equal_range(keys.begin(), keys.end(), k);
+    auto r = v.equal_range(k);
+    EXPECT_EQ(static_cast<size_t>(gold.first - keys.begin()), r.first);
+    EXPECT_EQ(static_cast<size_t>(gold.second - keys.begin()), r.second);
+    EXPECT_EQ(static_cast<size_t>(gold.second - gold.first), v.count(k));
+    EXPECT_EQ(r.first, v.lower_bound(k));
+    EXPECT_EQ(r.second, v.upper_bound(k));
+    // starting from a smaller position gives the same result.
+    EXPECT_EQ(r, v.equal_range(k, r.first / 2));
+    total += v.count(k);
+  }
+  EXPECT_EQ(input.size(), total);
+}
+
+TEST(SoaSortedVectorTest, kmer_interpolation)
+{
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  using Less = ::fsc::TransformedComparator<KmerType, ::std::less, ::bliss::kmer::transform::lex_less>;
+
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  std::vector<KmerType> queries;
+  srand(3);
+  for (uint32_t i = 0; i < 20000; ++i) {
+    KmerType k;
+    for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(rand() % 4);
+    input.emplace_back(k, i);
+    if (i % 4 == 0) input.emplace_back(k, i + 1);  // repeated keys.
+    if (i % 3 == 0) queries.emplace_back(k);
+    k.nextFromChar(rand() % 4);
+    queries.emplace_back(k);
+  }
+
+  ::fsc::soa_sorted_vector<KmerType, uint32_t, Less> v(input.begin(), input.end());
+  Less lt;
+  std::vector<KmerType> keys(v.keys());
+  ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end(), lt));
+  for (auto const & q : queries) {
+    auto gold = std::equal_range(keys.begin(), keys.end(), q, lt);
+    auto r = v.equal_range(q);
+    EXPECT_EQ(static_cast<size_t>(gold.first - keys.begin()), r.first);
+    EXPECT_EQ(static_cast<size_t>(gold.second - keys.begin()), r.second);
+    for (size_t i = r.first; i < r.second; ++i) EXPECT_FALSE(lt(q, v.key(i)) || lt(v.key(i), q));
+  }
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/swiss_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+// include files to test
+#include "utils/transform_utils.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class SwissMapTest : public ::testing::Test
+{
+    static_assert(std::is_integral<T>::value, "only supporting integral types in tests right now.");
+  protected:
+
+
+    ::std::unordered_map<T, T> gold;
+    ::std::vector<std::pair<T, T>> temp;
+
+
+    size_t iters = 100000;
+    // no reserved keys:  use the entire key space
+    T min_val = 0;
+    T max_val = ::std::numeric_limits<T>::max();
+
+    virtual void SetUp()
+    { // generate some inputs
+
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(min_val, max_val);
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        gold.emplace(key, val);
+        temp.emplace_back(::std::move(key), ::std::move(val));
+      }
+
+      gold.emplace(min_val, 0);
+      gold.emplace(max_val, 0);
+      temp.emplace_back(min_val, 0);
+      temp.emplace_back(max_val, 0);
+    }
+
+    static bool less(::std::pair<T, T> const & x, ::std::pair<T, T> const &y) {
+      return (x.first == y.first) ? (x.second < y.second) : (x.first < y.first);
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(SwissMapTest);
+
+TYPED_TEST_P(SwissMapTest, insert)
+{
+  using MAP = ::fsc::swiss_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+  MAP test_batch;
+  test_batch.insert(this->temp);
+
+  EXPECT_EQ(this->gold.size(), test.size());
+  EXPECT_EQ(this->gold.size(), test_batch.size());
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > test_vals = test.to_vector();
+  ::std::vector<::std::pair<TypeParam, TypeParam> > batch_vals = test_batch.to_vector();
+  ::std::vector<::std::pair<TypeParam, TypeParam> > gold_vals(this->gold.begin(), this->gold.end());
+
+  ::std::sort(test_vals.begin(), test_vals.end(), &SwissMapTest<TypeParam>::less);
+  ::std::sort(batch_vals.begin(), batch_vals.end(), &SwissMapTest<TypeParam>::less);
+  ::std::sort(gold_vals.begin(), gold_vals.end(), &SwissMapTest<TypeParam>::less);
+
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+  EXPECT_TRUE(::std::equal(batch_vals.begin(), batch_vals.end(), gold_vals.begin()));
+}
+
+
+TYPED_TEST_P(SwissMapTest, find_count)
+{
+  using MAP = ::fsc::swiss_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  for (auto i : this->gold) {
+    EXPECT_EQ(1UL, test.count(i.first));
+    auto it = test.find(i.first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(i.second, it->second);
+
+    auto range = test.equal_range(i.first);
+    EXPECT_EQ(1, ::std::distance(range.first, range.second));
+  }
+
+  // batch find, with some absent keys if the key space is not filled.
+  ::std::vector<TypeParam> queries;
+  for (size_t i = 0; i < 1000; ++i) queries.emplace_back(static_cast<TypeParam>(i * 7919));
+  ::std::vector<typename MAP::value_type const *> results(queries.size());
+  ::std::vector<typename MAP::size_type> counts(queries.size());
+  test.find(queries.data(), queries.size(), results.data());
+  test.count(queries.data(), queries.size(), counts.data());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    auto g = this->gold.find(queries[i]);
+    EXPECT_EQ(this->gold.count(queries[i]), counts[i]);
+    if (g == this->gold.end()) {
+      EXPECT_TRUE(results[i] == nullptr);
+    } else {
+      ASSERT_TRUE(results[i] != nullptr);
+      EXPECT_EQ(g->second, results[i]->second);
+    }
+  }
+}
+
+
+TYPED_TEST_P(SwissMapTest, erase)
+{
+  using MAP = ::fsc::swiss_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  // erase the even keys, then reinsert some.
+  ::std::vector<TypeParam> evens;
+  for (auto i : this->gold) {
+    if ((i.first & 0x1) == 0) evens.emplace_back(i.first);
+  }
+  EXPECT_EQ(evens.size(), test.erase(evens.begin(), evens.end()));
+  EXPECT_EQ(this->gold.size() - evens.size(), test.size());
+
+  for (auto i : this->gold) {
+    EXPECT_EQ((i.first & 0x1), test.count(i.first));
+  }
+
+  for (size_t i = 0; i < evens.size(); i += 2) {
+    EXPECT_TRUE(test.insert(::std::make_pair(evens[i], evens[i])).second);
+  }
+  for (size_t i = 0; i < evens.size(); ++i) {
+    EXPECT_EQ(((i & 0x1) == 0) ? 1UL : 0UL, test.count(evens[i]));
+  }
+
+  // erase by predicate
+  test.erase([](::std::pair<const TypeParam, TypeParam> const & x){ return (x.first & 0x1) == 0; });
+  for (auto it = test.begin(); it != test.end(); ++it) {
+    EXPECT_EQ(1, it->first & 0x1);
+  }
+  EXPECT_EQ(this->gold.size() - evens.size(), test.size());
+
+  test.clear();
+  EXPECT_TRUE(test.empty());
+  EXPECT_TRUE(test.begin() == test.end());
+}
+
+
+TYPED_TEST_P(SwissMapTest, erase_if)
+{
+  using MAP = ::fsc::swiss_map<TypeParam, TypeParam>;
+
+  // few removed:  elements are shifted back.  most removed:  the table is rebuilt.
+  for (TypeParam mod : {static_cast<TypeParam>(16), static_cast<TypeParam>(1)}) {
+    MAP test(this->temp.begin(), this->temp.end());
+    size_t buckets = test.bucket_count();
+
+    size_t expected = 0;
+    for (auto i : this->gold) expected += ((i.first % 4) < mod) ? 0 : 1;
+    auto pred = [mod](::std::pair<const TypeParam, TypeParam> const & x){ return (x.first % 4) >= mod; };
+
+    EXPECT_EQ(expected, test.erase(pred));
+    EXPECT_EQ(this->gold.size() - expected, test.size());
+    EXPECT_EQ(buckets, test.bucket_count());
+    for (auto i : this->gold) {
+      EXPECT_EQ(((i.first % 4) < mod) ? 1UL : 0UL, test.count(i.first));
+    }
+  }
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(SwissMapTest, insert, find_count, erase, erase_if);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint8_t, uint16_t,
+    uint32_t, uint64_t> SwissMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, SwissMapTest, SwissMapTestTypes);
+
+
+/// 4 hash values, so the probe sequences of the keys overlap over many groups.
+template <typename T>
+struct ClusterHash {
+    size_t operator()(T const & x) const { return x & 0x3; }
+};
+
+/// backward shift on long probe sequences.  erase and reinsert in rounds, checking all keys after each.
+TEST(SwissMapEraseTest, clustered)
+{
+  using MAP = ::fsc::swiss_map<uint32_t, uint32_t, void, ::bliss::transform::identity, ClusterHash<uint32_t> >;
+
+  MAP test;
+  ::std::vector<bool> present(2000, false);
+  for (uint32_t i = 0; i < 2000; ++i) {
+    test.insert(::std::make_pair(i, i));
+    present[i] = true;
+  }
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint32_t> distribution(0, 1999);
+  size_t buckets = test.bucket_count();
+  for (int round = 0; round < 20; ++round) {
+    ::std::vector<uint32_t> victims;
+    for (int j = 0; j < 100; ++j) victims.emplace_back(distribution(generator));
+    ::std::sort(victims.begin(), victims.end());
+    victims.erase(::std::unique(victims.begin(), victims.end()), victims.end());
+
+    size_t expected = 0;
+    for (auto v : victims) expected += present[v] ? 1 : 0;
+    EXPECT_EQ(expected, test.erase(victims.begin(), victims.end()));
+    for (auto v : victims) present[v] = false;
+
+    for (int j = 0; j < 50; ++j) {
+      uint32_t k = distribution(generator);
+      EXPECT_EQ(!present[k], test.insert(::std::make_pair(k, k)).second);
+      present[k] = true;
+    }
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < 2000; ++i) {
+      ASSERT_EQ(present[i] ? 1UL : 0UL, test.count(i)) << "round " << round << " key " << i;
+      n += present[i] ? 1 : 0;
+    }
+    EXPECT_EQ(n, test.size());
+  }
+  // erasing never grew the table.
+  EXPECT_EQ(buckets, test.bucket_count());
+}
+
+
+template <typename KMER>
+using FarmHash = ::bliss::kmer::hash::farm<KMER, false>;
+
+/// canonical kmers, with a storage transform.  all kmer values are valid keys.
+TEST(SwissMapKmerTest, canonical)
+{
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  using MAP = ::fsc::swiss_map<KmerType, uint32_t, void,
+      ::bliss::kmer::transform::lex_less,
+      ::fsc::TransformedHash<KmerType, FarmHash, ::bliss::kmer::transform::lex_less> >;
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  ::std::vector<::std::pair<KmerType, uint32_t> > input;
+  KmerType k;
+  for (size_t i = 0; i < 10000; ++i) {
+    k.getDataRef()[0] = distribution(generator);
+    k.getDataRef()[0] >>= 2;
+    input.emplace_back(k, 1);
+  }
+  // AAA...A, the reverse complement of TTT...T, which is inserted below.
+  k.getDataRef()[0] = 0;
+  input.emplace_back(k, 1);
+
+  MAP test;
+  test.insert(input);
+  EXPECT_EQ(input.size(), test.size());
+
+  k.getDataRef()[0] = ~(0ULL) >> 2;
+  EXPECT_FALSE(test.insert(::std::make_pair(k, 1U)).second);
+  EXPECT_EQ(input.size(), test.size());
+
+  // reverse complements are the same entries
+  ::std::vector<::std::pair<KmerType, uint32_t> > rc;
+  for (auto x : input) {
+    rc.emplace_back(x.first.reverse_complement(), 2);
+  }
+  EXPECT_EQ(rc.size(), test.update(rc, [](uint32_t & x, uint32_t const & y) { x += y; return 1; }));
+  for (auto x : input) {
+    auto it = test.find(x.first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(3U, it->second);
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/tracking_allocator.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>  // uint32_t
+
+struct test_vec_tag { static char const * name() { return "test_vec"; } };
+struct test_map_tag { static char const * name() { return "test_map"; } };
+
+
+TEST(TrackingAllocator, current_and_peak)
+{
+  ::fsc::alloc_counter & c = ::fsc::get_alloc_counter<test_vec_tag>();
+  c.reset_peak();
+  int64_t base = c.current.load();
+
+  {
+    std::vector<uint32_t, ::fsc::tracking_allocator<uint32_t, test_vec_tag> > v;
+    v.reserve(1000);
+    EXPECT_EQ(base + 4000, c.current.load());
+
+    // transient buffer
+    {
+      std::vector<uint32_t, ::fsc::tracking_allocator<uint32_t, test_vec_tag> > tmp(2000);
+      EXPECT_EQ(base + 12000, c.current.load());
+    }
+    EXPECT_EQ(base + 4000, c.current.load());
+  }
+  EXPECT_EQ(base, c.current.load());
+  EXPECT_EQ(base + 12000, c.peak.load());
+
+  c.reset_peak();
+  EXPECT_EQ(base, c.peak.load());
+}
+
+TEST(TrackingAllocator, rebind_same_tag)
+{
+  ::fsc::alloc_counter & c = ::fsc::get_alloc_counter<test_map_tag>();
+  ::fsc::alloc_counter & t = ::fsc::alloc_tracker::instance().total();
+  int64_t base = c.current.load();
+  int64_t tbase = t.current.load();
+
+  {
+    std::unordered_map<uint32_t, uint32_t, std::hash<uint32_t>, std::equal_to<uint32_t>,
+      ::fsc::tracking_allocator<std::pair<const uint32_t, uint32_t>, test_map_tag> > m;
+    for (uint32_t i = 0; i < 100; ++i) m[i] = i;
+
+    // nodes and buckets are both counted under the map tag.
+    EXPECT_LT(base + 100 * static_cast<int64_t>(sizeof(std::pair<const uint32_t, uint32_t>)), c.current.load());
+    EXPECT_EQ(c.current.load() - base, t.current.load() - tbase);
+  }
+  EXPECT_EQ(base, c.current.load());
+  EXPECT_EQ(tbase, t.current.load());
+
+  // registered by name
+  bool found = false;
+  for (auto x : ::fsc::alloc_tracker::instance().get_counters()) found |= (std::string(x->name) == "test_map");
+  EXPECT_TRUE(found);
+}
@@ -434,6 +434,27 @@ TYPED_TEST_P(UnorderedVecMapTest, count)
     }
 }
 
+TYPED_TEST_P(UnorderedVecMapTest, batch)
+{
+    // include keys beyond the input range, which are not present.
+    ::std::vector<TypeParam> queries;
+    for (int i = 0; i < 150; ++i) queries.emplace_back(i);
+
+    ::std::vector<size_t> counts(queries.size());
+    this->test.count(queries.data(), queries.size(), counts.data());
+
+    ::std::vector<typename ::fsc::unordered_vecmap<TypeParam, TypeParam>::value_only_const_range > ranges(queries.size());
+    this->test.equal_range_value_only(queries.data(), queries.size(), ranges.data());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+      EXPECT_EQ(this->gold.count(queries[i]), counts[i]);
+      EXPECT_EQ(this->gold.count(queries[i]), static_cast<size_t>(::std::distance(ranges[i].first, ranges[i].second)));
+      for (auto it = ranges[i].first; it != ranges[i].second; ++it) {
+        EXPECT_EQ(queries[i], it->first);
+      }
+    }
+}
+
 TYPED_TEST_P(UnorderedVecMapTest, iterator)
 {
   using valType = ::std::pair<TypeParam, TypeParam>;
@@ -563,7 +584,7 @@ TYPED_TEST_P(UnorderedVecMapTest, copy)
 
 
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(UnorderedVecMapTest, insert, equal_range, count, iterator, rand_iterator, copy);
+REGISTER_TYPED_TEST_CASE_P(UnorderedVecMapTest, insert, equal_range, count, batch, iterator, rand_iterator, copy);
 
 
 //////////////////// RUN the tests with different types.
@@ -572,3 +593,150 @@ typedef ::testing::Types<int8_t, int16_t, int32_t,
     int64_t, uint64_t> UnorderedVecMapTestTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, UnorderedVecMapTest, UnorderedVecMapTestTypes);
 
+
+
+
+
+/*
+ * test class for the pooled vecmap.  inserts are done in 2 halves, so the second half is merged into an existing pool.
+ */
+template<typename T>
+class UnorderedPooledVecMapTest : public ::testing::Test
+{
+  protected:
+    ::std::unordered_multimap<T, T> gold;
+    ::fsc::unordered_pooled_vecmap<T, T> test;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(0,99);
+
+      ::std::vector<::std::pair<T, T> > input;
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        input.emplace_back(key, val);
+        gold.emplace(key, val);
+      }
+
+      test.insert(input.begin(), input.begin() + iters / 2);
+      test.compact();
+      for (size_t i = iters / 2; i < iters; ++i) {
+        test.insert(input[i]);
+      }
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(UnorderedPooledVecMapTest);
+
+TYPED_TEST_P(UnorderedPooledVecMapTest, equal_range)
+{
+    for (int i = 0; i < 99; ++i) {
+      auto test_range = this->test.equal_range(i);
+      auto gold_range = this->gold.equal_range(i);
+
+      ::std::vector<TypeParam> test_vals;
+      ::std::vector<TypeParam> gold_vals;
+
+      for (auto it = test_range.first; it != test_range.second; ++it) {
+        EXPECT_EQ(i, it->first);
+        test_vals.push_back(it->second);
+      }
+      for (auto it = gold_range.first; it != gold_range.second; ++it) {
+        gold_vals.push_back(it->second);
+      }
+
+      EXPECT_EQ(gold_vals.size(), test_vals.size());
+
+      ::std::sort(test_vals.begin(), test_vals.end());
+      ::std::sort(gold_vals.begin(), gold_vals.end());
+
+      EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+    }
+}
+
+TYPED_TEST_P(UnorderedPooledVecMapTest, count)
+{
+    for (int i = 0; i < 150; ++i) {
+      EXPECT_EQ(this->gold.count(i), this->test.count(i));
+    }
+    EXPECT_EQ(this->iters, this->test.size());
+
+    ::std::vector<TypeParam> queries;
+    for (int i = 0; i < 150; ++i) queries.emplace_back(i);
+
+    ::std::vector<size_t> counts(queries.size());
+    this->test.count(queries.data(), queries.size(), counts.data());
+
+    ::std::vector<typename ::fsc::unordered_pooled_vecmap<TypeParam, TypeParam>::value_only_const_range > ranges(queries.size());
+    this->test.equal_range_value_only(queries.data(), queries.size(), ranges.data());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+      EXPECT_EQ(this->gold.count(queries[i]), counts[i]);
+      EXPECT_EQ(this->gold.count(queries[i]), static_cast<size_t>(::std::distance(ranges[i].first, ranges[i].second)));
+    }
+}
+
+TYPED_TEST_P(UnorderedPooledVecMapTest, iterator)
+{
+  using valType = ::std::pair<TypeParam, TypeParam>;
+
+  ::std::vector<valType> test_vals(this->test.begin(), this->test.end());
+  ::std::vector<valType> gold_vals(this->gold.begin(), this->gold.end());
+
+  EXPECT_EQ(this->iters, test_vals.size());
+
+  // entries of a key are contiguous
+  EXPECT_EQ(this->test.unique_size(), static_cast<size_t>(::std::distance(test_vals.begin(),
+        ::std::unique(test_vals.begin(), test_vals.end(), [](valType const & x, valType const & y){ return x.first == y.first; }))));
+
+  test_vals.assign(this->test.begin(), this->test.end());
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+}
+
+TYPED_TEST_P(UnorderedPooledVecMapTest, erase)
+{
+  // erase odd keys, and the odd values of even keys.
+  size_t erased = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (i & 0x1) {
+      erased += this->test.erase(i);
+    } else {
+      erased += this->test.erase(i, [](::std::pair<TypeParam, TypeParam> const & x){ return (x.second & 0x1) != 0; });
+    }
+  }
+
+  for (auto it = this->gold.begin(); it != this->gold.end(); ) {
+    if ((it->first & 0x1) || (it->second & 0x1)) it = this->gold.erase(it);
+    else ++it;
+  }
+
+  EXPECT_EQ(this->iters - this->gold.size(), erased);
+  EXPECT_EQ(this->gold.size(), this->test.size());
+  EXPECT_EQ(this->gold.size(), static_cast<size_t>(::std::distance(this->test.begin(), this->test.end())));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(this->gold.count(i), this->test.count(i));
+  }
+
+  this->test.clear();
+  EXPECT_TRUE(this->test.empty());
+  EXPECT_TRUE(this->test.begin() == this->test.end());
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(UnorderedPooledVecMapTest, equal_range, count, iterator, erase);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<int8_t, int16_t, int32_t,
+    int64_t, uint64_t> UnorderedPooledVecMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, UnorderedPooledVecMapTest, UnorderedPooledVecMapTestTypes);
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/xor_filter.hpp"
+
+#include <unordered_set>
+#include <random>
+#include <cstdint>  // uint32_t
+#include <vector>
+
+
+struct identity_hash {
+    inline uint64_t operator()(uint64_t const & x) const { return x; }
+};
+
+
+TEST(XorFilterTest, no_false_negatives)
+{
+  for (size_t n : {0UL, 1UL, 2UL, 100UL, 100000UL}) {
+    std::default_random_engine generator(n);
+    std::uniform_int_distribution<uint64_t> distribution;
+
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < n; ++i) keys.emplace_back(distribution(generator));
+    // duplicates are allowed.
+    if (n > 0) keys.emplace_back(keys.front());
+
+    ::fsc::xor_filter<uint64_t, identity_hash> f(keys.begin(), keys.end());
+    EXPECT_EQ(n == 0, f.empty());
+    for (auto const & k : keys) EXPECT_TRUE(f.contains(k));
+
+    if (n >= 100000) {
+      // about 1.23 bytes per key.
+      EXPECT_LT(static_cast<double>(f.bytes()) / static_cast<double>(n), 1.25);
+    }
+  }
+}
+
+
+TEST(XorFilterTest, false_positive_rate)
+{
+  size_t n = 100000;
+  std::default_random_engine generator(5);
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  std::unordered_set<uint64_t> keys;
+  while (keys.size() < n) keys.emplace(distribution(generator));
+
+  ::fsc::xor_filter<uint64_t, identity_hash, uint8_t> f8(keys.begin(), keys.end());
+  ::fsc::xor_filter<uint64_t, identity_hash, uint16_t> f16(keys.begin(), keys.end());
+
+  size_t fp8 = 0, fp16 = 0, queries = 0;
+  while (queries < n) {
+    uint64_t k = distribution(generator);
+    if (keys.count(k) > 0) continue;
+    ++queries;
+    fp8 += f8.contains(k);
+    fp16 += f16.contains(k);
+  }
+  // expected 390 and 1.5.
+  EXPECT_LT(fp8, 2 * n / 256);
+  EXPECT_GT(fp8, n / 512);
+  EXPECT_LT(fp16, 20UL);
+
+  // restored from its parts.
+  std::vector<uint8_t> fps(f8.get_fingerprints());
+  ::fsc::xor_filter<uint64_t, identity_hash, uint8_t> copy(f8.get_seed(), std::move(fps));
+  for (auto const & k : keys) EXPECT_TRUE(copy.contains(k));
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    tracking_allocator.hpp
+ * @ingroup fsc::containers
+ * @brief   allocator that counts current and peak bytes per tag.
+ * @details tracking_allocator<T, Tag> allocates with std::allocator and adds the bytes to the counter of Tag and to
+ *          the process total.  peaks are updated at each allocation, so transient buffers between MemUsage marks are
+ *          captured.  the counters are atomic; the cost is 2 atomic adds per allocation.
+ *
+ *          a tag is a type with a static name(), e.g.
+ *            struct kmer_index_tag { static char const * name() { return "kmer_index"; } };
+ *          and the allocator is passed as the Alloc parameter of the local and distributed maps, accounting the map
+ *          and its rebound node/bucket types under the same tag.
+ *
+ *          fsc::allocator (used by unordered_vecmap) is tracking_allocator with the default tag when
+ *          BL_TRACK_ALLOC == 1 (cmake ENABLE_ALLOC_TRACKING), and std::allocator otherwise.
+ */
+#ifndef SRC_CONTAINERS_TRACKING_ALLOCATOR_HPP_
+#define SRC_CONTAINERS_TRACKING_ALLOCATOR_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <memory>   // allocator
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace fsc {  // fast standard container
+
+  /// current and peak bytes of 1 tag.
+  struct alloc_counter {
+      char const * name;
+      std::atomic<int64_t> current;
+      std::atomic<int64_t> peak;
+
+      explicit alloc_counter(char const * _name) : name(_name), current(0), peak(0) {}
+
+      inline void add(int64_t const & bytes) {
+        int64_t c = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        int64_t p = peak.load(std::memory_order_relaxed);
+        while ((c > p) && !peak.compare_exchange_weak(p, c, std::memory_order_relaxed)) {}
+      }
+      inline void sub(int64_t const & bytes) {
+        current.fetch_sub(bytes, std::memory_order_relaxed);
+      }
+      /// restart peak tracking from the current usage.
+      void reset_peak() {
+        peak.store(current.load());
+      }
+  };
+
+  /// registry of the tag counters, and the process total.
+  class alloc_tracker {
+    protected:
+      std::mutex mtx;
+      std::vector<alloc_counter *> counters;
+      alloc_counter all;
+
+      alloc_tracker() : all("total") {}
+
+    public:
+      static alloc_tracker & instance() {
+        static alloc_tracker tracker;
+        return tracker;
+      }
+
+      void add(alloc_counter * c) {
+        std::lock_guard<std::mutex> lock(mtx);
+        counters.push_back(c);
+      }
+
+      alloc_counter & total() { return all; }
+
+      /// the tag counters, in order of first allocation.
+      std::vector<alloc_counter *> get_counters() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return counters;
+      }
+
+      void reset_peaks() {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto c : counters) c->reset_peak();
+        all.reset_peak();
+      }
+  };
+
+  /// tag of allocations without an explicit tag.
+  struct default_alloc_tag {
+      static char const * name() { return "default"; }
+  };
+
+  /// the counter of a tag, registered on first use.
+  template <typename Tag>
+  inline alloc_counter & get_alloc_counter() {
+    static alloc_counter * c = []() {
+      alloc_counter * x = new alloc_counter(Tag::name());   // not freed, so deallocations at exit stay valid.
+      alloc_tracker::instance().add(x);
+      return x;
+    }();
+    return *c;
+  }
+
+
+  /**
+   * @brief std::allocator that counts bytes under Tag.
+   * @details derives from std::allocator so the pre-C++11 interface (pointer, construct, ...) needed by
+   *          google dense_hash_map is present.  stateless:  all instances compare equal.
+   */
+  template <typename T, typename Tag = default_alloc_tag>
+  class tracking_allocator : public std::allocator<T> {
+    public:
+      using base_type = std::allocator<T>;
+      using value_type = T;
+      using pointer = T*;
+      using size_type = size_t;
+
+      template <typename U>
+      struct rebind {
+          using other = tracking_allocator<U, Tag>;
+      };
+
+      tracking_allocator() noexcept : base_type() {}
+      tracking_allocator(tracking_allocator const & other) noexcept : base_type(other) {}
+      template <typename U>
+      tracking_allocator(tracking_allocator<U, Tag> const &) noexcept : base_type() {}
+
+      pointer allocate(size_type n, void const * = 0) {
+        pointer p = base_type::allocate(n);
+        int64_t bytes = static_cast<int64_t>(n * sizeof(T));
+        get_alloc_counter<Tag>().add(bytes);
+        alloc_tracker::instance().total().add(bytes);
+        return p;
+      }
+
+      void deallocate(pointer p, size_type n) {
+        int64_t bytes = static_cast<int64_t>(n * sizeof(T));
+        get_alloc_counter<Tag>().sub(bytes);
+        alloc_tracker::instance().total().sub(bytes);
+        base_type::deallocate(p, n);
+      }
+  };
+
+  template <typename T, typename U, typename Tag>
+  inline bool operator==(tracking_allocator<T, Tag> const &, tracking_allocator<U, Tag> const &) { return true; }
+  template <typename T, typename U, typename Tag>
+  inline bool operator!=(tracking_allocator<T, Tag> const &, tracking_allocator<U, Tag> const &) { return false; }
+
+
+#if defined(BL_TRACK_ALLOC) && (BL_TRACK_ALLOC == 1)
+  template <typename T>
+  using allocator = tracking_allocator<T>;
+#else
+  template <typename T>
+  using allocator = std::allocator<T>;
+#endif
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_TRACKING_ALLOCATOR_HPP_ */
@@ -35,12 +35,10 @@
 //#include "ext/pool_allocator.h"
 
 #include "utils/logging.h"
+#include "containers/tracking_allocator.hpp"   // fsc::allocator
 
 namespace fsc {  // fast standard container
 
-template <typename T>
-using allocator = std::allocator<T>;
-
   /**
    * @brief my version of unordered map.  because std::unordered_map does chaining for collision using a LINKED LIST.
    * @details std::unordered_map's use of linked list is fine for low collision.  for high collision, it's great for insertion but terrible for search or delete
@@ -1526,8 +1524,453 @@ using allocator = std::allocator<T>;
       }
       // NO bucket interfaces
 
+      /// number of queries prefetched at a time by the batch lookups.
+      static constexpr size_t batch_size = 32;
+
+      /**
+       * @brief prefetch the entry for a key, e.g. a few queries ahead of its lookup.
+       * @details  std::unordered_map does not expose its bucket array.  reading the bucket head is a load,
+       *           but the loads for different keys are independent, and the first node is then prefetched.
+       */
+      inline void prefetch(Key const & key) const {
+        size_t b = map.bucket(key);
+        auto it = map.cbegin(b);
+        if (it != map.cend(b)) __builtin_prefetch(&(*it));
+      }
+
+      /// batch count.  entries are prefetched a block of queries at a time.
+      void count(Key const * queries, size_t const n, size_type * results) const {
+        size_t m;
+        for (size_t i = 0; i < n; i += batch_size) {
+          m = ((n - i) < batch_size) ? (n - i) : batch_size;
+          for (size_t j = 0; j < m; ++j) prefetch(queries[i + j]);
+          for (size_t j = i; j < i + m; ++j) {
+            auto iter = map.find(queries[j]);
+            results[j] = (iter == map.end()) ? 0 : iter->second.size();
+          }
+        }
+      }
+
+      /// range of entries for a key in its vector, result type of the batch equal_range_value_only.
+      using value_only_const_range = ::std::pair<const_subiter_type, const_subiter_type>;
+
+      /// batch find.  results[i] is the range of entries for queries[i].
+      void equal_range_value_only(Key const * queries, size_t const n, value_only_const_range * results) const {
+        size_t m;
+        for (size_t i = 0; i < n; i += batch_size) {
+          m = ((n - i) < batch_size) ? (n - i) : batch_size;
+          for (size_t j = 0; j < m; ++j) prefetch(queries[i + j]);
+          for (size_t j = i; j < i + m; ++j) {
+            results[j] = equal_range_value_only(queries[j]);
+          }
+        }
+      }
+
+  };
+
+  template <typename Key, typename T, typename Hash, typename Comparator, typename Equal, typename Allocator>
+  constexpr size_t unordered_vecmap<Key, T, Hash, Comparator, Equal, Allocator>::batch_size;
+
+
+  /**
+   * @brief vecmap variant that keeps all entries in one pool instead of a vector per key.
+   * @details  unordered_vecmap allocates a std::vector for each unique key.  for a position index with millions of keys and a few
+   *          entries each, the build is dominated by small allocations, and the vectors are scattered across the heap.
+   *
+   *          here the map holds an (offset, length) range per key into a single pool vector.  inserts append to a staging vector.
+   *          before the next query or iteration, the staged entries are merged into the pool (compact()), by a counting sort on
+   *          the key: the ranges are laid out in map order, each key's existing entries are copied, then its staged entries are
+   *          scattered after them.  order of entries within a key is preserved.  erase leaves holes that the same pass removes.
+   *
+   *          iteration walks the pool sequentially, and each key's entries are contiguous.
+   *
+   *      memory usage:
+   *          pool stores std::pair<K, T>, so 16 or 24 bytes.  N elements.  the staging vector holds the entries inserted since the last compaction.
+   *          each link list node has ::std::pair<K, range> as payload and a next ptr - 32 to 40 bytes.  U unique elements
+   *          each "bucket" 16 bytes, HU hash unique elements.
+   *
+   *          total: (16N or 24N) + 40U + 16 HU, without the 24 byte vector header and the allocator overhead per key.
+   *          compacting temporarily needs a second pool.
+   *
+   *      queries merge the staged entries lazily, so the pool members are mutable.  as with the std containers, concurrent const calls
+   *      are not safe while there are staged entries or holes.  call compact() after the build to avoid that.
+   *      lookups and erase do not need the holes removed, so a series of erases compacts at most once, at the next iteration.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Comparator = ::std::less<Key>,
+  typename Equal = ::std::equal_to<Key>,
+  typename Allocator = ::fsc::allocator<::std::pair<Key, T> > >
+  class unordered_pooled_vecmap {
+
+    protected:
+      /// range of a key's entries in the pool.  added counts the staged entries during compaction.
+      struct range {
+        size_t offset;
+        size_t length;
+        size_t added;
+
+        range() : offset(0), length(0), added(0) {};
+      };
+
+      using pool_type = ::std::vector<::std::pair<Key, T>, Allocator >;
+      using superallocator_type = ::fsc::allocator<::std::pair<const Key, range > >;
+      using supercontainer_type =
+          ::std::unordered_map<Key, range, Hash, Equal, superallocator_type >;
+
+      using subiter_type = typename pool_type::iterator;
+      using const_subiter_type = typename pool_type::const_iterator;
+
+      mutable supercontainer_type map;
+      mutable pool_type pool;
+      mutable pool_type staged;
+      /// true if there are staged entries or holes in the pool.
+      mutable bool dirty;
+      size_t s;
+
+      /// ranges are valid if nothing is staged.  holes from erase do not affect lookups, only iteration.
+      inline void merge_staged() const {
+        if (!staged.empty()) compact();
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<Key, T>;
+      using hasher                = Hash;
+      using key_equal             = Equal;
+      using allocator_type        = Allocator;
+      using reference             = value_type&;
+      using const_reference       = const value_type&;
+      using pointer               = typename std::allocator_traits<Allocator>::pointer;
+      using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+      // keys in the pool must not be modified, so iteration is const only.
+      using iterator              = const_subiter_type;
+      using const_iterator        = const_subiter_type;
+      using size_type             = typename pool_type::size_type;
+      using difference_type       = typename pool_type::difference_type;
+
+
+      unordered_pooled_vecmap(size_type load_factor = 1,
+                   size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                           map(bucket_count, hash, equal, superallocator_type()),
+                           pool(alloc), staged(alloc), dirty(false),
+                           s(0UL) {};
+
+      template<class InputIt>
+      unordered_pooled_vecmap(InputIt first, InputIt last,
+                         size_type load_factor = 1,
+                         size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                         unordered_pooled_vecmap(load_factor, bucket_count, hash, equal, alloc) {
+          this->insert(first, last);
+      };
+
+      virtual ~unordered_pooled_vecmap() {};
+
+
+      /// merge the staged entries into the pool and remove holes.  ranges and iterators are invalidated if there is work to do.
+      void compact() const {
+        if (!dirty) return;
+
+        // count the staged entries per key.  new keys are added here.
+        for (auto const & x : staged) {
+          ++(map[x.first].added);
+        }
+
+        // lay out the ranges in map order, and copy the existing entries.
+        pool_type new_pool(s, pool.get_allocator());
+        size_t cursor = 0;
+        auto max = map.end();
+        for (auto it = map.begin(); it != max; ++it) {
+          range & r = it->second;
+          ::std::copy(pool.begin() + r.offset, pool.begin() + r.offset + r.length, new_pool.begin() + cursor);
+          r.offset = cursor;
+          cursor += r.length;
+          r.length += r.added;
+          r.added = cursor;   // where the next staged entry goes.
+          cursor = r.offset + r.length;
+        }
+
+        // scatter the staged entries.
+        for (auto const & x : staged) {
+          new_pool[map.find(x.first)->second.added++] = x;
+        }
+        for (auto it = map.begin(); it != max; ++it) {
+          it->second.added = 0;
+        }
+
+        pool.swap(new_pool);
+        pool_type(pool.get_allocator()).swap(staged);
+        dirty = false;
+      }
+
+
+      const_iterator begin() const {
+        return cbegin();
+      }
+      const_iterator cbegin() const {
+        compact();
+        return pool.cbegin();
+      }
+
+      const_iterator end() const {
+        return cend();
+      }
+      const_iterator cend() const {
+        compact();
+        return pool.cend();
+      }
+
+
+
+      bool empty() const {
+        return s == 0;
+      }
+
+      size_type size() const {
+        return s;
+      }
+
+      void reset() {
+        s = 0;
+        dirty = false;
+        decltype(map) tmp; tmp.swap(map);
+        pool_type().swap(pool);
+        pool_type().swap(staged);
+      }
+
+      void clear() {
+        s = 0;
+        dirty = false;
+        map.clear();
+        pool.clear();
+        staged.clear();
+      }
+
+      /// rehash for new count number of BUCKETS.  ranges remain valid.
+      void rehash(size_type count) {
+        // only rehash if new bucket count is greater than old bucket count
+        if (count > map.bucket_count())
+          map.rehash(count);
+      }
+
+      /// bucket count.  same as underlying buckets
+      size_type bucket_count() { return map.bucket_count(); }
+
+      /// max load factor.  this is the map's max load factor (ranges per bucket) x multiplicity = elements per bucket.
+      float max_load_factor() {
+        return (map.size() == 0) ? map.max_load_factor() : map.max_load_factor() * (static_cast<float>(s) / static_cast<float>(map.size()));
+      }
+
+
+      /// reserve for new count of elements.
+      void reserve(size_type count) {
+        // compute number of buckets required.
+        this->rehash(std::ceil(static_cast<float>(count) / this->max_load_factor()));
+        staged.reserve(count > s ? count - s : 0);
+      }
+
+      /// insert an entry.  does not return an iterator, since the entry is staged until the next compaction.
+      void insert(const value_type & value) {
+        staged.emplace_back(value);
+        ++s;
+        dirty = true;
+      }
+      void insert(value_type && value) {
+        staged.emplace_back(::std::forward<value_type>(value));
+        ++s;
+        dirty = true;
+      }
+      void emplace(value_type && value) {
+        insert(::std::forward<value_type>(value));
+      }
+      void emplace(Key&& key, T&& value) {
+        staged.emplace_back(::std::forward<Key>(key), ::std::forward<T>(value));
+        ++s;
+        dirty = true;
+      }
+
+      /// insert a range of entries.  appended to the staging vector, no per key allocation.
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        if (first == last) return;
+        size_t ss = std::distance(first, last);
+        staged.reserve(staged.size() + ss);
+        staged.insert(staged.end(), first, last);
+        s += ss;
+        dirty = true;
+      }
+
+      /// same as insert.  the compaction groups by key, so the input does not need to be sorted.
+      template <class InputIt>
+      void insert_sorted(InputIt first, InputIt last) {
+        this->insert(first, last);
+      }
+
+
+      template <typename Pred>
+      size_t erase(const key_type& key, Pred const & pred) {
+        merge_staged();
+        auto iter = map.find(key);
+        if (iter == map.end()) return 0;
+
+        range & r = iter->second;
+        auto start = pool.begin() + r.offset;
+        auto new_end = ::std::remove_if(start, start + r.length, pred);
+        size_t after = ::std::distance(start, new_end);
+        size_t c = r.length - after;
+
+        if (after == 0) map.erase(iter);   // need to remove entry because we rely on map.size()
+        else r.length = after;
+
+        s -= c;
+        if (c > 0) dirty = true;   // holes in the pool
+        return c;
+      }
+
+      size_t erase(const key_type& key) {
+        merge_staged();
+        auto iter = map.find(key);
+        if (iter == map.end()) return 0;
+
+        size_t c = iter->second.length;
+        s -= c;
+        map.erase(iter);
+        dirty = true;
+
+        return c;
+      }
+
+      size_type count(Key const & key) const {
+        merge_staged();
+        auto iter = map.find(key);
+        return (iter == map.end()) ? 0 : iter->second.length;
+      }
+
+      void shrink_to_fit() {
+        compact();
+        pool.shrink_to_fit();
+        staged.shrink_to_fit();
+      }
+
+
+      void report() {
+          BL_INFOF("pooled vecmap bucket count: %lu\n", map.bucket_count());
+          BL_INFOF("pooled vecmap load factor: %f\n", map.load_factor());
+          BL_INFOF("pooled vecmap unique entries: %lu\n", map.size());
+          BL_INFOF("pooled vecmap total size: %lu, pool capacity %lu, staged %lu\n", s, pool.capacity(), staged.size());
+      }
+
+
+      size_type unique_size() const {
+        merge_staged();
+        return map.size();
+      }
+
+
+      size_type get_max_multiplicity() const {
+        merge_staged();
+        size_type max_multiplicity = 0;
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+          max_multiplicity = ::std::max(max_multiplicity, it->second.length);
+        }
+        return max_multiplicity;
+      }
+
+      size_type get_min_multiplicity() const {
+        merge_staged();
+        size_type min_multiplicity = ::std::numeric_limits<size_type>::max();
+        auto max = map.cend();
+        for (auto it = map.cbegin(); it != max; ++it) {
+          if (it->second.length > 0)
+            min_multiplicity = ::std::min(min_multiplicity, it->second.length);
+        }
+        return min_multiplicity;
+      }
+
+      double get_mean_multiplicity() const {
+        merge_staged();
+        return static_cast<double>(s) / double(map.size());
+      }
+      double get_stdev_multiplicity() const {
+        merge_staged();
+        double stdev_multiplicity = 0;
+        auto max = map.cend();
+        for (auto it = map.cbegin(); it != max; ++it) {
+          stdev_multiplicity += (it->second.length * it->second.length);
+        }
+        return stdev_multiplicity / double(map.size()) - get_mean_multiplicity();
+      }
+
+
+      /// range of entries for a key in the pool.  valid until the next insert or erase.
+      ::std::pair<const_subiter_type, const_subiter_type> equal_range_value_only(Key const & key) const {
+        merge_staged();
+        auto iter = map.find(key);
+
+        if (iter == map.end()) return ::std::make_pair(pool.cend(), pool.cend());
+
+        return ::std::make_pair(pool.cbegin() + iter->second.offset,
+                                pool.cbegin() + iter->second.offset + iter->second.length);
+      }
+
+      /// pool iterators are sequential, so this is the same as equal_range_value_only.
+      ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+        return equal_range_value_only(key);
+      }
+      // NO bucket interfaces
+
+      /// number of queries prefetched at a time by the batch lookups.
+      static constexpr size_t batch_size = 32;
+
+      /// prefetch the entry for a key.  see unordered_vecmap::prefetch.  compact() first.
+      inline void prefetch(Key const & key) const {
+        size_t b = map.bucket(key);
+        auto it = map.cbegin(b);
+        if (it != map.cend(b)) __builtin_prefetch(&(*it));
+      }
+
+      /// batch count.  entries are prefetched a block of queries at a time.
+      void count(Key const * queries, size_t const n, size_type * results) const {
+        merge_staged();
+        size_t m;
+        for (size_t i = 0; i < n; i += batch_size) {
+          m = ((n - i) < batch_size) ? (n - i) : batch_size;
+          for (size_t j = 0; j < m; ++j) prefetch(queries[i + j]);
+          for (size_t j = i; j < i + m; ++j) {
+            auto iter = map.find(queries[j]);
+            results[j] = (iter == map.end()) ? 0 : iter->second.length;
+          }
+        }
+      }
+
+      /// range of entries for a key in the pool, result type of the batch equal_range_value_only.
+      using value_only_const_range = ::std::pair<const_subiter_type, const_subiter_type>;
+
+      /// batch find.  results[i] is the range of entries for queries[i].
+      void equal_range_value_only(Key const * queries, size_t const n, value_only_const_range * results) const {
+        merge_staged();
+        size_t m;
+        for (size_t i = 0; i < n; i += batch_size) {
+          m = ((n - i) < batch_size) ? (n - i) : batch_size;
+          for (size_t j = 0; j < m; ++j) prefetch(queries[i + j]);
+          for (size_t j = i; j < i + m; ++j) {
+            results[j] = equal_range_value_only(queries[j]);
+          }
+        }
+      }
+
   };
 
+  template <typename Key, typename T, typename Hash, typename Comparator, typename Equal, typename Allocator>
+  constexpr size_t unordered_pooled_vecmap<Key, T, Hash, Comparator, Equal, Allocator>::batch_size;
 
 
 } // end namespace fsc.
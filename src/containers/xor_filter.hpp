@@ -0,0 +1,204 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    xor_filter.hpp
+ * @ingroup fsc::containers
+ * @brief   static membership filter over a fixed key set (xor filter, Graf and Lemire 2020).
+ * @details each key maps to 3 slots, 1 in each third of a fingerprint array of about 1.23 n entries.  the slots are assigned
+ *          so that the xor of a key's 3 slots is the key's fingerprint.  a query computes the 3 slots and compares, so
+ *          it touches at most 3 cache lines and has no branches on the data.
+ *
+ *          with 8 bit fingerprints, about 9.9 bits per key for a false positive rate of 2^-8, vs about 11.5 bits per key
+ *          for a bloom filter with the same rate.  keys in the set are always reported.  the filter cannot be modified.
+ *
+ *          construction peels the 3-hypergraph of the keys, and retries with a new seed if it fails, which is rare.
+ *          keys with the same 64 bit hash are treated as 1 key.
+ */
+#ifndef XOR_FILTER_HPP_
+#define XOR_FILTER_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief xor filter over keys.
+   * @tparam Hash         hash functor on Key, returning a 64 bit value.  mixed with the seed before use.
+   * @tparam Fingerprint  unsigned integer type.  false positive rate is 2^-(bits of Fingerprint).
+   */
+  template <typename Key, typename Hash, typename Fingerprint = uint8_t>
+  class xor_filter {
+      static_assert(::std::is_unsigned<Fingerprint>::value, "fingerprint type has to be unsigned");
+
+    public:
+      using fingerprint_type = Fingerprint;
+
+      /// construction attempts before giving up.
+      static constexpr size_t max_attempts = 100;
+
+    protected:
+      Hash hash;
+      uint64_t seed;
+      /// a third of the fingerprint array.
+      uint32_t block_length;
+      ::std::vector<Fingerprint> fingerprints;
+
+      /// murmur3 64 bit finalizer.
+      static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+      }
+      static inline uint64_t rotl(uint64_t const & x, int const & r) {
+        return (x << r) | (x >> (64 - r));
+      }
+      /// map 32 bits to [0, n) without division.
+      static inline uint32_t reduce(uint32_t const & x, uint32_t const & n) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(x) * static_cast<uint64_t>(n)) >> 32);
+      }
+
+      inline uint64_t seeded(uint64_t const & h) const {
+        return mix(h + seed);
+      }
+      static inline Fingerprint fingerprint(uint64_t const & h) {
+        return static_cast<Fingerprint>(h ^ (h >> 32));
+      }
+      inline uint32_t slot(uint64_t const & h, int const & i) const {
+        return reduce(static_cast<uint32_t>(rotl(h, i * 21)), block_length) + i * block_length;
+      }
+
+      /// build from unique hash values.  returns false if peeling failed for the current seed.
+      bool build(::std::vector<uint64_t> const & hashes) {
+        size_t capacity = fingerprints.size();
+        ::std::vector<uint64_t> xormask(capacity, 0);
+        ::std::vector<uint32_t> counts(capacity, 0);
+
+        for (auto const & x : hashes) {
+          uint64_t h = seeded(x);
+          for (int i = 0; i < 3; ++i) {
+            uint32_t s = slot(h, i);
+            xormask[s] ^= h;
+            ++counts[s];
+          }
+        }
+
+        // peel the slots with 1 key, in order.  stack of (seeded hash, slot).
+        ::std::vector<uint32_t> queue;
+        for (uint32_t s = 0; s < capacity; ++s) {
+          if (counts[s] == 1) queue.emplace_back(s);
+        }
+        ::std::vector<::std::pair<uint64_t, uint32_t> > stack;
+        stack.reserve(hashes.size());
+        while (!queue.empty()) {
+          uint32_t s = queue.back();
+          queue.pop_back();
+          if (counts[s] != 1) continue;
+          uint64_t h = xormask[s];
+          stack.emplace_back(h, s);
+          for (int i = 0; i < 3; ++i) {
+            uint32_t t = slot(h, i);
+            xormask[t] ^= h;
+            if (--counts[t] == 1) queue.emplace_back(t);
+          }
+        }
+        if (stack.size() != hashes.size()) return false;
+
+        // assign in reverse peeling order, so each key's slot is free when it is set.
+        ::std::fill(fingerprints.begin(), fingerprints.end(), 0);
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+          uint64_t h = it->first;
+          fingerprints[it->second] = fingerprint(h) ^ fingerprints[slot(h, 0)] ^
+              fingerprints[slot(h, 1)] ^ fingerprints[slot(h, 2)];
+        }
+        return true;
+      }
+
+    public:
+      xor_filter() : seed(0), block_length(0) {}
+
+      /// build from the keys in [first, last).  duplicates allowed.
+      template <typename Iter>
+      xor_filter(Iter first, Iter last) : seed(0), block_length(0) {
+        ::std::vector<uint64_t> hashes;
+        for (; first != last; ++first) hashes.emplace_back(hash(*first));
+        ::std::sort(hashes.begin(), hashes.end());
+        hashes.erase(::std::unique(hashes.begin(), hashes.end()), hashes.end());
+        if (hashes.empty()) return;
+
+        size_t capacity = 32 + (hashes.size() * 123 + 99) / 100;
+        capacity = ((capacity + 2) / 3) * 3;
+        if (capacity >= (1ULL << 32))
+          throw ::std::length_error("xor_filter: too many keys for 32 bit slot indices.");
+        block_length = static_cast<uint32_t>(capacity / 3);
+        fingerprints.resize(capacity);
+
+        for (size_t a = 0; a < max_attempts; ++a) {
+          seed = mix(a + 0x9e3779b97f4a7c15ULL);
+          if (build(hashes)) return;
+        }
+        throw ::std::runtime_error("xor_filter: construction failed.");
+      }
+
+      /// restore a filter from its parts, e.g. received from another process.  see get_seed, get_fingerprints.
+      xor_filter(uint64_t const & _seed, ::std::vector<Fingerprint> && _fingerprints) :
+        seed(_seed), block_length(static_cast<uint32_t>(_fingerprints.size() / 3)), fingerprints(::std::move(_fingerprints)) {}
+
+      void swap(xor_filter & other) {
+        ::std::swap(hash, other.hash);
+        ::std::swap(seed, other.seed);
+        ::std::swap(block_length, other.block_length);
+        fingerprints.swap(other.fingerprints);
+      }
+
+      /// true if the filter has no keys.
+      bool empty() const {
+        return block_length == 0;
+      }
+
+      /// true if the key is (probably) in the filter.  always true for the keys it was built from.
+      bool contains(Key const & key) const {
+        if (block_length == 0) return false;
+        uint64_t h = seeded(hash(key));
+        return fingerprint(h) == (fingerprints[slot(h, 0)] ^ fingerprints[slot(h, 1)] ^ fingerprints[slot(h, 2)]);
+      }
+
+      uint64_t get_seed() const {
+        return seed;
+      }
+      ::std::vector<Fingerprint> const & get_fingerprints() const {
+        return fingerprints;
+      }
+
+      /// size in bytes.
+      size_t bytes() const {
+        return fingerprints.size() * sizeof(Fingerprint);
+      }
+  };
+
+  template <typename Key, typename Hash, typename Fingerprint>
+  constexpr size_t xor_filter<Key, Hash, Fingerprint>::max_attempts;
+
+} // namespace fsc
+
+#endif /* XOR_FILTER_HPP_ */
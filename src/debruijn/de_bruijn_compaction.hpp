@@ -0,0 +1,454 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_compaction.hpp
+ * @ingroup bliss::de_bruijn
+ * @brief   compaction of the distributed de bruijn graph into unitigs (maximal non-branching paths).
+ * @details the nodes are the canonical kmers of a de_bruijn_nodes_distributed map, each with an L side (in edges of the
+ *          canonical kmer) and an R side (out edges).  an edge joins 2 nodes in a unitig if the side it leaves from has
+ *          exactly 1 edge, and the side it enters has exactly 1 edge as well.  following these links from a node alternates
+ *          sides as in a bidirected graph, so a link records the side of the neighbor it enters.
+ *
+ *          1. links:  the candidate neighbor of each side with 1 edge is looked up in a batch with the node map's find, and
+ *             the link is kept if the neighbor's side has 1 edge pointing back.
+ *          2. list ranking by pointer jumping:  each (node, side) jumps to the node its target jumps to, accumulating the distance
+ *             and the smallest node on the way, until it reaches the end of the path.  each round is 1 scatter_compute_gather,
+ *             and the distance covered doubles per round, so paths finish in ceil(log2(n)) rounds.  entries still not done after
+ *             that are on cycles.  these are cut at their smallest node, and the ranking repeated.
+ *          3. each node's unitig is identified by the smaller of its 2 end nodes (the head), and its position is the distance from
+ *             the head.  the nodes are sent to the head's rank, sorted by position, and the sequence assembled.
+ *
+ *          the unitigs are on the rank that owns the head node.  circular unitigs are cut at their smallest node, and their
+ *          sequence is the path from that node around the cycle, so the first and last k-1 characters are the same.
+ *
+ *          requires DNA kmers (the edge index is the character value), and the node map's input transform must be identity
+ *          (see de_bruijn_nodes_distributed).  palindromic kmers (even k) do not link.
+ */
+#ifndef DE_BRUIJN_COMPACTION_HPP_
+#define DE_BRUIJN_COMPACTION_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>      // pair
+#include <algorithm>    // sort, min
+#include <cmath>        // log2, ceil
+#include <type_traits>
+
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/mxx_support.hpp"
+#include "utils/kmer_utils.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+
+    /// a compacted non-branching path.  head is the canonical kmer of the first node, and identifies the unitig.
+    template <typename Kmer>
+    struct unitig {
+        Kmer head;
+        size_t kmers;
+        bool circular;
+        std::string seq;
+    };
+
+    /// location of a node in its unitig.  strand is node::SENSE if the canonical kmer reads in the unitig's direction.
+    template <typename Kmer>
+    struct unitig_position {
+        Kmer node;
+        Kmer head;
+        size_t pos;
+        unsigned char strand;
+    };
+
+
+    /**
+     * @brief compacts the nodes of a de_bruijn_nodes_distributed map into unitigs.  collective.
+     * @tparam NodeMap   de_bruijn_nodes_distributed, with edge_exists or edge_counts nodes.
+     */
+    template <typename NodeMap>
+    class unitig_compactor {
+      public:
+        using Kmer = typename NodeMap::key_type;
+        using EdgeType = typename NodeMap::mapped_type;
+
+        static_assert(::std::is_same<typename Kmer::KmerAlphabet, ::bliss::common::DNA>::value,
+                      "unitig compaction requires DNA kmers, as edges are indexed by the character value");
+
+      protected:
+        static constexpr uint8_t L = 0;
+        static constexpr uint8_t R = 1;
+        /// flag in the side byte of a jump:  reached the end of the path.
+        static constexpr uint8_t DONE = 2;
+
+        /// (node, side)
+        using query_type = ::std::pair<Kmer, uint8_t>;
+        /// jump pointer:  ((target node, smallest node passed), (distance, side to continue from at target | DONE))
+        using jump_type = ::std::pair<::std::pair<Kmer, Kmer>, ::std::pair<uint64_t, uint8_t> >;
+        /// node sent to its unitig's head:  ((head, position), (kmer in unitig orientation, circular))
+        using record_type = ::std::pair<::std::pair<Kmer, uint64_t>, ::std::pair<Kmer, uint8_t> >;
+
+        struct link_type {
+            Kmer node;      // canonical neighbor
+            uint8_t side;   // side of the neighbor the link enters
+            bool valid;
+        };
+
+        struct node_state {
+            link_type link[2];
+            jump_type jump[2];
+            bool circular;
+        };
+
+        using Hash = ::bliss::kmer::hash::farm<Kmer, false>;
+
+        NodeMap & nodes;
+        const mxx::comm & comm;
+        ::bliss::kmer::transform::lex_less<Kmer> canonical;
+
+        /// per canonical node owned by this rank.
+        ::std::unordered_map<Kmer, node_state, Hash> states;
+
+        ::std::vector<unitig<Kmer> > unitigs;
+        ::std::vector<unitig_position<Kmer> > positions;
+        size_t rounds;
+
+        /// letters of the edges on side of the canonical kmer, as a mask with A C G T from low to high bit.
+        /// flip is true if the stored kmer (and its edges) is the reverse complement of the canonical one.
+        static uint8_t side_letters(EdgeType const & edges, bool flip, uint8_t side) {
+          // R side of the canonical kmer is the stored out edges, or the complemented stored in edges if flipped.
+          uint8_t offset = ((side == R) != flip) ? 0 : 4;
+          uint8_t mask = 0;
+          for (uint8_t i = 0; i < 4; ++i) {
+            if (edges.get_edge_frequency(offset + i) > 0) mask |= flip ? (1 << (3 - i)) : (1 << i);
+          }
+          return mask;
+        }
+
+        /// the letter if mask has exactly 1 bit, else 4.
+        static uint8_t single_letter(uint8_t mask) {
+          switch (mask) {
+            case 1: return 0;
+            case 2: return 1;
+            case 4: return 2;
+            case 8: return 3;
+            default: return 4;
+          }
+        }
+
+        /// neighbor of kmer across side, via letter.  not canonical.
+        static Kmer neighbor(Kmer const & kmer, uint8_t side, uint8_t letter) {
+          Kmer result(kmer);
+          if (side == R) result.nextFromChar(letter);
+          else result.nextReverseFromChar(letter);
+          return result;
+        }
+
+        /// side of the neighbor (not canonical) that a link from side enters, in the neighbor's canonical orientation.
+        static uint8_t entry_side(Kmer const & next, Kmer const & canonical_next, uint8_t side) {
+          bool same = (next == canonical_next);
+          return (side == R) ? (same ? L : R) : (same ? R : L);
+        }
+
+        bool palindrome(Kmer const & kmer) const {
+          return kmer == kmer.reverse_complement();
+        }
+
+        /// find the links of all local nodes.
+        void build_links() {
+          auto & local = nodes.get_local_container();
+
+          states.clear();
+          states.reserve(local.size());
+
+          // tentative links hold the (non canonical) neighbor until it is checked.
+          ::std::vector<Kmer> query;
+          query.reserve(local.size() * 2);
+          for (auto it = local.begin(); it != local.end(); ++it) {
+            Kmer c = canonical(it->first);
+            bool flip = !(c == it->first);
+            node_state & st = states[c];
+            st.circular = false;
+            for (uint8_t side = L; side <= R; ++side) {
+              uint8_t letter = single_letter(side_letters(it->second, flip, side));
+              st.link[side].valid = (letter < 4) && !palindrome(c);
+              if (st.link[side].valid) {
+                st.link[side].node = neighbor(c, side, letter);
+                query.emplace_back(st.link[side].node);
+              }
+            }
+          }
+
+          // batched neighbor lookup.  the result holds the stored orientation of each neighbor.
+          ::std::sort(query.begin(), query.end());
+          query.erase(::std::unique(query.begin(), query.end()), query.end());
+          auto found = nodes.find(query);
+
+          ::std::unordered_map<Kmer, ::std::pair<bool, EdgeType>, Hash> neighbors;
+          neighbors.reserve(found.size());
+          for (auto const & f : found) {
+            Kmer c = canonical(f.first);
+            neighbors[c] = ::std::make_pair(!(c == f.first), f.second);
+          }
+
+          // keep the links whose far side has 1 edge, pointing back.
+          for (auto & kv : states) {
+            for (uint8_t side = L; side <= R; ++side) {
+              link_type & l = kv.second.link[side];
+              if (!l.valid) continue;
+
+              Kmer next = canonical(l.node);
+              uint8_t entry = entry_side(l.node, next, side);
+              auto nit = neighbors.find(next);
+              l.valid = (nit != neighbors.end()) && !(next == kv.first) && !palindrome(next);
+              if (l.valid) {
+                uint8_t letter = single_letter(side_letters(nit->second.second, nit->second.first, entry));
+                l.valid = (letter < 4) && (canonical(neighbor(next, entry, letter)) == kv.first);
+              }
+              l.node = next;
+              l.side = entry;
+            }
+          }
+        }
+
+        /// set each side's jump pointer to its link, or to itself (done) if there is none.
+        void init_jumps() {
+          for (auto & kv : states) {
+            for (uint8_t side = L; side <= R; ++side) {
+              link_type const & l = kv.second.link[side];
+              if (l.valid)
+                kv.second.jump[side] = jump_type(::std::make_pair(l.node, l.node), ::std::make_pair(1UL, static_cast<uint8_t>(1 - l.side)));
+              else
+                kv.second.jump[side] = jump_type(::std::make_pair(kv.first, kv.first), ::std::make_pair(0UL, static_cast<uint8_t>(side | DONE)));
+            }
+          }
+        }
+
+        /**
+         * @brief pointer jumping, at most max_rounds rounds.
+         * @return  true if all jumps reached the end of their path.
+         */
+        bool pointer_jump(size_t const & max_rounds) {
+          ::std::vector<query_type> query;
+          ::std::vector<jump_type *> source;
+          ::std::vector<jump_type> answers;
+          ::std::vector<size_t> i2o;
+          ::std::vector<query_type> in_buffer;
+          ::std::vector<jump_type> out_buffer;
+          // the rounds reuse the buffers, so the count exchange and repeated patterns use persistent collectives.
+          ::imxx::persistent_exchange pex(comm);
+
+          auto to_rank = [this](query_type const & q) { return nodes.get_rank(q.first); };
+          // answers are the jumps of the previous round.  all lookups complete before any update.
+          auto lookup = [this](typename ::std::vector<query_type>::iterator first,
+                               typename ::std::vector<query_type>::iterator last,
+                               typename ::std::vector<jump_type>::iterator out) {
+            for (; first != last; ++first, ++out) {
+              auto it = states.find(first->first);
+              if (it == states.end())  // not a node.  cannot happen with symmetric links, but terminate the path if it does.
+                *out = jump_type(::std::make_pair(first->first, first->first), ::std::make_pair(0UL, static_cast<uint8_t>(first->second | DONE)));
+              else
+                *out = it->second.jump[first->second];
+            }
+          };
+
+          for (size_t r = 0; ; ++r) {
+            query.clear();
+            source.clear();
+            for (auto & kv : states) {
+              for (uint8_t side = L; side <= R; ++side) {
+                jump_type & j = kv.second.jump[side];
+                if ((j.second.second & DONE) == 0) {
+                  query.emplace_back(j.first.first, j.second.second);
+                  source.emplace_back(&j);
+                }
+              }
+            }
+
+            size_t pending = ::mxx::allreduce(query.size(), comm);
+            if (pending == 0) return true;
+            if (r == max_rounds) return false;
+
+            ::imxx::scatter_compute_gather(query, to_rank, lookup, i2o, answers, in_buffer, out_buffer, comm, true, &pex);
+            ++rounds;
+
+            for (size_t i = 0; i < source.size(); ++i) {
+              jump_type & j = *(source[i]);
+              jump_type const & a = answers[i];
+              j.first.first = a.first.first;
+              if (a.first.second < j.first.second) j.first.second = a.first.second;
+              j.second.first += a.second.first;
+              j.second.second = a.second.second;
+            }
+          }
+        }
+
+        /// mark the nodes still not done as circular, and cut each cycle after its smallest node.
+        void cut_cycles() {
+          ::std::vector<query_type> cuts;
+          for (auto & kv : states) {
+            node_state & st = kv.second;
+            if ((st.jump[R].second.second & DONE) != 0) continue;
+
+            st.circular = true;
+            // after enough rounds, the smallest node passed is the smallest on the cycle.
+            if ((st.jump[R].first.second == kv.first) && st.link[R].valid) {
+              cuts.emplace_back(st.link[R].node, st.link[R].side);
+              st.link[R].valid = false;
+            }
+          }
+
+          ::std::vector<size_t> recv_counts;
+          ::std::vector<size_t> i2o;
+          ::std::vector<query_type> received;
+          ::imxx::distribute(cuts, [this](query_type const & q) { return nodes.get_rank(q.first); },
+                             recv_counts, i2o, received, comm, false);
+          for (auto const & c : received) {
+            auto it = states.find(c.first);
+            if (it != states.end()) it->second.link[c.second].valid = false;
+          }
+        }
+
+        /// send the nodes to the heads of their unitigs, and assemble the sequences there.
+        void assemble() {
+          ::std::vector<record_type> records;
+          records.reserve(states.size());
+          positions.clear();
+          positions.reserve(states.size());
+
+          for (auto const & kv : states) {
+            node_state const & st = kv.second;
+            Kmer const & left = st.jump[L].first.first;
+            Kmer const & right = st.jump[R].first.first;
+            bool head_left = !(right < left);
+            Kmer const & head = head_left ? left : right;
+            uint64_t pos = head_left ? st.jump[L].second.first : st.jump[R].second.first;
+
+            records.emplace_back(::std::make_pair(head, pos),
+                                 ::std::make_pair(head_left ? kv.first : kv.first.reverse_complement(),
+                                                  static_cast<uint8_t>(st.circular ? 1 : 0)));
+            positions.emplace_back(unitig_position<Kmer>{kv.first, head, pos,
+              head_left ? ::bliss::de_bruijn::node::SENSE : ::bliss::de_bruijn::node::ANTI_SENSE});
+          }
+
+          ::std::vector<size_t> recv_counts;
+          ::std::vector<size_t> i2o;
+          ::std::vector<record_type> received;
+          ::imxx::distribute(records, [this](record_type const & x) { return nodes.get_rank(x.first.first); },
+                             recv_counts, i2o, received, comm, false);
+          records.clear();
+
+          ::std::sort(received.begin(), received.end(), [](record_type const & x, record_type const & y) {
+            return x.first < y.first;
+          });
+
+          unitigs.clear();
+          size_t bits_mask = (1 << Kmer::bitsPerChar) - 1;
+          for (size_t i = 0; i < received.size(); ) {
+            unitig<Kmer> u;
+            u.head = received[i].first.first;
+            u.seq = ::bliss::utils::KmerUtils::toASCIIString(received[i].second.first);
+            u.circular = false;
+
+            size_t j = i;
+            for (; (j < received.size()) && (received[j].first.first == u.head); ++j) {
+              if (j > i) u.seq.push_back(Kmer::KmerAlphabet::TO_ASCII[received[j].second.first.getData()[0] & bits_mask]);
+              u.circular |= (received[j].second.second != 0);
+            }
+            u.kmers = j - i;
+            unitigs.emplace_back(::std::move(u));
+            i = j;
+          }
+        }
+
+      public:
+        unitig_compactor(NodeMap & _nodes) : nodes(_nodes), comm(_nodes.get_comm()), rounds(0) {}
+
+        /// build the unitigs.  collective.
+        void compact() {
+          BL_BENCH_INIT(compact);
+
+          rounds = 0;
+
+          BL_BENCH_START(compact);
+          size_t n = nodes.size();
+          size_t max_rounds = static_cast<size_t>(::std::ceil(::std::log2(static_cast<double>(n + 1)))) + 1;
+          BL_BENCH_END(compact, "size", n);
+
+          BL_BENCH_COLLECTIVE_START(compact, "links", comm);
+          build_links();
+          BL_BENCH_END(compact, "links", states.size());
+
+          BL_BENCH_COLLECTIVE_START(compact, "jump", comm);
+          init_jumps();
+          bool done = pointer_jump(max_rounds);
+          BL_BENCH_END(compact, "jump", rounds);
+
+          if (!done) {
+            BL_BENCH_COLLECTIVE_START(compact, "cycles", comm);
+            cut_cycles();
+            init_jumps();
+            pointer_jump(max_rounds);
+            BL_BENCH_END(compact, "cycles", rounds);
+          }
+
+          BL_BENCH_COLLECTIVE_START(compact, "assemble", comm);
+          assemble();
+          BL_BENCH_END(compact, "assemble", unitigs.size());
+
+          states.clear();
+
+          BL_BENCH_REPORT_MPI_NAMED(compact, "debruijn:compact", comm);
+        }
+
+        /// unitigs whose head is owned by this rank.
+        ::std::vector<unitig<Kmer> > const & get_unitigs() const {
+          return unitigs;
+        }
+
+        /// unitig and position of each node owned by this rank.
+        ::std::vector<unitig_position<Kmer> > const & get_positions() const {
+          return positions;
+        }
+
+        /// number of pointer jumping rounds in the last compact().
+        size_t get_rounds() const {
+          return rounds;
+        }
+
+        /// total number of unitigs.  collective.
+        size_t size() const {
+          return ::mxx::allreduce(unitigs.size(), comm);
+        }
+    };
+
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_COMPACTION_HPP_ */
@@ -157,6 +157,100 @@ namespace bliss
 		 }
 	 };
 
+
+   /**
+    * @brief generate canonical de Bruijn graph nodes and edges from the reads in 1 pass.
+    * @details  de_bruijn_parser zips a kmer generation iterator with an edge_iterator, so each character is read
+    *           3 times (kmer, left edge, right edge), and the node map then reverse complements the edges of
+    *           kmers that arrive in the other orientation.  this parser slides a k+1 window once:  each character
+    *           is shifted into the forward kmer and, complemented, into the reverse complement kmer (as in
+    *           CanonicalKmerSlidingWindow), and is the out edge of the previous kmer.  the in edge comes from a
+    *           ring of the last k edge characters.  when the reverse complement is smaller, the edges are
+    *           reverse complemented as well, so the output is the same graph with canonical nodes.
+    *
+    *           output value type is the same as de_bruijn_parser with DNA16 edge encoding.
+    */
+   template <typename KmerType, typename EdgeEncoder = bliss::common::DNA16>
+   struct de_bruijn_canonical_parser {
+
+     static_assert(std::is_same<EdgeEncoder, bliss::common::DNA16>::value,
+                   "Currently only support DNA16 as edge encoder for canonical nodes, as ASCII edges have no complement for the read ends");
+
+      /// type of element generated by this parser.  since kmer itself is parameterized, this is not hard coded.  NOTE THAT THIS IS TYPE FOR THE OUTPUTIT.
+      using edge_type = uint8_t;
+      using value_type = std::pair<KmerType, edge_type>;
+      using kmer_type = KmerType;
+      static constexpr size_t window_size = kmer_type::size;
+
+      using Alphabet = typename KmerType::KmerAlphabet;
+
+      ::bliss::partition::range<size_t> valid_range;
+
+      de_bruijn_canonical_parser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
+
+     template <typename SeqType, typename OutputIt>
+     OutputIt operator()(SeqType & read, OutputIt output_iter) {
+       static_assert(std::is_same<value_type, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+                      "output type and output container value type are not the same");
+
+       if (read.seq_begin == read.seq_end) return output_iter;
+
+       // filter out EOL characters
+       using CharIter = bliss::index::kmer::NonEOLIter<typename SeqType::IteratorType>;
+
+       bliss::utils::file::NotEOL neol;
+       CharIter it(neol, read.seq_begin, read.seq_end);
+       CharIter end(neol, read.seq_end);
+
+       KmerType fwd;
+       KmerType rev;
+       // edge chars of the last k characters, indexed by position mod k.  the slot about to be overwritten
+       // holds the in edge of the next kmer.
+       edge_type ring[window_size];
+       edge_type in_edge = 0;
+       size_t pos = 0;
+       size_t slot = 0;
+
+       for (; it != end; ++it, ++pos) {
+         unsigned char c = *it;
+         edge_type e = EdgeEncoder::FROM_ASCII[c];
+
+         // the kmer ending at the previous character is complete.  c is its out edge.
+         if (pos >= window_size) {
+           *output_iter = make_node(fwd, rev, (in_edge << 4) | e);
+           ++output_iter;
+           in_edge = ring[slot];
+         }
+         ring[slot] = e;
+         slot = (slot + 1 == window_size) ? 0 : slot + 1;
+
+         unsigned char a = Alphabet::FROM_ASCII[c];
+         fwd.nextFromChar(a);
+         rev.nextReverseFromChar(Alphabet::to_complement(a));
+       }
+
+       // last kmer of the read has no out edge.
+       if (pos >= window_size) {
+         *output_iter = make_node(fwd, rev, in_edge << 4);
+         ++output_iter;
+       }
+
+       return output_iter;
+     }
+
+    protected:
+     /// choose the smaller strand, and reverse complement the edges if that is the reverse complement.
+     static inline value_type make_node(KmerType const & fwd, KmerType const & rev, edge_type const & edges) {
+       if (rev < fwd)
+         return value_type(rev, bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<EdgeEncoder>(edges));
+       else
+         return value_type(fwd, edges);
+     }
+   };
+
+   template <typename KmerType, typename EdgeEncoder>
+   constexpr size_t de_bruijn_canonical_parser<KmerType, EdgeEncoder>::window_size;
+
 	 /*generate de Brujin graph nodes and edges, which each node associated with base quality scores*/
     template <typename KmerType, typename QualType=double, typename EdgeEncoder = bliss::common::DNA16, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
 	 struct de_bruijn_quality_parser {
@@ -241,6 +335,10 @@ namespace bliss
 	template <template <typename> class MapType>
 	using de_bruijn_engine = ::bliss::index::kmer::Index<MapType<bliss::common::DNA16>, de_bruijn_parser<typename MapType<bliss::common::DNA16>::key_type, bliss::common::DNA16 > >;
 
+	/// de bruijn graph construction with canonical nodes, from the 1 pass de_bruijn_canonical_parser.
+	template <template <typename> class MapType>
+	using de_bruijn_canonical_engine = ::bliss::index::kmer::Index<MapType<bliss::common::DNA16>, de_bruijn_canonical_parser<typename MapType<bliss::common::DNA16>::key_type, bliss::common::DNA16 > >;
+
 	template <template <typename> class MapType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec >
 	using de_bruijn_quality_engine = ::bliss::index::kmer::Index<MapType<bliss::common::DNA16>, de_bruijn_quality_parser<typename MapType<bliss::common::DNA16>::key_type, typename std::tuple_element<1, typename MapType<bliss::common::DNA16>::mapped_type>::type, bliss::common::DNA16, QualityEncoder > >;
 
@@ -262,6 +262,11 @@ namespace bliss
 				  return counts[idx];
 				}
 
+				/// remove the edge at idx (same indexing as get_edge_frequency), e.g. when pruning the graph.
+				void remove_edge(uint8_t idx) {
+				  if (idx < 8) counts[idx] = 0;
+				}
+
 			};
 
 
@@ -332,6 +337,11 @@ namespace bliss
           return (counts >> idx) & 0x1;
         }
 
+        /// remove the edge at idx (same indexing as get_edge_frequency), e.g. when pruning the graph.
+        void remove_edge(uint8_t idx) {
+          if (idx < 8) counts &= static_cast<uint8_t>(~(1 << idx));
+        }
+
 
       };
 
@@ -220,6 +220,15 @@ namespace bliss{
 
 			  virtual ~de_bruijn_nodes_distributed() {/*do nothing*/};
 
+			  /// rank that owns the node of kmer k (either strand), for batched queries on the node distribution, e.g. by unitig_compactor.
+			  int get_rank(Key const & k) const {
+				  return this->key_to_rank(k);
+			  }
+
+			  const mxx::comm& get_comm() const {
+				  return this->comm;
+			  }
+
 			  /*transform function*/
 
 			  /**
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_pruning.hpp
+ * @ingroup bliss::de_bruijn
+ * @brief   distributed error pruning of the de bruijn graph:  low coverage edges, tips, and bubbles.
+ * @details all passes work on a de_bruijn_nodes_distributed map in place, and are collective.
+ *
+ *          1. filter_edges:  removes edges with frequency below a threshold.  the 2 end nodes of an edge count the same
+ *             k+1-mers, so each rank filters its own nodes and the graph stays symmetric, without communication.
+ *             meaningful for edge_counts nodes only, as edge_exists frequencies are 0 or 1.
+ *          2. remove_tips:  compacts the graph into unitigs (unitig_compactor), then looks up the 2 end nodes of each short
+ *             unitig with 1 batched find.  a unitig with a dead end on exactly 1 side is a tip.  its nodes are erased,
+ *             and the edges of its neighbors to it are removed.  repeated, as removing a tip can create a new one.
+ *          3. pop_bubbles:  a short unitig whose 2 ends each have 1 neighbor is a bubble branch candidate.  candidates are
+ *             sent to a rank chosen by their neighbor pair, and candidates with the same neighbors and similar length
+ *             form a bubble.  all branches but the one with the highest coverage (frequency of its end edges, then the
+ *             smallest head) are removed as for tips.
+ *
+ *          node removal is 1 erase of the unitig kmers, and 1 distribute of the edge removals to the neighbors' owners.
+ *          requires DNA kmers, as unitig_compactor does.
+ */
+#ifndef DE_BRUIJN_PRUNING_HPP_
+#define DE_BRUIJN_PRUNING_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>      // pair
+#include <tuple>        // tie
+#include <algorithm>    // sort, min
+
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/mxx_support.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+
+    /**
+     * @brief error pruning passes over a de_bruijn_nodes_distributed map.  all public methods are collective.
+     * @tparam NodeMap   de_bruijn_nodes_distributed, with edge_exists or edge_counts nodes.
+     */
+    template <typename NodeMap>
+    class graph_pruner {
+      public:
+        using Kmer = typename NodeMap::key_type;
+        using EdgeType = typename NodeMap::mapped_type;
+        using CountType = typename EdgeType::CountType;
+
+      protected:
+        using Alphabet = typename Kmer::KmerAlphabet;
+        using Hash = ::bliss::kmer::hash::farm<Kmer, false>;
+
+        /// (kmer, edge index in the kmer's orientation, as in get_edge_frequency)
+        using edge_removal_type = ::std::pair<Kmer, uint8_t>;
+        /// bubble branch:  ((smaller neighbor, larger neighbor), ((head, kmers), coverage))
+        using branch_type = ::std::pair<::std::pair<Kmer, Kmer>, ::std::pair<::std::pair<Kmer, uint64_t>, uint64_t> >;
+
+        /// the 2 ends of a local unitig, in the unitig's orientation, with the letters and frequencies of their outer sides.
+        struct unitig_ends {
+            size_t id;            // index in the compactor's unitigs
+            Kmer first;
+            Kmer last;
+            uint8_t in_letters;   // mask of the in edges of first, A C G T from low to high bit
+            uint8_t out_letters;  // mask of the out edges of last
+            uint64_t in_freq;     // sum of the in edge frequencies of first
+            uint64_t out_freq;    // sum of the out edge frequencies of last
+        };
+
+        NodeMap & nodes;
+        const mxx::comm & comm;
+        ::bliss::kmer::transform::lex_less<Kmer> canonical;
+
+        /// kmer at offset of an ASCII sequence.
+        static Kmer kmer_at(::std::string const & seq, size_t const & offset) {
+          Kmer km;
+          for (size_t i = 0; i < Kmer::size; ++i)
+            km.nextFromChar(Alphabet::FROM_ASCII[static_cast<unsigned char>(seq[offset + i])]);
+          return km;
+        }
+
+        /// the letter if mask has exactly 1 bit, else 4.
+        static uint8_t single_letter(uint8_t mask) {
+          switch (mask) {
+            case 1: return 0;
+            case 2: return 1;
+            case 4: return 2;
+            case 8: return 3;
+            default: return 4;
+          }
+        }
+
+        /// letters and total frequency of the out (or in) edges of kmer, given the stored kmer (either strand) and its edges.
+        static ::std::pair<uint8_t, uint64_t> side_edges(Kmer const & kmer, Kmer const & stored, EdgeType const & edges, bool out) {
+          bool same = (kmer == stored);
+          // out edges of the reverse complement are the complemented in edges of the stored kmer.
+          uint8_t offset = (out == same) ? 0 : 4;
+          uint8_t mask = 0;
+          uint64_t freq = 0;
+          for (uint8_t i = 0; i < 4; ++i) {
+            uint64_t f = edges.get_edge_frequency(offset + i);
+            if (f > 0) {
+              mask |= same ? (1 << i) : (1 << (3 - i));
+              freq += f;
+            }
+          }
+          return ::std::make_pair(mask, freq);
+        }
+
+        /// look up the end nodes of the (non circular) local unitigs with at most max_kmers kmers.
+        ::std::vector<unitig_ends> find_ends(::std::vector<unitig<Kmer> > const & unitigs, size_t const & max_kmers) {
+          ::std::vector<unitig_ends> ends;
+          ::std::vector<Kmer> query;
+          for (size_t i = 0; i < unitigs.size(); ++i) {
+            unitig<Kmer> const & u = unitigs[i];
+            if (u.circular || (u.kmers > max_kmers)) continue;
+
+            unitig_ends e;
+            e.id = i;
+            e.first = kmer_at(u.seq, 0);
+            e.last = kmer_at(u.seq, u.seq.size() - Kmer::size);
+            ends.emplace_back(e);
+            query.emplace_back(e.first);
+            query.emplace_back(e.last);
+          }
+
+          // batched lookup.  the results hold the stored orientation of each node.
+          auto found = nodes.find(query);
+          ::std::unordered_map<Kmer, ::std::pair<Kmer, EdgeType>, Hash> lookup;
+          lookup.reserve(found.size());
+          for (auto const & f : found) {
+            lookup[canonical(f.first)] = f;
+          }
+
+          size_t j = 0;
+          for (size_t i = 0; i < ends.size(); ++i) {
+            unitig_ends & e = ends[i];
+            auto fit = lookup.find(canonical(e.first));
+            auto lit = lookup.find(canonical(e.last));
+            if ((fit == lookup.end()) || (lit == lookup.end())) continue;  // not a node.  cannot happen after compaction.
+
+            ::std::tie(e.in_letters, e.in_freq) = side_edges(e.first, fit->second.first, fit->second.second, false);
+            ::std::tie(e.out_letters, e.out_freq) = side_edges(e.last, lit->second.first, lit->second.second, true);
+            ends[j++] = e;
+          }
+          ends.resize(j);
+          return ends;
+        }
+
+        /// remove the selected local unitigs:  erase their nodes and the edges of their neighbors to them.
+        size_t remove(::std::vector<unitig<Kmer> > const & unitigs, ::std::vector<unitig_ends> const & removed) {
+          ::std::vector<Kmer> keys;
+          ::std::vector<edge_removal_type> edges;
+
+          for (auto const & e : removed) {
+            unitig<Kmer> const & u = unitigs[e.id];
+
+            Kmer km = e.first;
+            keys.emplace_back(km);
+            for (size_t i = Kmer::size; i < u.seq.size(); ++i) {
+              km.nextFromChar(Alphabet::FROM_ASCII[static_cast<unsigned char>(u.seq[i])]);
+              keys.emplace_back(km);
+            }
+
+            // the left neighbor across in letter x has an out edge to first, with the last letter of first.
+            uint8_t first_last = Alphabet::FROM_ASCII[static_cast<unsigned char>(u.seq[Kmer::size - 1])];
+            // the right neighbor across out letter y has an in edge from last, with the first letter of last.
+            uint8_t last_first = Alphabet::FROM_ASCII[static_cast<unsigned char>(u.seq[u.seq.size() - Kmer::size])];
+            for (uint8_t x = 0; x < 4; ++x) {
+              if ((e.in_letters >> x) & 1) {
+                Kmer n = e.first;
+                n.nextReverseFromChar(x);
+                edges.emplace_back(n, first_last);
+              }
+              if ((e.out_letters >> x) & 1) {
+                Kmer n = e.last;
+                n.nextFromChar(x);
+                edges.emplace_back(n, 4 + last_first);
+              }
+            }
+          }
+
+          ::std::vector<size_t> recv_counts;
+          ::std::vector<size_t> i2o;
+          ::std::vector<edge_removal_type> received;
+          ::imxx::distribute(edges, [this](edge_removal_type const & x) { return nodes.get_rank(x.first); },
+                             recv_counts, i2o, received, comm, false);
+
+          // local find accepts either strand.  edge indices of the other strand are complemented, with in and out swapped.
+          auto & local = nodes.get_local_container();
+          for (auto const & r : received) {
+            auto it = local.find(r.first);
+            if (it == local.end()) continue;  // neighbor is also removed.
+
+            if (it->first == r.first) it->second.remove_edge(r.second);
+            else it->second.remove_edge((r.second < 4) ? (7 - r.second) : (3 - (r.second - 4)));
+          }
+
+          return nodes.erase(keys);
+        }
+
+      public:
+        graph_pruner(NodeMap & _nodes) : nodes(_nodes), comm(_nodes.get_comm()) {}
+
+        /**
+         * @brief remove the edges with frequency below min_count.  nodes are kept.
+         * @return total number of edge entries removed (each edge is counted at both of its ends).
+         */
+        size_t filter_edges(CountType const & min_count) {
+          size_t count = 0;
+          auto & local = nodes.get_local_container();
+          for (auto it = local.begin(); it != local.end(); ++it) {
+            for (uint8_t i = 0; i < 8; ++i) {
+              CountType f = it->second.get_edge_frequency(i);
+              if ((f > 0) && (f < min_count)) {
+                it->second.remove_edge(i);
+                ++count;
+              }
+            }
+          }
+          return ::mxx::allreduce(count, comm);
+        }
+
+        /**
+         * @brief remove tips:  unitigs of at most max_kmers kmers with a dead end on exactly 1 side.
+         * @param max_iterations   number of compact and remove rounds, stopping early when no tip is found.
+         * @return number of tips removed.
+         */
+        size_t remove_tips(size_t const & max_kmers, size_t const & max_iterations = 3) {
+          BL_BENCH_INIT(tips);
+
+          size_t total = 0;
+          for (size_t iter = 0; iter < max_iterations; ++iter) {
+            BL_BENCH_COLLECTIVE_START(tips, "compact", comm);
+            unitig_compactor<NodeMap> compactor(nodes);
+            compactor.compact();
+            auto const & unitigs = compactor.get_unitigs();
+            BL_BENCH_END(tips, "compact", unitigs.size());
+
+            BL_BENCH_COLLECTIVE_START(tips, "find_ends", comm);
+            ::std::vector<unitig_ends> ends = find_ends(unitigs, max_kmers);
+            size_t j = 0;
+            for (size_t i = 0; i < ends.size(); ++i) {
+              if ((ends[i].in_letters == 0) != (ends[i].out_letters == 0)) ends[j++] = ends[i];
+            }
+            ends.resize(j);
+            BL_BENCH_END(tips, "find_ends", ends.size());
+
+            size_t count = ::mxx::allreduce(ends.size(), comm);
+            if (count == 0) break;
+
+            BL_BENCH_COLLECTIVE_START(tips, "remove", comm);
+            remove(unitigs, ends);
+            BL_BENCH_END(tips, "remove", count);
+
+            total += count;
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(tips, "debruijn:tips", comm);
+          return total;
+        }
+
+        /**
+         * @brief pop bubbles:  2 or more unitigs of at most max_kmers kmers, between the same 2 neighbor nodes, with
+         *        lengths within max_length_diff of the branch that is kept.
+         * @param max_iterations   number of compact and remove rounds, stopping early when no bubble is found.
+         * @return number of bubble branches removed.
+         */
+        size_t pop_bubbles(size_t const & max_kmers, size_t const & max_length_diff = 1, size_t const & max_iterations = 3) {
+          BL_BENCH_INIT(bubbles);
+
+          size_t total = 0;
+          for (size_t iter = 0; iter < max_iterations; ++iter) {
+            BL_BENCH_COLLECTIVE_START(bubbles, "compact", comm);
+            unitig_compactor<NodeMap> compactor(nodes);
+            compactor.compact();
+            auto const & unitigs = compactor.get_unitigs();
+            BL_BENCH_END(bubbles, "compact", unitigs.size());
+
+            // candidates have exactly 1 neighbor on each side.
+            BL_BENCH_COLLECTIVE_START(bubbles, "find_ends", comm);
+            ::std::vector<unitig_ends> ends = find_ends(unitigs, max_kmers);
+            ::std::unordered_map<Kmer, size_t, Hash> candidates;  // head to index in ends
+            ::std::vector<branch_type> branches;
+            for (size_t i = 0; i < ends.size(); ++i) {
+              unitig_ends const & e = ends[i];
+              uint8_t x = single_letter(e.in_letters);
+              uint8_t y = single_letter(e.out_letters);
+              if ((x > 3) || (y > 3)) continue;
+
+              Kmer a = e.first;
+              a.nextReverseFromChar(x);
+              Kmer b = e.last;
+              b.nextFromChar(y);
+              a = canonical(a);
+              b = canonical(b);
+              if (a == b) continue;   // loop
+
+              unitig<Kmer> const & u = unitigs[e.id];
+              candidates[u.head] = i;
+              branches.emplace_back(::std::make_pair(::std::min(a, b), ::std::max(a, b)),
+                                    ::std::make_pair(::std::make_pair(u.head, static_cast<uint64_t>(u.kmers)),
+                                                     ::std::min(e.in_freq, e.out_freq)));
+            }
+            BL_BENCH_END(bubbles, "find_ends", branches.size());
+
+            // group the branches by their neighbor pair.
+            BL_BENCH_COLLECTIVE_START(bubbles, "group", comm);
+            ::std::vector<size_t> recv_counts;
+            ::std::vector<size_t> i2o;
+            ::std::vector<branch_type> received;
+            ::imxx::distribute(branches, [this](branch_type const & x) { return nodes.get_rank(x.first.first); },
+                               recv_counts, i2o, received, comm, false);
+            branches.clear();
+
+            // highest coverage first, then smallest head.
+            ::std::sort(received.begin(), received.end(), [](branch_type const & x, branch_type const & y) {
+              return (x.first < y.first) ||
+                  ((x.first == y.first) && ((x.second.second > y.second.second) ||
+                      ((x.second.second == y.second.second) && (x.second.first.first < y.second.first.first))));
+            });
+
+            ::std::vector<Kmer> popped;
+            for (size_t i = 0; i < received.size(); ) {
+              uint64_t kept = received[i].second.first.second;
+              size_t j = i + 1;
+              for (; (j < received.size()) && (received[j].first == received[i].first); ++j) {
+                uint64_t len = received[j].second.first.second;
+                if (((len > kept) ? (len - kept) : (kept - len)) <= max_length_diff)
+                  popped.emplace_back(received[j].second.first.first);
+              }
+              i = j;
+            }
+            received.clear();
+
+            // the unitigs are on the rank of their heads.
+            ::std::vector<Kmer> heads;
+            ::imxx::distribute(popped, [this](Kmer const & x) { return nodes.get_rank(x); },
+                               recv_counts, i2o, heads, comm, false);
+            BL_BENCH_END(bubbles, "group", heads.size());
+
+            size_t count = ::mxx::allreduce(heads.size(), comm);
+            if (count == 0) break;
+
+            BL_BENCH_COLLECTIVE_START(bubbles, "remove", comm);
+            ::std::vector<unitig_ends> removed;
+            removed.reserve(heads.size());
+            for (auto const & h : heads) {
+              auto it = candidates.find(h);
+              if (it != candidates.end()) removed.emplace_back(ends[it->second]);
+            }
+            remove(unitigs, removed);
+            BL_BENCH_END(bubbles, "remove", count);
+
+            total += count;
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(bubbles, "debruijn:bubbles", comm);
+          return total;
+        }
+
+        /**
+         * @brief the pruning pipeline:  low coverage edges, then tips, bubbles, and the tips left by popping bubbles.
+         * @param min_count    edges with lower frequency are removed.  0 or 1 to skip.
+         * @param max_kmers    longest tip or bubble branch, in kmers, e.g. 2k.
+         */
+        void prune(CountType const & min_count, size_t const & max_kmers) {
+          BL_BENCH_INIT(prune);
+
+          BL_BENCH_COLLECTIVE_START(prune, "filter_edges", comm);
+          size_t edges = (min_count > 1) ? filter_edges(min_count) : 0;
+          BL_BENCH_END(prune, "filter_edges", edges);
+
+          BL_BENCH_COLLECTIVE_START(prune, "tips", comm);
+          size_t tips = remove_tips(max_kmers);
+          BL_BENCH_END(prune, "tips", tips);
+
+          BL_BENCH_COLLECTIVE_START(prune, "bubbles", comm);
+          size_t bubbles = pop_bubbles(max_kmers);
+          BL_BENCH_END(prune, "bubbles", bubbles);
+
+          BL_BENCH_COLLECTIVE_START(prune, "tips2", comm);
+          tips = remove_tips(max_kmers);
+          BL_BENCH_END(prune, "tips2", tips);
+
+          BLISS_UNUSED(edges);
+          BLISS_UNUSED(bubbles);
+          BLISS_UNUSED(tips);
+
+          BL_BENCH_REPORT_MPI_NAMED(prune, "debruijn:prune", comm);
+        }
+    };
+
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_PRUNING_HPP_ */
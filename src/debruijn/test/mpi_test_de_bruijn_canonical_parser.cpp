@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_de_bruijn_canonical_parser.cpp
+ * @ingroup bliss::de_bruijn::test
+ * @brief   tests the 1 pass canonical de bruijn parser against de_bruijn_parser followed by canonicalization.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/sequence.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_construct_engine.hpp"
+
+
+template <typename KmerType>
+void check_canonical_parser(std::string const & input) {
+  using SeqType = bliss::common::Sequence<unsigned char const *>;
+  using ValueType = std::pair<KmerType, uint8_t>;
+
+  SeqType read;
+  read.seq_begin = reinterpret_cast<unsigned char const *>(input.data());
+  read.seq_end = read.seq_begin + input.size();
+
+  ::bliss::partition::range<size_t> r(0, input.size());
+
+  // parsers check the output iterator's value type, so write into preallocated vectors.
+  std::vector<ValueType> gold(input.size());
+  ::bliss::de_bruijn::de_bruijn_parser<KmerType> parser(r);
+  gold.erase(parser(read, gold.begin()), gold.end());
+
+  std::vector<ValueType> canonicals(input.size());
+  ::bliss::de_bruijn::de_bruijn_canonical_parser<KmerType> canonical_parser(r);
+  canonicals.erase(canonical_parser(read, canonicals.begin()), canonicals.end());
+
+  ASSERT_EQ(gold.size(), canonicals.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    KmerType rc = gold[i].first.reverse_complement();
+    if (rc < gold[i].first) {
+      EXPECT_EQ(rc, canonicals[i].first) << "position " << i;
+      EXPECT_EQ(::bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<bliss::common::DNA16>(gold[i].second),
+                canonicals[i].second) << "position " << i;
+    } else {
+      EXPECT_EQ(gold[i].first, canonicals[i].first) << "position " << i;
+      EXPECT_EQ(gold[i].second, canonicals[i].second) << "position " << i;
+    }
+  }
+}
+
+static std::string random_dna(size_t const & len, unsigned int seed) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<int> d(0, 3);
+  std::string s(len, 'A');
+  for (size_t i = 0; i < len; ++i) s[i] = "ACGT"[d(gen)];
+  return s;
+}
+
+
+TEST(DeBruijnCanonicalParser, single_line)
+{
+  std::string s = random_dna(500, 21);
+  check_canonical_parser<bliss::common::Kmer<21, bliss::common::DNA, uint64_t> >(s);
+  check_canonical_parser<bliss::common::Kmer<31, bliss::common::DNA, uint64_t> >(s);
+  check_canonical_parser<bliss::common::Kmer<63, bliss::common::DNA, uint64_t> >(s);
+  check_canonical_parser<bliss::common::Kmer<21, bliss::common::DNA5, uint64_t> >(s);
+}
+
+TEST(DeBruijnCanonicalParser, multi_line)
+{
+  // EOL are skipped, and N is an edge character in DNA16.
+  std::string s = random_dna(200, 22) + "\n" + random_dna(100, 23) + "N\r\n" + random_dna(60, 24);
+  check_canonical_parser<bliss::common::Kmer<21, bliss::common::DNA, uint64_t> >(s);
+  check_canonical_parser<bliss::common::Kmer<31, bliss::common::DNA5, uint64_t> >(s);
+}
+
+TEST(DeBruijnCanonicalParser, short_reads)
+{
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  // fewer than k, exactly k, and k+1 characters.
+  check_canonical_parser<KmerType>(random_dna(20, 25));
+  check_canonical_parser<KmerType>(random_dna(21, 26));
+  check_canonical_parser<KmerType>(random_dna(22, 27));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_de_bruijn_pruning.cpp
+ * @ingroup bliss::de_bruijn::test
+ * @brief   tests low coverage edge filtering, tip removal, and bubble popping on graphs with known errors.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/debruijn_mxx_support.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_nodes_distributed.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
+#include "debruijn/de_bruijn_pruning.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
+using NodeMapType = ::bliss::de_bruijn::de_bruijn_nodes_distributed<
+    KmerType, ::bliss::de_bruijn::node::edge_counts<::bliss::common::DNA16>, MapParams>;
+using PrunerType = ::bliss::de_bruijn::graph_pruner<NodeMapType>;
+using CompactorType = ::bliss::de_bruijn::unitig_compactor<NodeMapType>;
+
+
+static std::string random_dna(size_t const & len, unsigned int seed) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<int> d(0, 3);
+  std::string s(len, 'A');
+  for (size_t i = 0; i < len; ++i) s[i] = "ACGT"[d(gen)];
+  return s;
+}
+
+static std::string revcomp(std::string const & s) {
+  std::string r(s.rbegin(), s.rend());
+  for (auto & c : r) c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+  return r;
+}
+
+static std::string canonical(std::string const & s) {
+  return std::min(s, revcomp(s));
+}
+
+/// kmers of read s with their [out, in] DNA16 edges, as the de bruijn parser produces them.  keeps every p-th one, starting at r.
+static void add_read(std::string const & s, int r, int p, std::vector<std::pair<KmerType, uint8_t> > & nodes) {
+  size_t k = KmerType::size;
+  for (size_t i = 0; i + k <= s.size(); ++i) {
+    if (static_cast<int>(i % p) != r) continue;
+    KmerType km;
+    for (size_t j = 0; j < k; ++j) km.nextFromChar(::bliss::common::DNA::FROM_ASCII[static_cast<size_t>(s[i + j])]);
+    uint8_t out = (i + k < s.size()) ? ::bliss::common::DNA16::FROM_ASCII[static_cast<size_t>(s[i + k])] : 0;
+    uint8_t in = (i > 0) ? ::bliss::common::DNA16::FROM_ASCII[static_cast<size_t>(s[i - 1])] : 0;
+    nodes.emplace_back(km, (in << 4) | out);
+  }
+}
+
+/// compact, and return the number of unitigs, and whether s is one of them.
+static std::pair<size_t, bool> has_unitig(NodeMapType & nodes, std::string const & s, ::mxx::comm const & comm) {
+  CompactorType compactor(nodes);
+  compactor.compact();
+
+  int found = 0;
+  for (auto const & u : compactor.get_unitigs()) {
+    if (canonical(u.seq) == canonical(s)) found = 1;
+  }
+  return std::make_pair(compactor.size(), ::mxx::allreduce(found, comm) > 0);
+}
+
+
+TEST(DeBruijnPruning, tip)
+{
+  ::mxx::comm comm;
+
+  // an error 10 characters before the end of a read creates a tip of 10 kmers.
+  std::string s = random_dna(300, 31);
+  std::string t = s.substr(100, 60) + random_dna(10, 32);
+  t[60] = (s[160] == 'A') ? 'C' : 'A';
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(t, comm.rank(), comm.size(), input);
+
+  NodeMapType nodes(comm);
+  nodes.insert(input);
+  size_t before = nodes.size();
+
+  PrunerType pruner(nodes);
+  EXPECT_EQ(1UL, pruner.remove_tips(2 * KmerType::size));
+  EXPECT_EQ(before - 10, nodes.size());
+
+  auto result = has_unitig(nodes, s, comm);
+  EXPECT_EQ(1UL, result.first);
+  EXPECT_TRUE(result.second);
+}
+
+TEST(DeBruijnPruning, bubble)
+{
+  ::mxx::comm comm;
+
+  // a substitution in 1 of 3 reads creates a bubble, with k kmers in each branch.
+  std::string s = random_dna(300, 33);
+  std::string e = s;
+  e[150] = (s[150] == 'A') ? 'C' : 'A';
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(e, comm.rank(), comm.size(), input);
+
+  NodeMapType nodes(comm);
+  nodes.insert(input);
+  size_t before = nodes.size();
+
+  PrunerType pruner(nodes);
+  EXPECT_EQ(1UL, pruner.pop_bubbles(2 * KmerType::size));
+  EXPECT_EQ(before - KmerType::size, nodes.size());
+
+  // the higher coverage branch is kept.
+  auto result = has_unitig(nodes, s, comm);
+  EXPECT_EQ(1UL, result.first);
+  EXPECT_TRUE(result.second);
+}
+
+TEST(DeBruijnPruning, filter_edges)
+{
+  ::mxx::comm comm;
+
+  std::string s = random_dna(300, 34);
+  std::string e = s;
+  e[150] = (s[150] == 'A') ? 'C' : 'A';
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(e, comm.rank(), comm.size(), input);
+
+  NodeMapType nodes(comm);
+  nodes.insert(input);
+
+  // the k+1 edges of the erroneous branch are removed at both ends.  its k kmers become isolated.
+  PrunerType pruner(nodes);
+  EXPECT_EQ(2 * (KmerType::size + 1), pruner.filter_edges(2));
+
+  auto result = has_unitig(nodes, s, comm);
+  EXPECT_EQ(1UL + KmerType::size, result.first);
+  EXPECT_TRUE(result.second);
+}
+
+TEST(DeBruijnPruning, prune)
+{
+  ::mxx::comm comm;
+
+  // a tip and a bubble on the same sequence.
+  std::string s = random_dna(400, 35);
+  std::string t = s.substr(50, 60) + random_dna(10, 36);
+  t[60] = (s[110] == 'A') ? 'C' : 'A';
+  std::string e = s;
+  e[250] = (s[250] == 'A') ? 'C' : 'A';
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(s, comm.rank(), comm.size(), input);
+  add_read(t, comm.rank(), comm.size(), input);
+  add_read(e, comm.rank(), comm.size(), input);
+
+  NodeMapType nodes(comm);
+  nodes.insert(input);
+
+  PrunerType pruner(nodes);
+  pruner.prune(0, 2 * KmerType::size);
+
+  auto result = has_unitig(nodes, s, comm);
+  EXPECT_EQ(1UL, result.first);
+  EXPECT_TRUE(result.second);
+  EXPECT_EQ(s.size() - KmerType::size + 1, nodes.size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_unitig_compaction.cpp
+ * @ingroup bliss::de_bruijn::test
+ * @brief   tests unitig compaction on graphs with known unitigs:  a linear path, a branch, and a cycle.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/debruijn_mxx_support.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_nodes_distributed.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
+using NodeMapType = ::bliss::de_bruijn::de_bruijn_nodes_distributed<
+    KmerType, ::bliss::de_bruijn::node::edge_exists<::bliss::common::DNA16>, MapParams>;
+using CompactorType = ::bliss::de_bruijn::unitig_compactor<NodeMapType>;
+
+
+static std::string random_dna(size_t const & len, unsigned int seed) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<int> d(0, 3);
+  std::string s(len, 'A');
+  for (size_t i = 0; i < len; ++i) s[i] = "ACGT"[d(gen)];
+  return s;
+}
+
+static std::string revcomp(std::string const & s) {
+  std::string r(s.rbegin(), s.rend());
+  for (auto & c : r) c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+  return r;
+}
+
+static std::string canonical(std::string const & s) {
+  return std::min(s, revcomp(s));
+}
+
+/// kmers of s with their [out, in] DNA16 edges, as the de bruijn parser produces them.  keeps every p-th one, starting at r.
+static void add_nodes(std::string const & s, bool circular, int r, int p,
+                      std::vector<std::pair<KmerType, uint8_t> > & nodes) {
+  size_t k = KmerType::size;
+  size_t n = circular ? s.size() : s.size() - k + 1;
+  std::string t = circular ? s + s.substr(0, k) : s;
+  for (size_t i = 0; i < n; ++i) {
+    if (static_cast<int>(i % p) != r) continue;
+    KmerType km;
+    for (size_t j = 0; j < k; ++j) km.nextFromChar(::bliss::common::DNA::FROM_ASCII[static_cast<size_t>(t[i + j])]);
+    uint8_t out = (i + k < t.size()) ? ::bliss::common::DNA16::FROM_ASCII[static_cast<size_t>(t[i + k])] : 0;
+    uint8_t in = circular ? ::bliss::common::DNA16::FROM_ASCII[static_cast<size_t>(t[(i + s.size() - 1) % s.size()])] :
+        ((i > 0) ? ::bliss::common::DNA16::FROM_ASCII[static_cast<size_t>(t[i - 1])] : 0);
+    nodes.emplace_back(km, (in << 4) | out);
+  }
+}
+
+/// compact, then check that each local unitig is expected, and that the total count matches.
+static void check(std::vector<std::pair<KmerType, uint8_t> > & input, std::set<std::string> const & expected,
+                  bool circular, ::mxx::comm const & comm) {
+  NodeMapType nodes(comm);
+  nodes.insert(input);
+
+  CompactorType compactor(nodes);
+  compactor.compact();
+
+  size_t kmers = 0;
+  for (auto const & u : compactor.get_unitigs()) {
+    EXPECT_EQ(u.seq.size(), u.kmers + KmerType::size - 1);
+    EXPECT_EQ(circular, u.circular);
+    kmers += u.kmers;
+    if (circular) {
+      // a rotation of the cycle, with the first k-1 characters repeated at the end.
+      std::string const & e = *(expected.begin());
+      std::string body = u.seq.substr(0, u.kmers);
+      EXPECT_TRUE(((e + e).find(body) != std::string::npos) || ((revcomp(e) + revcomp(e)).find(body) != std::string::npos));
+      EXPECT_EQ(u.seq.substr(0, KmerType::size - 1), u.seq.substr(u.kmers));
+    } else {
+      EXPECT_EQ(1UL, expected.count(canonical(u.seq))) << u.seq;
+    }
+  }
+  EXPECT_EQ(expected.size(), compactor.size());
+  EXPECT_EQ(nodes.size(), ::mxx::allreduce(kmers, comm));
+  EXPECT_EQ(nodes.local_size(), compactor.get_positions().size());
+}
+
+
+TEST(UnitigCompaction, linear)
+{
+  ::mxx::comm comm;
+
+  std::string s = random_dna(300, 11);
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_nodes(s, false, comm.rank(), comm.size(), input);
+
+  std::set<std::string> expected;
+  expected.insert(canonical(s));
+  check(input, expected, false, comm);
+}
+
+TEST(UnitigCompaction, branch)
+{
+  ::mxx::comm comm;
+
+  // 2 reads share a 100 character prefix, then diverge at the first character and do not reconverge.
+  std::string prefix = random_dna(100, 12);
+  std::string a = random_dna(100, 13);
+  std::string b = random_dna(100, 15);
+  b[0] = (a[0] == 'A') ? 'C' : 'A';
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_nodes(prefix + a, false, comm.rank(), comm.size(), input);
+  add_nodes(prefix + b, false, comm.rank(), comm.size(), input);
+
+  // the last kmer of the prefix branches, and ends the prefix unitig.
+  size_t k = KmerType::size;
+  std::set<std::string> expected;
+  expected.insert(canonical(prefix));
+  expected.insert(canonical((prefix + a).substr(100 - k + 1)));
+  expected.insert(canonical((prefix + b).substr(100 - k + 1)));
+  check(input, expected, false, comm);
+}
+
+TEST(UnitigCompaction, cycle)
+{
+  ::mxx::comm comm;
+
+  std::string s = random_dna(150, 14);
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  add_nodes(s, true, comm.rank(), comm.size(), input);
+
+  std::set<std::string> expected;
+  expected.insert(s);
+  check(input, expected, true, comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
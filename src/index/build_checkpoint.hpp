@@ -0,0 +1,271 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    build_checkpoint.hpp
+ * @ingroup index
+ * @brief   periodic checkpoints of a streaming index build, so an interrupted build resumes from the last checkpoint.
+ * @details  a checkpoint is the map content of each process, in a per process file <prefix>.<slot>.<rank> (see
+ *          map_base::snapshot_local), and the bytes of the file partition each process had inserted, in <prefix>.meta.
+ *          the local map is copied on the calling thread, then written by a background thread, so ingestion continues
+ *          during the write.  when all processes have finished writing, rank 0 replaces the meta file, which commits the
+ *          checkpoint.  the snapshots alternate between 2 slots, so the committed checkpoint is never overwritten.
+ *
+ *          the file partitions depend on the number of processes, so a checkpoint is only resumed with the same number
+ *          of processes and the same input file size, and a map of the same type.  otherwise the build starts over.
+ *          the snapshot copy needs as much memory as the local map.
+ */
+#ifndef BLISS_INDEX_BUILD_CHECKPOINT_HPP
+#define BLISS_INDEX_BUILD_CHECKPOINT_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>   // shared_ptr
+#include <future>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "utils/logging.h"
+#include "io/io_exception.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/**
+ * @brief settings of Index::build_checkpointed.  the same on all processes.
+ */
+struct checkpoint_config {
+	/// path prefix of the checkpoint files.  should be on a file system shared by all processes, and kept across jobs.
+	std::string prefix;
+	/// seconds between checkpoints, as measured on rank 0.  a checkpoint starts only after the previous one is committed.
+	double interval;
+	/// resume from the last committed checkpoint, if any.
+	bool resume;
+	/// remove the checkpoint files when the build completes.  otherwise the completed map is saved as the last checkpoint.
+	bool remove_at_end;
+
+	checkpoint_config(std::string const & _prefix = "bliss_checkpoint", double const & _interval = 600.0) :
+		prefix(_prefix), interval(_interval), resume(true), remove_at_end(true) {}
+};
+
+/**
+ * @brief checkpoints of 1 build of MapType from 1 file.  all methods except get_* are collective.
+ * @tparam MapType  distributed map with snapshot_local and load_local, e.g. the dsc hashed maps.
+ */
+template <typename MapType>
+class build_checkpointer {
+protected:
+	/// header of the meta file.  followed by comm_size uint64_t, the bytes of each process's partition in the checkpoint.
+	struct meta_header {
+		uint64_t magic;
+		uint64_t comm_size;
+		uint64_t file_size;
+		uint64_t slot;
+		uint64_t sequence;
+	};
+	/// "BLISSCKP" as a little endian uint64_t.
+	static constexpr uint64_t meta_magic = 0x504B435353494C42UL;
+
+	MapType & map;
+	const mxx::comm & comm;
+	checkpoint_config config;
+	uint64_t file_size;
+
+	/// slot of the next snapshot, and the number of committed checkpoints.
+	uint64_t slot;
+	uint64_t sequence;
+
+	/// snapshot being written, its slot, and the bytes of all processes at the snapshot (rank 0 only).
+	std::future<void> pending;
+	uint64_t pending_slot;
+	std::vector<uint64_t> pending_bytes;
+
+	/// time of the last snapshot, on rank 0.
+	std::chrono::steady_clock::time_point last;
+
+	std::string meta_name() const { return config.prefix + ".meta"; }
+	std::string slot_name(uint64_t const & s, int const & rank) const {
+		std::stringstream ss;
+		ss << config.prefix << "." << s << "." << rank;
+		return ss.str();
+	}
+
+	/// write the meta file for the pending snapshot.  rank 0.  replaces the old meta file whole.
+	void write_meta() const {
+		meta_header header;
+		header.magic = meta_magic;
+		header.comm_size = comm.size();
+		header.file_size = file_size;
+		header.slot = pending_slot;
+		header.sequence = sequence;
+
+		std::string tmp = meta_name() + ".tmp";
+		FILE * f = fopen(tmp.c_str(), "wb");
+		bool ok = (f != NULL);
+		if (ok) ok = (fwrite(&header, sizeof(meta_header), 1, f) == 1) &&
+				(fwrite(pending_bytes.data(), sizeof(uint64_t), pending_bytes.size(), f) == pending_bytes.size());
+		if (f != NULL) ok = (fclose(f) == 0) && ok;
+		if (ok) ok = (rename(tmp.c_str(), meta_name().c_str()) == 0);
+		if (!ok) {
+			BL_WARNINGF("build_checkpointer: could not write %s.  checkpoint %lu is not committed.", meta_name().c_str(), sequence);
+		}
+	}
+
+	/// read the meta file.  true if it exists and matches this build.
+	bool read_meta(meta_header & header, std::vector<uint64_t> & bytes) const {
+		FILE * f = fopen(meta_name().c_str(), "rb");
+		if (f == NULL) return false;
+		bool ok = (fread(&header, sizeof(meta_header), 1, f) == 1) && (header.magic == meta_magic);
+		if (ok && ((header.comm_size != static_cast<uint64_t>(comm.size())) || (header.file_size != file_size))) {
+			if (comm.rank() == 0) BL_WARNINGF("build_checkpointer: %s is for %lu processes and a file of %lu bytes, not %d and %lu.  starting over.",
+					meta_name().c_str(), header.comm_size, header.file_size, comm.size(), file_size);
+			ok = false;
+		}
+		if (ok) {
+			bytes.resize(header.comm_size);
+			ok = (fread(bytes.data(), sizeof(uint64_t), bytes.size(), f) == bytes.size());
+		}
+		fclose(f);
+		return ok;
+	}
+
+	/// if a snapshot is pending and written on all processes, commit it.  wait for the write if block.
+	void try_commit(bool block) {
+		if (!::mxx::any_of(pending.valid(), comm)) return;
+
+		bool ready = !pending.valid() || block ||
+				(pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		if (!::mxx::all_of(ready, comm)) return;
+
+		bool ok = true;
+		if (pending.valid()) {
+			try {
+				pending.get();
+			} catch (::bliss::io::IOException const & e) {
+				BL_WARNINGF("build_checkpointer: %s", e.what());
+				ok = false;
+			}
+		}
+		if (::mxx::all_of(ok, comm)) {
+			++sequence;
+			if (comm.rank() == 0) write_meta();
+		}
+		comm.barrier();
+	}
+
+	/// copy the local map and start writing it in the background.
+	void start_snapshot(size_t const & consumed) {
+		typedef typename MapType::local_snapshot snapshot_type;
+		std::shared_ptr<snapshot_type> snap = std::make_shared<snapshot_type>(map.snapshot_local(slot_name(slot, comm.rank())));
+		pending = std::async(std::launch::async, [snap](){ snap->write(); });
+
+		pending_bytes = ::mxx::gather(static_cast<uint64_t>(consumed), 0, comm);
+		pending_slot = slot;
+		slot = 1 - slot;
+		last = std::chrono::steady_clock::now();
+	}
+
+public:
+	build_checkpointer(MapType & _map, const mxx::comm & _comm, checkpoint_config const & _config, std::string const & filename) :
+		map(_map), comm(_comm), config(_config), file_size(0), slot(0), sequence(0), pending_slot(0),
+		last(std::chrono::steady_clock::now()) {
+		struct stat st;
+		if (stat(filename.c_str(), &st) == 0) file_size = st.st_size;
+	}
+
+	/// wait for the pending write, if any, without committing it.
+	virtual ~build_checkpointer() {
+		if (pending.valid()) pending.wait();
+	}
+
+	/// number of committed checkpoints of the build, including those before a resume.
+	uint64_t get_checkpoints() const { return sequence; }
+
+	/**
+	 * @brief load the map of the last committed checkpoint, if config.resume and there is one for this build.
+	 * @return the bytes of this process's partition that are in the map.  0 to start over, with the map unchanged.
+	 */
+	size_t resume() {
+		if (!config.resume) return 0;
+
+		// the meta file is small, so all processes read it.
+		meta_header header = meta_header();
+		std::vector<uint64_t> bytes;
+		if (!::mxx::all_of(read_meta(header, bytes), comm)) return 0;
+
+		bool ok = true;
+		try {
+			map.load_local(slot_name(header.slot, comm.rank()));
+		} catch (::bliss::io::IOException const & e) {
+			BL_WARNINGF("build_checkpointer: %s", e.what());
+			ok = false;
+		}
+		if (!::mxx::all_of(ok, comm)) {
+			if (comm.rank() == 0) BL_WARNINGF("build_checkpointer: %s has missing or invalid snapshots.  starting over.", meta_name().c_str());
+			map.clear();
+			return 0;
+		}
+
+		slot = 1 - header.slot;
+		sequence = header.sequence;
+		return bytes[comm.rank()];
+	}
+
+	/**
+	 * @brief call after each batch is inserted.  commits a finished snapshot, and starts one if the interval has passed.
+	 * @param consumed   bytes of this process's partition in the map.
+	 */
+	void step(size_t const & consumed) {
+		try_commit(false);
+
+		bool due = (comm.rank() == 0) &&
+				(std::chrono::duration<double>(std::chrono::steady_clock::now() - last).count() >= config.interval);
+		if (::mxx::any_of(due, comm) && !::mxx::any_of(pending.valid(), comm)) start_snapshot(consumed);
+	}
+
+	/// at the end of the build:  remove the checkpoint files, or save the completed map as the last checkpoint.
+	void finish(size_t const & consumed) {
+		try_commit(true);
+
+		if (config.remove_at_end) {
+			if (comm.rank() == 0) remove(meta_name().c_str());
+			comm.barrier();
+			remove(slot_name(0, comm.rank()).c_str());
+			remove(slot_name(1, comm.rank()).c_str());
+		} else {
+			start_snapshot(consumed);
+			try_commit(true);
+		}
+	}
+};
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_BUILD_CHECKPOINT_HPP
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    colored_index.hpp
+ * @ingroup index
+ * @brief   sample aware (colored) kmer index:  1 distributed map holds each kmer once, with its per sample counts or presence.
+ * @details  the mapped value is a fixed size per sample record, either sample_counts (a saturating count per sample) or
+ *          sample_set (1 bit per sample, for presence only).  the map is a reduction map whose reduction is the value's
+ *          operator+, i.e. element wise add or bitwise or, so inserting (kmer, value of 1 sample) merges the samples.
+ *
+ *          the index is built from a list of (file, sample id) pairs.  each file is streamed in blocks, and its kmers are
+ *          inserted tagged with the sample, so only 1 block of kmers is in memory.  a find returns all samples of a kmer
+ *          in 1 lookup.  memory is (kmer + value) per unique kmer, e.g. 8 + 16 bytes for presence of 128 samples,
+ *          instead of 1 map entry per sample per kmer.
+ */
+#ifndef BLISS_INDEX_COLORED_INDEX_HPP
+#define BLISS_INDEX_COLORED_INDEX_HPP
+
+#include <vector>
+#include <string>
+#include <utility>      // pair
+#include <limits>       // numeric_limits
+#include <algorithm>    // transform
+#include <stdexcept>    // invalid_argument
+#include <cstdint>
+#include <cctype>       // tolower
+
+#include <mxx/datatypes.hpp>
+
+#include "index/kmer_index.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/**
+ * @brief count of a kmer in each of SAMPLES samples.  operator+ adds per sample, saturating at the max of CountType.
+ */
+template <unsigned int SAMPLES, typename CountType = uint16_t>
+struct sample_counts {
+    static_assert(::std::is_unsigned<CountType>::value, "sample count type has to be unsigned");
+    static constexpr unsigned int num_samples = SAMPLES;
+
+    CountType counts[SAMPLES];
+
+    sample_counts() {
+      for (unsigned int i = 0; i < SAMPLES; ++i) counts[i] = 0;
+    }
+
+    /// 1 occurrence in sample s.
+    static sample_counts single(size_t const & s) {
+      sample_counts out;
+      out.counts[s] = 1;
+      return out;
+    }
+
+    CountType count(size_t const & s) const {
+      return counts[s];
+    }
+    bool contains(size_t const & s) const {
+      return counts[s] > 0;
+    }
+    /// number of samples with the kmer.
+    size_t samples() const {
+      size_t n = 0;
+      for (unsigned int i = 0; i < SAMPLES; ++i) n += (counts[i] > 0) ? 1 : 0;
+      return n;
+    }
+
+    sample_counts operator+(sample_counts const & other) const {
+      sample_counts out;
+      for (unsigned int i = 0; i < SAMPLES; ++i) {
+        out.counts[i] = (counts[i] > ::std::numeric_limits<CountType>::max() - other.counts[i]) ?
+            ::std::numeric_limits<CountType>::max() : static_cast<CountType>(counts[i] + other.counts[i]);
+      }
+      return out;
+    }
+
+    bool operator==(sample_counts const & other) const {
+      for (unsigned int i = 0; i < SAMPLES; ++i) {
+        if (counts[i] != other.counts[i]) return false;
+      }
+      return true;
+    }
+};
+
+/**
+ * @brief presence of a kmer in each of SAMPLES samples, 1 bit per sample.  operator+ is the union.
+ */
+template <unsigned int SAMPLES>
+struct sample_set {
+    static constexpr unsigned int num_samples = SAMPLES;
+    static constexpr unsigned int num_words = (SAMPLES + 63) / 64;
+
+    uint64_t words[num_words];
+
+    sample_set() {
+      for (unsigned int i = 0; i < num_words; ++i) words[i] = 0;
+    }
+
+    /// presence in sample s.
+    static sample_set single(size_t const & s) {
+      sample_set out;
+      out.words[s >> 6] = 1ULL << (s & 63);
+      return out;
+    }
+
+    size_t count(size_t const & s) const {
+      return contains(s) ? 1 : 0;
+    }
+    bool contains(size_t const & s) const {
+      return ((words[s >> 6] >> (s & 63)) & 1ULL) != 0;
+    }
+    /// number of samples with the kmer.
+    size_t samples() const {
+      size_t n = 0;
+      for (unsigned int i = 0; i < num_words; ++i) n += __builtin_popcountll(words[i]);
+      return n;
+    }
+
+    sample_set operator+(sample_set const & other) const {
+      sample_set out;
+      for (unsigned int i = 0; i < num_words; ++i) out.words[i] = words[i] | other.words[i];
+      return out;
+    }
+
+    bool operator==(sample_set const & other) const {
+      for (unsigned int i = 0; i < num_words; ++i) {
+        if (words[i] != other.words[i]) return false;
+      }
+      return true;
+    }
+};
+
+
+/**
+ * @brief kmer index over many samples.  find returns the per sample value of each kmer.
+ * @tparam MapType  reduction map with sample_counts or sample_set mapped type, e.g. ColoredCountMap or ColoredPresenceMap.
+ */
+template <typename MapType>
+class ColoredIndex : public Index<MapType, KmerParser<typename MapType::key_type> > {
+protected:
+	using BaseIndexType = Index<MapType, KmerParser<typename MapType::key_type> >;
+
+public:
+	using KmerType = typename BaseIndexType::KmerType;
+	using ValueType = typename BaseIndexType::ValueType;
+	using TupleType = typename BaseIndexType::TupleType;
+	using KmerParserType = typename BaseIndexType::KmerParserType;
+
+	static constexpr unsigned int num_samples = ValueType::num_samples;
+
+	ColoredIndex(const mxx::comm& _comm) : BaseIndexType(_comm) {}
+
+	virtual ~ColoredIndex() {};
+
+	/**
+	 * @brief  build the index from files tagged with sample ids.  files are read 1 block at a time.  collective.
+	 * @details  all processes read each file in turn.  a sample may have several files.
+	 * @param files        (filename, sample id) pairs.  sample ids are in [0, num_samples).  same on all processes.
+	 * @param comm         communicator
+	 * @param block_size   number of bytes to read per block.
+	 * @return             number of kmers read by the current process.
+	 */
+	template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	size_t build_samples(std::vector<std::pair<std::string, size_t> > const & files, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+
+		for (auto const & f : files) {
+			if (f.second >= num_samples) throw std::invalid_argument("sample id is larger than the number of samples of the index.");
+
+			std::string extension = ::bliss::utils::file::get_file_extension(f.first);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+				throw std::invalid_argument("input filename extension is not supported.");
+			}
+			if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+				throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+			} else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+				throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+			}
+		}
+
+	    BL_BENCH_INIT(build);
+
+		size_t total = 0;
+		std::vector<TupleType> tuples;
+		for (auto const & f : files) {
+	    BL_BENCH_START(build);
+			ValueType v = ValueType::single(f.second);
+			auto consumer = [this, &tuples, &v](::std::vector<KmerType> & batch) {
+				tuples.clear();
+				tuples.reserve(batch.size());
+				for (auto const & k : batch) tuples.emplace_back(k, v);
+				this->map.insert(tuples);  // COLLECTIVE CALL...
+			};
+			auto read = bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParserType, SeqParser, SeqIterType>(f.first, block_size, consumer, comm);
+			total += read.second;
+	    BL_BENCH_END(build, "read_insert", read.second);
+		}
+
+	    BL_BENCH_REPORT_MPI_NAMED(build, "index:build_samples", this->comm);
+		return total;
+	}
+
+	/// convenience function for building the index with posix file reads
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	size_t build_samples_posix(std::vector<std::pair<std::string, size_t> > const & files, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+		return this->template build_samples<::bliss::io::posix_file, SeqParser, SeqIterType>(files, comm, block_size);
+	}
+};
+
+/// canonical kmers, murmur hash.
+template <typename Key>
+using ColoredHashMapParams = CanonicalHashMapParams<Key>;
+
+/// per sample counts.
+template <typename Key, unsigned int SAMPLES, typename CountType = uint16_t,
+	template <typename> class MapParams = ColoredHashMapParams>
+using ColoredCountMap = ::dsc::reduction_unordered_map<Key, sample_counts<SAMPLES, CountType>, MapParams>;
+
+/// per sample presence.
+template <typename Key, unsigned int SAMPLES,
+	template <typename> class MapParams = ColoredHashMapParams>
+using ColoredPresenceMap = ::dsc::reduction_unordered_map<Key, sample_set<SAMPLES>, MapParams>;
+
+} /* namespace kmer */
+} /* namespace index */
+} /* namespace bliss */
+
+
+namespace mxx {
+
+  template<unsigned int SAMPLES, typename CountType>
+    struct datatype_builder<bliss::index::kmer::sample_counts<SAMPLES, CountType> > :
+    public datatype_contiguous<CountType, SAMPLES> {
+
+      typedef datatype_contiguous<CountType, SAMPLES> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<unsigned int SAMPLES>
+    struct datatype_builder<bliss::index::kmer::sample_set<SAMPLES> > :
+    public datatype_contiguous<uint64_t, bliss::index::kmer::sample_set<SAMPLES>::num_words> {
+
+      typedef datatype_contiguous<uint64_t, bliss::index::kmer::sample_set<SAMPLES>::num_words> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+}  // namespace mxx
+
+#endif // BLISS_INDEX_COLORED_INDEX_HPP
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    epoch_index.hpp
+ * @ingroup index
+ * @brief   epoch versioned hashed index, for queries interleaved with streaming inserts.
+ * @details  inserts go into a delta map.  commit seals the delta as epoch e:  its local container is copied out, and a
+ *          background thread merges it with the local container holding epochs 1..e-1 (the base) into a new base.  until
+ *          the merge is done, the sealed delta is queried as its own layer, and the finished base replaces both at the
+ *          next call.  the layers are immutable once sealed, so the merge needs no locks, and queries and inserts never
+ *          wait for it.  the merge is local:  the layers are copies of the delta's local containers, so a key is in
+ *          the same process in all of them.  each process publishes its merged base on its own, since the content of
+ *          base and sealed delta is the same as that of the merged base.
+ *
+ *          find and count distribute the queries once, and look them up in base, sealed delta and, if asked, in the
+ *          delta, combining the entries of a key from several layers with the Merge policy:
+ *            epoch_merge_all     keep all entries, for the multimaps.
+ *            epoch_merge_first   keep the entry of the oldest layer, for the unique key maps, as their insert does.
+ *            epoch_merge_reduce  reduce the values with Reduc, for the reduction and counting maps.
+ *
+ *          only for the hashed maps, whose local containers have equal_range and count.  a merge copies the base, so it
+ *          needs as much extra memory as the local base while it runs.
+ */
+#ifndef BLISS_INDEX_EPOCH_INDEX_HPP
+#define BLISS_INDEX_EPOCH_INDEX_HPP
+
+#include <vector>
+#include <memory>     // shared_ptr
+#include <future>
+#include <chrono>
+#include <utility>    // pair
+#include <algorithm>  // sort, unique
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// epoch_index merge policy of the multimaps:  a key's entries in all layers are kept.
+struct epoch_merge_all {
+	template <typename C>
+	static void merge(C & into, C const & from) {
+		into.insert(from.begin(), from.end());
+	}
+
+	template <typename C, typename K, typename V>
+	static void find(::std::vector<C const *> const & layers, K const & k, ::std::vector<::std::pair<K, V> > & out) {
+		for (C const * l : layers) {
+			auto range = l->equal_range(k);
+			for (auto it = range.first; it != range.second; ++it) out.emplace_back(it->first, it->second);
+		}
+	}
+
+	template <typename C, typename K>
+	static size_t count(::std::vector<C const *> const & layers, K const & k) {
+		size_t c = 0;
+		for (C const * l : layers) c += l->count(k);
+		return c;
+	}
+};
+
+/// epoch_index merge policy of the unique key maps:  the entry inserted first, i.e. in the oldest layer, is kept.
+struct epoch_merge_first {
+	template <typename C>
+	static void merge(C & into, C const & from) {
+		into.insert(from.begin(), from.end());  // does not replace existing keys.
+	}
+
+	template <typename C, typename K, typename V>
+	static void find(::std::vector<C const *> const & layers, K const & k, ::std::vector<::std::pair<K, V> > & out) {
+		for (C const * l : layers) {
+			auto range = l->equal_range(k);
+			if (range.first == range.second) continue;
+			out.emplace_back(range.first->first, range.first->second);
+			return;
+		}
+	}
+
+	template <typename C, typename K>
+	static size_t count(::std::vector<C const *> const & layers, K const & k) {
+		for (C const * l : layers) {
+			if (l->count(k) > 0) return 1;
+		}
+		return 0;
+	}
+};
+
+/// epoch_index merge policy of the reduction and counting maps:  the values of a key in all layers are reduced.
+template <typename Reduc>
+struct epoch_merge_reduce {
+	template <typename C>
+	static void merge(C & into, C const & from) {
+		Reduc r;
+		for (auto it = from.begin(); it != from.end(); ++it) {
+			auto res = into.insert(::std::make_pair(it->first, it->second));
+			if (!res.second) res.first->second = r(res.first->second, it->second);
+		}
+	}
+
+	template <typename C, typename K, typename V>
+	static void find(::std::vector<C const *> const & layers, K const & k, ::std::vector<::std::pair<K, V> > & out) {
+		Reduc r;
+		bool found = false;
+		for (C const * l : layers) {
+			auto range = l->equal_range(k);
+			if (range.first == range.second) continue;
+			if (found) out.back().second = r(out.back().second, range.first->second);
+			else out.emplace_back(range.first->first, range.first->second);
+			found = true;
+		}
+	}
+
+	template <typename C, typename K>
+	static size_t count(::std::vector<C const *> const & layers, K const & k) {
+		return epoch_merge_first::count(layers, k);
+	}
+};
+
+
+/**
+ * @brief hashed index with a delta layer for inserts and background merged epochs for queries.  see file description.
+ * @details  e.g. for an ingestion service:  insert each arriving batch, commit every few batches, and query at any time.
+ *        insert, commit, find and count are collective.  the delta map is accessible through get_delta(), e.g. to set its
+ *        distribution policy;  modifying it otherwise, or changing its bucket table after the first commit, is not supported.
+ * @tparam MapType  a hashed distributed map, e.g. ::dsc::counting_densehash_map.
+ * @tparam Merge    epoch_merge_all, epoch_merge_first, or epoch_merge_reduce<Reduc>, by the kind of MapType.
+ */
+template <typename MapType, typename Merge = epoch_merge_all>
+class epoch_index {
+public:
+	using KmerType = typename MapType::key_type;
+	using ValueType = typename MapType::mapped_type;
+	using TupleType = ::std::pair<KmerType, ValueType>;
+	using local_container_type = typename MapType::local_container_type;
+	using layer_ptr = ::std::shared_ptr<local_container_type const>;
+
+protected:
+	const mxx::comm & comm;
+
+	/// receives the inserts of the current epoch.
+	MapType delta;
+
+	/// epochs 1..merged_epoch, and the sealed delta of epoch sealed_epoch while it is merged.  replaced, never modified.
+	mutable layer_ptr base;
+	mutable layer_ptr sealed;
+	/// the next base, from the background merge.
+	mutable ::std::future<layer_ptr> merging;
+
+	/// number of commits.
+	size_t epoch;
+	mutable size_t merged_epoch;
+	size_t sealed_epoch;
+
+	struct KeyToRank {
+		MapType const & map;
+		KeyToRank(MapType const & _map) : map(_map) {}
+		inline int operator()(KmerType const & k) const {
+			return map.owner(k);
+		}
+	};
+
+	/// the layers to query, oldest first.
+	::std::vector<local_container_type const *> layers(bool const & with_delta) const {
+		::std::vector<local_container_type const *> out;
+		if (base) out.emplace_back(base.get());
+		if (sealed) out.emplace_back(sealed.get());
+		if (with_delta) out.emplace_back(&(delta.get_local_container()));
+		return out;
+	}
+
+	/**
+	 * @brief distribute the unique input transformed queries once, look them up in the layers at the owners with
+	 *        lookup(layers, key, results), and send the results back.  collective.
+	 */
+	template <typename R, typename Lookup>
+	::std::vector<R> layered_query(::std::vector<KmerType> & query, bool const & with_delta, Lookup const & lookup,
+			char const * name) const {
+		BL_BENCH_INIT(epoch);
+
+		BL_BENCH_START(epoch);
+		this->poll();
+		delta.transform_input(query);
+		::std::sort(query.begin(), query.end());
+		query.erase(::std::unique(query.begin(), query.end()), query.end());
+		BL_BENCH_END(epoch, "unique", query.size());
+
+		int const p = comm.size();
+		::std::vector<size_t> recv_counts;
+		if (p > 1) {
+			BL_BENCH_COLLECTIVE_START(epoch, "dist_query", comm);
+			::std::vector<size_t> i2o;
+			::std::vector<KmerType> buffer;
+			::imxx::distribute(query, KeyToRank(delta), recv_counts, i2o, buffer, comm);
+			query.swap(buffer);
+			BL_BENCH_END(epoch, "dist_query", query.size());
+		} else {
+			recv_counts.assign(1, query.size());
+		}
+		if (recv_counts.empty()) recv_counts.assign(p, 0);  // no queries on any process.
+
+		BL_BENCH_START(epoch);
+		::std::vector<local_container_type const *> ls = this->layers(with_delta);
+		::std::vector<R> results;
+		results.reserve(query.size());
+		::std::vector<size_t> send_counts(p, 0);
+		size_t before;
+		auto it = query.begin();
+		for (int r = 0; r < p; ++r) {
+			before = results.size();
+			for (auto end = it + recv_counts[r]; it != end; ++it) lookup(ls, *it, results);
+			send_counts[r] = results.size() - before;
+		}
+		BL_BENCH_END(epoch, "local_lookup", results.size());
+
+		if (p > 1) {
+			BL_BENCH_COLLECTIVE_START(epoch, "a2a2", comm);
+			mxx::all2allv(results, send_counts, comm).swap(results);
+			BL_BENCH_END(epoch, "a2a2", results.size());
+		}
+
+		BL_BENCH_REPORT_MPI_NAMED(epoch, name, comm);
+		return results;
+	}
+
+	/// merge sealed into a copy of base.  runs on the background thread, and only reads the shared layers.
+	static layer_ptr merge_layers(layer_ptr b, layer_ptr s) {
+		if (!b) return ::std::make_shared<local_container_type>(*s);
+		::std::shared_ptr<local_container_type> next = ::std::make_shared<local_container_type>(*b);
+		Merge::merge(*next, *s);
+		return next;
+	}
+
+public:
+	epoch_index(const mxx::comm & _comm) : comm(_comm), delta(_comm), epoch(0), merged_epoch(0), sealed_epoch(0) {}
+
+	virtual ~epoch_index() {
+		if (merging.valid()) merging.wait();
+	}
+
+	MapType & get_delta() {
+		return delta;
+	}
+	MapType const & get_delta() const {
+		return delta;
+	}
+
+	/// number of commits.  queries see epochs 1..get_epoch(), and the delta if asked.
+	size_t get_epoch() const {
+		return epoch;
+	}
+	/// number of epochs merged into the local base.  per process.
+	size_t get_merged_epoch() const {
+		this->poll();
+		return merged_epoch;
+	}
+
+	/// insert into the delta, as MapType::insert.  does not wait for a merge.  collective.
+	template <typename T>
+	void insert(::std::vector<T> & input) {
+		this->poll();
+		delta.insert(input);
+	}
+
+	/**
+	 * @brief seal the delta as the next epoch and start merging it into the base in the background.  collective.
+	 * @details  waits for the merge of the previous epoch, if it is still running, so there is at most 1 sealed delta.
+	 * @return  the new epoch.
+	 */
+	size_t commit() {
+		this->wait();
+
+		++epoch;
+		if (delta.get_local_container().size() > 0) {
+			sealed = ::std::make_shared<local_container_type>(delta.get_local_container());
+			sealed_epoch = epoch;
+			merging = ::std::async(::std::launch::async, &epoch_index::merge_layers, base, sealed);
+		} else {
+			merged_epoch = epoch;  // nothing to merge here.
+		}
+		delta.clear();
+
+		return epoch;
+	}
+
+	/// publish the merged base if its merge is done.  does not block.  local.  called by the other methods.
+	/// @return  true if no merge is running.
+	bool poll() const {
+		if (!merging.valid()) return true;
+		if (merging.wait_for(::std::chrono::seconds(0)) != ::std::future_status::ready) return false;
+		base = merging.get();  // rethrows an exception of the merge.
+		sealed.reset();
+		merged_epoch = sealed_epoch;
+		return true;
+	}
+
+	/// block until the running merge, if any, is published.  local.
+	void wait() const {
+		if (merging.valid()) merging.wait();
+		this->poll();
+	}
+
+	/**
+	 * @brief the (kmer, value) entries of the query kmers in the committed epochs, and in the delta if with_delta.  collective.
+	 * @details  entries of a kmer from several layers are combined by the Merge policy.
+	 * @param query   input transformed, made unique, and distributed.
+	 */
+	::std::vector<TupleType> find(::std::vector<KmerType> & query, bool with_delta = false) const {
+		return this->template layered_query<TupleType>(query, with_delta,
+				[](::std::vector<local_container_type const *> const & ls, KmerType const & k, ::std::vector<TupleType> & out) {
+					Merge::find(ls, k, out);
+				}, "epoch_index:find");
+	}
+
+	/**
+	 * @brief (kmer, count) of each unique query kmer in the committed epochs, and in the delta if with_delta.  collective.
+	 * @details  the count is the number of entries the kmer has after merging, i.e. 0 or 1 for the unique and reduction maps.
+	 * @param query   input transformed, made unique, and distributed.
+	 */
+	::std::vector<::std::pair<KmerType, size_t> > count(::std::vector<KmerType> & query, bool with_delta = false) const {
+		return this->template layered_query<::std::pair<KmerType, size_t> >(query, with_delta,
+				[](::std::vector<local_container_type const *> const & ls, KmerType const & k,
+						::std::vector<::std::pair<KmerType, size_t> > & out) {
+					out.emplace_back(k, Merge::count(ls, k));
+				}, "epoch_index:count");
+	}
+};
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_EPOCH_INDEX_HPP
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_client.hpp
+ * @ingroup index
+ * @brief   client of the node local index daemon (index_daemon.hpp), for processes that are not part of the MPI job.
+ * @details  the client connects to the daemon of its node by a unix domain stream socket, in the abstract namespace,
+ *          named by the daemon.  it creates a shared memory payload region (an unlinked file in /dev/shm), and passes
+ *          its descriptor to the daemon with send_fd, so that query keys and results are not copied through the
+ *          socket.  each request is a small header on the socket:  the keys are written to the region, the daemon
+ *          answers in the region, and replies with the result count.  results larger than the region follow the reply
+ *          on the socket instead.  requests on 1 connection are served in order, 1 at a time.
+ *
+ *          keys and results are copied as bytes, as in the MPI exchanges, so client and daemon have to be built with
+ *          the same k-mer and value types.  the client makes no MPI calls.
+ */
+#ifndef BLISS_INDEX_INDEX_CLIENT_HPP
+#define BLISS_INDEX_INDEX_CLIENT_HPP
+
+#include <vector>
+#include <string>
+#include <utility>    // pair
+#include <cstdint>
+#include <cstdlib>    // mkstemp
+#include <cstring>    // memcpy
+#include <cerrno>
+#include <sstream>  // for unix_domain_socket.h
+#include <cassert>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "io/io_exception.hpp"
+#include "io/unix_domain_socket.h"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+namespace daemon
+{
+  static constexpr uint32_t magic = 0xB1155DAE;
+
+  /// request operations.
+  enum op : uint32_t { COUNT = 1, FIND = 2, CLOSE = 3, SHUTDOWN = 4 };
+  /// reply status.
+  enum status : uint32_t { OK = 0, IN_STREAM = 1, TOO_LARGE = 2, BAD_REQUEST = 3 };
+
+  struct request_header {
+      uint32_t magic;
+      uint32_t op;
+      uint64_t count;
+  };
+
+  struct reply_header {
+      uint32_t magic;
+      uint32_t status;
+      uint64_t count;
+  };
+
+  /// abstract socket name of the daemon called name.
+  inline std::string socket_name(std::string const & name) {
+    return std::string("#BLISS_IDX_") + name;
+  }
+
+  /// send or receive exactly bytes.  false if the peer closed or on error.
+  inline bool send_all(int const & fd, void const * data, size_t bytes) {
+    char const * ptr = reinterpret_cast<char const *>(data);
+    while (bytes > 0) {
+      ssize_t sent = ::send(fd, ptr, bytes, MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent <= 0) return false;
+      ptr += sent;
+      bytes -= sent;
+    }
+    return true;
+  }
+
+  inline bool recv_all(int const & fd, void * data, size_t bytes) {
+    char * ptr = reinterpret_cast<char *>(data);
+    while (bytes > 0) {
+      ssize_t recvd = ::recv(fd, ptr, bytes, 0);
+      if (recvd < 0 && errno == EINTR) continue;
+      if (recvd <= 0) return false;
+      ptr += recvd;
+      bytes -= recvd;
+    }
+    return true;
+  }
+} // namespace daemon
+
+
+/**
+ * @brief  connection to the index daemon of this node.  not thread safe; use 1 per thread.
+ * @tparam KmerType     key type of the index.
+ * @tparam FindValue    element of find results, e.g. std::pair<KmerType, position>.
+ * @tparam CountValue   element of count results, e.g. std::pair<KmerType, count>.
+ */
+template <typename KmerType, typename FindValue, typename CountValue>
+class index_client {
+  protected:
+    int sock;
+    int shm_fd;
+    void * region;
+    size_t region_bytes;
+
+    /// send a request whose keys are in the region, and receive its results.
+    template <typename V>
+    std::vector<V> query(uint32_t const & op, std::vector<KmerType> const & keys) {
+      std::vector<V> results;
+      size_t max_keys = region_bytes / sizeof(KmerType);
+
+      // batches of at most a region of keys.
+      for (size_t first = 0; first < keys.size() || (first == 0); first += max_keys) {
+        size_t n = std::min(max_keys, keys.size() - first);
+        if (n > 0) memcpy(region, keys.data() + first, n * sizeof(KmerType));
+
+        daemon::request_header req = { daemon::magic, op, n };
+        daemon::reply_header rep;
+        if (!daemon::send_all(sock, &req, sizeof(req)) || !daemon::recv_all(sock, &rep, sizeof(rep)) ||
+            (rep.magic != daemon::magic))
+          throw ::bliss::io::IOException("ERROR: index daemon connection lost");
+        if (rep.status != daemon::OK && rep.status != daemon::IN_STREAM)
+          throw ::bliss::io::IOException("ERROR: index daemon rejected the request");
+
+        size_t offset = results.size();
+        results.resize(offset + rep.count);
+        if (rep.status == daemon::OK) {
+          if (rep.count > 0) memcpy(static_cast<void *>(results.data() + offset), region, rep.count * sizeof(V));
+        } else if (!daemon::recv_all(sock, results.data() + offset, rep.count * sizeof(V))) {
+          throw ::bliss::io::IOException("ERROR: index daemon connection lost");
+        }
+        if (keys.size() == 0) break;
+      }
+      return results;
+    }
+
+  public:
+    /**
+     * @param name          daemon name, as given to index_daemon.
+     * @param _region_bytes size of the shared payload region.  batches larger than this are split.
+     */
+    index_client(std::string const & name, size_t const & _region_bytes = (1UL << 24)) :
+      sock(-1), shm_fd(-1), region(nullptr), region_bytes(std::max(_region_bytes, sizeof(KmerType) + sizeof(FindValue) + sizeof(CountValue))) {
+
+      // payload region, unlinked so it goes away with the last mapping.
+      char tmpl[] = "/dev/shm/bliss_idx_XXXXXX";
+      shm_fd = mkstemp(tmpl);
+      if (shm_fd < 0) {
+        char tmpl2[] = "/tmp/bliss_idx_XXXXXX";
+        shm_fd = mkstemp(tmpl2);
+        if (shm_fd >= 0) unlink(tmpl2);
+      } else {
+        unlink(tmpl);
+      }
+      if (shm_fd < 0) throw ::bliss::io::IOException("ERROR: unable to create index client payload region");
+      if (ftruncate(shm_fd, region_bytes) != 0) {
+        close(shm_fd);
+        throw ::bliss::io::IOException("ERROR: unable to size index client payload region");
+      }
+      region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+      if (region == MAP_FAILED) {
+        close(shm_fd);
+        throw ::bliss::io::IOException("ERROR: unable to map index client payload region");
+      }
+
+      // connect, and hand over the region.
+      socklen_t address_length;
+      struct sockaddr_un address = ::bliss::io::util::make_address(daemon::socket_name(name), address_length);
+      sock = socket(AF_UNIX, SOCK_STREAM, 0);
+      uint64_t bytes = region_bytes;
+      if ((sock < 0) ||
+          (connect(sock, (const struct sockaddr *) &address, address_length) < 0) ||
+          (::bliss::io::util::send_fd(sock, shm_fd) < 0) ||
+          !daemon::send_all(sock, &bytes, sizeof(bytes))) {
+        if (sock >= 0) close(sock);
+        munmap(region, region_bytes);
+        close(shm_fd);
+        throw ::bliss::io::IOException("ERROR: unable to connect to index daemon " + name);
+      }
+    }
+
+    index_client(index_client const & other) = delete;
+    index_client & operator=(index_client const & other) = delete;
+
+    ~index_client() {
+      if (sock >= 0) {
+        daemon::request_header req = { daemon::magic, daemon::CLOSE, 0 };
+        daemon::send_all(sock, &req, sizeof(req));
+        close(sock);
+      }
+      if (region != nullptr) munmap(region, region_bytes);
+      if (shm_fd >= 0) close(shm_fd);
+    }
+
+    /// (key, count) for each key, in order, including 0 counts.  keys are transformed by the index, e.g. to canonical.
+    std::vector<CountValue> count(std::vector<KmerType> const & keys) {
+      return query<CountValue>(daemon::COUNT, keys);
+    }
+
+    /// entries of the keys.
+    std::vector<FindValue> find(std::vector<KmerType> const & keys) {
+      return query<FindValue>(daemon::FIND, keys);
+    }
+
+    /// stop the daemon of this node.  the connection is closed.
+    void shutdown() {
+      daemon::request_header req = { daemon::magic, daemon::SHUTDOWN, 0 };
+      daemon::send_all(sock, &req, sizeof(req));
+      close(sock);
+      sock = -1;
+    }
+};
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_INDEX_CLIENT_HPP
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_daemon.hpp
+ * @ingroup index
+ * @brief   serves the queries of local, non MPI, processes against a distributed index held by a running MPI job.
+ * @details  the lowest rank of each node listens on a unix domain stream socket (abstract namespace, see index_client.hpp)
+ *          and serves each connected client on its own thread.  a client hands over a shared memory payload region
+ *          once, at connect, with the fd passing of unix_domain_socket.h.  each request is forwarded to the query_server
+ *          of the index, so that requests of all clients on all nodes are batched into the same collective find and
+ *          count rounds, and the answer is written back to the client's region.
+ *
+ *          the query_server's run() loop is the job's main loop:
+ *
+ *              query_server<IndexType> server(index, comm);
+ *              index_daemon<IndexType> daemon(server, comm, "my_index");
+ *              server.run();     // returns once the daemons of all nodes are shut down.
+ *
+ *          ranks without a listener stop their query_server at once, and only take part in the rounds.  a daemon is
+ *          shut down by a client's shutdown(), or by stop().  a client is served until it disconnects or the daemon stops.
+ *          only clients of the same user as the daemon are served (SO_PEERCRED), and a payload region larger than its
+ *          shared memory object is rejected.
+ */
+#ifndef BLISS_INDEX_INDEX_DAEMON_HPP
+#define BLISS_INDEX_INDEX_DAEMON_HPP
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstring>    // memcpy
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>   // fstat
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+
+#include "index/query_server.hpp"
+#include "index/index_client.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/**
+ * @brief node local front end of a query_server, for clients connected by unix domain sockets.
+ * @tparam IndexType    as for query_server.
+ */
+template <typename IndexType>
+class index_daemon {
+  public:
+    using server_type = query_server<IndexType>;
+    using KmerType = typename server_type::KmerType;
+    using find_value_type = typename server_type::find_result_type::value_type;
+    using count_value_type = typename server_type::count_result_type::value_type;
+
+  protected:
+    server_type & server;
+    std::string name;
+    bool listening;
+    int listen_fd;
+
+    std::atomic<bool> stopping;
+    std::thread acceptor;
+    std::mutex mtx;
+    std::vector<std::thread> handlers;
+    std::vector<int> client_fds;
+
+    /// write results to the region, or after the reply if they do not fit.
+    template <typename V>
+    static bool reply(int const & fd, void * region, size_t const & region_bytes, std::vector<V> const & results) {
+      daemon::reply_header rep = { daemon::magic, daemon::OK, results.size() };
+      size_t bytes = results.size() * sizeof(V);
+      if (bytes <= region_bytes) {
+        if (bytes > 0) memcpy(region, results.data(), bytes);
+        return daemon::send_all(fd, &rep, sizeof(rep));
+      }
+      rep.status = daemon::IN_STREAM;
+      return daemon::send_all(fd, &rep, sizeof(rep)) && daemon::send_all(fd, results.data(), bytes);
+    }
+
+    /// whether the peer of fd runs as the same user as this process.
+    static bool same_user(int const & fd) {
+#if defined(SO_PEERCRED)
+      struct ucred cred;
+      socklen_t len = sizeof(cred);
+      return (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) && (cred.uid == getuid());
+#else
+      return false;
+#endif
+    }
+
+    /// serve 1 client until it closes, or the daemon stops.
+    void handle(int fd) {
+      if (!same_user(fd)) {
+        ::shutdown(fd, SHUT_RDWR);
+        return;
+      }
+
+      int shm_fd = ::bliss::io::util::recv_fd(fd);
+      uint64_t region_bytes = 0;
+      void * region = MAP_FAILED;
+      struct stat st;
+      // the region has to be within the shared memory object, else an access past its end faults the daemon.
+      if ((shm_fd >= 0) && daemon::recv_all(fd, &region_bytes, sizeof(region_bytes)) && (region_bytes > 0) &&
+          (fstat(shm_fd, &st) == 0) && (st.st_size > 0) && (region_bytes <= static_cast<uint64_t>(st.st_size)))
+        region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+
+      daemon::request_header req;
+      while ((region != MAP_FAILED) && !stopping.load() && daemon::recv_all(fd, &req, sizeof(req))) {
+        daemon::reply_header rep = { daemon::magic, daemon::BAD_REQUEST, 0 };
+        if (req.magic != daemon::magic) {
+          daemon::send_all(fd, &rep, sizeof(rep));
+          break;
+        }
+        if (req.op == daemon::CLOSE) break;
+        if (req.op == daemon::SHUTDOWN) {
+          stopping.store(true);
+          break;
+        }
+        if ((req.op != daemon::COUNT) && (req.op != daemon::FIND)) {
+          if (!daemon::send_all(fd, &rep, sizeof(rep))) break;
+          continue;
+        }
+        if (req.count > region_bytes / sizeof(KmerType)) {
+          rep.status = daemon::TOO_LARGE;
+          if (!daemon::send_all(fd, &rep, sizeof(rep))) break;
+          continue;
+        }
+
+        KmerType const * keys = reinterpret_cast<KmerType const *>(region);
+        std::vector<KmerType> query(keys, keys + req.count);
+        bool ok;
+        if (req.op == daemon::COUNT) {
+          ok = reply(fd, region, region_bytes, server.count(std::move(query)).get());
+        } else {
+          ok = reply(fd, region, region_bytes, server.find(std::move(query)).get());
+        }
+        if (!ok) break;
+      }
+
+      if (region != MAP_FAILED) munmap(region, region_bytes);
+      if (shm_fd >= 0) close(shm_fd);
+    }
+
+    /// accept clients until stopped, then close them and stop the query server.
+    void accept_loop() {
+      struct pollfd pfd;
+      pfd.fd = listen_fd;
+      pfd.events = POLLIN;
+      while (!stopping.load()) {
+        if (poll(&pfd, 1, 10) <= 0) continue;
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        client_fds.push_back(fd);
+        handlers.emplace_back(&index_daemon::handle, this, fd);
+      }
+
+      close(listen_fd);
+      listen_fd = -1;
+      {
+        // unblock the handlers waiting on their clients.
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int fd : client_fds) ::shutdown(fd, SHUT_RDWR);
+      }
+      for (auto & t : handlers) t.join();
+      for (int fd : client_fds) close(fd);
+      handlers.clear();
+      client_fds.clear();
+
+      server.stop();
+    }
+
+  public:
+    /**
+     * @brief  start listening on the lowest rank of each node.  collective.
+     * @param _name   daemon name, for index_client.  the same on all nodes; sockets are per node.
+     */
+    index_daemon(server_type & _server, mxx::comm const & comm, std::string const & _name) :
+      server(_server), name(_name), listening(false), listen_fd(-1), stopping(false) {
+
+      MPI_Comm shared;
+      MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.rank(), MPI_INFO_NULL, &shared);
+      int local_rank;
+      MPI_Comm_rank(shared, &local_rank);
+      MPI_Comm_free(&shared);
+
+      if (local_rank != 0) {
+        server.stop();
+        return;
+      }
+
+      socklen_t address_length;
+      struct sockaddr_un address = ::bliss::io::util::make_address(daemon::socket_name(name), address_length);
+      listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if ((listen_fd < 0) ||
+          (bind(listen_fd, (const struct sockaddr *) &address, address_length) < 0) ||
+          (listen(listen_fd, 64) < 0)) {
+        if (listen_fd >= 0) close(listen_fd);
+        throw ::bliss::io::IOException("ERROR: unable to listen as index daemon " + name);
+      }
+      listening = true;
+      acceptor = std::thread(&index_daemon::accept_loop, this);
+    }
+
+    index_daemon(index_daemon const & other) = delete;
+    index_daemon & operator=(index_daemon const & other) = delete;
+
+    virtual ~index_daemon() {
+      stop();
+    }
+
+    /// whether this rank listens for clients.
+    bool is_listening() const { return listening; }
+
+    /// stop serving clients on this node, and stop the query server of this rank.  thread safe.  clients see a closed connection.
+    void stop() {
+      stopping.store(true);
+      if (acceptor.joinable() && (acceptor.get_id() != std::this_thread::get_id())) acceptor.join();
+    }
+};
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_INDEX_DAEMON_HPP
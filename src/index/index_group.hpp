@@ -0,0 +1,344 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_group.hpp
+ * @ingroup index
+ * @brief   co-partitioned indices over the same kmers, e.g. a count and a position index, queried together in 1 exchange.
+ * @details  the maps of the member indices have the same input transform, distribution transform and hash, and bucket
+ *          table, so each kmer has the same owner in all of them.  a group query is sent to the owners once, in 1
+ *          distribute.  each owner looks the received kmers up in the local containers of all members, and the results of
+ *          all members for a process go back in 1 message, with 1 segment per member whose sizes are exchanged in place
+ *          of the message sizes, as in build_multi_k.  so a query of N indices takes 1 round trip instead of N.
+ *
+ *          only for the hashed maps.  the members answer from their maps:  frozen layouts, query caches, and the heavy
+ *          keys of the multimaps (find_heavy_hitters) are not used, so the members should not have heavy keys.
+ */
+#ifndef BLISS_INDEX_INDEX_GROUP_HPP
+#define BLISS_INDEX_INDEX_GROUP_HPP
+
+#include <vector>
+#include <tuple>
+#include <utility>      // pair
+#include <algorithm>    // sort, unique
+#include <numeric>      // accumulate
+#include <type_traits>
+#include <stdexcept>    // invalid_argument
+#include <cstring>      // memcpy
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "index/kmer_index.hpp"
+#include "io/incremental_mxx.hpp"
+#include "utils/integer_sequence.hpp"
+#include "utils/benchmark_utils.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// true if all the maps assign each key to a process the same way, given the same bucket table.
+template <typename... Maps>
+struct same_distribution : public ::std::true_type {};
+template <typename P, typename Q, typename... Maps>
+struct same_distribution<P, Q, Maps...> :
+  public ::std::integral_constant<bool,
+    ::std::is_same<typename P::key_type, typename Q::key_type>::value &&
+    ::std::is_same<typename P::input_transform_type, typename Q::input_transform_type>::value &&
+    ::std::is_same<typename P::distribution_function_type, typename Q::distribution_function_type>::value &&
+    same_distribution<Q, Maps...>::value> {};
+
+/**
+ * @brief results of the members of an index_group, for the queries received by the owner, grouped by source process.
+ *        1 part per member, in a recursive list.
+ * @tparam Count   true for (kmer, count) results, false for the (kmer, value) entries.
+ */
+template <bool Count, typename... Indices>
+struct index_group_parts {
+	template <typename Key>
+	size_t lookup(Key const *, size_t const *, int const &) { return 0; }
+	void segments(int const &, size_t *, size_t &) const {}
+	static void bytes(size_t const *, size_t &) {}
+	void pack(int const &, size_t *, char *&) const {}
+	void clear() {}
+	void unpack(size_t const *, char const *&) {}
+	template <typename Tuple, size_t I>
+	void take(Tuple &, ::std::integral_constant<size_t, I> const &) {}
+};
+template <bool Count, typename IndexType, typename... Indices>
+struct index_group_parts<Count, IndexType, Indices...> {
+	using map_type = typename ::std::remove_reference<decltype(::std::declval<IndexType const &>().get_map())>::type;
+	using key_type = typename map_type::key_type;
+	using value_type = ::std::pair<key_type,
+			typename ::std::conditional<Count, size_t, typename map_type::mapped_type>::type>;
+
+	::std::vector<value_type> entries;
+	/// number of entries for each process.
+	::std::vector<size_t> counts;
+	index_group_parts<Count, Indices...> rest;
+
+	/// count of 1 key.
+	template <typename DB>
+	static void append(DB const & db, key_type const & k, ::std::vector<value_type> & out, ::std::true_type const &) {
+		out.emplace_back(k, db.count(k));
+	}
+	/// entries of 1 key.
+	template <typename DB>
+	static void append(DB const & db, key_type const & k, ::std::vector<value_type> & out, ::std::false_type const &) {
+		auto range = db.equal_range(k);
+		for (auto it = range.first; it != range.second; ++it) out.emplace_back(it->first, it->second);
+	}
+
+	/// look up the received keys, recv_counts[r] from process r in order, in the local container of each member.
+	size_t lookup(key_type const * keys, size_t const * recv_counts, int const & p,
+			IndexType const & index, Indices const &... indices) {
+		auto const & db = index.get_map().get_local_container();
+		entries.clear();
+		counts.assign(p, 0);
+		size_t before;
+		key_type const * it = keys;
+		for (int r = 0; r < p; ++r) {
+			before = entries.size();
+			for (key_type const * end = it + recv_counts[r]; it != end; ++it) {
+				append(db, *it, entries, ::std::integral_constant<bool, Count>());
+			}
+			counts[r] = entries.size() - before;
+		}
+		return entries.size() + rest.lookup(keys, recv_counts, p, indices...);
+	}
+
+	/// segment sizes of the message to rank r, 1 per member, and the message bytes.
+	void segments(int const & r, size_t * seg, size_t & bytes) const {
+		*seg = counts[r];
+		bytes += counts[r] * sizeof(value_type);
+		rest.segments(r, seg + 1, bytes);
+	}
+
+	/// bytes of a message with seg entries per member.
+	static void bytes(size_t const * seg, size_t & bytes) {
+		bytes += *seg * sizeof(value_type);
+		index_group_parts<Count, Indices...>::bytes(seg + 1, bytes);
+	}
+
+	/// copy the segments of rank r to out, and advance out.  starts are the first entries for rank r, 1 per member.
+	void pack(int const & r, size_t * starts, char *& out) const {
+		size_t bytes = counts[r] * sizeof(value_type);
+		memcpy(out, entries.data() + *starts, bytes);
+		out += bytes;
+		*starts += counts[r];
+		rest.pack(r, starts + 1, out);
+	}
+
+	void clear() {
+		entries.clear();
+		rest.clear();
+	}
+
+	/// append the received segments of 1 source, with seg entries per member.
+	void unpack(size_t const * seg, char const *& in) {
+		size_t before = entries.size();
+		entries.resize(before + *seg);
+		memcpy(entries.data() + before, in, *seg * sizeof(value_type));
+		in += *seg * sizeof(value_type);
+		rest.unpack(seg + 1, in);
+	}
+
+	/// move the entries to the I-th element of out and on.
+	template <typename Tuple, size_t I>
+	void take(Tuple & out, ::std::integral_constant<size_t, I> const &) {
+		::std::get<I>(out).swap(entries);
+		::std::vector<value_type>().swap(entries);
+		rest.take(out, ::std::integral_constant<size_t, I + 1>());
+	}
+};
+
+
+/**
+ * @brief co-partitioned indices over the same kmers, answering find and count for all members in 1 exchange.  see file description.
+ * @details  the group keeps references to the members, which have to outlive it.  the members are built and modified as
+ *        usual, e.g. with build_indices or build_multi_k.  the bucket tables are checked at construction, so set_bucket_table
+ *        of a member afterwards needs a new group.
+ * @tparam Indices    Index types over hashed maps with the same key type, input transform, and distribution function.
+ */
+template <typename... Indices>
+class index_group {
+	static_assert(sizeof...(Indices) > 0, "index_group needs at least 1 index");
+
+public:
+	using first_index_type = typename ::std::tuple_element<0, ::std::tuple<Indices...> >::type;
+	using KmerType = typename first_index_type::KmerType;
+
+	static_assert(same_distribution<typename ::std::remove_reference<decltype(::std::declval<Indices const &>().get_map())>::type...>::value,
+			"index_group members need the same key type, input transform and distribution function");
+
+	/// (kmer, value) entries of each member, and (kmer, count) of each member.
+	using find_result_type = ::std::tuple<::std::vector<typename index_group_parts<false, Indices>::value_type>...>;
+	using count_result_type = ::std::tuple<::std::vector<typename index_group_parts<true, Indices>::value_type>...>;
+
+protected:
+	::std::tuple<Indices const &...> members;
+
+	const mxx::comm & comm;
+
+	/// owner of a key in all members.
+	struct KeyToRank {
+		first_index_type const & index;
+		KeyToRank(first_index_type const & _index) : index(_index) {}
+		inline int operator()(KmerType const & k) const {
+			return index.get_map().owner(k);
+		}
+	};
+
+	/// true if all bucket tables are the same as the first.
+	template <typename Index>
+	bool check_tables(Index const & index) const {
+		return std::get<0>(members).get_map().get_bucket_table() == index.get_map().get_bucket_table();
+	}
+
+	/// transform the queries with the members' input transform, and remove duplicates.  local.
+	void prepare(::std::vector<KmerType> & query) const {
+		std::get<0>(members).get_map().transform_input(query);
+		::std::sort(query.begin(), query.end());
+		query.erase(::std::unique(query.begin(), query.end()), query.end());
+	}
+
+	/**
+	 * @brief distribute the queries once, look them up in all members at the owners, and send the results back in 1
+	 *        all2allv.  collective.
+	 */
+	template <bool Count, typename Result>
+	void group_query(::std::vector<KmerType> & query, Result & results, char const * name) const {
+		BL_BENCH_INIT(group);
+
+		BL_BENCH_START(group);
+		this->prepare(query);
+		BL_BENCH_END(group, "unique", query.size());
+
+		constexpr size_t nk = sizeof...(Indices);
+		int const p = comm.size();
+		index_group_parts<Count, Indices...> parts;
+
+		std::vector<size_t> recv_counts;
+		if (p > 1) {
+			BL_BENCH_COLLECTIVE_START(group, "dist_query", comm);
+			std::vector<size_t> i2o;
+			std::vector<KmerType> buffer;
+			::imxx::distribute(query, KeyToRank(std::get<0>(members)), recv_counts, i2o, buffer, comm);
+			query.swap(buffer);
+			BL_BENCH_END(group, "dist_query", query.size());
+		} else {
+			recv_counts.assign(1, query.size());
+		}
+		if (recv_counts.empty()) recv_counts.assign(p, 0);  // no queries on any process.
+
+		BL_BENCH_START(group);
+		size_t total = this->lookup(parts, query, recv_counts, typename ::bliss::utils::make_index_sequence<nk>::type());
+		BL_BENCH_END(group, "local_lookup", total);
+
+		if (p > 1) {
+			// segment sizes, by destination then member.
+			BL_BENCH_START(group);
+			std::vector<size_t> segments(nk * p);
+			std::vector<size_t> send_bytes(p, 0);
+			for (int r = 0; r < p; ++r) parts.segments(r, segments.data() + nk * r, send_bytes[r]);
+			std::vector<char> sendbuf(std::accumulate(send_bytes.begin(), send_bytes.end(), static_cast<size_t>(0)));
+			{
+				char * out = sendbuf.data();
+				std::vector<size_t> starts(nk, 0);
+				for (int r = 0; r < p; ++r) parts.pack(r, starts.data(), out);
+			}
+			parts.clear();
+			BL_BENCH_END(group, "pack_results", sendbuf.size());
+
+			BL_BENCH_COLLECTIVE_START(group, "a2a_results", comm);
+			std::vector<size_t> recv_segments(nk * p);
+			::mxx::all2all(segments.data(), nk, recv_segments.data(), comm);
+			std::vector<size_t> recv_bytes(p, 0);
+			for (int r = 0; r < p; ++r) index_group_parts<Count, Indices...>::bytes(recv_segments.data() + nk * r, recv_bytes[r]);
+			std::vector<char> recvbuf(std::accumulate(recv_bytes.begin(), recv_bytes.end(), static_cast<size_t>(0)));
+			::mxx::all2allv(sendbuf.data(), send_bytes, recvbuf.data(), recv_bytes, comm);
+			std::vector<char>().swap(sendbuf);
+			BL_BENCH_END(group, "a2a_results", recvbuf.size());
+
+			BL_BENCH_START(group);
+			char const * in = recvbuf.data();
+			for (int r = 0; r < p; ++r) parts.unpack(recv_segments.data() + nk * r, in);
+			BL_BENCH_END(group, "unpack", recvbuf.size());
+		}
+
+		parts.take(results, ::std::integral_constant<size_t, 0>());
+
+		BL_BENCH_REPORT_MPI_NAMED(group, name, comm);
+	}
+
+	template <bool Count, size_t... I>
+	size_t lookup(index_group_parts<Count, Indices...> & parts, ::std::vector<KmerType> const & keys,
+			::std::vector<size_t> const & recv_counts, ::bliss::utils::index_sequence<I...> const &) const {
+		return parts.lookup(keys.data(), recv_counts.data(), comm.size(), std::get<I>(members)...);
+	}
+
+public:
+	/// group the indices.  checks that their bucket tables are the same.  not collective.
+	index_group(const mxx::comm & _comm, Indices const &... indices) : members(indices...), comm(_comm) {
+		bool same[] = {true, this->check_tables(indices)...};
+		for (bool s : same) {
+			if (!s) throw ::std::invalid_argument("index_group: the members have different bucket tables.");
+		}
+	}
+
+	virtual ~index_group() {}
+
+	/// number of members.
+	static constexpr size_t size() { return sizeof...(Indices); }
+
+	/**
+	 * @brief the (kmer, value) entries of the query kmers in each member, as each member's find.  collective.
+	 * @param query   input transformed, made unique, and distributed.
+	 * @return  1 vector per member, in member order.  the order of the entries within a vector is unspecified.
+	 */
+	find_result_type find(::std::vector<KmerType> & query) const {
+		find_result_type results;
+		this->template group_query<false>(query, results, "index_group:find");
+		return results;
+	}
+
+	/**
+	 * @brief (kmer, count) of each unique query kmer in each member, as each member's count.  collective.
+	 * @param query   input transformed, made unique, and distributed.
+	 * @return  1 vector per member, in member order, each with all unique query kmers.
+	 */
+	count_result_type count(::std::vector<KmerType> & query) const {
+		count_result_type results;
+		this->template group_query<true>(query, results, "index_group:count");
+		return results;
+	}
+};
+
+/// group indices without naming their types, e.g. auto group = make_index_group(comm, count_index, position_index).
+template <typename... Indices>
+index_group<Indices...> make_index_group(const mxx::comm & comm, Indices const &... indices) {
+	return index_group<Indices...>(comm, indices...);
+}
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_INDEX_GROUP_HPP
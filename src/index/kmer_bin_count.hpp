@@ -0,0 +1,222 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_bin_count.hpp
+ * @ingroup bliss::index
+ * @brief   disk binned kmer counting, for a single node or a few processes.
+ * @details  pass 1 packs the kmers of each read into super-kmers, binned by their minimizer, and appends them to 1 spill
+ *          file per bin on local disk.  pass 2 counts 1 bin at a time on each process:  the bin's super-kmers from all
+ *          processes are gathered, unpacked, canonicalized and sort counted (radix sort with OpenMP threads).  memory is
+ *          bounded by the size of a bin, about the packed input divided by the number of bins, not by the kmer set.
+ *
+ *          the bin of a kmer is a function of its canonical minimizer, so a kmer and its reverse complement are in the
+ *          same bin and each kmer is counted in exactly 1 bin.  the counts are (kmer, count) pairs, as produced by
+ *          KmerCountTupleParser and reduced by the counting maps.
+ */
+#ifndef KMER_BIN_COUNT_HPP_
+#define KMER_BIN_COUNT_HPP_
+
+#include <vector>
+#include <string>
+#include <utility>     // pair
+#include <functional>  // equal_to
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
+#include "common/superkmer.hpp"
+#include "utils/transform_utils.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "containers/batch_count.hpp"
+#include "io/spill_buckets.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/kmer_parser.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/**
+ * @brief 2 pass kmer counter with minimizer bins on local disk.
+ * @tparam Transform  canonicalization applied before counting, e.g. lex_less, or identity for single strand counts.
+ * @tparam Minimizer  strand symmetric transform whose value selects the bin.
+ */
+template <typename KMER, typename T = uint32_t,
+		template <typename> class Transform = ::bliss::kmer::transform::lex_less,
+		typename Minimizer = ::bliss::kmer::transform::default_minimizer<KMER> >
+class bin_counter {
+	static_assert(::bliss::kmer::transform::is_strand_symmetric<Minimizer>::value,
+			"bin_counter needs a strand symmetric minimizer, so a kmer and its reverse complement share a bin.");
+
+public:
+	using kmer_type = KMER;
+	using count_type = T;
+	using value_type = ::std::pair<KMER, T>;
+
+protected:
+	const mxx::comm& comm;
+	Minimizer minimizer;
+	::bliss::io::spill_buckets<uint8_t> bins;
+	/// kmers added on this process.
+	size_t added;
+
+	// reused between calls to add.
+	std::vector<size_t> bin_ids;
+	std::vector<size_t> bin_bytes;
+	std::vector<uint8_t> packed;
+
+public:
+	/**
+	 * @param dir           directory for the bin files, node local.
+	 * @param nbins         number of bins on each process.  pass 2 holds about 1/nbins of the packed kmers of all processes.
+	 * @param buffer_bytes  write buffer per bin.
+	 */
+	bin_counter(const mxx::comm & _comm, std::string const & dir, size_t const & nbins = 512, size_t const & buffer_bytes = (1UL << 16)) :
+		comm(_comm), bins(dir, ::std::max(nbins, static_cast<size_t>(1)), buffer_bytes, _comm.rank()), added(0) {}
+
+	size_t bin_count() const {
+		return bins.bucket_count();
+	}
+
+	/// bin of a kmer, by its minimizer.
+	size_t bin_of(KMER const & x) const {
+		return static_cast<size_t>(Minimizer::order(*(minimizer(x).getData())) % bins.bucket_count());
+	}
+
+	/// bytes of bin b on this process.
+	size_t bin_size(size_t const & b) const {
+		return bins.size(b);
+	}
+
+	size_t local_added() const {
+		return added;
+	}
+
+	/**
+	 * @brief pass 1.  append kmers to their bins as super-kmers.  local.
+	 * @param kmers  not transformed, in sequence order, e.g. from KmerParser, so that consecutive kmers share a super-kmer.
+	 */
+	void add(std::vector<KMER> const & kmers) {
+		if (kmers.empty()) return;
+		bin_ids.resize(kmers.size());
+		for (size_t i = 0; i < kmers.size(); ++i) bin_ids[i] = bin_of(kmers[i]);
+
+		::bliss::kmer::superkmer::pack(kmers, bin_ids, static_cast<int>(bins.bucket_count()), bin_bytes, packed);
+		uint8_t const * start = packed.data();
+		for (size_t b = 0; b < bin_bytes.size(); ++b) {
+			if (bin_bytes[b] > 0) bins.append(b, start, bin_bytes[b]);
+			start += bin_bytes[b];
+		}
+		added += kmers.size();
+	}
+
+	/**
+	 * @brief pass 2.  count the bins, and pass the counts of each bin to consumer.  collective.
+	 * @details  in round r, process q counts bin r * p + q, receiving that bin from all processes.  the counts of
+	 *        a bin are sorted by transformed kmer, and no kmer appears in 2 calls.  the bins are removed as they are read.
+	 * @param consumer  called with std::vector<std::pair<KMER, T> >&, once per round, possibly with an empty vector.
+	 * @param nthreads  threads for the sort.  0 means omp_get_max_threads().
+	 * @return  number of distinct kmers counted on this process.
+	 */
+	template <typename Consumer>
+	size_t count(Consumer & consumer, int nthreads = 0) {
+		BL_BENCH_INIT(bin_count);
+
+		size_t nbins = bins.bucket_count();
+		size_t p = comm.size();
+		size_t distinct = 0;
+
+		std::vector<uint8_t> send;
+		std::vector<uint8_t> recv;
+		std::vector<size_t> send_counts(p, 0);
+		std::vector<KMER> kmers;
+		std::vector<value_type> counts;
+		Transform<KMER> trans;
+
+		for (size_t first = 0; first < nbins; first += p) {
+			BL_BENCH_START(bin_count);
+			send.clear();
+			for (size_t q = 0; q < p; ++q) {
+				send_counts[q] = (first + q < nbins) ? bins.size(first + q) : 0;
+				if (send_counts[q] > 0) bins.read(first + q, send);
+			}
+			if (p > 1) {
+				mxx::all2allv(send, send_counts, comm).swap(recv);
+			} else {
+				recv.swap(send);
+			}
+			::std::vector<uint8_t>().swap(send);
+			BL_BENCH_END(bin_count, "gather", recv.size());
+
+			BL_BENCH_START(bin_count);
+			kmers.clear();
+			::bliss::kmer::superkmer::unpack(recv.data(), recv.data() + recv.size(), kmers);
+			::std::vector<uint8_t>().swap(recv);
+			if (!::std::is_same<Transform<KMER>, ::bliss::transform::identity<KMER> >::value)
+				::std::transform(kmers.begin(), kmers.end(), kmers.begin(), trans);
+
+			counts.clear();
+			if (!kmers.empty())
+				::fsc::sort_count(kmers, counts, ::bliss::transform::identity<KMER>(), ::std::equal_to<KMER>(), nthreads);
+			distinct += counts.size();
+			BL_BENCH_END(bin_count, "count", counts.size());
+
+			consumer(counts);
+		}
+
+		BL_BENCH_REPORT_MPI_NAMED(bin_count, "bin_counter:count", comm);
+		return distinct;
+	}
+
+	/// pass 2, appending all counts of this process to results.  collective.
+	size_t count(std::vector<value_type> & results, int nthreads = 0) {
+		auto append = [&results](std::vector<value_type> & counts) {
+			results.insert(results.end(), counts.begin(), counts.end());
+		};
+		return this->count(append, nthreads);
+	}
+};
+
+
+/**
+ * @brief pass 1 for a FASTQ or FASTA file.  the file is read in blocks of block_size bytes.  collective.
+ * @return  number of kmers added on this process.
+ */
+template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+		typename Counter>
+size_t bin_file(const std::string & filename, Counter & counter, const mxx::comm & comm, size_t const & block_size = (1UL << 26)) {
+	auto consumer = [&counter](std::vector<typename Counter::kmer_type> & batch) {
+		counter.add(batch);
+	};
+	return ::bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParser<typename Counter::kmer_type>, SeqParser, SeqIterType>(
+			filename, block_size, consumer, comm).second;
+}
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* KMER_BIN_COUNT_HPP_ */
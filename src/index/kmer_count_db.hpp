@@ -0,0 +1,673 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_count_db.hpp
+ * @ingroup index
+ * @brief   collective import and export of count indices as Jellyfish and KMC binary count databases.
+ * @details the records of both formats have fixed size, so each process reads an even range of records with
+ *          MPI_File_read_at_all, decodes the (kmer, count) tuples that KmerCountTupleParser would produce, and inserts
+ *          them with Index::insert, 1 chunk per round.  the map reduces the counts, so a canonical index loaded from a
+ *          single strand database gets the sum of both strands.  exports write chunks with MPI_File_write_at_all at
+ *          offsets from an exscan, as export_text.
+ *
+ *          supported subsets, for 2 bit alphabets (A, C, G, T = 0..3, as in DNA and RNA):
+ *
+ *          Jellyfish 2 binary ("binary/sorted"):  9 decimal digits of header length, a JSON header, then records of
+ *            ceil(key_len / 8) bytes of kmer, little endian with the last base in the low bits, and counter_len bytes
+ *            of count, little endian.  import needs key_len == 2k and counter_len.  the export is in scan order, or
+ *            in kmer order with sorted, not in Jellyfish's hash order, so it has no "matrix":  jellyfish dump and histo
+ *            read it, jellyfish query does not.
+ *
+ *          KMC 1 (database version 0):  <prefix>.kmc_pre has "KMCP", a lookup table of 4^lut_prefix_length uint64
+ *            start indices plus the total, the header, the header size, and "KMCP".  <prefix>.kmc_suf has "KMCS", the
+ *            kmers sorted, each as (k - lut_prefix_length) / 4 bytes of suffix, big endian, and counter_size bytes of
+ *            count, little endian, then "KMCS".  the export sorts globally with mxx::sort.  KMC 2 databases
+ *            (version 0x200, with signature bins) and quality counters (mode 1) are rejected.
+ */
+#ifndef BLISS_INDEX_KMER_COUNT_DB_HPP
+#define BLISS_INDEX_KMER_COUNT_DB_HPP
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <algorithm>    // min, max, upper_bound
+#include <iterator>
+#include <functional>   // plus
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>      // memcpy, memcmp
+#include <cstdlib>      // strtoull
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+#include <mxx/sort.hpp>
+
+#include "io/io_exception.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// parameters of a count database.
+struct count_db_info {
+    /// kmer length
+    unsigned int k;
+    /// bytes per count
+    size_t counter_bytes;
+    /// kmers are canonical, i.e. counted on both strands.
+    bool canonical;
+    /// number of (kmer, count) records in the database.
+    size_t entries;
+
+    count_db_info() : k(0), counter_bytes(0), canonical(false), entries(0) {}
+};
+
+
+namespace detail {
+
+  inline void throw_db_error(::std::string const & filename, ::std::string const & msg) {
+    ::std::stringstream ss;
+    ss << "ERROR : bliss::index::kmer count database [" << filename << "] " << msg;
+    throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+  }
+
+  inline void put_le(uint8_t * out, uint64_t v, size_t const & bytes) {
+    for (size_t i = 0; i < bytes; ++i, v >>= 8) out[i] = static_cast<uint8_t>(v);
+  }
+
+  inline uint64_t get_le(uint8_t const * in, size_t const & bytes) {
+    uint64_t v = 0;
+    for (size_t i = bytes; i > 0; --i) v = (v << 8) | in[i - 1];
+    return v;
+  }
+
+  /// bytes needed for x, at least 1.
+  inline size_t bytes_for(uint64_t x) {
+    size_t n = 1;
+    while ((n < 8) && ((x >> (8 * n)) > 0)) ++n;
+    return n;
+  }
+
+  /// kmer as the little endian bytes of its 2k bit value.  the last character is in the low bits.
+  template <typename KmerType>
+  struct kmer_bytes {
+      static_assert(KmerType::bitsPerChar == 2, "count databases need a 2 bit alphabet, e.g. DNA.");
+      using WordType = typename KmerType::KmerWordType;
+
+      static constexpr size_t bits = 2 * KmerType::size;
+      static constexpr size_t bytes = (bits + 7) / 8;
+
+      static inline void store(KmerType const & km, uint8_t * out) {
+        for (size_t j = 0; j < bytes; ++j)
+          out[j] = static_cast<uint8_t>(km.getData()[j / sizeof(WordType)] >> (8 * (j % sizeof(WordType))));
+      }
+
+      static inline KmerType load(uint8_t const * in) {
+        KmerType km;  // cleared
+        auto & data = km.getDataRef();
+        for (size_t j = 0; j < bytes; ++j) {
+          uint8_t b = in[j];
+          if ((j == bytes - 1) && ((bits % 8) != 0)) b &= static_cast<uint8_t>((1U << (bits % 8)) - 1);
+          data[j / sizeof(WordType)] |= static_cast<WordType>(static_cast<WordType>(b) << (8 * (j % sizeof(WordType))));
+        }
+        return km;
+      }
+  };
+
+  template <typename V>
+  inline V saturate(uint64_t const & c) {
+    return (c > static_cast<uint64_t>(::std::numeric_limits<V>::max())) ? ::std::numeric_limits<V>::max() : static_cast<V>(c);
+  }
+
+
+  /// collective MPI-IO on 1 file:  reads at given offsets, writes appended in rank order.
+  class db_file {
+      ::mxx::comm const & comm;
+      ::std::string filename;
+      MPI_File fh;
+      MPI_Offset offset;
+      int res;
+
+      void throw_io_error(int const & code) const {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(code, msg, &len);
+
+        ::std::stringstream ss;
+        ss << "rank " << comm.rank() << " " << ::std::string(msg, len);
+        throw_db_error(filename, ss.str());
+      }
+
+    public:
+      db_file(::std::string const & _filename, ::mxx::comm const & _comm, bool const & writing) :
+        comm(_comm), filename(_filename), offset(0) {
+        res = MPI_File_open(comm, const_cast<char *>(filename.c_str()),
+                            writing ? (MPI_MODE_CREATE | MPI_MODE_WRONLY) : MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) throw_io_error((res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+        // truncate any existing file.
+        if (writing) res = MPI_File_set_size(fh, 0);
+      }
+
+      size_t file_size() const {
+        MPI_Offset s = 0;
+        MPI_File_get_size(fh, &s);
+        return static_cast<size_t>(s);
+      }
+
+      /// read bytes at pos into buf.  collective.
+      void read(size_t const & pos, uint8_t * buf, size_t const & bytes) {
+        MPI_Status stat;
+        int r_res = MPI_File_read_at_all(fh, static_cast<MPI_Offset>(pos), buf, static_cast<int>(bytes), MPI_BYTE, &stat);
+        if (res == MPI_SUCCESS) res = r_res;
+      }
+
+      /// write the buffers of all processes, in rank order, after the previous ones.  collective.
+      void write(::std::vector<uint8_t> const & buf, size_t const & bytes) {
+        size_t prefix = ::mxx::exscan(bytes, comm);
+        if (comm.rank() == 0) prefix = 0;
+        size_t total = ::mxx::allreduce(bytes, comm);
+
+        MPI_Status stat;
+        int w_res = MPI_File_write_at_all(fh, offset + static_cast<MPI_Offset>(prefix), const_cast<uint8_t *>(buf.data()),
+                                          static_cast<int>(bytes), MPI_BYTE, &stat);
+        if (res == MPI_SUCCESS) res = w_res;
+        offset += static_cast<MPI_Offset>(total);
+      }
+
+      /// close, and throw on all processes if any read or write failed.  collective.
+      void close() {
+        int c_res = MPI_File_close(&fh);
+        if (res == MPI_SUCCESS) res = c_res;
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) throw_io_error((res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+      }
+
+      size_t size() const { return static_cast<size_t>(offset); }
+  };
+
+
+  /// raw value of a top level field of a flat JSON object, e.g. 62, true, or "binary/sorted" without quotes.  empty if absent.
+  inline ::std::string json_field(::std::string const & json, ::std::string const & key) {
+    ::std::string quoted = "\"" + key + "\"";
+    size_t p = json.find(quoted);
+    if (p == ::std::string::npos) return ::std::string();
+    p = json.find(':', p + quoted.size());
+    if (p == ::std::string::npos) return ::std::string();
+    p = json.find_first_not_of(" \t\r\n", p + 1);
+    if (p == ::std::string::npos) return ::std::string();
+    if (json[p] == '"') {
+      size_t e = json.find('"', p + 1);
+      return (e == ::std::string::npos) ? ::std::string() : json.substr(p + 1, e - p - 1);
+    }
+    size_t e = json.find_first_of(",} \t\r\n", p);
+    return json.substr(p, (e == ::std::string::npos) ? ::std::string::npos : e - p);
+  }
+
+  /// each process's even share [first, last) of n records.
+  inline ::std::pair<size_t, size_t> record_range(size_t const & n, ::mxx::comm const & comm) {
+    size_t p = static_cast<size_t>(comm.size()), r = static_cast<size_t>(comm.rank());
+    return ::std::make_pair(n / p * r + ::std::min(r, n % p), n / p * (r + 1) + ::std::min(r + 1, n % p));
+  }
+
+  /// the entries of an index, via the scan, globally sorted by kmer with mxx::sort.
+  template <typename IndexType>
+  ::std::vector<::std::pair<typename IndexType::KmerType, typename IndexType::ValueType> >
+  sorted_entries(IndexType const & index, size_t const & chunk, ::mxx::comm const & comm) {
+    using Entry = ::std::pair<typename IndexType::KmerType, typename IndexType::ValueType>;
+    ::std::vector<Entry> entries;
+    auto cursor = index.scan(chunk);
+    while (cursor.next()) {
+      auto const & c = cursor.chunk();
+      for (size_t i = 0; i < c.size(); ++i) entries.emplace_back(c.key(i), c.value(i));
+    }
+    ::mxx::sort(entries.begin(), entries.end(),
+                [](Entry const & x, Entry const & y) { return x.first < y.first; }, comm);
+    return entries;
+  }
+
+} // namespace detail
+
+
+//================= Jellyfish
+
+/// read the header of a Jellyfish binary database.  data_offset is set to the first record.  local.
+inline count_db_info read_jellyfish_header(::std::string const & filename, size_t & data_offset) {
+  ::std::ifstream ifs(filename, ::std::ios::binary);
+  if (!ifs) detail::throw_db_error(filename, "cannot open.");
+
+  char digits[10] = {0};
+  ifs.read(digits, 9);
+  if (ifs.gcount() != 9) detail::throw_db_error(filename, "no Jellyfish header.");
+  char * end = nullptr;
+  size_t len = strtoull(digits, &end, 10);
+  if (end != digits + 9) detail::throw_db_error(filename, "no Jellyfish header length.");
+
+  ::std::string json(len, ' ');
+  ifs.read(&(json[0]), len);
+  if (static_cast<size_t>(ifs.gcount()) != len) detail::throw_db_error(filename, "truncated Jellyfish header.");
+
+  if (detail::json_field(json, "format") != "binary/sorted")
+    detail::throw_db_error(filename, "Jellyfish format is not binary/sorted: " + detail::json_field(json, "format"));
+  ::std::string key_len = detail::json_field(json, "key_len");
+  ::std::string counter_len = detail::json_field(json, "counter_len");
+  if (key_len.empty() || counter_len.empty()) detail::throw_db_error(filename, "Jellyfish header without key_len or counter_len.");
+
+  count_db_info info;
+  size_t key_bits = strtoull(key_len.c_str(), nullptr, 10);
+  info.k = static_cast<unsigned int>(key_bits / 2);
+  info.counter_bytes = strtoull(counter_len.c_str(), nullptr, 10);
+  info.canonical = (detail::json_field(json, "canonical") == "true");
+  if ((key_bits % 2) != 0 || (info.counter_bytes == 0) || (info.counter_bytes > 8))
+    detail::throw_db_error(filename, "unsupported Jellyfish key_len or counter_len.");
+
+  ifs.seekg(0, ::std::ios::end);
+  size_t file_size = static_cast<size_t>(ifs.tellg());
+  data_offset = 9 + len;
+  size_t record = (key_bits + 7) / 8 + info.counter_bytes;
+  info.entries = (file_size - ::std::min(file_size, data_offset)) / record;
+  return info;
+}
+
+/**
+ * @brief insert the (kmer, count) records of a Jellyfish binary database into a count index.  collective.
+ * @details each process reads an even range of records.  key_len has to be 2k of the index's kmer type.
+ * @param chunk_size  records read per process per round.
+ * @return  parameters of the database.
+ */
+template <typename IndexType>
+count_db_info import_jellyfish(IndexType & index, ::std::string const & filename, ::mxx::comm const & comm,
+                               size_t const & chunk_size = (1UL << 20)) {
+  using KmerType = typename IndexType::KmerType;
+  using ValueType = typename IndexType::ValueType;
+  using Bytes = detail::kmer_bytes<KmerType>;
+  static_assert(::std::is_integral<ValueType>::value, "count database import needs integer values, e.g. counts.");
+
+  BL_BENCH_INIT(import_jellyfish);
+
+  BL_BENCH_START(import_jellyfish);
+  size_t data_offset = 0;
+  count_db_info info = read_jellyfish_header(filename, data_offset);
+  if (info.k != KmerType::size) {
+    ::std::stringstream ss;
+    ss << "Jellyfish k = " << info.k << ", index k = " << KmerType::size;
+    detail::throw_db_error(filename, ss.str());
+  }
+  size_t record = Bytes::bytes + info.counter_bytes;
+  size_t chunk = ::std::max(static_cast<size_t>(1), ::std::min(chunk_size, (1UL << 30) / record));
+  ::std::pair<size_t, size_t> range = detail::record_range(info.entries, comm);
+  BL_BENCH_END(import_jellyfish, "header", info.entries);
+
+  BL_BENCH_START(import_jellyfish);
+  detail::db_file file(filename, comm, false);
+  ::std::vector<uint8_t> buf(::std::min(chunk, range.second - range.first) * record);
+  ::std::vector<::std::pair<KmerType, ValueType> > tuples;
+  tuples.reserve(buf.size() / record);
+
+  size_t rounds = ::mxx::allreduce((range.second - range.first + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+  for (size_t r = 0, pos = range.first; r < rounds; ++r) {
+    size_t n = ::std::min(chunk, range.second - pos);
+    file.read(data_offset + pos * record, buf.data(), n * record);
+
+    tuples.clear();
+    for (uint8_t const * p = buf.data(); p < buf.data() + n * record; p += record)
+      tuples.emplace_back(Bytes::load(p), detail::saturate<ValueType>(detail::get_le(p + Bytes::bytes, info.counter_bytes)));
+    index.insert(tuples);  // collective
+    pos += n;
+  }
+  file.close();
+  BL_BENCH_END(import_jellyfish, "read_insert", range.second - range.first);
+
+  BL_BENCH_REPORT_MPI_NAMED(import_jellyfish, "index:import_jellyfish", comm);
+  return info;
+}
+
+/**
+ * @brief write the (kmer, count) entries of a count index as a Jellyfish binary database.  collective.
+ * @details counter_len is the size of the index's count type.
+ * @param canonical   recorded in the header.  true if the index counts canonical kmers.
+ * @param sorted      globally sort by kmer first, with mxx::sort.  otherwise the records are in the order of the scan.
+ * @param chunk_size  entries written per process per collective write.
+ * @return  size of the file.
+ */
+template <typename IndexType>
+size_t export_jellyfish(IndexType const & index, ::std::string const & filename, ::mxx::comm const & comm,
+                        bool const & canonical, bool const & sorted = false, size_t const & chunk_size = (1UL << 20)) {
+  using KmerType = typename IndexType::KmerType;
+  using ValueType = typename IndexType::ValueType;
+  using Bytes = detail::kmer_bytes<KmerType>;
+  static_assert(::std::is_integral<ValueType>::value, "count database export needs integer values, e.g. counts.");
+
+  constexpr size_t counter_len = (sizeof(ValueType) < 8) ? sizeof(ValueType) : 8;
+  constexpr size_t record = Bytes::bytes + counter_len;
+  size_t chunk = ::std::max(static_cast<size_t>(1), ::std::min(chunk_size, (1UL << 30) / record));
+  ::std::vector<uint8_t> buf(chunk * record);
+
+  BL_BENCH_INIT(export_jellyfish);
+
+  BL_BENCH_START(export_jellyfish);
+  detail::db_file file(filename, comm, true);
+
+  // header, padded with spaces so that the records start 8 byte aligned.
+  {
+    ::std::stringstream ss;
+    ss << "{\"alignment\":8,\"canonical\":" << (canonical ? "true" : "false") << ",\"counter_len\":" << counter_len
+       << ",\"format\":\"binary/sorted\",\"key_len\":" << Bytes::bits << ",\"val_len\":" << (8 * counter_len) << "}";
+    ::std::string json = ss.str();
+    json.append((8 - (9 + json.size()) % 8) % 8, ' ');
+    ss.str(::std::string());
+    ss.width(9);
+    ss.fill('0');
+    ss << json.size();
+    ::std::string header = ss.str() + json;
+
+    size_t bytes = (comm.rank() == 0) ? header.size() : 0;
+    if (buf.size() < header.size()) buf.resize(header.size());
+    memcpy(buf.data(), header.data(), bytes);
+    file.write(buf, bytes);
+  }
+  BL_BENCH_END(export_jellyfish, "header", 1);
+
+  size_t local_count = 0;
+  if (sorted) {
+    BL_BENCH_COLLECTIVE_START(export_jellyfish, "sort", comm);
+    auto entries = detail::sorted_entries(index, chunk, comm);
+    BL_BENCH_COLLECTIVE_END(export_jellyfish, "sort", entries.size(), comm);
+
+    BL_BENCH_START(export_jellyfish);
+    size_t rounds = ::mxx::allreduce((entries.size() + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+    size_t pos = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+      size_t n = ::std::min(chunk, entries.size() - pos);
+      uint8_t * p = buf.data();
+      for (size_t i = pos; i < pos + n; ++i, p += record) {
+        Bytes::store(entries[i].first, p);
+        detail::put_le(p + Bytes::bytes, static_cast<uint64_t>(entries[i].second), counter_len);
+      }
+      file.write(buf, n * record);
+      pos += n;
+    }
+    local_count = entries.size();
+  } else {
+    auto cursor = index.scan(chunk);
+    while (cursor.next()) {
+      auto const & c = cursor.chunk();
+      uint8_t * p = buf.data();
+      for (size_t i = 0; i < c.size(); ++i, p += record) {
+        Bytes::store(c.key(i), p);
+        detail::put_le(p + Bytes::bytes, static_cast<uint64_t>(c.value(i)), counter_len);
+      }
+      file.write(buf, c.size() * record);
+    }
+    local_count = cursor.local_scanned();
+  }
+
+  file.close();
+  BL_BENCH_END(export_jellyfish, "write", local_count);
+
+  BL_BENCH_REPORT_MPI_NAMED(export_jellyfish, "index:export_jellyfish", comm);
+  return file.size();
+}
+
+
+//================= KMC
+
+/// parameters of a KMC 1 database, from <prefix>.kmc_pre.  local.
+struct kmc_db_info : public count_db_info {
+    unsigned int lut_prefix_length;
+    /// start index of the kmers of each prefix, 4^lut_prefix_length entries.
+    ::std::vector<uint64_t> lut;
+
+    kmc_db_info() : count_db_info(), lut_prefix_length(0) {}
+
+    size_t suffix_bytes() const { return (k - lut_prefix_length) / 4; }
+};
+
+/// read <prefix>.kmc_pre of a KMC 1 database.  local.
+inline kmc_db_info read_kmc_header(::std::string const & prefix) {
+  ::std::string filename = prefix + ".kmc_pre";
+  ::std::ifstream ifs(filename, ::std::ios::binary);
+  if (!ifs) detail::throw_db_error(filename, "cannot open.");
+  ::std::vector<uint8_t> pre((::std::istreambuf_iterator<char>(ifs)), ::std::istreambuf_iterator<char>());
+
+  if ((pre.size() < 16) || (memcmp(pre.data(), "KMCP", 4) != 0) || (memcmp(pre.data() + pre.size() - 4, "KMCP", 4) != 0))
+    detail::throw_db_error(filename, "no KMCP markers.");
+  uint32_t version = static_cast<uint32_t>(detail::get_le(pre.data() + pre.size() - 12, 4));
+  if (version != 0) detail::throw_db_error(filename, "only KMC 1 databases (version 0) are supported.");
+  size_t header_offset = detail::get_le(pre.data() + pre.size() - 8, 4);
+  if ((header_offset < 33) || (header_offset + 16 > pre.size())) detail::throw_db_error(filename, "bad KMC header offset.");
+
+  uint8_t const * h = pre.data() + pre.size() - 8 - header_offset;
+  kmc_db_info info;
+  info.k = static_cast<unsigned int>(detail::get_le(h, 4));
+  uint32_t mode = static_cast<uint32_t>(detail::get_le(h + 4, 4));
+  info.counter_bytes = detail::get_le(h + 8, 4);
+  info.lut_prefix_length = static_cast<unsigned int>(detail::get_le(h + 12, 4));
+  // min_count at 16, max_count at 20.
+  info.entries = detail::get_le(h + 24, 8);
+  info.canonical = (h[32] == 0);
+
+  if (mode != 0) detail::throw_db_error(filename, "only KMC counter mode 0 is supported.");
+  if ((info.counter_bytes == 0) || (info.counter_bytes > 8) || (info.lut_prefix_length > info.k) ||
+      (((info.k - info.lut_prefix_length) % 4) != 0) || (info.lut_prefix_length > 16))
+    detail::throw_db_error(filename, "unsupported KMC counter size or lut prefix length.");
+
+  size_t lut_size = 1UL << (2 * info.lut_prefix_length);
+  if (4 + lut_size * sizeof(uint64_t) > pre.size() - 8 - header_offset)
+    detail::throw_db_error(filename, "truncated KMC lookup table.");
+  info.lut.resize(lut_size);
+  for (size_t i = 0; i < lut_size; ++i) info.lut[i] = detail::get_le(pre.data() + 4 + i * sizeof(uint64_t), 8);
+
+  return info;
+}
+
+/**
+ * @brief insert the (kmer, count) records of a KMC 1 database, <prefix>.kmc_pre and <prefix>.kmc_suf, into a count index.  collective.
+ * @details each process reads an even range of suffix records, and gets their prefixes from the lookup table.
+ * @param chunk_size  records read per process per round.
+ * @return  parameters of the database.
+ */
+template <typename IndexType>
+count_db_info import_kmc(IndexType & index, ::std::string const & prefix, ::mxx::comm const & comm,
+                         size_t const & chunk_size = (1UL << 20)) {
+  using KmerType = typename IndexType::KmerType;
+  using ValueType = typename IndexType::ValueType;
+  using Bytes = detail::kmer_bytes<KmerType>;
+  static_assert(::std::is_integral<ValueType>::value, "count database import needs integer values, e.g. counts.");
+
+  BL_BENCH_INIT(import_kmc);
+
+  BL_BENCH_START(import_kmc);
+  kmc_db_info info = read_kmc_header(prefix);
+  ::std::string filename = prefix + ".kmc_suf";
+  if (info.k != KmerType::size) {
+    ::std::stringstream ss;
+    ss << "KMC k = " << info.k << ", index k = " << KmerType::size;
+    detail::throw_db_error(filename, ss.str());
+  }
+  size_t sbytes = info.suffix_bytes();
+  size_t record = sbytes + info.counter_bytes;
+  size_t chunk = ::std::max(static_cast<size_t>(1), ::std::min(chunk_size, (1UL << 30) / ::std::max(record, static_cast<size_t>(1))));
+  ::std::pair<size_t, size_t> range = detail::record_range(info.entries, comm);
+  BL_BENCH_END(import_kmc, "header", info.entries);
+
+  BL_BENCH_START(import_kmc);
+  detail::db_file file(filename, comm, false);
+  if (!::mxx::all_of(file.file_size() == 8 + info.entries * record, comm)) {
+    file.close();
+    detail::throw_db_error(filename, "size does not match the KMC header.");
+  }
+
+  ::std::vector<uint8_t> buf(::std::min(chunk, range.second - range.first) * record);
+  ::std::vector<::std::pair<KmerType, ValueType> > tuples;
+  tuples.reserve(buf.size() / ::std::max(record, static_cast<size_t>(1)));
+  uint8_t kbytes[Bytes::bytes + 8];
+
+  // prefix of the first record:  the last prefix that starts at or before it.
+  size_t pfx = ::std::upper_bound(info.lut.begin(), info.lut.end(), static_cast<uint64_t>(range.first)) - info.lut.begin() - 1;
+
+  size_t rounds = ::mxx::allreduce((range.second - range.first + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+  for (size_t r = 0, pos = range.first; r < rounds; ++r) {
+    size_t n = ::std::min(chunk, range.second - pos);
+    file.read(4 + pos * record, buf.data(), n * record);
+
+    tuples.clear();
+    uint8_t const * p = buf.data();
+    for (size_t i = pos; i < pos + n; ++i, p += record) {
+      while ((pfx + 1 < info.lut.size()) && (info.lut[pfx + 1] <= i)) ++pfx;
+      // little endian:  the suffix, reversed, then the prefix, whose bits start byte aligned.
+      memset(kbytes, 0, sizeof(kbytes));
+      for (size_t j = 0; j < sbytes; ++j) kbytes[j] = p[sbytes - 1 - j];
+      detail::put_le(kbytes + sbytes, pfx, 8);
+      tuples.emplace_back(Bytes::load(kbytes), detail::saturate<ValueType>(detail::get_le(p + sbytes, info.counter_bytes)));
+    }
+    index.insert(tuples);  // collective
+    pos += n;
+  }
+  file.close();
+  BL_BENCH_END(import_kmc, "read_insert", range.second - range.first);
+
+  BL_BENCH_REPORT_MPI_NAMED(import_kmc, "index:import_kmc", comm);
+  return info;
+}
+
+/**
+ * @brief write the (kmer, count) entries of a count index as a KMC 1 database, <prefix>.kmc_pre and <prefix>.kmc_suf.  collective.
+ * @details the entries are globally sorted with mxx::sort.  lut_prefix_length is the largest value <= 8 with
+ *          (k - lut_prefix_length) divisible by 4, and counter_size fits the largest count.
+ * @param canonical   recorded in the header.  true if the index counts canonical kmers.
+ * @param chunk_size  entries written per process per collective write.
+ * @return  number of kmers written.
+ */
+template <typename IndexType>
+size_t export_kmc(IndexType const & index, ::std::string const & prefix, ::mxx::comm const & comm,
+                  bool const & canonical, size_t const & chunk_size = (1UL << 20)) {
+  using KmerType = typename IndexType::KmerType;
+  using ValueType = typename IndexType::ValueType;
+  using Bytes = detail::kmer_bytes<KmerType>;
+  using Entry = ::std::pair<KmerType, ValueType>;
+  static_assert(::std::is_integral<ValueType>::value, "count database export needs integer values, e.g. counts.");
+
+  constexpr size_t k = KmerType::size;
+  size_t lut_len = (k % 4 == 0) ? 4 : k % 4;
+  while ((lut_len + 4 <= 8) && (lut_len + 4 <= k)) lut_len += 4;
+  size_t sbytes = (k - lut_len) / 4;
+  size_t lut_size = 1UL << (2 * lut_len);
+
+  BL_BENCH_INIT(export_kmc);
+
+  size_t chunk = ::std::max(static_cast<size_t>(1), ::std::min(chunk_size, (1UL << 30) / (sbytes + 8)));
+
+  BL_BENCH_COLLECTIVE_START(export_kmc, "sort", comm);
+  ::std::vector<Entry> entries = detail::sorted_entries(index, chunk, comm);
+  BL_BENCH_COLLECTIVE_END(export_kmc, "sort", entries.size(), comm);
+
+  BL_BENCH_START(export_kmc);
+  uint64_t local_max = 0, local_min = ::std::numeric_limits<uint64_t>::max();
+  ::std::vector<uint64_t> prefix_counts(lut_size, 0);
+  uint8_t kbytes[Bytes::bytes + 8];
+  for (auto const & e : entries) {
+    local_max = ::std::max(local_max, static_cast<uint64_t>(e.second));
+    local_min = ::std::min(local_min, static_cast<uint64_t>(e.second));
+    Bytes::store(e.first, kbytes);
+    ++prefix_counts[detail::get_le(kbytes + sbytes, Bytes::bytes - sbytes)];
+  }
+  uint64_t max_count = ::mxx::allreduce(local_max, ::mxx::max<uint64_t>(), comm);
+  uint64_t min_count = ::mxx::allreduce(local_min, ::mxx::min<uint64_t>(), comm);
+  size_t total = ::mxx::allreduce(entries.size(), comm);
+  size_t counter_size = detail::bytes_for(max_count);
+  size_t record = sbytes + counter_size;
+  prefix_counts = ::mxx::reduce(prefix_counts, 0, ::std::plus<uint64_t>(), comm);
+  BL_BENCH_END(export_kmc, "prefixes", lut_size);
+
+  // suffixes:  marker, records in kmer order, marker.
+  BL_BENCH_START(export_kmc);
+  detail::db_file file(prefix + ".kmc_suf", comm, true);
+  ::std::vector<uint8_t> buf(::std::max(chunk * record, static_cast<size_t>(4)));
+  memcpy(buf.data(), "KMCS", 4);
+  file.write(buf, (comm.rank() == 0) ? 4 : 0);
+
+  size_t rounds = ::mxx::allreduce((entries.size() + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+  size_t pos = 0;
+  for (size_t r = 0; r < rounds; ++r) {
+    size_t n = ::std::min(chunk, entries.size() - pos);
+    uint8_t * p = buf.data();
+    for (size_t i = pos; i < pos + n; ++i, p += record) {
+      Bytes::store(entries[i].first, kbytes);
+      for (size_t j = 0; j < sbytes; ++j) p[j] = kbytes[sbytes - 1 - j];
+      detail::put_le(p + sbytes, static_cast<uint64_t>(entries[i].second), counter_size);
+    }
+    file.write(buf, n * record);
+    pos += n;
+  }
+  memcpy(buf.data(), "KMCS", 4);
+  file.write(buf, (comm.rank() == 0) ? 4 : 0);
+  file.close();
+  BL_BENCH_END(export_kmc, "write_suf", entries.size());
+
+  // prefixes:  lookup table of start indices, and the header.  small, so written by the first process.
+  BL_BENCH_START(export_kmc);
+  bool ok = true;
+  ::std::string pre_name = prefix + ".kmc_pre";
+  if (comm.rank() == 0) {
+    ::std::vector<uint8_t> pre(4 + (lut_size + 1) * sizeof(uint64_t), 0);
+    memcpy(pre.data(), "KMCP", 4);
+    uint64_t start = 0;
+    for (size_t i = 0; i < lut_size; ++i) {
+      detail::put_le(pre.data() + 4 + i * sizeof(uint64_t), start, 8);
+      start += prefix_counts[i];
+    }
+    detail::put_le(pre.data() + 4 + lut_size * sizeof(uint64_t), start, 8);
+
+    // kmer_length, mode, counter_size, lut_prefix_length, min_count, max_count, total_kmers, both_strands,
+    // 27 reserved bytes, version.
+    uint8_t header[64] = {0};
+    detail::put_le(header, k, 4);
+    detail::put_le(header + 8, counter_size, 4);
+    detail::put_le(header + 12, lut_len, 4);
+    detail::put_le(header + 16, ::std::min(min_count, max_count), 4);
+    detail::put_le(header + 20, max_count, 4);
+    detail::put_le(header + 24, total, 8);
+    header[32] = canonical ? 0 : 1;
+    pre.insert(pre.end(), header, header + sizeof(header));
+    uint8_t tail[8];
+    detail::put_le(tail, sizeof(header), 4);
+    memcpy(tail + 4, "KMCP", 4);
+    pre.insert(pre.end(), tail, tail + sizeof(tail));
+
+    ::std::ofstream ofs(pre_name, ::std::ios::binary | ::std::ios::trunc);
+    ofs.write(reinterpret_cast<char const *>(pre.data()), pre.size());
+    ok = static_cast<bool>(ofs);
+  }
+  if (!::mxx::all_of(ok, comm)) detail::throw_db_error(pre_name, "cannot write.");
+  BL_BENCH_END(export_kmc, "write_pre", lut_size);
+
+  BL_BENCH_REPORT_MPI_NAMED(export_kmc, "index:export_kmc", comm);
+  return total;
+}
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_KMER_COUNT_DB_HPP
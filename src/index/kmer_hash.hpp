@@ -63,6 +63,7 @@
 
 #include "common/alphabets.hpp"
 #include "common/kmer.hpp"
+#include "common/kmer_rolling_hash.hpp"
 
 #include "utils/transform_utils.hpp"
 
@@ -76,6 +77,10 @@
 #include <farmhash/src/farmhash.cc>
 #endif
 
+#if defined(__AVX2__) || defined(__SSE4_2__) || defined(__PCLMUL__)
+#include <x86intrin.h>   // AVX2 murmur finalization, SSE4.2 crc32c, PCLMULQDQ clhash
+#endif
+
 //// Kmer specialization for std::hash
 //namespace std {
 //  /**
@@ -148,6 +153,126 @@ namespace bliss {
     namespace hash
     {
 
+      namespace detail {
+
+#if defined(__AVX2__)
+        /// 64 bit multiply per lane.  AVX2 only has 32x32->64 bit multiply, so combine 3 of those.
+        inline __m256i mullo_epi64(__m256i const & a, __m256i const & b) {
+#if defined(__AVX512DQ__) && defined(__AVX512VL__)
+          return _mm256_mullo_epi64(a, b);
+#else
+          __m256i lo = _mm256_mul_epu32(a, b);
+          __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                           _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+          return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+#endif
+        }
+
+        template <int R>
+        inline __m256i rotl_epi64(__m256i const & x) {
+          return _mm256_or_si256(_mm256_slli_epi64(x, R), _mm256_srli_epi64(x, 64 - R));
+        }
+
+        /// murmur3 64 bit finalizer, 4 values at a time.  same as fmix64 in MurmurHash3.cpp
+        inline __m256i fmix64(__m256i k) {
+          k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+          k = mullo_epi64(k, _mm256_set1_epi64x(0xff51afd7ed558ccdULL));
+          k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+          k = mullo_epi64(k, _mm256_set1_epi64x(0xc4ceb9fe1a85ec53ULL));
+          return _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+        }
+#endif
+
+        /// apply the murmur3 64 bit finalizer to an array of values in place.
+        inline void fmix64(uint64_t * x, size_t const & count) {
+          size_t i = 0;
+#if defined(__AVX2__)
+          for (; i + 4 <= count; i += 4) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(x + i),
+                                fmix64(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(x + i))));
+          }
+#endif
+          for (; i < count; ++i) {
+            x[i] = ::fmix64(x[i]);
+          }
+        }
+
+#if !defined(__SSE4_2__)
+        /// lookup table for software crc32c (Castagnoli polynomial, reflected).
+        struct crc32c_table {
+            uint32_t t[8][256];
+
+            crc32c_table() {
+              uint32_t c;
+              for (uint32_t i = 0; i < 256; ++i) {
+                c = i;
+                for (int j = 0; j < 8; ++j) c = (c >> 1) ^ (0x82F63B78U & (0U - (c & 1U)));
+                t[0][i] = c;
+              }
+              for (uint32_t i = 0; i < 256; ++i) {
+                c = t[0][i];
+                for (int j = 1; j < 8; ++j) {
+                  c = t[0][c & 0xFF] ^ (c >> 8);
+                  t[j][i] = c;
+                }
+              }
+            }
+
+            static crc32c_table const & get() {
+              static const crc32c_table table;
+              return table;
+            }
+        };
+#endif
+
+        /// crc32c of 1 8 byte word.  same value as the SSE4.2 _mm_crc32_u64, in software (slice by 8) if SSE4.2 is not available.
+        inline uint64_t crc32c_u64(uint64_t const & crc, uint64_t const & w) {
+#if defined(__SSE4_2__)
+          return _mm_crc32_u64(crc, w);
+#else
+          crc32c_table const & tab = crc32c_table::get();
+          uint64_t x = static_cast<uint32_t>(crc) ^ w;
+          return tab.t[7][x & 0xFF] ^ tab.t[6][(x >> 8) & 0xFF] ^
+                 tab.t[5][(x >> 16) & 0xFF] ^ tab.t[4][(x >> 24) & 0xFF] ^
+                 tab.t[3][(x >> 32) & 0xFF] ^ tab.t[2][(x >> 40) & 0xFF] ^
+                 tab.t[1][(x >> 48) & 0xFF] ^ tab.t[0][x >> 56];
+#endif
+        }
+
+        /// carry-less multiply of 2 64 bit words, 128 bit result as lo and hi.  PCLMULQDQ if available, else in software, 4 bits at a time.
+        inline void clmul64(uint64_t const a, uint64_t const b, uint64_t & lo, uint64_t & hi) {
+#if defined(__PCLMUL__) && defined(__SSE4_1__)
+          __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0x00);
+          lo = _mm_cvtsi128_si64(r);
+          hi = _mm_extract_epi64(r, 1);
+#else
+          // products of a with all 4 bit values.
+          uint64_t tlo[16], thi[16];
+          tlo[0] = 0; thi[0] = 0;
+          tlo[1] = a; thi[1] = 0;
+          for (int i = 2; i < 16; i += 2) {
+            tlo[i] = tlo[i >> 1] << 1;
+            thi[i] = (thi[i >> 1] << 1) | (tlo[i >> 1] >> 63);
+            tlo[i + 1] = tlo[i] ^ a;
+            thi[i + 1] = thi[i];
+          }
+
+          uint64_t l = 0, h = 0;
+          size_t idx;
+          for (int n = 60; n >= 0; n -= 4) {
+            h = (h << 4) | (l >> 60);
+            l <<= 4;
+            idx = (b >> n) & 0xF;
+            l ^= tlo[idx];
+            h ^= thi[idx];
+          }
+          lo = l;
+          hi = h;
+#endif
+        }
+
+      } // namespace detail
+
 
       /**
        * @brief  Kmer hash, returns the least significant NumBits directly as identity hash.
@@ -248,7 +373,11 @@ namespace bliss {
           uint32_t seed;
 
         public:
+#if defined(__AVX2__)
+          static constexpr uint8_t batch_size = (nBytes <= 16) ? 4 : 1;
+#else
           static constexpr uint8_t batch_size = 1;
+#endif
 
           static const unsigned int default_init_value = 24U;  // allow 16M processors.  but it's ignored here.
 
@@ -273,6 +402,78 @@ namespace bliss {
               return h[0];
           }
 
+          /// batch hash.  with AVX2 and kmers up to 16 bytes, MurmurHash3_x64_128 is computed for 4 kmers per register.
+          inline void operator()(KMER const * kmers, size_t const & count, uint64_t * results) const
+          {
+            size_t i = 0;
+#if defined(__AVX2__)
+            if ((nBytes <= 16) && (sizeof(void*) == 8)) {
+              for (; i + 4 <= count; i += 4) {
+                hash4(kmers + i, results + i);
+              }
+            }
+#endif
+            for (; i < count; ++i) {
+              results[i] = this->operator()(kmers[i]);
+            }
+          }
+
+#if defined(__AVX2__)
+        protected:
+          /// MurmurHash3_x64_128 for 4 kmers of at most 16 bytes:  at most 1 block, or only the tail.
+          inline void hash4(KMER const * kmers, uint64_t * results) const
+          {
+            constexpr size_t lo_bytes = (nBytes < 8) ? nBytes : 8;
+            constexpr size_t hi_bytes = (nBytes > 8) ? (nBytes - 8) : 0;
+
+            uint64_t k1s[4] = {0, 0, 0, 0};
+            uint64_t k2s[4] = {0, 0, 0, 0};
+            for (size_t j = 0; j < 4; ++j) {
+              memcpy(k1s + j, kmers[j].getData(), lo_bytes);
+              if (hi_bytes > 0) memcpy(k2s + j, reinterpret_cast<uint8_t const *>(kmers[j].getData()) + lo_bytes, hi_bytes);
+            }
+
+            __m256i c1 = _mm256_set1_epi64x(0x87c37b91114253d5ULL);
+            __m256i c2 = _mm256_set1_epi64x(0x4cf5ad432745937fULL);
+            __m256i h1 = _mm256_set1_epi64x(seed);
+            __m256i h2 = h1;
+            __m256i k1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(k1s));
+            __m256i k2 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(k2s));
+
+            // k1 mix is the same for the 16 byte body and the tail.
+            k1 = detail::mullo_epi64(detail::rotl_epi64<31>(detail::mullo_epi64(k1, c1)), c2);
+            h1 = _mm256_xor_si256(h1, k1);
+
+            if (nBytes == 16) {  // body
+              h1 = _mm256_add_epi64(detail::rotl_epi64<27>(h1), h2);
+              h1 = _mm256_add_epi64(_mm256_add_epi64(h1, _mm256_slli_epi64(h1, 2)), _mm256_set1_epi64x(0x52dce729));
+            }
+            if (nBytes > 8) {
+              k2 = detail::mullo_epi64(detail::rotl_epi64<33>(detail::mullo_epi64(k2, c2)), c1);
+              h2 = _mm256_xor_si256(h2, k2);
+            }
+            if (nBytes == 16) {
+              h2 = _mm256_add_epi64(detail::rotl_epi64<31>(h2), h1);
+              h2 = _mm256_add_epi64(_mm256_add_epi64(h2, _mm256_slli_epi64(h2, 2)), _mm256_set1_epi64x(0x38495ab5));
+            }
+
+            // finalization
+            __m256i len = _mm256_set1_epi64x(nBytes);
+            h1 = _mm256_xor_si256(h1, len);
+            h2 = _mm256_xor_si256(h2, len);
+            h1 = _mm256_add_epi64(h1, h2);
+            h2 = _mm256_add_epi64(h2, h1);
+            h1 = detail::fmix64(h1);
+            h2 = detail::fmix64(h2);
+            h1 = _mm256_add_epi64(h1, h2);
+
+            if (Prefix)
+              _mm256_storeu_si256(reinterpret_cast<__m256i *>(results), _mm256_add_epi64(h2, h1));
+            else
+              _mm256_storeu_si256(reinterpret_cast<__m256i *>(results), h1);
+          }
+#endif
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t murmur<KMER, Prefix>::batch_size;
@@ -308,11 +509,222 @@ namespace bliss {
               return ::util::Hash64WithSeed(reinterpret_cast<const char*>(kmer.getData()), nBytes, seed);
           }
 
+          /// batch hash.  farm hash branches on the input length, so it is not vectorized.  this saves the per-call overhead only.
+          inline void operator()(KMER const * kmers, size_t const & count, uint64_t * results) const {
+            for (size_t i = 0; i < count; ++i) {
+              results[i] = this->operator()(kmers[i]);
+            }
+          }
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t farm<KMER, Prefix>::batch_size;
 
 
+      /**
+       * @brief  Kmer hash using the SSE4.2 crc32c instruction, followed by the murmur3 64 bit finalizer.
+       *           without SSE4.2, the same crc32c values are computed with a lookup table.
+       * @details  2 crc32c values are computed over the kmer's 8 byte blocks, the second with rotated blocks and a different seed,
+       *           so that the 64 bit result is not a trivial function of the first 32 bits.  the crc32c has 3 cycle latency,
+       *           so the batch version interleaves independent kmers, and finalizes 4 at a time with AVX2.
+       *           as with farm, a different seed is used for the "prefix" version.
+       */
+      template <typename KMER, bool Prefix = false>
+      class crc32c {
+
+        protected:
+          static constexpr unsigned int nBytes = (KMER::nBits + 7) / 8;
+          uint32_t seed;
+
+          inline uint64_t crc(KMER const & kmer) const {
+            uint8_t const * data = reinterpret_cast<uint8_t const *>(kmer.getData());
+            uint64_t lo = seed;
+            uint64_t hi = ~seed;
+            uint64_t w;
+
+            for (size_t i = 0; i < (nBytes >> 3); ++i) {
+              memcpy(&w, data + (i << 3), 8);
+              lo = detail::crc32c_u64(lo, w);
+              hi = detail::crc32c_u64(hi, (w << 32) | (w >> 32));
+            }
+            if ((nBytes & 0x7) > 0) {
+              w = 0;
+              memcpy(&w, data + (nBytes & ~(0x7U)), nBytes & 0x7);
+              lo = detail::crc32c_u64(lo, w);
+              hi = detail::crc32c_u64(hi, (w << 32) | (w >> 32));
+            }
+            return (hi << 32) | lo;
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 4;
+
+          static const unsigned int default_init_value = 24U;
+
+          crc32c(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(Prefix ? ((_seed << 1) - 1) : _seed) {};
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            return fmix64(crc(kmer));
+          }
+
+          /// batch hash
+          inline void operator()(KMER const * kmers, size_t const & count, uint64_t * results) const {
+            for (size_t i = 0; i < count; ++i) {
+              results[i] = crc(kmers[i]);
+            }
+            detail::fmix64(results, count);
+          }
+
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t crc32c<KMER, Prefix>::batch_size;
+
+      /**
+       * @brief  CLHash style kmer hash:  carry-less multiplication of the kmer's 8 byte words with random keys, using PCLMULQDQ.
+       * @details  pairs of words, each xored with a key, are carry-less multiplied and the 128 bit products are accumulated with xor
+       *           (CLNH).  the sum is reduced modulo x^64 + x^4 + x^3 + x + 1, and, since the distributed maps take the rank
+       *           from the high bits, finished with the murmur3 64 bit finalizer.  without PCLMULQDQ, the carry-less
+       *           multiplication is done in software and produces the same values.
+       *           the keys are generated from the seed, and as with farm, a different seed is used for the "prefix" version.
+       */
+      template <typename KMER, bool Prefix = false>
+      class clhash {
+
+        protected:
+          static constexpr unsigned int nBytes = (KMER::nBits + 7) / 8;
+          static constexpr unsigned int nWords = (nBytes + 7) / 8;
+          static constexpr unsigned int nKeys = (nWords + 1) & ~(0x1U);
+
+          uint64_t keys[nKeys];
+
+          inline uint64_t clnh(KMER const & kmer) const {
+            uint64_t w[nKeys];
+            w[nKeys - 1] = 0;
+            memcpy(w, kmer.getData(), nBytes);
+            if ((nBytes & 0x7) > 0) memset(reinterpret_cast<uint8_t *>(w) + nBytes, 0, (nWords << 3) - nBytes);
+
+            uint64_t lo = 0, hi = 0, l, h;
+            for (size_t i = 0; i < nKeys; i += 2) {
+              detail::clmul64(w[i] ^ keys[i], w[i + 1] ^ keys[i + 1], l, h);
+              lo ^= l;
+              hi ^= h;
+            }
+
+            // reduce:  x^64 = x^4 + x^3 + x + 1.  hi * 0x1B has at most 68 bits, so a second, 4 bit fold finishes it.
+            detail::clmul64(hi, 0x1BULL, l, h);
+            lo ^= l;
+            detail::clmul64(h, 0x1BULL, l, h);
+            return (lo ^ l) ^ nBytes;
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 4;
+
+          static const unsigned int default_init_value = 24U;
+
+          clhash(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) {
+            // splitmix64 key generation
+            uint64_t x = Prefix ? ((static_cast<uint64_t>(_seed) << 1) - 1) : _seed;
+            uint64_t z;
+            for (size_t i = 0; i < nKeys; ++i) {
+              x += 0x9E3779B97F4A7C15ULL;
+              z = x;
+              z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+              z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+              keys[i] = z ^ (z >> 31);
+            }
+          };
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            return fmix64(clnh(kmer));
+          }
+
+          /// batch hash
+          inline void operator()(KMER const * kmers, size_t const & count, uint64_t * results) const {
+            for (size_t i = 0; i < count; ++i) {
+              results[i] = clnh(kmers[i]);
+            }
+            detail::fmix64(results, count);
+          }
+
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t clhash<KMER, Prefix>::batch_size;
+
+
+      /**
+       * @brief  ntHash style kmer hash, for kmers from RollingHashKmerSlidingWindow, which carry their rolling hash.
+       * @details  for a (kmer, hash) pair the carried hash is only finalized with the murmur3 64 bit finalizer, O(1)
+       *           for any k.  a kmer without the hash, e.g. a query, is hashed from its characters in O(k), with the
+       *           same result (see bliss::common::rolling_hash).  with Canonical, the hash is the same for a kmer and
+       *           its reverse complement, and matches RollingHashKmerSlidingWindow<..., true>.
+       *           as with farm, a different seed is used for the "prefix" version.
+       */
+      template <typename KMER, bool Prefix = false, bool Canonical = false>
+      class ntHash {
+
+        protected:
+          using rolling = ::bliss::common::rolling_hash<KMER>;
+          uint64_t key;
+
+        public:
+          static constexpr uint8_t batch_size = 4;
+
+          static const unsigned int default_init_value = 24U;
+
+          ntHash(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) {
+            // splitmix64 of the seed
+            uint64_t z = (Prefix ? ((static_cast<uint64_t>(_seed) << 1) - 1) : _seed) + 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+          };
+
+          /// hash of the raw rolling hash value.
+          inline uint64_t finalize(uint64_t const & raw) const {
+            return fmix64(raw ^ key);
+          }
+
+          /// raw rolling hash of a kmer, from its characters.
+          static inline uint64_t raw(KMER const & kmer) {
+            return Canonical ? rolling::canonical(kmer) : rolling::forward(kmer);
+          }
+
+          /// kmer with its precomputed rolling hash, e.g. from RollingHashKmerGenerationIterator.
+          inline uint64_t operator()(::std::pair<KMER, uint64_t> const & hashed) const {
+            return finalize(hashed.second);
+          }
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            return finalize(raw(kmer));
+          }
+
+          /// batch hash
+          inline void operator()(KMER const * kmers, size_t const & count, uint64_t * results) const {
+            for (size_t i = 0; i < count; ++i) {
+              results[i] = raw(kmers[i]) ^ key;
+            }
+            detail::fmix64(results, count);
+          }
+
+          /// batch hash of kmers with precomputed rolling hashes.
+          inline void operator()(::std::pair<KMER, uint64_t> const * hashed, size_t const & count, uint64_t * results) const {
+            for (size_t i = 0; i < count; ++i) {
+              results[i] = hashed[i].second ^ key;
+            }
+            detail::fmix64(results, count);
+          }
+
+      };
+      template<typename KMER, bool Prefix, bool Canonical>
+      constexpr uint8_t ntHash<KMER, Prefix, Canonical>::batch_size;
+
+      /// canonical ntHash, with the 2 parameter form of the other kmer hashes.
+      template <typename KMER, bool Prefix = false>
+      using canonical_ntHash = ntHash<KMER, Prefix, true>;
+
+
       namespace sparsehash {
       	  //  ===============
       	  //  Sparse hash specific, kmer related stuff
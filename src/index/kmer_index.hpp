@@ -52,7 +52,15 @@
 #include <tuple>        // tuple and utility functions
 #include <utility>      // pair and utility functions.
 #include <type_traits>
+#include <memory>       // unique_ptr
+#include <stdexcept>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <numeric>      // partial_sum, accumulate
+#include <cstring>      // memcpy
 #include <cctype>       // tolower.
+#include <iterator>     // back_inserter
 
 #include "io/file.hpp"
 #include "io/fastq_loader.hpp"
@@ -66,16 +74,27 @@
 #include "index/kmer_hash.hpp"
 #include "common/kmer_transform.hpp"
 
+#include "index/query_cache.hpp"
+#include "index/query_trace.hpp"
+#include "index/build_checkpoint.hpp"
+
 #include "io/kmer_file_helper.hpp"
 #include "io/kmer_parser.hpp"
+#include "io/spill_buckets.hpp"
+#include "io/adaptive_block_size.hpp"
 #include "io/mxx_support.hpp"
 #include "containers/distributed_unordered_map.hpp"
 #include "containers/distributed_sorted_map.hpp"
 //#include "containers/distributed_hashed_vec.hpp"
 //#include "containers/distributed_map.hpp"
 #include "containers/distributed_densehash_map.hpp"
+#include "containers/distributed_adaptive_map.hpp"
+#include "containers/distributed_count_min_sketch.hpp"
+#include "containers/distributed_direct_count_map.hpp"
+#include "containers/hugepage_allocator.hpp"
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/memory_usage.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/transform_utils.hpp"
 
@@ -91,6 +110,101 @@ namespace index
 namespace kmer
 {
 
+/// placeholder frozen map type, for the maps without freeze.  never constructed.
+template <typename MapType>
+struct unfrozen_map {
+	template <typename Q>
+	auto find(Q & query) const -> decltype(::std::declval<MapType const &>().find(query)) {
+		throw ::std::logic_error("Index: map type does not support freeze.");
+	}
+	template <typename Q>
+	auto count(Q & query) const -> decltype(::std::declval<MapType const &>().count(query)) {
+		throw ::std::logic_error("Index: map type does not support freeze.");
+	}
+	size_t size() const { return 0; }
+	size_t local_size() const { return 0; }
+	::dsc::scan_cursor<typename MapType::key_type, typename MapType::mapped_type> scan(size_t const & chunk_size) const {
+		throw ::std::logic_error("Index: map type does not support freeze.");
+	}
+};
+
+/// MapType::frozen_type<>, the read only map built by MapType::freeze, if any.
+template <typename MapType, typename = void>
+struct frozen_map_type {
+	using type = unfrozen_map<MapType>;
+};
+template <typename MapType>
+struct frozen_map_type<MapType, typename ::std::conditional<true, void, typename MapType::template frozen_type<> >::type> {
+	using type = typename MapType::template frozen_type<>;
+};
+
+/**
+ * @brief settings of Index::build_external.  the same on all processes.
+ */
+struct external_build_config {
+	/// directory for the spill files.  should be node local, e.g. an NVMe scratch.
+	std::string spill_dir;
+	/// number of spill files per process.  a pass inserts 1 or more of them.
+	size_t buckets;
+	/// fraction of the memory usable by the process (MemUsage::get_usable_mem() divided by the ranks on the node) for 1 pass.
+	double mem_fraction;
+	/// bytes per process for 1 pass.  overrides mem_fraction if not 0.
+	size_t mem_bytes;
+	/// bytes read from the file per block.
+	size_t block_size;
+	/// if not empty, each pass's map is saved to <output>.<pass> and cleared, so the index does not have to fit in memory.
+	std::string output;
+
+	external_build_config(std::string const & _spill_dir = "/tmp") :
+		spill_dir(_spill_dir), buckets(256), mem_fraction(0.25), mem_bytes(0), block_size(1UL << 26) {}
+};
+
+/// the kmer of a parsed tuple.
+template <typename K>
+inline K const & tuple_kmer(K const & x) { return x; }
+template <typename K, typename V>
+inline K const & tuple_kmer(std::pair<K, V> const & x) { return x.first; }
+
+/**
+ * @brief group consecutive buckets into passes.  a pass ends before the largest bucket sizes (over all processes) exceed max_elements.
+ * @return  the first bucket of each pass, and the bucket count at the end.
+ */
+inline std::vector<size_t> external_passes(std::vector<size_t> const & bucket_max, size_t const & max_elements) {
+	std::vector<size_t> passes(1, 0);
+	size_t sum = 0;
+	for (size_t b = 0; b < bucket_max.size(); ++b) {
+		if ((sum > 0) && (sum + bucket_max[b] > max_elements)) {
+			passes.emplace_back(b);
+			sum = 0;
+		}
+		sum += bucket_max[b];
+	}
+	passes.emplace_back(bucket_max.size());
+	return passes;
+}
+
+/// true if MapType has a consuming insert(std::vector<T> &&), e.g. the hashed unordered and densehash maps.
+template <typename MapType, typename T, typename = void>
+struct has_consuming_insert : public ::std::false_type {};
+template <typename MapType, typename T>
+struct has_consuming_insert<MapType, T, typename ::std::conditional<true, void,
+	decltype(::std::declval<MapType &>().insert(::std::declval<::std::vector<T> &&>()))>::type> : public ::std::true_type {};
+
+/// insert input into map, consuming it if the map supports it.  input is empty afterwards.  collective.
+template <typename MapType, typename T>
+inline void consume_insert(MapType & map, ::std::vector<T> & input, ::std::true_type) {
+	map.insert(::std::move(input));
+}
+template <typename MapType, typename T>
+inline void consume_insert(MapType & map, ::std::vector<T> & input, ::std::false_type) {
+	map.insert(input);
+	::std::vector<T>().swap(input);
+}
+template <typename MapType, typename T>
+inline void consume_insert(MapType & map, ::std::vector<T> & input) {
+	consume_insert(map, input, has_consuming_insert<MapType, T>());
+}
+
 /**
  * @tparam MapType  	container type
  * @tparam KmerParser		functor to generate kmer (tuple) from input.  specified here so we specialize for different index.  note KmerParser needs to be supplied with a data type.
@@ -101,6 +215,10 @@ protected:
 
 	MapType map;
 
+	using FrozenMapType = typename frozen_map_type<MapType>::type;
+	/// read only layout of the map after freeze.  answers find and count if set.
+	::std::unique_ptr<FrozenMapType> frozen;
+
 	const mxx::comm& comm;
 
 public:
@@ -112,7 +230,26 @@ public:
 
 	using KmerParserType = KmerParser;
 
-	Index(const mxx::comm& _comm) : map(_comm), comm(_comm) {
+protected:
+	using FindResultType = decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>()));
+	using CountResultType = decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>()));
+	using FindCacheType = ::bliss::index::clock_cache<KmerType, std::vector<typename FindResultType::value_type::second_type>,
+			::bliss::kmer::hash::farm<KmerType, false> >;
+	using CountCacheType = ::bliss::index::clock_cache<KmerType, typename CountResultType::value_type::second_type,
+			::bliss::kmer::hash::farm<KmerType, false> >;
+
+	/// per process caches of the find and count results, by input transformed kmer.  disabled by default.
+	mutable FindCacheType find_cache;
+	mutable CountCacheType count_cache;
+	/// incremented by each modification of the map through the index.  a cache filled in an older epoch is cleared before use.
+	size_t epoch;
+
+	using QueryTraceType = ::bliss::index::query_trace_writer<KmerType, ::bliss::kmer::hash::farm<KmerType, false> >;
+	/// recorder of the find and count batches of this process.  disabled if null.
+	mutable ::std::unique_ptr<QueryTraceType> query_trace;
+
+public:
+	Index(const mxx::comm& _comm) : map(_comm), comm(_comm), epoch(0) {
 	}
 
 	virtual ~Index() {};
@@ -124,6 +261,26 @@ public:
 		return map;
 	}
 
+	/// choose how large query batches are distributed, e.g. imxx::scatter_algo::LOW_MEM to bound memory.  same on all processes.
+	void set_distribution_policy(::imxx::distribution_policy const & policy) {
+		map.set_distribution_policy(policy);
+	}
+	::imxx::distribution_policy const & get_distribution_policy() const {
+		return map.get_distribution_policy();
+	}
+
+	/// communication volume counters of the imxx calls, by phase.  per process, so shared by all indices.
+	void enable_comm_stats(bool const & enable = true) {
+		::imxx::comm_stats::instance().enable(enable);
+	}
+	::imxx::comm_stats const & get_comm_stats() const {
+		return ::imxx::comm_stats::instance();
+	}
+	/// print the communication counters reduced over the ranks.  collective.
+	void report_comm_stats() const {
+		::imxx::comm_stats::instance().report(comm);
+	}
+
 
 
 //	std::vector<TupleType> find_overlap(std::vector<KmerType> &query) const {
@@ -131,7 +288,9 @@ public:
 //	}
 	auto find(std::vector<KmerType> &query) const
 		-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
-		return map.find(query);
+		if (query_trace) query_trace->record(::bliss::index::query_op::FIND, query);
+		if (find_cache.enabled()) return cached_find(query);
+		return uncached_find(query);
 	}
 //	std::vector<TupleType> find_collective(std::vector<KmerType> &query) const {
 //		return map.find_collective(query);
@@ -141,13 +300,150 @@ public:
 //  }
 	auto count(std::vector<KmerType> &query) const
 	-> decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>())){
-		return map.count(query);
+		if (query_trace) query_trace->record(::bliss::index::query_op::COUNT, query);
+		if (count_cache.enabled()) return cached_count(query);
+		return uncached_count(query);
+	}
+
+	/**
+	 * @brief record the find and count query batches of each process in <prefix>.<rank>, for replay in a benchmark.  call on all processes.
+	 * @details  the kmers are recorded as queried, before the input transform.  with sample_rate below 1, about that
+	 *        fraction of the distinct kmers are recorded, with all their occurrences.  see query_trace_writer.
+	 */
+	void enable_query_trace(std::string const & prefix, double const & sample_rate = 1.0) {
+		query_trace.reset(new QueryTraceType(::bliss::index::query_trace_filename(prefix, comm.rank()),
+				comm.size(), comm.rank(), sample_rate));
+	}
+	/// stop recording, and close the trace files.
+	void disable_query_trace() {
+		query_trace.reset();
+	}
+	QueryTraceType const * get_query_trace() const {
+		return query_trace.get();
+	}
+
+	/**
+	 * @brief cache up to capacity find and up to capacity count results on this process, for repeated query kmers.  0 disables.
+	 * @details  a cached kmer is answered locally in later find and count calls, and is not sent to its owner.  both
+	 *        calls remain collective, and return the results of the unique input transformed queries, as without the cache.
+	 *        the caches are cleared by insert, erase, freeze and the builds.  modifications through get_map() are not
+	 *        tracked:  call invalidate_query_cache() after them.  find caches all values of a kmer, so capacity bounds
+	 *        kmers, not entries.  per process, so may differ between processes.
+	 */
+	void enable_query_cache(size_t const & capacity) {
+		find_cache = FindCacheType(capacity);
+		count_cache = CountCacheType(capacity);
+		find_cache.validate(epoch);
+		count_cache.validate(epoch);
+	}
+	/// clear the query caches, e.g. after modifying the map through get_map().
+	void invalidate_query_cache() {
+		++epoch;
+	}
+	FindCacheType const & get_find_cache() const {
+		return find_cache;
+	}
+	CountCacheType const & get_count_cache() const {
+		return count_cache;
+	}
+
+	/**
+	 * @brief switch to a read only minimal perfect hash layout, for a reference index that is built once and queried many times.  collective.
+	 * @details  find and count are then answered by the frozen layout, and may report absent kmers as present with
+	 *        probability 2^-16.  only for the maps with freeze, i.e. the hashed unordered and densehash maps.  see frozen_unordered_map.
+	 * @param release  clear the map afterwards.  the other accessors and modifiers then see an empty map.
+	 */
+	void freeze(bool release = true) {
+		++epoch;
+		frozen.reset(new FrozenMapType(map, comm));
+		if (release) map.reset();
+	}
+
+	/**
+	 * @brief membership filter of the current kmers, to drop absent query kmers before find or count.  collective.
+	 * @details  e.g. screening reads against a contaminant index:  with replicate, filter.screen(query) removes most
+	 *        absent kmers without communication.  only for the hashed unordered maps.  see dsc::membership_filter.
+	 */
+	template <typename Fingerprint = uint8_t, typename M = MapType>
+	typename M::template membership_filter_type<Fingerprint> membership_filter(bool replicate = false) const {
+		return map.template membership_filter<Fingerprint>(replicate);
+	}
+
+	bool is_frozen() const {
+		return static_cast<bool>(frozen);
+	}
+
+	/// drop the frozen layout.  the map is empty if it was released by freeze.  collective.
+	void unfreeze() {
+		++epoch;
+		frozen.reset();
+		if (comm.size() > 1) comm.barrier();
+	}
+
+	/**
+	 * @brief stage the following inserts and builds until finalize, so the map does its per insert work once.  collective.
+	 * @details  e.g. begin_build, build_streaming of several files, finalize, then freeze for a read only index.
+	 *        the staged k-mers stay in memory until finalize.  see map_base::begin_build
+	 */
+	void begin_build() {
+		map.begin_build();
+	}
+
+	bool is_building() const {
+		return map.is_building();
+	}
+
+	/// insert the k-mers staged since begin_build as 1 batch, and ready the map for queries.  collective.  see map_base::finalize
+	void finalize() {
+		++epoch;
+		map.finalize();
 	}
 
 	void erase(std::vector<KmerType> &query) {
+		++epoch;
 		map.erase(query);
 	}
 
+	/// number of kmers with each value in [0, max_value], e.g. the kmer spectrum of a count index.  collective.
+	std::vector<size_t> histogram(size_t const & max_value) const {
+		return map.histogram(max_value);
+	}
+
+	/**
+	 * @brief scan the local (kmer, value) entries in chunks of at most chunk_size, e.g. to export the index at constant extra memory.
+	 * @details  the calls to next of the cursor are collective, and the index must not be modified until the scan is done.
+	 *        after freeze with release, scans the frozen layout, which does not store the keys of the hashed maps.
+	 *        collective.  see dsc::scan_cursor.
+	 */
+	::dsc::scan_cursor<KmerType, ValueType> scan(size_t const & chunk_size) const {
+		if (frozen && (map.size() == 0)) return frozen->scan(chunk_size);
+		return map.scan(chunk_size);
+	}
+
+	/**
+	 * @brief reduce the entries of other into this index, e.g. to add the counts of another batch without rebuilding.  collective.
+	 * @details  needs a reduction or counting map.  local if the maps are co-partitioned, otherwise other's entries are
+	 *        streamed through insert.  see reduction_unordered_map::merge.  other's map has to hold its entries, i.e. not be
+	 *        released by freeze.
+	 * @return  number of new local kmers.
+	 */
+	template <typename OtherIndex>
+	size_t merge(OtherIndex const & other, size_t const & chunk_size = (1UL << 20)) {
+		++epoch;
+		return map.merge(other.get_map(), chunk_size);
+	}
+
+	/// the n kmers with the largest values, in decreasing order.  collective.
+	std::vector<TupleType> top_n(size_t const & n) const {
+		return map.top_n(n);
+	}
+
+	/// reduce f(entry) over all entries, with init the identity of reduce.  collective.
+	template <typename V, typename MapOp, typename ReduceOp>
+	V map_reduce(MapOp const & f, ReduceOp const & reduce, V const & init) const {
+		return map.map_reduce(f, reduce, init);
+	}
+
 
 //	template <typename Predicate>
 //	std::vector<TupleType> find_if_overlap(std::vector<KmerType> &query, Predicate const &pred) const {
@@ -185,14 +481,21 @@ public:
 
 	template <typename Predicate>
 	void erase_if(std::vector<KmerType> &query, Predicate const &pred) {
+		++epoch;
 		map.erase(query, false, pred);
 	}
 
 	template <typename Predicate>
 	void erase_if(Predicate const &pred) {
+		++epoch;
 		map.erase(pred);
 	}
 
+	/// release the memory left over from erase and erase_if, e.g. before the query phase.  collective.  see map_base::compact.
+	void compact(bool rebalance = false) {
+		map.compact(rebalance);
+	}
+
 
 	/**
 	 * @tparam T 	input type may not be same as map's value types, so map need to provide overloads (and potentially with transform operators)
@@ -208,22 +511,32 @@ public:
 
 		// distribute
 		BL_BENCH_START(insert);
+		++this->epoch;
 		this->map.insert(temp);  // COLLECTIVE CALL...
 		BL_BENCH_END(insert, "map_insert", this->map.local_size());
 
-#if (BL_BENCHMARK == 1)
-		BL_BENCH_START(insert);
-		size_t m = 0;  // here because sortmap needs it.
-		m = this->map.get_multiplicity();
-		BL_BENCH_END(insert, "multiplicity", m);
-#else
-		auto result = this->map.get_multiplicity();
-		BLISS_UNUSED(result);
-#endif
+		// no multiplicity here:  the hash maps track it during insert, and the sorted maps compute it when they
+		// redistribute, on the next query or build.
 		BL_BENCH_REPORT_MPI_NAMED(insert, "index:insert", this->comm);
 
 	 }
 
+	/**
+	 * @brief insert, consuming temp, e.g. the kmers of a build.  maps with a consuming insert distribute temp in place,
+	 *        without a second buffer of the same size.  temp is empty afterwards.  collective.
+	 */
+	 template <typename T>
+	void insert(std::vector<T> &&temp) {
+		BL_BENCH_INIT(insert);
+
+		BL_BENCH_START(insert);
+		++this->epoch;
+		consume_insert(this->map, temp);  // COLLECTIVE CALL...
+		BL_BENCH_END(insert, "map_insert", this->map.local_size());
+
+		BL_BENCH_REPORT_MPI_NAMED(insert, "index:insert", this->comm);
+	 }
+
 	 // Note that KmerParserType may depend on knowing the Sequence Parser Type (e.g. provide quality score iterators)
 	 //	Output type of KmerParserType may not match Map value type, in which case the map needs to do its own transform.
 	 //     since Kmer template parameter is not explicitly known, we can't hard code the return types of KmerParserType.
@@ -271,14 +584,117 @@ public:
 		 //         ofs.close();
 
      BL_BENCH_START(build);
-		 this->insert(temp);
-     BL_BENCH_END(build, "insert", temp.size());
+		 this->insert(::std::move(temp));
+     BL_BENCH_END(build, "insert", this->map.local_size());
 
 
      BL_BENCH_REPORT_MPI_NAMED(build, "index:build_mpiio", this->comm);
 
 	 }
 
+	 /// convenience function for building index from a FASTA file, using its sidecar record index (FASTA.bidx), see fasta_index.  written on first use.
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_indexed(const std::string & filename, MPI_Comm comm) {
+
+		 // file extension determines SeqParserType
+		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+
+		 // check to make sure that the file parser will work
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if ((extension.compare("fasta") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+     BL_BENCH_INIT(build);
+
+		 // proceed
+     BL_BENCH_START(build);
+		 ::std::vector<typename KmerParser::value_type> temp;
+		 bliss::io::KmerFileHelper::template read_file_indexed<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
+		 	 KmerParser, SeqParser, SeqIterType>(filename, temp, comm);
+     BL_BENCH_END(build, "read", temp.size());
+
+     BL_BENCH_START(build);
+		 this->insert(::std::move(temp));
+     BL_BENCH_END(build, "insert", this->map.local_size());
+
+     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_indexed", this->comm);
+
+	 }
+
+	 /// convenience function for building index from a packed sequence file, see KmerFileHelper::write_packed_file.  no FASTQ parsing.
+	 void build_packed(const std::string & filename, MPI_Comm comm) {
+     BL_BENCH_INIT(build);
+
+     BL_BENCH_START(build);
+		 ::std::vector<typename KmerParser::value_type> temp;
+		 bliss::io::KmerFileHelper::template read_packed_file<KmerParser>(filename, temp, comm);
+     BL_BENCH_END(build, "read", temp.size());
+
+     BL_BENCH_START(build);
+		 this->insert(::std::move(temp));
+     BL_BENCH_END(build, "insert", this->map.local_size());
+
+     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_packed", this->comm);
+
+	 }
+
+	 /// convenience function for building index from a FASTQ file with long reads.  reads longer than threshold are split across processes, see long_read_partition.
+	 void build_long_reads(const std::string & filename, MPI_Comm comm, size_t const & threshold = 65536UL) {
+     BL_BENCH_INIT(build);
+
+     BL_BENCH_START(build);
+		 ::std::vector<typename KmerParser::value_type> temp;
+		 bliss::io::KmerFileHelper::template read_file_long_reads<KmerParser>(filename, temp, comm, threshold);
+     BL_BENCH_END(build, "read", temp.size());
+
+     BL_BENCH_START(build);
+		 this->insert(::std::move(temp));
+     BL_BENCH_END(build, "insert", this->map.local_size());
+
+     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_long_reads", this->comm);
+
+	 }
+
+#if defined(USE_ZLIB)
+	 /// convenience function for building index from gzip or BGZF compressed file, e.g. reads.fastq.gz
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_bgzf(const std::string & filename, MPI_Comm comm) {
+
+		 // file extension, excluding the compression extension, determines SeqParserType
+		 std::string extension = ::bliss::utils::file::get_uncompressed_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+
+		 // check to make sure that the file parser will work
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if ((extension.compare("fasta") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+     BL_BENCH_INIT(build);
+
+		 // proceed
+     BL_BENCH_START(build);
+		 ::std::vector<typename KmerParser::value_type> temp;
+		 bliss::io::KmerFileHelper::template read_file_bgzf<KmerParser, SeqParser, SeqIterType>(filename, temp, comm);
+     BL_BENCH_END(build, "read", temp.size());
+
+     BL_BENCH_START(build);
+		 this->insert(::std::move(temp));
+     BL_BENCH_END(build, "insert", this->map.local_size());
+
+     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_bgzf", this->comm);
+
+	 }
+#endif
+
 
 	  /// convenience function for building index.
 	   template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
@@ -316,8 +732,8 @@ public:
 	     //         ofs.close();
 
 	     BL_BENCH_START(build);
-	     this->insert(temp);
-	      BL_BENCH_END(build, "insert", temp.size());
+	     this->insert(::std::move(temp));
+	      BL_BENCH_END(build, "insert", this->map.local_size());
 
 
 	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_mmap", this->comm);
@@ -363,8 +779,8 @@ public:
 			 //         ofs.close();
 
 	     BL_BENCH_START(build);
-			 this->insert(temp);
-	     BL_BENCH_END(build, "insert", temp.size());
+			 this->insert(::std::move(temp));
+	     BL_BENCH_END(build, "insert", this->map.local_size());
 
 
 	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_posix", this->comm);
@@ -372,6 +788,304 @@ public:
 		 }
 
 
+		 /**
+		  * @brief  build index by reading the file one block at a time and inserting the kmers for each block.
+		  * @details  peak memory is bounded by the block size and the kmers generated from 1 block, instead of
+		  *           all kmers in the process's partition.  multiplicity is computed once at the end.
+		  *           FASTA sequences span blocks.  the bases at a block's end are carried to the next block, see fasta_stream.
+		  * @param filename     name of the file to read
+		  * @param comm         communicator
+		  * @param block_size   number of bytes to read per block.
+		  * @param cyclic       read the blocks block cyclically, to spread the reads over the file system stripes.
+		  */
+		 template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_streaming(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26), bool cyclic = false) {
+
+			 // file extension determines SeqParserType
+			 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+				 throw std::invalid_argument("input filename extension is not supported.");
+			 }
+
+			 // check to make sure that the file parser will work
+			 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+			 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+			 }
+	     BL_BENCH_INIT(build);
+
+			 // proceed
+	     BL_BENCH_START(build);
+			 size_t batches = 0;
+			 ++this->epoch;
+			 auto consumer = [this, &batches](::std::vector<typename KmerParser::value_type> & batch) {
+				 this->map.insert(batch);  // COLLECTIVE CALL...
+				 ++batches;
+			 };
+			 auto read = bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParser, SeqParser, SeqIterType>(filename, block_size, consumer, comm, true, cyclic);
+	     BL_BENCH_END(build, "read_insert", read.second);
+
+	     BL_BENCH_START(build);
+			 size_t m = this->map.get_multiplicity();
+			 BLISS_UNUSED(m);
+	     BL_BENCH_END(build, "multiplicity", batches);
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_streaming", this->comm);
+		 }
+
+		 /// convenience function for building index with bounded memory, using posix file reads
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_streaming_posix(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26), bool cyclic = false) {
+			 this->template build_streaming<::bliss::io::posix_file, SeqParser, SeqIterType>(filename, comm, block_size, cyclic);
+		 }
+
+		 /// convenience function for building index with bounded memory, using mmap file reads
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_streaming_mmap(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26), bool cyclic = false) {
+			 this->template build_streaming<::bliss::io::mmap_file, SeqParser, SeqIterType>(filename, comm, block_size, cyclic);
+		 }
+
+		 /**
+		  * @brief  build_streaming with the block size chosen after each round by sizer, from the memory headroom and the map growth.  collective.
+		  * @details  throughput stays near the memory limit as the map grows, instead of depending on a fixed block size.
+		  *           see ::bliss::io::adaptive_block_size.  sizer keeps its state, e.g. the final block size and bytes per entry.
+		  */
+		 template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_streaming_adaptive(const std::string & filename, MPI_Comm comm, ::bliss::io::adaptive_block_size & sizer) {
+			 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+				 throw std::invalid_argument("input filename extension is not supported.");
+			 }
+
+			 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+			 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+			 }
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ++this->epoch;
+			 auto consumer = [this](::std::vector<typename KmerParser::value_type> & batch) {
+				 this->map.insert(batch);  // COLLECTIVE CALL...
+			 };
+			 auto block_sizer = [this, &sizer](size_t const & bytes, size_t const & kmers) {
+				 return sizer.update(bytes, kmers, this->map.local_size(), this->comm);  // COLLECTIVE CALL...
+			 };
+			 auto read = bliss::io::KmerFileHelper::template read_file_streamed_adaptive<FileReader, KmerParser, SeqParser, SeqIterType>(
+					 filename, sizer.get_block_size(), consumer, block_sizer, comm);
+	     BL_BENCH_END(build, "read_insert", read.second);
+
+	     BL_BENCH_START(build);
+			 size_t m = this->map.get_multiplicity();
+			 BLISS_UNUSED(m);
+	     BL_BENCH_END(build, "multiplicity", sizer.get_rounds());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_streaming_adaptive", this->comm);
+		 }
+
+		 /// build_streaming_adaptive with posix file reads, and a controller for the map's tuple and entry sizes.
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_streaming_adaptive_posix(const std::string & filename, MPI_Comm comm, size_t const & initial_block_size = (1UL << 26),
+				 double const & mem_fraction = 0.5) {
+			 ::bliss::io::adaptive_block_size sizer(initial_block_size, sizeof(typename KmerParser::value_type),
+					 2 * sizeof(typename MapType::value_type), (1UL << 20), (1UL << 30), mem_fraction);
+			 this->template build_streaming_adaptive<::bliss::io::posix_file, SeqParser, SeqIterType>(filename, comm, sizer);
+		 }
+
+		 /**
+		  * @brief  build_streaming with periodic checkpoints, resuming from the last checkpoint of an interrupted build.  collective.
+		  * @details  FASTQ only.  the map is snapshotted every config.interval seconds, and written in the background while
+		  *           the next blocks are inserted.  a build of an unchanged file with the same number of processes and prefix
+		  *           loads the last committed snapshot, and skips the part of each process's partition that it contains.
+		  *           see build_checkpointer.  the map should be empty before the call, otherwise it is replaced when resuming.
+		  * @return  true if the build resumed from a checkpoint.
+		  */
+		 template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 bool build_checkpointed(const std::string & filename, MPI_Comm comm, checkpoint_config const & config,
+				 size_t const & block_size = (1UL << 26)) {
+			 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			 if ((extension.compare("fastq") != 0) || (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+				 throw std::invalid_argument("build_checkpointed supports FASTQ files only.");
+			 }
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ++this->epoch;
+			 build_checkpointer<MapType> checkpointer(this->map, this->comm, config, filename);
+			 size_t consumed = checkpointer.resume();
+			 bool resumed = (checkpointer.get_checkpoints() > 0);
+	     BL_BENCH_END(build, "resume", consumed);
+
+	     BL_BENCH_START(build);
+			 auto consumer = [this](::std::vector<typename KmerParser::value_type> & batch) {
+				 this->map.insert(batch);  // COLLECTIVE CALL...
+			 };
+			 auto block_sizer = [&checkpointer, &consumed, &block_size](size_t const & bytes, size_t const &) {
+				 consumed += bytes;
+				 checkpointer.step(consumed);  // COLLECTIVE CALL...
+				 return block_size;
+			 };
+			 auto read = bliss::io::KmerFileHelper::template read_file_streamed_adaptive<FileReader, KmerParser, SeqParser, SeqIterType>(
+					 filename, block_size, consumer, block_sizer, comm, true, consumed);
+	     BL_BENCH_END(build, "read_insert", read.second);
+
+	     BL_BENCH_START(build);
+			 checkpointer.finish(consumed);
+	     BL_BENCH_END(build, "finish", checkpointer.get_checkpoints());
+
+	     BL_BENCH_START(build);
+			 size_t m = this->map.get_multiplicity();
+			 BLISS_UNUSED(m);
+	     BL_BENCH_END(build, "multiplicity", m);
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_checkpointed", this->comm);
+			 return resumed;
+		 }
+
+		 /**
+		  * @brief  build the index with a memory budget, spilling the kmers to local disk.  collective.
+		  * @details  phase 1 reads the file in blocks and appends each kmer tuple to 1 of config.buckets spill files on this
+		  *           process, chosen by a hash of the transformed kmer, so all copies of a kmer, from all processes, are in
+		  *           the same bucket.  phase 2 inserts the buckets in passes:  consecutive buckets are grouped so that the
+		  *           tuples of a pass take at most a third of the budget on every process, leaving room for the distribute
+		  *           buffers and the map.  peak memory is then about the budget plus the map, instead of all kmers.
+		  *
+		  *           with config.output, the kmers of each pass are distinct from those of the other passes, so each pass's
+		  *           map is final, and is saved and cleared.  the map is then empty at the end, and the index is the set of
+		  *           files, each of which can be loaded or opened with the mapped layouts.
+		  * @param filename     name of the file to read
+		  * @param comm         communicator
+		  * @param config       spill directory, buckets, memory budget and output.
+		  * @return  number of passes.
+		  */
+		 template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 size_t build_external(const std::string & filename, MPI_Comm comm, external_build_config const & config = external_build_config()) {
+			 using TupleType = typename KmerParser::value_type;
+
+			 // file extension determines SeqParserType
+			 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+				 throw std::invalid_argument("input filename extension is not supported.");
+			 }
+
+			 // check to make sure that the file parser will work
+			 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+			 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+			 }
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 size_t budget = config.mem_bytes;
+			 if (budget == 0) {
+				 budget = std::numeric_limits<size_t>::max();
+				 try {
+					 budget = static_cast<size_t>(static_cast<double>(::plog::MemUsage::get_usable_mem() / this->comm.split_shared().size()) * config.mem_fraction);
+				 } catch (::bliss::io::IOException const &) {
+					 // no /proc/meminfo.  1 pass.
+				 }
+			 }
+			 size_t nbuckets = std::max(config.buckets, static_cast<size_t>(1));
+			 // the write buffers take at most 1/4 of the budget.
+			 size_t buffer_size = std::min(static_cast<size_t>(1UL << 20), budget / 4) / sizeof(TupleType) / nbuckets;
+			 ::bliss::io::spill_buckets<TupleType> spill(config.spill_dir, nbuckets, buffer_size, this->comm.rank());
+	     BL_BENCH_END(build, "budget", budget);
+
+	     BL_BENCH_START(build);
+			 ::bliss::kmer::hash::murmur<KmerType, false> hash(64, 7919);   // different seed than the distribution hash.
+			 auto bucket_of = [&hash, &nbuckets](TupleType const & x) {
+				 return static_cast<size_t>(hash(tuple_kmer(x)) % nbuckets);
+			 };
+			 auto consumer = [this, &spill, &bucket_of](::std::vector<TupleType> & batch) {
+				 this->map.transform_input(batch);
+				 spill.append(batch, bucket_of);
+			 };
+			 auto read = bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParser, SeqParser, SeqIterType>(filename, config.block_size, consumer, this->comm);
+			 spill.flush();
+	     BL_BENCH_END(build, "spill", read.second);
+
+	     BL_BENCH_COLLECTIVE_START(build, "plan", this->comm);
+			 std::vector<size_t> bucket_max = spill.sizes();
+			 if (this->comm.size() > 1) bucket_max = ::mxx::allreduce(bucket_max, ::mxx::max<size_t>(), this->comm);
+			 std::vector<size_t> passes = external_passes(bucket_max, std::max(budget / (3 * sizeof(TupleType)), static_cast<size_t>(1)));
+	     BL_BENCH_END(build, "plan", passes.size() - 1);
+
+	     BL_BENCH_START(build);
+			 std::vector<TupleType> temp;
+			 ++this->epoch;
+			 for (size_t p = 0; p + 1 < passes.size(); ++p) {
+				 temp.clear();
+				 for (size_t b = passes[p]; b < passes[p + 1]; ++b) spill.read(b, temp);
+				 consume_insert(this->map, temp);  // COLLECTIVE CALL...
+
+				 if (!config.output.empty()) {
+					 size_t m = this->map.get_multiplicity();   // sorted maps reduce here.
+					 BLISS_UNUSED(m);
+					 std::stringstream ss;
+					 ss << config.output << "." << p;
+					 this->map.save(ss.str());
+					 this->map.reset();
+				 }
+			 }
+	     BL_BENCH_END(build, "insert", passes.size() - 1);
+
+	     BL_BENCH_START(build);
+			 size_t m = this->map.get_multiplicity();
+			 BLISS_UNUSED(m);
+	     BL_BENCH_END(build, "multiplicity", this->map.local_size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_external", this->comm);
+
+			 return passes.size() - 1;
+		 }
+
+		 /// convenience function for building index with a memory budget, using posix file reads
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 size_t build_external_posix(const std::string & filename, MPI_Comm comm, external_build_config const & config = external_build_config()) {
+			 return this->template build_external<::bliss::io::posix_file, SeqParser, SeqIterType>(filename, comm, config);
+		 }
+
+		 /**
+		  * @brief build index from a list of FASTQ files in 1 pass.  files are load balanced as 1 concatenated byte space.
+		  * @param whole_files  assign whole files to processes by size instead, for many more files than processes.
+		  *                     no record search or communication until insert.  FASTA files are supported in this mode.
+		  */
+		 template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_multi(const std::vector<std::string> & filenames, MPI_Comm comm, bool whole_files = false) {
+
+			 // check to make sure that the file parser will work.  extension is checked by read_files.
+			 if (!whole_files && !std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value) {
+				 throw std::invalid_argument("Specified File Parser template parameter does not support multiple files.  only FASTQ is supported.");
+			 }
+	     BL_BENCH_INIT(build);
+
+			 // proceed
+	     BL_BENCH_START(build);
+			 ::std::vector<typename KmerParser::value_type> temp;
+			 bliss::io::KmerFileHelper::template read_files<FileReader, KmerParser, SeqParser, SeqIterType>(filenames, temp, comm, whole_files);
+	     BL_BENCH_END(build, "read", temp.size());
+
+	     BL_BENCH_START(build);
+			 this->insert(::std::move(temp));
+	     BL_BENCH_END(build, "insert", this->map.local_size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_multi", this->comm);
+		 }
+
+		 /// convenience function for building index from a list of files, using posix file reads
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_multi_posix(const std::vector<std::string> & filenames, MPI_Comm comm, bool whole_files = false) {
+			 this->template build_multi<::bliss::io::posix_file, SeqParser, SeqIterType>(filenames, comm, whole_files);
+		 }
+
+
 
 
    typename MapType::const_iterator cbegin() const
@@ -384,16 +1098,326 @@ public:
    }
 
    size_t size() const {
-     return map.size();
+     return frozen ? frozen->size() : map.size();
    }
 
    size_t local_size() const {
-     return map.local_size();
+     return frozen ? frozen->local_size() : map.local_size();
    }
 
+protected:
+	FindResultType uncached_find(std::vector<KmerType> &query) const {
+		if (frozen) return frozen->find(query);
+		return map.find(query);
+	}
+	CountResultType uncached_count(std::vector<KmerType> &query) const {
+		if (frozen) return frozen->count(query);
+		return map.count(query);
+	}
+
+	/// unique input transformed queries, split into the cached ones and the misses.  query is replaced by the misses.
+	template <typename Cache, typename HitOp>
+	void split_cached(std::vector<KmerType> &query, Cache & cache, HitOp const & on_hit) const {
+		cache.validate(epoch);
+		map.transform_input(query);
+		bool sorted = false;
+		::fsc::unique(query, sorted, ::bliss::kmer::hash::farm<KmerType, false>(), ::std::equal_to<KmerType>());
+
+		size_t misses = 0;
+		for (size_t i = 0; i < query.size(); ++i) {
+			auto v = cache.find(query[i]);
+			if (v == nullptr) query[misses++] = query[i];
+			else on_hit(query[i], *v);
+		}
+		query.resize(misses);
+	}
+
+	/// find with the cache:  hits are answered locally, and the misses with 1 collective find.  collective.
+	FindResultType cached_find(std::vector<KmerType> &query) const {
+		BL_BENCH_INIT(cached_find);
+
+		BL_BENCH_START(cached_find);
+		FindResultType results;
+		split_cached(query, find_cache, [&results](KmerType const & k, typename FindCacheType::value_type const & vals) {
+			for (auto const & v : vals) results.emplace_back(k, v);
+		});
+		size_t hits = results.size();
+		BL_BENCH_END(cached_find, "cache_lookup", query.size());
+
+		// find reorders and distributes its queries.
+		BL_BENCH_COLLECTIVE_START(cached_find, "find", this->comm);
+		std::vector<KmerType> misses(query);
+		FindResultType found = uncached_find(misses);
+		BL_BENCH_END(cached_find, "find", found.size());
+
+		// the results are keyed by the input transformed kmers, as are the misses.  cache the misses without entries too.
+		BL_BENCH_START(cached_find);
+		::std::unordered_map<KmerType, typename FindCacheType::value_type, ::bliss::kmer::hash::farm<KmerType, false> > grouped(query.size());
+		for (auto const & k : query) grouped[k];
+		for (auto const & x : found) grouped[x.first].emplace_back(x.second);
+		for (auto const & g : grouped) find_cache.insert(g.first, g.second);
+		results.insert(results.end(), found.begin(), found.end());
+		BL_BENCH_END(cached_find, "cache_insert", results.size() - hits);
+
+		BL_BENCH_REPORT_MPI_NAMED(cached_find, "index:cached_find", this->comm);
+		return results;
+	}
+
+	/// count with the cache:  hits are answered locally, and the misses with 1 collective count.  collective.
+	CountResultType cached_count(std::vector<KmerType> &query) const {
+		BL_BENCH_INIT(cached_count);
+
+		BL_BENCH_START(cached_count);
+		CountResultType results;
+		split_cached(query, count_cache, [&results](KmerType const & k, typename CountCacheType::value_type const & c) {
+			results.emplace_back(k, c);
+		});
+		BL_BENCH_END(cached_count, "cache_lookup", query.size());
+
+		BL_BENCH_COLLECTIVE_START(cached_count, "count", this->comm);
+		std::vector<KmerType> misses(query);
+		CountResultType counted = uncached_count(misses);
+		BL_BENCH_END(cached_count, "count", counted.size());
+
+		// 1 result per unique query, including the absent ones.
+		BL_BENCH_START(cached_count);
+		for (auto const & x : counted) count_cache.insert(x.first, x.second);
+		results.insert(results.end(), counted.begin(), counted.end());
+		BL_BENCH_END(cached_count, "cache_insert", counted.size());
+
+		BL_BENCH_REPORT_MPI_NAMED(cached_count, "index:cached_count", this->comm);
+		return results;
+	}
+
 };
 
 
+/// true if all the k-mer parsers have the same window size, so they can share 1 loaded partition.
+template <typename... Parsers>
+struct same_window_size : public ::std::true_type {};
+template <typename P, typename Q, typename... Parsers>
+struct same_window_size<P, Q, Parsers...> :
+  public ::std::integral_constant<bool, (P::window_size == Q::window_size) && same_window_size<Q, Parsers...>::value> {};
+
+/// parse the k-mers of 1 index from a loaded partition, and insert them.  collective.
+template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename IndexType>
+size_t build_from_partition(IndexType & index, ::bliss::io::file_data const & partition, const mxx::comm & comm) {
+	std::vector<typename IndexType::KmerParserType::value_type> temp;
+	::bliss::io::KmerFileHelper::template parse_file_data_old<typename IndexType::KmerParserType, SeqParser, SeqIterType>(partition, temp, comm);
+	size_t n = temp.size();
+	index.insert(::std::move(temp));  // COLLECTIVE CALL...
+	return n;
+}
+
+/**
+ * @brief build several indices from 1 read of a file, e.g. a count, a position, and a position quality index.  collective.
+ * @details  the file is opened and loaded once.  then each index's parser runs over the loaded partition and its k-mers are
+ *        inserted, 1 index at a time, so the k-mers of only 1 index are in memory at a time.
+ *        the parsers generate different tuples, so the k-mers are generated once per index.
+ * @tparam FileType   e.g. ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser>
+ * @tparam Indices    Index types.  their k-mer parsers need the same window size.
+ */
+template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+	typename... Indices>
+void build_indices(const std::string & filename, const mxx::comm & comm, Indices &... indices) {
+	static_assert(sizeof...(Indices) > 0, "build_indices needs at least 1 index");
+	static_assert(same_window_size<typename Indices::KmerParserType...>::value, "the k-mer parsers need the same window size");
+	constexpr int kmer_size = ::std::tuple_element<0, ::std::tuple<typename Indices::KmerParserType...> >::type::window_size;
+
+	BL_BENCH_INIT(build);
+
+	BL_BENCH_START(build);
+	::bliss::io::file_data partition = ::bliss::io::KmerFileHelper::template open_file<FileType>(filename, kmer_size - 1, comm);
+	BL_BENCH_END(build, "open", partition.getRange().size());
+
+	BL_BENCH_START(build);
+	size_t total = 0;
+	int dummy[] = {0, (total += build_from_partition<SeqParser, SeqIterType>(indices, partition, comm), 0)...};
+	BLISS_UNUSED(dummy);
+	BL_BENCH_END(build, "parse_insert", total);
+
+	BL_BENCH_REPORT_MPI_NAMED(build, "index:build_indices", comm);
+}
+
+
+/// true if all the k-mer types have the same alphabet, so their k-mers can be generated from 1 packed copy of the reads.
+template <typename... Kmers>
+struct same_alphabet : public ::std::true_type {};
+template <typename P, typename Q, typename... Kmers>
+struct same_alphabet<P, Q, Kmers...> :
+  public ::std::integral_constant<bool, ::std::is_same<typename P::KmerAlphabet, typename Q::KmerAlphabet>::value && same_alphabet<Q, Kmers...>::value> {};
+
+/// k-mers of the indices of build_multi_k, input transformed and grouped by owner.  1 part per index, in a recursive list.
+template <typename... Indices>
+struct multi_k_parts {
+	template <typename PackedData>
+	size_t generate(PackedData const &, int const &) { return 0; }
+	void segments(int const &, size_t *, size_t &) const {}
+	static void bytes(size_t const *, size_t &) {}
+	void pack(int const &, size_t *, char *&) const {}
+	void unpack(size_t const *, char const *&) {}
+	void release() {}
+	void insert() {}
+};
+template <typename IndexType, typename... Indices>
+struct multi_k_parts<IndexType, Indices...> {
+	using value_type = typename IndexType::KmerParserType::value_type;
+
+	std::vector<value_type> entries;
+	/// number of entries for each owner.
+	std::vector<size_t> counts;
+	multi_k_parts<Indices...> rest;
+
+	/// generate the k-mers from the packed reads, and group them by owner.
+	template <typename PackedData>
+	size_t generate(PackedData const & data, int const & p, IndexType const & index, Indices const &... indices) {
+		std::vector<value_type> temp;
+		::bliss::io::KmerFileHelper::template parse_packed_data<typename IndexType::KmerParserType>(data, temp);
+		index.get_map().transform_input(temp);
+
+		std::vector<int> ranks;
+		index.get_map().owners(temp, ranks);
+		counts.assign(p, 0);
+		for (size_t i = 0; i < ranks.size(); ++i) ++counts[ranks[i]];
+		std::vector<size_t> offsets(p, 0);
+		std::partial_sum(counts.begin(), counts.end() - 1, offsets.begin() + 1);
+		entries.resize(temp.size());
+		for (size_t i = 0; i < temp.size(); ++i) entries[offsets[ranks[i]]++] = temp[i];
+
+		return entries.size() + rest.generate(data, p, indices...);
+	}
+
+	/// segment sizes of the message to rank r, 1 per index, and the message bytes.
+	void segments(int const & r, size_t * seg, size_t & bytes) const {
+		*seg = counts[r];
+		bytes += counts[r] * sizeof(value_type);
+		rest.segments(r, seg + 1, bytes);
+	}
+
+	/// bytes of a message with seg entries per index.
+	static void bytes(size_t const * seg, size_t & bytes) {
+		bytes += *seg * sizeof(value_type);
+		multi_k_parts<Indices...>::bytes(seg + 1, bytes);
+	}
+
+	/// copy the segments of rank r to out, and advance out.  starts are the first entries for rank r, 1 per index.
+	void pack(int const & r, size_t * starts, char *& out) const {
+		size_t bytes = counts[r] * sizeof(value_type);
+		memcpy(out, entries.data() + *starts, bytes);
+		out += bytes;
+		*starts += counts[r];
+		rest.pack(r, starts + 1, out);
+	}
+
+	/// append the received segments of 1 source, with seg entries per index.
+	void unpack(size_t const * seg, char const *& in) {
+		size_t before = entries.size();
+		entries.resize(before + *seg);
+		memcpy(entries.data() + before, in, *seg * sizeof(value_type));
+		in += *seg * sizeof(value_type);
+		rest.unpack(seg + 1, in);
+	}
+
+	void release() {
+		std::vector<value_type>().swap(entries);
+		rest.release();
+	}
+
+	/// insert into each index in turn.  collective.
+	void insert(IndexType & index, Indices &... indices) {
+		index.insert(::std::move(entries));  // COLLECTIVE CALL...
+		rest.insert(indices...);
+	}
+};
+
+/**
+ * @brief build several indices with different k, e.g. k = 21, 31, 51, from 1 read of a FASTQ file and 1 k-mer exchange.  collective.
+ * @details  the file is loaded and its reads are packed 2 bits per base (see KmerFileHelper::pack_block) once.  the k-mers
+ *        of each index are generated directly from the packed words, input transformed, and grouped by their owner in
+ *        that index's map.  then the k-mers of all indices for each process go in 1 message, with 1 segment per index
+ *        whose sizes are exchanged in place of the message sizes, as in densehash_map::insert_count_find.  each index
+ *        then inserts its received k-mers, which are already on their owners, so its distribute sends no k-mers.
+ *        all indices' k-mers are in memory at once.  only for the hashed maps, and the parsers supported by packed
+ *        sequences, i.e. KmerParser, KmerPositionTupleParser, and KmerCountTupleParser.
+ * @tparam FileType   e.g. ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser>
+ * @tparam Indices    Index types.  their k-mers need the same alphabet.  the k may differ, as may the maps.
+ */
+template <typename FileType, typename... Indices>
+void build_multi_k(const std::string & filename, const mxx::comm & comm, Indices &... indices) {
+	static_assert(sizeof...(Indices) > 0, "build_multi_k needs at least 1 index");
+	static_assert(same_alphabet<typename Indices::KmerType...>::value, "the k-mers need the same alphabet");
+	using Alphabet = typename ::std::tuple_element<0, ::std::tuple<typename Indices::KmerType...> >::type::KmerAlphabet;
+	constexpr size_t nk = sizeof...(Indices);
+
+	std::string extension = ::bliss::utils::file::get_file_extension(filename);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension.compare("fastq") != 0) {
+		throw std::invalid_argument("build_multi_k supports FASTQ files only.");
+	}
+
+	BL_BENCH_INIT(build);
+
+	// pack the reads once.  FASTQ records are complete in a partition, so no overlap is needed.
+	BL_BENCH_START(build);
+	multi_k_parts<Indices...> parts;
+	int const p = comm.size();
+	size_t total = 0;
+	{
+		typename ::bliss::io::packed_sequence_file<Alphabet>::data_type data;
+		size_t seqs = 0;
+		{
+			::bliss::io::file_data partition = ::bliss::io::KmerFileHelper::template open_file<FileType>(filename, 0, comm);
+			::bliss::io::FASTQParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+			seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), comm);
+			if (partition.getRange().size() > 0) {
+				seqs = ::bliss::io::KmerFileHelper::template pack_block<Alphabet>(partition, seq_parser, data);
+			}
+		}
+		BL_BENCH_END(build, "pack", seqs);
+
+		BL_BENCH_START(build);
+		total = parts.generate(data, p, indices...);
+		BL_BENCH_END(build, "generate", total);
+	}
+
+	if (p > 1) {
+		// segment sizes, by destination then index.
+		BL_BENCH_START(build);
+		std::vector<size_t> segments(nk * p);
+		std::vector<size_t> send_bytes(p, 0);
+		for (int r = 0; r < p; ++r) parts.segments(r, segments.data() + nk * r, send_bytes[r]);
+		std::vector<char> sendbuf(std::accumulate(send_bytes.begin(), send_bytes.end(), static_cast<size_t>(0)));
+		{
+			char * out = sendbuf.data();
+			std::vector<size_t> starts(nk, 0);
+			for (int r = 0; r < p; ++r) parts.pack(r, starts.data(), out);
+		}
+		parts.release();
+		BL_BENCH_END(build, "pack_kmers", sendbuf.size());
+
+		BL_BENCH_COLLECTIVE_START(build, "a2a", comm);
+		std::vector<size_t> recv_segments(nk * p);
+		::mxx::all2all(segments.data(), nk, recv_segments.data(), comm);
+		std::vector<size_t> recv_bytes(p, 0);
+		for (int r = 0; r < p; ++r) multi_k_parts<Indices...>::bytes(recv_segments.data() + nk * r, recv_bytes[r]);
+		std::vector<char> recvbuf(std::accumulate(recv_bytes.begin(), recv_bytes.end(), static_cast<size_t>(0)));
+		::mxx::all2allv(sendbuf.data(), send_bytes, recvbuf.data(), recv_bytes, comm);
+		std::vector<char>().swap(sendbuf);
+		BL_BENCH_END(build, "a2a", recvbuf.size());
+
+		BL_BENCH_START(build);
+		char const * in = recvbuf.data();
+		for (int r = 0; r < p; ++r) parts.unpack(recv_segments.data() + nk * r, in);
+		BL_BENCH_END(build, "unpack", recvbuf.size());
+	}
+
+	BL_BENCH_START(build);
+	parts.insert(indices...);
+	BL_BENCH_END(build, "insert", total);
+
+	BL_BENCH_REPORT_MPI_NAMED(build, "index:build_multi_k", comm);
+}
+
 
 // TODO: the types of Map that is used should be restricted.  (perhaps via map traits)
 template <typename MapType>
@@ -402,6 +1426,119 @@ using KmerIndex = Index<MapType, KmerParser<typename MapType::key_type> >;
 template <typename MapType>
 using PositionIndex = Index<MapType, KmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
 
+/**
+ * @brief position index that stores each position once, under the canonical kmer, with the strand in the kmer_strand bit.
+ * @details  the parser canonicalizes while generating, so the map's storage needs no transform.  query kmers are replaced
+ *        by their canonical kmers in batch, so 1 lookup finds the positions of both strands.  a position is on the
+ *        query's strand if its strand bit equals whether the query kmer was replaced.
+ */
+template <typename MapType>
+class CanonicalPositionIndex :
+	public Index<MapType, CanonicalKmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > > {
+protected:
+	using BaseType = Index<MapType, CanonicalKmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
+
+public:
+	using KmerType = typename BaseType::KmerType;
+	using ValueType = typename BaseType::ValueType;
+	using strand = ::bliss::common::kmer_strand<ValueType>;
+
+	// the predicate only overloads.
+	using BaseType::find_if;
+	using BaseType::count_if;
+	using BaseType::erase_if;
+
+	CanonicalPositionIndex(const mxx::comm& _comm) : BaseType(_comm) {}
+
+	virtual ~CanonicalPositionIndex() {};
+
+	/// replace each kmer by its canonical kmer, using the batch reverse complement.
+	static void canonicalize(std::vector<KmerType> & query) {
+		std::vector<KmerType> rc(query.size());
+		::bliss::common::reverse_complement(query.data(), rc.data(), query.size());
+		for (size_t i = 0; i < query.size(); ++i) {
+			if (rc[i] < query[i]) query[i] = rc[i];
+		}
+	}
+
+	/// query is canonicalized in place.
+	auto find(std::vector<KmerType> &query) const
+		-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+		canonicalize(query);
+		if (this->find_cache.enabled()) return this->cached_find(query);
+		return this->map.find(query);
+	}
+	auto count(std::vector<KmerType> &query) const
+	-> decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>())){
+		canonicalize(query);
+		if (this->count_cache.enabled()) return this->cached_count(query);
+		return this->map.count(query);
+	}
+	template <typename Predicate>
+	auto find_if(std::vector<KmerType> &query, Predicate const &pred) const
+	-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+		canonicalize(query);
+		return this->map.find(query, false, pred);
+	}
+	template <typename Predicate>
+	auto count_if(std::vector<KmerType> &query, Predicate const &pred) const
+	-> decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>())) {
+		canonicalize(query);
+		return this->map.count(query, false, pred);
+	}
+	void erase(std::vector<KmerType> &query) {
+		canonicalize(query);
+		++this->epoch;
+		this->map.erase(query);
+	}
+	template <typename Predicate>
+	void erase_if(std::vector<KmerType> &query, Predicate const &pred) {
+		canonicalize(query);
+		++this->epoch;
+		this->map.erase(query, false, pred);
+	}
+};
+
+/**
+ * @brief sparse position index that stores only the (w,k) minimizer positions of each sequence, about 2/(W+1) of them.
+ * @details  for large references, e.g. W = 10 stores and sends about 1/5 of the positions.  a query has to be reduced
+ *        to its minimizers with sample() before find or count, so that it looks up the same kmers that were selected
+ *        when building.  a substring of at least W + k - 1 chars shared by the query and a reference sequence finds
+ *        at least 1 of its reference positions.  the sampling is strand symmetric, so canonical maps also work.
+ */
+template <typename MapType, unsigned int W = 10>
+class MinimizerPositionIndex :
+	public Index<MapType, MinimizerKmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type>, W> > {
+protected:
+	using BaseType = Index<MapType, MinimizerKmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type>, W> >;
+
+public:
+	using KmerType = typename BaseType::KmerType;
+	using ValueType = typename BaseType::ValueType;
+	static constexpr unsigned int window = W;
+
+	MinimizerPositionIndex(const mxx::comm& _comm) : BaseType(_comm) {}
+
+	virtual ~MinimizerPositionIndex() {};
+
+	/**
+	 * @brief reduce query, the consecutive kmers of 1 sequence, to its minimizers, in place.
+	 * @return the offsets of the kept kmers in the original query, e.g. to map the positions found back to the query.
+	 */
+	static std::vector<size_t> sample(std::vector<KmerType> & query) {
+		std::vector<size_t> offsets;
+		::bliss::common::minimizer_sampler<KmerType, W> sampler;
+		sampler.select(query.begin(), query.end(), ::std::back_inserter(offsets));
+
+		for (size_t i = 0; i < offsets.size(); ++i) query[i] = query[offsets[i]];
+		query.resize(offsets.size());
+		return offsets;
+	}
+};
+
+template <typename MapType, unsigned int W>
+constexpr unsigned int MinimizerPositionIndex<MapType, W>::window;
+
 template <typename MapType>
 using PositionQualityIndex = Index<MapType, KmerPositionQualityTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
 
@@ -409,6 +1546,190 @@ template <typename MapType>
 using CountIndex = Index<MapType, KmerCountTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
 template <typename MapType>
 using CountIndex2 = Index<MapType, KmerParser<typename MapType::key_type> >;
+/// count index of FASTQ files, with quality trimming and kmer quality filtering at parse time, before distribution.  see QualityFilteredKmerParser.
+template <typename MapType, unsigned int TrimPhred = 3, unsigned int MinKmerPhred = 10>
+using QualityFilteredCountIndex = Index<MapType, QualityFilteredKmerParser<typename MapType::key_type,
+    ::bliss::index::Illumina18QualityScoreCodec, TrimPhred, MinKmerPhred> >;
+/// six frame peptide kmer index of DNA reads.  see TranslatedKmerParser.  both strands are generated, so use single strand map params.
+template <typename MapType>
+using TranslatedKmerIndex = Index<MapType, TranslatedKmerParser<typename MapType::key_type> >;
+
+/**
+ * @brief approximate count index in fixed memory, with a distributed Count-Min sketch instead of a map.
+ * @details  for kmer abundance screening where the distinct kmers do not fit in memory.  only the 64 bit kmer
+ *        fingerprints are distributed.  counts are never underestimated, and overestimated by at most
+ *        epsilon * (kmers of the owner process) with probability 1 - delta.  see dsc::count_min_sketch.
+ *        kmers cannot be enumerated, so there is no find, erase, or iteration.
+ * @tparam MapParams  e.g. CanonicalHashMapParams, for canonical counts.  the storage hash of MapParams is the fingerprint.
+ */
+template <typename Kmer, template <typename> class MapParams, typename Counter = uint32_t, bool Conservative = true>
+class ApproximateCountIndex {
+public:
+	using KmerType = Kmer;
+	using SketchType = ::dsc::count_min_sketch<Kmer, MapParams, Counter, Conservative>;
+	using KmerParserType = KmerParser<Kmer>;
+	using EstimateType = typename SketchType::estimate_type;
+
+protected:
+	SketchType sketch;
+	const mxx::comm& comm;
+
+public:
+	ApproximateCountIndex(const mxx::comm& _comm, double const & epsilon = 1.0e-5, double const & delta = 0.01) :
+		sketch(_comm, epsilon, delta), comm(_comm) {}
+
+	virtual ~ApproximateCountIndex() {};
+
+	SketchType & get_map() { return sketch; }
+	SketchType const & get_map() const { return sketch; }
+
+	/// kmers inserted, over all processes.
+	size_t size() const { return sketch.size(); }
+	size_t local_size() const { return sketch.local_size(); }
+	/// maximum overestimate of any count, with probability 1 - delta.
+	size_t error_bound() const { return sketch.error_bound(); }
+
+	/// count 1 occurrence of each kmer.  collective.  input is transformed.
+	void insert(std::vector<Kmer> & input) {
+		sketch.insert(input);
+	}
+
+	/// estimated count and error bound of each kmer, in query order.  collective.  query is transformed.
+	std::vector<EstimateType> query(std::vector<Kmer> & query) const {
+		return sketch.query(query);
+	}
+	/// estimated count of each kmer, in query order.  collective.  query is transformed.
+	std::vector<std::pair<Kmer, size_t> > count(std::vector<Kmer> & query) const {
+		return sketch.count(query);
+	}
+
+	/**
+	 * @brief  build by reading the file one block at a time and counting the kmers for each block.  collective.
+	 * @details  memory is the sketch plus the kmers of 1 block, independent of the number of distinct kmers.
+	 */
+	template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	void build_streaming(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+		std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			throw std::invalid_argument("input filename extension is not supported.");
+		}
+
+		if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		} else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		}
+
+		BL_BENCH_INIT(build);
+
+		BL_BENCH_START(build);
+		auto consumer = [this](::std::vector<Kmer> & batch) {
+			this->sketch.insert(batch);  // COLLECTIVE CALL...
+		};
+		auto read = bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParserType, SeqParser, SeqIterType>(filename, block_size, consumer, comm);
+		BL_BENCH_END(build, "read_insert", read.second);
+
+		BL_BENCH_REPORT_MPI_NAMED(build, "index:approx_build_streaming", this->comm);
+	}
+
+	/// convenience function for building with posix file reads
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	void build_posix(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+		this->template build_streaming<::bliss::io::posix_file, SeqParser, SeqIterType>(filename, comm, block_size);
+	}
+};
+
+/**
+ * @brief exact count index for small k, with an array indexed by the packed kmer instead of a map.
+ * @details  for spectrum and minimizer statistics with k * bitsPerChar <= 28.  kmers are counted locally without hashing
+ *        or communication, and the counts are combined with 1 reduce-scatter at the first query or at finalize.
+ *        see dsc::direct_count_map.  there is no find or erase.
+ * @tparam MapParams  e.g. CanonicalHashMapParams, for canonical counts.  only the input transform is used.
+ */
+template <typename Kmer, template <typename> class MapParams, typename Counter = uint32_t>
+class DirectCountIndex {
+public:
+	using KmerType = Kmer;
+	using MapType = ::dsc::direct_count_map<Kmer, MapParams, Counter>;
+	using KmerParserType = KmerParser<Kmer>;
+
+protected:
+	MapType map;
+	const mxx::comm& comm;
+
+public:
+	DirectCountIndex(const mxx::comm& _comm) : map(_comm), comm(_comm) {}
+
+	virtual ~DirectCountIndex() {};
+
+	MapType & get_map() { return map; }
+	MapType const & get_map() const { return map; }
+
+	/// kmers inserted, over all processes.  collective.
+	size_t size() const { return map.size(); }
+	size_t local_size() const { return map.local_size(); }
+
+	/// count 1 occurrence of each kmer.  local.  input is transformed.
+	void insert(std::vector<Kmer> & input) {
+		map.insert(input);
+	}
+
+	/// combine the counts of all processes.  collective.  optional, the first count does it too.
+	void finalize() {
+		map.finalize();
+	}
+
+	/// count of each kmer, in query order.  collective.  query is transformed.
+	std::vector<std::pair<Kmer, size_t> > count(std::vector<Kmer> & query) {
+		return map.count(query);
+	}
+
+	/**
+	 * @brief  build by reading the file one block at a time and counting the kmers for each block.  collective.
+	 * @details  memory is the count array plus the kmers of 1 block.
+	 */
+	template <typename FileReader, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	void build_streaming(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+		std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			throw std::invalid_argument("input filename extension is not supported.");
+		}
+
+		if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		} else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		}
+
+		BL_BENCH_INIT(build);
+
+		BL_BENCH_START(build);
+		auto consumer = [this](::std::vector<Kmer> & batch) {
+			this->map.insert(batch);
+		};
+		auto read = bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParserType, SeqParser, SeqIterType>(filename, block_size, consumer, comm);
+		BL_BENCH_END(build, "read_insert", read.second);
+
+		BL_BENCH_COLLECTIVE_START(build, "combine", this->comm);
+		map.finalize();
+		BL_BENCH_END(build, "combine", map.local_size());
+
+		BL_BENCH_REPORT_MPI_NAMED(build, "index:direct_build_streaming", this->comm);
+	}
+
+	/// convenience function for building with posix file reads
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	void build_posix(const std::string & filename, MPI_Comm comm, size_t const & block_size = (1UL << 26)) {
+		this->template build_streaming<::bliss::io::posix_file, SeqParser, SeqIterType>(filename, comm, block_size);
+	}
+};
+
+/// count index chosen from the kmer size at compile time:  DirectCountIndex for small k, else HashedCountIndex.
+template <typename Kmer, template <typename> class MapParams, typename HashedCountIndex, typename Counter = uint32_t>
+using SmallKmerCountIndex = typename ::std::conditional<::dsc::direct_count_fits<Kmer>::value,
+		DirectCountIndex<Kmer, MapParams, Counter>, HashedCountIndex>::type;
 
 // template aliases for hash to be used as distribution hash
 template <typename Key>
@@ -419,6 +1740,10 @@ template <typename Key>
 using DistHashStd = ::bliss::kmer::hash::cpp_std<Key, true>;
 template <typename Key>
 using DistHashIdentity = ::bliss::kmer::hash::identity<Key, true>;
+template <typename Key>
+using DistHashCRC32C = ::bliss::kmer::hash::crc32c<Key, true>;
+template <typename Key>
+using DistHashCLHash = ::bliss::kmer::hash::clhash<Key, true>;
 
 
 template <typename Key>
@@ -429,6 +1754,10 @@ template <typename Key>
 using StoreHashStd = ::bliss::kmer::hash::cpp_std<Key, false>;
 template <typename Key>
 using StoreHashIdentity = ::bliss::kmer::hash::identity<Key, false>;
+template <typename Key>
+using StoreHashCRC32C = ::bliss::kmer::hash::crc32c<Key, false>;
+template <typename Key>
+using StoreHashCLHash = ::bliss::kmer::hash::clhash<Key, false>;
 
 // =================  Partially defined aliases for MapParams, for distributed_xxx_maps.
 // NOTE: when using this, need to further alias so that only Key param remains.
@@ -480,6 +1809,66 @@ using BimoleculeHashMapParams = ::dsc::HashMapParams<
 		    ::std::equal_to
 		  >;
 
+// =================  minimizer distribution:  consecutive kmers of a read go to the same rank, for super-kmer insertion.
+template <typename Key>
+using DistTransMinimizer = ::bliss::kmer::transform::default_minimizer<Key>;
+
+template <typename Key,
+	template <typename> class DistHash  = DistHashMurmur,
+	template <typename> class StoreHash = StoreHashMurmur
+>
+using SingleStrandMinimizerHashMapParams = SingleStrandHashMapParams<Key, DistHash, StoreHash, DistTransMinimizer>;
+
+template <typename Key,
+	template <typename> class DistHash  = DistHashMurmur,
+	template <typename> class StoreHash = StoreHashMurmur
+>
+using CanonicalMinimizerHashMapParams = ::dsc::HashMapParams<
+		Key,
+		::bliss::kmer::transform::lex_less,  // precanonalizer
+		 DistTransMinimizer,  // strand symmetric, so ranks can be computed before canonicalization
+		  DistHash,
+		  ::std::equal_to,
+		   ::bliss::transform::identity,
+		    StoreHash,
+		    ::std::equal_to
+		  >;
+
+// =================  single hash variants:  one 64 bit hash per kmer, high bits choose the rank and low bits are used by the local table.
+template <typename Key,
+			template <typename> class Hash = StoreHashMurmur,
+			template <typename> class Trans = ::bliss::transform::identity
+			>
+using SingleStrandSingleHashMapParams = ::dsc::SingleHashMapParams<
+		Key,
+		::bliss::transform::identity,  // precanonalizer
+		 Trans,  				// could be iden, xor, lex_less
+		  Hash,
+		  ::std::equal_to
+		  >;
+
+template <typename Key,
+	template <typename> class Hash = StoreHashMurmur
+>
+using CanonicalSingleHashMapParams = ::dsc::SingleHashMapParams<
+		Key,
+		::bliss::kmer::transform::lex_less,  // precanonalizer
+		 ::bliss::transform::identity,
+		  Hash,
+		  ::std::equal_to
+		  >;
+
+template <typename Key,
+	template <typename> class Hash = StoreHashMurmur
+	>
+using BimoleculeSingleHashMapParams = ::dsc::SingleHashMapParams<
+		Key,
+		::bliss::transform::identity,  // precanonalizer - only one that makes sense for bimole
+		 ::bliss::kmer::transform::lex_less,  // only one that makes sense for bimole
+		  Hash,
+		  ::std::equal_to
+		  >;
+
 //template <typename Key,
 //			template <typename> class DistHash = DistHashMurmur,
 //			template <typename> class StoreLess = ::std::less,
@@ -560,6 +1949,21 @@ using BimoleculeSortedMapParams = ::dsc::SortedMapParams<
 		    Less,
 		    ::std::equal_to
 		  >;
+
+// =================  allocators for the local containers (Alloc parameter of the maps).  the large tables get huge pages.
+// e.g. ::dsc::counting_densehash_map<KmerType, uint32_t, CanonicalHashMapParams, SpecialKeys, HugePageAlloc<::std::pair<const KmerType, uint32_t> > >
+//  or  ::dsc::counting_sorted_map<KmerType, uint32_t, CanonicalSortedMapParams, HugePageAlloc<::std::pair<KmerType, uint32_t> > >
+template <typename T>
+using HugePageAlloc = ::fsc::hugepage_allocator<T>;
+
+/// pages interleaved over the NUMA nodes, for tables shared by the processes of a node.
+template <typename T>
+using InterleavedHugePageAlloc = ::fsc::hugepage_allocator<T, ::fsc::interleaved_hugepage_policy>;
+
+/// 1 GB pages from the hugetlbfs pool, or transparent huge pages if the pool is empty.
+template <typename T>
+using GigaPageAlloc = ::fsc::hugepage_allocator<T, ::fsc::hugepage_policy<::fsc::hugepage_kind::hugetlb_1g> >;
+
 } /* namespace kmer */
 
 } /* namespace index */
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_text_export.hpp
+ * @ingroup index
+ * @brief   collective export of a count index to 1 tab separated text file, "kmer\tcount\n" per kmer.
+ * @details  each process formats a chunk of its local entries into a buffer, and all processes write their buffers with
+ *          1 MPI_File_write_at_all per chunk, at offsets from an exscan of the buffer sizes.  memory is bounded by the
+ *          chunk, via Index::scan.  kmers are decoded without operator<<:  2 bit alphabets (DNA, RNA) decode 4 characters
+ *          per byte with a 256 entry table, others 1 character per shift.  counts are formatted with an integer to
+ *          decimal loop instead of iostreams.
+ *
+ *          with sorted, the entries are written in kmer order, 1 window of kmer prefixes at a time via
+ *          dsc::sorted_export, so memory stays bounded by about the chunk instead of a copy of the local entries.
+ */
+#ifndef BLISS_INDEX_KMER_TEXT_EXPORT_HPP
+#define BLISS_INDEX_KMER_TEXT_EXPORT_HPP
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>    // min, max
+#include <type_traits>
+#include <cstdint>
+#include <cstring>      // memcpy
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/sorted_export.hpp"
+#include "io/io_exception.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// formats (kmer, count) as 1 line of text.
+template <typename KmerType>
+struct kmer_text_formatter {
+    using Alphabet = typename KmerType::KmerAlphabet;
+    using WordType = typename KmerType::KmerWordType;
+
+    /// longest line:  kmer, tab, 20 digits, newline.
+    static constexpr size_t max_line = KmerType::size + 22;
+
+  protected:
+    /// the 4 characters of each byte of a 2 bit kmer, the first character from the high bits.
+    struct byte_table {
+        char chars[256][4];
+
+        byte_table() {
+          for (size_t b = 0; b < 256; ++b)
+            for (size_t j = 0; j < 4; ++j)
+              chars[b][j] = Alphabet::TO_ASCII[(b >> (6 - 2 * j)) & 0x3];
+        }
+    };
+    static byte_table const & table() {
+      static const byte_table t;
+      return t;
+    }
+
+    /// byte j of the kmer's bits, from the least significant.  the last character is in the low bits.
+    static inline uint8_t get_byte(KmerType const & km, size_t const & j) {
+      return static_cast<uint8_t>(km.getData()[j / sizeof(WordType)] >> (8 * (j % sizeof(WordType))));
+    }
+
+    static inline void format_kmer(KmerType const & km, char * out, ::std::true_type const &) {
+      byte_table const & t = table();
+      constexpr size_t full = KmerType::size / 4;
+      constexpr size_t rem = KmerType::size % 4;
+
+      char * end = out + KmerType::size;
+      for (size_t j = 0; j < full; ++j) memcpy(end - 4 * (j + 1), t.chars[get_byte(km, j)], 4);
+      if (rem > 0) memcpy(out, t.chars[get_byte(km, full)] + (4 - rem), rem);
+    }
+
+    static inline void format_kmer(KmerType const & km, char * out, ::std::false_type const &) {
+      KmerType cpy(km);
+      size_t mask = (1 << KmerType::bitsPerChar) - 1;
+      for (size_t i = KmerType::size; i > 0; --i) {
+        out[i - 1] = Alphabet::TO_ASCII[static_cast<size_t>(mask & cpy.getData()[0])];
+        cpy >>= 1;
+      }
+    }
+
+  public:
+    /// write the line to out, which has room for max_line chars.  returns the line length.
+    template <typename V>
+    static inline size_t format(KmerType const & km, V const & count, char * out) {
+      static_assert(::std::is_integral<V>::value, "text export needs integer values, e.g. counts.");
+
+      format_kmer(km, out, ::std::integral_constant<bool, KmerType::bitsPerChar == 2>());
+      char * p = out + KmerType::size;
+      *p = '\t';
+      ++p;
+
+      // digits in reverse, then copied in order.
+      char digits[20];
+      size_t n = 0;
+      uint64_t x = static_cast<uint64_t>(count);
+      do {
+        digits[n++] = static_cast<char>('0' + (x % 10));
+        x /= 10;
+      } while (x > 0);
+      for (size_t i = 0; i < n; ++i) p[i] = digits[n - 1 - i];
+      p += n;
+      *p = '\n';
+      ++p;
+      return p - out;
+    }
+};
+
+template <typename KmerType>
+constexpr size_t kmer_text_formatter<KmerType>::max_line;
+
+
+namespace detail {
+
+  /// collective writes of text chunks at consecutive offsets of 1 file.
+  class text_file_writer {
+      ::mxx::comm const & comm;
+      ::std::string filename;
+      MPI_File fh;
+      MPI_Offset offset;
+      int res;
+
+      void throw_io_error(int const & code) const {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(code, msg, &len);
+
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::index::kmer::export_text: rank " << comm.rank() << " [" << filename << "] " << ::std::string(msg, len);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+    public:
+      text_file_writer(::std::string const & _filename, ::mxx::comm const & _comm) :
+        comm(_comm), filename(_filename), offset(0) {
+        res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+        if (res != MPI_SUCCESS) throw_io_error(res);
+        // truncate any existing file.
+        res = MPI_File_set_size(fh, 0);
+      }
+
+      /// write the buffers of all processes, in rank order, after the previous ones.  collective.
+      void write(::std::vector<char> const & buf, size_t const & bytes) {
+        size_t prefix = ::mxx::exscan(bytes, comm);
+        if (comm.rank() == 0) prefix = 0;
+        size_t total = ::mxx::allreduce(bytes, comm);
+
+        MPI_Status stat;
+        int w_res = MPI_File_write_at_all(fh, offset + static_cast<MPI_Offset>(prefix), const_cast<char *>(buf.data()),
+                                          static_cast<int>(bytes), MPI_BYTE, &stat);
+        if (res == MPI_SUCCESS) res = w_res;
+        offset += static_cast<MPI_Offset>(total);
+      }
+
+      /// close, and throw on all processes if any write failed.  collective.
+      void close() {
+        int c_res = MPI_File_close(&fh);
+        if (res == MPI_SUCCESS) res = c_res;
+        if (!::mxx::all_of(res == MPI_SUCCESS, comm)) throw_io_error((res == MPI_SUCCESS) ? MPI_ERR_OTHER : res);
+      }
+
+      size_t size() const { return static_cast<size_t>(offset); }
+  };
+
+} // namespace detail
+
+
+/**
+ * @brief write the (kmer, count) entries of a count index to 1 text file, 1 "kmer\tcount" line per kmer.  collective.
+ * @param sorted      write in kmer order, via dsc::sorted_export.  otherwise the lines are in the order of the scan.
+ * @param chunk_size  entries formatted per process per collective write.
+ * @return  size of the file.
+ */
+template <typename IndexType>
+size_t export_text(IndexType const & index, ::std::string const & filename, ::mxx::comm const & comm,
+                   bool const & sorted = false, size_t const & chunk_size = (1UL << 18)) {
+  using KmerType = typename IndexType::KmerType;
+  using ValueType = typename IndexType::ValueType;
+  using Formatter = kmer_text_formatter<KmerType>;
+
+  // each write is at most 1 GB, within the int count of MPI_File_write_at_all.
+  size_t chunk = ::std::max(static_cast<size_t>(1), ::std::min(chunk_size, (1UL << 30) / Formatter::max_line));
+  ::std::vector<char> buf(chunk * Formatter::max_line);
+
+  BL_BENCH_INIT(export_text);
+
+  BL_BENCH_START(export_text);
+  detail::text_file_writer writer(filename, comm);
+  size_t local_count = 0;
+
+  if (sorted) {
+    // windows of globally sorted entries, without a full copy of the local entries.  see dsc::sorted_export.
+    auto sink = [&writer, &buf, &chunk, &comm](::std::vector<::std::pair<KmerType, ValueType> > const & entries) {
+      // a window can be over the chunk if a prefix has many entries.
+      size_t rounds = ::mxx::allreduce((entries.size() + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+      size_t pos = 0;
+      for (size_t r = 0; r < rounds; ++r) {
+        size_t n = ::std::min(chunk, entries.size() - pos);
+        size_t bytes = 0;
+        for (size_t i = pos; i < pos + n; ++i)
+          bytes += Formatter::format(entries[i].first, entries[i].second, buf.data() + bytes);
+        writer.write(buf, bytes);
+        pos += n;
+      }
+    };
+    local_count = ::dsc::sorted_export(index, sink, comm, chunk);
+  } else {
+    auto cursor = index.scan(chunk);
+    while (cursor.next()) {
+      auto const & c = cursor.chunk();
+      size_t bytes = 0;
+      for (size_t i = 0; i < c.size(); ++i)
+        bytes += Formatter::format(c.key(i), c.value(i), buf.data() + bytes);
+      writer.write(buf, bytes);
+    }
+    local_count = cursor.local_scanned();
+  }
+
+  writer.close();
+  BL_BENCH_END(export_text, "write", local_count);
+
+  BL_BENCH_REPORT_MPI_NAMED(export_text, "index:export_text", comm);
+  return writer.size();
+}
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_KMER_TEXT_EXPORT_HPP
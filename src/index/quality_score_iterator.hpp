@@ -28,6 +28,15 @@
 #define BLISS_INDEX_QUALITY_SCORE_ITERATOR_HPP
 
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>  // min
+#include <type_traits>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <x86intrin.h>
+#endif
 
 #include "index/quality_scores.hpp"
 #include "iterators/sliding_window_iterator.hpp"
@@ -63,7 +72,8 @@ namespace index
  *                      (probabilities in log space).
  */
 template <typename BaseIterator, unsigned int KMER_SIZE,
-          typename Encoder = bliss::index::Illumina18QualityScoreCodec<double> >
+          typename Encoder = bliss::index::Illumina18QualityScoreCodec<double>,
+          bool Fixed = std::is_integral<typename Encoder::value_type>::value >
 class QualityScoreSlidingWindow
 {
   public:
@@ -173,6 +183,66 @@ public:
   }
 };
 
+/**
+ * @brief The sliding window operator for fixed point quality scores, i.e. for `QualityScoreCodec<uint16_t, ...>`.
+ *
+ * @details  the window keeps the sum of the fixed point costs (-log2 probabilities) of its bases in 32 bits, and
+ * returns the sum saturated to 16 bits.  an incorrect base has the saturated cost, so no separate count is needed.
+ * the value is the k-mer's fixed point cost, and `Encoder::to_prob()` converts it to a probability.
+ */
+template <typename BaseIterator, unsigned int KMER_SIZE, typename Encoder>
+class QualityScoreSlidingWindow<BaseIterator, KMER_SIZE, Encoder, true>
+{
+  public:
+    /// fixed point cost
+    typedef typename Encoder::value_type QualityType;
+
+  private:
+    /// The current sum of the costs in the current window
+    uint32_t current_sum = 0;
+
+    /// All current values in the window, as a circular buffer
+    QualityType window_values[KMER_SIZE];
+
+    /// The current position in the window_values circular buffer, Points to the next available position
+    unsigned int window_pos = 0;
+
+  public:
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    /// Initializes the sliding window.  at end of initialization, `it` is set to last position read.
+    inline void init(BaseIterator& it)
+    {
+      for (unsigned int i = 0; i < KMER_SIZE;)
+      {
+        window_values[i] = Encoder::decode(*it);
+        current_sum += window_values[i];
+        if (++i < KMER_SIZE) ++it;  // set to LAST READ position
+      }
+      window_pos = 0;
+    }
+
+    /// Slides the window by one character taken from the given iterator, then advances the iterator.
+    inline void next(BaseIterator& it)
+    {
+      QualityType newval = Encoder::decode(*it);
+      current_sum -= window_values[window_pos];
+      current_sum += newval;
+
+      window_values[window_pos] = newval;
+      window_pos = (window_pos+1) % KMER_SIZE;
+      ++it;
+    }
+
+    /// Returns the fixed point cost of the window, saturated at `Encoder::incorrect`.
+    inline QualityType getValue()
+    {
+      return static_cast<QualityType>(std::min<uint32_t>(current_sum, Encoder::incorrect));
+    }
+};
+
+
 // /**
 //  * compute kmer quality based on phred quality score.
 //  *
@@ -318,6 +388,239 @@ protected:
 
 
 
+/**
+ * @brief Computes the k-mer quality scores of a whole read in one batch.
+ *
+ * @details  The sliding window iterator decodes one quality character and updates
+ * the window sum per k-mer, interleaved with the k-mer and position iterators.
+ * This class copies the quality characters of a read into a contiguous buffer
+ * first, decodes them all in one pass, and computes every window sum as the
+ * difference of 2 prefix sums.  All loops run over contiguous arrays, so they
+ * can be vectorized and no per-k-mer window state is kept.
+ *
+ * The results are the same as those of QualityScoreGenerationIterator: 0 for
+ * a window that contains an incorrect base, and exp2(sum of log2 probabilities)
+ * otherwise.  The prefix sums are accumulated in double precision so that long
+ * reads do not lose precision in the float case.
+ *
+ * Buffers are retained between calls, so reuse one instance for consecutive reads.
+ *
+ * @tparam KMER_SIZE   the k-mer (window) size.
+ * @tparam Encoder     The `Encoder` class, which decodes the quality score characters.
+ */
+template <unsigned int KMER_SIZE,
+          typename Encoder = bliss::index::Illumina18QualityScoreCodec<double>,
+          bool Fixed = std::is_integral<typename Encoder::value_type>::value >
+class QualityScoreBatch
+{
+  public:
+    /// Type of the computed k-mer quality
+    typedef typename Encoder::value_type QualityType;
+
+  protected:
+    /// type for the prefix sums.
+    typedef double SumType;
+
+    /// contiguous copy of the quality characters of the current read
+    std::vector<unsigned char> chars;
+
+    /// prefix sums of the log2 probabilities of correct bases.  size is read length + 1.
+    std::vector<SumType> sums;
+
+    /// prefix counts of the incorrect bases.  size is read length + 1.
+    std::vector<unsigned int> incorrect;
+
+  public:
+    /**
+     * @brief compute the quality scores for all k-mers in a read.
+     *
+     * @param begin    iterator to the first quality character of the read.  should already filter out EOL characters.
+     * @param end      iterator to the end of the quality characters of the read.
+     * @param output   the k-mer quality scores, one per k-mer in the read.  cleared first.
+     * @return         number of k-mer quality scores produced.
+     */
+    template <typename Iterator>
+    size_t operator()(Iterator begin, Iterator end, std::vector<QualityType> & output)
+    {
+      output.clear();
+
+      chars.clear();
+      for (; begin != end; ++begin) chars.push_back(*begin);
+
+      size_t n = chars.size();
+      if (n < KMER_SIZE) return 0;
+
+      sums.resize(n + 1);
+      incorrect.resize(n + 1);
+
+      const QualityType lowest = Encoder::DecodeLUT[0];
+      const QualityType highest = Encoder::DecodeLUT[95];
+
+      // decode in one pass.  incorrect bases contribute nothing to the sums.
+      sums[0] = 0;
+      incorrect[0] = 0;
+      for (size_t i = 0; i < n; ++i) {
+        QualityType val = Encoder::decode(chars[i]);
+        bool correct = (val > lowest) && (val < highest);
+        sums[i + 1] = correct ? static_cast<SumType>(val) : 0;
+        incorrect[i + 1] = correct ? 0 : 1;
+      }
+
+      // prefix sums
+      for (size_t i = 1; i <= n; ++i) {
+        sums[i] += sums[i - 1];
+        incorrect[i] += incorrect[i - 1];
+      }
+
+      // window sums from prefix sum differences.
+      size_t count = n - KMER_SIZE + 1;
+      output.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        output[i] = (incorrect[i + KMER_SIZE] > incorrect[i]) ? 0.0 :
+            std::exp2(static_cast<QualityType>(sums[i + KMER_SIZE] - sums[i]));
+      }
+
+      return count;
+    }
+};
+
+
+/**
+ * @brief Computes the fixed point k-mer quality scores of a whole read in one batch.
+ *
+ * @details  the costs are decoded into a 16 bit buffer, and each window sum is accumulated with saturating adds, which
+ * gives the same values as QualityScoreSlidingWindow for fixed point codecs.  with AVX2 (__AVX2__), 16 consecutive
+ * windows are summed per step with KMER_SIZE unaligned loads and `_mm256_adds_epu16`.  otherwise, or for the
+ * last windows, a running 32 bit sum is used.
+ *
+ * Buffers are retained between calls, so reuse one instance for consecutive reads.
+ */
+template <unsigned int KMER_SIZE, typename Encoder>
+class QualityScoreBatch<KMER_SIZE, Encoder, true>
+{
+  public:
+    /// fixed point cost
+    typedef typename Encoder::value_type QualityType;
+
+  protected:
+    /// decoded costs of the current read
+    std::vector<QualityType> costs;
+
+  public:
+    /**
+     * @brief compute the fixed point quality scores for all k-mers in a read.
+     *
+     * @param begin    iterator to the first quality character of the read.  should already filter out EOL characters.
+     * @param end      iterator to the end of the quality characters of the read.
+     * @param output   the k-mer costs, one per k-mer in the read.  cleared first.
+     * @return         number of k-mer quality scores produced.
+     */
+    template <typename Iterator>
+    size_t operator()(Iterator begin, Iterator end, std::vector<QualityType> & output)
+    {
+      output.clear();
+
+      costs.clear();
+      for (; begin != end; ++begin) costs.push_back(Encoder::decode(*begin));
+
+      size_t n = costs.size();
+      if (n < KMER_SIZE) return 0;
+
+      size_t count = n - KMER_SIZE + 1;
+      output.resize(count);
+
+      size_t i = 0;
+#if defined(__AVX2__)
+      __m256i acc;
+      for (; i + 16 <= count; i += 16) {
+        acc = _mm256_setzero_si256();
+        for (unsigned int j = 0; j < KMER_SIZE; ++j) {
+          acc = _mm256_adds_epu16(acc, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(costs.data() + i + j)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output.data() + i), acc);
+      }
+#endif
+
+      if (i < count) {
+        uint32_t sum = 0;
+        for (unsigned int j = 0; j < KMER_SIZE; ++j) sum += costs[i + j];
+        output[i] = static_cast<QualityType>(std::min<uint32_t>(sum, Encoder::incorrect));
+        for (++i; i < count; ++i) {
+          sum += costs[i + KMER_SIZE - 1];
+          sum -= costs[i - 1];
+          output[i] = static_cast<QualityType>(std::min<uint32_t>(sum, Encoder::incorrect));
+        }
+      }
+
+      return count;
+    }
+};
+
+
+/**
+ * @brief  phred thresholds for quality filtering during parsing, for base trimming and for k-mer filtering.
+ *
+ * @details  a base is low if its phred score is below trim_phred, and a k-mer passes if its probability of being correct
+ * is at least 1 - 10^(-kmer_phred / 10), i.e. its k-mer phred score is at least kmer_phred.  0 disables either test.
+ * bases are compared in log2 probability with a threshold half way to the next lower phred score, so the rounding of
+ * the decode table does not matter.  for fixed point codecs, the bases are decoded with the floating point codec, and
+ * the k-mer costs are compared to the cost of the threshold, so saturated windows pass only when the test is disabled.
+ *
+ * @tparam Encoder   the codec that produced the k-mer quality scores.
+ */
+template <typename Encoder, bool Fixed = std::is_integral<typename Encoder::value_type>::value >
+class QualityThreshold
+{
+  public:
+    typedef typename Encoder::value_type QualityType;
+    typedef Encoder BaseEncoder;
+
+  protected:
+    double base_min;
+    QualityType kmer_min;
+
+  public:
+    QualityThreshold(unsigned int const & trim_phred = 0, unsigned int const & kmer_phred = 0) :
+      base_min((trim_phred == 0) ? -std::numeric_limits<double>::infinity() :
+          std::log2(1.0 - std::pow(10.0, (0.5 - static_cast<double>(trim_phred)) / 10.0))),
+      kmer_min((kmer_phred == 0) ? 0 : static_cast<QualityType>(1.0 - std::pow(10.0, -static_cast<double>(kmer_phred) / 10.0))) {}
+
+    /// true if the base with this quality character should be trimmed.
+    inline bool is_low(unsigned char const & c) const { return static_cast<double>(BaseEncoder::decode(c)) < base_min; }
+
+    /// true if the k-mer with this quality score is kept.
+    inline bool pass(QualityType const & q) const { return q >= kmer_min; }
+};
+
+/// fixed point k-mer costs:  lower is better.
+template <typename Encoder>
+class QualityThreshold<Encoder, true>
+{
+  public:
+    typedef typename Encoder::value_type QualityType;
+    typedef typename Encoder::FloatCodec BaseEncoder;
+
+  protected:
+    double base_min;
+    QualityType kmer_max;
+
+  public:
+    QualityThreshold(unsigned int const & trim_phred = 0, unsigned int const & kmer_phred = 0) :
+      base_min((trim_phred == 0) ? -std::numeric_limits<double>::infinity() :
+          std::log2(1.0 - std::pow(10.0, (0.5 - static_cast<double>(trim_phred)) / 10.0))),
+      kmer_max((kmer_phred == 0) ? Encoder::incorrect :
+          static_cast<QualityType>(std::min(std::round(-std::log2(1.0 - std::pow(10.0, -static_cast<double>(kmer_phred) / 10.0)) *
+                                                       static_cast<double>(1 << Encoder::fixed_bits)),
+                                            static_cast<double>(Encoder::incorrect - 1)))) {}
+
+    /// true if the base with this quality character should be trimmed.
+    inline bool is_low(unsigned char const & c) const { return BaseEncoder::decode(c) < base_min; }
+
+    /// true if the k-mer with this cost is kept.
+    inline bool pass(QualityType const & q) const { return q <= kmer_max; }
+};
+
+
 } // namespace index
 } // namespace bliss
 
@@ -27,6 +27,7 @@
 #define BLISS_INDEX_QUALITY_SCORES_HPP
 
 #include <cstdlib>
+#include <cstdint>
 
 #include <numeric>
 #include <cmath>
@@ -524,6 +525,94 @@ template<typename OutT, unsigned char MinInput, unsigned char MaxInput, char Min
 constexpr typename QualityScoreCodec<OutT, MinInput, MaxInput, MinScore>::LUTType QualityScoreCodec<OutT, MinInput, MaxInput, MinScore>::EncodeLUT;
 
 
+/**
+ * @brief fixed point quality score codec:  -log2(Pr(correct base)) in 16 bit unsigned integers.
+ * @details  the value is the cost -log2(p_correct) * 2^fixed_bits, rounded, so the values of a window can be added,
+ *  and a larger value is a lower quality.  the cost of an incorrect base (q = 0 or below MinScore) is `incorrect`,
+ *  and window sums saturate at `incorrect`, which then stands for probability 0.  with 10 fraction bits a window is
+ *  saturated only if its probability is below 2^-64.
+ *
+ *  the rounding error is at most 2^-(fixed_bits+1) in log2 per base, i.e. about 1.5% relative error in the probability of a 31-mer.
+ *  the lookup table is computed from the floating point codec's table on first use.
+ *
+ *  use this as `QualityScoreCodec<uint16_t, ...>`, e.g. `Illumina18QualityScoreCodec<uint16_t>`, to store 2 byte qualities.
+ */
+template<unsigned char MinInput, unsigned char MaxInput, char MinScore >
+struct QualityScoreCodec<uint16_t, MinInput, MaxInput, MinScore>
+{
+    static_assert(MaxInput >= MinInput, "Quality Score Input range is invalid");
+    static_assert(MinScore >= 0, "Minimum score should at least 0 for Phred Scores");
+
+    /// floating point codec with the same input range.
+    typedef QualityScoreCodec<double, MinInput, MaxInput, MinScore> FloatCodec;
+
+    typedef uint16_t value_type;
+
+    /// number of possible quality-score character values
+    static constexpr unsigned char size = MaxInput - MinInput + 1;
+
+    /// number of fraction bits of the fixed point cost.
+    static constexpr unsigned int fixed_bits = 10;
+
+    /// cost of an incorrect base, and the saturated value of a window sum.
+    static constexpr uint16_t incorrect = std::numeric_limits<uint16_t>::max();
+
+protected:
+    /// Type of the lookup-table
+    typedef std::array<uint16_t, 96> LUTType;
+
+    struct lut_builder {
+        LUTType lut;
+        lut_builder() {
+          for (size_t i = 0; i < lut.size(); ++i) {
+            double v = FloatCodec::DecodeLUT[i];
+            if (v == std::numeric_limits<double>::lowest()) lut[i] = incorrect;
+            else lut[i] = static_cast<uint16_t>(std::min(std::round(-v * static_cast<double>(1 << fixed_bits)),
+                                                         static_cast<double>(incorrect - 1)));
+          }
+        }
+    };
+
+public:
+    /// the lookup table for ASCII to fixed point cost.
+    static LUTType const & decode_lut() {
+      static const lut_builder builder;
+      return builder.lut;
+    }
+
+    /// Returns the fixed point cost for the given Phred Score ASCII character.
+    inline static uint16_t decode(const unsigned char score)
+    {
+      return decode_lut()[score - MinInput];
+    }
+
+    /// log2 probability of correct bases for a fixed point cost, or lowest() if saturated.
+    inline static double to_log2(const uint16_t cost)
+    {
+      return (cost == incorrect) ? std::numeric_limits<double>::lowest() :
+          (-static_cast<double>(cost) / static_cast<double>(1 << fixed_bits));
+    }
+
+    /// probability of correct bases for a fixed point cost.
+    inline static double to_prob(const uint16_t cost)
+    {
+      return (cost == incorrect) ? 0.0 : std::exp2(to_log2(cost));
+    }
+
+    /// Returns the Sanger/Phred score for the given fixed point cost.
+    inline static unsigned char encode(const uint16_t cost)
+    {
+      return FloatCodec::encode(to_log2(cost));
+    }
+};
+
+template<unsigned char MinInput, unsigned char MaxInput, char MinScore>
+constexpr uint16_t QualityScoreCodec<uint16_t, MinInput, MaxInput, MinScore>::incorrect;
+
+template<unsigned char MinInput, unsigned char MaxInput, char MinScore>
+constexpr unsigned int QualityScoreCodec<uint16_t, MinInput, MaxInput, MinScore>::fixed_bits;
+
+
 /// Illumina 1.8 quality score converstion presets.  convenience typedef.
 template<typename OutT>
 using Illumina18QualityScoreCodec = QualityScoreCodec<OutT, 33, 126, 0>;
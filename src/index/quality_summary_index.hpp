@@ -0,0 +1,268 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    quality_summary_index.hpp
+ * @ingroup index
+ * @brief   kmer quality index that keeps 1 aggregate per kmer instead of 1 quality per occurrence.
+ * @details  the mapped value is a quality_summary:  the number of occurrences, the sum and the minimum of the kmer
+ *          qualities (log2 of the probability that the kmer is correct), and optionally a histogram of the
+ *          probabilities.  the map is a reduction map whose reduction is the summary's operator+, so occurrences
+ *          are merged by the sender side combiner (see set_combiner) and again at the owner.
+ *
+ *          memory is (kmer + summary) per unique kmer, instead of (kmer + position + quality) per occurrence in a
+ *          PositionQualityIndex multimap, i.e. smaller by about the coverage.  positions are not kept.
+ */
+#ifndef BLISS_INDEX_QUALITY_SUMMARY_INDEX_HPP
+#define BLISS_INDEX_QUALITY_SUMMARY_INDEX_HPP
+
+#include <vector>
+#include <utility>      // pair
+#include <iterator>
+#include <limits>       // numeric_limits
+#include <algorithm>    // min
+#include <cmath>        // exp2
+#include <cstdint>
+
+#include <mxx/datatypes.hpp>
+
+#include "index/kmer_index.hpp"
+#include "index/quality_scores.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+namespace detail
+{
+  /// histogram of kmer probabilities in BINS equal width bins of [0, 1].
+  template <unsigned int BINS>
+  struct quality_bins {
+      uint32_t bins[BINS];
+
+      quality_bins() {
+        for (unsigned int i = 0; i < BINS; ++i) bins[i] = 0;
+      }
+
+      void add(double const & prob) {
+        unsigned int b = static_cast<unsigned int>(prob * BINS);
+        ++bins[::std::min(b, BINS - 1)];
+      }
+      void merge(quality_bins const & x, quality_bins const & y) {
+        for (unsigned int i = 0; i < BINS; ++i) {
+          bins[i] = (x.bins[i] > ::std::numeric_limits<uint32_t>::max() - y.bins[i]) ?
+              ::std::numeric_limits<uint32_t>::max() : x.bins[i] + y.bins[i];
+        }
+      }
+      bool equal(quality_bins const & other) const {
+        for (unsigned int i = 0; i < BINS; ++i) {
+          if (bins[i] != other.bins[i]) return false;
+        }
+        return true;
+      }
+  };
+
+  template <>
+  struct quality_bins<0> {
+      void add(double const &) {}
+      void merge(quality_bins const &, quality_bins const &) {}
+      bool equal(quality_bins const &) const { return true; }
+  };
+} // namespace detail
+
+
+/**
+ * @brief aggregate of the qualities of the occurrences of a kmer.  operator+ merges 2 aggregates.
+ * @details  qualities are log2(Pr(kmer correct)), as produced by the quality score codecs.  the count saturates.
+ * @tparam QualType  float or double.
+ * @tparam BINS      number of histogram bins of the probability, 0 for no histogram.
+ */
+template <typename QualType = float, unsigned int BINS = 0>
+struct quality_summary : public detail::quality_bins<BINS> {
+    static_assert(::std::is_floating_point<QualType>::value, "quality summary type has to be floating point");
+    static constexpr unsigned int num_bins = BINS;
+
+    QualType sum;
+    QualType min;
+    uint32_t count;
+
+    quality_summary() : sum(0), min(::std::numeric_limits<QualType>::max()), count(0) {}
+
+    /// 1 occurrence with quality q.
+    static quality_summary single(QualType const & q) {
+      quality_summary out;
+      out.sum = q;
+      out.min = q;
+      out.count = 1;
+      out.add(::std::exp2(static_cast<double>(q)));
+      return out;
+    }
+
+    /// mean log2 probability.
+    QualType mean() const {
+      return (count == 0) ? 0 : sum / static_cast<QualType>(count);
+    }
+
+    /// occurrences with probability at least the lower edge of bin b, i.e. b / BINS.
+    size_t count_above(unsigned int const & b) const {
+      static_assert(BINS > 0, "count_above needs a histogram");
+      size_t n = 0;
+      for (unsigned int i = b; i < BINS; ++i) n += this->bins[i];
+      return n;
+    }
+
+    quality_summary operator+(quality_summary const & other) const {
+      quality_summary out;
+      out.sum = sum + other.sum;
+      out.min = ::std::min(min, other.min);
+      out.count = (count > ::std::numeric_limits<uint32_t>::max() - other.count) ?
+          ::std::numeric_limits<uint32_t>::max() : count + other.count;
+      out.merge(*this, other);
+      return out;
+    }
+
+    bool operator==(quality_summary const & other) const {
+      return (count == other.count) && (sum == other.sum) && (min == other.min) && this->equal(other);
+    }
+};
+
+
+/**
+ * @brief  output iterator that converts (kmer, (position, quality)) to (kmer, quality_summary of 1 occurrence).
+ * @details  lets KmerQualitySummaryTupleParser reuse the position-quality parser without an intermediate vector.
+ */
+template <typename OutputIt, typename InnerTuple, typename OuterTuple>
+class quality_summary_output_iterator :
+    public ::std::iterator<::std::output_iterator_tag, InnerTuple, void, void, void> {
+protected:
+	using SummaryType = typename ::std::tuple_element<1, OuterTuple>::type;
+	OutputIt out;
+
+public:
+	explicit quality_summary_output_iterator(OutputIt const & _out) : out(_out) {}
+
+	OutputIt base() const { return out; }
+
+	quality_summary_output_iterator & operator=(InnerTuple const & x) {
+		*out = OuterTuple(x.first, SummaryType::single(x.second.second));
+		++out;
+		return *this;
+	}
+
+	quality_summary_output_iterator & operator*() { return *this; }
+	quality_summary_output_iterator & operator++() { return *this; }
+	quality_summary_output_iterator & operator++(int) { return *this; }
+};
+
+/**
+ * @brief  parser of (kmer, quality_summary) pairs, 1 per kmer occurrence, with the same kmers, qualities, trimming
+ *         and filtering as KmerPositionQualityTupleParser.
+ * @tparam TupleType       (kmer, quality_summary) pair.
+ */
+template <typename TupleType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec,
+    unsigned int TrimPhred = 0, unsigned int MinKmerPhred = 0>
+class KmerQualitySummaryTupleParser {
+public:
+	using value_type = TupleType;
+	using kmer_type = typename ::std::tuple_element<0, value_type>::type;
+	using mapped_type = typename ::std::tuple_element<1, value_type>::type;
+	static constexpr size_t window_size = kmer_type::size;
+
+protected:
+	using QualType = decltype(::std::declval<mapped_type>().sum);
+	using InnerTupleType = ::std::pair<kmer_type, ::std::pair<::bliss::common::ShortSequenceKmerId, QualType> >;
+
+	KmerPositionQualityTupleParser<InnerTupleType, QualityEncoder, TrimPhred, MinKmerPhred> parser;
+
+public:
+	KmerQualitySummaryTupleParser(::bliss::partition::range<size_t> const & _valid_range) : parser(_valid_range) {};
+
+	/**
+	 * @brief generate kmer-summary pairs from 1 sequence.  result inserted into output_iter.
+	 * @return new position for output_iter
+	 */
+	template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+	OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+		static_assert(std::is_same<TupleType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+			"output type and output container value type are not the same");
+
+		quality_summary_output_iterator<OutputIt, InnerTupleType, TupleType> out(output_iter);
+		return parser(read, out, pred).base();
+	}
+};
+template <typename TupleType, template<typename> class QualityEncoder, unsigned int TrimPhred, unsigned int MinKmerPhred>
+constexpr size_t KmerQualitySummaryTupleParser<TupleType, QualityEncoder, TrimPhred, MinKmerPhred>::window_size;
+
+
+/**
+ * @brief kmer index with 1 quality summary per kmer.  find returns the summary of each kmer.
+ * @details  the sender side combiner of the map is on by default, since each read file has many occurrences per kmer.
+ * @tparam MapType  reduction map with quality_summary mapped type, e.g. QualitySummaryMap.
+ */
+template <typename MapType, unsigned int TrimPhred = 0, unsigned int MinKmerPhred = 0>
+class QualitySummaryIndex : public Index<MapType, KmerQualitySummaryTupleParser<
+	std::pair<typename MapType::key_type, typename MapType::mapped_type>,
+	::bliss::index::Illumina18QualityScoreCodec, TrimPhred, MinKmerPhred> > {
+protected:
+	using BaseIndexType = Index<MapType, KmerQualitySummaryTupleParser<
+		std::pair<typename MapType::key_type, typename MapType::mapped_type>,
+		::bliss::index::Illumina18QualityScoreCodec, TrimPhred, MinKmerPhred> >;
+
+public:
+	using KmerType = typename BaseIndexType::KmerType;
+	using ValueType = typename BaseIndexType::ValueType;
+
+	QualitySummaryIndex(const mxx::comm& _comm) : BaseIndexType(_comm) {
+		this->map.set_combiner();
+	}
+
+	virtual ~QualitySummaryIndex() {};
+};
+
+/// quality summary per canonical kmer, in a reduction densehash map.
+template <typename Key, typename QualType = float, unsigned int BINS = 0,
+	template <typename> class MapParams = CanonicalHashMapParams,
+	typename SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<Key, true> >
+using QualitySummaryMap = ::dsc::reduction_densehash_map<Key, quality_summary<QualType, BINS>, MapParams, SpecialKeys>;
+
+} /* namespace kmer */
+} /* namespace index */
+} /* namespace bliss */
+
+
+namespace mxx {
+
+  template<typename QualType, unsigned int BINS>
+    struct datatype_builder<bliss::index::kmer::quality_summary<QualType, BINS> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::index::kmer::quality_summary<QualType, BINS>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::index::kmer::quality_summary<QualType, BINS>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+}  // namespace mxx
+
+#endif // BLISS_INDEX_QUALITY_SUMMARY_INDEX_HPP
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_cache.hpp
+ * @ingroup index
+ * @brief   per process CLOCK cache of query results, in front of the collective Index::find and count.
+ * @details  for screening workloads that query the same high frequency kmers (adapters, repeats) in consecutive batches.
+ *          a hit is answered locally, so the kmer is neither sent to its owner nor looked up there.  the cache holds
+ *          at most capacity keys, and evicts with the CLOCK (second chance) policy:  a hit sets the reference bit of the
+ *          key's slot, and the hand clears reference bits until it finds an unreferenced slot to replace.
+ *
+ *          the cache does not know about the map.  the owner tags it with an epoch, and the cache is cleared when the
+ *          owner's epoch changes, e.g. at each insert or erase.
+ */
+#ifndef BLISS_INDEX_QUERY_CACHE_HPP
+#define BLISS_INDEX_QUERY_CACHE_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <functional>  // equal_to
+#include <cstddef>
+
+namespace bliss
+{
+namespace index
+{
+
+/**
+ * @brief fixed capacity key to value cache with CLOCK eviction.  not thread safe.
+ * @tparam Hash   hash functor of Key, e.g. ::bliss::kmer::hash::farm<Key, false>
+ */
+template <typename Key, typename Value, typename Hash, typename Equal = ::std::equal_to<Key> >
+class clock_cache {
+  public:
+    using key_type = Key;
+    using value_type = Value;
+
+  protected:
+    /// cached key and value, and the reference bit of the CLOCK policy.
+    struct slot {
+        Key key;
+        Value value;
+        bool referenced;
+    };
+
+    ::std::vector<slot> slots;
+    ::std::unordered_map<Key, size_t, Hash, Equal> slot_of;
+
+    size_t capacity_;
+    /// next slot the CLOCK hand examines for eviction.
+    size_t hand;
+    /// epoch of the owner when the cached values were computed.
+    size_t epoch_;
+
+    size_t hits_;
+    size_t misses_;
+
+  public:
+    explicit clock_cache(size_t const & capacity = 0) :
+      capacity_(capacity), hand(0), epoch_(0), hits_(0), misses_(0) {
+      slots.reserve(capacity_);
+      slot_of.reserve(capacity_);
+    }
+
+    /// maximum number of keys.  0 disables the cache.
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return slots.size(); }
+    bool enabled() const { return capacity_ > 0; }
+
+    /// lookups that were answered by the cache, and that were not, since construction or reset_stats.
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+    void reset_stats() { hits_ = 0; misses_ = 0; }
+
+    /// drop all keys.
+    void clear() {
+      slots.clear();
+      slot_of.clear();
+      hand = 0;
+    }
+
+    /// clear the cache if the owner's epoch differs from the one of the cached values.
+    void validate(size_t const & epoch) {
+      if (epoch == epoch_) return;
+      clear();
+      epoch_ = epoch;
+    }
+
+    /// cached value of key, or nullptr.  a hit marks the key as recently used.  the pointer is valid until the next insert.
+    Value const * find(Key const & key) {
+      auto it = slot_of.find(key);
+      if (it == slot_of.end()) {
+        ++misses_;
+        return nullptr;
+      }
+      ++hits_;
+      slot & s = slots[it->second];
+      s.referenced = true;
+      return &(s.value);
+    }
+
+    /// cache the value of key, replacing an unreferenced key if full.  no op if disabled.
+    void insert(Key const & key, Value const & value) {
+      if (capacity_ == 0) return;
+
+      auto it = slot_of.find(key);
+      if (it != slot_of.end()) {
+        slots[it->second].value = value;
+        return;
+      }
+
+      if (slots.size() < capacity_) {
+        slot_of.emplace(key, slots.size());
+        slots.push_back(slot{key, value, false});
+        return;
+      }
+
+      // second chance:  at most 1 sweep clears all reference bits.
+      while (slots[hand].referenced) {
+        slots[hand].referenced = false;
+        hand = (hand + 1 == capacity_) ? 0 : hand + 1;
+      }
+      slot_of.erase(slots[hand].key);
+      slot_of.emplace(key, hand);
+      slots[hand].key = key;
+      slots[hand].value = value;
+      hand = (hand + 1 == capacity_) ? 0 : hand + 1;
+    }
+};
+
+
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_QUERY_CACHE_HPP
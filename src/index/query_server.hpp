@@ -0,0 +1,233 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_server.hpp
+ * @ingroup index
+ * @brief   batches k-mer lookups from many client threads into few collective Index::find / count calls.
+ * @details  clients call find() or count() from any thread, and get a future for their results.  the server loop, run(),
+ *          runs on the thread that makes the MPI calls, on every process.  each round it waits until max_batch keys are
+ *          pending or max_delay has passed, takes the pending requests, removes duplicate keys across requests, and
+ *          makes 1 collective find and/or count for all of them.  the results are then split back per request.
+ *
+ *          the rounds are collective, so all processes loop together, and a round with no keys anywhere costs 1 allreduce.
+ *          max_batch and max_delay trade throughput for latency.  query keys are transformed with the map's input transform,
+ *          e.g. to canonical k-mers, so results are reported for the transformed keys.
+ *          only the server thread makes MPI calls, so MPI_THREAD_FUNNELED is enough.
+ */
+#ifndef BLISS_INDEX_QUERY_SERVER_HPP
+#define BLISS_INDEX_QUERY_SERVER_HPP
+
+#include <vector>
+#include <deque>
+#include <utility>    // pair
+#include <algorithm>  // sort, unique, equal_range
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/**
+ * @brief asynchronous query front end of an Index.
+ * @tparam IndexType   e.g. CountIndex2<...>.  needs find(std::vector<KmerType>&), count(std::vector<KmerType>&), and get_map().
+ */
+template <typename IndexType>
+class query_server {
+  public:
+    using KmerType = typename IndexType::KmerType;
+    using find_result_type = decltype(::std::declval<IndexType const &>().find(::std::declval<std::vector<KmerType> &>()));
+    using count_result_type = decltype(::std::declval<IndexType const &>().count(::std::declval<std::vector<KmerType> &>()));
+
+  protected:
+    using find_value_type = typename find_result_type::value_type;
+    using count_value_type = typename count_result_type::value_type;
+
+    template <typename R>
+    struct request {
+        std::vector<KmerType> keys;
+        std::promise<R> result;
+    };
+
+    IndexType const & index;
+    mxx::comm const & comm;
+
+    size_t max_batch;
+    std::chrono::microseconds max_delay;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<request<find_result_type> > find_queue;
+    std::deque<request<count_result_type> > count_queue;
+    /// keys in the queues.
+    size_t pending;
+    bool stopping;
+
+    /// move requests from queue to batch, up to max_batch keys but at least 1 request.  requires the lock.
+    template <typename R>
+    size_t take(std::deque<request<R> > & queue, std::vector<request<R> > & batch) {
+      size_t keys = 0;
+      while (!queue.empty() && (batch.empty() || (keys + queue.front().keys.size() <= max_batch))) {
+        keys += queue.front().keys.size();
+        batch.emplace_back(std::move(queue.front()));
+        queue.pop_front();
+      }
+      pending -= keys;
+      return keys;
+    }
+
+    /// sorted unique keys of all requests in batch.
+    template <typename R>
+    static std::vector<KmerType> unique_keys(std::vector<request<R> > const & batch) {
+      std::vector<KmerType> keys;
+      for (auto const & r : batch) keys.insert(keys.end(), r.keys.begin(), r.keys.end());
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+      return keys;
+    }
+
+    struct result_less {
+        template <typename V>
+        inline bool operator()(V const & x, KmerType const & y) const { return x.first < y; }
+        template <typename V>
+        inline bool operator()(KmerType const & x, V const & y) const { return x < y.first; }
+    };
+
+  public:
+    /**
+     * @param _max_batch  keys per round at which the server stops waiting.
+     * @param _max_delay  longest wait for a round to fill.
+     */
+    query_server(IndexType const & _index, mxx::comm const & _comm, size_t const & _max_batch = (1UL << 20),
+                 std::chrono::microseconds const & _max_delay = std::chrono::microseconds(1000)) :
+      index(_index), comm(_comm), max_batch(_max_batch), max_delay(_max_delay), pending(0), stopping(false) {}
+
+    virtual ~query_server() {};
+
+    /// entries for the keys.  thread safe.  completed by a later round of run().
+    std::future<find_result_type> find(std::vector<KmerType> keys) {
+      index.get_map().transform_input(keys);
+      request<find_result_type> r;
+      r.keys.swap(keys);
+      std::future<find_result_type> f = r.result.get_future();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending += r.keys.size();
+        find_queue.emplace_back(std::move(r));
+      }
+      cv.notify_one();
+      return f;
+    }
+
+    /// (key, count) for each key, in the order of keys, including 0 counts.  thread safe.  completed by a later round of run().
+    std::future<count_result_type> count(std::vector<KmerType> keys) {
+      index.get_map().transform_input(keys);
+      request<count_result_type> r;
+      r.keys.swap(keys);
+      std::future<count_result_type> f = r.result.get_future();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending += r.keys.size();
+        count_queue.emplace_back(std::move(r));
+      }
+      cv.notify_one();
+      return f;
+    }
+
+    /// ask run() to return once this process's queues are drained, and all processes have stopped.  thread safe.
+    void stop() {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+      }
+      cv.notify_one();
+    }
+
+    /**
+     * @brief 1 round:  take a batch of pending requests, query, and complete the requests.  collective.
+     * @return false when all processes are stopped and have nothing pending.
+     */
+    bool serve() {
+      std::vector<request<find_result_type> > finds;
+      std::vector<request<count_result_type> > counts;
+      bool done;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, max_delay, [this]{ return stopping || (pending >= max_batch); });
+        take(find_queue, finds);
+        take(count_queue, counts);
+        done = stopping && find_queue.empty() && count_queue.empty();
+      }
+
+      // 1 allreduce to agree on this round's collectives.
+      int flags = (finds.empty() ? 0 : 1) | (counts.empty() ? 0 : 2) | (done ? 0 : 4);
+      flags = ::mxx::allreduce(flags, [](int const & x, int const & y) { return x | y; }, comm);
+
+      if (flags & 1) {
+        std::vector<KmerType> keys = unique_keys(finds);
+        find_result_type found = index.find(keys);
+        std::sort(found.begin(), found.end(), [](find_value_type const & x, find_value_type const & y) { return x.first < y.first; });
+
+        for (auto & r : finds) {
+          find_result_type res;
+          for (auto const & k : r.keys) {
+            auto range = std::equal_range(found.begin(), found.end(), k, result_less());
+            res.insert(res.end(), range.first, range.second);
+          }
+          r.result.set_value(std::move(res));
+        }
+      }
+
+      if (flags & 2) {
+        std::vector<KmerType> keys = unique_keys(counts);
+        count_result_type counted = index.count(keys);
+        std::sort(counted.begin(), counted.end(), [](count_value_type const & x, count_value_type const & y) { return x.first < y.first; });
+
+        for (auto & r : counts) {
+          count_result_type res;
+          res.reserve(r.keys.size());
+          for (auto const & k : r.keys) {
+            auto it = std::lower_bound(counted.begin(), counted.end(), k, result_less());
+            if ((it != counted.end()) && (it->first == k)) res.emplace_back(*it);
+            else res.emplace_back(k, 0);
+          }
+          r.result.set_value(std::move(res));
+        }
+      }
+
+      return (flags & 4) != 0;
+    }
+
+    /// serve until all processes are stopped and drained.  collective.
+    void run() {
+      while (serve()) {};
+    }
+};
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_QUERY_SERVER_HPP
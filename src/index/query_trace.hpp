@@ -0,0 +1,269 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_trace.hpp
+ * @ingroup index
+ * @brief   binary trace of the query batches of an index, for replaying a real query workload in a benchmark.
+ * @details  a trace is 1 file per process.  the file header is followed by 1 record per find or count call:  the call
+ *          type, the time since the trace started, the batch size, and the recorded kmers of the batch, as the raw
+ *          kmer words.  the kmers are recorded before the input transform and deduplication, so the duplicate rate
+ *          and the key skew of the workload are kept.
+ *
+ *          with a sample rate below 1, a kmer is recorded if its hash falls in the sampled fraction of the hash range.
+ *          all occurrences of a kmer are then either recorded or not, so the sampled trace has the same duplicate
+ *          rate and skew as the full workload.  the batch size is always the full size.
+ *
+ *          the calls are collective, so the traces of all processes have the same sequence of records.  see
+ *          test/benchmark/BenchmarkQueryReplay.cpp for replay.
+ */
+#ifndef BLISS_INDEX_QUERY_TRACE_HPP
+#define BLISS_INDEX_QUERY_TRACE_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include "utils/logging.h"
+#include "io/io_exception.hpp"
+
+namespace bliss
+{
+namespace index
+{
+
+/// query call types in a trace.
+enum class query_op : uint32_t {
+  FIND = 0,
+  COUNT = 1
+};
+
+/// header of a trace file.
+struct query_trace_header {
+    uint64_t magic;
+    uint32_t version;
+    /// bytes per recorded kmer, k, and bits per character, to check the kmer type at replay.
+    uint32_t kmer_bytes;
+    uint32_t k;
+    uint32_t bits_per_char;
+    /// number of processes and the rank of the recording.
+    uint32_t comm_size;
+    uint32_t rank;
+    double sample_rate;
+
+    /// "BLISSQTR" as a little endian uint64_t.
+    static constexpr uint64_t trace_magic = 0x5254515353494C42UL;
+    static constexpr uint32_t trace_version = 1;
+};
+
+/// header of a batch record.  followed by recorded kmers.
+struct query_trace_record {
+    /// seconds since the trace started.
+    double time;
+    /// kmers in the query batch, and kmers recorded.
+    uint64_t batch_size;
+    uint64_t recorded;
+    uint32_t op;
+    uint32_t reserved;
+};
+
+/// 1 query batch read from a trace.
+template <typename KmerType>
+struct query_trace_batch {
+    query_op op;
+    double time;
+    uint64_t batch_size;
+    ::std::vector<KmerType> kmers;
+};
+
+
+/**
+ * @brief appends the query batches of 1 process to a trace file.  not thread safe.
+ * @details  a write error disables the writer with a warning, so a failed trace does not stop the queries.
+ * @tparam Hash  hash functor of KmerType for sampling, e.g. ::bliss::kmer::hash::farm<KmerType, false>
+ */
+template <typename KmerType, typename Hash>
+class query_trace_writer {
+  protected:
+    FILE * file;
+    ::std::string filename;
+    double sample_rate;
+    /// a kmer is recorded if the top 32 bits of its hash are below threshold.
+    uint64_t threshold;
+    Hash hash;
+    ::std::chrono::steady_clock::time_point start;
+
+    size_t batches_;
+    size_t recorded_;
+
+    /// sampled kmers of the current batch.  reused between batches.
+    ::std::vector<KmerType> sampled;
+
+    void fail() {
+      BL_WARNINGF("query_trace_writer: could not write %s.  tracing stopped.", filename.c_str());
+      fclose(file);
+      file = NULL;
+    }
+
+  public:
+    /**
+     * @param _filename  trace file of this process, truncated.
+     * @param rate       fraction of the distinct kmers recorded, in (0, 1].
+     */
+    query_trace_writer(::std::string const & _filename, int const & comm_size, int const & rank, double const & rate = 1.0) :
+      file(NULL), filename(_filename), sample_rate((rate > 1.0 || rate <= 0.0) ? 1.0 : rate),
+      threshold(static_cast<uint64_t>(sample_rate * 4294967296.0)),
+      start(::std::chrono::steady_clock::now()), batches_(0), recorded_(0) {
+
+      file = fopen(filename.c_str(), "wb");
+      if (file == NULL) throw ::bliss::io::IOException("ERROR: unable to create query trace file " + filename);
+
+      query_trace_header header;
+      header.magic = query_trace_header::trace_magic;
+      header.version = query_trace_header::trace_version;
+      header.kmer_bytes = sizeof(KmerType);
+      header.k = KmerType::size;
+      header.bits_per_char = KmerType::bitsPerChar;
+      header.comm_size = comm_size;
+      header.rank = rank;
+      header.sample_rate = sample_rate;
+      if (fwrite(&header, sizeof(query_trace_header), 1, file) != 1) fail();
+    }
+
+    ~query_trace_writer() {
+      if (file != NULL) fclose(file);
+    }
+
+    query_trace_writer(query_trace_writer const &) = delete;
+    query_trace_writer & operator=(query_trace_writer const &) = delete;
+
+    /// append 1 batch.
+    void record(query_op const & op, ::std::vector<KmerType> const & query) {
+      if (file == NULL) return;
+
+      KmerType const * kmers = query.data();
+      size_t n = query.size();
+      if (threshold < (1UL << 32)) {
+        sampled.clear();
+        for (auto const & km : query) {
+          if ((static_cast<uint64_t>(hash(km)) >> 32) < threshold) sampled.emplace_back(km);
+        }
+        kmers = sampled.data();
+        n = sampled.size();
+      }
+
+      query_trace_record rec;
+      rec.time = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start).count();
+      rec.batch_size = query.size();
+      rec.recorded = n;
+      rec.op = static_cast<uint32_t>(op);
+      rec.reserved = 0;
+
+      if ((fwrite(&rec, sizeof(query_trace_record), 1, file) != 1) ||
+          (fwrite(kmers, sizeof(KmerType), n, file) != n)) {
+        fail();
+        return;
+      }
+      ++batches_;
+      recorded_ += n;
+    }
+
+    /// write the buffered records to the file.
+    void flush() {
+      if ((file != NULL) && (fflush(file) != 0)) fail();
+    }
+
+    bool good() const { return file != NULL; }
+    size_t batches() const { return batches_; }
+    size_t recorded() const { return recorded_; }
+    ::std::string const & get_filename() const { return filename; }
+};
+
+
+/**
+ * @brief reads the batches of 1 trace file in order.
+ * @details  throws IOException if the file cannot be opened, or was recorded with a different kmer type.
+ */
+template <typename KmerType>
+class query_trace_reader {
+  protected:
+    FILE * file;
+    ::std::string filename;
+    query_trace_header header;
+
+  public:
+    explicit query_trace_reader(::std::string const & _filename) : file(NULL), filename(_filename) {
+      file = fopen(filename.c_str(), "rb");
+      if (file == NULL) throw ::bliss::io::IOException("ERROR: unable to open query trace file " + filename);
+
+      if ((fread(&header, sizeof(query_trace_header), 1, file) != 1) ||
+          (header.magic != query_trace_header::trace_magic) || (header.version != query_trace_header::trace_version)) {
+        fclose(file);
+        throw ::bliss::io::IOException("ERROR: not a query trace file: " + filename);
+      }
+      if ((header.kmer_bytes != sizeof(KmerType)) || (header.k != KmerType::size) ||
+          (header.bits_per_char != KmerType::bitsPerChar)) {
+        fclose(file);
+        throw ::bliss::io::IOException("ERROR: query trace file " + filename + " was recorded with a different kmer type");
+      }
+    }
+
+    ~query_trace_reader() {
+      if (file != NULL) fclose(file);
+    }
+
+    query_trace_reader(query_trace_reader const &) = delete;
+    query_trace_reader & operator=(query_trace_reader const &) = delete;
+
+    query_trace_header const & get_header() const { return header; }
+
+    /// read the next batch.  false at the end of the trace.  a truncated last record ends the trace with a warning.
+    bool next(query_trace_batch<KmerType> & batch) {
+      query_trace_record rec;
+      if (fread(&rec, sizeof(query_trace_record), 1, file) != 1) return false;
+
+      batch.op = static_cast<query_op>(rec.op);
+      batch.time = rec.time;
+      batch.batch_size = rec.batch_size;
+      batch.kmers.resize(rec.recorded);
+      if (fread(batch.kmers.data(), sizeof(KmerType), rec.recorded, file) != rec.recorded) {
+        BL_WARNINGF("query_trace_reader: %s ends in a truncated record.", filename.c_str());
+        batch.kmers.clear();
+        return false;
+      }
+      return true;
+    }
+
+    /// all batches from the current position.
+    ::std::vector<query_trace_batch<KmerType> > read_all() {
+      ::std::vector<query_trace_batch<KmerType> > batches;
+      query_trace_batch<KmerType> batch;
+      while (next(batch)) batches.emplace_back(::std::move(batch));
+      return batches;
+    }
+};
+
+/// trace file name of a rank.
+inline ::std::string query_trace_filename(::std::string const & prefix, int const & rank) {
+  return prefix + "." + ::std::to_string(rank);
+}
+
+} /* namespace index */
+} /* namespace bliss */
+
+#endif // BLISS_INDEX_QUERY_TRACE_HPP
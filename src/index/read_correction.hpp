@@ -0,0 +1,425 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_correction.hpp
+ * @ingroup index
+ * @brief   kmer spectrum read error correction of a FASTQ file against a count index of the same reads.
+ * @details  pass 1 builds the count index, e.g. with Index::build_streaming_posix.  pass 2, correct(), walks the process's
+ *          record aligned partition in batches of reads.  for each batch:
+ *            1. the kmers of the reads are looked up with 1 find_values call, so only the counts come back, in read order.
+ *               a kmer is solid if its count is at least the threshold, and weak otherwise.
+ *            2. the unique weak kmers are looked up with 1 find_neighbors call at hamming distance 1.  each solid neighbor
+ *               is a candidate substitution (position in the kmer, character).
+ *            3. for each read, each weak kmer votes for its candidates, at their positions in the read.  a position covered by
+ *               a solid kmer is not changed.  otherwise it is changed to the candidate with the most votes, if no other
+ *               candidate of the position has as many, up to max_corrections per read, most votes first.
+ *            4. the batch's records are written to the output file at their input offsets, with the collective MPI-IO write.
+ *               substitutions do not change the record sizes, so the output has the same layout as the input.
+ *
+ *          all processes make the same number of collective calls.  kmers with characters outside the alphabet, e.g. N, are
+ *          skipped, and those characters are not changed.  substitutions only; no insertions or deletions.
+ */
+#ifndef BLISS_INDEX_READ_CORRECTION_HPP
+#define BLISS_INDEX_READ_CORRECTION_HPP
+
+#include <vector>
+#include <utility>    // pair
+#include <algorithm>  // sort, unique, equal_range
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>     // tolower, toupper
+#include <iterator>   // iterator_traits, advance
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/sequence.hpp"
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/io_exception.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/file_utils.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// correction totals of the current process.
+struct correction_stats {
+    /// reads in the process's partition.
+    size_t reads;
+    /// reads with at least 1 substitution.
+    size_t corrected_reads;
+    /// substitutions.
+    size_t corrections;
+
+    correction_stats() : reads(0), corrected_reads(0), corrections(0) {}
+};
+
+/**
+ * @brief kmer spectrum error correction of FASTQ reads.
+ * @tparam IndexType   count index, e.g. CountIndex2<counting_unordered_map<...> >, built from the reads to correct.
+ *                     its map needs find_values and find_neighbors.
+ */
+template <typename IndexType>
+class read_correction_engine {
+  public:
+    using KmerType = typename IndexType::KmerType;
+    using ValueType = typename IndexType::ValueType;
+    using Alphabet = typename IndexType::Alphabet;
+
+  protected:
+    using CharIterType = typename ::bliss::io::file_data::const_iterator;
+    using SeqType = typename ::std::iterator_traits<::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> >::value_type;
+
+    /// substitution that makes a weak kmer solid:  character c at position pos of the kmer, 0 is the first character.
+    struct candidate {
+        KmerType kmer;
+        uint32_t pos;
+        uint8_t c;
+    };
+
+    /// vote of a weak kmer for character c at position pos of a read.
+    struct vote {
+        uint32_t pos;
+        uint8_t c;
+
+        bool operator<(vote const & other) const {
+          return (pos < other.pos) || ((pos == other.pos) && (c < other.c));
+        }
+        bool operator==(vote const & other) const {
+          return (pos == other.pos) && (c == other.c);
+        }
+    };
+
+    IndexType const & index;
+    mxx::comm const & comm;
+
+    /// minimum count of a solid kmer.
+    ValueType solid;
+    /// maximum number of substitutions per read.
+    size_t max_corrections;
+
+    /// kmers of the batch in read order, the offset of each in its read, and the first kmer of each read.
+    std::vector<KmerType> keys;
+    std::vector<uint32_t> offsets;
+    std::vector<size_t> read_kmers;
+
+    static constexpr unsigned int k = KmerType::size;
+
+    /// true if c is a character of the alphabet, in either case.
+    static bool is_valid(unsigned char c) {
+      return Alphabet::TO_ASCII[Alphabet::FROM_ASCII[c]] == static_cast<char>(::toupper(c));
+    }
+
+    /// the kmers of 1 read that have only valid characters.
+    template <typename Iter>
+    void add_kmers(Iter first, Iter last) {
+      KmerType kmer;
+      size_t run = 0;
+      uint32_t i = 0;
+      for (; first != last; ++first, ++i) {
+        if (!is_valid(*first)) {
+          run = 0;
+          continue;
+        }
+        kmer.nextFromChar(Alphabet::FROM_ASCII[static_cast<unsigned char>(*first)]);
+        if (++run >= k) {
+          keys.emplace_back(kmer);
+          offsets.emplace_back(i + 1 - k);
+        }
+      }
+    }
+
+    /// if n differs from q at exactly 1 character, get its position and n's character there.
+    static bool get_substitution(KmerType const & q, KmerType const & n, uint32_t & pos, uint8_t & c) {
+      KmerType diff = q ^ n;
+      KmerType x = n;
+      unsigned int found = 0;
+      // the last character of the kmer is in the lowest bits.
+      for (unsigned int i = 0; i < k; ++i, diff = diff >> 1, x = x >> 1) {
+        if (diff.getSuffix(KmerType::bitsPerChar) == 0) continue;
+        ++found;
+        pos = k - 1 - i;
+        c = static_cast<uint8_t>(x.getSuffix(KmerType::bitsPerChar));
+      }
+      return found == 1;
+    }
+
+    /// candidate substitutions of the weak kmers, sorted by kmer.  COLLECTIVE.
+    std::vector<candidate> get_candidates(std::vector<KmerType> const & weak) const {
+      auto found = index.get_map().find_neighbors(weak, 1);
+
+      std::vector<candidate> cands;
+      cands.reserve(found.size());
+      uint32_t pos;
+      uint8_t c;
+      for (auto const & f : found) {
+        if (f.second.second < solid) continue;
+        // the entry is input transformed, e.g. the reverse complement of the neighbor.
+        if (get_substitution(f.first, f.second.first, pos, c) ||
+            get_substitution(f.first, f.second.first.reverse_complement(), pos, c)) {
+          cands.push_back(candidate{f.first, pos, c});
+        }
+      }
+      std::sort(cands.begin(), cands.end(), [](candidate const & x, candidate const & y) { return x.kmer < y.kmer; });
+      return cands;
+    }
+
+    /**
+     * @brief choose and apply the substitutions of 1 read.
+     * @param seq     the read's sequence in the output buffer.
+     * @param len     sequence length.
+     * @param first   index of the read's first kmer in keys.
+     * @param last    end of the read's kmers.
+     * @return        number of substitutions.
+     */
+    size_t correct_read(unsigned char * seq, size_t const & len, size_t const & first, size_t const & last,
+                        std::vector<ValueType> const & counts, std::vector<candidate> const & cands,
+                        std::vector<vote> & votes, std::vector<int> & trusted) const {
+      votes.clear();
+      trusted.assign(len + 1, 0);
+
+      auto less = [](candidate const & x, KmerType const & y) { return x.kmer < y; };
+      auto greater = [](KmerType const & x, candidate const & y) { return x < y.kmer; };
+      bool weak = false;
+      for (size_t i = first; i < last; ++i) {
+        if (counts[i] >= solid) {
+          // positions covered by a solid kmer.
+          ++trusted[offsets[i]];
+          --trusted[offsets[i] + k];
+          continue;
+        }
+        weak = true;
+        auto lo = std::lower_bound(cands.begin(), cands.end(), keys[i], less);
+        auto hi = std::upper_bound(lo, cands.end(), keys[i], greater);
+        for (; lo != hi; ++lo) votes.push_back(vote{offsets[i] + lo->pos, lo->c});
+      }
+      if (!weak || votes.empty()) return 0;
+
+      for (size_t i = 1; i < len; ++i) trusted[i] += trusted[i - 1];
+
+      // (votes, vote) of the best candidate of each untrusted position, if it is the only best.
+      std::sort(votes.begin(), votes.end());
+      std::vector<std::pair<size_t, vote> > best;
+      size_t j, n, top = 0;
+      bool tie = false;
+      for (size_t i = 0; i < votes.size(); i = j) {
+        for (j = i + 1; (j < votes.size()) && (votes[j] == votes[i]); ++j);
+        n = j - i;
+
+        if (best.empty() || (best.back().second.pos != votes[i].pos)) {
+          if (!best.empty() && tie) best.pop_back();
+          best.emplace_back(n, votes[i]);
+          top = n;
+          tie = false;
+        } else if (n > top) {
+          best.back() = std::make_pair(n, votes[i]);
+          top = n;
+          tie = false;
+        } else if (n == top) {
+          tie = true;
+        }
+      }
+      if (!best.empty() && tie) best.pop_back();
+
+      std::sort(best.begin(), best.end(), [](std::pair<size_t, vote> const & x, std::pair<size_t, vote> const & y) {
+        return x.first > y.first;
+      });
+
+      size_t changed = 0;
+      for (auto const & b : best) {
+        if (changed >= max_corrections) break;
+        if (trusted[b.second.pos] > 0) continue;
+        if (!is_valid(seq[b.second.pos])) continue;
+        seq[b.second.pos] = Alphabet::TO_ASCII[b.second.c];
+        ++changed;
+      }
+      return changed;
+    }
+
+    /// collectively write a local range of bytes, in chunks.  all processes participate in every round.
+    static int write_at_all(MPI_File & fh, MPI_Offset offset, unsigned char const * ptr, size_t bytes, ::mxx::comm const & comm) {
+      constexpr size_t chunk = 64UL * 1024UL * 1024UL;
+      size_t rounds = ::mxx::allreduce((bytes + chunk - 1) / chunk, ::mxx::max<size_t>(), comm);
+
+      MPI_Status stat;
+      int res = MPI_SUCCESS, r_res;
+      size_t pos = 0, n;
+      for (size_t r = 0; r < rounds; ++r) {
+        n = ::std::min(chunk, bytes - pos);
+        r_res = MPI_File_write_at_all(fh, offset + pos, const_cast<unsigned char *>(ptr) + pos, n, MPI_BYTE, &stat);
+        if (res == MPI_SUCCESS) res = r_res;
+        pos += n;
+      }
+      return res;
+    }
+
+    static void throw_io_error(::std::string const & filename, int res, ::mxx::comm const & comm) {
+      char msg[MPI_MAX_ERROR_STRING];
+      int len = 0;
+      MPI_Error_string(res, msg, &len);
+
+      ::std::stringstream ss;
+      ss << "ERROR : bliss::index::kmer::read_correction_engine::correct: rank " << comm.rank() << " [" << filename << "] " << ::std::string(msg, len);
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+    }
+
+  public:
+    /**
+     * @param _index            count index of the reads.
+     * @param _solid            minimum count of a solid kmer.
+     * @param _max_corrections  maximum number of substitutions per read.
+     */
+    read_correction_engine(IndexType const & _index, mxx::comm const & _comm,
+                           ValueType const & _solid = 3, size_t const & _max_corrections = 4) :
+      index(_index), comm(_comm), solid(_solid), max_corrections(_max_corrections) {}
+
+    virtual ~read_correction_engine() {};
+
+    /**
+     * @brief correct the reads of a FASTQ file and write them to out_filename.  collective.
+     * @details  the partition is loaded once.  the lookups and the writes are per batch, so the kmer and query buffers are
+     *           bounded by batch_bytes.
+     * @param batch_bytes   bytes of records per batch.
+     * @return              totals of the current process.
+     */
+    correction_stats correct(std::string const & filename, std::string const & out_filename, size_t const & batch_bytes = (1UL << 26)) {
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if (extension.compare("fastq") != 0) {
+        throw std::invalid_argument("read correction supports FASTQ files only.");
+      }
+
+      BL_BENCH_INIT(correct);
+
+      BL_BENCH_START(correct);
+      ::bliss::io::file_data partition = ::bliss::io::KmerFileHelper::template open_file<
+          ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser> >(filename, 0, comm);
+
+      ::bliss::io::FASTQParser<CharIterType> seq_parser;
+      seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), comm);
+      BL_BENCH_END(correct, "open", partition.getRange().size());
+
+      MPI_File fh;
+      int res = MPI_File_open(comm, const_cast<char *>(out_filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+      if (res != MPI_SUCCESS) throw_io_error(out_filename, res, comm);
+      // same size as the input.
+      res = MPI_File_set_size(fh, partition.parent_range_bytes.end);
+
+      correction_stats stats;
+      std::vector<SeqType> reads;
+      std::vector<ValueType> counts;
+      std::vector<KmerType> weak;
+      std::vector<vote> votes;
+      std::vector<int> trusted;
+      std::vector<unsigned char> out;
+
+      ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+      ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_end(partition.in_mem_cend());
+
+      size_t batch_start = partition.valid_range_bytes.start;
+      size_t batch_end;
+      bool more = (partition.getRange().size() > 0) && (seqs_start != seqs_end);
+      size_t batches = 0;
+
+      BL_BENCH_START(correct);
+      while (::mxx::any_of(more, comm)) {
+        reads.clear();
+        keys.clear();
+        offsets.clear();
+        read_kmers.assign(1, 0);
+        out.clear();
+        batch_end = batch_start;
+
+        if (more) {
+          // the records of the batch.
+          for (; seqs_start != seqs_end; ++seqs_start) {
+            auto seq = *seqs_start;
+            if (!reads.empty() && (seq.id.get_pos() >= batch_start + batch_bytes)) break;
+            reads.emplace_back(seq);
+            add_kmers(seq.seq_begin, seq.seq_end);
+            read_kmers.emplace_back(keys.size());
+          }
+          more = (seqs_start != seqs_end);
+          batch_end = more ? (*seqs_start).id.get_pos() : partition.valid_range_bytes.end;
+
+          CharIterType b = partition.in_mem_cbegin();
+          std::advance(b, batch_start - partition.in_mem_range_bytes.start);
+          CharIterType e = b;
+          std::advance(e, batch_end - batch_start);
+          out.assign(b, e);
+        }
+
+        // 1. counts of the kmers, in read order.
+        counts = index.get_map().find_values(keys, ValueType(0));    // COLLECTIVE CALL
+
+        // 2. substitutions that make the weak kmers solid.
+        weak.clear();
+        for (size_t i = 0; i < keys.size(); ++i) {
+          if (counts[i] < solid) weak.emplace_back(keys[i]);
+        }
+        std::sort(weak.begin(), weak.end());
+        weak.erase(std::unique(weak.begin(), weak.end()), weak.end());
+        std::vector<candidate> cands = get_candidates(weak);    // COLLECTIVE CALL
+
+        // 3. vote and correct each read in the output buffer.
+        size_t changed;
+        for (size_t r = 0; r < reads.size(); ++r) {
+          changed = correct_read(out.data() + (reads[r].seq_global_offset() - batch_start), reads[r].seq_size(),
+                                 read_kmers[r], read_kmers[r + 1], counts, cands, votes, trusted);
+          ++stats.reads;
+          if (changed > 0) ++stats.corrected_reads;
+          stats.corrections += changed;
+        }
+
+        // 4. write the batch at its input offset.
+        int w_res = write_at_all(fh, batch_start, out.data(), out.size(), comm);    // COLLECTIVE CALL
+        if (res == MPI_SUCCESS) res = w_res;
+
+        batch_start = batch_end;
+        ++batches;
+      }
+      BL_BENCH_END(correct, "correct", batches);
+
+      int c_res = MPI_File_close(&fh);
+      if (res == MPI_SUCCESS) res = c_res;
+      if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+        throw_io_error(out_filename, (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res, comm);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(correct, "read_correction:correct", comm);
+      return stats;
+    }
+};
+
+template <typename IndexType>
+constexpr unsigned int read_correction_engine<IndexType>::k;
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_READ_CORRECTION_HPP
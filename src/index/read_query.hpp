@@ -0,0 +1,247 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_query.hpp
+ * @ingroup index
+ * @brief   streams a query FASTQ/FASTA file against an Index, and aggregates the lookup results per read.
+ * @details  the query file is read in batches with KmerFileHelper::read_file_streamed, and the kmers are generated with
+ *          KmerPositionTupleParser, so each kmer carries the id of its read and its offset in the record.  for each batch,
+ *          the unique (input transformed) kmers are looked up with 1 collective Index::find or count, and then the batch is
+ *          walked in read order, reducing the results of each query kmer into its read's aggregate.  the aggregates of the
+ *          batch are passed to the consumer, so no read to kmer side table or regrouping sort is needed.
+ *
+ *          FASTQ batches are record aligned, so each read is reported once.  FASTA sequences may span processes, in which
+ *          case each process reports its part of the sequence under the same read id.  reads without kmers are not
+ *          reported.  the kmer ids are ShortSequenceKmerId by default, i.e. records are limited to 64K characters.
+ */
+#ifndef BLISS_INDEX_READ_QUERY_HPP
+#define BLISS_INDEX_READ_QUERY_HPP
+
+#include <vector>
+#include <utility>    // pair
+#include <algorithm>  // sort, unique, equal_range
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <cctype>     // tolower
+
+#include <mxx/comm.hpp>
+
+#include "common/sequence.hpp"
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/fasta_loader.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/kmer_parser.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/file_utils.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+/// hit summary of 1 read.
+struct read_hits {
+    /// query kmers in the read.
+    size_t kmers;
+    /// query kmers found in the index.
+    size_t hits;
+    /// offsets in the record of the found kmers, if requested.
+    std::vector<uint16_t> positions;
+
+    read_hits() : kmers(0), hits(0) {}
+};
+
+/**
+ * @brief per read query front end of an Index.
+ * @tparam IndexType   e.g. CountIndex2<...>.  needs find(std::vector<KmerType>&), count(std::vector<KmerType>&), and get_map().
+ * @tparam KmerIdType  id attached to each query kmer by the parser.  get_id() is the read id, get_pos() - get_id() the offset.
+ */
+template <typename IndexType, typename KmerIdType = ::bliss::common::ShortSequenceKmerId>
+class read_query_engine {
+  public:
+    using KmerType = typename IndexType::KmerType;
+    using TupleType = std::pair<KmerType, KmerIdType>;
+    using KmerParserType = ::bliss::index::kmer::KmerPositionTupleParser<TupleType>;
+
+    using find_result_type = decltype(::std::declval<IndexType const &>().find(::std::declval<std::vector<KmerType> &>()));
+    using count_result_type = decltype(::std::declval<IndexType const &>().count(::std::declval<std::vector<KmerType> &>()));
+    using find_value_type = typename find_result_type::value_type;
+    using count_value_type = typename count_result_type::value_type;
+
+    /// aggregate of 1 read:  (read id, reduced value)
+    template <typename Result>
+    using read_result = std::pair<size_t, Result>;
+
+  protected:
+    IndexType const & index;
+    mxx::comm const & comm;
+
+    /// transformed kmers of the batch, in batch order, and their sorted unique copy for the lookup.
+    std::vector<KmerType> keys;
+    std::vector<KmerType> unique;
+
+    struct result_less {
+        template <typename V>
+        inline bool operator()(V const & x, KmerType const & y) const { return x.first < y; }
+        template <typename V>
+        inline bool operator()(KmerType const & x, V const & y) const { return x < y.first; }
+    };
+
+    /// input transformed keys of the batch, and the sorted unique keys.
+    void prepare_keys(std::vector<TupleType> const & batch) {
+      keys.clear();
+      keys.reserve(batch.size());
+      for (auto const & t : batch) keys.emplace_back(t.first);
+      index.get_map().transform_input(keys);
+
+      unique.assign(keys.begin(), keys.end());
+      std::sort(unique.begin(), unique.end());
+      unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    }
+
+    /**
+     * @brief walk the batch in read order, and reduce the sorted lookup results of each query kmer into its read's aggregate.
+     * @param reduce  called as reduce(Result &, TupleType const & query, ResultIter first, ResultIter last).
+     */
+    template <typename Result, typename Results, typename Reducer>
+    void aggregate(std::vector<TupleType> const & batch, Results const & found, Reducer & reduce,
+                   std::vector<read_result<Result> > & reads) const {
+      reads.clear();
+      size_t read_id = 0;
+      for (size_t i = 0; i < batch.size(); ++i) {
+        size_t id = batch[i].second.get_id();
+        if (reads.empty() || (id != read_id)) {
+          read_id = id;
+          reads.emplace_back(id, Result());
+        }
+        auto range = std::equal_range(found.begin(), found.end(), keys[i], result_less());
+        reduce(reads.back().second, batch[i], range.first, range.second);
+      }
+    }
+
+    /// check that the file extension matches the sequence parser.
+    template <template <typename> class SeqParser>
+    static void check_file(std::string const & filename) {
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+        throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+      } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+        throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+      } else if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+    }
+
+  public:
+    read_query_engine(IndexType const & _index, mxx::comm const & _comm) : index(_index), comm(_comm) {}
+
+    virtual ~read_query_engine() {};
+
+    /**
+     * @brief query the kmers of each read in a file with Index::find, and reduce the found entries per read.  collective.
+     * @details  consumer is called with a std::vector<read_result<Result> >& for each batch, the same number of times on all
+     *           processes.  the vector is reused between calls.
+     * @tparam Result       per read aggregate.  default constructed for each read.
+     * @param block_size    for FASTQ, number of bytes of file to read per batch.  for FASTA, number of bytes of kmers per batch.
+     * @param reduce        called as reduce(Result &, TupleType const & query, first, last) for each query kmer, with the
+     *                      found (kmer, value) entries of the transformed kmer.  the range is empty if not found.
+     * @return              number of reads and number of query kmers of the current process.
+     */
+    template <typename Result, typename FileReader, template <typename> class SeqParser,
+              template <typename,  template <typename> class> class SeqIterType, typename Reducer, typename Consumer>
+    std::pair<size_t, size_t> query(std::string const & filename, size_t const & block_size,
+                                    Reducer reduce, Consumer & consumer) {
+      check_file<SeqParser>(filename);
+
+      BL_BENCH_INIT(query);
+
+      std::vector<read_result<Result> > reads;
+      size_t batches = 0;
+      auto lookup = [this, &reduce, &consumer, &reads, &batches](std::vector<TupleType> & batch) {
+        prepare_keys(batch);
+        find_result_type found = index.find(unique);       // COLLECTIVE CALL
+        std::sort(found.begin(), found.end(), [](find_value_type const & x, find_value_type const & y) { return x.first < y.first; });
+
+        this->template aggregate<Result>(batch, found, reduce, reads);
+        consumer(reads);
+        ++batches;
+      };
+
+      BL_BENCH_START(query);
+      auto read = ::bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParserType, SeqParser, SeqIterType>(filename, block_size, lookup, comm);
+      BL_BENCH_END(query, "read_find", batches);
+
+      BL_BENCH_REPORT_MPI_NAMED(query, "read_query:query", comm);
+      return read;
+    }
+
+    /**
+     * @brief count the query kmers of each read that are in the index, with Index::count.  collective.
+     * @details  consumer is called with a std::vector<read_result<read_hits> >& for each batch, the same number of times on
+     *           all processes.  count sends back 1 count per unique kmer instead of the entries, so this is cheaper than query().
+     * @param positions     if true, record the offsets of the found kmers in each read.
+     * @return              number of reads and number of query kmers of the current process.
+     */
+    template <typename FileReader, template <typename> class SeqParser,
+              template <typename,  template <typename> class> class SeqIterType, typename Consumer>
+    std::pair<size_t, size_t> count_hits(std::string const & filename, size_t const & block_size,
+                                         Consumer & consumer, bool positions = false) {
+      check_file<SeqParser>(filename);
+
+      BL_BENCH_INIT(query);
+
+      auto reduce = [positions](read_hits & r, TupleType const & q,
+          typename count_result_type::const_iterator first, typename count_result_type::const_iterator last) {
+        ++r.kmers;
+        if ((first != last) && (first->second > 0)) {
+          ++r.hits;
+          if (positions) r.positions.emplace_back(static_cast<uint16_t>(q.second.get_pos() - q.second.get_id()));
+        }
+      };
+
+      std::vector<read_result<read_hits> > reads;
+      size_t batches = 0;
+      auto lookup = [this, &reduce, &consumer, &reads, &batches](std::vector<TupleType> & batch) {
+        prepare_keys(batch);
+        count_result_type counted = index.count(unique);       // COLLECTIVE CALL
+        std::sort(counted.begin(), counted.end(), [](count_value_type const & x, count_value_type const & y) { return x.first < y.first; });
+
+        this->template aggregate<read_hits>(batch, counted, reduce, reads);
+        consumer(reads);
+        ++batches;
+      };
+
+      BL_BENCH_START(query);
+      auto read = ::bliss::io::KmerFileHelper::template read_file_streamed<FileReader, KmerParserType, SeqParser, SeqIterType>(filename, block_size, lookup, comm);
+      BL_BENCH_END(query, "read_count", batches);
+
+      BL_BENCH_REPORT_MPI_NAMED(query, "read_query:count_hits", comm);
+      return read;
+    }
+};
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_READ_QUERY_HPP
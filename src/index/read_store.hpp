@@ -0,0 +1,372 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_store.hpp
+ * @ingroup index
+ * @brief   distributed store of packed reads, for retrieving the sequence around a kmer position without re-reading the input.
+ * @details  each process keeps the reads of its partition of the FASTQ file, packed as in packed_sequence_file (the
+ *          PackedStringImpl layout, e.g. 2 bits per DNA char), and a table of the first word of each read.  the reads
+ *          are identified by the file position of the record, and characters by the offset from the record start, i.e.
+ *          the two fields of the ShortSequenceKmerId of a position index.  the first record position of each process is
+ *          allgathered, so the owner of a read is found by binary search.
+ *
+ *          fetch sends the requests to the owners with imxx::distribute.  each owner extracts the substrings, re-packed to
+ *          start on a word boundary, and returns the lengths with imxx::undistribute and the words with 1 all2allv.
+ *          the requester unpacks the substrings to ASCII in the order of the requests.
+ *
+ *          FASTQ only, since FASTA sequences span processes.
+ */
+#ifndef BLISS_INDEX_READ_STORE_HPP
+#define BLISS_INDEX_READ_STORE_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>  // upper_bound, lower_bound, min, max
+#include <numeric>    // accumulate
+#include <cstdint>
+#include <stdexcept>
+#include <cctype>     // tolower
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/sequence.hpp"
+#include "common/alphabet_traits.hpp"
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/packed_sequence_file.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/byte_transport.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/file_utils.hpp"
+
+namespace bliss
+{
+namespace index
+{
+
+/**
+ * @brief  request for the characters [offset, offset + length) of a read.
+ * @details  offset is from the start of the record, as in the kmer ids, so characters before the sequence (the
+ *           header line) and after it are not returned.
+ */
+struct read_fetch_request {
+	/// file position of the record, i.e. ShortSequenceKmerId::get_id().
+	uint64_t record;
+	/// offset from the record start of the first character.
+	uint32_t offset;
+	/// number of characters.
+	uint32_t length;
+
+	read_fetch_request() : record(0), offset(0), length(0) {}
+	read_fetch_request(uint64_t const & _record, uint32_t const & _offset, uint32_t const & _length) :
+		record(_record), offset(_offset), length(_length) {}
+	/// length characters starting at a kmer position.
+	read_fetch_request(::bliss::common::ShortSequenceKmerId const & id, uint32_t const & _length) :
+		record(id.get_id()), offset(static_cast<uint32_t>(id.get_pos() - id.get_id())), length(_length) {}
+};
+
+} // namespace index
+} // namespace bliss
+
+
+namespace mxx {
+  template<>
+    struct datatype_builder<::bliss::index::read_fetch_request> :
+    public datatype_contiguous<uint8_t, sizeof(::bliss::index::read_fetch_request)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(::bliss::index::read_fetch_request)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+}  // namespace mxx
+
+namespace imxx {
+  template<>
+    struct is_byte_transport<::bliss::index::read_fetch_request> : public ::std::integral_constant<bool,
+      sizeof(::bliss::index::read_fetch_request) == 2 * sizeof(uint64_t)> {};
+}  // namespace imxx
+
+
+namespace bliss
+{
+namespace index
+{
+
+/**
+ * @brief  distributed packed reads.  see file description.  build, load, fetch, and size are collective.
+ * @tparam Alphabet   alphabet of the reads, e.g. the KmerAlphabet of the index.
+ */
+template <typename Alphabet>
+class read_store {
+public:
+	using file_type = ::bliss::io::packed_sequence_file<Alphabet>;
+	using data_type = typename file_type::data_type;
+	using record_type = typename file_type::record_type;
+	using word_type = typename file_type::word_type;
+
+	static constexpr unsigned int bits_per_char = file_type::bits_per_char;
+	static constexpr size_t chars_per_word = file_type::chars_per_word;
+
+protected:
+	/// local reads, in file order.
+	data_type data;
+	/// first word of each local read.  1 more entry than reads.
+	::std::vector<uint64_t> word_offsets;
+
+	/// first record position of each process that has reads, and its rank.
+	::std::vector<uint64_t> splitters;
+	::std::vector<int> splitter_ranks;
+
+	const mxx::comm & comm;
+
+	/// owner of a request:  the last process whose first record is not after the requested one.
+	struct RequestToRank {
+		::std::vector<uint64_t> const & splitters;
+		::std::vector<int> const & ranks;
+		RequestToRank(::std::vector<uint64_t> const & _splitters, ::std::vector<int> const & _ranks) :
+			splitters(_splitters), ranks(_ranks) {}
+
+		inline int operator()(read_fetch_request const & req) const {
+			if (ranks.empty()) return 0;
+			size_t i = ::std::upper_bound(splitters.begin(), splitters.end(), req.record) - splitters.begin();
+			return ranks[(i == 0) ? 0 : (i - 1)];
+		}
+	};
+
+	/// index the local reads and exchange the first record positions.
+	void update_tables() {
+		word_offsets.resize(data.records.size() + 1);
+		word_offsets[0] = 0;
+		for (size_t i = 0; i < data.records.size(); ++i) {
+			word_offsets[i + 1] = word_offsets[i] + file_type::get_word_count(data.records[i].length);
+		}
+
+		uint64_t first = data.records.empty() ? 0 : data.records.front().pos_in_file;
+		::std::vector<uint64_t> firsts = ::mxx::allgather(first, comm);
+		::std::vector<size_t> counts = ::mxx::allgather(data.records.size(), comm);
+		splitters.clear();
+		splitter_ranks.clear();
+		for (int r = 0; r < comm.size(); ++r) {
+			if (counts[r] == 0) continue;
+			splitters.emplace_back(firsts[r]);
+			splitter_ranks.emplace_back(r);
+		}
+	}
+
+	/// character i of local read rec.
+	inline word_type get_char(size_t const & rec, size_t const & i) const {
+		return (data.words[word_offsets[rec] + i / chars_per_word] >> ((i % chars_per_word) * bits_per_char)) &
+				((static_cast<word_type>(1) << bits_per_char) - 1);
+	}
+
+	/// find a local read and clip the request to its sequence.  returns the read, or data.records.size() if empty.
+	size_t locate(read_fetch_request const & req, size_t & start, size_t & len) const {
+		start = 0;
+		len = 0;
+		auto it = ::std::lower_bound(data.records.begin(), data.records.end(), req.record,
+				[](record_type const & r, uint64_t const & pos) { return r.pos_in_file < pos; });
+		if ((it == data.records.end()) || (it->pos_in_file != req.record)) return data.records.size();
+
+		size_t first = ::std::max(static_cast<uint64_t>(req.offset), it->seq_begin_offset);
+		size_t last = ::std::min(static_cast<uint64_t>(req.offset) + req.length, it->seq_begin_offset + it->length);
+		if (first >= last) return data.records.size();
+
+		start = first - it->seq_begin_offset;
+		len = last - first;
+		return it - data.records.begin();
+	}
+
+public:
+	read_store(const mxx::comm & _comm) : word_offsets(1, 0), comm(_comm) {}
+
+	virtual ~read_store() {}
+
+	/**
+	 * @brief  pack the reads of a FASTQ file.  each process keeps the reads whose sequences start in its partition.
+	 * @return the number of local reads.
+	 */
+	template <typename FileType = ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser> >
+	size_t build(std::string const & filename) {
+		std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension.compare("fastq") != 0) {
+			throw std::invalid_argument("read_store supports FASTQ files only.");
+		}
+
+		BL_BENCH_INIT(read_store);
+
+		BL_BENCH_START(read_store);
+		data.clear();
+		{
+			::bliss::io::file_data partition = ::bliss::io::KmerFileHelper::template open_file<FileType>(filename, 0, comm);
+			::bliss::io::FASTQParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+			seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), comm);
+			if (partition.getRange().size() > 0) {
+				::bliss::io::KmerFileHelper::template pack_block<Alphabet>(partition, seq_parser, data);
+			}
+		}
+		BL_BENCH_END(read_store, "pack", data.records.size());
+
+		BL_BENCH_COLLECTIVE_START(read_store, "index", comm);
+		update_tables();
+		BL_BENCH_END(read_store, "index", data.words.size());
+
+		BL_BENCH_REPORT_MPI_NAMED(read_store, "read_store:build", comm);
+		return data.records.size();
+	}
+
+	/// load the reads of a packed sequence file, e.g. from KmerFileHelper::write_packed_file.  partitioned by words.
+	size_t load(std::string const & packed_filename) {
+		file_type::read(packed_filename, data, comm);
+		update_tables();
+		return data.records.size();
+	}
+
+	/// save the reads as a packed sequence file.
+	void save(std::string const & packed_filename) const {
+		file_type::write(packed_filename, data, comm);
+	}
+
+	/// local reads, e.g. for KmerFileHelper::parse_packed_data, to build an index from the same reads.
+	data_type const & get_data() const { return data; }
+
+	/// number of local reads.
+	size_t local_size() const { return data.records.size(); }
+	/// number of reads on all processes.
+	size_t size() const { return ::mxx::allreduce(data.records.size(), comm); }
+	/// bytes of the local reads and tables.
+	size_t local_bytes() const {
+		return data.words.size() * sizeof(word_type) + data.records.size() * sizeof(record_type) +
+				data.blocks.size() * sizeof(typename file_type::block_type) + word_offsets.size() * sizeof(uint64_t);
+	}
+
+	/// the characters of a local request as ASCII.  empty if the read is not local.
+	std::string local_fetch(read_fetch_request const & req) const {
+		size_t start, len;
+		size_t rec = locate(req, start, len);
+		std::string out(len, ' ');
+		for (size_t i = 0; i < len; ++i) out[i] = Alphabet::TO_ASCII[get_char(rec, start + i)];
+		return out;
+	}
+
+	/**
+	 * @brief  fetch substrings of reads on any process.
+	 * @param requests   unchanged.
+	 * @return  the characters of each request as ASCII, in the order of the requests.  requests for reads that are not
+	 *          in the store, or outside of the sequence, give empty strings.
+	 */
+	std::vector<std::string> fetch(std::vector<read_fetch_request> const & requests) const {
+		std::vector<std::string> results(requests.size());
+
+		if (comm.size() == 1) {
+			for (size_t i = 0; i < requests.size(); ++i) results[i] = local_fetch(requests[i]);
+			return results;
+		}
+
+		BL_BENCH_INIT(fetch);
+
+		// send the requests to the owners.
+		BL_BENCH_COLLECTIVE_START(fetch, "dist_query", comm);
+		std::vector<read_fetch_request> query(requests);
+		std::vector<size_t> recv_counts;
+		std::vector<size_t> i2o;
+		std::vector<read_fetch_request> buffer;
+		::imxx::distribute(query, RequestToRank(splitters, splitter_ranks), recv_counts, i2o, buffer, comm);
+		::std::vector<read_fetch_request>().swap(query);
+		BL_BENCH_END(fetch, "dist_query", buffer.size());
+
+		if (recv_counts.empty()) recv_counts.assign(comm.size(), 0);  // no requests on any process.
+
+		// extract the substrings, each starting on a word boundary.
+		BL_BENCH_START(fetch);
+		std::vector<uint32_t> lengths(buffer.size(), 0);
+		std::vector<word_type> words;
+		std::vector<size_t> word_counts(comm.size(), 0);
+		size_t start, len, rec, before, j = 0;
+		for (int r = 0; r < comm.size(); ++r) {
+			before = words.size();
+			for (size_t e = j + recv_counts[r]; j < e; ++j) {
+				rec = locate(buffer[j], start, len);
+				lengths[j] = static_cast<uint32_t>(len);
+				size_t offset = words.size();
+				words.resize(offset + file_type::get_word_count(len), 0);
+				for (size_t i = 0; i < len; ++i) {
+					words[offset + i / chars_per_word] |= get_char(rec, start + i) << ((i % chars_per_word) * bits_per_char);
+				}
+			}
+			word_counts[r] = words.size() - before;
+		}
+		::std::vector<read_fetch_request>().swap(buffer);
+		BL_BENCH_END(fetch, "local_fetch", words.size());
+
+		// return the lengths, in the bucketed order of the requests, and the words.
+		BL_BENCH_COLLECTIVE_START(fetch, "a2a_results", comm);
+		std::vector<uint32_t> bucketed_lengths;
+		::imxx::undistribute(lengths, recv_counts, i2o, bucketed_lengths, comm, false);
+		::mxx::all2allv(words, word_counts, comm).swap(words);
+		BL_BENCH_END(fetch, "a2a_results", words.size());
+
+		// unpack in request order.
+		BL_BENCH_START(fetch);
+		std::vector<size_t> offsets(bucketed_lengths.size() + 1, 0);
+		for (size_t i = 0; i < bucketed_lengths.size(); ++i) {
+			offsets[i + 1] = offsets[i] + file_type::get_word_count(bucketed_lengths[i]);
+		}
+		size_t pos;
+		for (size_t q = 0; q < requests.size(); ++q) {
+			pos = i2o[q];
+			len = bucketed_lengths[pos];
+			std::string & out = results[q];
+			out.resize(len);
+			for (size_t i = 0; i < len; ++i) {
+				out[i] = Alphabet::TO_ASCII[(words[offsets[pos] + i / chars_per_word] >> ((i % chars_per_word) * bits_per_char)) &
+											((static_cast<word_type>(1) << bits_per_char) - 1)];
+			}
+		}
+		BL_BENCH_END(fetch, "unpack", results.size());
+
+		BL_BENCH_REPORT_MPI_NAMED(fetch, "read_store:fetch", comm);
+		return results;
+	}
+
+	/// fetch length characters starting at each kmer position.  see fetch.
+	std::vector<std::string> fetch(std::vector<::bliss::common::ShortSequenceKmerId> const & positions, uint32_t const & length) const {
+		std::vector<read_fetch_request> requests;
+		requests.reserve(positions.size());
+		for (auto const & id : positions) requests.emplace_back(id, length);
+		return fetch(requests);
+	}
+};
+
+template <typename Alphabet>
+constexpr unsigned int read_store<Alphabet>::bits_per_char;
+template <typename Alphabet>
+constexpr size_t read_store<Alphabet>::chars_per_word;
+
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_READ_STORE_HPP
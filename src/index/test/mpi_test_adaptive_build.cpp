@@ -0,0 +1,201 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_adaptive_build.cpp
+ * @ingroup
+ * @brief   tests the streaming build with adaptive block size, with block cyclic reads and of FASTA files against build_posix, and the block size controller.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "io/adaptive_block_size.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+
+
+TEST(AdaptiveBlockSizeTest, update)
+{
+  ::mxx::comm comm;
+  ::bliss::io::adaptive_block_size sizer(1UL << 16, sizeof(KmerType), 32, 1UL << 16, 1UL << 20);
+  EXPECT_EQ(1UL << 16, sizer.get_block_size());
+
+  // growth is limited per round, and by max_block.  ranks without data do not limit the others.
+  size_t bytes = (comm.rank() == 0) ? 0 : (1UL << 16);
+  EXPECT_EQ(1UL << 17, sizer.update(bytes, bytes / 2, 100, comm));
+  EXPECT_EQ(1UL << 18, sizer.update(bytes, bytes / 2, 200, comm));
+  for (int i = 0; i < 5; ++i) sizer.update(bytes, bytes / 2, 300, comm);
+  EXPECT_EQ(1UL << 20, sizer.get_block_size());
+  EXPECT_EQ(7UL, sizer.get_rounds());
+  EXPECT_GE(sizer.get_entry_bytes(), 32.0);
+
+  // less than all memory for 1 round shrinks the block.
+  ::bliss::io::adaptive_block_size small(1UL << 20, 1UL << 20, 1UL << 20, 1UL << 16, 1UL << 30, 1.0e-6);
+  EXPECT_EQ(1UL << 16, small.update(1UL << 20, 1UL << 20, 1UL << 20, comm));
+
+  EXPECT_THROW(::bliss::io::adaptive_block_size(1, 1, 1, 2, 1), std::invalid_argument);
+}
+
+TEST(AdaptiveBlockSizeTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/natural.fastq");
+
+  CountIndexType gold(comm);
+  gold.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  CountIndexType adaptive(comm);
+  ::bliss::io::adaptive_block_size sizer(1UL << 16, sizeof(KmerType), 2 * sizeof(std::pair<KmerType, uint32_t>), 1UL << 16, 1UL << 18);
+  adaptive.template build_streaming_adaptive<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, sizer);
+
+  EXPECT_GT(sizer.get_rounds(), 0UL);
+  EXPECT_EQ(::mxx::allreduce(sizer.get_block_size(), ::mxx::min<size_t>(), comm),
+            ::mxx::allreduce(sizer.get_block_size(), ::mxx::max<size_t>(), comm));
+
+  EXPECT_GT(gold.size(), 0UL);
+  EXPECT_EQ(gold.size(), adaptive.size());
+
+  std::vector<std::pair<KmerType, uint32_t> > g, a;
+  gold.get_map().to_vector(g);
+  adaptive.get_map().to_vector(a);
+  g = ::mxx::allgatherv(g, comm);
+  a = ::mxx::allgatherv(a, comm);
+  std::sort(g.begin(), g.end());
+  std::sort(a.begin(), a.end());
+  EXPECT_TRUE(g == a);
+
+  // the convenience version, with the default controller.
+  CountIndexType adaptive2(comm);
+  adaptive2.template build_streaming_adaptive_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, 1UL << 16);
+  EXPECT_EQ(gold.size(), adaptive2.size());
+}
+
+TEST(StreamingBuildTest, block_cyclic)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/natural.fastq");
+
+  // the blocks of all processes tile the file, which is the partition range in block cyclic mode.
+  ::bliss::io::parallel::block_streaming_file<::bliss::io::posix_file> fobj(filename, 1UL << 16, comm, true);
+  std::vector<std::pair<size_t, size_t> > blocks;
+  ::bliss::io::file_data block;
+  while (fobj.has_next_block()) {
+    fobj.read_next_block(block);
+    blocks.emplace_back(block.getRange().start, block.getRange().end);
+    EXPECT_EQ(block.getRange().size(), block.data.size());
+  }
+  blocks = ::mxx::allgatherv(blocks, comm);
+  std::sort(blocks.begin(), blocks.end());
+  ASSERT_FALSE(blocks.empty());
+  EXPECT_EQ(fobj.get_partition_range().start, blocks.front().first);
+  EXPECT_EQ(fobj.get_partition_range().end, blocks.back().second);
+  for (size_t i = 1; i < blocks.size(); ++i) EXPECT_EQ(blocks[i - 1].second, blocks[i].first);
+
+  CountIndexType gold(comm);
+  gold.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  CountIndexType cyclic(comm);
+  cyclic.template build_streaming_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, 1UL << 16, true);
+  EXPECT_EQ(gold.size(), cyclic.size());
+
+  std::vector<std::pair<KmerType, uint32_t> > g, c;
+  gold.get_map().to_vector(g);
+  cyclic.get_map().to_vector(c);
+  g = ::mxx::allgatherv(g, comm);
+  c = ::mxx::allgatherv(c, comm);
+  std::sort(g.begin(), g.end());
+  std::sort(c.begin(), c.end());
+  EXPECT_TRUE(g == c);
+}
+
+TEST(StreamingBuildTest, fasta)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.medium.fasta");
+
+  // the first streaming build finds the sequences and writes the index, the second loads it.
+  if (comm.rank() == 0) remove(::bliss::io::fasta_index::get_index_filename(filename).c_str());
+  comm.barrier();
+
+  CountIndexType gold(comm);
+  gold.template build_posix<::bliss::io::FASTAParser, ::bliss::io::SequencesIterator>(filename, comm);
+  std::vector<std::pair<KmerType, uint32_t> > g;
+  gold.get_map().to_vector(g);
+  g = ::mxx::allgatherv(g, comm);
+  std::sort(g.begin(), g.end());
+
+  // sequences span the 64KB blocks.  block cyclic blocks read the carried bases from the file.
+  for (bool cyclic : {false, true}) {
+    CountIndexType streamed(comm);
+    streamed.template build_streaming_posix<::bliss::io::FASTAParser, ::bliss::io::SequencesIterator>(filename, comm, 1UL << 16, cyclic);
+    EXPECT_EQ(gold.size(), streamed.size());
+
+    std::vector<std::pair<KmerType, uint32_t> > c;
+    streamed.get_map().to_vector(c);
+    c = ::mxx::allgatherv(c, comm);
+    std::sort(c.begin(), c.end());
+    EXPECT_TRUE(g == c);
+  }
+
+  comm.barrier();
+  if (comm.rank() == 0) remove(::bliss::io::fasta_index::get_index_filename(filename).c_str());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
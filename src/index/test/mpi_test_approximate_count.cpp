@@ -0,0 +1,182 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_approximate_count.cpp
+ * @ingroup
+ * @brief   tests the Count-Min sketch estimates of ApproximateCountIndex against the exact counts of a count index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using ApproxIndexType = ::bliss::index::kmer::ApproximateCountIndex<KmerType, CanonicalParams>;
+using PlainApproxIndexType = ::bliss::index::kmer::ApproximateCountIndex<KmerType, CanonicalParams, uint32_t, false>;
+
+
+/// n random kmers from a skewed pool of pool_size kmers shared by all ranks.
+static std::vector<KmerType> make_kmers(size_t const & n, size_t const & pool_size, unsigned int seed) {
+  srand(17);
+  std::vector<KmerType> pool;
+  KmerType km;
+  for (size_t i = 0; i < pool_size; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    pool.emplace_back(km);
+  }
+  srand(seed);
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < n; ++i) {
+    size_t r = rand() % pool_size;
+    kmers.emplace_back(pool[(i % 4 == 0) ? (r % 16) : r]);
+  }
+  return kmers;
+}
+
+/**
+ * check the estimates of the exact index's kmers against the exact counts.
+ * @return  the sum of the estimates, for comparing plain and conservative updates.
+ */
+template <typename Approx>
+static size_t check_estimates(Approx const & approx, CountIndexType const & exact, ::mxx::comm const & comm) {
+  std::vector<std::pair<KmerType, uint32_t> > gold;
+  exact.get_map().to_vector(gold);
+
+  std::vector<KmerType> query;
+  for (auto const & x : gold) query.emplace_back(x.first);
+  auto est = approx.query(query);
+  EXPECT_EQ(gold.size(), est.size());
+
+  size_t within = 0;
+  size_t sum = 0;
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_GE(static_cast<size_t>(est[i].count), static_cast<size_t>(gold[i].second));
+    EXPECT_LE(est[i].error, approx.error_bound());
+    if (est[i].count <= gold[i].second + est[i].error) ++within;
+    sum += est[i].count;
+  }
+  // bound holds with probability 1 - delta per kmer.
+  size_t all_within = ::mxx::allreduce(within, comm);
+  size_t all = ::mxx::allreduce(gold.size(), comm);
+  EXPECT_GE(static_cast<double>(all_within), 0.95 * static_cast<double>(all));
+
+  // count has the same estimates.
+  query.clear();
+  for (auto const & x : gold) query.emplace_back(x.first);
+  auto counts = approx.count(query);
+  EXPECT_EQ(gold.size(), counts.size());
+  for (size_t i = 0; i < counts.size(); ++i) {
+    EXPECT_TRUE(counts[i].first == gold[i].first);
+    EXPECT_EQ(static_cast<size_t>(est[i].count), counts[i].second);
+  }
+  return ::mxx::allreduce(sum, comm);
+}
+
+
+TEST(ApproximateCountTest, random)
+{
+  ::mxx::comm comm;
+  CountIndexType exact(comm);
+  ApproxIndexType approx(comm, 1.0e-3, 0.01);
+  PlainApproxIndexType plain(comm, 1.0e-3, 0.01);
+
+  EXPECT_EQ(2719UL, approx.get_map().get_width());
+  EXPECT_EQ(5UL, approx.get_map().get_depth());
+  EXPECT_EQ(2719UL * 5UL * sizeof(uint32_t), approx.get_map().local_bytes());
+
+  for (unsigned int b = 0; b < 2; ++b) {
+    std::vector<KmerType> input = make_kmers(20000, 5000, 3 + b + comm.rank());
+    std::vector<KmerType> input2(input), input3(input);
+    exact.insert(input);
+    approx.insert(input2);
+    plain.insert(input3);
+  }
+  EXPECT_EQ(40000UL * comm.size(), approx.size());
+  EXPECT_EQ(approx.size(), plain.size());
+  EXPECT_GT(approx.error_bound(), 0UL);
+
+  size_t conservative_sum = check_estimates(approx, exact, comm);
+  size_t plain_sum = check_estimates(plain, exact, comm);
+  EXPECT_LE(conservative_sum, plain_sum);
+
+  // absent kmers, and 1 process without queries.
+  std::vector<KmerType> query = make_kmers(comm.rank() == 0 ? 0 : 100, 100000, 99 + comm.rank());
+  auto est = approx.query(query);
+  EXPECT_EQ(query.size(), est.size());
+}
+
+TEST(ApproximateCountTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.fastq");
+
+  CountIndexType exact(comm);
+  exact.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  ApproxIndexType approx(comm, 1.0e-4, 0.01);
+  approx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, 1UL << 16);
+
+  size_t total = 0;
+  std::vector<std::pair<KmerType, uint32_t> > gold;
+  exact.get_map().to_vector(gold);
+  for (auto const & x : gold) total += x.second;
+  EXPECT_EQ(::mxx::allreduce(total, comm), approx.size());
+
+  check_estimates(approx, exact, comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
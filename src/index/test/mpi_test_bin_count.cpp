@@ -0,0 +1,136 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_bin_count.cpp
+ * @ingroup
+ * @brief   tests the disk binned kmer counter against gathered gold counts.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_bin_count.hpp"
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+
+/// the kmers of random reads, in sequence order.  reads overlap so that kmers repeat.
+std::vector<KmerType> make_reads(size_t nreads, size_t seed) {
+  std::default_random_engine generator(seed);
+  std::uniform_int_distribution<int> base(0, 3);
+  std::vector<uint8_t> genome(5000);
+  std::default_random_engine g2(7);
+  for (auto & c : genome) c = base(g2);
+
+  std::uniform_int_distribution<size_t> start(0, genome.size() - 150);
+  std::vector<KmerType> kmers;
+  for (size_t r = 0; r < nreads; ++r) {
+    size_t s = start(generator);
+    KmerType kmer;
+    for (size_t i = 0; i < 150; ++i) {
+      kmer.nextFromChar(genome[s + i]);
+      if (i + 1 >= KmerType::size) kmers.emplace_back(kmer);
+    }
+  }
+  return kmers;
+}
+
+template <template <typename> class Transform>
+void check_count(size_t nbins) {
+  ::mxx::comm comm;
+  std::vector<KmerType> kmers = make_reads(200, comm.rank());
+
+  std::map<KmerType, uint32_t> gold;
+  Transform<KmerType> trans;
+  std::vector<KmerType> all = ::mxx::allgatherv(kmers, comm);
+  for (auto const & k : all) ++gold[trans(k)];
+
+  ::bliss::index::kmer::bin_counter<KmerType, uint32_t, Transform> counter(comm, "/tmp", nbins, 256);
+  // in 2 batches.
+  std::vector<KmerType> half(kmers.begin(), kmers.begin() + kmers.size() / 2);
+  counter.add(half);
+  half.assign(kmers.begin() + kmers.size() / 2, kmers.end());
+  counter.add(half);
+  EXPECT_EQ(kmers.size(), counter.local_added());
+
+  // super-kmers are packed smaller than the kmers.
+  size_t bytes = 0;
+  for (size_t b = 0; b < counter.bin_count(); ++b) bytes += counter.bin_size(b);
+  EXPECT_GT(kmers.size() * sizeof(KmerType) / 2, bytes);
+
+  std::vector<std::pair<KmerType, uint32_t> > counts;
+  size_t distinct = counter.count(counts);
+  EXPECT_EQ(counts.size(), distinct);
+  EXPECT_EQ(gold.size(), ::mxx::allreduce(distinct, comm));
+
+  for (auto const & x : counts) {
+    ASSERT_EQ(1UL, gold.count(x.first));
+    EXPECT_EQ(gold.at(x.first), x.second);
+  }
+}
+
+TEST(BinCountTest, canonical)
+{
+  check_count<::bliss::kmer::transform::lex_less>(37);
+}
+
+TEST(BinCountTest, single_strand)
+{
+  check_count<::bliss::transform::identity>(5);
+}
+
+TEST(BinCountTest, one_bin)
+{
+  check_count<::bliss::kmer::transform::lex_less>(1);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
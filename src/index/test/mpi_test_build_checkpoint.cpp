@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_build_checkpoint.cpp
+ * @ingroup
+ * @brief   tests checkpointed streaming builds, resumed after an interruption, against build_posix.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/build_checkpoint.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using MapType = ::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams>;
+using CountIndexType = ::bliss::index::kmer::CountIndex2<MapType>;
+
+/// thrown to interrupt a build.
+struct interrupted {};
+
+class BuildCheckpointTest : public ::testing::Test {
+  protected:
+    ::mxx::comm comm;
+    std::string filename;
+    std::string prefix;
+    CountIndexType gold;
+
+    BuildCheckpointTest() : gold(comm) {}
+
+    virtual void SetUp() {
+      filename = PROJ_SRC_DIR;
+      filename.append("/test/data/test.fastq");
+      prefix = "/tmp/bliss_test_checkpoint";
+      gold.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+    }
+
+    virtual void TearDown() {
+      comm.barrier();
+      std::remove((prefix + ".meta").c_str());
+      for (int s = 0; s < 2; ++s) {
+        std::stringstream ss;
+        ss << prefix << "." << s << "." << comm.rank();
+        std::remove(ss.str().c_str());
+      }
+      comm.barrier();
+    }
+
+    void expect_same(CountIndexType const & index) {
+      EXPECT_EQ(gold.size(), index.size());
+      std::vector<std::pair<KmerType, uint32_t> > g, a;
+      gold.get_map().to_vector(g);
+      index.get_map().to_vector(a);
+      g = ::mxx::allgatherv(g, comm);
+      a = ::mxx::allgatherv(a, comm);
+      std::sort(g.begin(), g.end());
+      std::sort(a.begin(), a.end());
+      EXPECT_TRUE(g == a);
+    }
+
+    bool meta_exists() {
+      FILE * f = fopen((prefix + ".meta").c_str(), "rb");
+      if (f == NULL) return false;
+      fclose(f);
+      return true;
+    }
+
+    /// the first rounds of build_checkpointed, then interrupted.
+    void interrupted_build(::bliss::index::kmer::checkpoint_config const & config, size_t const & block_size, size_t const & rounds) {
+      using Parser = ::bliss::index::kmer::KmerParser<KmerType>;
+      CountIndexType index(comm);
+      ::bliss::index::kmer::build_checkpointer<MapType> checkpointer(index.get_map(), comm, config, filename);
+      size_t consumed = checkpointer.resume();
+      size_t round = 0;
+      auto consumer = [&index](std::vector<KmerType> & batch) { index.get_map().insert(batch); };
+      auto sizer = [&](size_t const & bytes, size_t const &) {
+        consumed += bytes;
+        checkpointer.step(consumed);
+        if (++round == rounds) throw interrupted();
+        return block_size;
+      };
+      EXPECT_THROW((::bliss::io::KmerFileHelper::template read_file_streamed_adaptive<::bliss::io::posix_file, Parser,
+          ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, block_size, consumer, sizer, comm, true, consumed)),
+                   interrupted);
+      // let the last snapshot finish, so that it can be committed on resume.
+      comm.barrier();
+    }
+};
+
+
+TEST_F(BuildCheckpointTest, complete)
+{
+  ::bliss::index::kmer::checkpoint_config config(prefix, 0.0);
+  config.remove_at_end = false;
+
+  CountIndexType index(comm);
+  EXPECT_FALSE((index.template build_checkpointed<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, comm, config, 1UL << 20)));
+  expect_same(index);
+  EXPECT_TRUE(meta_exists());
+
+  // the completed map is the last checkpoint.
+  CountIndexType resumed(comm);
+  EXPECT_TRUE((resumed.template build_checkpointed<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, comm, config, 1UL << 20)));
+  expect_same(resumed);
+
+  // not resumed, and removed at the end.
+  config.resume = false;
+  config.remove_at_end = true;
+  CountIndexType fresh(comm);
+  EXPECT_FALSE((fresh.template build_checkpointed<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, comm, config, 1UL << 20)));
+  expect_same(fresh);
+  EXPECT_FALSE(meta_exists());
+}
+
+TEST_F(BuildCheckpointTest, interrupted)
+{
+  ::bliss::index::kmer::checkpoint_config config(prefix, 0.0);
+
+  // interrupted twice, each time resuming from the checkpoint of the previous attempt.
+  interrupted_build(config, 1UL << 20, 4);
+  EXPECT_TRUE(meta_exists());
+  interrupted_build(config, 1UL << 20, 3);
+
+  CountIndexType index(comm);
+  EXPECT_TRUE((index.template build_checkpointed<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, comm, config, 1UL << 20)));
+  expect_same(index);
+  EXPECT_FALSE(meta_exists());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_build_external.cpp
+ * @ingroup
+ * @brief   tests the pass plan of build_external, and builds in several passes with a small budget, with and without
+ *          the per pass output files, against build_posix.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using MapType = ::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams>;
+using CountIndexType = ::bliss::index::kmer::CountIndex2<MapType>;
+
+
+TEST(ExternalPassesTest, plan)
+{
+  using ::bliss::index::kmer::external_passes;
+
+  // consecutive buckets up to the limit.  a bucket larger than the limit is a pass by itself.
+  EXPECT_EQ(std::vector<size_t>({0, 2, 3, 5}), external_passes(std::vector<size_t>({3, 4, 9, 2, 5}), 8));
+  EXPECT_EQ(std::vector<size_t>({0, 4}), external_passes(std::vector<size_t>({1, 2, 3, 4}), 100));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2, 3}), external_passes(std::vector<size_t>({5, 5, 5}), 1));
+  EXPECT_EQ(std::vector<size_t>({0, 0}), external_passes(std::vector<size_t>(), 10));
+}
+
+class BuildExternalTest : public ::testing::Test {
+  protected:
+    ::mxx::comm comm;
+    std::string filename;
+    std::string output;
+    CountIndexType gold;
+
+    BuildExternalTest() : gold(comm) {}
+
+    virtual void SetUp() {
+      filename = PROJ_SRC_DIR;
+      filename.append("/test/data/natural.fastq");
+      output = "/tmp/bliss_test_external";
+      gold.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+    }
+
+    /// all entries of a map, on all processes, sorted.
+    std::vector<std::pair<KmerType, uint32_t> > entries_of(MapType const & map) {
+      std::vector<std::pair<KmerType, uint32_t> > local;
+      map.to_vector(local);
+      local = ::mxx::allgatherv(local, comm);
+      std::sort(local.begin(), local.end());
+      return local;
+    }
+
+    /// a budget of about 1/4 of the largest process's kmers per pass.
+    ::bliss::index::kmer::external_build_config small_budget() {
+      ::bliss::index::kmer::external_build_config config("/tmp");
+      config.buckets = 64;
+      size_t n = ::mxx::allreduce(gold.local_size(), ::mxx::max<size_t>(), comm);
+      config.mem_bytes = std::max(n, static_cast<size_t>(64)) * 3 * sizeof(KmerType) / 4;
+      return config;
+    }
+};
+
+
+TEST_F(BuildExternalTest, passes)
+{
+  ASSERT_GT(gold.size(), 0UL);
+
+  ::bliss::index::kmer::external_build_config config = small_budget();
+  CountIndexType index(comm);
+  size_t passes = index.template build_external_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, config);
+  EXPECT_GT(passes, 1UL);
+  EXPECT_EQ(gold.size(), index.size());
+  EXPECT_TRUE(entries_of(gold.get_map()) == entries_of(index.get_map()));
+
+  // 1 pass with a budget larger than the input.
+  CountIndexType one(comm);
+  config.mem_bytes = 1UL << 30;
+  EXPECT_EQ(1UL, (one.template build_external_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, config)));
+  EXPECT_TRUE(entries_of(gold.get_map()) == entries_of(one.get_map()));
+}
+
+TEST_F(BuildExternalTest, output)
+{
+  ::bliss::index::kmer::external_build_config config = small_budget();
+  config.output = output;
+
+  CountIndexType index(comm);
+  size_t passes = index.template build_external_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, config);
+  EXPECT_GT(passes, 1UL);
+  EXPECT_EQ(0UL, index.size());
+
+  // the passes have distinct kmers, so their files together are the index.
+  std::vector<std::pair<KmerType, uint32_t> > all;
+  for (size_t p = 0; p < passes; ++p) {
+    std::stringstream ss;
+    ss << output << "." << p;
+    MapType pass(comm);
+    pass.load(ss.str());
+    EXPECT_GT(pass.size(), 0UL);
+    std::vector<std::pair<KmerType, uint32_t> > entries = entries_of(pass);
+    all.insert(all.end(), entries.begin(), entries.end());
+
+    comm.barrier();
+    if (comm.rank() == 0) std::remove(ss.str().c_str());
+  }
+  std::sort(all.begin(), all.end());
+  EXPECT_TRUE(entries_of(gold.get_map()) == all);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
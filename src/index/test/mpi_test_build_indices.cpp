@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_build_indices.cpp
+ * @ingroup
+ * @brief   tests building a count, a position and a position quality index from 1 read of a FASTQ file against building
+ *          each from the file.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using PosQualType = std::pair<::bliss::common::ShortSequenceKmerId, float>;
+
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using PosType = ::bliss::index::kmer::PositionIndex<::dsc::unordered_multimap<KmerType, ::bliss::common::ShortSequenceKmerId, CanonicalParams> >;
+using PosQualIndexType = ::bliss::index::kmer::PositionQualityIndex<::dsc::unordered_multimap<KmerType, PosQualType, CanonicalParams> >;
+
+using FileType = ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser>;
+
+
+/// all entries of the index, on all processes, sorted.
+template <typename Index, typename Less>
+static std::vector<typename Index::TupleType> entries_of(Index const & index, Less const & less, ::mxx::comm const & comm) {
+  std::vector<typename Index::TupleType> local;
+  index.get_map().to_vector(local);
+  auto all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), less);
+  return all;
+}
+
+struct KmerCountLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const { return x < y; }
+};
+struct KmerPosLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const {
+    return (x.second.id < y.second.id) || ((x.second.id == y.second.id) && (x.first < y.first));
+  }
+};
+struct KmerPosQualLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const {
+    return (x.second.first.id < y.second.first.id) || ((x.second.first.id == y.second.first.id) && (x.first < y.first));
+  }
+};
+
+
+class BuildIndicesTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(BuildIndicesTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  CountType gold_count(comm), count(comm);
+  PosType gold_pos(comm), pos(comm);
+  PosQualIndexType gold_qual(comm), qual(comm);
+  gold_count.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  gold_pos.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  gold_qual.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  ::bliss::index::kmer::build_indices<FileType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, comm, count, pos, qual);
+
+  EXPECT_GT(gold_count.size(), 0UL);
+  EXPECT_EQ(gold_count.size(), count.size());
+  EXPECT_EQ(gold_count.local_size(), count.local_size());
+  EXPECT_TRUE(entries_of(gold_count, KmerCountLess(), comm) == entries_of(count, KmerCountLess(), comm));
+
+  EXPECT_EQ(gold_pos.size(), pos.size());
+  auto g = entries_of(gold_pos, KmerPosLess(), comm);
+  auto m = entries_of(pos, KmerPosLess(), comm);
+  ASSERT_EQ(g.size(), m.size());
+  for (size_t i = 0; i < g.size(); ++i) {
+    ASSERT_TRUE(g[i].first == m[i].first);
+    ASSERT_EQ(g[i].second.id, m[i].second.id);
+  }
+
+  EXPECT_EQ(gold_qual.size(), qual.size());
+  auto gq = entries_of(gold_qual, KmerPosQualLess(), comm);
+  auto mq = entries_of(qual, KmerPosQualLess(), comm);
+  ASSERT_EQ(gq.size(), mq.size());
+  for (size_t i = 0; i < gq.size(); ++i) {
+    ASSERT_TRUE(gq[i].first == mq[i].first);
+    ASSERT_EQ(gq[i].second.first.id, mq[i].second.first.id);
+    ASSERT_EQ(gq[i].second.second, mq[i].second.second);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, BuildIndicesTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
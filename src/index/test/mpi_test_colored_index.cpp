@@ -0,0 +1,187 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_colored_index.cpp
+ * @ingroup
+ * @brief   tests the per sample counts and presence of the colored index, against a serial count of the canonical kmers.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include "index/colored_index.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_iterators.hpp"
+#include "iterators/transform_iterator.hpp"
+
+#include <map>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+/// canonical kmer counts of the sequences of a FASTQ file.
+std::map<KmerType, size_t> count_canonical(std::string const & filename) {
+  using Decoder = bliss::common::ASCII2<bliss::common::DNA, char>;
+  using CharIter = bliss::iterator::transform_iterator<std::string::const_iterator, Decoder>;
+  using KmerIter = bliss::common::KmerGenerationIterator<CharIter, KmerType>;
+
+  std::map<KmerType, size_t> counts;
+  std::ifstream ifs(filename);
+  std::string header, seq, plus, qual;
+  while (std::getline(ifs, header) && std::getline(ifs, seq) && std::getline(ifs, plus) && std::getline(ifs, qual)) {
+    if (seq.size() < KmerType::size) continue;
+    KmerIter it(CharIter(seq.cbegin(), Decoder()), true);
+    KmerIter end(CharIter(seq.cend(), Decoder()), false);
+    for (; it != end; ++it) {
+      KmerType k = *it;
+      KmerType rc = k.reverse_complement();
+      ++counts[(rc < k) ? rc : k];
+    }
+  }
+  return counts;
+}
+
+
+TEST(ColoredIndexTest, sample_counts_and_presence)
+{
+  ::mxx::comm comm;
+  std::string natural(PROJ_SRC_DIR);
+  natural.append("/test/data/natural.fastq");
+  std::string medium(PROJ_SRC_DIR);
+  medium.append("/test/data/test.medium.fastq");
+
+  // sample 0:  natural.  sample 1:  medium.  sample 2:  natural twice.
+  std::vector<std::pair<std::string, size_t> > files;
+  files.emplace_back(natural, 0);
+  files.emplace_back(medium, 1);
+  files.emplace_back(natural, 2);
+  files.emplace_back(natural, 2);
+
+  std::vector<std::map<KmerType, size_t> > gold;
+  gold.emplace_back(count_canonical(natural));
+  gold.emplace_back(count_canonical(medium));
+
+  std::vector<KmerType> query;
+  for (size_t s = 0; s < gold.size(); ++s) {
+    for (auto const & g : gold[s]) query.emplace_back(g.first);
+  }
+  // absent kmer
+  KmerType absent;
+  for (size_t i = 0; i < KmerType::size; ++i) absent.nextFromChar(0);
+  if ((gold[0].count(absent) == 0) && (gold[1].count(absent) == 0)) query.emplace_back(absent);
+
+  // each process queries part of the kmers.
+  std::vector<KmerType> local_query;
+  for (size_t i = comm.rank(); i < query.size(); i += comm.size()) local_query.emplace_back(query[i]);
+
+  {
+    using MapType = ::bliss::index::kmer::ColoredCountMap<KmerType, 3>;
+    ::bliss::index::kmer::ColoredIndex<MapType> index(comm);
+    size_t read = index.build_samples_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(files, comm, 4096);
+
+    size_t gold_total = 0;
+    for (auto const & g : gold[0]) gold_total += 3 * g.second;
+    for (auto const & g : gold[1]) gold_total += g.second;
+    EXPECT_EQ(gold_total, ::mxx::allreduce(read, comm));
+
+    std::map<KmerType, size_t> all(gold[0]);
+    all.insert(gold[1].begin(), gold[1].end());
+    EXPECT_EQ(all.size(), index.size());
+
+    std::vector<KmerType> q(local_query);
+    auto found = index.find(q);
+    std::map<KmerType, MapType::mapped_type> results(found.begin(), found.end());
+
+    for (auto const & k : local_query) {
+      KmerType rc = k.reverse_complement();
+      KmerType c = (rc < k) ? rc : k;
+      size_t c0 = gold[0].count(c) ? gold[0].at(c) : 0;
+      size_t c1 = gold[1].count(c) ? gold[1].at(c) : 0;
+      auto it = results.find(c);
+      if ((c0 + c1) == 0) {
+        EXPECT_TRUE(it == results.end());
+        continue;
+      }
+      ASSERT_TRUE(it != results.end());
+      EXPECT_EQ(c0, it->second.count(0));
+      EXPECT_EQ(c1, it->second.count(1));
+      EXPECT_EQ(2 * c0, it->second.count(2));
+      EXPECT_EQ((c0 > 0 ? 2UL : 0UL) + (c1 > 0 ? 1UL : 0UL), it->second.samples());
+    }
+  }
+
+  {
+    using MapType = ::bliss::index::kmer::ColoredPresenceMap<KmerType, 3>;
+    ::bliss::index::kmer::ColoredIndex<MapType> index(comm);
+    index.build_samples_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(files, comm);
+
+    std::vector<KmerType> q(local_query);
+    auto found = index.find(q);
+    std::map<KmerType, MapType::mapped_type> results(found.begin(), found.end());
+
+    for (auto const & k : local_query) {
+      KmerType rc = k.reverse_complement();
+      KmerType c = (rc < k) ? rc : k;
+      auto it = results.find(c);
+      if ((gold[0].count(c) + gold[1].count(c)) == 0) {
+        EXPECT_TRUE(it == results.end());
+        continue;
+      }
+      ASSERT_TRUE(it != results.end());
+      EXPECT_EQ(gold[0].count(c) > 0, it->second.contains(0));
+      EXPECT_EQ(gold[1].count(c) > 0, it->second.contains(1));
+      EXPECT_EQ(gold[0].count(c) > 0, it->second.contains(2));
+    }
+
+    // sample id out of range.
+    std::vector<std::pair<std::string, size_t> > bad(1, std::make_pair(natural, 3UL));
+    EXPECT_THROW((index.build_samples_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(bad, comm)), std::invalid_argument);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
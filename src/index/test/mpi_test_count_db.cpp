@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_count_db.cpp
+ * @ingroup
+ * @brief   tests that count indices exported as Jellyfish and KMC databases are imported with the same counts.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/kmer_count_db.hpp"
+
+
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using Kmer21Type = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint16_t>;
+using Count21Type = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<Kmer21Type, uint32_t, CanonicalParams> >;
+
+
+template <typename IndexType>
+std::vector<std::pair<typename IndexType::KmerType, uint32_t> > all_entries(IndexType & index, ::mxx::comm const & comm) {
+  std::vector<std::pair<typename IndexType::KmerType, uint32_t> > local;
+  index.get_map().to_vector(local);
+  local = ::mxx::allgatherv(local, comm);
+  std::sort(local.begin(), local.end());
+  return local;
+}
+
+class CountDBTest : public ::testing::TestWithParam<std::string> {};
+
+template <typename IndexType>
+void round_trip(std::string const & filename, ::mxx::comm const & comm) {
+  std::string jf("/tmp/bliss_test_count_db.jf");
+  std::string kmc("/tmp/bliss_test_count_db");
+
+  IndexType counts(comm);
+  counts.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  auto gold = all_entries(counts, comm);
+
+  // small chunks, so there are several rounds.
+  for (bool sorted : {false, true}) {
+    ::bliss::index::kmer::export_jellyfish(counts, jf, comm, true, sorted, 1000);
+
+    IndexType loaded(comm);
+    ::bliss::index::kmer::count_db_info info = ::bliss::index::kmer::import_jellyfish(loaded, jf, comm, 777);
+    EXPECT_EQ(gold.size(), info.entries);
+    EXPECT_EQ(static_cast<unsigned int>(IndexType::KmerType::size), info.k);
+    EXPECT_TRUE(info.canonical);
+    EXPECT_TRUE(gold == all_entries(loaded, comm));
+  }
+
+  EXPECT_EQ(gold.size(), ::bliss::index::kmer::export_kmc(counts, kmc, comm, true, 1000));
+  IndexType loaded(comm);
+  ::bliss::index::kmer::count_db_info info = ::bliss::index::kmer::import_kmc(loaded, kmc, comm, 777);
+  EXPECT_EQ(gold.size(), info.entries);
+  EXPECT_TRUE(gold == all_entries(loaded, comm));
+
+  // loading twice adds the counts.
+  ::bliss::index::kmer::import_kmc(loaded, kmc, comm);
+  auto twice = all_entries(loaded, comm);
+  ASSERT_EQ(gold.size(), twice.size());
+  for (size_t i = 0; i < gold.size(); ++i) EXPECT_EQ(2 * gold[i].second, twice[i].second);
+
+  comm.barrier();
+  if (comm.rank() == 0) {
+    std::remove(jf.c_str());
+    std::remove((kmc + ".kmc_pre").c_str());
+    std::remove((kmc + ".kmc_suf").c_str());
+  }
+}
+
+TEST_P(CountDBTest, round_trip)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  round_trip<CountType>(filename, comm);
+  round_trip<Count21Type>(filename, comm);
+}
+
+TEST(CountDBTest, mismatched_k)
+{
+  ::mxx::comm comm;
+  std::string jf("/tmp/bliss_test_count_db_k.jf");
+
+  CountType counts(comm);
+  ::bliss::index::kmer::export_jellyfish(counts, jf, comm, true);
+
+  Count21Type loaded(comm);
+  EXPECT_THROW(::bliss::index::kmer::import_jellyfish(loaded, jf, comm), ::bliss::io::IOException);
+
+  comm.barrier();
+  if (comm.rank() == 0) std::remove(jf.c_str());
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, CountDBTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
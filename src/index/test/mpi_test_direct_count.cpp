@@ -0,0 +1,161 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_direct_count.cpp
+ * @ingroup
+ * @brief   tests the small k counts of DirectCountIndex against the counts of a hashed count index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <type_traits>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<9, ::bliss::common::DNA, uint32_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using DirectIndexType = ::bliss::index::kmer::DirectCountIndex<KmerType, CanonicalParams>;
+
+// selected from the kmer size.
+static_assert(::std::is_same<DirectIndexType,
+              ::bliss::index::kmer::SmallKmerCountIndex<KmerType, CanonicalParams, CountIndexType> >::value,
+              "k = 9 should use the direct count index.");
+using LargeKmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using LargeIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<LargeKmerType, uint32_t, CanonicalParams> >;
+static_assert(::std::is_same<LargeIndexType,
+              ::bliss::index::kmer::SmallKmerCountIndex<LargeKmerType, CanonicalParams, LargeIndexType> >::value,
+              "k = 21 should use the hashed count index.");
+
+
+static std::vector<KmerType> make_kmers(size_t const & n, unsigned int seed) {
+  srand(seed);
+  std::vector<KmerType> kmers;
+  KmerType km;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < ((i % 3 == 0) ? 1 : KmerType::size); ++j) km.nextFromChar(rand() % 4);
+    kmers.emplace_back(km);
+  }
+  return kmers;
+}
+
+/// counts of the hashed index's kmers are the same in the direct index, and there are no other kmers.
+static void check_counts(DirectIndexType & direct, CountIndexType const & exact, ::mxx::comm const & comm) {
+  std::vector<std::pair<KmerType, uint32_t> > gold;
+  exact.get_map().to_vector(gold);
+
+  std::vector<KmerType> query;
+  for (auto const & x : gold) query.emplace_back(x.first);
+  auto counts = direct.count(query);
+  ASSERT_EQ(gold.size(), counts.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_TRUE(counts[i].first == gold[i].first);
+    EXPECT_EQ(static_cast<size_t>(gold[i].second), counts[i].second);
+  }
+
+  EXPECT_EQ(exact.get_map().size(), direct.get_map().unique_size());
+
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  direct.get_map().to_vector(entries);
+  size_t total = 0;
+  for (auto const & x : entries) total += x.second;
+  EXPECT_EQ(direct.size(), ::mxx::allreduce(total, comm));
+}
+
+
+TEST(DirectCountTest, random)
+{
+  ::mxx::comm comm;
+  CountIndexType exact(comm);
+  DirectIndexType direct(comm);
+
+  for (unsigned int b = 0; b < 3; ++b) {
+    // 1 process without input in the last batch.
+    std::vector<KmerType> input = make_kmers((b == 2 && comm.rank() == 0) ? 0 : 20000, 3 + b + comm.rank());
+    std::vector<KmerType> input2(input);
+    exact.insert(input);
+    direct.insert(input2);
+  }
+
+  check_counts(direct, exact, comm);
+
+  // absent kmers count 0, and 1 process without queries.
+  std::vector<KmerType> query = make_kmers(comm.rank() == 0 ? 0 : 100, 99 + comm.rank());
+  auto counts = direct.count(query);
+  EXPECT_EQ(query.size(), counts.size());
+
+  // counts accumulate over combines.
+  std::vector<KmerType> input = make_kmers(1000, 7 + comm.rank());
+  std::vector<KmerType> input2(input);
+  exact.insert(input);
+  direct.insert(input2);
+  direct.finalize();
+  check_counts(direct, exact, comm);
+}
+
+TEST(DirectCountTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.fastq");
+
+  CountIndexType exact(comm);
+  exact.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  DirectIndexType direct(comm);
+  direct.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm, 1UL << 16);
+
+  check_counts(direct, exact, comm);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
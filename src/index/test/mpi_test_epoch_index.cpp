@@ -0,0 +1,183 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_epoch_index.cpp
+ * @ingroup
+ * @brief   tests that an epoch index answers as a map holding the committed batches, before and after the merges finish.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <functional>   // plus
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/epoch_index.hpp"
+
+
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+
+using CountMap = ::dsc::counting_unordered_map<KmerType, uint32_t, SingleParams>;
+using CountEpochs = ::bliss::index::kmer::epoch_index<CountMap, ::bliss::index::kmer::epoch_merge_reduce<std::plus<uint32_t> > >;
+using PosMap = ::dsc::unordered_multimap<KmerType, uint32_t, SingleParams>;
+using PosEpochs = ::bliss::index::kmer::epoch_index<PosMap, ::bliss::index::kmer::epoch_merge_all>;
+
+
+KmerType make_key(size_t const & i) {
+  KmerType km;
+  size_t x = i * 2654435761UL;
+  for (size_t j = 0; j < KmerType::size; ++j, x >>= 2) km.nextFromChar(x & 0x3);
+  return km;
+}
+
+/// batch b of a process:  keys [100 b, 100 b + 300), so consecutive batches overlap.
+std::vector<KmerType> make_batch(size_t const & b) {
+  std::vector<KmerType> batch;
+  for (size_t i = 100 * b; i < 100 * b + 300; ++i) batch.emplace_back(make_key(i));
+  return batch;
+}
+
+std::vector<KmerType> make_query(size_t const & n) {
+  std::vector<KmerType> query;
+  for (size_t i = 0; i < n; i += 3) query.emplace_back(make_key(i));
+  query.emplace_back(make_key(n + 12345));  // absent
+  return query;
+}
+
+template <typename T>
+std::vector<T> sorted(std::vector<T> x) {
+  std::sort(x.begin(), x.end());
+  return x;
+}
+
+TEST(EpochIndexTest, count_map)
+{
+  ::mxx::comm comm;
+  CountEpochs epochs(comm);
+  CountMap gold(comm);      // committed batches
+  CountMap gold_all(comm);  // all batches
+
+  for (size_t b = 0; b < 6; ++b) {
+    std::vector<KmerType> batch = make_batch(b);
+    std::vector<KmerType> copy(batch);
+    epochs.insert(batch);
+    gold_all.insert(copy);
+
+    // the delta is only visible if asked.
+    std::vector<KmerType> q = make_query(1000);
+    std::vector<KmerType> gq(q);
+    EXPECT_EQ(sorted(gold.find(gq)), sorted(epochs.find(q)));
+    q = make_query(1000);
+    gq = q;
+    EXPECT_EQ(sorted(gold_all.find(gq)), sorted(epochs.find(q, true)));
+
+    if (b % 2 == 1) {
+      EXPECT_EQ((b + 1) / 2, epochs.commit());
+      gold.clear();
+      for (size_t c = 0; c <= b; ++c) {
+        batch = make_batch(c);
+        gold.insert(batch);
+      }
+
+      // possibly while the merge runs.
+      q = make_query(1000);
+      gq = q;
+      EXPECT_EQ(sorted(gold.find(gq)), sorted(epochs.find(q)));
+    }
+  }
+
+  epochs.wait();
+  EXPECT_EQ(3UL, epochs.get_merged_epoch());
+
+  std::vector<KmerType> q = make_query(1000);
+  std::vector<KmerType> gq(q);
+  EXPECT_EQ(sorted(gold.find(gq)), sorted(epochs.find(q)));
+  q = make_query(1000);
+  gq = q;
+  auto gold_counts = sorted(gold.count(gq));
+  auto counts = sorted(epochs.count(q));
+  ASSERT_EQ(gold_counts.size(), counts.size());
+  for (size_t i = 0; i < counts.size(); ++i) {
+    EXPECT_EQ(gold_counts[i].first, counts[i].first);
+    EXPECT_EQ(gold_counts[i].second, counts[i].second);
+  }
+}
+
+TEST(EpochIndexTest, multimap)
+{
+  ::mxx::comm comm;
+  PosEpochs epochs(comm);
+  PosMap gold(comm);
+
+  for (size_t b = 0; b < 4; ++b) {
+    std::vector<KmerType> keys = make_batch(b);
+    std::vector<std::pair<KmerType, uint32_t> > batch;
+    for (size_t i = 0; i < keys.size(); ++i) batch.emplace_back(keys[i], static_cast<uint32_t>(b * 1000 + i));
+    std::vector<std::pair<KmerType, uint32_t> > copy(batch);
+    epochs.insert(batch);
+    gold.insert(copy);
+    epochs.commit();
+  }
+
+  std::vector<KmerType> q = make_query(800);
+  std::vector<KmerType> gq(q);
+  EXPECT_EQ(sorted(gold.find(gq)), sorted(epochs.find(q)));
+
+  epochs.wait();
+  q = make_query(800);
+  gq = q;
+  EXPECT_EQ(sorted(gold.find(gq)), sorted(epochs.find(q)));
+  q = make_query(800);
+  gq = q;
+  EXPECT_EQ(sorted(gold.count(gq)), sorted(epochs.count(q)));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
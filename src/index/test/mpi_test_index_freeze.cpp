@@ -0,0 +1,144 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_index_freeze.cpp
+ * @ingroup
+ * @brief   tests Index freeze, unfreeze and is_frozen, with the hashed unordered and densehash count maps.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/kmer_hash.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+using DenseKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using DenseCountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_densehash_map<KmerType, uint32_t, CanonicalParams, DenseKeys> >;
+
+
+/// n random kmers from a pool of pool_size kmers shared by all ranks.
+static std::vector<KmerType> make_kmers(size_t const & n, size_t const & pool_size, unsigned int seed) {
+  srand(23);
+  std::vector<KmerType> pool;
+  KmerType km;
+  for (size_t i = 0; i < pool_size; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    pool.emplace_back(km);
+  }
+  srand(seed);
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < n; ++i) kmers.emplace_back(pool[rand() % pool_size]);
+  return kmers;
+}
+
+/// results of a query, on all processes, sorted.
+template <typename Result>
+static Result all_sorted(Result local, ::mxx::comm const & comm) {
+  Result all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+template <typename Index>
+class IndexFreezeTest : public ::testing::Test {};
+
+typedef ::testing::Types<CountIndexType, DenseCountIndexType> FreezeIndexTypes;
+TYPED_TEST_CASE(IndexFreezeTest, FreezeIndexTypes);
+
+TYPED_TEST(IndexFreezeTest, freeze_unfreeze)
+{
+  ::mxx::comm comm;
+  TypeParam index(comm);
+  std::vector<KmerType> input = make_kmers(3000, 1000, 3 + comm.rank());
+  index.insert(input);
+  EXPECT_FALSE(index.is_frozen());
+
+  // present kmers only:  the frozen layout may report absent kmers with probability 2^-16.
+  std::vector<KmerType> query = make_kmers(800, 1000, 3 + comm.rank());
+  std::vector<KmerType> q(query);
+  auto gold_count = all_sorted(index.count(q), comm);
+  q = query;
+  auto gold_find = all_sorted(index.find(q), comm);
+  size_t gold_size = index.size();
+
+  // frozen, keeping the map.
+  index.freeze(false);
+  EXPECT_TRUE(index.is_frozen());
+  EXPECT_EQ(gold_size, index.size());
+  q = query;
+  EXPECT_EQ(gold_find, all_sorted(index.find(q), comm));
+  EXPECT_EQ(gold_size, index.get_map().size());
+
+  // unfreeze answers from the map again.
+  index.unfreeze();
+  EXPECT_FALSE(index.is_frozen());
+  q = query;
+  EXPECT_EQ(gold_count, all_sorted(index.count(q), comm));
+
+  // frozen with release:  the map is cleared, and the frozen layout answers.
+  index.freeze();
+  EXPECT_TRUE(index.is_frozen());
+  EXPECT_EQ(0UL, index.get_map().size());
+  EXPECT_EQ(gold_size, index.size());
+  q = query;
+  EXPECT_EQ(gold_find, all_sorted(index.find(q), comm));
+
+  index.unfreeze();
+  EXPECT_FALSE(index.is_frozen());
+  EXPECT_EQ(0UL, index.size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_index_group.cpp
+ * @ingroup
+ * @brief   tests that a group of co-partitioned indices answers find and count as its members.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/index_group.hpp"
+
+
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, SingleParams> >;
+using PosType = ::bliss::index::kmer::PositionIndex<::dsc::unordered_multimap<KmerType, ::bliss::common::ShortSequenceKmerId, SingleParams> >;
+
+
+struct PosLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const {
+    return (x.first < y.first) || ((x.first == y.first) && (x.second.id < y.second.id));
+  }
+};
+struct PosEqual {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const {
+    return (x.first == y.first) && (x.second.id == y.second.id);
+  }
+};
+
+
+class IndexGroupTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(IndexGroupTest, find_count)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  CountType counts(comm);
+  PosType positions(comm);
+  counts.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  positions.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  auto group = ::bliss::index::kmer::make_index_group(comm, counts, positions);
+  EXPECT_EQ(2UL, group.size());
+
+  // every 5th kmer of all processes, spread over the processes, some of them repeated.
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  counts.get_map().to_vector(local);
+  std::vector<KmerType> sample;
+  for (size_t i = 0; i < local.size(); i += 5) sample.emplace_back(local[i].first);
+  sample = ::mxx::allgatherv(sample, comm);
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < sample.size(); i += 2) query.emplace_back(sample[i]);
+  if (!query.empty()) query.emplace_back(query.front());
+  KmerType absent;
+  query.emplace_back(absent);
+
+  // counts, for all unique queries.
+  std::vector<KmerType> q(query);
+  auto grouped_counts = group.count(q);
+
+  q = query;
+  auto gold_counts = counts.count(q);
+  q = query;
+  auto gold_pos_counts = positions.count(q);
+
+  auto c0 = std::get<0>(grouped_counts);
+  auto c1 = std::get<1>(grouped_counts);
+  std::sort(c0.begin(), c0.end());
+  std::sort(c1.begin(), c1.end());
+  ASSERT_EQ(gold_counts.size(), c0.size());
+  ASSERT_EQ(gold_pos_counts.size(), c1.size());
+  std::sort(gold_counts.begin(), gold_counts.end());
+  std::sort(gold_pos_counts.begin(), gold_pos_counts.end());
+  for (size_t i = 0; i < c0.size(); ++i) {
+    EXPECT_EQ(gold_counts[i].first, c0[i].first);
+    EXPECT_EQ(gold_counts[i].second, c0[i].second);
+  }
+  for (size_t i = 0; i < c1.size(); ++i) {
+    EXPECT_EQ(gold_pos_counts[i].first, c1[i].first);
+    EXPECT_EQ(gold_pos_counts[i].second, c1[i].second);
+  }
+
+  // entries.
+  q = query;
+  auto grouped = group.find(q);
+
+  q = query;
+  auto gold_found = counts.find(q);
+  q = query;
+  auto gold_pos = positions.find(q);
+
+  auto f0 = std::get<0>(grouped);
+  std::sort(f0.begin(), f0.end());
+  std::sort(gold_found.begin(), gold_found.end());
+  EXPECT_TRUE(gold_found == f0);
+
+  auto f1 = std::get<1>(grouped);
+  std::sort(f1.begin(), f1.end(), PosLess());
+  std::sort(gold_pos.begin(), gold_pos.end(), PosLess());
+  ASSERT_EQ(gold_pos.size(), f1.size());
+  EXPECT_TRUE(std::equal(gold_pos.begin(), gold_pos.end(), f1.begin(), PosEqual()));
+}
+
+TEST_P(IndexGroupTest, different_tables)
+{
+  ::mxx::comm comm;
+  if (comm.size() == 1) return;
+
+  CountType counts(comm);
+  PosType positions(comm);
+  // buckets assigned round robin instead of in contiguous ranges.
+  std::vector<uint32_t> ranks(::dsc::bucket_table::nbuckets);
+  for (size_t b = 0; b < ranks.size(); ++b) ranks[b] = static_cast<uint32_t>(b % comm.size());
+  positions.get_map().set_bucket_table(::dsc::bucket_table(ranks, comm.size()));
+
+  EXPECT_THROW(::bliss::index::kmer::make_index_group(comm, counts, positions), std::invalid_argument);
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, IndexGroupTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_index_merge.cpp
+ * @ingroup
+ * @brief   tests that merging count indices gives the counts of 1 index built from all the input.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <map>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using SingleCountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, SingleParams> >;
+
+
+template <typename IndexType>
+std::vector<std::pair<KmerType, uint32_t> > all_entries(IndexType & index, ::mxx::comm const & comm) {
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  index.get_map().to_vector(local);
+  local = ::mxx::allgatherv(local, comm);
+  std::sort(local.begin(), local.end());
+  return local;
+}
+
+/// sum of the counts of both, by kmer.
+std::vector<std::pair<KmerType, uint32_t> > add(std::vector<std::pair<KmerType, uint32_t> > const & x,
+                                                std::vector<std::pair<KmerType, uint32_t> > const & y) {
+  std::map<KmerType, uint32_t> sums;
+  for (auto const & e : x) sums[e.first] += e.second;
+  for (auto const & e : y) sums[e.first] += e.second;
+  return std::vector<std::pair<KmerType, uint32_t> >(sums.begin(), sums.end());
+}
+
+TEST(IndexMergeTest, merge)
+{
+  ::mxx::comm comm;
+  std::string file1(PROJ_SRC_DIR);
+  file1.append("/test/data/test.fastq");
+  std::string file2(PROJ_SRC_DIR);
+  file2.append("/test/data/natural.fastq");
+
+  CountType first(comm);
+  first.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(file1, comm);
+  CountType second(comm);
+  second.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(file2, comm);
+  auto gold = add(all_entries(first, comm), all_entries(second, comm));
+
+  // co-partitioned:  local.  small chunks, so there are several rounds.
+  {
+    CountType merged(comm);
+    merged.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(file1, comm);
+    ASSERT_TRUE(merged.get_map().is_co_partitioned(second.get_map()));
+    merged.merge(second, 1000);
+    EXPECT_TRUE(gold == all_entries(merged, comm));
+  }
+
+  // different input transform:  streamed through insert, which makes the single strand kmers canonical.
+  {
+    SingleCountType single(comm);
+    single.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(file2, comm);
+
+    CountType merged(comm);
+    merged.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(file1, comm);
+    merged.merge(single, 1000);
+    EXPECT_TRUE(gold == all_entries(merged, comm));
+  }
+
+  // merging into itself doubles the counts.
+  {
+    auto before = all_entries(first, comm);
+    first.merge(first);
+    auto after = all_entries(first, comm);
+    ASSERT_EQ(before.size(), after.size());
+    for (size_t i = 0; i < before.size(); ++i) EXPECT_EQ(2 * before[i].second, after[i].second);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
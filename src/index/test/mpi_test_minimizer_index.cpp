@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_minimizer_index.cpp
+ * @ingroup
+ * @brief   tests that the minimizer sampled position index stores the minimizers of each read, and that sampled queries find them.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/sequence.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "index/kmer_index.hpp"
+
+
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using PosType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+using ParserType = ::bliss::index::kmer::KmerPositionTupleParser<PosType>;
+using SampledType = ::bliss::index::kmer::MinimizerPositionIndex<
+    ::dsc::unordered_multimap<KmerType, ::bliss::common::ShortSequenceKmerId, SingleParams>, 10>;
+
+
+class MinimizerIndexTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(MinimizerIndexTest, sampled)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  // all kmers, read by read.
+  std::vector<PosType> all;
+  ::bliss::io::KmerFileHelper::template read_file_posix<ParserType,
+    ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, all, comm);
+
+  // sample each read on the query side.
+  std::vector<PosType> gold;
+  std::vector<KmerType> query;
+  std::vector<KmerType> read_kmers;
+  for (size_t b = 0; b < all.size(); ) {
+    size_t e = b;
+    while ((e < all.size()) && (all[e].second.get_id() == all[b].second.get_id())) ++e;
+
+    read_kmers.clear();
+    for (size_t i = b; i < e; ++i) read_kmers.emplace_back(all[i].first);
+    std::vector<size_t> offsets = SampledType::sample(read_kmers);
+    ASSERT_EQ(offsets.size(), read_kmers.size());
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      EXPECT_EQ(all[b + offsets[i]].first, read_kmers[i]);
+      gold.emplace_back(all[b + offsets[i]]);
+    }
+    query.insert(query.end(), read_kmers.begin(), read_kmers.end());
+    b = e;
+  }
+
+  SampledType index(comm);
+  index.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  // the index has exactly the minimizers of each read.
+  std::vector<PosType> local;
+  index.get_map().to_vector(local);
+  local = ::mxx::allgatherv(local, comm);
+  gold = ::mxx::allgatherv(gold, comm);
+  std::sort(local.begin(), local.end());
+  std::sort(gold.begin(), gold.end());
+  ASSERT_EQ(gold.size(), local.size());
+  EXPECT_TRUE(gold == local);
+
+  // much smaller than all positions.
+  size_t total = ::mxx::allreduce(all.size(), comm);
+  EXPECT_LT(local.size() * 2, total);
+
+  // every sampled query kmer is found.
+  auto counts = index.count(query);
+  for (auto const & c : counts) {
+    EXPECT_GT(c.second, 0UL);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, MinimizerIndexTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_multi_k_index.cpp
+ * @ingroup
+ * @brief   tests building indices of several k from 1 packed read of a FASTQ file against building each from the file.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+
+
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using Kmer21 = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using Kmer31 = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using Kmer15 = ::bliss::common::Kmer<15, ::bliss::common::DNA, uint32_t>;
+
+using Count21 = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<Kmer21, uint32_t, CanonicalParams> >;
+using Count31 = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<Kmer31, uint32_t, SingleParams> >;
+using Pos15 = ::bliss::index::kmer::PositionIndex<::dsc::unordered_multimap<Kmer15, ::bliss::common::ShortSequenceKmerId, SingleParams> >;
+
+using FileType = ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser>;
+
+
+/// all entries of the index, on all processes, sorted.
+template <typename Index, typename Less>
+static std::vector<typename Index::TupleType> entries_of(Index const & index, Less const & less, ::mxx::comm const & comm) {
+  std::vector<typename Index::TupleType> local;
+  index.get_map().to_vector(local);
+  auto all = ::mxx::allgatherv(local, comm);
+  std::sort(all.begin(), all.end(), less);
+  return all;
+}
+
+struct KmerCountLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const { return x < y; }
+};
+struct KmerPosLess {
+  template <typename T>
+  bool operator()(T const & x, T const & y) const {
+    return (x.second.id < y.second.id) || ((x.second.id == y.second.id) && (x.first < y.first));
+  }
+};
+
+
+class MultiKIndexTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(MultiKIndexTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  Count21 gold21(comm), multi21(comm);
+  Count31 gold31(comm), multi31(comm);
+  Pos15 gold15(comm), multi15(comm);
+  gold21.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  gold31.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  gold15.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  ::bliss::index::kmer::build_multi_k<FileType>(filename, comm, multi21, multi31, multi15);
+
+  EXPECT_GT(gold21.size(), 0UL);
+  EXPECT_EQ(gold21.size(), multi21.size());
+  EXPECT_EQ(gold21.local_size(), multi21.local_size());
+  EXPECT_TRUE(entries_of(gold21, KmerCountLess(), comm) == entries_of(multi21, KmerCountLess(), comm));
+
+  EXPECT_EQ(gold31.size(), multi31.size());
+  EXPECT_EQ(gold31.local_size(), multi31.local_size());
+  EXPECT_TRUE(entries_of(gold31, KmerCountLess(), comm) == entries_of(multi31, KmerCountLess(), comm));
+
+  EXPECT_EQ(gold15.size(), multi15.size());
+  auto g = entries_of(gold15, KmerPosLess(), comm);
+  auto m = entries_of(multi15, KmerPosLess(), comm);
+  ASSERT_EQ(g.size(), m.size());
+  for (size_t i = 0; i < g.size(); ++i) {
+    ASSERT_TRUE(g[i].first == m[i].first);
+    ASSERT_EQ(g[i].second.id, m[i].second.id);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, MultiKIndexTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
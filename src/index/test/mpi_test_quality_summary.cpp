@@ -0,0 +1,130 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_quality_summary.cpp
+ * @ingroup
+ * @brief   tests the per kmer quality summaries against the occurrences of a position-quality index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/quality_summary_index.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using PosQualType = std::pair<::bliss::common::ShortSequenceKmerId, float>;
+using PositionQualityIndexType = ::bliss::index::kmer::PositionQualityIndex<
+    ::dsc::unordered_multimap<KmerType, PosQualType, CanonicalParams> >;
+
+using SummaryType = ::bliss::index::kmer::quality_summary<float, 10>;
+using SummaryIndexType = ::bliss::index::kmer::QualitySummaryIndex<
+    ::bliss::index::kmer::QualitySummaryMap<KmerType, float, 10, CanonicalParams> >;
+
+
+TEST(QualitySummaryTest, merge)
+{
+  SummaryType a = SummaryType::single(-0.01f);
+  SummaryType b = SummaryType::single(-2.0f);
+  SummaryType c = a + b + SummaryType();
+
+  EXPECT_EQ(2U, c.count);
+  EXPECT_FLOAT_EQ(-2.01f, c.sum);
+  EXPECT_FLOAT_EQ(-2.0f, c.min);
+  EXPECT_FLOAT_EQ(-1.005f, c.mean());
+  // probabilities 0.993 and 0.25
+  EXPECT_EQ(2UL, c.count_above(2));
+  EXPECT_EQ(1UL, c.count_above(3));
+  EXPECT_EQ(1UL, c.count_above(9));
+  EXPECT_TRUE((a + b) == (b + a));
+}
+
+TEST(QualitySummaryTest, build)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.fastq");
+
+  PositionQualityIndexType gold_index(comm);
+  gold_index.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  SummaryIndexType index(comm);
+  index.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  EXPECT_GT(index.get_map().get_combiner(), 0UL);
+
+  // aggregate the occurrences.  all occurrences of a kmer are on its owner.
+  std::vector<std::pair<KmerType, PosQualType> > occurrences;
+  gold_index.get_map().to_vector(occurrences);
+  std::map<KmerType, SummaryType> gold;
+  for (auto const & x : occurrences) gold[x.first] = gold[x.first] + SummaryType::single(x.second.second);
+
+  // 1 entry per kmer.
+  EXPECT_EQ(gold_index.get_map().unique_size(), index.size());
+
+  std::vector<KmerType> query;
+  for (auto const & x : gold) query.emplace_back(x.first);
+  auto found = index.find(query);
+  ASSERT_EQ(gold.size(), found.size());
+  for (auto const & x : found) {
+    SummaryType const & g = gold[x.first];
+    EXPECT_EQ(g.count, x.second.count);
+    EXPECT_FLOAT_EQ(g.min, x.second.min);
+    // summation order differs.
+    EXPECT_NEAR(g.sum, x.second.sum, 1.0e-4 * std::fabs(g.sum) + 1.0e-5);
+    EXPECT_EQ(g.count_above(0), x.second.count_above(0));
+    EXPECT_EQ(g.count_above(9), x.second.count_above(9));
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
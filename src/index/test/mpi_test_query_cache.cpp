@@ -0,0 +1,203 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_query_cache.cpp
+ * @ingroup
+ * @brief   tests the CLOCK eviction of the query cache, and cached Index find and count against the uncached ones.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/query_cache.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+using MultiIndexType = ::bliss::index::kmer::Index<::dsc::unordered_multimap<KmerType, uint32_t, SingleParams>,
+    ::bliss::index::kmer::KmerParser<KmerType> >;
+
+
+/// n random kmers from a pool of pool_size kmers shared by all ranks.
+static std::vector<KmerType> make_kmers(size_t const & n, size_t const & pool_size, unsigned int seed) {
+  srand(17);
+  std::vector<KmerType> pool;
+  KmerType km;
+  for (size_t i = 0; i < pool_size; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    pool.emplace_back(km);
+  }
+  srand(seed);
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < n; ++i) kmers.emplace_back(pool[rand() % pool_size]);
+  return kmers;
+}
+
+/// cached and uncached results of the same queries, sorted.
+template <typename Result>
+static void expect_same(Result cached, Result uncached) {
+  std::sort(cached.begin(), cached.end());
+  std::sort(uncached.begin(), uncached.end());
+  EXPECT_EQ(uncached.size(), cached.size());
+  EXPECT_TRUE(uncached == cached);
+}
+
+
+TEST(QueryCacheTest, clock_eviction)
+{
+  ::bliss::index::clock_cache<int, int, std::hash<int> > cache(3);
+  EXPECT_TRUE(cache.enabled());
+  for (int i = 0; i < 3; ++i) cache.insert(i, 10 * i);
+  EXPECT_EQ(3UL, cache.size());
+
+  // 0 and 2 are referenced, so 1 is evicted, then 0 after its second chance.
+  ASSERT_TRUE(cache.find(0) != nullptr);
+  ASSERT_TRUE(cache.find(2) != nullptr);
+  cache.insert(3, 30);
+  EXPECT_EQ(3UL, cache.size());
+  EXPECT_TRUE(cache.find(1) == nullptr);
+  cache.insert(4, 40);
+  EXPECT_TRUE(cache.find(0) == nullptr);
+  ASSERT_TRUE(cache.find(2) != nullptr);
+  EXPECT_EQ(20, *(cache.find(2)));
+  EXPECT_EQ(30, *(cache.find(3)));
+  EXPECT_EQ(40, *(cache.find(4)));
+  EXPECT_EQ(6UL, cache.hits());
+  EXPECT_EQ(2UL, cache.misses());
+
+  // new epoch clears.
+  cache.validate(0);
+  EXPECT_EQ(3UL, cache.size());
+  cache.validate(1);
+  EXPECT_EQ(0UL, cache.size());
+
+  ::bliss::index::clock_cache<int, int, std::hash<int> > disabled;
+  disabled.insert(1, 1);
+  EXPECT_FALSE(disabled.enabled());
+  EXPECT_EQ(0UL, disabled.size());
+}
+
+TEST(QueryCacheTest, count)
+{
+  ::mxx::comm comm;
+  CountIndexType index(comm);
+  std::vector<KmerType> input = make_kmers(2000, 1000, 3 + comm.rank());
+  index.insert(input);
+
+  CountIndexType cached(comm);
+  input = make_kmers(2000, 1000, 3 + comm.rank());
+  cached.insert(input);
+  cached.enable_query_cache(comm.rank() % 2 == 0 ? 500 : 100000);   // capacities may differ between processes.
+
+  // repeated batches, including kmers absent from the index.
+  for (unsigned int b = 0; b < 3; ++b) {
+    std::vector<KmerType> query = make_kmers(600, 1500, 100 + b + comm.rank());
+    std::vector<KmerType> q2(query);
+    expect_same(cached.count(query), index.count(q2));
+  }
+  EXPECT_GT(cached.get_count_cache().hits(), 0UL);
+  EXPECT_LE(cached.get_count_cache().size(), cached.get_count_cache().capacity());
+
+  // insert invalidates, so the new counts are seen.
+  input = make_kmers(500, 1500, 7 + comm.rank());
+  std::vector<KmerType> input2(input);
+  index.insert(input);
+  cached.insert(input2);
+
+  std::vector<KmerType> query = make_kmers(600, 1500, 100 + comm.rank());
+  std::vector<KmerType> q2(query);
+  expect_same(cached.count(query), index.count(q2));
+
+  // 1 process without queries.
+  query = make_kmers(comm.rank() == 0 ? 0 : 300, 1500, 200 + comm.rank());
+  q2 = query;
+  expect_same(cached.count(query), index.count(q2));
+}
+
+TEST(QueryCacheTest, find_multimap)
+{
+  ::mxx::comm comm;
+  MultiIndexType index(comm);
+  MultiIndexType cached(comm);
+  cached.enable_query_cache(300);
+
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  std::vector<KmerType> kmers = make_kmers(2000, 800, 5 + comm.rank());
+  for (size_t i = 0; i < kmers.size(); ++i) input.emplace_back(kmers[i], i + 10000 * comm.rank());
+  std::vector<std::pair<KmerType, uint32_t> > input2(input);
+  index.insert(input);
+  cached.insert(input2);
+
+  for (unsigned int b = 0; b < 3; ++b) {
+    std::vector<KmerType> query = make_kmers(400, 1000, 50 + b + comm.rank());
+    std::vector<KmerType> q2(query);
+    expect_same(cached.find(query), index.find(q2));
+  }
+  EXPECT_GT(cached.get_find_cache().hits(), 0UL);
+
+  // erase invalidates, so the erased kmers are not found.
+  std::vector<KmerType> erased = make_kmers(100, 800, 9 + comm.rank());
+  std::vector<KmerType> erased2(erased);
+  index.erase(erased);
+  cached.erase(erased2);
+
+  std::vector<KmerType> query = make_kmers(400, 1000, 50 + comm.rank());
+  std::vector<KmerType> q2(query);
+  expect_same(cached.find(query), index.find(q2));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
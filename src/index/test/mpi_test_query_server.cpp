@@ -0,0 +1,161 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_query_server.cpp
+ * @ingroup
+ * @brief   tests batching of client thread queries, against a replicated gold index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include "index/query_server.hpp"
+
+#include <map>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+/// stands in for an Index:  collective find and count over a multimap replicated on all processes.
+class GoldIndex {
+  public:
+    using KmerType = uint64_t;
+
+    struct Map {
+        void transform_input(std::vector<uint64_t> &) const {}
+    } map;
+
+    std::multimap<uint64_t, uint32_t> gold;
+    mxx::comm const & comm;
+    mutable size_t calls;
+
+    GoldIndex(mxx::comm const & _comm) : comm(_comm), calls(0) {
+      for (uint32_t i = 0; i < 1000; ++i) gold.emplace(i % 300, i);
+    }
+
+    Map const & get_map() const { return map; }
+
+    std::vector<std::pair<uint64_t, uint32_t> > find(std::vector<uint64_t> & keys) const {
+      ::mxx::allreduce(keys.size(), comm);   // collective, as in the distributed maps.
+      ++calls;
+      std::vector<std::pair<uint64_t, uint32_t> > results;
+      for (auto k : keys) {
+        auto r = gold.equal_range(k);
+        results.insert(results.end(), r.first, r.second);
+      }
+      return results;
+    }
+
+    std::vector<std::pair<uint64_t, size_t> > count(std::vector<uint64_t> & keys) const {
+      ::mxx::allreduce(keys.size(), comm);
+      ++calls;
+      std::vector<std::pair<uint64_t, size_t> > results;
+      for (auto k : keys) {
+        size_t c = gold.count(k);
+        if (c > 0) results.emplace_back(k, c);
+      }
+      return results;
+    }
+};
+
+
+TEST(QueryServerTest, batched_clients)
+{
+  ::mxx::comm comm;
+  GoldIndex index(comm);
+  ::bliss::index::kmer::query_server<GoldIndex> server(index, comm, 256, std::chrono::microseconds(500));
+
+  // client threads, some on rank 0 only.  keys include absent ones.
+  int const n_clients = (comm.rank() == 0) ? 4 : 1;
+  int const n_requests = 50;
+  std::vector<int> errors(n_clients, 0);
+  std::vector<std::thread> clients;
+  for (int c = 0; c < n_clients; ++c) {
+    clients.emplace_back([&server, &index, &errors, c, &comm]() {
+      std::default_random_engine generator(comm.rank() * 100 + c);
+      std::uniform_int_distribution<uint64_t> distribution(0, 399);
+      for (int i = 0; i < n_requests; ++i) {
+        std::vector<uint64_t> keys(10);
+        for (auto & k : keys) k = distribution(generator);
+
+        auto fc = server.count(keys);
+        auto ff = server.find(keys);
+
+        auto counted = fc.get();
+        if (counted.size() != keys.size()) ++errors[c];
+        for (size_t j = 0; j < keys.size() && j < counted.size(); ++j) {
+          if ((counted[j].first != keys[j]) || (counted[j].second != index.gold.count(keys[j]))) ++errors[c];
+        }
+
+        auto found = ff.get();
+        std::vector<std::pair<uint64_t, uint32_t> > gold;
+        for (auto k : keys) {
+          auto r = index.gold.equal_range(k);
+          gold.insert(gold.end(), r.first, r.second);
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(gold.begin(), gold.end());
+        if (found != gold) ++errors[c];
+      }
+    });
+  }
+  std::thread stopper([&clients, &server]() {
+    for (auto & t : clients) t.join();
+    server.stop();
+  });
+
+  server.run();
+  stopper.join();
+
+  for (int c = 0; c < n_clients; ++c) {
+    EXPECT_EQ(0, errors[c]);
+  }
+  // each round serves several requests, from all processes.
+  size_t total = ::mxx::allreduce(static_cast<size_t>(2 * n_clients * n_requests), comm);
+  EXPECT_GT(total, index.calls);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_query_trace.cpp
+ * @ingroup
+ * @brief   tests recording Index query batches in a trace, reading them back, and replaying them.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>  // getpid
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/query_trace.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+
+using CountIndexType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+
+
+/// n random kmers from a pool of pool_size kmers shared by all ranks.
+static std::vector<KmerType> make_kmers(size_t const & n, size_t const & pool_size, unsigned int seed) {
+  srand(17);
+  std::vector<KmerType> pool;
+  KmerType km;
+  for (size_t i = 0; i < pool_size; ++i) {
+    for (size_t j = 0; j < KmerType::size; ++j) km.nextFromChar(rand() % 4);
+    pool.emplace_back(km);
+  }
+  srand(seed);
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < n; ++i) kmers.emplace_back(pool[rand() % pool_size]);
+  return kmers;
+}
+
+static std::string trace_prefix(::mxx::comm const & comm) {
+  return "./query_trace." + std::to_string(::mxx::bcast(static_cast<int>(getpid()), 0, comm));
+}
+
+
+TEST(QueryTraceTest, record_replay)
+{
+  ::mxx::comm comm;
+  std::string prefix = trace_prefix(comm);
+
+  CountIndexType index(comm);
+  std::vector<KmerType> input = make_kmers(3000, 1000, 3 + comm.rank());
+  index.insert(input);
+
+  // 1 process without queries in the second batch.
+  std::vector<std::vector<KmerType> > queries;
+  queries.emplace_back(make_kmers(500, 1500, 100 + comm.rank()));
+  queries.emplace_back(make_kmers(comm.rank() == 0 ? 0 : 300, 1500, 200 + comm.rank()));
+  queries.emplace_back(make_kmers(400, 1500, 300 + comm.rank()));
+
+  index.enable_query_trace(prefix);
+  decltype(index.count(queries[0])) counts;
+  {
+    std::vector<KmerType> q(queries[0]);
+    counts = index.count(q);
+  }
+  {
+    std::vector<KmerType> q(queries[1]);
+    index.find(q);
+  }
+  {
+    std::vector<KmerType> q(queries[2]);
+    index.count(q);
+  }
+  ASSERT_TRUE(index.get_query_trace() != nullptr);
+  EXPECT_EQ(3UL, index.get_query_trace()->batches());
+  index.disable_query_trace();
+
+  // the batches of this process, as queried.
+  {
+    ::bliss::index::query_trace_reader<KmerType> reader(::bliss::index::query_trace_filename(prefix, comm.rank()));
+    EXPECT_EQ(static_cast<uint32_t>(comm.size()), reader.get_header().comm_size);
+    EXPECT_EQ(static_cast<uint32_t>(comm.rank()), reader.get_header().rank);
+
+    auto batches = reader.read_all();
+    ASSERT_EQ(3UL, batches.size());
+    EXPECT_EQ(::bliss::index::query_op::COUNT, batches[0].op);
+    EXPECT_EQ(::bliss::index::query_op::FIND, batches[1].op);
+    EXPECT_EQ(::bliss::index::query_op::COUNT, batches[2].op);
+    for (size_t i = 0; i < batches.size(); ++i) {
+      EXPECT_EQ(queries[i].size(), batches[i].batch_size);
+      EXPECT_TRUE(queries[i] == batches[i].kmers);
+      if (i > 0) EXPECT_LE(batches[i - 1].time, batches[i].time);
+    }
+
+    // replay gives the same results.
+    auto replayed = index.count(batches[0].kmers);
+    std::sort(counts.begin(), counts.end());
+    std::sort(replayed.begin(), replayed.end());
+    EXPECT_TRUE(counts == replayed);
+  }
+
+  // the wrong kmer type is rejected.
+  EXPECT_THROW(::bliss::index::query_trace_reader<::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t> >
+    (::bliss::index::query_trace_filename(prefix, comm.rank())), ::bliss::io::IOException);
+
+  remove(::bliss::index::query_trace_filename(prefix, comm.rank()).c_str());
+}
+
+TEST(QueryTraceTest, sampled)
+{
+  ::mxx::comm comm;
+  std::string prefix = trace_prefix(comm) + ".sampled";
+
+  CountIndexType index(comm);
+  index.enable_query_trace(prefix, 0.25);
+  std::vector<KmerType> query = make_kmers(4000, 1000, 100 + comm.rank());
+  std::vector<KmerType> q(query);
+  index.count(q);
+  index.disable_query_trace();
+
+  ::bliss::index::query_trace_reader<KmerType> reader(::bliss::index::query_trace_filename(prefix, comm.rank()));
+  EXPECT_DOUBLE_EQ(0.25, reader.get_header().sample_rate);
+  ::bliss::index::query_trace_batch<KmerType> batch;
+  ASSERT_TRUE(reader.next(batch));
+  EXPECT_EQ(query.size(), batch.batch_size);
+  EXPECT_GT(batch.kmers.size(), query.size() / 10);
+  EXPECT_LT(batch.kmers.size(), query.size() / 2);
+  EXPECT_FALSE(reader.next(batch));
+
+  // all occurrences of a sampled kmer are recorded.
+  std::vector<KmerType> sampled(batch.kmers);
+  std::sort(sampled.begin(), sampled.end());
+  sampled.erase(std::unique(sampled.begin(), sampled.end()), sampled.end());
+  size_t occurrences = 0;
+  for (auto const & km : query) {
+    if (std::binary_search(sampled.begin(), sampled.end(), km)) ++occurrences;
+  }
+  EXPECT_EQ(batch.kmers.size(), occurrences);
+
+  remove(::bliss::index::query_trace_filename(prefix, comm.rank()).c_str());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_read_correction.cpp
+ * @ingroup
+ * @brief   tests that spectrum correction of synthetic reads with substitutions moves them closer to the error free reads.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/synthetic_reads.hpp"
+#include "index/kmer_index.hpp"
+#include "index/read_correction.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+
+template <typename K>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<K>;
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, CanonicalParams> >;
+
+
+static std::string read_all(std::string const & filename) {
+  std::ifstream ifs(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+/// differences in the sequence lines, i.e. line 2 of each 4 line record.  the files have the same layout.
+static size_t mismatches(std::string const & x, std::string const & y) {
+  size_t n = 0, line = 0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (x[i] == '\n') ++line;
+    else if ((line % 4) == 1) n += (x[i] != y[i]) ? 1 : 0;
+  }
+  return n;
+}
+
+TEST(ReadCorrectionTest, synthetic)
+{
+  ::mxx::comm comm;
+
+  std::string truth_file("/tmp/bliss_test_correction.truth.fastq");
+  std::string reads_file("/tmp/bliss_test_correction.reads.fastq");
+  std::string out_file("/tmp/bliss_test_correction.out.fastq");
+
+  // same reads, with and without substitutions.
+  size_t total_reads = 4000;
+  ::bliss::io::synthetic_read_params params;
+  params.read_len = 100;
+  params.coverage = 40.0;
+  ::bliss::io::synthetic_reads(total_reads, params).write_fastq(truth_file, total_reads, comm);
+  params.sub_start = 0.002;
+  params.sub_end = 0.01;
+  ::bliss::io::synthetic_reads(total_reads, params).write_fastq(reads_file, total_reads, comm);
+
+  // pass 1:  count.  pass 2:  correct.
+  CountType counts(comm);
+  counts.template build_streaming_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(reads_file, comm);
+
+  ::bliss::index::kmer::read_correction_engine<CountType> engine(counts, comm, 3, 4);
+  // small batches, so there are several rounds.
+  ::bliss::index::kmer::correction_stats stats = engine.correct(reads_file, out_file, 1UL << 14);
+
+  EXPECT_EQ(total_reads, ::mxx::allreduce(stats.reads, comm));
+  EXPECT_GT(::mxx::allreduce(stats.corrections, comm), 0UL);
+  EXPECT_LE(stats.corrected_reads, stats.reads);
+
+  if (comm.rank() == 0) {
+    std::string truth = read_all(truth_file);
+    std::string reads = read_all(reads_file);
+    std::string out = read_all(out_file);
+
+    // same layout, and only sequence characters change.
+    ASSERT_EQ(truth.size(), reads.size());
+    ASSERT_EQ(reads.size(), out.size());
+    EXPECT_EQ(mismatches(reads, out), [&reads, &out]() {
+      size_t n = 0;
+      for (size_t i = 0; i < reads.size(); ++i) n += (reads[i] != out[i]) ? 1 : 0;
+      return n;
+    }());
+
+    size_t before = mismatches(truth, reads);
+    size_t after = mismatches(truth, out);
+    EXPECT_GT(before, 0UL);
+    EXPECT_LT(after * 2, before) << "before " << before << " after " << after;
+  }
+  comm.barrier();
+
+  if (comm.rank() == 0) {
+    std::remove(truth_file.c_str());
+    std::remove(reads_file.c_str());
+    std::remove(out_file.c_str());
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
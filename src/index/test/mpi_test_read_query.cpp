@@ -0,0 +1,214 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_read_query.cpp
+ * @ingroup
+ * @brief   tests per read aggregation of streamed FASTQ queries, against a replicated gold index and a serial parse.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include "index/read_query.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_iterators.hpp"
+#include "iterators/transform_iterator.hpp"
+
+#include <map>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+/// kmers of a sequence string.
+std::vector<KmerType> kmers_of(std::string const & seq) {
+  using Decoder = bliss::common::ASCII2<bliss::common::DNA, char>;
+  using CharIter = bliss::iterator::transform_iterator<std::string::const_iterator, Decoder>;
+  using KmerIter = bliss::common::KmerGenerationIterator<CharIter, KmerType>;
+
+  if (seq.size() < KmerType::size) return std::vector<KmerType>();
+  return std::vector<KmerType>(KmerIter(CharIter(seq.cbegin(), Decoder()), true), KmerIter(CharIter(seq.cend(), Decoder()), false));
+}
+
+/// FASTQ records of a file:  record start in file, offset of the sequence in the record, sequence.
+struct Record {
+    size_t start;
+    size_t seq_offset;
+    std::string seq;
+};
+
+std::vector<Record> read_records(std::string const & filename) {
+  std::vector<Record> records;
+  std::ifstream ifs(filename);
+  std::string header, seq, plus, qual;
+  size_t pos = 0;
+  while (std::getline(ifs, header) && std::getline(ifs, seq) && std::getline(ifs, plus) && std::getline(ifs, qual)) {
+    records.push_back(Record{pos, header.size() + 1, seq});
+    pos += header.size() + seq.size() + plus.size() + qual.size() + 4;
+  }
+  return records;
+}
+
+/// stands in for an Index:  collective find and count over a map replicated on all processes.
+class GoldIndex {
+  public:
+    using KmerType = ::KmerType;
+
+    struct Map {
+        void transform_input(std::vector<KmerType> &) const {}
+    } map;
+
+    std::map<KmerType, uint32_t> gold;
+    mxx::comm const & comm;
+
+    GoldIndex(mxx::comm const & _comm) : comm(_comm) {}
+
+    Map const & get_map() const { return map; }
+
+    std::vector<std::pair<KmerType, uint32_t> > find(std::vector<KmerType> & keys) const {
+      ::mxx::allreduce(keys.size(), comm);   // collective, as in the distributed maps.
+      std::vector<std::pair<KmerType, uint32_t> > results;
+      for (auto k : keys) {
+        auto it = gold.find(k);
+        if (it != gold.end()) results.emplace_back(*it);
+      }
+      return results;
+    }
+
+    std::vector<std::pair<KmerType, size_t> > count(std::vector<KmerType> & keys) const {
+      ::mxx::allreduce(keys.size(), comm);
+      std::vector<std::pair<KmerType, size_t> > results;
+      for (auto k : keys) {
+        if (gold.count(k) > 0) results.emplace_back(k, 1);
+      }
+      return results;
+    }
+};
+
+
+TEST(ReadQueryTest, count_and_find)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/natural.fastq");
+
+  // every third read is in the index, and the first kmer of every other read.
+  std::vector<Record> records = read_records(filename);
+  ASSERT_LT(0UL, records.size());
+  GoldIndex index(comm);
+  for (size_t i = 0; i < records.size(); ++i) {
+    std::vector<KmerType> kmers = kmers_of(records[i].seq);
+    if (i % 3 == 0) {
+      for (auto const & k : kmers) index.gold.emplace(k, static_cast<uint32_t>(i));
+    } else if ((i % 2 == 0) && !kmers.empty()) {
+      index.gold.emplace(kmers.front(), static_cast<uint32_t>(i));
+    }
+  }
+
+  using Engine = ::bliss::index::kmer::read_query_engine<GoldIndex>;
+  Engine engine(index, comm);
+
+  // small blocks, so there are several batches.
+  std::map<size_t, ::bliss::index::kmer::read_hits> hits;
+  size_t duplicates = 0;
+  auto hit_consumer = [&hits, &duplicates](std::vector<Engine::read_result<::bliss::index::kmer::read_hits> > & reads) {
+    for (auto const & r : reads) {
+      if (hits.count(r.first) > 0) ++duplicates;
+      hits[r.first] = r.second;
+    }
+  };
+  auto counted = engine.count_hits<::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, 2048, hit_consumer, true);
+
+  // user reduction:  sum of the values of the found kmers.
+  std::map<size_t, size_t> sums;
+  auto sum_consumer = [&sums](std::vector<Engine::read_result<size_t> > & reads) {
+    for (auto const & r : reads) sums[r.first] += r.second;
+  };
+  auto sum = [](size_t & s, Engine::TupleType const &,
+      Engine::find_result_type::const_iterator first, Engine::find_result_type::const_iterator last) {
+    for (; first != last; ++first) s += first->second;
+  };
+  auto found = engine.query<size_t, ::bliss::io::posix_file, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, 2048, sum, sum_consumer);
+
+  EXPECT_EQ(0UL, duplicates);
+  EXPECT_EQ(counted, found);
+  EXPECT_EQ(records.size(), ::mxx::allreduce(counted.first, comm));
+  // reads shorter than k are not reported.
+  size_t with_kmers = std::count_if(records.begin(), records.end(), [](Record const & r) { return r.seq.size() >= KmerType::size; });
+  EXPECT_EQ(with_kmers, ::mxx::allreduce(hits.size(), comm));
+
+  // compare each read reported by this process to the serial computation.
+  size_t kmer_total = 0;
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto it = hits.find(records[i].start);
+    if (it == hits.end()) continue;
+
+    std::vector<KmerType> kmers = kmers_of(records[i].seq);
+    kmer_total += kmers.size();
+
+    size_t gold_hits = 0;
+    size_t gold_sum = 0;
+    std::vector<uint16_t> gold_positions;
+    for (size_t j = 0; j < kmers.size(); ++j) {
+      auto g = index.gold.find(kmers[j]);
+      if (g == index.gold.end()) continue;
+      ++gold_hits;
+      gold_sum += g->second;
+      gold_positions.emplace_back(static_cast<uint16_t>(records[i].seq_offset + j));
+    }
+
+    EXPECT_EQ(kmers.size(), it->second.kmers) << "read " << i;
+    EXPECT_EQ(gold_hits, it->second.hits) << "read " << i;
+    EXPECT_EQ(gold_positions, it->second.positions) << "read " << i;
+    EXPECT_EQ(gold_sum, sums[records[i].start]) << "read " << i;
+  }
+  EXPECT_EQ(kmer_total, counted.second);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_read_store.cpp
+ * @ingroup
+ * @brief   tests fetching the sequence at kmer positions from the distributed read store.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/sequence.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "index/kmer_index.hpp"
+#include "index/read_store.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using PosType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+using StoreType = ::bliss::index::read_store<::bliss::common::DNA>;
+
+
+/// kmer positions of the file, spread over the processes so that most requests are for reads on other processes.
+static std::vector<PosType> get_positions(std::string const & filename, ::mxx::comm const & comm) {
+  std::vector<PosType> all;
+  ::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerPositionTupleParser<PosType>,
+    ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, all, comm);
+  all = ::mxx::allgatherv(all, comm);
+
+  std::vector<PosType> mine;
+  for (size_t i = (comm.rank() + 1) % comm.size(); i < all.size(); i += comm.size()) mine.emplace_back(all[i]);
+  return mine;
+}
+
+static void check_fetch(StoreType const & store, std::vector<PosType> const & pos) {
+  std::vector<::bliss::common::ShortSequenceKmerId> ids;
+  for (auto const & p : pos) ids.emplace_back(p.second);
+
+  // exactly the kmers.
+  auto seqs = store.fetch(ids, static_cast<uint32_t>(KmerType::size));
+  ASSERT_EQ(pos.size(), seqs.size());
+  for (size_t i = 0; i < pos.size(); ++i) {
+    ASSERT_EQ(pos[i].first.toAlphabetString(), seqs[i]) << "i=" << i << pos[i].second;
+  }
+
+  // longer, up to the end of the read.
+  auto longer = store.fetch(ids, static_cast<uint32_t>(3 * KmerType::size));
+  ASSERT_EQ(pos.size(), longer.size());
+  for (size_t i = 0; i < pos.size(); ++i) {
+    ASSERT_GE(longer[i].size(), seqs[i].size());
+    EXPECT_EQ(seqs[i], longer[i].substr(0, seqs[i].size()));
+  }
+}
+
+
+TEST(ReadStoreTest, fetch)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.medium.fastq");
+
+  StoreType store(comm);
+  store.build(filename);
+  EXPECT_GT(store.size(), 0UL);
+
+  std::vector<PosType> pos = get_positions(filename, comm);
+  check_fetch(store, pos);
+
+  // requests before the sequence, for absent reads, and empty requests.
+  std::vector<::bliss::index::read_fetch_request> requests;
+  if (!pos.empty()) {
+    requests.emplace_back(pos[0].second.get_id(), 0, 1);
+    requests.emplace_back(pos[0].second.get_id() + 1, 0, 100);
+    requests.emplace_back(pos[0].second, 0);
+  }
+  auto seqs = store.fetch(requests);
+  ASSERT_EQ(requests.size(), seqs.size());
+  for (auto const & s : seqs) EXPECT_TRUE(s.empty());
+
+  // a process without requests.
+  if (comm.rank() == 0) pos.clear();
+  check_fetch(store, pos);
+}
+
+TEST(ReadStoreTest, packed_file)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.medium.fastq");
+  std::string packed = "read_store_test.pks";
+
+  StoreType store(comm);
+  store.build(filename);
+  store.save(packed);
+
+  StoreType loaded(comm);
+  loaded.load(packed);
+  EXPECT_EQ(store.size(), loaded.size());
+
+  std::vector<PosType> pos = get_positions(filename, comm);
+  check_fetch(loaded, pos);
+
+  comm.barrier();
+  if (comm.rank() == 0) remove(packed.c_str());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_text_export.cpp
+ * @ingroup
+ * @brief   tests the collective text export of a count index against the entries and toASCIIString.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "utils/kmer_utils.hpp"
+#include "index/kmer_index.hpp"
+#include "index/kmer_text_export.hpp"
+
+
+template <typename K>
+using SingleParams = ::bliss::index::kmer::SingleStrandHashMapParams<K>;
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using CountType = ::bliss::index::kmer::CountIndex2<::dsc::counting_unordered_map<KmerType, uint32_t, SingleParams> >;
+
+
+template <typename K>
+void check_format(std::string const & chars) {
+  K km(chars);
+  std::vector<char> buf(::bliss::index::kmer::kmer_text_formatter<K>::max_line);
+  size_t n = ::bliss::index::kmer::kmer_text_formatter<K>::format(km, 1234567UL, buf.data());
+  EXPECT_EQ(::bliss::utils::KmerUtils::toASCIIString(km) + "\t1234567\n", std::string(buf.data(), n));
+}
+
+TEST(TextExportTest, format)
+{
+  std::string chars("GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT");
+  // full and partial bytes, several words, and 1 character per shift alphabets.
+  check_format<::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t> >(chars);
+  check_format<::bliss::common::Kmer<32, ::bliss::common::DNA, uint64_t> >(chars);
+  check_format<::bliss::common::Kmer<5, ::bliss::common::DNA, uint8_t> >(chars);
+  check_format<::bliss::common::Kmer<45, ::bliss::common::DNA, uint16_t> >(chars);
+  check_format<::bliss::common::Kmer<21, ::bliss::common::DNA5, uint64_t> >(chars);
+  check_format<::bliss::common::Kmer<15, ::bliss::common::DNA16, uint32_t> >(chars);
+
+  std::vector<char> buf(::bliss::index::kmer::kmer_text_formatter<KmerType>::max_line);
+  size_t n = ::bliss::index::kmer::kmer_text_formatter<KmerType>::format(KmerType(chars), 0U, buf.data());
+  EXPECT_EQ(chars.substr(0, 31) + "\t0\n", std::string(buf.data(), n));
+}
+
+
+class TextExportFileTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(TextExportFileTest, export_text)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+  std::string out("/tmp/bliss_test_text_export.tsv");
+
+  CountType counts(comm);
+  counts.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+
+  // gold:  the entries of all processes as lines.
+  std::vector<std::pair<KmerType, uint32_t> > local;
+  counts.get_map().to_vector(local);
+  local = ::mxx::allgatherv(local, comm);
+  std::vector<std::string> gold;
+  size_t gold_bytes = 0;
+  for (auto const & e : local) {
+    std::stringstream ss;
+    ss << ::bliss::utils::KmerUtils::toASCIIString(e.first) << "\t" << e.second;
+    gold.emplace_back(ss.str());
+    gold_bytes += gold.back().size() + 1;
+  }
+  std::sort(gold.begin(), gold.end());
+
+  // small chunks, so there are several writes.
+  for (bool sorted : {false, true}) {
+    size_t bytes = ::bliss::index::kmer::export_text(counts, out, comm, sorted, 1000);
+    EXPECT_EQ(gold_bytes, bytes);
+
+    if (comm.rank() == 0) {
+      std::ifstream ifs(out);
+      std::vector<std::string> lines;
+      std::string line;
+      while (std::getline(ifs, line)) lines.emplace_back(line);
+
+      if (sorted) EXPECT_TRUE(std::is_sorted(lines.begin(), lines.end()));
+      else std::sort(lines.begin(), lines.end());
+      ASSERT_EQ(gold.size(), lines.size());
+      EXPECT_TRUE(gold == lines);
+    }
+    comm.barrier();
+  }
+
+  if (comm.rank() == 0) std::remove(out.c_str());
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, TextExportFileTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
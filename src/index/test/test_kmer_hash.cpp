@@ -41,11 +41,18 @@
 #include "common/kmer.hpp"
 #include "common/alphabets.hpp"
 #include "common/alphabet_traits.hpp"
+#include "common/kmer_iterators.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "utils/transform_utils.hpp"
 
 
 
 // include files to test
 
+/// the forward ntHash, in the 2 parameter form of the other kmer hashes.
+template <typename KMER, bool Prefix>
+using forward_ntHash = bliss::kmer::hash::ntHash<KMER, Prefix, false>;
+
 //TESTS: Hash functions.  test boundary cases - the number of unique outputs should be relatively close to number of unique inputs.
 
 template <typename T>
@@ -107,6 +114,66 @@ class KmerHashTest : public ::testing::Test {
       EXPECT_TRUE(same);
 
     }
+
+    /// batch hash should produce the same values as hashing one kmer at a time.  odd count to exercise the remainder.
+    template <template <typename, bool> class H, bool Prefix>
+    void batch_hash_vector(std::string name) {
+      H<T, Prefix> op;
+
+      size_t count = this->iterations - 3;
+      std::vector<uint64_t> hashes(count);
+      op(this->kmers.data(), count, hashes.data());
+
+      for (size_t i = 0; i < count; ++i) {
+        if (hashes[i] != op(this->kmers[i]))
+          BL_DEBUGF("ERROR: batch hash %s prefix %d differs at %lu.", name.c_str(), (Prefix ? 1 : 0), i);
+        ASSERT_EQ(op(this->kmers[i]), hashes[i]);
+      }
+
+      // through the transformed hash used by the distributed maps.
+      ::fsc::TransformedHash<T, PrefixHash<H, Prefix>::template type, ::bliss::transform::identity> trans_op;
+      std::vector<uint64_t> trans_hashes(count);
+      trans_op(this->kmers.data(), count, trans_hashes.data());
+      EXPECT_TRUE(std::equal(hashes.begin(), hashes.end(), trans_hashes.begin()));
+    }
+
+    /// the rolling hashes of the sliding window are the hashes of its kmers, forward or canonical.
+    template <bool canonical>
+    void rolling_hash_window() {
+      using Rolling = bliss::common::rolling_hash<T>;
+      using Iter = bliss::common::RollingHashKmerGenerationIterator<typename std::vector<uint8_t>::const_iterator, T, canonical>;
+
+      srand(1);
+      std::vector<uint8_t> seq(T::size + 2000);
+      for (size_t i = 0; i < seq.size(); ++i) {
+        seq[i] = T::KmerAlphabet::FROM_ASCII[static_cast<size_t>("ACGT"[rand() % 4])];
+      }
+
+      bliss::kmer::hash::ntHash<T, false, canonical> op;
+      Iter it(seq.cbegin(), true);
+      Iter end(seq.cend(), false);
+      size_t count = 0;
+      for (; it != end; ++it, ++count) {
+        auto v = *it;
+        T km;
+        for (size_t j = count; j < count + T::size; ++j) km.nextFromChar(seq[j]);
+        if (canonical) {
+          T rc = km.reverse_complement();
+          km = (km < rc) ? km : rc;
+          ASSERT_EQ(Rolling::canonical(rc), v.second);
+        }
+        ASSERT_EQ(km, v.first);
+        ASSERT_EQ(canonical ? Rolling::canonical(km) : Rolling::forward(km), v.second);
+        ASSERT_EQ(op(km), op(v));
+      }
+      EXPECT_EQ(2001UL, count);
+    }
+
+    template <template <typename, bool> class H, bool Prefix>
+    struct PrefixHash {
+    	template <typename K>
+    	using type = H<K, Prefix>;
+    };
 };
 
 template <typename T>
@@ -127,6 +194,29 @@ TYPED_TEST_P(KmerHashTest, hash)
 	this->template hash_vector<bliss::kmer::hash::identity>(std::string("identity"));
 	this->template hash_vector<bliss::kmer::hash::murmur  >(std::string("murmur"));
 	this->template hash_vector<bliss::kmer::hash::farm    >(std::string("farm"));
+	this->template hash_vector<bliss::kmer::hash::crc32c  >(std::string("crc32c"));
+	this->template hash_vector<bliss::kmer::hash::clhash  >(std::string("clhash"));
+	this->template hash_vector<forward_ntHash             >(std::string("ntHash"));
+}
+
+TYPED_TEST_P(KmerHashTest, hash_batch)
+{
+	this->template batch_hash_vector<bliss::kmer::hash::murmur, false>(std::string("murmur"));
+	this->template batch_hash_vector<bliss::kmer::hash::murmur, true >(std::string("murmur"));
+	this->template batch_hash_vector<bliss::kmer::hash::farm,   false>(std::string("farm"));
+	this->template batch_hash_vector<bliss::kmer::hash::farm,   true >(std::string("farm"));
+	this->template batch_hash_vector<bliss::kmer::hash::crc32c, false>(std::string("crc32c"));
+	this->template batch_hash_vector<bliss::kmer::hash::crc32c, true >(std::string("crc32c"));
+	this->template batch_hash_vector<bliss::kmer::hash::clhash, false>(std::string("clhash"));
+	this->template batch_hash_vector<bliss::kmer::hash::clhash, true >(std::string("clhash"));
+	this->template batch_hash_vector<forward_ntHash,            false>(std::string("ntHash"));
+	this->template batch_hash_vector<forward_ntHash,            true >(std::string("ntHash"));
+}
+
+TYPED_TEST_P(KmerHashTest, rolling_hash)
+{
+	this->template rolling_hash_window<false>();
+	this->template rolling_hash_window<true>();
 }
 
 
@@ -134,7 +224,38 @@ TYPED_TEST_P(KmerHashTest, hash)
 
 
 
-REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash);
+REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash, hash_batch, rolling_hash);
+
+
+/// the crc32c and carry-less multiply primitives, hardware or software, against bit-at-a-time references.
+TEST(KmerHashPrimitives, crc32c_clmul)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+
+  uint64_t a, b, lo, hi, gold_lo, gold_hi;
+  uint64_t crc, gold;
+  for (size_t iter = 0; iter < 1000; ++iter) {
+    a = distribution(generator);
+    b = distribution(generator);
+
+    gold_lo = 0; gold_hi = 0;
+    for (int i = 0; i < 64; ++i) {
+      if ((b >> i) & 1ULL) {
+        gold_lo ^= a << i;
+        if (i > 0) gold_hi ^= a >> (64 - i);
+      }
+    }
+    bliss::kmer::hash::detail::clmul64(a, b, lo, hi);
+    EXPECT_EQ(gold_lo, lo);
+    EXPECT_EQ(gold_hi, hi);
+
+    crc = static_cast<uint32_t>(b);
+    gold = crc ^ a;
+    for (int i = 0; i < 64; ++i) gold = (gold >> 1) ^ (0x82F63B78ULL & (0ULL - (gold & 1ULL)));
+    EXPECT_EQ(gold & 0xFFFFFFFFULL, bliss::kmer::hash::detail::crc32c_u64(crc, a));
+  }
+}
 
 //////////////////// RUN the tests with different types.
 
@@ -33,6 +33,7 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <random>
 #include "utils/logging.h"
 
 //// Usable AlmostEqual function
@@ -177,6 +178,19 @@ void iter_decode(const std::vector<unsigned char>& data, // quality score value
 }
 
 
+// templated test function
+template<typename CODEC, unsigned int K>
+void batch_decode(const std::vector<unsigned char>& data, // quality score value
+                           std::vector<typename CODEC::value_type>& output) {
+
+  bliss::index::QualityScoreBatch<K, CODEC> batch;
+
+  // run twice to check that buffers are reset between reads.
+  batch(data.begin(), data.end(), output);
+  batch(data.begin(), data.end(), output);
+}
+
+
 // templated test function
 template<typename CODEC, unsigned int K>
 void codec_decode(const std::vector<unsigned char> & data, // quality score value
@@ -337,6 +351,24 @@ void testQualityIterator(const std::string & strdata) {
   EXPECT_TRUE(same);
 
 
+  std::vector<OT> batchDecoded;
+  batch_decode< Encoder, K >(gold, batchDecoded);
+  same = compare_vectors<OT>(batchDecoded, goldDecoded);
+
+  if (!same) {
+    BL_ERROR( "batch decode: result not same" << std::endl );
+
+    BL_ERROR( "GOLD decoded: size: " << goldDecoded.size() );
+    std::copy(goldDecoded.begin() , goldDecoded.end(), std::ostream_iterator<OT>(std::cout, ","));
+    std::cout << std::endl;
+    BL_ERROR( "batch decoded: size: " << batchDecoded.size());
+    std::copy(batchDecoded.begin() , batchDecoded.end(), std::ostream_iterator<OT>(std::cout, ","));
+    std::cout << std::endl;
+  }
+
+  EXPECT_TRUE(same);
+
+
 }
 
 
@@ -405,6 +437,91 @@ TEST(QualityScoreGenerationIteratorTest, TestIllunima18QualityScoreFloat)
 }
 
 
+/**
+ * Test batch quality scores against the sliding window iterator on random 150bp reads
+ */
+TEST(QualityScoreGenerationIteratorTest, TestBatchRandomReads)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> distribution(33, 126);
+
+  std::vector<unsigned char> data(150);
+  std::vector<double> iterDecoded, batchDecoded;
+  std::vector<float> iterDecodedF, batchDecodedF;
+
+  for (int r = 0; r < 100; ++r) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      // mostly high quality, with occasional incorrect bases.
+      data[i] = (r % 4 == 0) ? distribution(generator) : (distribution(generator) % 2 == 0 ? 'I' : '5');
+    }
+
+    iter_decode<bliss::index::Illumina18QualityScoreCodec<double>, 31>(data, iterDecoded);
+    batch_decode<bliss::index::Illumina18QualityScoreCodec<double>, 31>(data, batchDecoded);
+    EXPECT_TRUE(compare_vectors<double>(batchDecoded, iterDecoded));
+
+    iter_decode<bliss::index::Illumina18QualityScoreCodec<float>, 21>(data, iterDecodedF);
+    batch_decode<bliss::index::Illumina18QualityScoreCodec<float>, 21>(data, batchDecodedF);
+    EXPECT_TRUE(compare_vectors<float>(batchDecodedF, iterDecodedF));
+  }
+
+  // shorter than k produces nothing
+  data.resize(20);
+  batch_decode<bliss::index::Illumina18QualityScoreCodec<double>, 31>(data, batchDecoded);
+  EXPECT_EQ(0UL, batchDecoded.size());
+}
+
+
+/**
+ * Test the fixed point codec, iterator, and batch against the double k-mer probabilities.
+ */
+TEST(QualityScoreGenerationIteratorTest, TestFixedPoint)
+{
+  using Codec = bliss::index::Illumina18QualityScoreCodec<uint16_t>;
+  using DCodec = bliss::index::Illumina18QualityScoreCodec<double>;
+
+  // per base rounding error is at most half of the last fraction bit.
+  double eps = 0.5 / static_cast<double>(1 << Codec::fixed_bits);
+  for (unsigned char c = 34; c <= 126; ++c) {
+    EXPECT_NEAR(DCodec::decode(c), Codec::to_log2(Codec::decode(c)), eps);
+  }
+  EXPECT_EQ(Codec::incorrect, Codec::decode('!'));
+  EXPECT_EQ(0.0, Codec::to_prob(Codec::incorrect));
+  EXPECT_EQ(DCodec::encode(DCodec::decode('5')), Codec::encode(Codec::decode('5')));
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> distribution(33, 126);
+
+  // lengths around the 16 window steps.
+  std::vector<unsigned char> data;
+  std::vector<uint16_t> iterDecoded, batchDecoded;
+  std::vector<double> goldDecoded;
+
+  for (size_t len : {31UL, 46UL, 47UL, 100UL, 150UL}) {
+    data.resize(len);
+    for (int r = 0; r < 20; ++r) {
+      for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (r % 4 == 0) ? distribution(generator) : (distribution(generator) % 2 == 0 ? 'I' : '%');
+      }
+
+      iter_decode<Codec, 31>(data, iterDecoded);
+      batch_decode<Codec, 31>(data, batchDecoded);
+      EXPECT_TRUE(compare_vectors<uint16_t>(batchDecoded, iterDecoded));
+
+      iter_decode<DCodec, 31>(data, goldDecoded);
+      ASSERT_EQ(goldDecoded.size(), iterDecoded.size());
+      for (size_t i = 0; i < iterDecoded.size(); ++i) {
+        if (iterDecoded[i] == Codec::incorrect) {
+          // incorrect base, or probability below 2^-64
+          EXPECT_LT(goldDecoded[i], std::exp2(-63.0));
+        } else {
+          EXPECT_NEAR(std::log2(goldDecoded[i]), Codec::to_log2(iterDecoded[i]), 31 * eps + 1e-9);
+        }
+      }
+    }
+  }
+}
+
+
 //
 //
 ///**
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    adaptive_block_size.hpp
+ * @ingroup io
+ * @brief   block size controller for streaming builds, from the memory headroom after each round.
+ * @details  after each block is inserted, the controller projects the peak memory of the next round per byte of file:
+ *          kmers per byte (observed) times the kmer tuple bytes in the batch and the distribute buffers (3 copies), plus
+ *          the fraction of kmers that were new entries (observed) times the map's bytes per entry, doubled for rehashing.
+ *          the bytes per entry start at the caller's estimate and are raised to the observed RSS growth per new entry.
+ *
+ *          the headroom is mem_fraction of the memory usable by the rank (MemUsage::get_usable_mem() divided by the ranks
+ *          on the node), which shrinks as the map grows.  the next block is headroom / projected bytes, at most max_growth
+ *          times the current one, within [min_block, max_block], and the minimum over all ranks, via 1 allreduce, so that
+ *          all ranks read blocks of the same target size.
+ *
+ *          the settings must be the same on all ranks.
+ */
+#ifndef SRC_IO_ADAPTIVE_BLOCK_SIZE_HPP_
+#define SRC_IO_ADAPTIVE_BLOCK_SIZE_HPP_
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstddef>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "io/io_exception.hpp"
+#include "utils/memory_usage.hpp"
+
+namespace bliss
+{
+namespace io
+{
+
+  /// block size of the next round of a streaming build, from the memory headroom and the map growth.  see file description.
+  class adaptive_block_size {
+    protected:
+      size_t current;
+      size_t min_block;
+      size_t max_block;
+      double mem_fraction;
+      double max_growth;
+
+      /// bytes of 1 kmer tuple in a batch.
+      size_t tuple_bytes;
+      /// projected bytes of 1 map entry.
+      double entry_bytes;
+
+      /// map entries and RSS at the previous update.
+      size_t entries_last;
+      double rss_last;
+
+      /// number of ranks sharing the node's memory.  computed on the first update.
+      int ranks_per_node;
+      size_t rounds;
+
+    public:
+      /**
+       * @param initial      block size in bytes for the first round.
+       * @param _tuple_bytes  bytes of 1 kmer tuple, e.g. sizeof(KmerParser::value_type).
+       * @param _entry_bytes  initial estimate of the bytes of 1 map entry, e.g. 2 * sizeof(MapType::value_type).
+       */
+      adaptive_block_size(size_t const & initial, size_t const & _tuple_bytes, size_t const & _entry_bytes,
+                          size_t const & _min_block = (1UL << 20), size_t const & _max_block = (1UL << 30),
+                          double const & _mem_fraction = 0.5, double const & _max_growth = 2.0) :
+        current(initial), min_block(_min_block), max_block(_max_block),
+        mem_fraction(_mem_fraction), max_growth(_max_growth),
+        tuple_bytes(_tuple_bytes), entry_bytes(static_cast<double>(_entry_bytes)),
+        entries_last(0), rss_last(static_cast<double>(::getCurrentRSS())), ranks_per_node(0), rounds(0) {
+        if ((min_block == 0) || (min_block > max_block))
+          throw ::std::invalid_argument("adaptive_block_size: need 0 < min_block <= max_block.");
+        if (max_growth < 1.0)
+          throw ::std::invalid_argument("adaptive_block_size: max_growth has to be at least 1.");
+        current = ::std::min(::std::max(current, min_block), max_block);
+      }
+
+      /// block size for the next round.
+      size_t get_block_size() const { return current; }
+      /// current projection of the bytes per map entry.
+      double get_entry_bytes() const { return entry_bytes; }
+      /// number of updates.
+      size_t get_rounds() const { return rounds; }
+
+      /**
+       * @brief compute the next block size from the last round.  collective.
+       * @param block_bytes  file bytes read in the last round by this rank.
+       * @param kmers        kmers generated from them.
+       * @param entries      local entries of the map after the last round.
+       * @return the block size for the next round, the same on all ranks.
+       */
+      size_t update(size_t const & block_bytes, size_t const & kmers, size_t const & entries, ::mxx::comm const & comm) {
+        ++rounds;
+        if (ranks_per_node == 0) ranks_per_node = comm.split_shared().size();
+
+        double rss = static_cast<double>(::getCurrentRSS());
+        if (entries > entries_last) {
+          double observed = (rss - rss_last) / static_cast<double>(entries - entries_last);
+          entry_bytes = ::std::max(entry_bytes, observed);
+        }
+        double new_fraction = (kmers == 0) ? 1.0 :
+            ::std::min(1.0, static_cast<double>((entries > entries_last) ? entries - entries_last : 0) / static_cast<double>(kmers));
+        entries_last = entries;
+        rss_last = rss;
+
+        double target = static_cast<double>(current) * max_growth;
+        if (block_bytes > 0) {
+          double avail = ::std::numeric_limits<double>::max();
+          try {
+            avail = static_cast<double>(::plog::MemUsage::get_usable_mem() / ranks_per_node) * mem_fraction;
+          } catch (::bliss::io::IOException const &) {
+            // no /proc/meminfo.  assume memory is not a constraint.
+          }
+
+          double kmers_per_byte = static_cast<double>(kmers) / static_cast<double>(block_bytes);
+          double bytes_per_byte = kmers_per_byte * (3.0 * static_cast<double>(tuple_bytes) + 2.0 * new_fraction * entry_bytes);
+
+          if (bytes_per_byte > 0.0) target = ::std::min(target, avail / bytes_per_byte);
+        }
+        // ranks that read nothing only limit the growth.
+        size_t next = (target >= static_cast<double>(max_block)) ? max_block : static_cast<size_t>(target);
+        next = ::std::min(::std::max(next, min_block), max_block);
+
+        current = ::mxx::allreduce(next, ::mxx::min<size_t>(), comm);
+        return current;
+      }
+  };
+
+} // namespace io
+} // namespace bliss
+
+#endif // SRC_IO_ADAPTIVE_BLOCK_SIZE_HPP_
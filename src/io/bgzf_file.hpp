@@ -0,0 +1,532 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bgzf_file.hpp
+ *
+ * @brief  parallel reader for gzip compressed FASTQ/FASTA files.
+ * @details  BGZF (blocked gzip, as written by bgzip/htslib) is a series of gzip members of at most 64KB each, with the
+ *    compressed member size stored in a header extra field.  processes can therefore find block boundaries in their
+ *    own portion of the compressed file, and decompress independently.
+ *
+ *    each process is assigned the BGZF blocks that start in its block partition of the compressed file.
+ *    the decompressed data is then treated as a partition of the uncompressed file, whose offsets are
+ *    computed via exscan.  the FASTQ / FASTA record boundary handling is the same as for partitioned_file.
+ *
+ *    a plain (not blocked) gzip file cannot be split, so rank 0 decompresses it and scatters the partitions.
+ */
+
+#ifndef BGZF_FILE_HPP_
+#define BGZF_FILE_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI) && defined(USE_ZLIB)
+
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+#include <cstring>      // memcpy, strerror
+#include <sstream>      // stringstream
+#include <exception>    // std exception
+#include <functional>   // std::plus
+
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include <io/io_exception.hpp>
+#include <io/file.hpp>
+#include <io/fastq_loader.hpp>
+#include <io/fasta_loader.hpp>
+#include <partition/range.hpp>
+#include <partition/partitioner.hpp>
+#include <partition/rank_weights.hpp>
+#include <utils/exception_handling.hpp>
+
+namespace bliss {
+
+namespace io {
+
+namespace parallel {
+
+
+/**
+ * @brief  parallel BGZF (or gzip) file reader.  each process decompresses its own blocks.
+ * @details  file_range_bytes and size() refer to the UNCOMPRESSED file, so that file_data ranges are in uncompressed
+ *      coordinates, as expected by the sequence parsers.  the constructor is collective, and determines the block
+ *      assignment and the uncompressed partition ranges.  read_file is collective.
+ * @note  records are aligned the same way as in partitioned_file:  FASTQ moves the partial first record to the
+ *      previous process, FASTA and BaseFileParser append overlap from the next process.  the overlap is taken
+ *      from the next process only, so each process's uncompressed partition should be larger than the overlap.
+ */
+template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
+class bgzf_file : public ::bliss::io::parallel::base_file {
+
+protected:
+	using BASE = ::bliss::io::parallel::base_file;
+	using range_type = typename ::bliss::io::base_file::range_type;
+	using FileParserType = FileParser<typename ::bliss::io::file_data::const_iterator >;
+
+	/// BGZF block information: offset in local compressed buffer, compressed size, uncompressed size.
+	struct block_info {
+		size_t offset;
+		size_t size;
+		size_t usize;
+	};
+
+	/// maximum BGZF block size, compressed and uncompressed.
+	static constexpr size_t max_block_size = 65536UL;
+
+	/// minimum gzip member size: header, empty deflate stream, footer.
+	static constexpr size_t min_block_size = 26UL;
+
+	/// sequential reader for the compressed file
+	::bliss::io::posix_file reader;
+
+	/// overlap amount, in uncompressed bytes
+	const size_t overlap;
+
+	/// compressed file range
+	range_type compressed_range_bytes;
+
+	/// uncompressed range for the current process
+	range_type partition_range_bytes;
+
+	/// blocks for the current process
+	std::vector<block_info> blocks;
+
+	/// compressed data for the current process's blocks, or the decompressed data if plain gzip.
+	typename ::bliss::io::file_data::container buffer;
+
+	/// whether the file is BGZF.  false for plain gzip.
+	bool blocked;
+
+	/// read little endian 16 bit integer
+	static inline size_t get_u16(unsigned char const * ptr) {
+		return static_cast<size_t>(ptr[0]) | (static_cast<size_t>(ptr[1]) << 8);
+	}
+
+	/// read little endian 32 bit integer
+	static inline size_t get_u32(unsigned char const * ptr) {
+		return get_u16(ptr) | (get_u16(ptr + 2) << 16);
+	}
+
+	/// check if there is a gzip header at ptr.
+	static inline bool is_gzip(unsigned char const * ptr, size_t const & len) {
+		return (len >= 4) && (ptr[0] == 0x1f) && (ptr[1] == 0x8b) && (ptr[2] == 8);
+	}
+
+	/**
+	 * @brief  get the size of the BGZF block starting at ptr.
+	 * @return  the total compressed block size, or 0 if there is no BGZF header at ptr.
+	 */
+	static size_t get_block_size(unsigned char const * ptr, size_t const & len) {
+		// FLG.FEXTRA has to be set.
+		if ((len < 18) || !is_gzip(ptr, len) || ((ptr[3] & 4) == 0)) return 0;
+
+		size_t xlen = get_u16(ptr + 10);
+		if (len < 12 + xlen) return 0;
+
+		// look for the BC subfield.
+		unsigned char const * sub = ptr + 12;
+		unsigned char const * sub_end = sub + xlen;
+		size_t slen;
+		while (sub + 4 <= sub_end) {
+			slen = get_u16(sub + 2);
+			if ((sub[0] == 'B') && (sub[1] == 'C') && (slen == 2) && (sub + 6 <= sub_end)) {
+				return get_u16(sub + 4) + 1;
+			}
+			sub += 4 + slen;
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief  find the first BGZF block that starts in [start, end) in the local compressed buffer.
+	 * @details  a match is accepted if it is followed by another block header or by the end of file, to avoid false positives in compressed data.
+	 * @param buffer_start  file offset of buffer[0]
+	 * @return  buffer offset of the first block, or end if not found.
+	 */
+	size_t find_first_block(size_t const & start, size_t const & end, size_t const & buffer_start) {
+		size_t buf_end = buffer_start + buffer.size();
+		size_t bsize, next;
+		for (size_t pos = start; pos < end; ++pos) {
+			bsize = get_block_size(buffer.data() + (pos - buffer_start), buf_end - pos);
+			if (bsize < min_block_size) continue;
+
+			next = pos + bsize;
+			if ((next == compressed_range_bytes.end) ||
+					((next < buf_end) && (get_block_size(buffer.data() + (next - buffer_start), buf_end - next) > 0))) {
+				return pos;
+			}
+		}
+		return end;
+	}
+
+	/**
+	 * @brief  collectively locate the BGZF blocks for each process, and compute the uncompressed ranges.
+	 */
+	void find_blocks() {
+		// partition the compressed file.
+		range_type target = compressed_range_bytes;
+		if (this->comm.size() > 1) {
+			::bliss::partition::BlockPartitioner<range_type> partitioner;
+			partitioner.configure(compressed_range_bytes, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
+			target = partitioner.getNext(this->comm.rank());
+		}
+
+		// read the partition, plus enough to contain the last block and the header of the next.
+		range_type window = target;
+		window.end += 2 * max_block_size;
+		window.intersect(compressed_range_bytes);
+		window = reader.read_range(buffer, window);
+
+		// find the first block start
+		size_t pos = (this->comm.rank() == 0) ? target.start : find_first_block(target.start, target.end, window.start);
+
+		// walk the blocks to the end of the partition.
+		block_info bi;
+		size_t usize = 0;
+		while (pos < target.end) {
+			bi.offset = pos - window.start;
+			bi.size = get_block_size(buffer.data() + bi.offset, window.end - pos);
+			if ((bi.size < min_block_size) || (pos + bi.size > window.end)) {
+				std::stringstream ss;
+				ss << "ERROR: bgzf_file: invalid BGZF block at offset " << pos << " in file " << this->filename;
+				throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+			}
+			bi.usize = get_u32(buffer.data() + bi.offset + bi.size - 4);
+			// skip empty blocks, e.g. the EOF marker block.
+			if (bi.usize > 0) blocks.push_back(bi);
+
+			usize += bi.usize;
+			pos += bi.size;
+		}
+
+		// compute the uncompressed offsets.
+		size_t ustart = ::mxx::exscan(usize, std::plus<size_t>(), this->comm);
+		if (this->comm.rank() == 0) ustart = 0;
+		size_t total = ::mxx::allreduce(usize, this->comm);
+
+		partition_range_bytes = range_type(ustart, ustart + usize);
+		this->file_range_bytes = range_type(0, total);
+	}
+
+	/**
+	 * @brief  inflate a gzip stream.
+	 * @param src   compressed data, starting at gzip header.
+	 * @param dest  output.  for BGZF, preallocated.
+	 * @param raw   if true, src is a raw deflate stream (no header, no footer), and dest_len is the expected output size.
+	 * @return  number of bytes written.
+	 */
+	static size_t inflate_block(unsigned char const * src, size_t const & src_len, unsigned char * dest, size_t const & dest_len) {
+		z_stream strm;
+		memset(&strm, 0, sizeof(z_stream));
+
+		// raw deflate stream
+		int ret = inflateInit2(&strm, -15);
+		if (ret != Z_OK) return static_cast<size_t>(-1);
+
+		strm.next_in = const_cast<unsigned char *>(src);
+		strm.avail_in = src_len;
+		strm.next_out = dest;
+		strm.avail_out = dest_len;
+
+		ret = inflate(&strm, Z_FINISH);
+		size_t written = dest_len - strm.avail_out;
+		inflateEnd(&strm);
+
+		return (ret == Z_STREAM_END) ? written : static_cast<size_t>(-1);
+	}
+
+	/**
+	 * @brief  decompress the local BGZF blocks, in parallel.
+	 */
+	void decompress_blocks(typename ::bliss::io::file_data::container & output) {
+		output.resize(partition_range_bytes.size());
+
+		// output offsets for each block
+		std::vector<size_t> offsets(blocks.size() + 1, 0);
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			offsets[i + 1] = offsets[i] + blocks[i].usize;
+		}
+
+		int errors = 0;
+
+#pragma omp parallel for schedule(dynamic, 16) reduction(+ : errors)
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			unsigned char const * bstart = buffer.data() + blocks[i].offset;
+			size_t header = 12 + get_u16(bstart + 10);
+
+			// deflate data is between header and 8 byte footer.
+			size_t len = inflate_block(bstart + header, blocks[i].size - header - 8,
+					output.data() + offsets[i], blocks[i].usize);
+
+			if ((len != blocks[i].usize) ||
+					(crc32(crc32(0L, Z_NULL, 0), output.data() + offsets[i], len) != get_u32(bstart + blocks[i].size - 8))) {
+				++errors;
+			}
+		}
+
+		// all processes throw, so that none is left waiting in a collective call.
+		errors = ::mxx::allreduce(errors, this->comm);
+		if (errors > 0) {
+			std::stringstream ss;
+			ss << "ERROR: bgzf_file: " << errors << " blocks failed to decompress in file " << this->filename;
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		// compressed data no longer needed.
+		typename ::bliss::io::file_data::container().swap(buffer);
+		blocks.clear();
+	}
+
+	/**
+	 * @brief  decompress a plain gzip file on rank 0, then scatter the block partitions.  collective.
+	 */
+	void decompress_gzip() {
+		size_t total = 0;
+
+		if (this->comm.rank() == 0) {
+			typename ::bliss::io::file_data::container compressed;
+			reader.read_range(compressed, compressed_range_bytes);
+
+			z_stream strm;
+			memset(&strm, 0, sizeof(z_stream));
+			// gzip header, allow concatenated members.
+			int ret = inflateInit2(&strm, 15 + 16);
+
+			strm.next_in = compressed.data();
+			strm.avail_in = compressed.size();
+
+			// estimate 4x compression
+			buffer.resize(compressed.size() * 4);
+			while (ret == Z_OK) {
+				if (total == buffer.size()) buffer.resize(buffer.size() * 2);
+				strm.next_out = buffer.data() + total;
+				strm.avail_out = buffer.size() - total;
+
+				ret = inflate(&strm, Z_NO_FLUSH);
+				total = buffer.size() - strm.avail_out;
+
+				// next member of a multi-member gzip file.
+				if ((ret == Z_STREAM_END) && (strm.avail_in > 0)) ret = inflateReset(&strm);
+			}
+			inflateEnd(&strm);
+
+			if (ret != Z_STREAM_END) {
+				total = static_cast<size_t>(-1);
+			}
+			buffer.resize(ret == Z_STREAM_END ? total : 0);
+		}
+
+		total = ::mxx::allreduce((this->comm.rank() == 0) ? total : 0UL, this->comm);
+		if (total == static_cast<size_t>(-1)) {
+			std::stringstream ss;
+			ss << "ERROR: bgzf_file: failed to decompress gzip file " << this->filename;
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		this->file_range_bytes = range_type(0, total);
+		partition_range_bytes = this->file_range_bytes;
+
+		if (this->comm.size() > 1) {
+			::bliss::partition::BlockPartitioner<range_type> partitioner;
+			partitioner.configure(this->file_range_bytes, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
+			std::vector<size_t> send_counts(this->comm.size(), 0);
+			if (this->comm.rank() == 0) {
+				for (int i = 0; i < this->comm.size(); ++i) {
+					send_counts[i] = partitioner.getNext(i).size();
+				}
+			}
+			// getNext marks the partition as done.  reset before getting the local partition.
+			partitioner.reset();
+			partition_range_bytes = partitioner.getNext(this->comm.rank());
+
+			buffer = ::mxx::all2allv(buffer, send_counts, this->comm);
+		}
+	}
+
+	/**
+	 * @brief append the first "count" bytes of the next process's partition to the current process's data.  collective.
+	 */
+	void append_from_next(::bliss::io::file_data & output, size_t const & count) {
+		std::vector<size_t> send_counts(this->comm.size(), 0);
+		if (this->comm.rank() > 0) send_counts[this->comm.rank() - 1] = ::std::min(count, output.data.size());
+
+		typename ::bliss::io::file_data::container shifted =
+				::mxx::all2allv(output.data, send_counts, this->comm);
+		output.data.insert(output.data.end(), shifted.begin(), shifted.end());
+
+		output.in_mem_range_bytes.end = output.in_mem_range_bytes.start + output.data.size();
+	}
+
+
+	/// record alignment for BaseFileParser.  add overlap.
+	template <typename P>
+	void align_records(::bliss::io::file_data & output, P const &) {
+		if (overlap > 0) append_from_next(output, overlap);
+	}
+
+	/// record alignment for FASTA.  add overlap, then remove the extra.  same as partitioned_file<FASTAParser>.
+	void align_records(::bliss::io::file_data & output, ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator> const &) {
+		append_from_next(output, 2 * overlap);
+
+		FileParserType parser;
+		size_t overlap_end = parser.find_overlap_end(output.in_mem_cbegin(), output.parent_range_bytes,
+				output.in_mem_range_bytes, output.valid_range_bytes.end, overlap);
+
+		// erase the extra.
+		output.in_mem_range_bytes.end = overlap_end;
+		output.data.erase(output.data.begin() + output.in_mem_range_bytes.size(), output.data.end());
+	}
+
+	/// record alignment for FASTQ.  move partial first record to previous process.  same as partitioned_file<FASTQParser>.
+	void align_records(::bliss::io::file_data & output, ::bliss::io::FASTQParser<typename ::bliss::io::file_data::const_iterator> const &) {
+		range_type partition_range = output.valid_range_bytes;
+		range_type in_mem = output.in_mem_range_bytes;
+
+		FileParserType parser;
+		size_t real_start = parser.init_parser(output.in_mem_cbegin(), this->file_range_bytes,
+				in_mem, partition_range, this->comm);
+
+		bool not_found = (real_start >= partition_range.end);  // if real start is outside of partition, not found
+		real_start = std::min(real_start, partition_range.end);
+		int target_rank = not_found ? 0 : this->comm.rank();
+		target_rank = ::mxx::exscan(target_rank, [](int const & x, int const & y) {
+			return (x < y) ? y : x;
+		}, this->comm);
+
+		std::vector<size_t> send_counts(this->comm.size(), 0);
+		if (this->comm.rank() > 0) send_counts[target_rank] = real_start - in_mem.start;
+
+		typename ::bliss::io::file_data::container shifted =
+				::mxx::all2allv(output.data, send_counts, this->comm);
+		output.data.insert(output.data.end(), shifted.begin(), shifted.end());
+
+		output.in_mem_range_bytes.end = in_mem.start + output.data.size();
+
+		output.valid_range_bytes.start = real_start;
+		output.valid_range_bytes.end =
+				not_found ? partition_range.end : output.in_mem_range_bytes.end;
+
+		// a process with no record start sent all its data to a previous process.  it gets empty ranges, positioned at
+		// the next record start so that the valid ranges are contiguous.  common when there are fewer BGZF blocks than processes.
+		size_t next_start = not_found ? this->file_range_bytes.end : real_start;
+		next_start = ::mxx::exscan(next_start, [](size_t const & x, size_t const & y) {
+			return (x < y) ? x : y;
+		}, this->comm.reverse());
+		if (this->comm.rank() == (this->comm.size() - 1)) next_start = this->file_range_bytes.end;
+		if (not_found) {
+			output.data.clear();
+			output.in_mem_range_bytes = range_type(next_start, next_start);
+			output.valid_range_bytes = output.in_mem_range_bytes;
+		}
+	}
+
+public:
+
+	/**
+	 * @brief constructor.  collective.  locates the compressed blocks for each process.
+	 * @param _filename 		name of file to open
+	 * @param _overlap      overlap, in uncompressed bytes
+	 * @param _comm				MPI communicator to use.
+	 */
+	bgzf_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
+		BASE(_filename, _comm),
+		reader(this->fd, this->file_range_bytes.end), overlap(_overlap),
+		compressed_range_bytes(this->file_range_bytes), partition_range_bytes(0, 0), blocked(false) {
+
+		// check the first header.
+		typename ::bliss::io::file_data::container header;
+		reader.read_range(header, range_type(0, ::std::min(compressed_range_bytes.end, 18UL)));
+
+		if (!is_gzip(header.data(), header.size())) {
+			std::stringstream ss;
+			ss << "ERROR: bgzf_file: file " << this->filename << " is not gzip compressed.";
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		blocked = (get_block_size(header.data(), header.size()) > 0);
+		if (blocked) find_blocks();
+		else decompress_gzip();
+	};
+
+	/// destructor
+	virtual ~bgzf_file() {};
+
+	/// get the compressed file size
+	size_t compressed_size() const {
+		return compressed_range_bytes.end;
+	}
+
+	/// check if the file is BGZF, i.e. can be decompressed in parallel.
+	bool is_blocked() const {
+		return blocked;
+	}
+
+	/// get the uncompressed range for the current process, before record alignment.
+	range_type const & get_partition_range() const {
+		return partition_range_bytes;
+	}
+
+	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+	using BASE::read_range;
+
+	/**
+	 * @brief  not supported:  compressed data cannot be read at arbitrary uncompressed offsets.
+	 */
+	virtual range_type read_range(typename ::bliss::io::file_data::container & output,
+			range_type const & range_bytes) {
+		BLISS_UNUSED(output);
+		BLISS_UNUSED(range_bytes);
+		throw ::std::logic_error("ERROR: bgzf_file does not support read_range.  use read_file.");
+	}
+
+	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+	using BASE::read_file;
+
+	/**
+	 * @brief  decompress the process's blocks and align to records.  collective.  can only be called once.
+	 * @param output 		file_data object containing data and various ranges.
+	 */
+	virtual void read_file(::bliss::io::file_data & output) {
+		if (blocked) {
+			decompress_blocks(output.data);
+		} else {
+			output.data.swap(buffer);
+		}
+
+		output.in_mem_range_bytes = partition_range_bytes;
+		output.valid_range_bytes = partition_range_bytes;
+		output.parent_range_bytes = this->file_range_bytes;
+
+		align_records(output, FileParserType());
+	}
+
+};
+
+
+} // parallel
+
+} // io
+
+} // bliss
+
+#endif  // USE_MPI && USE_ZLIB
+
+#endif /* BGZF_FILE_HPP_ */
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    buffer_pool.hpp
+ * @ingroup
+ * @brief   pool of std::vector buffers whose capacity is reused across the distribute calls of a map.
+ * @details a query allocates its distribute buffers and mapping (i2o) for each call.  for a stream of medium batches,
+ *          that is a malloc, page faults on first touch, and a free of the same sizes each time.  with the pool, the
+ *          buffers are taken from the pool and returned at the end of the call, cleared but with their capacity, so
+ *          that the next call writes to memory that is already mapped.
+ *
+ *          cached buffers are trimmed to the high water mark of the recent calls:  every trim_interval acquires, each
+ *          element type keeps only as many buffers, the largest ones, as were in use at the same time during the
+ *          interval.  the total cached bytes are also capped by max_bytes, above which returned buffers are freed.  the
+ *          default cap of 64 MB keeps the buffers of medium query batches, while the buffers of a large insert
+ *          or build are freed when returned, instead of staying resident with the map.
+ *
+ *          not thread safe.  each map has its own pool.
+ */
+#ifndef SRC_IO_BUFFER_POOL_HPP_
+#define SRC_IO_BUFFER_POOL_HPP_
+
+#include <vector>
+#include <map>
+#include <memory>     // unique_ptr
+#include <typeindex>
+#include <typeinfo>
+#include <algorithm>
+
+namespace imxx
+{
+
+  class buffer_pool {
+    protected:
+
+      /// cached buffers of 1 element type.
+      struct slot_base {
+          /// buffers of this type in use now, and the most at once since the last trim.
+          size_t out;
+          size_t peak_out;
+
+          slot_base() : out(0), peak_out(0) {}
+          virtual ~slot_base() {}
+
+          /// free all but the keep largest buffers.  returns the bytes freed.
+          virtual size_t trim(size_t const & keep) = 0;
+      };
+
+      template <typename T>
+      struct slot : public slot_base {
+          /// sorted by capacity, increasing.
+          ::std::vector<::std::vector<T> > cached;
+
+          static size_t bytes(::std::vector<T> const & v) {
+            return v.capacity() * sizeof(T);
+          }
+
+          virtual size_t trim(size_t const & keep) {
+            size_t freed = 0;
+            size_t drop = (cached.size() > keep) ? cached.size() - keep : 0;
+            for (size_t i = 0; i < drop; ++i) freed += bytes(cached[i]);
+            cached.erase(cached.begin(), cached.begin() + drop);
+            return freed;
+          }
+      };
+
+      ::std::map<::std::type_index, ::std::unique_ptr<slot_base> > slots;
+
+      size_t cached_bytes;
+      size_t max_bytes;
+      size_t trim_interval;
+      size_t acquires;
+      size_t hits;
+
+      template <typename T>
+      slot<T> & get_slot() {
+        ::std::unique_ptr<slot_base> & s = slots[::std::type_index(typeid(T))];
+        if (!s) s.reset(new slot<T>());
+        return static_cast<slot<T> &>(*s);
+      }
+
+      /// cache a buffer that is no longer used.  frees it if the pool is full.
+      template <typename T>
+      void release(::std::vector<T> & v) {
+        slot<T> & s = get_slot<T>();
+        if (s.out > 0) --s.out;
+
+        size_t b = slot<T>::bytes(v);
+        if ((b == 0) || (cached_bytes + b > max_bytes)) {
+          ::std::vector<T>().swap(v);
+          return;
+        }
+        v.clear();
+        auto pos = ::std::upper_bound(s.cached.begin(), s.cached.end(), v,
+                                      [](::std::vector<T> const & x, ::std::vector<T> const & y) {
+          return x.capacity() < y.capacity();
+        });
+        pos = s.cached.emplace(pos);
+        pos->swap(v);
+        cached_bytes += b;
+      }
+
+    public:
+
+      /**
+       * @brief a buffer from the pool.  returned to the pool when destroyed.  move only.
+       */
+      template <typename T>
+      class buffer {
+          friend class buffer_pool;
+
+        protected:
+          buffer_pool * pool;
+          ::std::vector<T> v;
+
+          buffer(buffer_pool * _pool) : pool(_pool) {}
+
+        public:
+          buffer(buffer && other) : pool(other.pool), v(::std::move(other.v)) {
+            other.pool = nullptr;
+          }
+          buffer(buffer const & other) = delete;
+          buffer & operator=(buffer const & other) = delete;
+
+          ~buffer() {
+            if (pool) pool->release(v);
+          }
+
+          ::std::vector<T> & operator*() { return v; }
+          ::std::vector<T> * operator->() { return &v; }
+      };
+
+      /**
+       * @param _max_bytes      cap on the bytes of cached buffers.  default 64 MB.
+       * @param _trim_interval  acquires between trims to the high water mark.  0 disables the automatic trim.
+       */
+      buffer_pool(size_t const & _max_bytes = (64UL << 20), size_t const & _trim_interval = 64) :
+        cached_bytes(0), max_bytes(_max_bytes), trim_interval(_trim_interval), acquires(0), hits(0) {}
+
+      /// copies start empty:  the buffers belong to the pool they came from.
+      buffer_pool(buffer_pool const & other) :
+        cached_bytes(0), max_bytes(other.max_bytes), trim_interval(other.trim_interval), acquires(0), hits(0) {}
+      buffer_pool & operator=(buffer_pool const & other) {
+        clear();
+        max_bytes = other.max_bytes;
+        trim_interval = other.trim_interval;
+        return *this;
+      }
+
+      /**
+       * @brief an empty buffer, with the capacity of a cached one if there is one.
+       * @param n  expected size.  the smallest cached buffer with at least this capacity is used, else the largest.
+       */
+      template <typename T>
+      buffer<T> acquire(size_t const & n = 0) {
+        if ((trim_interval > 0) && (++acquires % trim_interval == 0)) trim();
+
+        slot<T> & s = get_slot<T>();
+        ++s.out;
+        s.peak_out = ::std::max(s.peak_out, s.out);
+
+        buffer<T> result(this);
+        if (!s.cached.empty()) {
+          auto pos = ::std::find_if(s.cached.begin(), s.cached.end(), [&n](::std::vector<T> const & x) {
+            return x.capacity() >= n;
+          });
+          if (pos == s.cached.end()) --pos;
+          cached_bytes -= slot<T>::bytes(*pos);
+          result.v.swap(*pos);
+          s.cached.erase(pos);
+          ++hits;
+        }
+        return result;
+      }
+
+      /// keep, for each element type, only as many cached buffers as were in use at once since the last trim.
+      void trim() {
+        for (auto & s : slots) {
+          cached_bytes -= s.second->trim(s.second->peak_out);
+          s.second->peak_out = s.second->out;
+        }
+      }
+
+      /// free all cached buffers.
+      void clear() {
+        for (auto & s : slots) {
+          cached_bytes -= s.second->trim(0);
+        }
+      }
+
+      void set_max_bytes(size_t const & b) {
+        max_bytes = b;
+        if (cached_bytes > max_bytes) clear();
+      }
+      size_t get_max_bytes() const { return max_bytes; }
+
+      void set_trim_interval(size_t const & i) { trim_interval = i; }
+      size_t get_trim_interval() const { return trim_interval; }
+
+      /// bytes held by the cached buffers.
+      size_t bytes() const { return cached_bytes; }
+
+      /// number of acquires that reused a cached buffer.
+      size_t reused() const { return hits; }
+  };
+
+} // namespace imxx
+
+#endif /* SRC_IO_BUFFER_POOL_HPP_ */
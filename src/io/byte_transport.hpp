@@ -0,0 +1,192 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    byte_transport.hpp
+ * @ingroup
+ * @brief   sends payloads that are plain bytes as MPI_BYTE, instead of through their mxx derived datatype.
+ * @details mxx builds an MPI struct type for std::pair<Kmer, T> and similar, and some MPI implementations (MVAPICH)
+ *          pack such types element by element in all2allv.  a payload whose bytes are its value, with no padding,
+ *          can be sent as sizeof(V) bytes per element instead, with the counts and displacements scaled.
+ *
+ *          is_byte_transport<V> says whether V is such a payload.  it is true for arithmetic and enum types, for
+ *          std::pair and std::array of such types when there is no padding, and for the types that specialize it,
+ *          e.g. Kmer and the sequence ids in io/mxx_support.hpp.  padding is checked at compile time:  a pair with
+ *          padding is not byte transported, so the padding is not sent, and it keeps its mxx datatype.
+ *
+ *          the choice has to be the same on all ranks, since the type signatures have to match.  it depends on V and
+ *          on the byte_transport setting, which should be the same on all ranks.  if a rank's byte counts do not fit
+ *          in int, it uses a contiguous type of sizeof(V) bytes, which has the same signature.
+ */
+#ifndef SRC_IO_BYTE_TRANSPORT_HPP_
+#define SRC_IO_BYTE_TRANSPORT_HPP_
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <utility>      // pair
+#include <type_traits>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "io/rma_transport.hpp"
+
+namespace imxx
+{
+
+  /// true if the bytes of V are its value, without padding, so it can be sent as MPI_BYTE.  specialize for other types.
+  template <typename V>
+  struct is_byte_transport : public ::std::integral_constant<bool,
+    ::std::is_arithmetic<V>::value || ::std::is_enum<V>::value> {};
+
+  template <typename V>
+  struct is_byte_transport<const V> : public is_byte_transport<V> {};
+
+  template <typename A, typename B>
+  struct is_byte_transport<::std::pair<A, B> > : public ::std::integral_constant<bool,
+    is_byte_transport<A>::value && is_byte_transport<B>::value &&
+    (sizeof(::std::pair<A, B>) == sizeof(A) + sizeof(B))> {};
+
+  template <typename V, size_t N>
+  struct is_byte_transport<::std::array<V, N> > : public ::std::integral_constant<bool,
+    is_byte_transport<V>::value && (sizeof(::std::array<V, N>) == N * sizeof(V))> {};
+
+
+  /// setting for byte transport, per process.  should be the same on all ranks.
+  class byte_transport {
+    protected:
+      bool on;
+
+    public:
+      byte_transport() : on(true) {}
+
+      static byte_transport & instance() {
+        static byte_transport settings;
+        return settings;
+      }
+
+      void enable(bool const & e = true) { on = e; }
+      bool enabled() const { return on; }
+
+      /// whether V is sent as bytes.
+      template <typename V>
+      bool use() const { return on && is_byte_transport<V>::value; }
+  };
+
+
+  namespace local {
+
+    /// counts and displacements scaled to bytes.  false if any does not fit in int.
+    template <typename SIZE>
+    bool scale_to_bytes(::std::vector<SIZE> const & counts, size_t const & elem_bytes,
+                        ::std::vector<int> & byte_counts, ::std::vector<int> & byte_displs) {
+      size_t const limit = ::std::numeric_limits<int>::max();
+      byte_counts.resize(counts.size());
+      byte_displs.resize(counts.size());
+      size_t offset = 0;
+      for (size_t i = 0; i < counts.size(); ++i) {
+        size_t bytes = static_cast<size_t>(counts[i]) * elem_bytes;
+        if ((bytes > limit) || (offset > limit)) return false;
+        byte_counts[i] = static_cast<int>(bytes);
+        byte_displs[i] = static_cast<int>(offset);
+        offset += bytes;
+      }
+      return true;
+    }
+
+    /// element counts and displacements as int.  the callers use large_all2allv when the counts are larger.
+    template <typename SIZE>
+    void to_int_counts(::std::vector<SIZE> const & counts, ::std::vector<int> & int_counts, ::std::vector<int> & int_displs) {
+      int_counts.resize(counts.size());
+      int_displs.resize(counts.size());
+      size_t offset = 0;
+      for (size_t i = 0; i < counts.size(); ++i) {
+        int_counts[i] = static_cast<int>(counts[i]);
+        int_displs[i] = static_cast<int>(offset);
+        offset += counts[i];
+      }
+    }
+
+  } // local namespace
+
+
+  /**
+   * @brief  all2allv that sends byte transport payloads as MPI_BYTE, and others with mxx::all2allv.  collective.
+   * @details  same arguments as mxx::all2allv.  byte transport payloads go by one sided puts if the rma transport is
+   *          installed for comm, see rma_transport.hpp.
+   */
+  template <typename V, typename SIZE>
+  void payload_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                        V * output, ::std::vector<SIZE> const & recv_counts,
+                        ::mxx::comm const & comm) {
+    if (!byte_transport::instance().use<V>()) {
+      ::mxx::all2allv(input, send_counts, output, recv_counts, comm);
+      return;
+    }
+
+    rma_window * win = rma_transport::instance().window(comm);
+    if (win != nullptr) {
+      rma_all2allv(input, send_counts, output, recv_counts, *win, comm);
+      return;
+    }
+
+    ::std::vector<int> sc, sd, rc, rd;
+    if (local::scale_to_bytes(send_counts, sizeof(V), sc, sd) &&
+        local::scale_to_bytes(recv_counts, sizeof(V), rc, rd)) {
+      MPI_Alltoallv(const_cast<V *>(input), sc.data(), sd.data(), MPI_BYTE,
+                    output, rc.data(), rd.data(), MPI_BYTE, comm);
+      return;
+    }
+
+    // same type signature as the scaled MPI_BYTE counts on the other ranks.
+    MPI_Datatype dt;
+    MPI_Type_contiguous(static_cast<int>(sizeof(V)), MPI_BYTE, &dt);
+    MPI_Type_commit(&dt);
+    local::to_int_counts(send_counts, sc, sd);
+    local::to_int_counts(recv_counts, rc, rd);
+    MPI_Alltoallv(const_cast<V *>(input), sc.data(), sd.data(), dt,
+                  output, rc.data(), rd.data(), dt, comm);
+    MPI_Type_free(&dt);
+  }
+
+  /**
+   * @brief  block all2all, count elements per rank, for byte transport payloads as MPI_BYTE.  collective.
+   */
+  template <typename V>
+  void payload_all2all(V const * input, size_t const & count, V * output, ::mxx::comm const & comm) {
+    if (!byte_transport::instance().use<V>()) {
+      ::mxx::all2all(input, count, output, comm);
+      return;
+    }
+
+    if (count * sizeof(V) <= static_cast<size_t>(::std::numeric_limits<int>::max())) {
+      MPI_Alltoall(const_cast<V *>(input), static_cast<int>(count * sizeof(V)), MPI_BYTE,
+                   output, static_cast<int>(count * sizeof(V)), MPI_BYTE, comm);
+      return;
+    }
+
+    MPI_Datatype dt;
+    MPI_Type_contiguous(static_cast<int>(sizeof(V)), MPI_BYTE, &dt);
+    MPI_Type_commit(&dt);
+    MPI_Alltoall(const_cast<V *>(input), static_cast<int>(count), dt, output, static_cast<int>(count), dt, comm);
+    MPI_Type_free(&dt);
+  }
+
+} // namespace imxx
+
+#endif /* SRC_IO_BYTE_TRANSPORT_HPP_ */
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    comm_schedule.hpp
+ * @ingroup
+ * @brief   order of the pairwise exchange steps in imxx, by node topology and measured bandwidth.
+ * @details the point to point exchanges in imxx (distribute_consume, the chunked large_all2allv, the pipelined
+ *          scatter_compute_gather, and block_all2all when a schedule is installed) go through p steps.  in step i, a rank
+ *          sends to dst(i) and receives from src(i), and dst(i) receives from it in its own step i.  by default,
+ *          dst(i) = rank + i, which on a multi-core node makes the ranks of a node send to several nodes at once, and
+ *          several nodes send to the same node.
+ *
+ *          the node aware schedule makes each step a permutation of the nodes:  in the step for node shift s and
+ *          local shift t, the ranks of node n send to local rank l + t of node n + s, so each node sends to and
+ *          receives from exactly one node, and each NIC carries ppn messages in each direction.  the intra node
+ *          steps (s = 0) come first.  given a node bandwidth matrix (measured by bliss::mxx::node_bandwidth_matrix,
+ *          or read from a file), the node shifts are ordered by their slowest node pair, fastest first, so that the
+ *          congested shifts are done together at the end instead of delaying the uncongested ones.
+ *
+ *          nodes are numbered by their lowest global rank.  the node aware schedule needs the same number of ranks
+ *          per node, otherwise it is the rank shift schedule.
+ *
+ *          a schedule is installed for a communicator with comm_scheduler::instance().install(comm, schedule), once,
+ *          and used by all later exchanges on it.  it has to be installed on all ranks.
+ */
+#ifndef SRC_IO_COMM_SCHEDULE_HPP_
+#define SRC_IO_COMM_SCHEDULE_HPP_
+
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+#include <limits>
+#include <numeric>   // iota
+#include <algorithm>
+#include <stdexcept>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+namespace imxx
+{
+
+  /// the peers of a rank in each of the p steps.  step 0 is the rank itself.
+  class pairwise_schedule {
+    protected:
+      int p;
+      int rank;
+      /// empty for the rank shift schedule.
+      ::std::vector<int> to;
+      ::std::vector<int> from;
+
+    public:
+      /// rank shift schedule.
+      explicit pairwise_schedule(::mxx::comm const & comm) : p(comm.size()), rank(comm.rank()) {}
+
+      int size() const { return p; }
+      bool is_rank_shift() const { return to.empty(); }
+
+      /// rank to send to in step i.
+      int dst(int const & i) const { return to.empty() ? (rank + i) % p : to[i]; }
+      /// rank to receive from in step i.
+      int src(int const & i) const { return from.empty() ? (rank + p - i) % p : from[i]; }
+
+      /**
+       * @brief  node aware schedule.  collective.
+       * @param node_bw   node_count x node_count bandwidths, row major, the same on all ranks.  empty to keep the
+       *                  node shifts in order.
+       */
+      static pairwise_schedule node_aware(::mxx::comm const & comm, ::std::vector<double> const & node_bw = ::std::vector<double>()) {
+        if (comm.size() < 2) return pairwise_schedule(comm);
+
+        // node of each rank, as the lowest global rank on the node.
+        MPI_Comm shared;
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.rank(), MPI_INFO_NULL, &shared);
+        int leader = comm.rank();
+        MPI_Allreduce(MPI_IN_PLACE, &leader, 1, MPI_INT, MPI_MIN, shared);
+        MPI_Comm_free(&shared);
+
+        return for_nodes(comm, ::mxx::allgather(leader, comm), node_bw);
+      }
+
+      /**
+       * @brief  node aware schedule for a given node layout.  not collective.
+       * @param leaders   for each rank, the lowest global rank of its node.  the same on all ranks.
+       */
+      static pairwise_schedule for_nodes(::mxx::comm const & comm, ::std::vector<int> const & leaders,
+                                         ::std::vector<double> const & node_bw = ::std::vector<double>()) {
+        pairwise_schedule sched(comm);
+        int p = comm.size();
+        if ((p < 2) || (leaders.size() != static_cast<size_t>(p))) return sched;
+
+        // node index, and local index by global rank.
+        ::std::vector<int> node_of(p, -1), local_of(p, 0);
+        ::std::vector<::std::vector<int> > nodes;
+        ::std::map<int, int> node_ids;
+        for (int r = 0; r < p; ++r) {
+          auto it = node_ids.find(leaders[r]);
+          if (it == node_ids.end()) {
+            it = node_ids.insert(::std::make_pair(leaders[r], static_cast<int>(nodes.size()))).first;
+            nodes.emplace_back();
+          }
+          node_of[r] = it->second;
+          local_of[r] = nodes[it->second].size();
+          nodes[it->second].push_back(r);
+        }
+        int nn = nodes.size();
+        int ppn = nodes[0].size();
+        for (auto const & n : nodes)
+          if (static_cast<int>(n.size()) != ppn) return sched;   // uneven.  all ranks see the same.
+        if ((nn < 2) || (ppn < 2)) return sched;
+
+        // node shifts, ordered by their slowest node pair.
+        ::std::vector<int> shifts(nn - 1);
+        ::std::iota(shifts.begin(), shifts.end(), 1);
+        if (node_bw.size() == static_cast<size_t>(nn) * nn) {
+          ::std::vector<double> slowest(nn, ::std::numeric_limits<double>::max());
+          for (int s = 1; s < nn; ++s)
+            for (int n = 0; n < nn; ++n)
+              slowest[s] = ::std::min(slowest[s], node_bw[n * nn + (n + s) % nn]);
+          ::std::stable_sort(shifts.begin(), shifts.end(), [&slowest](int const & x, int const & y) {
+            return slowest[x] > slowest[y];
+          });
+        }
+        shifts.insert(shifts.begin(), 0);
+
+        int n = node_of[comm.rank()];
+        int l = local_of[comm.rank()];
+        sched.to.clear();
+        sched.from.clear();
+        sched.to.reserve(p);
+        sched.from.reserve(p);
+        for (int s : shifts) {
+          for (int t = 0; t < ppn; ++t) {
+            sched.to.push_back(nodes[(n + s) % nn][(l + t) % ppn]);
+            sched.from.push_back(nodes[(n + nn - s) % nn][(l + ppn - t) % ppn]);
+          }
+        }
+        return sched;
+      }
+  };
+
+
+  /// schedules installed per communicator.  the same on all ranks.
+  class comm_scheduler {
+    protected:
+      ::std::map<MPI_Comm, pairwise_schedule> schedules;
+
+    public:
+      static comm_scheduler & instance() {
+        static comm_scheduler s;
+        return s;
+      }
+
+      void install(::mxx::comm const & comm, pairwise_schedule const & sched) {
+        auto it = schedules.find(static_cast<MPI_Comm>(comm));
+        if (it == schedules.end()) schedules.insert(::std::make_pair(static_cast<MPI_Comm>(comm), sched));
+        else it->second = sched;
+      }
+
+      void remove(::mxx::comm const & comm) { schedules.erase(static_cast<MPI_Comm>(comm)); }
+
+      /// whether a schedule other than the rank shift is installed for comm.
+      bool installed(::mxx::comm const & comm) const {
+        auto it = schedules.find(static_cast<MPI_Comm>(comm));
+        return (it != schedules.end()) && (it->second.size() == comm.size()) && !(it->second.is_rank_shift());
+      }
+
+      /// installed schedule of comm, or the rank shift.  a handle reused by a communicator of another size gets the rank shift.
+      pairwise_schedule get(::mxx::comm const & comm) const {
+        auto it = schedules.find(static_cast<MPI_Comm>(comm));
+        if ((it == schedules.end()) || (it->second.size() != comm.size())) return pairwise_schedule(comm);
+        return it->second;
+      }
+  };
+
+
+  /**
+   * @brief  read a node bandwidth matrix:  node_count, then node_count x node_count values, white space separated.
+   * @details  read on rank 0 and broadcast.  collective.  empty if the file cannot be read.
+   */
+  inline ::std::vector<double> read_node_bandwidth(::std::string const & filename, ::mxx::comm const & comm) {
+    ::std::vector<double> bw;
+    size_t count = 0;
+    if (comm.rank() == 0) {
+      ::std::ifstream ifs(filename);
+      size_t nn = 0;
+      if (ifs >> nn) {
+        bw.resize(nn * nn);
+        for (size_t i = 0; i < bw.size(); ++i)
+          if (!(ifs >> bw[i])) { bw.clear(); break; }
+      }
+      count = bw.size();
+    }
+    MPI_Bcast(&count, 1, MPI_UNSIGNED_LONG, 0, comm);
+    bw.resize(count);
+    if (count > 0) MPI_Bcast(bw.data(), static_cast<int>(count), MPI_DOUBLE, 0, comm);
+    return bw;
+  }
+
+} // namespace imxx
+
+#endif /* SRC_IO_COMM_SCHEDULE_HPP_ */
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    comm_stats.hpp
+ * @ingroup
+ * @brief   communication volume counters for the imxx distribute and undistribute calls.
+ * @details the all2allv of each imxx phase ("imxx:distribute", "imxx:undistribute", ...) adds its send and receive
+ *          counts, in bytes and in non-empty messages to other ranks, and the time spent in the all2allv, to a
+ *          per process accumulator.  counting is off by default, and costs a pass over the count arrays when on.
+ *
+ *          report(comm) is collective and prints, per phase, the min/max/mean over ranks of the bytes sent and received,
+ *          the imbalance (max / mean of the bytes received), messages, and bandwidth (bytes sent / all2allv time).
+ */
+#ifndef SRC_IO_COMM_STATS_HPP_
+#define SRC_IO_COMM_STATS_HPP_
+
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <iterator>   // ostream_iterator
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace imxx
+{
+
+  /// accumulated communication of 1 phase on 1 rank.
+  struct comm_volume {
+      size_t calls;
+      size_t bytes_sent;
+      size_t bytes_recv;
+      size_t msgs_sent;
+      size_t msgs_recv;
+      double seconds;
+
+      comm_volume() : calls(0), bytes_sent(0), bytes_recv(0), msgs_sent(0), msgs_recv(0), seconds(0.0) {}
+
+      /// bytes sent per second of all2allv.
+      double bandwidth() const { return (seconds > 0.0) ? static_cast<double>(bytes_sent) / seconds : 0.0; }
+  };
+
+  /// per process communication counters, by phase.
+  class comm_stats {
+    protected:
+      std::map<std::string, comm_volume> phases;
+      bool on;
+
+    public:
+      comm_stats() : on(false) {}
+
+      static comm_stats & instance() {
+        static comm_stats stats;
+        return stats;
+      }
+
+      /// enable or disable counting.  should be the same on all ranks, since report is collective.
+      void enable(bool const & e = true) { on = e; }
+      bool enabled() const { return on; }
+
+      void reset() { phases.clear(); }
+
+      std::map<std::string, comm_volume> const & get_phases() const { return phases; }
+
+      comm_volume get(std::string const & phase) const {
+        auto it = phases.find(phase);
+        return (it == phases.end()) ? comm_volume() : it->second;
+      }
+
+      /// add 1 all2allv, with counts in elements of elem_bytes each.  messages to self are not counted.
+      template <typename SIZE1, typename SIZE2>
+      void add(std::string const & phase, std::vector<SIZE1> const & send_counts, std::vector<SIZE2> const & recv_counts,
+               size_t const & elem_bytes, int const & rank, double const & seconds) {
+        if (!on) return;
+        comm_volume & v = phases[phase];
+        ++v.calls;
+        for (size_t i = 0; i < send_counts.size(); ++i) {
+          v.bytes_sent += send_counts[i] * elem_bytes;
+          v.msgs_sent += ((static_cast<int>(i) != rank) && (send_counts[i] > 0)) ? 1 : 0;
+        }
+        for (size_t i = 0; i < recv_counts.size(); ++i) {
+          v.bytes_recv += recv_counts[i] * elem_bytes;
+          v.msgs_recv += ((static_cast<int>(i) != rank) && (recv_counts[i] > 0)) ? 1 : 0;
+        }
+        v.seconds += seconds;
+      }
+
+      /// print the counters, reduced over ranks, from rank 0.  collective.
+      void report(::mxx::comm const & comm) const {
+        if (!on) return;
+
+        // phases may differ if counting was not enabled everywhere at the same time.
+        size_t n = phases.size();
+        size_t max_n = ::mxx::allreduce(n, [](size_t const & x, size_t const & y) { return ::std::max(x, y); }, comm);
+        size_t min_n = ::mxx::allreduce(n, [](size_t const & x, size_t const & y) { return ::std::min(x, y); }, comm);
+        if (min_n != max_n) {
+          if (comm.rank() == 0) fprintf(stderr, "WARNING: imxx comm_stats phases differ between ranks.  not reporting.\n");
+          return;
+        }
+        if (n == 0) return;
+
+        std::vector<std::string> names;
+        std::vector<double> sent, recv, msgs, secs, calls;
+        for (auto const & ph : phases) {
+          names.emplace_back(ph.first);
+          sent.emplace_back(static_cast<double>(ph.second.bytes_sent));
+          recv.emplace_back(static_cast<double>(ph.second.bytes_recv));
+          msgs.emplace_back(static_cast<double>(ph.second.msgs_sent));
+          secs.emplace_back(ph.second.seconds);
+          calls.emplace_back(static_cast<double>(ph.second.calls));
+        }
+
+        auto mn = [](double const & x, double const & y) { return ::std::min(x, y); };
+        auto mx = [](double const & x, double const & y) { return ::std::max(x, y); };
+        std::vector<double> sent_min = ::mxx::reduce(sent, 0, mn, comm);
+        std::vector<double> sent_max = ::mxx::reduce(sent, 0, mx, comm);
+        std::vector<double> sent_sum = ::mxx::reduce(sent, 0, ::std::plus<double>(), comm);
+        std::vector<double> recv_min = ::mxx::reduce(recv, 0, mn, comm);
+        std::vector<double> recv_max = ::mxx::reduce(recv, 0, mx, comm);
+        std::vector<double> recv_sum = ::mxx::reduce(recv, 0, ::std::plus<double>(), comm);
+        std::vector<double> msgs_sum = ::mxx::reduce(msgs, 0, ::std::plus<double>(), comm);
+        std::vector<double> secs_max = ::mxx::reduce(secs, 0, mx, comm);
+
+        if (comm.rank() == 0) {
+          double p = comm.size();
+          auto BtoMB = [](double const & x) { return x / (1024.0 * 1024.0); };
+
+          std::stringstream output;
+          std::ostream_iterator<std::string> nit(output, ",");
+          std::ostream_iterator<double> dit(output, ",");
+
+          output << std::fixed;
+          output << "[COMM] " << "R 0/" << comm.size() << std::endl;
+          output << "[COMM] imxx\theader (MB)\t[,";
+          std::copy(names.begin(), names.end(), nit);
+          output << "]" << std::endl;
+
+          output.precision(0);
+          output << "[COMM] imxx\tcalls\t[,";
+          std::copy(calls.begin(), calls.end(), dit);
+          output << "]" << std::endl;
+
+          output.precision(3);
+          output << "[COMM] imxx\tsent_min\t[,";
+          std::transform(sent_min.begin(), sent_min.end(), dit, BtoMB);
+          output << "]" << std::endl;
+          output << "[COMM] imxx\tsent_max\t[,";
+          std::transform(sent_max.begin(), sent_max.end(), dit, BtoMB);
+          output << "]" << std::endl;
+          output << "[COMM] imxx\tsent_mean\t[,";
+          std::transform(sent_sum.begin(), sent_sum.end(), dit, [&p](double const & x) { return x / (p * 1024.0 * 1024.0); });
+          output << "]" << std::endl;
+
+          output << "[COMM] imxx\trecv_min\t[,";
+          std::transform(recv_min.begin(), recv_min.end(), dit, BtoMB);
+          output << "]" << std::endl;
+          output << "[COMM] imxx\trecv_max\t[,";
+          std::transform(recv_max.begin(), recv_max.end(), dit, BtoMB);
+          output << "]" << std::endl;
+          output << "[COMM] imxx\trecv_mean\t[,";
+          std::transform(recv_sum.begin(), recv_sum.end(), dit, [&p](double const & x) { return x / (p * 1024.0 * 1024.0); });
+          output << "]" << std::endl;
+
+          // max / mean of the received bytes.  1 is perfectly balanced.
+          output << "[COMM] imxx\trecv_imbalance\t[,";
+          std::transform(recv_max.begin(), recv_max.end(), recv_sum.begin(), dit,
+                         [&p](double const & x, double const & y) { return (y > 0) ? x * p / y : 1.0; });
+          output << "]" << std::endl;
+
+          output << "[COMM] imxx\tmsgs_mean\t[,";
+          std::transform(msgs_sum.begin(), msgs_sum.end(), dit, [&p](double const & x) { return x / p; });
+          output << "]" << std::endl;
+
+          // aggregate bandwidth, limited by the slowest rank.
+          output << "[COMM] imxx\tbw (MB/s)\t[,";
+          std::transform(sent_sum.begin(), sent_sum.end(), secs_max.begin(), dit,
+                         [](double const & x, double const & y) { return (y > 0) ? x / (y * 1024.0 * 1024.0) : 0.0; });
+          output << "]";
+
+          fflush(stdout);
+          printf("%s\n", output.str().c_str());
+          fflush(stdout);
+        }
+        comm.barrier();
+      }
+  };
+
+  /// times 1 all2allv and adds its counts to comm_stats.  does nothing when counting is off.
+  class comm_stats_scope {
+    protected:
+      char const * phase;
+      std::chrono::steady_clock::time_point t1;
+      bool on;
+
+    public:
+      explicit comm_stats_scope(char const * _phase) : phase(_phase), on(comm_stats::instance().enabled()) {
+        if (on) t1 = std::chrono::steady_clock::now();
+      }
+
+      template <typename SIZE1, typename SIZE2>
+      void done(std::vector<SIZE1> const & send_counts, std::vector<SIZE2> const & recv_counts,
+                size_t const & elem_bytes, ::mxx::comm const & comm) {
+        if (!on) return;
+        double secs = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - t1).count();
+        comm_stats::instance().add(phase, send_counts, recv_counts, elem_bytes, comm.rank(), secs);
+      }
+  };
+
+} // namespace imxx
+
+#endif /* SRC_IO_COMM_STATS_HPP_ */
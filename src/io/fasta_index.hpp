@@ -0,0 +1,272 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * fasta_index.hpp
+ *
+ * @brief  sidecar index of the FASTA record offsets, so that repeated reads of the same FASTA file do not need to search for headers.
+ * @details  similar to samtools' .fai, but stores FASTAParser's sequence offsets, i.e. (record start, sequence start, sequence end, record id)
+ *    for every record.  With the index, any partition can be initialized for parsing locally,
+ *    without the distributed header search and its communication.
+ *
+ *    The index is stored next to the FASTA file as <filename>.bidx.  binary format, all fields uint64_t in native byte order:
+ *      magic, version, FASTA file size, number of records, then 4 fields per record.
+ *    The FASTA file size is checked on load, so an index for a modified file is ignored.
+ */
+
+#ifndef FASTA_INDEX_HPP_
+#define FASTA_INDEX_HPP_
+
+#include "bliss-config.hpp"
+
+#include <cstdio>       // fopen, fread, fwrite
+#include <cstdint>      // uint64_t
+#include <cstring>      // strerror
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <sstream>      // stringstream
+#include <algorithm>    // sort, unique
+#include <type_traits>  // is_same
+#include <limits>       // numeric_limits
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#endif
+
+#include <io/io_exception.hpp>
+#include <io/fasta_loader.hpp>
+#include <utils/exception_handling.hpp>
+
+
+namespace bliss {
+
+namespace io {
+
+/**
+ * @brief sidecar index of FASTA sequence offsets.  read and write functions only.
+ */
+struct fasta_index {
+
+    /// entry type. same as FASTAParser's: record start, sequence start, sequence end, and record id.
+    using entry_type = ::std::tuple<size_t, size_t, size_t, size_t>;
+
+    static_assert(::std::is_same<entry_type,
+                  typename ::bliss::io::FASTAParser<unsigned char const *>::SequenceOffsetsType>::value,
+                  "ERROR: fasta_index entry type does not match FASTAParser sequence offsets type.");
+
+    /// identifies the file type.  "BLISSIDX" as a little endian uint64_t
+    static constexpr uint64_t magic = 0x5844495353494C42UL;
+    /// format version.
+    static constexpr uint64_t version = 1UL;
+    /// number of uint64_t fields in the header and per entry
+    static constexpr size_t header_fields = 4UL;
+    static constexpr size_t entry_fields = 4UL;
+
+    /// get the index file name for a FASTA file.
+    static ::std::string get_index_filename(::std::string const & filename) {
+      return filename + ".bidx";
+    }
+
+    /**
+     * @brief load the index of a FASTA file.
+     * @param filename     name of the FASTA file (not the index)
+     * @param file_size    size of the FASTA file. used to check that the index is current.
+     * @param entries[out] sequence offsets for all records in the file, in file order.
+     * @return  true if the index was loaded.  false if there is no index, or it is for a different file size or version.
+     */
+    static bool read(::std::string const & filename, size_t const & file_size, ::std::vector<entry_type> & entries) {
+      entries.clear();
+
+      FILE * fp = fopen(get_index_filename(filename).c_str(), "rb");
+      if (fp == nullptr) return false;
+
+      uint64_t header[header_fields];
+      bool ok = (fread(header, sizeof(uint64_t), header_fields, fp) == header_fields) &&
+          (header[0] == magic) && (header[1] == version) && (header[2] == file_size);
+
+      if (ok) {
+        ::std::vector<uint64_t> fields(header[3] * entry_fields);
+        ok = (fread(fields.data(), sizeof(uint64_t), fields.size(), fp) == fields.size());
+
+        if (ok) {
+          entries.reserve(header[3]);
+          for (size_t i = 0; i < fields.size(); i += entry_fields) {
+            entries.emplace_back(fields[i], fields[i + 1], fields[i + 2], fields[i + 3]);
+          }
+        }
+      }
+      fclose(fp);
+
+      if (!ok) {
+        BL_WARNING("WARNING: fasta_index for " << filename << " is stale or corrupt.  ignored.");
+      }
+      return ok;
+    }
+
+    /**
+     * @brief save the index of a FASTA file.  written to a temporary file then renamed, so readers never see a partial index.
+     * @param filename     name of the FASTA file (not the index)
+     * @param file_size    size of the FASTA file.
+     * @param entries      sequence offsets for all records in the file.  sorted and deduplicated by record start.
+     */
+    static void write(::std::string const & filename, size_t const & file_size, ::std::vector<entry_type> const & entries) {
+      ::std::string index_filename = get_index_filename(filename);
+      ::std::string tmp_filename = index_filename + ".tmp";
+
+      ::std::vector<uint64_t> fields;
+      fields.reserve(header_fields + entries.size() * entry_fields);
+      fields.push_back(static_cast<uint64_t>(magic));
+      fields.push_back(static_cast<uint64_t>(version));
+      fields.push_back(file_size);
+      fields.push_back(entries.size());
+      for (auto const & e : entries) {
+        fields.push_back(::std::get<0>(e));
+        fields.push_back(::std::get<1>(e));
+        fields.push_back(::std::get<2>(e));
+        fields.push_back(::std::get<3>(e));
+      }
+
+      FILE * fp = fopen(tmp_filename.c_str(), "wb");
+      bool ok = (fp != nullptr);
+      if (ok) {
+        ok = (fwrite(fields.data(), sizeof(uint64_t), fields.size(), fp) == fields.size());
+        ok &= (fclose(fp) == 0);
+      }
+      if (ok) ok = (rename(tmp_filename.c_str(), index_filename.c_str()) == 0);
+
+      if (!ok) {
+        int myerr = errno;
+        remove(tmp_filename.c_str());
+
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::fasta_index::write: ["  << index_filename << "] " << myerr << ": " << strerror(myerr);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+    }
+
+#if defined(USE_MPI)
+    /**
+     * @brief load the index of a FASTA file.  collective.  rank 0 reads the index and broadcasts.
+     * @return  true on all processes if the index was loaded.
+     */
+    static bool read(::std::string const & filename, size_t const & file_size, ::std::vector<entry_type> & entries,
+                     ::mxx::comm const & comm) {
+      if (comm.size() == 1) return read(filename, file_size, entries);
+
+      // flatten to send.
+      ::std::vector<size_t> fields;
+      size_t count = 0;
+      if (comm.rank() == 0) {
+        count = read(filename, file_size, entries) ? entries.size() : ::std::numeric_limits<size_t>::max();
+      }
+      MPI_Bcast(&count, 1, MPI_UNSIGNED_LONG, 0, comm);
+      if (count == ::std::numeric_limits<size_t>::max()) {
+        entries.clear();
+        return false;
+      }
+
+      if (comm.rank() == 0) {
+        fields.reserve(count * entry_fields);
+        for (auto const & e : entries) {
+          fields.push_back(::std::get<0>(e));
+          fields.push_back(::std::get<1>(e));
+          fields.push_back(::std::get<2>(e));
+          fields.push_back(::std::get<3>(e));
+        }
+      } else {
+        fields.resize(count * entry_fields);
+      }
+      if (count > 0) MPI_Bcast(fields.data(), fields.size(), MPI_UNSIGNED_LONG, 0, comm);
+
+      if (comm.rank() > 0) {
+        entries.clear();
+        entries.reserve(count);
+        for (size_t i = 0; i < fields.size(); i += entry_fields) {
+          entries.emplace_back(fields[i], fields[i + 1], fields[i + 2], fields[i + 3]);
+        }
+      }
+      return true;
+    }
+
+    /**
+     * @brief save the index of a FASTA file from the distributed sequence offsets.  collective.
+     * @details  the local offsets, e.g. from FASTAParser's distributed init_parser, are gathered to rank 0, which writes the file.
+     *           a record that spans partitions appears on multiple processes, so the entries are deduplicated by record start.
+     *           record ids are reassigned in file order, so the index is the same for any number of processes.
+     *           best effort:  the index is only an optimization, so a failure, e.g. in a read only directory, is reported
+     *           with a warning on rank 0 and the caller continues without it.
+     * @param local_entries   sequence offsets on the current process.
+     * @return  true on all processes if the index was written.
+     */
+    static bool write(::std::string const & filename, size_t const & file_size, ::std::vector<entry_type> const & local_entries,
+                      ::mxx::comm const & comm) {
+      // flatten to send.
+      ::std::vector<size_t> fields;
+      fields.reserve(local_entries.size() * entry_fields);
+      for (auto const & e : local_entries) {
+        fields.push_back(::std::get<0>(e));
+        fields.push_back(::std::get<1>(e));
+        fields.push_back(::std::get<2>(e));
+        fields.push_back(::std::get<3>(e));
+      }
+      fields = ::mxx::gatherv(fields, 0, comm);
+
+      int ok = 1;
+      ::std::string message;
+      if (comm.rank() == 0) {
+        ::std::vector<entry_type> entries;
+        entries.reserve(fields.size() / entry_fields);
+        for (size_t i = 0; i < fields.size(); i += entry_fields) {
+          entries.emplace_back(fields[i], fields[i + 1], fields[i + 2], fields[i + 3]);
+        }
+        ::std::sort(entries.begin(), entries.end());
+        entries.erase(::std::unique(entries.begin(), entries.end(), [](entry_type const & x, entry_type const & y){
+          return ::std::get<0>(x) == ::std::get<0>(y);
+        }), entries.end());
+
+        // distributed record ids depend on the partitioning, so renumber in file order.
+        for (size_t i = 0; i < entries.size(); ++i) {
+          ::std::get<3>(entries[i]) = i;
+        }
+
+        try {
+          write(filename, file_size, entries);
+        } catch (::bliss::io::IOException & e) {
+          ok = 0;
+          message = e.what();
+        }
+      }
+
+      // all processes learn if rank 0 could not write.
+      MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+      if ((ok == 0) && (comm.rank() == 0)) {
+        BL_WARNING("WARNING: FASTA index not written, continuing without it. " << message);
+      }
+      return ok != 0;
+    }
+#endif
+
+};
+
+} // io
+
+} // bliss
+
+#endif /* FASTA_INDEX_HPP_ */
@@ -96,7 +96,6 @@ namespace bliss
         using SequenceIdType = typename SequenceType::IdType;
 
 
-      protected:
         /**
          * @typedef RangeType
          * @brief   range object types
@@ -108,6 +107,8 @@ namespace bliss
          */
         using SequenceOffsetsType = ::std::tuple<typename RangeType::ValueType, typename RangeType::ValueType, typename RangeType::ValueType, size_t >;
         using SequenceVecType = std::vector<SequenceOffsetsType >;
+
+      protected:
         /**
          * @brief internal storage marking each sequence.
          */
@@ -182,6 +183,41 @@ namespace bliss
           sequences.clear();
         }
 
+        /// get the sequence offsets found by init_parser, e.g. to save as an index.  see fasta_index.
+        SequenceVecType const & get_sequence_offsets() const {
+          return sequences;
+        }
+
+        /**
+         * @brief   initialize from precomputed sequence offsets for the whole file, e.g. loaded from fasta_index, instead of searching the data.
+         * @note    NOT collective.  keeps the same entries as the distributed init_parser, i.e. the sequences with some part inside searchRange.
+         * @param[in]   all_sequences   sequence offsets for all records in the file, sorted by position.
+         */
+        size_t init_parser(const Iterator &_data, const RangeType &parentRange, const RangeType &inMemRange, const RangeType &searchRange,
+                           SequenceVecType const & all_sequences)
+        {
+          //== range checking
+          if(!parentRange.contains(inMemRange)) throw std::invalid_argument("ERROR: Parent Range does not contain inMemRange");
+
+          if (sequences.size() > 0) {
+            BL_WARNING("WARNING: fasta_parser init called without reset first.  previous records are cleared.");
+            sequences.clear();
+          }
+
+          RangeType r = RangeType::intersect(searchRange, parentRange);
+
+          // first sequence ending after r.start, then copy until sequence starts after r.end
+          auto it = std::upper_bound(all_sequences.begin(), all_sequences.end(),
+              r.start, [](size_t const & off, SequenceOffsetsType const & seq){
+                return off < ::std::get<2>(seq);
+              });
+          for (; (it != all_sequences.end()) && (std::get<1>(*it) < r.end); ++it) {
+            sequences.emplace_back(*it);
+          }
+
+          return RangeType::intersect(searchRange, inMemRange).start;
+        }
+
 
 #ifdef USE_MPI
 
@@ -296,17 +332,15 @@ namespace bliss
             }
 
             // now search for occurrences of '\n', since we've already handled the case where the first char is '>'
-            Iterator it2 = it;
-            ++it;
-            ++i;
+            // findChar jumps directly to the next '\n' (vectorized for contiguous memory).
             while (it != end) {
-              if (*it2 == '\n'){
-                // previous char is eol, so add the position here if it's not another eol, and encode it for header vs not
-                line_starts.emplace_back(i, ((*it == ';') || (*it == '>')) ? 1 : 0);
-              }
+              this->findChar(it, end, i, '\n');
+              if (it == end) break;
               ++it;
-              ++it2;
               ++i;
+              if (it == end) break;
+              // previous char is eol, so add the position here if it's not another eol, and encode it for header vs not
+              line_starts.emplace_back(i, ((*it == ';') || (*it == '>')) ? 1 : 0);
             }
             if (in_comm.rank() == (in_comm.size() - 1)) {
               // add a eof entry.
@@ -537,17 +571,15 @@ namespace bliss
             }
 
             // now search for occurrences of '\n', since we've already handled the case where the first char is '>'
-            Iterator it2 = it;
-            ++it;
-            ++i;
+            // findChar jumps directly to the next '\n' (vectorized for contiguous memory).
             while (it != end) {
-              if (*it2 == '\n'){
-                // previous char is eol, so add the position here if it's not another eol, and encode it for header vs not
-                line_starts.emplace_back(i, ((*it == ';') || (*it == '>')) ? 1 : 0);
-              }
+              this->findChar(it, end, i, '\n');
+              if (it == end) break;
               ++it;
-              ++it2;
               ++i;
+              if (it == end) break;
+              // previous char is eol, so add the position here if it's not another eol, and encode it for header vs not
+              line_starts.emplace_back(i, ((*it == ';') || (*it == '>')) ? 1 : 0);
             }
             // add a very last line to mark end of file.
             line_starts.emplace_back(parentRange.end, 1);
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    fasta_stream.hpp
+ * @ingroup io
+ * @brief   state carried from block to block when a FASTA file is read and parsed 1 block at a time.
+ * @details the blocks of a block_streaming_file of a FASTA file are plain byte ranges, so a sequence can span many
+ *          blocks.  2 things are needed to parse a block on its own:
+ *
+ *          1. the sequence offsets (record start, sequence start, sequence end, record id) of the sequences in the
+ *             block.  these are the same as in the sidecar fasta_index, and are loaded from it, or found with
+ *             find_sequences, which reads the file 1 block at a time and keeps only the line type changes.
+ *          2. the last window - 1 bases of the sequence that continues into the block, i.e. the first bases of the
+ *             kmers that span the block start.  these are kept from the previous block, so the blocks do not
+ *             overlap.  a block that does not continue the previous one, e.g. the first block of a process or a block
+ *             of a block cyclic read, reads them from the file instead.
+ *
+ *          prepare prepends the carried bytes to a block and moves the block's start back to them, so the block can be
+ *          parsed with FASTAParser's init_parser from the sequence offsets, like a partition of read_file_indexed, and
+ *          each kmer of the file is generated exactly once, by the block that holds its last base.
+ */
+#ifndef SRC_IO_FASTA_STREAM_HPP_
+#define SRC_IO_FASTA_STREAM_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+#if defined(USE_MPI)
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#endif
+
+#include "io/file.hpp"
+#include "io/fasta_index.hpp"
+#include "utils/file_utils.hpp"   // NotEOL
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /// the sequence offsets and the carried bases of a FASTA file read 1 block at a time.  NOT thread safe.
+    class fasta_stream {
+      public:
+        using range_type = ::bliss::partition::range<size_t>;
+        using entry_type = ::bliss::io::fasta_index::entry_type;
+        using container = ::bliss::io::file_data::container;
+
+      protected:
+        /// sequence offsets of the whole file, sorted by position.
+        ::std::vector<entry_type> entries;
+
+        /// kmer size.  the kmers that start in the last window - 1 bases of a block end in the next block.
+        size_t window;
+
+        /// raw bytes at the end of the previous block, from the first base of its last incomplete kmer.  EOLs included.
+        container carry;
+
+        /// file range of carry.  carry_range.end is where the previous block ended.
+        range_type carry_range;
+
+        /// first entry whose sequence ends after pos, i.e. pos is in its header or its sequence, or entries.end().
+        typename ::std::vector<entry_type>::const_iterator find(size_t const & pos) const {
+          return ::std::upper_bound(entries.begin(), entries.end(), pos,
+              [](size_t const & off, entry_type const & seq){ return off < ::std::get<2>(seq); });
+        }
+
+        /**
+         * @brief  start of the last window - 1 bases in data before range.end, not before seq_start.
+         * @return  the start, and whether it is final, i.e. enough bases were found or the search reached seq_start.
+         */
+        ::std::pair<size_t, bool> tail_start(unsigned char const * data, range_type const & range, size_t const & seq_start) const {
+          ::bliss::utils::file::NotEOL not_eol;
+          size_t first = ::std::max(range.start, seq_start);
+          size_t pos = range.end;
+          size_t count = 0;
+          while ((count + 1 < window) && (pos > first)) {
+            --pos;
+            if (not_eol(data[pos - range.start])) ++count;
+          }
+          return ::std::make_pair(pos, (count + 1 >= window) || (pos <= seq_start));
+        }
+
+        /// sequence start if pos is inside the data of a sequence that continues at pos, else max size_t.
+        size_t continued_sequence(size_t const & pos) const {
+          if (pos == 0) return ::std::numeric_limits<size_t>::max();
+          auto it = find(pos - 1);
+          if ((it == entries.end()) || (::std::get<1>(*it) >= pos) || (::std::get<2>(*it) <= pos)) return ::std::numeric_limits<size_t>::max();
+          return ::std::get<1>(*it);
+        }
+
+        /// read the bases before pos that start the kmers spanning pos, into carry.
+        template <typename ReadFunc>
+        void seed(size_t const & pos, ReadFunc & read) {
+          carry.clear();
+          carry_range = range_type(pos, pos);
+
+          size_t seq_start = continued_sequence(pos);
+          if (seq_start == ::std::numeric_limits<size_t>::max()) return;
+
+          // EOLs are interleaved with the bases, so read more until window - 1 bases are found.
+          size_t bytes = 2 * window;
+          ::std::pair<size_t, bool> t;
+          range_type r;
+          while (true) {
+            r = range_type(::std::max(seq_start, pos - ::std::min(pos, bytes)), pos);
+            r = read(carry, r);
+            t = tail_start(carry.data(), r, seq_start);
+            if (t.second || (r.start <= seq_start)) break;
+            bytes <<= 1;
+          }
+          carry.erase(carry.begin(), carry.begin() + (t.first - r.start));
+          carry_range.start = t.first;
+        }
+
+      public:
+        /**
+         * @param _entries   sequence offsets of the whole file, e.g. from fasta_index::read or find_sequences.
+         * @param _window    kmer size.
+         */
+        fasta_stream(::std::vector<entry_type> const & _entries, size_t const & _window) :
+          entries(_entries), window(::std::max(_window, static_cast<size_t>(1))),
+          carry_range(::std::numeric_limits<size_t>::max(), ::std::numeric_limits<size_t>::max()) {}
+
+        /// sequence offsets of the whole file, for FASTAParser's init_parser.
+        ::std::vector<entry_type> const & get_sequence_offsets() const { return entries; }
+
+        /// file range of the bytes carried to the next block.
+        range_type const & get_carried_range() const { return carry_range; }
+
+        /// forget the carried bytes.  the next block reads them from the file.
+        void reset() {
+          carry.clear();
+          carry_range = range_type(::std::numeric_limits<size_t>::max(), ::std::numeric_limits<size_t>::max());
+        }
+
+        /**
+         * @brief  prepend to block the first bases of the kmers that span its start, then keep the last bases of block for the next one.
+         * @details  if block does not start where the previous block ended, the bytes are read with read.
+         *          block's in memory, valid and parent ranges start at the prepended bytes afterwards.
+         * @param block   a block of the file, e.g. from block_streaming_file::read_next_block, with in memory == valid range.
+         * @param read    functor range_type(container & out, range_type const & r) that reads r of the file into out.
+         */
+        template <typename ReadFunc>
+        void prepare(::bliss::io::file_data & block, ReadFunc && read) {
+          if (block.valid_range_bytes.size() == 0) return;
+
+          if (carry_range.end != block.valid_range_bytes.start) seed(block.valid_range_bytes.start, read);
+
+          if (carry.size() > 0) {
+            block.data.insert(block.data.begin(), carry.begin(), carry.end());
+            block.in_mem_range_bytes.start = carry_range.start;
+            block.valid_range_bytes.start = carry_range.start;
+            block.parent_range_bytes.start = ::std::min(block.parent_range_bytes.start, carry_range.start);
+          }
+
+          // keep the tail, if the last sequence continues into the next block.
+          size_t end = block.in_mem_range_bytes.end;
+          size_t seq_start = continued_sequence(end);
+          size_t start = (seq_start == ::std::numeric_limits<size_t>::max()) ? end :
+              tail_start(block.data.data(), block.in_mem_range_bytes, seq_start).first;
+
+          carry.assign(block.data.begin() + (start - block.in_mem_range_bytes.start), block.data.end());
+          carry_range = range_type(start, end);
+        }
+
+
+#if defined(USE_MPI)
+        /**
+         * @brief  find the sequence offsets of the whole file by reading each process's blocks once.  collective.
+         * @details  same entries as the sidecar fasta_index, record ids from 0 in file order.  only the positions where
+         *          the line type changes between header and sequence are kept and gathered, 2 per record.
+         *          fobj is reset afterwards.
+         * @tparam StreamingFile  block_streaming_file or prefetching_block_streaming_file of the FASTA file.
+         */
+        template <typename StreamingFile>
+        static ::std::vector<entry_type> find_sequences(StreamingFile & fobj, ::mxx::comm const & comm) {
+          // line start, and 1 for header or 0 for sequence, as in FASTAParser's init_parser.
+          using LL = ::std::pair<size_t, uint8_t>;
+          ::std::vector<LL> line_starts;
+
+          ::bliss::io::file_data block;
+          container prev;
+          size_t prev_end = ::std::numeric_limits<size_t>::max();
+          unsigned char prev_char = '\n';
+          uint8_t last_type = 2;    // none
+
+          while (fobj.has_next_block()) {
+            fobj.read_next_block(block);
+            range_type r = block.getRange();
+            if (r.size() == 0) continue;
+
+            // the character before the block, if it does not continue the previous one.
+            if (r.start != prev_end) {
+              last_type = 2;
+              prev_char = '\n';
+              if (r.start > 0) {
+                fobj.read_file_range(prev, range_type(r.start - 1, r.start));
+                if (prev.size() > 0) prev_char = prev[0];
+              }
+            }
+
+            unsigned char const * data = block.data.data();
+            for (size_t i = 0; i < r.size(); ++i) {
+              if (prev_char == '\n') {
+                uint8_t type = ((data[i] == ';') || (data[i] == '>')) ? 1 : 0;
+                // keep only the first of consecutive lines of the same type.
+                if (type != last_type) line_starts.emplace_back(r.start + i, type);
+                last_type = type;
+              }
+              prev_char = data[i];
+            }
+            prev_end = r.end;
+          }
+          fobj.reset();
+
+          // the runs of the processes may continue each other, so sort and keep the first of each run again.
+          line_starts = ::mxx::allgatherv(line_starts, comm);
+          ::std::sort(line_starts.begin(), line_starts.end());
+          line_starts.erase(::std::unique(line_starts.begin(), line_starts.end(), [](LL const & x, LL const & y) {
+            return x.second == y.second;
+          }), line_starts.end());
+          // end of file.
+          line_starts.emplace_back(fobj.size(), 1);
+
+          // header start, sequence start, and sequence end (next header start), as in FASTAParser's init_parser.
+          ::std::vector<entry_type> result;
+          size_t k = 0;
+          if (line_starts[k].second == 0) ++k;
+          if (k >= line_starts.size()) return result;
+          size_t pos = line_starts[k].first;
+          ++k;
+          for (size_t id = 0; (k + 1) < line_starts.size(); k += 2, ++id) {
+            result.emplace_back(pos, line_starts[k].first, line_starts[k + 1].first, id);
+            pos = line_starts[k + 1].first;
+          }
+          return result;
+        }
+#endif
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_FASTA_STREAM_HPP_ */
@@ -40,6 +40,7 @@
 
 #include <string>
 #include <cstring>      // memcpy, strerror
+#include <cstdlib>      // strtoul
 
 #include <ios>          // ios_base::failure
 #include <iostream>     // ios_base::failure
@@ -48,6 +49,9 @@
 #include <fcntl.h>      // for open64 and close
 #include <sstream>      // stringstream
 #include <exception>    // std exception
+#include <future>       // async, for prefetching
+#include <limits>       // numeric_limits
+#include <type_traits>  // is_same
 
 #if defined(USE_MPI)
 #include <mpi.h>
@@ -62,8 +66,12 @@
 #include <io/file_loader.hpp>
 #include <io/fastq_loader.hpp>
 #include <io/fasta_loader.hpp>
+#include <io/fasta_index.hpp>
+#include <io/kmer_balanced_partition.hpp>
 #include <io/unix_domain_socket.h>
 #include <partition/range.hpp>
+#include <partition/rank_weights.hpp>
+#include <utils/numa_node.hpp>
 
 #include <utils/exception_handling.hpp>
 
@@ -222,6 +230,20 @@ struct file_data {
 
 
 
+/**
+ * @brief flags for how mapped_data maps and places file data.  combine with |.
+ */
+struct map_policy {
+    /// MADV_SEQUENTIAL and MADV_WILLNEED only.
+    static constexpr unsigned int DEFAULT = 0;
+    /// huge pages.  MAP_HUGETLB if the file is on hugetlbfs, else transparent huge pages via MADV_HUGEPAGE, with the
+    /// mapping aligned to huge page boundary.  file backed THP needs kernel support (READ_ONLY_THP_FOR_FS), else no effect.
+    static constexpr unsigned int HUGEPAGE = 1;
+    /// prefer the NUMA node of the process for pages faulted in through the mapping (mbind MPOL_PREFERRED).  the node
+    /// set by affinity_manager::pin_ranks if pinned, else that of the calling thread.
+    static constexpr unsigned int LOCAL_NODE = 2;
+};
+
 /**
  * mmapped data.  wrapper for moving it around.
  */
@@ -238,17 +260,36 @@ class mapped_data {
 
     const size_t page_size;
 
+    /// bytes from the start of the mapping that have been released via release().
+    size_t released;
+
+    /// transparent huge page size.
+    static constexpr size_t huge_page_size = 2UL * 1024UL * 1024UL;
+
+    /// set the mapping's memory policy to prefer this process's NUMA node (the pinned rank's node, else the current one).
+    /// best effort - on failure, the default (first touch) policy applies.
+    void bind_to_local_node() {
+      int node = ::bliss::utils::preferred_numa_node();
+      if (node < 0) return;
+      if (!::bliss::utils::prefer_numa_node(data, range_bytes.size(), node)) {
+        BL_WARNING("WARNING: mbind to NUMA node " << node << " failed: " << strerror(errno));
+      }
+    }
+
   public:
 
+    /// default constructor.  empty mapping.
+    mapped_data() : data(nullptr), range_bytes(0, 0), page_size(sysconf(_SC_PAGE_SIZE)), released(0) {}
 
     /**
      * @brief   map the specified portion of the file to memory.
      * @note    AGNOSTIC of overlaps
      * @param range_bytes    range specifying the portion of the file to map.
+     * @param policy         map_policy flags.
      */
-    mapped_data(int const & _fd, range_type const & target) :
+    mapped_data(int const & _fd, range_type const & target, unsigned int const policy = map_policy::DEFAULT) :
       data(nullptr), range_bytes(0, 0),
-      page_size(sysconf(_SC_PAGE_SIZE))
+      page_size(sysconf(_SC_PAGE_SIZE)), released(0)
     {
 
       // if no file
@@ -263,18 +304,30 @@ class mapped_data {
         return;
       }
 
-      // get start and end positions that are page aligned.
-      range_bytes.start = range_type::align_to_page(target, page_size);
+      // get start and end positions that are page aligned.  huge page aligned if requested, so the file offset and the address can be aligned.
+      range_bytes.start = range_type::align_to_page(target, ((policy & map_policy::HUGEPAGE) != 0) ? static_cast<size_t>(huge_page_size) : page_size);
       range_bytes.end = target.end;  // okay for end not to align - made 0.
 
       // NOT using MAP_POPULATE. (SLOW)  no need to prefault the entire range - use read ahead from madvice.
-      // NOTE HUGETLB not supported for file mapping, only anonymous.  also, kernel has to enable it and system has to have it reserved,
+      // NOTE HUGETLB not supported for file mapping, only anonymous and hugetlbfs.  also, kernel has to enable it and system has to have it reserved,
+      // so try it first only if requested.
       // MAP_SHARED so that we don't have CoW (no private instance) (potential sharing between processes?)  slightly slower by 1%?
       // MAP_NORESERVE so that swap is not allocated.
-      data = (unsigned char*)mmap64(nullptr, range_bytes.size(),
-                                   PROT_READ,
-                                   MAP_SHARED | MAP_NORESERVE, _fd,
-                                   range_bytes.start);
+      data = (unsigned char*)MAP_FAILED;
+#if defined(MAP_HUGETLB)
+      if ((policy & map_policy::HUGEPAGE) != 0) {
+        data = (unsigned char*)mmap64(nullptr, range_bytes.size(),
+                                     PROT_READ,
+                                     MAP_SHARED | MAP_NORESERVE | MAP_HUGETLB, _fd,
+                                     range_bytes.start);
+      }
+#endif
+      if (data == MAP_FAILED) {
+        data = (unsigned char*)mmap64(nullptr, range_bytes.size(),
+                                     PROT_READ,
+                                     MAP_SHARED | MAP_NORESERVE, _fd,
+                                     range_bytes.start);
+      }
 
       // if mmap failed,
       if (data == MAP_FAILED)
@@ -286,9 +339,18 @@ class mapped_data {
         throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
       }
 
+      // memory policy has to be set before pages are faulted in, i.e. before WILLNEED read ahead.
+      if ((policy & map_policy::LOCAL_NODE) != 0) bind_to_local_node();
+
+#if defined(MADV_HUGEPAGE)
+      // best effort.  EINVAL if THP is not available.
+      if ((policy & map_policy::HUGEPAGE) != 0) madvise(data, range_bytes.size(), MADV_HUGEPAGE);
+#endif
+
       // set the madvice info.  SEQUENTIAL vs RANDOM does not appear to make a difference in running time.
-      int madv_result = madvise(data, range_bytes.size(),
-          MADV_SEQUENTIAL | MADV_WILLNEED);
+      // advice values are not flags, so set them separately.
+      int madv_result = madvise(data, range_bytes.size(), MADV_SEQUENTIAL);
+      if (madv_result != -1) madv_result = madvise(data, range_bytes.size(), MADV_WILLNEED);
       if ( madv_result == -1 ) {
         std::stringstream ss;
         int myerr = errno;
@@ -315,10 +377,11 @@ class mapped_data {
     mapped_data& operator=(mapped_data const & other) = delete;
 
     mapped_data(mapped_data && other) :
-      data(other.data), range_bytes(other.range_bytes), page_size(other.page_size) {
+      data(other.data), range_bytes(other.range_bytes), page_size(other.page_size), released(other.released) {
 
       other.data = nullptr;
       other.range_bytes.start = other.range_bytes.end;
+      other.released = 0;
     }
     mapped_data& operator=(mapped_data && other) {
       // first unmap
@@ -328,10 +391,26 @@ class mapped_data {
       // then move other to here.
       data = other.data;      other.data = nullptr;
       range_bytes = other.range_bytes;   other.range_bytes.start = other.range_bytes.end;
+      released = other.released;  other.released = 0;
 
       return *this;
     }
 
+    /**
+     * @brief release the physical pages mapped before file position pos, e.g. behind a parse cursor, so that resident memory stays bounded.
+     * @details  MADV_DONTNEED on whole pages only.  the mapping remains valid.  released pages are reloaded from the page cache if accessed again.
+     * @param pos   position in the file, NOT relative to the mapping.
+     */
+    void release(size_t const & pos) {
+      if ((data == nullptr) || (pos <= range_bytes.start)) return;
+
+      size_t end = ((::std::min(pos, range_bytes.end) - range_bytes.start) / page_size) * page_size;
+      if (end <= released) return;
+
+      madvise(data + released, end - released, MADV_DONTNEED);
+      released = end;
+    }
+
 
 
     /// accessor for mapped data
@@ -364,6 +443,75 @@ class mapped_data {
 
 
 
+/**
+ * @brief loaded file data as a view of a mapped region of the file.  zero copy alternative to file_data for mmap_file.
+ * @details  same ranges and accessors as file_data, so it can be parsed the same way, e.g. with KmerFileHelper::parse_file_data.
+ *    the view owns its mapping:  the data remains valid for the lifetime of the mapped_file_data object,
+ *    even after the mmap_file that created it is closed or destroyed, and is unmapped when the mapped_file_data
+ *    is destroyed.  iterators, and sequences and kmers that refer to the data, must not be used after that.
+ *    read only, and move only.
+ */
+struct mapped_file_data {
+  using iterator = unsigned char const *;
+  using const_iterator = unsigned char const *;
+
+  // type of ranges
+  using range_type = ::bliss::partition::range<size_t>;
+
+  // range from which the data came
+  range_type parent_range_bytes;
+
+  // range loaded in memory.  INCLUDES OVERLAP
+  range_type in_mem_range_bytes;
+
+  // valid range for this.  EXCLUDES OVERLAP
+  range_type valid_range_bytes;
+
+  // the mapping.  contains in_mem_range_bytes.
+  mapped_data mapping;
+
+  mapped_file_data() = default;
+  mapped_file_data(mapped_file_data && other) = default;
+  mapped_file_data& operator=(mapped_file_data && other) = default;
+
+  /// beginning of the valid range
+  const_iterator begin() const {
+    return cbegin();
+  }
+  /// end of valid range
+  const_iterator end() const {
+    return cend();
+  }
+
+  /// beginning of the valid range
+  const_iterator cbegin() const {
+    return mapping.get_data() + (valid_range_bytes.start - mapping.get_range().start);
+  }
+  /// end of valid range
+  const_iterator cend() const {
+    return mapping.get_data() + (valid_range_bytes.end - mapping.get_range().start);
+  }
+
+  /// start of inmem range
+  const_iterator in_mem_cbegin() const {
+    return mapping.get_data() + (in_mem_range_bytes.start - mapping.get_range().start);
+  }
+  /// end of in mem range
+  const_iterator in_mem_cend() const {
+    return mapping.get_data() + (in_mem_range_bytes.end - mapping.get_range().start);
+  }
+
+  range_type getRange() const {
+    return valid_range_bytes;
+  }
+
+  /// release the physical pages before file position pos, e.g. after the data before pos has been parsed.  see mapped_data::release.
+  void release(size_t const & pos) {
+    mapping.release(pos);
+  }
+};
+
+
 /// base class to wrap a file object with structured data or bytes
 class base_file {
 
@@ -556,11 +704,27 @@ protected:
 	/// BASE type
 	using BASE = ::bliss::io::base_file;
 
+	/// map_policy flags for mapping the file.
+	unsigned int policy;
+
+	/// bytes copied between releases of the mapped pages, to bound resident memory when copying large ranges.
+	static constexpr size_t copy_window = 64UL * 1024UL * 1024UL;
+
 public:
 
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// set the map_policy flags for subsequent maps and reads.  e.g. map_policy::HUGEPAGE | map_policy::LOCAL_NODE
+	void set_map_policy(unsigned int const & _policy) {
+	  policy = _policy;
+	}
+
+	/// get the map_policy flags.
+	unsigned int get_map_policy() const {
+	  return policy;
+	}
+
 	/**
 	 *  bulk load all the data and return it in pre-allocated vector
 	 *  @param output   vector where the results are to be stored.
@@ -577,7 +741,7 @@ public:
 	  }
 
 		// map
-		mapped_data md(this->fd, file_range);
+		mapped_data md(this->fd, file_range, policy);
 
 		//
 		unsigned char * md_data = md.get_data();
@@ -601,11 +765,17 @@ public:
 			return target;
 		}
 
-		// resize output's capacity
-		if (output.capacity() < target.size()) output.resize(target.size());
+		// resize output.  size needs to match the range, since output may be reused.
+		output.resize(target.size());
 
 		// copy the data into memory.  vector is contiguous, so this is okay.
-		memmove(output.data(), md_data + (target.start - mapped_range.start), target.size());
+		// copy by window, and release the mapped pages behind, so only the output is resident at the end.
+		size_t step;
+		for (size_t pos = target.start; pos < target.end; pos += step) {
+		  step = ::std::min(static_cast<size_t>(copy_window), target.end - pos);
+		  memmove(output.data() + (pos - target.start), md_data + (pos - mapped_range.start), step);
+		  md.release(pos + step);
+		}
 
 		return target;
 
@@ -613,7 +783,31 @@ public:
 	}
 
 	inline mapped_data map(typename BASE::range_type const & range_bytes) {
-	  return mapped_data(this->fd, BASE::range_type::intersect(range_bytes, this->file_range_bytes));
+	  return mapped_data(this->fd, BASE::range_type::intersect(range_bytes, this->file_range_bytes), policy);
+	}
+
+	/**
+	 * @brief  map a range of the file as a zero copy file data view.  valid range is the same as in mem range.
+	 */
+	void map_range(::bliss::io::mapped_file_data & output, typename BASE::range_type const & range_bytes) {
+	  typename BASE::range_type file_range = BASE::range_type::intersect(range_bytes, this->file_range_bytes);
+
+	  output.mapping = mapped_data();  // unmap first
+	  if (file_range.size() > 0) output.mapping = map(file_range);
+
+	  output.in_mem_range_bytes = file_range;
+	  output.valid_range_bytes = file_range;
+	  output.parent_range_bytes = this->file_range_bytes;
+	}
+
+	// this is needed to prevent overload name hiding.
+	using BASE::read_file;
+
+	/**
+	 * @brief  map the whole file as a zero copy file data view.
+	 */
+	void read_file(::bliss::io::mapped_file_data & output) {
+	  map_range(output, this->file_range_bytes);
 	}
 
 	/**
@@ -621,7 +815,7 @@ public:
 	 * @param _filename 	name of file to open
 	 */
 	mmap_file(std::string const & _filename) :
-		::bliss::io::base_file(_filename) {
+		::bliss::io::base_file(_filename), policy(map_policy::DEFAULT) {
 
 //    // for testing:  multiple processes on the same node maps to the same ptr address
 //    map(this->file_range_bytes);
@@ -635,7 +829,7 @@ public:
    * @param _file_size  previously determined file size.
    */
   mmap_file(std::string const & _filename, size_t const & _file_size, size_t const & delay_ms = 0) :
-    ::bliss::io::base_file(_filename, _file_size, delay_ms) {}
+    ::bliss::io::base_file(_filename, _file_size, delay_ms), policy(map_policy::DEFAULT) {}
 
   /**
    * initializes a file for reading/writing via memmap.  for use by parallel file (composition)
@@ -643,16 +837,12 @@ public:
    * @param _file_size  previously determined file size.
    */
   mmap_file(int const & _fd, size_t const & _file_size) :
-    ::bliss::io::base_file(_fd, _file_size) {}
+    ::bliss::io::base_file(_fd, _file_size), policy(map_policy::DEFAULT) {}
 
 	/// default destructor
 	virtual ~mmap_file() {
 	};
 
-
-	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
-	using BASE::read_file;
-
 };
 
 /**
@@ -738,8 +928,8 @@ public:
 
 //		std::cout << "curr pos in fd is " << ftell(this->fp) << std::endl;
 
-		// resize output's capacity
-		if (output.capacity() < target.size()) output.resize(target.size());
+		// resize output.  size needs to match the range, since output may be reused.
+		output.resize(target.size());
 
 		size_t read = fread_unlocked(output.data(), 1, target.size(), fp);
 
@@ -846,8 +1036,8 @@ public:
 
     //std::cout << "curr pos in fd is " << lseek64(this->fd, 0, SEEK_CUR) << ::std::endl;
 
-    // resize output's capacity
-    if (output.capacity() < target.size()) output.resize(target.size());
+    // resize output.  size needs to match the range, since output may be reused.
+    output.resize(target.size());
 
     size_t s = 0;
     long count;
@@ -910,6 +1100,216 @@ public:
 
 
 
+};
+
+
+/**
+ * @brief    file wrapper that uses posix read with O_DIRECT, bypassing the page cache.
+ * @details  for single pass reads of files much larger than memory, the page cache would otherwise evict
+ *           resident application memory (e.g. index pages).
+ *           O_DIRECT requires that the buffer address, file offset, and read size be aligned to the
+ *           device's logical block size.  reads go through an internal aligned buffer, with the requested range
+ *           expanded to alignment boundaries, and the requested portion is copied into the output.
+ *
+ *           if the file system does not support O_DIRECT (e.g. tmpfs), this falls back to buffered reads.
+ * @note     the internal buffer means that an instance should not be used concurrently from multiple threads.
+ */
+class direct_posix_file : public ::bliss::io::base_file {
+
+
+protected:
+
+  using BASE = ::bliss::io::base_file;
+
+  /// default aligned buffer size.  multiple of alignment.
+  static constexpr size_t default_buffer_size = (1UL << 26);
+
+  /// alignment for buffer, offset, and size.  page size is a multiple of logical block size for common devices.
+  size_t alignment;
+
+  /// size of the aligned buffer.
+  size_t buffer_size;
+
+  /// aligned buffer.  allocated on first read.
+  unsigned char * buffer;
+
+  /// whether O_DIRECT is in effect.
+  bool direct;
+
+  /// reopen the file with O_DIRECT.  fall back to the existing buffered descriptor if not supported.
+  void open_direct() {
+    if (this->fd == -1) return;
+
+    // get the path via procfs, so that a file descriptor passed in by a parallel file also works.
+    std::string path = this->filename;
+    if (path.length() == 0) {
+      std::stringstream ss;
+      ss << "/proc/self/fd/" << this->fd;
+      path = ss.str();
+    }
+
+    int dfd = open64(path.c_str(), O_RDONLY | O_DIRECT);
+    if (dfd == -1) {
+      int myerr = errno;
+      // EINVAL is returned when file system does not support O_DIRECT.
+      std::cout << "WARNING: direct_posix_file: O_DIRECT not available for [" << path << "] error " << myerr << ": " << strerror(myerr) << ".  using buffered reads." << std::endl;
+      direct = false;
+      return;
+    }
+
+    close(this->fd);
+    this->fd = dfd;
+    direct = true;
+  }
+
+  /// allocate the aligned buffer if not already present.
+  void allocate_buffer() {
+    if (buffer != nullptr) return;
+
+    void * ptr = nullptr;
+    int ret = posix_memalign(&ptr, alignment, buffer_size);
+    if (ret != 0) {
+      std::stringstream ss;
+      ss << "ERROR: direct_posix_file: posix_memalign of " << buffer_size << " bytes failed with error " << ret << ": " << strerror(ret);
+      throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+    }
+    buffer = reinterpret_cast<unsigned char *>(ptr);
+  }
+
+  /// initialize alignment and buffer size, then reopen with O_DIRECT.
+  void init(size_t _buffer_size) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    alignment = (page_size > 0) ? static_cast<size_t>(page_size) : 4096UL;
+    buffer_size = ::std::max(alignment, ((_buffer_size + alignment - 1) / alignment) * alignment);
+
+    open_direct();
+  }
+
+public:
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /**
+   * @brief  bulk load the data in range.  reuse vector
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   * @return  the range for the read data.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output, range_type const & range_bytes) {
+    if (this->fd == -1) {
+      throw ::bliss::utils::make_exception<std::logic_error>("ERROR: read_range: file pointer is null");
+    }
+
+    // ensure the portion to copy is within the file.
+    typename BASE::range_type target =
+        BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+
+    if (target.size() == 0) {
+      // print error through exception.
+      std::cout << "WARNING: read_range: requested " << range_bytes << " not in file " << this->file_range_bytes << std::endl;
+      output.clear();
+      return target;
+    }
+
+    output.resize(target.size());
+
+    allocate_buffer();
+
+    // expand to alignment boundaries.  reading past end of file is allowed with O_DIRECT and returns a short count.
+    size_t aligned_start = (target.start / alignment) * alignment;
+    size_t aligned_end = ((target.end + alignment - 1) / alignment) * alignment;
+
+    size_t s = 0;                 // bytes copied into output
+    size_t pos = aligned_start;   // current aligned file offset
+    size_t skip, len;
+    long count;
+
+    while ((pos < aligned_end) && (s < target.size())) {
+      count = pread64(this->fd, buffer, ::std::min(buffer_size, aligned_end - pos),
+          static_cast<__off64_t>(pos));
+
+      if (count < 0) {
+        std::stringstream ss;
+        int myerr = errno;
+        ss << "ERROR: pread64: file " << this->filename << " error " << myerr << ": " << strerror(myerr);
+
+        throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+      }
+      if (count == 0) break;  // eof
+
+      // copy the part that is in target.
+      skip = (pos < target.start) ? (target.start - pos) : 0;
+      if (static_cast<size_t>(count) > skip) {
+        len = ::std::min(static_cast<size_t>(count) - skip, target.size() - s);
+        memcpy(output.data() + s, buffer + skip, len);
+        s += len;
+      }
+
+      // a short read that is not aligned happens only at eof.
+      pos += count;
+      if ((pos % alignment) != 0) break;
+    }
+
+    if (s != target.size()) {
+        std::stringstream ss;
+        ss << "ERROR: pread64: file " << this->filename << " read " << s << " less than range: " << target.size();
+        throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+    }
+
+    return target;
+  }
+
+  /**
+   * initializes a file for reading
+   * @param _filename   name of file to open
+   * @param _buffer_size  size of the internal aligned buffer.  rounded up to alignment
+   */
+  direct_posix_file(std::string const & _filename, size_t _buffer_size = default_buffer_size) :
+    ::bliss::io::base_file(_filename), alignment(4096UL), buffer_size(_buffer_size), buffer(nullptr), direct(false) {
+    init(_buffer_size);
+  };
+
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @param _filename   name of file to open
+   * @param _file_size  previously computed file size.
+   */
+  direct_posix_file(std::string const & _filename, size_t const & _file_size, size_t const & delay_ms) :
+    ::bliss::io::base_file(_filename, _file_size, delay_ms), alignment(4096UL), buffer_size(default_buffer_size), buffer(nullptr), direct(false) {
+    init(default_buffer_size);
+  };
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @note  the descriptor is duplicated, then replaced with one opened with O_DIRECT
+   * @param _fd   previously opened file descriptor
+   * @param _file_size  previously computed file size.
+   */
+  direct_posix_file(int const & _fd, size_t const & _file_size) :
+    ::bliss::io::base_file(_fd, _file_size), alignment(4096UL), buffer_size(default_buffer_size), buffer(nullptr), direct(false) {
+    init(default_buffer_size);
+  };
+
+  /// no copying, since there is an internal buffer.
+  direct_posix_file(direct_posix_file const & other) = delete;
+  /// no copying, since there is an internal buffer.
+  direct_posix_file & operator=(direct_posix_file const & other) = delete;
+
+  /// destructor
+  virtual ~direct_posix_file() {
+    if (buffer != nullptr) free(buffer);
+  };
+
+  /// check if reads bypass the page cache.
+  bool is_direct() const {
+    return direct;
+  }
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_file;
+
 };
 
 #ifdef USE_MPI
@@ -918,6 +1318,205 @@ public:
 namespace parallel {
 
 
+/**
+ * @brief loaded file data as a view of a node's copy of the file in MPI-3 shared memory.  zero copy alternative to file_data.
+ * @details  one process per node (local rank 0 of comm.split_shared()) reads the node's contiguous byte range, i.e. the union of
+ *    the in memory ranges of the processes on the node, into a window from MPI_Win_allocate_shared.  every process on the node
+ *    then has a view of its own ranges in the window.  same ranges and accessors as file_data, so it can be parsed the same way,
+ *    e.g. with KmerFileHelper::parse_file_data.
+ *
+ *    with many processes per node, this gives the file system 1 stream per node instead of 1 per process.  the node range is
+ *    contiguous if the processes of a node have consecutive ranks, the usual block mapping.  otherwise it covers the gaps too.
+ *
+ *    the window is freed when the object is destroyed or reloaded, which is collective on the processes of the node.
+ *    read only, and move only.
+ */
+struct shared_file_data {
+  using iterator = unsigned char const *;
+  using const_iterator = unsigned char const *;
+
+  // type of ranges
+  using range_type = ::bliss::partition::range<size_t>;
+
+  // range from which the data came
+  range_type parent_range_bytes;
+
+  // range loaded in memory.  INCLUDES OVERLAP
+  range_type in_mem_range_bytes;
+
+  // valid range for this.  EXCLUDES OVERLAP
+  range_type valid_range_bytes;
+
+  // range in the node's window.  contains in_mem_range_bytes.
+  range_type node_range_bytes;
+
+protected:
+  MPI_Win win;
+  bool allocated;
+  /// start of the node's window.
+  unsigned char const * data;
+
+  /// bytes the node leader reads at a time, to bound the staging buffer.
+  static constexpr size_t read_window = 64UL * 1024UL * 1024UL;
+
+  void release() {
+    if (allocated) {
+      MPI_Win_unlock_all(win);
+      MPI_Win_free(&win);
+    }
+    allocated = false;
+    data = nullptr;
+    node_range_bytes = range_type(0, 0);
+  }
+
+public:
+  shared_file_data() : allocated(false), data(nullptr) {};
+
+  shared_file_data(shared_file_data const & other) = delete;
+  shared_file_data& operator=(shared_file_data const & other) = delete;
+
+  shared_file_data(shared_file_data && other) :
+    parent_range_bytes(other.parent_range_bytes), in_mem_range_bytes(other.in_mem_range_bytes),
+    valid_range_bytes(other.valid_range_bytes), node_range_bytes(other.node_range_bytes),
+    win(other.win), allocated(other.allocated), data(other.data) {
+    other.allocated = false;
+    other.data = nullptr;
+  }
+  shared_file_data& operator=(shared_file_data && other) {
+    release();
+    parent_range_bytes = other.parent_range_bytes;
+    in_mem_range_bytes = other.in_mem_range_bytes;
+    valid_range_bytes = other.valid_range_bytes;
+    node_range_bytes = other.node_range_bytes;
+    win = other.win;
+    allocated = other.allocated;   other.allocated = false;
+    data = other.data;             other.data = nullptr;
+    return *this;
+  }
+
+  /// collective on the processes of the node.  frees the window.
+  ~shared_file_data() {
+    release();
+  }
+
+  /**
+   * @brief  read the node's range into a new shared window.  collective on shared.  replaces the current window.
+   * @param reader     sequential reader of the file.  only used on the node leader.
+   * @param in_mem     range this process needs.  the node range is the union of the processes' ranges.
+   * @param shared     communicator of the processes on the node, from comm.split_shared().
+   */
+  template <typename FileReader>
+  void load(FileReader & reader, range_type const & in_mem, ::mxx::comm const & shared) {
+    release();
+
+    // union of the local ranges.  empty ranges do not count.
+    size_t bounds[2] = { (in_mem.size() > 0) ? in_mem.start : ::std::numeric_limits<size_t>::max(),
+                         (in_mem.size() > 0) ? in_mem.end : 0UL };
+    bounds[0] = ::mxx::allreduce(bounds[0], [](size_t const & x, size_t const & y){ return ::std::min(x, y); }, shared);
+    bounds[1] = ::mxx::allreduce(bounds[1], [](size_t const & x, size_t const & y){ return ::std::max(x, y); }, shared);
+    node_range_bytes = (bounds[0] < bounds[1]) ? range_type(bounds[0], bounds[1]) : range_type(in_mem.start, in_mem.start);
+
+    // the leader's segment holds the node range.
+    unsigned char * base = nullptr;
+    MPI_Aint bytes = (shared.rank() == 0) ? static_cast<MPI_Aint>(node_range_bytes.size()) : 0;
+    int res = MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, shared, &base, &win);
+    if (res != MPI_SUCCESS) {
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: shared_file_data: MPI_Win_allocate_shared failed.");
+    }
+    allocated = true;
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    if (shared.rank() == 0) {
+      typename ::bliss::io::file_data::container buffer;
+      for (size_t pos = node_range_bytes.start; pos < node_range_bytes.end; pos += read_window) {
+        range_type r = reader.read_range(buffer,
+            range_type(pos, ::std::min(node_range_bytes.end, pos + read_window)));
+        if (r.size() != ::std::min(node_range_bytes.end - pos, read_window)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: shared_file_data: short read.");
+        }
+        memcpy(base + (pos - node_range_bytes.start), buffer.data(), r.size());
+      }
+    }
+
+    MPI_Aint seg_size;
+    int disp_unit;
+    MPI_Win_shared_query(win, 0, &seg_size, &disp_unit, &base);
+    data = base;
+
+    // make the leader's writes visible.
+    MPI_Win_sync(win);
+    MPI_Barrier(shared);
+    MPI_Win_sync(win);
+  }
+
+  /// beginning of the valid range
+  const_iterator begin() const {
+    return cbegin();
+  }
+  /// end of valid range
+  const_iterator end() const {
+    return cend();
+  }
+
+  /// beginning of the valid range
+  const_iterator cbegin() const {
+    return data + (valid_range_bytes.start - node_range_bytes.start);
+  }
+  /// end of valid range
+  const_iterator cend() const {
+    return data + (valid_range_bytes.end - node_range_bytes.start);
+  }
+
+  /// start of inmem range
+  const_iterator in_mem_cbegin() const {
+    return data + (in_mem_range_bytes.start - node_range_bytes.start);
+  }
+  /// end of in mem range
+  const_iterator in_mem_cend() const {
+    return data + (in_mem_range_bytes.end - node_range_bytes.start);
+  }
+
+  range_type getRange() const {
+    return valid_range_bytes;
+  }
+};
+
+
+/**
+ * @brief  sizes of files from 1 stat call per file, on rank 0 only.  collective.
+ * @details  at thousands of processes, a stat (and open) from every process is a burst of metadata requests at the same
+ *           time, e.g. to the Lustre MDS.  here rank 0 stats, then broadcasts the sizes together with the errors, so a
+ *           missing or unreadable file throws the same IOException on all processes, instead of on rank 0 only while
+ *           the others wait in the broadcast.  an empty file name has size 0.
+ * @param caller    prefix of the error message.
+ */
+inline ::std::vector<size_t> stat_files(::std::vector<::std::string> const & filenames, ::mxx::comm const & comm,
+                                        char const * caller = "bliss::io::parallel::stat_files") {
+  // size and errno of each file.
+  ::std::vector<size_t> stats(2 * filenames.size(), 0);
+  if (comm.rank() == 0) {
+    struct stat64 filestat;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      if (filenames[i].length() == 0) continue;
+      if (stat64(filenames[i].c_str(), &filestat) < 0) stats[2 * i + 1] = static_cast<size_t>(errno);
+      else stats[2 * i] = static_cast<size_t>(filestat.st_size);
+    }
+  }
+  if ((comm.size() > 1) && (stats.size() > 0))
+    MPI_Bcast(stats.data(), stats.size(), MPI_UNSIGNED_LONG, 0, comm);
+
+  ::std::vector<size_t> sizes(filenames.size());
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    if (stats[2 * i + 1] != 0) {
+      ::std::stringstream ss;
+      int myerr = static_cast<int>(stats[2 * i + 1]);
+      ss << "ERROR : " << caller << ": ["  << filenames[i] << "] " << myerr << ": " << strerror(myerr);
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+    }
+    sizes[i] = stats[2 * i];
+  }
+  return sizes;
+}
 
 
 class base_file : public ::bliss::io::base_file {
@@ -930,21 +1529,10 @@ protected:
 	/// communicator used.  object instead of being a reference - lifetime of a src comm temp object in constructor is just that of the constructor call.
 	const ::mxx::comm comm;
 
-		/// compute file size in parallel (1 proc, then broadcast.
+		/// compute file size in parallel (1 proc, then broadcast.  throws on all procs if the file is not valid.
 	size_t get_file_size() {
-
-		size_t file_size = 0;
-
-		// rank 0 gets the size.
-		if (comm.rank() == 0) {
-//		  printf("parallel base file get_file_size\n");
-		  file_size = BASE::get_file_size();
-		}
-		// then broadcast.
-		if (comm.size() > 1)
-			MPI_Bcast(&file_size, 1, MPI_UNSIGNED_LONG, 0, comm);
-
-		return file_size;
+		return ::bliss::io::parallel::stat_files(::std::vector<::std::string>(1, this->filename), comm,
+		                                         "bliss::io::parallel::base_file::get_file_size")[0];
 	}
 
   base_file(::mxx::comm const & _comm = ::mxx::comm()) :
@@ -987,6 +1575,11 @@ public:
 
 
 
+/**
+ * @brief parallel base file that opens the file once per node instead of once per process.
+ * @details  rank 0 stats the file (see stat_files), local rank 0 of each node opens it, and passes the file descriptor to
+ *           the other processes of the node (see unix_domain_socket.h).  for startup of large jobs on a shared file system.
+ */
 class base_shared_fd_file : public ::bliss::io::parallel::base_file {
 protected:
   using BASE = ::bliss::io::parallel::base_file;
@@ -994,7 +1587,7 @@ protected:
   using range_type = typename BASE::range_type;
 
 
-  /// opens a file. side effect computes size of the file.
+  /// opens a file, 1 open call per node.  the other processes on the node get the file descriptor through a unix domain socket.
   void open_file() {
     // first split the communicator
 
@@ -1003,8 +1596,19 @@ protected:
 
     ::mxx::comm shared = this->comm.split_shared();
 
+    // fd is populated on shared comm rank 0.  a failed open throws on all processes, before any fd is passed.
+    ::std::string err;
     if (shared.rank() == 0) {
-      this->::bliss::io::base_file::open_file();  // fd is populated on shared comm rank 0.
+      try {
+        this->::bliss::io::base_file::open_file();
+      } catch (::bliss::io::IOException const & e) {
+        err = e.what();
+      }
+    }
+    if (::mxx::any_of(!err.empty(), this->comm)) {
+      this->file_range_bytes.end = 0;
+      if (err.empty()) err = "ERROR in base_shared_fd_file open: [" + this->filename + "] failed on another node.";
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>(err);
     }
 
     int id = ::mxx::allreduce(this->comm.rank(), [](int const & x, int const & y){ return ::std::min(x, y); }, shared);
@@ -1016,9 +1620,6 @@ protected:
       // all mpi processes on the same node share the same file handle.
 
       ::bliss::io::util::broadcast_file_descriptor(this->fd, id, shared.size(), shared.rank());
-
-	if (this->comm.rank() == id) 
-		printf("broadcasting file descriptor %d from rank G%d N%d to rest.\n", this->fd, id, shared.rank()); 
     }
     // that's it.
 
@@ -1095,7 +1696,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
+		partitioner.configure(target, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
 
 		return partitioner.getNext(this->comm.rank());
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
@@ -1133,7 +1734,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
+		partitioner.configure(valid, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
 		valid = partitioner.getNext(this->comm.rank());
 
 		// compute the in mem range.  extend by overlap
@@ -1149,6 +1750,11 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// get the sequential reader, e.g. to set its options such as mmap_file::set_map_policy.  set before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1205,14 +1811,48 @@ public:
 		output.parent_range_bytes = this->file_range_bytes;
 	}
 
-//	std::string get_class_name() {
-//		return std::string("partitioned_file<...>");
-//	}
-//
-};
+	/**
+	 * @brief  map the process's partition as a zero copy view.  requires mmap_file as FileReader.  same ranges as read_file.
+	 * @param output 		mapped_file_data object.  owns the mapping.
+	 */
+	void read_file(::bliss::io::mapped_file_data & output) {
+	  static_assert(::std::is_same<FileReader, ::bliss::io::mmap_file>::value, "ERROR: zero copy read requires mmap_file.");
 
+	  typename BASE::range_type in_mem_partitioned;
+	  typename BASE::range_type valid_partitioned;
 
-template <typename FileReader, typename BaseType>
+		::std::tie(in_mem_partitioned, valid_partitioned) =
+				overlapped_partition(this->file_range_bytes, this->file_range_bytes);
+
+		reader.map_range(output, in_mem_partitioned);
+		output.valid_range_bytes = valid_partitioned;
+	}
+
+	/**
+	 * @brief  read the node's partitions once, into shared memory, and view the process's partition.  collective.  same ranges as read_file.
+	 * @param output 		shared_file_data object.  owns the window.
+	 */
+	void read_file(::bliss::io::parallel::shared_file_data & output) {
+	  typename BASE::range_type in_mem_partitioned;
+	  typename BASE::range_type valid_partitioned;
+
+		::std::tie(in_mem_partitioned, valid_partitioned) =
+				overlapped_partition(this->file_range_bytes, this->file_range_bytes);
+
+		output.load(reader, in_mem_partitioned, this->comm.split_shared());
+		output.in_mem_range_bytes = in_mem_partitioned;
+		output.valid_range_bytes = valid_partitioned;
+		output.parent_range_bytes = this->file_range_bytes;
+	}
+
+//	std::string get_class_name() {
+//		return std::string("partitioned_file<...>");
+//	}
+//
+};
+
+
+template <typename FileReader, typename BaseType>
 class partitioned_file<FileReader, ::bliss::io::FASTQParser, BaseType > :
 	public BaseType {
 
@@ -1230,6 +1870,18 @@ protected:
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<typename BASE::range_type> partitioner;
 
+	/// boundaries of all processes' partitions of the file, from balance_kmers.  empty for block partitioning by bytes.
+	::std::vector<size_t> splits;
+
+	/// the current process's block of target.  the balanced boundaries only apply to the whole file.
+	typename BASE::range_type block(typename BASE::range_type const & target) {
+	  if ((splits.size() == static_cast<size_t>(this->comm.size() + 1)) && (target == this->file_range_bytes)) {
+	    return typename BASE::range_type(splits[this->comm.rank()], splits[this->comm.rank() + 1]);
+	  }
+	  partitioner.configure(target, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
+	  return partitioner.getNext(this->comm.rank());
+	}
+
 	/**
 	 * @brief partitions the specified range by the number of processes in communicator
 	 * @note  does not add overlap.  this is strictly for block partitioning a range.
@@ -1244,9 +1896,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
-
-		return partitioner.getNext(this->comm.rank());
+		return block(target);
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
 //
 //		std::cout << "rank = " << this->comm.rank() << " range " << result << std::endl;
@@ -1282,8 +1932,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
-		valid = partitioner.getNext(this->comm.rank());
+		valid = block(valid);
 
 		// compute the in mem range.  extend by overlap
 		typename BASE::range_type in_mem_valid = valid;
@@ -1298,6 +1947,82 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// get the sequential reader, e.g. to set its options such as mmap_file::set_map_policy.  set before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
+	/**
+	 * @brief  balance the partitions by the estimated number of kmers instead of bytes.  collective.  call before read_file.
+	 * @details  each process's byte block is divided into sample windows.  the kmer density of a window is measured from
+	 *           the complete records in the first sample_bytes of the window, and the densities are allgathered so all
+	 *           processes compute the same boundaries.  read_file then aligns the boundaries to records as usual.
+	 *           densities of windows without a complete record are the average.  if nothing is sampled, the block partition is kept.
+	 * @param k             kmer size.
+	 * @param samples       number of sample windows per process.
+	 * @param sample_bytes  bytes read per window.  should hold a few records.
+	 */
+	void balance_kmers(size_t const & k, size_t const & samples = 16UL, size_t const & sample_bytes = 65536UL) {
+	  splits.clear();
+	  if ((this->comm.size() == 1) || (samples == 0)) return;
+
+	  ::bliss::partition::BlockPartitioner<range_type> windows;
+	  windows.configure(partition(this->file_range_bytes), samples);
+
+	  // window start, window end, sampled kmers, sampled bytes, largest record.
+	  ::std::vector<size_t> fields;
+	  fields.reserve(samples * 5);
+
+	  typename ::bliss::io::file_data::container buffer;
+	  FileParserType parser;
+	  for (size_t i = 0; i < samples; ++i) {
+	    range_type w = windows.getNext(i);
+	    if (w.size() == 0) continue;
+
+	    ::bliss::io::kmer_balanced_partition::fastq_sample s{0, 0, 0, 0};
+	    range_type in_mem = reader.read_range(buffer,
+	        range_type(w.start, ::std::min(this->file_range_bytes.end, w.start + sample_bytes)));
+	    try {
+	      size_t start = parser.find_first_record(buffer.cbegin(), this->file_range_bytes, in_mem, in_mem);
+	      if (start < in_mem.end) {
+	        s = ::bliss::io::kmer_balanced_partition::sample_fastq(buffer.cbegin() + (start - in_mem.start), buffer.cend(),
+	            in_mem.end == this->file_range_bytes.end, k);
+	      }
+	    } catch (::std::logic_error const &) {
+	      // no record start in the sample.  use the average density.
+	    }
+
+	    fields.push_back(w.start);
+	    fields.push_back(w.end);
+	    fields.push_back(s.kmers);
+	    fields.push_back(s.bytes);
+	    fields.push_back(s.max_record);
+	  }
+
+	  fields = ::mxx::allgatherv(fields, this->comm);
+
+	  size_t kmers = 0, bytes = 0, max_record = 0;
+	  for (size_t i = 0; i < fields.size(); i += 5) {
+	    kmers += fields[i + 2];
+	    bytes += fields[i + 3];
+	    max_record = ::std::max(max_record, fields[i + 4]);
+	  }
+	  if (bytes == 0) return;
+
+	  double average = static_cast<double>(kmers) / static_cast<double>(bytes);
+	  ::std::vector<::bliss::io::kmer_balanced_partition::segment> segments;
+	  segments.reserve(fields.size() / 5);
+	  for (size_t i = 0; i < fields.size(); i += 5) {
+	    double density = (fields[i + 3] == 0) ? average :
+	        static_cast<double>(fields[i + 2]) / static_cast<double>(fields[i + 3]);
+	    segments.push_back(::bliss::io::kmer_balanced_partition::segment{fields[i], fields[i + 1],
+	      density * static_cast<double>(fields[i + 1] - fields[i])});
+	  }
+
+	  // each partition should hold a record start, so the record search in read_file succeeds.
+	  splits = ::bliss::io::kmer_balanced_partition::split(segments, this->file_range_bytes, this->comm.size(), 2 * max_record);
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1425,6 +2150,86 @@ public:
 
 	}
 
+	/**
+	 * @brief  map the process's record aligned partition as a zero copy view.  requires mmap_file as FileReader.  collective.
+	 * @details  same valid ranges as read_file.  instead of shifting the partial record at the partition start
+	 *           to the previous process, each process maps its own range [real start, next process's real start).
+	 * @param output 		mapped_file_data object.  owns the mapping.
+	 */
+	void read_file(::bliss::io::mapped_file_data & output) {
+	  static_assert(::std::is_same<FileReader, ::bliss::io::mmap_file>::value, "ERROR: zero copy read requires mmap_file.");
+
+	  // search for the record start in the block partition.
+	  range_type partition_range = partition(this->file_range_bytes);
+	  reader.map_range(output, partition_range);
+
+	  ::bliss::io::FASTQParser<typename ::bliss::io::mapped_file_data::const_iterator> parser;
+	  size_t real_start = parser.init_parser(output.in_mem_cbegin(), this->file_range_bytes,
+	      partition_range, partition_range, this->comm);
+
+	  // empty if no record start found.  else valid range ends at the next process's record start.
+	  bool not_found = (real_start >= partition_range.end);
+	  real_start = std::min(real_start, partition_range.end);
+
+	  size_t next_start = not_found ? ::std::numeric_limits<size_t>::max() : real_start;
+	  next_start = ::mxx::exscan(next_start, [](size_t const & x, size_t const & y) {
+	    return (x < y) ? x : y;
+	  }, this->comm.reverse());
+	  if ((this->comm.rank() == (this->comm.size() - 1)) ||
+	      (next_start == ::std::numeric_limits<size_t>::max())) next_start = this->file_range_bytes.end;
+
+	  range_type valid(real_start, not_found ? partition_range.end : next_start);
+
+	  // remap to the valid range.
+	  reader.map_range(output, valid);
+	}
+
+	/**
+	 * @brief  read the node's partitions once, into shared memory, and view the process's record aligned partition.  collective.
+	 * @details  same valid ranges as read_file.  as in the zero copy mapped read_file, each process's range is
+	 *           [real start, next process's real start).  the node's window holds the node's block partitions plus tail bytes,
+	 *           for the records that straddle into the next node.  if a record is longer than that, the window is read again.
+	 * @param output 		shared_file_data object.  owns the window.
+	 * @param tail      bytes read past the node's last partition.
+	 */
+	void read_file(::bliss::io::parallel::shared_file_data & output, size_t const & tail = 1UL << 20) {
+	  ::mxx::comm shared = this->comm.split_shared();
+
+	  // search for the record start in the block partition.
+	  range_type partition_range = partition(this->file_range_bytes);
+	  range_type in_mem = partition_range;
+	  in_mem.end = ::std::min(this->file_range_bytes.end, in_mem.end + tail);
+	  output.load(reader, in_mem, shared);
+
+	  ::bliss::io::FASTQParser<typename ::bliss::io::parallel::shared_file_data::const_iterator> parser;
+	  output.in_mem_range_bytes = partition_range;
+	  size_t real_start = parser.init_parser(output.in_mem_cbegin(), this->file_range_bytes,
+	      partition_range, partition_range, this->comm);
+
+	  // empty if no record start found.  else valid range ends at the next process's record start.
+	  bool not_found = (real_start >= partition_range.end);
+	  real_start = std::min(real_start, partition_range.end);
+
+	  size_t next_start = not_found ? ::std::numeric_limits<size_t>::max() : real_start;
+	  next_start = ::mxx::exscan(next_start, [](size_t const & x, size_t const & y) {
+	    return (x < y) ? x : y;
+	  }, this->comm.reverse());
+	  if ((this->comm.rank() == (this->comm.size() - 1)) ||
+	      (next_start == ::std::numeric_limits<size_t>::max())) next_start = this->file_range_bytes.end;
+
+	  range_type valid(real_start, not_found ? partition_range.end : next_start);
+
+	  // record longer than the tail.  read the exact range.
+	  bool short_tail = !output.node_range_bytes.contains(valid);
+	  if (::mxx::any_of(short_tail, shared)) {
+	    output.load(reader, valid, shared);
+	  }
+
+	  output.in_mem_range_bytes = valid;
+	  output.valid_range_bytes = valid;
+	  output.parent_range_bytes = this->file_range_bytes;
+	}
+
 
 //	std::string get_class_name() {
 //		return std::string("partitioned_file<FASTQ>");
@@ -1452,6 +2257,18 @@ protected:
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<typename BASE::range_type> partitioner;
 
+	/// boundaries of all processes' partitions of the file, from balance_kmers.  empty for block partitioning by bytes.
+	::std::vector<size_t> splits;
+
+	/// the current process's block of target.  the balanced boundaries only apply to the whole file.
+	typename BASE::range_type block(typename BASE::range_type const & target) {
+	  if ((splits.size() == static_cast<size_t>(this->comm.size() + 1)) && (target == this->file_range_bytes)) {
+	    return typename BASE::range_type(splits[this->comm.rank()], splits[this->comm.rank() + 1]);
+	  }
+	  partitioner.configure(target, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
+	  return partitioner.getNext(this->comm.rank());
+	}
+
 	/**
 	 * @brief partitions the specified range by the number of processes in communicator
 	 * @note  does not add overlap.  this is strictly for block partitioning a range.
@@ -1466,9 +2283,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
-
-		return partitioner.getNext(this->comm.rank());
+		return block(target);
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
 //
 //		std::cout << "rank = " << this->comm.rank() << " range " << result << std::endl;
@@ -1504,8 +2319,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
-		valid = partitioner.getNext(this->comm.rank());
+		valid = block(valid);
 
 		// compute the in mem range.  extend by overlap
 		typename BASE::range_type in_mem_valid = valid;
@@ -1520,6 +2334,38 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// get the sequential reader, e.g. to set its options such as mmap_file::set_map_policy.  set before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
+	/**
+	 * @brief  balance the partitions by the kmer counts of the sequences in a fasta_index, instead of bytes.  call before read_file.
+	 * @note   entries are for the whole file, e.g. from the collective fasta_index::read, so this is not collective.
+	 * @param k         kmer size.
+	 * @param entries   sequence offsets of all records in the file.
+	 */
+	void balance_kmers(size_t const & k, ::std::vector<::bliss::io::fasta_index::entry_type> const & entries) {
+	  splits.clear();
+	  if (this->comm.size() == 1) return;
+
+	  splits = ::bliss::io::kmer_balanced_partition::split(
+	      ::bliss::io::kmer_balanced_partition::fasta_segments(entries, k), this->file_range_bytes, this->comm.size());
+	}
+
+	/**
+	 * @brief  balance the partitions by kmer counts using the file's sidecar fasta_index, if there is a current one.  collective.
+	 * @return true if the index was loaded.  if not, the block partition by bytes is kept.
+	 */
+	bool balance_kmers(size_t const & k) {
+	  ::std::vector<::bliss::io::fasta_index::entry_type> entries;
+	  splits.clear();
+	  if (!::bliss::io::fasta_index::read(this->filename, this->file_range_bytes.end, entries, this->comm)) return false;
+
+	  balance_kmers(k, entries);
+	  return true;
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1601,12 +2447,479 @@ public:
 //		std::cout << "rank " << this->comm.rank() << " file  " << output.parent_range_bytes << std::endl;
 
 	}
+
+	/**
+	 * @brief  map the process's partition, with overlap, as a zero copy view.  requires mmap_file as FileReader.  same ranges as read_file.
+	 * @param output 		mapped_file_data object.  owns the mapping.
+	 */
+	void read_file(::bliss::io::mapped_file_data & output) {
+	  static_assert(::std::is_same<FileReader, ::bliss::io::mmap_file>::value, "ERROR: zero copy read requires mmap_file.");
+
+	  range_type in_mem, valid;
+		::std::tie(in_mem, valid) =
+				overlapped_partition(this->file_range_bytes, this->file_range_bytes);
+
+		reader.map_range(output, in_mem);
+		output.valid_range_bytes = valid;
+
+		// trim the overlap to the requested number of non-EOL characters.  the mapping is not changed.
+		::bliss::io::FASTAParser<typename ::bliss::io::mapped_file_data::const_iterator> parser;
+		output.in_mem_range_bytes.end = parser.find_overlap_end(output.in_mem_cbegin(), output.parent_range_bytes,
+				output.in_mem_range_bytes, output.valid_range_bytes.end, overlap);
+	}
+
+	/**
+	 * @brief  read the node's partitions once, into shared memory, and view the process's partition with overlap.  collective.  same ranges as read_file.
+	 * @param output 		shared_file_data object.  owns the window.
+	 */
+	void read_file(::bliss::io::parallel::shared_file_data & output) {
+	  range_type in_mem, valid;
+		::std::tie(in_mem, valid) =
+				overlapped_partition(this->file_range_bytes, this->file_range_bytes);
+
+		output.load(reader, in_mem, this->comm.split_shared());
+		output.in_mem_range_bytes = in_mem;
+		output.valid_range_bytes = valid;
+		output.parent_range_bytes = this->file_range_bytes;
+
+		// trim the overlap to the requested number of non-EOL characters.  the window is not changed.
+		::bliss::io::FASTAParser<typename ::bliss::io::parallel::shared_file_data::const_iterator> parser;
+		output.in_mem_range_bytes.end = parser.find_overlap_end(output.in_mem_cbegin(), output.parent_range_bytes,
+				output.in_mem_range_bytes, output.valid_range_bytes.end, overlap);
+	}
 //	std::string get_class_name() {
 //		return std::string("partitioned_file<FASTA>");
 //	}
 
 };
 
+/**
+ * @brief  parallel file that hands out a process's partition in record-aligned blocks of bounded size.
+ * @details  the file is first block partitioned across the processes in the communicator, and the partition
+ *     boundaries are moved to record starts (collective, in constructor).  Each process then reads its own
+ *     partition one block at a time via read_next_block, which is NOT collective.   each block starts at a record
+ *     and ends at a record boundary, so the block can be parsed independently with a sequential parser.
+ *
+ *     memory use is bounded by the block size plus the size of 1 record, instead of the full partition.
+ *
+ *     in block cyclic mode, the file is instead cut into blocks of block_size bytes, and process r reads blocks
+ *     r, r + p, r + 2p, ...  each block is moved to the record starts after its 2 ends, so the blocks tile the file
+ *     without a collective step.  in each round the processes read p consecutive blocks, so on a striped parallel file
+ *     system (Lustre) the requests of a round are spread over the stripes, instead of every process streaming
+ *     from its own part of the file and many of them hitting the same OSTs.  the block grid is fixed at construction,
+ *     so set_block_size has no effect, and read_file and read_range cover the whole file.
+ *
+ * @note   the record start is obtained via FileParser's find_first_record. This works for FASTQ, where a record
+ *         boundary can be found from local data alone.  FASTA records can span blocks and need header information
+ *         from earlier blocks, so with FASTAParser the blocks are not moved to record starts, and are parsed with the
+ *         state carried by fasta_stream (io/fasta_stream.hpp).
+ */
+template <typename FileReader,
+          template <typename> class FileParser = ::bliss::io::FASTQParser,
+          typename BaseType = ::bliss::io::parallel::base_file >
+class block_streaming_file : public BaseType {
+
+protected:
+  using BASE = BaseType;
+  using range_type = typename ::bliss::io::base_file::range_type;
+  using FileParserType = FileParser<typename ::bliss::io::file_data::const_iterator >;
+
+  /// FileReader
+  FileReader reader;
+
+  /// target block size in bytes.
+  size_t block_size;
+
+  /// record aligned range for the current process.
+  range_type partition_range_bytes;
+
+  /// start of next block to read.
+  size_t next_block_start;
+
+  /// block cyclic mode.
+  bool cyclic;
+
+  /// in block cyclic mode, index of the next block to read.
+  size_t next_block;
+
+  /// partitioner to use.
+  ::bliss::partition::BlockPartitioner<range_type> partitioner;
+
+  /// default size of the window used to search for record starts.
+  static constexpr size_t search_window = 65536UL;
+
+  /// blocks start at records.  FASTA blocks are plain byte ranges.
+  static constexpr bool record_aligned = !::std::is_same<FileParserType,
+      ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator> >::value;
+
+
+  /**
+   * @brief  find the position of the first record at or after pos, reading increasing amount of
+   *         file data until a record start is found or the end of the limit is reached.
+   * @param pos    position from which to search.
+   * @param limit  largest position to search to.
+   * @param buffer  scratch buffer for the search
+   * @return  position of the first record start that is >= pos, or limit if not found.
+   */
+  size_t find_record_start(size_t const & pos, size_t const & limit,
+                           typename ::bliss::io::file_data::container & buffer) {
+    if (pos >= limit) return limit;
+    if (!record_aligned) return pos;
+
+    FileParserType parser;
+    size_t window = search_window;
+    range_type search;
+    size_t start;
+
+    while (true) {
+      search = range_type(pos, ::std::min(limit, pos + window));
+      range_type in_mem = reader.read_range(buffer, search);
+
+      try {
+        start = parser.find_first_record(buffer.cbegin(), this->file_range_bytes, in_mem, search);
+      } catch (::std::logic_error & e) {
+        // no complete record in window.
+        start = search.end;
+      }
+
+      // found, or already searched all the way to the limit.
+      if ((start < search.end) || (search.end == limit)) break;
+
+      window <<= 1;
+    }
+
+    return start;
+  }
+
+public:
+
+  /**
+   * @brief constructor.  collectively compute the record aligned partition range for each process.
+   * @param _filename     name of file to open
+   * @param _block_size   target number of bytes to read per block.
+   * @param _comm         MPI communicator to use.
+   * @param _cyclic       read blocks r, r + p, ... of the whole file instead of a contiguous partition.
+   */
+  block_streaming_file(std::string const & _filename, size_t const & _block_size, ::mxx::comm const & _comm = ::mxx::comm(),
+                       bool const & _cyclic = false) :
+    BaseType(_filename, _comm),
+    reader(this->fd, this->file_range_bytes.end), block_size(::std::max(_block_size, static_cast<size_t>(search_window))),
+    partition_range_bytes(this->file_range_bytes), next_block_start(this->file_range_bytes.start),
+    cyclic(_cyclic), next_block(_comm.rank()) {
+
+    if (cyclic) return;
+
+    range_type target = this->file_range_bytes;
+    if (this->comm.size() > 1) {
+      partitioner.configure(this->file_range_bytes, this->comm.size(), ::bliss::partition::rank_weights::instance().get(this->comm));
+      target = partitioner.getNext(this->comm.rank());
+    }
+
+    // find the record start for the current partition.  search past the partition end.
+    typename ::bliss::io::file_data::container buffer;
+    size_t start = (this->comm.rank() == 0) ? this->file_range_bytes.start :
+        find_record_start(target.start, this->file_range_bytes.end, buffer);
+
+    // end is the start of the next partition.
+    size_t end = this->file_range_bytes.end;
+    if (this->comm.size() > 1) {
+      end = ::mxx::left_shift(start, this->comm);
+      if (this->comm.rank() == (this->comm.size() - 1)) end = this->file_range_bytes.end;
+    }
+
+    // partition with no record start of its own.
+    if (end < start) end = start;
+
+    partition_range_bytes = range_type(start, end);
+    next_block_start = start;
+  };
+
+  /// destructor
+  virtual ~block_streaming_file() {};
+
+  /// get the record aligned range for this process.
+  range_type const & get_partition_range() const {
+    return partition_range_bytes;
+  }
+
+  /// get the block size.
+  size_t get_block_size() const {
+    return block_size;
+  }
+
+  /// change the target block size for the following blocks, e.g. by adaptive_block_size.  at least the record search window.
+  /// no effect in block cyclic mode.
+  void set_block_size(size_t const & _block_size) {
+    if (cyclic) return;
+    block_size = ::std::max(_block_size, static_cast<size_t>(search_window));
+  }
+
+  bool is_cyclic() const { return cyclic; }
+
+  /// check if there are more blocks in this process's partition.
+  bool has_next_block() const {
+    if (cyclic) return next_block < (this->file_range_bytes.size() + block_size - 1) / block_size;
+    return next_block_start < partition_range_bytes.end;
+  }
+
+  /// go back to first block.
+  void reset() {
+    next_block = this->comm.rank();
+    next_block_start = partition_range_bytes.start;
+  }
+
+  /// continue from pos, a block boundary of an earlier read of the same partition, e.g. to resume a build.  clamped to the partition.
+  /// in block cyclic mode, continue with the first block of this process that starts in the block grid at or after pos.
+  void seek(size_t const & pos) {
+    if (cyclic) {
+      size_t p = this->comm.size();
+      size_t first = (::std::max(pos, this->file_range_bytes.start) - this->file_range_bytes.start + block_size - 1) / block_size;
+      next_block = ((first + p - 1 - this->comm.rank()) / p) * p + this->comm.rank();
+      return;
+    }
+    next_block_start = ::std::min(::std::max(pos, partition_range_bytes.start), partition_range_bytes.end);
+  }
+
+  /**
+   * @brief  read the next record aligned block in the process's partition.  NOT collective.
+   * @note   parent range is set to the block's range, since block starts at a record start.
+   *         this allows a sequential parser to get the first record without searching.
+   * @param output   file_data object containing data and various ranges.
+   */
+  void read_next_block(::bliss::io::file_data & output) {
+    if (!has_next_block()) {
+      output.data.clear();
+      output.in_mem_range_bytes = output.valid_range_bytes = output.parent_range_bytes =
+          range_type(partition_range_bytes.end, partition_range_bytes.end);
+      return;
+    }
+
+    if (cyclic) {
+      // both ends move to the next record start, the same way for the neighboring blocks of the other processes.
+      // empty if a record spans the whole block.
+      size_t grid = this->file_range_bytes.start + next_block * block_size;
+      size_t start = (next_block == 0) ? grid : find_record_start(grid, this->file_range_bytes.end, output.data);
+      size_t end = find_record_start(::std::min(grid + block_size, this->file_range_bytes.end), this->file_range_bytes.end, output.data);
+      next_block_start = ::std::min(start, end);
+      next_block += this->comm.size();
+
+      range_type block(next_block_start, end);
+      output.in_mem_range_bytes = reader.read_range(output.data, block);
+      output.valid_range_bytes = output.in_mem_range_bytes;
+      output.parent_range_bytes = output.in_mem_range_bytes;
+      return;
+    }
+
+    // first find the block end.  block ends at a record start, or the partition end.
+    size_t end = ::std::min(next_block_start + block_size, partition_range_bytes.end);
+    end = find_record_start(end, partition_range_bytes.end, output.data);
+
+    // then read.
+    range_type block(next_block_start, end);
+    output.in_mem_range_bytes = reader.read_range(output.data, block);
+    output.valid_range_bytes = output.in_mem_range_bytes;
+    output.parent_range_bytes = output.in_mem_range_bytes;
+
+    next_block_start = end;
+  }
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /**
+   * @brief  read the range for this process.  reads all blocks at once.
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output,
+                                               range_type const & range_bytes) {
+    range_type target = range_type::intersect(range_bytes, partition_range_bytes);
+
+    return reader.read_range(output, target);
+  }
+
+  /**
+   * @brief  read any range of the file, e.g. the bytes before a FASTA block that start the kmers spanning it.  NOT collective.
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   */
+  virtual range_type read_file_range(typename ::bliss::io::file_data::container & output,
+                                     range_type const & range_bytes) {
+    return reader.read_range(output, range_type::intersect(range_bytes, this->file_range_bytes));
+  }
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_file;
+
+  /**
+   * @brief  read the process's whole partition
+   * @param output    file_data object containing data and various ranges.
+   */
+  virtual void read_file(::bliss::io::file_data & output) {
+    output.in_mem_range_bytes = reader.read_range(output.data, partition_range_bytes);
+    output.valid_range_bytes = output.in_mem_range_bytes;
+    output.parent_range_bytes = this->file_range_bytes;
+  }
+
+};
+
+
+/**
+ * @brief  block streaming file that reads the next block in a background thread while the current block is processed.
+ * @details  2 buffers are used:  the one returned to the caller, and the one being filled asynchronously.
+ *     read_next_block waits for the pending read, swaps the buffer with the caller's, then starts reading the following block.
+ *     the caller's file_data is swapped, not copied, so its allocated memory is reused for the next prefetch.
+ *     reads are done via FileReader's read_range, which uses pread or a private mapping, and is only accessed by the
+ *     background thread while a read is pending.
+ *
+ * @note   like block_streaming_file, only the constructor is collective.
+ */
+template <typename FileReader,
+          template <typename> class FileParser = ::bliss::io::FASTQParser,
+          typename BaseType = ::bliss::io::parallel::base_file >
+class prefetching_block_streaming_file : public block_streaming_file<FileReader, FileParser, BaseType> {
+
+protected:
+  using BASE = block_streaming_file<FileReader, FileParser, BaseType>;
+  using range_type = typename BASE::range_type;
+
+  /// buffer being filled in background.
+  ::bliss::io::file_data prefetched;
+
+  /// pending background read.  declared after buffer so it is destroyed (and waited on) first.
+  ::std::future<void> pending;
+
+  /// block size requested by set_block_size, applied when no read is pending.  0 if none.
+  size_t requested_block_size;
+
+  /// start reading the next block in the background, if there is one.
+  void prefetch() {
+    if (BASE::has_next_block()) {
+      pending = ::std::async(::std::launch::async, [this](){ this->BASE::read_next_block(this->prefetched); });
+    }
+  }
+
+  /// apply the block size requested during a pending read.  no read may be pending.
+  void apply_block_size() {
+    if (requested_block_size == 0) return;
+    BASE::set_block_size(requested_block_size);
+    requested_block_size = 0;
+  }
+
+  /// wait for the pending read, if any.  rethrows any exception from the background read.
+  void wait() {
+    if (pending.valid()) pending.get();
+  }
+
+public:
+
+  /**
+   * @brief constructor.  collectively compute the record aligned partition range for each process, then start reading the first block.
+   * @param _filename     name of file to open
+   * @param _block_size   target number of bytes to read per block.
+   * @param _comm         MPI communicator to use.
+   * @param _cyclic       block cyclic mode.  see block_streaming_file.
+   */
+  prefetching_block_streaming_file(std::string const & _filename, size_t const & _block_size, ::mxx::comm const & _comm = ::mxx::comm(),
+                                   bool const & _cyclic = false) :
+    BASE(_filename, _block_size, _comm, _cyclic), requested_block_size(0) {
+    prefetch();
+  };
+
+  /// destructor.  finish any pending read first.
+  virtual ~prefetching_block_streaming_file() {
+    if (pending.valid()) pending.wait();
+  };
+
+  /// check if there are more blocks in this process's partition.
+  bool has_next_block() const {
+    // if no read is pending, the background thread is not modifying the base class state.
+    return pending.valid() || BASE::has_next_block();
+  }
+
+  /// go back to first block.
+  void reset() {
+    wait();
+    apply_block_size();
+    BASE::reset();
+    prefetch();
+  }
+
+  /// continue from pos.  the prefetched block is dropped.  see block_streaming_file::seek.
+  void seek(size_t const & pos) {
+    wait();
+    apply_block_size();
+    BASE::seek(pos);
+    prefetch();
+  }
+
+  /**
+   * @brief  get the next record aligned block in the process's partition, and start reading the one after.  NOT collective.
+   * @param output   file_data object containing data and various ranges.  swapped with the internal buffer.
+   */
+  void read_next_block(::bliss::io::file_data & output) {
+    if (!pending.valid()) {
+      // nothing in flight, so already at end of partition.
+      BASE::read_next_block(output);
+      return;
+    }
+
+    pending.get();
+
+    ::std::swap(output.parent_range_bytes, prefetched.parent_range_bytes);
+    ::std::swap(output.in_mem_range_bytes, prefetched.in_mem_range_bytes);
+    ::std::swap(output.valid_range_bytes, prefetched.valid_range_bytes);
+    output.data.swap(prefetched.data);
+
+    apply_block_size();
+    prefetch();
+  }
+
+  /**
+   * @brief change the target block size.  the block being prefetched keeps the old size, so the new size applies from the block after it.
+   * @details  the background read uses the block size, so it is only changed between reads.
+   */
+  void set_block_size(size_t const & _block_size) {
+    if (pending.valid()) requested_block_size = _block_size;
+    else BASE::set_block_size(_block_size);
+  }
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /**
+   * @brief  read the range for this process.  waits for pending block read to avoid concurrent access to the reader.
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output,
+                                               range_type const & range_bytes) {
+    if (pending.valid()) pending.wait();
+    return this->BASE::read_range(output, range_bytes);
+  }
+
+  /// read any range of the file.  waits for pending block read.  see block_streaming_file::read_file_range.
+  virtual range_type read_file_range(typename ::bliss::io::file_data::container & output,
+                                     range_type const & range_bytes) {
+    if (pending.valid()) pending.wait();
+    return this->BASE::read_file_range(output, range_bytes);
+  }
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_file;
+
+  /**
+   * @brief  read the process's whole partition.  waits for pending block read to avoid concurrent access to the reader.
+   * @param output    file_data object containing data and various ranges.
+   */
+  virtual void read_file(::bliss::io::file_data & output) {
+    if (pending.valid()) pending.wait();
+    this->BASE::read_file(output);
+  }
+
+};
+
+
 /// disable shared fd for stdio file.
 template <template <typename> class FileParser>
 class partitioned_file<::bliss::io::stdio_file, FileParser, ::bliss::io::parallel::base_shared_fd_file >
@@ -1629,6 +2942,68 @@ class partitioned_file<::bliss::io::stdio_file, FileParser, ::bliss::io::paralle
 
 
 
+/**
+ * @brief MPI-IO hints and read strategy for mpiio_file.  hints that are 0 or empty are not set, so the MPI library's default is used.
+ * @details  the hints are the ROMIO ones, also recognized by the Lustre and GPFS drivers.  striping hints only have effect when
+ *           a file is created, so for reading they matter for the stripe size query, if at all.
+ */
+struct mpiio_policy {
+    /// how mpiio_file reads.  AUTOMATIC uses independent reads when each process reads at least independent_min_bytes.
+    enum read_mode { COLLECTIVE = 0, INDEPENDENT = 1, AUTOMATIC = 2 };
+
+    /// "striping_factor": number of storage targets (Lustre OSTs) to stripe over.
+    int striping_factor;
+    /// "striping_unit": stripe size in bytes.
+    size_t striping_unit;
+    /// "cb_nodes": number of collective buffering aggregators.  typically 1 per node, or striping_factor.
+    int cb_nodes;
+    /// "cb_buffer_size": aggregator buffer in bytes.  typically a multiple of the stripe size.
+    size_t cb_buffer_size;
+    /// "romio_cb_read": "enable", "disable", or "automatic".
+    ::std::string romio_cb_read;
+
+    /// read disjoint, stripe aligned blocks and exchange the overlap.  see mpiio_base_file::set_boundary_exchange.
+    bool align_to_stripes;
+    read_mode mode;
+    /// AUTOMATIC: minimum bytes per process for independent reads.  large contiguous reads gain nothing from aggregation.
+    size_t independent_min_bytes;
+    /// "romio_no_indep_rw": only the cb_nodes aggregators open the file, instead of all processes.  reads are then
+    /// always collective, regardless of mode.
+    bool deferred_open;
+
+    mpiio_policy() : striping_factor(0), striping_unit(0), cb_nodes(0), cb_buffer_size(0), romio_cb_read(),
+        align_to_stripes(false), mode(COLLECTIVE), independent_min_bytes(1UL << 30), deferred_open(false) {};
+
+    /// create an MPI_Info with the hints that are set.  MPI_INFO_NULL if none.  caller frees a non-null info.
+    MPI_Info create_info() const {
+      if ((striping_factor == 0) && (striping_unit == 0) && (cb_nodes == 0) && (cb_buffer_size == 0) && romio_cb_read.empty() &&
+          !deferred_open)
+        return MPI_INFO_NULL;
+
+      MPI_Info info;
+      MPI_Info_create(&info);
+      if (striping_factor > 0) MPI_Info_set(info, const_cast<char *>("striping_factor"), const_cast<char *>(::std::to_string(striping_factor).c_str()));
+      if (striping_unit > 0) MPI_Info_set(info, const_cast<char *>("striping_unit"), const_cast<char *>(::std::to_string(striping_unit).c_str()));
+      if (cb_nodes > 0) MPI_Info_set(info, const_cast<char *>("cb_nodes"), const_cast<char *>(::std::to_string(cb_nodes).c_str()));
+      if (cb_buffer_size > 0) MPI_Info_set(info, const_cast<char *>("cb_buffer_size"), const_cast<char *>(::std::to_string(cb_buffer_size).c_str()));
+      if (!romio_cb_read.empty()) MPI_Info_set(info, const_cast<char *>("romio_cb_read"), const_cast<char *>(romio_cb_read.c_str()));
+      // deferred open needs collective buffering for the reads.
+      if (deferred_open) {
+        MPI_Info_set(info, const_cast<char *>("romio_no_indep_rw"), const_cast<char *>("true"));
+        if (romio_cb_read.empty()) MPI_Info_set(info, const_cast<char *>("romio_cb_read"), const_cast<char *>("enable"));
+      }
+      return info;
+    }
+
+    /// true if the reads should be collective, for a file of file_size bytes read by nprocs processes.
+    bool use_collective(size_t const & file_size, int const & nprocs) const {
+      if (deferred_open) return true;
+      if (mode == AUTOMATIC) return (file_size / static_cast<size_t>(nprocs)) < independent_min_bytes;
+      return mode == COLLECTIVE;
+    }
+};
+
+
 // multilevel parallel file io relies on MPIIO.
 template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
 class mpiio_base_file : public ::bliss::io::base_file {
@@ -1650,6 +3025,79 @@ protected:
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<range_type> partitioner;
 
+	/// boundary exchange mode.  processes read disjoint stripe aligned ranges, and receive the overlap from the next processes.
+	bool exchange_overlap;
+
+	/// alignment of the partition boundaries in boundary exchange mode, in bytes.
+	size_t stripe_size;
+
+	/// message tag for the boundary exchange.
+	static constexpr int boundary_tag = 7607;
+
+	/// hints and read mode.
+	mpiio_policy policy;
+
+	/**
+	 * @brief block partition of target for a process, with the internal boundaries rounded up to stripe_size multiples.
+	 * @note  depends only on target and rank, so every process can compute the partition of its neighbors.
+	 */
+	range_type aligned_block(range_type const & target, int const & rank) {
+	  partitioner.configure(target, comm.size(), ::bliss::partition::rank_weights::instance().get(comm));
+	  range_type b = partitioner.getNext(rank);
+
+	  auto align = [this, &target](size_t const & x) {
+	    return ::std::min(target.end, ((x + stripe_size - 1) / stripe_size) * stripe_size);
+	  };
+	  return range_type((rank == 0) ? target.start : align(b.start),
+	                    (rank == (comm.size() - 1)) ? target.end : align(b.end));
+	}
+
+	/**
+	 * @brief append the ext bytes following this process's block to output, received from the processes that read them.
+	 * @details  point to point, usually from the next process only.  a block shorter than ext is forwarded to all
+	 *           earlier processes that need it.  the amounts are computed locally from the aligned partitions.
+	 * @param output    data of block, as read.  resized to include the received bytes.
+	 * @param target    the whole range that was partitioned.
+	 * @param block     this process's block of target.
+	 * @param ext       number of bytes to get after the end of block.
+	 */
+	void exchange_boundary(typename ::bliss::io::file_data::container & output, range_type const & target,
+	                       range_type const & block, size_t const & ext) {
+	  range_type need(block.end, ::std::min(target.end, block.end + ext));
+	  size_t offset = output.size();
+	  output.resize(offset + need.size());
+
+	  ::std::vector<MPI_Request> reqs;
+
+	  // receive from the next processes that own part of need.
+	  for (int src = comm.rank() + 1; src < comm.size(); ++src) {
+	    range_type b = aligned_block(target, src);
+	    if (b.start >= need.end) break;
+	    range_type x = range_type::intersect(b, need);
+	    if (x.size() == 0) continue;
+
+	    reqs.emplace_back();
+	    MPI_Irecv(output.data() + offset + (x.start - need.start), x.size(), MPI_BYTE, src, boundary_tag, comm, &(reqs.back()));
+	  }
+
+	  // send the prefix of block to the earlier processes that need it.
+	  for (int dest = comm.rank() - 1; dest >= 0; --dest) {
+	    range_type b = aligned_block(target, dest);
+	    if (b.end + ext <= block.start) break;
+	    range_type x = range_type::intersect(range_type(b.end, ::std::min(target.end, b.end + ext)), block);
+	    if (x.size() == 0) continue;
+
+	    reqs.emplace_back();
+	    MPI_Isend(output.data() + (x.start - block.start), x.size(), MPI_BYTE, dest, boundary_tag, comm, &(reqs.back()));
+	  }
+
+	  if (reqs.size() > 0) {
+	    int res = MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+	    if (res != MPI_SUCCESS)
+	      throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("boundary exchange", res));
+	  }
+	}
+
 	std::string get_error_string(std::string const & op_name, int const & return_val) {
 		char error_string[BUFSIZ];
 		int length_of_error_string, error_class;
@@ -1712,8 +3160,10 @@ protected:
 	// first clear previously open file
 		close_file();
 
-		// open the file
-		int res = MPI_File_open(this->comm, const_cast<char *>(this->filename.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+		// open the file, with the policy's hints.
+		MPI_Info info = policy.create_info();
+		int res = MPI_File_open(this->comm, const_cast<char *>(this->filename.c_str()), MPI_MODE_RDONLY, info, &fh);
+		if (info != MPI_INFO_NULL) MPI_Info_free(&info);
 
 		if (res != MPI_SUCCESS) {
 			throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("open", res));
@@ -1758,18 +3208,24 @@ public:
 		}
 
 		// ensure valid range is used.
-		range_type target =
+		range_type whole =
 				BASE::range_type::intersect(range_bytes, this->file_range_bytes);
+		range_type target = whole;
+
+		bool exchange = exchange_overlap && (comm.size() > 1);
 
 		// do equal partition
-		if (comm.size() > 1) {
-			partitioner.configure(target, comm.size());
+		if (exchange) {
+		  target = aligned_block(whole, comm.rank());
+		} else if (comm.size() > 1) {
+			partitioner.configure(target, comm.size(), ::bliss::partition::rank_weights::instance().get(comm));
 			target = partitioner.getNext(comm.rank());
 		}
 
 		// compute the size to read.
+		size_t ext = std::is_same<FileParser<typename bliss::io::file_data::const_iterator>, ::bliss::io::FASTAParser<typename bliss::io::file_data::const_iterator> >::value ? 2 * this->overlap : this->overlap;
 		range_type read_range = target;
-		read_range.end += std::is_same<FileParser<typename bliss::io::file_data::const_iterator>, ::bliss::io::FASTAParser<typename bliss::io::file_data::const_iterator> >::value ? 2 * this->overlap : this->overlap;
+		if (!exchange) read_range.end += ext;
 		read_range.intersect(this->file_range_bytes);
 
 		output.resize(read_range.size());    // set size for reading.
@@ -1780,6 +3236,8 @@ public:
 		// NOTE:  file offset is in units of byte (up to size_t).  number of elements to read has type int.
 
 		size_t step_size = 1UL << 30 ;  // using 2^30 vs 2^31-2^15 does not make a huge performance difference (will only matter for low proc count anyways)
+		// whole stripes per step, so that aligned blocks stay aligned.
+		if (stripe_size < step_size) step_size -= step_size % stripe_size;
 		size_t rem = read_range.size() % step_size;
 //	size_t steps = read_range.size() / step_size;
 		int count = 0;
@@ -1864,15 +3322,19 @@ public:
 
 // ===========  iterative works
 		size_t iter_step_size;
-		// since collective, first get the maximum read size.
+		bool collective = policy.use_collective(this->file_range_bytes.size(), comm.size());
+
+		// if collective, first get the maximum read size.
 		size_t max_read_size = read_range.size();
-		max_read_size = ::mxx::allreduce(max_read_size, [](size_t const & x, size_t const & y){
-		  return ::std::max(x, y);
-		}, this->comm);
+		if (collective) {
+			max_read_size = ::mxx::allreduce(max_read_size, [](size_t const & x, size_t const & y){
+			  return ::std::max(x, y);
+			}, this->comm);
+		}
 
 		// compute the steps for from the max and local_steps
-		size_t steps = (max_read_size + step_size - 1) >> 30;
-    size_t local_full_steps = read_range.size() >> 30;
+		size_t steps = (max_read_size + step_size - 1) / step_size;
+    size_t local_full_steps = read_range.size() / step_size;
 		size_t offset = 0;
 
 		for (size_t s = 0; s < steps; ++s) {
@@ -1883,8 +3345,12 @@ public:
 		  iter_step_size = (s < local_full_steps) ? step_size :
 		      (s == local_full_steps) ? rem : 0;
 
-			res = MPI_File_read_at_all(fh, read_range.start + offset, output.data() + offset,
-			                           iter_step_size, MPI_BYTE, &stat);
+			if (collective)
+				res = MPI_File_read_at_all(fh, read_range.start + offset, output.data() + offset,
+				                           iter_step_size, MPI_BYTE, &stat);
+			else
+				res = MPI_File_read_at(fh, read_range.start + offset, output.data() + offset,
+				                       iter_step_size, MPI_BYTE, &stat);
 			offset += iter_step_size;
 
 			if (res != MPI_SUCCESS)
@@ -1905,17 +3371,80 @@ public:
 
 //		std::cout << "rank " << comm.rank() << " done reading " << read_range << std::endl;
 
+		// get the overlap from the neighbors instead of reading it again.
+		if (exchange) exchange_boundary(output, whole, target, ext);
+
 		return target;
 	}
 
+	/**
+	 * @brief  enable or disable boundary exchange mode.  collective, since all processes must use the same partitions.
+	 * @details  by default each process reads its block plus the overlap, so the overlap is read twice and the reads
+	 *           are not aligned to the file system stripes.  in boundary exchange mode, the blocks are disjoint,
+	 *           with boundaries at multiples of the stripe size, and the overlap is sent by the processes that read it.
+	 * @param enable   true to read disjoint aligned blocks and exchange the overlap
+	 * @param stripe   alignment in bytes.  0 uses the "striping_unit" hint of the file if set, else 1MB.
+	 */
+	void set_boundary_exchange(bool const & enable, size_t const & stripe = 0UL) {
+	  exchange_overlap = enable;
+	  stripe_size = (stripe == 0) ? get_stripe_size() : stripe;
+	}
+
+	/**
+	 * @brief  get the stripe size of the open file from its "striping_unit" hint.  collective.
+	 * @return stripe size in bytes, same on all processes.  1MB if the file system does not report it.
+	 */
+	size_t get_stripe_size() {
+	  size_t unit = 0;
+
+	  MPI_Info info;
+	  if (MPI_File_get_info(fh, &info) == MPI_SUCCESS) {
+	    char value[MPI_MAX_INFO_VAL + 1];
+	    int flag = 0;
+	    MPI_Info_get(info, const_cast<char *>("striping_unit"), MPI_MAX_INFO_VAL, value, &flag);
+	    if (flag) unit = ::std::strtoul(value, nullptr, 10);
+	    MPI_Info_free(&info);
+	  }
+	  if (unit == 0) unit = 1UL << 20;
 
-	mpiio_base_file(::std::string const & _filename, size_t const _overlap = 0UL,  ::mxx::comm const & _comm = ::mxx::comm()) :
+	  // hints may differ between processes.  use rank 0's.
+	  MPI_Bcast(&unit, 1, MPI_UNSIGNED_LONG, 0, comm);
+	  return unit;
+	}
+
+	/**
+	 * @brief  set the MPI-IO hints and read mode.  collective.  the file is reopened with the hints, so call before reading.
+	 * @details  if policy.align_to_stripes, boundary exchange mode is enabled with the stripe size reported by the file system,
+	 *           and the read steps are whole stripes.
+	 */
+	void set_io_policy(mpiio_policy const & _policy) {
+	  policy = _policy;
+	  this->open_file();
+
+	  if (policy.align_to_stripes) set_boundary_exchange(true);
+	}
+
+	mpiio_policy const & get_io_policy() const {
+	  return policy;
+	}
+
+
+	/**
+	 * @note  the size comes from 1 stat on rank 0 (see stat_files), which also checks the file before the collective open,
+	 *        so a missing file throws the same IOException on all processes.  with _policy.deferred_open, only the
+	 *        aggregators call open.  the policy is given here so the file is not opened twice, as with set_io_policy.
+	 */
+	mpiio_base_file(::std::string const & _filename, size_t const _overlap = 0UL,  ::mxx::comm const & _comm = ::mxx::comm(),
+	                mpiio_policy const & _policy = mpiio_policy()) :
 	  BASE(static_cast<int>(-1), static_cast<size_t>(0)),
 	 	 overlap(_overlap),
-				  comm(_comm.copy()), fh(MPI_FILE_NULL) {
+				  comm(_comm.copy()), fh(MPI_FILE_NULL), exchange_overlap(false), stripe_size(1UL << 20), policy(_policy) {
 		this->filename = _filename;
+		this->file_range_bytes.end = ::bliss::io::parallel::stat_files(::std::vector<::std::string>(1, this->filename), comm,
+		                                                               "bliss::io::parallel::mpiio_base_file")[0];
 	  this->open_file();
-		this->file_range_bytes.end = this->get_file_size();  // call after opening file
+
+	  if (policy.align_to_stripes) set_boundary_exchange(true);
 	};
 
 	~mpiio_base_file() { this->close_file(); };
@@ -1943,8 +3472,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, _overlap, _comm) {};
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_policy const & _policy = mpiio_policy()) :
+			BASE(_filename, _overlap, _comm, _policy) {};
 
 		~mpiio_file() {};
 
@@ -1998,8 +3528,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, 0UL, _comm) {};      // specify 1 page worth as overlap
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_policy const & _policy = mpiio_policy()) :
+			BASE(_filename, 0UL, _comm, _policy) {};      // specify 1 page worth as overlap
 
 		~mpiio_file() { };
 
@@ -2121,8 +3652,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, _overlap, _comm) {};      // specify 1 page worth as overlap
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_policy const & _policy = mpiio_policy()) :
+			BASE(_filename, _overlap, _comm, _policy) {};      // specify 1 page worth as overlap
 
 		~mpiio_file() { };
 
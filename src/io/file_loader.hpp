@@ -49,12 +49,19 @@
 
 #include <sys/sysinfo.h>  // for meminfo
 #include <type_traits>
+#include <iterator>     // iterator_traits
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <x86intrin.h>   // all intrinsics.  will be enabled based on compiler flag such as __AVX2__ internally.
+#endif
 
 #include "partition/range.hpp"
 #include "partition/partitioner.hpp"
 //#include "io/data_block.hpp"
 #include "io/io_exception.hpp"
 #include "utils/logging.h"
+#include "utils/file_utils.hpp"
 #include "common/sequence.hpp"
 #include <mxx/comm.hpp> // for mxx::comm
 
@@ -131,6 +138,92 @@ namespace io
         */
       using RangeType = bliss::partition::range<size_t>;
 
+      /// iterator over contiguous chars in memory (pointers and vector iterators), for which vectorized search can be used.
+      template <typename IT>
+      using is_contiguous_char_iterator = ::bliss::utils::file::is_contiguous_char_iterator<IT>;
+
+      /**
+       * @brief  find the position of the first EOL or CR character in a contiguous char array.
+       * @details  compares 32 (AVX2) or 16 (SSE2) bytes at a time, then scans the remainder.
+       * @return  position of the first EOL or CR char, or len if not found.
+       */
+      static inline size_t find_eol_pos(unsigned char const * ptr, size_t const & len) {
+        size_t i = 0;
+        unsigned int mask;
+
+#if defined(__AVX2__)
+        const __m256i eol32 = _mm256_set1_epi8(static_cast<char>(eol));
+        const __m256i cr32 = _mm256_set1_epi8(static_cast<char>(cr));
+        __m256i v32;
+        for (; (i + 32) <= len; i += 32) {
+          v32 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ptr + i));
+          mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v32, eol32), _mm256_cmpeq_epi8(v32, cr32))));
+          if (mask != 0) return i + __builtin_ctz(mask);
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i eol16 = _mm_set1_epi8(static_cast<char>(eol));
+        const __m128i cr16 = _mm_set1_epi8(static_cast<char>(cr));
+        __m128i v16;
+        for (; (i + 16) <= len; i += 16) {
+          v16 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(ptr + i));
+          mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v16, eol16), _mm_cmpeq_epi8(v16, cr16))));
+          if (mask != 0) return i + __builtin_ctz(mask);
+        }
+#endif
+        BLISS_UNUSED(mask);
+
+        for (; i < len; ++i) {
+          if ((ptr[i] == eol) || (ptr[i] == cr)) return i;
+        }
+        return len;
+      }
+
+      /// search for first EOL character, 1 char at a time.
+      template <typename IT>
+      inline IT findEOL_impl(IT& iter, const IT& end, size_t &offset, ::std::false_type const &) const {
+        while ((iter != end) && ((*iter != eol) && (*iter != cr) ) ) {
+          ++iter;
+          ++offset;
+        }
+        return iter;
+      }
+
+      /// search for first EOL character in contiguous memory, vectorized.
+      template <typename IT>
+      inline IT findEOL_impl(IT& iter, const IT& end, size_t &offset, ::std::true_type const &) const {
+        if (iter == end) return iter;
+
+        size_t pos = find_eol_pos(reinterpret_cast<unsigned char const *>(&(*iter)), ::std::distance(iter, end));
+        ::std::advance(iter, pos);
+        offset += pos;
+        return iter;
+      }
+
+      /// search for the first occurrence of character c, 1 char at a time.
+      template <typename IT>
+      inline IT findChar_impl(IT& iter, const IT& end, size_t &offset, unsigned char const c, ::std::false_type const &) const {
+        while ((iter != end) && (*iter != c)) {
+          ++iter;
+          ++offset;
+        }
+        return iter;
+      }
+
+      /// search for the first occurrence of character c in contiguous memory, via memchr (vectorized in libc).
+      template <typename IT>
+      inline IT findChar_impl(IT& iter, const IT& end, size_t &offset, unsigned char const c, ::std::true_type const &) const {
+        if (iter == end) return iter;
+
+        size_t len = ::std::distance(iter, end);
+        unsigned char const * ptr = reinterpret_cast<unsigned char const *>(&(*iter));
+        void const * found = memchr(ptr, c, len);
+        size_t pos = (found == nullptr) ? len : (reinterpret_cast<unsigned char const *>(found) - ptr);
+        ::std::advance(iter, pos);
+        offset += pos;
+        return iter;
+      }
+
        /**
         * @brief  search for first non-EOL character in a iterator, returns the stopping position as an iterator.  also records offset.
         * @details       iter can point to the previous EOL, or a nonEOL character.
@@ -164,11 +257,23 @@ namespace io
                                                 ::std::is_same<typename ::std::iterator_traits<IT>::value_type, unsigned char>::value)
                                                >::type >
        inline IT findEOL(IT& iter, const IT& end, size_t &offset) const {
-         while ((iter != end) && ((*iter != eol) && (*iter != cr) ) ) {
-           ++iter;
-           ++offset;
-         }
-         return iter;
+         return findEOL_impl(iter, end, offset, typename is_contiguous_char_iterator<IT>::type());
+       }
+
+       /**
+        * @brief  search for first occurrence of character c in a iterator, returns the stopping position as an iterator.  also records offset.
+        * @param[in/out] iter    iterator to advance
+        * @param[in]     end     position to stop the traversal
+        * @param[in/out] offset  the global offset of the sequence record within the file.
+        * @param[in]     c       character to search for.
+        * @return        iterator at the new position, where c is found, or end.
+        */
+       template <typename IT = Iterator,
+           typename = typename ::std::enable_if<(::std::is_same<typename ::std::iterator_traits<IT>::value_type, char>::value ||
+                                                ::std::is_same<typename ::std::iterator_traits<IT>::value_type, unsigned char>::value)
+                                               >::type >
+       inline IT findChar(IT& iter, const IT& end, size_t &offset, unsigned char const c) const {
+         return findChar_impl(iter, end, offset, c, typename is_contiguous_char_iterator<IT>::type());
        }
 
 
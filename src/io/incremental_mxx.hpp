@@ -28,15 +28,30 @@
 
 
 #include <algorithm>
+#include <cmath>    // sqrt
+#include <type_traits>  // integral_constant
+#include <utility>  // declval
 #include <mxx/datatypes.hpp>
 #include <mxx/comm.hpp>
 #include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
 #include <mxx/samplesort.hpp>
 
+#if defined(USE_OPENMP)
+#include "omp.h"
+#endif
+
 #include "utils/benchmark_utils.hpp"
 #include "utils/function_traits.hpp"
+#include "io/comm_stats.hpp"
+#include "io/sparse_all2allv.hpp"
+#include "io/persistent_all2all.hpp"
+#include "io/large_all2allv.hpp"
+#include "io/byte_transport.hpp"
+#include "io/comm_schedule.hpp"
 
 #include "containers/fsc_container_utils.hpp"
+#include "containers/multiway_merge.hpp"
 
 namespace imxx
 {
@@ -270,6 +285,55 @@ namespace imxx
      * @param first         first position to bucket in input
      * @param last          last position to bucket in input
      */
+    /// detect key functions with a batch interface, i.e. key_func(T const * input, size_t count, SIZE * bucket_ids)
+    template <typename Func, typename T, typename SIZE>
+    struct is_batch_key_func {
+      protected:
+        template <typename F>
+        static constexpr auto check(F const * f) ->
+            decltype((*f)(::std::declval<T const *>(), ::std::declval<size_t const &>(), ::std::declval<SIZE *>()), bool()) { return true; }
+        template <typename F>
+        static constexpr bool check(...) { return false; }
+      public:
+        static constexpr bool value = check<Func>(nullptr);
+    };
+
+    /// compute bucket ids for input in [first, last), one element at a time.
+    template <typename T, typename Func, typename SIZE>
+    inline void compute_bucket_ids(std::vector<T> const & input, Func const & key_func,
+                                   std::vector<SIZE> & ids, size_t const & first, size_t const & last,
+                                   ::std::false_type) {
+      for (size_t i = first; i < last; ++i) {
+        ids[i] = key_func(input[i]);
+      }
+    }
+    /// compute bucket ids for input in [first, last) via the key function's batch interface.
+    template <typename T, typename Func, typename SIZE>
+    inline void compute_bucket_ids(std::vector<T> const & input, Func const & key_func,
+                                   std::vector<SIZE> & ids, size_t const & first, size_t const & last,
+                                   ::std::true_type) {
+      key_func(input.data() + first, last - first, ids.data() + first);
+    }
+
+    /// number of threads for local bucketing and permutation in the collectives.  omp_get_max_threads() with USE_OPENMP, else 1.
+    inline int get_bucketing_threads() {
+#if defined(USE_OPENMP)
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    /// number of threads to use for len entries, so each thread has at least one block of 16K entries.
+    inline int get_bucketing_threads(int const & nthreads, size_t const & len) {
+#if defined(USE_OPENMP)
+      return static_cast<int>(std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(std::max(1, nthreads)), len >> 14)));
+#else
+      return 1;
+#endif
+    }
+
+    /// @param nthreads   threads for the counting pass.  key_func is then called concurrently, so should not have mutable state.
     template <typename T, typename Func, typename SIZE = size_t>
     void
     assign_to_buckets(std::vector<T> const & input,
@@ -278,7 +342,8 @@ namespace imxx
                       std::vector<SIZE> & bucket_sizes,
                       std::vector<SIZE> & i2o,
                       size_t first = 0,
-                      size_t last = std::numeric_limits<size_t>::max()) {
+                      size_t last = std::numeric_limits<size_t>::max(),
+                      int nthreads = 1) {
         bucket_sizes.clear();
 
         // no bucket.
@@ -306,16 +371,42 @@ namespace imxx
         }
 
 
+        int nt = get_bucketing_threads(nthreads, l - f);
+        if (nt > 1) {
+          // threaded: each thread assigns a block and keeps its own histogram.
+          size_t block = (l - f + nt - 1) / nt;
+          std::vector<SIZE> counts(nt * num_buckets, 0);
+
+#pragma omp parallel for num_threads(nt) schedule(static, 1)
+          for (int t = 0; t < nt; ++t) {
+            size_t bf = std::min(l, f + t * block);
+            size_t bl = std::min(l, bf + block);
+            compute_bucket_ids(input, key_func, i2o, bf, bl,
+                               ::std::integral_constant<bool, is_batch_key_func<Func, T, SIZE>::value>());
+            SIZE * cnt = counts.data() + t * num_buckets;
+            for (size_t i = bf; i < bl; ++i) {
+              assert((i2o[i] < num_buckets) && "assigned bucket id is not valid");
+
+              ++cnt[i2o[i]];
+            }
+          }
+
+          for (int t = 0; t < nt; ++t) {
+            for (size_t b = 0; b < num_buckets; ++b) {
+              bucket_sizes[b] += counts[t * num_buckets + b];
+            }
+          }
+          return;
+        }
+
         // [1st pass]: compute bucket counts and input2bucket assignment.
-        // store input2bucket assignment in i2o temporarily.
-        size_t p;
+        // store input2bucket assignment in i2o temporarily.  key functions with a batch interface compute all assignments first.
+        compute_bucket_ids(input, key_func, i2o, f, l,
+                           ::std::integral_constant<bool, is_batch_key_func<Func, T, SIZE>::value>());
         for (size_t i = f; i < l; ++i) {
-            p = key_func(input[i]);
+            assert((i2o[i] < num_buckets) && "assigned bucket id is not valid");
 
-            assert(((0 <= p) && ((size_t)p < num_buckets)) && "assigned bucket id is not valid");
-
-            i2o[i] = p;
-            ++bucket_sizes[p];
+            ++bucket_sizes[i2o[i]];
         }
 
     }
@@ -363,6 +454,119 @@ namespace imxx
       bucket_sizes[0] -= f;
     }
 
+    /**
+     * @brief  radix scatter: convert bucket ids in i2o to output positions, and copy input into bucketed order in output.
+     * @details  fused, cache blocked version of bucket_to_permutation followed by permute.  i2o and bucket_sizes on return
+     *          are the same as from those 2 calls (i.e. a stable counting sort), so distribute and undistribute are unaffected.
+     *
+     *          [first, last) is split into one block per thread.  each thread counts its block per bucket, and the output offsets are
+     *          assigned bucket major, so a thread's entries for a bucket are contiguous in output and the order is stable.
+     *          with many buckets, the scattered writes go to many cache lines and pages at once, so entries are first staged in a small
+     *          buffer per bucket (software write combining) and written out a few cache lines at a time.
+     *
+     * @param input               entries to bucket.  only [first, last) is read.
+     * @param bucket_sizes[in]    bucket counts for [first, last), from assign_to_buckets.  not modified.
+     * @param i2o[in/out]         bucket ids from assign_to_buckets, replaced by output positions in [first, last).
+     * @param output[out]         bucketed entries, written in [first, last).  resized to input.size() if smaller.  should not be input.
+     * @param nthreads            number of threads.  1 if USE_OPENMP is not defined.
+     */
+    template <typename T, typename SIZE = size_t>
+    void
+    radix_scatter(std::vector<T> const & input,
+                  std::vector<SIZE> const & bucket_sizes,
+                  std::vector<SIZE> & i2o,
+                  std::vector<T> & output,
+                  size_t first = 0,
+                  size_t last = std::numeric_limits<size_t>::max(),
+                  int nthreads = 1) {
+
+      // no bucket.
+      if (bucket_sizes.size() == 0) throw std::invalid_argument("bucket_sizes has 0 buckets.");
+      assert(((input.size() == 0) || (input.data() != output.data())) &&
+          "input and output should not be the same.");
+
+      // ensure valid range
+      size_t f = std::min(first, std::min(input.size(), i2o.size()));
+      size_t l = std::min(last, std::min(input.size(), i2o.size()));
+      assert((f <= l) && "first should not exceed last" );
+
+      if (f == l) return;  // no data in question.
+
+      if (output.size() < input.size()) output.resize(input.size());
+
+      size_t const nb = bucket_sizes.size();
+      int const nt = get_bucketing_threads(nthreads, l - f);
+      size_t const block = (l - f + nt - 1) / nt;
+
+      // per thread output offsets, thread major.  single thread can use the bucket sizes directly.
+      std::vector<SIZE> offsets(nt * nb, 0);
+      if (nt > 1) {
+#pragma omp parallel for num_threads(nt) schedule(static, 1)
+        for (int t = 0; t < nt; ++t) {
+          SIZE * cnt = offsets.data() + t * nb;
+          for (size_t i = std::min(l, f + t * block), max = std::min(l, f + (t + 1) * block); i < max; ++i) {
+            ++cnt[i2o[i]];
+          }
+        }
+      } else {
+        std::copy(bucket_sizes.begin(), bucket_sizes.end(), offsets.begin());
+      }
+
+      // exclusive prefix sum, bucket major, offset by f.
+      SIZE total = f, c;
+      for (size_t b = 0; b < nb; ++b) {
+        for (int t = 0; t < nt; ++t) {
+          c = offsets[t * nb + b];
+          offsets[t * nb + b] = total;
+          total += c;
+        }
+      }
+      assert((total == l) && "bucket sizes do not add up to the range");
+
+      // staging buffer per bucket, about 4 cache lines.  pays off with more buckets than there are write combining streams,
+      // as long as the buffers of a thread stay in cache (<= 1MB).  1-thread 16M pairs of uint64: ~1.4x faster for 256 to 4096 buckets.
+      size_t const swc_len = std::max(static_cast<size_t>(1), static_cast<size_t>(256 / sizeof(T)));
+      bool const swc = (nb > 64) && ((nb * swc_len * sizeof(T)) <= (1UL << 20));
+
+#pragma omp parallel num_threads(nt)
+      {
+        int t = 0;
+#if defined(USE_OPENMP)
+        t = omp_get_thread_num();
+#endif
+        SIZE * off = offsets.data() + t * nb;
+        size_t bf = std::min(l, f + t * block);
+        size_t bl = std::min(l, bf + block);
+
+        if (swc) {
+          std::vector<T> buf(nb * swc_len);
+          std::vector<size_t> fill(nb, 0);
+          SIZE b, pos;
+          for (size_t i = bf; i < bl; ++i) {
+            b = i2o[i];
+            pos = off[b]++;
+            i2o[i] = pos;
+            buf[b * swc_len + fill[b]] = input[i];
+            if ((++fill[b]) == swc_len) {
+              std::copy(buf.begin() + b * swc_len, buf.begin() + (b + 1) * swc_len, output.begin() + (pos + 1 - swc_len));
+              fill[b] = 0;
+            }
+          }
+          // flush partially filled buffers.
+          for (b = 0; b < nb; ++b) {
+            std::copy(buf.begin() + b * swc_len, buf.begin() + b * swc_len + fill[b], output.begin() + (off[b] - fill[b]));
+          }
+        } else {
+          SIZE pos;
+          for (size_t i = bf; i < bl; ++i) {
+            pos = off[i2o[i]]++;
+            i2o[i] = pos;
+            output[pos] = input[i];
+          }
+        }
+      }
+    }
+
 //    template <typename SIZE = size_t>
 //    void
 //    permutation_to_bucket(std::vector<SIZE> & bucket_sizes,
@@ -893,6 +1097,155 @@ namespace imxx
 
 
 
+    /**
+     * @brief group input by bucket in place (american flag sort), with no mapping array.  not stable.
+     * @details  to_rank is called about twice per element, once to count and once when the element is moved.
+     * @param[out] bucket_sizes   elements per bucket.
+     */
+    template <typename V, typename ToRank, typename SIZE>
+    void bucket_inplace(std::vector<V> & input, ToRank const & to_rank, size_t const & num_buckets,
+                        std::vector<SIZE> & bucket_sizes) {
+      bucket_sizes.assign(num_buckets, 0);
+      for (auto const & x : input) ++bucket_sizes[to_rank(x)];
+
+      std::vector<size_t> next(num_buckets, 0), end(num_buckets, 0);
+      size_t offset = 0;
+      for (size_t b = 0; b < num_buckets; ++b) {
+        next[b] = offset;
+        offset += bucket_sizes[b];
+        end[b] = offset;
+      }
+
+      for (size_t b = 0; b < num_buckets; ++b) {
+        while (next[b] < end[b]) {
+          V v = std::move(input[next[b]]);
+          size_t d = to_rank(v);
+          // follow the cycle until an element for bucket b comes back.
+          while (d != b) {
+            std::swap(v, input[next[d]++]);
+            d = to_rank(v);
+          }
+          input[next[b]++] = std::move(v);
+        }
+      }
+    }
+
+
+    //===  sorted delta + varint encoding of bucketed entries, for the compressed distribute.
+
+    /**
+     * @brief word view of a bitwise copyable type, e.g. the packed words of a Kmer, for sorting and delta encoding.
+     * @details  sizeof(T) is split into the largest of 8, 4, 2, 1 byte words that divides it.  entries compare as unsigned
+     *          integers, with the last word most significant, consistent with the delta encoding.
+     */
+    template <typename T>
+    struct word_view {
+        // Kmer has user defined copy, so only the layout can be checked.
+        static_assert(::std::is_standard_layout<T>::value, "word_view requires a bitwise copyable type");
+
+        using word_type = typename ::std::conditional<(sizeof(T) % 8) == 0, uint64_t,
+                          typename ::std::conditional<(sizeof(T) % 4) == 0, uint32_t,
+                          typename ::std::conditional<(sizeof(T) % 2) == 0, uint16_t, uint8_t>::type>::type>::type;
+        static constexpr size_t nwords = sizeof(T) / sizeof(word_type);
+
+        static inline void get(T const & x, word_type * w) {
+          memcpy(w, &x, sizeof(T));
+        }
+        static inline void set(word_type const * w, T & x) {
+          memcpy(&x, w, sizeof(T));
+        }
+        inline bool operator()(T const & x, T const & y) const {
+          word_type wx[nwords], wy[nwords];
+          get(x, wx);
+          get(y, wy);
+          for (size_t j = nwords; j > 0; --j) {
+            if (wx[j-1] != wy[j-1]) return wx[j-1] < wy[j-1];
+          }
+          return false;
+        }
+    };
+
+    /// append v as a LEB128 varint.
+    inline void varint_encode(uint64_t v, std::vector<uint8_t> & out) {
+      while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+      }
+      out.push_back(static_cast<uint8_t>(v));
+    }
+
+    /// decode a LEB128 varint at in, advancing in.
+    inline uint64_t varint_decode(uint8_t const * & in) {
+      uint64_t v = 0;
+      int shift = 0;
+      while ((*in) & 0x80) {
+        v |= static_cast<uint64_t>((*in) & 0x7F) << shift;
+        shift += 7;
+        ++in;
+      }
+      v |= static_cast<uint64_t>(*in) << shift;
+      ++in;
+      return v;
+    }
+
+    /**
+     * @brief encode a range sorted by word_view<T>, appending to out.
+     * @details  words are visited from the most significant.  while all higher words equal those of the previous entry, the word is
+     *          written as the (nonnegative) difference to the previous entry's word; after the first nonzero difference, the remaining
+     *          words are written as is.  repeated entries take 1 byte per word, and close entries few bytes.
+     */
+    template <typename IT>
+    void delta_encode(IT first, IT last, std::vector<uint8_t> & out) {
+      using T = typename std::iterator_traits<IT>::value_type;
+      using W = typename word_view<T>::word_type;
+      constexpr size_t nw = word_view<T>::nwords;
+
+      W prev[nw], curr[nw];
+      memset(prev, 0, sizeof(W) * nw);
+      bool same;
+      for (; first != last; ++first) {
+        word_view<T>::get(*first, curr);
+        same = true;
+        for (size_t j = nw; j > 0; --j) {
+          if (same) {
+            assert((curr[j-1] >= prev[j-1]) && "delta_encode input is not sorted");
+            varint_encode(static_cast<uint64_t>(curr[j-1] - prev[j-1]), out);
+            same = (curr[j-1] == prev[j-1]);
+          } else {
+            varint_encode(static_cast<uint64_t>(curr[j-1]), out);
+          }
+        }
+        memcpy(prev, curr, sizeof(W) * nw);
+      }
+    }
+
+    /// decode count entries from in, written to output.  returns the position after the last byte read.
+    template <typename OT>
+    uint8_t const * delta_decode(uint8_t const * in, size_t const & count, OT output) {
+      using T = typename std::iterator_traits<OT>::value_type;
+      using W = typename word_view<T>::word_type;
+      constexpr size_t nw = word_view<T>::nwords;
+
+      W prev[nw];
+      memset(prev, 0, sizeof(W) * nw);
+      uint64_t v;
+      bool same;
+      for (size_t i = 0; i < count; ++i, ++output) {
+        same = true;
+        for (size_t j = nw; j > 0; --j) {
+          v = varint_decode(in);
+          if (same) {
+            prev[j-1] += static_cast<W>(v);
+            same = (v == 0);
+          } else {
+            prev[j-1] = static_cast<W>(v);
+          }
+        }
+        word_view<T>::set(prev, *output);
+      }
+      return in;
+    }
+
   } // local namespace
 
 
@@ -986,8 +1339,21 @@ namespace imxx
     assert((input.size() >= (send_offset + send_count * comm.size())) && "input for block_all2all not big enough");
     assert((output.size() >= (recv_offset + send_count * comm.size())) && "output for block_all2all not big enough");
 
+    // with an installed schedule, pairwise in schedule order.
+    if (comm_scheduler::instance().installed(comm)) {
+      pairwise_schedule const sched = comm_scheduler::instance().get(comm);
+      mxx::datatype dt = mxx::get_datatype<T>().contiguous(send_count);
+      for (int i = 0; i < comm.size(); ++i) {
+        int dst = sched.dst(i);
+        int src = sched.src(i);
+        MPI_Sendrecv(const_cast<T*>(&(input[send_offset + dst * send_count])), 1, dt.type(), dst, 0,
+                     &(output[recv_offset + src * send_count]), 1, dt.type(), src, 0, comm, MPI_STATUS_IGNORE);
+      }
+      return;
+    }
+
     // send via mxx all2all - leverage any large message support from mxx.  (which uses datatype.contiguous() to increase element size and reduce element count to 1)
-    ::mxx::all2all(&(input[send_offset]), send_count, &(output[recv_offset]), comm);
+    ::imxx::payload_all2all(&(input[send_offset]), send_count, &(output[recv_offset]), comm);
   }
 
   /**
@@ -1035,18 +1401,22 @@ namespace imxx
    * @brief distribute function.  input is transformed, but remains the original input with original order.  buffer is used for output.
    * @details
    * @tparam SIZE     type for the i2o mapping and recv counts.  should be large enough to represent max of input.size() and output.size()
+   * @param pex       optional persistent exchange, for repeated calls.  used unless the sparse exchange applies.
    */
   template <typename V, typename ToRank, typename SIZE>
   void distribute(::std::vector<V>& input, ToRank const & to_rank,
                   ::std::vector<SIZE> & recv_counts,
                   ::std::vector<SIZE> & i2o,
                   ::std::vector<V>& output,
-                  ::mxx::comm const &_comm, bool const & preserve_input = false) {
+                  ::mxx::comm const &_comm, bool const & preserve_input = false,
+                  persistent_exchange * pex = nullptr) {
     BL_BENCH_INIT(distribute);
 
     BL_BENCH_COLLECTIVE_START(distribute, "empty", _comm);
-    bool empty = input.size() == 0;
-    empty = mxx::all_of(empty);
+    // the global count bounds every message and receive buffer.
+    size_t global_count = mxx::allreduce(input.size(), _comm);
+    bool empty = (global_count == 0);
+    bool large = large_count::instance().is_large(global_count, sizeof(V));
     BL_BENCH_END(distribute, "empty", input.size());
 
     if (empty) {
@@ -1062,41 +1432,70 @@ namespace imxx
 
     // bucketing
     BL_BENCH_START(distribute);
-    imxx::local::assign_to_buckets(input, to_rank, _comm.size(), send_counts, i2o, 0, input.size());
+    int nthreads = imxx::local::get_bucketing_threads();
+    imxx::local::assign_to_buckets(input, to_rank, _comm.size(), send_counts, i2o, 0, input.size(), nthreads);
     BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
-
-    BL_BENCH_START(distribute);
-    // distribute (communication part)
-    imxx::local::bucket_to_permutation(send_counts, i2o, 0, input.size());
-    BL_BENCH_COLLECTIVE_END(distribute, "to_pos", input.size(), _comm);
+    BL_BENCH_BYTES(distribute, input.size() * (sizeof(V) + sizeof(SIZE)));
 
     BL_BENCH_START(distribute);
     if (output.capacity() < input.size()) output.clear();
     output.resize(input.size());
-    output.swap(input);  // swap the 2.
     BL_BENCH_COLLECTIVE_END(distribute, "alloc_permute", output.size(), _comm);
 
     BL_BENCH_START(distribute);
-    // distribute (communication part)
-    imxx::local::permute(output.begin(), output.end(), i2o.begin(), input.begin(), 0);  // input now holds permuted entries.
+    // compute positions and permute in one pass.
+    imxx::local::radix_scatter(input, send_counts, i2o, output, 0, input.size(), nthreads);
+    output.swap(input);  // input now holds permuted entries.
     BL_BENCH_COLLECTIVE_END(distribute, "permute", input.size(), _comm);
+    BL_BENCH_BYTES(distribute, input.size() * (2 * sizeof(V) + sizeof(SIZE)));
 
     // distribute (communication part)
-    BL_BENCH_START(distribute);
-    recv_counts.resize(_comm.size());
-    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
-    size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
-    BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
+    if (large) {
+      BL_BENCH_START(distribute);
+      recv_counts.resize(_comm.size());
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
-    BL_BENCH_START(distribute);
-    // now resize output
-    if (output.capacity() < total) output.clear();
-    output.resize(total);
-    BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      large_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "a2a_large", output.size());
+    } else if (sparse_exchange::instance().use(send_counts, sizeof(V), _comm)) {
+      // few destinations:  no count exchange.
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      sparse_all2allv(input.data(), send_counts, output, recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "nbx", output.size());
+    } else if (pex != nullptr) {
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      pex->all2allv(input.data(), send_counts, output, recv_counts);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "persistent", output.size());
+    } else {
+      BL_BENCH_START(distribute);
+      recv_counts.resize(_comm.size());
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+      BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
-    BL_BENCH_START(distribute);
-    mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
-    BL_BENCH_END(distribute, "a2a", output.size());
+      BL_BENCH_START(distribute);
+      // now resize output
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
+
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      ::imxx::payload_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "a2a", output.size());
+    }
 
     if (preserve_input) {
       BL_BENCH_START(distribute);
@@ -1116,8 +1515,10 @@ namespace imxx
     BL_BENCH_INIT(distribute);
 
     BL_BENCH_COLLECTIVE_START(distribute, "empty", _comm);
-    bool empty = input.size() == 0;
-    empty = mxx::all_of(empty);
+    // the global count bounds every message and receive buffer.
+    size_t global_count = mxx::allreduce(input.size(), _comm);
+    bool empty = (global_count == 0);
+    bool large = large_count::instance().is_large(global_count, sizeof(V));
     BL_BENCH_END(distribute, "empty", input.size());
 
     if (empty) {
@@ -1149,24 +1550,50 @@ namespace imxx
       imxx::local::bucketing_impl(output, to_rank, static_cast<uint64_t>(comm_size), send_counts, input, 0, output.size());
     }
     BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
+    BL_BENCH_BYTES(distribute, input.size() * 2 * sizeof(V));
 
 
     // distribute (communication part)
-    BL_BENCH_START(distribute);
-    recv_counts.resize(_comm.size());
-    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
-    size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
-    BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
+    if (large) {
+      BL_BENCH_START(distribute);
+      recv_counts.resize(_comm.size());
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
-    BL_BENCH_START(distribute);
-    // now resize output
-    if (output.capacity() < total) output.clear();
-    output.resize(total);
-    BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      large_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "a2a_large", output.size());
+    } else if (sparse_exchange::instance().use(send_counts, sizeof(V), _comm)) {
+      // few destinations:  no count exchange.
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      sparse_all2allv(input.data(), send_counts, output, recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "nbx", output.size());
+    } else {
+      BL_BENCH_START(distribute);
+      recv_counts.resize(_comm.size());
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+      BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
-    BL_BENCH_START(distribute);
-    mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
-    BL_BENCH_END(distribute, "a2a", output.size());
+      BL_BENCH_START(distribute);
+      // now resize output
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
+
+      BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute");
+      ::imxx::payload_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+      a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+      BL_BENCH_END(distribute, "a2a", output.size());
+    }
 
     BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_bucket", _comm);
 
@@ -1177,12 +1604,14 @@ namespace imxx
                   ::std::vector<SIZE> const & recv_counts,
                   ::std::vector<SIZE> & i2o,
                   ::std::vector<V>& output,
-                  ::mxx::comm const &_comm, bool const & restore_order = true) {
+                  ::mxx::comm const &_comm, bool const & restore_order = true,
+                  persistent_exchange * pex = nullptr) {
     BL_BENCH_INIT(undistribute);
 
     BL_BENCH_COLLECTIVE_START(undistribute, "empty", _comm);
-    bool empty = input.size() == 0;
-    empty = mxx::all_of(empty);
+    size_t global_count = mxx::allreduce(input.size(), _comm);
+    bool empty = (global_count == 0);
+    bool large = large_count::instance().is_large(global_count, sizeof(V));
     BL_BENCH_END(undistribute, "empty", input.size());
 
     if (empty) {
@@ -1191,20 +1620,49 @@ namespace imxx
     }
 
 
-    BL_BENCH_START(undistribute);
-    std::vector<size_t> send_counts(recv_counts.size());
-    mxx::all2all(recv_counts.data(), 1, send_counts.data(), _comm);
-    size_t total = std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
-    BL_BENCH_END(undistribute, "recv_counts", input.size());
+    std::vector<SIZE> send_counts(recv_counts.size());
+    if (large) {
+      BL_BENCH_START(undistribute);
+      mxx::all2all(recv_counts.data(), 1, send_counts.data(), _comm);
+      size_t total = std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_END(undistribute, "recv_counts", input.size());
 
-    BL_BENCH_START(undistribute);
-    if (output.capacity() < total) output.clear();
-    output.resize(total);
-    BL_BENCH_COLLECTIVE_END(undistribute, "realloc_out", output.size(), _comm);
+      BL_BENCH_START(undistribute);
+      comm_stats_scope a2a_stats("imxx:undistribute");
+      large_all2allv(input.data(), recv_counts, output.data(), send_counts, _comm);
+      a2a_stats.done(recv_counts, send_counts, sizeof(V), _comm);
+      BL_BENCH_END(undistribute, "a2av_large", input.size());
+    } else if (sparse_exchange::instance().use(recv_counts, sizeof(V), _comm)) {
+      BL_BENCH_START(undistribute);
+      comm_stats_scope a2a_stats("imxx:undistribute");
+      sparse_all2allv(input.data(), recv_counts, output, send_counts, _comm);
+      a2a_stats.done(recv_counts, send_counts, sizeof(V), _comm);
+      BL_BENCH_END(undistribute, "nbx", input.size());
+    } else if (pex != nullptr) {
+      BL_BENCH_START(undistribute);
+      comm_stats_scope a2a_stats("imxx:undistribute");
+      pex->all2allv(input.data(), recv_counts, output, send_counts);
+      a2a_stats.done(recv_counts, send_counts, sizeof(V), _comm);
+      BL_BENCH_END(undistribute, "persistent", input.size());
+    } else {
+      BL_BENCH_START(undistribute);
+      mxx::all2all(recv_counts.data(), 1, send_counts.data(), _comm);
+      size_t total = std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+      BL_BENCH_END(undistribute, "recv_counts", input.size());
 
-    BL_BENCH_START(undistribute);
-    mxx::all2allv(input.data(), recv_counts, output.data(), send_counts, _comm);
-    BL_BENCH_END(undistribute, "a2av", input.size());
+      BL_BENCH_START(undistribute);
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(undistribute, "realloc_out", output.size(), _comm);
+
+      BL_BENCH_START(undistribute);
+      comm_stats_scope a2a_stats("imxx:undistribute");
+      ::imxx::payload_all2allv(input.data(), recv_counts, output.data(), send_counts, _comm);
+      a2a_stats.done(recv_counts, send_counts, sizeof(V), _comm);
+      BL_BENCH_END(undistribute, "a2av", input.size());
+    }
 
     if (restore_order) {
       BL_BENCH_START(undistribute);
@@ -1217,6 +1675,98 @@ namespace imxx
 
   }
 
+  /**
+   * @brief distribute and consume:  the input is bucketed in place, and each chunk received is passed to consume as
+   *        soon as it arrives, instead of collecting all received elements in a second buffer.
+   * @details  for building a map from a large batch.  the input's own bucket is consumed first and in place, then
+   *        step i exchanges with ranks rank + i and rank - i, in messages of at most chunk_bytes.  the receive of the next
+   *        chunk is posted before the current one is consumed.  peak memory is the input plus 2 chunks, instead of
+   *        input, output and mapping for distribute.  input is released at the end.  collective.
+   * @param consume   called with (V * first, V * last) for each received range.  may modify the range.
+   */
+  template <typename V, typename ToRank, typename Consumer>
+  void distribute_consume(::std::vector<V>& input, ToRank const & to_rank, Consumer & consume,
+                          ::mxx::comm const &_comm, size_t const & chunk_bytes = (1UL << 24)) {
+    BL_BENCH_INIT(distribute_consume);
+
+    int const p = _comm.size();
+    int const rank = _comm.rank();
+
+    if (p == 1) {
+      BL_BENCH_START(distribute_consume);
+      if (input.size() > 0) consume(input.data(), input.data() + input.size());
+      ::std::vector<V>().swap(input);
+      BL_BENCH_END(distribute_consume, "consume", 0);
+      BL_BENCH_REPORT_MPI_NAMED(distribute_consume, "imxx:distribute_consume", _comm);
+      return;
+    }
+
+    BL_BENCH_START(distribute_consume);
+    std::vector<size_t> send_counts;
+    imxx::local::bucket_inplace(input, to_rank, p, send_counts);
+    BL_BENCH_COLLECTIVE_END(distribute_consume, "bucket_inplace", input.size(), _comm);
+
+    BL_BENCH_START(distribute_consume);
+    std::vector<size_t> recv_counts(p);
+    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    std::vector<size_t> send_displs(p, 0);
+    for (int i = 1; i < p; ++i) send_displs[i] = send_displs[i - 1] + send_counts[i - 1];
+    BL_BENCH_COLLECTIVE_END(distribute_consume, "a2a_count", recv_counts.size(), _comm);
+
+    BL_BENCH_START(distribute_consume);
+    comm_stats_scope a2a_stats("imxx:distribute_consume");
+
+    size_t chunk = ::std::max(static_cast<size_t>(1), chunk_bytes / sizeof(V));
+    chunk = ::std::min(chunk, static_cast<size_t>(::std::numeric_limits<int>::max()));
+    size_t max_recv = *(::std::max_element(recv_counts.begin(), recv_counts.end()));
+    std::vector<V> buffers[2] = { std::vector<V>(::std::min(chunk, max_recv)), std::vector<V>(::std::min(chunk, max_recv)) };
+
+    MPI_Datatype dt;
+    MPI_Type_contiguous(static_cast<int>(sizeof(V)), MPI_BYTE, &dt);
+    MPI_Type_commit(&dt);
+    int const tag = 0x5AD0;
+
+    // own bucket.
+    if (send_counts[rank] > 0) consume(input.data() + send_displs[rank], input.data() + send_displs[rank] + send_counts[rank]);
+
+    std::vector<MPI_Request> sends;
+    MPI_Request recv_req = MPI_REQUEST_NULL;
+    pairwise_schedule const sched = comm_scheduler::instance().get(_comm);
+    for (int i = 1; i < p; ++i) {
+      int dst = sched.dst(i);
+      int src = sched.src(i);
+
+      // sends are from the input, so all of this step's are posted at once.
+      sends.clear();
+      for (size_t offset = 0; offset < send_counts[dst]; offset += chunk) {
+        sends.emplace_back(MPI_REQUEST_NULL);
+        MPI_Isend(input.data() + send_displs[dst] + offset, static_cast<int>(::std::min(chunk, send_counts[dst] - offset)), dt,
+                  dst, tag, _comm, &(sends.back()));
+      }
+
+      size_t nmsgs = (recv_counts[src] + chunk - 1) / chunk;
+      if (nmsgs > 0)
+        MPI_Irecv(buffers[0].data(), static_cast<int>(::std::min(chunk, recv_counts[src])), dt, src, tag, _comm, &recv_req);
+      for (size_t k = 0; k < nmsgs; ++k) {
+        MPI_Wait(&recv_req, MPI_STATUS_IGNORE);
+        size_t n = ::std::min(chunk, recv_counts[src] - k * chunk);
+        if ((k + 1) < nmsgs)
+          MPI_Irecv(buffers[(k + 1) % 2].data(), static_cast<int>(::std::min(chunk, recv_counts[src] - (k + 1) * chunk)), dt,
+                    src, tag, _comm, &recv_req);
+        consume(buffers[k % 2].data(), buffers[k % 2].data() + n);
+      }
+
+      MPI_Waitall(sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+    }
+    MPI_Type_free(&dt);
+
+    a2a_stats.done(send_counts, recv_counts, sizeof(V), _comm);
+    ::std::vector<V>().swap(input);
+    BL_BENCH_END(distribute_consume, "exchange_consume", input.size());
+
+    BL_BENCH_REPORT_MPI_NAMED(distribute_consume, "imxx:distribute_consume", _comm);
+  }
+
   /**
    * @brief distribute function.  input is transformed, but remains the original input with original order.  buffer is used for output.
    *
@@ -1288,13 +1838,21 @@ namespace imxx
       BL_BENCH_COLLECTIVE_END(distribute, "alloc_out", output.size(), _comm);
 
       BL_BENCH_START(distribute);
+      comm_stats_scope a2a_stats("imxx:distribute_2");
       block_all2all(input, min_bucket_size, output, 0, 0, _comm);
       BL_BENCH_COLLECTIVE_END(distribute, "a2a", first_part, _comm);
 
 
       BL_BENCH_START(distribute);
-      mxx::all2allv(input.data() + first_part, send_counts,
+      ::imxx::payload_all2allv(input.data() + first_part, send_counts,
                     output.data() + first_part, recv_counts, _comm);
+      if (comm_stats::instance().enabled()) {
+        // block part and remainders, as 1 call.
+        std::vector<size_t> sent(send_counts.begin(), send_counts.end()), recvd(recv_counts.begin(), recv_counts.end());
+        for (auto & x : sent) x += min_bucket_size;
+        for (auto & x : recvd) x += min_bucket_size;
+        a2a_stats.done(sent, recvd, sizeof(V), _comm);
+      }
       BL_BENCH_END(distribute, "a2av", total - first_part);
 
       // permute
@@ -1346,11 +1904,19 @@ namespace imxx
     BL_BENCH_COLLECTIVE_END(undistribute, "realloc_out", output.size(), _comm);
 
     BL_BENCH_START(undistribute);
-    mxx::all2all(input.data(), first_part / _comm.size(), output.data(), _comm);
+    comm_stats_scope a2a_stats("imxx:undistribute_2");
+    ::imxx::payload_all2all(input.data(), first_part / _comm.size(), output.data(), _comm);
     BL_BENCH_END(undistribute, "a2a", first_part);
 
     BL_BENCH_START(undistribute);
-    mxx::all2allv(input.data() + first_part, recv_counts, output.data() + first_part, send_counts, _comm);
+    ::imxx::payload_all2allv(input.data() + first_part, recv_counts, output.data() + first_part, send_counts, _comm);
+    if (comm_stats::instance().enabled()) {
+      // block part and remainders, as 1 call.
+      std::vector<size_t> sent(recv_counts.begin(), recv_counts.end()), recvd(send_counts);
+      for (auto & x : sent) x += first_part / _comm.size();
+      for (auto & x : recvd) x += first_part / _comm.size();
+      a2a_stats.done(sent, recvd, sizeof(V), _comm);
+    }
     BL_BENCH_END(undistribute, "a2av", second_part);
 
     if (restore_order) {
@@ -1365,6 +1931,199 @@ namespace imxx
   }
 
 
+  /**
+   * @brief distribute with compressed messages, for entries whose order and grouping do not matter, e.g. k-mers to be counted.
+   * @details  each bucket is sorted by value and delta + varint encoded before the all2allv, then decoded at the receiver.
+   *          hashed distribution leaves the buckets in random order, and sorting makes neighboring entries share their high bits,
+   *          and repeated entries (k-mer multiplicity) cost 1 byte per word.  the multiset sent to each rank is unchanged,
+   *          but there is no i2o mapping, and output is sorted per source rank rather than in the source's order.
+   *
+   *          V must be bitwise copyable (see local::word_view).
+   * @param recv_counts[out]   number of entries received from each rank.
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void distribute_compressed(::std::vector<V>& input, ToRank const & to_rank,
+                  ::std::vector<SIZE> & recv_counts,
+                  ::std::vector<V>& output,
+                  ::mxx::comm const &_comm) {
+    BL_BENCH_INIT(distribute_c);
+
+    BL_BENCH_COLLECTIVE_START(distribute_c, "empty", _comm);
+    bool empty = input.size() == 0;
+    empty = mxx::all_of(empty);
+    BL_BENCH_END(distribute_c, "empty", input.size());
+
+    if (empty) {
+      BL_BENCH_REPORT_MPI_NAMED(distribute_c, "imxx:distribute_compressed", _comm);
+      return;
+    }
+
+    // bucket by destination
+    BL_BENCH_START(distribute_c);
+    int nthreads = imxx::local::get_bucketing_threads();
+    std::vector<SIZE> send_counts(_comm.size(), 0);
+    std::vector<V> bucketed;
+    {
+      std::vector<SIZE> i2o(input.size());
+      imxx::local::assign_to_buckets(input, to_rank, _comm.size(), send_counts, i2o, 0, input.size(), nthreads);
+      imxx::local::radix_scatter(input, send_counts, i2o, bucketed, 0, input.size(), nthreads);
+    }
+    auto send_displs = mxx::impl::get_displacements(send_counts);
+    BL_BENCH_COLLECTIVE_END(distribute_c, "bucket", input.size(), _comm);
+
+    // sort and encode each bucket
+    BL_BENCH_START(distribute_c);
+    std::vector<std::vector<uint8_t> > encoded(_comm.size());
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (int i = 0; i < _comm.size(); ++i) {
+      std::sort(bucketed.begin() + send_displs[i], bucketed.begin() + send_displs[i] + send_counts[i], imxx::local::word_view<V>());
+      encoded[i].reserve(send_counts[i] * sizeof(V) / 2);
+      imxx::local::delta_encode(bucketed.begin() + send_displs[i], bucketed.begin() + send_displs[i] + send_counts[i], encoded[i]);
+    }
+    std::vector<V>().swap(bucketed);
+
+    std::vector<size_t> send_bytes(_comm.size());
+    for (int i = 0; i < _comm.size(); ++i) send_bytes[i] = encoded[i].size();
+    std::vector<size_t> send_byte_displs = mxx::impl::get_displacements(send_bytes);
+    std::vector<uint8_t> send_buf(send_byte_displs.back() + send_bytes.back());
+    for (int i = 0; i < _comm.size(); ++i) {
+      memcpy(send_buf.data() + send_byte_displs[i], encoded[i].data(), send_bytes[i]);
+      std::vector<uint8_t>().swap(encoded[i]);
+    }
+    BL_BENCH_COLLECTIVE_END(distribute_c, "encode", send_buf.size(), _comm);
+
+    // counts of entries and of bytes.
+    BL_BENCH_START(distribute_c);
+    recv_counts.resize(_comm.size());
+    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    std::vector<size_t> recv_bytes(_comm.size());
+    mxx::all2all(send_bytes.data(), 1, recv_bytes.data(), _comm);
+    BL_BENCH_COLLECTIVE_END(distribute_c, "a2a_count", recv_counts.size(), _comm);
+
+    BL_BENCH_START(distribute_c);
+    std::vector<size_t> recv_byte_displs = mxx::impl::get_displacements(recv_bytes);
+    std::vector<uint8_t> recv_buf(recv_byte_displs.back() + recv_bytes.back());
+    comm_stats_scope a2a_stats("imxx:distribute_compressed");
+    ::imxx::payload_all2allv(send_buf.data(), send_bytes, recv_buf.data(), recv_bytes, _comm);
+    a2a_stats.done(send_bytes, recv_bytes, 1, _comm);
+    std::vector<uint8_t>().swap(send_buf);
+    BL_BENCH_COLLECTIVE_END(distribute_c, "a2av", recv_buf.size(), _comm);
+
+    // decode
+    BL_BENCH_START(distribute_c);
+    auto recv_displs = mxx::impl::get_displacements(recv_counts);
+    size_t total = recv_displs.back() + recv_counts.back();
+    if (output.capacity() < total) output.clear();
+    output.resize(total);
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (int i = 0; i < _comm.size(); ++i) {
+      imxx::local::delta_decode(recv_buf.data() + recv_byte_displs[i], recv_counts[i], output.begin() + recv_displs[i]);
+    }
+    BL_BENCH_COLLECTIVE_END(distribute_c, "decode", output.size(), _comm);
+
+    BL_BENCH_REPORT_MPI_NAMED(distribute_c, "imxx:distribute_compressed", _comm);
+  }
+
+
+  /**
+   * @brief node-aware communicators for the two level distribute.
+   * @details  local holds the ranks on the same node (shared memory).  cross holds the ranks with the same local rank,
+   *            1 per node, so a rank's cross rank is its node id.
+   *            requires the same number of ranks per node.  otherwise uniform() is false and the two level calls fall back to the flat version.
+   */
+  class node_aware_comm {
+    public:
+      ::mxx::comm global;
+      ::mxx::comm local;
+      ::mxx::comm cross;
+      /// node id and local rank of each global rank.
+      std::vector<int> node_of;
+      std::vector<int> local_of;
+
+    protected:
+      bool is_uniform;
+      int n_nodes;
+
+    public:
+      node_aware_comm(::mxx::comm const & _comm) :
+        global(_comm.copy()), local(_comm.split_shared()), cross(_comm.split(local.rank(), _comm.rank())) {
+        is_uniform = ::mxx::all_same(local.size(), global);
+
+        // node id is the cross rank of the node's first rank.  the cross comm of local rank 0 includes all nodes.
+        int ids[2] = {cross.rank(), cross.size()};
+        MPI_Bcast(ids, 2, MPI_INT, 0, local);
+        n_nodes = ids[1];
+        node_of = ::mxx::allgather(ids[0], global);
+        local_of = ::mxx::allgather(local.rank(), global);
+      }
+
+      bool uniform() const {
+        return is_uniform;
+      }
+
+      int num_nodes() const {
+        return n_nodes;
+      }
+  };
+
+  /// counts and permutations of the 2 levels of a two level distribute, for the matching undistribute.
+  struct two_level_mapping {
+      std::vector<size_t> node_recv_counts;
+      std::vector<size_t> node_i2o;
+      std::vector<size_t> local_recv_counts;
+      std::vector<size_t> local_i2o;
+  };
+
+  /**
+   * @brief two level distribute.  first between nodes, to the rank with the same local rank on the destination node, then within the node.
+   * @details  each rank sends num_nodes messages across the network instead of comm.size(), so the inter-node message count
+   *            goes down by the ranks per node factor, and the messages are correspondingly larger.  the second level is within
+   *            shared memory, and there are no leader ranks that all of a node's data has to go through.
+   *
+   *            output holds the same entries as distribute(), but grouped by source local rank then source node, not by source rank.
+   *            input is permuted as in distribute(), and mapping.node_i2o is the permutation.
+   */
+  template <typename V, typename ToRank>
+  void distribute_2level(::std::vector<V>& input, ToRank const & to_rank,
+                         two_level_mapping & mapping,
+                         ::std::vector<V>& output,
+                         node_aware_comm const & hc, bool const & preserve_input = false) {
+    output.clear();
+
+    if (!hc.uniform()) {
+      distribute(input, to_rank, mapping.node_recv_counts, mapping.node_i2o, output, hc.global, preserve_input);
+      return;
+    }
+
+    ::std::vector<V> buffer;
+    distribute(input, [&to_rank, &hc](V const & x) { return hc.node_of[to_rank(x)]; },
+               mapping.node_recv_counts, mapping.node_i2o, buffer, hc.cross, preserve_input);
+    distribute(buffer, [&to_rank, &hc](V const & x) { return hc.local_of[to_rank(x)]; },
+               mapping.local_recv_counts, mapping.local_i2o, output, hc.local, false);
+  }
+
+  /**
+   * @brief reverse of distribute_2level.  input is one to one with the output of distribute_2level.
+   * @details  output is in the permuted order of distribute_2level's input, or in the original order if restore_order.
+   */
+  template <typename V>
+  void undistribute_2level(::std::vector<V> const & input,
+                           two_level_mapping & mapping,
+                           ::std::vector<V>& output,
+                           node_aware_comm const & hc, bool const & restore_order = true) {
+    output.clear();
+
+    if (!hc.uniform()) {
+      undistribute(input, mapping.node_recv_counts, mapping.node_i2o, output, hc.global, restore_order);
+      return;
+    }
+
+    ::std::vector<V> buffer;
+    undistribute(input, mapping.local_recv_counts, mapping.local_i2o, buffer, hc.local, true);
+    undistribute(buffer, mapping.node_recv_counts, mapping.node_i2o, output, hc.cross, restore_order);
+  }
+
+
   /**
    * @brief distribute, compute, send back.  one to one.  result matching input in order at then end.
    * @detail   this is the memory inefficient version
@@ -1379,7 +2138,8 @@ namespace imxx
                               ::std::vector<T>& output,
                               ::std::vector<V>& in_buffer, std::vector<T>& out_buffer,
                               ::mxx::comm const &_comm,
-                              bool const & preserve_input = false) {
+                              bool const & preserve_input = false,
+                              persistent_exchange * pex = nullptr) {
       BL_BENCH_INIT(scat_comp_gath);
 
       // speed over mem use.  mxx all2allv already has to double memory usage. same as stable distribute.
@@ -1401,7 +2161,7 @@ namespace imxx
 
       // distribute
       BL_BENCH_START(scat_comp_gath);
-      distribute(input, to_rank, recv_counts, i2o, in_buffer, _comm, false);
+      distribute(input, to_rank, recv_counts, i2o, in_buffer, _comm, false, pex);
       BL_BENCH_END(scat_comp_gath, "distribute", in_buffer.size());
 
       // allocate out_buffer - output is same size as input
@@ -1423,13 +2183,16 @@ namespace imxx
 
       // distribute data back to source
       BL_BENCH_START(scat_comp_gath);
-      undistribute(out_buffer, recv_counts, i2o, output, _comm, false);
+      undistribute(out_buffer, recv_counts, i2o, output, _comm, false, pex);
       BL_BENCH_END(scat_comp_gath, "undistribute", output.size());
 
 
       // permute
       if (preserve_input) {
         BL_BENCH_START(scat_comp_gath);
+        // the buffers are sized for the received queries, which in general is not the input size.
+        in_buffer.resize(input.size());
+        out_buffer.resize(output.size());
         ::imxx::local::unpermute(input.begin(), input.end(), i2o.begin(), in_buffer.begin(), 0);
         in_buffer.swap(input);
         ::imxx::local::unpermute(output.begin(), output.end(), i2o.begin(), out_buffer.begin(), 0);
@@ -1545,7 +2308,7 @@ namespace imxx
 
       // send second part.  reuse entire in_buffer
       BL_BENCH_START(scat_comp_gath_2);
-	  mxx::all2allv(input.data() + first_part, send_counts,
+	  ::imxx::payload_all2allv(input.data() + first_part, send_counts,
                     in_buffer.data(), recv_counts, _comm);
       BL_BENCH_END(scat_comp_gath_2, "a2av", in_buffer.size());
 
@@ -1556,7 +2319,7 @@ namespace imxx
 
       // send the results back
       BL_BENCH_START(scat_comp_gath_2);
-	  mxx::all2allv(out_buffer.data(), recv_counts,
+	  ::imxx::payload_all2allv(out_buffer.data(), recv_counts,
                     output.data() + first_part, send_counts, _comm);
       BL_BENCH_END(scat_comp_gath_2, "inverse_a2av", output.size());
 
@@ -1766,7 +2529,7 @@ namespace imxx
       // send second part.  reuse entire in_buffer
       BL_BENCH_START(scat_comp_gath_lm);
       ::mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
-	  mxx::all2allv(in_buffer.data(), send_counts,
+	  ::imxx::payload_all2allv(in_buffer.data(), send_counts,
                     in_buffer.data() + second_part_local, recv_counts, _comm);
       BL_BENCH_END(scat_comp_gath_lm, "a2av", second_part_local);
 
@@ -1777,7 +2540,7 @@ namespace imxx
 
       // send the results back
       BL_BENCH_START(scat_comp_gath_lm);
-	  mxx::all2allv(out_buffer.data(), recv_counts,
+	  ::imxx::payload_all2allv(out_buffer.data(), recv_counts,
                     output.data() + first_part, send_counts, _comm);
       BL_BENCH_END(scat_comp_gath_lm, "inverse_a2av", second_part_remote);
 
@@ -1793,6 +2556,274 @@ namespace imxx
       BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_lm, "imxx:scat_comp_gath_lm", _comm);
   }
 
+  /// algorithm for one to one distribute, compute, send back.
+  enum class scatter_algo : int {
+    AUTO = 0,      ///< chosen at runtime by distribution_policy
+    FULL = 1,      ///< scatter_compute_gather.  fastest, input and output are both buffered in full.
+    TWO_PART = 2,  ///< scatter_compute_gather_2part.
+    LOW_MEM = 3    ///< scatter_compute_gather_lowmem.  buffers at most about 1/2 of input and output.
+  };
+
+  /**
+   * @brief runtime choice of the scatter_compute_gather version.
+   * @details  with AUTO, each rank estimates the peak memory of each version for its input, and picks the fastest one that fits in
+   *        mem_fraction of the memory usable by the rank (MemUsage::get_usable_mem() divided by the ranks on the node).
+   *        batches of at most small_batch elements always use FULL.  the most conservative pick over all ranks is used, via 1 allreduce.
+   *
+   *        peak estimates per element, for V input, T output and SIZE mapping:  FULL 2(V + T) + SIZE, TWO_PART 2V + 1.5T + SIZE,
+   *        LOW_MEM 1.5(V + T) + SIZE.
+   *
+   *        the settings must be the same on all ranks.  a fixed algorithm needs no communication.
+   */
+  class distribution_policy {
+    protected:
+      scatter_algo algo;
+      double mem_fraction;
+      size_t small_batch;
+      /// number of ranks sharing the node's memory.  computed on first AUTO choice.
+      mutable int ranks_per_node;
+
+    public:
+      distribution_policy(scatter_algo const & _algo = scatter_algo::AUTO,
+                          double const & _mem_fraction = 0.5,
+                          size_t const & _small_batch = (1UL << 20)) :
+        algo(_algo), mem_fraction(_mem_fraction), small_batch(_small_batch), ranks_per_node(0) {}
+
+      void set_algorithm(scatter_algo const & _algo) { algo = _algo; }
+      scatter_algo get_algorithm() const { return algo; }
+
+      void set_memory_fraction(double const & _mem_fraction) { mem_fraction = _mem_fraction; }
+      double get_memory_fraction() const { return mem_fraction; }
+
+      void set_small_batch(size_t const & _small_batch) { small_batch = _small_batch; }
+      size_t get_small_batch() const { return small_batch; }
+
+      /// pick the algorithm for count elements on this rank.  collective for AUTO.  never returns AUTO.
+      template <typename V, typename T, typename SIZE = size_t>
+      scatter_algo choose(size_t const & count, ::mxx::comm const & _comm) const {
+        if (algo != scatter_algo::AUTO) return algo;
+
+        if (ranks_per_node == 0) ranks_per_node = _comm.split_shared().size();
+
+        scatter_algo local = scatter_algo::FULL;
+        if (count > small_batch) {
+          size_t avail = std::numeric_limits<size_t>::max();
+          try {
+            avail = static_cast<size_t>(static_cast<double>(::plog::MemUsage::get_usable_mem() / ranks_per_node) * mem_fraction);
+          } catch (::bliss::io::IOException const &) {
+            // no /proc/meminfo.  assume memory is not a constraint.
+          }
+
+          double n = static_cast<double>(count);
+          if (n * (2.0 * (sizeof(V) + sizeof(T)) + sizeof(SIZE)) <= static_cast<double>(avail))
+            local = scatter_algo::FULL;
+          else if (n * (2.0 * sizeof(V) + 1.5 * sizeof(T) + sizeof(SIZE)) <= static_cast<double>(avail))
+            local = scatter_algo::TWO_PART;
+          else
+            local = scatter_algo::LOW_MEM;
+        }
+
+        return static_cast<scatter_algo>(::mxx::allreduce(static_cast<int>(local), ::mxx::max<int>(), _comm));
+      }
+  };
+
+  /**
+   * @brief distribute, compute, send back.  one to one.  the version is chosen by the policy from the input size and available memory.
+   * @details  collective.  see scatter_compute_gather for the parameters.
+   */
+  template <typename V, typename ToRank, typename Operation, typename SIZE = size_t,
+      typename T = typename bliss::functional::function_traits<Operation, V>::return_type>
+  void scatter_compute_gather_adaptive(::std::vector<V>& input, ToRank const & to_rank,
+                              Operation const & op,
+                              ::std::vector<SIZE> & i2o,
+                              ::std::vector<T>& output,
+                              ::std::vector<V>& in_buffer, std::vector<T>& out_buffer,
+                              ::mxx::comm const &_comm,
+                              distribution_policy const & policy = distribution_policy(),
+                              bool const & preserve_input = false) {
+    switch (policy.template choose<V, T, SIZE>(input.size(), _comm)) {
+      case scatter_algo::TWO_PART:
+        scatter_compute_gather_2part(input, to_rank, op, i2o, output, in_buffer, out_buffer, _comm, preserve_input);
+        break;
+      case scatter_algo::LOW_MEM:
+        scatter_compute_gather_lowmem(input, to_rank, op, i2o, output, in_buffer, out_buffer, _comm, preserve_input);
+        break;
+      default:
+        scatter_compute_gather(input, to_rank, op, i2o, output, in_buffer, out_buffer, _comm, preserve_input);
+        break;
+    }
+  }
+
+  /**
+   * @brief distribute, compute, send back.  one to one.  result matching input in order at then end.
+   * @details  pipelined version.  the destination ranks are processed in rounds of ranks_per_round, using the shift pattern
+   *            (send to rank + i, receive from rank - i) as in the distributed map's find.  the queries for round r+1 and the
+   *            answers for round r-1 are in flight (nonblocking point to point) while op computes on round r, so the
+   *            communication overlaps computation instead of adding to it.
+   *
+   *            in_buffer and out_buffer each hold 2 rounds of received queries, so their size is bounded by
+   *            2 x the largest round, not by the total received.  the answers are received directly into output.
+   *
+   *            the input is bucketed and permuted as in distribute().  output and input are in the permuted order unless preserve_input.
+   *
+   * @param ranks_per_round   number of destination ranks per round.  0 means sqrt(p).  p means a single round.
+   */
+  template <typename V, typename ToRank, typename Operation, typename SIZE = size_t,
+      typename T = typename bliss::functional::function_traits<Operation, V>::return_type>
+  void scatter_compute_gather_pipelined(::std::vector<V>& input, ToRank const & to_rank,
+                              Operation const & op,
+                              ::std::vector<SIZE> & i2o,
+                              ::std::vector<T>& output,
+                              ::std::vector<V>& in_buffer, std::vector<T>& out_buffer,
+                              ::mxx::comm const &_comm,
+                              bool const & preserve_input = false,
+                              int ranks_per_round = 0) {
+      BL_BENCH_INIT(scat_comp_gath_pl);
+
+      BL_BENCH_COLLECTIVE_START(scat_comp_gath_pl, "empty", _comm);
+      bool empty = input.size() == 0;
+      empty = mxx::all_of(empty);
+      BL_BENCH_END(scat_comp_gath_pl, "empty", input.size());
+
+      if (empty) {
+        BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_pl, "imxx:scat_comp_gath_pl", _comm);
+        return;
+      }
+
+      int const p = _comm.size();
+      int const rank = _comm.rank();
+      if (ranks_per_round <= 0) ranks_per_round = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(p))));
+      ranks_per_round = std::min(ranks_per_round, p);
+      int const rounds = (p + ranks_per_round - 1) / ranks_per_round;
+
+      // do assignment.
+      BL_BENCH_START(scat_comp_gath_pl);
+      std::vector<SIZE> send_counts(p, 0);
+      std::vector<SIZE> recv_counts(p, 0);
+      i2o.resize(input.size());
+      BL_BENCH_END(scat_comp_gath_pl, "alloc_map", input.size());
+
+      // bucketing
+      BL_BENCH_START(scat_comp_gath_pl);
+      imxx::local::assign_to_buckets(input, to_rank, p, send_counts, i2o, 0, input.size());
+      imxx::local::bucket_to_permutation(send_counts, i2o, 0, input.size());
+      BL_BENCH_END(scat_comp_gath_pl, "bucket", input.size());
+
+      // permute
+      BL_BENCH_START(scat_comp_gath_pl);
+      if (in_buffer.capacity() < input.size()) in_buffer.clear();
+      in_buffer.resize(input.size());
+      imxx::local::permute(input.begin(), input.end(), i2o.begin(), in_buffer.begin(), 0);
+      in_buffer.swap(input);       // input is now permuted.
+      BL_BENCH_END(scat_comp_gath_pl, "permute", input.size());
+
+      // counts, and the offsets of each source's queries within its round's buffer slot.
+      BL_BENCH_START(scat_comp_gath_pl);
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      auto send_displs = mxx::impl::get_displacements(send_counts);
+
+      pairwise_schedule const sched = comm_scheduler::instance().get(_comm);
+      std::vector<size_t> recv_offsets(p, 0);
+      size_t max_round = 0;
+      for (int r = 0; r < rounds; ++r) {
+        size_t round_total = 0;
+        for (int i = r * ranks_per_round, max = std::min(p, (r + 1) * ranks_per_round); i < max; ++i) {
+          recv_offsets[i] = round_total;
+          round_total += recv_counts[sched.src(i)];
+        }
+        max_round = std::max(max_round, round_total);
+      }
+      BL_BENCH_END(scat_comp_gath_pl, "a2a_count", max_round);
+
+      // allocate 2 slots each for received queries and their answers, and the output.
+      BL_BENCH_START(scat_comp_gath_pl);
+      if (in_buffer.capacity() < (2 * max_round)) in_buffer.clear();
+      in_buffer.resize(2 * max_round);
+      if (out_buffer.capacity() < (2 * max_round)) out_buffer.clear();
+      out_buffer.resize(2 * max_round);
+      if (output.capacity() < (input.size())) output.clear();
+      output.resize(input.size());
+      BL_BENCH_END(scat_comp_gath_pl, "alloc_buffers", in_buffer.size());
+
+      BL_BENCH_START(scat_comp_gath_pl);
+      mxx::datatype in_dt = mxx::get_datatype<V>();
+      mxx::datatype out_dt = mxx::get_datatype<T>();
+      // a rank sends to each other rank once, so the tags only need to separate queries from answers.
+      int const query_tag = 0;
+      int const answer_tag = 1;
+
+      // 2 requests (send and recv) per step, for 2 rounds.
+      std::vector<MPI_Request> query_reqs[2] = { std::vector<MPI_Request>(2 * ranks_per_round, MPI_REQUEST_NULL),
+                                                 std::vector<MPI_Request>(2 * ranks_per_round, MPI_REQUEST_NULL) };
+      std::vector<MPI_Request> answer_reqs[2] = { std::vector<MPI_Request>(2 * ranks_per_round, MPI_REQUEST_NULL),
+                                                  std::vector<MPI_Request>(2 * ranks_per_round, MPI_REQUEST_NULL) };
+
+      // post the receives and sends of queries for round r
+      auto post_queries = [&](int r) {
+        int slot = r % 2;
+        int src, dst;
+        std::fill(query_reqs[slot].begin(), query_reqs[slot].end(), MPI_REQUEST_NULL);
+        for (int i = r * ranks_per_round, max = std::min(p, (r + 1) * ranks_per_round), j = 0; i < max; ++i, j += 2) {
+          src = sched.src(i);
+          dst = sched.dst(i);
+
+          if (recv_counts[src] > 0)
+            MPI_Irecv(in_buffer.data() + slot * max_round + recv_offsets[i], recv_counts[src], in_dt.type(),
+                      src, query_tag, _comm, &(query_reqs[slot][j]));
+          if (send_counts[dst] > 0)
+            MPI_Isend(input.data() + send_displs[dst], send_counts[dst], in_dt.type(),
+                      dst, query_tag, _comm, &(query_reqs[slot][j + 1]));
+        }
+      };
+
+      post_queries(0);
+      for (int r = 0; r < rounds; ++r) {
+        int slot = r % 2;
+
+        // queries for round r are in.  start round r+1's.  its slot was last used by round r-1, already computed.
+        MPI_Waitall(query_reqs[slot].size(), query_reqs[slot].data(), MPI_STATUSES_IGNORE);
+        if ((r + 1) < rounds) post_queries(r + 1);
+
+        // compute on round r.  out slot was last used by round r-2, whose answers completed in the previous iteration.
+        int first = r * ranks_per_round;
+        int last = std::min(p, (r + 1) * ranks_per_round);
+        size_t round_total = recv_offsets[last - 1] + recv_counts[sched.src(last - 1)];
+        op(in_buffer.begin() + slot * max_round, in_buffer.begin() + slot * max_round + round_total,
+           out_buffer.begin() + slot * max_round);
+
+        // send round r's answers back, and receive the answers to this rank's queries of round r directly into output.
+        int src, dst;
+        std::fill(answer_reqs[slot].begin(), answer_reqs[slot].end(), MPI_REQUEST_NULL);
+        for (int i = first, j = 0; i < last; ++i, j += 2) {
+          src = sched.src(i);
+          dst = sched.dst(i);
+
+          if (send_counts[dst] > 0)
+            MPI_Irecv(output.data() + send_displs[dst], send_counts[dst], out_dt.type(),
+                      dst, answer_tag, _comm, &(answer_reqs[slot][j]));
+          if (recv_counts[src] > 0)
+            MPI_Isend(out_buffer.data() + slot * max_round + recv_offsets[i], recv_counts[src], out_dt.type(),
+                      src, answer_tag, _comm, &(answer_reqs[slot][j + 1]));
+        }
+
+        // answers of round r-1 are done.
+        if (r > 0) MPI_Waitall(answer_reqs[1 - slot].size(), answer_reqs[1 - slot].data(), MPI_STATUSES_IGNORE);
+      }
+      MPI_Waitall(answer_reqs[(rounds - 1) % 2].size(), answer_reqs[(rounds - 1) % 2].data(), MPI_STATUSES_IGNORE);
+      BL_BENCH_END(scat_comp_gath_pl, "pipeline", output.size());
+
+      // permute
+      if (preserve_input) {
+        BL_BENCH_START(scat_comp_gath_pl);
+        // buffers are small, so do this inplace.
+        ::imxx::local::unpermute_inplace(input, i2o, 0, input.size());
+        ::imxx::local::unpermute_inplace(output, i2o, 0, output.size());
+        BL_BENCH_END(scat_comp_gath_pl, "unpermute_inplace", output.size());
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_pl, "imxx:scat_comp_gath_pl", _comm);
+  }
+
   // TODO: non-one-to-one version.
 
   /**
@@ -2153,12 +3184,39 @@ namespace imxx
   }
 
 
+  /// memory and threads of samplesort, per process.  should be the same on all ranks.
+  class samplesort_settings {
+    protected:
+      size_t budget_bytes;
+      int threads;
+
+    public:
+      samplesort_settings() : budget_bytes(1UL << 30), threads(0) {}
+
+      static samplesort_settings & instance() {
+        static samplesort_settings settings;
+        return settings;
+      }
+
+      /// memory for the exchange and the merge, beyond the input and the output.  bounds the all2allv messages, and
+      /// the merge buffer.  if the received data is larger, samplesort merges in place in blocks.
+      void set_budget_bytes(size_t const & b) { budget_bytes = ::std::max(b, static_cast<size_t>(1)); }
+      size_t get_budget_bytes() const { return budget_bytes; }
+
+      /// merge threads.  0 means omp_get_max_threads().  the in place merge is sequential.
+      void set_threads(int const & t) { threads = t; }
+      int get_threads() const { return threads; }
+  };
+
+
   /**
    * @brief modified version of mxx::samplesort with some optimizations
    * @details  This version does not attempt to rebalance after parallel sort.
    *    NOTE: if we want load balance, balance BEFORE calling this routine.
    *    ASSUMPTION: data is close to uniformly distributed
    *    ASSUMPTION: where data is not uniformly distributed, sampling results in good enough splits
+   *    the received runs are merged with a loser tree (stable), into a buffer with samplesort_settings threads, or in
+   *    place in blocks if the received data exceeds samplesort_settings' budget.  V is exchanged as bytes.
    *
    *    return local splitters
    */
@@ -2256,147 +3314,46 @@ namespace imxx
       std::size_t recv_n = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
       MXX_ASSERT(!_AssumeBlockDecomp || (local_size <= (size_t)p || recv_n <= 2* local_size));
 
+      // the merge goes through a buffer of the received size if it is within the budget.  otherwise it is done in
+      // place in blocks, so the runs are received at block aligned offsets.
+      samplesort_settings const & settings = samplesort_settings::instance();
+      size_t budget = std::max(settings.get_budget_bytes() / sizeof(V), static_cast<size_t>(1));
+      size_t chunk = std::max(budget / (2 * p), static_cast<size_t>(1));
+      bool in_place = (recv_n > budget);
+
+      std::vector<size_t> recv_displs;
+      size_t storage = recv_n;
+      if (in_place) storage = ::fsc::block_merge_storage(recv_counts, chunk, recv_displs);
+      else recv_displs = mxx::impl::get_displacements(recv_counts);
+
       // reserve
-      if (output.capacity() < recv_n) output.clear();
-      output.resize(recv_n);
-      BL_BENCH_END(imxx_samplesort, "reserve", recv_n);
+      if (output.capacity() < storage) output.clear();
+      output.resize(storage);
+      BL_BENCH_END(imxx_samplesort, "reserve", storage);
 
       BL_BENCH_START(imxx_samplesort);
 
-
-      // TODO: use collective with iterators [begin,end) instead of pointers!
-      ::mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
+      // in messages of at most chunk elements, so the MPI buffers stay within the budget.
+      std::vector<size_t> send_displs = mxx::impl::get_displacements(send_counts);
+      ::imxx::chunked_all2allv(input.data(), send_counts, send_displs, output.data(), recv_counts, recv_displs, chunk, comm);
       BL_BENCH_END(imxx_samplesort, "all2all", local_size);
 
       BL_BENCH_START(imxx_samplesort);
 
-      // 9. local reordering
-      /* multiway-merge (using the implementation in __gnu_parallel) */
-      // if p = 2, then merge
-      if (p == 2) {
-        // always stable.
-        std::inplace_merge(output.begin(), output.begin() + recv_counts[0], output.end(), comp);
-
+      // 9. local reordering.  p-way merge with a loser tree.  the runs are in rank order, so it is stable.
+      if (in_place) {
+        ::fsc::block_multiway_merge(output, recv_counts, recv_displs, chunk, comp);
       } else {
-
-        // allocate half of the total space.  merge for first half, compact, copy, run the second half, copy.
-
-  #ifdef MXX_USE_GCC_MULTIWAY_MERGE
-        // NOTE: uses recv_n / 2 temp storage.
-
-      if (recv_n > (size_t)p*p) {  // should not be local_size.
-
-        BL_BENCH_INIT(imxx_samplesort_merge);
-
-
-        BL_BENCH_START(imxx_samplesort_merge);
-
-
-        // prepare the sequence offsets
-          typedef typename std::vector<V>::iterator val_it;
-
-          std::vector<std::pair<val_it, val_it> > seqs(p);
-          std::vector<size_t> recv_displs = mxx::impl::get_displacements(recv_counts);
-          for (int i = 0; i < p; ++i) {
-              seqs[i].first = output.begin() + recv_displs[i];
-              seqs[i].second = seqs[i].first + recv_counts[i];
-          }
-
-          BL_BENCH_END(imxx_samplesort_merge, "merge_ranges", seqs.size());
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-          // allocate the size.
-          // TODO: reasonable values for the buffer?
-          std::size_t merge_n = (recv_n + 1) / 2;
-          std::vector<V> merge_buf(merge_n);
-          // auto tmp = std::get_temporary_buffer<V>(merge_n);
-
-          BL_BENCH_END(imxx_samplesort_merge, "merge_buf_alloc", merge_n);
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-
-          val_it start_merge_it = output.begin();
-
-          V* merge_buf_begin = merge_buf.data();
-
-          __gnu_parallel::sequential_tag seq_tag;
-
-          // 2 iterations.  unroll loop.
-          // first half.
-          // i)   merge at most `merge_n` many elements sequentially
-          if (_Stable)
-            __gnu_parallel::stable_multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, merge_n, comp, seq_tag);
-          else
-            __gnu_parallel::multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, merge_n, comp, seq_tag);
-
-          BL_BENCH_END(imxx_samplesort_merge, "merge1", merge_n);
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-
-          // ii)  compact the remaining elements in `output`
-          // TCP:  doing this a fixed number of times makes it linear in data size.  if the number of iterations is dependent on data size, then it becomes quadratic.
-          for (int i = p-1; i > 0; --i)
-          {
-              seqs[i-1].first = std::move_backward(seqs[i-1].first, seqs[i-1].second, seqs[i].first);
-              seqs[i-1].second = seqs[i].first;
-          }
-
-          BL_BENCH_END(imxx_samplesort_merge, "compact", std::distance(seqs[0].first, seqs[p-1].second));
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-
-          // iii) copy the output buffer `merge_n` elements back into `output`
-          //      `recv_elements`.
-          start_merge_it = std::copy(merge_buf.begin(), merge_buf.begin() + merge_n, start_merge_it);
-          assert(start_merge_it == seqs[0].first);
-          BL_BENCH_END(imxx_samplesort_merge, "copy1", merge_n);
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-
-          // now the second half.
-          merge_n = recv_n  - merge_n;
-
-          // i)   merge at most `local_size` many elements sequentially
-          if (_Stable)
-            __gnu_parallel::stable_multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, merge_n, comp, seq_tag);
-          else
-            __gnu_parallel::multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, merge_n, comp, seq_tag);
-
-          BL_BENCH_END(imxx_samplesort_merge, "merge2", merge_n);
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-          // iii) copy the output buffer `merge_n` elements back into `output`
-          //      `recv_elements`.
-          start_merge_it = std::move(merge_buf.begin(), merge_buf.begin() + merge_n, start_merge_it);
-          assert(start_merge_it == output.end());
-
-          BL_BENCH_END(imxx_samplesort_merge, "copy2", merge_n);
-
-          BL_BENCH_START(imxx_samplesort_merge);
-
-
-          // clean up
-          merge_buf.clear(); std::vector<V>().swap(merge_buf);
-
-          BL_BENCH_END(imxx_samplesort_merge, "merge_buf_dealloc", merge_n);
-
-          BL_BENCH_REPORT_MPI_NAMED(imxx_samplesort_merge, "imxx_samplesort_merge", comm);
-
-      } else
-  #endif
-      { // sorting based.
-          if (_Stable)
-              std::stable_sort(output.begin(), output.end(), comp);
-          else
-              std::sort(output.begin(), output.end(), comp);
+        typedef typename std::vector<V>::iterator val_it;
+        std::vector<std::pair<val_it, val_it> > seqs(p);
+        for (int i = 0; i < p; ++i) {
+          seqs[i].first = output.begin() + recv_displs[i];
+          seqs[i].second = seqs[i].first + recv_counts[i];
+        }
+        std::vector<V> merged(recv_n);
+        ::fsc::multiway_merge(seqs, merged.begin(), comp, settings.get_threads());
+        output.swap(merged);
       }
-      } // p > 2
 
       BL_BENCH_COLLECTIVE_END(imxx_samplesort, "local_merge", recv_n, comm);
 
@@ -2526,35 +3483,24 @@ namespace imxx
 
       BL_BENCH_START(imxx_samplesort);
 
-      bool full_buffer = true;  // is a full buffer availabel for use?
-      bool use_sort = (p > 2);
+      bool full_buffer = true;  // is a full buffer available for use?
+      bool use_sort = (p > 2) && (recv_n <= (size_t)p * (size_t)p);  // merge p = 2, or if there are enough entries.
 
-#if defined(__GNUG__)
-	// if not gnu, then leave use_sort as is, since we can't really use k-way merge.
-#ifdef MXX_USE_GCC_MULTIWAY_MERGE
-      use_sort &= (recv_n <= (size_t)p * (size_t)p);  // if merge is defined, then use merge if p = 2, or if have enough entries.
-#endif
-#endif
-
-      V* buf = nullptr;
-      std::ptrdiff_t buf_size = 0;
+      // merge buffer, at most the budget.  the merge uses output -> buffer -> output in rounds if it is smaller than recv_n.
+      std::vector<V> merge_buf;
       if (use_sort) {
         full_buffer = false;
       } else {
-        // not using sort, then let's check if we can alloc temp buffer
-        std::tie(buf, buf_size) = std::get_temporary_buffer<V>(recv_n);
-        full_buffer = (static_cast<size_t>(buf_size) >= recv_n);
- 
-	// get_temporary_buffer does not seem to work correctly with more than 2 processses under clang.
-
-      std::cout << "rank " << comm.rank() << " SAMPLESORT allocated " << (full_buffer ? "full" : "partial") << " buffer. " << buf_size << "/" << 
-		recv_n << " override " << (full_buffer_override ? "full" : "partial") << std::endl;
-
-     }
+        size_t budget = std::max(samplesort_settings::instance().get_budget_bytes() / sizeof(V), static_cast<size_t>(1));
+        merge_buf.resize(std::min(recv_n, budget));
+        full_buffer = (merge_buf.size() >= recv_n);
+      }
+      V* buf = merge_buf.data();
+      size_t buf_size = merge_buf.size();
 
 // for testing only.
       if (use_sort_override != 0) {
-    	  use_sort |= use_sort_override == 1;  // use merge only when allowed by compiler and data size and not overriden
+    	  use_sort |= use_sort_override == 1;  // use merge only when allowed by data size and not overriden
 
     	  if (comm.rank() == 0) std::cout << "SAMPLESORT using " << (use_sort ? "sort" : "merge") << std::endl;
       }
@@ -2563,10 +3509,12 @@ namespace imxx
 
     	  if (comm.rank() == 0) std::cout << "SAMPLESORT using " << (full_buffer ? "full" : "partial") << " buffer" << std::endl;
       }
-
-
-
-      // if no gcc multiway merge, then use 2-way merge for p=2, and sort otherwise.
+      // a partial merge needs at least 1 element of buffer.
+      if (!use_sort && !full_buffer && (buf_size == 0) && (recv_n > 0)) {
+        merge_buf.resize(1);
+        buf = merge_buf.data();
+        buf_size = 1;
+      }
 
       BL_BENCH_END(imxx_samplesort, "res_buf", recv_n);
 
@@ -2574,17 +3522,15 @@ namespace imxx
 
       // TODO: use collective with iterators [begin,end) instead of pointers!
       if (use_sort || !full_buffer)
-        ::mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
+        ::imxx::payload_all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
       else
-        ::mxx::all2allv(input.data(), send_counts, buf, recv_counts, comm);
+        ::imxx::payload_all2allv(input.data(), send_counts, buf, recv_counts, comm);
 
       BL_BENCH_END(imxx_samplesort, "all2all", local_size);
 
       BL_BENCH_START(imxx_samplesort);
 
       // 9. local reordering
-      /* multiway-merge (using the implementation in __gnu_parallel) */
-      // if p = 2, then merge
       if (use_sort) {
         if (_Stable)
             std::stable_sort(output.begin(), output.end(), comp);
@@ -2592,133 +3538,99 @@ namespace imxx
             std::sort(output.begin(), output.end(), comp);
 
       } else {
-        if (p == 2) { // use 2-way merge.  always stable.
-          if (full_buffer) {
-            std::merge(buf, buf + recv_counts[0],
-                       buf + recv_counts[0], buf + recv_n,
-                       output.begin(), comp);
+        // p-way merge with a loser tree.  the runs are in rank order, so it is stable.
+        BL_BENCH_INIT(imxx_samplesort_merge);
+        std::vector<size_t> recv_displs = mxx::impl::get_displacements(recv_counts);
 
-          } else {
-            std::inplace_merge(output.begin(), output.begin() + recv_counts[0], output.end(), comp);
+        if (full_buffer) {  // if we have full buffer, then all2all result is in the buf.  merge into output.
+          // buffer -> output
+
+          BL_BENCH_START(imxx_samplesort_merge);
+
+          std::vector<std::pair<V*, V*> > seqs(p);
+          for (int i = 0; i < p; ++i) {
+            seqs[i].first = buf + recv_displs[i];   // point to buffer.
+            seqs[i].second = seqs[i].first + recv_counts[i];
           }
-#ifdef MXX_USE_GCC_MULTIWAY_MERGE
+          BL_BENCH_END(imxx_samplesort_merge, "merge_ranges", seqs.size());
 
-        } else { // using multiway merge, and p > 2.
-          BL_BENCH_INIT(imxx_samplesort_merge);
-          __gnu_parallel::sequential_tag seq_tag;
+          BL_BENCH_START(imxx_samplesort_merge);
+          ::fsc::multiway_merge(seqs, output.begin(), comp, samplesort_settings::instance().get_threads());
+          BL_BENCH_END(imxx_samplesort_merge, "merge", recv_n);
 
-          if (full_buffer) {  // if we have full buffer, then all2all result is in the buf.  merge into output.
-            // buffer -> output
+        } else {  // buffer was not big enough, so all2all went into output.  now need to use buffer to merge and then copy into output.
 
-            BL_BENCH_START(imxx_samplesort_merge);
+          // output -> temp buffer -> back to output, in iterations.
+          BL_BENCH_START(imxx_samplesort_merge);
 
-            std::vector<std::pair<V*, V*> > seqs(p);
+          // prepare the sequence offsets
+          typedef typename std::vector<V>::iterator val_it;
 
-            std::vector<size_t> recv_displs = mxx::impl::get_displacements(recv_counts);
-            for (int i = 0; i < p; ++i) {
-              seqs[i].first = buf + recv_displs[i];   // point to buffer.
-              seqs[i].second = seqs[i].first + recv_counts[i];
-            }
-            BL_BENCH_END(imxx_samplesort_merge, "merge_ranges", seqs.size());
-
-            BL_BENCH_START(imxx_samplesort_merge);
-            if (_Stable)
-              __gnu_parallel::stable_multiway_merge(seqs.begin(), seqs.end(), output.data(), recv_n, comp, seq_tag);
-            else
-              __gnu_parallel::multiway_merge(seqs.begin(), seqs.end(), output.data(), recv_n, comp, seq_tag);
-
-            BL_BENCH_END(imxx_samplesort_merge, "merge", recv_n);
-
-          } else {  // buffer was not big enough, so all2all went into output.  now need to use buffer to merge and then copy into output.
-
-            // output -> temp buffer -> back to output, in iterations.
-            BL_BENCH_START(imxx_samplesort_merge);
-
-            // prepare the sequence offsets
-			typedef typename std::vector<V>::iterator val_it;
-
-			std::vector<std::pair<val_it, val_it> > seqs(p);
-			std::vector<size_t> recv_displs = mxx::impl::get_displacements(recv_counts);
-			for (int i = 0; i < p; ++i) {
-			  seqs[i].first = output.begin() + recv_displs[i];
-			  seqs[i].second = seqs[i].first + recv_counts[i];
-			}
-			BL_BENCH_END(imxx_samplesort_merge, "merge_ranges", seqs.size());
-
-
-			BL_BENCH_START(imxx_samplesort_merge);
-			size_t remain_n = recv_n;
-			size_t target_size = buf_size;
-
-            val_it start_merge_it = output.begin();
-            V* merge_buf_begin = buf;
-
-            BL_BENCH_LOOP_START(imxx_samplesort_merge, 0);
-            BL_BENCH_LOOP_START(imxx_samplesort_merge, 1);
-            BL_BENCH_LOOP_START(imxx_samplesort_merge, 2);
-            size_t count0 = 0;
-            size_t count1 = 0;
-            size_t count2 = 0;
-
-
-            while (remain_n > 0) {
-
-                BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 0);
-            	if (remain_n < target_size) target_size = remain_n;
-
-              // 2 iterations.  unroll loop.
-              // first half.
-              // i)   merge at most `merge_n` many elements sequentially
-              if (_Stable)
-                __gnu_parallel::stable_multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, target_size, comp, seq_tag);
-              else
-                __gnu_parallel::multiway_merge(seqs.begin(), seqs.end(), merge_buf_begin, target_size, comp, seq_tag);
-
-              BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 0);
-              count0 += target_size;
-
-              BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 1);
-
-              // ii)  compact the remaining elements in `output`
-              // TCP:  doing this a fixed number of times makes it linear in data size.  if the number of iterations is dependent on data size, then it becomes quadratic.
-              for (int i = p-1; i > 0; --i)
-              {
-                  seqs[i-1].first = std::move_backward(seqs[i-1].first, seqs[i-1].second, seqs[i].first);
-                  seqs[i-1].second = seqs[i].first;
-              }
-              BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 1);
-              count1 += std::distance(seqs[0].first, seqs[p-1].second);
-
-              BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 2);
-
-              // iii) copy the output buffer `merge_n` elements back into `output`
-              //      `recv_elements`.
-              start_merge_it = std::copy(merge_buf_begin, merge_buf_begin + target_size, start_merge_it);
-              assert(start_merge_it == seqs[0].first);
-
-              // now the second half.
-              remain_n -= target_size;
-              BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 2);
-              count2 += target_size;
-              }
-            BL_BENCH_LOOP_END(imxx_samplesort_merge, 0, "merge", count0);
-            BL_BENCH_LOOP_END(imxx_samplesort_merge, 1, "compact", count1);
-            BL_BENCH_LOOP_END(imxx_samplesort_merge, 2, "copy", count2);
+          std::vector<std::pair<val_it, val_it> > seqs(p);
+          for (int i = 0; i < p; ++i) {
+            seqs[i].first = output.begin() + recv_displs[i];
+            seqs[i].second = seqs[i].first + recv_counts[i];
           }
+          BL_BENCH_END(imxx_samplesort_merge, "merge_ranges", seqs.size());
+
 
+          BL_BENCH_START(imxx_samplesort_merge);
+          size_t remain_n = recv_n;
+          size_t target_size = buf_size;
 
+          val_it start_merge_it = output.begin();
 
-          BL_BENCH_REPORT_MPI_NAMED(imxx_samplesort_merge, "imxx_samplesort_merge", comm);
+          BL_BENCH_LOOP_START(imxx_samplesort_merge, 0);
+          BL_BENCH_LOOP_START(imxx_samplesort_merge, 1);
+          BL_BENCH_LOOP_START(imxx_samplesort_merge, 2);
+          size_t count0 = 0;
+          size_t count1 = 0;
+          size_t count2 = 0;
 
-#else
-	} else {
-	  throw ::std::logic_error("ERROR: specified multiway merge but is not using gnu compiler");	
-#endif
 
-        }  // else p > 2, in the absense of MXX_USE_GCC_MULTIWAY_MERGE, would be using SORT and handled earlier.
+          while (remain_n > 0) {
+
+            BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 0);
+            if (remain_n < target_size) target_size = remain_n;
+
+            // i)   merge at most `target_size` many elements sequentially
+            {
+              ::fsc::loser_tree<val_it, _Compare> tree(seqs, comp);
+              for (size_t i = 0; i < target_size; ++i) buf[i] = std::move(*(tree.pop()));
+              seqs = tree.get_runs();
+            }
+
+            BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 0);
+            count0 += target_size;
+
+            BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 1);
+
+            // ii)  compact the remaining elements in `output`
+            // TCP:  doing this a fixed number of times makes it linear in data size.  if the number of iterations is dependent on data size, then it becomes quadratic.
+            for (int i = p-1; i > 0; --i)
+            {
+                seqs[i-1].first = std::move_backward(seqs[i-1].first, seqs[i-1].second, seqs[i].first);
+                seqs[i-1].second = seqs[i].first;
+            }
+            BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 1);
+            count1 += std::distance(seqs[0].first, seqs[p-1].second);
 
+            BL_BENCH_LOOP_RESUME(imxx_samplesort_merge, 2);
 
+            // iii) copy the output buffer `target_size` elements back into `output`
+            start_merge_it = std::move(buf, buf + target_size, start_merge_it);
+            assert(start_merge_it == seqs[0].first);
+
+            remain_n -= target_size;
+            BL_BENCH_LOOP_PAUSE(imxx_samplesort_merge, 2);
+            count2 += target_size;
+          }
+          BL_BENCH_LOOP_END(imxx_samplesort_merge, 0, "merge", count0);
+          BL_BENCH_LOOP_END(imxx_samplesort_merge, 1, "compact", count1);
+          BL_BENCH_LOOP_END(imxx_samplesort_merge, 2, "copy", count2);
+        }
 
+        BL_BENCH_REPORT_MPI_NAMED(imxx_samplesort_merge, "imxx_samplesort_merge", comm);
       }
 
       BL_BENCH_COLLECTIVE_END(imxx_samplesort, "local_merge", recv_n, comm);
@@ -2727,7 +3639,7 @@ namespace imxx
 
 
       // CLEAR the temp buffer.
-      if (!use_sort) std::return_temporary_buffer(buf);
+      merge_buf.clear(); std::vector<V>().swap(merge_buf);
 
       BL_BENCH_END(imxx_samplesort, "rel_buf", buf_size);
 
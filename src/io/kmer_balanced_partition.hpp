@@ -0,0 +1,204 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * kmer_balanced_partition.hpp
+ *
+ * @brief  compute file partition boundaries that balance the estimated number of kmers per process instead of bytes.
+ * @details  the file is described by weighted segments, i.e. byte ranges with an estimated kmer count, spread uniformly over
+ *    the range.  bytes outside of all segments (e.g. FASTA headers) have no weight.  the boundaries split the cumulative
+ *    weight evenly.
+ *
+ *    FASTA:  the segments are the sequences in the sidecar fasta_index, each with (sequence length - k + 1) kmers.
+ *    FASTQ:  the segments are windows of the byte partition, with kmer density measured from a sample of complete records
+ *            at the start of each window.  short reads and long headers have fewer kmers per byte.
+ *
+ *    the boundaries are byte offsets.  the parallel file still aligns them to records as usual.
+ */
+
+#ifndef KMER_BALANCED_PARTITION_HPP_
+#define KMER_BALANCED_PARTITION_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <tuple>
+#include <algorithm>    // find, min, max
+#include <iterator>     // distance
+
+#include <partition/range.hpp>
+#include <partition/partitioner.hpp>
+#include <io/fasta_index.hpp>
+
+
+namespace bliss {
+
+namespace io {
+
+/**
+ * @brief functions for computing kmer balanced partition boundaries.  no state.
+ */
+struct kmer_balanced_partition {
+
+    using range_type = ::bliss::partition::range<size_t>;
+
+    /// byte range with estimated kmer count, spread uniformly over the range.
+    struct segment {
+        size_t start;
+        size_t end;
+        double weight;
+    };
+
+    /// summary of the complete FASTQ records in a sample.
+    struct fastq_sample {
+        /// number of complete records
+        size_t records;
+        /// bytes in the complete records.
+        size_t bytes;
+        /// kmers in the complete records.
+        size_t kmers;
+        /// largest record size.
+        size_t max_record;
+    };
+
+    /**
+     * @brief split a range into nparts so that each part has about the same weight.
+     * @param segments       weighted segments in increasing order, not overlapping.  parts outside of the range are ignored.
+     * @param r              range to split, e.g. the file range.
+     * @param nparts         number of parts
+     * @param min_part_size  minimum size in bytes of each part, e.g. so that a FASTQ part contains a record start.  ignored
+     *                       if the range is too small.
+     * @return  nparts + 1 boundaries. part i is [boundaries[i], boundaries[i+1]).  block partition if there is no weight.
+     */
+    static ::std::vector<size_t> split(::std::vector<segment> const & segments, range_type const & r,
+                                       size_t const & nparts, size_t const & min_part_size = 0) {
+      ::std::vector<size_t> bounds(nparts + 1, r.start);
+      bounds[nparts] = r.end;
+      if (nparts < 2) return bounds;
+
+      double total = 0.0;
+      for (auto const & s : segments) {
+        range_type x = range_type::intersect(range_type(s.start, s.end), r);
+        if (x.size() > 0) total += s.weight * static_cast<double>(x.size()) / static_cast<double>(s.end - s.start);
+      }
+
+      if (total <= 0.0) {
+        ::bliss::partition::BlockPartitioner<range_type> blocks;
+        blocks.configure(r, nparts);
+        for (size_t i = 1; i < nparts; ++i) bounds[i] = blocks.getNext(i).start;
+        return bounds;
+      }
+
+      // walk the segments once, placing each boundary where the cumulative weight reaches i * total / nparts.
+      double cumulative = 0.0;
+      size_t i = 1;
+      for (auto const & s : segments) {
+        range_type x = range_type::intersect(range_type(s.start, s.end), r);
+        if (x.size() == 0) continue;
+
+        double w = s.weight * static_cast<double>(x.size()) / static_cast<double>(s.end - s.start);
+        while ((i < nparts) && (cumulative + w >= total * static_cast<double>(i) / static_cast<double>(nparts))) {
+          double frac = (w > 0.0) ? (total * static_cast<double>(i) / static_cast<double>(nparts) - cumulative) / w : 0.0;
+          bounds[i] = x.start + ::std::min(x.size(), static_cast<size_t>(frac * static_cast<double>(x.size())));
+          ++i;
+        }
+        cumulative += w;
+      }
+      // rounding.  remaining boundaries at the end of the last weighted byte.
+      for (; i < nparts; ++i) bounds[i] = r.end;
+
+      // enforce the minimum size, if the range is large enough.
+      if ((min_part_size > 0) && (r.size() >= nparts * min_part_size)) {
+        for (i = 1; i < nparts; ++i) {
+          bounds[i] = ::std::max(bounds[i], bounds[i - 1] + min_part_size);
+        }
+        for (i = nparts - 1; i > 0; --i) {
+          bounds[i] = ::std::min(bounds[i], bounds[i + 1] - min_part_size);
+        }
+      }
+
+      return bounds;
+    }
+
+    /**
+     * @brief segments of a FASTA file from its sidecar index.  1 per sequence, weighted by its kmer count.
+     * @note  the sequence range includes the line breaks, so the kmer count is slightly over estimated for multiline FASTA.
+     */
+    static ::std::vector<segment> fasta_segments(::std::vector<::bliss::io::fasta_index::entry_type> const & entries,
+                                                 size_t const & k) {
+      ::std::vector<segment> segments;
+      segments.reserve(entries.size());
+
+      for (auto const & e : entries) {
+        size_t len = ::std::get<2>(e) - ::std::get<1>(e);
+        if (len == 0) continue;
+        segments.push_back(segment{::std::get<1>(e), ::std::get<2>(e),
+          (len < k) ? 0.0 : static_cast<double>(len - k + 1)});
+      }
+      return segments;
+    }
+
+    /**
+     * @brief count the complete FASTQ records and their kmers in a sample.
+     * @details  records are 4 lines, "@" header, sequence, "+" line and quality.  counting starts at first_record and stops at
+     *           the first record that is incomplete or not well formed.
+     * @param first_record   start of a record, e.g. from FASTQParser's find_first_record.
+     * @param last           end of the sample.
+     * @param at_file_end    if true, last is the end of file, so the last record can omit its final line break.
+     * @param k              kmer size.
+     */
+    template <typename Iterator>
+    static fastq_sample sample_fastq(Iterator first_record, Iterator last, bool const & at_file_end, size_t const & k) {
+      fastq_sample out{0, 0, 0, 0};
+
+      Iterator it = first_record;
+      while (it != last) {
+        Iterator record_start = it;
+        Iterator lines[4];
+        size_t seq_len = 0;
+
+        bool complete = true;
+        for (int j = 0; j < 4; ++j) {
+          lines[j] = it;
+          Iterator eol = ::std::find(it, last, '\n');
+          if ((eol == last) && !((j == 3) && at_file_end && (eol != it))) {
+            complete = false;
+            break;
+          }
+          if (j == 1) {
+            seq_len = ::std::distance(it, eol);
+            if ((seq_len > 0) && (*(eol - 1) == '\r')) --seq_len;
+          }
+          it = (eol == last) ? eol : (eol + 1);
+        }
+        if (!complete || (*(lines[0]) != '@') || (*(lines[2]) != '+')) break;
+
+        size_t bytes = ::std::distance(record_start, it);
+        ++out.records;
+        out.bytes += bytes;
+        out.kmers += (seq_len < k) ? 0 : (seq_len - k + 1);
+        out.max_record = ::std::max(out.max_record, bytes);
+      }
+      return out;
+    }
+
+};
+
+} // io
+
+} // bliss
+
+#endif /* KMER_BALANCED_PARTITION_HPP_ */
@@ -40,11 +40,12 @@
 
 #if defined(USE_MPI)
 #include "mpi.h"
+#include <mxx/reduction.hpp>  // any_of
 #endif
 
-//#if defined(USE_OPENMP)
-//#include "omp.h"
-//#endif
+#if defined(USE_OPENMP)
+#include "omp.h"
+#endif
 
 #include <unistd.h>     // sysconf
 #include <sys/stat.h>   // block size.
@@ -52,10 +53,19 @@
 #include <utility>      // pair and utility functions.
 #include <type_traits>
 #include <cctype>       // tolower.
+#include <limits>       // numeric_limits
+#include <memory>       // unique_ptr
+#include <mutex>
 
 #include "io/file.hpp"
+#include "io/fasta_stream.hpp"
+#include "io/bgzf_file.hpp"
+#include "io/multi_file.hpp"
 #include "io/fastq_loader.hpp"
 #include "io/fasta_loader.hpp"
+#include "io/fasta_index.hpp"
+#include "io/packed_sequence_file.hpp"
+#include "io/long_read_partition.hpp"
 //#include "io/fasta_iterator.hpp"
 
 #include "iterators/container_concatenating_iterator.hpp"
@@ -63,6 +73,7 @@
 #include "utils/logging.h"
 #include "utils/file_utils.hpp"
 #include "common/kmer.hpp"
+#include "common/kmer_iterators.hpp"
 #include "common/base_types.hpp"
 #include "common/sequence.hpp"
 #include "utils/kmer_utils.hpp"
@@ -75,6 +86,9 @@
 
 #include "io/sequence_iterator.hpp"
 
+#include "partition/range.hpp"
+#include "partition/work_stealing_scheduler.hpp"
+
 #include "utils/benchmark_utils.hpp"
 #include "utils/file_utils.hpp"
 
@@ -98,42 +112,40 @@ struct KmerFileHelper {
 
 
   /**
-   * @brief  generate kmers or kmer tuples for 1 block of raw data.
-   * @note   requires that SeqParser be passed in and operates on the Block's Iterators.
-   *          Mostly, this is because we need to broadcast the state of SeqParser to procs on the same node (L1 seq info) and recreate on child procs a new SeqParser (for L2)
+   * @brief  generate kmers or kmer tuples from the sequences in [seqs_start, seqs_end), stopping after at least max_count entries have been generated.
+   * @details  seqs_start is advanced past the sequences that have been processed, so subsequent calls continue from where the last call stopped.
+   *           all kmers from a sequence are generated in the same call, so the output may exceed max_count by up to 1 sequence's worth of kmers.
    * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.  template template parameter, param is iterator
    * @tparam KmerParser           parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
    * @tparam BlockType    input partition type, supports in memory (vector) vs memmapped.
-   * @param partition
-   * @param result        output vector.  should be pre allocated.
+   * @param partition     the data block containing the sequences.
+   * @param seqs_start    iterator to the first sequence to process.  modified.
+   * @param seqs_end      end iterator for the sequences.
+   * @param result        output vector.
+   * @param max_count     number of entries to generate before returning.
+   * @return              number of sequences and number of entries generated.
    */
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
-  static std::pair<size_t, size_t> read_block_old(BlockType const & partition,
-      SeqParser<typename BlockType::iterator> const &seq_parser,
-      std::vector<typename KmerParser::value_type>& result) {
+  static std::pair<size_t, size_t> read_block_partial(BlockType const & partition,
+      SeqIterType<typename BlockType::const_iterator, SeqParser> & seqs_start,
+      SeqIterType<typename BlockType::const_iterator, SeqParser> const & seqs_end,
+      std::vector<typename KmerParser::value_type>& result,
+      size_t const & max_count = ::std::numeric_limits<size_t>::max()) {
 
     // from FileLoader type, get the block iter type and range type
     using CharIterType = typename BlockType::const_iterator;
 
-    //using SeqIterType = ::bliss::io::SequencesIterator<CharIterType, SeqParser >;
-
     //== sequence parser type
     KmerParser kmer_parser(partition.valid_range_bytes);
     ::bliss::utils::file::NotEOL not_eol;
 
-    //== process the chunk of data
-
-    //==  and wrap the chunk inside an iterator that emits Reads.
-    SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
-    SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
-
     ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
 
     size_t before = result.size();
     size_t seqs = 0;
 
     //== loop over the reads
-    for (; seqs_start != seqs_end; ++seqs_start)
+    for (; (seqs_start != seqs_end) && ((result.size() - before) < max_count); ++seqs_start)
     {
       auto seq = *seqs_start;
       if (seq.seq_size() == 0) continue;
@@ -180,12 +192,38 @@ struct KmerFileHelper {
 
     }
 
-    //std::cout << "number of sequences " << seqs << " number of total entries " << result.size() << " before insertion " << before << std::endl;
-
     return std::make_pair(seqs, result.size() - before);
   }
 
 
+  /**
+   * @brief  generate kmers or kmer tuples for 1 block of raw data.
+   * @note   requires that SeqParser be passed in and operates on the Block's Iterators.
+   *          Mostly, this is because we need to broadcast the state of SeqParser to procs on the same node (L1 seq info) and recreate on child procs a new SeqParser (for L2)
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.  template template parameter, param is iterator
+   * @tparam KmerParser           parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   * @tparam BlockType    input partition type, supports in memory (vector) vs memmapped.
+   * @param partition
+   * @param result        output vector.  should be pre allocated.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static std::pair<size_t, size_t> read_block_old(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      std::vector<typename KmerParser::value_type>& result) {
+
+    // from FileLoader type, get the block iter type and range type
+    using CharIterType = typename BlockType::const_iterator;
+
+    //== process the chunk of data
+
+    //==  and wrap the chunk inside an iterator that emits Reads.
+    SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+    SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
+
+    return read_block_partial<KmerParser, SeqParser, SeqIterType>(partition, seqs_start, seqs_end, result);
+  }
+
+
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
   static std::pair<size_t, size_t> read_block(BlockType const & partition,
       SeqParser<typename BlockType::iterator> const &seq_parser,
@@ -241,6 +279,177 @@ struct KmerFileHelper {
   }
 
 
+  /**
+   * @brief  number of kmers that KmerParser generates from 1 sequence, within the partition's valid range.
+   * @details  exact for parsers that emit every window.  filtering parsers, e.g. NFilteredKmerParser, may emit fewer.
+   */
+  template <typename KmerParser, typename SeqType>
+  static size_t count_kmers(SeqType const & seq, ::bliss::partition::range<size_t> const & valid_range) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<typename KmerParser::kmer_type>::get_valid_iterator_range(seq, valid_range, KmerParser::window_size);
+    if (!has_window) return 0;
+
+    size_t chars = std::count_if(seq_begin, seq_end, ::bliss::utils::file::NotEOL());
+    return chars - KmerParser::window_size + 1;
+  }
+
+  /// the sequences of a block and where each sequence's kmers go in the output.  from count_block, for fill_block.
+  template <typename SeqType>
+  struct block_layout {
+      ::std::vector<SeqType> seqs;
+      /// exclusive prefix sum of the kmer counts of seqs, with seqs.size() + 1 entries.
+      ::std::vector<size_t> offsets;
+      /// sequences that start in the valid range, as counted by read_block.
+      size_t seq_count;
+      /// for each of seqs, the number of sequences that start in the valid range up to and including it.  for number_reads.
+      ::std::vector<size_t> local_ids;
+
+      block_layout() : offsets(1, 0), seq_count(0) {}
+
+      /// number of output entries to allocate.
+      size_t size() const { return offsets.back(); }
+  };
+
+  /**
+   * @brief  first phase of the 2 phase extraction:  find the sequences of a block and the number of kmers of each.
+   * @details  the caller allocates layout.size() entries, in its own buffer if it has one, and calls fill_block.
+   *          generates the same kmers, in the same order, as read_block.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static block_layout<typename ::std::iterator_traits<SeqIterType<typename BlockType::const_iterator, SeqParser> >::value_type>
+  count_block(BlockType const & partition, SeqParser<typename BlockType::iterator> const &seq_parser) {
+    using CharIterType = typename BlockType::const_iterator;
+    using SeqType = typename ::std::iterator_traits<SeqIterType<CharIterType, SeqParser> >::value_type;
+
+    block_layout<SeqType> layout;
+    if (partition.getRange().size() == 0) return layout;
+
+    SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+    SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
+
+    size_t count;
+    for (auto it = seqs_start; it != seqs_end; ++it) {
+      auto seq = *it;
+      if (partition.valid_range_bytes.contains(seq.id.get_pos() + seq.seq_offset)) ++layout.seq_count;
+
+      count = count_kmers<KmerParser>(seq, partition.valid_range_bytes);
+      if (count == 0) continue;
+
+      layout.seqs.emplace_back(seq);
+      layout.offsets.emplace_back(layout.offsets.back() + count);
+      layout.local_ids.emplace_back(layout.seq_count);
+    }
+    return layout;
+  }
+
+  /**
+   * @brief  optional pass between count_block and fill_block:  replace the sequence ids of the layout with dense read numbers.
+   * @details  sets SequenceId::seq_id of each sequence to its number from 0 in file order, for DenseSequenceKmerId.
+   *          this process's first number is the number of sequences before it, so 1 exscan with MPI.  a sequence that
+   *          starts before the valid range continues the last one started before it, which has the number before the first.
+   * @param first   number of the first sequence that starts in this block.
+   * @return  number of sequences that start in this block.
+   */
+  template <typename SeqType>
+  static size_t number_reads(block_layout<SeqType> & layout, size_t const & first = 0) {
+    for (size_t i = 0; i < layout.seqs.size(); ++i) {
+      layout.seqs[i].id.seq_id = first + layout.local_ids[i] - 1;
+    }
+    return layout.seq_count;
+  }
+
+  /// thread pool for fill_block, shared by the calls of this process.  recreated if the thread count changes.
+  static ::bliss::partition::work_stealing_scheduler & get_scheduler(size_t const & nthreads) {
+    static ::std::unique_ptr<::bliss::partition::work_stealing_scheduler> pool;
+    if (!pool || (pool->get_num_threads() != nthreads)) pool.reset(new ::bliss::partition::work_stealing_scheduler(nthreads));
+    return *pool;
+  }
+  /// the scheduler is not reentrant, so calls from different threads, e.g. a streamed build's consumer, take turns.
+  static ::std::mutex & get_scheduler_mutex() {
+    static ::std::mutex m;
+    return m;
+  }
+
+  /**
+   * @brief  second phase of the 2 phase extraction:  generate the kmers of the layout's sequences into output.
+   * @details  each thread writes whole sequences at their offsets, so there are no bounds checks or reallocation.
+   *          the sequences are processed in chunks of 64 on the work stealing scheduler, so threads that finish their
+   *          block early take chunks of long reads from the others.  if the parser filters kmers, the output is
+   *          compacted afterwards.
+   * @param output    room for layout.size() entries.
+   * @param nthreads  number of threads.  0 means omp_get_max_threads() with OpenMP, else 1.
+   * @return          number of entries generated, at the front of output.
+   */
+  template <typename KmerParser, typename BlockType, typename SeqType>
+  static size_t fill_block(BlockType const & partition, block_layout<SeqType> const & layout,
+                           typename KmerParser::value_type * output, int nthreads = 0) {
+    using OutputType = typename KmerParser::value_type;
+
+    size_t const n = layout.seqs.size();
+    if (n == 0) return 0;
+
+#if defined(USE_OPENMP)
+    int const T = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+    int const T = (nthreads > 0) ? nthreads : 1;
+#endif
+
+    ::std::vector<size_t> written(n, 0);
+
+    // parsers keep per read buffers, so 1 per thread.
+    ::std::vector<KmerParser> parsers;
+    parsers.reserve(T);
+    for (int i = 0; i < T; ++i) parsers.emplace_back(partition.valid_range_bytes);
+
+    auto fill = [&parsers, &layout, &written, output](::bliss::partition::range<size_t> const & r, size_t id) {
+      OutputType * out;
+      for (size_t i = r.start; i < r.end; ++i) {
+        out = output + layout.offsets[i];
+        written[i] = parsers[id](layout.seqs[i], out) - out;
+      }
+    };
+
+    if (T == 1) {
+      fill(::bliss::partition::range<size_t>(0, n), 0);
+    } else {
+      ::std::lock_guard<::std::mutex> lock(get_scheduler_mutex());
+      get_scheduler(T).parallel_for(::bliss::partition::range<size_t>(0, n), static_cast<size_t>(64), fill);
+    }
+
+    // close the gaps left by filtered kmers.
+    size_t pos = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if ((pos != layout.offsets[i]) && (written[i] > 0))
+        ::std::move(output + layout.offsets[i], output + layout.offsets[i] + written[i], output + pos);
+      pos += written[i];
+    }
+    return pos;
+  }
+
+  /**
+   * @brief  generate kmers or kmer tuples for 1 block of raw data with the 2 phase extraction.  appends to result.
+   * @details  result is resized once to the exact count.  same output as read_block.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static std::pair<size_t, size_t> read_block_counted(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      std::vector<typename KmerParser::value_type>& result, int nthreads = 0) {
+
+    auto layout = count_block<KmerParser, SeqParser, SeqIterType>(partition, seq_parser);
+
+    size_t before = result.size();
+    result.resize(before + layout.size());
+    size_t count = fill_block<KmerParser>(partition, layout, result.data() + before, nthreads);
+    result.resize(before + count);
+
+    return std::make_pair(layout.seq_count, count);
+  }
+
+
   /**
    * @brief initialize the sequence parser, estimate capacity and reserver, and then call read_block to parse the actual data.
    */
@@ -294,8 +503,6 @@ struct KmerFileHelper {
                          std::vector<typename KmerParser::value_type>& result) {
       std::pair<size_t, size_t> read = {0, 0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -304,24 +511,11 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange());
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size  + (est_size >> 4) );
-        BL_BENCH_END(file, "reserve", est_size + (est_size >> 4));
-
+        //== count the kmers of each sequence, allocate once, and generate in parallel into the allocated entries.
         BL_BENCH_START(file);
         //=== copy into array
         if (partition.getRange().size() > 0) {
-          read = read_block<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+          read = read_block_counted<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
         }
         BL_BENCH_END(file, "read_seqs", read.first);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
@@ -433,6 +627,124 @@ struct KmerFileHelper {
   }
 
 
+  /**
+   * @brief read a file's content and generate kmers, place in a vector as return result.  file is read with O_DIRECT, bypassing page cache.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static std::pair<size_t, size_t> read_file_direct(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result) {
+
+      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::direct_posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result);
+
+  }
+
+
+  /**
+   * @brief  pack the FASTQ sequences whose data start in the partition's valid range.  the records are complete in a FASTQ partition.
+   */
+  template <typename Alphabet, typename BlockType>
+  static size_t pack_block(BlockType const & partition,
+      ::bliss::io::FASTQParser<typename BlockType::const_iterator> const & seq_parser,
+      typename ::bliss::io::packed_sequence_file<Alphabet>::data_type & data) {
+
+    using CharIterType = typename BlockType::const_iterator;
+
+    ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+    ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_end(partition.in_mem_cend());
+
+    size_t seqs = 0;
+    for (; seqs_start != seqs_end; ++seqs_start) {
+      auto seq = *seqs_start;
+      if (seq.seq_size() == 0) continue;
+      if (!partition.valid_range_bytes.contains(seq.seq_global_offset())) continue;
+
+      ::bliss::io::packed_sequence_file<Alphabet>::append(data, seq);
+      ++seqs;
+    }
+    return seqs;
+  }
+
+  /// generate kmers from 1 packed record.
+  template <typename KmerType, typename KmerIter>
+  static void generate_packed(::bliss::index::kmer::KmerParser<KmerType> const *,
+                              ::bliss::common::SequenceId const &, size_t const &, KmerIter start, KmerIter const & end,
+                              std::vector<KmerType> & result) {
+    result.insert(result.end(), start, end);
+  }
+
+  /// generate kmer-position pairs from 1 packed record.  positions are the same as from the original FASTQ file.
+  template <typename TupleType, typename KmerIter>
+  static void generate_packed(::bliss::index::kmer::KmerPositionTupleParser<TupleType> const *,
+                              ::bliss::common::SequenceId const & seq_id, size_t const & seq_begin_offset, KmerIter start, KmerIter const & end,
+                              std::vector<TupleType> & result) {
+    typename ::bliss::index::kmer::KmerPositionTupleParser<TupleType>::IdType id(seq_id);
+    id += seq_begin_offset;  // change id to point to start of sequence (in file coord)
+    for (; start != end; ++start) {
+      result.emplace_back(*start, id);
+      id += 1;
+    }
+  }
+
+  /// generate kmer-count pairs from 1 packed record.
+  template <typename TupleType, typename KmerIter>
+  static void generate_packed(::bliss::index::kmer::KmerCountTupleParser<TupleType> const *,
+                              ::bliss::common::SequenceId const &, size_t const &, KmerIter start, KmerIter const & end,
+                              std::vector<TupleType> & result) {
+    using mapped_type = typename ::std::tuple_element<1, TupleType>::type;
+    for (; start != end; ++start) {
+      result.emplace_back(*start, mapped_type(1));
+    }
+  }
+
+  /// packed sequences do not have quality scores.
+  template <typename KmerParser, typename KmerIter>
+  static void generate_packed(KmerParser const *,
+                              ::bliss::common::SequenceId const &, size_t const &, KmerIter, KmerIter const &,
+                              std::vector<typename KmerParser::value_type> &) {
+    static_assert(sizeof(KmerParser) == 0, "packed sequence files support KmerParser, KmerPositionTupleParser, and KmerCountTupleParser only.  qualities are not stored.");
+  }
+
+  /**
+   * @brief  generate kmers or kmer tuples from packed sequences.  the kmers are generated directly from the packed words.
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count.
+   * @return              number of sequences and number of entries generated.
+   */
+  template <typename KmerParser>
+  static std::pair<size_t, size_t> parse_packed_data(
+      typename ::bliss::io::packed_sequence_file<typename KmerParser::kmer_type::KmerAlphabet>::data_type const & data,
+      std::vector<typename KmerParser::value_type>& result) {
+
+    using kmer_type = typename KmerParser::kmer_type;
+    using WordIter = ::WordType const *;
+    using KmerIter = ::bliss::common::PackedKmerGenerationIterator<WordIter, kmer_type>;
+
+    size_t before = result.size();
+    size_t words = 0;
+
+    // each record starts on a word boundary.
+    for (auto const & block : data.blocks) {
+      words = block.word_start;
+      for (size_t i = block.record_start; i < block.record_start + block.record_count; ++i) {
+        auto const & rec = data.records[i];
+        WordIter w = data.words.data() + words;
+        words += ::bliss::io::packed_sequence_file<typename kmer_type::KmerAlphabet>::get_word_count(rec.length);
+
+        if (rec.length < kmer_type::size) continue;
+
+        ::bliss::common::SequenceId seq_id(rec.pos_in_file, rec.seq_id, static_cast<uint16_t>(rec.file_id));
+        generate_packed(static_cast<KmerParser const *>(nullptr), seq_id, rec.seq_begin_offset,
+                        KmerIter(w), KmerIter(w, rec.length), result);
+      }
+    }
+
+    return std::make_pair(data.records.size(), result.size() - before);
+  }
+
+
 #if defined(USE_MPI)
 
   /**
@@ -482,15 +794,13 @@ struct KmerFileHelper {
   }
 
   /**
-   * @brief initialize the sequence parser, estimate capacity and reserver, and then call read_block to parse the actual data.
+   * @brief initialize the sequence parser, then call read_block_counted to parse the actual data into exactly sized output.
    */
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
   static  ::std::pair<size_t, size_t> parse_file_data(const BlockType & partition,
                          std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
       ::std::pair<size_t, size_t> read = {0,0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -499,24 +809,11 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size / 2);
-        BL_BENCH_END(file, "reserve", est_size);
-
+        //== count the kmers of each sequence, allocate once, and generate in parallel into the allocated entries.
         BL_BENCH_START(file);
         //=== copy into array
         if (partition.getRange().size() > 0) {
-          read = read_block<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+          read = read_block_counted<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
         }
         BL_BENCH_END(file, "read_seqs", read.first);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
@@ -528,6 +825,20 @@ struct KmerFileHelper {
   }
 
 
+  /**
+   * @brief  dense global read numbers over all processes, for DenseSequenceKmerId.  see number_reads above.
+   * @return  total number of sequences over all processes.  uint32_t read numbers fit if this is at most 2^32.
+   */
+  template <typename SeqType>
+  static size_t number_reads(block_layout<SeqType> & layout, const mxx::comm & _comm) {
+    size_t first = ::mxx::exscan(layout.seq_count, _comm);
+    if (_comm.rank() == 0) first = 0;
+
+    number_reads(layout, first);
+
+    return ::mxx::allreduce(layout.seq_count, _comm);
+  }
+
   template <typename FileType>
   static ::bliss::io::file_data open_file(const std::string & filename, const size_t overlap, const mxx::comm & _comm) {
         // file extension determines SeqParserType
@@ -570,6 +881,7 @@ struct KmerFileHelper {
         BL_BENCH_START(file);
         read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
         BL_BENCH_END(file, "read_kmers", read.second);
+        BL_BENCH_BYTES(file, partition.getRange().size() + read.second * sizeof(typename KmerParser::value_type));
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
       }
 
@@ -606,10 +918,82 @@ struct KmerFileHelper {
                         std::vector<typename KmerParser::value_type>& result,
                         const mxx::comm & _comm) {
 
-      // partitioned file with mmap or posix is only slightly faster than mpiio and may result in more jitter when congested.
-      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser >,
-          KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+      {
+        // partitioned file with mmap or posix is only slightly faster than mpiio and may result in more jitter when congested.
+        // kmers are parsed directly from the mapped file, without copying into file_data.
+        BL_BENCH_START(file);
+        ::bliss::io::mapped_file_data partition;
+        {
+          ::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser > fobj(filename, kmer_size - 1, _comm);
+          fobj.read_file(partition);
+        }  // file is closed here.  the mapping remains valid until partition goes out of scope.
+        BL_BENCH_END(file, "map", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+        BL_BENCH_END(file, "read_kmers", read.second);
+        BL_BENCH_BYTES(file, partition.getRange().size() + read.second * sizeof(typename KmerParser::value_type));
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_mmap", _comm);
+      return read;
+  }
+
+
+  /**
+   * @brief read a file's content and generate kmers, place in a vector as return result.  1 process per node reads the file.
+   * @details  the node's partitions are read once into shared memory, and each process parses its partition from there,
+   *           without copying.  fewer concurrent streams per node against the parallel file system.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_file_shared(const std::string & filename,
+                        std::vector<typename KmerParser::value_type>& result,
+                        const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        ::bliss::io::parallel::shared_file_data partition;
+        {
+          ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser > fobj(filename, kmer_size - 1, _comm);
+          fobj.read_file(partition);
+        }  // file is closed here.  the window remains valid until partition goes out of scope.
+        BL_BENCH_END(file, "read_shared", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+        BL_BENCH_END(file, "read_kmers", read.second);
+        BL_BENCH_BYTES(file, partition.getRange().size() + read.second * sizeof(typename KmerParser::value_type));
+      }
 
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_shared", _comm);
+      return read;
   }
 
 
@@ -631,6 +1015,589 @@ struct KmerFileHelper {
           KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
 
   }
+
+
+  /**
+   * @brief read a file's content and generate kmers, place in a vector as return result.  file is read with O_DIRECT, bypassing page cache.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_direct(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      // single pass read of large file.  avoid evicting resident memory via page cache.
+      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::direct_posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+
+  }
+
+  /**
+   * @brief read a FASTQ file's content and generate kmers, with partitions balanced by sampled kmer density.
+   * @details  FASTQ record starts are found from a few lines at the partition boundaries, so there is nothing to index.
+   *           instead the partitions are balanced with partitioned_file::balance_kmers, then read as in read_file.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_indexed_impl(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, ::std::false_type) {
+    ::std::pair<size_t, size_t> read = {0, 0};
+
+    constexpr int kmer_size = KmerParser::window_size;
+
+    BL_BENCH_INIT(file);
+    {
+      BL_BENCH_START(file);
+      FileType fobj(filename, kmer_size - 1, _comm);
+      fobj.balance_kmers(kmer_size);
+      ::bliss::io::file_data partition = fobj.read_file();
+      BL_BENCH_END(file, "open", partition.getRange().size());
+
+      BL_BENCH_START(file);
+      read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+      BL_BENCH_END(file, "read_kmers", read.second);
+      BL_BENCH_BYTES(file, partition.getRange().size() + read.second * sizeof(typename KmerParser::value_type));
+    }
+
+    BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_indexed", _comm);
+    return read;
+  }
+
+  /**
+   * @brief read a FASTA file's content and generate kmers, using the sidecar fasta_index to initialize the parser.
+   * @details  if the index is missing or stale, the sequences are found by the distributed search and the index is written,
+   *           so subsequent reads of the same file skip the search.  with an index, the partitions are balanced by the
+   *           kmer counts of the sequences instead of bytes, see partitioned_file::balance_kmers.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_indexed_impl(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, ::std::true_type) {
+    ::std::pair<size_t, size_t> read = {0, 0};
+
+    constexpr int kmer_size = KmerParser::window_size;
+    using CharIterType = typename ::bliss::io::file_data::const_iterator;
+
+    BL_BENCH_INIT(file);
+    {
+      BL_BENCH_START(file);
+      FileType fobj(filename, kmer_size - 1, _comm);
+      size_t file_size = fobj.size();
+      ::std::vector<::bliss::io::fasta_index::entry_type> entries;
+      bool indexed = ::bliss::io::fasta_index::read(filename, file_size, entries, _comm);
+      if (indexed) fobj.balance_kmers(kmer_size, entries);
+      ::bliss::io::file_data partition = fobj.read_file();
+      BL_BENCH_END(file, "open", partition.getRange().size());
+
+      BL_BENCH_START(file);
+      SeqParser<CharIterType> seq_parser;
+      if (indexed) {
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), entries);
+      } else {
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+        // best effort.  without the index, the next read searches for the records again.
+        ::bliss::io::fasta_index::write(filename, file_size, seq_parser.get_sequence_offsets(), _comm);
+      }
+      entries.clear();
+      BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+      //== reserve
+      BL_BENCH_START(file);
+      size_t record_size = 0;
+      size_t seq_len = 0;
+      std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
+      size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
+      est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
+      result.reserve(result.size() + est_size / 2);
+      BL_BENCH_END(file, "reserve", est_size);
+
+      BL_BENCH_START(file);
+      if (partition.getRange().size() > 0) {
+        read = read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+      }
+      BL_BENCH_END(file, "read_kmers", read.second);
+    }
+
+    BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_indexed", _comm);
+    return read;
+  }
+
+  /**
+   * @brief read a file's content and generate kmers, place in a vector as return result.  FASTA files use a sidecar index, <filename>.bidx.
+   * @details  the first read of a FASTA file writes the index.  later reads load it, balance the partitions by kmer count,
+   *           and each process initializes its parser locally. the index records all sequence offsets, so it is independent
+   *           of the number of processes.  FASTQ partitions are balanced by sampled kmer density.
+   * @note   FileType should be a partitioned_file, which provides balance_kmers.
+   * @note  static so can be used wihtout instantiating a internal map.  collective.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_indexed(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+    return read_file_indexed_impl<FileType, KmerParser, SeqParser, SeqIterType>(filename, result, _comm,
+        typename ::std::is_same<SeqParser<typename ::bliss::io::file_data::const_iterator>,
+                                ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator> >::type());
+  }
+
+#if defined(USE_ZLIB)
+  /**
+   * @brief read a gzip or BGZF compressed file's content and generate kmers, place in a vector as return result.
+   * @details  BGZF blocks are decompressed in parallel by all processes.  plain gzip is decompressed by rank 0 then scattered.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_bgzf(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension, excluding compression extension, determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_uncompressed_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition;
+        {
+          ::bliss::io::parallel::bgzf_file<SeqParser> fobj(filename, kmer_size - 1, _comm);
+          fobj.read_file(partition);
+        }
+        BL_BENCH_END(file, "decompress", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+        BL_BENCH_END(file, "read_kmers", read.second);
+        BL_BENCH_BYTES(file, partition.getRange().size() + read.second * sizeof(typename KmerParser::value_type));
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_bgzf", _comm);
+      return read;
+  }
+#endif
+
+  /**
+   * @brief read a list of FASTQ files' content and generate kmers, place in a vector as return result.
+   * @details  the files are partitioned as 1 concatenated byte space, so each process reads about the same number of bytes
+   *           even if files are of very different sizes.  see multi_file.
+   *           with whole_files, each file is read and parsed by 1 process, assigned by size, so there is no record search
+   *           and no communication other than the file sizes.  for many more files than processes.  FASTA is supported.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_files(const std::vector<std::string> & filenames,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, bool whole_files = false) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+      ::std::pair<size_t, size_t> piece_read;
+
+      // file extension determines SeqParserType
+      std::string extension;
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        extension = ::bliss::utils::file::get_file_extension(filenames[i]);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (::std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value ?
+            !(whole_files && ((extension.compare("fasta") == 0) || (extension.compare("fa") == 0))) :
+            (extension.compare("fastq") != 0)) {
+          throw std::invalid_argument("input filename extension is not supported.");
+        }
+      }
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::parallel::multi_file<FileReader, SeqParser> fobj(filenames, _comm, whole_files);
+        std::vector<::bliss::io::file_data> pieces = fobj.read_file();
+        BL_BENCH_END(file, "open", pieces.size());
+
+        BL_BENCH_START(file);
+        for (size_t i = 0; i < pieces.size(); ++i) {
+          if (pieces[i].getRange().size() == 0) continue;
+
+          // piece starts at a record, or is a whole file, so sequential parser is sufficient.
+          SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+          seq_parser.init_parser(pieces[i].in_mem_cbegin(), pieces[i].parent_range_bytes, pieces[i].in_mem_range_bytes, pieces[i].getRange());
+
+          piece_read = read_block_old<KmerParser, SeqParser, SeqIterType>(pieces[i], seq_parser, result);
+          read.first += piece_read.first;
+          read.second += piece_read.second;
+        }
+        BL_BENCH_END(file, "read_kmers", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_files", _comm);
+      return read;
+  }
+
+  /// block sizer of read_file_streamed:  the same block size for all batches.
+  struct fixed_block_size {
+      size_t block_size;
+      explicit fixed_block_size(size_t const & _block_size) : block_size(_block_size) {}
+      size_t operator()(size_t const &, size_t const &) const { return block_size; }
+  };
+
+  /**
+   * @brief generate kmers for each block of a block streaming file.  consumer is called for each batch of kmers.
+   * @details  all processes call consumer the same number of times (possibly with empty batch), so consumer can be collective (e.g. distributed insert).
+   *           only 1 block of the file (2 if prefetching) and the kmers for 1 block are in memory at any time.
+   *           after each consumer call, sizer is called with the bytes read and the kmers generated by this process in the round,
+   *           and returns the block size for the following rounds.  it is called by all processes, so it can be collective.
+   * @tparam StreamingFileType  block_streaming_file or prefetching_block_streaming_file
+   * @tparam BlockSizer   functor size_t(size_t bytes, size_t kmers), e.g. fixed_block_size.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename StreamingFileType, typename Consumer, typename BlockSizer>
+  static ::std::pair<size_t, size_t> read_blocks_streamed(StreamingFileType & fobj, Consumer & consumer, BlockSizer & sizer, const mxx::comm & _comm) {
+    // block starts at a record, so sequential parser is sufficient.
+    auto prepare = [](::bliss::io::file_data & block, SeqParser<typename ::bliss::io::file_data::const_iterator> & seq_parser) {
+      seq_parser.init_parser(block.in_mem_cbegin(), block.parent_range_bytes, block.in_mem_range_bytes, block.getRange());
+    };
+    return read_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, prepare, _comm);
+  }
+
+  /**
+   * @brief read_blocks_streamed with a custom parser setup for each block, e.g. to prepend the bases carried from the previous FASTA block.
+   * @tparam Prepare   functor void(file_data & block, SeqParser & seq_parser), called for each non-empty block before it is parsed.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename StreamingFileType, typename Consumer, typename BlockSizer, typename Prepare>
+  static ::std::pair<size_t, size_t> read_blocks_streamed(StreamingFileType & fobj, Consumer & consumer, BlockSizer & sizer,
+                                                          Prepare & prepare, const mxx::comm & _comm) {
+    ::std::pair<size_t, size_t> read = {0, 0};
+    ::std::pair<size_t, size_t> block_read;
+
+    ::bliss::io::file_data block;
+    std::vector<typename KmerParser::value_type> batch;
+    size_t block_bytes;
+    size_t kmers;
+
+    bool more = fobj.has_next_block();
+    while (::mxx::any_of(more, _comm)) {
+      batch.clear();
+      block_bytes = 0;
+
+      if (more) {
+        fobj.read_next_block(block);
+        block_bytes = block.getRange().size();
+
+        if (block.getRange().size() > 0) {
+          SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+          prepare(block, seq_parser);
+
+          block_read = read_block_old<KmerParser, SeqParser, SeqIterType>(block, seq_parser, batch);
+          read.first += block_read.first;
+          read.second += block_read.second;
+        }
+
+        more = fobj.has_next_block();
+      }
+
+      kmers = batch.size();
+      consumer(batch);
+      fobj.set_block_size(sizer(block_bytes, kmers));
+    }
+
+    return read;
+  }
+
+  /**
+   * @brief read a FASTQ file one record aligned block at a time and generate kmers for each block.  consumer is called for each batch of kmers.
+   * @details  if prefetch is true, the next block is read in the background while the current block is parsed and consumed.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Consumer, typename BlockSizer>
+  static ::std::pair<size_t, size_t> read_file_streamed_impl(const std::string & filename, size_t const & block_size,
+                                                              Consumer & consumer, BlockSizer & sizer, const mxx::comm & _comm, bool prefetch,
+                                                              size_t const & skip, bool cyclic, ::std::false_type) {
+    if (cyclic && (skip > 0)) throw std::invalid_argument("read_file_streamed: block cyclic reads cannot skip part of the partition.");
+    if (prefetch) {
+      ::bliss::io::parallel::prefetching_block_streaming_file<FileReader, SeqParser> fobj(filename, block_size, _comm, cyclic);
+      if (skip > 0) fobj.seek(fobj.get_partition_range().start + skip);
+      return read_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, _comm);
+    } else {
+      ::bliss::io::parallel::block_streaming_file<FileReader, SeqParser> fobj(filename, block_size, _comm, cyclic);
+      if (skip > 0) fobj.seek(fobj.get_partition_range().start + skip);
+      return read_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, _comm);
+    }
+  }
+
+  /**
+   * @brief read the blocks of a FASTA file and generate kmers for each block.  the sequences span blocks.
+   * @details  the sequence offsets are loaded from the sidecar fasta_index, or found by reading the file once and then
+   *           saved in the index, so later reads skip the search.  each block is prefixed with the bases carried from the
+   *           previous one, see fasta_stream, so there is no overlap between blocks and no kmer is lost at a block edge.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename StreamingFileType, typename Consumer, typename BlockSizer>
+  static ::std::pair<size_t, size_t> read_fasta_blocks_streamed(StreamingFileType & fobj, Consumer & consumer, BlockSizer & sizer,
+                                                                const mxx::comm & _comm, size_t const & skip) {
+    using range_type = ::bliss::partition::range<size_t>;
+
+    ::std::vector<::bliss::io::fasta_index::entry_type> entries;
+    if (!::bliss::io::fasta_index::read(fobj.get_filename(), fobj.size(), entries, _comm)) {
+      entries = ::bliss::io::fasta_stream::find_sequences(fobj, _comm);
+
+      // best effort.  the search is repeated next time if the index cannot be written, e.g. in a read only directory.
+      // entries are the same on all processes, so only rank 0 contributes.
+      ::bliss::io::fasta_index::write(fobj.get_filename(), fobj.size(),
+          (_comm.rank() == 0) ? entries : ::std::vector<::bliss::io::fasta_index::entry_type>(), _comm);
+    }
+    if (skip > 0) fobj.seek(fobj.get_partition_range().start + skip);
+
+    ::bliss::io::fasta_stream stream(entries, KmerParser::window_size);
+    entries.clear();
+
+    auto read_range = [&fobj](typename ::bliss::io::file_data::container & out, range_type const & r) {
+      return fobj.read_file_range(out, r);
+    };
+    auto prepare = [&stream, &read_range](::bliss::io::file_data & block, SeqParser<typename ::bliss::io::file_data::const_iterator> & seq_parser) {
+      stream.prepare(block, read_range);
+      seq_parser.init_parser(block.in_mem_cbegin(), block.parent_range_bytes, block.in_mem_range_bytes, block.getRange(),
+                             stream.get_sequence_offsets());
+    };
+    return read_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, prepare, _comm);
+  }
+
+  /**
+   * @brief read a FASTA file one block at a time and generate kmers for each block.  consumer is called for each batch of kmers.
+   * @details  see read_fasta_blocks_streamed.  if prefetch is true, the next block is read in the background.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Consumer, typename BlockSizer>
+  static ::std::pair<size_t, size_t> read_file_streamed_impl(const std::string & filename, size_t const & block_size,
+                                                              Consumer & consumer, BlockSizer & sizer, const mxx::comm & _comm, bool prefetch,
+                                                              size_t const & skip, bool cyclic, ::std::true_type) {
+    if (cyclic && (skip > 0)) throw std::invalid_argument("read_file_streamed: block cyclic reads cannot skip part of the partition.");
+    if (prefetch) {
+      ::bliss::io::parallel::prefetching_block_streaming_file<FileReader, SeqParser> fobj(filename, block_size, _comm, cyclic);
+      return read_fasta_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, _comm, skip);
+    } else {
+      ::bliss::io::parallel::block_streaming_file<FileReader, SeqParser> fobj(filename, block_size, _comm, cyclic);
+      return read_fasta_blocks_streamed<KmerParser, SeqParser, SeqIterType>(fobj, consumer, sizer, _comm, skip);
+    }
+  }
+
+
+  /**
+   * @brief read a file's content and generate kmers in batches, calling consumer on each batch, so that the full set of kmers is never in memory.
+   * @note  static so can be used wihtout instantiating a internal map.  collective.
+   *        all processes call consumer the same number of times, so consumer may be collective, e.g. a distributed map's insert.
+   *        the batch vector is reused between calls, so consumer may modify it but should not keep references to it.
+   * @tparam FileReader   sequential file reader type, e.g. posix_file or mmap_file.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   * @tparam Consumer     functor that accepts a std::vector<KmerParser::value_type>&.
+   * @param filename      name of the file to read
+   * @param block_size    number of bytes of file to read per block.
+   * @param consumer      functor to call with each batch.
+   * @param _comm         communicator
+   * @param prefetch      read the next block in the background while the current one is parsed and consumed.
+   * @param cyclic        read the blocks of the whole file block cyclically instead of a contiguous partition, to
+   *                      spread the concurrent reads over the stripes of a parallel file system.  see block_streaming_file.
+   * @return              number of sequences and number of kmers generated by the current process.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename Consumer>
+  static ::std::pair<size_t, size_t> read_file_streamed(const std::string & filename, size_t const & block_size,
+                                                        Consumer & consumer, const mxx::comm & _comm, bool prefetch = true,
+                                                        bool cyclic = false) {
+
+      fixed_block_size sizer(block_size);
+      return read_file_streamed_adaptive<FileReader, KmerParser, SeqParser, SeqIterType>(filename, block_size, consumer, sizer, _comm, prefetch, 0, cyclic);
+  }
+
+  /**
+   * @brief read_file_streamed with a block size that can change after each batch.  collective.
+   * @details  sizer is called by all processes after each consumer call, with the bytes read and the kmers generated by the
+   *        current process for the batch, and returns the block size for the following batches.  sizer may be collective,
+   *        e.g. adaptive_block_size::update.  with prefetch, the block already being read keeps the previous size.
+   * @tparam BlockSizer   functor size_t(size_t bytes, size_t kmers).
+   * @param block_size    block size of the first batch.  see read_file_streamed.
+   * @param skip          bytes at the start of this process's partition to skip, e.g. the sum of the bytes passed
+   *                      to sizer by an earlier, interrupted read with the same number of processes.
+   * @param cyclic        block cyclic reads, with a fixed block size.  see read_file_streamed.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Consumer, typename BlockSizer>
+  static ::std::pair<size_t, size_t> read_file_streamed_adaptive(const std::string & filename, size_t const & block_size,
+                                                                 Consumer & consumer, BlockSizer & sizer, const mxx::comm & _comm, bool prefetch = true,
+                                                                 size_t const & skip = 0, bool cyclic = false) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        read = read_file_streamed_impl<FileReader, KmerParser, SeqParser, SeqIterType>(filename, block_size, consumer, sizer, _comm, prefetch, skip, cyclic,
+            typename ::std::is_same<SeqParser<typename ::bliss::io::file_data::const_iterator>,
+                                    ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator> >::type());
+        BL_BENCH_END(file, "read_kmers_streamed", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_streamed", _comm);
+      return read;
+  }
+
+  /**
+   * @brief  parse a FASTQ file and save its sequences as a packed sequence file, so repeated index builds can skip FASTQ parsing.  collective.
+   * @note   FASTQ only.  quality scores are not saved.
+   * @tparam Alphabet   alphabet of the kmers to be built from the packed file, e.g. DNA, or DNA16 to keep N.
+   * @tparam FileType   parallel file reader type, e.g. mpiio_file<FASTQParser>.
+   * @return            number of sequences saved by the current process.
+   */
+  template <typename Alphabet, typename FileType = ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser> >
+  static size_t write_packed_file(const std::string & filename, const std::string & packed_filename,
+                                  const mxx::comm & _comm) {
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if (extension.compare("fastq") != 0) {
+        throw std::invalid_argument("packed sequence file can only be created from FASTQ files.");
+      }
+
+      size_t seqs = 0;
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, 0, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        ::bliss::io::FASTQParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+
+        typename ::bliss::io::packed_sequence_file<Alphabet>::data_type data;
+        if (partition.getRange().size() > 0) {
+          seqs = pack_block<Alphabet>(partition, seq_parser, data);
+        }
+        BL_BENCH_END(file, "pack", seqs);
+
+        BL_BENCH_START(file);
+        ::bliss::io::packed_sequence_file<Alphabet>::write(packed_filename, data, _comm);
+        BL_BENCH_END(file, "write", data.words.size());
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:write_packed_file", _comm);
+      return seqs;
+  }
+
+  /**
+   * @brief  read a packed sequence file and generate kmers, place in a vector as return result.  collective.
+   * @details  the blocks of the file are partitioned so each process gets about the same number of chars.
+   *           the kmers and positions are the same as from read_file on the original FASTQ file, but may be on different processes.
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count.
+   */
+  template <typename KmerParser>
+  static ::std::pair<size_t, size_t> read_packed_file(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        typename ::bliss::io::packed_sequence_file<typename KmerParser::kmer_type::KmerAlphabet>::data_type data;
+        ::bliss::io::packed_sequence_file<typename KmerParser::kmer_type::KmerAlphabet>::read(filename, data, _comm);
+        BL_BENCH_END(file, "read", data.words.size());
+
+        BL_BENCH_START(file);
+        read = parse_packed_data<KmerParser>(data, result);
+        BL_BENCH_END(file, "read_kmers", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_packed_file", _comm);
+      return read;
+  }
+
+  /**
+   * @brief  read a FASTQ file and generate kmers, splitting the long reads across processes.  collective.
+   * @details  reads up to threshold chars are parsed where they are, as in read_file.  the longer ones are split at kmer
+   *           granularity with k-1 chars overlap and the fragments sent to the processes with fewer kmers, see long_read_partition.
+   *           the kmers and positions are the same as from read_file, but may be on different processes.
+   *           positions in reads longer than 64K need LongSequenceKmerId.
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count.  fragments have no quality scores.
+   * @param threshold     reads with more chars than this are split.
+   */
+  template <typename KmerParser,
+            typename FileType = ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser> >
+  static ::std::pair<size_t, size_t> read_file_long_reads(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, size_t const & threshold = 65536UL) {
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if (extension.compare("fastq") != 0) {
+        throw std::invalid_argument("long reads can only be split for FASTQ files.");
+      }
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+      constexpr int kmer_size = KmerParser::window_size;
+      using CharIterType = typename ::bliss::io::file_data::const_iterator;
+      using SeqType = typename ::std::iterator_traits<::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> >::value_type;
+
+      size_t before = result.size();
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, kmer_size - 1, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        // short reads are parsed in place, long reads are set aside.
+        BL_BENCH_START(file);
+        ::bliss::io::FASTQParser<CharIterType> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+
+        ::std::vector<SeqType> long_reads;
+        if (partition.getRange().size() > 0) {
+          ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+          ::bliss::io::SequencesIterator<CharIterType, ::bliss::io::FASTQParser> seqs_end(partition.in_mem_cend());
+
+          KmerParser kmer_parser(partition.valid_range_bytes);
+          ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
+
+          for (; seqs_start != seqs_end; ++seqs_start) {
+            auto seq = *seqs_start;
+            if (seq.seq_size() == 0) continue;
+            if (!partition.valid_range_bytes.contains(seq.seq_global_offset())) continue;
+
+            ++read.first;
+            if (seq.seq_size() > threshold) long_reads.emplace_back(seq);
+            else emplace_iter = kmer_parser(seq, emplace_iter);
+          }
+        }
+        BL_BENCH_END(file, "short_reads", result.size() - before);
+
+        BL_BENCH_START(file);
+        ::bliss::io::long_read_partition::data_type fragments;
+        ::bliss::io::long_read_partition::distribute(long_reads, result.size() - before, kmer_size, fragments, _comm);
+        BL_BENCH_END(file, "split_long", fragments.fragments.size());
+
+        // the fragments are complete, so all of their kmers are valid.
+        BL_BENCH_START(file);
+        KmerParser fragment_parser(partition.parent_range_bytes);
+        ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
+        for (size_t i = 0; i < fragments.fragments.size(); ++i) {
+          emplace_iter = fragment_parser(fragments.get_sequence(i), emplace_iter);
+        }
+        BL_BENCH_END(file, "long_reads", fragments.chars.size());
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_long_reads", _comm);
+      read.second = result.size() - before;
+      return read;
+  }
+
 #endif
 
 
@@ -20,7 +20,7 @@
  * @author  Tony Pan <tpan7@gatech.edu>
  * @brief kmer parsers definitions
  * @details 4 primary Kmer Parser classes are currently provided:
- *      Kmer
+ *      Kmer (and canonical Kmer)
  *      Kmer Count tuple,
  *      Kmer Position tuple, and
  *      Kmer Position + Quality score tuple.
@@ -44,6 +44,10 @@
 #include <utility>      // pair and utility functions.
 #include <type_traits>
 #include <cctype>       // tolower.
+#include <cstring>      // memchr
+#include <vector>
+#include <algorithm>    // count_if
+#include <iterator>     // back_inserter
 
 #include "utils/logging.h"
 #include "utils/file_utils.hpp"
@@ -61,6 +65,8 @@
 #include "io/sequence_id_iterator.hpp"
 #include "iterators/transform_iterator.hpp"
 #include "common/kmer_iterators.hpp"
+#include "common/packed_encoder.hpp"
+#include "common/translation.hpp"
 #include "iterators/zip_iterator.hpp"
 #include "iterators/unzip_iterator.hpp"
 #include "iterators/constant_iterator.hpp"
@@ -79,6 +85,100 @@ template <typename Iter>
 using NonEOLIter = bliss::iterator::filter_iterator<::bliss::utils::file::NotEOL, Iter>;
 
 
+/**
+ * @brief  characters of a contiguous multiline sequence without EOL characters, copied in bulk 1 line at a time, and the
+ *         position of each line in the original characters.
+ * @details  lines are found with memchr and copied with memcpy, instead of testing every character through a filter
+ *           iterator.  this is for long records, e.g. reference chromosomes in FASTA, which are mostly full lines.
+ */
+struct EOLStrippedChars {
+    /// the characters without EOL.  reused between sequences.
+    ::std::vector<unsigned char> chars;
+    /// (offset in chars, offset in the original characters) of the first character of each line.
+    ::std::vector<::std::pair<size_t, size_t> > lines;
+
+    void assign(unsigned char const * ptr, size_t const & len) {
+      chars.resize(len);
+      lines.clear();
+
+      unsigned char const * end = ptr + len;
+      unsigned char const * p = ptr;
+      unsigned char const * q;
+      unsigned char const * r;
+      size_t n = 0;
+      while (p < end) {
+        // skip EOL characters, then find the end of the line.
+        while ((p < end) && ((*p == '\n') || (*p == '\r'))) ++p;
+        if (p == end) break;
+
+        q = reinterpret_cast<unsigned char const *>(::memchr(p, '\n', end - p));
+        if (q == nullptr) q = end;
+        r = reinterpret_cast<unsigned char const *>(::memchr(p, '\r', q - p));
+        if (r != nullptr) q = r;
+
+        lines.emplace_back(n, p - ptr);
+        ::memcpy(chars.data() + n, p, q - p);
+        n += q - p;
+        p = q;
+      }
+      chars.resize(n);
+    }
+
+    size_t size() const { return chars.size(); }
+    unsigned char const * data() const { return chars.data(); }
+};
+
+
+/**
+ * @brief  kernel for the parsers' contiguous fast path:  kmers of a contiguous character span, generated from packed words
+ *         instead of through the NonEOLIter / transform_iterator / KmerGenerationIterator / zip_iterator stack.
+ * @details  single line spans are encoded in place.  multiline spans are copied without EOL first (EOLStrippedChars), and the
+ *           line map gives each kmer's position in the original characters.  f is called as f(i, offset, kmer) for the i-th
+ *           kmer, in order, with offset the position of its first character in the span.
+ *           supported only if PackedWordKmerGenerator supports the kmer type.
+ */
+template <typename KmerType>
+struct ContiguousKmerKernel {
+    static constexpr bool supported = ::bliss::common::PackedWordKmerGenerator<KmerType>::supported;
+
+    /// packed words of the current span.  reused between spans.
+    ::std::vector<WordType> packed_words;
+    /// the current span without EOL, for multiline spans.  reused between spans.
+    EOLStrippedChars stripped;
+
+    template <typename Func>
+    void operator()(unsigned char const * ptr, size_t const & len, Func f) {
+      using encoder_type = ::bliss::common::PackedEncoder<typename KmerType::KmerAlphabet>;
+
+      bool multiline = (::memchr(ptr, '\n', len) != nullptr) || (::memchr(ptr, '\r', len) != nullptr);
+      if (multiline) stripped.assign(ptr, len);
+      unsigned char const * chars = multiline ? stripped.data() : ptr;
+      size_t n = multiline ? stripped.size() : len;
+
+      packed_words.resize(encoder_type::get_word_count(n));
+      encoder_type::encode(chars, n, packed_words.data());
+
+      if (!multiline) {
+        ::bliss::common::PackedWordKmerGenerator<KmerType>::generate(packed_words.data(), n,
+            [&f](size_t const & i, KmerType const & km, KmerType const &) { f(i, i, km); });
+        return;
+      }
+
+      // kmers come in position order, so the line of each kmer is found by walking the line map.
+      auto const & lines = stripped.lines;
+      size_t line = 0;
+      ::bliss::common::PackedWordKmerGenerator<KmerType>::generate(packed_words.data(), n,
+          [&f, &lines, &line](size_t const & i, KmerType const & km, KmerType const &) {
+            while (((line + 1) < lines.size()) && (lines[line + 1].first <= i)) ++line;
+            f(i, lines[line].second + (i - lines[line].first), km);
+          });
+    }
+};
+
+template <typename KmerType>
+constexpr bool ContiguousKmerKernel<KmerType>::supported;
+
+
 /**
  * @tparam KmerType       output value type of this parser.  not necessarily the same as the map's final storage type.
  */
@@ -156,6 +256,11 @@ public:
 	  return std::make_tuple(seq_begin, seq_end, i >= window);
   }
 
+  /// number of kmers in a valid iterator range with at least window characters, not counting EOL.
+  template <typename Iterator>
+  static size_t count_kmers(Iterator seq_begin, Iterator seq_end, size_t window) {
+    return std::count_if(seq_begin, seq_end, bliss::utils::file::NotEOL()) - window + 1;
+  }
 
 
   // kmer generation iterator
@@ -286,10 +391,68 @@ public:
 ////      else
 ////        return ::std::copy_if(start, end, output_iter, pred);
 //    }
-    iterator_type<SeqType> istart = begin(read, window_size);
-    iterator_type<SeqType> iend = end(read, window_size);
+    return generate(read, output_iter, use_packed_words<SeqType>());
+  }
 
-    return std::copy(istart, iend, output_iter);
+protected:
+  /// contiguous reads of alphabets that do not span words can be encoded and generated from packed words.
+  template <typename SeqType>
+  using use_packed_words = ::std::integral_constant<bool,
+      ::bliss::utils::file::is_contiguous_char_iterator<typename SeqType::IteratorType>::value &&
+      ::bliss::common::PackedWordKmerGenerator<kmer_type>::supported>;
+
+  /// packed words of the current read, reused between reads.
+  ::std::vector<WordType> packed_words;
+
+  /// characters of the current read without EOL, for multiline reads.  reused between reads.
+  EOLStrippedChars stripped;
+
+  /// generate kmers with the character iterators
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) = get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    // the kmer count is known from the valid range, so use the bulk fill instead of comparing to an end iterator.
+    bliss::utils::file::NotEOL neol;
+    iterator_type<SeqType> istart(BaseCharIterator<SeqType>(CharIter<SeqType>(neol, seq_begin, seq_end),
+                                                            bliss::common::ASCII2<Alphabet>()), true);
+
+    return istart.fill(output_iter, count_kmers(seq_begin, seq_end, window_size));
+  }
+
+  /// encode the read into packed words in blocks, then generate kmers by word shifts.  reads with EOL are copied without EOL first.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    unsigned char const * ptr = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    size_t len = std::distance(seq_begin, seq_end);
+
+    // multiline sequences are copied without EOL first.
+    if ((::memchr(ptr, '\n', len) != nullptr) || (::memchr(ptr, '\r', len) != nullptr)) {
+      stripped.assign(ptr, len);
+      ptr = stripped.data();
+      len = stripped.size();
+    }
+
+    using encoder_type = ::bliss::common::PackedEncoder<Alphabet>;
+    packed_words.resize(encoder_type::get_word_count(len));
+    encoder_type::encode(ptr, len, packed_words.data());
+
+    return ::bliss::common::PackedWordKmerGenerator<kmer_type>()(packed_words.data(), len, output_iter);
   }
 };
 
@@ -297,6 +460,502 @@ template <typename KmerType>
 constexpr size_t KmerParser<KmerType>::window_size;
 
 
+/**
+ * @brief  generates canonical kmers, i.e. the lexicographically smaller of each kmer and its reverse complement.
+ * @details  the forward and reverse complement windows are advanced together, so there is no reverse_complement()
+ *           per kmer.  when both inserts and queries are parsed with this class, the map does not need to
+ *           canonicalize keys again (e.g. SingleStrand map params can be used in place of Canonical).
+ * @tparam KmerType       output value type of this parser.  not necessarily the same as the map's final storage type.
+ */
+template <typename KmerType>
+class CanonicalKmerParser : public KmerParser<KmerType> {
+
+protected:
+  using BaseType = KmerParser<KmerType>;
+  using Alphabet = typename BaseType::Alphabet;
+
+  template <typename SeqType>
+  using CharIter = typename BaseType::template CharIter<SeqType>;
+  template <typename SeqType>
+  using BaseCharIterator = typename BaseType::template BaseCharIterator<SeqType>;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  // canonical kmer generation iterator
+  template <typename SeqType>
+  using iterator_type = bliss::common::CanonicalKmerGenerationIterator<BaseCharIterator<SeqType>, kmer_type>;
+
+  CanonicalKmerParser(::bliss::partition::range<size_t> const & _valid_range) : BaseType(_valid_range) {};
+
+  template <typename SeqType>
+  iterator_type<SeqType> begin(SeqType const & read, size_t const & window = window_size) const {
+      typename SeqType::IteratorType seq_begin;
+      typename SeqType::IteratorType seq_end;
+      bool has_window = false;
+
+      std::tie(seq_begin, seq_end, has_window) =
+          BaseType::get_valid_iterator_range(read, this->valid_range, window);
+
+      //== set up the kmer generating iterators.
+      bliss::utils::file::NotEOL neol;
+
+      if (has_window) {
+        return iterator_type<SeqType>(BaseCharIterator<SeqType>(
+            CharIter<SeqType>(neol, seq_begin, seq_end),
+            bliss::common::ASCII2<Alphabet>()),
+            true);
+      } else {
+        return iterator_type<SeqType>(BaseCharIterator<SeqType>(
+            CharIter<SeqType>(neol, seq_end),
+            bliss::common::ASCII2<Alphabet>()),
+            false);
+      }
+  }
+
+  template <typename SeqType>
+  iterator_type<SeqType> end(SeqType const & read, size_t const & window = window_size) const {
+      typename SeqType::IteratorType seq_begin;
+      typename SeqType::IteratorType seq_end;
+      bool has_window = false;
+
+      std::tie(seq_begin, seq_end, has_window) =
+          BaseType::get_valid_iterator_range(read, this->valid_range, window);
+
+      //== set up the kmer generating iterators.
+      bliss::utils::file::NotEOL neol;
+
+      return iterator_type<SeqType>(BaseCharIterator<SeqType>(
+          CharIter<SeqType>(neol, seq_end),
+          bliss::common::ASCII2<Alphabet>()),
+          false);
+  }
+
+  /**
+   * @brief generate canonical kmers from 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   * @tparam SeqType      type of sequence.  inferred.
+   * @tparam OutputIt     output iterator type, inferred.
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    return generate(read, output_iter, typename BaseType::template use_packed_words<SeqType>());
+  }
+
+protected:
+  /// generate canonical kmers with the character iterators
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) = BaseType::get_valid_iterator_range(read, this->valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    // the kmer count is known from the valid range, so use the bulk fill instead of comparing to an end iterator.
+    bliss::utils::file::NotEOL neol;
+    iterator_type<SeqType> istart(BaseCharIterator<SeqType>(CharIter<SeqType>(neol, seq_begin, seq_end),
+                                                            bliss::common::ASCII2<Alphabet>()), true);
+
+    return istart.fill(output_iter, BaseType::count_kmers(seq_begin, seq_end, window_size));
+  }
+
+  /// encode the read into packed words, then generate canonical kmers by word shifts.  reads with EOL are copied without EOL first.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        BaseType::get_valid_iterator_range(read, this->valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    unsigned char const * ptr = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    size_t len = std::distance(seq_begin, seq_end);
+
+    // multiline sequences are copied without EOL first.
+    if ((::memchr(ptr, '\n', len) != nullptr) || (::memchr(ptr, '\r', len) != nullptr)) {
+      this->stripped.assign(ptr, len);
+      ptr = this->stripped.data();
+      len = this->stripped.size();
+    }
+
+    using encoder_type = ::bliss::common::PackedEncoder<Alphabet>;
+    this->packed_words.resize(encoder_type::get_word_count(len));
+    encoder_type::encode(ptr, len, this->packed_words.data());
+
+    return ::bliss::common::PackedWordKmerGenerator<kmer_type>().canonical(this->packed_words.data(), len, output_iter);
+  }
+};
+
+template <typename KmerType>
+constexpr size_t CanonicalKmerParser<KmerType>::window_size;
+
+
+/**
+ * @brief  generates the kmers of a read that contain only A, C, G, and T, i.e. skips every window with an N (or other
+ *         non-ACGT character), without splitting the read into sub-sequences.
+ * @details  this gives the same kmers as parsing with NSplitSequencesIterator and KmerParser, but needs 1 pass and
+ *           no per sub-sequence iterators, which matters for short reads with scattered Ns.  the read is encoded
+ *           with PackedEncoder, which also produces the non-ACGT bit mask, and PackedWordKmerGenerator::generate_valid
+ *           emits the windows the mask allows.  multiline reads are first copied without EOL characters.
+ *
+ *           alphabets that PackedWordKmerGenerator does not support (e.g. DNA5) use the kmer generation iterator
+ *           over the copied characters, with the same run counter.
+ * @tparam KmerType       output value type of this parser.  not necessarily the same as the map's final storage type.
+ */
+template <typename KmerType>
+class NFilteredKmerParser : public KmerParser<KmerType> {
+
+protected:
+  using BaseType = KmerParser<KmerType>;
+  using Alphabet = typename BaseType::Alphabet;
+
+  template <typename SeqType>
+  using CharIter = typename BaseType::template CharIter<SeqType>;
+
+  /// characters of the current read without EOL, when the read is not contiguous.  reused between reads.
+  ::std::vector<unsigned char> chars;
+
+  /// non-ACGT mask of the current read.  reused between reads.
+  ::std::vector<WordType> ambig_words;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  NFilteredKmerParser(::bliss::partition::range<size_t> const & _valid_range) : BaseType(_valid_range) {};
+
+  /**
+   * @brief generate the kmers without N from 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   * @tparam SeqType      type of sequence.  inferred.
+   * @tparam OutputIt     output iterator type, inferred.
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        BaseType::get_valid_iterator_range(read, this->valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    size_t len = 0;
+    unsigned char const * ptr = get_chars<SeqType>(seq_begin, seq_end, len,
+        ::bliss::utils::file::is_contiguous_char_iterator<typename SeqType::IteratorType>());
+
+    return generate(ptr, len, output_iter,
+        ::std::integral_constant<bool, ::bliss::common::PackedWordKmerGenerator<kmer_type>::supported>());
+  }
+
+protected:
+  /// contiguous characters:  use them directly, or copy them in bulk without EOL characters.
+  template <typename SeqType>
+  unsigned char const * get_chars(typename SeqType::IteratorType const & seq_begin, typename SeqType::IteratorType const & seq_end,
+                                  size_t & len, ::std::true_type const &) {
+    unsigned char const * ptr = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    len = std::distance(seq_begin, seq_end);
+    if ((::memchr(ptr, '\n', len) == nullptr) && (::memchr(ptr, '\r', len) == nullptr)) return ptr;
+
+    this->stripped.assign(ptr, len);
+    len = this->stripped.size();
+    return this->stripped.data();
+  }
+
+  /// copy the characters without EOL.
+  template <typename SeqType>
+  unsigned char const * get_chars(typename SeqType::IteratorType const & seq_begin, typename SeqType::IteratorType const & seq_end,
+                                  size_t & len, ::std::false_type const &) {
+    bliss::utils::file::NotEOL neol;
+    chars.assign(CharIter<SeqType>(neol, seq_begin, seq_end), CharIter<SeqType>(neol, seq_end));
+    len = chars.size();
+    return chars.data();
+  }
+
+  /// encode with the non-ACGT mask, then generate the valid kmers by word shifts.
+  template <typename OutputIt>
+  OutputIt generate(unsigned char const * ptr, size_t const & len, OutputIt output_iter, ::std::true_type const &) {
+    using encoder_type = ::bliss::common::PackedEncoder<Alphabet>;
+    this->packed_words.resize(encoder_type::get_word_count(len));
+    ambig_words.resize(encoder_type::get_mask_word_count(len));
+    encoder_type::encode(ptr, len, this->packed_words.data(), ambig_words.data());
+
+    ::bliss::common::PackedWordKmerGenerator<kmer_type>::generate_valid(this->packed_words.data(), ambig_words.data(), len,
+        [&output_iter](size_t const &, kmer_type const & km, kmer_type const &) {
+          *output_iter = km;
+          ++output_iter;
+        });
+    return output_iter;
+  }
+
+  /// generate with the kmer generation iterator, and keep the kmers whose window has no non-ACGT character.
+  template <typename OutputIt>
+  OutputIt generate(unsigned char const * ptr, size_t const & len, OutputIt output_iter, ::std::false_type const &) {
+    using CharTransIter = bliss::iterator::transform_iterator<unsigned char const *, bliss::common::ASCII2<Alphabet> >;
+    bliss::common::KmerGenerationIterator<CharTransIter, kmer_type> it(CharTransIter(ptr, bliss::common::ASCII2<Alphabet>()), true);
+
+    size_t run = 0;
+    for (size_t i = 0; i < len; ++i) {
+      if (::bliss::common::PackedEncoder<Alphabet>::is_acgt(ptr[i])) ++run;
+      else run = 0;
+
+      if ((i + 1) < window_size) continue;
+
+      if (run >= window_size) {
+        *output_iter = *it;
+        ++output_iter;
+      }
+      if ((i + 1) < len) ++it;
+    }
+    return output_iter;
+  }
+};
+
+template <typename KmerType>
+constexpr size_t NFilteredKmerParser<KmerType>::window_size;
+
+
+/**
+ * @brief  generates the six frame peptide kmers of DNA reads, for translated search.  see SixFrameKmerGenerator.
+ * @details  the window is 3k bases, so partition overlaps and the valid range are in bases, as for DNA kmers.  each
+ *           window with only ACGT gives up to 2 kmers, the forward and reverse strand peptides without stop codons.
+ *           multiline reads are first copied without EOL characters.
+ * @tparam KmerType       kmer of the AA alphabet.
+ */
+template <typename KmerType>
+class TranslatedKmerParser {
+
+public:
+  using value_type = KmerType;
+  using kmer_type = KmerType;
+  static constexpr size_t window_size = ::bliss::common::SixFrameKmerGenerator<KmerType>::window_size;
+
+protected:
+  template <typename SeqType>
+  using CharIter = bliss::index::kmer::NonEOLIter<typename SeqType::IteratorType>;
+
+  ::bliss::partition::range<size_t> valid_range;
+
+  ::bliss::common::SixFrameKmerGenerator<KmerType> generator;
+
+  /// characters of the current read without EOL.  reused between reads.
+  EOLStrippedChars stripped;
+  ::std::vector<unsigned char> chars;
+
+public:
+  TranslatedKmerParser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
+
+  /**
+   * @brief generate the peptide kmers from 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    size_t len = 0;
+    unsigned char const * ptr = get_chars<SeqType>(seq_begin, seq_end, len,
+        ::bliss::utils::file::is_contiguous_char_iterator<typename SeqType::IteratorType>());
+
+    return generator(ptr, len, output_iter);
+  }
+
+protected:
+  /// contiguous characters:  use them directly, or copy them without EOL characters.
+  template <typename SeqType>
+  unsigned char const * get_chars(typename SeqType::IteratorType const & seq_begin, typename SeqType::IteratorType const & seq_end,
+                                  size_t & len, ::std::true_type const &) {
+    unsigned char const * ptr = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    len = std::distance(seq_begin, seq_end);
+    if ((::memchr(ptr, '\n', len) == nullptr) && (::memchr(ptr, '\r', len) == nullptr)) return ptr;
+
+    stripped.assign(ptr, len);
+    len = stripped.size();
+    return stripped.data();
+  }
+
+  /// copy the characters without EOL.
+  template <typename SeqType>
+  unsigned char const * get_chars(typename SeqType::IteratorType const & seq_begin, typename SeqType::IteratorType const & seq_end,
+                                  size_t & len, ::std::false_type const &) {
+    bliss::utils::file::NotEOL neol;
+    chars.assign(CharIter<SeqType>(neol, seq_begin, seq_end), CharIter<SeqType>(neol, seq_end));
+    len = chars.size();
+    return chars.data();
+  }
+};
+
+template <typename KmerType>
+constexpr size_t TranslatedKmerParser<KmerType>::window_size;
+
+
+/**
+ * @brief  trim the low quality bases at the 2 ends of a read with quality scores.
+ * @details  the returned read refers to the same characters, starting at the first base that is not low and ending
+ *           after the last one, with seq_begin_offset adjusted so the positions are unchanged.  EOL characters are
+ *           skipped.  if all bases are low, the read is empty.  FASTQ records are never truncated at partition
+ *           boundaries, so the ends of the read are the ends of the record.
+ * @tparam Threshold   provides is_low(quality char), e.g. ::bliss::index::QualityThreshold.
+ */
+template <typename SeqType, typename Threshold>
+SeqType trim_read_by_quality(SeqType const & read, Threshold const & threshold) {
+  static_assert(SeqType::has_quality(), "Sequence Parser needs to support quality scores");
+
+  size_t len = std::distance(read.seq_begin, read.seq_end);
+  size_t first = len, last = 0;
+  typename SeqType::IteratorType it = read.qual_begin;
+  for (size_t i = 0; i < len; ++i, ++it) {
+    if ((*it == '\n') || (*it == '\r') || threshold.is_low(*it)) continue;
+    if (first == len) first = i;
+    last = i + 1;
+  }
+  if (first == len) first = last = 0;
+
+  SeqType trimmed(read);
+  trimmed.seq_begin = read.seq_begin;
+  std::advance(trimmed.seq_begin, first);
+  trimmed.seq_end = read.seq_begin;
+  std::advance(trimmed.seq_end, last);
+  trimmed.qual_begin = read.qual_begin;
+  std::advance(trimmed.qual_begin, first);
+  trimmed.qual_end = read.qual_begin;
+  std::advance(trimmed.qual_end, last);
+  trimmed.seq_begin_offset += first;
+  return trimmed;
+}
+
+
+/**
+ * @brief  generates the kmers of a FASTQ read after quality trimming, and only those whose quality passes a threshold.
+ * @details  filtering at parse time keeps the low quality kmers out of the distribution and out of the map, instead of
+ *           removing them afterwards with erase_if or skipping them with query predicates.  the read ends are trimmed
+ *           while the base phred score is below TrimPhred, and a kmer is kept if its probability of being correct is at
+ *           least 1 - 10^(-MinKmerPhred / 10).  0 disables either filter.  the kmer qualities are computed with the fixed
+ *           point codec in 1 batch per read, and the kmers with the base class's fast paths.
+ *
+ *           the output is a kmer, so this can be used with the count index, see QualityFilteredCountIndex.  begin()
+ *           and end() are the unfiltered ones of KmerParser.
+ * @tparam KmerType        output value type of this parser.  not necessarily the same as the map's final storage type.
+ * @tparam QualityEncoder  quality score codec template, for the FASTQ variant.
+ */
+template <typename KmerType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec,
+    unsigned int TrimPhred = 3, unsigned int MinKmerPhred = 10>
+class QualityFilteredKmerParser : public KmerParser<KmerType> {
+
+protected:
+  using BaseType = KmerParser<KmerType>;
+
+  template <typename SeqType>
+  using CharIter = typename BaseType::template CharIter<SeqType>;
+
+  using encoder_type = QualityEncoder<uint16_t>;
+
+  ::bliss::index::QualityThreshold<encoder_type> threshold;
+
+  /// batch quality score computation, reused between reads.
+  ::bliss::index::QualityScoreBatch<KmerType::size, encoder_type> qual_batch;
+
+  /// k-mer costs of the current read.
+  ::std::vector<uint16_t> qual_values;
+
+  /// all kmers of the current read.  reused between reads.
+  ::std::vector<KmerType> kmers;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  QualityFilteredKmerParser(::bliss::partition::range<size_t> const & _valid_range) :
+    BaseType(_valid_range), threshold(TrimPhred, MinKmerPhred) {};
+
+  /**
+   * @brief generate the kmers with good quality from 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   * @tparam SeqType      type of sequence.  inferred.
+   * @tparam OutputIt     output iterator type, inferred.
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(SeqType::has_quality(), "Sequence Parser needs to support quality scores");
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    SeqType trimmed = (TrimPhred == 0) ? read : trim_read_by_quality(read, threshold);
+
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        BaseType::get_valid_iterator_range(trimmed, this->valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    kmers.clear();
+    BaseType::operator()(trimmed, ::fsc::back_emplace_iterator<::std::vector<KmerType> >(kmers));
+    if (MinKmerPhred == 0) return ::std::copy(kmers.begin(), kmers.end(), output_iter);
+
+    // qualities of the same windows.
+    typename SeqType::IteratorType qual_begin = trimmed.qual_begin;
+    std::advance(qual_begin, std::distance(trimmed.seq_begin, seq_begin));
+    typename SeqType::IteratorType qual_end = qual_begin;
+    std::advance(qual_end, std::distance(seq_begin, seq_end));
+
+    bliss::utils::file::NotEOL neol;
+    size_t count = qual_batch(CharIter<SeqType>(neol, qual_begin, qual_end), CharIter<SeqType>(neol, qual_end), qual_values);
+    count = ::std::min(count, kmers.size());
+
+    for (size_t i = 0; i < count; ++i) {
+      if (!threshold.pass(qual_values[i])) continue;
+      *output_iter = kmers[i];
+      ++output_iter;
+    }
+    return output_iter;
+  }
+};
+
+template <typename KmerType, template<typename> class QualityEncoder, unsigned int TrimPhred, unsigned int MinKmerPhred>
+constexpr size_t QualityFilteredKmerParser<KmerType, QualityEncoder, TrimPhred, MinKmerPhred>::window_size;
+
+
 /**
  * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
  */
@@ -559,22 +1218,205 @@ public:
 //        return ::std::copy(index_start, index_end, output_iter);
 //    }
 
+    return generate(read, output_iter, use_kernel<SeqType>());
+  }
+
+protected:
+  /// contiguous reads of alphabets that do not span words use ContiguousKmerKernel.
+  template <typename SeqType>
+  using use_kernel = ::std::integral_constant<bool,
+      ::bliss::utils::file::is_contiguous_char_iterator<typename SeqType::IteratorType>::value &&
+      ContiguousKmerKernel<kmer_type>::supported>;
+
+  ContiguousKmerKernel<kmer_type> kernel;
+
+  /// generate kmer-positions with the iterators
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
     iterator_type<SeqType> istart = begin(read, window_size);
     iterator_type<SeqType> iend = end(read, window_size);
 
     return std::copy(istart, iend, output_iter);
-
   }
 
+  /// generate kmer-positions from packed words.  same positions as the iterators.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    // id of the first valid character, in file coordinates, as in begin()
+    IdType begin_id(read.id);
+    begin_id += read.seq_begin_offset;
+    begin_id += std::distance(read.seq_begin, seq_begin);
+
+    kernel(reinterpret_cast<unsigned char const *>(&(*seq_begin)), std::distance(seq_begin, seq_end),
+        [&output_iter, &begin_id](size_t const &, size_t const & offset, kmer_type const & km) {
+          IdType id(begin_id);
+          id += offset;
+          *output_iter = value_type(km, id);
+          ++output_iter;
+        });
+    return output_iter;
+  }
 };
 
 template <typename TupleType>
 constexpr size_t KmerPositionTupleParser<TupleType>::window_size;
 
+
 /**
+ * @brief  kmer + position parser for reference sequences, e.g. FASTA chromosomes of many Mbp.
+ * @details  KmerPositionTupleParser now generates contiguous input from packed words with ContiguousKmerKernel, copying
+ *           multiline records without EOL in bulk, so this is the same parser.  kept for existing users.
+ * @tparam TupleType       output value type of this parser.  std::pair<Kmer, IdType>.  LongSequenceKmerId for long records.
+ */
+template <typename TupleType>
+class ReferenceKmerPositionParser : public KmerPositionTupleParser<TupleType> {
+
+protected:
+  using BaseType = KmerPositionTupleParser<TupleType>;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  using IdType = typename BaseType::IdType;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  ReferenceKmerPositionParser(::bliss::partition::range<size_t> const & _valid_range) : BaseType(_valid_range) {};
+};
+
+template <typename TupleType>
+constexpr size_t ReferenceKmerPositionParser<TupleType>::window_size;
+
+
+/**
+ * @brief  kmer + position parser for canonical position indices:  emits the canonical kmer (lex_less) once per position,
+ *         with the strand in the position's kmer_strand bit.
+ * @details  the kmers of a read are generated by KmerPositionTupleParser into a buffer, reverse complemented in batch,
+ *           and the smaller of each pair is emitted.  the bit is set if the reverse complement was smaller.  palindromes
+ *           are forward.  compared to indexing both strands, this stores each position once.
+ * @tparam TupleType       std::pair<Kmer, IdType>.
+ */
+template <typename TupleType>
+class CanonicalKmerPositionTupleParser : public KmerPositionTupleParser<TupleType> {
+
+protected:
+  using BaseType = KmerPositionTupleParser<TupleType>;
+
+  /// generated tuples, kmers, and reverse complements of the current read.  reused between reads.
+  ::std::vector<TupleType> tuples;
+  ::std::vector<typename BaseType::kmer_type> kmers;
+  ::std::vector<typename BaseType::kmer_type> revcomps;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  using IdType = typename BaseType::IdType;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  CanonicalKmerPositionTupleParser(::bliss::partition::range<size_t> const & _valid_range) : BaseType(_valid_range) {};
+
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(std::is_same<TupleType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    tuples.clear();
+    BaseType::operator()(read, ::fsc::back_emplace_iterator<::std::vector<TupleType> >(tuples));
+    if (tuples.empty()) return output_iter;
+
+    kmers.resize(tuples.size());
+    revcomps.resize(tuples.size());
+    for (size_t i = 0; i < tuples.size(); ++i) kmers[i] = tuples[i].first;
+    ::bliss::common::reverse_complement(kmers.data(), revcomps.data(), kmers.size());
+
+    for (size_t i = 0; i < tuples.size(); ++i) {
+      if (revcomps[i] < kmers[i]) {
+        tuples[i].first = revcomps[i];
+        ::bliss::common::kmer_strand<IdType>::set_reverse(tuples[i].second);
+      }
+      *output_iter = tuples[i];
+      ++output_iter;
+    }
+    return output_iter;
+  }
+};
+
+template <typename TupleType>
+constexpr size_t CanonicalKmerPositionTupleParser<TupleType>::window_size;
+
+
+/**
+ * @brief  kmer + position parser for sampled position indices:  emits only the (w,k) minimizers of each read.
+ * @details  the kmers of a read are generated by KmerPositionTupleParser into a buffer, and minimizer_sampler selects
+ *           about 2/(W+1) of them.  queries should be sampled with the same minimizer_sampler, see MinimizerPositionIndex.
+ *           a sequence that is split between partitions is sampled separately on each side, so the windows that cross
+ *           the partition boundary may select a different kmer than for the whole sequence.
+ * @tparam TupleType       std::pair<Kmer, IdType>.
+ * @tparam W               number of consecutive kmers per minimizer window.
+ */
+template <typename TupleType, unsigned int W>
+class MinimizerKmerPositionTupleParser : public KmerPositionTupleParser<TupleType> {
+
+protected:
+  using BaseType = KmerPositionTupleParser<TupleType>;
+
+  /// generated tuples, kmers, and offsets of the selected kmers of the current read.  reused between reads.
+  ::std::vector<TupleType> tuples;
+  ::std::vector<typename BaseType::kmer_type> kmers;
+  ::std::vector<size_t> selected;
+
+  ::bliss::common::minimizer_sampler<typename BaseType::kmer_type, W> sampler;
+
+public:
+  using value_type = typename BaseType::value_type;
+  using kmer_type = typename BaseType::kmer_type;
+  using IdType = typename BaseType::IdType;
+  static constexpr size_t window_size = BaseType::window_size;
+
+  MinimizerKmerPositionTupleParser(::bliss::partition::range<size_t> const & _valid_range) : BaseType(_valid_range) {};
+
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(std::is_same<TupleType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    tuples.clear();
+    BaseType::operator()(read, ::fsc::back_emplace_iterator<::std::vector<TupleType> >(tuples));
+    if (tuples.empty()) return output_iter;
+
+    kmers.resize(tuples.size());
+    for (size_t i = 0; i < tuples.size(); ++i) kmers[i] = tuples[i].first;
+
+    selected.clear();
+    sampler.select(kmers.begin(), kmers.end(), ::std::back_inserter(selected));
+
+    for (size_t i = 0; i < selected.size(); ++i) {
+      *output_iter = tuples[selected[i]];
+      ++output_iter;
+    }
+    return output_iter;
+  }
+};
+
+template <typename TupleType, unsigned int W>
+constexpr size_t MinimizerKmerPositionTupleParser<TupleType, W>::window_size;
+
+/**
+ * @details  operator() can filter at parse time:  the read ends are trimmed while the base phred score is below TrimPhred,
+ *           and kmers with a k-mer phred score below MinKmerPhred are not generated.  both are disabled (0) by default.
+ *           begin() and end() do not filter.
  * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
  */
-template <typename TupleType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
+template <typename TupleType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec,
+    unsigned int TrimPhred = 0, unsigned int MinKmerPhred = 0>
 class KmerPositionQualityTupleParser {
 
 public:
@@ -631,12 +1473,16 @@ protected:
 
   ::bliss::partition::range<size_t> valid_range;
 
+  /// parse time quality filter
+  ::bliss::index::QualityThreshold<QualityEncoder<QualType> > threshold;
+
 public:
   template <typename SeqType>
   using iterator_type = bliss::iterator::ZipIterator<KmerIter<SeqType>, KmerInfoIterType<SeqType> >;
 
 
-  KmerPositionQualityTupleParser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
+  KmerPositionQualityTupleParser(::bliss::partition::range<size_t> const & _valid_range) :
+    valid_range(_valid_range), threshold(TrimPhred, MinKmerPhred) {};
 
   template <typename SeqType>
   iterator_type<SeqType> begin(SeqType const & read, size_t const & window = window_size) const {
@@ -891,16 +1737,123 @@ public:
 //        return ::std::copy(index_start, index_end, output_iter);
 //    }
 
-    iterator_type<SeqType> istart = begin(read, window_size);
-    iterator_type<SeqType> iend = end(read, window_size);
+    if (TrimPhred == 0) return generate(read, output_iter, use_kernel<SeqType>());
+    return generate(trim_read_by_quality(read, threshold), output_iter, use_kernel<SeqType>());
+  }
 
-    return std::copy(istart, iend, output_iter);
+protected:
+  /// batch quality score computation, reused between reads.
+  ::bliss::index::QualityScoreBatch<kmer_type::size, QualityEncoder<QualType> > qual_batch;
+
+  /// k-mer quality scores of the current read.
+  ::std::vector<QualType> qual_values;
+
+  /// contiguous reads of alphabets that do not span words use ContiguousKmerKernel.
+  template <typename SeqType>
+  using use_kernel = ::std::integral_constant<bool,
+      ::bliss::utils::file::is_contiguous_char_iterator<typename SeqType::IteratorType>::value &&
+      ContiguousKmerKernel<kmer_type>::supported>;
+
+  ContiguousKmerKernel<kmer_type> kernel;
+
+  /// quality characters of the current read without EOL, for multiline reads.  reused between reads.
+  EOLStrippedChars stripped_qual;
+
+  /// generate kmers from packed words, and qualities in 1 batch.  same tuples as the iterators.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    assert(::std::distance(read.seq_begin, read.seq_end) <= ::std::distance(read.qual_begin, read.qual_end));
+
+    unsigned char const * qual = reinterpret_cast<unsigned char const *>(&(*read.qual_begin)) + std::distance(read.seq_begin, seq_begin);
+    size_t qual_len = std::distance(seq_begin, seq_end);
+    if ((::memchr(qual, '\n', qual_len) != nullptr) || (::memchr(qual, '\r', qual_len) != nullptr)) {
+      stripped_qual.assign(qual, qual_len);
+      qual = stripped_qual.data();
+      qual_len = stripped_qual.size();
+    }
+    size_t count = qual_batch(qual, qual + qual_len, qual_values);
+
+    IdType begin_id(read.id);
+    begin_id += read.seq_begin_offset;
+    begin_id += std::distance(read.seq_begin, seq_begin);
+
+    kernel(reinterpret_cast<unsigned char const *>(&(*seq_begin)), std::distance(seq_begin, seq_end),
+        [this, &output_iter, &begin_id, &count](size_t const & i, size_t const & offset, kmer_type const & km) {
+          if ((i >= count) || !threshold.pass(qual_values[i])) return;
+          IdType id(begin_id);
+          id += offset;
+          *output_iter = value_type(km, mapped_type(id, qual_values[i]));
+          ++output_iter;
+        });
+    return output_iter;
+  }
 
+  /// generate with the iterators.  the k-mer qualities for the whole read are computed in one batch instead of
+  /// through the per-k-mer sliding window in QualIterType.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
+    // same range as begin() and end()
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    assert(::std::distance(read.seq_begin, read.seq_end) <= ::std::distance(read.qual_begin, read.qual_end));
+
+    typename SeqType::IteratorType qual_begin = read.qual_begin;
+    std::advance(qual_begin, std::distance(read.seq_begin, seq_begin));
+    typename SeqType::IteratorType qual_end = qual_begin;
+    std::advance(qual_end, std::distance(seq_begin, seq_end));
+
+    bliss::utils::file::NotEOL neol;
+
+    // ==== quality scoring, filter eol.
+    size_t count = qual_batch(CharIter<SeqType>(neol, qual_begin, qual_end), CharIter<SeqType>(neol, qual_end), qual_values);
+
+    //== set up the kmer generating iterators.
+    KmerIter<SeqType> kmer_it(BaseCharIterator<SeqType>(
+        CharIter<SeqType>(neol, seq_begin, seq_end),
+        bliss::common::ASCII2<Alphabet>()), true);
+    KmerIter<SeqType> kmer_end(BaseCharIterator<SeqType>(
+        CharIter<SeqType>(neol, seq_end),
+        bliss::common::ASCII2<Alphabet>()), false);
+
+    //== set up the position iterators
+    IdType seq_begin_id(read.id);
+    seq_begin_id += read.seq_begin_offset;  // change id to point to start of sequence (in file coord)
+    seq_begin_id += std::distance(read.seq_begin, seq_begin);
+    IdType seq_end_id(seq_begin_id);
+    seq_end_id += std::distance(seq_begin, seq_end);
+
+    // tie chars and id together, and filter eol
+    CharPosIter<SeqType> pos_it(neol, PairedIter<SeqType>(seq_begin, IdIterType(seq_begin_id)),
+                                PairedIter<SeqType>(seq_end, IdIterType(seq_end_id)));
+
+    for (size_t i = 0; (i < count) && (kmer_it != kmer_end); ++i, ++kmer_it, ++pos_it) {
+      if (!threshold.pass(qual_values[i])) continue;
+      *output_iter = value_type(*kmer_it, mapped_type(::std::get<1>(*pos_it), qual_values[i]));
+      ++output_iter;
+    }
+
+    return output_iter;
   }
 };
 
-template <typename TupleType, template<typename> class QualityEncoder>
-constexpr size_t KmerPositionQualityTupleParser<TupleType, QualityEncoder>::window_size;
+template <typename TupleType, template<typename> class QualityEncoder, unsigned int TrimPhred, unsigned int MinKmerPhred>
+constexpr size_t KmerPositionQualityTupleParser<TupleType, QualityEncoder, TrimPhred, MinKmerPhred>::window_size;
 
 
 /**
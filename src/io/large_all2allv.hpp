@@ -0,0 +1,181 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    large_all2allv.hpp
+ * @ingroup
+ * @brief   all2allv for counts and displacements that do not fit in an int.
+ * @details MPI collectives take int counts and displacements, so an all2allv of more than 2^31 elements per rank, or
+ *          into a receive buffer of more than 2^31 elements, overflows.  large_all2allv uses the MPI 4 large count
+ *          MPI_Alltoallv_c when available.  otherwise, or if disabled, each pair of ranks exchanges its data in
+ *          messages of at most max_message_bytes, by MPI_Isend/MPI_Irecv in waves, with size_t offsets into the
+ *          buffers.  messages between 2 ranks are matched in order, so no other synchronization is needed.
+ *
+ *          distribute and undistribute decide with the allreduce of their input sizes that they already do:  if the
+ *          global element count, which bounds every message and receive buffer, is above INT_MAX or its bytes above
+ *          max_message_bytes, all ranks use large_all2allv.
+ *
+ *          elements are sent as bytes, so V has to be trivially copyable.
+ */
+#ifndef SRC_IO_LARGE_ALL2ALLV_HPP_
+#define SRC_IO_LARGE_ALL2ALLV_HPP_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <numeric>   // accumulate
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "io/comm_schedule.hpp"
+
+namespace imxx
+{
+
+  /// settings for large exchanges, per process.  should be the same on all ranks.
+  class large_count {
+    protected:
+      size_t max_message_bytes;
+      bool use_large_count_calls;
+
+    public:
+      /// tag of the chunked messages.
+      static constexpr int tag = 0x5AC0;
+
+      large_count() : max_message_bytes(1UL << 30), use_large_count_calls(true) {}
+
+      static large_count & instance() {
+        static large_count settings;
+        return settings;
+      }
+
+      /// largest message of the chunked exchange, and the size above which an exchange is treated as large.
+      void set_max_message_bytes(size_t const & b) { max_message_bytes = ::std::max(b, static_cast<size_t>(1)); }
+      size_t get_max_message_bytes() const { return max_message_bytes; }
+
+      /// use MPI_Alltoallv_c (MPI 4) instead of chunked messages, when available.
+      void set_large_count_calls(bool const & use) { use_large_count_calls = use; }
+      bool get_large_count_calls() const { return use_large_count_calls; }
+
+      /// MPI_Alltoallv_c is available.
+      static constexpr bool has_large_count_calls() {
+#if defined(MPI_VERSION) && (MPI_VERSION >= 4)
+        return true;
+#else
+        return false;
+#endif
+      }
+
+      /// whether an exchange whose global element count is global_count is large.  the same on all ranks.
+      bool is_large(size_t const & global_count, size_t const & elem_bytes) const {
+        return (global_count > static_cast<size_t>(::std::numeric_limits<int>::max())) ||
+            (global_count * elem_bytes > max_message_bytes);
+      }
+  };
+
+
+  /**
+   * @brief  all2allv in messages of at most chunk elements per pair of ranks, by MPI_Isend/MPI_Irecv in waves.  collective.
+   * @details  the displacements are given, so the received blocks need not be adjacent, e.g. aligned for a merge.
+   *          each wave has at most 1 message per peer and direction in flight, so the MPI buffers stay below
+   *          2 * p * chunk elements per rank.
+   */
+  template <typename V, typename SIZE>
+  void chunked_all2allv(V const * input, ::std::vector<SIZE> const & send_counts, ::std::vector<size_t> const & send_displs,
+                        V * output, ::std::vector<SIZE> const & recv_counts, ::std::vector<size_t> const & recv_displs,
+                        size_t const & chunk_size, ::mxx::comm const & comm) {
+    int const p = comm.size();
+    int const rank = comm.rank();
+
+    MPI_Datatype dt;
+    MPI_Type_contiguous(static_cast<int>(sizeof(V)), MPI_BYTE, &dt);
+    MPI_Type_commit(&dt);
+
+    // waves of at most 1 message per peer and direction, posted in schedule order.
+    pairwise_schedule const sched = comm_scheduler::instance().get(comm);
+    size_t chunk = ::std::max(static_cast<size_t>(1), chunk_size);
+    chunk = ::std::min(chunk, static_cast<size_t>(::std::numeric_limits<int>::max()));
+
+    ::std::copy(input + send_displs[rank], input + send_displs[rank] + send_counts[rank], output + recv_displs[rank]);
+
+    ::std::vector<MPI_Request> reqs;
+    reqs.reserve(2 * p);
+    for (size_t offset = 0; ; offset += chunk) {
+      reqs.clear();
+      for (int i = 1; i < p; ++i) {
+        int src = sched.src(i);
+        if (static_cast<size_t>(recv_counts[src]) > offset) {
+          reqs.emplace_back(MPI_REQUEST_NULL);
+          MPI_Irecv(output + recv_displs[src] + offset, static_cast<int>(::std::min(chunk, static_cast<size_t>(recv_counts[src]) - offset)), dt,
+                    src, large_count::tag, comm, &(reqs.back()));
+        }
+      }
+      for (int i = 1; i < p; ++i) {
+        int dst = sched.dst(i);
+        if (static_cast<size_t>(send_counts[dst]) > offset) {
+          reqs.emplace_back(MPI_REQUEST_NULL);
+          MPI_Isend(const_cast<V *>(input + send_displs[dst] + offset), static_cast<int>(::std::min(chunk, static_cast<size_t>(send_counts[dst]) - offset)), dt,
+                    dst, large_count::tag, comm, &(reqs.back()));
+        }
+      }
+      if (reqs.empty()) break;
+      MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+    }
+
+    MPI_Type_free(&dt);
+  }
+
+
+  /**
+   * @brief  all2allv with size_t counts and displacements.  collective.
+   * @param input         send buffer, grouped by destination rank.
+   * @param output        pre-sized to the sum of recv_counts.  grouped by source rank.
+   */
+  template <typename V, typename SIZE>
+  void large_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                      V * output, ::std::vector<SIZE> const & recv_counts,
+                      ::mxx::comm const & comm) {
+    int const p = comm.size();
+    large_count const & settings = large_count::instance();
+
+    ::std::vector<size_t> send_displs(p, 0), recv_displs(p, 0);
+    for (int i = 1; i < p; ++i) {
+      send_displs[i] = send_displs[i - 1] + send_counts[i - 1];
+      recv_displs[i] = recv_displs[i - 1] + recv_counts[i - 1];
+    }
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 4)
+    if (settings.get_large_count_calls()) {
+      MPI_Datatype dt;
+      MPI_Type_contiguous(static_cast<int>(sizeof(V)), MPI_BYTE, &dt);
+      MPI_Type_commit(&dt);
+      ::std::vector<MPI_Count> sc(send_counts.begin(), send_counts.end()), rc(recv_counts.begin(), recv_counts.end());
+      ::std::vector<MPI_Aint> sd(send_displs.begin(), send_displs.end()), rd(recv_displs.begin(), recv_displs.end());
+      MPI_Alltoallv_c(input, sc.data(), sd.data(), dt, output, rc.data(), rd.data(), dt, comm);
+      MPI_Type_free(&dt);
+      return;
+    }
+#endif
+
+    chunked_all2allv(input, send_counts, send_displs, output, recv_counts, recv_displs,
+                     settings.get_max_message_bytes() / sizeof(V), comm);
+  }
+
+} // namespace imxx
+
+#endif /* SRC_IO_LARGE_ALL2ALLV_HPP_ */
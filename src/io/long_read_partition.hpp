@@ -0,0 +1,217 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * long_read_partition.hpp
+ *
+ * @brief  split long reads across processes at kmer granularity, so that a few long reads do not load 1 process.
+ * @details  FASTQ partitions are aligned to records, so a process holds all of a read that starts in its partition.
+ *    for ONT or PacBio reads of 100 kb to 1 Mb, this is coarse and a process may get many more kmers than the others.
+ *
+ *    reads up to a threshold length are kept by the process that parsed them.  the kmer positions of the longer reads are
+ *    numbered globally and split so that the processes with fewer short read kmers get more of them.  each process
+ *    receives a fragment of a read for each range of kmer positions assigned to it, with k-1 chars overlap at the end.
+ *    a fragment keeps the read's SequenceId and its offset in the record, so kmer positions are the same as from the
+ *    whole read.
+ */
+
+#ifndef LONG_READ_PARTITION_HPP_
+#define LONG_READ_PARTITION_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <algorithm>    // upper_bound, min, max
+#include <iterator>     // advance
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/sequence.hpp"
+#include "io/file.hpp"
+
+
+namespace bliss {
+
+namespace io {
+
+/**
+ * @brief functions for splitting long reads across processes.  no state.
+ */
+struct long_read_partition {
+
+    /// number of size_t fields sent per fragment.
+    static constexpr size_t fields = 7;
+
+    /// part of a read.  the id fields are the same as SequenceId's, the offsets the same as Sequence's.
+    struct fragment {
+        size_t pos_in_file;
+        size_t seq_id;
+        size_t file_id;
+        size_t record_size;
+        /// offset of the read's sequence in the record.
+        size_t seq_offset;
+        /// offset of the fragment's first char in the record.
+        size_t seq_begin_offset;
+        /// position of the fragment's first char in data_type::chars
+        size_t char_start;
+        size_t length;
+    };
+
+    /// fragments received by a process, and their chars.
+    struct data_type {
+        using container = ::bliss::io::file_data::container;
+        using const_iterator = typename container::const_iterator;
+        using sequence_type = ::bliss::common::Sequence<const_iterator>;
+
+        ::std::vector<fragment> fragments;
+        container chars;
+
+        void clear() {
+          fragments.clear();
+          chars.clear();
+        }
+
+        /// the i-th fragment as a sequence, e.g. for a KmerParser.
+        sequence_type get_sequence(size_t const & i) const {
+          fragment const & f = fragments[i];
+          const_iterator b = chars.cbegin();
+          ::std::advance(b, f.char_start);
+          const_iterator e = b;
+          ::std::advance(e, f.length);
+          return sequence_type(::bliss::common::SequenceId(f.pos_in_file, f.seq_id, static_cast<uint16_t>(f.file_id)),
+                               f.record_size, f.seq_offset, f.seq_begin_offset, b, e);
+        }
+    };
+
+    /// number of kmers in a sequence of the given length.
+    static size_t get_kmer_count(size_t const & length, size_t const & k) {
+      return (length < k) ? 0 : (length - k + 1);
+    }
+
+    /**
+     * @brief  assign the long read kmers so that the largest number of kmers on a process is as small as possible.
+     * @details  each process is filled up to the average total kmers per process, in rank order.  a process
+     *           with more short read kmers than the average gets no long read kmers.
+     * @param short_kmers   number of short read kmers of each process.
+     * @param long_kmers    total number of long read kmers.
+     * @return  short_kmers.size() + 1 boundaries in the global long read kmer numbering.
+     *          process i gets [boundaries[i], boundaries[i+1]).
+     */
+    static ::std::vector<size_t> split(::std::vector<size_t> const & short_kmers, size_t const & long_kmers) {
+      size_t nparts = short_kmers.size();
+      ::std::vector<size_t> bounds(nparts + 1, 0);
+      if (nparts == 0) return bounds;
+
+      size_t total = long_kmers;
+      for (auto const & s : short_kmers) total += s;
+      size_t target = (total + nparts - 1) / nparts;
+
+      // the capacities add up to at least long_kmers, so the last boundary is long_kmers.
+      size_t cumulative = 0;
+      for (size_t i = 0; i < nparts; ++i) {
+        cumulative += (target > short_kmers[i]) ? (target - short_kmers[i]) : 0;
+        bounds[i + 1] = ::std::min(cumulative, long_kmers);
+      }
+      return bounds;
+    }
+
+    /**
+     * @brief  split the long reads of all processes and send each fragment to its process.  collective.
+     * @param reads         long reads parsed by this process.  seq_begin to seq_end must not contain EOL chars, as for FASTQ.
+     * @param short_kmers   number of kmers this process generates from its short reads.
+     * @param k             kmer size.  fragments overlap by k-1 chars.
+     * @param output        fragments for this process.
+     */
+    template <typename SeqType>
+    static void distribute(::std::vector<SeqType> const & reads, size_t const & short_kmers, size_t const & k,
+                           data_type & output, ::mxx::comm const & comm) {
+      output.clear();
+
+      size_t long_kmers = 0;
+      for (auto const & r : reads) long_kmers += get_kmer_count(r.seq_size(), k);
+
+      size_t total_long = ::mxx::allreduce(long_kmers, comm);
+      if (total_long == 0) return;
+
+      ::std::vector<size_t> bounds = split(::mxx::allgather(short_kmers, comm), total_long);
+
+      // global number of this process's first long read kmer.
+      size_t first = ::mxx::exscan(long_kmers, comm);
+      if (comm.rank() == 0) first = 0;
+
+      // reads are in global kmer order, so the fragments are already grouped by destination.
+      ::std::vector<size_t> meta;
+      typename data_type::container chars;
+      ::std::vector<size_t> meta_counts(comm.size(), 0);
+      ::std::vector<size_t> char_counts(comm.size(), 0);
+
+      for (auto const & r : reads) {
+        size_t n = get_kmer_count(r.seq_size(), k);
+        if (n == 0) continue;
+
+        size_t lo = first;
+        size_t end = first + n;
+        while (lo < end) {
+          int dest = static_cast<int>(::std::upper_bound(bounds.begin(), bounds.end(), lo) - bounds.begin()) - 1;
+          size_t hi = ::std::min(end, bounds[dest + 1]);
+
+          // kmers [lo, hi) need chars [lo, hi + k - 1) of the read.
+          size_t offset = lo - first;
+          size_t length = hi - lo + k - 1;
+
+          meta.push_back(r.id.get_pos());
+          meta.push_back(r.id.get_id());
+          meta.push_back(r.id.get_file_id());
+          meta.push_back(r.record_size);
+          meta.push_back(r.seq_offset);
+          meta.push_back(r.seq_begin_offset + offset);
+          meta.push_back(length);
+          meta_counts[dest] += fields;
+
+          auto b = r.seq_begin;
+          ::std::advance(b, offset);
+          auto e = b;
+          ::std::advance(e, length);
+          chars.insert(chars.end(), b, e);
+          char_counts[dest] += length;
+
+          lo = hi;
+        }
+        first = end;
+      }
+
+      meta = ::mxx::all2allv(meta, meta_counts, comm);
+      output.chars = ::mxx::all2allv(chars, char_counts, comm);
+
+      output.fragments.reserve(meta.size() / fields);
+      size_t char_start = 0;
+      for (size_t i = 0; i < meta.size(); i += fields) {
+        output.fragments.push_back(fragment{meta[i], meta[i + 1], meta[i + 2], meta[i + 3], meta[i + 4], meta[i + 5],
+          char_start, meta[i + 6]});
+        char_start += meta[i + 6];
+      }
+    }
+
+};
+
+
+} // namespace io
+
+} // namespace bliss
+
+#endif // LONG_READ_PARTITION_HPP_
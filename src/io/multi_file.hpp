@@ -0,0 +1,334 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * multi_file.hpp
+ *
+ * @brief  parallel reader for a set of files, partitioned as 1 concatenated byte space.
+ * @details  the files are treated as if concatenated, and the concatenated range is block partitioned across
+ *    the processes, so each process gets the same number of bytes even if the partition crosses file boundaries,
+ *    and small files do not leave processes idle.
+ *
+ *    a process's partition is split at file boundaries into pieces, and each piece is record aligned within its
+ *    own file:  a piece starts at the first record at or after its start, and ends at the first record at or after
+ *    its end.  a process finds the end of its piece with the same search the next process uses to find its start,
+ *    so the record alignment requires no communication.   only the constructor is collective.
+ *
+ *    with many more files than processes, e.g. thousands of single cell FASTQ files, the record search at each piece
+ *    boundary costs more than the balance is worth.  in whole file mode, each file is assigned as a whole to 1 process,
+ *    greedily by size (largest first, to the least loaded process, i.e. LPT scheduling), and each process reads its
+ *    files without searching and parses them on its own.  the only communication is the broadcast of the file sizes.
+ *
+ * @note   the record start is obtained via FileParser's find_first_record, so like block_streaming_file,
+ *         FASTQ is supported but FASTA is not, except in whole file mode, where files are not split.
+ */
+
+#ifndef MULTI_FILE_HPP_
+#define MULTI_FILE_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+
+#include <mpi.h>
+
+#include <string>
+#include <vector>
+#include <type_traits>  // is_same
+#include <algorithm>    // stable_sort
+#include <queue>        // priority_queue
+#include <functional>   // greater
+#include <utility>      // pair
+#include <stdexcept>
+
+#include <mxx/comm.hpp>
+
+#include <io/io_exception.hpp>
+#include <io/file.hpp>
+#include <io/fastq_loader.hpp>
+#include <io/fasta_loader.hpp>
+#include <partition/range.hpp>
+#include <partition/partitioner.hpp>
+#include <partition/rank_weights.hpp>
+#include <utils/exception_handling.hpp>
+
+
+namespace bliss {
+
+namespace io {
+
+namespace parallel {
+
+/**
+ * @brief a list of files partitioned as 1 concatenated byte space.
+ * @tparam FileReader  the sequential file reader to use, e.g. posix_file or mmap_file
+ * @tparam FileParser  parser for finding record starts.
+ */
+template <typename FileReader,
+          template <typename> class FileParser = ::bliss::io::FASTQParser >
+class multi_file {
+
+protected:
+  using range_type = typename ::bliss::io::base_file::range_type;
+  using FileParserType = FileParser<typename ::bliss::io::file_data::const_iterator >;
+
+  /// communicator used.
+  const ::mxx::comm comm;
+
+  /// names of the files.
+  std::vector<std::string> filenames;
+
+  /// start of each file in the concatenated byte space.  last entry is the total size.
+  std::vector<size_t> file_offsets;
+
+  /// the process's block partition, in the concatenated byte space.  empty in whole file mode.
+  range_type partition_range_bytes;
+
+  /// whole file mode.
+  bool whole_files;
+
+  /// in whole file mode, the process that reads each file.
+  std::vector<int> file_owners;
+
+  /// default size of the window used to search for record starts.
+  static constexpr size_t search_window = 65536UL;
+
+  /**
+   * @brief  find the position of the first record at or after pos, reading increasing amount of
+   *         file data until a record start is found or the end of the file is reached.
+   * @note   same as block_streaming_file's.
+   * @param reader  reader for the file
+   * @param file_size  size of the file
+   * @param pos    position in the file from which to search.
+   * @param buffer  scratch buffer for the search
+   * @return  position of the first record start that is >= pos, or file size if not found.
+   */
+  size_t find_record_start(FileReader & reader, size_t const & file_size, size_t const & pos,
+                           typename ::bliss::io::file_data::container & buffer) {
+    range_type file_range(0, file_size);
+    size_t limit = file_size;
+    if (pos >= limit) return limit;
+
+    FileParserType parser;
+    size_t window = search_window;
+    range_type search;
+    size_t start;
+
+    while (true) {
+      search = range_type(pos, ::std::min(limit, pos + window));
+      range_type in_mem = reader.read_range(buffer, search);
+
+      try {
+        start = parser.find_first_record(buffer.cbegin(), file_range, in_mem, search);
+      } catch (::std::logic_error & e) {
+        // no complete record in window.
+        start = search.end;
+      }
+
+      // found, or already searched all the way to the limit.
+      if ((start < search.end) || (search.end == limit)) break;
+
+      window <<= 1;
+    }
+
+    return start;
+  }
+
+public:
+
+  /**
+   * @brief constructor.  collective.  rank 0 gets the file sizes to avoid concurrent stat calls, then broadcasts (see stat_files).
+   * @param _filenames    names of files to open, in the order of concatenation.
+   * @param _comm         MPI communicator to use.
+   * @param _whole_files  assign each file as a whole to 1 process instead of partitioning the concatenated bytes.
+   */
+  multi_file(std::vector<std::string> const & _filenames, ::mxx::comm const & _comm = ::mxx::comm(),
+             bool const & _whole_files = false) :
+    comm(_comm.copy()), filenames(_filenames), file_offsets(_filenames.size() + 1, 0),
+    partition_range_bytes(0, 0), whole_files(_whole_files) {
+
+    if (!whole_files && ::std::is_same<FileParserType,
+        ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator> >::value)
+      throw std::invalid_argument("multi_file: FASTA records span partitions.  FASTA files can only be read in whole file mode.");
+
+    // get the file sizes.  throws on all processes if a file is not valid.
+    std::vector<size_t> sizes = ::bliss::io::parallel::stat_files(filenames, comm, "bliss::io::parallel::multi_file");
+
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      file_offsets[i + 1] = file_offsets[i] + sizes[i];
+    }
+
+    if (whole_files) {
+      file_owners = assign_files(sizes, comm.size(), ::bliss::partition::rank_weights::instance().get(comm));
+      return;
+    }
+
+    // partition the concatenated range.
+    partition_range_bytes = range_type(0, file_offsets.back());
+    if (comm.size() > 1) {
+      ::bliss::partition::BlockPartitioner<range_type> partitioner;
+      partitioner.configure(partition_range_bytes, comm.size(), ::bliss::partition::rank_weights::instance().get(comm));
+      partition_range_bytes = partitioner.getNext(comm.rank());
+    }
+  };
+
+  /// destructor
+  virtual ~multi_file() {};
+
+  /// get the total size of all files.
+  size_t size() const {
+    return file_offsets.back();
+  }
+
+  /// get the number of files
+  size_t get_file_count() const {
+    return filenames.size();
+  }
+
+  /// get the name of a file
+  std::string const & get_filename(size_t const & id) const {
+    return filenames[id];
+  }
+
+  /// get the range of a file in the concatenated byte space
+  range_type get_file_range(size_t const & id) const {
+    return range_type(file_offsets[id], file_offsets[id + 1]);
+  }
+
+  /// get the (not record-aligned) partition in the concatenated byte space.  empty in whole file mode.
+  range_type const & get_partition_range() const {
+    return partition_range_bytes;
+  }
+
+  bool is_whole_files() const { return whole_files; }
+
+  /// in whole file mode, get the process that reads a file.
+  int get_file_owner(size_t const & id) const {
+    return file_owners[id];
+  }
+
+  /**
+   * @brief  assign whole files to processes by size, largest first, each to the process with the least load.  not collective.
+   * @details  with weights (see rank_weights), the load of a process is divided by its weight.  ties go to the lower
+   *           file id and rank, so all processes compute the same assignment.
+   * @return  the process for each file.
+   */
+  static std::vector<int> assign_files(std::vector<size_t> const & sizes, int const & nprocs,
+                                       std::vector<double> const & weights = std::vector<double>()) {
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    ::std::stable_sort(order.begin(), order.end(), [&sizes](size_t const & x, size_t const & y) {
+      return sizes[x] > sizes[y];
+    });
+
+    // min heap of (relative load, rank).
+    using load_type = std::pair<double, int>;
+    std::priority_queue<load_type, std::vector<load_type>, std::greater<load_type> > loads;
+    for (int r = 0; r < nprocs; ++r) loads.emplace(0.0, r);
+
+    std::vector<int> owners(sizes.size(), 0);
+    load_type least;
+    for (size_t i = 0; i < order.size(); ++i) {
+      least = loads.top();
+      loads.pop();
+      owners[order[i]] = least.second;
+      least.first += static_cast<double>(sizes[order[i]]) / (weights.empty() ? 1.0 : weights[least.second]);
+      loads.push(least);
+    }
+    return owners;
+  }
+
+  /**
+   * @brief get the ids of the files that intersect the process's partition, in order.  in whole file mode, the files assigned to the process.
+   */
+  std::vector<size_t> get_local_files() const {
+    std::vector<size_t> ids;
+    if (whole_files) {
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        if (file_owners[i] == comm.rank()) ids.push_back(i);
+      }
+      return ids;
+    }
+    if (partition_range_bytes.size() == 0) return ids;
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      if ((file_offsets[i] < partition_range_bytes.end) &&
+          (file_offsets[i + 1] > partition_range_bytes.start)) ids.push_back(i);
+    }
+    return ids;
+  }
+
+  /**
+   * @brief  read the record-aligned pieces of the process's partition, 1 per local file.  NOT collective.
+   * @details  ranges of each file_data are in that file's coordinates, and parent range is the file's range.
+   *           a piece with no record start of its own is empty.  in whole file mode, each piece is a whole file.
+   * @param output    file_data objects, 1 per entry of get_local_files().
+   */
+  void read_file(std::vector<::bliss::io::file_data> & output) {
+    std::vector<size_t> ids = get_local_files();
+    output.resize(ids.size());
+
+    typename ::bliss::io::file_data::container buffer;
+    size_t start, end;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      size_t const & id = ids[i];
+      size_t file_size = file_offsets[id + 1] - file_offsets[id];
+
+      // piece of the partition in the local file, in the file's coordinates.
+      range_type piece = range_type::intersect(partition_range_bytes, get_file_range(id));
+      piece.start -= file_offsets[id];
+      piece.end -= file_offsets[id];
+
+      FileReader reader(filenames[id], file_size, 0);
+
+      if (whole_files) {
+        output[i].in_mem_range_bytes = reader.read_range(output[i].data, range_type(0, file_size));
+        output[i].valid_range_bytes = output[i].in_mem_range_bytes;
+        output[i].parent_range_bytes = range_type(0, file_size);
+        continue;
+      }
+
+      start = (piece.start == 0) ? 0 : find_record_start(reader, file_size, piece.start, buffer);
+      end = (piece.end == file_size) ? file_size : find_record_start(reader, file_size, piece.end, buffer);
+      if (end < start) end = start;
+
+      output[i].in_mem_range_bytes = reader.read_range(output[i].data, range_type(start, end));
+      output[i].valid_range_bytes = output[i].in_mem_range_bytes;
+      output[i].parent_range_bytes = range_type(0, file_size);
+    }
+  }
+
+  /**
+   * @brief  read the record-aligned pieces of the process's partition, 1 per local file.  NOT collective.
+   */
+  std::vector<::bliss::io::file_data> read_file() {
+    std::vector<::bliss::io::file_data> output;
+    read_file(output);
+    return output;
+  }
+
+};
+
+
+} // parallel
+
+} // io
+
+} // bliss
+
+#endif  // USE_MPI
+
+#endif /* MULTI_FILE_HPP_ */
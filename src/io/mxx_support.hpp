@@ -37,6 +37,7 @@
 
 #include "partition/range.hpp"
 #include "common/sequence.hpp"
+#include "io/byte_transport.hpp"
 
 namespace mxx {
 
@@ -47,6 +48,8 @@ namespace mxx {
 
       typedef datatype_contiguous<typename bliss::common::Kmer<size, A, WT>::KmerWordType,
       bliss::common::Kmer<size, A, WT>::nWords> baseType;
+      static_assert(sizeof(bliss::common::Kmer<size, A, WT>) == bliss::common::Kmer<size, A, WT>::nWords * sizeof(WT),
+                    "Kmer should be stored as contiguous words without padding");
 
       static MPI_Datatype get_type(){ 
         return baseType::get_type(); 
@@ -65,6 +68,8 @@ namespace mxx {
 
       typedef datatype_contiguous<typename bliss::common::Kmer<size, A, WT>::KmerWordType,
       bliss::common::Kmer<size, A, WT>::nWords> baseType;
+      static_assert(sizeof(bliss::common::Kmer<size, A, WT>) == bliss::common::Kmer<size, A, WT>::nWords * sizeof(WT),
+                    "Kmer should be stored as contiguous words without padding");
 
       static MPI_Datatype get_type(){ 
         return baseType::get_type(); 
@@ -140,6 +145,39 @@ namespace mxx {
     };
 
 
+  // packed, so sent as bytes.
+  template<typename ReadIdType>
+    struct datatype_builder<bliss::common::DenseSequenceKmerId<ReadIdType> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::common::DenseSequenceKmerId<ReadIdType>) > {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::common::DenseSequenceKmerId<ReadIdType>) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename ReadIdType>
+    struct datatype_builder<const bliss::common::DenseSequenceKmerId<ReadIdType> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::common::DenseSequenceKmerId<ReadIdType>) > {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::common::DenseSequenceKmerId<ReadIdType>) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
   template<typename T>
     struct datatype_builder<bliss::partition::range<T> > : 
     public datatype_contiguous<T , 
@@ -180,6 +218,35 @@ namespace mxx {
 }  // namespace mxx
 
 
+namespace imxx {
+
+  // payloads that are sent as bytes.  the sizes are checked so that no padding is sent.
+  template<unsigned int size, typename A, typename WT>
+    struct is_byte_transport<bliss::common::Kmer<size, A, WT> > : public ::std::true_type {
+      static_assert(sizeof(bliss::common::Kmer<size, A, WT>) == bliss::common::Kmer<size, A, WT>::nWords * sizeof(WT),
+                    "Kmer should be stored as contiguous words without padding");
+    };
+
+  template<>
+    struct is_byte_transport<bliss::common::LongSequenceKmerId> : public ::std::integral_constant<bool,
+      sizeof(bliss::common::LongSequenceKmerId) == sizeof(decltype(bliss::common::LongSequenceKmerId::id))> {};
+
+  template<>
+    struct is_byte_transport<bliss::common::ShortSequenceKmerId> : public ::std::integral_constant<bool,
+      sizeof(bliss::common::ShortSequenceKmerId) == sizeof(decltype(bliss::common::ShortSequenceKmerId::id))> {};
+
+  // packed.
+  template<typename ReadIdType>
+    struct is_byte_transport<bliss::common::DenseSequenceKmerId<ReadIdType> > : public ::std::integral_constant<bool,
+      sizeof(bliss::common::DenseSequenceKmerId<ReadIdType>) == sizeof(ReadIdType) + sizeof(uint16_t)> {};
+
+  template<typename T>
+    struct is_byte_transport<bliss::partition::range<T> > : public ::std::integral_constant<bool,
+      is_byte_transport<T>::value && (sizeof(bliss::partition::range<T>) == 2 * sizeof(T))> {};
+
+}  // namespace imxx
+
+
 //std::ostream &operator<<(std::ostream &os, uint8_t const &t) {
 //  return os << static_cast<uint32_t>(t);
 //}
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * packed_sequence_file.hpp
+ *
+ * @brief  pre-parsed binary sequence file, so that repeated index builds from the same reads do not need to parse ASCII.
+ * @details  sequences are translated to the alphabet and packed with PackedEncoder, in the PackedStringImpl layout, e.g. 2 bits per char for DNA, 4 for DNA16.
+ *    each record keeps its SequenceId fields and the sequence offset in the record, so k-mer positions are the same as
+ *    from the original file.  qualities are not stored.
+ *
+ *    records are grouped into blocks of about the same number of words.  The block directory allows the blocks to be
+ *    partitioned between processes without scanning the records.
+ *
+ *    binary format, all uint64_t in native byte order:
+ *      header:   magic, version, bits per char, alphabet size, number of records, number of blocks, number of words, reserved
+ *      blocks:   record start, record count, word start, word count   (number of blocks entries)
+ *      records:  pos_in_file, seq_id, file_id, seq_begin_offset, length   (number of records entries)
+ *      words:    packed sequences.  each record starts on a word boundary.
+ */
+
+#ifndef PACKED_SEQUENCE_FILE_HPP_
+#define PACKED_SEQUENCE_FILE_HPP_
+
+#include "bliss-config.hpp"
+
+#include <cstdio>       // fopen, fread, fwrite
+#include <cstdint>      // uint64_t
+#include <cstring>      // strerror
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sstream>      // stringstream
+#include <algorithm>    // lower_bound, min
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+#endif
+
+#include <common/base_types.hpp>
+#include <common/alphabet_traits.hpp>
+#include <common/packed_string.hpp>
+#include <common/packed_encoder.hpp>
+#include <io/io_exception.hpp>
+#include <utils/exception_handling.hpp>
+
+
+namespace bliss {
+
+namespace io {
+
+/**
+ * @brief  packed sequences for 1 alphabet, with read and write functions.
+ * @tparam Alphabet   alphabet of the sequences.  same as the KmerAlphabet of the kmers to generate.
+ */
+template <typename Alphabet>
+struct packed_sequence_file {
+
+    using packed_string_type = typename ::bliss::common::AlphabetTraits<Alphabet>::PackedStringType;
+    using word_type = ::WordType;
+    using encoder_type = ::bliss::common::PackedEncoder<Alphabet>;
+
+    static constexpr unsigned int bits_per_char = ::bliss::common::AlphabetTraits<Alphabet>::getBitsPerChar();
+    static constexpr size_t chars_per_word = (sizeof(word_type) * 8) / bits_per_char;
+
+    /// identifies the file type.  "BLISSPKS" as a little endian uint64_t
+    static constexpr uint64_t magic = 0x534B505353494C42UL;
+    /// format version.
+    static constexpr uint64_t version = 1UL;
+    /// default number of words per block.  512KB
+    static constexpr size_t default_block_words = 1UL << 16;
+    /// bytes per MPI-IO call.
+    static constexpr size_t io_chunk_bytes = 64UL * 1024UL * 1024UL;
+
+    /// file header
+    struct header_type {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t bits_per_char;
+        uint64_t alphabet_size;
+        uint64_t record_count;
+        uint64_t block_count;
+        uint64_t word_count;
+        uint64_t reserved;
+    };
+
+    /// 1 sequence.  the id fields are the same as SequenceId's
+    struct record_type {
+        uint64_t pos_in_file;
+        uint64_t seq_id;
+        uint64_t file_id;
+        uint64_t seq_begin_offset;
+        uint64_t length;
+    };
+
+    /// a range of records and the words containing their sequences.
+    struct block_type {
+        uint64_t record_start;
+        uint64_t record_count;
+        uint64_t word_start;
+        uint64_t word_count;
+    };
+
+    /// in memory packed sequences.  block starts are indices into records and words.
+    struct data_type {
+        ::std::vector<block_type> blocks;
+        ::std::vector<record_type> records;
+        ::std::vector<word_type> words;
+
+        void clear() {
+          blocks.clear();
+          records.clear();
+          words.clear();
+        }
+    };
+
+    /// number of words for a sequence of the given length.
+    static size_t get_word_count(size_t const & length) {
+      return (length + chars_per_word - 1) / chars_per_word;
+    }
+
+    /**
+     * @brief  translate and pack 1 sequence, and append it to data.  a new block is started if the current one would exceed block_words.
+     * @param seq          sequence object, e.g. from FASTQParser.  seq_begin to seq_end must not contain EOL chars.
+     * @param block_words  maximum number of words in a block, unless it has only 1 record.
+     */
+    template <typename SeqType>
+    static void append(data_type & data, SeqType const & seq, size_t const & block_words = default_block_words) {
+      // contiguous copy, so the encoder can work on blocks of chars.
+      ::std::vector<unsigned char> chars(seq.seq_begin, seq.seq_end);
+
+      record_type rec;
+      rec.pos_in_file = seq.id.get_pos();
+      rec.seq_id = seq.id.get_id();
+      rec.file_id = seq.id.get_file_id();
+      rec.seq_begin_offset = seq.seq_begin_offset;
+      rec.length = chars.size();
+
+      size_t nwords = get_word_count(chars.size());
+      if (data.blocks.empty() || ((data.blocks.back().word_count + nwords) > block_words)) {
+        data.blocks.push_back(block_type{data.records.size(), 0, data.words.size(), 0});
+      }
+      data.blocks.back().record_count += 1;
+      data.blocks.back().word_count += nwords;
+
+      data.records.push_back(rec);
+      size_t offset = data.words.size();
+      data.words.resize(offset + nwords);
+      encoder_type::encode(chars.data(), chars.size(), data.words.data() + offset);
+    }
+
+    /// make a header for the data.
+    static header_type make_header(size_t const & records, size_t const & blocks, size_t const & words) {
+      return header_type{ static_cast<uint64_t>(magic), static_cast<uint64_t>(version), bits_per_char,
+        static_cast<uint64_t>(Alphabet::SIZE), records, blocks, words, 0 };
+    }
+
+    /// check a header read from a file.  throws IOException if it does not match this alphabet.
+    static void check_header(::std::string const & filename, header_type const & header) {
+      if ((header.magic != magic) || (header.version != version) ||
+          (header.bits_per_char != bits_per_char) || (header.alphabet_size != Alphabet::SIZE)) {
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::packed_sequence_file: [" << filename << "] is not a packed sequence file for this alphabet.";
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+    }
+
+    /**
+     * @brief  load all packed sequences in a file.
+     * @param data[out]   packed sequences.
+     */
+    static void read(::std::string const & filename, data_type & data) {
+      data.clear();
+
+      FILE * fp = fopen(filename.c_str(), "rb");
+      bool ok = (fp != nullptr);
+      int myerr = errno;
+
+      header_type header = header_type();
+      if (ok) ok = (fread(&header, sizeof(header_type), 1, fp) == 1);
+      if (ok) {
+        try {
+          check_header(filename, header);
+        } catch (::bliss::io::IOException & e) {
+          fclose(fp);
+          throw;
+        }
+
+        data.blocks.resize(header.block_count);
+        data.records.resize(header.record_count);
+        data.words.resize(header.word_count);
+        ok = (fread(data.blocks.data(), sizeof(block_type), data.blocks.size(), fp) == data.blocks.size()) &&
+            (fread(data.records.data(), sizeof(record_type), data.records.size(), fp) == data.records.size()) &&
+            (fread(data.words.data(), sizeof(word_type), data.words.size(), fp) == data.words.size());
+      }
+      if (!ok) myerr = errno;
+      if (fp != nullptr) fclose(fp);
+
+      if (!ok) {
+        data.clear();
+
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::packed_sequence_file::read: ["  << filename << "] " << myerr << ": " << strerror(myerr);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+    }
+
+    /**
+     * @brief  save packed sequences.  written to a temporary file then renamed, so readers never see a partial file.
+     */
+    static void write(::std::string const & filename, data_type const & data) {
+      ::std::string tmp_filename = filename + ".tmp";
+
+      header_type header = make_header(data.records.size(), data.blocks.size(), data.words.size());
+
+      FILE * fp = fopen(tmp_filename.c_str(), "wb");
+      bool ok = (fp != nullptr);
+      if (ok) {
+        ok = (fwrite(&header, sizeof(header_type), 1, fp) == 1) &&
+            (fwrite(data.blocks.data(), sizeof(block_type), data.blocks.size(), fp) == data.blocks.size()) &&
+            (fwrite(data.records.data(), sizeof(record_type), data.records.size(), fp) == data.records.size()) &&
+            (fwrite(data.words.data(), sizeof(word_type), data.words.size(), fp) == data.words.size());
+        ok &= (fclose(fp) == 0);
+      }
+      if (ok) ok = (rename(tmp_filename.c_str(), filename.c_str()) == 0);
+
+      if (!ok) {
+        int myerr = errno;
+        remove(tmp_filename.c_str());
+
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::packed_sequence_file::write: ["  << filename << "] " << myerr << ": " << strerror(myerr);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+    }
+
+#if defined(USE_MPI)
+  protected:
+    static void throw_io_error(::std::string const & filename, ::std::string const & op, int res, ::mxx::comm const & comm) {
+      char msg[MPI_MAX_ERROR_STRING];
+      int len = 0;
+      MPI_Error_string(res, msg, &len);
+
+      ::std::stringstream ss;
+      ss << "ERROR : bliss::io::packed_sequence_file::" << op << ": rank " << comm.rank() << " [" << filename << "] " << ::std::string(msg, len);
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+    }
+
+    /// collectively write or read a local range of bytes, in chunks. all processes participate in every round.
+    template <bool is_write>
+    static int transfer_at_all(MPI_File & fh, MPI_Offset offset, unsigned char * ptr, size_t bytes, ::mxx::comm const & comm) {
+      size_t rounds = ::mxx::allreduce((bytes + io_chunk_bytes - 1) / io_chunk_bytes, ::mxx::max<size_t>(), comm);
+
+      MPI_Status stat;
+      int res = MPI_SUCCESS, r_res;
+      size_t pos = 0, n;
+      for (size_t r = 0; r < rounds; ++r) {
+        n = ::std::min(io_chunk_bytes, bytes - pos);
+        if (is_write) r_res = MPI_File_write_at_all(fh, offset + pos, ptr + pos, n, MPI_BYTE, &stat);
+        else r_res = MPI_File_read_at_all(fh, offset + pos, ptr + pos, n, MPI_BYTE, &stat);
+        if (res == MPI_SUCCESS) res = r_res;
+        pos += n;
+      }
+      return res;
+    }
+
+  public:
+    /**
+     * @brief  save the packed sequences of all processes, in rank order.  collective.
+     * @param data   packed sequences on the current process.  block starts are local.
+     */
+    static void write(::std::string const & filename, data_type const & data, ::mxx::comm const & comm) {
+      // global offsets of the local blocks, records, and words
+      size_t block_offset = ::mxx::exscan(data.blocks.size(), comm);
+      size_t record_offset = ::mxx::exscan(data.records.size(), comm);
+      size_t word_offset = ::mxx::exscan(data.words.size(), comm);
+      if (comm.rank() == 0) {
+        block_offset = 0;
+        record_offset = 0;
+        word_offset = 0;
+      }
+      size_t blocks = ::mxx::allreduce(data.blocks.size(), comm);
+      size_t records = ::mxx::allreduce(data.records.size(), comm);
+      size_t words = ::mxx::allreduce(data.words.size(), comm);
+
+      ::std::vector<block_type> global_blocks(data.blocks);
+      for (auto & b : global_blocks) {
+        b.record_start += record_offset;
+        b.word_start += word_offset;
+      }
+
+      MPI_File fh;
+      int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+      if (res != MPI_SUCCESS) throw_io_error(filename, "write", res, comm);
+
+      // truncate any existing file.
+      res = MPI_File_set_size(fh, 0);
+
+      MPI_Status stat;
+      header_type header = make_header(records, blocks, words);
+      if ((res == MPI_SUCCESS) && (comm.rank() == 0)) {
+        res = MPI_File_write_at(fh, 0, &header, sizeof(header_type), MPI_BYTE, &stat);
+      }
+
+      MPI_Offset start = sizeof(header_type);
+      int r_res = transfer_at_all<true>(fh, start + block_offset * sizeof(block_type),
+                                        reinterpret_cast<unsigned char *>(global_blocks.data()), global_blocks.size() * sizeof(block_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      start += blocks * sizeof(block_type);
+      r_res = transfer_at_all<true>(fh, start + record_offset * sizeof(record_type),
+                                    reinterpret_cast<unsigned char *>(const_cast<record_type *>(data.records.data())),
+                                    data.records.size() * sizeof(record_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      start += records * sizeof(record_type);
+      r_res = transfer_at_all<true>(fh, start + word_offset * sizeof(word_type),
+                                    reinterpret_cast<unsigned char *>(const_cast<word_type *>(data.words.data())),
+                                    data.words.size() * sizeof(word_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      int c_res = MPI_File_close(&fh);
+      if (res == MPI_SUCCESS) res = c_res;
+
+      if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+        throw_io_error(filename, "write", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res, comm);
+      }
+    }
+
+    /**
+     * @brief  load packed sequences.  collective.  blocks are partitioned so that each process gets about the same number of words.
+     * @param data[out]   packed sequences for the current process.  block starts are local.
+     */
+    static void read(::std::string const & filename, data_type & data, ::mxx::comm const & comm) {
+      data.clear();
+
+      MPI_File fh;
+      int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+      if (res != MPI_SUCCESS) throw_io_error(filename, "read", res, comm);
+      MPI_File_set_atomicity(fh, 0);
+
+      // all processes read the header and the block directory.
+      MPI_Status stat;
+      header_type header = header_type();
+      res = MPI_File_read_at_all(fh, 0, &header, sizeof(header_type), MPI_BYTE, &stat);
+      if (res == MPI_SUCCESS) {
+        try {
+          check_header(filename, header);
+        } catch (::bliss::io::IOException & e) {
+          MPI_File_close(&fh);
+          throw;
+        }
+      }
+
+      ::std::vector<block_type> blocks(header.block_count);
+      MPI_Offset start = sizeof(header_type);
+      int r_res = transfer_at_all<false>(fh, start, reinterpret_cast<unsigned char *>(blocks.data()),
+                                         blocks.size() * sizeof(block_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      // blocks are in word order.  rank r gets the blocks starting in [r * words / p, (r+1) * words / p)
+      auto word_less = [](block_type const & b, uint64_t const & w) { return b.word_start < w; };
+      size_t rank = comm.rank();
+      size_t first = ::std::lower_bound(blocks.begin(), blocks.end(), (rank * header.word_count) / comm.size(), word_less) - blocks.begin();
+      size_t last = ::std::lower_bound(blocks.begin(), blocks.end(), ((rank + 1) * header.word_count) / comm.size(), word_less) - blocks.begin();
+      if (rank == static_cast<size_t>(comm.size() - 1)) last = blocks.size();
+      if (res != MPI_SUCCESS) first = last = 0;
+
+      data.blocks.assign(blocks.begin() + first, blocks.begin() + last);
+      size_t record_start = 0, word_start = 0;
+      if (!data.blocks.empty()) {
+        record_start = data.blocks.front().record_start;
+        word_start = data.blocks.front().word_start;
+        data.records.resize(data.blocks.back().record_start + data.blocks.back().record_count - record_start);
+        data.words.resize(data.blocks.back().word_start + data.blocks.back().word_count - word_start);
+      }
+      for (auto & b : data.blocks) {
+        b.record_start -= record_start;
+        b.word_start -= word_start;
+      }
+
+      start += header.block_count * sizeof(block_type);
+      r_res = transfer_at_all<false>(fh, start + record_start * sizeof(record_type),
+                                     reinterpret_cast<unsigned char *>(data.records.data()), data.records.size() * sizeof(record_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      start += header.record_count * sizeof(record_type);
+      r_res = transfer_at_all<false>(fh, start + word_start * sizeof(word_type),
+                                     reinterpret_cast<unsigned char *>(data.words.data()), data.words.size() * sizeof(word_type), comm);
+      if (res == MPI_SUCCESS) res = r_res;
+
+      int c_res = MPI_File_close(&fh);
+      if (res == MPI_SUCCESS) res = c_res;
+
+      if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+        data.clear();
+        throw_io_error(filename, "read", (res == MPI_SUCCESS) ? MPI_ERR_OTHER : res, comm);
+      }
+    }
+#endif
+
+};
+
+template <typename Alphabet>
+constexpr unsigned int packed_sequence_file<Alphabet>::bits_per_char;
+template <typename Alphabet>
+constexpr size_t packed_sequence_file<Alphabet>::chars_per_word;
+template <typename Alphabet>
+constexpr uint64_t packed_sequence_file<Alphabet>::magic;
+template <typename Alphabet>
+constexpr uint64_t packed_sequence_file<Alphabet>::version;
+template <typename Alphabet>
+constexpr size_t packed_sequence_file<Alphabet>::default_block_words;
+template <typename Alphabet>
+constexpr size_t packed_sequence_file<Alphabet>::io_chunk_bytes;
+
+} // io
+
+} // bliss
+
+#endif /* PACKED_SEQUENCE_FILE_HPP_ */
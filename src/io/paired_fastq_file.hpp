@@ -0,0 +1,245 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * paired_fastq_file.hpp
+ *
+ * @brief  parallel reader for paired end FASTQ files (R1 and R2), co-partitioned so that mates are on the same process.
+ * @details  R1 is partitioned by partitioned_file<FASTQParser>, i.e. block partitioned then record aligned.
+ *    the number of records on each process in R1 then determines the R2 partitions: process i gets the same
+ *    record ids [s_i, e_i) from R2.
+ *
+ *    R2 is first read the same way as R1 and its records are counted.  the R2 byte offset of the first record
+ *    id of each R1 partition is then known to the process that holds that record, and is shared with 1
+ *    allreduce of p offsets.  each process then reads its R2 range, [offset of s_i, offset of e_i), from the file,
+ *    reusing the part that is already in memory and reading only the fringes.  no R2 data is exchanged between
+ *    processes, and the mates are local, i.e. the k-th record in the R1 partition is the mate of the k-th
+ *    record in the R2 partition.
+ */
+
+#ifndef PAIRED_FASTQ_FILE_HPP_
+#define PAIRED_FASTQ_FILE_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+
+#include <string>
+#include <vector>
+#include <sstream>      // stringstream
+#include <utility>      // pair
+#include <limits>       // numeric_limits
+#include <functional>   // std::plus
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include <io/io_exception.hpp>
+#include <io/file.hpp>
+#include <io/fastq_loader.hpp>
+#include <partition/range.hpp>
+#include <utils/exception_handling.hpp>
+
+
+namespace bliss {
+
+namespace io {
+
+namespace parallel {
+
+/**
+ * @brief paired end FASTQ file.  R1 and R2 are partitioned so that the same records (by record id) are on the same process.
+ * @tparam FileReader  the sequential file reader to use, e.g. posix_file or mmap_file
+ */
+template <typename FileReader>
+class paired_fastq_file {
+
+protected:
+	using range_type = typename ::bliss::io::base_file::range_type;
+	using FileType = ::bliss::io::parallel::partitioned_file<FileReader, ::bliss::io::FASTQParser>;
+	using SeqParserType = ::bliss::io::SequentialFASTQParser<typename ::bliss::io::file_data::const_iterator >;
+
+	/// communicator
+	::mxx::comm comm;
+
+	/// the R1 file
+	FileType file1;
+
+	/// the R2 file
+	FileType file2;
+
+	/// name of the R2 file, for reading the ranges that match the R1 partitions.
+	std::string filename2;
+
+	/**
+	 * @brief get the starting offsets of the records in the valid range of a FASTQ partition.
+	 * @return  vector of record start positions, followed by the valid range end.  size is number of records + 1.
+	 */
+	static std::vector<size_t> get_record_offsets(::bliss::io::file_data const & fdata) {
+		std::vector<size_t> offsets;
+
+		typename ::bliss::io::file_data::const_iterator iter = fdata.cbegin();
+		typename ::bliss::io::file_data::const_iterator end = fdata.cend();
+		size_t offset = fdata.valid_range_bytes.start;
+
+		SeqParserType parser;
+		while (iter != end) {
+			size_t record_start = offset;
+			auto seq = parser.get_next_record(iter, end, offset);
+			if (seq.record_size == 0) break;
+
+			offsets.push_back(record_start);
+		}
+		offsets.push_back(fdata.valid_range_bytes.end);
+
+		return offsets;
+	}
+
+public:
+
+	/**
+	 * @brief constructor.  collective.
+	 * @param _filename1 	name of the R1 file
+	 * @param _filename2 	name of the R2 file
+	 * @param _comm				MPI communicator to use.
+	 */
+	paired_fastq_file(std::string const & _filename1, std::string const & _filename2,
+			::mxx::comm const & _comm = ::mxx::comm()) :
+		comm(_comm.copy()), file1(_filename1, 0UL, comm), file2(_filename2, 0UL, comm), filename2(_filename2) {};
+
+	/// destructor
+	virtual ~paired_fastq_file() {};
+
+	/// get R1 file size
+	size_t size1() {
+		return file1.size();
+	}
+
+	/// get R2 file size
+	size_t size2() {
+		return file2.size();
+	}
+
+	/**
+	 * @brief  read both files.  collective.  records in output2 are the mates of the records in output1, in the same order.
+	 * @param output1 		file_data object for R1.  valid range is in R1 file coordinates
+	 * @param output2 		file_data object for R2.  valid range is in R2 file coordinates
+	 */
+	void read_file(::bliss::io::file_data & output1, ::bliss::io::file_data & output2) {
+
+		// R1 determines the partitions.
+		file1.read_file(output1);
+
+		// R2 is first partitioned independently.
+		::bliss::io::file_data block2;
+		file2.read_file(block2);
+
+		// count records.  record ids are global via exscan.
+		size_t count1 = get_record_offsets(output1).size() - 1;
+		std::vector<size_t> offsets2 = get_record_offsets(block2);
+		size_t count2 = offsets2.size() - 1;
+
+		size_t first1 = ::mxx::exscan(count1, std::plus<size_t>(), comm);
+		size_t first2 = ::mxx::exscan(count2, std::plus<size_t>(), comm);
+		if (comm.rank() == 0) {
+			first1 = 0;
+			first2 = 0;
+		}
+
+		size_t total1 = ::mxx::allreduce(count1, comm);
+		size_t total2 = ::mxx::allreduce(count2, comm);
+		if (total1 != total2) {
+			std::stringstream ss;
+			ss << "ERROR: paired_fastq_file: R1 has " << total1 << " records but R2 has " << total2 << " records.";
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		// R1 record id ranges for all processes.
+		std::vector<size_t> firsts = ::mxx::allgather(first1, comm);
+
+		// end of the last R2 record.
+		size_t end2 = ::mxx::allreduce(block2.valid_range_bytes.end, [](size_t const & x, size_t const & y) {
+			return (x < y) ? y : x;
+		}, comm);
+
+		// R2 byte offset of the first record of each R1 partition, from the process that holds that record.
+		std::vector<size_t> bounds(comm.size(), ::std::numeric_limits<size_t>::max());
+		for (int i = 0; i < comm.size(); ++i) {
+			if ((firsts[i] >= first2) && (firsts[i] < first2 + count2)) bounds[i] = offsets2[firsts[i] - first2];
+		}
+		bounds = ::mxx::allreduce(bounds, [](size_t const & x, size_t const & y) {
+			return (x < y) ? x : y;
+		}, comm);
+		for (int i = 0; i < comm.size(); ++i) {
+			if (bounds[i] == ::std::numeric_limits<size_t>::max()) bounds[i] = end2;   // partition has no records.
+		}
+		bounds.push_back(end2);
+
+		// this process's R2 range.  reuse the part of it that is in memory, read the rest from the file.
+		range_type target(bounds[comm.rank()], bounds[comm.rank() + 1]);
+		range_type in_mem = range_type::intersect(target, block2.in_mem_range_bytes);
+		if (in_mem.size() == 0) in_mem = range_type(target.end, target.end);
+
+		output2.data.clear();
+		output2.data.reserve(target.size());
+		if (target.size() > in_mem.size()) {
+			FileReader reader(filename2, file2.size(), 0);
+			typename ::bliss::io::file_data::container fringe;
+
+			if (in_mem.start > target.start) {
+				reader.read_range(fringe, range_type(target.start, in_mem.start));
+				output2.data.insert(output2.data.end(), fringe.begin(), fringe.end());
+			}
+			output2.data.insert(output2.data.end(),
+					block2.data.begin() + (in_mem.start - block2.in_mem_range_bytes.start),
+					block2.data.begin() + (in_mem.end - block2.in_mem_range_bytes.start));
+			if (target.end > in_mem.end) {
+				reader.read_range(fringe, range_type(in_mem.end, target.end));
+				output2.data.insert(output2.data.end(), fringe.begin(), fringe.end());
+			}
+		} else {
+			output2.data.assign(block2.data.begin() + (in_mem.start - block2.in_mem_range_bytes.start),
+					block2.data.begin() + (in_mem.end - block2.in_mem_range_bytes.start));
+		}
+
+		output2.in_mem_range_bytes = target;
+		output2.valid_range_bytes = target;
+		output2.parent_range_bytes = block2.parent_range_bytes;
+	}
+
+	/**
+	 * @brief  read both files.  collective.
+	 * @return pair of file_data objects for R1 and R2.
+	 */
+	::std::pair<::bliss::io::file_data, ::bliss::io::file_data> read_file() {
+		::std::pair<::bliss::io::file_data, ::bliss::io::file_data> output;
+		read_file(output.first, output.second);
+		return output;
+	}
+
+};
+
+
+} // parallel
+
+} // io
+
+} // bliss
+
+#endif  // USE_MPI
+
+#endif /* PAIRED_FASTQ_FILE_HPP_ */
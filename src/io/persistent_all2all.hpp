@@ -0,0 +1,266 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    persistent_all2all.hpp
+ * @ingroup
+ * @brief   persistent collectives for all2allv calls repeated on the same communicator.
+ * @details iterative algorithms (pointer jumping in the de bruijn compaction, repeated query rounds) exchange counts with
+ *          all2all and then data with all2allv many times, and pay the collective setup every call.  persistent_exchange
+ *          keeps an MPI_Alltoall_init request for the counts, which have the same size every call, and MPI_Alltoallv_init
+ *          requests for the last few data exchange patterns (buffers and counts), so that a repeated pattern is only
+ *          MPI_Start and MPI_Wait.
+ *
+ *          the count exchange also carries, from each rank, which cached patterns its send buffer, send counts and
+ *          receive buffer still match.  the receive counts of a rank only change if a sender's counts do, so all ranks
+ *          agree on the cached pattern to start, or on none, without another collective.  a new pattern is sent with
+ *          all2allv the first time, and gets a persistent request when it is seen again.
+ *
+ *          uses MPI 4 MPI_Alltoall_init, or the MPIX_ versions of the Open MPI pcollreq extension.  without either,
+ *          it is all2all and all2allv.  elements are sent as bytes, so V has to be trivially copyable.
+ */
+#ifndef SRC_IO_PERSISTENT_ALL2ALL_HPP_
+#define SRC_IO_PERSISTENT_ALL2ALL_HPP_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <numeric>   // accumulate
+
+#include <mpi.h>
+#if defined(OPEN_MPI) && OPEN_MPI
+#include <mpi-ext.h>
+#endif
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 4)
+#define IMXX_ALLTOALL_INIT MPI_Alltoall_init
+#define IMXX_ALLTOALLV_INIT MPI_Alltoallv_init
+#elif defined(OMPI_HAVE_MPI_EXT_PCOLLREQ) && OMPI_HAVE_MPI_EXT_PCOLLREQ
+#define IMXX_ALLTOALL_INIT MPIX_Alltoall_init
+#define IMXX_ALLTOALLV_INIT MPIX_Alltoallv_init
+#endif
+
+namespace imxx
+{
+
+  /**
+   * @brief counts and data exchange with persistent collective requests.  1 per communicator and call site.
+   * @details  the constructor and all2allv are collective.  the buffers of a cached pattern are used by its request,
+   *        so they should not be freed while the exchange object lives, only reused.
+   */
+  class persistent_exchange {
+    protected:
+      /// a data exchange pattern, and its request once it has been seen twice.
+      struct pattern {
+          void const * send;
+          void * recv;
+          size_t elem_bytes;
+          ::std::vector<size_t> send_counts;
+          size_t recv_total;
+          size_t last_used;
+
+          // persistent request, and the arrays it refers to.
+          MPI_Request req;
+          MPI_Datatype dt;
+          ::std::vector<int> sc, sd, rc, rd;
+          /// counts too large for int.  always all2allv.
+          bool dense;
+
+          pattern() : send(nullptr), recv(nullptr), elem_bytes(0), recv_total(0), last_used(0),
+              req(MPI_REQUEST_NULL), dt(MPI_DATATYPE_NULL), dense(false) {}
+
+          void release() {
+            if (req != MPI_REQUEST_NULL) MPI_Request_free(&req);
+            if (dt != MPI_DATATYPE_NULL) MPI_Type_free(&dt);
+          }
+      };
+
+      ::mxx::comm const & comm;
+      ::std::vector<pattern> patterns;
+
+      // count exchange.  per rank:  count, and mask of the cached patterns that still match on the sender.
+      ::std::vector<size_t> count_send;
+      ::std::vector<size_t> count_recv;
+      MPI_Request count_req;
+
+      size_t calls;
+      size_t inits;
+      size_t starts;
+
+      /// mask of the patterns that this rank's side of the exchange matches.
+      template <typename SIZE>
+      size_t local_matches(void const * send, ::std::vector<SIZE> const & send_counts, void * recv, size_t const & recv_capacity,
+                           size_t const & elem_bytes) const {
+        size_t mask = 0;
+        for (size_t e = 0; e < patterns.size(); ++e) {
+          pattern const & pt = patterns[e];
+          if ((pt.last_used == 0) || (pt.send != send) || (pt.recv != recv) || (pt.elem_bytes != elem_bytes) ||
+              (recv_capacity < pt.recv_total)) continue;
+          if (!::std::equal(send_counts.begin(), send_counts.end(), pt.send_counts.begin())) continue;
+          mask |= (1UL << e);
+        }
+        return mask;
+      }
+
+      /// create the persistent request of a pattern.  collective.
+      void init(pattern & pt, ::std::vector<size_t> const & recv_counts) {
+        int p = comm.size();
+        size_t const limit = ::std::numeric_limits<int>::max();
+        size_t send_total = ::std::accumulate(pt.send_counts.begin(), pt.send_counts.end(), static_cast<size_t>(0));
+        int too_large = ((send_total > limit) || (pt.recv_total > limit)) ? 1 : 0;
+        pt.dense = (::mxx::allreduce(too_large, ::mxx::max<int>(), comm) > 0);
+        if (pt.dense) return;
+
+        pt.sc.resize(p);  pt.sd.resize(p);  pt.rc.resize(p);  pt.rd.resize(p);
+        int so = 0, ro = 0;
+        for (int i = 0; i < p; ++i) {
+          pt.sc[i] = static_cast<int>(pt.send_counts[i]);  pt.sd[i] = so;  so += pt.sc[i];
+          pt.rc[i] = static_cast<int>(recv_counts[i]);     pt.rd[i] = ro;  ro += pt.rc[i];
+        }
+        MPI_Type_contiguous(static_cast<int>(pt.elem_bytes), MPI_BYTE, &(pt.dt));
+        MPI_Type_commit(&(pt.dt));
+#if defined(IMXX_ALLTOALLV_INIT)
+        IMXX_ALLTOALLV_INIT(pt.send, pt.sc.data(), pt.sd.data(), pt.dt, pt.recv, pt.rc.data(), pt.rd.data(), pt.dt,
+                            comm, MPI_INFO_NULL, &(pt.req));
+#endif
+        ++inits;
+      }
+
+    public:
+      /// true if persistent collectives are available.  otherwise all2allv is all2all and mxx::all2allv.
+      static constexpr bool available() {
+#if defined(IMXX_ALLTOALLV_INIT)
+        return true;
+#else
+        return false;
+#endif
+      }
+
+      /**
+       * @param _comm           communicator.  kept by reference.
+       * @param cached_patterns number of data exchange patterns with requests, at most 64.  e.g. 4 for a distribute
+       *                        and undistribute whose buffers are swapped every round.
+       */
+      persistent_exchange(::mxx::comm const & _comm, size_t const & cached_patterns = 4) :
+        comm(_comm), patterns(::std::min(::std::max(cached_patterns, static_cast<size_t>(1)), static_cast<size_t>(64))),
+        count_send(2 * _comm.size(), 0), count_recv(2 * _comm.size(), 0), count_req(MPI_REQUEST_NULL),
+        calls(0), inits(0), starts(0) {
+#if defined(IMXX_ALLTOALL_INIT)
+        IMXX_ALLTOALL_INIT(count_send.data(), 2 * sizeof(size_t), MPI_BYTE, count_recv.data(), 2 * sizeof(size_t), MPI_BYTE,
+                           comm, MPI_INFO_NULL, &count_req);
+#endif
+      }
+
+      persistent_exchange(persistent_exchange const & other) = delete;
+      persistent_exchange & operator=(persistent_exchange const & other) = delete;
+
+      ~persistent_exchange() {
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (finalized) return;
+        for (auto & pt : patterns) pt.release();
+        if (count_req != MPI_REQUEST_NULL) MPI_Request_free(&count_req);
+      }
+
+      /// number of persistent data requests created.
+      size_t get_inits() const { return inits; }
+      /// number of data exchanges done by starting a persistent request.
+      size_t get_starts() const { return starts; }
+
+      /**
+       * @brief  all2allv of input, grouped by destination rank.  collective.
+       * @param output       resized to the received elements, grouped by source rank.
+       * @param recv_counts  resized to p.
+       */
+      template <typename V, typename SIZE>
+      void all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                    ::std::vector<V> & output, ::std::vector<SIZE> & recv_counts) {
+        int p = comm.size();
+        recv_counts.resize(p);
+
+        if (!available()) {
+          ::mxx::all2all(send_counts.data(), 1, recv_counts.data(), comm);
+          size_t total = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+          if (output.capacity() < total) output.clear();
+          output.resize(total);
+          ::mxx::all2allv(input, send_counts, output.data(), recv_counts, comm);
+          return;
+        }
+
+        ++calls;
+
+        // counts, and the patterns matched on each rank.
+        size_t mask = local_matches(input, send_counts, output.data(), output.capacity(), sizeof(V));
+        for (int i = 0; i < p; ++i) {
+          count_send[2 * i] = send_counts[i];
+          count_send[2 * i + 1] = mask;
+        }
+        MPI_Start(&count_req);
+        MPI_Wait(&count_req, MPI_STATUS_IGNORE);
+
+        ::std::vector<size_t> counts(p);
+        for (int i = 0; i < p; ++i) {
+          counts[i] = count_recv[2 * i];
+          mask &= count_recv[2 * i + 1];
+          recv_counts[i] = counts[i];
+        }
+        size_t total = ::std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
+
+        // all ranks have the same mask, and pick the same pattern.
+        size_t e = 0;
+        if (mask != 0) {
+          while ((mask & (1UL << e)) == 0) ++e;
+        } else {
+          // new pattern, in place of the least recently used.
+          for (size_t i = 1; i < patterns.size(); ++i)
+            if (patterns[i].last_used < patterns[e].last_used) e = i;
+          patterns[e].release();
+          patterns[e] = pattern();
+        }
+        pattern & pt = patterns[e];
+        bool seen = (pt.last_used > 0);
+        pt.last_used = calls;
+
+        if (output.capacity() < total) output.clear();
+        output.resize(total);
+
+        if (!seen) {
+          pt.send = input;
+          pt.recv = output.data();
+          pt.elem_bytes = sizeof(V);
+          pt.send_counts.assign(send_counts.begin(), send_counts.end());
+          pt.recv_total = total;
+        } else if ((pt.req == MPI_REQUEST_NULL) && !pt.dense) {
+          init(pt, counts);
+        }
+
+        if (pt.req == MPI_REQUEST_NULL) {
+          ::mxx::all2allv(input, send_counts, output.data(), recv_counts, comm);
+        } else {
+          MPI_Start(&(pt.req));
+          MPI_Wait(&(pt.req), MPI_STATUS_IGNORE);
+          ++starts;
+        }
+      }
+  };
+
+} // namespace imxx
+
+#endif /* SRC_IO_PERSISTENT_ALL2ALL_HPP_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    rma_transport.hpp
+ * @ingroup
+ * @brief   transport of the imxx all2allv exchanges:  MPI collectives by default, or one sided puts into registered windows.
+ * @details all exchanges of distribute, undistribute and scatter_compute_gather that are not point to point go through
+ *          payload_all2allv.  with the rma transport installed for a communicator, the byte transport payloads are
+ *          written with MPI_Put directly into a receive window of each destination, then copied out of the window.
+ *          the window is allocated with MPI_Win_allocate, so the MPI library registers it with the NIC once, and it
+ *          is kept and reused by all later exchanges on the communicator.  it grows by doubling, when a rank receives
+ *          more than fits.  on InfiniBand this maps to RDMA writes (through UCX with Open MPI and MPICH), without the
+ *          per call registration or rendezvous handshakes of a large MPI_Alltoallv.
+ *
+ *          an exchange is:  1 all2all of the receive offsets, so each sender knows where to write, 2 fences, and the
+ *          puts in the order of the installed pairwise schedule (see comm_schedule.hpp).  the part to self is copied
+ *          directly.  so it pays for irregular exchanges with many small or empty messages, e.g. of k-mer queries,
+ *          less so for large balanced ones.
+ *
+ *          installed per communicator, like the pairwise schedules:  rma_transport::instance().install(comm) and
+ *          remove(comm) are collective, and have to be called on all ranks.  remove before MPI_Finalize, since the
+ *          windows are MPI objects.  payloads that are not byte transport keep the mxx datatype path.
+ */
+#ifndef SRC_IO_RMA_TRANSPORT_HPP_
+#define SRC_IO_RMA_TRANSPORT_HPP_
+
+#include <vector>
+#include <map>
+#include <memory>     // shared_ptr
+#include <algorithm>
+#include <cstring>    // memcpy
+#include <cstdint>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "io/comm_schedule.hpp"
+
+namespace imxx
+{
+
+  /// receive window of a communicator, allocated and registered by MPI.  constructor, reserve and the destructor are collective.
+  class rma_window {
+    protected:
+      MPI_Comm comm;
+      MPI_Win win;
+      void * base;
+      size_t capacity;
+
+      void allocate(size_t const & bytes) {
+        capacity = bytes;
+        MPI_Win_allocate(static_cast<MPI_Aint>(::std::max(bytes, static_cast<size_t>(1))), 1, MPI_INFO_NULL, comm, &base, &win);
+      }
+
+    public:
+      rma_window(::mxx::comm const & _comm, size_t const & bytes = (1UL << 20)) :
+        comm(static_cast<MPI_Comm>(_comm)), win(MPI_WIN_NULL), base(nullptr), capacity(0) {
+        allocate(bytes);
+      }
+
+      ~rma_window() {
+        if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+      }
+
+      rma_window(rma_window const &) = delete;
+      rma_window & operator=(rma_window const &) = delete;
+
+      /// make room for bytes on this rank.  collective, since the window is reallocated on all ranks if any rank grows.
+      void reserve(size_t const & bytes, ::mxx::comm const & _comm) {
+        bool grow = bytes > capacity;
+        if (!::mxx::any_of(grow, _comm)) return;
+
+        size_t next = grow ? ::std::max(bytes, 2 * capacity) : capacity;
+        MPI_Win_free(&win);
+        allocate(next);
+      }
+
+      MPI_Win handle() const { return win; }
+      uint8_t const * data() const { return reinterpret_cast<uint8_t const *>(base); }
+      size_t size() const { return capacity; }
+  };
+
+
+  /// the communicators with the rma transport installed.  the same on all ranks.
+  class rma_transport {
+    protected:
+      ::std::map<MPI_Comm, ::std::shared_ptr<rma_window> > windows;
+
+    public:
+      static rma_transport & instance() {
+        static rma_transport t;
+        return t;
+      }
+
+      /// use the rma transport for comm.  collective.
+      void install(::mxx::comm const & comm, size_t const & initial_bytes = (1UL << 20)) {
+        if (installed(comm)) return;
+        windows[static_cast<MPI_Comm>(comm)] = ::std::make_shared<rma_window>(comm, initial_bytes);
+      }
+
+      /// back to the MPI collectives for comm, and free its window.  collective.
+      void remove(::mxx::comm const & comm) { windows.erase(static_cast<MPI_Comm>(comm)); }
+
+      bool installed(::mxx::comm const & comm) const {
+        return windows.find(static_cast<MPI_Comm>(comm)) != windows.end();
+      }
+
+      /// window of comm, null if not installed.
+      rma_window * window(::mxx::comm const & comm) const {
+        auto it = windows.find(static_cast<MPI_Comm>(comm));
+        return (it == windows.end()) ? nullptr : it->second.get();
+      }
+  };
+
+
+  /**
+   * @brief  all2allv of raw bytes by MPI_Put into the receive window of each rank.  collective.
+   * @details  same arguments as mxx::all2allv.  V has to be a byte transport payload.
+   */
+  template <typename V, typename SIZE>
+  void rma_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                    V * output, ::std::vector<SIZE> const & recv_counts,
+                    rma_window & window, ::mxx::comm const & comm) {
+    int const p = comm.size();
+    int const rank = comm.rank();
+
+    // where each source writes in this rank's window, then where this rank writes in each destination's window.
+    ::std::vector<uint64_t> recv_offsets(p), put_offsets(p);
+    ::std::vector<size_t> send_offsets(p);
+    size_t recv_bytes = 0, send_bytes = 0;
+    for (int i = 0; i < p; ++i) {
+      recv_offsets[i] = recv_bytes;
+      recv_bytes += static_cast<size_t>(recv_counts[i]) * sizeof(V);
+      send_offsets[i] = send_bytes;
+      send_bytes += static_cast<size_t>(send_counts[i]) * sizeof(V);
+    }
+    ::mxx::all2all(recv_offsets.data(), 1, put_offsets.data(), comm);
+
+    window.reserve(recv_bytes, comm);
+
+    uint8_t const * in = reinterpret_cast<uint8_t const *>(input);
+    size_t const max_put = (1UL << 30);
+    pairwise_schedule const sched = comm_scheduler::instance().get(comm);
+
+    MPI_Win_fence(MPI_MODE_NOPRECEDE, window.handle());
+    for (int i = 1; i < p; ++i) {
+      int dst = sched.dst(i);
+      size_t bytes = static_cast<size_t>(send_counts[dst]) * sizeof(V);
+      for (size_t off = 0; off < bytes; off += max_put) {
+        int len = static_cast<int>(::std::min(max_put, bytes - off));
+        MPI_Put(const_cast<uint8_t *>(in + send_offsets[dst] + off), len, MPI_BYTE, dst,
+                static_cast<MPI_Aint>(put_offsets[dst] + off), len, MPI_BYTE, window.handle());
+      }
+    }
+    // own part, not through the window.
+    uint8_t * out = reinterpret_cast<uint8_t *>(output);
+    if (send_counts[rank] > 0)
+      ::std::memcpy(out + recv_offsets[rank], in + send_offsets[rank], static_cast<size_t>(send_counts[rank]) * sizeof(V));
+    MPI_Win_fence(MPI_MODE_NOSUCCEED, window.handle());
+
+    for (int i = 0; i < p; ++i) {
+      if ((i == rank) || (recv_counts[i] == 0)) continue;
+      ::std::memcpy(out + recv_offsets[i], window.data() + recv_offsets[i], static_cast<size_t>(recv_counts[i]) * sizeof(V));
+    }
+  }
+
+} // namespace imxx
+
+#endif /* SRC_IO_RMA_TRANSPORT_HPP_ */
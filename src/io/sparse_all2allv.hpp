@@ -0,0 +1,186 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    sparse_all2allv.hpp
+ * @ingroup
+ * @brief   sparse dynamic exchange (NBX) for all2allv calls where each rank sends to only a few ranks.
+ * @details the dense exchange is an all2all of the counts followed by all2allv, O(p) per rank even when a rank
+ *          sends to 2 others.  NBX (Hoefler et al., "Scalable communication protocols for dynamic sparse data
+ *          exchange") does not exchange counts:  a rank sends each non-empty message with MPI_Issend, receives
+ *          whatever arrives via MPI_Iprobe, and enters an MPI_Ibarrier once all its sends are matched.  when the
+ *          barrier completes, every message has been received.  the cost is O(messages + log p).
+ *
+ *          the decision is collective, 1 allreduce:  NBX is used when the largest number of destinations of any
+ *          rank is at most max_density * p, and p is at least min_ranks.  results (output and recv_counts) are
+ *          laid out by source rank, the same as for all2allv.
+ *
+ *          messages are sent as bytes, so V has to be trivially copyable, as for the other raw copies in imxx.
+ */
+#ifndef SRC_IO_SPARSE_ALL2ALLV_HPP_
+#define SRC_IO_SPARSE_ALL2ALLV_HPP_
+
+#include <vector>
+#include <map>
+#include <limits>
+#include <algorithm>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace imxx
+{
+
+  /// settings of the sparse exchange, per process.  should be the same on all ranks.
+  class sparse_exchange {
+    protected:
+      bool on;
+      double max_density;
+      int min_ranks;
+      /// number of exchanges per communicator, to alternate the tags of consecutive calls.
+      std::map<MPI_Comm, unsigned int> calls;
+
+    public:
+      /// tags used by NBX.  consecutive calls on a communicator alternate between the 2.
+      static constexpr int tag = 0x5AB0;
+
+      sparse_exchange() : on(true), max_density(0.125), min_ranks(64) {}
+
+      static sparse_exchange & instance() {
+        static sparse_exchange settings;
+        return settings;
+      }
+
+      void enable(bool const & e = true) { on = e; }
+      bool enabled() const { return on; }
+
+      /// largest fraction of the ranks that any rank may send to, for NBX to be used.
+      void set_max_density(double const & d) { max_density = d; }
+      double get_max_density() const { return max_density; }
+
+      /// smallest communicator for NBX.  on small communicators the dense all2all is as fast.
+      void set_min_ranks(int const & p) { min_ranks = p; }
+      int get_min_ranks() const { return min_ranks; }
+
+      /**
+       * @brief  whether to use NBX for these send counts.  collective, but only if p >= min_ranks.
+       */
+      template <typename SIZE>
+      bool use(std::vector<SIZE> const & send_counts, size_t const & elem_bytes, ::mxx::comm const & comm) const {
+        if (!on || (comm.size() < min_ranks) || (comm.size() < 2)) return false;
+
+        // destinations, or p + 1 if a message is too large for an int byte count.
+        int dests = 0;
+        int const limit = ::std::numeric_limits<int>::max();
+        for (size_t i = 0; i < send_counts.size(); ++i) {
+          if (send_counts[i] == 0) continue;
+          if (static_cast<size_t>(send_counts[i]) * elem_bytes > static_cast<size_t>(limit)) {
+            dests = comm.size() + 1;
+            break;
+          }
+          ++dests;
+        }
+        dests = ::mxx::allreduce(dests, ::mxx::max<int>(), comm);
+        return static_cast<double>(dests) <= max_density * static_cast<double>(comm.size());
+      }
+
+      /// tag of the next exchange on comm.
+      int next_tag(::mxx::comm const & comm) {
+        return tag + static_cast<int>((calls[static_cast<MPI_Comm>(comm)]++) & 1);
+      }
+  };
+
+
+  /**
+   * @brief  all2allv by NBX.  collective.
+   * @param input         send buffer, grouped by destination rank as for all2allv.
+   * @param send_counts   elements for each rank.
+   * @param output        resized to the received elements, grouped by source rank.
+   * @param recv_counts   resized to p, elements from each rank.
+   */
+  template <typename V, typename SIZE1, typename SIZE2>
+  void sparse_all2allv(V const * input, ::std::vector<SIZE1> const & send_counts,
+                       ::std::vector<V> & output, ::std::vector<SIZE2> & recv_counts,
+                       ::mxx::comm const & comm) {
+    int const p = comm.size();
+    int const rank = comm.rank();
+    int const tag = sparse_exchange::instance().next_tag(comm);
+
+    recv_counts.assign(p, 0);
+
+    // send all non-empty messages to other ranks.  synchronous:  complete only once matched by a receive.
+    ::std::vector<size_t> send_displs(p, 0);
+    for (int i = 1; i < p; ++i) send_displs[i] = send_displs[i - 1] + send_counts[i - 1];
+
+    ::std::vector<MPI_Request> sends;
+    for (int i = 1; i < p; ++i) {
+      int dst = (rank + i) % p;
+      if (send_counts[dst] == 0) continue;
+      sends.emplace_back(MPI_REQUEST_NULL);
+      MPI_Issend(const_cast<V *>(input + send_displs[dst]), static_cast<int>(send_counts[dst] * sizeof(V)), MPI_BYTE,
+                 dst, tag, comm, &(sends.back()));
+    }
+
+    // receive until the barrier completes.
+    ::std::vector<::std::vector<V> > received(p);
+    MPI_Request barrier = MPI_REQUEST_NULL;
+    bool barrier_active = false;
+    int flag;
+    MPI_Status status;
+    while (true) {
+      MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &flag, &status);
+      if (flag) {
+        int bytes;
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+        int src = status.MPI_SOURCE;
+        received[src].resize(bytes / sizeof(V));
+        MPI_Recv(received[src].data(), bytes, MPI_BYTE, src, tag, comm, MPI_STATUS_IGNORE);
+        recv_counts[src] = received[src].size();
+      }
+
+      if (barrier_active) {
+        MPI_Test(&barrier, &flag, MPI_STATUS_IGNORE);
+        if (flag) break;
+      } else {
+        MPI_Testall(sends.size(), sends.data(), &flag, MPI_STATUSES_IGNORE);
+        if (flag) {
+          MPI_Ibarrier(comm, &barrier);
+          barrier_active = true;
+        }
+      }
+    }
+
+    // lay out by source rank.
+    recv_counts[rank] = send_counts[rank];
+    size_t total = 0;
+    for (int i = 0; i < p; ++i) total += recv_counts[i];
+    if (output.capacity() < total) output.clear();
+    output.resize(total);
+
+    V * out = output.data();
+    for (int i = 0; i < p; ++i) {
+      if (i == rank) {
+        ::std::copy(input + send_displs[i], input + send_displs[i] + send_counts[i], out);
+      } else {
+        ::std::copy(received[i].begin(), received[i].end(), out);
+      }
+      out += recv_counts[i];
+    }
+  }
+
+} // namespace imxx
+
+#endif /* SRC_IO_SPARSE_ALL2ALLV_HPP_ */
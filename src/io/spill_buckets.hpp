@@ -0,0 +1,185 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * spill_buckets.hpp
+ *
+ * @brief  bucketed spill files on local disk, for building an index larger than memory.
+ * @details  elements are appended to 1 of nbuckets files, each with a small memory buffer that is written out when full.
+ *    a bucket is later read back in full, e.g. to insert it into a map, and removed.  the files are raw binary copies
+ *    of the elements, so V has to hold no pointers, and they are read by the process that wrote them.
+ *
+ *    the files are named <dir>/bliss_spill.<pid>.<tag>.<bucket>, and are removed by the destructor.  dir should be
+ *    node local, e.g. an NVMe scratch, not a shared file system.
+ */
+
+#ifndef SPILL_BUCKETS_HPP_
+#define SPILL_BUCKETS_HPP_
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>   // strerror
+#include <string>
+#include <sstream>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+
+#include <unistd.h>  // getpid
+
+#include "io/io_exception.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief a set of append only spill files, 1 per bucket.
+     * @tparam V   element type, copied as raw bytes, e.g. Kmer or std::pair of Kmer and a plain value.
+     */
+    template <typename V>
+    class spill_buckets {
+        static_assert(::std::is_trivially_destructible<V>::value, "spill_buckets elements are copied as raw bytes.");
+
+      protected:
+        ::std::vector<::std::string> names;
+        ::std::vector<FILE *> files;
+        ::std::vector<::std::vector<V> > buffers;
+        /// elements per bucket, including the buffered ones.
+        ::std::vector<size_t> counts;
+        size_t buffer_size;
+
+        static void throw_error(::std::string const & action, ::std::string const & name) {
+          ::std::stringstream ss;
+          int myerr = errno;
+          ss << "ERROR " << action << " spill file " << name << ": " << myerr << ": " << strerror(myerr);
+          throw ::bliss::io::IOException(ss.str());
+        }
+
+        /// write n elements to the file of bucket b.  the file is created on the first write.
+        void write(size_t const & b, V const * data, size_t const & n) {
+          if (n == 0) return;
+          if (files[b] == nullptr) {
+            files[b] = fopen(names[b].c_str(), "w+b");
+            if (files[b] == nullptr) throw_error("creating", names[b]);
+          }
+          if (fwrite(data, sizeof(V), n, files[b]) != n)
+            throw_error("writing", names[b]);
+        }
+
+        /// write out the buffer of bucket b.
+        void write(size_t const & b) {
+          write(b, buffers[b].data(), buffers[b].size());
+          buffers[b].clear();
+        }
+
+        void close(size_t const & b) {
+          if (files[b] == nullptr) return;
+          fclose(files[b]);
+          files[b] = nullptr;
+          ::std::remove(names[b].c_str());
+        }
+
+      public:
+        /**
+         * @param dir           directory for the files.
+         * @param nbuckets      number of buckets (files).
+         * @param _buffer_size  elements buffered in memory per bucket.
+         * @param tag           distinguishes the files of processes sharing dir, e.g. the rank.
+         */
+        spill_buckets(::std::string const & dir, size_t const & nbuckets, size_t const & _buffer_size, int const & tag) :
+          files(nbuckets, nullptr), buffers(nbuckets), counts(nbuckets, 0),
+          buffer_size(::std::max(_buffer_size, static_cast<size_t>(1))) {
+          names.reserve(nbuckets);
+          for (size_t b = 0; b < nbuckets; ++b) {
+            ::std::stringstream ss;
+            ss << dir << "/bliss_spill." << getpid() << "." << tag << "." << b;
+            names.emplace_back(ss.str());
+          }
+        }
+
+        spill_buckets(spill_buckets const & other) = delete;
+        spill_buckets & operator=(spill_buckets const & other) = delete;
+
+        ~spill_buckets() {
+          for (size_t b = 0; b < files.size(); ++b) close(b);
+        }
+
+        size_t bucket_count() const {
+          return files.size();
+        }
+
+        /// elements in bucket b.
+        size_t size(size_t const & b) const {
+          return counts[b];
+        }
+        ::std::vector<size_t> const & sizes() const {
+          return counts;
+        }
+
+        /// append x to bucket b.
+        void push_back(size_t const & b, V const & x) {
+          buffers[b].emplace_back(x);
+          ++counts[b];
+          if (buffers[b].size() >= buffer_size) write(b);
+        }
+
+        /// append the n elements at first to bucket b.
+        void append(size_t const & b, V const * first, size_t const & n) {
+          if (buffers[b].size() + n >= buffer_size) {  // keep the order:  buffer first.
+            write(b);
+            write(b, first, n);
+          } else {
+            buffers[b].insert(buffers[b].end(), first, first + n);
+          }
+          counts[b] += n;
+        }
+
+        /// append each element of input to bucket bucket_of(element).
+        template <typename BucketOf>
+        void append(::std::vector<V> const & input, BucketOf const & bucket_of) {
+          for (auto const & x : input) push_back(bucket_of(x), x);
+        }
+
+        /// write out all buffers.
+        void flush() {
+          for (size_t b = 0; b < files.size(); ++b) write(b);
+        }
+
+        /// append the content of bucket b to output, then remove the bucket's file.
+        void read(size_t const & b, ::std::vector<V> & output) {
+          size_t before = output.size();
+          output.resize(before + counts[b]);
+
+          size_t on_disk = counts[b] - buffers[b].size();
+          if (on_disk > 0) {
+            if (fseek(files[b], 0, SEEK_SET) != 0) throw_error("seeking", names[b]);
+            if (fread(output.data() + before, sizeof(V), on_disk, files[b]) != on_disk)
+              throw_error("reading", names[b]);
+          }
+          ::std::copy(buffers[b].begin(), buffers[b].end(), output.begin() + before + on_disk);
+
+          ::std::vector<V>().swap(buffers[b]);
+          counts[b] = 0;
+          close(b);
+        }
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* SPILL_BUCKETS_HPP_ */
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * synthetic_reads.hpp
+ *
+ * @brief  in-process parallel generator of FASTQ reads from a seeded synthetic genome, for benchmarks at any scale.
+ * @details  the genome is never materialized:  base i is a hash of (seed, i), so any process can produce any read
+ *    without communication, and with memory independent of the genome size.
+ *
+ *    repeats:  the genome is divided into blocks of repeat_len bases.  a block is, with probability repeat_fraction,
+ *    a copy of 1 of repeat_families repeat sequences, with each base diverged with probability repeat_divergence.
+ *
+ *    reads:  read j starts at a hashed genome position and is reverse complemented with probability 1/2.
+ *    errors are applied in read coordinates:  substitution probability ramps linearly from sub_start at the
+ *    first base to sub_end at the last (as in Illumina reads), insertions and deletions at ins_rate and del_rate,
+ *    and N at n_rate.  qualities are 'I' for correct bases, '#' for substituted or inserted bases, '!' for N.
+ *
+ *    reads depend only on (params, read id), so the data set is the same for any number of processes.
+ *    the reads are produced either into a file_data block per process, partitioned the same way a parallel
+ *    FASTQ reader would partition the file, or into a FASTQ file written collectively with MPI-IO.
+ */
+
+#ifndef SYNTHETIC_READS_HPP_
+#define SYNTHETIC_READS_HPP_
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <random>
+#include <limits>
+#include <algorithm>   // min
+#include <stdexcept>
+#include <cstdint>
+
+#include "io/file.hpp"   // file_data
+#include "io/io_exception.hpp"
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+#endif
+
+
+namespace bliss {
+
+namespace io {
+
+/// parameters of the synthetic genome and reads.
+struct synthetic_read_params {
+    /// read length, before indels.  reads are always this long.
+    size_t read_len;
+    /// mean coverage.  determines the genome size if genome_size is 0.
+    double coverage;
+    /// genome size.  0 to derive from the number of reads, read length and coverage.
+    uint64_t genome_size;
+
+    /// substitution probability at the first and last base of a read.
+    double sub_start;
+    double sub_end;
+    /// insertion and deletion probability per base.
+    double ins_rate;
+    double del_rate;
+    /// probability of N per base.
+    double n_rate;
+
+    /// fraction of the genome in repeat copies
+    double repeat_fraction;
+    /// length of a repeat copy
+    size_t repeat_len;
+    /// number of distinct repeat sequences
+    size_t repeat_families;
+    /// per base divergence of a repeat copy from its family sequence
+    double repeat_divergence;
+
+    /// produce reads from both strands
+    bool both_strands;
+
+    uint64_t seed;
+
+    synthetic_read_params() :
+      read_len(100), coverage(30.0), genome_size(0),
+      sub_start(0.0), sub_end(0.0), ins_rate(0.0), del_rate(0.0), n_rate(0.0),
+      repeat_fraction(0.0), repeat_len(1000), repeat_families(16), repeat_divergence(0.01),
+      both_strands(true), seed(1) {}
+};
+
+
+/**
+ * @brief deterministic synthetic FASTQ reads.  see file description.
+ */
+class synthetic_reads {
+  protected:
+    synthetic_read_params params;
+    uint64_t genome_size;
+
+    /// splitmix64 finalizer.
+    static inline uint64_t mix(uint64_t x) {
+      x += 0x9E3779B97F4A7C15ULL;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+      return x ^ (x >> 31);
+    }
+
+    /// map hash to [0, 1)
+    static inline double to_unit(uint64_t const & h) {
+      return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+  public:
+    /**
+     * @param total_reads   number of reads in the whole data set.  used for the genome size if params.genome_size is 0
+     */
+    synthetic_reads(size_t const & total_reads, synthetic_read_params const & _params) : params(_params) {
+      if ((params.read_len == 0) || ((params.genome_size == 0) && (params.coverage <= 0.0)))
+        throw std::invalid_argument("synthetic_reads: read length and coverage need to be positive.");
+      if (params.repeat_len == 0) params.repeat_len = 1;
+      if (params.repeat_families == 0) params.repeat_families = 1;
+
+      genome_size = (params.genome_size > 0) ? params.genome_size :
+          static_cast<uint64_t>(static_cast<double>(total_reads) * static_cast<double>(params.read_len) / params.coverage);
+      if (genome_size < params.read_len) genome_size = params.read_len;
+    }
+
+    uint64_t get_genome_size() const { return genome_size; }
+
+    synthetic_read_params const & get_params() const { return params; }
+
+    /// genome base at pos, 0..3 for A, C, G, T.
+    inline uint8_t genome_base(uint64_t const & pos) const {
+      if (params.repeat_fraction > 0.0) {
+        uint64_t block = pos / params.repeat_len;
+        uint64_t bh = mix(params.seed ^ mix(block ^ 0x7265706561747321ULL));
+        if (to_unit(bh) < params.repeat_fraction) {
+          uint64_t family = (bh >> 7) % params.repeat_families;
+          uint64_t dh = mix(params.seed ^ mix(pos ^ 0x6469766572676521ULL));
+          if (to_unit(dh) < params.repeat_divergence) return (dh >> 3) & 0x3;
+          return mix(params.seed ^ mix((family << 40) ^ (pos % params.repeat_len) ^ 0x66616d696c792121ULL)) & 0x3;
+        }
+      }
+      return mix(params.seed ^ mix(pos)) & 0x3;
+    }
+
+    /// append read id as a FASTQ record.
+    void append_read(size_t const & id, std::string & out) const {
+      static const char bases[4] = {'A', 'C', 'G', 'T'};
+
+      size_t const L = params.read_len;
+      uint64_t h = mix(params.seed + 0x5bd1e995ULL * (id + 1));
+      uint64_t start = h % genome_size;
+      bool rc = params.both_strands && ((h >> 63) != 0);
+
+      std::mt19937_64 gen(h);
+      std::uniform_real_distribution<double> unif(0.0, 1.0);
+      std::uniform_int_distribution<int> sub(1, 3);
+      std::uniform_int_distribution<int> rnd(0, 3);
+
+      out.append("@r");
+      out.append(std::to_string(id));
+      out.push_back('\n');
+      size_t seq_pos = out.size();
+      out.append(L, 'A');
+      out.append("\n+\n");
+      size_t qual_pos = out.size();
+      out.append(L, 'I');
+      out.push_back('\n');
+
+      // walk the genome, forward from start or backward on the complement strand.  wraps around the ends.
+      uint64_t g = rc ? ((start + genome_size - 1) % genome_size) : start;
+      double ramp = (L > 1) ? (params.sub_end - params.sub_start) / static_cast<double>(L - 1) : 0.0;
+      for (size_t i = 0; i < L; ) {
+        if ((params.del_rate > 0.0) && (unif(gen) < params.del_rate)) {
+          g = (rc ? (g + genome_size - 1) : (g + 1)) % genome_size;
+          continue;
+        }
+        uint8_t b;
+        char q = 'I';
+        if ((params.ins_rate > 0.0) && (unif(gen) < params.ins_rate)) {
+          b = rnd(gen);
+          q = '#';
+        } else {
+          b = genome_base(g);
+          if (rc) b = 3 - b;
+          g = (rc ? (g + genome_size - 1) : (g + 1)) % genome_size;
+          double s = params.sub_start + ramp * static_cast<double>(i);
+          if ((s > 0.0) && (unif(gen) < s)) {
+            b = (b + sub(gen)) & 0x3;
+            q = '#';
+          }
+        }
+        if ((params.n_rate > 0.0) && (unif(gen) < params.n_rate)) {
+          out[seq_pos + i] = 'N';
+          out[qual_pos + i] = '!';
+        } else {
+          out[seq_pos + i] = bases[b];
+          out[qual_pos + i] = q;
+        }
+        ++i;
+      }
+    }
+
+    /// FASTQ records for reads [first, first + count).
+    std::string generate(size_t const & first, size_t const & count) const {
+      std::string out;
+      out.reserve(count * (2 * params.read_len + 16 + std::to_string(first + count).size()));
+      for (size_t i = first; i < first + count; ++i) append_read(i, out);
+      return out;
+    }
+
+    /**
+     * @brief file_data for reads [first, first + count), as block [offset, offset + bytes) of a file of total_bytes.
+     * @details  the valid range is aligned the same way as the parallel FASTQ readers:  it starts at the EOL before
+     *      the first record (except at file start), and ends before the EOL of the last record (except at file end).
+     *      the in memory range covers both EOLs, so the blocks of all processes partition the file.
+     *      use with KmerFileHelper::parse_file_data.
+     * @param data     FASTQ records, from generate(first, count)
+     * @param offset   file offset of data
+     */
+    static ::bliss::io::file_data make_file_data(std::string const & data, size_t const & offset, size_t const & total_bytes) {
+      ::bliss::io::file_data fd;
+      size_t prefix = (offset > 0) ? 1 : 0;
+      fd.data.reserve(data.size() + prefix);
+      if (prefix) fd.data.push_back('\n');   // last byte of the previous block
+      fd.data.insert(fd.data.end(), data.begin(), data.end());
+
+      fd.parent_range_bytes.start = 0;
+      fd.parent_range_bytes.end = total_bytes;
+      fd.in_mem_range_bytes.start = offset - prefix;
+      fd.in_mem_range_bytes.end = offset + data.size();
+      fd.valid_range_bytes.start = offset - prefix;
+      fd.valid_range_bytes.end = ((offset + data.size() < total_bytes) && (data.size() > 0)) ?
+          (offset + data.size() - 1) : (offset + data.size());
+      return fd;
+    }
+
+    /// all reads as 1 file_data, e.g. for a single process.
+    ::bliss::io::file_data generate_file_data(size_t const & total_reads) const {
+      std::string data = generate(0, total_reads);
+      return make_file_data(data, 0, data.size());
+    }
+
+#if defined(USE_MPI)
+    /// block partitioned range of reads of this process.  first and count.
+    static std::pair<size_t, size_t> local_reads(size_t const & total_reads, ::mxx::comm const & comm) {
+      size_t p = comm.size();
+      size_t rank = comm.rank();
+      return std::make_pair((total_reads / p) * rank + std::min(rank, total_reads % p),
+                            total_reads / p + ((rank < (total_reads % p)) ? 1 : 0));
+    }
+
+    /// this process' share of total_reads reads, as a file_data block of the virtual FASTQ file.  collective.
+    ::bliss::io::file_data generate_file_data(size_t const & total_reads, ::mxx::comm const & comm) const {
+      std::pair<size_t, size_t> r = local_reads(total_reads, comm);
+      std::string data = generate(r.first, r.second);
+      size_t bytes = data.size();
+      size_t offset = ::mxx::exscan(bytes, comm);
+      if (comm.rank() == 0) offset = 0;
+      size_t total = ::mxx::allreduce(bytes, comm);
+      return make_file_data(data, offset, total);
+    }
+
+    /**
+     * @brief generate total_reads reads, block partitioned over comm, and write them to 1 FASTQ file.  collective.
+     * @return bytes written by this process.
+     */
+    size_t write_fastq(std::string const & filename, size_t const & total_reads, ::mxx::comm const & comm) const {
+      std::pair<size_t, size_t> r = local_reads(total_reads, comm);
+      std::string data = generate(r.first, r.second);
+      size_t bytes = data.size();
+      size_t offset = ::mxx::exscan(bytes, comm);
+      if (comm.rank() == 0) offset = 0;
+
+      if (comm.rank() == 0) MPI_File_delete(const_cast<char*>(filename.c_str()), MPI_INFO_NULL);  // ok if it does not exist.
+      comm.barrier();
+
+      MPI_File fh;
+      int res = MPI_File_open(comm, const_cast<char*>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                              MPI_INFO_NULL, &fh);
+      if (res != MPI_SUCCESS) throw ::bliss::io::IOException("ERROR: unable to open synthetic read file " + filename);
+
+      size_t written = 0;
+      size_t max_chunk = static_cast<size_t>(std::numeric_limits<int>::max());
+      while (written < bytes) {
+        int chunk = static_cast<int>(std::min(bytes - written, max_chunk));
+        res = MPI_File_write_at(fh, offset + written, const_cast<char*>(data.data() + written), chunk, MPI_BYTE, MPI_STATUS_IGNORE);
+        if (res != MPI_SUCCESS) break;
+        written += chunk;
+      }
+      MPI_File_close(&fh);
+      if (res != MPI_SUCCESS) throw ::bliss::io::IOException("ERROR: unable to write synthetic read file " + filename);
+      comm.barrier();
+
+      return bytes;
+    }
+#endif
+
+};
+
+} // namespace io
+
+} // namespace bliss
+
+#endif /* SYNTHETIC_READS_HPP_ */
@@ -238,6 +238,28 @@ TEST_P(BucketBenchmark, permute)
   }
 }
 
+TEST_P(BucketBenchmark, radix_scatter)
+{
+	this->unbucketed.clear();
+  this->mapping.clear();
+  this->bucketed.clear();
+
+  BucketBenchmarkInfo pp = this->p;
+  int nthreads = imxx::local::get_bucketing_threads();
+
+  // allocate.
+  this->mapping.reserve(this->p.input_size);
+
+  imxx::local::assign_to_buckets(this->data, [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; },
+		  this->p.bucket_count,
+                                 this->bcounts, this->mapping, this->p.first, this->p.last, nthreads);
+
+  if (pp.bucket_count > 0) {
+	  imxx::local::radix_scatter(this->data, this->bcounts, this->mapping, this->bucketed,
+			  this->p.first, this->p.last, nthreads);
+  }
+}
+
 TEST_P(BucketBenchmark, inplace_permute)
 {
 	this->unbucketed.clear();
@@ -0,0 +1,451 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_benchmark_collectives.cpp
+ * @ingroup bliss::io::test
+ * @brief   benchmark of the imxx collectives and their mxx equivalents, on k-mer like payloads.
+ * @details sweeps elements per rank, key skew, and number of ranks.  the keys are 64 bit words drawn from a pool shared by
+ *          all ranks with zipf distributed multiplicity, so that frequent k-mers all hash to the same rank and the
+ *          all2allv receive counts are skewed as with real reads.  skew 0 is uniform over the pool.
+ *
+ *          for each primitive, the ranks are swept over P = 1, 2, 4, ... comm.size() by splitting the communicator.
+ *          each rank times the call (median of ITERS, after a barrier), and rank 0 prints 1 line per rank
+ *            [COLL] primitive  n  skew  P  rank  sec  sent  recv
+ *          and a summary line with min/mean/max time and max/mean imbalance.  with BL_BENCHMARK on, the imxx calls
+ *          additionally print their internal phase breakdown.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/sort.hpp"
+
+#include <cstdint> // for uint64_t, etc.
+#include <cmath>   // pow
+#include <string>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <functional>  // less
+#include <vector>
+
+#include "io/incremental_mxx.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+
+struct CollectiveBenchmarkInfo {
+    size_t input_size;   // elements per rank
+    double skew;         // zipf exponent of the key multiplicity.  0 is uniform.
+
+    CollectiveBenchmarkInfo() = default;
+    CollectiveBenchmarkInfo(size_t const & _input_size, double const & _skew) :
+      input_size(_input_size), skew(_skew) {};
+
+    CollectiveBenchmarkInfo(CollectiveBenchmarkInfo const & other) = default;
+    CollectiveBenchmarkInfo& operator=(CollectiveBenchmarkInfo const & other) = default;
+    CollectiveBenchmarkInfo(CollectiveBenchmarkInfo && other) = default;
+    CollectiveBenchmarkInfo& operator=(CollectiveBenchmarkInfo && other) = default;
+};
+
+
+/// 64 bit finalizer (splitmix64).  makes the pool keys and the rank assignment.
+inline uint64_t mix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+template <typename IIT, typename OIT>
+struct copy {
+    void operator()(IIT begin, IIT end, OIT out) const {
+      for (; begin != end; ++begin, ++out) {
+        *out = *begin;
+      }
+    }
+};
+
+/// variable output version of copy, for scatter_compute_gather_v.  returns the output count.
+template <typename IIT, typename OIT>
+struct copy_v {
+    size_t operator()(IIT begin, IIT end, OIT & out) const {
+      size_t count = 0;
+      for (; begin != end; ++begin, ++out, ++count) {
+        *out = *begin;
+      }
+      return count;
+    }
+};
+
+
+/**
+ * @brief fixture that generates k-mer like keys and sweeps the number of ranks.
+ */
+class CollectiveBenchmark : public ::testing::TestWithParam<CollectiveBenchmarkInfo>
+{
+  protected:
+    CollectiveBenchmark() {};
+    virtual ~CollectiveBenchmark() {};
+
+    using T = uint64_t;
+    using IT = typename std::vector<T>::const_iterator;
+    using OT = typename std::vector<T>::iterator;
+
+    static constexpr int ITERS = 3;
+
+    virtual void SetUp()
+    {
+      p = GetParam();
+
+      // pool of distinct keys, shared by all ranks.  cdf of the zipf multiplicity over the pool.
+      pool_size = std::min(std::max(p.input_size * 4, static_cast<size_t>(1)), static_cast<size_t>(1) << 22);
+      cdf.resize(pool_size);
+      double sum = 0.0;
+      for (size_t i = 0; i < pool_size; ++i) {
+        sum += (p.skew == 0.0) ? 1.0 : 1.0 / std::pow(static_cast<double>(i + 1), p.skew);
+        cdf[i] = sum;
+      }
+      for (size_t i = 0; i < pool_size; ++i) cdf[i] /= sum;
+    }
+
+    void init(mxx::comm const & comm) {
+      std::default_random_engine gen(comm.rank() * 7919 + 17);
+      std::uniform_real_distribution<double> u(0.0, 1.0);
+
+      data.clear();
+      data.reserve(p.input_size);
+      for (size_t i = 0; i < p.input_size; ++i) {
+        size_t idx = std::lower_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin();
+        data.emplace_back(mix64(std::min(idx, pool_size - 1)));
+      }
+    }
+
+    static double median(std::vector<double> v) {
+      std::sort(v.begin(), v.end());
+      return (v.size() % 2 == 1) ? v[v.size() / 2] : 0.5 * (v[v.size() / 2 - 1] + v[v.size() / 2]);
+    }
+
+    /// gather the per rank timings and print on rank 0.
+    void report(std::string const & prim, mxx::comm const & comm, double const & sec, size_t const & sent, size_t const & recv) {
+      std::vector<double> secs = ::mxx::gather(sec, 0, comm);
+      std::vector<size_t> sents = ::mxx::gather(sent, 0, comm);
+      std::vector<size_t> recvs = ::mxx::gather(recv, 0, comm);
+      if (comm.rank() != 0) return;
+
+      std::stringstream output;
+      output << std::fixed;
+      output.precision(6);
+      double mn = secs[0], mx = secs[0], mean = 0.0;
+      size_t rmax = 0, rsum = 0;
+      for (int r = 0; r < comm.size(); ++r) {
+        output << "[COLL] " << prim << "\t" << p.input_size << "\t" << p.skew << "\t" << comm.size() << "\t" << r << "\t" <<
+            secs[r] << "\t" << sents[r] << "\t" << recvs[r] << std::endl;
+        mn = std::min(mn, secs[r]);
+        mx = std::max(mx, secs[r]);
+        mean += secs[r];
+        rmax = std::max(rmax, recvs[r]);
+        rsum += recvs[r];
+      }
+      mean /= static_cast<double>(comm.size());
+      double rmean = static_cast<double>(rsum) / static_cast<double>(comm.size());
+      output << "[COLL] " << prim << "\t" << p.input_size << "\t" << p.skew << "\t" << comm.size() << "\tsummary\t" <<
+          "min=" << mn << " mean=" << mean << " max=" << mx <<
+          " time_imbalance=" << ((mean > 0.0) ? mx / mean : 0.0) <<
+          " recv_imbalance=" << ((rmean > 0.0) ? static_cast<double>(rmax) / rmean : 0.0) << std::endl;
+      fflush(stdout);
+      printf("%s", output.str().c_str());
+      fflush(stdout);
+    }
+
+    /**
+     * @brief run f on P = 1, 2, 4, ... comm.size() ranks.
+     * @param f   f(input, comm, node_aware_comm), returns the number of elements received.  input is a fresh copy of data.
+     */
+    template <typename F>
+    void sweep(std::string const & prim, F const & f) {
+      ::mxx::comm comm;
+
+      for (int P = 1; ; P <<= 1) {
+        int np = std::min(P, comm.size());
+        bool member = comm.rank() < np;
+        ::mxx::comm sub = comm.split(member ? 0 : 1, comm.rank());
+
+        if (member) {
+          this->init(sub);
+          ::imxx::node_aware_comm hc(sub);
+
+          std::vector<double> secs(ITERS);
+          size_t recv = 0;
+          for (int it = 0; it < ITERS; ++it) {
+            std::vector<T> input(data);
+            sub.barrier();
+            double t0 = MPI_Wtime();
+            recv = f(input, sub, hc);
+            secs[it] = MPI_Wtime() - t0;
+          }
+          this->report(prim, sub, median(secs), data.size(), recv);
+        }
+        comm.barrier();
+
+        if (np == comm.size()) break;
+      }
+    }
+
+    /// hashed destination rank, as for the k-mer index.
+    static int to_rank(T const & x, int const & p) {
+      return mix64(x ^ 0x5555555555555555ULL) % p;
+    }
+
+    CollectiveBenchmarkInfo p;
+    size_t pool_size;
+    std::vector<double> cdf;
+
+    // input data
+    std::vector<T> data;
+};
+
+constexpr int CollectiveBenchmark::ITERS;
+
+
+//========= distribute
+
+TEST_P(CollectiveBenchmark, imxx_distribute)
+{
+  this->sweep("imxx::distribute", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> recv_counts, i2o;
+    std::vector<T> out;
+    imxx::distribute(in, [&p](T const & x) { return to_rank(x, p); }, recv_counts, i2o, out, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_distribute_rt)
+{
+  this->sweep("imxx::distribute+undistribute", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> recv_counts, i2o;
+    std::vector<T> out, rt;
+    imxx::distribute(in, [&p](T const & x) { return to_rank(x, p); }, recv_counts, i2o, out, comm, false);
+    imxx::undistribute(out, recv_counts, i2o, rt, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_distribute_2part)
+{
+  this->sweep("imxx::distribute_2part", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> recv_counts, i2o;
+    std::vector<T> out;
+    imxx::distribute_2part(in, [&p](T const & x) { return to_rank(x, p); }, recv_counts, i2o, out, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_distribute_2level)
+{
+  this->sweep("imxx::distribute_2level", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const & hc) {
+    int p = comm.size();
+    imxx::two_level_mapping mapping;
+    std::vector<T> out;
+    imxx::distribute_2level(in, [&p](T const & x) { return to_rank(x, p); }, mapping, out, hc, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_distribute_compressed)
+{
+  this->sweep("imxx::distribute_compressed", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> recv_counts;
+    std::vector<T> out;
+    imxx::distribute_compressed(in, [&p](T const & x) { return to_rank(x, p); }, recv_counts, out, comm);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, mxx_distribute)
+{
+  this->sweep("mxx::all2allv", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    bool sorted = false;
+    std::vector<size_t> send_counts = ::dsc::distribute(in, [&p](T const & x) { return to_rank(x, p); }, sorted, comm);
+    std::vector<T> out = ::mxx::all2allv(in, send_counts, comm);
+    return out.size();
+  });
+}
+
+
+//========= scatter compute gather
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather)
+{
+  this->sweep("imxx::scatter_compute_gather", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather(in, [&p](T const & x) { return to_rank(x, p); }, copy<IT, OT>(),
+                                 i2o, out, inbuf, outbuf, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather_2part)
+{
+  this->sweep("imxx::scatter_compute_gather_2part", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather_2part(in, [&p](T const & x) { return to_rank(x, p); }, copy<IT, OT>(),
+                                 i2o, out, inbuf, outbuf, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather_lowmem)
+{
+  this->sweep("imxx::scatter_compute_gather_lowmem", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather_lowmem(in, [&p](T const & x) { return to_rank(x, p); }, copy<IT, OT>(),
+                                 i2o, out, inbuf, outbuf, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather_adaptive)
+{
+  this->sweep("imxx::scatter_compute_gather_adaptive", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather_adaptive(in, [&p](T const & x) { return to_rank(x, p); }, copy<IT, OT>(),
+                                 i2o, out, inbuf, outbuf, comm);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather_pipelined)
+{
+  this->sweep("imxx::scatter_compute_gather_pipelined", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather_pipelined(in, [&p](T const & x) { return to_rank(x, p); }, copy<IT, OT>(),
+                                 i2o, out, inbuf, outbuf, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_scatter_compute_gather_v)
+{
+  this->sweep("imxx::scatter_compute_gather_v", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    std::vector<size_t> i2o;
+    std::vector<T> out, inbuf, outbuf;
+    imxx::scatter_compute_gather_v(in, [&p](T const & x) { return to_rank(x, p); },
+                                 copy_v<OT, ::fsc::back_emplace_iterator<std::vector<T> > >(),
+                                 i2o, out, inbuf, outbuf, comm, false);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, mxx_scatter_compute_gather)
+{
+  this->sweep("mxx::all2allv_compute_all2allv", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    int p = comm.size();
+    bool sorted = false;
+    std::vector<size_t> send_counts = ::dsc::distribute(in, [&p](T const & x) { return to_rank(x, p); }, sorted, comm);
+    std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+    std::vector<T> query = ::mxx::all2allv(in, send_counts, comm);
+    std::vector<T> answer(query.size());
+    copy<IT, OT>()(query.cbegin(), query.cend(), answer.begin());
+    std::vector<T> out = ::mxx::all2allv(answer, recv_counts, comm);
+    return query.size();
+  });
+}
+
+
+//========= sort
+
+TEST_P(CollectiveBenchmark, imxx_samplesort)
+{
+  this->sweep("imxx::samplesort", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    std::vector<T> out;
+    imxx::samplesort<false>(in, out, std::less<T>(), comm);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, imxx_samplesort_buf)
+{
+  this->sweep("imxx::samplesort_buf", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    std::vector<T> out;
+    imxx::samplesort_buf<false>(in, out, std::less<T>(), comm, 0, 0);
+    return out.size();
+  });
+}
+
+TEST_P(CollectiveBenchmark, mxx_sort)
+{
+  this->sweep("mxx::sort", [](std::vector<T> & in, mxx::comm const & comm, imxx::node_aware_comm const &) {
+    ::mxx::sort(in.begin(), in.end(), std::less<T>(), comm);
+    return in.size();
+  });
+}
+
+
+INSTANTIATE_TEST_CASE_P(Bliss, CollectiveBenchmark, ::testing::Values(
+    // 32KB, 512KB, 8MB per rank, each uniform, moderately and heavily skewed.
+    CollectiveBenchmarkInfo((1UL << 12), 0.0),
+    CollectiveBenchmarkInfo((1UL << 12), 0.8),
+    CollectiveBenchmarkInfo((1UL << 12), 1.2),
+    CollectiveBenchmarkInfo((1UL << 16), 0.0),
+    CollectiveBenchmarkInfo((1UL << 16), 0.8),
+    CollectiveBenchmarkInfo((1UL << 16), 1.2),
+    CollectiveBenchmarkInfo((1UL << 20), 0.0),
+    CollectiveBenchmarkInfo((1UL << 20), 0.8),
+    CollectiveBenchmarkInfo((1UL << 20), 1.2)
+));
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
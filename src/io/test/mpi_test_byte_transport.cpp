@@ -0,0 +1,117 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_byte_transport.cpp
+ * @ingroup
+ * @brief   tests the byte transport payload check, and payload_all2allv against the mxx datatypes.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "io/mxx_support.hpp"
+#include "io/incremental_mxx.hpp"
+
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+
+TEST(ByteTransportTest, payloads)
+{
+  EXPECT_TRUE(::imxx::is_byte_transport<uint64_t>::value);
+  EXPECT_TRUE(::imxx::is_byte_transport<KmerType>::value);
+  EXPECT_TRUE((::imxx::is_byte_transport<std::pair<KmerType, uint64_t> >::value));
+  EXPECT_TRUE((::imxx::is_byte_transport<std::pair<uint32_t, uint32_t> >::value));
+  EXPECT_TRUE((::imxx::is_byte_transport<std::pair<KmerType, bliss::common::ShortSequenceKmerId> >::value));
+  EXPECT_TRUE(::imxx::is_byte_transport<bliss::partition::range<size_t> >::value);
+
+  // padding, so keeps the mxx datatype.
+  EXPECT_FALSE((::imxx::is_byte_transport<std::pair<uint64_t, uint32_t> >::value));
+  EXPECT_FALSE((::imxx::is_byte_transport<std::pair<KmerType, uint8_t> >::value));
+  EXPECT_FALSE(::imxx::is_byte_transport<std::vector<int> >::value);
+}
+
+TEST(ByteTransportTest, same_as_all2allv)
+{
+  ::mxx::comm comm;
+  int p = comm.size();
+
+  std::vector<std::pair<KmerType, uint64_t> > input;
+  std::vector<size_t> send_counts(p);
+  KmerType km;
+  for (int i = 0; i < p; ++i) {
+    send_counts[i] = (comm.rank() + 2 * i) % 7 + 1;
+    for (size_t j = 0; j < send_counts[i]; ++j) {
+      km.nextFromChar((j + i) & 3);
+      input.emplace_back(km, (static_cast<uint64_t>(comm.rank()) << 32) + j);
+    }
+  }
+  std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+  size_t total = 0;
+  for (auto c : recv_counts) total += c;
+
+  ::imxx::byte_transport & settings = ::imxx::byte_transport::instance();
+  settings.enable(false);
+  std::vector<std::pair<KmerType, uint64_t> > gold(total);
+  ::imxx::payload_all2allv(input.data(), send_counts, gold.data(), recv_counts, comm);
+
+  settings.enable(true);
+  EXPECT_TRUE((settings.use<std::pair<KmerType, uint64_t> >()));
+  std::vector<std::pair<KmerType, uint64_t> > output(total);
+  ::imxx::payload_all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
+  EXPECT_EQ(gold, output);
+
+  // block all2all.
+  std::vector<std::pair<KmerType, uint64_t> > block(3 * p), block_out(3 * p);
+  for (size_t i = 0; i < block.size(); ++i) block[i] = input[i % input.size()];
+  ::imxx::payload_all2all(block.data(), 3, block_out.data(), comm);
+  settings.enable(false);
+  std::vector<std::pair<KmerType, uint64_t> > block_gold(3 * p);
+  ::imxx::payload_all2all(block.data(), 3, block_gold.data(), comm);
+  settings.enable(true);
+  EXPECT_EQ(block_gold, block_out);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
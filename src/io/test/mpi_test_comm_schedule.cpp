@@ -0,0 +1,150 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_comm_schedule.cpp
+ * @ingroup
+ * @brief   tests the node aware exchange schedule, and the exchanges with a schedule installed.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "io/incremental_mxx.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+/// pretend nodes of 2 ranks each, if p is even.
+static std::vector<int> fake_leaders(int const & p) {
+  std::vector<int> leaders(p);
+  for (int r = 0; r < p; ++r) leaders[r] = (p % 2 == 0) ? (r / 2) * 2 : 0;
+  return leaders;
+}
+
+TEST(CommScheduleTest, steps_are_permutations)
+{
+  ::mxx::comm comm;
+  int p = comm.size();
+
+  // slowest shift 1, so it comes last.
+  int nn = (p % 2 == 0) ? p / 2 : 1;
+  std::vector<double> bw(nn * nn, 10.0);
+  for (int n = 0; n < nn; ++n) bw[n * nn + (n + 1) % nn] = 1.0;
+
+  ::imxx::pairwise_schedule sched = ::imxx::pairwise_schedule::for_nodes(comm, fake_leaders(p), bw);
+  EXPECT_EQ(p, sched.size());
+  EXPECT_EQ(comm.rank(), sched.dst(0));
+  EXPECT_EQ(comm.rank(), sched.src(0));
+
+  // every rank is a destination once, and whoever this rank sends to in step i receives from it in step i.
+  std::vector<int> dsts(p), srcs(p);
+  for (int i = 0; i < p; ++i) {
+    dsts[i] = sched.dst(i);
+    srcs[i] = sched.src(i);
+  }
+  std::vector<int> all_srcs = ::mxx::allgather(srcs, comm);
+  for (int i = 0; i < p; ++i) EXPECT_EQ(comm.rank(), all_srcs[dsts[i] * p + i]);
+  std::sort(dsts.begin(), dsts.end());
+  for (int i = 0; i < p; ++i) EXPECT_EQ(i, dsts[i]);
+
+  if (nn > 2) {
+    // node shift 1 is the last 2 steps.
+    EXPECT_EQ(((comm.rank() / 2 + 1) % nn), sched.dst(p - 1) / 2);
+    EXPECT_EQ(((comm.rank() / 2 + 1) % nn), sched.dst(p - 2) / 2);
+  }
+}
+
+TEST(CommScheduleTest, exchanges_with_schedule)
+{
+  ::mxx::comm comm;
+  int p = comm.size();
+
+  ::imxx::comm_scheduler::instance().install(comm, ::imxx::pairwise_schedule::for_nodes(comm, fake_leaders(p)));
+  EXPECT_EQ(p >= 4 && (p % 2 == 0), ::imxx::comm_scheduler::instance().installed(comm));
+
+  // block all2all
+  std::vector<uint8_t> input(3 * p), output(3 * p);
+  for (int i = 0; i < p; ++i)
+    for (int j = 0; j < 3; ++j) input[i * 3 + j] = static_cast<uint8_t>(comm.rank() * 3 + j);
+  ::imxx::block_all2all(input, 3, output, 0, 0, comm);
+  for (int i = 0; i < p; ++i)
+    for (int j = 0; j < 3; ++j) EXPECT_EQ(static_cast<uint8_t>(i * 3 + j), output[i * 3 + j]);
+
+  // chunked large all2allv
+  std::vector<size_t> send_counts(p);
+  std::vector<uint64_t> data;
+  for (int i = 0; i < p; ++i) {
+    send_counts[i] = (comm.rank() + i) % 4 + 1;
+    for (size_t j = 0; j < send_counts[i]; ++j) data.emplace_back((static_cast<uint64_t>(comm.rank()) << 32) + j);
+  }
+  std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+  std::vector<uint64_t> gold = ::mxx::all2allv(data, send_counts, comm);
+
+  ::imxx::large_count & settings = ::imxx::large_count::instance();
+  size_t max_bytes = settings.get_max_message_bytes();
+  bool calls = settings.get_large_count_calls();
+  settings.set_max_message_bytes(2 * sizeof(uint64_t));
+  settings.set_large_count_calls(false);
+  std::vector<uint64_t> out(gold.size());
+  ::imxx::large_all2allv(data.data(), send_counts, out.data(), recv_counts, comm);
+  EXPECT_EQ(gold, out);
+  settings.set_max_message_bytes(max_bytes);
+  settings.set_large_count_calls(calls);
+
+  // distribute_consume
+  auto to_rank = [&p](uint64_t const & x) { return static_cast<int>((x >> 32) + (x & 0xFFFFFFFF)) % p; };
+  std::vector<uint64_t> dist_in = data, dist_gold, dist_i2o_in = data;
+  std::vector<size_t> rc, i2o;
+  ::imxx::distribute(dist_i2o_in, to_rank, rc, i2o, dist_gold, comm, false);
+  std::sort(dist_gold.begin(), dist_gold.end());
+  std::vector<uint64_t> received;
+  auto consume = [&received](uint64_t * first, uint64_t * last) { received.insert(received.end(), first, last); };
+  ::imxx::distribute_consume(dist_in, to_rank, consume, comm, 2 * sizeof(uint64_t));
+  std::sort(received.begin(), received.end());
+  EXPECT_EQ(dist_gold, received);
+
+  ::imxx::comm_scheduler::instance().remove(comm);
+  EXPECT_FALSE(::imxx::comm_scheduler::instance().installed(comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -475,6 +475,40 @@ TEST_P(DistributeTest, distribute)
 
 
 
+TEST_P(DistributeTest, distribute_comm_stats)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  ::imxx::comm_stats & stats = ::imxx::comm_stats::instance();
+  stats.reset();
+  stats.enable();
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> recv_counts;
+  std::vector<size_t> mapping;
+  std::vector<T> temp(this->data.begin(), this->data.end());
+
+  imxx::distribute(temp, [&p](T const & x ){ return x.first % p; },
+                   recv_counts, mapping, this->distributed, comm, false);
+
+  stats.enable(false);
+
+  ::imxx::comm_volume v = stats.get("imxx:distribute");
+  EXPECT_EQ(1UL, v.calls);
+  EXPECT_EQ(this->data.size() * sizeof(T), v.bytes_sent);
+  EXPECT_EQ(this->distributed.size() * sizeof(T), v.bytes_recv);
+
+  size_t total_sent = ::mxx::allreduce(v.bytes_sent, comm);
+  size_t total_recv = ::mxx::allreduce(v.bytes_recv, comm);
+  EXPECT_EQ(total_sent, total_recv);
+
+  stats.reset();
+}
+
 TEST_P(DistributeTest, distribute_preserve_input_rt)
 {
 
@@ -522,6 +556,59 @@ TEST_P(DistributeTest, distribute_rt)
   imxx::undistribute(distributed, recv_counts, mapping, this->roundtripped, comm, true);
 }
 
+TEST_P(DistributeTest, distribute_2level)
+{
+
+  ::mxx::comm comm;
+  ::imxx::node_aware_comm hc(comm);
+
+  this->init(comm);
+
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->roundtripped.begin());
+
+  // distribute
+  int p = comm.size();
+  ::imxx::two_level_mapping mapping;
+
+  imxx::distribute_2level(this->roundtripped, [&p](T const & x ){ return x.first % p; },
+                   mapping, this->distributed, hc, false);
+
+  std::vector<T> distributed(this->distributed);
+  imxx::undistribute_2level(distributed, mapping, this->roundtripped, hc, true);
+
+  // same entries as the flat distribute, but grouped by node then local rank.
+  std::sort(this->distributed.begin(), this->distributed.end());
+  std::sort(this->gold.begin(), this->gold.end());
+}
+
+TEST_P(DistributeTest, distribute_compressed)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->roundtripped.begin());
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> recv_counts;
+
+  imxx::distribute_compressed(this->roundtripped, [&p](T const & x ){ return x.first % p; },
+                   recv_counts, this->distributed, comm);
+
+  // no mapping back, and entries are sorted per source.  same entries as the uncompressed distribute.
+  this->roundtripped.clear();
+  std::sort(this->distributed.begin(), this->distributed.end());
+  std::sort(this->gold.begin(), this->gold.end());
+}
+
 TEST_P(DistributeTest, scatter_compute_gather)
 {
 
@@ -555,6 +642,39 @@ TEST_P(DistributeTest, scatter_compute_gather)
 
 }
 
+TEST_P(DistributeTest, scatter_compute_gather_pipelined)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+
+  this->distributed.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->distributed.begin());
+
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> mapping;
+
+  std::vector<T> inbuf;
+  std::vector<T> outbuf;
+
+  imxx::scatter_compute_gather_pipelined(this->distributed, [&p](T const & x ){ return x.first % p; },
+                               copy<typename std::vector<T>::const_iterator,
+                                    typename std::vector<T>::iterator>(),
+                   mapping, this->roundtripped, inbuf, outbuf, comm, false, 2);
+
+  this->distributed.clear();
+
+  imxx::local::unpermute_inplace(this->roundtripped, mapping);
+
+}
+
 
 
 
@@ -883,6 +1003,46 @@ TEST_P(Distribute2PartTest, scatter_compute_gather_lowmem)
 
 }
 
+TEST_P(Distribute2PartTest, scatter_compute_gather_adaptive)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+
+  this->distributed.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->distributed.begin());
+
+
+  // no memory to spare, every batch is large:  should pick the low memory version.
+  imxx::distribution_policy policy(imxx::scatter_algo::AUTO, 1e-12, 0);
+  imxx::scatter_algo algo = policy.choose<T, T>(this->distributed.size(), comm);
+  EXPECT_TRUE(mxx::all_same(static_cast<int>(algo), comm));
+  if (mxx::any_of(this->distributed.size() > 0, comm)) {
+    EXPECT_EQ(static_cast<int>(imxx::scatter_algo::LOW_MEM), static_cast<int>(algo));
+  }
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> mapping;
+
+  std::vector<T> inbuf;
+  std::vector<T> outbuf;
+
+  imxx::scatter_compute_gather_adaptive(this->distributed, [&p](T const & x ){ return x.first % p; },
+                                     copy<typename std::vector<T>::const_iterator,
+                                          typename std::vector<T>::iterator>(),
+                   mapping, this->roundtripped, inbuf, outbuf, comm, policy, false);
+
+  this->distributed.clear();
+  imxx::local::unpermute_inplace(this->roundtripped, mapping);
+
+}
+
 
 
 INSTANTIATE_TEST_CASE_P(Bliss, Distribute2PartTest, ::testing::Values(
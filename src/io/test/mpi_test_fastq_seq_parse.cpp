@@ -428,6 +428,18 @@ TEST_P(FASTQParseTest, parse_posix_mpi)
   comm.barrier();
 }
 
+TEST_P(FASTQParseTest, parse_posix_mpi_balanced)
+{
+	  ::mxx::comm comm;
+
+  ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, bliss::io::FASTQParser> fobj(this->fileName, 0UL, comm);
+  fobj.balance_kmers(kmer_size, 4, 4096);
+
+  this->parse_mpi(fobj, 0UL, comm);
+
+  comm.barrier();
+}
+
 TEST_P(FASTQParseTest, parse_mpiio_mpi)
 {
 	  ::mxx::comm comm;
@@ -1433,6 +1445,109 @@ INSTANTIATE_TEST_CASE_P(Bliss, SplitFASTQParseTest, ::testing::Values(
 ));
 
 
+#ifdef USE_MPI
+/**
+ * @brief compare kmers from a packed sequence file to kmers parsed from the FASTQ file.
+ */
+class PackedFASTQParseTest : public KmerReaderTest
+{
+protected:
+	static constexpr size_t kmer_size = 35;
+
+	template <typename Alphabet>
+	void compare(mxx::comm const & comm) {
+		using KmerType = ::bliss::common::Kmer<kmer_size, Alphabet, uint64_t>;
+		using PosType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+
+		std::string packed = this->fileName + ".pks";
+
+		this->seqCount = ::bliss::io::KmerFileHelper::template write_packed_file<Alphabet>(this->fileName, packed, comm);
+
+		// kmers
+		std::vector<KmerType> gold, result;
+		::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerParser<KmerType>,
+			::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(this->fileName, gold, comm);
+		this->kmerCount = ::bliss::io::KmerFileHelper::template read_packed_file<::bliss::index::kmer::KmerParser<KmerType> >(packed, result, comm).second;
+
+		gold = ::mxx::allgatherv(gold, comm);
+		result = ::mxx::allgatherv(result, comm);
+		std::sort(gold.begin(), gold.end());
+		std::sort(result.begin(), result.end());
+		ASSERT_EQ(gold.size(), result.size());
+		ASSERT_TRUE(gold == result);
+
+		// kmers and positions
+		std::vector<PosType> gold_pos, result_pos;
+		::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerPositionTupleParser<PosType>,
+			::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(this->fileName, gold_pos, comm);
+		::bliss::io::KmerFileHelper::template read_packed_file<::bliss::index::kmer::KmerPositionTupleParser<PosType> >(packed, result_pos, comm);
+
+		gold_pos = ::mxx::allgatherv(gold_pos, comm);
+		result_pos = ::mxx::allgatherv(result_pos, comm);
+		auto pos_less = [](PosType const & x, PosType const & y) {
+			return (x.second.id < y.second.id) || ((x.second.id == y.second.id) && (x.first < y.first));
+		};
+		std::sort(gold_pos.begin(), gold_pos.end(), pos_less);
+		std::sort(result_pos.begin(), result_pos.end(), pos_less);
+		ASSERT_EQ(gold_pos.size(), result_pos.size());
+		for (size_t i = 0; i < gold_pos.size(); ++i) {
+			ASSERT_TRUE(gold_pos[i].first == result_pos[i].first);
+			ASSERT_EQ(gold_pos[i].second.id, result_pos[i].second.id);
+		}
+
+		comm.barrier();
+		if (comm.rank() == 0) remove(packed.c_str());
+	}
+};
+
+TEST_P(PackedFASTQParseTest, packed_dna)
+{
+	::mxx::comm comm;
+	this->template compare<::bliss::common::DNA>(comm);
+}
+
+TEST_P(PackedFASTQParseTest, packed_dna16)
+{
+	::mxx::comm comm;
+	this->template compare<::bliss::common::DNA16>(comm);
+}
+
+TEST_P(PackedFASTQParseTest, wrong_alphabet)
+{
+	::mxx::comm comm;
+	using KmerType = ::bliss::common::Kmer<kmer_size, ::bliss::common::DNA16, uint64_t>;
+
+	std::string packed = this->fileName + ".pks";
+	::bliss::io::KmerFileHelper::template write_packed_file<::bliss::common::DNA>(this->fileName, packed, comm);
+
+	std::vector<KmerType> result;
+	bool thrown = false;
+	try {
+		::bliss::io::KmerFileHelper::template read_packed_file<::bliss::index::kmer::KmerParser<KmerType> >(packed, result, comm);
+	} catch (::bliss::io::IOException & e) {
+		thrown = true;
+	}
+	ASSERT_TRUE(thrown);
+
+	// counts are not checked.
+	this->seqCount = std::numeric_limits<size_t>::max();
+	this->kmerCount = std::numeric_limits<size_t>::max();
+
+	comm.barrier();
+	if (comm.rank() == 0) remove(packed.c_str());
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, PackedFASTQParseTest, ::testing::Values(
+    TestFileInfo(243,    434,     27580, std::string("/test/data/natural.fastq")),
+    TestFileInfo(250,    500,     29250, std::string("/test/data/natural.withN.fastq")),
+    TestFileInfo(1,      26,      134, std::string("/test/data/test.debruijn.tiny.fastq")),
+    TestFileInfo(140,    3640,    18761, std::string("/test/data/test.medium.fastq")),
+    TestFileInfo(2,      31155,   62490, std::string("/test/data/test.unitiqs.fastq"))
+));
+#endif
+
+
+
 int main(int argc, char* argv[])
 {
   int result = 0;
@@ -44,6 +44,10 @@
 #include "io/fastq_loader.hpp"
 #include "io/fasta_loader.hpp"
 #include "io/file.hpp"
+#include "io/bgzf_file.hpp"
+#include "io/paired_fastq_file.hpp"
+#include "io/multi_file.hpp"
+#include "io/fasta_index.hpp"
 
 
 
@@ -138,7 +142,8 @@ REGISTER_TYPED_TEST_CASE_P(FileSequentialLoadTest,
 typedef ::testing::Types<
 		bliss::io::mmap_file,
 		bliss::io::stdio_file,
-		bliss::io::posix_file
+		bliss::io::posix_file,
+		bliss::io::direct_posix_file
 > FileSequentialLoadTestTypes;
 
 //typedef ::testing::Types< FileLoader<unsigned char, 0, bliss::io::BaseFileParser, false, false> > FileSequentialLoadTestTypes;
@@ -146,6 +151,48 @@ typedef ::testing::Types<
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, FileSequentialLoadTest, FileSequentialLoadTestTypes);
 
 
+class MmapPolicyLoadTest : public FileLoaderTest
+{
+protected:
+	~MmapPolicyLoadTest() {};
+};
+
+TEST_F(MmapPolicyLoadTest, read)
+{
+#ifdef USE_MPI
+	::mxx::comm comm;
+	if (comm.rank() == 0) {
+#endif
+
+	unsigned int policies[] = {::bliss::io::map_policy::DEFAULT, ::bliss::io::map_policy::HUGEPAGE,
+		::bliss::io::map_policy::LOCAL_NODE, ::bliss::io::map_policy::HUGEPAGE | ::bliss::io::map_policy::LOCAL_NODE};
+
+	for (unsigned int policy : policies) {
+		::bliss::io::mmap_file fobj(this->fileName);
+		fobj.set_map_policy(policy);
+		ASSERT_EQ(policy, fobj.get_map_policy());
+
+		::bliss::io::file_data fdata = fobj.read_file();
+		ASSERT_EQ(fdata.getRange().size(), fobj.size());
+
+		ValueType * data = new ValueType[fobj.size()];
+		this->readFilePOSIX(this->fileName, 0, fobj.size(), data);
+		ASSERT_TRUE(equal(data, fdata.begin(), fobj.size(), true));
+
+		// released pages are reloaded on access.
+		::bliss::io::mapped_data md = fobj.map(::bliss::io::file_data::range_type(0, fobj.size()));
+		md.release(fobj.size() / 2);
+		ASSERT_TRUE(equal(data, md.get_data(), fobj.size(), true));
+
+		delete [] data;
+	}
+
+#ifdef USE_MPI
+	}
+#endif
+}
+
+
 #ifdef USE_MPI
 
 template <typename file_loader>
@@ -245,12 +292,14 @@ typedef ::testing::Types<
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::direct_posix_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::BaseFileParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::direct_posix_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTAParser , ::bliss::io::parallel::base_shared_fd_file>,  std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTAParser , ::bliss::io::parallel::base_shared_fd_file>,  std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >
@@ -347,6 +396,7 @@ typedef ::testing::Types<
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::direct_posix_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTQParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >
@@ -356,6 +406,726 @@ INSTANTIATE_TYPED_TEST_CASE_P(Bliss, FASTQMPILoadTest, FASTQMPILoadTestTypes);
 
 
 
+#if defined(USE_ZLIB)
+
+class BGZFMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~BGZFMPILoadTest() {};
+
+	template <template <typename> class FileParser>
+	void open(std::string const & compressed, std::string const & uncompressed, size_t const & overlap, mxx::comm const & comm) {
+
+		std::string fileName(PROJ_SRC_DIR);
+		fileName.append(uncompressed);
+		std::string gzFileName(PROJ_SRC_DIR);
+		gzFileName.append(compressed);
+
+		struct stat filestat;
+		stat(fileName.c_str(), &filestat);
+		size_t fileSize = static_cast<size_t>(filestat.st_size);
+
+		::bliss::io::parallel::bgzf_file<FileParser> fobj(gzFileName, overlap, comm);
+		::bliss::io::file_data fdata = fobj.read_file();
+
+		// size is the uncompressed size.
+		ASSERT_EQ(fileSize, fobj.size());
+		ASSERT_TRUE(fobj.compressed_size() < fileSize);
+
+		// parent range should match.
+		ASSERT_EQ(fdata.parent_range_bytes.size(), fobj.size());
+		ASSERT_EQ(fdata.parent_range_bytes.end, fobj.size());
+
+		ASSERT_TRUE(fdata.in_mem_range_bytes.start <= fdata.valid_range_bytes.start);
+		ASSERT_TRUE(fdata.in_mem_range_bytes.end >= fdata.valid_range_bytes.end);
+		ASSERT_EQ(fdata.in_mem_range_bytes.size(), fdata.data.size());
+
+		// get all the sizes to make sure total is same as file size.
+		size_t region_size = fdata.valid_range_bytes.size();
+		region_size = ::mxx::allreduce(region_size, comm);
+		ASSERT_EQ(region_size, fobj.size());
+
+		// make sure the aggregate range is same as parent range.
+		std::vector<size_t> begins = mxx::allgather(fdata.valid_range_bytes.start, comm);
+		std::vector<size_t> ends = mxx::allgather(fdata.valid_range_bytes.end, comm);
+
+		ASSERT_EQ(begins.front(), 0UL);
+		ASSERT_EQ(ends.back(), fobj.size());
+
+		for (int i = 1; i < comm.size(); ++i) {
+			ASSERT_TRUE(ends[i-1] == begins[i] );
+		}
+
+		// make sure the decompressed data is same as the uncompressed file, including overlap.
+		if (fdata.in_mem_range_bytes.size() > 0) {
+			bool same = true;
+
+			ValueType * data = new ValueType[fdata.in_mem_range_bytes.size()];
+			this->readFilePOSIX(fileName,
+					fdata.in_mem_range_bytes.start,
+					fdata.in_mem_range_bytes.size(), data);
+
+			same = equal(data, fdata.in_mem_cbegin(), fdata.in_mem_range_bytes.size(), true);
+			ASSERT_TRUE(same);
+
+			delete [] data;
+		}
+	}
+};
+
+TEST_F(BGZFMPILoadTest, read_fastq)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq.gz", "/test/data/test.medium.fastq", 0, comm);
+	comm.barrier();
+}
+
+TEST_F(BGZFMPILoadTest, read_fasta)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTAParser>("/test/data/test.medium.fasta.gz", "/test/data/test.medium.fasta", 30, comm);
+	comm.barrier();
+}
+
+TEST_F(BGZFMPILoadTest, read_plain_gzip)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.plain.fastq.gz", "/test/data/test.medium.fastq", 0, comm);
+	comm.barrier();
+}
+
+#endif
+
+
+
+template <typename file_loader>
+class PairedFASTQMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~PairedFASTQMPILoadTest() {};
+
+	/// get the header lines (line 1 of each record) in the valid range of a record-aligned FASTQ partition.
+	static std::vector<std::string> get_headers(::bliss::io::file_data const & fdata) {
+		std::vector<std::string> headers;
+
+		std::string line;
+		size_t i = 0;
+		for (auto it = fdata.cbegin(); it != fdata.cend(); ++it) {
+			if (*it == '\n') {
+				if (line.length() > 0) {
+					if ((i % 4) == 0) headers.push_back(line);
+					++i;
+				}
+				line.clear();
+			} else {
+				line.push_back(*it);
+			}
+		}
+		if (line.length() > 0) {
+			if ((i % 4) == 0) headers.push_back(line);
+		}
+		return headers;
+	}
+};
+
+TYPED_TEST_CASE_P(PairedFASTQMPILoadTest);
+
+TYPED_TEST_P(PairedFASTQMPILoadTest, read)
+{
+	::mxx::comm comm;
+
+	std::string fileName1(PROJ_SRC_DIR);
+	fileName1.append("/test/data/test.medium.fastq");
+	std::string fileName2(PROJ_SRC_DIR);
+	fileName2.append("/test/data/test.medium_2.fastq");
+
+	::bliss::io::parallel::paired_fastq_file<TypeParam> fobj(fileName1, fileName2, comm);
+	std::pair<::bliss::io::file_data, ::bliss::io::file_data> fdata = fobj.read_file();
+
+	// R1 partition should be same as partitioned_file's
+	{
+		::bliss::io::parallel::partitioned_file<TypeParam, ::bliss::io::FASTQParser> r1(fileName1, 0, comm);
+		::bliss::io::file_data expected = r1.read_file();
+		ASSERT_EQ(expected.valid_range_bytes, fdata.first.valid_range_bytes);
+	}
+
+	// R2 ranges should cover the file, as contiguous ranges.
+	ASSERT_EQ(fdata.second.parent_range_bytes.end, fobj.size2());
+	ASSERT_EQ(fdata.second.in_mem_range_bytes.size(), fdata.second.data.size());
+
+	std::vector<size_t> begins = mxx::allgather(fdata.second.valid_range_bytes.start, comm);
+	std::vector<size_t> ends = mxx::allgather(fdata.second.valid_range_bytes.end, comm);
+	ASSERT_EQ(begins.front(), 0UL);
+	ASSERT_EQ(ends.back(), fobj.size2());
+	for (int i = 1; i < comm.size(); ++i) {
+		ASSERT_TRUE(ends[i-1] == begins[i] );
+	}
+
+	// data should match the file content
+	if (fdata.second.valid_range_bytes.size() > 0) {
+		typename TestFixture::ValueType * data = new typename TestFixture::ValueType[fdata.second.valid_range_bytes.size()];
+		this->readFilePOSIX(fileName2,
+				fdata.second.valid_range_bytes.start,
+				fdata.second.valid_range_bytes.size(), data);
+
+		bool same = equal(data, fdata.second.cbegin(), fdata.second.valid_range_bytes.size(), true);
+		ASSERT_TRUE(same);
+
+		delete [] data;
+	}
+
+	// mates are local, and in the same order.
+	std::vector<std::string> headers1 = this->get_headers(fdata.first);
+	std::vector<std::string> headers2 = this->get_headers(fdata.second);
+	ASSERT_EQ(headers1.size(), headers2.size());
+	for (size_t i = 0; i < headers1.size(); ++i) {
+		ASSERT_EQ(headers1[i] + "/2 mate", headers2[i]);
+	}
+
+	size_t total = ::mxx::allreduce(headers2.size(), comm);
+	ASSERT_EQ(140UL, total);
+
+	comm.barrier();
+}
+
+REGISTER_TYPED_TEST_CASE_P(PairedFASTQMPILoadTest, read);
+
+typedef ::testing::Types<
+		::bliss::io::mmap_file,
+		::bliss::io::stdio_file,
+		::bliss::io::posix_file
+		> PairedFASTQMPILoadTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PairedFASTQMPILoadTest, PairedFASTQMPILoadTestTypes);
+
+
+
+template <typename file_loader>
+class MultiFileMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~MultiFileMPILoadTest() {};
+};
+
+TYPED_TEST_CASE_P(MultiFileMPILoadTest);
+
+TYPED_TEST_P(MultiFileMPILoadTest, read)
+{
+	::mxx::comm comm;
+
+	std::vector<std::string> fileNames;
+	for (std::string name : {"/test/data/test.medium.fastq", "/test/data/test.small.fastq", "/test/data/natural.fastq",
+		"/test/data/test.unitiq1.short2.fastq", "/test/data/test.debruijn.tiny.fastq", "/test/data/test.medium_2.fastq"}) {
+		fileNames.push_back(std::string(PROJ_SRC_DIR) + name);
+	}
+
+	::bliss::io::parallel::multi_file<TypeParam> fobj(fileNames, comm);
+	std::vector<size_t> ids = fobj.get_local_files();
+	std::vector<::bliss::io::file_data> fdata = fobj.read_file();
+	ASSERT_EQ(ids.size(), fdata.size());
+
+	// partitions are balanced over the concatenated files.
+	size_t total = 0;
+	struct stat filestat;
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		stat(fileNames[i].c_str(), &filestat);
+		ASSERT_EQ(static_cast<size_t>(filestat.st_size), fobj.get_file_range(i).size());
+		total += static_cast<size_t>(filestat.st_size);
+	}
+	ASSERT_EQ(total, fobj.size());
+	size_t part_size = fobj.get_partition_range().size();
+	ASSERT_TRUE(part_size + 1 >= (total / comm.size()));
+	ASSERT_TRUE(part_size <= (total / comm.size()) + 1);
+
+	// each piece is record aligned, and matches the file content.
+	std::vector<size_t> pieces;
+	for (size_t i = 0; i < fdata.size(); ++i) {
+		ASSERT_EQ(fdata[i].parent_range_bytes.size(), fobj.get_file_range(ids[i]).size());
+		if (fdata[i].valid_range_bytes.size() == 0) continue;
+
+		pieces.push_back(ids[i]);
+		pieces.push_back(fdata[i].valid_range_bytes.start);
+		pieces.push_back(fdata[i].valid_range_bytes.end);
+
+		ASSERT_EQ('@', *(fdata[i].cbegin()));
+
+		typename TestFixture::ValueType * data = new typename TestFixture::ValueType[fdata[i].valid_range_bytes.size()];
+		this->readFilePOSIX(fileNames[ids[i]],
+				fdata[i].valid_range_bytes.start,
+				fdata[i].valid_range_bytes.size(), data);
+
+		bool same = equal(data, fdata[i].cbegin(), fdata[i].valid_range_bytes.size(), true);
+		ASSERT_TRUE(same);
+
+		delete [] data;
+	}
+
+	// pieces tile each file.
+	std::vector<size_t> all_pieces = ::mxx::allgatherv(pieces, comm);
+	std::vector<size_t> ends(fileNames.size(), 0);
+	for (size_t i = 0; i < all_pieces.size(); i += 3) {
+		ASSERT_EQ(ends[all_pieces[i]], all_pieces[i + 1]);
+		ends[all_pieces[i]] = all_pieces[i + 2];
+	}
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		ASSERT_EQ(fobj.get_file_range(i).size(), ends[i]);
+	}
+
+	comm.barrier();
+}
+
+TYPED_TEST_P(MultiFileMPILoadTest, whole_files)
+{
+	::mxx::comm comm;
+
+	std::vector<std::string> fileNames;
+	for (std::string name : {"/test/data/test.medium.fastq", "/test/data/test.small.fastq", "/test/data/natural.fastq",
+		"/test/data/test.unitiq1.short2.fastq", "/test/data/test.debruijn.tiny.fastq", "/test/data/test.medium_2.fastq"}) {
+		fileNames.push_back(std::string(PROJ_SRC_DIR) + name);
+	}
+
+	::bliss::io::parallel::multi_file<TypeParam> fobj(fileNames, comm, true);
+	ASSERT_TRUE(fobj.is_whole_files());
+	std::vector<size_t> ids = fobj.get_local_files();
+	std::vector<::bliss::io::file_data> fdata = fobj.read_file();
+	ASSERT_EQ(ids.size(), fdata.size());
+
+	// each file is read whole, by its owner.
+	for (size_t i = 0; i < fdata.size(); ++i) {
+		ASSERT_EQ(comm.rank(), fobj.get_file_owner(ids[i]));
+		ASSERT_EQ(0UL, fdata[i].valid_range_bytes.start);
+		ASSERT_EQ(fobj.get_file_range(ids[i]).size(), fdata[i].valid_range_bytes.end);
+
+		typename TestFixture::ValueType * data = new typename TestFixture::ValueType[fdata[i].valid_range_bytes.size()];
+		this->readFilePOSIX(fileNames[ids[i]], 0, fdata[i].valid_range_bytes.size(), data);
+		bool same = equal(data, fdata[i].cbegin(), fdata[i].valid_range_bytes.size(), true);
+		ASSERT_TRUE(same);
+		delete [] data;
+	}
+
+	// every file has exactly 1 owner.
+	std::vector<size_t> all_ids = ::mxx::allgatherv(ids, comm);
+	std::sort(all_ids.begin(), all_ids.end());
+	ASSERT_EQ(fileNames.size(), all_ids.size());
+	for (size_t i = 0; i < all_ids.size(); ++i) ASSERT_EQ(i, all_ids[i]);
+
+	// largest first, to the least loaded process.  ties to the lower rank.
+	std::vector<size_t> sizes = {4, 10, 7, 9, 8};
+	std::vector<int> owners = ::bliss::io::parallel::multi_file<TypeParam>::assign_files(sizes, 3);
+	std::vector<int> expected = {1, 0, 2, 1, 2};
+	ASSERT_TRUE(expected == owners);
+	// a process with twice the weight takes twice the load.
+	owners = ::bliss::io::parallel::multi_file<TypeParam>::assign_files(std::vector<size_t>(6, 1), 2, {2.0, 1.0});
+	ASSERT_EQ(4, std::count(owners.begin(), owners.end(), 0));
+
+	comm.barrier();
+}
+
+REGISTER_TYPED_TEST_CASE_P(MultiFileMPILoadTest, read, whole_files);
+
+typedef ::testing::Types<
+		::bliss::io::mmap_file,
+		::bliss::io::stdio_file,
+		::bliss::io::posix_file
+		> MultiFileMPILoadTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, MultiFileMPILoadTest, MultiFileMPILoadTestTypes);
+
+
+
+class MappedFileMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~MappedFileMPILoadTest() {};
+
+	/// zero copy read should produce the same ranges and content as the copying read_file.
+	template <template <typename> class FileParser>
+	void open(std::string const & name, size_t const & overlap, mxx::comm const & comm) {
+		std::string fileName(PROJ_SRC_DIR);
+		fileName.append(name);
+
+		::bliss::io::file_data gold;
+		::bliss::io::mapped_file_data fdata;
+		{
+			::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, FileParser> fobj(fileName, overlap, comm);
+			fobj.read_file(gold);
+		}
+		{
+			::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, FileParser> fobj(fileName, overlap, comm);
+			fobj.read_file(fdata);
+		}  // mapping outlives the file object.
+
+		ASSERT_EQ(gold.parent_range_bytes, fdata.parent_range_bytes);
+		ASSERT_EQ(gold.valid_range_bytes, fdata.valid_range_bytes);
+		ASSERT_TRUE(fdata.in_mem_range_bytes.contains(fdata.valid_range_bytes));
+
+		ASSERT_TRUE(equal(gold.cbegin(), fdata.cbegin(), fdata.valid_range_bytes.size(), true));
+
+		// overlap is the same as well.
+		ASSERT_EQ(gold.in_mem_range_bytes.end, fdata.in_mem_range_bytes.end);
+		ASSERT_EQ(static_cast<long>(gold.in_mem_range_bytes.end - gold.valid_range_bytes.end), std::distance(fdata.cend(), fdata.in_mem_cend()));
+		ASSERT_TRUE(equal(gold.cend(), fdata.cend(), gold.in_mem_range_bytes.end - gold.valid_range_bytes.end, true));
+
+		// released pages are reloaded on access.
+		fdata.release(fdata.valid_range_bytes.end);
+		ASSERT_TRUE(equal(gold.cbegin(), fdata.cbegin(), fdata.valid_range_bytes.size(), true));
+
+		// valid ranges tile the file.
+		size_t region_size = ::mxx::allreduce(fdata.valid_range_bytes.size(), comm);
+		ASSERT_EQ(fdata.parent_range_bytes.size(), region_size);
+	}
+};
+
+TEST_F(MappedFileMPILoadTest, read_fastq)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq", 0, comm);
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.small.fastq", 0, comm);
+	comm.barrier();
+}
+
+TEST_F(MappedFileMPILoadTest, read_fasta)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTAParser>("/test/data/test.medium.fasta", 30, comm);
+	comm.barrier();
+}
+
+TEST_F(MappedFileMPILoadTest, read)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 30, comm);
+	comm.barrier();
+}
+
+class SharedFileMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~SharedFileMPILoadTest() {};
+
+	/// node shared read should produce the same ranges and content as the copying read_file.
+	template <template <typename> class FileParser, typename ... Args>
+	void open(std::string const & name, size_t const & overlap, mxx::comm const & comm, Args ... args) {
+		std::string fileName(PROJ_SRC_DIR);
+		fileName.append(name);
+
+		::bliss::io::file_data gold;
+		::bliss::io::parallel::shared_file_data fdata;
+		{
+			::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, FileParser> fobj(fileName, overlap, comm);
+			fobj.read_file(gold);
+		}
+		{
+			::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, FileParser> fobj(fileName, overlap, comm);
+			fobj.read_file(fdata, args...);
+		}  // window outlives the file object.
+
+		ASSERT_EQ(gold.parent_range_bytes, fdata.parent_range_bytes);
+		ASSERT_EQ(gold.valid_range_bytes, fdata.valid_range_bytes);
+		ASSERT_TRUE(fdata.node_range_bytes.contains(fdata.in_mem_range_bytes));
+		ASSERT_TRUE(fdata.in_mem_range_bytes.contains(fdata.valid_range_bytes));
+
+		ASSERT_TRUE(equal(gold.cbegin(), fdata.cbegin(), fdata.valid_range_bytes.size(), true));
+
+		// overlap is the same as well.
+		ASSERT_EQ(gold.in_mem_range_bytes.end, fdata.in_mem_range_bytes.end);
+		ASSERT_TRUE(equal(gold.cend(), fdata.cend(), gold.in_mem_range_bytes.end - gold.valid_range_bytes.end, true));
+
+		// valid ranges tile the file.
+		size_t region_size = ::mxx::allreduce(fdata.valid_range_bytes.size(), comm);
+		ASSERT_EQ(fdata.parent_range_bytes.size(), region_size);
+	}
+};
+
+TEST_F(SharedFileMPILoadTest, read_fastq)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq", 0, comm);
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.small.fastq", 0, comm);
+	// records straddling nodes are longer than the tail, so the window is read again.
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq", 0, comm, 1UL);
+	comm.barrier();
+}
+
+TEST_F(SharedFileMPILoadTest, read_fasta)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTAParser>("/test/data/test.medium.fasta", 30, comm);
+	comm.barrier();
+}
+
+TEST_F(SharedFileMPILoadTest, read)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 30, comm);
+	comm.barrier();
+}
+
+class BoundaryExchangeMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~BoundaryExchangeMPILoadTest() {};
+
+	/// stripe aligned disjoint reads with exchanged overlap should have the same content as reading the file directly.
+	template <template <typename> class FileParser>
+	void open(std::string const & name, size_t const & overlap, size_t const & stripe, mxx::comm const & comm) {
+		std::string fileName(PROJ_SRC_DIR);
+		fileName.append(name);
+
+		::bliss::io::parallel::mpiio_file<FileParser> fobj(fileName, overlap, comm);
+		fobj.set_boundary_exchange(true, stripe);
+		::bliss::io::file_data fdata = fobj.read_file();
+
+		ASSERT_EQ(fdata.in_mem_range_bytes.size(), fdata.data.size());
+		ASSERT_TRUE(fdata.in_mem_range_bytes.contains(fdata.valid_range_bytes));
+
+		// block boundaries are at stripe multiples, except at the end of the file.
+		if ((comm.rank() > 0) && (fdata.in_mem_range_bytes.start < fdata.parent_range_bytes.end)) {
+			ASSERT_EQ(0UL, fdata.in_mem_range_bytes.start % stripe);
+		}
+
+		// valid ranges tile the file.
+		size_t region_size = ::mxx::allreduce(fdata.valid_range_bytes.size(), comm);
+		ASSERT_EQ(fdata.parent_range_bytes.size(), region_size);
+
+		// in memory data, including the exchanged overlap, matches the file.
+		if (fdata.data.size() > 0) {
+			ValueType * data = new ValueType[fdata.data.size()];
+			this->readFilePOSIX(fileName, fdata.in_mem_range_bytes.start, fdata.data.size(), data);
+			bool same = equal(data, fdata.data.data(), fdata.data.size(), true);
+			delete [] data;
+			ASSERT_TRUE(same);
+		}
+	}
+};
+
+TEST_F(BoundaryExchangeMPILoadTest, read)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 30, 4096, comm);
+	// overlap longer than the blocks is forwarded through several processes.
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 100000, 1, comm);
+	comm.barrier();
+}
+
+TEST_F(BoundaryExchangeMPILoadTest, read_fasta)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTAParser>("/test/data/test.medium.fasta", 30, 4096, comm);
+	comm.barrier();
+}
+
+TEST_F(BoundaryExchangeMPILoadTest, read_fastq)
+{
+	::mxx::comm comm;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq", 0, 4096, comm);
+	comm.barrier();
+}
+
+class IOPolicyMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~IOPolicyMPILoadTest() {};
+
+	/// reads with hints and either read mode should have the same content as reading the file directly.
+	template <template <typename> class FileParser>
+	void open(std::string const & name, size_t const & overlap, ::bliss::io::parallel::mpiio_policy const & policy, mxx::comm const & comm) {
+		std::string fileName(PROJ_SRC_DIR);
+		fileName.append(name);
+
+		::bliss::io::parallel::mpiio_file<FileParser> fobj(fileName, overlap, comm);
+		fobj.set_io_policy(policy);
+		::bliss::io::file_data fdata = fobj.read_file();
+
+		ASSERT_EQ(fdata.in_mem_range_bytes.size(), fdata.data.size());
+		size_t region_size = ::mxx::allreduce(fdata.valid_range_bytes.size(), comm);
+		ASSERT_EQ(fdata.parent_range_bytes.size(), region_size);
+
+		if (fdata.data.size() > 0) {
+			ValueType * data = new ValueType[fdata.data.size()];
+			this->readFilePOSIX(fileName, fdata.in_mem_range_bytes.start, fdata.data.size(), data);
+			bool same = equal(data, fdata.data.data(), fdata.data.size(), true);
+			delete [] data;
+			ASSERT_TRUE(same);
+		}
+	}
+};
+
+TEST_F(IOPolicyMPILoadTest, read)
+{
+	::mxx::comm comm;
+	::bliss::io::parallel::mpiio_policy policy;
+	policy.cb_nodes = 1;
+	policy.cb_buffer_size = 1UL << 20;
+	policy.romio_cb_read = "enable";
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 30, policy, comm);
+
+	policy.mode = ::bliss::io::parallel::mpiio_policy::INDEPENDENT;
+	policy.romio_cb_read = "disable";
+	this->template open<::bliss::io::BaseFileParser>("/test/data/test.medium.fasta", 30, policy, comm);
+
+	// small file:  collective.
+	policy.mode = ::bliss::io::parallel::mpiio_policy::AUTOMATIC;
+	policy.align_to_stripes = true;
+	this->template open<::bliss::io::FASTQParser>("/test/data/test.medium.fastq", 0, policy, comm);
+	// any size:  independent.
+	policy.independent_min_bytes = 0;
+	this->template open<::bliss::io::FASTAParser>("/test/data/test.medium.fasta", 30, policy, comm);
+	comm.barrier();
+}
+
+TEST(IOPolicyTest, read_mode)
+{
+	::bliss::io::parallel::mpiio_policy policy;
+	ASSERT_EQ(MPI_INFO_NULL, policy.create_info());
+	ASSERT_TRUE(policy.use_collective(1UL << 40, 1));
+
+	policy.mode = ::bliss::io::parallel::mpiio_policy::INDEPENDENT;
+	ASSERT_FALSE(policy.use_collective(1, 1));
+
+	policy.mode = ::bliss::io::parallel::mpiio_policy::AUTOMATIC;
+	policy.independent_min_bytes = 1000;
+	ASSERT_FALSE(policy.use_collective(4000, 4));
+	ASSERT_TRUE(policy.use_collective(3999, 4));
+
+	policy.cb_nodes = 2;
+	MPI_Info info = policy.create_info();
+	ASSERT_NE(MPI_INFO_NULL, info);
+	char value[MPI_MAX_INFO_VAL + 1];
+	int flag = 0;
+	MPI_Info_get(info, const_cast<char *>("cb_nodes"), MPI_MAX_INFO_VAL, value, &flag);
+	ASSERT_TRUE(flag);
+	ASSERT_EQ(std::string("2"), std::string(value));
+	MPI_Info_get(info, const_cast<char *>("striping_unit"), MPI_MAX_INFO_VAL, value, &flag);
+	ASSERT_FALSE(flag);
+	MPI_Info_free(&info);
+}
+
+class FASTAIndexMPILoadTest : public FileLoadTypeParamTest
+{
+protected:
+	~FASTAIndexMPILoadTest() {};
+};
+
+TEST_F(FASTAIndexMPILoadTest, read)
+{
+	::mxx::comm comm;
+	using ParserType = ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator>;
+
+	std::string fileName(PROJ_SRC_DIR);
+	fileName.append("/test/data/test.medium.fasta");
+
+	::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTAParser> fobj(fileName, 30, comm);
+	::bliss::io::file_data fdata = fobj.read_file();
+	size_t file_size = fdata.parent_range_bytes.end;
+
+	// distributed search
+	ParserType parser;
+	parser.init_parser(fdata.in_mem_cbegin(), fdata.parent_range_bytes, fdata.in_mem_range_bytes, fdata.getRange(), comm);
+
+	// write the index, then read it back.
+	std::vector<::bliss::io::fasta_index::entry_type> entries;
+	if (comm.rank() == 0) remove(::bliss::io::fasta_index::get_index_filename(fileName).c_str());
+	comm.barrier();
+	ASSERT_FALSE(::bliss::io::fasta_index::read(fileName, file_size, entries, comm));
+
+	ASSERT_TRUE(::bliss::io::fasta_index::write(fileName, file_size, parser.get_sequence_offsets(), comm));
+	ASSERT_TRUE(::bliss::io::fasta_index::read(fileName, file_size, entries, comm));
+
+	// an index that cannot be written is skipped, not an error.
+	bool written = true;
+	EXPECT_NO_THROW(written = ::bliss::io::fasta_index::write("/nonexistent/dir/test.fa", file_size, parser.get_sequence_offsets(), comm));
+	EXPECT_FALSE(written);
+
+	// stale index is ignored.
+	ASSERT_FALSE(::bliss::io::fasta_index::read(fileName, file_size + 1, entries, comm));
+	ASSERT_TRUE(::bliss::io::fasta_index::read(fileName, file_size, entries, comm));
+
+	// 1 entry per record, in order.
+	for (size_t i = 1; i < entries.size(); ++i) {
+		ASSERT_EQ(std::get<2>(entries[i-1]), std::get<0>(entries[i]));
+		ASSERT_EQ(i, std::get<3>(entries[i]));
+	}
+	ASSERT_EQ(0UL, std::get<0>(entries.front()));
+	ASSERT_EQ(file_size, std::get<2>(entries.back()));
+
+	// local initialization from the index matches the distributed search.
+	ParserType indexed_parser;
+	indexed_parser.init_parser(fdata.in_mem_cbegin(), fdata.parent_range_bytes, fdata.in_mem_range_bytes, fdata.getRange(), entries);
+	// record ids are renumbered in the index, so compare just the positions.
+	auto const & gold = parser.get_sequence_offsets();
+	auto const & indexed = indexed_parser.get_sequence_offsets();
+	ASSERT_EQ(gold.size(), indexed.size());
+	for (size_t i = 0; i < gold.size(); ++i) {
+		ASSERT_EQ(std::get<0>(gold[i]), std::get<0>(indexed[i]));
+		ASSERT_EQ(std::get<1>(gold[i]), std::get<1>(indexed[i]));
+		ASSERT_EQ(std::get<2>(gold[i]), std::get<2>(indexed[i]));
+	}
+
+	comm.barrier();
+	if (comm.rank() == 0) remove(::bliss::io::fasta_index::get_index_filename(fileName).c_str());
+}
+
+TEST(FileStartupMPITest, stat_and_open)
+{
+	::mxx::comm comm;
+
+	std::string fileName(PROJ_SRC_DIR);
+	fileName.append("/test/data/test.medium.fasta");
+	std::string missing(PROJ_SRC_DIR);
+	missing.append("/test/data/no.such.file.fasta");
+
+	// sizes from rank 0, the same on all processes.
+	struct stat64 filestat;
+	ASSERT_EQ(0, stat64(fileName.c_str(), &filestat));
+	std::vector<size_t> sizes = ::bliss::io::parallel::stat_files({fileName, std::string(), fileName}, comm);
+	ASSERT_EQ(3UL, sizes.size());
+	ASSERT_EQ(static_cast<size_t>(filestat.st_size), sizes[0]);
+	ASSERT_EQ(0UL, sizes[1]);
+	ASSERT_EQ(sizes[0], sizes[2]);
+
+	// a missing file throws on all processes, instead of only on rank 0.
+	EXPECT_THROW((::bliss::io::parallel::stat_files({fileName, missing}, comm)), ::bliss::io::IOException);
+	EXPECT_THROW((::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser>(missing, 0, comm)),
+	             ::bliss::io::IOException);
+	EXPECT_THROW((::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser,
+	             ::bliss::io::parallel::base_shared_fd_file>(missing, 0, comm)), ::bliss::io::IOException);
+	EXPECT_THROW(::bliss::io::parallel::mpiio_file<::bliss::io::BaseFileParser>(missing, 0, comm), ::bliss::io::IOException);
+	EXPECT_THROW((::bliss::io::parallel::multi_file<::bliss::io::posix_file>({fileName, missing}, comm)), ::bliss::io::IOException);
+
+	// 1 open per node:  the shared descriptor reads the same bytes.
+	{
+		::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser,
+			::bliss::io::parallel::base_shared_fd_file> fobj(fileName, 0, comm);
+		ASSERT_EQ(sizes[0], fobj.size());
+		::bliss::io::file_data fdata = fobj.read_file();
+		ASSERT_EQ(fobj.size(), ::mxx::allreduce(fdata.valid_range_bytes.size(), comm));
+	}
+
+	// deferred open:  the aggregators open the file, and the reads are collective.
+	::bliss::io::parallel::mpiio_policy policy;
+	policy.deferred_open = true;
+	policy.mode = ::bliss::io::parallel::mpiio_policy::INDEPENDENT;
+	ASSERT_TRUE(policy.use_collective(1UL << 40, 1));
+	MPI_Info info = policy.create_info();
+	ASSERT_NE(MPI_INFO_NULL, info);
+	char value[MPI_MAX_INFO_VAL + 1];
+	int flag = 0;
+	MPI_Info_get(info, const_cast<char *>("romio_no_indep_rw"), MPI_MAX_INFO_VAL, value, &flag);
+	ASSERT_TRUE(flag);
+	ASSERT_EQ(std::string("true"), std::string(value));
+	MPI_Info_free(&info);
+
+	{
+		::bliss::io::parallel::mpiio_file<::bliss::io::BaseFileParser> fobj(fileName, 30, comm, policy);
+		ASSERT_EQ(sizes[0], fobj.size());
+		::bliss::io::file_data fdata = fobj.read_file();
+		ASSERT_EQ(fobj.size(), ::mxx::allreduce(fdata.valid_range_bytes.size(), comm));
+	}
+
+	comm.barrier();
+}
+
+
+
 #endif
 
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_large_all2allv.cpp
+ * @ingroup
+ * @brief   tests the chunked large count exchange against all2allv, and distribute / undistribute with it.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "io/incremental_mxx.hpp"
+
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+
+TEST(LargeAll2allvTest, same_as_all2allv)
+{
+  ::mxx::comm comm;
+
+  ::imxx::large_count & settings = ::imxx::large_count::instance();
+  size_t max_bytes = settings.get_max_message_bytes();
+  bool use_calls = settings.get_large_count_calls();
+  settings.set_large_count_calls(false);
+
+  int p = comm.size();
+  std::vector<size_t> send_counts(p);
+  std::vector<std::pair<uint64_t, int> > input;
+  for (int i = 0; i < p; ++i) {
+    send_counts[i] = (comm.rank() * 7 + i * 13) % 50;
+    for (size_t j = 0; j < send_counts[i]; ++j)
+      input.emplace_back((static_cast<uint64_t>(comm.rank()) << 32) + j, i);
+  }
+  std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+  std::vector<std::pair<uint64_t, int> > gold = ::mxx::all2allv(input, send_counts, comm);
+
+  // messages of 1 element, a few elements, and whole buckets.
+  for (size_t bytes : {1UL, 3 * sizeof(std::pair<uint64_t, int>), 1UL << 20}) {
+    settings.set_max_message_bytes(bytes);
+    std::vector<std::pair<uint64_t, int> > output(gold.size());
+    ::imxx::large_all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
+    EXPECT_EQ(gold, output);
+  }
+
+  settings.set_max_message_bytes(max_bytes);
+  settings.set_large_count_calls(use_calls);
+}
+
+TEST(LargeAll2allvTest, distribute_roundtrip)
+{
+  ::mxx::comm comm;
+
+  ::imxx::large_count & settings = ::imxx::large_count::instance();
+  size_t max_bytes = settings.get_max_message_bytes();
+  bool use_calls = settings.get_large_count_calls();
+
+  std::vector<uint64_t> data;
+  for (uint64_t i = 0; i < 1000; ++i) data.emplace_back(i * 7919 + comm.rank());
+  int p = comm.size();
+  auto to_rank = [&p](uint64_t const & x) { return static_cast<int>((x >> 3) % p); };
+
+  std::vector<uint64_t> gold_in = data, gold;
+  std::vector<size_t> gold_counts, gold_i2o;
+  ::imxx::distribute(gold_in, to_rank, gold_counts, gold_i2o, gold, comm, false);
+
+  // every exchange above 256 bytes is large, and sent in messages of 32 elements.
+  settings.set_large_count_calls(false);
+  settings.set_max_message_bytes(32 * sizeof(uint64_t));
+  EXPECT_TRUE(settings.is_large(data.size(), sizeof(uint64_t)));
+
+  std::vector<uint64_t> input = data, distributed;
+  std::vector<size_t> recv_counts, i2o;
+  ::imxx::distribute(input, to_rank, recv_counts, i2o, distributed, comm, false);
+  EXPECT_EQ(gold_counts, recv_counts);
+  EXPECT_EQ(gold, distributed);
+
+  std::vector<uint64_t> roundtripped;
+  ::imxx::undistribute(distributed, recv_counts, i2o, roundtripped, comm, true);
+  EXPECT_EQ(data, roundtripped);
+
+  settings.set_max_message_bytes(max_bytes);
+  settings.set_large_count_calls(use_calls);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_long_read_partition.cpp
+ * @ingroup
+ * @brief   tests that splitting long reads across processes gives the same kmers and positions as read_file, balanced.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/sequence.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/long_read_partition.hpp"
+#include "index/kmer_index.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using PosType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+using ParserType = ::bliss::index::kmer::KmerPositionTupleParser<PosType>;
+
+
+TEST(LongReadPartitionTest, split)
+{
+  // no short reads:  even split.
+  std::vector<size_t> bounds = ::bliss::io::long_read_partition::split(std::vector<size_t>(4, 0), 10);
+  EXPECT_EQ(std::vector<size_t>({0, 3, 6, 9, 10}), bounds);
+
+  // the processes with fewer short read kmers are filled first.
+  bounds = ::bliss::io::long_read_partition::split(std::vector<size_t>({10, 0, 5, 5}), 20);
+  EXPECT_EQ(std::vector<size_t>({0, 0, 10, 15, 20}), bounds);
+
+  // a process with more than the average gets none.
+  bounds = ::bliss::io::long_read_partition::split(std::vector<size_t>({100, 0, 0}), 10);
+  EXPECT_EQ(std::vector<size_t>({0, 0, 10, 10}), bounds);
+
+  bounds = ::bliss::io::long_read_partition::split(std::vector<size_t>({3, 4}), 0);
+  EXPECT_EQ(std::vector<size_t>({0, 0, 0}), bounds);
+}
+
+
+class LongReadFileTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(LongReadFileTest, same_kmers)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  std::vector<PosType> gold;
+  auto gold_read = ::bliss::io::KmerFileHelper::template read_file_posix<ParserType,
+    ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, gold, comm);
+  gold = ::mxx::allgatherv(gold, comm);
+  std::sort(gold.begin(), gold.end());
+
+  // split every read, no read split, and some in between.
+  for (size_t threshold : {0UL, 64UL, 100000UL}) {
+    std::vector<PosType> local;
+    auto read = ::bliss::io::KmerFileHelper::template read_file_long_reads<ParserType>(filename, local, comm, threshold);
+
+    EXPECT_EQ(::mxx::allreduce(gold_read.first, comm), ::mxx::allreduce(read.first, comm));
+    EXPECT_EQ(local.size(), read.second);
+
+    // every read is long:  no process has more than the average, rounded up.
+    if (threshold == 0) {
+      size_t most = ::mxx::allreduce(local.size(), ::mxx::max<size_t>(), comm);
+      EXPECT_LE(most, (gold.size() + comm.size() - 1) / comm.size());
+    }
+
+    std::vector<PosType> all = ::mxx::allgatherv(local, comm);
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(gold.size(), all.size());
+    EXPECT_TRUE(gold == all);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, LongReadFileTest, ::testing::Values(
+    std::string("/test/data/test.fastq"),
+    std::string("/test/data/natural.fastq")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
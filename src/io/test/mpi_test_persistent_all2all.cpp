@@ -0,0 +1,118 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_persistent_all2all.cpp
+ * @ingroup
+ * @brief   tests the persistent exchange against all2allv, for repeated and changing patterns.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "io/incremental_mxx.hpp"
+
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+
+TEST(PersistentAll2allTest, same_as_all2allv)
+{
+  ::mxx::comm comm;
+  ::imxx::persistent_exchange pex(comm);
+
+  int p = comm.size();
+  std::vector<std::pair<uint64_t, int> > input;
+  std::vector<std::pair<uint64_t, int> > output;
+  std::vector<size_t> send_counts(p), recv_counts;
+  input.reserve(100 * p);
+
+  // the pattern changes every 3 rounds, and the data every round.
+  for (int round = 0; round < 9; ++round) {
+    input.clear();
+    for (int i = 0; i < p; ++i) {
+      send_counts[i] = (comm.rank() + i + round / 3) % 5 * 7;
+      for (size_t j = 0; j < send_counts[i]; ++j)
+        input.emplace_back((static_cast<uint64_t>(comm.rank()) << 32) + j, round);
+    }
+
+    std::vector<size_t> gold_counts = ::mxx::all2all(send_counts, comm);
+    std::vector<std::pair<uint64_t, int> > gold = ::mxx::all2allv(input, send_counts, comm);
+
+    pex.all2allv(input.data(), send_counts, output, recv_counts);
+
+    EXPECT_EQ(gold_counts, recv_counts);
+    EXPECT_EQ(gold, output);
+  }
+
+  // 3 patterns, each sent 3 times:  the first time by all2allv, then by 1 request started twice.
+  if (::imxx::persistent_exchange::available()) {
+    EXPECT_EQ(3UL, pex.get_inits());
+    EXPECT_EQ(6UL, pex.get_starts());
+  }
+}
+
+TEST(PersistentAll2allTest, scatter_compute_gather)
+{
+  ::mxx::comm comm;
+  ::imxx::persistent_exchange pex(comm);
+
+  int p = comm.size();
+  auto to_rank = [&p](uint64_t const & x) { return static_cast<int>(x % p); };
+  auto square = [](std::vector<uint64_t>::iterator first, std::vector<uint64_t>::iterator last,
+                   std::vector<uint64_t>::iterator out) {
+    for (; first != last; ++first, ++out) *out = (*first) * (*first);
+  };
+
+  std::vector<uint64_t> query, answers, in_buffer, out_buffer;
+  std::vector<size_t> i2o;
+  for (int round = 0; round < 6; ++round) {
+    query.clear();
+    for (uint64_t i = 0; i < 200; ++i) query.emplace_back(i * 3 + comm.rank() + round);
+
+    ::imxx::scatter_compute_gather(query, to_rank, square, i2o, answers, in_buffer, out_buffer, comm, true, &pex);
+
+    ASSERT_EQ(query.size(), answers.size());
+    for (size_t i = 0; i < query.size(); ++i) EXPECT_EQ(query[i] * query[i], answers[i]);
+  }
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
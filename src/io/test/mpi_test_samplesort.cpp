@@ -186,6 +186,26 @@ TEST_P(SamplesortTest, samplesort)
 }
 
 
+TEST_P(SamplesortTest, samplesort_bounded)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // a budget below the received size:  chunked exchange, and in place block merge.
+  size_t budget = imxx::samplesort_settings::instance().get_budget_bytes();
+  imxx::samplesort_settings::instance().set_budget_bytes(64 * comm.size() * sizeof(T));
+
+  if (this->p.stable)
+	  imxx::samplesort<true>(this->data, this->sorted, [](const T& x, const T& y){ return x.first < y.first; }, comm);
+  else
+	  imxx::samplesort<false>(this->data, this->sorted, [](const T& x, const T& y){ return x.first < y.first; }, comm);
+
+  imxx::samplesort_settings::instance().set_budget_bytes(budget);
+}
+
+
 TEST_P(SamplesortTest, samplesort_buf)
 {
 
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sparse_all2allv.cpp
+ * @ingroup
+ * @brief   tests the NBX sparse exchange against all2allv, and distribute / undistribute with NBX.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+#include "io/incremental_mxx.hpp"
+
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+
+/// counts of a sparse pattern:  rank r sends to r + 1 and r + 3, and nothing from the odd ranks in every other call.
+static std::vector<size_t> sparse_counts(::mxx::comm const & comm, int const & call) {
+  int p = comm.size();
+  int r = comm.rank();
+  std::vector<size_t> counts(p, 0);
+  if ((call % 2 == 1) && (r % 2 == 1)) return counts;
+  counts[(r + 1) % p] += 10 + r + call;
+  counts[(r + 3) % p] += 5 * call;
+  return counts;
+}
+
+TEST(SparseAll2allvTest, same_as_all2allv)
+{
+  ::mxx::comm comm;
+
+  // several calls, so consecutive exchanges with the same tag parity are exercised.
+  for (int call = 0; call < 6; ++call) {
+    std::vector<size_t> send_counts = sparse_counts(comm, call);
+    std::vector<std::pair<uint64_t, int> > input;
+    for (size_t i = 0; i < send_counts.size(); ++i) {
+      for (size_t j = 0; j < send_counts[i]; ++j)
+        input.emplace_back((static_cast<uint64_t>(comm.rank()) << 32) + j, static_cast<int>(i));
+    }
+
+    std::vector<size_t> gold_counts = ::mxx::all2all(send_counts, comm);
+    std::vector<std::pair<uint64_t, int> > gold = ::mxx::all2allv(input, send_counts, comm);
+
+    std::vector<size_t> recv_counts;
+    std::vector<std::pair<uint64_t, int> > output;
+    ::imxx::sparse_all2allv(input.data(), send_counts, output, recv_counts, comm);
+
+    EXPECT_EQ(gold_counts, recv_counts);
+    EXPECT_EQ(gold, output);
+  }
+}
+
+TEST(SparseAll2allvTest, distribute_roundtrip)
+{
+  ::mxx::comm comm;
+
+  ::imxx::sparse_exchange & settings = ::imxx::sparse_exchange::instance();
+  int min_ranks = settings.get_min_ranks();
+  double density = settings.get_max_density();
+
+  // every rank sends to at most 2 ranks.
+  std::vector<uint64_t> data;
+  for (uint64_t i = 0; i < 1000; ++i) data.emplace_back(i * comm.size() + comm.rank());
+  int p = comm.size();
+  int r = comm.rank();
+  auto to_rank = [&p, &r](uint64_t const & x) {
+    return static_cast<int>(((x & 1) == 0) ? (r + 1) % p : (r + 2) % p);
+  };
+
+  // dense, for the gold.
+  settings.enable(false);
+  std::vector<uint64_t> gold_in = data, gold;
+  std::vector<size_t> gold_counts, gold_i2o;
+  ::imxx::distribute(gold_in, to_rank, gold_counts, gold_i2o, gold, comm, false);
+
+  // NBX, forced on for this communicator size.
+  settings.enable(true);
+  settings.set_min_ranks(1);
+  settings.set_max_density(1.0);
+  EXPECT_TRUE(comm.size() < 2 || settings.use(std::vector<size_t>(comm.size(), 1), sizeof(uint64_t), comm));
+
+  std::vector<uint64_t> input = data, distributed;
+  std::vector<size_t> recv_counts, i2o;
+  ::imxx::distribute(input, to_rank, recv_counts, i2o, distributed, comm, false);
+  EXPECT_EQ(gold_counts, recv_counts);
+  EXPECT_EQ(gold, distributed);
+
+  std::vector<uint64_t> roundtripped;
+  ::imxx::undistribute(distributed, recv_counts, i2o, roundtripped, comm, true);
+  EXPECT_EQ(data, roundtripped);
+
+  settings.set_min_ranks(min_ranks);
+  settings.set_max_density(density);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -284,6 +284,46 @@ TEST_P(BucketTest, permute )
   }
 }
 
+TEST_P(BucketTest, radix_scatter)
+{
+	this->unbucketed.clear();
+  this->mapping.clear();
+  this->bucketed.clear();
+
+  BucketTestInfo pp = this->p;
+
+  // allocate.
+  this->mapping.reserve(this->p.input_size);
+
+  imxx::local::assign_to_buckets(this->data, [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; },
+		  this->p.bucket_count,
+                                 this->bcounts, this->mapping, this->p.first, this->p.last);
+
+  if ((pp.bucket_count > 0) && (this->p.last <= this->p.input_size) && (this->p.first <= this->p.last) ) {
+	  imxx::local::radix_scatter(this->data, this->bcounts, this->mapping, this->bucketed, this->p.first, this->p.last);
+  }
+}
+
+TEST_P(BucketTest, radix_scatter_threaded)
+{
+	this->unbucketed.clear();
+  this->mapping.clear();
+  this->bucketed.clear();
+
+  BucketTestInfo pp = this->p;
+
+  // allocate.
+  this->mapping.reserve(this->p.input_size);
+
+  imxx::local::assign_to_buckets(this->data, [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; },
+		  this->p.bucket_count,
+                                 this->bcounts, this->mapping, this->p.first, this->p.last, 4);
+
+  if ((pp.bucket_count > 0) && (this->p.last <= this->p.input_size) && (this->p.first <= this->p.last) ) {
+	  imxx::local::radix_scatter(this->data, this->bcounts, this->mapping, this->bucketed, this->p.first, this->p.last, 4);
+  }
+}
+
 TEST_P(BucketTest, inplace_permute)
 {
 	this->unbucketed.clear();
@@ -467,3 +507,43 @@ INSTANTIATE_TEST_CASE_P(Bliss, BucketTest, ::testing::Values(
 
 
 
+
+
+template <typename T>
+void check_delta_roundtrip(std::vector<T> & data) {
+  std::sort(data.begin(), data.end(), imxx::local::word_view<T>());
+
+  std::vector<uint8_t> encoded;
+  imxx::local::delta_encode(data.begin(), data.end(), encoded);
+
+  std::vector<T> decoded(data.size());
+  uint8_t const * end = imxx::local::delta_decode(encoded.data(), data.size(), decoded.begin());
+  EXPECT_EQ(encoded.data() + encoded.size(), end);
+  EXPECT_TRUE(std::equal(data.begin(), data.end(), decoded.begin()));
+  // sorted, with repeats.
+  EXPECT_GT(data.size() * sizeof(T) / 2, encoded.size());
+}
+
+TEST(DeltaEncodeTest, roundtrip)
+{
+  srand(23);
+  std::vector<uint64_t> words;
+  std::vector<std::pair<uint32_t, uint32_t> > pairs;
+  uint64_t val;
+  for (size_t i = 0; i < 100000; ++i) {
+    val = rand() % 20000;
+    val <<= 32;
+    val |= rand();
+    for (int j = 0; j < 4; ++j) {
+      words.emplace_back(val);
+      pairs.emplace_back(static_cast<uint32_t>(val), static_cast<uint32_t>(val >> 32));
+    }
+  }
+  check_delta_roundtrip(words);
+  check_delta_roundtrip(pairs);
+
+  // empty range
+  std::vector<uint8_t> encoded;
+  imxx::local::delta_encode(words.begin(), words.begin(), encoded);
+  EXPECT_EQ(0UL, encoded.size());
+}
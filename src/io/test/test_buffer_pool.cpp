@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/buffer_pool.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+TEST(BufferPoolTest, reuse)
+{
+  ::imxx::buffer_pool pool;
+  uint64_t const * data = nullptr;
+  {
+    auto b = pool.acquire<uint64_t>(1000);
+    EXPECT_TRUE(b->empty());
+    b->resize(1000);
+    data = b->data();
+  }
+  EXPECT_EQ(1000 * sizeof(uint64_t), pool.bytes());
+
+  {
+    // same memory, cleared.
+    auto b = pool.acquire<uint64_t>(500);
+    EXPECT_TRUE(b->empty());
+    EXPECT_GE(b->capacity(), 1000UL);
+    EXPECT_EQ(data, b->data());
+    EXPECT_EQ(0UL, pool.bytes());
+
+    // other types have their own buffers.
+    auto c = pool.acquire<uint32_t>(10);
+    EXPECT_EQ(0UL, c->capacity());
+
+    // moved handles return the buffer once.
+    auto d = std::move(b);
+    EXPECT_EQ(data, d->data());
+  }
+  EXPECT_EQ(1000 * sizeof(uint64_t), pool.bytes());
+  EXPECT_EQ(1UL, pool.reused());
+
+  pool.clear();
+  EXPECT_EQ(0UL, pool.bytes());
+}
+
+TEST(BufferPoolTest, best_fit)
+{
+  ::imxx::buffer_pool pool(-1, 0);
+  {
+    auto a = pool.acquire<int>();
+    auto b = pool.acquire<int>();
+    auto c = pool.acquire<int>();
+    a->reserve(10);
+    b->reserve(100);
+    c->reserve(1000);
+  }
+  // smallest that fits, else the largest.
+  auto x = pool.acquire<int>(50);
+  EXPECT_EQ(100UL, x->capacity());
+  auto y = pool.acquire<int>(5000);
+  EXPECT_EQ(1000UL, y->capacity());
+  auto z = pool.acquire<int>(1);
+  EXPECT_EQ(10UL, z->capacity());
+}
+
+TEST(BufferPoolTest, trim_to_peak)
+{
+  ::imxx::buffer_pool pool(-1, 0);
+  {
+    auto a = pool.acquire<int>();
+    auto b = pool.acquire<int>();
+    auto c = pool.acquire<int>();
+    a->reserve(10);
+    b->reserve(100);
+    c->reserve(1000);
+  }
+  EXPECT_EQ(1110 * sizeof(int), pool.bytes());
+
+  // peak was 3 at once, so nothing is freed.
+  pool.trim();
+  EXPECT_EQ(1110 * sizeof(int), pool.bytes());
+
+  // 1 at a time since the last trim:  keep the largest.
+  for (int i = 0; i < 3; ++i) {
+    auto a = pool.acquire<int>(1000);
+  }
+  pool.trim();
+  EXPECT_EQ(1000 * sizeof(int), pool.bytes());
+}
+
+TEST(BufferPoolTest, max_bytes)
+{
+  ::imxx::buffer_pool pool(100 * sizeof(int), 0);
+  {
+    auto a = pool.acquire<int>();
+    auto b = pool.acquire<int>();
+    a->reserve(60);
+    b->reserve(60);
+  }
+  // the second returned buffer is above the cap, and is freed.
+  EXPECT_EQ(60 * sizeof(int), pool.bytes());
+
+  pool.set_max_bytes(10);
+  EXPECT_EQ(0UL, pool.bytes());
+}
+
+TEST(BufferPoolTest, default_cap)
+{
+  // a large buffer, e.g. of an insert, is freed when returned.  a small one is kept.
+  ::imxx::buffer_pool pool;
+  EXPECT_LT(pool.get_max_bytes(), 1UL << 30);
+  {
+    auto a = pool.acquire<uint64_t>();
+    a->reserve(pool.get_max_bytes() / sizeof(uint64_t) + 1);
+    auto b = pool.acquire<uint64_t>();
+    b->reserve(1000);
+  }
+  EXPECT_EQ(1000 * sizeof(uint64_t), pool.bytes());
+}
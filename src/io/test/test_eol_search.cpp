@@ -0,0 +1,125 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/file_loader.hpp"
+
+#include <string>
+#include <random>
+#include <vector>
+#include <list>
+#include <cstdint>  // uint32_t
+
+
+/// expose the protected search functions for testing.
+template <typename Iterator>
+class EOLSearchParser : public ::bliss::io::BaseFileParser<Iterator> {
+  public:
+    using ::bliss::io::BaseFileParser<Iterator>::findEOL;
+    using ::bliss::io::BaseFileParser<Iterator>::findNonEOL;
+    using ::bliss::io::BaseFileParser<Iterator>::findChar;
+};
+
+
+/**
+ * @brief test fixture for vectorized EOL search.  compares contiguous (vectorized) search to list iterator (1 char at a time) search.
+ */
+class EOLSearchTest : public ::testing::TestWithParam<size_t>
+{
+  protected:
+    std::vector<unsigned char> data;
+
+    virtual void SetUp()
+    {
+      // random text with sparse and clustered EOLs.
+      std::default_random_engine generator(GetParam());
+      std::uniform_int_distribution<int> distribution(0, 99);
+
+      data.resize(GetParam());
+      for (size_t i = 0; i < data.size(); ++i) {
+        int v = distribution(generator);
+        data[i] = (v == 0) ? '\n' : ((v == 1) ? '\r' : ((v < 10) ? '>' : 'A' + (v % 26)));
+      }
+    }
+};
+
+
+TEST_P(EOLSearchTest, findEOL)
+{
+  using VecIter = std::vector<unsigned char>::const_iterator;
+  using ListIter = std::list<unsigned char>::const_iterator;
+
+  std::list<unsigned char> gold(data.begin(), data.end());
+  EOLSearchParser<VecIter> parser;
+  EOLSearchParser<ListIter> gold_parser;
+
+  // start at every position for the first 64 bytes, so all alignments are covered.
+  for (size_t s = 0; s < std::min(data.size(), 64UL); ++s) {
+    VecIter it = data.cbegin() + s;
+    VecIter end = data.cend();
+    ListIter git = gold.cbegin();
+    std::advance(git, s);
+    ListIter gend = gold.cend();
+    size_t offset = s, goffset = s;
+
+    while (it != end) {
+      parser.findEOL(it, end, offset);
+      gold_parser.findEOL(git, gend, goffset);
+      ASSERT_EQ(goffset, offset);
+      ASSERT_EQ(std::distance(data.cbegin(), it), static_cast<long>(offset));
+
+      parser.findNonEOL(it, end, offset);
+      gold_parser.findNonEOL(git, gend, goffset);
+      ASSERT_EQ(goffset, offset);
+    }
+    ASSERT_TRUE(git == gend);
+  }
+}
+
+TEST_P(EOLSearchTest, findChar)
+{
+  using PtrIter = unsigned char const *;
+  using ListIter = std::list<unsigned char>::const_iterator;
+
+  std::list<unsigned char> gold(data.begin(), data.end());
+  EOLSearchParser<PtrIter> parser;
+  EOLSearchParser<ListIter> gold_parser;
+
+  PtrIter it = data.data();
+  PtrIter end = data.data() + data.size();
+  ListIter git = gold.cbegin();
+  ListIter gend = gold.cend();
+  size_t offset = 0, goffset = 0;
+
+  while (it != end) {
+    parser.findChar(it, end, offset, '\n');
+    gold_parser.findChar(git, gend, goffset, '\n');
+    ASSERT_EQ(goffset, offset);
+    ASSERT_EQ(static_cast<size_t>(it - data.data()), offset);
+
+    if (it != end) {
+      ++it; ++offset;
+      ++git; ++goffset;
+    }
+  }
+  ASSERT_TRUE(git == gend);
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, EOLSearchTest, ::testing::Values(
+    0UL, 1UL, 15UL, 16UL, 17UL, 31UL, 32UL, 33UL, 100UL, 1000UL, 65537UL
+));
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/kmer_balanced_partition.hpp"
+
+#include <string>
+#include <vector>
+#include <tuple>
+
+using kbp = ::bliss::io::kmer_balanced_partition;
+using range_type = kbp::range_type;
+
+
+// no weight:  same as block partition.
+TEST(KmerBalancedPartitionTest, no_weight)
+{
+  std::vector<size_t> b = kbp::split(std::vector<kbp::segment>(), range_type(0, 100), 4);
+
+  ASSERT_EQ(5UL, b.size());
+  EXPECT_EQ(0UL, b[0]);
+  EXPECT_EQ(25UL, b[1]);
+  EXPECT_EQ(50UL, b[2]);
+  EXPECT_EQ(75UL, b[3]);
+  EXPECT_EQ(100UL, b[4]);
+}
+
+// the dense second half gets 3 of the 4 parts.
+TEST(KmerBalancedPartitionTest, uneven_density)
+{
+  std::vector<kbp::segment> segs;
+  segs.push_back(kbp::segment{0, 100, 100.0});
+  segs.push_back(kbp::segment{100, 200, 300.0});
+
+  std::vector<size_t> b = kbp::split(segs, range_type(0, 200), 4);
+
+  ASSERT_EQ(5UL, b.size());
+  EXPECT_EQ(0UL, b[0]);
+  EXPECT_EQ(100UL, b[1]);
+  EXPECT_EQ(133UL, b[2]);
+  EXPECT_EQ(166UL, b[3]);
+  EXPECT_EQ(200UL, b[4]);
+}
+
+// unweighted gap, e.g. FASTA headers, and the minimum part size.
+TEST(KmerBalancedPartitionTest, gap_and_min_size)
+{
+  std::vector<kbp::segment> segs;
+  segs.push_back(kbp::segment{10, 20, 10.0});
+  segs.push_back(kbp::segment{900, 1000, 10.0});
+
+  std::vector<size_t> b = kbp::split(segs, range_type(0, 1000), 2);
+  ASSERT_EQ(3UL, b.size());
+  EXPECT_EQ(20UL, b[1]);
+
+  b = kbp::split(segs, range_type(0, 1000), 4, 100);
+  ASSERT_EQ(5UL, b.size());
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_LE(b[i] + 100, b[i + 1]);
+  }
+  EXPECT_EQ(1000UL, b[4]);
+}
+
+// fasta index entries: record start, sequence start, sequence end, id.
+TEST(KmerBalancedPartitionTest, fasta_segments)
+{
+  std::vector<::bliss::io::fasta_index::entry_type> entries;
+  entries.emplace_back(0, 10, 50, 0);
+  entries.emplace_back(50, 55, 58, 1);   // shorter than k
+  entries.emplace_back(58, 62, 1062, 2);
+
+  std::vector<kbp::segment> segs = kbp::fasta_segments(entries, 5);
+  ASSERT_EQ(3UL, segs.size());
+  EXPECT_EQ(10UL, segs[0].start);
+  EXPECT_EQ(50UL, segs[0].end);
+  EXPECT_DOUBLE_EQ(36.0, segs[0].weight);
+  EXPECT_DOUBLE_EQ(0.0, segs[1].weight);
+  EXPECT_DOUBLE_EQ(996.0, segs[2].weight);
+
+  // the long sequence gets both boundaries.
+  std::vector<size_t> b = kbp::split(segs, range_type(0, 1062), 3);
+  EXPECT_LT(62UL, b[1]);
+  EXPECT_LT(b[1], b[2]);
+}
+
+TEST(KmerBalancedPartitionTest, sample_fastq)
+{
+  std::string data = "@r1\nACGTACGT\n+\nIIIIIIII\n@r2 long header\nACG\n+r2\nIII\n@r3\nACGTA\n+\nIIIII";
+
+  // last record has no final line break.  complete only at the end of file.
+  kbp::fastq_sample s = kbp::sample_fastq(data.cbegin(), data.cend(), false, 4);
+  EXPECT_EQ(2UL, s.records);
+  EXPECT_EQ(5UL, s.kmers);
+  EXPECT_EQ(data.find("@r3"), s.bytes);
+  EXPECT_EQ(28UL, s.max_record);
+
+  s = kbp::sample_fastq(data.cbegin(), data.cend(), true, 4);
+  EXPECT_EQ(3UL, s.records);
+  EXPECT_EQ(7UL, s.kmers);
+  EXPECT_EQ(data.size(), s.bytes);
+
+  // truncated.
+  s = kbp::sample_fastq(data.cbegin(), data.cbegin() + 10, false, 4);
+  EXPECT_EQ(0UL, s.records);
+  EXPECT_EQ(0UL, s.bytes);
+}
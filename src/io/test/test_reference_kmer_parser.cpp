@@ -0,0 +1,263 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <memory>
+#include "iterators/filter_iterator.hpp"
+#include "io/kmer_parser.hpp"
+#include "io/fastq_loader.hpp"
+
+#include <string>
+#include <random>
+#include <vector>
+#include <deque>
+#include <utility>  // pair
+
+
+/// multiline records with LF and CRLF, parsed with the EOL copying fast paths and with the character iterators.
+TEST(ReferenceKmerParser, multiline)
+{
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  using TupleType = std::pair<KmerType, bliss::common::LongSequenceKmerId>;
+  using SeqType = bliss::common::Sequence<unsigned char const *>;
+
+  std::mt19937 gen(3);
+
+  for (int trial = 0; trial < 50; ++trial) {
+    std::string raw(">header\n");
+    size_t header = raw.size();
+    size_t len = 100 + gen() % 3000;
+    for (size_t i = 0; i < len; ++i) {
+      raw.push_back("ACGT"[gen() % 4]);
+      if (gen() % 60 == 0) raw.append((gen() % 2) ? "\n" : "\r\n");
+    }
+    raw.push_back('\n');
+
+    unsigned char const * data = reinterpret_cast<unsigned char const *>(raw.data());
+    SeqType seq(bliss::common::SequenceId(1000), raw.size(), header, header, data + header, data + raw.size());
+    // every third record ends in the overlap region.
+    bliss::partition::range<size_t> valid(1000, 1000 + raw.size() - ((trial % 3 == 0) ? 200 : 0));
+
+    // kmers
+    bliss::index::kmer::KmerParser<KmerType> kmer_parser(valid);
+    std::vector<KmerType> kmers, expected_kmers(kmer_parser.begin(seq), kmer_parser.end(seq));
+    kmer_parser(seq, fsc::back_emplace_iterator<std::vector<KmerType> >(kmers));
+    EXPECT_EQ(expected_kmers, kmers);
+
+    bliss::index::kmer::CanonicalKmerParser<KmerType> canonical_parser(valid);
+    std::vector<KmerType> canonical, expected_canonical(canonical_parser.begin(seq), canonical_parser.end(seq));
+    canonical_parser(seq, fsc::back_emplace_iterator<std::vector<KmerType> >(canonical));
+    EXPECT_EQ(expected_canonical, canonical);
+
+    // non contiguous characters, generated with the bulk fill on the character iterators.
+    std::deque<unsigned char> chars(data, data + raw.size());
+    bliss::common::Sequence<std::deque<unsigned char>::const_iterator> dseq(bliss::common::SequenceId(1000), raw.size(),
+                                                                              header, header, chars.cbegin() + header, chars.cend());
+    kmers.clear();
+    kmer_parser(dseq, fsc::back_emplace_iterator<std::vector<KmerType> >(kmers));
+    EXPECT_EQ(expected_kmers, kmers);
+    canonical.clear();
+    canonical_parser(dseq, fsc::back_emplace_iterator<std::vector<KmerType> >(canonical));
+    EXPECT_EQ(expected_canonical, canonical);
+
+    // kmer + positions, in file coordinates
+    bliss::index::kmer::KmerPositionTupleParser<TupleType> pos_parser(valid);
+    bliss::index::kmer::ReferenceKmerPositionParser<TupleType> ref_parser(valid);
+    std::vector<TupleType> expected(pos_parser.begin(seq), pos_parser.end(seq)), result, ref_result;
+    pos_parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(result));
+    ref_parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(ref_result));
+
+    ASSERT_EQ(expected_kmers.size(), expected.size());
+    EXPECT_TRUE(expected == result);
+    EXPECT_TRUE(expected == ref_result);
+  }
+}
+
+/// FASTQ reads, single and multiline, parsed with the contiguous kernel and with the character iterators.
+TEST(ReferenceKmerParser, position_quality)
+{
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using IdType = bliss::common::ShortSequenceKmerId;
+  using TupleType = std::pair<KmerType, std::pair<IdType, double> >;
+  using SeqType = bliss::io::FASTQSequence<unsigned char const *>;
+  using ParserType = bliss::index::kmer::KmerPositionQualityTupleParser<TupleType>;
+
+  std::mt19937 gen(7);
+
+  for (int trial = 0; trial < 20; ++trial) {
+    std::string seq_chars, qual_chars;
+    size_t len = 10 + gen() % 300;
+    for (size_t i = 0; i < len; ++i) {
+      seq_chars.push_back("ACGT"[gen() % 4]);
+      qual_chars.push_back(static_cast<char>('#' + gen() % 40));
+      // same line breaks in sequence and quality
+      if ((trial % 2 == 1) && (gen() % 50 == 0)) {
+        seq_chars.push_back('\n');
+        qual_chars.push_back('\n');
+      }
+    }
+    std::string raw = "@read\n" + seq_chars + "\n+\n" + qual_chars + "\n";
+    size_t header = 6;
+    size_t qual_start = header + seq_chars.size() + 3;
+
+    unsigned char const * data = reinterpret_cast<unsigned char const *>(raw.data());
+    SeqType seq(bliss::common::SequenceId(2000), raw.size(), header,
+                data + header, data + header + seq_chars.size(),
+                data + qual_start, data + qual_start + qual_chars.size());
+    bliss::partition::range<size_t> valid(2000, 2000 + raw.size());
+
+    ParserType parser(valid);
+    std::vector<TupleType> expected(parser.begin(seq), parser.end(seq)), result;
+    parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(result));
+
+    ASSERT_EQ(expected.size(), result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(expected[i].first, result[i].first);
+      EXPECT_EQ(expected[i].second.first, result[i].second.first);
+      EXPECT_NEAR(expected[i].second.second, result[i].second.second, 1e-9);
+    }
+  }
+}
+
+/// canonical kmers with the strand in the position's top bit.
+TEST(ReferenceKmerParser, canonical_positions)
+{
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using IdType = bliss::common::ShortSequenceKmerId;
+  using TupleType = std::pair<KmerType, IdType>;
+  using SeqType = bliss::common::Sequence<unsigned char const *>;
+  using strand = bliss::common::kmer_strand<IdType>;
+
+  std::mt19937 gen(5);
+  std::string raw("@read\n");
+  size_t header = raw.size();
+  for (size_t i = 0; i < 150; ++i) raw.push_back("ACGT"[gen() % 4]);
+  raw.push_back('\n');
+
+  unsigned char const * data = reinterpret_cast<unsigned char const *>(raw.data());
+  SeqType seq(bliss::common::SequenceId(5000, 0, 3), raw.size(), header, header, data + header, data + raw.size());
+  bliss::partition::range<size_t> valid(5000, 5000 + raw.size());
+
+  bliss::index::kmer::KmerPositionTupleParser<TupleType> pos_parser(valid);
+  bliss::index::kmer::CanonicalKmerPositionTupleParser<TupleType> canonical_parser(valid);
+  std::vector<TupleType> expected, result;
+  pos_parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(expected));
+  canonical_parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(result));
+
+  ASSERT_EQ(expected.size(), result.size());
+  size_t reversed = 0;
+  for (size_t i = 0; i < result.size(); ++i) {
+    KmerType rc = expected[i].first.reverse_complement();
+    bool rev = rc < expected[i].first;
+    EXPECT_EQ(rev ? rc : expected[i].first, result[i].first);
+    EXPECT_EQ(rev, strand::is_reverse(result[i].second));
+    EXPECT_EQ(expected[i].second, strand::forward(result[i].second));
+    EXPECT_EQ(3, strand::forward(result[i].second).get_file_id());
+    reversed += rev ? 1 : 0;
+  }
+  EXPECT_GT(reversed, 0UL);
+  EXPECT_LT(reversed, result.size());
+}
+
+/// quality trimming and kmer quality filtering at parse time, compared to parsing the trimmed read without filters.
+TEST(ReferenceKmerParser, quality_filter)
+{
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using IdType = bliss::common::ShortSequenceKmerId;
+  using TupleType = std::pair<KmerType, std::pair<IdType, double> >;
+  using CostTupleType = std::pair<KmerType, std::pair<IdType, uint16_t> >;
+  using SeqType = bliss::io::FASTQSequence<unsigned char const *>;
+  constexpr unsigned int trim = 10;
+  constexpr unsigned int min_kmer = 10;
+
+  std::mt19937 gen(11);
+  size_t kept = 0, filtered = 0;
+
+  for (int trial = 0; trial < 40; ++trial) {
+    std::string seq_chars, qual_chars;
+    size_t len = 10 + gen() % 200;
+    size_t low_front = gen() % 10, low_back = gen() % 10;
+    for (size_t i = 0; i < len; ++i) {
+      seq_chars.push_back("ACGT"[gen() % 4]);
+      bool low = (i < low_front) || ((i + low_back) >= len);
+      qual_chars.push_back(static_cast<char>('!' + (low ? gen() % trim : trim + gen() % 32)));
+      if ((trial % 2 == 1) && (gen() % 40 == 0)) {
+        seq_chars.push_back('\n');
+        qual_chars.push_back('\n');
+      }
+    }
+    std::string raw = "@read\n" + seq_chars + "\n+\n" + qual_chars + "\n";
+    size_t header = 6;
+    size_t qual_start = header + seq_chars.size() + 3;
+
+    unsigned char const * data = reinterpret_cast<unsigned char const *>(raw.data());
+    SeqType seq(bliss::common::SequenceId(3000), raw.size(), header,
+                data + header, data + header + seq_chars.size(),
+                data + qual_start, data + qual_start + qual_chars.size());
+    bliss::partition::range<size_t> valid(3000, 3000 + raw.size());
+
+    // trim by hand.
+    size_t first = seq_chars.size(), last = 0;
+    for (size_t i = 0; i < qual_chars.size(); ++i) {
+      if ((qual_chars[i] == '\n') || (static_cast<unsigned int>(qual_chars[i] - '!') < trim)) continue;
+      if (first == seq_chars.size()) first = i;
+      last = i + 1;
+    }
+    if (first == seq_chars.size()) first = last = 0;
+    SeqType trimmed(bliss::common::SequenceId(3000), raw.size(), header + first,
+                    data + header + first, data + header + last,
+                    data + qual_start + first, data + qual_start + last);
+
+    // kmer, position, and probability.
+    bliss::index::kmer::KmerPositionQualityTupleParser<TupleType> parser(valid);
+    bliss::index::kmer::KmerPositionQualityTupleParser<TupleType, bliss::index::Illumina18QualityScoreCodec,
+        trim, min_kmer> filter_parser(valid);
+    std::vector<TupleType> all, expected, result;
+    parser(trimmed, fsc::back_emplace_iterator<std::vector<TupleType> >(all));
+    double min_prob = 1.0 - std::pow(10.0, -static_cast<double>(min_kmer) / 10.0);
+    for (auto const & x : all) {
+      if (x.second.second >= min_prob) expected.emplace_back(x);
+    }
+    filter_parser(seq, fsc::back_emplace_iterator<std::vector<TupleType> >(result));
+
+    ASSERT_EQ(expected.size(), result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(expected[i].first, result[i].first);
+      EXPECT_EQ(expected[i].second.first, result[i].second.first);
+    }
+    kept += result.size();
+    filtered += all.size() - result.size();
+
+    // kmers only, with fixed point costs.
+    bliss::index::kmer::KmerPositionQualityTupleParser<CostTupleType> cost_parser(valid);
+    bliss::index::QualityThreshold<bliss::index::Illumina18QualityScoreCodec<uint16_t> > threshold(trim, min_kmer);
+    std::vector<CostTupleType> costs;
+    cost_parser(trimmed, fsc::back_emplace_iterator<std::vector<CostTupleType> >(costs));
+    std::vector<KmerType> expected_kmers, kmers;
+    for (auto const & x : costs) {
+      if (threshold.pass(x.second.second)) expected_kmers.emplace_back(x.first);
+    }
+    bliss::index::kmer::QualityFilteredKmerParser<KmerType, bliss::index::Illumina18QualityScoreCodec,
+        trim, min_kmer> kmer_parser(valid);
+    kmer_parser(seq, fsc::back_emplace_iterator<std::vector<KmerType> >(kmers));
+    EXPECT_EQ(expected_kmers, kmers);
+  }
+  EXPECT_GT(kept, 0UL);
+  EXPECT_GT(filtered, 0UL);
+}
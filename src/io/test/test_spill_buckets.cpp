@@ -0,0 +1,88 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/spill_buckets.hpp"
+
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+#include <algorithm>
+#include <unistd.h>  // access
+
+
+TEST(SpillBucketsTest, append_read)
+{
+  using V = std::pair<uint64_t, uint32_t>;
+  std::vector<V> input;
+  for (uint32_t i = 0; i < 10000; ++i) input.emplace_back(i * 7919ULL, i);
+
+  ::bliss::io::spill_buckets<V> spill("/tmp", 5, 100, 0);
+  auto bucket_of = [](V const & x) { return static_cast<size_t>(x.first % 5); };
+  spill.append(input, bucket_of);
+  spill.append(input, bucket_of);
+
+  size_t total = 0;
+  for (size_t b = 0; b < spill.bucket_count(); ++b) total += spill.size(b);
+  EXPECT_EQ(2 * input.size(), total);
+
+  spill.flush();
+  for (size_t b = 0; b < spill.bucket_count(); ++b) {
+    std::vector<V> gold;
+    for (auto const & x : input) if (bucket_of(x) == b) gold.emplace_back(x);
+    gold.insert(gold.end(), gold.begin(), gold.end());
+
+    std::vector<V> out;
+    spill.read(b, out);
+    EXPECT_EQ(gold, out);
+    EXPECT_EQ(0UL, spill.size(b));
+  }
+}
+
+TEST(SpillBucketsTest, buffered_only)
+{
+  // elements that never reached the file are returned too, after the written ones.
+  ::bliss::io::spill_buckets<uint32_t> spill("/tmp", 2, 4, 1);
+  for (uint32_t i = 0; i < 10; ++i) spill.push_back(i % 2, i);
+
+  std::vector<uint32_t> out;
+  spill.read(0, out);
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 6, 8}), out);
+  spill.read(1, out);
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 6, 8, 1, 3, 5, 7, 9}), out);
+}
+
+TEST(SpillBucketsTest, bad_dir)
+{
+  ::bliss::io::spill_buckets<uint32_t> spill("/nonexistent/spill", 1, 1, 0);
+  EXPECT_THROW(spill.push_back(0, 1), ::bliss::io::IOException);
+}
+
+TEST(SpillBucketsTest, append_range)
+{
+  ::bliss::io::spill_buckets<uint8_t> spill("/tmp", 2, 8, 2);
+  std::vector<uint8_t> gold;
+  for (uint8_t n = 1; n < 20; ++n) {
+    std::vector<uint8_t> bytes(n, n);
+    spill.append(n % 2, bytes.data(), bytes.size());
+    if (n % 2 == 1) gold.insert(gold.end(), bytes.begin(), bytes.end());
+  }
+  std::vector<uint8_t> out;
+  spill.read(1, out);
+  EXPECT_EQ(gold, out);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_synthetic_reads.cpp
+ * @ingroup bliss::io::test
+ * @brief   tests for the synthetic read generator
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include "io/synthetic_reads.hpp"
+
+
+/// split FASTQ text into sequence and quality lines
+static void split_fastq(std::string const & text, std::vector<std::string> & seqs, std::vector<std::string> & quals) {
+  std::stringstream ss(text);
+  std::string h, s, p, q;
+  while (std::getline(ss, h) && std::getline(ss, s) && std::getline(ss, p) && std::getline(ss, q)) {
+    EXPECT_EQ('@', h[0]);
+    EXPECT_EQ("+", p);
+    seqs.push_back(s);
+    quals.push_back(q);
+  }
+}
+
+TEST(SyntheticReads, deterministic_by_read_id)
+{
+  ::bliss::io::synthetic_read_params params;
+  params.read_len = 50;
+  params.sub_start = 0.01;
+  params.sub_end = 0.05;
+  params.seed = 7;
+  ::bliss::io::synthetic_reads gen(1000, params);
+
+  EXPECT_EQ(1000UL * 50 / 30, gen.get_genome_size());
+
+  // any block of reads is the same regardless of how the reads are split.
+  std::string all = gen.generate(0, 100);
+  std::string part = gen.generate(0, 40);
+  part.append(gen.generate(40, 60));
+  EXPECT_EQ(all, part);
+
+  std::vector<std::string> seqs, quals;
+  split_fastq(all, seqs, quals);
+  ASSERT_EQ(100UL, seqs.size());
+  for (size_t i = 0; i < seqs.size(); ++i) {
+    EXPECT_EQ(50UL, seqs[i].size());
+    EXPECT_EQ(50UL, quals[i].size());
+    EXPECT_EQ(std::string::npos, seqs[i].find_first_not_of("ACGT"));
+  }
+
+  // different seed, different reads.
+  params.seed = 8;
+  ::bliss::io::synthetic_reads gen2(1000, params);
+  EXPECT_NE(all, gen2.generate(0, 100));
+}
+
+TEST(SyntheticReads, error_and_n_rates)
+{
+  ::bliss::io::synthetic_read_params params;
+  params.read_len = 100;
+  params.seed = 3;
+  ::bliss::io::synthetic_reads exact(10000, params);
+
+  params.sub_start = 0.02;
+  params.sub_end = 0.02;
+  params.n_rate = 0.01;
+  ::bliss::io::synthetic_reads noisy(10000, params);
+
+  std::vector<std::string> es, eq, ns, nq;
+  split_fastq(exact.generate(0, 2000), es, eq);
+  split_fastq(noisy.generate(0, 2000), ns, nq);
+  ASSERT_EQ(es.size(), ns.size());
+
+  // without indels, the reads come from the same positions, so differences are errors.
+  size_t subs = 0, ns_count = 0, total = 0;
+  for (size_t i = 0; i < es.size(); ++i) {
+    ASSERT_EQ(es[i].size(), ns[i].size());
+    for (size_t j = 0; j < es[i].size(); ++j) {
+      ++total;
+      if (ns[i][j] == 'N') {
+        ++ns_count;
+        EXPECT_EQ('!', nq[i][j]);
+      } else if (ns[i][j] != es[i][j]) {
+        ++subs;
+        EXPECT_EQ('#', nq[i][j]);
+      }
+    }
+  }
+  double sub_rate = static_cast<double>(subs) / static_cast<double>(total);
+  double n_rate = static_cast<double>(ns_count) / static_cast<double>(total);
+  EXPECT_NEAR(0.02, sub_rate, 0.004);
+  EXPECT_NEAR(0.01, n_rate, 0.003);
+}
+
+TEST(SyntheticReads, repeats)
+{
+  ::bliss::io::synthetic_read_params params;
+  params.genome_size = 100000;
+  params.repeat_len = 100;
+  params.repeat_families = 1;
+  params.repeat_divergence = 0.0;
+  params.repeat_fraction = 0.5;
+  ::bliss::io::synthetic_reads gen(0, params);
+
+  // with 1 family and no divergence, all repeat blocks are identical.
+  std::vector<std::string> blocks;
+  for (uint64_t b = 0; b < 1000; ++b) {
+    std::string s;
+    for (uint64_t i = 0; i < 100; ++i) s.push_back("ACGT"[gen.genome_base(b * 100 + i)]);
+    blocks.push_back(s);
+  }
+  std::sort(blocks.begin(), blocks.end());
+  size_t max_copies = 0;
+  for (size_t i = 0; i < blocks.size(); ) {
+    size_t j = i;
+    while ((j < blocks.size()) && (blocks[j] == blocks[i])) ++j;
+    max_copies = std::max(max_copies, j - i);
+    i = j;
+  }
+  EXPECT_GT(max_copies, 400UL);
+  EXPECT_LT(max_copies, 600UL);
+}
+
+TEST(SyntheticReads, file_data_partition)
+{
+  ::bliss::io::synthetic_read_params params;
+  params.read_len = 30;
+  ::bliss::io::synthetic_reads gen(100, params);
+
+  std::string a = gen.generate(0, 50);
+  std::string b = gen.generate(50, 50);
+  size_t total = a.size() + b.size();
+
+  ::bliss::io::file_data fa = ::bliss::io::synthetic_reads::make_file_data(a, 0, total);
+  ::bliss::io::file_data fb = ::bliss::io::synthetic_reads::make_file_data(b, a.size(), total);
+
+  // valid ranges partition the file, and each after the first starts at an EOL.
+  EXPECT_EQ(0UL, fa.valid_range_bytes.start);
+  EXPECT_EQ(fa.valid_range_bytes.end, fb.valid_range_bytes.start);
+  EXPECT_EQ(total, fb.valid_range_bytes.end);
+  EXPECT_EQ('\n', *(fb.cbegin()));
+  EXPECT_EQ('@', *(fb.cbegin() + 1));
+  EXPECT_EQ(fb.in_mem_range_bytes.size(), fb.data.size());
+  EXPECT_EQ(fa.in_mem_range_bytes.size(), fa.data.size());
+
+  ::bliss::io::file_data whole = gen.generate_file_data(100);
+  EXPECT_EQ(total, whole.getRange().size());
+  EXPECT_TRUE(std::equal(fa.in_mem_cbegin(), fa.in_mem_cend(), whole.in_mem_cbegin()));
+}
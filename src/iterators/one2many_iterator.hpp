@@ -27,6 +27,7 @@
 #define BLISS_ITERATORS_ONE2MANY_ITERATOR_HPP
 
 #include <iterator>
+#include <algorithm>  // min
 
 #include "common/bit_ops.hpp"
 #include "utils/function_traits.hpp"
@@ -290,6 +291,34 @@ public:
     return *dynamic_cast<type*>(this);
   }
 
+  /**
+   * @brief     Bulk dereference: writes the values at the next n positions to out, and advances this iterator by n.
+   * @details   the base iterator is dereferenced once for all of its remaining offsets.  the caller guarantees that
+   *            there are at least n positions before the end.
+   *
+   * @return    the output iterator one past the last written value.
+   */
+  template <typename OutputIterator>
+  OutputIterator fill(OutputIterator out, difference_type n)
+  {
+    while (n > 0)
+    {
+      auto && v = *this->_base;
+      difference_type last = std::min(this->_m, this->_offset + n);
+      n -= last - this->_offset;
+      for (; this->_offset < last; ++this->_offset, ++out)
+      {
+        *out = this->_f(v, this->_offset);
+      }
+      if (this->_offset == this->_m)
+      {
+        ++this->_base;
+        this->_offset = 0;
+      }
+    }
+    return out;
+  }
+
   /****************************
    *  Bidirectional Iterator  *
    ****************************/
@@ -286,6 +286,39 @@ public:
     this->operator++();
     return tmp;
   }
+
+  /**
+   * @brief     Bulk dereference: writes the values at the next n positions to out, and advances this iterator by n.
+   * @details   same result as n calls to operator* and operator++, without the read-ahead check in each step.
+   *            the caller guarantees that there are at least n positions before the end.
+   *
+   * @return    the output iterator one past the last written value.
+   */
+  template <typename OutputIterator>
+  inline OutputIterator fill(OutputIterator out, difference_type n)
+  {
+    if (n <= 0) return out;
+
+    // the current element may already have been read by operator*
+    if (this->_leading == this->_next)
+    {
+      this->_window.next(this->_next);
+      ++(this->_trailing);
+    }
+    *out = this->_window.getValue();
+    ++out;
+
+    for (difference_type i = 1; i < n; ++i, ++out)
+    {
+      this->_window.next(this->_next);
+      ++(this->_trailing);
+      *out = this->_window.getValue();
+    }
+
+    this->_leading = this->_next;
+    return out;
+  }
+
 protected:
   /**
    * @brief Initializes the first window.
@@ -550,6 +583,37 @@ public:
     return tmp;
   }
 
+  /**
+   * @brief     Bulk dereference: writes the values at the next n positions to out, and advances this iterator by n.
+   * @details   same result as n calls to operator* and operator++, without the read-ahead check in each step.
+   *            the caller guarantees that there are at least n positions before the end.
+   *
+   * @return    the output iterator one past the last written value.
+   */
+  template <typename OutputIterator>
+  inline OutputIterator fill(OutputIterator out, difference_type n)
+  {
+    if (n <= 0) return out;
+
+    // the current element may already have been read by operator*
+    if (this->_leading == this->_next && this->_leading_offset == this->_next_offset)
+    {
+      this->_window.next(this->_next, this->_next_offset);
+    }
+    *out = this->_window.getValue();
+    ++out;
+
+    for (difference_type i = 1; i < n; ++i, ++out)
+    {
+      this->_window.next(this->_next, this->_next_offset);
+      *out = this->_window.getValue();
+    }
+
+    this->_leading = this->_next;
+    this->_leading_offset = this->_next_offset;
+    return out;
+  }
+
 protected:
   /**
    * @brief Initializes the first window.
@@ -29,6 +29,8 @@
 #include <stdexcept>
 #include <atomic>
 #include <cmath>
+#include <vector>
+#include <algorithm>  // min
 #include "bliss-config.hpp"
 #include <type_traits>
 #include "partition/range.hpp"
@@ -262,6 +264,8 @@ namespace bliss
      * @class BlockPartitioner
      * @brief A partition that creates equal sized partitions during division of the range.
      * @details   Each partition has a size that's guaranteed to be within 1 of each other in size.
+     *            Alternatively, configured with partition weights, each partition's size is proportional to its weight,
+     *            e.g. for processes on nodes of different speed (see rank_weights.hpp).
      *            inherits from base Partitioner using CRTP, and implements the detail impl for getNext and reset
      * @tparam Range  the range type used.
      */
@@ -300,6 +304,12 @@ namespace bliss
          */
         SizeType rem;
 
+        /**
+         * @var bounds
+         * @brief start of each partition, relative to src.start, and the src size.  empty if not weighted.
+         */
+        std::vector<SizeType> bounds;
+
 
       public:
 
@@ -344,12 +354,64 @@ namespace bliss
           this->rem = _src.size() - this->non_overlap_size * static_cast<SizeType>(this->nPartitions);
 
           this->nChunks = (chunk_size == 0 && !std::is_floating_point<SizeType>::value) ? this->rem : _nPartitions;
+          this->bounds.clear();
 
           resetImpl();
 
           return this->non_overlap_size;
         }
 
+        /**
+         * @brief configures the partitioner with sizes proportional to the partition weights.
+         * @param _src          range object to be partitioned.
+         * @param _nPartitions  the number of partitions to divide this range into
+         * @param _weights      positive weight of each partition.  if empty, the partitions are equal sized.
+         * @param _overlap_size   the size of the overlap region.
+         * @return updated non_overlap_size, of the equal sized partitions.
+         */
+        SizeType configure(const Range &_src, const size_t &_nPartitions,
+                           const std::vector<double> &_weights, const SizeType &_overlap_size = 0) {
+          SizeType result = this->configure(_src, _nPartitions, 1, _overlap_size);
+          if (_weights.empty()) return result;
+          if (_weights.size() != _nPartitions)
+            throw std::invalid_argument("ERROR: partitioner: need 1 weight per partition");
+
+          double total = 0;
+          for (auto w : _weights) {
+            if (!(w > 0)) throw std::invalid_argument("ERROR: partitioner: weights have to be positive");
+            total += w;
+          }
+
+          // floored prefix sums, so the ends meet and the last partition ends at src.end.
+          SizeType const len = _src.size();
+          this->bounds.resize(_nPartitions + 1);
+          this->bounds[0] = 0;
+          double prefix = 0;
+          for (size_t i = 0; i < _nPartitions; ++i) {
+            prefix += _weights[i];
+            this->bounds[i + 1] = (i + 1 == _nPartitions) ? len :
+                std::min(len, floorIfIntegral(static_cast<double>(len) * (prefix / total)));
+          }
+          return result;
+        }
+
+      protected:
+
+        /// round down for integral sizes.
+        static inline SizeType floorIfIntegral(double const & x) {
+          return std::is_floating_point<SizeType>::value ? static_cast<SizeType>(x) : static_cast<SizeType>(std::floor(x));
+        }
+
+        /// the range of a weighted partition, with the overlap.
+        Range computeWeightedRange(const size_t& partId) {
+          Range r(this->src.start + this->bounds[partId], this->src.start + this->bounds[partId + 1]);
+          if (static_cast<SizeType>(this->src.end - r.end) > this->overlap_size) r.end += this->overlap_size;
+          else r.end = this->src.end;
+          return r;
+        }
+
+      public:
+
       protected:
 
         /**
@@ -370,6 +432,8 @@ namespace bliss
 
           done[partId] = true;
 
+          if (!this->bounds.empty()) return computeWeightedRange(partId);
+
           // if just 1 partition, return.
           if (this->nPartitions == 1) {
 
@@ -409,6 +473,8 @@ namespace bliss
 
           done[partId] = true;
 
+          if (!this->bounds.empty()) return computeWeightedRange(partId);
+
           // if just 1 partition, return.
           if (this->nPartitions == 1) {
             return this->src;
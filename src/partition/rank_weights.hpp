@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    rank_weights.hpp
+ * @ingroup partition
+ * @brief   relative capacity of each process, for partitioning data across nodes of different speed or memory.
+ * @details with weights installed for a communicator, the file loaders split the file bytes with the weighted
+ *          BlockPartitioner, so a process with twice the weight reads twice the bytes, and the hashed maps created on
+ *          the communicator get a weighted table of virtual buckets (dsc::default_bucket_table).  install the weights
+ *          before creating the maps, or rebucket existing maps with set_bucket_table(get_bucket_table().remap(weights)).
+ *
+ *          weights are configured, e.g. from the node types of a job, or measured with
+ *          bliss::mxx::measure_rank_weights (utils/mxx_fast_comm.hpp).  installed per communicator, like the
+ *          pairwise schedules in io/comm_schedule.hpp, with the same weights on all ranks.
+ */
+#ifndef SRC_PARTITION_RANK_WEIGHTS_HPP_
+#define SRC_PARTITION_RANK_WEIGHTS_HPP_
+
+#include <vector>
+#include <map>
+#include <stdexcept>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+
+namespace bliss
+{
+  namespace partition
+  {
+
+    /// weights installed per communicator.  the same on all ranks.
+    class rank_weights {
+      protected:
+        std::map<MPI_Comm, std::vector<double> > weights;
+
+      public:
+        static rank_weights & instance() {
+          static rank_weights w;
+          return w;
+        }
+
+        /// set the weights of the ranks of comm, 1 positive weight per rank.  not collective.
+        void install(::mxx::comm const & comm, std::vector<double> const & w) {
+          if (w.size() != static_cast<size_t>(comm.size()))
+            throw std::invalid_argument("rank_weights: need 1 weight per rank.");
+          for (auto x : w)
+            if (!(x > 0)) throw std::invalid_argument("rank_weights: weights have to be positive.");
+          weights[static_cast<MPI_Comm>(comm)] = w;
+        }
+
+        void remove(::mxx::comm const & comm) { weights.erase(static_cast<MPI_Comm>(comm)); }
+
+        bool installed(::mxx::comm const & comm) const {
+          return !(get(comm).empty());
+        }
+
+        /// weights of comm, or empty for equal partitions.  a handle reused by a communicator of another size gets none.
+        std::vector<double> get(::mxx::comm const & comm) const {
+          auto it = weights.find(static_cast<MPI_Comm>(comm));
+          if ((it == weights.end()) || (it->second.size() != static_cast<size_t>(comm.size()))) return std::vector<double>();
+          return it->second;
+        }
+    };
+
+  } // namespace partition
+} // namespace bliss
+
+#endif /* SRC_PARTITION_RANK_WEIGHTS_HPP_ */
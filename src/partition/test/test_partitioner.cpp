@@ -559,3 +559,37 @@ typedef ::testing::Types<int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t,
     int64_t, size_t, float, double> PartitionTestTypes;
 //typedef ::testing::Types<size_t> PartitionTestTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PartitionTest, PartitionTestTypes);
+
+
+TEST(WeightedBlockPartitionTest, proportional)
+{
+  typedef bliss::partition::range<size_t> RangeType;
+  bliss::partition::BlockPartitioner<RangeType> part;
+
+  RangeType src(100, 1100);
+  std::vector<double> weights = {2.0, 1.0, 1.0, 0.5};
+  part.configure(src, weights.size(), weights);
+
+  // sizes proportional to the weights, and the blocks cover src.
+  std::vector<size_t> expected = {444, 222, 222, 112};
+  size_t start = src.start;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    RangeType r = part.getNext(i);
+    EXPECT_EQ(start, r.start);
+    EXPECT_EQ(expected[i], r.size());
+    start = r.end;
+  }
+  EXPECT_EQ(src.end, start);
+
+  // with overlap, except for the last block.
+  part.configure(src, weights.size(), weights, 5);
+  EXPECT_EQ(RangeType(100, 549), part.getNext(0));
+  EXPECT_EQ(RangeType(988, 1100), part.getNext(3));
+
+  // equal sized without weights.
+  part.configure(src, 4, std::vector<double>());
+  EXPECT_EQ(RangeType(350, 600), part.getNext(1));
+
+  EXPECT_THROW(part.configure(src, 3, weights), std::invalid_argument);
+  EXPECT_THROW(part.configure(src, 2, std::vector<double>({1.0, -1.0})), std::invalid_argument);
+}
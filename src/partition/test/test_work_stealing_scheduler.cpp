@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_work_stealing_scheduler.cpp
+ * @ingroup bliss::partition::test
+ * @brief   tests the work stealing scheduler:  every task and element is processed once, uneven work is stolen,
+ *          and task exceptions reach the caller.
+ */
+
+#include "bliss-config.hpp"
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <numeric>   // accumulate
+
+#include "partition/range.hpp"
+#include "partition/work_stealing_scheduler.hpp"
+
+using namespace bliss::partition;
+
+
+TEST(WorkStealingScheduler, run_tasks)
+{
+  work_stealing_scheduler sched(4);
+  EXPECT_EQ(4UL, sched.get_num_threads());
+
+  // reuse the pool.  also fewer tasks than threads.
+  for (size_t n : {0UL, 3UL, 1000UL}) {
+    std::vector<std::atomic<int> > hits(n);
+    for (auto & h : hits) h.store(0);
+
+    std::vector<work_stealing_scheduler::task_type> tasks;
+    for (size_t i = 0; i < n; ++i) tasks.emplace_back([&hits, i](size_t) { ++hits[i]; });
+
+    sched.reset_stats();
+    sched.run(tasks);
+
+    for (size_t i = 0; i < n; ++i) EXPECT_EQ(1, hits[i].load()) << "task " << i;
+    std::vector<size_t> executed = sched.get_executed();
+    EXPECT_EQ(n, std::accumulate(executed.begin(), executed.end(), 0UL));
+  }
+}
+
+TEST(WorkStealingScheduler, parallel_for)
+{
+  work_stealing_scheduler sched(3);
+
+  size_t n = 10007;
+  std::vector<std::atomic<int> > hits(n);
+  for (auto & h : hits) h.store(0);
+
+  auto mark = [&hits](range<size_t> const & r, size_t) {
+    for (size_t i = r.start; i < r.end; ++i) ++hits[i];
+  };
+
+  // without overlap, each element is in 1 chunk.
+  size_t chunks = sched.parallel_for(range<size_t>(0, n), 100UL, mark);
+  EXPECT_GE(chunks, (n + 99) / 100);
+  for (size_t i = 0; i < n; ++i) EXPECT_EQ(1, hits[i].load()) << "element " << i;
+
+  // with overlap, chunks extend into the next, but not past the end.
+  for (auto & h : hits) h.store(0);
+  std::atomic<size_t> max_len(0);
+  sched.parallel_for(range<size_t>(0, n), 100UL, [&](range<size_t> const & r, size_t id) {
+    mark(r, id);
+    size_t len = r.size();
+    size_t m = max_len.load();
+    while ((len > m) && !max_len.compare_exchange_weak(m, len)) {}
+  }, 20UL);
+  EXPECT_EQ(120UL, max_len.load());
+  for (size_t i = 0; i < n; ++i) EXPECT_GE(hits[i].load(), 1) << "element " << i;
+  EXPECT_EQ(1, hits[0].load());
+}
+
+TEST(WorkStealingScheduler, steal_uneven)
+{
+  work_stealing_scheduler sched(4);
+
+  // all the slow tasks are in the block of thread 0.  the other threads finish theirs and steal.
+  size_t n = 400;
+  std::vector<work_stealing_scheduler::task_type> tasks;
+  for (size_t i = 0; i < n; ++i) {
+    tasks.emplace_back([i, n](size_t) {
+      if (i < n / 4) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+  }
+
+  sched.reset_stats();
+  sched.run(tasks);
+
+  std::vector<size_t> stolen = sched.get_stolen();
+  std::vector<size_t> executed = sched.get_executed();
+  EXPECT_GT(std::accumulate(stolen.begin(), stolen.end(), 0UL), 0UL);
+  EXPECT_EQ(n, std::accumulate(executed.begin(), executed.end(), 0UL));
+  EXPECT_LT(executed[0], n / 4 + 1);
+}
+
+TEST(WorkStealingScheduler, exception)
+{
+  work_stealing_scheduler sched(2);
+
+  std::atomic<int> count(0);
+  std::vector<work_stealing_scheduler::task_type> tasks;
+  for (int i = 0; i < 100; ++i) {
+    tasks.emplace_back([&count, i](size_t) {
+      ++count;
+      if (i == 50) throw std::runtime_error("task failed");
+    });
+  }
+
+  EXPECT_THROW(sched.run(tasks), std::runtime_error);
+  // the other tasks still ran, and the pool is usable.
+  EXPECT_EQ(100, count.load());
+  sched.run(tasks = std::vector<work_stealing_scheduler::task_type>(10, [&count](size_t) { ++count; }));
+  EXPECT_EQ(110, count.load());
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    work_stealing_scheduler.hpp
+ * @ingroup bliss::partition
+ * @brief   per-rank thread pool with work-stealing deques, seeded with chunks from the partitioners.
+ * @details each thread owns a deque of tasks.  a thread runs tasks from the back of its own deque, and when that is empty,
+ *          steals from the front of another thread's deque, i.e. the tasks its owner would run last.  for a range, the
+ *          initial deques hold the chunks of each thread's BlockPartitioner block, enumerated by a DemandDrivenPartitioner,
+ *          so threads start on contiguous data and only move chunks when the work is uneven (e.g. FASTQ records of varying
+ *          length, or skewed kmer counts).
+ *
+ *          the calling thread is thread 0 and runs tasks as well.  the pool is created once and reused by each call.
+ *          calls are blocking, and not reentrant:  tasks must not call the scheduler.  the first exception thrown by a
+ *          task is rethrown by the call, after all tasks have finished.
+ *
+ *          deques are protected by 1 mutex each.  with chunks of thousands of records or kmers, the lock is not contended.
+ *
+ *          KmerFileHelper::fill_block generates the kmers of a block's sequences on it.
+ */
+#ifndef WORK_STEALING_SCHEDULER_HPP_
+#define WORK_STEALING_SCHEDULER_HPP_
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>  // min, max
+#include <memory>     // unique_ptr
+
+#include "partition/range.hpp"
+#include "partition/partitioner.hpp"
+
+namespace bliss
+{
+  namespace partition
+  {
+
+    /**
+     * @class work_stealing_scheduler
+     * @brief thread pool for the work of 1 rank.  tasks are called with the id of the thread that runs them.
+     */
+    class work_stealing_scheduler {
+      public:
+        /// a task.  parameter is the id of the thread running it, in [0, get_num_threads()).
+        using task_type = ::std::function<void(size_t)>;
+
+      protected:
+        /// deque of 1 thread, with its counters.
+        struct worker_queue {
+            ::std::mutex mutex;
+            ::std::deque<task_type> tasks;
+            size_t executed;
+            size_t stolen;
+        };
+
+        size_t nthreads;
+        ::std::vector<::std::unique_ptr<worker_queue> > queues;
+        ::std::vector<::std::thread> threads;
+
+        /// tasks of the current call not yet finished.
+        ::std::atomic<size_t> pending;
+
+        /// incremented for each call, to wake the threads.
+        size_t generation;
+        bool stop;
+        ::std::mutex wake_mutex;
+        ::std::condition_variable wake;
+
+        ::std::mutex error_mutex;
+        ::std::exception_ptr error;
+
+        /// pop from the back of own deque.
+        bool pop(size_t const & id, task_type & t) {
+          worker_queue & q = *(queues[id]);
+          ::std::lock_guard<::std::mutex> lock(q.mutex);
+          if (q.tasks.empty()) return false;
+          t = ::std::move(q.tasks.back());
+          q.tasks.pop_back();
+          return true;
+        }
+
+        /// steal from the front of the other deques, starting after own.
+        bool steal(size_t const & id, task_type & t) {
+          for (size_t i = 1; i < nthreads; ++i) {
+            worker_queue & q = *(queues[(id + i) % nthreads]);
+            ::std::lock_guard<::std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            t = ::std::move(q.tasks.front());
+            q.tasks.pop_front();
+            ++(queues[id]->stolen);
+            return true;
+          }
+          return false;
+        }
+
+        /// run tasks until all tasks of the current call are done.
+        void run_until_done(size_t const & id) {
+          task_type t;
+          while (pending.load(::std::memory_order_acquire) > 0) {
+            if (pop(id, t) || steal(id, t)) {
+              try {
+                t(id);
+              } catch (...) {
+                ::std::lock_guard<::std::mutex> lock(error_mutex);
+                if (!error) error = ::std::current_exception();
+              }
+              ++(queues[id]->executed);
+              pending.fetch_sub(1, ::std::memory_order_acq_rel);
+            } else {
+              // remaining tasks are running on other threads.
+              ::std::this_thread::yield();
+            }
+          }
+        }
+
+        void worker(size_t const id) {
+          size_t seen = 0;
+          while (true) {
+            {
+              ::std::unique_lock<::std::mutex> lock(wake_mutex);
+              wake.wait(lock, [this, &seen]() { return stop || (generation != seen); });
+              if (stop) return;
+              seen = generation;
+            }
+            run_until_done(id);
+          }
+        }
+
+        /// start the threads on the seeded deques, take part as thread 0, then rethrow the first task exception.
+        void execute(size_t const & count) {
+          if (count == 0) return;
+
+          error = nullptr;
+          pending.store(count, ::std::memory_order_release);
+          {
+            ::std::lock_guard<::std::mutex> lock(wake_mutex);
+            ++generation;
+          }
+          wake.notify_all();
+
+          run_until_done(0);
+
+          if (error) {
+            ::std::exception_ptr e = error;
+            error = nullptr;
+            ::std::rethrow_exception(e);
+          }
+        }
+
+      public:
+        /**
+         * @brief create the pool.
+         * @param _nthreads   number of threads including the calling thread.  0 for the hardware concurrency.
+         */
+        explicit work_stealing_scheduler(size_t const & _nthreads = 0) :
+          nthreads(_nthreads), pending(0), generation(0), stop(false), error(nullptr) {
+          if (nthreads == 0) nthreads = ::std::max(1U, ::std::thread::hardware_concurrency());
+
+          for (size_t i = 0; i < nthreads; ++i) {
+            queues.emplace_back(new worker_queue());
+            queues.back()->executed = 0;
+            queues.back()->stolen = 0;
+          }
+          for (size_t i = 1; i < nthreads; ++i) {
+            threads.emplace_back(&work_stealing_scheduler::worker, this, i);
+          }
+        }
+
+        work_stealing_scheduler(work_stealing_scheduler const &) = delete;
+        work_stealing_scheduler & operator=(work_stealing_scheduler const &) = delete;
+
+        ~work_stealing_scheduler() {
+          {
+            ::std::lock_guard<::std::mutex> lock(wake_mutex);
+            stop = true;
+          }
+          wake.notify_all();
+          for (auto & t : threads) t.join();
+        }
+
+        size_t get_num_threads() const {
+          return nthreads;
+        }
+
+        /**
+         * @brief run the tasks, and wait for them to finish.
+         * @details the tasks are split into contiguous blocks with BlockPartitioner, 1 per thread, and each thread runs its
+         *          block in order unless it is stolen.
+         */
+        void run(::std::vector<task_type> const & tasks) {
+          BlockPartitioner<range<size_t> > blocks;
+          blocks.configure(range<size_t>(0, tasks.size()), nthreads);
+
+          for (size_t t = 0; t < nthreads; ++t) {
+            range<size_t> b = blocks.getNext(t);
+            worker_queue & q = *(queues[t]);
+            ::std::lock_guard<::std::mutex> lock(q.mutex);
+            // the owner pops from the back, so push in reverse to run the block front to back.
+            for (size_t i = b.end; i > b.start; --i) q.tasks.emplace_back(tasks[i - 1]);
+          }
+
+          execute(tasks.size());
+        }
+
+        /**
+         * @brief call f(chunk, thread_id) for chunks of r, and wait for them to finish.
+         * @details r is split into 1 block per thread with BlockPartitioner, and each block into chunks of grain elements with
+         *          a DemandDrivenPartitioner.  each chunk is extended by overlap elements into the next, up to the end of r,
+         *          e.g. k - 1 for kmers spanning chunk boundaries.
+         * @return number of chunks.
+         */
+        template <typename T, typename F>
+        size_t parallel_for(range<T> const & r, T const & grain, F const & f, T const & overlap = 0) {
+          if (r.size() == 0) return 0;
+
+          BlockPartitioner<range<T> > blocks;
+          blocks.configure(r, nthreads);
+
+          size_t count = 0;
+          for (size_t t = 0; t < nthreads; ++t) {
+            range<T> b = blocks.getNext(t);
+            if (b.size() == 0) continue;
+
+            DemandDrivenPartitioner<range<T> > chunks;
+            chunks.configure(b, 1, ::std::max(grain, static_cast<T>(1)));
+
+            ::std::vector<task_type> local;
+            for (range<T> c = chunks.getNext(0); c.size() > 0; c = chunks.getNext(0)) {
+              c.end = (r.end - c.end > overlap) ? (c.end + overlap) : r.end;
+              local.emplace_back([c, &f](size_t id) { f(c, id); });
+            }
+
+            worker_queue & q = *(queues[t]);
+            ::std::lock_guard<::std::mutex> lock(q.mutex);
+            for (auto it = local.rbegin(); it != local.rend(); ++it) q.tasks.emplace_back(::std::move(*it));
+            count += local.size();
+          }
+
+          execute(count);
+          return count;
+        }
+
+        /// number of tasks run by each thread, since construction or reset_stats().
+        ::std::vector<size_t> get_executed() const {
+          ::std::vector<size_t> out;
+          for (auto const & q : queues) out.emplace_back(q->executed);
+          return out;
+        }
+
+        /// number of tasks stolen by each thread, since construction or reset_stats().
+        ::std::vector<size_t> get_stolen() const {
+          ::std::vector<size_t> out;
+          for (auto const & q : queues) out.emplace_back(q->stolen);
+          return out;
+        }
+
+        void reset_stats() {
+          for (auto & q : queues) {
+            q->executed = 0;
+            q->stolen = 0;
+          }
+        }
+    };
+
+  } /* namespace partition */
+} /* namespace bliss */
+
+#endif /* WORK_STEALING_SCHEDULER_HPP_ */
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    affinity.hpp
+ * @ingroup bliss::utils
+ * @brief   pins the ranks of a node and their worker threads to cores, and records the NUMA node each rank runs on.
+ * @details the topology (cores, their hardware threads, NUMA nodes and packages) comes from hwloc if built with
+ *          USE_HWLOC, else from sysfs, with each cpu taken as a core.  the cores available on a node are the union of
+ *          the cpus allowed to its ranks, so a launcher that binds each rank to 1 core does not limit the placement.
+ *
+ *          affinity_policy::compact gives each local rank a contiguous block of cores.  spread deals the ranks over
+ *          the NUMA nodes round robin, then gives each a block of its node's cores.  none keeps the launcher's
+ *          binding, and only records it.  pin_ranks sets the calling thread's affinity, which threads created later
+ *          inherit, so call it before the worker threads start.  pin_thread pins a worker to 1 core of its rank.
+ *
+ *          local_node() is the rank's NUMA node, or -1 if its cores span nodes.  it is published through
+ *          utils/numa_node.hpp, where the huge page allocator and mapped_data pick it up for their pages.
+ *          report(comm) prints the placement of all ranks as [AFFINITY] lines, e.g. in benchmark output via
+ *          BL_BENCH_AFFINITY(comm).
+ */
+#ifndef SRC_UTILS_AFFINITY_HPP_
+#define SRC_UTILS_AFFINITY_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sched.h>         // sched_getaffinity
+#include <pthread.h>       // pthread_setaffinity_np
+#include <unistd.h>        // gethostname, sysconf
+#include <dirent.h>
+#endif
+
+#if defined(USE_HWLOC)
+#include <hwloc.h>
+#endif
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "utils/numa_node.hpp"
+
+namespace bliss {
+
+  namespace utils {
+
+    enum class affinity_policy { none, compact, spread };
+
+    inline char const * to_string(affinity_policy const & p) {
+      return (p == affinity_policy::compact) ? "compact" : ((p == affinity_policy::spread) ? "spread" : "none");
+    }
+
+    /// "none", "compact" or "spread".  anything else is none.
+    inline affinity_policy parse_affinity_policy(std::string const & s) {
+      if (s == "compact") return affinity_policy::compact;
+      if (s == "spread") return affinity_policy::spread;
+      return affinity_policy::none;
+    }
+
+    /// parse a linux cpu list, e.g. "0-3,8,10-11".
+    inline std::vector<int> parse_cpulist(std::string const & s) {
+      std::vector<int> cpus;
+      std::stringstream ss(s);
+      std::string item;
+      while (std::getline(ss, item, ',')) {
+        if (item.empty() || (item[0] < '0') || (item[0] > '9')) continue;
+        size_t dash = item.find('-');
+        int first = atoi(item.c_str());
+        int last = (dash == std::string::npos) ? first : atoi(item.c_str() + dash + 1);
+        for (int c = first; c <= last; ++c) cpus.emplace_back(c);
+      }
+      return cpus;
+    }
+
+    /// cores of a machine, in topology order.
+    struct cpu_topology {
+        struct core {
+            int node;
+            int package;
+            /// os indices of the hardware threads.
+            std::vector<int> pus;
+        };
+        std::vector<core> cores;
+        bool from_hwloc;
+
+        cpu_topology() : from_hwloc(false) {}
+
+        /// number of distinct NUMA nodes.
+        size_t node_count() const {
+          std::vector<int> nodes;
+          for (auto const & c : cores) nodes.emplace_back(c.node);
+          std::sort(nodes.begin(), nodes.end());
+          return std::unique(nodes.begin(), nodes.end()) - nodes.begin();
+        }
+
+        /// topology of this machine.
+        static cpu_topology discover() {
+          cpu_topology topo;
+#if defined(USE_HWLOC)
+          hwloc_topology_t t;
+          if ((hwloc_topology_init(&t) == 0)) {
+#if HWLOC_API_VERSION >= 0x00020000
+            hwloc_topology_set_flags(t, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED);
+#else
+            hwloc_topology_set_flags(t, HWLOC_TOPOLOGY_FLAG_WHOLE_SYSTEM);
+#endif
+            if (hwloc_topology_load(t) == 0) {
+              int n = hwloc_get_nbobjs_by_type(t, HWLOC_OBJ_CORE);
+              for (int i = 0; i < n; ++i) {
+                hwloc_obj_t obj = hwloc_get_obj_by_type(t, HWLOC_OBJ_CORE, i);
+                core c;
+                c.node = (obj->nodeset == nullptr) ? 0 : std::max(0, hwloc_bitmap_first(obj->nodeset));
+                hwloc_obj_t pkg = hwloc_get_ancestor_obj_by_type(t, HWLOC_OBJ_PACKAGE, obj);
+                c.package = (pkg == nullptr) ? 0 : static_cast<int>(pkg->os_index);
+                unsigned int pu;
+                hwloc_bitmap_foreach_begin(pu, obj->cpuset)
+                  c.pus.emplace_back(static_cast<int>(pu));
+                hwloc_bitmap_foreach_end();
+                if (!c.pus.empty()) topo.cores.emplace_back(c);
+              }
+              topo.from_hwloc = !topo.cores.empty();
+            }
+            hwloc_topology_destroy(t);
+          }
+          if (topo.from_hwloc) return topo;
+#endif
+
+#if defined(__linux__)
+          // sysfs:  every online cpu is a core, on the node whose cpulist has it.
+          std::vector<int> node_of;
+          DIR * dir = opendir("/sys/devices/system/node");
+          if (dir != nullptr) {
+            struct dirent * entry;
+            while ((entry = readdir(dir)) != nullptr) {
+              std::string name(entry->d_name);
+              if ((name.compare(0, 4, "node") != 0) || (name.size() < 5) || (name[4] < '0') || (name[4] > '9')) continue;
+              int node = atoi(name.c_str() + 4);
+              std::ifstream f("/sys/devices/system/node/" + name + "/cpulist");
+              std::string list;
+              std::getline(f, list);
+              for (int cpu : parse_cpulist(list)) {
+                if (cpu >= static_cast<int>(node_of.size())) node_of.resize(cpu + 1, 0);
+                node_of[cpu] = node;
+              }
+            }
+            closedir(dir);
+          }
+          std::ifstream f("/sys/devices/system/cpu/online");
+          std::string list;
+          std::getline(f, list);
+          std::vector<int> cpus = parse_cpulist(list);
+          if (cpus.empty()) {
+            for (long i = 0; i < sysconf(_SC_NPROCESSORS_ONLN); ++i) cpus.emplace_back(i);
+          }
+          for (int cpu : cpus) {
+            core c;
+            c.node = (cpu < static_cast<int>(node_of.size())) ? node_of[cpu] : 0;
+            c.package = 0;
+            c.pus.emplace_back(cpu);
+            topo.cores.emplace_back(c);
+          }
+          std::stable_sort(topo.cores.begin(), topo.cores.end(), [](core const & x, core const & y) { return x.node < y.node; });
+#endif
+          return topo;
+        }
+    };
+
+    /**
+     * @brief the cores of 1 local rank, as indices into usable.
+     * @details  usable are the cores available on the node, in topology order, and nodes their NUMA nodes.  if there
+     *        are fewer cores than ranks, ranks share cores round robin.
+     */
+    inline std::vector<size_t> select_cores(std::vector<int> const & nodes, int const & local_rank, int const & local_size,
+                                            affinity_policy const & policy) {
+      std::vector<size_t> selected;
+      if (nodes.empty() || (local_size < 1) || (policy == affinity_policy::none)) return selected;
+
+      // the cores to divide, and this rank's position among the ranks dividing them.
+      std::vector<size_t> pool;
+      int position = local_rank;
+      int sharing = local_size;
+      if (policy == affinity_policy::spread) {
+        std::vector<int> distinct(nodes);
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        int n = static_cast<int>(distinct.size());
+        int node = distinct[local_rank % n];
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          if (nodes[i] == node) pool.emplace_back(i);
+        }
+        position = local_rank / n;
+        sharing = (local_size - 1 - (local_rank % n)) / n + 1;
+      } else {
+        for (size_t i = 0; i < nodes.size(); ++i) pool.emplace_back(i);
+      }
+
+      size_t per = pool.size() / sharing;
+      if (per == 0) {
+        selected.emplace_back(pool[position % pool.size()]);
+      } else {
+        // the first pool.size() % sharing ranks get 1 more core.
+        size_t extra = pool.size() % sharing;
+        size_t start = position * per + std::min(static_cast<size_t>(position), extra);
+        size_t count = per + ((static_cast<size_t>(position) < extra) ? 1 : 0);
+        selected.insert(selected.end(), pool.begin() + start, pool.begin() + start + count);
+      }
+      return selected;
+    }
+
+
+    /// placement of the ranks and threads of this process.  1 per process.
+    class affinity_manager {
+      protected:
+        cpu_topology topo;
+        /// cores of this rank.
+        std::vector<cpu_topology::core> cores;
+        affinity_policy policy;
+        int node;
+        bool pinned;
+
+        affinity_manager() : policy(affinity_policy::none), node(-1), pinned(false) {}
+
+        /// cpus the calling thread may run on.
+        static std::vector<int> allowed_cpus() {
+          std::vector<int> cpus;
+#if defined(__linux__)
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+              if (CPU_ISSET(c, &set)) cpus.emplace_back(c);
+            }
+          }
+#endif
+          return cpus;
+        }
+
+#if defined(__linux__)
+        static bool set_thread_affinity(std::vector<int> const & cpus) {
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          for (int c : cpus) {
+            if (c < CPU_SETSIZE) CPU_SET(c, &set);
+          }
+          return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+        }
+#endif
+
+        /// the node shared by all cores, or -1.
+        static int common_node(std::vector<cpu_topology::core> const & cs) {
+          if (cs.empty()) return -1;
+          for (auto const & c : cs) {
+            if (c.node != cs.front().node) return -1;
+          }
+          return cs.front().node;
+        }
+
+      public:
+        static affinity_manager & instance() {
+          static affinity_manager mgr;
+          return mgr;
+        }
+
+        /**
+         * @brief divide the cores of each node among its ranks, and pin the calling thread to this rank's cores.  collective.
+         * @details  with affinity_policy::none, or if the affinity cannot be set, the current binding is kept and recorded.
+         * @return  true if pinned.
+         */
+        bool pin_ranks(::mxx::comm const & comm, affinity_policy const & _policy) {
+          if (topo.cores.empty()) topo = cpu_topology::discover();
+          policy = _policy;
+
+          ::mxx::comm shared = comm.split_shared();
+          std::vector<int> allowed = allowed_cpus();
+          std::vector<int> node_allowed = (shared.size() > 1) ? ::mxx::allgatherv(allowed, shared) : allowed;
+          std::sort(node_allowed.begin(), node_allowed.end());
+          node_allowed.erase(std::unique(node_allowed.begin(), node_allowed.end()), node_allowed.end());
+
+          // cores with allowed cpus, restricted to them.
+          std::vector<cpu_topology::core> usable;
+          std::vector<int> nodes;
+          for (auto const & c : topo.cores) {
+            cpu_topology::core u = c;
+            u.pus.clear();
+            for (int pu : c.pus) {
+              if (std::binary_search(node_allowed.begin(), node_allowed.end(), pu)) u.pus.emplace_back(pu);
+            }
+            if (u.pus.empty()) continue;
+            usable.emplace_back(u);
+            nodes.emplace_back(u.node);
+          }
+
+          cores.clear();
+          pinned = false;
+          std::vector<size_t> selected = select_cores(nodes, shared.rank(), shared.size(), policy);
+          if (!selected.empty()) {
+            std::vector<int> cpus;
+            for (size_t i : selected) {
+              cores.emplace_back(usable[i]);
+              cpus.insert(cpus.end(), usable[i].pus.begin(), usable[i].pus.end());
+            }
+#if defined(__linux__)
+            pinned = set_thread_affinity(cpus);
+#endif
+          }
+          if (!pinned) {
+            // record the launcher's binding.
+            cores.clear();
+            for (auto const & c : usable) {
+              for (int pu : c.pus) {
+                if (std::binary_search(allowed.begin(), allowed.end(), pu)) {
+                  cores.emplace_back(c);
+                  break;
+                }
+              }
+            }
+          }
+          node = common_node(cores);
+          pinned_numa_node().store(node, std::memory_order_relaxed);
+          return pinned;
+        }
+
+        /// pin the calling worker thread to core tid (mod the rank's cores) of this rank.  no effect if the rank is not pinned.
+        bool pin_thread(int const & tid) {
+          if (!pinned || cores.empty()) return false;
+#if defined(__linux__)
+          return set_thread_affinity(cores[tid % cores.size()].pus);
+#else
+          return false;
+#endif
+        }
+
+        /// pin each thread of the OpenMP pool with pin_thread.
+        void pin_omp_threads() {
+#if defined(USE_OPENMP)
+#pragma omp parallel
+          {
+            pin_thread(omp_get_thread_num());
+          }
+#endif
+        }
+
+        /// NUMA node of this rank, or -1 if unknown or if the rank's cores span nodes.
+        int local_node() const { return node; }
+        bool is_pinned() const { return pinned; }
+        affinity_policy get_policy() const { return policy; }
+        cpu_topology const & get_topology() const { return topo; }
+
+        /// cpus of this rank.
+        std::vector<int> cpus() const {
+          std::vector<int> out;
+          for (auto const & c : cores) out.insert(out.end(), c.pus.begin(), c.pus.end());
+          std::sort(out.begin(), out.end());
+          return out;
+        }
+
+        /// placement of this rank:  "<host> rank <r> node <n> cpus <list>".
+        std::string describe(int const & rank) const {
+          char host[256] = {0};
+#if defined(__linux__)
+          gethostname(host, sizeof(host) - 1);
+#endif
+          std::vector<int> cs = cpus();
+          std::stringstream ss;
+          ss << host << " rank " << rank << " policy " << to_string(policy) << (pinned ? " pinned" : " unpinned")
+             << " node " << node << " cpus ";
+          // compress to ranges.
+          for (size_t i = 0; i < cs.size(); ) {
+            size_t j = i;
+            while ((j + 1 < cs.size()) && (cs[j + 1] == cs[j] + 1)) ++j;
+            if (i > 0) ss << ",";
+            ss << cs[i];
+            if (j > i) ss << "-" << cs[j];
+            i = j + 1;
+          }
+          return ss.str();
+        }
+
+        /// print the placement of all ranks on rank 0, as [AFFINITY] lines.  collective.
+        void report(::mxx::comm const & comm) const {
+          std::string local = describe(comm.rank());
+          std::vector<char> chars(local.begin(), local.end());
+          chars.emplace_back('\n');
+          std::vector<char> all = (comm.size() > 1) ? ::mxx::gatherv(chars, 0, comm) : chars;
+          if (comm.rank() == 0) {
+            std::stringstream ss(std::string(all.begin(), all.end()));
+            std::string line;
+            fflush(stdout);
+            while (std::getline(ss, line)) printf("[AFFINITY] %s\n", line.c_str());
+            fflush(stdout);
+          }
+        }
+    };
+
+
+  } // namespace utils
+} // namespace bliss
+
+#endif /* SRC_UTILS_AFFINITY_HPP_ */
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    async_logger.hpp
+ * @ingroup utils
+ * @brief   asynchronous log engine (USE_LOGGER == BLISS_LOGGING_ASYNC):  buffered per thread, written by a background thread.
+ * @details a log call formats the message and copies it into a lock free single producer ring of the calling thread,
+ *          so it does not wait for stdout, the file system, or the MPI launcher.  a background thread drains the rings
+ *          every BL_LOG_INTERVAL ms (default 100), or when a ring is half full, and writes the messages.
+ *          messages longer than a record are truncated.  when a ring is full, messages are dropped and counted, and
+ *          the count is logged with the next drain.
+ *
+ *          the output is configured by environment variables, read by start() (LOG_INIT()):
+ *            BL_LOG_FILE       if set, each rank writes to <BL_LOG_FILE>.<rank>.log instead of stdout.
+ *            BL_LOG_AGGREGATE  if set to n > 0, messages are kept until the collective aggregate(comm), which gathers them
+ *                              to the first rank of each group of n ranks for writing, so that only 1 in n ranks writes.
+ *                              messages not yet aggregated are written locally by stop().
+ *            BL_LOG_RING       records per thread ring, default 4096.
+ *            BL_LOG_INTERVAL   flush interval in ms.
+ *          lines are prefixed with the MPI rank if MPI is initialized at start().
+ */
+#ifndef SRC_UTILS_ASYNC_LOGGER_HPP_
+#define SRC_UTILS_ASYNC_LOGGER_HPP_
+
+#include "bliss-config.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>  // std::min
+#include <cstring>    // memcpy
+#include <cstdlib>    // getenv, strtoul
+#include <cstdint>
+#include <cstdio>
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#endif
+
+namespace bliss
+{
+
+namespace log
+{
+
+/// single producer, single consumer ring of fixed size log records.  lock free.
+class log_ring {
+  public:
+    /// 1 message.  256 bytes, so the ring is a flat array.
+    struct record {
+        uint32_t len;
+        char text[252];
+    };
+
+  protected:
+    std::vector<record> buf;
+    size_t mask;
+    /// number of records written.  only the producer stores.
+    std::atomic<size_t> head;
+    char pad0[64];
+    /// number of records read.  only the consumer stores.
+    std::atomic<size_t> tail;
+    char pad1[64];
+    std::atomic<size_t> dropped_count;
+
+  public:
+    /// capacity is rounded up to a power of 2.
+    explicit log_ring(size_t const & capacity) : head(0), tail(0), dropped_count(0) {
+      size_t cap = 1;
+      while (cap < capacity) cap <<= 1;
+      buf.resize(cap);
+      mask = cap - 1;
+    }
+
+    size_t capacity() const { return buf.size(); }
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+    /// producer.  false if the ring is full and the message is dropped.
+    bool push(char const * text, size_t const & len) {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) >= buf.size()) {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      record & r = buf[h & mask];
+      r.len = static_cast<uint32_t>(std::min(len, sizeof(r.text)));
+      memcpy(r.text, text, r.len);
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// consumer.  calls f(text, len) for each record, oldest first.  returns the number of records.
+    template <typename F>
+    size_t drain(F const & f) {
+      size_t t = tail.load(std::memory_order_relaxed);
+      size_t h = head.load(std::memory_order_acquire);
+      for (size_t i = t; i < h; ++i) f(buf[i & mask].text, buf[i & mask].len);
+      tail.store(h, std::memory_order_release);
+      return h - t;
+    }
+
+    /// number of messages dropped since the last call.
+    size_t take_dropped() { return dropped_count.exchange(0, std::memory_order_relaxed); }
+};
+
+
+class async_logger {
+  protected:
+    /// distinguishes instances for the thread local ring cache.
+    static std::atomic<uint64_t> & next_id() {
+      static std::atomic<uint64_t> id(1);
+      return id;
+    }
+
+    uint64_t id;
+
+    /// rings, 1 per logging thread.  kept until the logger is destroyed, since a thread may log again.
+    std::mutex rings_mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<log_ring> > rings;
+
+    /// serializes the consumers, i.e. the background thread and flush().
+    std::mutex drain_mutex;
+
+    std::thread flusher;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> running;
+
+    FILE * out;
+    bool own_out;
+    /// drained messages waiting for aggregate().
+    std::string pending;
+
+    std::string file_prefix;
+    int group;
+    size_t ring_capacity;
+    unsigned int interval_ms;
+    int rank;
+
+    log_ring & local_ring() {
+      struct cache { uint64_t owner; log_ring * ring; };
+      static thread_local cache c = {0, nullptr};
+      if (c.owner != id) {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        std::unique_ptr<log_ring> & r = rings[std::this_thread::get_id()];
+        if (!r) r.reset(new log_ring(ring_capacity));
+        c.owner = id;
+        c.ring = r.get();
+      }
+      return *(c.ring);
+    }
+
+    void append_line(std::string & dest, char const * text, size_t const & len) const {
+      if (rank >= 0) {
+        dest.push_back('[');
+        dest.append(std::to_string(rank));
+        dest.append("] ");
+      }
+      dest.append(text, len);
+      dest.push_back('\n');
+    }
+
+    void write_out(std::string const & text) {
+      if (text.empty()) return;
+      FILE * f = (out == nullptr) ? stdout : out;
+      fwrite(text.data(), 1, text.size(), f);
+      fflush(f);
+    }
+
+    /// move the messages of all rings to the output, or to pending when aggregating.
+    void drain() {
+      std::lock_guard<std::mutex> dlock(drain_mutex);
+
+      std::vector<log_ring *> all;
+      {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        all.reserve(rings.size());
+        for (auto & r : rings) all.push_back(r.second.get());
+      }
+
+      std::string text;
+      size_t dropped = 0;
+      for (auto r : all) {
+        r->drain([this, &text](char const * t, size_t const & len) { append_line(text, t, len); });
+        dropped += r->take_dropped();
+      }
+      if (dropped > 0) {
+        std::string msg("[warn ] async logger dropped ");
+        msg.append(std::to_string(dropped));
+        msg.append(" messages.  increase BL_LOG_RING.");
+        append_line(text, msg.data(), msg.size());
+      }
+
+      if (group > 0) pending.append(text);
+      else write_out(text);
+    }
+
+    void run() {
+      std::unique_lock<std::mutex> lock(wake_mutex);
+      while (running.load()) {
+        wake.wait_for(lock, std::chrono::milliseconds(interval_ms));
+        lock.unlock();
+        drain();
+        lock.lock();
+      }
+    }
+
+  public:
+    async_logger() : id(next_id().fetch_add(1)), running(false), out(nullptr), own_out(false),
+        group(0), ring_capacity(4096), interval_ms(100), rank(-1) {
+      char const * c = getenv("BL_LOG_FILE");
+      if (c != nullptr) file_prefix = c;
+      c = getenv("BL_LOG_AGGREGATE");
+      if (c != nullptr) group = static_cast<int>(strtoul(c, nullptr, 10));
+      c = getenv("BL_LOG_RING");
+      if (c != nullptr) ring_capacity = std::max(static_cast<size_t>(strtoul(c, nullptr, 10)), static_cast<size_t>(2));
+      c = getenv("BL_LOG_INTERVAL");
+      if (c != nullptr) interval_ms = std::max(static_cast<unsigned int>(strtoul(c, nullptr, 10)), 1U);
+    }
+
+    ~async_logger() {
+      stop();
+    }
+
+    static async_logger & instance() {
+      static async_logger logger;
+      return logger;
+    }
+
+    /// set the output, overriding the environment variables.  empty prefix is stdout, group 0 disables aggregation.  before start().
+    void configure(std::string const & prefix, int const & ranks_per_aggregator = 0) {
+      file_prefix = prefix;
+      group = ranks_per_aggregator;
+    }
+
+    bool is_running() const { return running.load(); }
+    int get_rank() const { return rank; }
+
+    /// open the output and start the background thread.  messages logged before are kept and written.
+    void start() {
+      if (running.load()) return;
+
+#if defined(USE_MPI)
+      int initialized = 0;
+      MPI_Initialized(&initialized);
+      if (initialized) MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+
+      if (!file_prefix.empty()) {
+        std::string fn(file_prefix);
+        fn.append(".");
+        fn.append(std::to_string(std::max(rank, 0)));
+        fn.append(".log");
+        out = fopen(fn.c_str(), "w");
+        if (out == nullptr) fprintf(stderr, "ERROR: cannot open log file %s.  logging to stdout\n", fn.c_str());
+        own_out = (out != nullptr);
+      }
+
+      running.store(true);
+      flusher = std::thread(&async_logger::run, this);
+    }
+
+    /// stop the background thread and write all messages, including those not yet aggregated.
+    void stop() {
+      if (running.exchange(false)) {
+        {
+          std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake.notify_one();
+        flusher.join();
+      }
+      drain();
+
+      std::lock_guard<std::mutex> dlock(drain_mutex);
+      write_out(pending);
+      pending.clear();
+      if (own_out) fclose(out);
+      out = nullptr;
+      own_out = false;
+    }
+
+    /// log 1 message, without end of line.  does not block.
+    void log(std::string const & msg) {
+      log_ring & r = local_ring();
+      r.push(msg.data(), msg.size());
+      // wake the flusher early instead of dropping.
+      if (running.load(std::memory_order_relaxed) && (r.size() * 2 >= r.capacity())) wake.notify_one();
+    }
+
+    /// write the messages logged so far, or move them to pending when aggregating.
+    void flush() {
+      drain();
+    }
+
+#if defined(USE_MPI)
+    /// gather the pending messages of each group of ranks to its first rank, which writes them in rank order.  collective.
+    void aggregate(::mxx::comm const & comm) {
+      drain();
+
+      std::vector<char> text;
+      {
+        std::lock_guard<std::mutex> dlock(drain_mutex);
+        text.assign(pending.begin(), pending.end());
+        pending.clear();
+      }
+
+      int n = (group > 0) ? group : comm.size();
+      ::mxx::comm sub = comm.split(comm.rank() / n, comm.rank());
+      std::vector<char> all = ::mxx::gatherv(text, 0, sub);
+      if (sub.rank() == 0) {
+        std::lock_guard<std::mutex> dlock(drain_mutex);
+        write_out(std::string(all.begin(), all.end()));
+      }
+    }
+#endif
+};
+
+} // namespace log
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_ASYNC_LOGGER_HPP_ */
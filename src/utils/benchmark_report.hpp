@@ -0,0 +1,243 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    benchmark_report.hpp
+ * @ingroup plog
+ * @brief   machine readable (JSON or CSV) output of the Timer and MemUsage reports.
+ * @details the reports of plog::Timer and plog::MemUsage are recorded, per (title, call site, phase), after the
+ *          reduction across ranks.  repeated reports of the same phase are aggregated:  the min and max are over all
+ *          calls, the means and counts are summed, so dur_mean / calls is the mean per call.
+ *
+ *          output is enabled by setting the environment variable BL_BENCH_OUTPUT to a file name.  the format is CSV
+ *          if the name ends in ".csv" or BL_BENCH_FORMAT is "csv", and JSON (an array of objects) otherwise.
+ *          the file is written by rank 0 at program exit, or by BenchReport::instance().write().
+ *          the human readable reports are printed as before.
+ */
+#ifndef SRC_UTILS_BENCHMARK_REPORT_HPP_
+#define SRC_UTILS_BENCHMARK_REPORT_HPP_
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <string>
+#include <limits>
+#include <algorithm>  // std::min, std::max
+#include <cstdlib>    // getenv
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace plog {
+
+class BenchReport {
+  public:
+    /// aggregated statistics of 1 phase.  durations in seconds, memory in bytes.
+    struct phase {
+        std::string title;
+        std::string site;
+        std::string name;
+        int ranks;
+        size_t calls;          // timer reports of this phase
+        double dur_min, dur_max, dur_mean;   // dur_mean summed over calls
+        double cnt_min, cnt_max, cnt_mean;   // cnt_mean summed over calls
+        size_t mem_calls;      // memory reports of this phase
+        double rss_delta_min, rss_delta_max, rss_delta_mean;   // change in current RSS during the phase.
+        double peak_max;
+
+        phase() : ranks(0), calls(0),
+            dur_min(std::numeric_limits<double>::max()), dur_max(0), dur_mean(0),
+            cnt_min(std::numeric_limits<double>::max()), cnt_max(0), cnt_mean(0),
+            mem_calls(0),
+            rss_delta_min(std::numeric_limits<double>::max()), rss_delta_max(std::numeric_limits<double>::lowest()),
+            rss_delta_mean(0), peak_max(0) {}
+
+        /// mean count per mean second, i.e. per rank element throughput.
+        double throughput() const { return (dur_mean > 0) ? cnt_mean / dur_mean : 0.0; }
+    };
+
+  protected:
+    typedef std::tuple<std::string, std::string, std::string> key_type;
+
+    std::map<key_type, size_t> index;
+    std::vector<phase> phases;   // in order of first report
+    std::string filename;
+    bool csv;
+    bool written;
+
+    phase & get(std::string const & title, std::string const & site, std::string const & name, int const & ranks) {
+      key_type k(title, site, name);
+      auto it = index.find(k);
+      if (it == index.end()) {
+        it = index.emplace(k, phases.size()).first;
+        phases.emplace_back();
+        phases.back().title = title;
+        phases.back().site = site;
+        phases.back().name = name;
+      }
+      phase & ph = phases[it->second];
+      ph.ranks = std::max(ph.ranks, ranks);
+      return ph;
+    }
+
+    static std::string json_escape(std::string const & s) {
+      std::string out;
+      for (char c : s) {
+        if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+        else if (static_cast<unsigned char>(c) < 0x20) out.push_back(' ');
+        else out.push_back(c);
+      }
+      return out;
+    }
+    static std::string csv_escape(std::string const & s) {
+      if (s.find_first_of(",\"\n") == std::string::npos) return s;
+      std::string out("\"");
+      for (char c : s) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+      }
+      out.push_back('"');
+      return out;
+    }
+    static double or_zero(double const & x) {
+      return (x == std::numeric_limits<double>::max() || x == std::numeric_limits<double>::lowest()) ? 0.0 : x;
+    }
+
+  public:
+    BenchReport() : csv(false), written(false) {
+      char const * f = getenv("BL_BENCH_OUTPUT");
+      if (f != nullptr) filename = f;
+      char const * fmt = getenv("BL_BENCH_FORMAT");
+      csv = (fmt != nullptr) ? (std::string(fmt) == "csv") :
+          (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0);
+    }
+
+    ~BenchReport() {
+      if (!written) write();
+    }
+
+    static BenchReport & instance() {
+      static BenchReport report;
+      return report;
+    }
+
+    bool enabled() const { return !filename.empty(); }
+
+    /// set the output file and format, overriding the environment variables.  empty filename disables output.
+    void set_output(std::string const & fn, bool const & as_csv) {
+      filename = fn;
+      csv = as_csv;
+    }
+
+    std::vector<phase> const & get_phases() const { return phases; }
+    void clear() { index.clear(); phases.clear(); }
+
+    /// record a timer report.  all vectors have 1 entry per phase, already reduced over the ranks.
+    void add_time(std::string const & title, std::string const & site, int const & ranks,
+                  std::vector<std::string> const & names,
+                  std::vector<double> const & dur_mins, std::vector<double> const & dur_maxs,
+                  std::vector<double> const & dur_means,
+                  std::vector<double> const & cnt_mins, std::vector<double> const & cnt_maxs,
+                  std::vector<double> const & cnt_means) {
+      for (size_t i = 0; i < names.size() && i < dur_mins.size(); ++i) {
+        phase & ph = get(title, site, names[i], ranks);
+        ++ph.calls;
+        ph.dur_min = std::min(ph.dur_min, dur_mins[i]);
+        ph.dur_max = std::max(ph.dur_max, dur_maxs[i]);
+        ph.dur_mean += dur_means[i];
+        ph.cnt_min = std::min(ph.cnt_min, cnt_mins[i]);
+        ph.cnt_max = std::max(ph.cnt_max, cnt_maxs[i]);
+        ph.cnt_mean += cnt_means[i];
+      }
+    }
+
+    /// record a memory report.  names[i] is the phase that ended with the RSS delta i.
+    void add_mem(std::string const & title, std::string const & site, int const & ranks,
+                 std::vector<std::string> const & names,
+                 std::vector<double> const & delta_mins, std::vector<double> const & delta_maxs,
+                 std::vector<double> const & delta_means, std::vector<double> const & peak_maxs) {
+      for (size_t i = 0; i < names.size() && i < delta_mins.size(); ++i) {
+        phase & ph = get(title, site, names[i], ranks);
+        ++ph.mem_calls;
+        ph.rss_delta_min = std::min(ph.rss_delta_min, delta_mins[i]);
+        ph.rss_delta_max = std::max(ph.rss_delta_max, delta_maxs[i]);
+        ph.rss_delta_mean += delta_means[i];
+        ph.peak_max = std::max(ph.peak_max, peak_maxs[i]);
+      }
+    }
+
+    /// format all phases as CSV, with a header line.
+    std::string to_csv() const {
+      std::stringstream output;
+      output.precision(9);
+      output << "title,site,phase,ranks,calls,dur_min,dur_max,dur_mean,cnt_min,cnt_max,cnt_mean,throughput,"
+             << "mem_calls,rss_delta_min,rss_delta_max,rss_delta_mean,peak_max" << std::endl;
+      for (auto const & ph : phases) {
+        output << csv_escape(ph.title) << "," << csv_escape(ph.site) << "," << csv_escape(ph.name) << ","
+            << ph.ranks << "," << ph.calls << ","
+            << or_zero(ph.dur_min) << "," << ph.dur_max << "," << ph.dur_mean << ","
+            << or_zero(ph.cnt_min) << "," << ph.cnt_max << "," << ph.cnt_mean << ","
+            << ph.throughput() << "," << ph.mem_calls << ","
+            << or_zero(ph.rss_delta_min) << "," << or_zero(ph.rss_delta_max) << "," << ph.rss_delta_mean << ","
+            << ph.peak_max << std::endl;
+      }
+      return output.str();
+    }
+
+    /// format all phases as a JSON array of objects.
+    std::string to_json() const {
+      std::stringstream output;
+      output.precision(9);
+      output << "[";
+      bool first = true;
+      for (auto const & ph : phases) {
+        output << (first ? "\n" : ",\n");
+        first = false;
+        output << "{\"title\":\"" << json_escape(ph.title) << "\",\"site\":\"" << json_escape(ph.site)
+            << "\",\"phase\":\"" << json_escape(ph.name) << "\",\"ranks\":" << ph.ranks
+            << ",\"calls\":" << ph.calls
+            << ",\"dur_min\":" << or_zero(ph.dur_min) << ",\"dur_max\":" << ph.dur_max << ",\"dur_mean\":" << ph.dur_mean
+            << ",\"cnt_min\":" << or_zero(ph.cnt_min) << ",\"cnt_max\":" << ph.cnt_max << ",\"cnt_mean\":" << ph.cnt_mean
+            << ",\"throughput\":" << ph.throughput()
+            << ",\"mem_calls\":" << ph.mem_calls
+            << ",\"rss_delta_min\":" << or_zero(ph.rss_delta_min) << ",\"rss_delta_max\":" << or_zero(ph.rss_delta_max)
+            << ",\"rss_delta_mean\":" << ph.rss_delta_mean << ",\"peak_max\":" << ph.peak_max << "}";
+      }
+      output << "\n]" << std::endl;
+      return output.str();
+    }
+
+    /// write the output file.  called by the reporting rank only, since only it has the reduced values.
+    void write() {
+      if (!enabled() || phases.empty()) return;
+      std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+      if (!ofs.is_open()) {
+        fprintf(stderr, "ERROR: cannot open benchmark output file %s\n", filename.c_str());
+        return;
+      }
+      ofs << (csv ? to_csv() : to_json());
+      written = true;
+    }
+};
+
+} // end namespace plog
+
+/// call site of a report, as "file:line".
+#define BL_BENCH_SITE_STR2(x) #x
+#define BL_BENCH_SITE_STR(x) BL_BENCH_SITE_STR2(x)
+#define BL_BENCH_SITE __FILE__ ":" BL_BENCH_SITE_STR(__LINE__)
+
+#endif /* SRC_UTILS_BENCHMARK_REPORT_HPP_ */
@@ -29,40 +29,53 @@
 
 #include "utils/timer.hpp"
 #include "utils/memory_usage.hpp"
+#include "utils/phase_trace.hpp"
+#include "utils/perf_counters.hpp"
+#include "utils/memory_bandwidth.hpp"
+#include "utils/affinity.hpp"
 
 #if BL_BENCHMARK == 1
 
-  #define BL_BENCH_INIT(title)                            BL_TIMER_INIT(title);  BL_MEMUSE_INIT(title); do { BL_MEMUSE_MARK(title, "begin");  } while (0)
-  #define BL_BENCH_RESET(title)                           do { BL_TIMER_RESET(title); BL_MEMUSE_RESET(title); } while (0)
+  #define BL_BENCH_INIT(title)                            BL_TIMER_INIT(title);  BL_MEMUSE_INIT(title); BL_TRACE_INIT(title) BL_PERF_INIT(title) BL_BW_INIT(title) do { BL_MEMUSE_MARK(title, "begin");  } while (0)
+  #define BL_BENCH_RESET(title)                           do { BL_TIMER_RESET(title); BL_MEMUSE_RESET(title); BL_PERF_RESET(title); BL_BW_RESET(title); } while (0)
   #define BL_BENCH_LOOP_START(title, id)                      do { BL_TIMER_LOOP_START(title, id); } while (0)
   #define BL_BENCH_LOOP_RESUME(title, id)                     do { BL_TIMER_LOOP_RESUME(title, id); } while (0)
   #define BL_BENCH_LOOP_PAUSE(title, id)                      do { BL_TIMER_LOOP_PAUSE(title, id); } while (0)
   #define BL_BENCH_LOOP_END(title, id, name, n_elem)          do { BL_TIMER_LOOP_END(title, id, name, n_elem); BL_MEMUSE_MARK(title, name); } while (0)
-  #define BL_BENCH_START(title)                           do { BL_TIMER_START(title); } while (0)
-  #define BL_BENCH_COLLECTIVE_START(title, name, comm)    do { BL_TIMER_COLLECTIVE_START(title, name, comm); } while (0)
-  #define BL_BENCH_COLLECTIVE_END(title, name, n_elem, comm)    do { BL_TIMER_COLLECTIVE_END(title, name, n_elem, comm); BL_MEMUSE_MARK(title, name); } while (0)
-  #define BL_BENCH_END(title, name, n_elem)               do { BL_TIMER_END(title, name, n_elem); BL_MEMUSE_MARK(title, name); } while (0)
-  #define BL_BENCH_REPORT(title, rank)                    do { BL_TIMER_REPORT(title); BL_MEMUSE_REPORT(title); } while (0)
-  #define BL_BENCH_REPORT_MPI(title, rank, comm)          do { BL_TIMER_REPORT_MPI(title, comm); BL_MEMUSE_REPORT_MPI(title, comm); } while (0)
-  #define BL_BENCH_REPORT_NAMED(title, name)                    do { BL_TIMER_REPORT_NAMED(title, name); BL_MEMUSE_REPORT_NAMED(title, name); } while (0)
-  #define BL_BENCH_REPORT_MPI_NAMED(title, name, comm)          do { BL_TIMER_REPORT_MPI_NAMED(title, name, comm); BL_MEMUSE_REPORT_MPI_NAMED(title, name, comm); } while (0)
+  #define BL_BENCH_START(title)                           do { BL_TIMER_START(title); BL_TRACE_START(title); BL_PERF_START(title); BL_BW_START(title); } while (0)
+  #define BL_BENCH_COLLECTIVE_START(title, name, comm)    do { BL_TIMER_COLLECTIVE_START(title, name, comm); BL_TRACE_START(title); BL_PERF_START(title); BL_BW_START(title); } while (0)
+  #define BL_BENCH_COLLECTIVE_END(title, name, n_elem, comm)    do { BL_PERF_END(title, name); BL_BW_END(title, name); BL_TIMER_COLLECTIVE_END(title, name, n_elem, comm); BL_TRACE_END(title, name); BL_MEMUSE_MARK(title, name); } while (0)
+  #define BL_BENCH_END(title, name, n_elem)               do { BL_PERF_END(title, name); BL_BW_END(title, name); BL_TIMER_END(title, name, n_elem); BL_TRACE_END(title, name); BL_MEMUSE_MARK(title, name); } while (0)
+  #define BL_BENCH_REPORT(title, rank)                    do { BL_TIMER_REPORT(title); BL_MEMUSE_REPORT(title); BL_PERF_REPORT(title); BL_BW_REPORT(title); } while (0)
+  #define BL_BENCH_REPORT_MPI(title, rank, comm)          do { BL_TIMER_REPORT_MPI(title, comm); BL_MEMUSE_REPORT_MPI(title, comm); BL_PERF_REPORT_MPI(title, comm); BL_BW_REPORT_MPI(title, comm); } while (0)
+  #define BL_BENCH_REPORT_NAMED(title, name)                    do { BL_TIMER_REPORT_NAMED(title, name); BL_MEMUSE_REPORT_NAMED(title, name); BL_PERF_REPORT_NAMED(title, name); BL_BW_REPORT_NAMED(title, name); } while (0)
+  #define BL_BENCH_REPORT_MPI_NAMED(title, name, comm)          do { BL_TIMER_REPORT_MPI_NAMED(title, name, comm); BL_MEMUSE_REPORT_MPI_NAMED(title, name, comm); BL_PERF_REPORT_MPI_NAMED(title, name, comm); BL_BW_REPORT_MPI_NAMED(title, name, comm); } while (0)
+  // bytes moved by the last ended phase, and the STREAM peak to compare with.  see memory_bandwidth.hpp
+  #define BL_BENCH_BYTES(title, bytes)                    BL_BW_BYTES(title, bytes)
+  #define BL_BENCH_PEAK_BANDWIDTH(comm)                   BL_BW_PEAK(comm)
+  // placement of the ranks, as set by affinity_manager::pin_ranks.  see affinity.hpp
+  #define BL_BENCH_AFFINITY(comm)                         do { ::bliss::utils::affinity_manager::instance().report(comm); } while (0)
 
 #else
 
-  #define BL_BENCH_INIT(title)
+  // phases are still traced (no barriers), see phase_trace.hpp
+  #define BL_BENCH_INIT(title)                            BL_TRACE_INIT(title)
   #define BL_BENCH_RESET(title)
   #define BL_BENCH_LOOP_START(title, id)
   #define BL_BENCH_LOOP_RESUME(title, id)
   #define BL_BENCH_LOOP_PAUSE(title, id)
   #define BL_BENCH_LOOP_END(title, id, name, n_elem)
-  #define BL_BENCH_START(title)
-  #define BL_BENCH_COLLECTIVE_START(title, name, comm)
-  #define BL_BENCH_COLLECTIVE_END(title, name, n_elem, comm)
-  #define BL_BENCH_END(title, name, n_elem)
+  #define BL_BENCH_START(title)                           BL_TRACE_START(title)
+  #define BL_BENCH_COLLECTIVE_START(title, name, comm)    BL_TRACE_START(title)
+  #define BL_BENCH_COLLECTIVE_END(title, name, n_elem, comm)    BL_TRACE_END(title, name)
+  #define BL_BENCH_END(title, name, n_elem)               BL_TRACE_END(title, name)
   #define BL_BENCH_REPORT(title, rank)
   #define BL_BENCH_REPORT_MPI(title, rank, comm)
   #define BL_BENCH_REPORT_NAMED(title, name)
   #define BL_BENCH_REPORT_MPI_NAMED(title, name, comm)
+  #define BL_BENCH_BYTES(title, bytes)
+  #define BL_BENCH_PEAK_BANDWIDTH(comm)
+  #define BL_BENCH_AFFINITY(comm)
 #endif
 
 #endif /* SRC_WIP_SYSTEM_UTILS_HPP_ */
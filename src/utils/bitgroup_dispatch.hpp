@@ -0,0 +1,411 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bitgroup_dispatch.hpp
+ * @ingroup utils
+ * @brief   runtime selection of SIMD bit group reversal for fixed size arrays.
+ * @details bitgroup_ops chooses SWAR/SSSE3/AVX2 at compile time from the compiler flags, so a binary built for the
+ *          oldest node in a cluster does not use AVX2 or AVX-512 on the newer nodes.  This file provides reverse
+ *          kernels for 1, 2, 3, and 4 bit groups, each compiled for its own instruction set via function target
+ *          attributes, independent of the compiler flags.  The CPU is checked once per array type, on first use,
+ *          and the best supported kernel is called through a function pointer from then on.
+ *
+ *          kernels:  SSSE3 for 9 to 16 bytes, AVX2 for 17 to 32 bytes, AVX-512 VBMI (with BW) for 33 to 64 bytes.
+ *          for other sizes, or if the CPU does not support the instruction set, or on non-x86 and non-GCC/clang
+ *          compilers, `reverse` returns false and the caller should use the compile time bitgroup_ops path.
+ *
+ *          Kmer uses this when compiled with USE_RUNTIME_SIMD_DISPATCH.
+ */
+#ifndef SRC_UTILS_BITGROUP_DISPATCH_HPP_
+#define SRC_UTILS_BITGROUP_DISPATCH_HPP_
+
+#include <cstdint>
+#include <cstring>       // memcpy
+#include <cstddef>
+#include <type_traits>  // enable_if
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__INTEL_COMPILER) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define BLISS_BITREV_DISPATCH 1
+#include <immintrin.h>   // all intrinsics are declared, irrespective of compiler flags.
+#endif
+
+namespace bliss {
+
+  namespace utils {
+
+    namespace bit_ops {
+
+      namespace dispatch {
+
+        /// instruction sets supported by the CPU that the binary is currently running on.  checked once.
+        struct cpu_features {
+            bool ssse3;
+            bool avx2;
+            bool avx512vbmi;
+
+            static cpu_features const & get() {
+              static const cpu_features features = detect();
+              return features;
+            }
+
+          protected:
+            static cpu_features detect() {
+              cpu_features f;
+#if defined(BLISS_BITREV_DISPATCH)
+              __builtin_cpu_init();
+              f.ssse3 = __builtin_cpu_supports("ssse3");
+              f.avx2 = __builtin_cpu_supports("avx2");
+              f.avx512vbmi = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                  __builtin_cpu_supports("avx512vbmi");
+#else
+              f.ssse3 = false;
+              f.avx2 = false;
+              f.avx512vbmi = false;
+#endif
+              return f;
+            }
+        };
+
+
+        namespace detail {
+
+          /// within-nibble reversal of BITS groups, for BITS = 1, 2, 4.  3 bits use 1 bit reversal then a group fix up.
+          template <unsigned int BITS>
+          struct nibble_rev {
+              static constexpr unsigned int g = (BITS == 3) ? 1 : BITS;
+
+              /// reverse the groups in a 4 bit value
+              static constexpr uint8_t rev(uint8_t n) {
+                return (g == 4) ? n :
+                    (g == 2) ? static_cast<uint8_t>(((n & 0x3) << 2) | (n >> 2)) :
+                        static_cast<uint8_t>(((n & 0x1) << 3) | ((n & 0x2) << 1) | ((n & 0x4) >> 1) | (n >> 3));
+              }
+              /// reversed low nibble goes to the high nibble, and vice versa.
+              static constexpr uint8_t lo(uint8_t n) { return static_cast<uint8_t>(rev(n) << 4); }
+              static constexpr uint8_t hi(uint8_t n) { return rev(n); }
+          };
+
+          /// mask of the bits in the 64 bit word at word_idx whose global bit position is congruent to r mod 3.
+          constexpr uint64_t mod3_mask(unsigned int r, unsigned int word_idx) {
+            // 64 = 1 mod 3, so the first such bit in the word is at (r - word_idx) mod 3.
+            return 0x9249249249249249ULL << ((r + 3 - (word_idx % 3)) % 3);
+          }
+
+#if defined(BLISS_BITREV_DISPATCH)
+
+#define BLISS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BLISS_TARGET_AVX2 __attribute__((target("avx2")))
+#define BLISS_TARGET_AVX512VBMI __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+          //================== SSSE3, up to 16 bytes
+
+          /// right shift all 128 bits by S, 0 < S < 64.
+          template <unsigned int S>
+          BLISS_TARGET_SSSE3 inline __m128i srl_128(__m128i const & x) {
+            return _mm_or_si128(_mm_srli_epi64(x, S), _mm_slli_epi64(_mm_srli_si128(x, 8), 64 - S));
+          }
+          template <unsigned int S>
+          BLISS_TARGET_SSSE3 inline __m128i sll_128(__m128i const & x) {
+            return _mm_or_si128(_mm_slli_epi64(x, S), _mm_srli_epi64(_mm_slli_si128(x, 8), 64 - S));
+          }
+
+          /// load BYTES bytes into the top of the register.  full registers are loaded directly, else via a buffer.
+          template <size_t BYTES>
+          BLISS_TARGET_SSSE3 inline __m128i load_top_128(uint8_t const * in) {
+            if (BYTES == 16) return _mm_loadu_si128(reinterpret_cast<__m128i const *>(in));
+            uint8_t buf[16] = {0};
+            memcpy(buf + 16 - BYTES, in, BYTES);
+            return _mm_loadu_si128(reinterpret_cast<__m128i const *>(buf));
+          }
+          /// store the lowest BYTES bytes.
+          template <size_t BYTES>
+          BLISS_TARGET_SSSE3 inline void store_128(uint8_t * out, __m128i const & x) {
+            if (BYTES == 16) {
+              _mm_storeu_si128(reinterpret_cast<__m128i *>(out), x);
+            } else {
+              uint8_t buf[16];
+              _mm_storeu_si128(reinterpret_cast<__m128i *>(buf), x);
+              memcpy(out, buf, BYTES);
+            }
+          }
+
+          template <unsigned int BITS, uint16_t PAD_BITS, bool NEGATE, size_t BYTES>
+          BLISS_TARGET_SSSE3 void reverse_ssse3(uint8_t * out, uint8_t const * in) {
+            static_assert(BYTES <= 16, "SSSE3 kernel supports up to 16 bytes");
+            using NR = nibble_rev<BITS>;
+
+            // place input at the top of the register so that full reversal puts it at the bottom.
+            __m128i x = load_top_128<BYTES>(in);
+
+            // reverse bytes, then the groups in each byte.
+            x = _mm_shuffle_epi8(x, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+            __m128i const nib = _mm_set1_epi8(0x0F);
+            __m128i lo = _mm_and_si128(x, nib);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nib);
+            x = _mm_or_si128(
+                _mm_shuffle_epi8(_mm_setr_epi8(NR::lo(0), NR::lo(1), NR::lo(2), NR::lo(3), NR::lo(4), NR::lo(5), NR::lo(6), NR::lo(7),
+                                               NR::lo(8), NR::lo(9), NR::lo(10), NR::lo(11), NR::lo(12), NR::lo(13), NR::lo(14), NR::lo(15)), lo),
+                _mm_shuffle_epi8(_mm_setr_epi8(NR::hi(0), NR::hi(1), NR::hi(2), NR::hi(3), NR::hi(4), NR::hi(5), NR::hi(6), NR::hi(7),
+                                               NR::hi(8), NR::hi(9), NR::hi(10), NR::hi(11), NR::hi(12), NR::hi(13), NR::hi(14), NR::hi(15)), hi));
+
+            if (NEGATE) {
+              // only the valid bytes.
+              __m128i valid = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(BYTES)),
+                                             _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+              x = _mm_xor_si128(x, valid);
+            }
+
+            // padding is now at the bottom.
+            if (PAD_BITS > 0) x = srl_128<(PAD_BITS > 0 ? PAD_BITS : 1)>(x);
+
+            if (BITS == 3) {
+              // bits within each 3 bit group are reversed.  swap the first and last bit of each group.
+              x = _mm_or_si128(_mm_and_si128(x, _mm_set_epi64x(mod3_mask(1, 1), mod3_mask(1, 0))),
+                  _mm_or_si128(_mm_and_si128(srl_128<2>(x), _mm_set_epi64x(mod3_mask(0, 1), mod3_mask(0, 0))),
+                               _mm_and_si128(sll_128<2>(x), _mm_set_epi64x(mod3_mask(2, 1), mod3_mask(2, 0)))));
+            }
+
+            store_128<BYTES>(out, x);
+          }
+
+
+          //================== AVX2, up to 32 bytes
+
+          /// next higher 64 bit word in each position, 0 at top.
+          BLISS_TARGET_AVX2 inline __m256i next_qword_256(__m256i const & x) {
+            return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0xF9), _mm256_setzero_si256(), 0xC0);  // 3 3 2 1
+          }
+          /// next lower 64 bit word in each position, 0 at bottom.
+          BLISS_TARGET_AVX2 inline __m256i prev_qword_256(__m256i const & x) {
+            return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), _mm256_setzero_si256(), 0x03);  // 2 1 0 0
+          }
+          template <unsigned int S>
+          BLISS_TARGET_AVX2 inline __m256i srl_256(__m256i const & x) {
+            return _mm256_or_si256(_mm256_srli_epi64(x, S), _mm256_slli_epi64(next_qword_256(x), 64 - S));
+          }
+          template <unsigned int S>
+          BLISS_TARGET_AVX2 inline __m256i sll_256(__m256i const & x) {
+            return _mm256_or_si256(_mm256_slli_epi64(x, S), _mm256_srli_epi64(prev_qword_256(x), 64 - S));
+          }
+
+          /// load BYTES bytes into the top of the register.  24 and 32 bytes (3 and 4 words) are loaded directly, else via a buffer.
+          template <size_t BYTES>
+          BLISS_TARGET_AVX2 inline __m256i load_top_256(uint8_t const * in) {
+            if (BYTES == 32) return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in));
+            if (BYTES == 24) return _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_slli_si128(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(in)), 8)),
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 8)), 1);
+            uint8_t buf[32] = {0};
+            memcpy(buf + 32 - BYTES, in, BYTES);
+            return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(buf));
+          }
+          /// store the lowest BYTES bytes.
+          template <size_t BYTES>
+          BLISS_TARGET_AVX2 inline void store_256(uint8_t * out, __m256i const & x) {
+            if (BYTES == 32) {
+              _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), x);
+            } else if (BYTES == 24) {
+              _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(x));
+              _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 16), _mm256_extracti128_si256(x, 1));
+            } else {
+              uint8_t buf[32];
+              _mm256_storeu_si256(reinterpret_cast<__m256i *>(buf), x);
+              memcpy(out, buf, BYTES);
+            }
+          }
+
+          template <unsigned int BITS, uint16_t PAD_BITS, bool NEGATE, size_t BYTES>
+          BLISS_TARGET_AVX2 void reverse_avx2(uint8_t * out, uint8_t const * in) {
+            static_assert(BYTES <= 32, "AVX2 kernel supports up to 32 bytes");
+            using NR = nibble_rev<BITS>;
+
+            __m256i x = load_top_256<BYTES>(in);
+
+            // reverse bytes in each lane, then swap the lanes.
+            x = _mm256_shuffle_epi8(x, _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                                        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+            x = _mm256_permute4x64_epi64(x, 0x4E);
+
+            __m256i const nib = _mm256_set1_epi8(0x0F);
+            __m256i lo = _mm256_and_si256(x, nib);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+            __m256i lo_lut = _mm256_broadcastsi128_si256(
+                _mm_setr_epi8(NR::lo(0), NR::lo(1), NR::lo(2), NR::lo(3), NR::lo(4), NR::lo(5), NR::lo(6), NR::lo(7),
+                              NR::lo(8), NR::lo(9), NR::lo(10), NR::lo(11), NR::lo(12), NR::lo(13), NR::lo(14), NR::lo(15)));
+            __m256i hi_lut = _mm256_broadcastsi128_si256(
+                _mm_setr_epi8(NR::hi(0), NR::hi(1), NR::hi(2), NR::hi(3), NR::hi(4), NR::hi(5), NR::hi(6), NR::hi(7),
+                              NR::hi(8), NR::hi(9), NR::hi(10), NR::hi(11), NR::hi(12), NR::hi(13), NR::hi(14), NR::hi(15)));
+            x = _mm256_or_si256(_mm256_shuffle_epi8(lo_lut, lo), _mm256_shuffle_epi8(hi_lut, hi));
+
+            if (NEGATE) {
+              __m256i valid = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(BYTES)),
+                                                _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                                                 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31));
+              x = _mm256_xor_si256(x, valid);
+            }
+
+            if (PAD_BITS > 0) x = srl_256<(PAD_BITS > 0 ? PAD_BITS : 1)>(x);
+
+            if (BITS == 3) {
+              x = _mm256_or_si256(_mm256_and_si256(x, _mm256_set_epi64x(mod3_mask(1, 3), mod3_mask(1, 2), mod3_mask(1, 1), mod3_mask(1, 0))),
+                  _mm256_or_si256(_mm256_and_si256(srl_256<2>(x), _mm256_set_epi64x(mod3_mask(0, 3), mod3_mask(0, 2), mod3_mask(0, 1), mod3_mask(0, 0))),
+                                  _mm256_and_si256(sll_256<2>(x), _mm256_set_epi64x(mod3_mask(2, 3), mod3_mask(2, 2), mod3_mask(2, 1), mod3_mask(2, 0)))));
+            }
+
+            store_256<BYTES>(out, x);
+          }
+
+
+          //================== AVX-512 VBMI, up to 64 bytes
+
+          // gcc reports _mm512_undefined_epi32() in the intrinsics as uninitialized when AVX-512 is enabled by target attribute only.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+          template <unsigned int S>
+          BLISS_TARGET_AVX512VBMI inline __m512i srl_512(__m512i const & x) {
+            return _mm512_or_si512(_mm512_srli_epi64(x, S),
+                                   _mm512_slli_epi64(_mm512_alignr_epi64(_mm512_setzero_si512(), x, 1), 64 - S));
+          }
+          template <unsigned int S>
+          BLISS_TARGET_AVX512VBMI inline __m512i sll_512(__m512i const & x) {
+            return _mm512_or_si512(_mm512_slli_epi64(x, S),
+                                   _mm512_srli_epi64(_mm512_alignr_epi64(x, _mm512_setzero_si512(), 7), 64 - S));
+          }
+          template <unsigned int R>
+          BLISS_TARGET_AVX512VBMI inline __m512i mod3_mask_512() {
+            return _mm512_set_epi64(mod3_mask(R, 7), mod3_mask(R, 6), mod3_mask(R, 5), mod3_mask(R, 4),
+                                    mod3_mask(R, 3), mod3_mask(R, 2), mod3_mask(R, 1), mod3_mask(R, 0));
+          }
+
+          template <unsigned int BITS, uint16_t PAD_BITS, bool NEGATE, size_t BYTES>
+          BLISS_TARGET_AVX512VBMI void reverse_avx512vbmi(uint8_t * out, uint8_t const * in) {
+            static_assert(BYTES <= 64, "AVX512 kernel supports up to 64 bytes");
+            using NR = nibble_rev<BITS>;
+
+            __mmask64 const valid = (BYTES == 64) ? ~(0ULL) : ((1ULL << (BYTES & 63)) - 1);
+            __m512i x = (BYTES == 64) ? _mm512_loadu_si512(in) :
+                ((BYTES & 7) == 0) ? _mm512_maskz_loadu_epi64(static_cast<__mmask8>((1U << (BYTES >> 3)) - 1), in) :
+                    _mm512_maskz_loadu_epi8(valid, in);
+
+            // reverse the bytes:  output byte j is input byte BYTES - 1 - j.   bytes above BYTES are zeroed.
+            __m512i idx = _mm512_sub_epi8(_mm512_set1_epi8(static_cast<char>(BYTES - 1)),
+                                          _mm512_set_epi64(0x3F3E3D3C3B3A3938ULL, 0x3736353433323130ULL,
+                                                           0x2F2E2D2C2B2A2928ULL, 0x2726252423222120ULL,
+                                                           0x1F1E1D1C1B1A1918ULL, 0x1716151413121110ULL,
+                                                           0x0F0E0D0C0B0A0908ULL, 0x0706050403020100ULL));
+            x = _mm512_maskz_permutexvar_epi8(valid, idx, x);
+
+            __m512i const nib = _mm512_set1_epi8(0x0F);
+            __m512i lo = _mm512_and_si512(x, nib);
+            __m512i hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), nib);
+            __m512i lo_lut = _mm512_maskz_broadcast_i32x4(0xFFFF, 
+                _mm_setr_epi8(NR::lo(0), NR::lo(1), NR::lo(2), NR::lo(3), NR::lo(4), NR::lo(5), NR::lo(6), NR::lo(7),
+                              NR::lo(8), NR::lo(9), NR::lo(10), NR::lo(11), NR::lo(12), NR::lo(13), NR::lo(14), NR::lo(15)));
+            __m512i hi_lut = _mm512_maskz_broadcast_i32x4(0xFFFF, 
+                _mm_setr_epi8(NR::hi(0), NR::hi(1), NR::hi(2), NR::hi(3), NR::hi(4), NR::hi(5), NR::hi(6), NR::hi(7),
+                              NR::hi(8), NR::hi(9), NR::hi(10), NR::hi(11), NR::hi(12), NR::hi(13), NR::hi(14), NR::hi(15)));
+            x = _mm512_or_si512(_mm512_shuffle_epi8(lo_lut, lo), _mm512_shuffle_epi8(hi_lut, hi));
+
+            if (NEGATE) x = _mm512_maskz_mov_epi8(valid, _mm512_ternarylogic_epi32(x, x, x, 0x55));  // not x
+
+            if (PAD_BITS > 0) x = srl_512<(PAD_BITS > 0 ? PAD_BITS : 1)>(x);
+
+            if (BITS == 3) {
+              x = _mm512_or_si512(_mm512_and_si512(x, mod3_mask_512<1>()),
+                  _mm512_or_si512(_mm512_and_si512(srl_512<2>(x), mod3_mask_512<0>()),
+                                  _mm512_and_si512(sll_512<2>(x), mod3_mask_512<2>())));
+            }
+
+            if (BYTES == 64) _mm512_storeu_si512(out, x);
+            else if ((BYTES & 7) == 0) _mm512_mask_storeu_epi64(out, static_cast<__mmask8>((1U << (BYTES >> 3)) - 1), x);
+            else _mm512_mask_storeu_epi8(out, valid, x);
+          }
+
+#pragma GCC diagnostic pop
+
+#undef BLISS_TARGET_SSSE3
+#undef BLISS_TARGET_AVX2
+#undef BLISS_TARGET_AVX512VBMI
+
+#endif  // BLISS_BITREV_DISPATCH
+
+          /// kernel function type
+          typedef void (*reverse_fn)(uint8_t *, uint8_t const *);
+
+          /// choose the kernel for an array of BYTES bytes given the CPU features.  nullptr if none applies.
+          template <unsigned int BITS, uint16_t PAD_BITS, bool NEGATE, size_t BYTES>
+          reverse_fn select_reverse() {
+#if defined(BLISS_BITREV_DISPATCH)
+            cpu_features const & f = cpu_features::get();
+            if ((BYTES > 8) && (BYTES <= 16) && f.ssse3)
+              return &reverse_ssse3<BITS, PAD_BITS, NEGATE, (BYTES <= 16 ? BYTES : 16)>;
+            if ((BYTES > 16) && (BYTES <= 32) && f.avx2)
+              return &reverse_avx2<BITS, PAD_BITS, NEGATE, (BYTES <= 32 ? BYTES : 32)>;
+            if ((BYTES > 32) && (BYTES <= 64) && f.avx512vbmi)
+              return &reverse_avx512vbmi<BITS, PAD_BITS, NEGATE, (BYTES <= 64 ? BYTES : 64)>;
+#endif
+            return nullptr;
+          }
+
+        } // namespace detail
+
+
+        /**
+         * @brief  reverse the BIT_GROUP_SIZE bit groups in a fixed size array with a kernel selected for the
+         *         running CPU, optionally negating the result.
+         * @details  semantics are the same as bit_ops::reverse<BIT_GROUP_SIZE, SIMD, PAD_BITS>(out, in),
+         *           with PAD_BITS zero bits at the MSB end of the input, which are also 0 in the output.
+         * @tparam BIT_GROUP_SIZE  1, 2, 3, or 4.  other group sizes always return false.
+         * @tparam NEGATE          if true, the output is the bitwise negation of the reverse (e.g. DNA reverse complement).
+         * @return  true if a runtime selected kernel was applied.  false if none applies, and out is unchanged.
+         */
+        template <unsigned int BIT_GROUP_SIZE, uint16_t PAD_BITS, bool NEGATE,
+          typename WORD_TYPE, size_t len>
+        inline typename ::std::enable_if<((BIT_GROUP_SIZE == 0) || (BIT_GROUP_SIZE > 4)), bool>::type
+        reverse(WORD_TYPE (&)[len], WORD_TYPE const (&)[len]) {
+          return false;
+        }
+
+        template <unsigned int BIT_GROUP_SIZE, uint16_t PAD_BITS, bool NEGATE,
+          typename WORD_TYPE, size_t len>
+        inline typename ::std::enable_if<((BIT_GROUP_SIZE > 0) && (BIT_GROUP_SIZE <= 4)), bool>::type
+        reverse(WORD_TYPE (&out)[len], WORD_TYPE const (&in)[len]) {
+          static_assert(PAD_BITS < 64, "ERROR: padding should be less than 1 word");
+          static_assert(((((sizeof(WORD_TYPE) * len) << 3) - PAD_BITS) % BIT_GROUP_SIZE) == 0,
+                        "ERROR: bit_group_size needs to divide all bits evenly.");
+
+          constexpr size_t bytes = sizeof(WORD_TYPE) * len;
+          if ((bytes <= 8) || (bytes > 64)) return false;
+
+          static const detail::reverse_fn f = detail::select_reverse<BIT_GROUP_SIZE, PAD_BITS, NEGATE, bytes>();
+          if (f == nullptr) return false;
+
+          f(reinterpret_cast<uint8_t *>(out), reinterpret_cast<uint8_t const *>(in));
+          return true;
+        }
+
+      } // namespace dispatch
+
+    } // namespace bit_ops
+
+  } // namespace utils
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_BITGROUP_DISPATCH_HPP_ */
@@ -649,7 +649,7 @@ namespace bliss {
 
           // for performance testing of the reverse_transform framework
           template <unsigned int BITS = BIT_GROUP_SIZE, typename WORD_TYPE>
-          BITS_INLINE typename std::enable_if<(BITS < 8) && (BITS && (BITS - 1) == 0), WORD_TYPE>::type
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), WORD_TYPE>::type
           reverse_bits_in_byte(WORD_TYPE const &u) const {
             static_assert((::std::is_integral<WORD_TYPE>::value) && (!::std::is_signed<WORD_TYPE>::value), "ERROR: WORD_TYPE has to be unsigned integral type.");
             static_assert(sizeof(WORD_TYPE) <= 8, "ERROR: WORD_TYPE should be primitive and smaller than 8 bytes for SWAR");
@@ -1801,7 +1801,7 @@ namespace bliss {
           }
 
           template <unsigned int BITS = BIT_GROUP_SIZE>
-          BITS_INLINE typename std::enable_if<(BITS < 8) && (BITS && (BITS - 1) == 0), __m256i>::type
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), __m256i>::type
           reverse_bits_in_byte(__m256i const & u) const {
 
             // load from memory in reverse is not appropriate here - since we may not have aligned memory, and we have v instead of a memory location.
@@ -3467,6 +3467,190 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
       }
 
 
+      //========================== batched reverse of independent words ================
+
+      namespace detail {
+
+        /// byte shuffle index that reverses the bytes of each WORD_BYTES sized word within a 128 bit lane.
+        template <size_t WORD_BYTES>
+        BITS_INLINE uint64_t word_bswap_idx(unsigned int half) {
+          uint64_t idx = 0;
+          for (unsigned int b = 0; b < 8; ++b) {
+            unsigned int pos = half * 8 + b;
+            unsigned int src = (pos - (pos % WORD_BYTES)) + (WORD_BYTES - 1 - (pos % WORD_BYTES));
+            idx |= static_cast<uint64_t>(src) << (b << 3);
+          }
+          return idx;
+        }
+
+        /// per-word right shift by PAD_BITS.  there is no 8 bit shift in SSE/AVX, so shift 16 bit and mask instead.
+        template <size_t WORD_BYTES, uint16_t PAD_BITS>
+        struct word_srli {
+            static constexpr uint64_t byte_mask = (0xFFULL >> (PAD_BITS & 0x7)) * 0x0101010101010101ULL;
+#if defined(__SSSE3__)
+            BITS_INLINE __m128i operator()(__m128i const & v) const {
+              if (PAD_BITS == 0) return v;
+              switch (WORD_BYTES) {
+                case 8:  return _mm_srli_epi64(v, PAD_BITS);
+                case 4:  return _mm_srli_epi32(v, PAD_BITS);
+                case 2:  return _mm_srli_epi16(v, PAD_BITS);
+                default: return _mm_and_si128(_mm_srli_epi16(v, PAD_BITS), _mm_set1_epi64x(byte_mask));
+              }
+            }
+#endif
+#if defined(__AVX2__)
+            BITS_INLINE __m256i operator()(__m256i const & v) const {
+              if (PAD_BITS == 0) return v;
+              switch (WORD_BYTES) {
+                case 8:  return _mm256_srli_epi64(v, PAD_BITS);
+                case 4:  return _mm256_srli_epi32(v, PAD_BITS);
+                case 2:  return _mm256_srli_epi16(v, PAD_BITS);
+                default: return _mm256_and_si256(_mm256_srli_epi16(v, PAD_BITS), _mm256_set1_epi64x(byte_mask));
+              }
+            }
+#endif
+#if defined(__AVX512BW__)
+            BITS_INLINE __m512i operator()(__m512i const & v) const {
+              if (PAD_BITS == 0) return v;
+              switch (WORD_BYTES) {
+                case 8:  return _mm512_srli_epi64(v, PAD_BITS);
+                case 4:  return _mm512_srli_epi32(v, PAD_BITS);
+                case 2:  return _mm512_srli_epi16(v, PAD_BITS);
+                default: return _mm512_and_si512(_mm512_srli_epi16(v, PAD_BITS), _mm512_set1_epi64(byte_mask));
+              }
+            }
+#endif
+        };
+
+#if defined(__AVX512BW__)
+        /// 512 bit version of bitgroup_ops::reverse_bits_in_byte.  bitgroup_ops has no AVX512 specialization, so the nibble LUTs are
+        /// taken from the SSSE3 specialization and broadcast to all 4 lanes.
+        template <unsigned int BIT_GROUP_SIZE>
+        BITS_INLINE __m512i reverse_bits_in_byte(bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_SSSE3> const & op, __m512i const & v) {
+          __m512i mask_lo = _mm512_set1_epi8(0x0F);
+          __m512i lo = _mm512_and_si512(mask_lo, v);
+          __m512i hi = _mm512_srli_epi16(_mm512_andnot_si512(mask_lo, v), 4);
+          switch (BIT_GROUP_SIZE) {
+            case 1:
+              lo = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(op.lut1_hi), lo);
+              hi = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(op.lut1_lo), hi);
+              break;
+            case 2:
+              lo = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(op.lut2_hi), lo);
+              hi = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(op.lut2_lo), hi);
+              break;
+            case 4:
+              lo = _mm512_slli_epi16(lo, 4);
+              break;
+            default:
+              break;
+          }
+          return _mm512_or_si512(lo, hi);
+        }
+#endif
+
+      } // namespace detail
+
+      /**
+       * @brief     reverse the bit groups of each word in an array independently, e.g. a batch of single word kmers.
+       * @details   the bit groups in the lower (sizeof(WORD_TYPE) * 8 - PAD_BITS) bits of each word are reversed, optionally negated,
+       *            and the result is placed in the lower bits of the output word.  the upper PAD_BITS are expected to be 0 in the input
+       *            and are 0 in the output.
+       *
+       *            unlike reverse(), which treats the array as one long bit string, each SIMD register here holds multiple
+       *            words: 8, 4 or 2 64-bit words per AVX512BW, AVX2 or SSSE3 register.  each register is byte swapped per word,
+       *            bit reversed within each byte via the bitgroup_ops LUT, optionally negated, then shifted per word by PAD_BITS.
+       *            the remainder is processed via SWAR.
+       * @param out		output array.  may be the same as in.
+       * @param in		input array
+       * @param count   number of words
+       * @tparam BIT_GROUP_SIZE  1, 2, or 4.
+       * @tparam PAD_BITS  number of 0 padding bits at the MSB end of each word.
+       * @tparam NEGATE    negate the reversed bits (e.g. DNA complement)
+       */
+      template <unsigned int BIT_GROUP_SIZE, uint16_t PAD_BITS, bool NEGATE, typename WORD_TYPE>
+      BITS_INLINE void reverse_words(WORD_TYPE * out, WORD_TYPE const * in, size_t const & count) {
+        static_assert((::std::is_integral<WORD_TYPE>::value) && (!::std::is_signed<WORD_TYPE>::value), "ERROR: WORD_TYPE has to be unsigned integral type.");
+        static_assert(sizeof(WORD_TYPE) <= 8, "ERROR: WORD_TYPE should be 64 bit or less");
+        static_assert((BIT_GROUP_SIZE > 0) && (BIT_GROUP_SIZE < 8) && ((BIT_GROUP_SIZE & (BIT_GROUP_SIZE - 1)) == 0),
+                      "ERROR: BIT_GROUP_SIZE has to be 1, 2, or 4");
+        static_assert(PAD_BITS < (sizeof(WORD_TYPE) << 3), "ERROR: PAD_BITS should be less than the word size");
+        static_assert((((sizeof(WORD_TYPE) << 3) - PAD_BITS) % BIT_GROUP_SIZE) == 0, "ERROR: bit_group_size needs to divide all bits evenly.");
+
+        size_t i = 0;
+
+#if defined(__SSSE3__)
+        ::bliss::utils::bit_ops::detail::word_srli<sizeof(WORD_TYPE), PAD_BITS> srli;
+        constexpr size_t WORD_BYTES = sizeof(WORD_TYPE);
+#endif
+
+#if defined(__AVX512BW__)
+        {
+          constexpr size_t step = 64 / sizeof(WORD_TYPE);
+          __m512i shuf = _mm512_broadcast_i32x4(_mm_set_epi64x(::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(1),
+                                                               ::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(0)));
+          __m512i ones = _mm512_set1_epi64(-1LL);
+          ::bliss::utils::bit_ops::bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_SSSE3> op;
+          __m512i v;
+          for (; i + step <= count; i += step) {
+            v = _mm512_loadu_si512(reinterpret_cast<void const *>(in + i));
+            if (WORD_BYTES > 1) v = _mm512_shuffle_epi8(v, shuf);
+            v = ::bliss::utils::bit_ops::detail::reverse_bits_in_byte(op, v);
+            if (NEGATE) v = _mm512_xor_si512(v, ones);
+            _mm512_storeu_si512(reinterpret_cast<void *>(out + i), srli(v));
+          }
+        }
+#endif
+
+#if defined(__AVX2__)
+        {
+          constexpr size_t step = 32 / sizeof(WORD_TYPE);
+          ::bliss::utils::bit_ops::bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_AVX2> op;
+          __m256i shuf = _mm256_set_epi64x(::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(1),
+                                           ::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(0),
+                                           ::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(1),
+                                           ::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(0));
+          __m256i ones = _mm256_set1_epi64x(-1LL);
+          __m256i v;
+          for (; i + step <= count; i += step) {
+            v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+            if (WORD_BYTES > 1) v = _mm256_shuffle_epi8(v, shuf);
+            v = op.reverse_bits_in_byte(v);
+            if (NEGATE) v = _mm256_xor_si256(v, ones);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), srli(v));
+          }
+        }
+#endif
+
+#if defined(__SSSE3__)
+        {
+          constexpr size_t step = 16 / sizeof(WORD_TYPE);
+          ::bliss::utils::bit_ops::bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_SSSE3> op;
+          __m128i shuf = _mm_set_epi64x(::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(1),
+                                        ::bliss::utils::bit_ops::detail::word_bswap_idx<WORD_BYTES>(0));
+          __m128i ones = _mm_set1_epi64x(-1LL);
+          __m128i v;
+          for (; i + step <= count; i += step) {
+            v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+            if (WORD_BYTES > 1) v = _mm_shuffle_epi8(v, shuf);
+            v = op.reverse_bits_in_byte(v);
+            if (NEGATE) v = _mm_xor_si128(v, ones);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), srli(v));
+          }
+        }
+#endif
+
+        // remainder, or everything if no SIMD.
+        ::bliss::utils::bit_ops::bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_SWAR> op;
+        WORD_TYPE w;
+        for (; i < count; ++i) {
+          w = op.reverse(in[i]);
+          if (NEGATE) w = ~w;
+          out[i] = static_cast<WORD_TYPE>(w >> PAD_BITS);
+        }
+      }
+
+
       //========================== bitwise operations ============
       // no difference between conservative and aggressive.  use specified.
 
@@ -3530,41 +3714,115 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
         }
 
       //========================== comparison operations ===========
+#if defined(__AVX2__) || defined(__SSSE3__)
+      /// arrays of at least this many bytes are compared with SSE or AVX2.  shorter ones are 1 or 2 uint64_t loads.
+      static constexpr size_t SIMD_COMPARE_MIN_BYTES = 16;
+
+      // the arrays are little endian multi-word integers (word len-1 is the most significant), so the most significant
+      // differing byte decides the order.  16 or 32 bytes are compared at a time, from the MSB end:  cmpeq, movemask,
+      // and the highest bit of the inverted mask is the highest differing byte.  when the length is not a multiple of
+      // 16, the last chunk at offset 0 overlaps bytes that are already known to be equal.
+
+      /// bit i set if byte i of the 16 bytes at u and v differ.
+      BITS_INLINE uint32_t bytes_differ_16(uint8_t const * u, uint8_t const * v) {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(u)),
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(v))))) ^ 0xFFFFU;
+      }
+#if defined(__AVX2__)
+      /// bit i set if byte i of the 32 bytes at u and v differ.
+      BITS_INLINE uint32_t bytes_differ_32(uint8_t const * u, uint8_t const * v) {
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(u)),
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(v)))));
+      }
+#endif
+
+      /// offset of the most significant differing byte of 2 arrays of BYTES >= 16 bytes, or BYTES if they are equal.
+      template <size_t BYTES>
+      BITS_INLINE size_t simd_highest_diff(uint8_t const * u, uint8_t const * v) {
+        static_assert(BYTES >= 16, "simd_highest_diff needs at least 16 bytes");
+        size_t remaining = BYTES;
+        uint32_t mask;
+#if defined(__AVX2__)
+        for (; remaining >= 32; remaining -= 32) {
+          mask = bytes_differ_32(u + remaining - 32, v + remaining - 32);
+          if (mask != 0) return remaining - 32 + (31 - __builtin_clz(mask));
+        }
+#endif
+        for (; remaining >= 16; remaining -= 16) {
+          mask = bytes_differ_16(u + remaining - 16, v + remaining - 16);
+          if (mask != 0) return remaining - 16 + (31 - __builtin_clz(mask));
+        }
+        if (remaining > 0) {
+          mask = bytes_differ_16(u, v);
+          if (mask != 0) return (31 - __builtin_clz(mask));
+        }
+        return BYTES;
+      }
+
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) >= SIMD_COMPARE_MIN_BYTES), int>::type = 1>
+      BITS_INLINE bool equal(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
+        constexpr size_t bytes = len * sizeof(WORD_TYPE);
+        return simd_highest_diff<bytes>(reinterpret_cast<uint8_t const *>(lhs), reinterpret_cast<uint8_t const *>(rhs)) == bytes;
+      }
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) >= SIMD_COMPARE_MIN_BYTES), int>::type = 1>
+      BITS_INLINE bool less(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
+        constexpr size_t bytes = len * sizeof(WORD_TYPE);
+        uint8_t const * u = reinterpret_cast<uint8_t const *>(lhs);
+        uint8_t const * v = reinterpret_cast<uint8_t const *>(rhs);
+        size_t i = simd_highest_diff<bytes>(u, v);
+        return (i < bytes) && (u[i] < v[i]);
+      }
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) >= SIMD_COMPARE_MIN_BYTES), int>::type = 1>
+      BITS_INLINE int8_t compare(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
+        constexpr size_t bytes = len * sizeof(WORD_TYPE);
+        uint8_t const * u = reinterpret_cast<uint8_t const *>(lhs);
+        uint8_t const * v = reinterpret_cast<uint8_t const *>(rhs);
+        size_t i = simd_highest_diff<bytes>(u, v);
+        return (i == bytes) ? 0 : ((u[i] < v[i]) ? -1 : 1);
+      }
+#else
+      static constexpr size_t SIMD_COMPARE_MIN_BYTES = ::std::numeric_limits<size_t>::max();
+#endif
+
       // Aggressive strategy means partial load. but since SWAR, it's okay. (requires memcpy)
-      template <typename WORD_TYPE, size_t len>
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) < SIMD_COMPARE_MIN_BYTES), int>::type = 1>
       BITS_INLINE bool equal(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
         using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
         return bliss::utils::bit_ops::bit_equal<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs);
       }
-      template <typename WORD_TYPE, size_t len>
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) < SIMD_COMPARE_MIN_BYTES), int>::type = 1>
       BITS_INLINE bool less(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
         using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
         return bliss::utils::bit_ops::bit_less<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs);
       }
+      template <typename WORD_TYPE, size_t len,
+        typename std::enable_if<((len * sizeof(WORD_TYPE)) < SIMD_COMPARE_MIN_BYTES), int>::type = 1>
+      BITS_INLINE int8_t compare(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
+          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
+          return bliss::utils::bit_ops::bit_compare<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs);
+      }
       template <typename WORD_TYPE, size_t len>
       BITS_INLINE bool greater(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
-          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
-          return bliss::utils::bit_ops::bit_less<MAX_SIMD_TYPE, WORD_TYPE, len>(rhs, lhs);
+          return ::bliss::utils::bit_ops::less<WORD_TYPE, len>(rhs, lhs);
       }
       template <typename WORD_TYPE, size_t len>
       BITS_INLINE bool not_equal(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
-          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
-          return !(bliss::utils::bit_ops::bit_equal<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs));
+          return !(::bliss::utils::bit_ops::equal<WORD_TYPE, len>(lhs, rhs));
       }
       template <typename WORD_TYPE, size_t len>
       BITS_INLINE bool less_equal(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
-          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
-          return !(bliss::utils::bit_ops::bit_less<MAX_SIMD_TYPE, WORD_TYPE, len>(rhs, lhs));
+          return !(::bliss::utils::bit_ops::less<WORD_TYPE, len>(rhs, lhs));
       }
       template <typename WORD_TYPE, size_t len>
       BITS_INLINE bool greater_equal(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
-          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
-          return !(bliss::utils::bit_ops::bit_less<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs));
-      }
-      template <typename WORD_TYPE, size_t len>
-      BITS_INLINE int8_t compare(WORD_TYPE const (&lhs)[len], WORD_TYPE const (&rhs)[len]) {
-          using MAX_SIMD_TYPE = BITREV_AUTO_AGGRESSIVE<(len * sizeof(WORD_TYPE)), BITREV_SWAR>;
-          return bliss::utils::bit_ops::bit_compare<MAX_SIMD_TYPE, WORD_TYPE, len>(lhs, rhs);
+          return !(::bliss::utils::bit_ops::less<WORD_TYPE, len>(lhs, rhs));
       }
     } // namespace bit_ops
 
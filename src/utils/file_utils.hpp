@@ -26,13 +26,16 @@
 #define SRC_UTILS_FILE_UTILS_HPP_
 
 #include <string>
+#include <vector>
+#include <iterator>
+#include <type_traits>
 
 namespace bliss {
   namespace utils {
 
     namespace file {
 
-      std::string get_file_extension(std::string const & filename) {
+      inline std::string get_file_extension(std::string const & filename) {
         // find the last part.
         size_t pos = filename.find_last_of('.');
         if (pos == std::string::npos)  return std::string();
@@ -40,6 +43,15 @@ namespace bliss {
           return filename.substr(pos + 1);  // from next char to end.
       }
 
+      /// get the file extension, skipping the compression extension (gz, bgz, bgzf) if present.  e.g. "fastq" for reads.fastq.gz
+      inline std::string get_uncompressed_file_extension(std::string const & filename) {
+        std::string extension = get_file_extension(filename);
+        if ((extension.compare("gz") != 0) && (extension.compare("bgz") != 0) && (extension.compare("bgzf") != 0))
+          return extension;
+
+        return get_file_extension(filename.substr(0, filename.length() - extension.length() - 1));
+      }
+
       struct NotEOL {
         template <typename CharType>
         bool operator()(CharType const & x) {
@@ -52,6 +64,14 @@ namespace bliss {
         }
       };
 
+      /// iterator over contiguous chars in memory (pointers and vector iterators), for which vectorized search can be used.
+      template <typename IT, typename V = typename ::std::remove_cv<typename ::std::iterator_traits<IT>::value_type>::type>
+      struct is_contiguous_char_iterator : public ::std::integral_constant<bool,
+        (::std::is_same<V, char>::value || ::std::is_same<V, unsigned char>::value) &&
+        (::std::is_pointer<IT>::value ||
+         ::std::is_same<IT, typename ::std::vector<V>::iterator>::value ||
+         ::std::is_same<IT, typename ::std::vector<V>::const_iterator>::value) > {};
+
     }
 
   }
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    hyperloglog.hpp
+ * @ingroup bliss::utils
+ * @brief   HyperLogLog sketch for estimating the number of distinct elements.
+ * @details the sketch takes 64 bit hash values, so there is no large range correction.  the hash values are
+ *          mixed first (murmur3 finalizer), so weak hashes such as std::hash on integers can be used.
+ *          registers are bytes, and sketches are merged by element-wise max, e.g. via an allreduce with max.
+ *          relative error is about 1.04 / sqrt(2^precision), i.e. 1.6% for the default precision of 12 (4KB).
+ */
+#ifndef SRC_UTILS_HYPERLOGLOG_HPP_
+#define SRC_UTILS_HYPERLOGLOG_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
+
+namespace bliss {
+
+  namespace utils {
+
+    /// HyperLogLog sketch with 2^precision byte registers.
+    template <uint8_t precision = 12>
+    class hyperloglog64 {
+        static_assert((precision >= 4) && (precision <= 18), "hyperloglog precision should be between 4 and 18");
+
+      public:
+        static constexpr size_t n_registers = 1ULL << precision;
+
+      protected:
+        ::std::vector<uint8_t> registers;
+
+        /// murmur3 64 bit finalizer.
+        static inline uint64_t mix(uint64_t h) {
+          h ^= h >> 33;
+          h *= 0xff51afd7ed558ccdULL;
+          h ^= h >> 33;
+          h *= 0xc4ceb9fe1a85ec53ULL;
+          h ^= h >> 33;
+          return h;
+        }
+
+      public:
+        hyperloglog64() : registers(n_registers, 0) {};
+
+        /// add 1 hash value.
+        inline void update(uint64_t const & hash) {
+          uint64_t h = mix(hash);
+          // high bits select the register.  leading zeros of the rest, with a guard bit so the count is bounded.
+          uint8_t rank = static_cast<uint8_t>(__builtin_clzll((h << precision) | (1ULL << (precision - 1))) + 1);
+          uint8_t & r = registers[h >> (64 - precision)];
+          if (rank > r) r = rank;
+        }
+
+        /// add an array of hash values.
+        inline void update(uint64_t const * hashes, size_t const & count) {
+          for (size_t i = 0; i < count; ++i) update(hashes[i]);
+        }
+
+        /// merge another sketch into this one.  the result estimates the size of the union.
+        void merge(hyperloglog64 const & other) {
+          for (size_t i = 0; i < n_registers; ++i) {
+            if (other.registers[i] > registers[i]) registers[i] = other.registers[i];
+          }
+        }
+
+        /// estimated number of distinct hash values added.
+        double estimate() const {
+          double m = static_cast<double>(n_registers);
+          double alpha = (n_registers == 16) ? 0.673 :
+                         (n_registers == 32) ? 0.697 :
+                         (n_registers == 64) ? 0.709 :
+                         0.7213 / (1.0 + 1.079 / m);
+
+          double sum = 0.0;
+          size_t zeros = 0;
+          for (size_t i = 0; i < n_registers; ++i) {
+            sum += ::std::ldexp(1.0, -static_cast<int>(registers[i]));
+            zeros += (registers[i] == 0) ? 1 : 0;
+          }
+          double est = alpha * m * m / sum;
+
+          // small range correction:  linear counting.
+          if ((est <= 2.5 * m) && (zeros > 0)) {
+            est = m * ::std::log(m / static_cast<double>(zeros));
+          }
+          return est;
+        }
+
+        void clear() {
+          registers.assign(n_registers, 0);
+        }
+
+        /// registers, e.g. for merging across processes with an element-wise max.
+        ::std::vector<uint8_t> & get_registers() { return registers; }
+        ::std::vector<uint8_t> const & get_registers() const { return registers; }
+    };
+
+    template <uint8_t precision>
+    constexpr size_t hyperloglog64<precision>::n_registers;
+
+  } // namespace utils
+} // namespace bliss
+
+#endif /* SRC_UTILS_HYPERLOGLOG_HPP_ */
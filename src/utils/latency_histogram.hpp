@@ -0,0 +1,155 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    latency_histogram.hpp
+ * @ingroup bliss::utils
+ * @brief   HDR style log-linear histogram of latencies, for percentiles such as p99 and p999.
+ * @details values are unsigned integers, e.g. nanoseconds.  values below 2^sub_bits have their own bucket.  above that,
+ *          each power of 2 range is split into 2^(sub_bits - 1) equal buckets, so a percentile is within a relative
+ *          error of 2^-(sub_bits - 1), 0.8% for the default of 8, at any magnitude.  the whole uint64_t range takes
+ *          (66 - sub_bits) * 2^(sub_bits - 1) counters, 58KB for the default.
+ *
+ *          histograms are merged by adding the counters, e.g. via an allreduce with std::plus over get_counts().
+ */
+#ifndef SRC_UTILS_LATENCY_HISTOGRAM_HPP_
+#define SRC_UTILS_LATENCY_HISTOGRAM_HPP_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+namespace bliss {
+
+  namespace utils {
+
+    /// latency histogram with 2^(sub_bits - 1) buckets per power of 2.
+    template <uint8_t sub_bits = 8>
+    class latency_histogram {
+        static_assert((sub_bits >= 2) && (sub_bits <= 16), "latency histogram sub_bits should be between 2 and 16");
+
+      public:
+        static constexpr uint64_t half = 1ULL << (sub_bits - 1);
+        static constexpr size_t n_buckets = (66 - sub_bits) * half;
+
+      protected:
+        ::std::vector<uint64_t> counts;
+        uint64_t total;
+        uint64_t min_;
+        uint64_t max_;
+        double sum;
+
+      public:
+        latency_histogram() : counts(n_buckets, 0), total(0),
+          min_(::std::numeric_limits<uint64_t>::max()), max_(0), sum(0.0) {};
+
+        /// bucket of a value.
+        static inline size_t bucket(uint64_t const & v) {
+          if (v < (half << 1)) return v;
+          uint64_t shift = (63 - __builtin_clzll(v)) - (sub_bits - 1);
+          return shift * half + (v >> shift);
+        }
+
+        /// largest value in a bucket.
+        static inline uint64_t bucket_upper(size_t const & b) {
+          if (b < (half << 1)) return b;
+          uint64_t shift = b / half - 1;
+          uint64_t top = b - shift * half;
+          return ((top + 1) << shift) - 1;
+        }
+
+        /// add 1 value.
+        inline void record(uint64_t const & v) {
+          ++counts[bucket(v)];
+          ++total;
+          sum += static_cast<double>(v);
+          if (v < min_) min_ = v;
+          if (v > max_) max_ = v;
+        }
+
+        /// add another histogram.
+        void merge(latency_histogram const & other) {
+          for (size_t i = 0; i < n_buckets; ++i) counts[i] += other.counts[i];
+          total += other.total;
+          sum += other.sum;
+          min_ = ::std::min(min_, other.min_);
+          max_ = ::std::max(max_, other.max_);
+        }
+
+        /**
+         * @brief value at quantile q in [0, 1], e.g. 0.99 for p99.  0 if empty.
+         * @details  the largest value of the bucket holding the ceil(q * count)-th smallest value, capped at the maximum.
+         */
+        uint64_t percentile(double const & q) const {
+          if (total == 0) return 0;
+          uint64_t rank = static_cast<uint64_t>(::std::ceil(q * static_cast<double>(total)));
+          rank = ::std::max(rank, static_cast<uint64_t>(1));
+          uint64_t seen = 0;
+          for (size_t i = 0; i < n_buckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return ::std::min(bucket_upper(i), max_);
+          }
+          return max_;
+        }
+
+        uint64_t count() const { return total; }
+        uint64_t min() const { return (total == 0) ? 0 : min_; }
+        uint64_t max() const { return max_; }
+        double mean() const { return (total == 0) ? 0.0 : sum / static_cast<double>(total); }
+
+        void clear() {
+          counts.assign(n_buckets, 0);
+          total = 0;
+          min_ = ::std::numeric_limits<uint64_t>::max();
+          max_ = 0;
+          sum = 0.0;
+        }
+
+        /// bucket counters, e.g. for merging across processes with an element-wise sum.  call recount() after changing them.
+        ::std::vector<uint64_t> & get_counts() { return counts; }
+        ::std::vector<uint64_t> const & get_counts() const { return counts; }
+
+        /**
+         * @brief recompute the count, and estimate min, max and mean, after the counters were replaced.
+         * @details  min, max and mean use the bucket bounds, since the exact values are not in the counters.
+         */
+        void recount() {
+          total = 0;
+          sum = 0.0;
+          min_ = ::std::numeric_limits<uint64_t>::max();
+          max_ = 0;
+          for (size_t i = 0; i < n_buckets; ++i) {
+            if (counts[i] == 0) continue;
+            total += counts[i];
+            uint64_t lower = (i == 0) ? 0 : bucket_upper(i - 1) + 1;
+            sum += static_cast<double>(counts[i]) * 0.5 * (static_cast<double>(lower) + static_cast<double>(bucket_upper(i)));
+            min_ = ::std::min(min_, lower);
+            max_ = bucket_upper(i);
+          }
+        }
+    };
+
+    template <uint8_t sub_bits>
+    constexpr uint64_t latency_histogram<sub_bits>::half;
+    template <uint8_t sub_bits>
+    constexpr size_t latency_histogram<sub_bits>::n_buckets;
+
+  } // namespace utils
+} // namespace bliss
+
+#endif /* SRC_UTILS_LATENCY_HISTOGRAM_HPP_ */
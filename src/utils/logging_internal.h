@@ -119,6 +119,27 @@
 
 
 
+/*********************************************************************
+ *        buffer per thread, write from a background thread          *
+ *********************************************************************/
+
+#elif USE_LOGGER == BLISS_LOGGING_ASYNC
+
+#include <cstdlib>
+#include <sstream>
+#include "utils/async_logger.hpp"
+
+// fatal writes all buffered messages before exiting.
+#define PRINT_FATAL(msg)    do { std::stringstream ss; ss << "[fatal] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); ::bliss::log::async_logger::instance().stop(); exit(EXIT_FAILURE); } while (false)
+#define PRINT_ERROR(msg)    do { std::stringstream ss; ss << "[error] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); } while (false)
+#define PRINT_WARNING(msg)  do { std::stringstream ss; ss << "[warn ] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); } while (false)
+#define PRINT_INFO(msg)     do { std::stringstream ss; ss << "[info ] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); } while (false)
+#define PRINT_DEBUG(msg)    do { std::stringstream ss; ss << "[debug] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); } while (false)
+#define PRINT_TRACE(msg)    do { std::stringstream ss; ss << "[trace] " << msg; ::bliss::log::async_logger::instance().log(ss.str()); } while (false)
+
+#define LOG_INIT() ::bliss::log::async_logger::instance().start()
+
+
 /*********************************************************************
  *                      use boost::log::trivial                      *
  *********************************************************************/
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    memory_bandwidth.hpp
+ * @ingroup plog
+ * @brief   bytes moved and achieved memory bandwidth per BL_BENCH phase, against the STREAM triad bandwidth of the node.
+ * @details a phase that knows how many bytes its kernel moves reports them with BL_BENCH_BYTES(title, bytes) right after
+ *          its BL_BENCH_END.  the bytes are analytic, from the element counts and sizes:  each element read or written
+ *          once counts once, so for random access kernels (hash table probes) the achieved GB/s is a lower bound of the
+ *          traffic, and a low fraction of the peak means the phase is latency bound rather than bandwidth bound.
+ *          the phase time is local (before the barrier of a collective end).
+ *
+ *          the peak is the STREAM triad (a = b + s * c, 24 bytes per element) run by all ranks of a node at the same
+ *          time, best of a few repetitions.  it is measured once, collectively, by BL_BENCH_PEAK_BANDWIDTH(comm), e.g.
+ *          at the start of a benchmark, and the per rank peak is the node peak divided by the ranks on the node.
+ *          BL_STREAM_ELEMENTS sets the elements per array (default 4M, 96MB per rank).  without a measured peak the
+ *          fraction is reported as -1.
+ *
+ *          enabled with BL_BENCHMARK_BW == 1 (cmake ENABLE_BANDWIDTH_BENCHMARK).  report(title, comm) prints, for each
+ *          phase with bytes, the mean bytes per rank, the min/max/mean per rank GB/s, and the mean fraction of the per rank
+ *          peak as [BW] lines.
+ */
+#ifndef SRC_UTILS_MEMORY_BANDWIDTH_HPP_
+#define SRC_UTILS_MEMORY_BANDWIDTH_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iterator>   // ostream_iterator
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>    // getenv, strtoull
+#include <limits>
+#include <cstdio>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace plog {
+
+/// STREAM triad bandwidth of the node, measured once per process.
+class StreamBandwidth {
+  protected:
+    double node_gbps;
+    double rank_gbps;
+    int node_ranks;
+    bool measured;
+
+    StreamBandwidth() : node_gbps(0), rank_gbps(0), node_ranks(1), measured(false) {}
+
+  public:
+    static StreamBandwidth & instance() {
+      static StreamBandwidth bw;
+      return bw;
+    }
+
+    /// elements per array, from BL_STREAM_ELEMENTS.
+    static size_t elements() {
+      char const * env = getenv("BL_STREAM_ELEMENTS");
+      size_t n = (env == nullptr) ? 0 : strtoull(env, nullptr, 10);
+      return (n == 0) ? (1UL << 22) : n;
+    }
+
+    /// seconds of 1 triad pass.  a, b and c have n elements.
+    static double triad(double * a, double const * b, double const * c, size_t const & n, double const & s) {
+      auto t1 = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < n; ++i) a[i] = b[i] + s * c[i];
+      auto t2 = std::chrono::steady_clock::now();
+      return std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count();
+    }
+
+    /**
+     * @brief measure the triad bandwidth with all ranks of each node running at the same time.  collective.
+     * @details the node time of a repetition is the slowest rank's, and the best repetition is kept.
+     *        the node peak is the lowest over the nodes, so all ranks get the same numbers.  later calls return at once.
+     */
+    void measure(::mxx::comm const & comm, int const & reps = 5) {
+      if (measured) return;
+
+      ::mxx::comm shared = comm.split_shared();
+      size_t const n = elements();
+      std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+
+      double best = std::numeric_limits<double>::max();
+      triad(a.data(), b.data(), c.data(), n, 3.0);  // first touch
+      for (int r = 0; r < reps; ++r) {
+        shared.barrier();
+        double t = triad(a.data(), b.data(), c.data(), n, 3.0);
+        best = std::min(best, ::mxx::allreduce(t, ::mxx::max<double>(), shared));
+      }
+      // use the result, so the loop is not dropped.
+      if (a[n / 2] != 7.0) fprintf(stderr, "WARNING: STREAM triad check failed\n");
+
+      double node = (best > 0) ? static_cast<double>(shared.size()) * 3.0 * sizeof(double) * n / best * 1e-9 : 0.0;
+      node_gbps = ::mxx::allreduce(node, ::mxx::min<double>(), comm);
+      node_ranks = ::mxx::allreduce(shared.size(), ::mxx::max<int>(), comm);
+      rank_gbps = node_gbps / node_ranks;
+      measured = true;
+    }
+
+    bool is_measured() const { return measured; }
+    double node_peak() const { return node_gbps; }
+    double rank_peak() const { return rank_gbps; }
+    int ranks_per_node() const { return node_ranks; }
+};
+
+
+/// bytes and local durations of the phases of 1 BL_BENCH title.
+class BandwidthUsage {
+  protected:
+    std::vector<std::string> names;
+    std::vector<double> durations;
+    std::vector<double> bytes;   // -1 if the phase did not report bytes.
+    std::chrono::steady_clock::time_point t1;
+
+  public:
+    BandwidthUsage() {
+      reset();
+    }
+
+    void reset() {
+      names.clear();
+      durations.clear();
+      bytes.clear();
+      t1 = std::chrono::steady_clock::now();
+    }
+
+    void start() {
+      t1 = std::chrono::steady_clock::now();
+    }
+
+    void end(::std::string const & name) {
+      auto t2 = std::chrono::steady_clock::now();
+      names.push_back(name);
+      durations.push_back(std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count());
+      bytes.push_back(-1.0);
+    }
+
+    /// bytes moved by the last ended phase.
+    void set_bytes(double const & b) {
+      if (!bytes.empty()) bytes.back() = b;
+    }
+
+    void report(::std::string const & title) {
+      StreamBandwidth const & peak = StreamBandwidth::instance();
+
+      std::stringstream output;
+      std::ostream_iterator<std::string> nit(output, ",");
+      std::ostream_iterator<double> dit(output, ",");
+
+      std::vector<std::string> hdr;
+      std::vector<double> mb, gbps, frac;
+      for (size_t i = 0; i < names.size(); ++i) {
+        if (bytes[i] < 0) continue;
+        double g = (durations[i] > 0) ? bytes[i] / durations[i] * 1e-9 : 0.0;
+        hdr.push_back(names[i]);
+        mb.push_back(bytes[i] / (1024.0 * 1024.0));
+        gbps.push_back(g);
+        frac.push_back(peak.is_measured() && (peak.rank_peak() > 0) ? g / peak.rank_peak() : -1.0);
+      }
+      if (hdr.empty()) return;
+
+      output << std::fixed;
+      output.precision(3);
+      output << "[BW] " << title << "\tpeak_GBps\t" << peak.rank_peak() << std::endl;
+      output << "[BW] " << title << "\theader\t[,";
+      std::copy(hdr.begin(), hdr.end(), nit);
+      output << "]" << std::endl << "[BW] " << title << "\tMB\t[,";
+      std::copy(mb.begin(), mb.end(), dit);
+      output << "]" << std::endl << "[BW] " << title << "\tGBps\t[,";
+      std::copy(gbps.begin(), gbps.end(), dit);
+      output << "]" << std::endl << "[BW] " << title << "\tpeak_frac\t[,";
+      std::copy(frac.begin(), frac.end(), dit);
+      output << "]";
+
+      fflush(stdout);
+      printf("%s\n", output.str().c_str());
+      fflush(stdout);
+    }
+
+    void report(::std::string const & title, ::mxx::comm const & comm) {
+      StreamBandwidth const & peak = StreamBandwidth::instance();
+      int p = comm.size();
+      int rank = comm.rank();
+
+      std::vector<double> gbps(names.size(), 0.0);
+      for (size_t i = 0; i < names.size(); ++i)
+        gbps[i] = (durations[i] > 0) ? ::std::max(bytes[i], 0.0) / durations[i] * 1e-9 : 0.0;
+
+      std::vector<double> bytes_max, bytes_means, gbps_mins, gbps_maxs, gbps_means;
+      if (names.size() > 0) {
+        bytes_max = ::mxx::reduce(bytes, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        bytes_means = ::mxx::reduce(bytes, 0, ::std::plus<double>(), comm);
+        gbps_mins = ::mxx::reduce(gbps, 0,
+            [](double const & x, double const & y) { return ::std::min(x, y); }, comm);
+        gbps_maxs = ::mxx::reduce(gbps, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        gbps_means = ::mxx::reduce(gbps, 0, ::std::plus<double>(), comm);
+      }
+
+      if (rank == 0) {
+        std::vector<std::string> hdr;
+        std::vector<double> mb, mins, maxs, means, frac;
+        for (size_t i = 0; i < names.size(); ++i) {
+          if (bytes_max[i] < 0) continue;
+          hdr.push_back(names[i]);
+          mb.push_back(bytes_means[i] / p / (1024.0 * 1024.0));
+          mins.push_back(gbps_mins[i]);
+          maxs.push_back(gbps_maxs[i]);
+          means.push_back(gbps_means[i] / p);
+          frac.push_back(peak.is_measured() && (peak.rank_peak() > 0) ? means.back() / peak.rank_peak() : -1.0);
+        }
+
+        if (!hdr.empty()) {
+          std::stringstream output;
+          std::ostream_iterator<std::string> nit(output, ",");
+          std::ostream_iterator<double> dit(output, ",");
+
+          output << std::fixed;
+          output.precision(3);
+          output << "[BW] " << "R " << rank << "/" << p << std::endl;
+          output << "[BW] " << title << "\tpeak_GBps\tnode " << peak.node_peak() << " rank " << peak.rank_peak()
+                 << " ranks_per_node " << peak.ranks_per_node() << std::endl;
+          output << "[BW] " << title << "\theader\t[,";
+          std::copy(hdr.begin(), hdr.end(), nit);
+          output << "]" << std::endl << "[BW] " << title << "\tMB_mean\t[,";
+          std::copy(mb.begin(), mb.end(), dit);
+          output << "]" << std::endl << "[BW] " << title << "\tGBps_min\t[,";
+          std::copy(mins.begin(), mins.end(), dit);
+          output << "]" << std::endl << "[BW] " << title << "\tGBps_max\t[,";
+          std::copy(maxs.begin(), maxs.end(), dit);
+          output << "]" << std::endl << "[BW] " << title << "\tGBps_mean\t[,";
+          std::copy(means.begin(), means.end(), dit);
+          output << "]" << std::endl << "[BW] " << title << "\tpeak_frac_mean\t[,";
+          std::copy(frac.begin(), frac.end(), dit);
+          output << "]";
+
+          fflush(stdout);
+          printf("%s\n", output.str().c_str());
+          fflush(stdout);
+        }
+      }
+      comm.barrier();
+    }
+};
+
+} // end namespace plog
+
+#if defined(BL_BENCHMARK_BW) && (BL_BENCHMARK_BW == 1)
+
+#define BL_BW_INIT(title)      ::plog::BandwidthUsage title##_bw;
+#define BL_BW_RESET(title)     do { title##_bw.reset(); } while (0)
+#define BL_BW_START(title)     do { title##_bw.start(); } while (0)
+#define BL_BW_END(title, name) do { title##_bw.end(name); } while (0)
+#define BL_BW_BYTES(title, bytes) do { title##_bw.set_bytes(static_cast<double>(bytes)); } while (0)
+#define BL_BW_PEAK(comm)       do { ::plog::StreamBandwidth::instance().measure(comm); } while (0)
+#define BL_BW_REPORT(title) do { title##_bw.report(#title); } while (0)
+#define BL_BW_REPORT_NAMED(title, name) do { title##_bw.report(name); } while (0)
+#define BL_BW_REPORT_MPI(title, comm) do { title##_bw.report(#title, comm); } while (0)
+#define BL_BW_REPORT_MPI_NAMED(title, name, comm) do { title##_bw.report(name, comm); } while (0)
+
+#else
+
+#define BL_BW_INIT(title)
+#define BL_BW_RESET(title)
+#define BL_BW_START(title)
+#define BL_BW_END(title, name)
+#define BL_BW_BYTES(title, bytes)
+#define BL_BW_PEAK(comm)
+#define BL_BW_REPORT(title)
+#define BL_BW_REPORT_NAMED(title, name)
+#define BL_BW_REPORT_MPI(title, comm)
+#define BL_BW_REPORT_MPI_NAMED(title, name, comm)
+
+#endif
+
+#endif /* SRC_UTILS_MEMORY_BANDWIDTH_HPP_ */
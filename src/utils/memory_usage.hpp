@@ -20,6 +20,9 @@
  * @author  tpan
  * @brief   functions to track memory usage during program execution (for marked functional blocks)
  * @details each "mark" call snapshots the current memory usage and peak memory usage.
+ *          each mark also records getrusage max RSS, and the current and peak bytes of fsc::tracking_allocator
+ *          (all tags).  the allocator peak is updated at each allocation, so it sees transient buffers between marks
+ *          (e.g. inside imxx::distribute) that the RSS snapshots miss.  these are 0 if no tracking allocator is used.
  *          relies on http://nadeausoftware.com/articles/2012/07/c_c_tip_how_get_process_resident_set_size_physical_memory_use#GetProcessMemoryInfonbspforpeakandcurrentresidentsetsize
  *
  *          also see http://www.linuxatemyram.com/play.html and
@@ -50,6 +53,9 @@
 #include <io/io_exception.hpp>
 #include <mxx/reduction.hpp>
 
+#include "utils/benchmark_report.hpp"
+#include "containers/tracking_allocator.hpp"
+
 //http://nadeausoftware.com/articles/2012/07/c_c_tip_how_get_process_resident_set_size_physical_memory_use#GetProcessMemoryInfonbspforpeakandcurrentresidentsetsize
 // note:  reports in bytes.
 #include "getRSS.h"
@@ -112,9 +118,23 @@ class MemUsage {
     std::vector<std::string> names;
     std::vector<double> mem_curr;
     std::vector<double> mem_max;
+    std::vector<double> mem_rusage;
+    std::vector<double> alloc_curr;
+    std::vector<double> alloc_peak;
 
   public:
 
+    /// getrusage max RSS, in bytes.
+    static double get_rusage_max() {
+      struct rusage u;
+      if (getrusage(RUSAGE_SELF, &u) != 0) return 0.0;
+#if defined(__APPLE__) && defined(__MACH__)
+      return static_cast<double>(u.ru_maxrss);   // already bytes
+#else
+      return static_cast<double>(u.ru_maxrss) * 1024.0;  // KB
+#endif
+    }
+
     /// return the program usable ram in bytes.
     static size_t get_usable_mem() {
        FILE *meminfo = fopen("/proc/meminfo", "r");
@@ -158,6 +178,16 @@ class MemUsage {
       names.clear();
       mem_curr.clear();
       mem_max.clear();
+      mem_rusage.clear();
+      alloc_curr.clear();
+      alloc_peak.clear();
+    }
+
+    /// change in current RSS from the previous mark, for each mark after the first.
+    ::std::vector<double> get_deltas() const {
+      ::std::vector<double> deltas;
+      for (size_t i = 1; i < mem_curr.size(); ++i) deltas.emplace_back(mem_curr[i] - mem_curr[i-1]);
+      return deltas;
     }
 
 
@@ -166,6 +196,28 @@ class MemUsage {
       names.push_back(name);
       mem_curr.push_back(::getCurrentRSS());
       mem_max.push_back(::getPeakRSS());
+      mem_rusage.push_back(get_rusage_max());
+      ::fsc::alloc_counter & total = ::fsc::alloc_tracker::instance().total();
+      alloc_curr.push_back(static_cast<double>(total.current.load()));
+      alloc_peak.push_back(static_cast<double>(total.peak.load()));
+    }
+
+    /// print the current and peak bytes of each tracking_allocator tag.  local to this process.
+    static void report_tags(::std::string const & title) {
+      ::std::vector<::fsc::alloc_counter *> counters = ::fsc::alloc_tracker::instance().get_counters();
+      if (counters.size() == 0) return;
+
+      std::stringstream output;
+      output << std::fixed;
+      output.precision(3);
+      for (auto c : counters) {
+        output << "[MEM] " << title << "	alloc_tag	" << c->name << "	curr (MB)	"
+               << (static_cast<double>(c->current.load()) / (1024.0 * 1024.0))
+               << "	peak (MB)	" << (static_cast<double>(c->peak.load()) / (1024.0 * 1024.0)) << std::endl;
+      }
+      fflush(stdout);
+      printf("%s", output.str().c_str());
+      fflush(stdout);
     }
     void collective_mark(::std::string const & name, ::mxx::comm const & comm) {
 
@@ -175,7 +227,13 @@ class MemUsage {
 		mark(name);
     }
 
-    void report(::std::string const & title) {
+    void report(::std::string const & title, ::std::string const & site = ::std::string()) {
+        if (BenchReport::instance().enabled() && (names.size() > 1)) {
+          ::std::vector<double> deltas = get_deltas();
+          BenchReport::instance().add_mem(title, site, 1, ::std::vector<std::string>(names.begin() + 1, names.end()),
+                                          deltas, deltas, deltas, ::std::vector<double>(mem_max.begin() + 1, mem_max.end()));
+        }
+
         auto BtoMB = [](double const & x) { return x / (1024.0 * 1024.0); };
 
     	std::stringstream output;
@@ -196,6 +254,18 @@ class MemUsage {
 
         output << "[MEM] " << title << "\tmax\t[,";
         std::transform(mem_max.begin(), mem_max.end(), dit, BtoMB);
+        output << "]" << ::std::endl;
+
+        output << "[MEM] " << title << "\trusage_max\t[,";
+        std::transform(mem_rusage.begin(), mem_rusage.end(), dit, BtoMB);
+        output << "]" << ::std::endl;
+
+        output << "[MEM] " << title << "\talloc_curr\t[,";
+        std::transform(alloc_curr.begin(), alloc_curr.end(), dit, BtoMB);
+        output << "]" << ::std::endl;
+
+        output << "[MEM] " << title << "\talloc_peak\t[,";
+        std::transform(alloc_peak.begin(), alloc_peak.end(), dit, BtoMB);
         output << "]";
 
         // print pending stuff, then print entire string at once (minimizes multiple threads/processes mixing output )
@@ -304,13 +374,32 @@ class MemUsage {
     }
 #endif
 
-    void report(::std::string const & title, ::mxx::comm const & comm) {
+    void report(::std::string const & title, ::mxx::comm const & comm, ::std::string const & site = ::std::string()) {
 
       ::std::vector<double> curr_mins, curr_maxs, curr_means, curr_stdevs;
       ::std::vector<double> peak_mins, peak_maxs, peak_means, peak_stdevs;
+      ::std::vector<double> rusage_maxs, alloc_curr_maxs, alloc_peak_maxs, alloc_peak_means;
       int p = comm.size();
       int rank = comm.rank();
 
+      if (mem_curr.size() > 1) {
+        // per phase RSS deltas for the structured output.
+        ::std::vector<double> deltas = get_deltas();
+        ::std::vector<double> delta_mins = ::mxx::reduce(deltas, 0,
+            [](double const & x, double const & y) { return ::std::min(x, y); }, comm);
+        ::std::vector<double> delta_maxs = ::mxx::reduce(deltas, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        ::std::vector<double> delta_means = ::mxx::reduce(deltas, 0, ::std::plus<double>(), comm);
+        ::std::vector<double> peaks = ::mxx::reduce(mem_max, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+
+        if ((rank == 0) && BenchReport::instance().enabled()) {
+          ::std::for_each(delta_means.begin(), delta_means.end(), [&p](double & x) { x /= p; });
+          BenchReport::instance().add_mem(title, site, p, ::std::vector<std::string>(names.begin() + 1, names.end()),
+                                          delta_mins, delta_maxs, delta_means, ::std::vector<double>(peaks.begin() + 1, peaks.end()));
+        }
+      }
+
       if (mem_curr.size() > 0) {
     	  curr_mins = ::mxx::reduce(mem_curr, 0,
     			[](double const & x, double const & y) { return ::std::min(x, y); }, comm);
@@ -328,7 +417,16 @@ class MemUsage {
         ::std::for_each(mem_max.begin(), mem_max.end(), [](double &x) { x = x*x; });
         peak_stdevs = ::mxx::reduce(mem_max, 0, ::std::plus<double>(), comm);
 
+        rusage_maxs = ::mxx::reduce(mem_rusage, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        alloc_curr_maxs = ::mxx::reduce(alloc_curr, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        alloc_peak_maxs = ::mxx::reduce(alloc_peak, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        alloc_peak_means = ::mxx::reduce(alloc_peak, 0, ::std::plus<double>(), comm);
+
         if (rank == 0) {
+          ::std::for_each(alloc_peak_means.begin(), alloc_peak_means.end(), [&p](double & x) { x /= p; });
 
           ::std::for_each(curr_means.begin(), curr_means.end(), [&p](double & x) { x /= p; });
           ::std::transform(curr_stdevs.begin(), curr_stdevs.end(), curr_means.begin(), curr_stdevs.begin(),
@@ -385,6 +483,22 @@ class MemUsage {
 
           output << "[MEM] " << title << "\tpeak_stdev\t[,";
           std::transform(peak_stdevs.begin(), peak_stdevs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\trusage_max\t[,";
+          std::transform(rusage_maxs.begin(), rusage_maxs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\talloc_curr_max\t[,";
+          std::transform(alloc_curr_maxs.begin(), alloc_curr_maxs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\talloc_peak_max\t[,";
+          std::transform(alloc_peak_maxs.begin(), alloc_peak_maxs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\talloc_peak_mean\t[,";
+          std::transform(alloc_peak_means.begin(), alloc_peak_means.end(), dit, BtoMB);
           output << "]";
 
 
@@ -405,16 +519,16 @@ class MemUsage {
 #define BL_MEMUSE_RESET(title)     do {  title##_memusage.reset(); } while (0)
 #define BL_MEMUSE_COLLECTIVE_MARK(title, name, comm) do { title##_memusage.collective_mark(name, comm); } while (0)
 #define BL_MEMUSE_MARK(title, name) do { title##_memusage.mark(name); } while (0)
-#define BL_MEMUSE_REPORT(title) do { title##_memusage.report(#title); } while (0)
-#define BL_MEMUSE_REPORT_NAMED(title, name) do { title##_memusage.report(name); } while (0)
+#define BL_MEMUSE_REPORT(title) do { title##_memusage.report(#title, BL_BENCH_SITE); } while (0)
+#define BL_MEMUSE_REPORT_NAMED(title, name) do { title##_memusage.report(name, BL_BENCH_SITE); } while (0)
 
 #if 0
 // do not use this function for now.  mxx::min_element and max_element has invalid read problem, reported by valgrind.
 #define BL_MEMUSE_REPORT_MPI_LOC(title, name, comm) do { title##_memusage.report_loc(name, comm); } while (0)
 #endif
 
-#define BL_MEMUSE_REPORT_MPI(title, comm) do { title##_memusage.report(#title, comm); } while (0)
-#define BL_MEMUSE_REPORT_MPI_NAMED(title, name, comm) do { title##_memusage.report(name, comm); } while (0)
+#define BL_MEMUSE_REPORT_MPI(title, comm) do { title##_memusage.report(#title, comm, BL_BENCH_SITE); } while (0)
+#define BL_MEMUSE_REPORT_MPI_NAMED(title, name, comm) do { title##_memusage.report(name, comm, BL_BENCH_SITE); } while (0)
 
 
 #else
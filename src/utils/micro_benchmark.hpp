@@ -0,0 +1,172 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    micro_benchmark.hpp
+ * @ingroup plog
+ * @brief   timing harness for small kernels:  warmup, calibrated repetitions, median and MAD, ns/op and GB/s.
+ * @details a kernel is a callable that performs ops_per_call operations and touches bytes_per_op bytes per operation.
+ *          the harness first calls it until at least warmup_ms has elapsed, then picks the number of calls per sample
+ *          so that a sample takes about sample_ms, then takes repetitions samples.  the reported ns/op is the median
+ *          over samples, with the median absolute deviation (MAD) as the spread, since both are insensitive to the
+ *          occasional interrupted sample.  GB/s is computed from the median.
+ *
+ *          do_not_optimize(x) forces x to be materialized, and clobber_memory() forces pending stores, so that the
+ *          compiler cannot remove or hoist the kernel.
+ */
+#ifndef SRC_UTILS_MICRO_BENCHMARK_HPP_
+#define SRC_UTILS_MICRO_BENCHMARK_HPP_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <algorithm>  // sort, min_element, transform
+#include <cmath>      // fabs
+#include <tuple>      // tie
+#include <utility>    // pair
+#include <cstdio>
+
+namespace plog {
+
+/// prevent the compiler from optimizing away the computation of value.
+template <typename T>
+inline void do_not_optimize(T const & value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile char sink;
+  sink = *reinterpret_cast<char const volatile *>(&value);
+#endif
+}
+
+/// prevent the compiler from reordering or eliding memory writes across this point.
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+
+/// timing of 1 kernel.
+struct micro_result {
+    std::string name;
+    double ns_median;     // ns per op
+    double ns_mad;        // median absolute deviation of ns per op
+    double ns_min;
+    double bytes_per_op;
+    size_t samples;
+    size_t calls_per_sample;
+
+    /// GB/s (10^9 bytes) at the median time.
+    double gbps() const { return (ns_median > 0.0) ? bytes_per_op / ns_median : 0.0; }
+};
+
+
+class MicroBench {
+  protected:
+    double warmup_ms;
+    double sample_ms;
+    size_t repetitions;
+    std::vector<micro_result> results;
+
+    using clock = std::chrono::steady_clock;
+
+    static double median(std::vector<double> v) {
+      if (v.size() == 0) return 0.0;
+      std::sort(v.begin(), v.end());
+      size_t n = v.size();
+      return (n % 2 == 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    }
+
+  public:
+    MicroBench(size_t const & _repetitions = 15, double const & _sample_ms = 20.0, double const & _warmup_ms = 50.0) :
+      warmup_ms(_warmup_ms), sample_ms(_sample_ms), repetitions(std::max(_repetitions, static_cast<size_t>(1))) {}
+
+    /// median and median absolute deviation of samples.
+    static std::pair<double, double> median_mad(std::vector<double> const & samples) {
+      double m = median(samples);
+      std::vector<double> dev(samples.size());
+      std::transform(samples.begin(), samples.end(), dev.begin(), [&m](double const & x) { return std::fabs(x - m); });
+      return std::make_pair(m, median(dev));
+    }
+
+    /**
+     * @brief time kernel.  kernel() performs ops_per_call operations.
+     * @return the result, also kept for report().
+     */
+    template <typename Kernel>
+    micro_result run(std::string const & name, size_t const & ops_per_call, double const & bytes_per_op, Kernel && kernel) {
+      // warmup, and estimate the time per call.
+      size_t calls = 0;
+      auto t0 = clock::now();
+      double elapsed = 0.0;
+      do {
+        kernel();
+        clobber_memory();
+        ++calls;
+        elapsed = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+      } while (elapsed < warmup_ms);
+
+      double ms_per_call = elapsed / static_cast<double>(calls);
+      size_t calls_per_sample = std::max(static_cast<size_t>(1), static_cast<size_t>(sample_ms / ms_per_call));
+
+      std::vector<double> ns(repetitions);
+      for (size_t r = 0; r < repetitions; ++r) {
+        auto t1 = clock::now();
+        for (size_t c = 0; c < calls_per_sample; ++c) {
+          kernel();
+          clobber_memory();
+        }
+        auto t2 = clock::now();
+        ns[r] = std::chrono::duration<double, std::nano>(t2 - t1).count() /
+            static_cast<double>(calls_per_sample * std::max(ops_per_call, static_cast<size_t>(1)));
+      }
+
+      micro_result res;
+      res.name = name;
+      std::tie(res.ns_median, res.ns_mad) = median_mad(ns);
+      res.ns_min = *(std::min_element(ns.begin(), ns.end()));
+      res.bytes_per_op = bytes_per_op;
+      res.samples = repetitions;
+      res.calls_per_sample = calls_per_sample;
+      results.push_back(res);
+      return res;
+    }
+
+    std::vector<micro_result> const & get_results() const { return results; }
+
+    void reset() { results.clear(); }
+
+    /// print 1 line per kernel.
+    void report(std::string const & title) const {
+      std::stringstream output;
+      output << std::fixed;
+      output.precision(3);
+      output << "[MICRO] " << title << "\tname\tns/op\tmad\tmin\tGB/s\tsamples x calls" << std::endl;
+      for (auto const & r : results) {
+        output << "[MICRO] " << title << "\t" << r.name << "\t" << r.ns_median << "\t" << r.ns_mad << "\t"
+               << r.ns_min << "\t" << r.gbps() << "\t" << r.samples << "x" << r.calls_per_sample << std::endl;
+      }
+      fflush(stdout);
+      printf("%s", output.str().c_str());
+      fflush(stdout);
+    }
+};
+
+} // end namespace plog
+
+#endif /* SRC_UTILS_MICRO_BENCHMARK_HPP_ */
@@ -33,6 +33,17 @@
 #include "mxx/comm.hpp"
 #include "mxx/benchmark.hpp"
 
+#include "io/comm_schedule.hpp"
+#include "partition/rank_weights.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <numeric>   // accumulate
+#include <algorithm>
+#include <cstdint>
+#include <unistd.h>  // sysconf
+
 namespace bliss {
 
   namespace mxx {
@@ -78,6 +89,77 @@ namespace bliss {
    }
 
 
+   /**
+    * @brief measure the bandwidth between each pair of nodes.  collective.
+    * @return node_count x node_count matrix, row major, on all ranks.  nodes are ordered by their lowest global rank.
+    */
+   inline std::vector<double> node_bandwidth_matrix(::mxx::comm const & comm) {
+     ::mxx::hybrid_comm hc(comm);
+
+     // 1 row per node, from its local rank 0.
+     std::vector<double> bw_row = ::mxx::pairwise_bw_matrix(hc);
+     if (hc.local.rank() != 0) bw_row.clear();
+     return ::mxx::allgatherv(bw_row, comm);
+   }
+
+   /**
+    * @brief install the node aware exchange schedule for comm, ordered by the node bandwidths.  collective.
+    * @param bw_file   node bandwidth matrix file (see imxx::read_node_bandwidth).  measured if empty or unreadable.
+    */
+   inline void install_topology_schedule(::mxx::comm const & comm, std::string const & bw_file = std::string()) {
+     std::vector<double> bw;
+     if (!bw_file.empty()) bw = ::imxx::read_node_bandwidth(bw_file, comm);
+     if (bw.empty()) bw = node_bandwidth_matrix(comm);
+
+     ::imxx::comm_scheduler::instance().install(comm, ::imxx::pairwise_schedule::node_aware(comm, bw));
+   }
+
+
+   /**
+    * @brief measure the relative capacity of each rank.  collective.
+    * @details  speed is the rate of hashed increments into a 32 MB table, which like k-mer counting is bound by the
+    *           random memory accesses.  with by_memory, a rank's weight is the smaller of its speed and its share of the
+    *           node's physical memory, each relative to the mean over the ranks, so that a fast node with little memory
+    *           does not get more than it can hold.
+    * @return 1 weight per rank, on all ranks.  mean 1.
+    */
+   inline std::vector<double> measure_rank_weights(::mxx::comm const & comm, bool const & by_memory = true) {
+     std::vector<uint64_t> table(1UL << 22);
+     uint64_t const mask = table.size() - 1;
+     size_t const iters = 1UL << 24;
+
+     comm.barrier();
+     auto start = std::chrono::steady_clock::now();
+     for (uint64_t i = 0; i < iters; ++i) {
+       uint64_t h = (i + 1) * 0x9E3779B97F4A7C15UL;
+       h ^= h >> 29;
+       table[h & mask] += i;
+     }
+     double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+     // keep the loop.
+     if (table[iters & mask] == 1) secs += 1e-9;
+
+     std::vector<double> speed = ::mxx::allgather(static_cast<double>(iters) / std::max(secs, 1e-9), comm);
+     double mean = std::accumulate(speed.begin(), speed.end(), 0.0) / speed.size();
+     for (auto & x : speed) x /= mean;
+     if (!by_memory) return speed;
+
+     ::mxx::hybrid_comm hc(comm);
+     double mem = static_cast<double>(sysconf(_SC_PHYS_PAGES)) * static_cast<double>(sysconf(_SC_PAGE_SIZE)) / hc.local.size();
+     std::vector<double> memory = ::mxx::allgather(mem, comm);
+     mean = std::accumulate(memory.begin(), memory.end(), 0.0) / memory.size();
+     for (size_t i = 0; i < speed.size(); ++i) speed[i] = std::min(speed[i], memory[i] / mean);
+     return speed;
+   }
+
+   /// measure the rank weights (see measure_rank_weights) and install them for comm.  collective.
+   inline std::vector<double> install_rank_weights(::mxx::comm const & comm, bool const & by_memory = true) {
+     std::vector<double> w = measure_rank_weights(comm, by_memory);
+     ::bliss::partition::rank_weights::instance().install(comm, w);
+     return w;
+   }
+
+
 
   }  // namespace mxx
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    numa_node.hpp
+ * @ingroup bliss::utils
+ * @brief   NUMA node of this process, for placing the pages of the index's tables and mapped files.
+ * @details the node is set by affinity_manager::pin_ranks (utils/affinity.hpp) when a rank's cores are on 1 node.
+ *          until then, or if they span nodes, the node of the calling thread is used.  no MPI or libnuma dependency,
+ *          so the allocators and file mappings can include it.
+ */
+#ifndef SRC_UTILS_NUMA_NODE_HPP_
+#define SRC_UTILS_NUMA_NODE_HPP_
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sys/syscall.h>   // SYS_mbind, SYS_getcpu
+#include <unistd.h>        // syscall
+#endif
+
+namespace bliss {
+
+  namespace utils {
+
+    /// NUMA node of the pinned process, -1 if not pinned to 1 node.
+    inline std::atomic<int> & pinned_numa_node() {
+      static std::atomic<int> node(-1);
+      return node;
+    }
+
+    /// NUMA node of the calling thread, from getcpu.  -1 if unknown.
+    inline int current_numa_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+      unsigned int cpu = 0, node = 0;
+      if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return static_cast<int>(node);
+#endif
+      return -1;
+    }
+
+    /// the node for this process's memory:  the pinned node, else the calling thread's current node.
+    inline int preferred_numa_node() {
+      int node = pinned_numa_node().load(std::memory_order_relaxed);
+      return (node >= 0) ? node : current_numa_node();
+    }
+
+    /**
+     * @brief prefer node for the pages of [p, p + bytes) (mbind MPOL_PREFERRED).  best effort.
+     * @return  false if not set, in which case the default (first touch) policy applies.
+     */
+    inline bool prefer_numa_node(void * p, size_t const & bytes, int const & node) {
+#if defined(__linux__) && defined(SYS_mbind)
+      // node mask for up to 1024 nodes.
+      constexpr size_t bits = 8 * sizeof(unsigned long);
+      unsigned long mask[1024 / bits] = {0};
+      if ((node < 0) || (node >= 1024)) return false;
+      mask[node / bits] = 1UL << (node % bits);
+
+      // MPOL_PREFERRED = 1, no flags.  numaif.h/libnuma are not required for the raw syscall.
+      return syscall(SYS_mbind, p, bytes, 1, mask, 1024UL, 0U) == 0;
+#else
+      (void)p; (void)bytes; (void)node;
+      return false;
+#endif
+    }
+
+  } // namespace utils
+} // namespace bliss
+
+#endif /* SRC_UTILS_NUMA_NODE_HPP_ */
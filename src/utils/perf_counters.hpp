@@ -0,0 +1,266 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    perf_counters.hpp
+ * @ingroup plog
+ * @brief   hardware counters (cycles, instructions, LLC misses, dTLB misses, branch misses) per BL_BENCH phase.
+ * @details the counters are opened once per process with perf_event_open (linux), for the calling thread, and read
+ *          at BL_BENCH_START and BL_BENCH_END, so each phase gets the difference.  threads spawned later (e.g. OpenMP)
+ *          are counted only after they exit, so for threaded phases the numbers are for the master thread.
+ *          counters that cannot be opened (unsupported, or perf_event_paranoid) are reported as -1.
+ *
+ *          enabled with BL_BENCHMARK_PERF == 1 (cmake ENABLE_PERF_BENCHMARK).  report(title, comm) prints the
+ *          min/max/mean over ranks of each counter for each phase, and the mean instructions per cycle.
+ */
+#ifndef SRC_UTILS_PERF_COUNTERS_HPP_
+#define SRC_UTILS_PERF_COUNTERS_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iterator>   // ostream_iterator
+#include <algorithm>
+#include <cstdint>
+#include <cstring>    // memset
+#include <cstdio>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <mxx/reduction.hpp>
+
+namespace plog {
+
+/// the process wide set of hardware counters.
+class PerfCounters {
+  public:
+    static constexpr int num_counters = 5;
+
+    static char const * counter_name(int const & i) {
+      static char const * names[num_counters] = { "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses" };
+      return names[i];
+    }
+
+  protected:
+    int fds[num_counters];
+
+#if defined(__linux__)
+    static int open_counter(uint32_t const & type, uint64_t const & config) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.disabled = 0;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    PerfCounters() {
+#if defined(__linux__)
+      fds[0] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+      fds[1] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+      fds[2] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+      fds[3] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+      fds[4] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+      for (int i = 0; i < num_counters; ++i) fds[i] = -1;
+#endif
+    }
+
+  public:
+    ~PerfCounters() {
+#if defined(__linux__)
+      for (int i = 0; i < num_counters; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+      }
+#endif
+    }
+
+    static PerfCounters & instance() {
+      static PerfCounters counters;
+      return counters;
+    }
+
+    bool available(int const & i) const { return fds[i] >= 0; }
+
+    /// current counts.  unavailable counters read as 0.
+    void read(int64_t * values) const {
+      for (int i = 0; i < num_counters; ++i) {
+        values[i] = 0;
+#if defined(__linux__)
+        if ((fds[i] < 0) || (::read(fds[i], values + i, sizeof(int64_t)) != sizeof(int64_t))) values[i] = 0;
+#endif
+      }
+    }
+};
+
+
+/// hardware counter differences of the phases of 1 BL_BENCH title.
+class PerfUsage {
+  protected:
+    std::vector<std::string> names;
+    std::vector<double> counts[PerfCounters::num_counters];
+    int64_t t1[PerfCounters::num_counters];
+
+  public:
+    PerfUsage() {
+      reset();
+    }
+
+    void reset() {
+      names.clear();
+      for (int i = 0; i < PerfCounters::num_counters; ++i) counts[i].clear();
+      PerfCounters::instance().read(t1);
+    }
+
+    void start() {
+      PerfCounters::instance().read(t1);
+    }
+
+    void end(::std::string const & name) {
+      int64_t t2[PerfCounters::num_counters];
+      PerfCounters::instance().read(t2);
+      names.push_back(name);
+      for (int i = 0; i < PerfCounters::num_counters; ++i) {
+        counts[i].push_back(PerfCounters::instance().available(i) ? static_cast<double>(t2[i] - t1[i]) : -1.0);
+      }
+    }
+
+    std::vector<std::string> const & get_names() const { return names; }
+    std::vector<double> const & get_counts(int const & counter) const { return counts[counter]; }
+
+    void report(::std::string const & title) {
+      std::stringstream output;
+      std::ostream_iterator<std::string> nit(output, ",");
+      std::ostream_iterator<double> dit(output, ",");
+
+      output << std::fixed;
+      output << "[PERF] " << title << "\theader\t[,";
+      std::copy(names.begin(), names.end(), nit);
+      output << "]";
+
+      output.precision(0);
+      for (int i = 0; i < PerfCounters::num_counters; ++i) {
+        output << std::endl << "[PERF] " << title << "\t" << PerfCounters::counter_name(i) << "\t[,";
+        std::copy(counts[i].begin(), counts[i].end(), dit);
+        output << "]";
+      }
+
+      output.precision(3);
+      output << std::endl << "[PERF] " << title << "\tipc\t[,";
+      std::transform(counts[1].begin(), counts[1].end(), counts[0].begin(), dit,
+                     [](double const & ins, double const & cyc) { return (cyc > 0) ? ins / cyc : 0.0; });
+      output << "]";
+
+      fflush(stdout);
+      printf("%s\n", output.str().c_str());
+      fflush(stdout);
+    }
+
+    void report(::std::string const & title, ::mxx::comm const & comm) {
+      std::vector<double> mins[PerfCounters::num_counters], maxs[PerfCounters::num_counters], means[PerfCounters::num_counters];
+      int p = comm.size();
+      int rank = comm.rank();
+
+      if (names.size() > 0) {
+        for (int i = 0; i < PerfCounters::num_counters; ++i) {
+          mins[i] = ::mxx::reduce(counts[i], 0,
+              [](double const & x, double const & y) { return ::std::min(x, y); }, comm);
+          maxs[i] = ::mxx::reduce(counts[i], 0,
+              [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+          means[i] = ::mxx::reduce(counts[i], 0, ::std::plus<double>(), comm);
+          if (rank == 0) ::std::for_each(means[i].begin(), means[i].end(), [&p](double & x) { x /= p; });
+        }
+      }
+
+      if (rank == 0) {
+        std::stringstream output;
+        std::ostream_iterator<std::string> nit(output, ",");
+        std::ostream_iterator<double> dit(output, ",");
+
+        output << std::fixed;
+        output << "[PERF] " << "R " << rank << "/" << p << std::endl;
+
+        output << "[PERF] " << title << "\theader\t[,";
+        std::copy(names.begin(), names.end(), nit);
+        output << "]";
+
+        output.precision(0);
+        for (int i = 0; i < PerfCounters::num_counters; ++i) {
+          output << std::endl << "[PERF] " << title << "\t" << PerfCounters::counter_name(i) << "_min\t[,";
+          std::copy(mins[i].begin(), mins[i].end(), dit);
+          output << "]" << std::endl;
+          output << "[PERF] " << title << "\t" << PerfCounters::counter_name(i) << "_max\t[,";
+          std::copy(maxs[i].begin(), maxs[i].end(), dit);
+          output << "]" << std::endl;
+          output << "[PERF] " << title << "\t" << PerfCounters::counter_name(i) << "_mean\t[,";
+          std::copy(means[i].begin(), means[i].end(), dit);
+          output << "]";
+        }
+
+        output.precision(3);
+        output << std::endl << "[PERF] " << title << "\tipc_mean\t[,";
+        std::transform(means[1].begin(), means[1].end(), means[0].begin(), dit,
+                       [](double const & ins, double const & cyc) { return (cyc > 0) ? ins / cyc : 0.0; });
+        output << "]";
+
+        fflush(stdout);
+        printf("%s\n", output.str().c_str());
+        fflush(stdout);
+      }
+      comm.barrier();
+    }
+};
+
+} // end namespace plog
+
+#if defined(BL_BENCHMARK_PERF) && (BL_BENCHMARK_PERF == 1)
+
+#define BL_PERF_INIT(title)      ::plog::PerfUsage title##_perf;
+#define BL_PERF_RESET(title)     do { title##_perf.reset(); } while (0)
+#define BL_PERF_START(title)     do { title##_perf.start(); } while (0)
+#define BL_PERF_END(title, name) do { title##_perf.end(name); } while (0)
+#define BL_PERF_REPORT(title) do { title##_perf.report(#title); } while (0)
+#define BL_PERF_REPORT_NAMED(title, name) do { title##_perf.report(name); } while (0)
+#define BL_PERF_REPORT_MPI(title, comm) do { title##_perf.report(#title, comm); } while (0)
+#define BL_PERF_REPORT_MPI_NAMED(title, name, comm) do { title##_perf.report(name, comm); } while (0)
+
+#else
+
+#define BL_PERF_INIT(title)
+#define BL_PERF_RESET(title)
+#define BL_PERF_START(title)
+#define BL_PERF_END(title, name)
+#define BL_PERF_REPORT(title)
+#define BL_PERF_REPORT_NAMED(title, name)
+#define BL_PERF_REPORT_MPI(title, comm)
+#define BL_PERF_REPORT_MPI_NAMED(title, name, comm)
+
+#endif
+
+#endif /* SRC_UTILS_PERF_COUNTERS_HPP_ */
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    phase_trace.hpp
+ * @ingroup plog
+ * @brief   low overhead tracing of the BL_BENCH phases, exported as Chrome trace event JSON.
+ * @details each BL_BENCH_START/BL_BENCH_END pair (and the COLLECTIVE variants) records 1 event, with the title,
+ *          the phase name, the thread, and steady clock begin and end times, into a fixed size ring buffer.
+ *          recording is a clock read and a 64 byte copy, with no barriers and no allocation, so it is compiled in
+ *          whenever BL_PHASE_TRACE == 1 (cmake ENABLE_PHASE_TRACE, on by default), independent of BL_BENCHMARK.
+ *          when the buffer is full the oldest events are overwritten.
+ *
+ *          the ring size is BL_TRACE_EVENTS (environment, default 16384 events, 0 disables recording).
+ *          BL_TRACE_EXPORT(filename, comm) is collective:  the clock offset of each rank relative to rank 0 is
+ *          estimated by ping-pong (minimum round trip of several rounds), the events are gathered to rank 0 and
+ *          written with the offsets applied, 1 pid per rank, so that the file can be loaded by chrome://tracing
+ *          or ui.perfetto.dev.
+ */
+#ifndef SRC_UTILS_PHASE_TRACE_HPP_
+#define SRC_UTILS_PHASE_TRACE_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstring>   // strncpy
+#include <cstdlib>   // getenv, strtoul
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>  // std::min
+#include <cstdio>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+namespace plog {
+
+/// 1 traced phase.  fixed size so the ring buffer is a flat array.
+struct trace_event {
+    char title[24];
+    char name[24];
+    int64_t begin;   // ns, steady clock
+    int64_t end;
+    uint32_t tid;
+    uint32_t pad;
+};
+
+class PhaseTrace {
+  protected:
+    std::vector<trace_event> ring;
+    std::atomic<size_t> next;
+    std::atomic<uint32_t> next_tid;
+
+    static void copy_name(char * dest, char const * src, size_t const & len) {
+      strncpy(dest, src, len - 1);
+      dest[len - 1] = 0;
+    }
+
+    static void append_escaped(std::stringstream & ss, char const * s) {
+      for (; *s != 0; ++s) {
+        if (*s == '"' || *s == '\\') ss << '\\';
+        ss << *s;
+      }
+    }
+
+    /// recorded events, oldest first.
+    std::vector<trace_event> ordered() const {
+      size_t n = next.load();
+      size_t cap = ring.size();
+      std::vector<trace_event> result;
+      if (cap == 0) return result;
+      size_t first = (n > cap) ? (n - cap) : 0;
+      result.reserve(n - first);
+      for (size_t i = first; i < n; ++i) result.push_back(ring[i % cap]);
+      return result;
+    }
+
+    /// events to chrome trace "X" events, with timestamps relative to origin.
+    static void append_json(std::stringstream & ss, std::vector<trace_event> const & events,
+                            int const & pid, int64_t const & origin, bool & first) {
+      ss.precision(3);
+      ss << std::fixed;
+      for (auto const & e : events) {
+        ss << (first ? "\n" : ",\n");
+        first = false;
+        ss << "{\"name\":\"";
+        append_escaped(ss, e.name);
+        ss << "\",\"cat\":\"";
+        append_escaped(ss, e.title);
+        ss << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << e.tid
+           << ",\"ts\":" << static_cast<double>(e.begin - origin) / 1000.0
+           << ",\"dur\":" << static_cast<double>(e.end - e.begin) / 1000.0 << "}";
+      }
+    }
+
+  public:
+    PhaseTrace() : next(0), next_tid(0) {
+      size_t cap = 16384;
+      char const * c = getenv("BL_TRACE_EVENTS");
+      if (c != nullptr) cap = strtoul(c, nullptr, 10);
+      ring.resize(cap);
+    }
+
+    static PhaseTrace & instance() {
+      static PhaseTrace trace;
+      return trace;
+    }
+
+    static inline int64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// small per thread id, in order of first use.
+    inline uint32_t thread_id() {
+      static thread_local uint32_t tid = next_tid.fetch_add(1);
+      return tid;
+    }
+
+    inline void record(char const * title, char const * name, int64_t const & begin, int64_t const & end) {
+      if (ring.size() == 0) return;
+      trace_event & e = ring[next.fetch_add(1, std::memory_order_relaxed) % ring.size()];
+      copy_name(e.title, title, sizeof(e.title));
+      copy_name(e.name, name, sizeof(e.name));
+      e.begin = begin;
+      e.end = end;
+      e.tid = thread_id();
+    }
+    inline void record(char const * title, std::string const & name, int64_t const & begin, int64_t const & end) {
+      record(title, name.c_str(), begin, end);
+    }
+
+    size_t capacity() const { return ring.size(); }
+    /// number of events in the buffer.
+    size_t size() const { return std::min(next.load(), ring.size()); }
+    /// number of events dropped because the buffer wrapped.
+    size_t dropped() const { return next.load() - size(); }
+    void clear() { next.store(0); }
+
+    std::vector<trace_event> get_events() const { return ordered(); }
+
+    /// chrome trace json of this process's events.
+    std::string to_json(int const & pid = 0) const {
+      std::vector<trace_event> events = ordered();
+      int64_t origin = events.empty() ? 0 : events.front().begin;
+      std::stringstream ss;
+      bool first = true;
+      ss << "{\"traceEvents\":[";
+      append_json(ss, events, pid, origin, first);
+      ss << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+      return ss.str();
+    }
+
+    /// write this process's events.
+    void write(std::string const & filename) const {
+      std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+      if (!ofs.is_open()) {
+        fprintf(stderr, "ERROR: cannot open trace output file %s\n", filename.c_str());
+        return;
+      }
+      ofs << to_json();
+    }
+
+    /// clock offset of this rank relative to rank 0, in ns.  collective.  rank 0 pings each rank in turn.
+    static int64_t clock_offset(::mxx::comm const & comm, int const & rounds = 8) {
+      int64_t offset = 0;
+      int64_t t0, t1, remote;
+      for (int r = 1; r < comm.size(); ++r) {
+        if (comm.rank() == 0) {
+          int64_t best_rtt = ::std::numeric_limits<int64_t>::max();
+          for (int i = 0; i < rounds; ++i) {
+            t0 = now();
+            MPI_Send(&t0, 1, MPI_INT64_T, r, 0, comm);
+            MPI_Recv(&remote, 1, MPI_INT64_T, r, 0, comm, MPI_STATUS_IGNORE);
+            t1 = now();
+            if ((t1 - t0) < best_rtt) {
+              best_rtt = t1 - t0;
+              offset = remote - (t0 + t1) / 2;
+            }
+          }
+          MPI_Send(&offset, 1, MPI_INT64_T, r, 1, comm);
+        } else if (comm.rank() == r) {
+          for (int i = 0; i < rounds; ++i) {
+            MPI_Recv(&t0, 1, MPI_INT64_T, 0, 0, comm, MPI_STATUS_IGNORE);
+            remote = now();
+            MPI_Send(&remote, 1, MPI_INT64_T, 0, 0, comm);
+          }
+          MPI_Recv(&offset, 1, MPI_INT64_T, 0, 1, comm, MPI_STATUS_IGNORE);
+        }
+      }
+      return (comm.rank() == 0) ? 0 : offset;
+    }
+
+    /// gather the events of all ranks to rank 0, correct the clock offsets, and write chrome trace json.  collective.
+    void write(std::string const & filename, ::mxx::comm const & comm) const {
+      int64_t offset = clock_offset(comm);
+
+      std::vector<trace_event> events = ordered();
+      // shift to rank 0's clock before gathering, so only the events need to be sent.
+      for (auto & e : events) { e.begin -= offset; e.end -= offset; }
+
+      std::vector<char> bytes(reinterpret_cast<char const *>(events.data()),
+                              reinterpret_cast<char const *>(events.data() + events.size()));
+      std::vector<size_t> counts = ::mxx::gather(events.size(), 0, comm);
+      std::vector<char> all = ::mxx::gatherv(bytes, 0, comm);
+
+      if (comm.rank() == 0) {
+        trace_event const * ptr = reinterpret_cast<trace_event const *>(all.data());
+        int64_t origin = ::std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < all.size() / sizeof(trace_event); ++i) origin = std::min(origin, ptr[i].begin);
+
+        std::stringstream ss;
+        bool first = true;
+        ss << "{\"traceEvents\":[";
+        for (int r = 0; r < comm.size(); ++r) {
+          std::vector<trace_event> rank_events(ptr, ptr + counts[r]);
+          append_json(ss, rank_events, r, origin, first);
+          ptr += counts[r];
+        }
+        ss << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+        std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+        if (!ofs.is_open()) {
+          fprintf(stderr, "ERROR: cannot open trace output file %s\n", filename.c_str());
+        } else {
+          ofs << ss.str();
+        }
+      }
+      comm.barrier();
+    }
+};
+
+/// begin time of the current phase of 1 BL_BENCH title.
+struct trace_span {
+    int64_t t;
+    trace_span() : t(PhaseTrace::now()) {}
+    inline void start() { t = PhaseTrace::now(); }
+    template <typename NameType>
+    inline void end(char const * title, NameType const & name) {
+      PhaseTrace::instance().record(title, name, t, PhaseTrace::now());
+    }
+};
+
+} // end namespace plog
+
+#if defined(BL_PHASE_TRACE) && (BL_PHASE_TRACE == 1)
+
+#define BL_TRACE_INIT(title)              ::plog::trace_span title##_trace;
+#define BL_TRACE_START(title)             do { title##_trace.start(); } while (0)
+#define BL_TRACE_END(title, name)         do { title##_trace.end(#title, name); } while (0)
+#define BL_TRACE_EXPORT(filename, comm)   do { ::plog::PhaseTrace::instance().write(filename, comm); } while (0)
+
+#else
+
+#define BL_TRACE_INIT(title)
+#define BL_TRACE_START(title)
+#define BL_TRACE_END(title, name)
+#define BL_TRACE_EXPORT(filename, comm)
+
+#endif
+
+#endif /* SRC_UTILS_PHASE_TRACE_HPP_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_affinity.cpp
+ * @ingroup
+ * @brief   tests the core selection of the affinity manager on synthetic topologies, and topology discovery.
+ */
+
+#include "utils/affinity.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+
+
+TEST(Affinity, cpulist)
+{
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), ::bliss::utils::parse_cpulist("0-3,8,10-11"));
+  EXPECT_EQ(std::vector<int>({5}), ::bliss::utils::parse_cpulist("5\n"));
+  EXPECT_TRUE(::bliss::utils::parse_cpulist("").empty());
+}
+
+TEST(Affinity, policy)
+{
+  using ::bliss::utils::affinity_policy;
+  for (auto p : {affinity_policy::none, affinity_policy::compact, affinity_policy::spread}) {
+    EXPECT_EQ(p, ::bliss::utils::parse_affinity_policy(::bliss::utils::to_string(p)));
+  }
+  EXPECT_EQ(affinity_policy::none, ::bliss::utils::parse_affinity_policy("bogus"));
+}
+
+TEST(Affinity, compact)
+{
+  using ::bliss::utils::affinity_policy;
+  // 2 nodes of 4 cores.
+  std::vector<int> nodes = {0, 0, 0, 0, 1, 1, 1, 1};
+
+  EXPECT_TRUE(::bliss::utils::select_cores(nodes, 0, 2, affinity_policy::none).empty());
+
+  // 2 ranks:  1 node each.
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2, 3}), ::bliss::utils::select_cores(nodes, 0, 2, affinity_policy::compact));
+  EXPECT_EQ(std::vector<size_t>({4, 5, 6, 7}), ::bliss::utils::select_cores(nodes, 1, 2, affinity_policy::compact));
+
+  // 3 ranks:  every core used once, the first ranks get the extra cores.
+  std::vector<size_t> all;
+  for (int r = 0; r < 3; ++r) {
+    std::vector<size_t> cs = ::bliss::utils::select_cores(nodes, r, 3, affinity_policy::compact);
+    EXPECT_EQ((r < 2) ? 3UL : 2UL, cs.size());
+    all.insert(all.end(), cs.begin(), cs.end());
+  }
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2, 3, 4, 5, 6, 7}), all);
+
+  // more ranks than cores:  shared round robin.
+  EXPECT_EQ(std::vector<size_t>({1}), ::bliss::utils::select_cores(nodes, 9, 12, affinity_policy::compact));
+}
+
+TEST(Affinity, spread)
+{
+  using ::bliss::utils::affinity_policy;
+  std::vector<int> nodes = {0, 0, 0, 0, 1, 1, 1, 1};
+
+  // ranks alternate nodes, and split their node's cores.
+  EXPECT_EQ(std::vector<size_t>({0, 1}), ::bliss::utils::select_cores(nodes, 0, 4, affinity_policy::spread));
+  EXPECT_EQ(std::vector<size_t>({4, 5}), ::bliss::utils::select_cores(nodes, 1, 4, affinity_policy::spread));
+  EXPECT_EQ(std::vector<size_t>({2, 3}), ::bliss::utils::select_cores(nodes, 2, 4, affinity_policy::spread));
+  EXPECT_EQ(std::vector<size_t>({6, 7}), ::bliss::utils::select_cores(nodes, 3, 4, affinity_policy::spread));
+
+  // 3 ranks:  node 0 has 2 ranks, node 1 has 1.
+  EXPECT_EQ(std::vector<size_t>({0, 1}), ::bliss::utils::select_cores(nodes, 0, 3, affinity_policy::spread));
+  EXPECT_EQ(std::vector<size_t>({4, 5, 6, 7}), ::bliss::utils::select_cores(nodes, 1, 3, affinity_policy::spread));
+  EXPECT_EQ(std::vector<size_t>({2, 3}), ::bliss::utils::select_cores(nodes, 2, 3, affinity_policy::spread));
+
+  // every rank's cores are on 1 node.
+  for (int r = 0; r < 5; ++r) {
+    std::vector<size_t> cs = ::bliss::utils::select_cores(nodes, r, 5, affinity_policy::spread);
+    ASSERT_FALSE(cs.empty());
+    for (size_t c : cs) EXPECT_EQ(nodes[cs.front()], nodes[c]);
+  }
+}
+
+TEST(Affinity, discover)
+{
+  ::bliss::utils::cpu_topology topo = ::bliss::utils::cpu_topology::discover();
+  ASSERT_FALSE(topo.cores.empty());
+  EXPECT_GE(topo.node_count(), 1UL);
+
+  // each cpu is in 1 core.
+  std::vector<int> pus;
+  for (auto const & c : topo.cores) {
+    EXPECT_FALSE(c.pus.empty());
+    EXPECT_GE(c.node, 0);
+    pus.insert(pus.end(), c.pus.begin(), c.pus.end());
+  }
+  std::sort(pus.begin(), pus.end());
+  EXPECT_EQ(pus.end(), std::adjacent_find(pus.begin(), pus.end()));
+}
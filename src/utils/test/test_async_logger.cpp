@@ -0,0 +1,96 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_async_logger.cpp
+ * @ingroup
+ * @brief   tests the per thread log rings and the background writing of the async logger
+ */
+
+#include "utils/async_logger.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+
+
+TEST(AsyncLogger, ring)
+{
+  ::bliss::log::log_ring ring(3);
+  EXPECT_EQ(4UL, ring.capacity());
+
+  for (int i = 0; i < 5; ++i) {
+    std::string msg = std::to_string(i);
+    EXPECT_EQ(i < 4, ring.push(msg.data(), msg.size()));
+  }
+  EXPECT_EQ(4UL, ring.size());
+  EXPECT_EQ(1UL, ring.take_dropped());
+  EXPECT_EQ(0UL, ring.take_dropped());
+
+  std::vector<std::string> got;
+  EXPECT_EQ(4UL, ring.drain([&got](char const * t, size_t const & len) { got.emplace_back(t, len); }));
+  EXPECT_EQ(std::vector<std::string>({"0", "1", "2", "3"}), got);
+  EXPECT_EQ(0UL, ring.size());
+
+  // long messages are truncated to the record.
+  std::string big(1000, 'x');
+  EXPECT_TRUE(ring.push(big.data(), big.size()));
+  got.clear();
+  ring.drain([&got](char const * t, size_t const & len) { got.emplace_back(t, len); });
+  ASSERT_EQ(1UL, got.size());
+  EXPECT_EQ(sizeof(::bliss::log::log_ring::record::text), got[0].size());
+}
+
+TEST(AsyncLogger, threads)
+{
+  std::string prefix("/tmp/bliss_test_async_logger");
+  std::string filename = prefix + ".0.log";
+
+  ::bliss::log::async_logger logger;
+  logger.configure(prefix);
+  logger.start();
+  EXPECT_TRUE(logger.is_running());
+
+  int const nthreads = 4;
+  int const nmsgs = 500;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&logger, t, nmsgs]() {
+      for (int i = 0; i < nmsgs; ++i) logger.log(std::to_string(t) + " " + std::to_string(i));
+    });
+  }
+  for (auto & th : threads) th.join();
+  logger.stop();
+  EXPECT_FALSE(logger.is_running());
+
+  // every message once, each thread's in order.
+  std::ifstream ifs(filename);
+  std::vector<int> next(nthreads, 0);
+  int t, i;
+  size_t lines = 0;
+  while (ifs >> t >> i) {
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, nthreads);
+    EXPECT_EQ(next[t], i);
+    next[t] = i + 1;
+    ++lines;
+  }
+  EXPECT_EQ(static_cast<size_t>(nthreads * nmsgs), lines);
+
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_benchmark_macros.cpp
+ * @ingroup
+ * @brief   builds the BL_BENCH macros with benchmarking turned on, whatever ENABLE_BENCHMARKING is, as statements in
+ *          unbraced if/else branches.  the collective reports are compiled but not run.
+ */
+
+#include "bliss-logger_config.hpp"
+
+// turn on the benchmark macros for this file only.
+#undef BL_BENCHMARK
+#define BL_BENCHMARK 1
+#undef BL_BENCHMARK_TIME
+#define BL_BENCHMARK_TIME 1
+#undef BL_BENCHMARK_MEM
+#define BL_BENCHMARK_MEM 1
+#undef BL_BENCHMARK_PERF
+#define BL_BENCHMARK_PERF 1
+#undef BL_BENCHMARK_BW
+#define BL_BENCHMARK_BW 1
+
+#include "utils/benchmark_utils.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <numeric>
+
+
+/// every collective macro, each as a single statement.  not called:  needs MPI.
+void benchmark_macros_mpi(::mxx::comm const & comm, bool const & flag) {
+  BL_BENCH_INIT(mpi);
+
+  if (flag) BL_BENCH_COLLECTIVE_START(mpi, "start", comm);
+  else BL_BENCH_START(mpi);
+
+  if (flag) BL_BENCH_COLLECTIVE_END(mpi, "end", 1, comm);
+  else BL_BENCH_END(mpi, "end", 1);
+
+  if (flag) BL_BENCH_REPORT_MPI(mpi, comm.rank(), comm);
+  else BL_BENCH_REPORT_MPI_NAMED(mpi, "mpi", comm);
+
+  if (flag) BL_BENCH_PEAK_BANDWIDTH(comm);
+  else BL_BENCH_AFFINITY(comm);
+}
+
+TEST(BenchMacros, local)
+{
+  bool flag = true;
+  std::vector<size_t> data(1000);
+
+  BL_BENCH_INIT(local);
+
+  if (flag) BL_BENCH_RESET(local);
+  else BL_BENCH_START(local);
+
+  if (flag) BL_BENCH_START(local);
+  else BL_BENCH_RESET(local);
+  std::iota(data.begin(), data.end(), 0);
+  if (flag) BL_BENCH_END(local, "iota", data.size());
+  else BL_BENCH_END(local, "none", 0);
+  BL_BENCH_BYTES(local, data.size() * sizeof(size_t));
+
+  if (flag) BL_BENCH_LOOP_START(local, 0);
+  else BL_BENCH_LOOP_RESUME(local, 0);
+  if (flag) BL_BENCH_LOOP_PAUSE(local, 0);
+  else BL_BENCH_LOOP_END(local, 0, "loop", 0);
+
+  if (flag) BL_BENCH_REPORT(local, 0);
+  else BL_BENCH_REPORT_NAMED(local, "local");
+
+  EXPECT_EQ(999UL, data.back());
+}
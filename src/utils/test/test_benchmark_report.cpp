@@ -0,0 +1,83 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_benchmark_report.cpp
+ * @ingroup
+ * @brief   tests the aggregation and formatting of the structured benchmark output
+ */
+
+#include "utils/benchmark_report.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+
+
+TEST(BenchReport, aggregate)
+{
+  ::plog::BenchReport rep;
+  rep.set_output(std::string(), false);
+
+  std::vector<std::string> names = {"read", "insert"};
+  rep.add_time("build", "a.hpp:10", 4, names, {1.0, 2.0}, {3.0, 4.0}, {2.0, 3.0}, {10, 20}, {30, 40}, {20, 30});
+  rep.add_time("build", "a.hpp:10", 4, names, {0.5, 2.5}, {3.5, 3.0}, {1.0, 3.0}, {10, 20}, {30, 40}, {20, 30});
+  rep.add_time("build", "b.hpp:20", 4, names, {1.0, 2.0}, {3.0, 4.0}, {2.0, 3.0}, {10, 20}, {30, 40}, {20, 30});
+  rep.add_mem("build", "a.hpp:10", 4, names, {-8, 16}, {8, 32}, {0, 24}, {100, 200});
+
+  auto const & phases = rep.get_phases();
+  ASSERT_EQ(4UL, phases.size());
+
+  // repeated calls at the same site are aggregated.
+  EXPECT_EQ("read", phases[0].name);
+  EXPECT_EQ(2UL, phases[0].calls);
+  EXPECT_EQ(4, phases[0].ranks);
+  EXPECT_EQ(0.5, phases[0].dur_min);
+  EXPECT_EQ(3.5, phases[0].dur_max);
+  EXPECT_EQ(3.0, phases[0].dur_mean);
+  EXPECT_EQ(40.0, phases[0].cnt_mean);
+  EXPECT_NEAR(40.0 / 3.0, phases[0].throughput(), 1e-9);
+  EXPECT_EQ(1UL, phases[0].mem_calls);
+  EXPECT_EQ(-8.0, phases[0].rss_delta_min);
+  EXPECT_EQ(100.0, phases[0].peak_max);
+
+  EXPECT_EQ("insert", phases[1].name);
+  EXPECT_EQ(4.0, phases[1].dur_max);
+  EXPECT_EQ(6.0, phases[1].dur_mean);
+  EXPECT_EQ(24.0, phases[1].rss_delta_mean);
+
+  // a different call site is a different entry.
+  EXPECT_EQ("b.hpp:20", phases[2].site);
+  EXPECT_EQ(1UL, phases[2].calls);
+  EXPECT_EQ(0UL, phases[2].mem_calls);
+
+  std::string csv = rep.to_csv();
+  EXPECT_EQ(0UL, csv.find("title,site,phase,"));
+  EXPECT_NE(std::string::npos, csv.find("build,a.hpp:10,read,4,2,"));
+
+  std::string json = rep.to_json();
+  EXPECT_EQ('[', json[0]);
+  EXPECT_NE(std::string::npos, json.find("\"site\":\"b.hpp:20\",\"phase\":\"read\""));
+}
+
+TEST(BenchReport, escape)
+{
+  ::plog::BenchReport rep;
+  rep.set_output(std::string(), true);
+  rep.add_time("map:find", "x", 1, {"a,\"b\""}, {1}, {1}, {1}, {1}, {1}, {1});
+
+  EXPECT_NE(std::string::npos, rep.to_csv().find("\"a,\"\"b\"\"\""));
+  EXPECT_NE(std::string::npos, rep.to_json().find("\"phase\":\"a,\\\"b\\\"\""));
+}
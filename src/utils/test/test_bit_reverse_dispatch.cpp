@@ -0,0 +1,152 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <random>
+#include <cstring>
+
+// include files to test
+#include "utils/bitgroup_dispatch.hpp"
+
+/// scalar reference:  reverse the BITS groups of the lowest (8 * BYTES - PAD) bits, optionally negating.
+template <unsigned int BITS, uint16_t PAD, bool NEGATE, size_t BYTES>
+void reference_reverse(uint8_t * out, uint8_t const * in) {
+  constexpr size_t nbits = BYTES * 8 - PAD;
+  memset(out, 0, BYTES);
+  for (size_t b = 0; b < nbits; ++b) {
+    size_t group = b / BITS;
+    size_t src = (nbits / BITS - 1 - group) * BITS + (b % BITS);
+    uint8_t v = (in[src >> 3] >> (src & 7)) & 0x1;
+    if (NEGATE) v ^= 0x1;
+    out[b >> 3] |= static_cast<uint8_t>(v << (b & 7));
+  }
+}
+
+template <unsigned int BITS, uint16_t PAD, bool NEGATE, size_t BYTES>
+void check_kernel(void (*kernel)(uint8_t *, uint8_t const *)) {
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> distribution(0, 255);
+
+  uint8_t in[BYTES], out[BYTES + 1], gold[BYTES];
+
+  for (int iter = 0; iter < 20; ++iter) {
+    for (size_t i = 0; i < BYTES; ++i) in[i] = distribution(generator);
+    // inputs have zero padding bits
+    if (PAD > 0) {
+      for (size_t b = BYTES * 8 - PAD; b < BYTES * 8; ++b) in[b >> 3] &= ~(1 << (b & 7));
+    }
+
+    out[BYTES] = 0xA5;   // guard byte
+    reference_reverse<BITS, PAD, NEGATE, BYTES>(gold, in);
+    kernel(out, in);
+
+    for (size_t i = 0; i < BYTES; ++i) {
+      ASSERT_EQ(gold[i], out[i]) << "bits " << BITS << " pad " << PAD << " negate " << NEGATE << " bytes " << BYTES << " at byte " << i;
+    }
+    ASSERT_EQ(0xA5, out[BYTES]) << "wrote past the end";
+  }
+}
+
+#if defined(BLISS_BITREV_DISPATCH)
+
+// PAD values valid for BITS and BYTES:  the first 3 values that leave a multiple of BITS
+#define CHECK_PADS(KERNEL, BITS, BYTES) \
+  check_kernel<BITS, ((BYTES * 8) % BITS), false, BYTES>(&bliss::utils::bit_ops::dispatch::detail::KERNEL<BITS, ((BYTES * 8) % BITS), false, BYTES>); \
+  check_kernel<BITS, ((BYTES * 8) % BITS) + 5 * BITS, false, BYTES>(&bliss::utils::bit_ops::dispatch::detail::KERNEL<BITS, ((BYTES * 8) % BITS) + 5 * BITS, false, BYTES>); \
+  check_kernel<BITS, ((BYTES * 8) % BITS) + 13 * BITS, false, BYTES>(&bliss::utils::bit_ops::dispatch::detail::KERNEL<BITS, ((BYTES * 8) % BITS) + 13 * BITS, false, BYTES>); \
+  check_kernel<BITS, ((BYTES * 8) % BITS), true, BYTES>(&bliss::utils::bit_ops::dispatch::detail::KERNEL<BITS, ((BYTES * 8) % BITS), true, BYTES>); \
+  check_kernel<BITS, ((BYTES * 8) % BITS) + 7 * BITS, true, BYTES>(&bliss::utils::bit_ops::dispatch::detail::KERNEL<BITS, ((BYTES * 8) % BITS) + 7 * BITS, true, BYTES>);
+
+#define CHECK_BITS(KERNEL, BYTES) \
+  CHECK_PADS(KERNEL, 1, BYTES) \
+  CHECK_PADS(KERNEL, 2, BYTES) \
+  CHECK_PADS(KERNEL, 3, BYTES) \
+  CHECK_PADS(KERNEL, 4, BYTES)
+
+TEST(BitReverseDispatch, ssse3)
+{
+  if (!bliss::utils::bit_ops::dispatch::cpu_features::get().ssse3) return;
+  CHECK_BITS(reverse_ssse3, 9)
+  CHECK_BITS(reverse_ssse3, 12)
+  CHECK_BITS(reverse_ssse3, 16)
+}
+
+TEST(BitReverseDispatch, avx2)
+{
+  if (!bliss::utils::bit_ops::dispatch::cpu_features::get().avx2) return;
+  CHECK_BITS(reverse_avx2, 17)
+  CHECK_BITS(reverse_avx2, 24)
+  CHECK_BITS(reverse_avx2, 32)
+}
+
+TEST(BitReverseDispatch, avx512vbmi)
+{
+  if (!bliss::utils::bit_ops::dispatch::cpu_features::get().avx512vbmi) return;
+  CHECK_BITS(reverse_avx512vbmi, 33)
+  CHECK_BITS(reverse_avx512vbmi, 40)
+  CHECK_BITS(reverse_avx512vbmi, 64)
+}
+
+#endif
+
+
+template <unsigned int BITS, uint16_t PAD, bool NEGATE, size_t len>
+void check_dispatch() {
+  constexpr size_t bytes = len * sizeof(uint64_t);
+
+  uint64_t in[len], out[len], gold[len];
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+  for (size_t i = 0; i < len; ++i) in[i] = distribution(generator);
+  if (PAD > 0) in[len - 1] &= (~(0ULL)) >> PAD;
+
+  reference_reverse<BITS, PAD, NEGATE, bytes>(reinterpret_cast<uint8_t *>(gold), reinterpret_cast<uint8_t const *>(in));
+
+  memset(out, 0, sizeof(out));
+  if (bliss::utils::bit_ops::dispatch::reverse<BITS, PAD, NEGATE, uint64_t, len>(out, in)) {
+    for (size_t i = 0; i < len; ++i) {
+      EXPECT_EQ(gold[i], out[i]) << "bits " << BITS << " pad " << PAD << " words " << len << " at word " << i;
+    }
+  } else {
+    // nothing written.
+    for (size_t i = 0; i < len; ++i) EXPECT_EQ(0ULL, out[i]);
+  }
+}
+
+/// the dispatched reverse on k-mer like arrays.
+TEST(BitReverseDispatch, kmer_arrays)
+{
+  // DNA:  31-mer, 33-mer, 63-mer, 96-mer, 255-mer
+  check_dispatch<2, 2, true, 1>();
+  check_dispatch<2, 62, true, 2>();
+  check_dispatch<2, 2, true, 2>();
+  check_dispatch<2, 0, false, 3>();
+  check_dispatch<2, 2, true, 8>();
+  // DNA5: 21-mer, 41-mer, 63-mer.   1 bit reverse.
+  check_dispatch<1, 1, false, 1>();
+  check_dispatch<3, 5, false, 2>();
+  check_dispatch<1, 5, false, 2>();
+  check_dispatch<3, 3, false, 3>();
+  // DNA16:  31-mer, 63-mer
+  check_dispatch<4, 4, false, 2>();
+  check_dispatch<4, 4, false, 4>();
+  check_dispatch<1, 4, false, 4>();
+  // too large, not dispatched.
+  check_dispatch<2, 0, true, 9>();
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_hyperloglog.cpp
+ * @ingroup
+ * @brief   tests the hyperloglog distinct count estimate
+ */
+
+#include "utils/hyperloglog.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cmath>
+
+
+TEST(HyperLogLog, empty)
+{
+  ::bliss::utils::hyperloglog64<> hll;
+  EXPECT_EQ(0.0, hll.estimate());
+}
+
+TEST(HyperLogLog, estimate)
+{
+  // sequential integers are weak hash values; the sketch mixes them.
+  for (size_t n : {100UL, 1000UL, 10000UL, 100000UL, 1000000UL}) {
+    ::bliss::utils::hyperloglog64<> hll;
+    for (uint64_t i = 0; i < n; ++i) {
+      hll.update(i);
+      hll.update(i);   // duplicates do not change the estimate.
+    }
+    EXPECT_NEAR(static_cast<double>(n), hll.estimate(), 0.05 * static_cast<double>(n)) << " n=" << n;
+  }
+}
+
+TEST(HyperLogLog, merge)
+{
+  // 2 overlapping ranges, [0, 60000) and [40000, 100000).
+  ::bliss::utils::hyperloglog64<> a, b;
+  for (uint64_t i = 0; i < 60000; ++i) a.update(i);
+  for (uint64_t i = 40000; i < 100000; ++i) b.update(i);
+
+  a.merge(b);
+  EXPECT_NEAR(100000.0, a.estimate(), 5000.0);
+
+  a.clear();
+  EXPECT_EQ(0.0, a.estimate());
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_latency_histogram.cpp
+ * @ingroup
+ * @brief   tests the latency histogram buckets and percentiles against sorted values.
+ */
+
+#include "utils/latency_histogram.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+
+TEST(LatencyHistogram, buckets)
+{
+  using Hist = ::bliss::utils::latency_histogram<8>;
+  // buckets are contiguous, and each value is in its bucket's range.
+  for (uint64_t v : {0UL, 1UL, 255UL, 256UL, 257UL, 511UL, 512UL, 1000UL, 123456789UL, 0xFFFFFFFFFFFFFFFFUL}) {
+    size_t b = Hist::bucket(v);
+    ASSERT_LT(b, Hist::n_buckets);
+    EXPECT_LE(v, Hist::bucket_upper(b)) << v;
+    if (b > 0) {
+      EXPECT_GT(v, Hist::bucket_upper(b - 1)) << v;
+    }
+  }
+  for (size_t b = 1; b < Hist::n_buckets; ++b) {
+    EXPECT_EQ(b, Hist::bucket(Hist::bucket_upper(b - 1) + 1));
+  }
+  EXPECT_EQ(Hist::n_buckets - 1, Hist::bucket(0xFFFFFFFFFFFFFFFFUL));
+}
+
+TEST(LatencyHistogram, empty)
+{
+  ::bliss::utils::latency_histogram<> hist;
+  EXPECT_EQ(0UL, hist.count());
+  EXPECT_EQ(0UL, hist.percentile(0.99));
+  EXPECT_EQ(0UL, hist.min());
+  EXPECT_EQ(0.0, hist.mean());
+}
+
+TEST(LatencyHistogram, percentiles)
+{
+  // long tailed values, as latencies are.
+  std::default_random_engine generator(11);
+  std::lognormal_distribution<double> distribution(10.0, 1.5);
+  std::vector<uint64_t> values;
+  ::bliss::utils::latency_histogram<> hist;
+  for (size_t i = 0; i < 100000; ++i) {
+    uint64_t v = static_cast<uint64_t>(distribution(generator));
+    values.emplace_back(v);
+    hist.record(v);
+  }
+  std::sort(values.begin(), values.end());
+
+  EXPECT_EQ(values.size(), hist.count());
+  EXPECT_EQ(values.front(), hist.min());
+  EXPECT_EQ(values.back(), hist.max());
+  EXPECT_EQ(values.back(), hist.percentile(1.0));
+  for (double q : {0.0, 0.5, 0.9, 0.99, 0.999}) {
+    size_t rank = std::max(static_cast<size_t>(std::ceil(q * values.size())), static_cast<size_t>(1));
+    double exact = static_cast<double>(values[rank - 1]);
+    EXPECT_GE(static_cast<double>(hist.percentile(q)), exact) << q;
+    EXPECT_LE(static_cast<double>(hist.percentile(q)), exact * (1.0 + 1.0 / 128.0) + 1.0) << q;
+  }
+}
+
+TEST(LatencyHistogram, merge)
+{
+  ::bliss::utils::latency_histogram<> a, b, all;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    a.record(i);
+    all.record(i);
+    b.record(i * 1000);
+    all.record(i * 1000);
+  }
+  a.merge(b);
+  EXPECT_EQ(all.count(), a.count());
+  EXPECT_EQ(all.max(), a.max());
+  EXPECT_EQ(all.get_counts(), a.get_counts());
+  EXPECT_EQ(all.percentile(0.75), a.percentile(0.75));
+  EXPECT_DOUBLE_EQ(all.mean(), a.mean());
+
+  // counters only, e.g. after an allreduce.
+  ::bliss::utils::latency_histogram<> c;
+  c.get_counts() = a.get_counts();
+  c.recount();
+  EXPECT_EQ(a.count(), c.count());
+  EXPECT_EQ(a.percentile(0.5), c.percentile(0.5));
+  EXPECT_EQ(1UL, c.min());
+  EXPECT_NEAR(a.mean(), c.mean(), 0.01 * a.mean());
+
+  a.clear();
+  EXPECT_EQ(0UL, a.count());
+  EXPECT_EQ(0UL, a.percentile(0.5));
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_micro_benchmark.cpp
+ * @ingroup
+ * @brief   tests the statistics and calibration of the micro-benchmark harness
+ */
+
+#include "utils/micro_benchmark.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+
+TEST(MicroBench, median_mad)
+{
+  // odd count, with 1 outlier that should not move either statistic much.
+  auto mm = ::plog::MicroBench::median_mad(std::vector<double>({1.0, 2.0, 3.0, 4.0, 100.0}));
+  EXPECT_DOUBLE_EQ(3.0, mm.first);
+  EXPECT_DOUBLE_EQ(1.0, mm.second);
+
+  // even count
+  mm = ::plog::MicroBench::median_mad(std::vector<double>({4.0, 1.0, 3.0, 2.0}));
+  EXPECT_DOUBLE_EQ(2.5, mm.first);
+  EXPECT_DOUBLE_EQ(1.0, mm.second);
+
+  mm = ::plog::MicroBench::median_mad(std::vector<double>());
+  EXPECT_DOUBLE_EQ(0.0, mm.first);
+  EXPECT_DOUBLE_EQ(0.0, mm.second);
+}
+
+TEST(MicroBench, run)
+{
+  ::plog::MicroBench mb(5, 1.0, 1.0);
+  std::vector<int> v(1024, 1);
+  auto res = mb.run("sum", v.size(), sizeof(int), [&v]() {
+    int s = 0;
+    for (auto x : v) s += x;
+    ::plog::do_not_optimize(s);
+  });
+
+  EXPECT_EQ("sum", res.name);
+  EXPECT_EQ(5UL, res.samples);
+  EXPECT_GE(res.calls_per_sample, 1UL);
+  EXPECT_GT(res.ns_median, 0.0);
+  EXPECT_LE(res.ns_min, res.ns_median);
+  EXPECT_GT(res.gbps(), 0.0);
+  ASSERT_EQ(1UL, mb.get_results().size());
+
+  mb.reset();
+  EXPECT_EQ(0UL, mb.get_results().size());
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_phase_trace.cpp
+ * @ingroup
+ * @brief   tests the phase trace ring buffer and its chrome trace output, and the BL_TRACE macros.
+ */
+
+// logging.h first:  its BL_TRACE(msg) should not affect the phase trace macros.
+#include "utils/logging.h"
+#include "utils/phase_trace.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <chrono>
+#include <iostream>
+
+
+TEST(PhaseTrace, record)
+{
+  ::plog::PhaseTrace & trace = ::plog::PhaseTrace::instance();
+  trace.clear();
+
+  ::plog::trace_span span;
+  span.start();
+  span.end("find", "local_find");
+  span.start();
+  span.end("find", std::string("a_long_phase_name_that_is_truncated"));
+
+  ASSERT_EQ(2UL, trace.size());
+  auto events = trace.get_events();
+  EXPECT_STREQ("find", events[0].title);
+  EXPECT_STREQ("local_find", events[0].name);
+  EXPECT_LE(events[0].begin, events[0].end);
+  EXPECT_LE(events[0].end, events[1].begin);
+  EXPECT_EQ(sizeof(events[1].name) - 1, strlen(events[1].name));
+
+  std::string json = trace.to_json();
+  EXPECT_EQ(0UL, json.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"local_find\",\"cat\":\"find\",\"ph\":\"X\",\"pid\":0"));
+}
+
+TEST(PhaseTrace, wrap)
+{
+  ::plog::PhaseTrace & trace = ::plog::PhaseTrace::instance();
+  trace.clear();
+
+  size_t cap = trace.capacity();
+  for (size_t i = 0; i < cap + 10; ++i) {
+    trace.record("loop", (i < 10) ? "old" : "new", i, i + 1);
+  }
+  EXPECT_EQ(cap, trace.size());
+  EXPECT_EQ(10UL, trace.dropped());
+
+  // oldest surviving event first.
+  auto events = trace.get_events();
+  EXPECT_EQ(10, events.front().begin);
+  EXPECT_STREQ("new", events.front().name);
+  EXPECT_EQ(static_cast<int64_t>(cap + 9), events.back().begin);
+
+  trace.clear();
+}
+
+TEST(PhaseTrace, macros)
+{
+  ::plog::PhaseTrace & trace = ::plog::PhaseTrace::instance();
+  trace.clear();
+
+  BL_TRACE_INIT(macro)
+  BL_TRACE_START(macro);
+  BL_TRACE_END(macro, "phase");
+
+#if BL_PHASE_TRACE == 1
+  ASSERT_EQ(1UL, trace.size());
+  EXPECT_STREQ("macro", trace.get_events()[0].title);
+  EXPECT_STREQ("phase", trace.get_events()[0].name);
+#else
+  EXPECT_EQ(0UL, trace.size());
+#endif
+  trace.clear();
+}
+
+// the cost of 1 traced phase, which is paid by every BL_BENCH phase when ENABLE_PHASE_TRACE is on.
+TEST(PhaseTrace, overhead)
+{
+  ::plog::PhaseTrace & trace = ::plog::PhaseTrace::instance();
+  trace.clear();
+
+  size_t const n = 1000000;
+  ::plog::trace_span span;
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    span.start();
+    span.end("overhead", "phase");
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / n;
+  std::cout << "phase trace:  " << ns << " ns per phase" << std::endl;
+
+  // well under a microsecond.  the bound is loose so that loaded test machines pass.
+  EXPECT_LT(ns, 1000.0);
+  trace.clear();
+}
@@ -40,6 +40,8 @@
 
 #include <mxx/reduction.hpp>
 
+#include "utils/benchmark_report.hpp"
+
 
 namespace plog {
 
@@ -129,7 +131,11 @@ class Timer {
 
 		end(name, n_elem);
     }
-    void report(::std::string const & title) {
+    void report(::std::string const & title, ::std::string const & site = ::std::string()) {
+        if (BenchReport::instance().enabled()) {
+          BenchReport::instance().add_time(title, site, 1, names, durations, durations, durations, counts, counts, counts);
+        }
+
         std::stringstream output;
 
         std::ostream_iterator<std::string> nit(output, ",");
@@ -262,7 +268,7 @@ class Timer {
     }
 #endif
 
-    void report(::std::string const & title, ::mxx::comm const & comm) {
+    void report(::std::string const & title, ::mxx::comm const & comm, ::std::string const & site = ::std::string()) {
       std::vector<double> dur_mins, dur_maxs, dur_means, dur_stdevs;
       std::vector<double> cum_mins, cum_maxs, cum_means, cum_stdevs;
       std::vector<double> cnt_mins, cnt_maxs, cnt_means, cnt_stdevs;
@@ -300,6 +306,10 @@ class Timer {
         if (rank == 0) {
 
           ::std::for_each(dur_means.begin(), dur_means.end(), [&p](double & x) { x /= p; });
+          ::std::for_each(cnt_means.begin(), cnt_means.end(), [&p](double & x) { x /= p; });
+          if (BenchReport::instance().enabled()) {
+            BenchReport::instance().add_time(title, site, p, names, dur_mins, dur_maxs, dur_means, cnt_mins, cnt_maxs, cnt_means);
+          }
           ::std::transform(dur_stdevs.begin(), dur_stdevs.end(), dur_means.begin(), dur_stdevs.begin(),
                            [&p](double const & x, double const & y) { return ::std::sqrt(x / p - y * y); });
 
@@ -307,7 +317,6 @@ class Timer {
           ::std::transform(cum_stdevs.begin(), cum_stdevs.end(), cum_means.begin(), cum_stdevs.begin(),
                            [&p](double const & x, double const & y) { return ::std::sqrt(x / p - y * y); });
 
-          ::std::for_each(cnt_means.begin(), cnt_means.end(), [&p](double & x) { x /= p; });
           ::std::transform(cnt_stdevs.begin(), cnt_stdevs.end(), cnt_means.begin(), cnt_stdevs.begin(),
                            [&p](double const & x, double const & y) { return ::std::sqrt(x / p - y * y); });
         }
@@ -407,16 +416,16 @@ class Timer {
 #define BL_TIMER_END(title, name, n_elem) do { title##_timer.end(name, n_elem); } while (0)
 #define BL_TIMER_COLLECTIVE_START(title, name, comm) do { title##_timer.collective_start(name, comm); } while (0)
 #define BL_TIMER_COLLECTIVE_END(title, name, n_elem, comm) do { title##_timer.collective_end(name, n_elem, comm); } while (0)
-#define BL_TIMER_REPORT(title) do { title##_timer.report(#title); } while (0)
-#define BL_TIMER_REPORT_NAMED(title, name) do { title##_timer.report(name); } while (0)
+#define BL_TIMER_REPORT(title) do { title##_timer.report(#title, BL_BENCH_SITE); } while (0)
+#define BL_TIMER_REPORT_NAMED(title, name) do { title##_timer.report(name, BL_BENCH_SITE); } while (0)
 
 #if 0
 // do not use this function for now.  mxx::min_element and max_element has invalid read problem, reported by valgrind.
 #define BL_TIMER_REPORT_MPI_LOC(title, comm) do { title##_timer.report_loc(#title, comm); } while (0)
 #endif
 
-#define BL_TIMER_REPORT_MPI(title, comm) do { title##_timer.report(#title, comm); } while (0)
-#define BL_TIMER_REPORT_MPI_NAMED(title, name, comm) do { title##_timer.report(name, comm); } while (0)
+#define BL_TIMER_REPORT_MPI(title, comm) do { title##_timer.report(#title, comm, BL_BENCH_SITE); } while (0)
+#define BL_TIMER_REPORT_MPI_NAMED(title, name, comm) do { title##_timer.report(name, comm, BL_BENCH_SITE); } while (0)
 
 
 #else
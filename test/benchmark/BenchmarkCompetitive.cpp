@@ -0,0 +1,241 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkCompetitive.cpp
+ * @ingroup
+ * @brief   kmerind side of the comparison with Jellyfish, KMC and BFCounter:  canonical kmer counting and count queries on a real FASTQ or FASTA file.
+ * @details k is compile time (pK).  the map is the canonical counting densehash map with farm hash, the default kmerind count index.
+ *          the file is FASTA if its extension is .fa, .fasta, .fna or .ffn, and FASTQ otherwise.
+ *
+ *          phases:  "read" parses the kmers of the file, "count" builds the count index from them, and "query" counts
+ *          1 in S of the kmers of the file.  with -Q the query kmers are also written as a FASTA file, 1 kmer per record,
+ *          so that "jellyfish query -s" and "kmc_tools filter" query the same kmers.
+ *
+ *          the phases are reported under the title "compare:kmerind:k<k>:<dataset>:c<P>", where dataset is the file
+ *          name without directory and extension, so setting BL_BENCH_OUTPUT gives 1 structured record per phase.
+ *          compare_suite.sh runs this and the other tools and writes their records in the same format.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#include "utils/logging.h"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+
+#include "io/mxx_support.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+
+#include "index/kmer_index.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+//================= define types
+
+using Alphabet = bliss::common::DNA;
+
+#if defined(pK)
+using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+#else
+using KmerType = bliss::common::Kmer<31, Alphabet, WordType>;
+#endif
+
+using CountType = uint32_t;
+
+template <typename KM>
+using DistHash = bliss::kmer::hash::farm<KM, true>;
+template <typename KM>
+using StoreHash = bliss::kmer::hash::farm<KM, false>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, DistHash, StoreHash>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+
+using MapType = ::dsc::counting_densehash_map<KmerType, CountType, MapParams, SpecialKeys>;
+
+using IndexType = bliss::index::kmer::CountIndex<MapType>;
+
+
+/// true if the file extension is a FASTA one.
+bool is_fasta(std::string const & filename) {
+  size_t dot = filename.find_last_of('.');
+  if (dot == std::string::npos) return false;
+  std::string ext = filename.substr(dot + 1);
+  return (ext == "fa") || (ext == "fasta") || (ext == "fna") || (ext == "ffn");
+}
+
+/// file name without directory and extension.
+std::string dataset_name(std::string const & filename) {
+  size_t slash = filename.find_last_of('/');
+  std::string base = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+  size_t dot = base.find('.');
+  return (dot == std::string::npos || dot == 0) ? base : base.substr(0, dot);
+}
+
+template <typename KmerParser>
+void read_kmers(std::string const & filename, bool const & fasta, int const & reader_algo,
+                std::vector<typename KmerParser::value_type> & out, mxx::comm const & comm) {
+  if (fasta) {
+    if (reader_algo == 5) {
+      ::bliss::io::KmerFileHelper::read_file_mmap<KmerParser, ::bliss::io::FASTAParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else if (reader_algo == 7) {
+      ::bliss::io::KmerFileHelper::read_file_posix<KmerParser, ::bliss::io::FASTAParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else if (reader_algo == 10) {
+      ::bliss::io::KmerFileHelper::read_file_mpiio<KmerParser, ::bliss::io::FASTAParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else {
+      throw std::invalid_argument("missing file reader type");
+    }
+  } else {
+    if (reader_algo == 5) {
+      ::bliss::io::KmerFileHelper::read_file_mmap<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else if (reader_algo == 7) {
+      ::bliss::io::KmerFileHelper::read_file_posix<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else if (reader_algo == 10) {
+      ::bliss::io::KmerFileHelper::read_file_mpiio<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+    } else {
+      throw std::invalid_argument("missing file reader type");
+    }
+  }
+}
+
+/// gather the query kmers on rank 0 and write them as FASTA, 1 kmer per record.
+void write_queries(std::string const & filename, std::vector<KmerType> const & query, mxx::comm const & comm) {
+  std::vector<KmerType> all = ::mxx::gatherv(query, 0, comm);
+  if (comm.rank() == 0) {
+    std::ofstream ofs(filename);
+    if (!ofs.good()) throw std::invalid_argument("cannot open query output file " + filename);
+    for (size_t i = 0; i < all.size(); ++i) {
+      ofs << ">" << i << "\n" << bliss::utils::KmerUtils::toASCIIString(all[i]) << "\n";
+    }
+  }
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  // node memory bandwidth, before any phase.  see memory_bandwidth.hpp
+  BL_BENCH_PEAK_BANDWIDTH(comm);
+
+  //////////////// parse parameters
+
+  std::string filename;
+  std::string queryname;
+  int reader_algo = 7;
+  int sample_ratio = 10;
+  int iterations = 1;
+
+  try {
+    TCLAP::CmdLine cmd("Kmer counting and count query benchmark on a FASTQ/FASTA file, for comparison with other kmer counters", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("F", "file", "FASTQ or FASTA file path", true, "", "string", cmd);
+    TCLAP::ValueArg<std::string> queryArg("Q", "query-output", "write the query kmers to this FASTA file. default none",
+                                          false, "", "string", cmd);
+    TCLAP::ValueArg<int> algoArg("A", "algo", "Reader Algorithm id. mmap = 5, posix=7, mpiio = 10. default is 7.",
+                                 false, reader_algo, "int", cmd);
+    TCLAP::ValueArg<int> sampleArg("S", "query-sample", "1 in S kmers are queried. default=10", false, sample_ratio, "int", cmd);
+    TCLAP::ValueArg<int> iterArg("i", "iterations", "repetitions of the benchmark. default=1", false, iterations, "int", cmd);
+
+    cmd.parse( argc, argv );
+
+    filename = fileArg.getValue();
+    queryname = queryArg.getValue();
+    reader_algo = algoArg.getValue();
+    sample_ratio = std::max(1, sampleArg.getValue());
+    iterations = std::max(1, iterArg.getValue());
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  bool fasta = is_fasta(filename);
+
+  std::stringstream ts;
+  ts << "compare:kmerind:k" << KmerType::size << ":" << dataset_name(filename) << ":c" << comm.size();
+  std::string title = ts.str();
+
+  if (comm.rank() == 0) printf("%s: %s file %s\n", title.c_str(), (fasta ? "FASTA" : "FASTQ"), filename.c_str());
+
+  BL_BENCH_INIT(test);
+
+  for (int it = 0; it < iterations; ++it) {
+    IndexType idx(comm);
+
+    {
+      ::std::vector<typename IndexType::KmerParserType::value_type> temp;
+
+      BL_BENCH_START(test);
+      read_kmers<typename IndexType::KmerParserType>(filename, fasta, reader_algo, temp, comm);
+      BL_BENCH_COLLECTIVE_END(test, "read", temp.size(), comm);
+
+      BL_BENCH_START(test);
+      idx.insert(temp);
+      BL_BENCH_COLLECTIVE_END(test, "count", temp.size(), comm);
+    }
+
+    ::std::vector<KmerType> query;
+    {
+      ::std::vector<KmerType> all;
+      read_kmers<::bliss::index::kmer::KmerParser<KmerType> >(filename, fasta, reader_algo, all, comm);
+      query.reserve(all.size() / sample_ratio + 1);
+      for (size_t i = 0; i < all.size(); i += sample_ratio) query.emplace_back(all[i]);
+    }
+    if ((it == 0) && !queryname.empty()) write_queries(queryname, query, comm);
+
+    {
+      BL_BENCH_START(test);
+      auto counts = idx.count(query);
+      BL_BENCH_COLLECTIVE_END(test, "query", counts.size(), comm);
+    }
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(test, title, comm);
+
+  // mpi cleanup is automatic
+  comm.barrier();
+
+  return 0;
+}
@@ -17,6 +17,7 @@
 #include "containers/unordered_vecmap.hpp"
 //#include "containers/hashed_vecmap.hpp"
 #include "containers/densehash_map.hpp"
+#include "containers/fsc_container_utils.hpp"
 
 #include "common/kmer.hpp"
 #include "common/kmer_transform.hpp"
@@ -113,6 +114,36 @@ void generate_input(std::vector<::std::pair<Kmer, Value> > & output, size_t cons
   }
 }
 
+/// cost of the kmer hash functions alone, one at a time and batched.
+template <typename Kmer, template <typename, bool> class Hash>
+void benchmark_hash(size_t const count, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(hash);
+
+  std::vector<::std::pair<Kmer, size_t> > input;
+  generate_input(input, count);
+  std::vector<Kmer> kmers(count);
+  std::transform(input.begin(), input.end(), kmers.begin(),
+                 [](::std::pair<Kmer, size_t> const & x){
+    return x.first;
+  });
+  std::vector<::std::pair<Kmer, size_t> >().swap(input);
+
+  Hash<Kmer, false> hasher;
+  std::vector<uint64_t> hashes(count);
+
+  BL_BENCH_START(hash);
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = hasher(kmers[i]);
+  }
+  BL_BENCH_END(hash, "hash", hashes[count / 2]);
+
+  BL_BENCH_START(hash);
+  ::fsc::batch_hash(hasher, kmers.data(), count, hashes.data());
+  BL_BENCH_END(hash, "batch_hash", hashes[count / 2]);
+
+  BL_BENCH_REPORT_MPI_NAMED(hash, "kmer_hash", comm);
+}
+
 template <typename Kmer, typename Value>
 void benchmark_unordered_map(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
   BL_BENCH_INIT(map);
@@ -293,6 +324,67 @@ void benchmark_unordered_vecmap(size_t const count, size_t const query_frac, ::m
   BL_BENCH_REPORT_MPI_NAMED(map, "unordered_vecmap", comm);
 }
 
+template <typename Kmer, typename Value>
+void benchmark_unordered_pooled_vecmap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(map);
+
+  std::vector<Kmer > query;
+  BL_BENCH_START(map);
+  // no transform involved.
+  ::fsc::unordered_pooled_vecmap<Kmer, Value, ::bliss::kmer::hash::farm<Kmer, false> > map(1, count);
+  BL_BENCH_END(map, "reserve", count);
+
+
+  {
+
+//    BL_BENCH_START(map);
+    std::vector<::std::pair<Kmer, Value> > input(count);
+//    BL_BENCH_END(map, "reserve input", count);
+
+//    BL_BENCH_START(map);
+    generate_input(input, count);
+    query.resize(count / query_frac);
+    std::transform(input.begin(), input.begin() + input.size() / query_frac, query.begin(),
+                   [](::std::pair<Kmer, Value> const & x){
+      return x.first;
+    });
+//    BL_BENCH_END(map, "generate input", input.size());
+
+    BL_BENCH_START(map);
+    map.insert_sorted(input.begin(), input.end());
+    BL_BENCH_END(map, "insert", map.size());
+  }
+
+  BL_BENCH_START(map);
+  map.compact();
+  BL_BENCH_END(map, "compact", map.unique_size());
+
+  BL_BENCH_START(map);
+  size_t result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    auto iters = map.equal_range(query[i]);
+    for (auto it = iters.first; it != iters.second; ++it)
+      result ^= (*it).second;
+  }
+  BL_BENCH_END(map, "find", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.count(query[i]);
+  }
+  BL_BENCH_END(map, "count", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.erase(query[i]);
+  }
+  BL_BENCH_END(map, "erase", result);
+
+  BL_BENCH_REPORT_MPI_NAMED(map, "unordered_pooled_vecmap", comm);
+}
+
 //template <typename Kmer, typename Value>
 //void benchmark_hashed_vecmap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
 //  BL_BENCH_INIT(map);
@@ -350,7 +442,7 @@ void benchmark_unordered_vecmap(size_t const count, size_t const query_frac, ::m
 //  BL_BENCH_REPORT_MPI_NAMED(map, "hashed_vecmap", comm);
 //}
 
-template <typename Kmer, typename Value>
+template <typename Kmer, typename Value, template <typename, bool> class Hash = ::bliss::kmer::hash::farm>
 void benchmark_densehash_map(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
   BL_BENCH_INIT(map);
 
@@ -361,7 +453,7 @@ void benchmark_densehash_map(size_t const count, size_t const query_frac, ::mxx:
   ::fsc::densehash_map<Kmer, Value, 
 	::bliss::kmer::hash::sparsehash::special_keys<Kmer, false>,
 	::bliss::transform::identity,
-	::bliss::kmer::hash::farm<Kmer, false> > map(count);
+	Hash<Kmer, false> > map(count);
   BL_BENCH_END(map, "reserve", count);
 
 
@@ -1187,6 +1279,22 @@ int main(int argc, char** argv) {
 
   comm.barrier();
 
+  BL_BENCH_START(test);
+  benchmark_hash<Kmer, ::bliss::kmer::hash::murmur>(count, comm);
+  BL_BENCH_COLLECTIVE_END(test, "hash_murmur", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_hash<Kmer, ::bliss::kmer::hash::farm>(count, comm);
+  BL_BENCH_COLLECTIVE_END(test, "hash_farm", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_hash<Kmer, ::bliss::kmer::hash::crc32c>(count, comm);
+  BL_BENCH_COLLECTIVE_END(test, "hash_crc32c", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_hash<Kmer, ::bliss::kmer::hash::clhash>(count, comm);
+  BL_BENCH_COLLECTIVE_END(test, "hash_clhash", count, comm);
+
   BL_BENCH_START(test);
   benchmark_unordered_map<Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "unordered_map", count, comm);
@@ -1199,6 +1307,18 @@ int main(int argc, char** argv) {
   benchmark_densehash_map<Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "densehash_map", count, comm);
 
+  BL_BENCH_START(test);
+  benchmark_densehash_map<Kmer, size_t, ::bliss::kmer::hash::murmur>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "densehash_map_murmur", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_densehash_map<Kmer, size_t, ::bliss::kmer::hash::crc32c>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "densehash_map_crc32c", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_densehash_map<Kmer, size_t, ::bliss::kmer::hash::clhash>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "densehash_map_clhash", count, comm);
+
   BL_BENCH_START(test);
   benchmark_densehash_map<DNA5Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "densehash_map_DNA5", count, comm);
@@ -1258,6 +1378,10 @@ int main(int argc, char** argv) {
   benchmark_unordered_vecmap<Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "unordered_vecmap", count, comm);
 
+  BL_BENCH_START(test);
+  benchmark_unordered_pooled_vecmap<Kmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "unordered_pooled_vecmap", count, comm);
+
 //  BL_BENCH_START(test);
 //  benchmark_hashed_vecmap<Kmer, size_t>(count, query_frac, comm);
 //  BL_BENCH_COLLECTIVE_END(test, "hashed_vecmap", count, comm);
@@ -93,11 +93,17 @@
 #define HASHEDVEC 45
 #define UNORDERED 46
 #define DENSEHASH 47
+#define SWISS 48
+#define COMPACT 49
 
 #define SINGLE 51
 #define CANONICAL 52
 #define BIMOLECULE 53
 
+#define STDALLOC 61
+#define HUGEPAGE 62
+#define HUGEPAGE_INTERLEAVE 63
+
 #define MAXLINE 1024
 
 void get_file_list(const char* filepath, int recurse,
@@ -179,7 +185,12 @@ using KmerType = bliss::common::Kmer<22, Alphabet, WordType>;
 
 
 // ============  index value type
+#if defined(pQualFixed)
+// 2 byte fixed point -log2 probabilities, see QualityScoreCodec<uint16_t, ...>
+using QualType = uint16_t;
+#else
 using QualType = float;
+#endif
 using KmerInfoType = std::pair<IdType, QualType>;
 using CountType = uint32_t;
 
@@ -244,6 +255,18 @@ using CountType = uint32_t;
 
 
 
+// ==== allocator for the local containers
+#if (pALLOC == HUGEPAGE)
+  template <typename T>
+  using LocalAlloc = ::bliss::index::kmer::HugePageAlloc<T>;
+#elif (pALLOC == HUGEPAGE_INTERLEAVE)
+  template <typename T>
+  using LocalAlloc = ::bliss::index::kmer::InterleavedHugePageAlloc<T>;
+#else
+  template <typename T>
+  using LocalAlloc = ::std::allocator<T>;
+#endif
+
 // ==== define Map parameter
 #if (pMAP == SORTED)
 	// choose a MapParam based on type of map and kmer model (canonical, original, bimolecule)
@@ -261,10 +284,10 @@ using CountType = uint32_t;
 	// DEFINE THE MAP TYPE base on the type of data to be stored.
 	#if (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
 		using MapType = ::dsc::sorted_multimap<
-				KmerType, ValType, MapParams>;
+				KmerType, ValType, MapParams, LocalAlloc< ::std::pair<KmerType, ValType> > >;
 	#elif (pINDEX == COUNT)  // map
 		using MapType = ::dsc::counting_sorted_map<
-				KmerType, ValType, MapParams>;
+				KmerType, ValType, MapParams, LocalAlloc< ::std::pair<KmerType, ValType> > >;
 	#endif
 
 
@@ -318,7 +341,7 @@ using CountType = uint32_t;
 //   #elif (pMAP == UNORDERED)
     #if (pMAP == UNORDERED)
       using MapType = ::dsc::unordered_multimap<
-          KmerType, ValType, MapParams>;
+          KmerType, ValType, MapParams, LocalAlloc< ::std::pair<const KmerType, ValType> > >;
 //    #elif (pMAP == COMPACTVEC)
 //      using MapType = ::dsc::unordered_multimap_compact_vec<
 //          KmerType, ValType, MapParams>;
@@ -327,15 +350,23 @@ using CountType = uint32_t;
 //          KmerType, ValType, MapParams>;
     #elif (pMAP == DENSEHASH)
       using MapType = ::dsc::densehash_multimap<
-          KmerType, ValType, MapParams, SpecialKeys>;
+          KmerType, ValType, MapParams, SpecialKeys, LocalAlloc< ::std::pair<const KmerType, ValType> > >;
     #endif
   #elif (pINDEX == COUNT)  // map
     #if (pMAP == DENSEHASH)
       using MapType = ::dsc::counting_densehash_map<
-        KmerType, ValType, MapParams, SpecialKeys>;
+        KmerType, ValType, MapParams, SpecialKeys, LocalAlloc< ::std::pair<const KmerType, ValType> > >;
+    #elif (pMAP == SWISS)
+      using MapType = ::dsc::counting_densehash_map<
+        KmerType, ValType, MapParams, SpecialKeys,
+        LocalAlloc< ::std::pair<const KmerType, ValType> >, ::fsc::swiss_map>;
+    #elif (pMAP == COMPACT)
+      using MapType = ::dsc::counting_densehash_map<
+        KmerType, ValType, MapParams, SpecialKeys,
+        LocalAlloc< ::std::pair<const KmerType, ValType> >, ::fsc::compact_counting_map8>;
     #else
       using MapType = ::dsc::counting_unordered_map<
-        KmerType, ValType, MapParams>;
+        KmerType, ValType, MapParams, LocalAlloc< ::std::pair<const KmerType, ValType> > >;
     #endif
   #endif
 
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkQueryLatency.cpp
+ * @ingroup
+ * @brief   open loop load test of the query_server path:  request latency percentiles at target request rates.
+ * @details the count index is built from a FASTQ file, and the query keys are drawn from the file's kmers, so hot
+ *          kmers are queried as often as they occur.  for each target rate, every rank runs a query_server and -c
+ *          client threads.  each client sends requests of -b keys at exponentially distributed intervals, i.e. a
+ *          Poisson stream, for -d seconds.  the send times do not depend on the responses (open loop), and the latency
+ *          of a request is measured from its scheduled send time to the completion of its future, so a slow server
+ *          is not hidden by clients that wait for it.  a separate thread per client collects the responses in order.
+ *
+ *          latencies go into latency_histograms, merged over all clients and ranks.  rank 0 prints 1 line per rate:
+ *          offered and achieved request rates, and p50, p90, p99, p999 and max latency in microseconds, also to a CSV
+ *          file with -o.  with -P, the run fails (exit code 1) if the p99 latency at any rate exceeds the limit.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include "utils/logging.h"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+
+#include "io/mxx_support.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+
+#include "index/kmer_index.hpp"
+#include "index/query_server.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+#include "utils/latency_histogram.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+//================= define types
+
+using Alphabet = bliss::common::DNA;
+
+#if defined(pK)
+using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+#else
+using KmerType = bliss::common::Kmer<31, Alphabet, WordType>;
+#endif
+
+using CountType = uint32_t;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+using MapType = ::dsc::counting_densehash_map<KmerType, CountType, MapParams, SpecialKeys>;
+
+using IndexType = bliss::index::kmer::CountIndex2<MapType>;
+using ServerType = bliss::index::kmer::query_server<IndexType>;
+using HistType = bliss::utils::latency_histogram<>;
+
+using clock_type = std::chrono::steady_clock;
+
+
+/// pending requests of 1 client, in send order.
+struct pending_requests {
+    struct entry {
+        clock_type::time_point scheduled;
+        bool is_find;
+        std::future<ServerType::find_result_type> found;
+        std::future<ServerType::count_result_type> counted;
+    };
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<entry> queue;
+    bool done = false;
+};
+
+/**
+ * @brief 1 open loop client:  send requests at the scheduled times until end, and record their latencies in ns.
+ * @return  number of requests sent.
+ */
+size_t run_client(ServerType & server, std::vector<KmerType> const & pool, double const & rate, size_t const & batch,
+                  double const & find_fraction, clock_type::time_point const & end, unsigned int const & seed,
+                  HistType & hist) {
+  pending_requests pending;
+
+  // collector:  wait for the responses in send order.
+  std::thread collector([&pending, &hist]() {
+    while (true) {
+      pending_requests::entry e;
+      {
+        std::unique_lock<std::mutex> lock(pending.mtx);
+        pending.cv.wait(lock, [&pending]{ return pending.done || !pending.queue.empty(); });
+        if (pending.queue.empty()) return;
+        e = std::move(pending.queue.front());
+        pending.queue.pop_front();
+      }
+      if (e.is_find) e.found.wait();
+      else e.counted.wait();
+      hist.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - e.scheduled).count());
+    }
+  });
+
+  std::default_random_engine generator(seed);
+  std::exponential_distribution<double> interval(rate);
+  std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+  std::uniform_real_distribution<double> op(0.0, 1.0);
+
+  size_t sent = 0;
+  clock_type::time_point next = clock_type::now();
+  while (true) {
+    next += std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(interval(generator)));
+    if (next >= end) break;
+    std::this_thread::sleep_until(next);
+
+    std::vector<KmerType> keys(batch);
+    for (auto & k : keys) k = pool[pick(generator)];
+
+    pending_requests::entry e;
+    e.scheduled = next;
+    e.is_find = (op(generator) < find_fraction);
+    if (e.is_find) e.found = server.find(std::move(keys));
+    else e.counted = server.count(std::move(keys));
+    {
+      std::lock_guard<std::mutex> lock(pending.mtx);
+      pending.queue.emplace_back(std::move(e));
+    }
+    pending.cv.notify_one();
+    ++sent;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pending.mtx);
+    pending.done = true;
+  }
+  pending.cv.notify_one();
+  collector.join();
+  return sent;
+}
+
+/// parse a comma separated list of rates.
+std::vector<double> parse_rates(std::string const & s) {
+  std::vector<double> rates;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty() && (std::stod(item) > 0.0)) rates.emplace_back(std::stod(item));
+  }
+  return rates;
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::string filename;
+  std::vector<double> rates;
+  double duration = 10.0;
+  int clients = 2;
+  size_t batch = 100;
+  double find_fraction = 0.0;
+  size_t max_batch = (1UL << 16);
+  int max_delay = 1000;
+  double slo_p99 = 0.0;
+  std::string csv;
+
+  try {
+    TCLAP::CmdLine cmd("Open loop latency load test of the kmer query server", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("f", "file", "FASTQ file to build the index and draw the queries from", true, "", "string", cmd);
+    TCLAP::ValueArg<std::string> rateArg("r", "rates", "comma separated total request rates, per second over all ranks. default 1000,10000,100000",
+                                         false, "1000,10000,100000", "string", cmd);
+    TCLAP::ValueArg<double> durArg("d", "duration", "seconds per rate. default 10", false, duration, "double", cmd);
+    TCLAP::ValueArg<int> clientArg("c", "clients", "client threads per rank. default 2", false, clients, "int", cmd);
+    TCLAP::ValueArg<size_t> batchArg("b", "batch", "keys per request. default 100", false, batch, "size_t", cmd);
+    TCLAP::ValueArg<double> findArg("F", "find-fraction", "fraction of find requests, the rest are count. default 0",
+                                    false, find_fraction, "double", cmd);
+    TCLAP::ValueArg<size_t> maxBatchArg("B", "max-batch", "query_server keys per round. default 65536", false, max_batch, "size_t", cmd);
+    TCLAP::ValueArg<int> delayArg("D", "max-delay", "query_server round wait in microseconds. default 1000", false, max_delay, "int", cmd);
+    TCLAP::ValueArg<double> sloArg("P", "p99", "p99 latency limit in microseconds.  0 for no limit. default 0", false, slo_p99, "double", cmd);
+    TCLAP::ValueArg<std::string> csvArg("o", "output", "CSV file of the latency curve, written by rank 0", false, "", "string", cmd);
+
+    cmd.parse( argc, argv );
+
+    filename = fileArg.getValue();
+    rates = parse_rates(rateArg.getValue());
+    duration = durArg.getValue();
+    clients = std::max(1, clientArg.getValue());
+    batch = std::max(static_cast<size_t>(1), batchArg.getValue());
+    find_fraction = findArg.getValue();
+    max_batch = maxBatchArg.getValue();
+    max_delay = delayArg.getValue();
+    slo_p99 = sloArg.getValue();
+    csv = csvArg.getValue();
+
+    if (rates.empty()) throw TCLAP::ArgException("no rates", "rates");
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  BL_BENCH_INIT(test);
+
+  IndexType idx(comm);
+  BL_BENCH_START(test);
+  idx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  BL_BENCH_COLLECTIVE_END(test, "build", idx.local_size(), comm);
+
+  std::vector<KmerType> pool;
+  BL_BENCH_START(test);
+  ::bliss::io::KmerFileHelper::read_file_posix<::bliss::index::kmer::KmerParser<KmerType>,
+    ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, pool, comm);
+  BL_BENCH_COLLECTIVE_END(test, "read_query", pool.size(), comm);
+  if (::mxx::any_of(pool.empty(), comm)) {
+    if (comm.rank() == 0) std::cerr << "error: every rank needs query kmers from the file." << std::endl;
+    exit(-1);
+  }
+
+  std::ofstream out;
+  if ((comm.rank() == 0) && !csv.empty()) {
+    out.open(csv);
+    out << "procs,clients,batch,find_fraction,offered_rps,achieved_rps,p50_us,p90_us,p99_us,p999_us,max_us" << std::endl;
+  }
+  if (comm.rank() == 0) printf("%10s %12s %12s %10s %10s %10s %10s %10s\n",
+      "procs", "offered/s", "achieved/s", "p50 us", "p90 us", "p99 us", "p999 us", "max us");
+
+  bool slo_met = true;
+  for (size_t ri = 0; ri < rates.size(); ++ri) {
+    double client_rate = rates[ri] / static_cast<double>(comm.size() * clients);
+
+    ServerType server(idx, comm, max_batch, std::chrono::microseconds(max_delay));
+    std::vector<HistType> hists(clients);
+    std::vector<size_t> sent(clients, 0);
+
+    comm.barrier();
+    clock_type::time_point start = clock_type::now();
+    clock_type::time_point end = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(duration));
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+      threads.emplace_back([&, c]() {
+        sent[c] = run_client(server, pool, client_rate, batch, find_fraction, end,
+                             (ri * comm.size() + comm.rank()) * clients + c + 1, hists[c]);
+      });
+    }
+    std::thread stopper([&threads, &server]() {
+      for (auto & t : threads) t.join();
+      server.stop();
+    });
+    server.run();
+    stopper.join();
+    double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    // merge over clients, then ranks.
+    HistType hist;
+    size_t requests = 0;
+    for (int c = 0; c < clients; ++c) {
+      hist.merge(hists[c]);
+      requests += sent[c];
+    }
+    uint64_t max_latency = ::mxx::allreduce(hist.max(), ::mxx::max<uint64_t>(), comm);
+    hist.get_counts() = ::mxx::allreduce(hist.get_counts(), ::std::plus<uint64_t>(), comm);
+    hist.recount();
+    requests = ::mxx::allreduce(requests, comm);
+    elapsed = ::mxx::allreduce(elapsed, ::mxx::max<double>(), comm);
+
+    if (comm.rank() == 0) {
+      double achieved = static_cast<double>(requests) / elapsed;
+      double p[4] = { hist.percentile(0.5) * 1e-3, hist.percentile(0.9) * 1e-3,
+                      hist.percentile(0.99) * 1e-3, hist.percentile(0.999) * 1e-3 };
+      printf("%10d %12.1f %12.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+             comm.size(), rates[ri], achieved, p[0], p[1], p[2], p[3], max_latency * 1e-3);
+      if (out.is_open()) {
+        out << comm.size() << "," << clients << "," << batch << "," << find_fraction << "," << rates[ri] << ","
+            << achieved << "," << p[0] << "," << p[1] << "," << p[2] << "," << p[3] << "," << (max_latency * 1e-3) << std::endl;
+      }
+      if ((slo_p99 > 0.0) && (p[2] > slo_p99)) {
+        printf("p99 latency %f us at %f requests/s exceeds the limit of %f us\n", p[2], rates[ri], slo_p99);
+        slo_met = false;
+      }
+    }
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(test, "query_latency", comm);
+
+  int failed = ::mxx::bcast(slo_met ? 0 : 1, 0, comm);
+
+  // mpi cleanup is automatic
+  comm.barrier();
+
+  return failed;
+}
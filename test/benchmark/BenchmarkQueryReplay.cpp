@@ -0,0 +1,279 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkQueryReplay.cpp
+ * @ingroup
+ * @brief   replays a recorded query trace against a kmer count index.
+ * @details k, map type and storage hash are compile time (pK, pMAP, pStoreHash, as in BenchmarkScaling).  the index is
+ *          built from a FASTQ file, then the find and count batches of the trace (see Index::enable_query_trace and
+ *          query_trace.hpp) are issued in their recorded order.
+ *
+ *          each rank replays <trace>.<rank mod recorded processes>, so a trace can be replayed on a different number
+ *          of processes.  with -x 0 the batches are issued back to back, otherwise at the recorded times divided by
+ *          the speed, e.g. -x 2 for twice the recorded rate.  a sampled trace replays its recorded kmers; -E draws
+ *          from them with replacement up to the recorded batch sizes.
+ *
+ *          the find and count totals are reported under the title "replay:k<k>:<map>:<hash>:p<P>".
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <thread>
+
+#include "utils/logging.h"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+
+#include "io/mxx_support.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+
+#include "index/kmer_index.hpp"
+#include "index/query_trace.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+// ================ define preproc macro constants
+#define STD 21
+#define MURMUR 22
+#define FARM 23
+
+#define SORTED 41
+#define UNORDERED 46
+#define DENSEHASH 47
+#define SWISS 48
+#define COMPACT 49
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+//================= define types
+
+using Alphabet = bliss::common::DNA;
+
+#if defined(pK)
+using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+#else
+using KmerType = bliss::common::Kmer<31, Alphabet, WordType>;
+#endif
+
+using CountType = uint32_t;
+
+template <typename KM>
+using DistHash = bliss::kmer::hash::farm<KM, true>;
+
+#if (pStoreHash == STD)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::cpp_std<KM, false>;
+#elif (pStoreHash == MURMUR)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::murmur<KM, false>;
+#else //if (pStoreHash == FARM)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::farm<KM, false>;
+#endif
+
+#if (pMAP == SORTED)
+  template <typename Key>
+  using MapParams = ::bliss::index::kmer::CanonicalSortedMapParams<Key>;
+#else
+  template <typename Key>
+  using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, DistHash, StoreHash>;
+#endif
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+
+#if (pMAP == SORTED)
+  using MapType = ::dsc::counting_sorted_map<
+    KmerType, CountType, MapParams>;
+#elif (pMAP == DENSEHASH)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys>;
+#elif (pMAP == SWISS)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys,
+    ::std::allocator< ::std::pair<const KmerType, CountType> >, ::fsc::swiss_map>;
+#elif (pMAP == COMPACT)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys,
+    ::std::allocator< ::std::pair<const KmerType, CountType> >, ::fsc::compact_counting_map8>;
+#else
+  using MapType = ::dsc::counting_unordered_map<
+    KmerType, CountType, MapParams>;
+#endif
+
+using IndexType = bliss::index::kmer::CountIndex<MapType>;
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::string filename;
+  std::string trace;
+  double speed = 0.0;
+  bool expand = false;
+  int iterations = 1;
+
+  try {
+    TCLAP::CmdLine cmd("Replay a recorded query trace against a kmer count index", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("f", "file", "FASTQ file to build the index from", true, "", "string", cmd);
+    TCLAP::ValueArg<std::string> traceArg("t", "trace", "query trace prefix, as passed to Index::enable_query_trace",
+                                          true, "", "string", cmd);
+    TCLAP::ValueArg<double> speedArg("x", "speed", "replay speed relative to the recording.  0 for back to back batches. default 0",
+                                     false, speed, "double", cmd);
+    TCLAP::SwitchArg expandArg("E", "expand", "draw from the sampled kmers up to the recorded batch sizes", cmd, false);
+    TCLAP::ValueArg<int> iterArg("i", "iterations", "repetitions of the replay. default=1", false, iterations, "int", cmd);
+
+    cmd.parse( argc, argv );
+
+    filename = fileArg.getValue();
+    trace = traceArg.getValue();
+    speed = std::max(0.0, speedArg.getValue());
+    expand = expandArg.getValue();
+    iterations = std::max(1, iterArg.getValue());
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  std::stringstream ts;
+  ts << "replay:k" << KmerType::size << ":" << STR(pMAP) << ":" << STR(pStoreHash) << ":p" << comm.size();
+  std::string title = ts.str();
+
+  BL_BENCH_INIT(test);
+
+  // load the batches of this rank.
+  BL_BENCH_START(test);
+  std::vector<::bliss::index::query_trace_batch<KmerType> > batches;
+  {
+    uint32_t procs = 1;
+    {
+      ::bliss::index::query_trace_reader<KmerType> reader(::bliss::index::query_trace_filename(trace, 0));
+      procs = reader.get_header().comm_size;
+    }
+    ::bliss::index::query_trace_reader<KmerType> reader(::bliss::index::query_trace_filename(trace, comm.rank() % procs));
+    batches = reader.read_all();
+
+    if (expand) {
+      std::default_random_engine generator(comm.rank());
+      for (auto & b : batches) {
+        if (b.kmers.empty() || (b.kmers.size() >= b.batch_size)) continue;
+        std::uniform_int_distribution<size_t> pick(0, b.kmers.size() - 1);
+        b.kmers.reserve(b.batch_size);
+        while (b.kmers.size() < b.batch_size) b.kmers.emplace_back(b.kmers[pick(generator)]);
+        std::shuffle(b.kmers.begin(), b.kmers.end(), generator);
+      }
+    }
+  }
+  size_t recorded = 0;
+  for (auto const & b : batches) recorded += b.kmers.size();
+  BL_BENCH_COLLECTIVE_END(test, "read_trace", recorded, comm);
+
+  // the traces of all ranks have the same sequence of calls.
+  if (::mxx::allreduce(batches.size(), ::mxx::max<size_t>(), comm) != ::mxx::allreduce(batches.size(), ::mxx::min<size_t>(), comm)) {
+    if (comm.rank() == 0) std::cerr << "error: the trace files have different numbers of batches." << std::endl;
+    exit(-1);
+  }
+  if (comm.rank() == 0) printf("%s: %lu batches per rank, speed %f\n", title.c_str(), batches.size(), speed);
+
+  IndexType idx(comm);
+  BL_BENCH_START(test);
+  idx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  BL_BENCH_COLLECTIVE_END(test, "build", idx.local_size(), comm);
+
+  for (int it = 0; it < iterations; ++it) {
+    double find_time = 0.0, count_time = 0.0, late = 0.0;
+    size_t find_kmers = 0, count_kmers = 0;
+    size_t found = 0, counted = 0;
+
+    comm.barrier();
+    auto start = std::chrono::steady_clock::now();
+    BL_BENCH_START(test);
+    for (auto const & b : batches) {
+      if (speed > 0.0) {
+        auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(b.time / speed));
+        auto now = std::chrono::steady_clock::now();
+        if (now < due) std::this_thread::sleep_until(due);
+        else late += std::chrono::duration<double>(now - due).count();
+      }
+
+      std::vector<KmerType> query(b.kmers);
+      auto t0 = std::chrono::steady_clock::now();
+      if (b.op == ::bliss::index::query_op::FIND) {
+        found += idx.find(query).size();
+        find_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        find_kmers += b.kmers.size();
+      } else {
+        counted += idx.count(query).size();
+        count_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        count_kmers += b.kmers.size();
+      }
+    }
+    BL_BENCH_COLLECTIVE_END(test, "replay", found + counted, comm);
+
+    // slowest rank per call type.
+    find_time = ::mxx::allreduce(find_time, ::mxx::max<double>(), comm);
+    count_time = ::mxx::allreduce(count_time, ::mxx::max<double>(), comm);
+    late = ::mxx::allreduce(late, ::mxx::max<double>(), comm);
+    find_kmers = ::mxx::allreduce(find_kmers, comm);
+    count_kmers = ::mxx::allreduce(count_kmers, comm);
+    if (comm.rank() == 0) {
+      printf("%s: iteration %d find %lu kmers in %f s (%f kmers/s), count %lu kmers in %f s (%f kmers/s), max lag %f s\n",
+             title.c_str(), it, find_kmers, find_time, (find_time > 0.0) ? find_kmers / find_time : 0.0,
+             count_kmers, count_time, (count_time > 0.0) ? count_kmers / count_time : 0.0, late);
+    }
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(test, title, comm);
+
+  // mpi cleanup is automatic
+  comm.barrier();
+
+  return 0;
+}
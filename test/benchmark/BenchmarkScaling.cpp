@@ -0,0 +1,325 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkScaling.cpp
+ * @ingroup
+ * @brief   strong and weak scaling benchmark of kmer count index build, count, find and erase on synthetic reads.
+ * @details k, map type and storage hash are compile time (pK, pMAP, pStoreHash, as in BenchmarkKmerIndex).
+ *          the file reader, scaling mode, data size, coverage and error rate are runtime parameters.
+ *          reads are generated with bliss::io::synthetic_reads and written to a FASTQ file, which is then read back with the
+ *          chosen reader, or kept in memory as file_data (-A 0).  in weak mode -n is the reads per rank, in strong mode the total reads.
+ *
+ *          the phases are reported under the title "scaling:<mode>:k<k>:<map>:<hash>:<reader>:p<P>", so setting
+ *          BL_BENCH_OUTPUT gives 1 structured record per phase and configuration.  scaling_suite.sh runs the matrix.
+ *          -P compact|spread pins the ranks and their threads to cores (utils/affinity.hpp), and the placement is printed
+ *          as [AFFINITY] lines.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <unistd.h>  // getpid
+
+#include "utils/logging.h"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+
+#include "io/mxx_support.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+
+#include "io/synthetic_reads.hpp"
+#include "index/kmer_index.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/affinity.hpp"
+#include "utils/exception_handling.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+
+// ================ define preproc macro constants
+#define STD 21
+#define MURMUR 22
+#define FARM 23
+
+#define UNORDERED 46
+#define DENSEHASH 47
+#define SWISS 48
+#define COMPACT 49
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+//================= define types
+
+using Alphabet = bliss::common::DNA;
+
+#if defined(pK)
+using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+#else
+using KmerType = bliss::common::Kmer<31, Alphabet, WordType>;
+#endif
+
+using CountType = uint32_t;
+
+template <typename KM>
+using DistHash = bliss::kmer::hash::farm<KM, true>;
+
+#if (pStoreHash == STD)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::cpp_std<KM, false>;
+#elif (pStoreHash == MURMUR)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::murmur<KM, false>;
+#else //if (pStoreHash == FARM)
+  template <typename KM>
+  using StoreHash = bliss::kmer::hash::farm<KM, false>;
+#endif
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, DistHash, StoreHash>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+
+#if (pMAP == DENSEHASH)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys>;
+#elif (pMAP == SWISS)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys,
+    ::std::allocator< ::std::pair<const KmerType, CountType> >, ::fsc::swiss_map>;
+#elif (pMAP == COMPACT)
+  using MapType = ::dsc::counting_densehash_map<
+    KmerType, CountType, MapParams, SpecialKeys,
+    ::std::allocator< ::std::pair<const KmerType, CountType> >, ::fsc::compact_counting_map8>;
+#else
+  using MapType = ::dsc::counting_unordered_map<
+    KmerType, CountType, MapParams>;
+#endif
+
+using IndexType = bliss::index::kmer::CountIndex<MapType>;
+
+
+template <typename KmerParser>
+void read_reads(std::string const & filename, ::bliss::io::file_data const & mem, int const & reader_algo,
+                std::vector<typename KmerParser::value_type> & out, mxx::comm const & comm) {
+  if (reader_algo == 0) {
+    ::bliss::io::KmerFileHelper::parse_file_data<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(mem, out);
+  } else if (reader_algo == 5) {
+    ::bliss::io::KmerFileHelper::read_file_mmap<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+  } else if (reader_algo == 7) {
+    ::bliss::io::KmerFileHelper::read_file_posix<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+  } else if (reader_algo == 10) {
+    ::bliss::io::KmerFileHelper::read_file_mpiio<KmerParser, ::bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, out, comm);
+  } else {
+    throw std::invalid_argument("missing file reader type");
+  }
+}
+
+char const * reader_name(int const & reader_algo) {
+  return (reader_algo == 0) ? "mem" : ((reader_algo == 5) ? "mmap" : ((reader_algo == 7) ? "posix" : "mpiio"));
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::string mode("weak");
+  size_t reads = 100000;
+  size_t read_len = 100;
+  double coverage = 30.0;
+  double error_rate = 0.01;
+  double n_rate = 0.0;
+  double repeat_fraction = 0.0;
+  size_t seed = 1;
+  int reader_algo = 7;
+  int sample_ratio = 10;
+  int iterations = 1;
+  std::string filename;
+  bool keep = false;
+  std::string pin("none");
+
+  try {
+    TCLAP::CmdLine cmd("Strong/weak scaling benchmark of kmer count index on synthetic reads", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> modeArg("m", "mode", "scaling mode: weak (-n reads per rank) or strong (-n reads total). default weak",
+                                         false, mode, "string", cmd);
+    TCLAP::ValueArg<size_t> readsArg("n", "reads", "number of reads, per rank (weak) or total (strong). default 100000",
+                                     false, reads, "size_t", cmd);
+    TCLAP::ValueArg<size_t> lenArg("L", "length", "read length. default 100", false, read_len, "size_t", cmd);
+    TCLAP::ValueArg<double> covArg("c", "coverage", "mean coverage. default 30", false, coverage, "double", cmd);
+    TCLAP::ValueArg<double> errArg("e", "error", "per base substitution rate. default 0.01", false, error_rate, "double", cmd);
+    TCLAP::ValueArg<double> nArg("N", "n-rate", "per base N rate. default 0", false, n_rate, "double", cmd);
+    TCLAP::ValueArg<double> repArg("r", "repeats", "fraction of the genome in repeats. default 0", false, repeat_fraction, "double", cmd);
+    TCLAP::ValueArg<size_t> seedArg("s", "seed", "random seed. default 1", false, seed, "size_t", cmd);
+    TCLAP::ValueArg<int> algoArg("A", "algo", "Reader Algorithm id. in memory (no file) = 0, mmap = 5, posix=7, mpiio = 10. default is 7.",
+                                 false, reader_algo, "int", cmd);
+    TCLAP::ValueArg<int> sampleArg("S", "query-sample", "1 in S kmers are queried. default=10", false, sample_ratio, "int", cmd);
+    TCLAP::ValueArg<int> iterArg("i", "iterations", "repetitions of the benchmark. default=1", false, iterations, "int", cmd);
+    TCLAP::ValueArg<std::string> fileArg("F", "file", "synthetic FASTQ file path. default ./scaling.<pid of rank 0>.fastq",
+                                         false, "", "string", cmd);
+    TCLAP::SwitchArg keepArg("K", "keep", "keep the synthetic FASTQ file", cmd, false);
+    TCLAP::ValueArg<std::string> pinArg("P", "pin", "pin ranks and threads to cores: none (launcher binding), compact or spread (over NUMA nodes). default none",
+                                        false, pin, "string", cmd);
+
+    cmd.parse( argc, argv );
+
+    mode = modeArg.getValue();
+    reads = readsArg.getValue();
+    read_len = lenArg.getValue();
+    coverage = covArg.getValue();
+    error_rate = errArg.getValue();
+    n_rate = nArg.getValue();
+    repeat_fraction = repArg.getValue();
+    seed = seedArg.getValue();
+    reader_algo = algoArg.getValue();
+    sample_ratio = std::max(1, sampleArg.getValue());
+    iterations = std::max(1, iterArg.getValue());
+    filename = fileArg.getValue();
+    keep = keepArg.getValue();
+    pin = pinArg.getValue();
+
+    if ((mode != "weak") && (mode != "strong")) throw TCLAP::ArgException("mode must be weak or strong", "mode");
+    if ((pin != "none") && (pin != "compact") && (pin != "spread")) throw TCLAP::ArgException("pin must be none, compact or spread", "pin");
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  // pin before the tables are allocated, so their pages land on the rank's node.  see affinity.hpp
+  ::bliss::utils::affinity_manager::instance().pin_ranks(comm, ::bliss::utils::parse_affinity_policy(pin));
+  ::bliss::utils::affinity_manager::instance().pin_omp_threads();
+  BL_BENCH_AFFINITY(comm);
+
+  // node memory bandwidth, before any phase.  see memory_bandwidth.hpp
+  BL_BENCH_PEAK_BANDWIDTH(comm);
+
+  if (filename.empty()) {
+    std::stringstream ss;
+    ss << "./scaling." << ::mxx::bcast(static_cast<int>(getpid()), 0, comm) << ".fastq";
+    filename = ss.str();
+  }
+
+  size_t total_reads = (mode == "weak") ? reads * comm.size() : reads;
+
+  std::stringstream ts;
+  ts << "scaling:" << mode << ":k" << KmerType::size << ":" << STR(pMAP) << ":" << STR(pStoreHash) << ":"
+     << reader_name(reader_algo) << ":p" << comm.size();
+  std::string title = ts.str();
+
+  if (comm.rank() == 0) printf("%s: %lu reads of length %lu, coverage %f, error rate %f\n",
+                               title.c_str(), total_reads, read_len, coverage, error_rate);
+
+  BL_BENCH_INIT(test);
+
+  ::bliss::io::synthetic_read_params params;
+  params.read_len = read_len;
+  params.coverage = coverage;
+  params.sub_start = error_rate;
+  params.sub_end = error_rate;
+  params.n_rate = n_rate;
+  params.repeat_fraction = repeat_fraction;
+  params.seed = seed;
+  ::bliss::io::synthetic_reads gen(total_reads, params);
+  BL_BENCH_START(test);
+  ::bliss::io::file_data mem;
+  size_t bytes = 0;
+  if (reader_algo == 0) {
+    mem = gen.generate_file_data(total_reads, comm);
+    bytes = mem.data.size();
+  } else {
+    bytes = gen.write_fastq(filename, total_reads, comm);
+  }
+  BL_BENCH_COLLECTIVE_END(test, "generate", bytes, comm);
+
+  for (int it = 0; it < iterations; ++it) {
+    IndexType idx(comm);
+
+    {
+      ::std::vector<typename IndexType::KmerParserType::value_type> temp;
+
+      BL_BENCH_START(test);
+      read_reads<typename IndexType::KmerParserType>(filename, mem, reader_algo, temp, comm);
+      BL_BENCH_COLLECTIVE_END(test, "read", temp.size(), comm);
+
+      BL_BENCH_START(test);
+      idx.insert(temp);
+      BL_BENCH_COLLECTIVE_END(test, "build", idx.local_size(), comm);
+    }
+
+    ::std::vector<KmerType> query;
+    {
+      BL_BENCH_START(test);
+      ::std::vector<KmerType> all;
+      read_reads<::bliss::index::kmer::KmerParser<KmerType> >(filename, mem, reader_algo, all, comm);
+      query.reserve(all.size() / sample_ratio + 1);
+      for (size_t i = 0; i < all.size(); i += sample_ratio) query.emplace_back(all[i]);
+      BL_BENCH_COLLECTIVE_END(test, "read_query", query.size(), comm);
+    }
+
+    {
+      auto lquery = query;
+      BL_BENCH_START(test);
+      auto counts = idx.count(lquery);
+      BL_BENCH_COLLECTIVE_END(test, "count", counts.size(), comm);
+    }
+    {
+      auto lquery = query;
+      BL_BENCH_START(test);
+      auto found = idx.find(lquery);
+      BL_BENCH_COLLECTIVE_END(test, "find", found.size(), comm);
+    }
+    {
+      auto lquery = query;
+      BL_BENCH_START(test);
+      idx.erase(lquery);
+      BL_BENCH_COLLECTIVE_END(test, "erase", idx.local_size(), comm);
+    }
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(test, title, comm);
+
+  if (!keep && (reader_algo != 0) && (comm.rank() == 0)) remove(filename.c_str());
+
+  // mpi cleanup is automatic
+  comm.barrier();
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+#!/bin/bash
+#
+# comparison of kmerind (benchCompare-* executables, BenchmarkCompetitive.cpp) with Jellyfish, KMC and BFCounter.
+#
+# for each dataset and k, runs the canonical kmer count and a count query of the same sampled kmers with each tool that
+# is installed, and writes 1 structured record file per run into OUT_DIR in the BL_BENCH_OUTPUT CSV format, under the
+# title "compare:<tool>:k<k>:<dataset>:c<cores>".  kmerind is run for each process count in PROCS, the other tools
+# for each thread count in THREADS.  for the other tools, wall time and peak RSS are from GNU time, the record is for
+# 1 process, and the query is "jellyfish query -s" or "kmc_tools filter" of the kmerind query kmers.
+# BFCounter has no query, so only its count is recorded.
+#
+# OUT_DIR/compare.csv has all records.  OUT_DIR/compare_summary.csv has, per tool, k, dataset, phase and core count,
+# the wall time, the kmer throughput per core and per node, the peak memory per rank and per node, and the scaling
+# efficiency relative to the run of the same tool with the fewest cores.  the kmerind count time includes its read
+# phase, since the other tools count from the file.  all tools are charged with the number of input kmers from the
+# kmerind read phase, so run kmerind with each dataset and k.
+#
+# datasets are not downloaded:  use the FASTQ or FASTA files of the published comparisons, e.g. the GAGE or SRA
+# read sets, from local storage.
+#
+# usage: compare_suite.sh [BIN_DIR] [OUT_DIR]
+#   environment (defaults in parentheses):
+#     DATASETS        FASTQ or FASTA files, required
+#     KS              kmer lengths, each needs a benchCompare-k<k> executable ("31")
+#     PROCS           kmerind process counts ("1 2 4 8")
+#     THREADS         thread counts of the other tools ("1 2 4 8")
+#     CORES_PER_NODE  cores of 1 node, for the per node numbers (16)
+#     TOOLS           tools to run, if installed ("kmerind jellyfish kmc bfcounter")
+#     JELLYFISH (jellyfish)  KMC (kmc)  KMC_TOOLS (kmc_tools)  BFCOUNTER (BFCounter)
+#     JF_HASH_SIZE    jellyfish initial hash size (100M)   KMC_MEM_GB  kmc memory limit in GB (16)
+#     BF_KMERS        BFCounter expected number of kmers (1000000000)
+#     READER          kmerind reader id, mmap = 5 posix=7 mpiio = 10 (7)
+#     SAMPLE          1 in SAMPLE kmers are queried (10)
+#     ITERATIONS (1)  MPIRUN ("mpirun"), MPIRUN_FLAGS ("")
+#     TIME            GNU time ("/usr/bin/time")
+
+BIN_DIR=${1:-./bin}
+OUT_DIR=${2:-./compare_results}
+
+DATASETS=${DATASETS:-""}
+KS=${KS:-"31"}
+PROCS=${PROCS:-"1 2 4 8"}
+THREADS=${THREADS:-"1 2 4 8"}
+CORES_PER_NODE=${CORES_PER_NODE:-16}
+TOOLS=${TOOLS:-"kmerind jellyfish kmc bfcounter"}
+JELLYFISH=${JELLYFISH:-jellyfish}
+KMC=${KMC:-kmc}
+KMC_TOOLS=${KMC_TOOLS:-kmc_tools}
+BFCOUNTER=${BFCOUNTER:-BFCounter}
+JF_HASH_SIZE=${JF_HASH_SIZE:-100M}
+KMC_MEM_GB=${KMC_MEM_GB:-16}
+BF_KMERS=${BF_KMERS:-1000000000}
+READER=${READER:-7}
+SAMPLE=${SAMPLE:-10}
+ITERATIONS=${ITERATIONS:-1}
+MPIRUN=${MPIRUN:-mpirun}
+MPIRUN_FLAGS=${MPIRUN_FLAGS:-""}
+TIME=${TIME:-/usr/bin/time}
+
+HEADER="title,site,phase,ranks,calls,dur_min,dur_max,dur_mean,cnt_min,cnt_max,cnt_mean,throughput,mem_calls,rss_delta_min,rss_delta_max,rss_delta_mean,peak_max"
+
+if [ -z "${DATASETS}" ]; then
+  echo "set DATASETS to the FASTQ or FASTA files to compare on" >&2
+  exit 1
+fi
+if ! ${TIME} -f "%e" true > /dev/null 2>&1; then
+  echo "GNU time (${TIME}) is needed for the wall time and peak memory of the other tools" >&2
+  exit 1
+fi
+
+mkdir -p ${OUT_DIR}
+WORK=${OUT_DIR}/work
+mkdir -p ${WORK}
+
+has_tool() {
+  case " ${TOOLS} " in *" $1 "*) ;; *) return 1 ;; esac
+  command -v $2 > /dev/null 2>&1
+}
+
+# run_timed <csv> <title> <phase> <count> <log> cmd...:  run cmd under GNU time and write 1 record.
+run_timed() {
+  local csv=$1 title=$2 phase=$3 cnt=$4 log=$5
+  shift 5
+  ${TIME} -f "%e %M" -o ${WORK}/time.txt "$@" >> ${log} 2>&1
+  local rc=$?
+  if [ ${rc} -ne 0 ]; then
+    echo "  FAILED ${phase}, see ${log}" >&2
+    return ${rc}
+  fi
+  read secs kb < <(tail -n 1 ${WORK}/time.txt)
+  [ -f ${csv} ] || echo ${HEADER} > ${csv}
+  awk -v t="${title}" -v ph="${phase}" -v s="${secs}" -v n="${cnt}" -v kb="${kb}" 'BEGIN {
+    tp = (s > 0) ? n / s : 0;
+    printf("%s,compare_suite.sh,%s,1,1,%s,%s,%s,%s,%s,%s,%g,1,0,0,0,%.0f\n", t, ph, s, s, s, n, n, n, tp, kb * 1024.0);
+  }' >> ${csv}
+}
+
+status=0
+for data in ${DATASETS}; do
+  ds=$(basename ${data})
+  ds=${ds%%.*}
+  for k in ${KS}; do
+    queries=${WORK}/${ds}-k${k}.queries.fa
+
+    if has_tool kmerind ${BIN_DIR}/benchCompare-k${k}; then
+      for p in ${PROCS}; do
+        out=${OUT_DIR}/kmerind-${ds}-k${k}-c${p}.csv
+        log=${OUT_DIR}/kmerind-${ds}-k${k}-c${p}.log
+        echo "kmerind ${ds} k=${k} p=${p}"
+        rm -f ${out}
+        BL_BENCH_OUTPUT=${out} ${MPIRUN} ${MPIRUN_FLAGS} -np ${p} ${BIN_DIR}/benchCompare-k${k} -F ${data} \
+          -A ${READER} -S ${SAMPLE} -i ${ITERATIONS} -Q ${queries} > ${log} 2>&1
+        if [ $? -ne 0 ]; then
+          echo "  FAILED, see ${log}" >&2
+          status=1
+        fi
+      done
+    fi
+    nq=0
+    [ -f ${queries} ] && nq=$(grep -c '^>' ${queries})
+
+    if has_tool jellyfish ${JELLYFISH}; then
+      for t in ${THREADS}; do
+        out=${OUT_DIR}/jellyfish-${ds}-k${k}-c${t}.csv
+        log=${OUT_DIR}/jellyfish-${ds}-k${k}-c${t}.log
+        title="compare:jellyfish:k${k}:${ds}:c${t}"
+        echo "jellyfish ${ds} k=${k} t=${t}"
+        rm -f ${out} ${log} ${WORK}/jf.jf
+        run_timed ${out} ${title} count 0 ${log} \
+          ${JELLYFISH} count -C -m ${k} -s ${JF_HASH_SIZE} -t ${t} -o ${WORK}/jf.jf ${data} || status=1
+        if [ -f ${WORK}/jf.jf ] && [ ${nq} -gt 0 ]; then
+          run_timed ${out} ${title} query ${nq} ${log} \
+            ${JELLYFISH} query -s ${queries} -o ${WORK}/jf.query ${WORK}/jf.jf || status=1
+        fi
+        rm -f ${WORK}/jf.jf ${WORK}/jf.query
+      done
+    fi
+
+    if has_tool kmc ${KMC}; then
+      for t in ${THREADS}; do
+        out=${OUT_DIR}/kmc-${ds}-k${k}-c${t}.csv
+        log=${OUT_DIR}/kmc-${ds}-k${k}-c${t}.log
+        title="compare:kmc:k${k}:${ds}:c${t}"
+        echo "kmc ${ds} k=${k} t=${t}"
+        rm -f ${out} ${log} ${WORK}/kmc.kmc_*
+        mkdir -p ${WORK}/kmc_tmp
+        fmt=-fq
+        case ${data} in *.fa|*.fasta|*.fna|*.ffn) fmt=-fm ;; esac
+        # -ci1 keeps the singletons, as kmerind and jellyfish do.
+        run_timed ${out} ${title} count 0 ${log} \
+          ${KMC} -k${k} -t${t} -m${KMC_MEM_GB} -ci1 ${fmt} ${data} ${WORK}/kmc ${WORK}/kmc_tmp || status=1
+        if [ -f ${WORK}/kmc.kmc_pre ] && [ ${nq} -gt 0 ] && command -v ${KMC_TOOLS} > /dev/null 2>&1; then
+          run_timed ${out} ${title} query ${nq} ${log} \
+            ${KMC_TOOLS} -t${t} filter ${WORK}/kmc -ci1 ${queries} -fa ${WORK}/kmc.query.fa || status=1
+        fi
+        rm -rf ${WORK}/kmc.kmc_* ${WORK}/kmc_tmp ${WORK}/kmc.query.fa
+      done
+    fi
+
+    if has_tool bfcounter ${BFCOUNTER}; then
+      for t in ${THREADS}; do
+        out=${OUT_DIR}/bfcounter-${ds}-k${k}-c${t}.csv
+        log=${OUT_DIR}/bfcounter-${ds}-k${k}-c${t}.log
+        echo "bfcounter ${ds} k=${k} t=${t}"
+        rm -f ${out} ${log}
+        run_timed ${out} "compare:bfcounter:k${k}:${ds}:c${t}" count 0 ${log} \
+          ${BFCOUNTER} count -k ${k} -n ${BF_KMERS} -t ${t} -o ${WORK}/bf.bin ${data} || status=1
+        rm -f ${WORK}/bf.bin
+      done
+    fi
+  done
+done
+
+# merge, keeping the first header.
+rm -f ${OUT_DIR}/compare.csv
+for f in ${OUT_DIR}/*-c*.csv; do
+  [ -f ${f} ] || continue
+  if [ ! -f ${OUT_DIR}/compare.csv ]; then
+    cat ${f} > ${OUT_DIR}/compare.csv
+  else
+    tail -n +2 ${f} >> ${OUT_DIR}/compare.csv
+  fi
+done
+[ -f ${OUT_DIR}/compare.csv ] || exit 1
+
+# summary.  dur_mean and cnt_mean are summed over the calls, so the per call mean time is dur_mean / calls,
+# and the total count is cnt_mean / calls * ranks.
+awk -F, -v cpn=${CORES_PER_NODE} '
+NR == 1 { next }
+{
+  split($1, f, ":");
+  if (f[1] != "compare") next;
+  key = f[2] SUBSEP f[3] SUBSEP f[4] SUBSEP substr(f[5], 2);
+  secs = ($5 > 0) ? $8 / $5 : 0;
+  if ($3 == "read") { rd[key] += secs; input[f[3] SUBSEP f[4]] = $11 / $5 * $4; }
+  else if ($3 == "count" || $3 == "query") {
+    k2 = key SUBSEP $3;
+    t[k2] = secs; n[k2] = $11 / $5 * $4; peak[k2] = $17; ranks[k2] = $4;
+    if ($3 == "count") has_count[key] = 1;
+  }
+}
+END {
+  print "tool,k,dataset,phase,cores,nodes,seconds,kmers,kmers_per_s,kmers_per_s_per_core,kmers_per_s_per_node,peak_mb_per_rank,peak_mb_per_node,efficiency";
+  for (k2 in t) {
+    split(k2, f, SUBSEP);
+    key = f[1] SUBSEP f[2] SUBSEP f[3] SUBSEP f[4];
+    c = f[4] + 0;
+    s = t[k2];
+    if (f[5] == "count") s += rd[key];
+    kmers = (f[5] == "count") ? input[f[2] SUBSEP f[3]] + 0 : n[k2];
+    sec[k2] = s; km[k2] = kmers;
+    g = f[1] SUBSEP f[2] SUBSEP f[3] SUBSEP f[5];
+    if (!(g in base_c) || c < base_c[g]) { base_c[g] = c; base_s[g] = s; }
+  }
+  for (k2 in t) {
+    split(k2, f, SUBSEP);
+    c = f[4] + 0;
+    # the other tools are 1 multithreaded process on 1 node.
+    nodes = (ranks[k2] > 1) ? int((c + cpn - 1) / cpn) : 1;
+    per_node_ranks = (ranks[k2] < cpn) ? ranks[k2] : cpn;
+    s = sec[k2];
+    tp = (s > 0) ? km[k2] / s : 0;
+    g = f[1] SUBSEP f[2] SUBSEP f[3] SUBSEP f[5];
+    eff = (s > 0) ? (base_s[g] * base_c[g]) / (s * c) : 0;
+    printf("%s,%s,%s,%s,%d,%d,%g,%.0f,%g,%g,%g,%g,%g,%g\n", f[1], substr(f[2], 2), f[3], f[5], c, nodes, s, km[k2],
+           tp, tp / c, tp / nodes, peak[k2] / 1048576.0, peak[k2] * per_node_ranks / 1048576.0, eff);
+  }
+}' ${OUT_DIR}/compare.csv | (read header; echo "${header}"; sort -t, -k3,3 -k2,2n -k4,4 -k1,1 -k5,5n) > ${OUT_DIR}/compare_summary.csv
+
+exit ${status}
@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# strong and weak scaling driver for the benchScaling-* executables (BenchmarkScaling.cpp).
+#
+# runs every benchScaling executable in BIN_DIR for each scaling mode, file reader and process count, and writes
+# 1 structured benchmark record file (BL_BENCH_OUTPUT) per run into OUT_DIR, plus OUT_DIR/scaling.csv with all of them.
+#
+# usage: scaling_suite.sh [BIN_DIR] [OUT_DIR]
+#   environment (defaults in parentheses):
+#     PROCS        process counts ("1 2 4 8")
+#     MODES        scaling modes ("weak strong")
+#     READERS      reader ids, in memory=0 mmap=5 posix=7 mpiio=10 ("0 7 10")
+#     WEAK_READS   reads per rank in weak mode (200000)
+#     STRONG_READS total reads in strong mode (1600000)
+#     READ_LEN (100)  COVERAGE (30)  ERROR_RATE (0.01)  SEED (1)  ITERATIONS (3)
+#     MPIRUN       launcher ("mpirun"), MPIRUN_FLAGS ("")
+
+BIN_DIR=${1:-./bin}
+OUT_DIR=${2:-./scaling_results}
+
+PROCS=${PROCS:-"1 2 4 8"}
+MODES=${MODES:-"weak strong"}
+READERS=${READERS:-"0 7 10"}
+WEAK_READS=${WEAK_READS:-200000}
+STRONG_READS=${STRONG_READS:-1600000}
+READ_LEN=${READ_LEN:-100}
+COVERAGE=${COVERAGE:-30}
+ERROR_RATE=${ERROR_RATE:-0.01}
+SEED=${SEED:-1}
+ITERATIONS=${ITERATIONS:-3}
+MPIRUN=${MPIRUN:-mpirun}
+MPIRUN_FLAGS=${MPIRUN_FLAGS:-""}
+
+mkdir -p ${OUT_DIR}
+
+EXES=$(ls ${BIN_DIR}/benchScaling-* 2>/dev/null)
+if [ -z "${EXES}" ]; then
+  echo "no benchScaling executables in ${BIN_DIR}.  configure with ENABLE_SCALING_BENCHMARK=ON" >&2
+  exit 1
+fi
+
+status=0
+for exe in ${EXES}; do
+  name=$(basename ${exe})
+  for mode in ${MODES}; do
+    if [ "${mode}" == "weak" ]; then
+      reads=${WEAK_READS}
+    else
+      reads=${STRONG_READS}
+    fi
+    for reader in ${READERS}; do
+      for p in ${PROCS}; do
+        out=${OUT_DIR}/${name}-${mode}-A${reader}-p${p}.csv
+        log=${OUT_DIR}/${name}-${mode}-A${reader}-p${p}.log
+        echo "${name} ${mode} reader=${reader} p=${p}"
+        BL_BENCH_OUTPUT=${out} ${MPIRUN} ${MPIRUN_FLAGS} -np ${p} ${exe} -m ${mode} -n ${reads} -L ${READ_LEN} \
+          -c ${COVERAGE} -e ${ERROR_RATE} -s ${SEED} -A ${reader} -i ${ITERATIONS} \
+          -F ${OUT_DIR}/${name}-${mode}-p${p}.fastq > ${log} 2>&1
+        if [ $? -ne 0 ]; then
+          echo "  FAILED, see ${log}" >&2
+          status=1
+        fi
+      done
+    done
+  done
+done
+
+# merge, keeping the first header.
+rm -f ${OUT_DIR}/scaling.csv
+for f in ${OUT_DIR}/benchScaling-*.csv; do
+  [ -f ${f} ] || continue
+  if [ ! -f ${OUT_DIR}/scaling.csv ]; then
+    cat ${f} > ${OUT_DIR}/scaling.csv
+  else
+    tail -n +2 ${f} >> ${OUT_DIR}/scaling.csv
+  fi
+done
+
+exit ${status}